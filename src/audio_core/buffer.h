@@ -0,0 +1,19 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <vector>
+#include "common/common_types.h"
+
+namespace AudioCore {
+
+/// A buffer of interleaved 16-bit samples appended to a stream by the guest
+struct Buffer {
+    /// Guest identifier of the buffer, returned once it was played
+    u64 tag;
+    std::vector<s16> samples;
+};
+
+} // namespace AudioCore
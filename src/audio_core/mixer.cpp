@@ -0,0 +1,423 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "audio_core/mixer.h"
+#include "common/assert.h"
+#include "common/kernel_dispatch.h"
+
+#ifdef ARCHITECTURE_x86_64
+#include <immintrin.h>
+#include "common/x64/cpu_detect.h"
+#endif
+
+namespace AudioCore {
+
+constexpr u32 FRACTION_ONE = 0x10000;
+
+/// Phases of the interpolation filter, selected by the top bits of the fraction
+constexpr size_t NUM_PHASES = 64;
+constexpr u32 PHASE_SHIFT = 10;
+static_assert(FRACTION_ONE >> PHASE_SHIFT == NUM_PHASES, "Phases don't cover a frame");
+
+/// The filter coefficients are fixed-point, with this many fractional bits
+constexpr u32 COEFFICIENT_BITS = 14;
+constexpr s32 COEFFICIENT_ROUNDING = 1 << (COEFFICIENT_BITS - 1);
+
+/// Cutoff of the filter relative to the input Nyquist frequency, below 1 to reduce imaging
+constexpr double FILTER_CUTOFF = 0.9;
+
+using FilterBank = std::array<std::array<s16, RESAMPLER_TAPS>, NUM_PHASES>;
+
+/// Blackman-windowed sinc, each phase normalized to a gain of exactly 1
+static FilterBank GenerateFilterBank() {
+    constexpr double pi = 3.14159265358979323846;
+    constexpr double half_width = RESAMPLER_TAPS / 2;
+
+    FilterBank bank{};
+    for (size_t phase = 0; phase < NUM_PHASES; ++phase) {
+        const double fraction = static_cast<double>(phase) / NUM_PHASES;
+        std::array<double, RESAMPLER_TAPS> taps;
+        double sum = 0.0;
+        for (size_t tap = 0; tap < RESAMPLER_TAPS; ++tap) {
+            // Distance of the tap from the interpolated position, between taps 3 and 4
+            const double x = static_cast<double>(tap) - (half_width - 1) - fraction;
+            const double sinc =
+                x == 0.0 ? 1.0 : std::sin(pi * FILTER_CUTOFF * x) / (pi * FILTER_CUTOFF * x);
+            const double window = 0.42 + 0.5 * std::cos(pi * x / half_width) +
+                                  0.08 * std::cos(2.0 * pi * x / half_width);
+            taps[tap] = sinc * window;
+            sum += taps[tap];
+        }
+
+        s32 total = 0;
+        for (size_t tap = 0; tap < RESAMPLER_TAPS; ++tap) {
+            bank[phase][tap] =
+                static_cast<s16>(std::lround(taps[tap] / sum * (1 << COEFFICIENT_BITS)));
+            total += bank[phase][tap];
+        }
+        // The rounding error goes to the tap closest to the position
+        const size_t center = fraction < 0.5 ? RESAMPLER_TAPS / 2 - 1 : RESAMPLER_TAPS / 2;
+        bank[phase][center] += static_cast<s16>((1 << COEFFICIENT_BITS) - total);
+    }
+    return bank;
+}
+
+alignas(32) static const FilterBank filter_bank = GenerateFilterBank();
+
+/// Adds stereo frames to a mix buffer with a volume changing by volume_step every frame
+using MixFunc = void (*)(s32* mix, const s16* samples, size_t num_frames, float start_volume,
+                         float volume_step);
+using ClampFunc = void (*)(s16* output, const s32* mix, size_t num_samples);
+/**
+ * Computes output frames from planar input frames. Output frame i is interpolated from the
+ * RESAMPLER_TAPS frames of each plane starting at positions[i], with the filter phases[i].
+ */
+using FilterFunc = void (*)(s16* output, size_t num_frames, u32 num_channels,
+                            const s16* const* planes, const size_t* positions, const u32* phases);
+
+static s16 SaturateFiltered(s32 sum) {
+    return static_cast<s16>(
+        std::clamp((sum + COEFFICIENT_ROUNDING) >> COEFFICIENT_BITS, -0x8000, 0x7FFF));
+}
+
+/// Mixes the frames [first_frame, last_frame), the vector kernels finish with it
+static void MixFramesScalar(s32* mix, const s16* samples, size_t first_frame, size_t last_frame,
+                            float start_volume, float volume_step) {
+    for (size_t frame = first_frame; frame < last_frame; ++frame) {
+        const float volume = start_volume + volume_step * static_cast<float>(frame);
+        mix[frame * 2] += static_cast<s32>(samples[frame * 2] * volume);
+        mix[frame * 2 + 1] += static_cast<s32>(samples[frame * 2 + 1] * volume);
+    }
+}
+
+static void MixSamplesScalar(s32* mix, const s16* samples, size_t num_frames, float start_volume,
+                             float volume_step) {
+    MixFramesScalar(mix, samples, 0, num_frames, start_volume, volume_step);
+}
+
+static void ClampSamplesScalar(s16* output, const s32* mix, size_t num_samples) {
+    for (size_t i = 0; i < num_samples; ++i) {
+        output[i] = static_cast<s16>(std::clamp(mix[i], -0x8000, 0x7FFF));
+    }
+}
+
+static void FilterScalar(s16* output, size_t num_frames, u32 num_channels,
+                         const s16* const* planes, const size_t* positions, const u32* phases) {
+    for (size_t frame = 0; frame < num_frames; ++frame) {
+        const auto& coefficients = filter_bank[phases[frame]];
+        for (u32 channel = 0; channel < num_channels; ++channel) {
+            const s16* window = planes[channel] + positions[frame];
+            s32 sum = 0;
+            for (size_t tap = 0; tap < RESAMPLER_TAPS; ++tap) {
+                sum += window[tap] * coefficients[tap];
+            }
+            output[frame * num_channels + channel] = SaturateFiltered(sum);
+        }
+    }
+}
+
+#ifdef ARCHITECTURE_x86_64
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+static_assert(RESAMPLER_TAPS == 8, "The vector filters take the taps of a plane in one load");
+
+static void MixSamplesSSE2(s32* mix, const s16* samples, size_t num_frames, float start_volume,
+                           float volume_step) {
+    const __m128 start = _mm_set1_ps(start_volume);
+    const __m128 step = _mm_set1_ps(volume_step);
+    // Frame numbers of the samples, two samples per frame
+    __m128 frames_low = _mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f);
+    __m128 frames_high = _mm_setr_ps(2.0f, 2.0f, 3.0f, 3.0f);
+    const __m128 frames_increment = _mm_set1_ps(4.0f);
+
+    size_t frame = 0;
+    for (; frame + 4 <= num_frames; frame += 4) {
+        const __m128i input =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + frame * 2));
+        // Sign-extends the samples to 32 bits
+        const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(input, input), 16);
+        const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(input, input), 16);
+
+        const __m128 volume_low = _mm_add_ps(start, _mm_mul_ps(step, frames_low));
+        const __m128 volume_high = _mm_add_ps(start, _mm_mul_ps(step, frames_high));
+        const __m128i scaled_low = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(low), volume_low));
+        const __m128i scaled_high =
+            _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(high), volume_high));
+
+        __m128i* output = reinterpret_cast<__m128i*>(mix + frame * 2);
+        _mm_storeu_si128(output, _mm_add_epi32(_mm_loadu_si128(output), scaled_low));
+        _mm_storeu_si128(output + 1, _mm_add_epi32(_mm_loadu_si128(output + 1), scaled_high));
+
+        frames_low = _mm_add_ps(frames_low, frames_increment);
+        frames_high = _mm_add_ps(frames_high, frames_increment);
+    }
+
+    MixFramesScalar(mix, samples, frame, num_frames, start_volume, volume_step);
+}
+
+static void ClampSamplesSSE2(s16* output, const s32* mix, size_t num_samples) {
+    size_t i = 0;
+    for (; i + 8 <= num_samples; i += 8) {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mix + i));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mix + i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packs_epi32(low, high));
+    }
+    ClampSamplesScalar(output + i, mix + i, num_samples - i);
+}
+
+/// Sums the four 32-bit lanes of each of two vectors, the sums end up in the two lowest lanes
+static __m128i SumPairSSE2(__m128i a, __m128i b) {
+    const __m128i sums = _mm_add_epi32(_mm_unpacklo_epi32(a, b), _mm_unpackhi_epi32(a, b));
+    return _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+static void FilterSSE2(s16* output, size_t num_frames, u32 num_channels, const s16* const* planes,
+                       const size_t* positions, const u32* phases) {
+    const __m128i rounding = _mm_set1_epi32(COEFFICIENT_ROUNDING);
+    for (size_t frame = 0; frame < num_frames; ++frame) {
+        const __m128i coefficients =
+            _mm_load_si128(reinterpret_cast<const __m128i*>(filter_bank[phases[frame]].data()));
+        const __m128i left = _mm_madd_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + positions[frame])),
+            coefficients);
+        const __m128i right =
+            num_channels == 2
+                ? _mm_madd_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                                     planes[1] + positions[frame])),
+                                 coefficients)
+                : _mm_setzero_si128();
+
+        __m128i sums = _mm_add_epi32(SumPairSSE2(left, right), rounding);
+        sums = _mm_packs_epi32(_mm_srai_epi32(sums, COEFFICIENT_BITS), sums);
+        const u32 samples = static_cast<u32>(_mm_cvtsi128_si32(sums));
+        std::memcpy(output + frame * num_channels, &samples, num_channels * sizeof(s16));
+    }
+}
+
+TARGET_AVX2 static void MixSamplesAVX2(s32* mix, const s16* samples, size_t num_frames,
+                                       float start_volume, float volume_step) {
+    const __m256 start = _mm256_set1_ps(start_volume);
+    const __m256 step = _mm256_set1_ps(volume_step);
+    __m256 frames_low = _mm256_setr_ps(0.0f, 0.0f, 1.0f, 1.0f, 2.0f, 2.0f, 3.0f, 3.0f);
+    __m256 frames_high = _mm256_setr_ps(4.0f, 4.0f, 5.0f, 5.0f, 6.0f, 6.0f, 7.0f, 7.0f);
+    const __m256 frames_increment = _mm256_set1_ps(8.0f);
+
+    size_t frame = 0;
+    for (; frame + 8 <= num_frames; frame += 8) {
+        const __m256i input =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + frame * 2));
+        const __m256i low = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(input));
+        const __m256i high = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(input, 1));
+
+        const __m256 volume_low = _mm256_add_ps(start, _mm256_mul_ps(step, frames_low));
+        const __m256 volume_high = _mm256_add_ps(start, _mm256_mul_ps(step, frames_high));
+        const __m256i scaled_low =
+            _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(low), volume_low));
+        const __m256i scaled_high =
+            _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(high), volume_high));
+
+        __m256i* output = reinterpret_cast<__m256i*>(mix + frame * 2);
+        _mm256_storeu_si256(output, _mm256_add_epi32(_mm256_loadu_si256(output), scaled_low));
+        _mm256_storeu_si256(output + 1,
+                            _mm256_add_epi32(_mm256_loadu_si256(output + 1), scaled_high));
+
+        frames_low = _mm256_add_ps(frames_low, frames_increment);
+        frames_high = _mm256_add_ps(frames_high, frames_increment);
+    }
+
+    MixFramesScalar(mix, samples, frame, num_frames, start_volume, volume_step);
+}
+
+TARGET_AVX2 static void ClampSamplesAVX2(s16* output, const s32* mix, size_t num_samples) {
+    size_t i = 0;
+    for (; i + 16 <= num_samples; i += 16) {
+        const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mix + i));
+        const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mix + i + 8));
+        // Packing works within the 128-bit lanes, the quarters are put back in order
+        const __m256i packed =
+            _mm256_permute4x64_epi64(_mm256_packs_epi32(low, high), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), packed);
+    }
+    ClampSamplesScalar(output + i, mix + i, num_samples - i);
+}
+
+TARGET_AVX2 static __m256i LoadWindowPairAVX2(const s16* first, const s16* second) {
+    const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+    const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(second));
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+}
+
+TARGET_AVX2 static void FilterAVX2(s16* output, size_t num_frames, u32 num_channels,
+                                   const s16* const* planes, const size_t* positions,
+                                   const u32* phases) {
+    // Two output frames at a time, one in each 128-bit lane
+    const __m256i rounding = _mm256_set1_epi32(COEFFICIENT_ROUNDING);
+    const s16* const left_plane = planes[0];
+    const s16* const right_plane = num_channels == 2 ? planes[1] : planes[0];
+
+    size_t frame = 0;
+    for (; frame + 2 <= num_frames; frame += 2) {
+        const __m256i coefficients = LoadWindowPairAVX2(filter_bank[phases[frame]].data(),
+                                                        filter_bank[phases[frame + 1]].data());
+        const __m256i left = _mm256_madd_epi16(
+            LoadWindowPairAVX2(left_plane + positions[frame], left_plane + positions[frame + 1]),
+            coefficients);
+        const __m256i right = _mm256_madd_epi16(
+            LoadWindowPairAVX2(right_plane + positions[frame], right_plane + positions[frame + 1]),
+            coefficients);
+
+        __m256i sums = _mm256_add_epi32(_mm256_unpacklo_epi32(left, right),
+                                        _mm256_unpackhi_epi32(left, right));
+        sums = _mm256_add_epi32(sums, _mm256_shuffle_epi32(sums, _MM_SHUFFLE(1, 0, 3, 2)));
+        sums = _mm256_srai_epi32(_mm256_add_epi32(sums, rounding), COEFFICIENT_BITS);
+        sums = _mm256_packs_epi32(sums, sums);
+
+        // Each lane holds the left and right sample of its frame in its lowest 32 bits
+        const u32 first = static_cast<u32>(_mm256_extract_epi32(sums, 0));
+        const u32 second = static_cast<u32>(_mm256_extract_epi32(sums, 4));
+        if (num_channels == 2) {
+            std::memcpy(output + frame * 2, &first, sizeof(first));
+            std::memcpy(output + frame * 2 + 2, &second, sizeof(second));
+        } else {
+            output[frame] = static_cast<s16>(first);
+            output[frame + 1] = static_cast<s16>(second);
+        }
+    }
+
+    FilterSSE2(output + frame * num_channels, num_frames - frame, num_channels, planes,
+               positions + frame, phases + frame);
+}
+
+#undef TARGET_AVX2
+
+#endif // ARCHITECTURE_x86_64
+
+struct Kernels {
+    MixFunc mix;
+    ClampFunc clamp;
+    FilterFunc filter;
+};
+
+static Kernels SelectKernels(MixerIsa isa) {
+    switch (isa) {
+#ifdef ARCHITECTURE_x86_64
+    case MixerIsa::AVX2:
+        Common::RecordKernelSelection("AudioMixer", "AVX2");
+        return {MixSamplesAVX2, ClampSamplesAVX2, FilterAVX2};
+    case MixerIsa::SSE2:
+        Common::RecordKernelSelection("AudioMixer", "SSE2");
+        return {MixSamplesSSE2, ClampSamplesSSE2, FilterSSE2};
+#endif
+    default:
+        Common::RecordKernelSelection("AudioMixer", "Scalar");
+        return {MixSamplesScalar, ClampSamplesScalar, FilterScalar};
+    }
+}
+
+static MixerIsa GetBestIsa() {
+#ifdef ARCHITECTURE_x86_64
+    if (Common::GetCPUCaps().avx2) {
+        return MixerIsa::AVX2;
+    }
+    // SSE2 is always available on x86_64
+    return MixerIsa::SSE2;
+#else
+    return MixerIsa::Scalar;
+#endif
+}
+
+static Kernels& GetKernels() {
+    static Kernels kernels = SelectKernels(GetBestIsa());
+    return kernels;
+}
+
+bool IsMixerIsaSupported(MixerIsa isa) {
+    switch (isa) {
+    case MixerIsa::Scalar:
+        return true;
+    case MixerIsa::SSE2:
+        return GetBestIsa() != MixerIsa::Scalar;
+    case MixerIsa::AVX2:
+        return GetBestIsa() == MixerIsa::AVX2;
+    }
+    return false;
+}
+
+void SetMixerIsa(MixerIsa isa) {
+    ASSERT(IsMixerIsaSupported(isa));
+    GetKernels() = SelectKernels(isa);
+}
+
+size_t Resample(s16* output, size_t num_output_frames, const s16* input, size_t num_input_frames,
+                u32 num_channels, u32 step, ResamplerState& state, size_t& num_consumed) {
+    ASSERT(num_channels > 0 && num_channels <= MAX_CHANNELS);
+
+    // The input is split in planes, each of them following the history of its channel
+    thread_local std::array<std::vector<s16>, MAX_CHANNELS> planes;
+    thread_local std::vector<size_t> positions;
+    thread_local std::vector<u32> phases;
+    std::array<const s16*, MAX_CHANNELS> plane_pointers{};
+    for (u32 channel = 0; channel < num_channels; ++channel) {
+        std::vector<s16>& plane = planes[channel];
+        plane.resize(RESAMPLER_TAPS + num_input_frames);
+        std::copy(state.history[channel].begin(), state.history[channel].end(), plane.begin());
+        for (size_t frame = 0; frame < num_input_frames; ++frame) {
+            plane[RESAMPLER_TAPS + frame] = input[frame * num_channels + channel];
+        }
+        plane_pointers[channel] = plane.data();
+    }
+
+    // Finds where the output frames are interpolated, the filter does the rest
+    positions.resize(num_output_frames);
+    phases.resize(num_output_frames);
+    size_t position = 0;
+    size_t num_frames = 0;
+    while (num_frames < num_output_frames) {
+        while (state.fraction >= FRACTION_ONE && position < num_input_frames) {
+            ++position;
+            state.fraction -= FRACTION_ONE;
+        }
+        if (state.fraction >= FRACTION_ONE) {
+            break;
+        }
+        positions[num_frames] = position;
+        phases[num_frames] = state.fraction >> PHASE_SHIFT;
+        state.fraction += step;
+        ++num_frames;
+    }
+
+    GetKernels().filter(output, num_frames, num_channels, plane_pointers.data(), positions.data(),
+                        phases.data());
+
+    for (u32 channel = 0; channel < num_channels; ++channel) {
+        std::copy_n(planes[channel].begin() + position, RESAMPLER_TAPS,
+                    state.history[channel].begin());
+    }
+    num_consumed = position;
+    return num_frames;
+}
+
+void MixSamples(s32* mix, const s16* samples, size_t num_frames, float start_volume,
+                float end_volume) {
+    if (num_frames == 0) {
+        return;
+    }
+    const float volume_step = (end_volume - start_volume) / static_cast<float>(num_frames);
+    GetKernels().mix(mix, samples, num_frames, start_volume, volume_step);
+}
+
+void ClampSamples(s16* output, const s32* mix, size_t num_samples) {
+    GetKernels().clamp(output, mix, num_samples);
+}
+
+} // namespace AudioCore
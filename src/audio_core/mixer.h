@@ -0,0 +1,62 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include "common/common_types.h"
+
+namespace AudioCore {
+
+/// Maximum number of interleaved channels the resampler supports
+constexpr u32 MAX_CHANNELS = 2;
+/// Length of the interpolation filter of the resampler, in frames
+constexpr size_t RESAMPLER_TAPS = 8;
+
+/// Position of a resampler between its input frames, kept across calls
+struct ResamplerState {
+    /// Position past the middle of the history, in 1/65536th of a frame
+    u32 fraction = 0;
+    /// Last frames read from the input for each channel, the oldest first. The output is
+    /// interpolated between the two frames in the middle.
+    std::array<std::array<s16, RESAMPLER_TAPS>, MAX_CHANNELS> history{};
+};
+
+/**
+ * Resamples interleaved frames with a polyphase windowed-sinc filter of RESAMPLER_TAPS frames.
+ * @param step Number of input frames per output frame, in 1/65536th of a frame
+ * @param num_consumed Receives the number of input frames that were read
+ * @returns The number of output frames written, less than num_output_frames when the input ran out
+ */
+size_t Resample(s16* output, size_t num_output_frames, const s16* input, size_t num_input_frames,
+                u32 num_channels, u32 step, ResamplerState& state, size_t& num_consumed);
+
+/**
+ * Adds interleaved stereo frames to a mix buffer, with a volume ramping linearly from
+ * start_volume on the first frame towards end_volume, which the frame after the last one gets.
+ */
+void MixSamples(s32* mix, const s16* samples, size_t num_frames, float start_volume,
+                float end_volume);
+
+/// Converts a mix buffer to 16-bit samples, saturating the ones out of range
+void ClampSamples(s16* output, const s32* mix, size_t num_samples);
+
+/// Instruction sets the kernels above are implemented with
+enum class MixerIsa {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+/// Whether the host CPU supports the kernels of an instruction set
+bool IsMixerIsaSupported(MixerIsa isa);
+
+/**
+ * Selects the kernels used by the functions above, the best ones the host supports are used by
+ * default. Only meant to compare the implementations, it must not be called while they run.
+ */
+void SetMixerIsa(MixerIsa isa);
+
+} // namespace AudioCore
@@ -0,0 +1,21 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <thread>
+#include "audio_core/null_sink.h"
+
+namespace AudioCore {
+
+NullSink::NullSink(u32 sample_rate) : sample_rate(sample_rate), end_time(Clock::now()) {}
+
+void NullSink::Write(const s16* samples, size_t num_frames) {
+    // Samples written after the device ran dry start playing right away
+    end_time = std::max(end_time, Clock::now());
+    end_time += std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(static_cast<double>(num_frames) / sample_rate));
+    std::this_thread::sleep_until(end_time);
+}
+
+} // namespace AudioCore
@@ -0,0 +1,27 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <chrono>
+#include "audio_core/sink.h"
+
+namespace AudioCore {
+
+/// Sink discarding the samples, at the rate a device would play them
+class NullSink final : public Sink {
+public:
+    explicit NullSink(u32 sample_rate);
+
+    void Write(const s16* samples, size_t num_frames) override;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    u32 sample_rate;
+    /// Time the previously written samples would have finished playing
+    Clock::time_point end_time;
+};
+
+} // namespace AudioCore
@@ -0,0 +1,56 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <thread>
+#include "audio_core/sdl2_sink.h"
+#include "common/logging/log.h"
+
+namespace AudioCore {
+
+/// Length of the samples kept queued to the device, in milliseconds
+constexpr u32 QUEUE_LENGTH_MS = 50;
+
+SDL2Sink::SDL2Sink(u32 sample_rate, u32 num_channels)
+    : sample_rate(sample_rate), num_channels(num_channels) {
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+        LOG_ERROR(Audio_Sink, "SDL_InitSubSystem failed: %s", SDL_GetError());
+        return;
+    }
+
+    SDL_AudioSpec spec{};
+    spec.freq = static_cast<int>(sample_rate);
+    spec.format = AUDIO_S16SYS;
+    spec.channels = static_cast<Uint8>(num_channels);
+    spec.samples = 512;
+    // Without a callback, the samples are queued with SDL_QueueAudio
+    spec.callback = nullptr;
+
+    device = SDL_OpenAudioDevice(nullptr, 0, &spec, nullptr, 0);
+    if (device == 0) {
+        LOG_ERROR(Audio_Sink, "SDL_OpenAudioDevice failed: %s", SDL_GetError());
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return;
+    }
+    SDL_PauseAudioDevice(device, 0);
+}
+
+SDL2Sink::~SDL2Sink() {
+    if (device == 0) {
+        return;
+    }
+    SDL_CloseAudioDevice(device);
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
+
+void SDL2Sink::Write(const s16* samples, size_t num_frames) {
+    const u32 frame_size = num_channels * sizeof(s16);
+    const u32 max_queued = sample_rate * QUEUE_LENGTH_MS / 1000 * frame_size;
+    while (SDL_GetQueuedAudioSize(device) > max_queued) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    SDL_QueueAudio(device, samples, static_cast<Uint32>(num_frames * frame_size));
+}
+
+} // namespace AudioCore
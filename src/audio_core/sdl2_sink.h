@@ -0,0 +1,31 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <SDL.h>
+#include "audio_core/sink.h"
+
+namespace AudioCore {
+
+/// Sink queueing the samples to an SDL2 audio device
+class SDL2Sink final : public Sink {
+public:
+    SDL2Sink(u32 sample_rate, u32 num_channels);
+    ~SDL2Sink() override;
+
+    /// Whether the device could be opened
+    bool IsOpen() const {
+        return device != 0;
+    }
+
+    void Write(const s16* samples, size_t num_frames) override;
+
+private:
+    SDL_AudioDeviceID device = 0;
+    u32 sample_rate;
+    u32 num_channels;
+};
+
+} // namespace AudioCore
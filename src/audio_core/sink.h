@@ -0,0 +1,24 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include "common/common_types.h"
+
+namespace AudioCore {
+
+/**
+ * Host audio output of a stream. Sinks are only used by the audio thread of their stream, and
+ * pace it: writes block until the device can take more samples.
+ */
+class Sink {
+public:
+    virtual ~Sink() = default;
+
+    /// Plays a number of frames of interleaved 16-bit samples
+    virtual void Write(const s16* samples, size_t num_frames) = 0;
+};
+
+} // namespace AudioCore
@@ -0,0 +1,39 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "audio_core/null_sink.h"
+#include "audio_core/sink_details.h"
+#ifdef HAVE_SDL2
+#include "audio_core/sdl2_sink.h"
+#endif
+#include "common/logging/log.h"
+
+namespace AudioCore {
+
+std::vector<std::string> GetSinkIds() {
+    std::vector<std::string> ids;
+#ifdef HAVE_SDL2
+    ids.emplace_back("sdl2");
+#endif
+    ids.emplace_back("null");
+    return ids;
+}
+
+std::unique_ptr<Sink> CreateSink(const std::string& sink_id, u32 sample_rate, u32 num_channels) {
+#ifdef HAVE_SDL2
+    if (sink_id == "auto" || sink_id == "sdl2") {
+        auto sink = std::make_unique<SDL2Sink>(sample_rate, num_channels);
+        if (sink->IsOpen()) {
+            return std::move(sink);
+        }
+    }
+#endif
+
+    if (sink_id != "auto" && sink_id != "null") {
+        LOG_ERROR(Audio_Sink, "Sink %s is unavailable, audio is muted", sink_id.c_str());
+    }
+    return std::make_unique<NullSink>(sample_rate);
+}
+
+} // namespace AudioCore
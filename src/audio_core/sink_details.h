@@ -0,0 +1,25 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/common_types.h"
+
+namespace AudioCore {
+
+class Sink;
+
+/// Identifiers of the available sinks, the preferred ones first
+std::vector<std::string> GetSinkIds();
+
+/**
+ * Creates the sink with the given identifier, "auto" picking the first one that works. Falls back
+ * to the null sink when the requested one can't be created.
+ */
+std::unique_ptr<Sink> CreateSink(const std::string& sink_id, u32 sample_rate, u32 num_channels);
+
+} // namespace AudioCore
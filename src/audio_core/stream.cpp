@@ -0,0 +1,113 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "audio_core/sink.h"
+#include "audio_core/sink_details.h"
+#include "audio_core/stream.h"
+#include "audio_core/time_stretch.h"
+
+namespace AudioCore {
+
+/// Longest the audio thread sleeps without buffers before checking for shutdown
+constexpr auto IDLE_TIMEOUT = std::chrono::milliseconds(10);
+
+/// Range of the stretched tempo, the emulation is assumed to be stalled below the minimum
+constexpr double MIN_TEMPO = 0.25;
+constexpr double MAX_TEMPO = 2.0;
+/// Fraction of the distance to the emulation speed the tempo moves by with every buffer, as the
+/// speed of single frames is noisy
+constexpr double TEMPO_SMOOTHING = 0.1;
+/// Tempos this close to 1 are played at exactly 1, to not drift around a full speed emulation
+constexpr double TEMPO_DEADBAND = 0.03;
+
+Stream::Stream(u32 sample_rate, u32 num_channels, const std::string& sink_id,
+               bool enable_stretching, ReleaseCallback release_callback)
+    : sample_rate(sample_rate), num_channels(num_channels),
+      sink(CreateSink(sink_id, sample_rate, num_channels)),
+      release_callback(std::move(release_callback)) {
+    if (enable_stretching) {
+        stretcher = std::make_unique<TimeStretcher>(sample_rate, num_channels);
+    }
+    audio_thread = std::thread(&Stream::AudioThreadMain, this);
+}
+
+Stream::~Stream() {
+    is_shutting_down = true;
+    buffer_queued.Set();
+    audio_thread.join();
+}
+
+void Stream::Play() {
+    is_playing = true;
+    buffer_queued.Set();
+}
+
+void Stream::Stop() {
+    is_playing = false;
+}
+
+void Stream::QueueBuffer(Buffer buffer) {
+    pending_tags.push_back(buffer.tag);
+    queued_buffers.Push(std::move(buffer));
+    buffer_queued.Set();
+}
+
+std::vector<u64> Stream::PopReleasedBuffers(size_t max_count) {
+    std::vector<u64> tags;
+    u64 tag;
+    while (tags.size() < max_count && released_buffers.Pop(tag)) {
+        tags.push_back(tag);
+        pending_tags.erase(std::find(pending_tags.begin(), pending_tags.end(), tag));
+    }
+    return tags;
+}
+
+bool Stream::ContainsBuffer(u64 tag) const {
+    return std::find(pending_tags.begin(), pending_tags.end(), tag) != pending_tags.end();
+}
+
+void Stream::SetTimeScale(double time_scale) {
+    // Before the first frame was measured, the scale is unknown
+    if (time_scale > 0.0) {
+        this->time_scale = time_scale;
+    }
+}
+
+double Stream::UpdateTempo() {
+    const double speed = std::clamp(1.0 / time_scale, MIN_TEMPO, MAX_TEMPO);
+    tempo += (speed - tempo) * TEMPO_SMOOTHING;
+    return std::abs(tempo - 1.0) < TEMPO_DEADBAND ? 1.0 : tempo;
+}
+
+void Stream::AudioThreadMain() {
+    Common::SetCurrentThreadName("Audio");
+    Common::PinCurrentHostThread(Common::HostThread::Audio);
+
+    Buffer buffer;
+    std::vector<s16> stretched;
+    while (!is_shutting_down) {
+        if (!is_playing || !queued_buffers.Pop(buffer)) {
+            buffer_queued.WaitUntil(std::chrono::steady_clock::now() + IDLE_TIMEOUT);
+            continue;
+        }
+
+        const size_t num_frames = buffer.samples.size() / num_channels;
+        if (stretcher) {
+            stretched.clear();
+            stretcher->Process(buffer.samples.data(), num_frames, UpdateTempo(), stretched);
+            if (!stretched.empty()) {
+                sink->Write(stretched.data(), stretched.size() / num_channels);
+            }
+        } else {
+            sink->Write(buffer.samples.data(), num_frames);
+        }
+        released_buffers.Push(buffer.tag);
+        release_callback();
+    }
+}
+
+} // namespace AudioCore
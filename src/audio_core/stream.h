@@ -0,0 +1,109 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "audio_core/buffer.h"
+#include "common/common_types.h"
+#include "common/thread.h"
+#include "common/threadsafe_queue.h"
+
+namespace AudioCore {
+
+class Sink;
+class TimeStretcher;
+
+/**
+ * Output stream of the emulated audio. The buffers queued by the emulation are played by an audio
+ * thread of the stream, they are passed to it and back through lock-free queues so that the
+ * emulation never waits on the host device.
+ *
+ * Everything but the release callback is called from a single emulation thread.
+ */
+class Stream {
+public:
+    /// Called on the audio thread whenever a buffer was played
+    using ReleaseCallback = std::function<void()>;
+
+    /**
+     * @param enable_stretching Whether the audio is stretched to the speed of the emulation, so that
+     *                          it plays without gaps when the emulation runs slower than the host
+     */
+    Stream(u32 sample_rate, u32 num_channels, const std::string& sink_id, bool enable_stretching,
+           ReleaseCallback release_callback);
+    ~Stream();
+
+    void Play();
+    void Stop();
+
+    bool IsPlaying() const {
+        return is_playing;
+    }
+
+    u32 GetSampleRate() const {
+        return sample_rate;
+    }
+
+    u32 GetNumChannels() const {
+        return num_channels;
+    }
+
+    /// Queues a buffer of interleaved samples to be played
+    void QueueBuffer(Buffer buffer);
+
+    /// Returns the tags of up to max_count buffers that were played, the oldest first
+    std::vector<u64> PopReleasedBuffers(size_t max_count);
+
+    /// Number of buffers queued that weren't played yet
+    size_t GetQueuedBufferCount() const {
+        return queued_buffers.Size();
+    }
+
+    /// Whether a buffer was queued and wasn't released yet
+    bool ContainsBuffer(u64 tag) const;
+
+    /**
+     * Sets the ratio between walltime and emulated time the buffers are queued at, see
+     * PerfStats::GetLastFrameTimeScale. The audio is stretched to play at the same speed.
+     */
+    void SetTimeScale(double time_scale);
+
+private:
+    void AudioThreadMain();
+
+    /// Gets the tempo the next buffer is stretched to, following the time scale smoothly
+    double UpdateTempo();
+
+    u32 sample_rate;
+    u32 num_channels;
+    std::unique_ptr<Sink> sink;
+    /// Only used by the audio thread, null when stretching is disabled
+    std::unique_ptr<TimeStretcher> stretcher;
+    ReleaseCallback release_callback;
+
+    /// Buffers passed from the emulation to the audio thread
+    Common::SPSCQueue<Buffer> queued_buffers;
+    /// Tags of the played buffers, passed back to the emulation
+    Common::SPSCQueue<u64> released_buffers;
+    /// Tags of the buffers between QueueBuffer and PopReleasedBuffers, only used by the emulation
+    std::vector<u64> pending_tags;
+
+    /// Latest time scale of the emulation, and the tempo the audio thread is moving towards it
+    std::atomic<double> time_scale{1.0};
+    double tempo = 1.0;
+
+    std::atomic<bool> is_playing{false};
+    std::atomic<bool> is_shutting_down{false};
+    /// Wakes the audio thread up when it ran out of buffers
+    Common::Event buffer_queued;
+    std::thread audio_thread;
+};
+
+} // namespace AudioCore
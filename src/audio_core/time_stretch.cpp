@@ -0,0 +1,108 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cmath>
+#include "audio_core/time_stretch.h"
+#include "common/assert.h"
+
+namespace AudioCore {
+
+/// Lengths of a sequence, of the window searched for its start, and of its cross-fade
+constexpr u32 SEQUENCE_MS = 40;
+constexpr u32 SEEK_MS = 15;
+constexpr u32 OVERLAP_MS = 8;
+
+TimeStretcher::TimeStretcher(u32 sample_rate, u32 num_channels)
+    : num_channels(num_channels), sequence_frames(sample_rate * SEQUENCE_MS / 1000),
+      seek_frames(sample_rate * SEEK_MS / 1000), overlap_frames(sample_rate * OVERLAP_MS / 1000),
+      overlap(overlap_frames * num_channels) {
+    ASSERT(num_channels > 0);
+    ASSERT(overlap_frames > 0 && sequence_frames >= 2 * overlap_frames);
+}
+
+void TimeStretcher::Process(const s16* samples, size_t num_frames, double tempo,
+                            std::vector<s16>& output) {
+    ASSERT(tempo > 0.0);
+    input.insert(input.end(), samples, samples + num_frames * num_channels);
+
+    // Every sequence outputs sequence_frames - overlap_frames frames, and the next one starts
+    // that many frames times the tempo later in the input
+    const double nominal_skip = tempo * static_cast<double>(sequence_frames - overlap_frames);
+    const size_t max_skip = static_cast<size_t>(nominal_skip) + 1;
+    const size_t required = std::max(max_skip + overlap_frames, sequence_frames) + seek_frames;
+    const size_t num_input_frames = input.size() / num_channels;
+    const size_t middle_samples = (sequence_frames - 2 * overlap_frames) * num_channels;
+
+    size_t start = 0;
+    while (num_input_frames - start >= required) {
+        const s16* window = &input[start * num_channels];
+        const s16* sequence = window + FindBestOffset(window) * num_channels;
+
+        for (size_t frame = 0; frame < overlap_frames; ++frame) {
+            const s32 fade_in = static_cast<s32>(frame);
+            const s32 fade_out = static_cast<s32>(overlap_frames - frame);
+            for (u32 channel = 0; channel < num_channels; ++channel) {
+                const size_t i = frame * num_channels + channel;
+                output.push_back(static_cast<s16>((overlap[i] * fade_out + sequence[i] * fade_in) /
+                                                  static_cast<s32>(overlap_frames)));
+            }
+        }
+
+        const s16* middle = sequence + overlap_frames * num_channels;
+        output.insert(output.end(), middle, middle + middle_samples);
+        std::copy_n(middle + middle_samples, overlap.size(), overlap.begin());
+
+        skip_fraction += nominal_skip;
+        const size_t skip = static_cast<size_t>(skip_fraction);
+        skip_fraction -= static_cast<double>(skip);
+        start += skip;
+    }
+
+    input.erase(input.begin(), input.begin() + start * num_channels);
+}
+
+size_t TimeStretcher::FindBestOffset(const s16* window) {
+    // Channels are summed, the waveforms are compared with their normalized cross-correlation
+    reference.assign(overlap_frames, 0);
+    candidate.assign(overlap_frames + seek_frames, 0);
+    for (size_t frame = 0; frame < reference.size(); ++frame) {
+        for (u32 channel = 0; channel < num_channels; ++channel) {
+            reference[frame] += overlap[frame * num_channels + channel];
+        }
+    }
+    for (size_t frame = 0; frame < candidate.size(); ++frame) {
+        for (u32 channel = 0; channel < num_channels; ++channel) {
+            candidate[frame] += window[frame * num_channels + channel];
+        }
+    }
+
+    // Energy of the candidate, slid along with the offset
+    double energy = 0.0;
+    for (size_t frame = 0; frame < overlap_frames; ++frame) {
+        energy += static_cast<double>(candidate[frame]) * candidate[frame];
+    }
+
+    size_t best_offset = 0;
+    double best_score = -1.0e300;
+    for (size_t offset = 0; offset < seek_frames; ++offset) {
+        s64 correlation = 0;
+        for (size_t frame = 0; frame < overlap_frames; ++frame) {
+            correlation += static_cast<s64>(reference[frame]) * candidate[offset + frame];
+        }
+        const double score = static_cast<double>(correlation) / std::sqrt(energy + 1.0);
+        if (score > best_score) {
+            best_score = score;
+            best_offset = offset;
+        }
+
+        const s32 leaving = candidate[offset];
+        const s32 entering = candidate[offset + overlap_frames];
+        energy += static_cast<double>(entering) * entering - static_cast<double>(leaving) * leaving;
+        energy = std::max(energy, 0.0);
+    }
+    return best_offset;
+}
+
+} // namespace AudioCore
@@ -0,0 +1,56 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "common/common_types.h"
+
+namespace AudioCore {
+
+/**
+ * Changes the tempo of interleaved 16-bit audio without changing its pitch, with WSOLA (waveform
+ * similarity overlap-add). The input is cut in sequences that are spaced by the tempo, and each
+ * one is cross-faded into the previous one where their waveforms match best.
+ */
+class TimeStretcher {
+public:
+    TimeStretcher(u32 sample_rate, u32 num_channels);
+
+    /**
+     * Stretches frames to a tempo, the input is kept until there is enough of it for a sequence.
+     * @param tempo Speed the input is played at, 0.5 plays it over twice as many frames
+     * @param output Receives the stretched frames, appended to its samples
+     */
+    void Process(const s16* samples, size_t num_frames, double tempo, std::vector<s16>& output);
+
+    /// Number of input frames kept for the next sequences
+    size_t GetBufferedFrameCount() const {
+        return input.size() / num_channels;
+    }
+
+private:
+    /// Finds the offset, within the seek window, where a sequence starting at window matches the
+    /// end of the previous one best
+    size_t FindBestOffset(const s16* window);
+
+    u32 num_channels;
+    /// Length of the sequences, of the window searched for their start, and of their cross-fade
+    size_t sequence_frames;
+    size_t seek_frames;
+    size_t overlap_frames;
+
+    /// Input frames not consumed yet
+    std::vector<s16> input;
+    /// End of the previous sequence, cross-faded into the start of the next one
+    std::vector<s16> overlap;
+    /// Fraction of a frame the sequences are behind the tempo
+    double skip_fraction = 0.0;
+    /// Channels of the end of the previous sequence and of the seek window, summed
+    std::vector<s32> reference;
+    std::vector<s32> candidate;
+};
+
+} // namespace AudioCore
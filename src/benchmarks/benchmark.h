@@ -0,0 +1,106 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <chrono>
+#include "common/common_types.h"
+
+namespace Log {
+class Filter;
+}
+
+namespace Benchmark {
+
+/**
+ * State of a run of a benchmark. The body of the benchmark loops while KeepRunning returns true,
+ * and only the loop is timed, so that the setup before it isn't measured.
+ */
+class State {
+public:
+    explicit State(u64 iterations) : iterations(iterations), remaining(iterations) {}
+
+    bool KeepRunning() {
+        if (remaining == iterations) {
+            start = std::chrono::steady_clock::now();
+        }
+        if (remaining != 0) {
+            --remaining;
+            return true;
+        }
+        end = std::chrono::steady_clock::now();
+        return false;
+    }
+
+    u64 GetIterations() const {
+        return iterations;
+    }
+
+    /// Sets the number of items an iteration processes, reported as items per second
+    void SetItemsPerIteration(u64 items) {
+        items_per_iteration = items;
+    }
+
+    /// Sets the number of bytes an iteration processes, reported as bytes per second
+    void SetBytesPerIteration(u64 bytes) {
+        bytes_per_iteration = bytes;
+    }
+
+    u64 GetItemsPerIteration() const {
+        return items_per_iteration;
+    }
+
+    u64 GetBytesPerIteration() const {
+        return bytes_per_iteration;
+    }
+
+    std::chrono::steady_clock::duration GetElapsed() const {
+        return end - start;
+    }
+
+private:
+    u64 iterations;
+    u64 remaining;
+    u64 items_per_iteration = 0;
+    u64 bytes_per_iteration = 0;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+};
+
+using Function = void (*)(State& state);
+
+/// Adds a benchmark to the ones the benchmarks executable runs, see BENCHMARK
+class Registration {
+public:
+    Registration(const char* name, Function function);
+};
+
+/// Filter of the log messages while the benchmarks run, it only lets warnings and errors through
+Log::Filter& GetLogFilter();
+
+/// Keeps the compiler from optimizing away the computation of a value that is never used
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+#ifdef _MSC_VER
+    static_cast<void>(*reinterpret_cast<const volatile char*>(&value));
+#else
+    asm volatile("" : : "g"(&value) : "memory");
+#endif
+}
+
+} // namespace Benchmark
+
+/**
+ * Defines a benchmark, followed by its body:
+ *
+ *     BENCHMARK(Memory_Read32) {
+ *         while (state.KeepRunning()) {
+ *             ...
+ *         }
+ *     }
+ */
+#define BENCHMARK(name)                                                                            \
+    static void name(::Benchmark::State& state);                                                   \
+    static const ::Benchmark::Registration name##_registration(#name, name);                       \
+    static void name(::Benchmark::State& state)
@@ -0,0 +1,295 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <getopt.h>
+#include "benchmarks/benchmark.h"
+#include "common/logging/backend.h"
+#include "common/logging/filter.h"
+#include "common/scm_rev.h"
+#ifdef ARCHITECTURE_x86_64
+#include "common/x64/cpu_detect.h"
+#endif
+
+/**
+ * Runs microbenchmarks of the primitives the emulator spends its time in. Each benchmark is run
+ * with a number of iterations calibrated to take at least the minimum time, and then repeated;
+ * the median of the repetitions is reported along with their spread. The CSV and JSON outputs are
+ * meant to be kept and compared between builds.
+ */
+
+namespace Benchmark {
+
+namespace {
+
+struct Entry {
+    const char* name;
+    Function function;
+};
+
+std::vector<Entry>& GetRegistry() {
+    static std::vector<Entry> registry;
+    return registry;
+}
+
+struct Result {
+    std::string name;
+    u64 iterations;
+    double median_ns;
+    double min_ns;
+    double max_ns;
+    double items_per_second;
+    double bytes_per_second;
+};
+
+struct Options {
+    std::string filter;
+    std::string format = "text";
+    unsigned long repetitions = 5;
+    std::chrono::nanoseconds min_time = std::chrono::milliseconds(100);
+};
+
+/// Largest number of iterations of a run
+constexpr u64 MAX_ITERATIONS = 1000000000;
+
+double RunOnce(Function function, u64 iterations, State& state) {
+    state = State(iterations);
+    function(state);
+    return static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(state.GetElapsed()).count());
+}
+
+Result Run(const Entry& entry, const Options& options) {
+    const double min_time_ns = static_cast<double>(options.min_time.count());
+
+    // Grow the number of iterations until a run takes long enough to be timed reliably
+    State state(1);
+    u64 iterations = 1;
+    double elapsed_ns = RunOnce(entry.function, iterations, state);
+    while (elapsed_ns < min_time_ns && iterations < MAX_ITERATIONS) {
+        const double factor = elapsed_ns > 0 ? min_time_ns * 1.2 / elapsed_ns : 100.0;
+        iterations = std::min<u64>(
+            MAX_ITERATIONS, static_cast<u64>(iterations * std::clamp(factor, 2.0, 100.0)));
+        elapsed_ns = RunOnce(entry.function, iterations, state);
+    }
+
+    std::vector<double> ns_per_iteration;
+    for (unsigned long i = 0; i < options.repetitions; ++i) {
+        ns_per_iteration.push_back(RunOnce(entry.function, iterations, state) / iterations);
+    }
+    std::sort(ns_per_iteration.begin(), ns_per_iteration.end());
+
+    Result result;
+    result.name = entry.name;
+    result.iterations = iterations;
+    result.median_ns = ns_per_iteration[ns_per_iteration.size() / 2];
+    result.min_ns = ns_per_iteration.front();
+    result.max_ns = ns_per_iteration.back();
+    result.items_per_second = state.GetItemsPerIteration() * 1e9 / result.median_ns;
+    result.bytes_per_second = state.GetBytesPerIteration() * 1e9 / result.median_ns;
+    return result;
+}
+
+std::string EscapeJson(const std::string& str) {
+    std::string escaped;
+    for (const char c : str) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        if (static_cast<unsigned char>(c) >= 0x20) {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string GetCpuName() {
+#ifdef ARCHITECTURE_x86_64
+    return Common::GetCPUCaps().brand_string;
+#else
+    return "unknown";
+#endif
+}
+
+void PrintHeader(const Options& options) {
+    if (options.format == "csv") {
+        std::printf("name,iterations,median_ns,min_ns,max_ns,items_per_second,bytes_per_second\n");
+    } else if (options.format == "json") {
+        char date[32];
+        const std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+        std::printf("{\n  \"context\": {\n");
+        std::printf("    \"date\": \"%s\",\n", date);
+        std::printf("    \"revision\": \"%s\",\n", EscapeJson(Common::g_scm_rev).c_str());
+        std::printf("    \"branch\": \"%s\",\n", EscapeJson(Common::g_scm_branch).c_str());
+        std::printf("    \"description\": \"%s\",\n", EscapeJson(Common::g_scm_desc).c_str());
+        std::printf("    \"cpu\": \"%s\",\n", EscapeJson(GetCpuName()).c_str());
+        std::printf("    \"host_threads\": %u,\n", std::thread::hardware_concurrency());
+        std::printf("    \"repetitions\": %lu\n", options.repetitions);
+        std::printf("  },\n  \"benchmarks\": [");
+    } else {
+        std::printf("%-40s %12s %14s %14s %14s %14s %14s\n", "Benchmark", "Iterations",
+                    "Median ns", "Min ns", "Max ns", "Items/s", "Bytes/s");
+    }
+}
+
+void PrintResult(const Options& options, const Result& result, bool is_first) {
+    if (options.format == "csv") {
+        std::printf("%s,%llu,%.3f,%.3f,%.3f,%.0f,%.0f\n", result.name.c_str(),
+                    static_cast<unsigned long long>(result.iterations), result.median_ns,
+                    result.min_ns, result.max_ns, result.items_per_second,
+                    result.bytes_per_second);
+    } else if (options.format == "json") {
+        std::printf("%s\n    {\"name\": \"%s\", \"iterations\": %llu, \"median_ns\": %.3f, "
+                    "\"min_ns\": %.3f, \"max_ns\": %.3f, \"items_per_second\": %.0f, "
+                    "\"bytes_per_second\": %.0f}",
+                    is_first ? "" : ",", EscapeJson(result.name).c_str(),
+                    static_cast<unsigned long long>(result.iterations), result.median_ns,
+                    result.min_ns, result.max_ns, result.items_per_second,
+                    result.bytes_per_second);
+    } else {
+        std::printf("%-40s %12llu %14.2f %14.2f %14.2f %14.0f %14.0f\n", result.name.c_str(),
+                    static_cast<unsigned long long>(result.iterations), result.median_ns,
+                    result.min_ns, result.max_ns, result.items_per_second,
+                    result.bytes_per_second);
+    }
+    std::fflush(stdout);
+}
+
+void PrintFooter(const Options& options) {
+    if (options.format == "json") {
+        std::printf("\n  ]\n}\n");
+    }
+}
+
+} // Anonymous namespace
+
+Registration::Registration(const char* name, Function function) {
+    GetRegistry().push_back({name, function});
+}
+
+Log::Filter& GetLogFilter() {
+    static Log::Filter filter(Log::Level::Warning);
+    return filter;
+}
+
+} // namespace Benchmark
+
+static void PrintHelp(const char* argv0) {
+    std::cout << "Usage: " << argv0
+              << " [options]\n"
+                 "-f, --filter=TEXT         Only run the benchmarks whose name contains TEXT\n"
+                 "-o, --format=FORMAT       Output format: text (default), csv or json\n"
+                 "-r, --repetitions=NUMBER  Repeat each benchmark NUMBER times (default 5)\n"
+                 "-t, --min-time=MS         Make each repetition take at least MS milliseconds "
+                 "(default 100)\n"
+                 "-l, --list                List the benchmarks and exit\n"
+                 "-h, --help                Display this help and exit\n";
+}
+
+static bool ParseNumber(const char* name, unsigned long& value) {
+    char* endarg;
+    errno = 0;
+    value = strtoul(optarg, &endarg, 0);
+    if (endarg == optarg || *endarg != '\0')
+        errno = EINVAL;
+    if (errno != 0) {
+        perror(name);
+        return false;
+    }
+    return true;
+}
+
+/// Application entry point
+int main(int argc, char** argv) {
+    int option_index = 0;
+    Benchmark::Options options;
+    bool list_only = false;
+
+    static struct option long_options[] = {
+        {"filter", required_argument, 0, 'f'},
+        {"format", required_argument, 0, 'o'},
+        {"repetitions", required_argument, 0, 'r'},
+        {"min-time", required_argument, 0, 't'},
+        {"list", no_argument, 0, 'l'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0},
+    };
+
+    while (true) {
+        const int arg = getopt_long(argc, argv, "f:o:r:t:lh", long_options, &option_index);
+        if (arg == -1) {
+            break;
+        }
+        unsigned long value;
+        switch (arg) {
+        case 'f':
+            options.filter = optarg;
+            break;
+        case 'o':
+            options.format = optarg;
+            if (options.format != "text" && options.format != "csv" && options.format != "json") {
+                PrintHelp(argv[0]);
+                return 1;
+            }
+            break;
+        case 'r':
+            if (!ParseNumber("--repetitions", value))
+                return 1;
+            options.repetitions = std::max(value, 1UL);
+            break;
+        case 't':
+            if (!ParseNumber("--min-time", value))
+                return 1;
+            options.min_time = std::chrono::milliseconds(value);
+            break;
+        case 'l':
+            list_only = true;
+            break;
+        case 'h':
+            PrintHelp(argv[0]);
+            return 0;
+        default:
+            PrintHelp(argv[0]);
+            return 1;
+        }
+    }
+
+    Log::SetFilter(&Benchmark::GetLogFilter());
+
+    std::vector<Benchmark::Entry> entries = Benchmark::GetRegistry();
+    std::sort(entries.begin(), entries.end(),
+              [](const auto& a, const auto& b) { return std::string(a.name) < b.name; });
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [&](const auto& entry) {
+                                     return std::string(entry.name).find(options.filter) ==
+                                            std::string::npos;
+                                 }),
+                  entries.end());
+
+    if (list_only) {
+        for (const auto& entry : entries) {
+            std::printf("%s\n", entry.name);
+        }
+        return 0;
+    }
+
+    Benchmark::PrintHeader(options);
+    bool is_first = true;
+    for (const auto& entry : entries) {
+        Benchmark::PrintResult(options, Benchmark::Run(entry, options), is_first);
+        is_first = false;
+    }
+    Benchmark::PrintFooter(options);
+    return 0;
+}
@@ -0,0 +1,35 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "benchmarks/benchmark.h"
+#include "common/logging/backend.h"
+#include "common/logging/filter.h"
+#include "common/logging/log.h"
+
+/// Messages each iteration of the throughput benchmark logs before waiting for them to be written
+constexpr int MESSAGES_PER_BATCH = 256;
+
+BENCHMARK(Logging_Filtered) {
+    // The message is below the level of the filter
+    while (state.KeepRunning()) {
+        LOG_DEBUG(Common, "Filtered message %d %s", 42, "argument");
+    }
+}
+
+BENCHMARK(Logging_Throughput) {
+    // Messages are formatted and discarded by the writer thread, without the cost of any sink
+    Log::SetConsoleSink(false);
+    Benchmark::GetLogFilter().SetClassLevel(Log::Class::Common, Log::Level::Info);
+
+    state.SetItemsPerIteration(MESSAGES_PER_BATCH);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < MESSAGES_PER_BATCH; ++i) {
+            LOG_INFO(Common, "Benchmark message %d with a string argument %s", i, "argument");
+        }
+        Log::Flush();
+    }
+
+    Benchmark::GetLogFilter().SetClassLevel(Log::Class::Common, Log::Level::Warning);
+    Log::SetConsoleSink(true);
+}
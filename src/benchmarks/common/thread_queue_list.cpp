@@ -0,0 +1,48 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include "benchmarks/benchmark.h"
+#include "common/thread_queue_list.h"
+
+namespace {
+struct BenchmarkThread {
+    Common::ThreadQueueNode<BenchmarkThread> node;
+};
+
+using BenchmarkQueue = Common::ThreadQueueList<BenchmarkThread, 64, &BenchmarkThread::node>;
+
+/// Number of threads in the queue, about as many as a game keeps ready
+constexpr size_t NUM_THREADS = 32;
+} // Anonymous namespace
+
+BENCHMARK(ThreadQueueList_PushPop) {
+    BenchmarkQueue queue;
+    std::array<BenchmarkThread, NUM_THREADS> threads;
+
+    state.SetItemsPerIteration(NUM_THREADS);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < NUM_THREADS; ++i) {
+            queue.push_back(static_cast<BenchmarkQueue::Priority>((i * 7) % 64), &threads[i]);
+        }
+        while (BenchmarkThread* thread = queue.pop_first()) {
+            Benchmark::DoNotOptimize(thread);
+        }
+    }
+}
+
+BENCHMARK(ThreadQueueList_Rotate) {
+    // Yielding threads rotate the queue of their priority
+    BenchmarkQueue queue;
+    std::array<BenchmarkThread, NUM_THREADS> threads;
+    for (size_t i = 0; i < NUM_THREADS; ++i) {
+        queue.push_back(static_cast<BenchmarkQueue::Priority>(i % 4 + 44), &threads[i]);
+    }
+
+    while (state.KeepRunning()) {
+        queue.rotate(44);
+        Benchmark::DoNotOptimize(queue.get_first());
+    }
+    queue.clear();
+}
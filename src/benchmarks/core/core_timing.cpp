@@ -0,0 +1,31 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "benchmarks/benchmark.h"
+#include "core/core_timing.h"
+
+/// Events scheduled by an iteration, spread over a few time slices
+constexpr u64 EVENTS_PER_ITERATION = 16;
+
+BENCHMARK(CoreTiming_ScheduleAndAdvance) {
+    CoreTiming::Init();
+    u64 callbacks = 0;
+    CoreTiming::EventType* event =
+        CoreTiming::RegisterEvent("Benchmark", [&callbacks](u64, int) { ++callbacks; });
+
+    state.SetItemsPerIteration(EVENTS_PER_ITERATION);
+    while (state.KeepRunning()) {
+        for (u64 i = 0; i < EVENTS_PER_ITERATION; ++i) {
+            CoreTiming::ScheduleEvent(static_cast<s64>(1000 + (i * 7919) % 50000), event, i);
+        }
+        // Pretend the CPU ran its slices until every event fired
+        const u64 target = callbacks + EVENTS_PER_ITERATION;
+        while (callbacks < target) {
+            CoreTiming::AddTicks(CoreTiming::GetDowncount());
+            CoreTiming::Advance();
+        }
+    }
+
+    CoreTiming::Shutdown();
+}
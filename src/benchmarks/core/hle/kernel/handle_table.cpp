@@ -0,0 +1,43 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <vector>
+#include "benchmarks/benchmark.h"
+#include "core/hle/kernel/event.h"
+#include "core/hle/kernel/handle_table.h"
+
+/// Handles created by an iteration, games keep a few hundred of them open
+constexpr size_t HANDLES_PER_ITERATION = 256;
+
+BENCHMARK(HandleTable_CreateClose) {
+    Kernel::HandleTable table;
+    const auto event = Kernel::Event::Create(Kernel::ResetType::OneShot, "Benchmark");
+    std::vector<Kernel::Handle> handles(HANDLES_PER_ITERATION);
+
+    state.SetItemsPerIteration(HANDLES_PER_ITERATION);
+    while (state.KeepRunning()) {
+        for (auto& handle : handles) {
+            handle = table.Create(event).Unwrap();
+        }
+        for (const auto handle : handles) {
+            table.Close(handle);
+        }
+    }
+}
+
+BENCHMARK(HandleTable_Get) {
+    Kernel::HandleTable table;
+    std::vector<Kernel::Handle> handles;
+    for (size_t i = 0; i < HANDLES_PER_ITERATION; ++i) {
+        handles.push_back(
+            table.Create(Kernel::Event::Create(Kernel::ResetType::OneShot, "Benchmark")).Unwrap());
+    }
+
+    state.SetItemsPerIteration(HANDLES_PER_ITERATION);
+    while (state.KeepRunning()) {
+        for (const auto handle : handles) {
+            Benchmark::DoNotOptimize(table.Get<Kernel::Event>(handle));
+        }
+    }
+}
@@ -0,0 +1,54 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <tuple>
+#include "benchmarks/benchmark.h"
+#include "common/common_funcs.h"
+#include "core/hle/ipc.h"
+#include "core/hle/kernel/client_port.h"
+#include "core/hle/kernel/client_session.h"
+#include "core/hle/kernel/handle_table.h"
+#include "core/hle/kernel/hle_ipc.h"
+#include "core/hle/kernel/process.h"
+#include "core/hle/kernel/server_session.h"
+
+/**
+ * Builds a request with an X and an A buffer descriptor and two words of arguments, the shape of
+ * most of the requests of the file system and graphics services.
+ */
+static std::array<u32, IPC::COMMAND_BUFFER_LENGTH> MakeRequest() {
+    std::array<u32, IPC::COMMAND_BUFFER_LENGTH> request{};
+    IPC::CommandHeader header{};
+    header.type.Assign(IPC::CommandType::Request);
+    header.num_buf_x_descriptors.Assign(1);
+    header.num_buf_a_descriptors.Assign(1);
+    // Payload header, command, arguments and the padding of the payload
+    header.data_size.Assign(2 + 2 + 2 + 4);
+    request[0] = header.raw_low;
+    request[1] = header.raw_high;
+    // The descriptors, then padding up to the 16 bytes aligned payload
+    request[8] = Common::MakeMagic('S', 'F', 'C', 'I');
+    request[10] = 3; // Command ID
+    request[12] = 0x1234;
+    request[13] = 0x5678;
+    return request;
+}
+
+BENCHMARK(HLERequestContext_Parse) {
+    auto process = Kernel::Process::Create("benchmark");
+    Kernel::HandleTable table;
+    auto session = std::get<Kernel::SharedPtr<Kernel::ServerSession>>(
+        Kernel::ServerSession::CreateSessionPair("Benchmark"));
+    Kernel::HLERequestContext context(session.get());
+    const auto request = MakeRequest();
+
+    while (state.KeepRunning()) {
+        auto command_buffer = request;
+        context.Reset(session.get());
+        context.PopulateFromIncomingCommandBuffer(command_buffer.data(), *process, table);
+        Benchmark::DoNotOptimize(context.GetCommand());
+        context.Clear();
+    }
+}
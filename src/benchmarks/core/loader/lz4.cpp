@@ -0,0 +1,45 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <vector>
+#include <lz4.h>
+#include "benchmarks/benchmark.h"
+#include "common/assert.h"
+
+/// Size of the segment, about the size of the .text of a small game
+constexpr int SEGMENT_SIZE = 8 * 1024 * 1024;
+
+/// Makes data that compresses about as well as code, with repeated instruction-like words
+static std::vector<char> MakeSegment() {
+    std::vector<char> segment(SEGMENT_SIZE);
+    u32 state = 0x12345678;
+    for (size_t i = 0; i < segment.size(); i += 4) {
+        state = state * 1103515245 + 12345;
+        // A few distinct opcodes with random operands
+        const u32 word = ((state >> 28) << 24) | ((state >> 8) & 0xFFF);
+        segment[i] = static_cast<char>(word);
+        segment[i + 1] = static_cast<char>(word >> 8);
+        segment[i + 2] = static_cast<char>(word >> 16);
+        segment[i + 3] = static_cast<char>(word >> 24);
+    }
+    return segment;
+}
+
+BENCHMARK(LZ4_DecompressSegment) {
+    // The NSO loader decompresses the segments with LZ4_decompress_safe
+    const std::vector<char> segment = MakeSegment();
+    std::vector<char> compressed(LZ4_compressBound(SEGMENT_SIZE));
+    const int compressed_size =
+        LZ4_compress_default(segment.data(), compressed.data(), SEGMENT_SIZE,
+                             static_cast<int>(compressed.size()));
+    ASSERT(compressed_size > 0);
+    std::vector<char> decompressed(SEGMENT_SIZE);
+
+    state.SetBytesPerIteration(SEGMENT_SIZE);
+    while (state.KeepRunning()) {
+        const int size = LZ4_decompress_safe(compressed.data(), decompressed.data(),
+                                             compressed_size, SEGMENT_SIZE);
+        Benchmark::DoNotOptimize(size);
+    }
+}
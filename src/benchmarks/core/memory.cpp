@@ -0,0 +1,92 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <memory>
+#include <vector>
+#include "benchmarks/benchmark.h"
+#include "core/hle/kernel/process.h"
+#include "core/memory.h"
+
+namespace {
+
+/// Size of the heap the benchmarks access, larger than the host caches
+constexpr size_t HEAP_SIZE = 64 * 1024 * 1024;
+/// Size of the blocks copied by the block benchmarks
+constexpr size_t BLOCK_SIZE = 0x1000;
+
+/// Process with a heap mapped, made the current one for its lifetime
+class BenchmarkProcess {
+public:
+    BenchmarkProcess() : process(Kernel::Process::Create("benchmark")) {
+        process->vm_manager
+            .MapMemoryBlock(Memory::HEAP_VADDR, std::make_shared<std::vector<u8>>(HEAP_SIZE), 0,
+                            HEAP_SIZE, Kernel::MemoryState::Heap)
+            .Unwrap();
+        previous_process = Kernel::g_current_process;
+        Kernel::g_current_process = process;
+        Memory::SetCurrentPageTable(&process->vm_manager.page_table);
+    }
+
+    ~BenchmarkProcess() {
+        Kernel::g_current_process = previous_process;
+        if (previous_process != nullptr) {
+            Memory::SetCurrentPageTable(&previous_process->vm_manager.page_table);
+        }
+    }
+
+private:
+    Kernel::SharedPtr<Kernel::Process> process;
+    Kernel::SharedPtr<Kernel::Process> previous_process;
+};
+
+/**
+ * Address of the n-th access of a benchmark. The accesses move to the next page each time, and
+ * are 8 bytes aligned but not page aligned, so that blocks span two pages.
+ */
+VAddr StridedAddress(u64 n, size_t access_size) {
+    const u64 offset = (n * (Memory::PAGE_SIZE + 8)) % (HEAP_SIZE - access_size);
+    return Memory::HEAP_VADDR + (offset & ~u64(7));
+}
+
+} // Anonymous namespace
+
+BENCHMARK(Memory_Read32) {
+    BenchmarkProcess process;
+    u64 n = 0;
+    u32 sum = 0;
+    while (state.KeepRunning()) {
+        sum += Memory::Read32(StridedAddress(n++, sizeof(u32)));
+    }
+    Benchmark::DoNotOptimize(sum);
+}
+
+BENCHMARK(Memory_Write32) {
+    BenchmarkProcess process;
+    u64 n = 0;
+    while (state.KeepRunning()) {
+        Memory::Write32(StridedAddress(n, sizeof(u32)), static_cast<u32>(n));
+        ++n;
+    }
+}
+
+BENCHMARK(Memory_ReadBlock) {
+    BenchmarkProcess process;
+    std::vector<u8> buffer(BLOCK_SIZE);
+    u64 n = 0;
+    state.SetBytesPerIteration(BLOCK_SIZE);
+    while (state.KeepRunning()) {
+        Memory::ReadBlock(StridedAddress(n++, BLOCK_SIZE), buffer.data(), BLOCK_SIZE);
+        Benchmark::DoNotOptimize(buffer);
+    }
+}
+
+BENCHMARK(Memory_WriteBlock) {
+    BenchmarkProcess process;
+    const std::vector<u8> buffer(BLOCK_SIZE, 0xAB);
+    u64 n = 0;
+    state.SetBytesPerIteration(BLOCK_SIZE);
+    while (state.KeepRunning()) {
+        Memory::WriteBlock(StridedAddress(n++, BLOCK_SIZE), buffer.data(), BLOCK_SIZE);
+    }
+}
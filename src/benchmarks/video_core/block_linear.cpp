@@ -0,0 +1,32 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <vector>
+#include "benchmarks/benchmark.h"
+#include "video_core/block_linear.h"
+
+/// Unswizzles a 1280x720 framebuffer, as presenting a frame does
+static void UnswizzleFramebuffer(Benchmark::State& state, u32 bytes_per_pixel) {
+    constexpr u32 width = 1280;
+    constexpr u32 height = 720;
+    constexpr u32 block_height = 16;
+    const std::vector<u8> tiled(
+        VideoCore::BlockLinear::GetSurfaceSize(width, height, bytes_per_pixel, block_height));
+    std::vector<u8> linear(width * height * bytes_per_pixel);
+
+    state.SetBytesPerIteration(linear.size());
+    while (state.KeepRunning()) {
+        VideoCore::BlockLinear::Unswizzle(linear.data(), tiled.data(), width, height,
+                                          bytes_per_pixel, block_height, true);
+        Benchmark::DoNotOptimize(linear);
+    }
+}
+
+BENCHMARK(BlockLinear_Unswizzle32) {
+    UnswizzleFramebuffer(state, 4);
+}
+
+BENCHMARK(BlockLinear_Unswizzle128) {
+    UnswizzleFramebuffer(state, 16);
+}
@@ -0,0 +1,65 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <vector>
+#include "benchmarks/benchmark.h"
+#include "video_core/macro_interpreter.h"
+#include "video_core/maxwell_3d.h"
+
+using namespace Tegra::Macro;
+
+static u32 AddImmediate(ResultOperation result, u32 dst, u32 src_a, s32 immediate) {
+    return static_cast<u32>(Operation::AddImmediate) | (static_cast<u32>(result) << 4) |
+           (dst << 8) | (src_a << 11) | (static_cast<u32>(immediate) << 14);
+}
+
+/// Calls a macro looping over its parameters to write them to consecutive registers, as the
+/// macros games call for every draw do
+static void CallMacros(Benchmark::State& state, bool use_macro_jit) {
+    constexpr u32 num_values = 16;
+    const std::vector<u32> code{
+        AddImmediate(ResultOperation::MoveAndSetMethod, 0, 1, 0),
+        AddImmediate(ResultOperation::IgnoreAndFetch, 2, 0, 0),
+        AddImmediate(ResultOperation::Move, 2, 2, -1),
+        AddImmediate(ResultOperation::IgnoreAndFetch, 3, 0, 0),
+        AddImmediate(ResultOperation::MoveAndSend, 0, 3, 0),
+        // Loops back with the decrement in the delay slot
+        static_cast<u32>(Operation::Branch) | (static_cast<u32>(BranchCondition::NotZero) << 4) |
+            (2 << 11) | (static_cast<u32>(-2) << 14),
+        AddImmediate(ResultOperation::Move, 2, 2, -1),
+        AddImmediate(ResultOperation::Move, 0, 0, 0) | (1 << 7),
+        AddImmediate(ResultOperation::Move, 0, 0, 0),
+    };
+
+    Tegra::Maxwell3D maxwell_3d(use_macro_jit);
+    maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(macros.upload_address), 0);
+    for (const u32 word : code) {
+        maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(macros.data), word);
+    }
+    maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(macros.entry), 0);
+    maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(macros.bind), 0);
+
+    const u32 method = Tegra::Maxwell3D::MACRO_REGISTERS_START;
+    u32 value = 0;
+    state.SetItemsPerIteration(1);
+    while (state.KeepRunning()) {
+        // Writes to 0x100 onwards, with an increment of 1
+        maxwell_3d.CallMethod(method, 0x1100, false);
+        maxwell_3d.CallMethod(method + 1, num_values, false);
+        for (u32 i = 0; i < num_values; ++i) {
+            maxwell_3d.CallMethod(method + 1, value++, i + 1 == num_values);
+        }
+    }
+    Benchmark::DoNotOptimize(maxwell_3d.GetRegisterValue(0x100));
+}
+
+BENCHMARK(Macro_Interpreter) {
+    CallMacros(state, false);
+}
+
+#ifdef ARCHITECTURE_x86_64
+BENCHMARK(Macro_JitX64) {
+    CallMacros(state, true);
+}
+#endif
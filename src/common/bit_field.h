@@ -32,6 +32,7 @@
 
 #include <cstddef>
 #include <limits>
+#include <tuple>
 #include <type_traits>
 #include "common/common_funcs.h"
 
@@ -128,6 +129,9 @@ private:
     using StorageTypeU = std::make_unsigned_t<StorageType>;
 
 public:
+    /// Type of the values of the field
+    using ValueType = T;
+
     /// Constants to allow limited introspection of fields if needed
     static constexpr size_t position = Position;
     static constexpr size_t bits = Bits;
@@ -200,3 +204,39 @@ private:
 static_assert(std::is_trivially_copyable<BitField<0, 1, unsigned>>::value,
               "BitField must be trivially copyable");
 #endif
+
+/**
+ * Bulk access to several bitfields of the same raw value. The fields are named by their types,
+ * e.g. decltype(SomeRegister::next_eight_bits), and their masks and shifts are constants, so the
+ * storage is read or written a single time whatever the number of fields.
+ *
+ * Sample usage:
+ *
+ * const auto [first, next] = ExtractFields<decltype(SomeRegister::first_seven_bits),
+ *                                          decltype(SomeRegister::next_eight_bits)>(reg.hex);
+ * AssignFields<decltype(SomeRegister::first_seven_bits),
+ *              decltype(SomeRegister::next_eight_bits)>(reg.hex, 1, 2);
+ */
+
+/// Union of the masks of several fields
+template <typename Storage, typename... Fields>
+constexpr Storage FieldsMask = (static_cast<Storage>(0) | ... | static_cast<Storage>(Fields::mask));
+
+/// Extracts the values of several fields from a raw value, in the order of the fields
+template <typename... Fields, typename Storage>
+constexpr FORCE_INLINE std::tuple<typename Fields::ValueType...> ExtractFields(Storage storage) {
+    static_assert(std::is_integral<Storage>::value, "Fields are extracted from raw values");
+    return std::tuple<typename Fields::ValueType...>(Fields::ExtractValue(storage)...);
+}
+
+/**
+ * Assigns several fields of a raw value at once, with a single read-modify-write of the storage
+ * instead of one per field. The values are given in the order of the fields.
+ */
+template <typename... Fields, typename Storage>
+FORCE_INLINE void AssignFields(Storage& storage, const typename Fields::ValueType&... values) {
+    static_assert(std::is_integral<Storage>::value, "Fields are assigned in raw values");
+    constexpr Storage mask = FieldsMask<Storage, Fields...>;
+    storage = (storage & ~mask) |
+              (static_cast<Storage>(0) | ... | static_cast<Storage>(Fields::FormatValue(values)));
+}
@@ -0,0 +1,365 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <type_traits>
+#include "common/assert.h"
+#include "common/color.h"
+#include "common/kernel_dispatch.h"
+
+#ifdef ARCHITECTURE_x86_64
+#include <immintrin.h>
+#include "common/x64/cpu_detect.h"
+#endif
+
+namespace Color {
+
+static_assert(sizeof(Math::Vec4<u8>) == 4 && std::is_trivially_copyable<Math::Vec4<u8>>::value,
+              "The span conversions store colors as four consecutive bytes");
+
+constexpr size_t NUM_FORMATS = static_cast<size_t>(Format::RGBA4) + 1;
+
+/// Kernels convert a prefix of a span and return its length, the rest is left to the scalar ones
+using DecodeFunc = size_t (*)(const u8* src, Math::Vec4<u8>* dst, size_t count);
+using EncodeFunc = size_t (*)(const Math::Vec4<u8>* src, u8* dst, size_t count);
+
+struct Kernels {
+    std::array<DecodeFunc, NUM_FORMATS> decode;
+    std::array<EncodeFunc, NUM_FORMATS> encode;
+};
+
+template <auto decode, size_t bytes_per_pixel>
+static size_t DecodeScalar(const u8* src, Math::Vec4<u8>* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = decode(src + i * bytes_per_pixel);
+    }
+    return count;
+}
+
+template <auto encode, size_t bytes_per_pixel>
+static size_t EncodeScalar(const Math::Vec4<u8>* src, u8* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        encode(src[i], dst + i * bytes_per_pixel);
+    }
+    return count;
+}
+
+static constexpr Kernels SCALAR_KERNELS{
+    {
+        DecodeScalar<DecodeRGBA8, 4>,
+        DecodeScalar<DecodeRGB8, 3>,
+        DecodeScalar<DecodeRG8, 2>,
+        DecodeScalar<DecodeRGB565, 2>,
+        DecodeScalar<DecodeRGB5A1, 2>,
+        DecodeScalar<DecodeRGBA4, 2>,
+    },
+    {
+        EncodeScalar<EncodeRGBA8, 4>,
+        EncodeScalar<EncodeRGB8, 3>,
+        EncodeScalar<EncodeRG8, 2>,
+        EncodeScalar<EncodeRGB565, 2>,
+        EncodeScalar<EncodeRGB5A1, 2>,
+        EncodeScalar<EncodeRGBA4, 2>,
+    },
+};
+
+#ifdef ARCHITECTURE_x86_64
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#else
+#define TARGET_SSSE3
+#endif
+
+static __m128i LoadPixels(const void* src) {
+    return _mm_loadu_si128(static_cast<const __m128i*>(src));
+}
+
+static void StorePixels(void* dst, __m128i pixels) {
+    _mm_storeu_si128(static_cast<__m128i*>(dst), pixels);
+}
+
+static __m128i AlphaMask() {
+    return _mm_set1_epi32(static_cast<int>(0xFF000000));
+}
+
+/// Reverses the bytes of each pixel, which both decodes and encodes RGBA8
+TARGET_SSSE3 static size_t ReverseRGBA8SSSE3(const void* src, void* dst, size_t count) {
+    const __m128i shuffle = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    const u8* src_bytes = static_cast<const u8*>(src);
+    u8* dst_bytes = static_cast<u8*>(dst);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i pixels = LoadPixels(src_bytes + i * 4);
+        StorePixels(dst_bytes + i * 4, _mm_shuffle_epi8(pixels, shuffle));
+    }
+    return i;
+}
+
+TARGET_SSSE3 static size_t DecodeRGBA8SSSE3(const u8* src, Math::Vec4<u8>* dst, size_t count) {
+    return ReverseRGBA8SSSE3(src, dst, count);
+}
+
+TARGET_SSSE3 static size_t EncodeRGBA8SSSE3(const Math::Vec4<u8>* src, u8* dst, size_t count) {
+    return ReverseRGBA8SSSE3(src, dst, count);
+}
+
+TARGET_SSSE3 static size_t DecodeRGB8SSSE3(const u8* src, Math::Vec4<u8>* dst, size_t count) {
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m128i alpha = AlphaMask();
+    size_t i = 0;
+    // Each load of four pixels reads 16 bytes, past the 12 bytes of the pixels
+    for (; i + 6 <= count; i += 4) {
+        const __m128i pixels = LoadPixels(src + i * 3);
+        StorePixels(dst + i, _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha));
+    }
+    return i;
+}
+
+TARGET_SSSE3 static size_t EncodeRGB8SSSE3(const Math::Vec4<u8>* src, u8* dst, size_t count) {
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t i = 0;
+    // Each store of four pixels writes 16 bytes, the last 4 of which the next pixels overwrite
+    for (; i + 6 <= count; i += 4) {
+        StorePixels(dst + i * 3, _mm_shuffle_epi8(LoadPixels(src + i), shuffle));
+    }
+    return i;
+}
+
+TARGET_SSSE3 static size_t DecodeRG8SSSE3(const u8* src, Math::Vec4<u8>* dst, size_t count) {
+    const __m128i shuffle_low =
+        _mm_setr_epi8(1, 0, -1, -1, 3, 2, -1, -1, 5, 4, -1, -1, 7, 6, -1, -1);
+    const __m128i shuffle_high =
+        _mm_setr_epi8(9, 8, -1, -1, 11, 10, -1, -1, 13, 12, -1, -1, 15, 14, -1, -1);
+    const __m128i alpha = AlphaMask();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i pixels = LoadPixels(src + i * 2);
+        StorePixels(dst + i, _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle_low), alpha));
+        StorePixels(dst + i + 4, _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle_high), alpha));
+    }
+    return i;
+}
+
+TARGET_SSSE3 static size_t EncodeRG8SSSE3(const Math::Vec4<u8>* src, u8* dst, size_t count) {
+    const __m128i shuffle = _mm_setr_epi8(1, 0, 5, 4, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i low = _mm_shuffle_epi8(LoadPixels(src + i), shuffle);
+        const __m128i high = _mm_shuffle_epi8(LoadPixels(src + i + 4), shuffle);
+        StorePixels(dst + i * 2, _mm_unpacklo_epi64(low, high));
+    }
+    return i;
+}
+
+/// Widens the 5-bit components in the 16-bit lanes to 8 bits, like Convert5To8
+static __m128i Expand5(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi16(value, 3), _mm_srli_epi16(value, 2));
+}
+
+/// Widens the 6-bit components in the 16-bit lanes to 8 bits, like Convert6To8
+static __m128i Expand6(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi16(value, 2), _mm_srli_epi16(value, 4));
+}
+
+/// Widens the 4-bit components in the 16-bit lanes to 8 bits, like Convert4To8
+static __m128i Expand4(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi16(value, 4), value);
+}
+
+/// Decodes eight pixels of a 16-bit format at once, one per 16-bit lane
+template <Format format>
+TARGET_SSSE3 static size_t Decode16SSSE3(const u8* src, Math::Vec4<u8>* dst, size_t count) {
+    const __m128i mask4 = _mm_set1_epi16(0xF);
+    const __m128i mask5 = _mm_set1_epi16(0x1F);
+    const __m128i mask6 = _mm_set1_epi16(0x3F);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i pixels = LoadPixels(src + i * 2);
+        __m128i r, g, b, a;
+        if constexpr (format == Format::RGB565) {
+            r = Expand5(_mm_srli_epi16(pixels, 11));
+            g = Expand6(_mm_and_si128(_mm_srli_epi16(pixels, 5), mask6));
+            b = Expand5(_mm_and_si128(pixels, mask5));
+            a = _mm_set1_epi16(0xFF);
+        } else if constexpr (format == Format::RGB5A1) {
+            r = Expand5(_mm_srli_epi16(pixels, 11));
+            g = Expand5(_mm_and_si128(_mm_srli_epi16(pixels, 6), mask5));
+            b = Expand5(_mm_and_si128(_mm_srli_epi16(pixels, 1), mask5));
+            // 0 - 1 sets all the bits, only the low 8 are kept below
+            a = _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(pixels, _mm_set1_epi16(1)));
+        } else {
+            static_assert(format == Format::RGBA4, "Not a 16-bit format");
+            r = Expand4(_mm_srli_epi16(pixels, 12));
+            g = Expand4(_mm_and_si128(_mm_srli_epi16(pixels, 8), mask4));
+            b = Expand4(_mm_and_si128(_mm_srli_epi16(pixels, 4), mask4));
+            a = Expand4(_mm_and_si128(pixels, mask4));
+        }
+
+        const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+        const __m128i ba = _mm_or_si128(b, _mm_slli_epi16(a, 8));
+        StorePixels(dst + i, _mm_unpacklo_epi16(rg, ba));
+        StorePixels(dst + i + 4, _mm_unpackhi_epi16(rg, ba));
+    }
+    return i;
+}
+
+/// Encodes the colors in the 32-bit lanes into the low 16 bits of the lanes
+template <Format format>
+static __m128i Pack16(__m128i colors) {
+    const auto component = [colors](u32 mask) {
+        return _mm_and_si128(colors, _mm_set1_epi32(static_cast<int>(mask)));
+    };
+    if constexpr (format == Format::RGB565) {
+        return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(component(0xF8), 8),
+                                         _mm_srli_epi32(component(0xFC00), 5)),
+                            _mm_srli_epi32(component(0xF80000), 19));
+    } else if constexpr (format == Format::RGB5A1) {
+        return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(component(0xF8), 8),
+                                         _mm_srli_epi32(component(0xF800), 5)),
+                            _mm_or_si128(_mm_srli_epi32(component(0xF80000), 18),
+                                         _mm_srli_epi32(colors, 31)));
+    } else {
+        static_assert(format == Format::RGBA4, "Not a 16-bit format");
+        return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(component(0xF0), 8),
+                                         _mm_srli_epi32(component(0xF000), 4)),
+                            _mm_or_si128(_mm_srli_epi32(component(0xF00000), 16),
+                                         _mm_srli_epi32(colors, 28)));
+    }
+}
+
+/// Encodes eight pixels of a 16-bit format at once, from two vectors of four colors
+template <Format format>
+TARGET_SSSE3 static size_t Encode16SSSE3(const Math::Vec4<u8>* src, u8* dst, size_t count) {
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i low = _mm_shuffle_epi8(Pack16<format>(LoadPixels(src + i)), shuffle);
+        const __m128i high = _mm_shuffle_epi8(Pack16<format>(LoadPixels(src + i + 4)), shuffle);
+        StorePixels(dst + i * 2, _mm_unpacklo_epi64(low, high));
+    }
+    return i;
+}
+
+static constexpr Kernels SSSE3_KERNELS{
+    {
+        DecodeRGBA8SSSE3,
+        DecodeRGB8SSSE3,
+        DecodeRG8SSSE3,
+        Decode16SSSE3<Format::RGB565>,
+        Decode16SSSE3<Format::RGB5A1>,
+        Decode16SSSE3<Format::RGBA4>,
+    },
+    {
+        EncodeRGBA8SSSE3,
+        EncodeRGB8SSSE3,
+        EncodeRG8SSSE3,
+        Encode16SSSE3<Format::RGB565>,
+        Encode16SSSE3<Format::RGB5A1>,
+        Encode16SSSE3<Format::RGBA4>,
+    },
+};
+
+#undef TARGET_SSSE3
+
+#endif // ARCHITECTURE_x86_64
+
+static const Kernels* SelectKernels(ConversionIsa isa) {
+    switch (isa) {
+#ifdef ARCHITECTURE_x86_64
+    case ConversionIsa::SSSE3:
+        Common::RecordKernelSelection("ColorConversion", "SSSE3");
+        return &SSSE3_KERNELS;
+#endif
+    default:
+        Common::RecordKernelSelection("ColorConversion", "Scalar");
+        return &SCALAR_KERNELS;
+    }
+}
+
+static ConversionIsa GetBestConversionIsa() {
+#ifdef ARCHITECTURE_x86_64
+    if (Common::GetCPUCaps().ssse3) {
+        return ConversionIsa::SSSE3;
+    }
+#endif
+    return ConversionIsa::Scalar;
+}
+
+static const Kernels*& GetKernels() {
+    static const Kernels* kernels = SelectKernels(GetBestConversionIsa());
+    return kernels;
+}
+
+bool IsConversionIsaSupported(ConversionIsa isa) {
+    switch (isa) {
+    case ConversionIsa::Scalar:
+        return true;
+    case ConversionIsa::SSSE3:
+        return GetBestConversionIsa() == ConversionIsa::SSSE3;
+    }
+    return false;
+}
+
+void SetConversionIsa(ConversionIsa isa) {
+    ASSERT(IsConversionIsaSupported(isa));
+    GetKernels() = SelectKernels(isa);
+}
+
+size_t GetBytesPerPixel(Format format) {
+    switch (format) {
+    case Format::RGBA8:
+        return 4;
+    case Format::RGB8:
+        return 3;
+    case Format::RG8:
+    case Format::RGB565:
+    case Format::RGB5A1:
+    case Format::RGBA4:
+        return 2;
+    }
+    UNREACHABLE();
+    return 0;
+}
+
+void DecodeSpan(Format format, const u8* src, Math::Vec4<u8>* dst, size_t count) {
+    const size_t index = static_cast<size_t>(format);
+    const size_t done = GetKernels()->decode[index](src, dst, count);
+    SCALAR_KERNELS.decode[index](src + done * GetBytesPerPixel(format), dst + done, count - done);
+}
+
+void EncodeSpan(Format format, const Math::Vec4<u8>* src, u8* dst, size_t count) {
+    const size_t index = static_cast<size_t>(format);
+    const size_t done = GetKernels()->encode[index](src, dst, count);
+    SCALAR_KERNELS.encode[index](src + done, dst + done * GetBytesPerPixel(format), count - done);
+}
+
+void ConvertSpan(Format src_format, const u8* src, Format dst_format, u8* dst, size_t count) {
+    if (src_format == dst_format) {
+        std::memcpy(dst, src, count * GetBytesPerPixel(src_format));
+        return;
+    }
+
+    // Converted through blocks of decoded colors small enough to stay in the L1 cache
+    constexpr size_t BLOCK_SIZE = 256;
+    std::array<Math::Vec4<u8>, BLOCK_SIZE> colors;
+    const size_t src_bpp = GetBytesPerPixel(src_format);
+    const size_t dst_bpp = GetBytesPerPixel(dst_format);
+    for (size_t offset = 0; offset < count; offset += BLOCK_SIZE) {
+        const size_t block_size = std::min(BLOCK_SIZE, count - offset);
+        DecodeSpan(src_format, src + offset * src_bpp, colors.data(), block_size);
+        EncodeSpan(dst_format, colors.data(), dst + offset * dst_bpp, block_size);
+    }
+}
+
+void ConvertRows(Format src_format, const u8* src, size_t src_stride, Format dst_format, u8* dst,
+                 size_t dst_stride, size_t width, size_t height) {
+    for (size_t row = 0; row < height; ++row) {
+        ConvertSpan(src_format, src + row * src_stride, dst_format, dst + row * dst_stride, width);
+    }
+}
+
+} // namespace Color
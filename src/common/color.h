@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include "common/common_types.h"
 #include "common/swap.h"
 #include "common/vector_math.h"
@@ -256,4 +257,61 @@ inline void EncodeX24S8(u8 stencil, u8* bytes) {
     bytes[3] = stencil;
 }
 
+/// Color formats the span conversions handle, stored like the Decode and Encode functions above
+enum class Format {
+    RGBA8,
+    RGB8,
+    RG8,
+    RGB565,
+    RGB5A1,
+    RGBA4,
+};
+
+/// Returns the number of bytes a pixel takes in a format
+size_t GetBytesPerPixel(Format format);
+
+/**
+ * Decodes a span of pixels, like calling the Decode function of the format on each of them.
+ * @param format Format of the source pixels
+ * @param src Pointer to the first source pixel
+ * @param dst Destination colors
+ * @param count Number of pixels
+ */
+void DecodeSpan(Format format, const u8* src, Math::Vec4<u8>* dst, size_t count);
+
+/**
+ * Encodes a span of colors, like calling the Encode function of the format on each of them.
+ * @param format Format of the destination pixels
+ * @param src Source colors
+ * @param dst Pointer to the first destination pixel
+ * @param count Number of pixels
+ */
+void EncodeSpan(Format format, const Math::Vec4<u8>* src, u8* dst, size_t count);
+
+/// Converts a span of pixels from a format to another, which may be the same
+void ConvertSpan(Format src_format, const u8* src, Format dst_format, u8* dst, size_t count);
+
+/**
+ * Converts a rectangle of pixels from a format to another, row by row.
+ * @param src_stride Distance in bytes between the starts of two source rows
+ * @param dst_stride Distance in bytes between the starts of two destination rows
+ */
+void ConvertRows(Format src_format, const u8* src, size_t src_stride, Format dst_format, u8* dst,
+                 size_t dst_stride, size_t width, size_t height);
+
+/// Instruction sets the span conversions can run with
+enum class ConversionIsa {
+    Scalar,
+    SSSE3,
+};
+
+/// Returns whether the host CPU supports running the span conversions with an instruction set
+bool IsConversionIsaSupported(ConversionIsa isa);
+
+/**
+ * Selects the instruction set the span conversions run with, which must be supported. The best
+ * one is selected by default, the others exist to compare them.
+ */
+void SetConversionIsa(ConversionIsa isa);
+
 } // namespace
@@ -35,7 +35,9 @@
 #include <cstdlib>
 #include <cstring>
 #include <dirent.h>
+#include <fcntl.h>
 #include <pwd.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #endif
 
@@ -715,6 +717,7 @@ const std::string& GetUserPath(const unsigned int DirIDX, const std::string& new
         paths[D_SDMC_IDX] = paths[D_USER_IDX] + SDMC_DIR DIR_SEP;
         paths[D_NAND_IDX] = paths[D_USER_IDX] + NAND_DIR DIR_SEP;
         paths[D_SYSDATA_IDX] = paths[D_USER_IDX] + SYSDATA_DIR DIR_SEP;
+        paths[D_LOGS_IDX] = paths[D_USER_IDX] + LOG_DIR DIR_SEP;
     }
 
     if (!newPath.empty()) {
@@ -736,6 +739,7 @@ const std::string& GetUserPath(const unsigned int DirIDX, const std::string& new
             paths[D_CACHE_IDX] = paths[D_USER_IDX] + CACHE_DIR DIR_SEP;
             paths[D_SDMC_IDX] = paths[D_USER_IDX] + SDMC_DIR DIR_SEP;
             paths[D_NAND_IDX] = paths[D_USER_IDX] + NAND_DIR DIR_SEP;
+            paths[D_LOGS_IDX] = paths[D_USER_IDX] + LOG_DIR DIR_SEP;
             break;
         }
     }
@@ -872,6 +876,20 @@ bool IOFile::Flush() {
     return m_good;
 }
 
+bool IOFile::Sync() {
+    if (!Flush() ||
+        0 !=
+#ifdef _WIN32
+            _commit(_fileno(m_file))
+#else
+            fsync(fileno(m_file))
+#endif
+            )
+        m_good = false;
+
+    return m_good;
+}
+
 bool IOFile::Resize(u64 size) {
     if (!IsOpen() ||
         0 !=
@@ -889,4 +907,134 @@ bool IOFile::Resize(u64 size) {
     return m_good;
 }
 
+MappedFile::MappedFile(const std::string& filename, Mode mode) {
+    Open(filename, mode);
+}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) {
+    Swap(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) {
+    Swap(other);
+    return *this;
+}
+
+void MappedFile::Swap(MappedFile& other) {
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_mode, other.m_mode);
+#ifdef _WIN32
+    std::swap(m_mapping, other.m_mapping);
+#endif
+}
+
+bool MappedFile::Open(const std::string& filename, Mode mode) {
+    Close();
+#ifdef _WIN32
+    const bool is_writable = mode == Mode::ReadWrite;
+    HANDLE file = CreateFileW(Common::UTF8ToUTF16W(filename).c_str(),
+                              is_writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                              is_writable ? FILE_SHARE_READ | FILE_SHARE_WRITE : FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart != 0) {
+        // The mapping keeps the file open
+        static constexpr DWORD protections[] = {PAGE_READONLY, PAGE_WRITECOPY, PAGE_READWRITE};
+        static constexpr DWORD accesses[] = {FILE_MAP_READ, FILE_MAP_COPY, FILE_MAP_WRITE};
+        m_mapping = CreateFileMappingW(file, nullptr, protections[static_cast<int>(mode)], 0, 0,
+                                       nullptr);
+        if (m_mapping != nullptr) {
+            const DWORD access = accesses[static_cast<int>(mode)];
+            m_data = static_cast<const u8*>(MapViewOfFile(m_mapping, access, 0, 0, 0));
+            m_size = size.QuadPart;
+        }
+    }
+    CloseHandle(file);
+#else
+    const int fd = open(filename.c_str(), mode == Mode::ReadWrite ? O_RDWR : O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat file_info;
+    if (fstat(fd, &file_info) == 0 && file_info.st_size != 0) {
+        // The mapping keeps the file open
+        const int protection = mode == Mode::ReadOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+        const int flags = mode == Mode::ReadWrite ? MAP_SHARED : MAP_PRIVATE;
+        void* data = mmap(nullptr, file_info.st_size, protection, flags, fd, 0);
+        if (data != MAP_FAILED) {
+            m_data = static_cast<const u8*>(data);
+            m_size = file_info.st_size;
+        }
+    }
+    close(fd);
+#endif
+
+    if (!IsOpen()) {
+        LOG_ERROR(Common_Filesystem, "Couldn't map %s", filename.c_str());
+        Close();
+        return false;
+    }
+    m_mode = mode;
+    return true;
+}
+
+void MappedFile::Close() {
+#ifdef _WIN32
+    if (m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping != nullptr) {
+        CloseHandle(m_mapping);
+    }
+    m_mapping = nullptr;
+#else
+    if (m_data != nullptr) {
+        munmap(const_cast<u8*>(m_data), m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_mode = Mode::ReadOnly;
+}
+
+void MappedFile::Advise(AccessHint hint, u64 offset, u64 length) const {
+#ifndef _WIN32
+    if (!IsOpen() || offset >= m_size) {
+        return;
+    }
+    // Dropping the pages of a private mapping would throw away what was written to them
+    if (hint == AccessHint::DontNeed && m_mode == Mode::CopyOnWrite) {
+        return;
+    }
+    static constexpr int advices[] = {MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED,
+                                      MADV_DONTNEED};
+    const u64 end = offset + std::min(length, m_size - offset);
+    // The range has to start on a page
+    const u64 page_size = sysconf(_SC_PAGESIZE);
+    const u64 begin = offset & ~(page_size - 1);
+    madvise(const_cast<u8*>(m_data) + begin, end - begin, advices[static_cast<int>(hint)]);
+#endif
+}
+
+bool MappedFile::Flush() const {
+    if (!IsOpen() || m_mode != Mode::ReadWrite) {
+        return true;
+    }
+#ifdef _WIN32
+    return FlushViewOfFile(m_data, 0) != 0;
+#else
+    return msync(const_cast<u8*>(m_data), m_size, MS_SYNC) == 0;
+#endif
+}
+
 } // namespace
@@ -241,6 +241,8 @@ public:
     u64 GetSize() const;
     bool Resize(u64 size);
     bool Flush();
+    /// Flushes the file and waits until its contents have reached the storage device
+    bool Sync();
 
     // clear error state
     void Clear() {
@@ -253,6 +255,83 @@ private:
     bool m_good = true;
 };
 
+/**
+ * Memory mapping of a whole file. The contents are paged in by the OS as they are accessed,
+ * instead of being copied into a buffer up front.
+ */
+class MappedFile : public NonCopyable {
+public:
+    enum class Mode {
+        /// The mapping can only be read
+        ReadOnly,
+        /// Written pages become private copies, the file and other mappings of it are never
+        /// modified
+        CopyOnWrite,
+        /// Writes go to the file and are seen by the other mappings of it
+        ReadWrite,
+    };
+
+    /// How the mapping is going to be accessed, lets the OS read ahead or drop pages early
+    enum class AccessHint {
+        Normal,
+        Sequential,
+        Random,
+        /// The range is going to be accessed soon, the OS starts reading it
+        WillNeed,
+        /// The range isn't going to be accessed for a while, the OS may drop its pages
+        DontNeed,
+    };
+
+    MappedFile() = default;
+    explicit MappedFile(const std::string& filename, Mode mode = Mode::ReadOnly);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other);
+    MappedFile& operator=(MappedFile&& other);
+
+    void Swap(MappedFile& other);
+
+    /// Maps a file, replacing the previous mapping. Empty files can't be mapped.
+    bool Open(const std::string& filename, Mode mode = Mode::ReadOnly);
+    void Close();
+
+    bool IsOpen() const {
+        return m_data != nullptr;
+    }
+
+    const u8* Data() const {
+        return m_data;
+    }
+
+    /// Writable view of a copy-on-write or read-write mapping
+    u8* WritableData() const {
+        return m_mode != Mode::ReadOnly ? const_cast<u8*>(m_data) : nullptr;
+    }
+
+    u64 Size() const {
+        return m_size;
+    }
+
+    /**
+     * Tells the OS how a range of the mapping is going to be accessed. This is only a hint, it
+     * does nothing on the systems that don't take it.
+     * @param offset Start of the range, rounded down to the page it is in.
+     * @param length Length of the range, clamped to the end of the mapping.
+     */
+    void Advise(AccessHint hint, u64 offset = 0, u64 length = ~0ULL) const;
+
+    /// Writes the modified pages of a read-write mapping back to the file and waits for them
+    bool Flush() const;
+
+private:
+    const u8* m_data = nullptr;
+    u64 m_size = 0;
+    Mode m_mode = Mode::ReadOnly;
+#ifdef _WIN32
+    void* m_mapping = nullptr;
+#endif
+};
+
 } // namespace
 
 // To deal with Windows being dumb at unicode:
@@ -5,9 +5,19 @@
 #if defined(_MSC_VER)
 #include <stdlib.h>
 #endif
+#include <algorithm>
+#include <cstring>
+#include "common/assert.h"
 #include "common/common_funcs.h"
 #include "common/common_types.h"
 #include "common/hash.h"
+#include "common/kernel_dispatch.h"
+#include "common/math_util.h"
+
+#ifdef ARCHITECTURE_x86_64
+#include <immintrin.h>
+#include "common/x64/cpu_detect.h"
+#endif
 
 namespace Common {
 
@@ -138,4 +148,244 @@ void MurmurHash3_128(const void* key, size_t len, u32 seed, void* out) {
     ((u64*)out)[1] = h2;
 }
 
+constexpr u32 FAST_HASH_PRIME32 = 0x9E3779B1;
+constexpr u64 FAST_HASH_PRIME64 = 0x9E3779B185EBCA87;
+
+/// Keys of the lanes, xored with the seed
+constexpr std::array<u64, FastHasher::NUM_LANES> FAST_HASH_SECRET{
+    0xBE4BA423396CFEB8, 0x1CAD21F72C81017C, 0xDB979083E96DD4DE, 0x1F67B3B7A4A44072,
+    0x78E5C0CC4EE679CB, 0x2172FFCC7DD05A82, 0x8E2443F7744608B8, 0x4C263A81E69035E0,
+};
+
+/**
+ * Adds stripes to the lanes. Each lane takes the product of the halves of its data mixed with its
+ * key, and the data of its neighbour, so that no data is lost when the product is 0.
+ * The key of lane i for stripe n of the block is keys[n % NUM_LANES + i].
+ */
+using AccumulateFunc = void (*)(u64* lanes, const u8* data, size_t num_stripes, const u64* keys,
+                                size_t first_stripe);
+
+static void AccumulateScalar(u64* lanes, const u8* data, size_t num_stripes, const u64* keys,
+                             size_t first_stripe) {
+    for (size_t stripe = 0; stripe < num_stripes; ++stripe) {
+        const u64* stripe_keys = keys + (first_stripe + stripe) % FastHasher::NUM_LANES;
+        for (size_t lane = 0; lane < FastHasher::NUM_LANES; ++lane) {
+            u64 value;
+            std::memcpy(&value, data + stripe * FastHasher::STRIPE_SIZE + lane * sizeof(u64),
+                        sizeof(value));
+            const u64 keyed = value ^ stripe_keys[lane];
+            lanes[lane ^ 1] += value;
+            lanes[lane] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+        }
+    }
+}
+
+#ifdef ARCHITECTURE_x86_64
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+static void AccumulateSSE2(u64* lanes, const u8* data, size_t num_stripes, const u64* keys,
+                           size_t first_stripe) {
+    constexpr size_t NUM_VECTORS = FastHasher::STRIPE_SIZE / sizeof(__m128i);
+    __m128i accumulators[NUM_VECTORS];
+    for (size_t i = 0; i < NUM_VECTORS; ++i) {
+        accumulators[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes) + i);
+    }
+    for (size_t stripe = 0; stripe < num_stripes; ++stripe) {
+        const u64* stripe_keys = keys + (first_stripe + stripe) % FastHasher::NUM_LANES;
+        const u8* stripe_data = data + stripe * FastHasher::STRIPE_SIZE;
+        for (size_t i = 0; i < NUM_VECTORS; ++i) {
+            const __m128i value =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(stripe_data) + i);
+            const __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(stripe_keys) + i);
+            const __m128i keyed = _mm_xor_si128(value, key);
+            const __m128i product = _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 32));
+            const __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+            accumulators[i] = _mm_add_epi64(accumulators[i], _mm_add_epi64(product, swapped));
+        }
+    }
+    for (size_t i = 0; i < NUM_VECTORS; ++i) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes) + i, accumulators[i]);
+    }
+}
+
+TARGET_AVX2 static void AccumulateAVX2(u64* lanes, const u8* data, size_t num_stripes,
+                                       const u64* keys, size_t first_stripe) {
+    constexpr size_t NUM_VECTORS = FastHasher::STRIPE_SIZE / sizeof(__m256i);
+    __m256i accumulators[NUM_VECTORS];
+    for (size_t i = 0; i < NUM_VECTORS; ++i) {
+        accumulators[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes) + i);
+    }
+    for (size_t stripe = 0; stripe < num_stripes; ++stripe) {
+        const u64* stripe_keys = keys + (first_stripe + stripe) % FastHasher::NUM_LANES;
+        const u8* stripe_data = data + stripe * FastHasher::STRIPE_SIZE;
+        for (size_t i = 0; i < NUM_VECTORS; ++i) {
+            const __m256i value =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(stripe_data) + i);
+            const __m256i key =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(stripe_keys) + i);
+            const __m256i keyed = _mm256_xor_si256(value, key);
+            const __m256i product = _mm256_mul_epu32(keyed, _mm256_srli_epi64(keyed, 32));
+            const __m256i swapped = _mm256_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+            accumulators[i] =
+                _mm256_add_epi64(accumulators[i], _mm256_add_epi64(product, swapped));
+        }
+    }
+    for (size_t i = 0; i < NUM_VECTORS; ++i) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes) + i, accumulators[i]);
+    }
+}
+
+#undef TARGET_AVX2
+
+#endif // ARCHITECTURE_x86_64
+
+static AccumulateFunc SelectAccumulate(HashIsa isa) {
+    switch (isa) {
+#ifdef ARCHITECTURE_x86_64
+    case HashIsa::AVX2:
+        RecordKernelSelection("Hash", "AVX2");
+        return AccumulateAVX2;
+    case HashIsa::SSE2:
+        RecordKernelSelection("Hash", "SSE2");
+        return AccumulateSSE2;
+#endif
+    default:
+        RecordKernelSelection("Hash", "Scalar");
+        return AccumulateScalar;
+    }
+}
+
+static HashIsa GetBestHashIsa() {
+#ifdef ARCHITECTURE_x86_64
+    if (Common::GetCPUCaps().avx2) {
+        return HashIsa::AVX2;
+    }
+    // SSE2 is always available on x86_64
+    return HashIsa::SSE2;
+#else
+    return HashIsa::Scalar;
+#endif
+}
+
+static AccumulateFunc& GetAccumulate() {
+    static AccumulateFunc accumulate = SelectAccumulate(GetBestHashIsa());
+    return accumulate;
+}
+
+bool IsHashIsaSupported(HashIsa isa) {
+    switch (isa) {
+    case HashIsa::Scalar:
+        return true;
+    case HashIsa::SSE2:
+        return GetBestHashIsa() != HashIsa::Scalar;
+    case HashIsa::AVX2:
+        return GetBestHashIsa() == HashIsa::AVX2;
+    }
+    return false;
+}
+
+void SetHashIsa(HashIsa isa) {
+    ASSERT(IsHashIsaSupported(isa));
+    GetAccumulate() = SelectAccumulate(isa);
+}
+
+/// Spreads the bits the multiplications gathered at the top of the lanes
+static void ScrambleLanes(std::array<u64, FastHasher::NUM_LANES>& lanes) {
+    for (size_t lane = 0; lane < FastHasher::NUM_LANES; ++lane) {
+        lanes[lane] ^= lanes[lane] >> 47;
+        lanes[lane] ^= FAST_HASH_SECRET[FastHasher::NUM_LANES - 1 - lane];
+        lanes[lane] *= FAST_HASH_PRIME32;
+    }
+}
+
+/// Multiplies two values and folds the 128-bit product into 64 bits
+static u64 MultiplyFold(u64 a, u64 b) {
+    return (a * b) ^ MathUtil::MultiplyHigh(a, b);
+}
+
+FastHasher::FastHasher(u64 seed) {
+    Reset(seed);
+}
+
+void FastHasher::Reset(u64 new_seed) {
+    seed = new_seed;
+    for (size_t lane = 0; lane < NUM_LANES; ++lane) {
+        lanes[lane] = FAST_HASH_PRIME64 * (lane + 1);
+        keys[lane] = keys[lane + NUM_LANES] = FAST_HASH_SECRET[lane] ^ seed;
+    }
+    buffer_size = 0;
+    stripes_in_block = 0;
+    total_len = 0;
+}
+
+void FastHasher::ProcessStripes(const u8* data, size_t num_stripes) {
+    const AccumulateFunc accumulate = GetAccumulate();
+    while (num_stripes > 0) {
+        const size_t count = std::min(num_stripes, STRIPES_PER_BLOCK - stripes_in_block);
+        accumulate(lanes.data(), data, count, keys.data(), stripes_in_block);
+        data += count * STRIPE_SIZE;
+        num_stripes -= count;
+        stripes_in_block += count;
+        if (stripes_in_block == STRIPES_PER_BLOCK) {
+            ScrambleLanes(lanes);
+            stripes_in_block = 0;
+        }
+    }
+}
+
+void FastHasher::Update(const void* data, size_t len) {
+    const u8* bytes = static_cast<const u8*>(data);
+    total_len += len;
+
+    if (buffer_size > 0) {
+        const size_t count = std::min(len, STRIPE_SIZE - buffer_size);
+        std::memcpy(buffer.data() + buffer_size, bytes, count);
+        buffer_size += count;
+        bytes += count;
+        len -= count;
+        if (buffer_size < STRIPE_SIZE) {
+            return;
+        }
+        ProcessStripes(buffer.data(), 1);
+        buffer_size = 0;
+    }
+
+    const size_t num_stripes = len / STRIPE_SIZE;
+    ProcessStripes(bytes, num_stripes);
+    buffer_size = len - num_stripes * STRIPE_SIZE;
+    std::memcpy(buffer.data(), bytes + num_stripes * STRIPE_SIZE, buffer_size);
+}
+
+u64 FastHasher::Finalize() const {
+    std::array<u64, NUM_LANES> final_lanes = lanes;
+    if (buffer_size > 0) {
+        // The partial stripe is padded with zeroes, the length tells it apart from real ones
+        std::array<u8, STRIPE_SIZE> stripe{};
+        std::memcpy(stripe.data(), buffer.data(), buffer_size);
+        AccumulateScalar(final_lanes.data(), stripe.data(), 1, keys.data(), stripes_in_block);
+    }
+
+    u64 hash = total_len * FAST_HASH_PRIME64 ^ seed;
+    for (size_t lane = 0; lane < NUM_LANES; lane += 2) {
+        hash += MultiplyFold(final_lanes[lane] ^ FAST_HASH_SECRET[NUM_LANES - 1 - lane],
+                             final_lanes[lane + 1] ^ FAST_HASH_SECRET[NUM_LANES - 2 - lane]);
+    }
+
+    hash ^= hash >> 37;
+    hash *= 0x165667919E3779F9;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+u64 ComputeFastHash64(const void* data, size_t len, u64 seed) {
+    FastHasher hasher(seed);
+    hasher.Update(data, len);
+    return hasher.Finalize();
+}
+
 } // namespace Common
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <array>
 #include <cstddef>
 #include "common/common_types.h"
 
@@ -23,4 +24,62 @@ static inline u64 ComputeHash64(const void* data, size_t len) {
     return res[0];
 }
 
+/**
+ * Incrementally computes a fast 64-bit hash, meant for large buffers like textures, framebuffers
+ * and shaders. Data is consumed in stripes of 64 bytes by 8 independent lanes, in the manner of
+ * xxHash3, and the hash doesn't depend on how the data is split between the updates.
+ *
+ * The hashes differ from ComputeHash64, which stays in use for the hashes stored on disk.
+ */
+class FastHasher {
+public:
+    explicit FastHasher(u64 seed = 0);
+
+    /// Starts over the hashing of new data
+    void Reset(u64 seed = 0);
+
+    /// Hashes the next block of data
+    void Update(const void* data, size_t len);
+
+    /// Gets the hash of the data so far, more data can still be hashed after it
+    u64 Finalize() const;
+
+    static constexpr size_t NUM_LANES = 8;
+    static constexpr size_t STRIPE_SIZE = NUM_LANES * sizeof(u64);
+    /// The lanes are scrambled after each block of stripes
+    static constexpr size_t STRIPES_PER_BLOCK = 16;
+
+private:
+    void ProcessStripes(const u8* data, size_t num_stripes);
+
+    std::array<u64, NUM_LANES> lanes;
+    /// Keys of the lanes, twice over, so that each stripe of a block takes a rotation of them
+    std::array<u64, NUM_LANES * 2> keys;
+    /// Partial stripe left by the previous updates
+    std::array<u8, STRIPE_SIZE> buffer;
+    size_t buffer_size;
+    size_t stripes_in_block;
+    u64 total_len;
+    u64 seed;
+};
+
+/// Computes a fast 64-bit hash over the specified block of data, see FastHasher.
+u64 ComputeFastHash64(const void* data, size_t len, u64 seed = 0);
+
+/// Instruction sets the stripes of the fast hash can be processed with
+enum class HashIsa {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+/// Returns whether the host CPU supports processing the stripes with an instruction set
+bool IsHashIsaSupported(HashIsa isa);
+
+/**
+ * Selects the instruction set the stripes are processed with, which must be supported. The best
+ * one is selected by default, the others exist to compare them.
+ */
+void SetHashIsa(HashIsa isa);
+
 } // namespace Common
@@ -0,0 +1,28 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <mutex>
+#include "common/kernel_dispatch.h"
+#include "common/logging/log.h"
+
+namespace Common {
+
+static std::mutex selections_mutex;
+static std::map<std::string, std::string> selections;
+
+void RecordKernelSelection(const std::string& family, const std::string& variant) {
+    std::lock_guard<std::mutex> lock(selections_mutex);
+    std::string& selection = selections[family];
+    if (selection != variant) {
+        selection = variant;
+        LOG_INFO(Common, "Using the %s kernels for %s", variant.c_str(), family.c_str());
+    }
+}
+
+std::map<std::string, std::string> GetKernelSelections() {
+    std::lock_guard<std::mutex> lock(selections_mutex);
+    return selections;
+}
+
+} // namespace Common
@@ -0,0 +1,24 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <map>
+#include <string>
+
+/**
+ * Registry of the variants in use for each family of performance kernels dispatched on the
+ * instruction sets of the host, such as byte swapping, hashing, color conversion and audio mixing.
+ * Each family picks the best variant the host supports the first time it is used, and records it
+ * here so that it is logged and reported in telemetry.
+ */
+namespace Common {
+
+/// Records the variant a family of kernels uses, logging it if it changed
+void RecordKernelSelection(const std::string& family, const std::string& variant);
+
+/// Returns the variant each family of kernels used so far uses, indexed by family
+std::map<std::string, std::string> GetKernelSelections();
+
+} // namespace Common
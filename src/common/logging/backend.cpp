@@ -4,10 +4,17 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <condition_variable>
 #include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
 #include "common/assert.h"
 #include "common/common_funcs.h" // snprintf compatibility define
+#include "common/file_util.h"
 #include "common/logging/backend.h"
+#include "common/logging/deferred_format.h"
 #include "common/logging/filter.h"
 #include "common/logging/log.h"
 #include "common/logging/text_formatter.h"
@@ -38,6 +45,9 @@ namespace Log {
     SUB(Service, CFG)                                                                              \
     SUB(Service, DSP)                                                                              \
     SUB(Service, HID)                                                                              \
+    SUB(Service, Audio)                                                                            \
+    SUB(Service, APM)                                                                              \
+    SUB(Service, BSD)                                                                              \
     CLS(HW)                                                                                        \
     SUB(HW, Memory)                                                                                \
     SUB(HW, LCD)                                                                                   \
@@ -113,22 +123,324 @@ Entry CreateEntry(Class log_class, Level log_level, const char* filename, unsign
     return entry;
 }
 
+/// Number of records the ring holds, producers wait for the writer thread when it is full
+constexpr size_t RING_SIZE = 1024;
+/// Size of the data of the records, messages with longer arguments are formatted right away and
+/// truncated
+constexpr size_t MESSAGE_SIZE = 1024;
+
+/**
+ * Asynchronous logger. Callers copy the format string and the arguments of their message into a
+ * record of a bounded MPSC ring, and a dedicated thread formats the entry and writes it to the
+ * console and file sinks, so that logging costs the callers neither formatting nor I/O.
+ *
+ * Each record has a sequence number saying whose turn it is: it equals the position of the ring it
+ * can be claimed for, becomes position + 1 once the message is written into it, and position +
+ * RING_SIZE once the writer thread is done with it.
+ */
+class Logger {
+public:
+    Logger() {
+        for (size_t index = 0; index < RING_SIZE; ++index) {
+            ring[index].sequence.store(index, std::memory_order_relaxed);
+        }
+        writer = std::thread(&Logger::WriterLoop, this);
+    }
+
+    ~Logger() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            is_stopping = true;
+            is_writer_sleeping = false;
+        }
+        writer_cv.notify_one();
+        writer.join();
+    }
+
+    void Push(Class log_class, Level log_level, const char* filename, unsigned int line_nr,
+              const char* function, const char* format, va_list args) {
+        const u64 position = Claim();
+        Record& record = ring[position % RING_SIZE];
+        record.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - time_origin);
+        record.log_class = log_class;
+        record.log_level = log_level;
+        record.filename = filename;
+        record.function = function;
+        record.line_nr = line_nr;
+        record.format = format;
+        // Formatting is left to the writer thread, unless the arguments can't be encoded
+        record.is_formatted =
+            !EncodeFormatArguments(format, args, record.data.data(), record.data.size());
+        if (record.is_formatted) {
+            vsnprintf(reinterpret_cast<char*>(record.data.data()), record.data.size(), format,
+                      args);
+        }
+        record.sequence.store(position + 1, std::memory_order_release);
+        WakeWriter();
+    }
+
+    /// Waits until every message pushed so far was written to the sinks
+    void Flush() {
+        const u64 position = write_position.load(std::memory_order_relaxed);
+        WakeWriter();
+        std::unique_lock<std::mutex> lock(mutex);
+        flush_cv.wait(lock, [&] { return written_position >= position; });
+    }
+
+    void SetFileSink(FileUtil::IOFile file) {
+        std::lock_guard<std::mutex> lock(file_sink_mutex);
+        file_sink = std::move(file);
+    }
+
+    void SetConsoleSink(bool enabled) {
+        is_console_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+private:
+    struct Record {
+        std::atomic<u64> sequence;
+        std::chrono::microseconds timestamp;
+        Class log_class;
+        Level log_level;
+        const char* filename;
+        const char* function;
+        unsigned int line_nr;
+        const char* format;
+        /// Whether the data holds the formatted message instead of the encoded arguments
+        bool is_formatted;
+        std::array<u8, MESSAGE_SIZE> data;
+    };
+
+    /// Claims the next position of the ring, waiting for the writer thread if the ring is full
+    u64 Claim() {
+        u64 position = write_position.load(std::memory_order_relaxed);
+        for (;;) {
+            const u64 sequence = ring[position % RING_SIZE].sequence.load(std::memory_order_acquire);
+            if (sequence == position) {
+                if (write_position.compare_exchange_weak(position, position + 1,
+                                                         std::memory_order_relaxed)) {
+                    return position;
+                }
+            } else if (sequence < position) {
+                // The record still holds a message of the previous round
+                WakeWriter();
+                std::this_thread::yield();
+                position = write_position.load(std::memory_order_relaxed);
+            } else {
+                position = write_position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void WakeWriter() {
+        // Orders the publication of the record before the check, the writer does the opposite
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (is_writer_sleeping.exchange(false)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            writer_cv.notify_one();
+        }
+    }
+
+    bool IsRecordReady() const {
+        return ring[read_position % RING_SIZE].sequence.load(std::memory_order_acquire) ==
+               read_position + 1;
+    }
+
+    void WriterLoop() {
+        for (;;) {
+            while (IsRecordReady()) {
+                Record& record = ring[read_position % RING_SIZE];
+                Write(record);
+                record.sequence.store(read_position + RING_SIZE, std::memory_order_release);
+                ++read_position;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(file_sink_mutex);
+                if (file_sink.IsOpen()) {
+                    file_sink.Flush();
+                }
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            written_position = read_position;
+            flush_cv.notify_all();
+
+            is_writer_sleeping = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (IsRecordReady()) {
+                is_writer_sleeping = false;
+                continue;
+            }
+            if (is_stopping) {
+                return;
+            }
+            writer_cv.wait(lock, [&] { return !is_writer_sleeping || is_stopping; });
+        }
+    }
+
+    void Write(const Record& record) {
+        std::array<char, 4 * 1024> formatting_buffer;
+
+        Entry entry;
+        entry.timestamp = record.timestamp;
+        entry.log_class = record.log_class;
+        entry.log_level = record.log_level;
+        snprintf(formatting_buffer.data(), formatting_buffer.size(), "%s:%s:%u", record.filename,
+                 record.function, record.line_nr);
+        entry.location = std::string(formatting_buffer.data());
+        if (record.is_formatted) {
+            entry.message = std::string(reinterpret_cast<const char*>(record.data.data()));
+        } else {
+            FormatEncodedArguments(record.format, record.data.data(), formatting_buffer.data(),
+                                   formatting_buffer.size());
+            entry.message = std::string(formatting_buffer.data());
+        }
+
+        if (is_console_enabled.load(std::memory_order_relaxed)) {
+            PrintColoredMessage(entry);
+        }
+
+        std::lock_guard<std::mutex> lock(file_sink_mutex);
+        if (file_sink.IsOpen()) {
+            FormatLogMessage(entry, formatting_buffer.data(), formatting_buffer.size());
+            file_sink.WriteBytes(formatting_buffer.data(), std::strlen(formatting_buffer.data()));
+            file_sink.WriteBytes("\n", 1);
+        }
+    }
+
+    const std::chrono::steady_clock::time_point time_origin = std::chrono::steady_clock::now();
+
+    std::array<Record, RING_SIZE> ring;
+    /// Next position of the ring to be claimed by a producer
+    std::atomic<u64> write_position{0};
+    /// Next position of the ring to be written to the sinks, only used by the writer thread
+    u64 read_position = 0;
+
+    std::mutex mutex;
+    std::condition_variable writer_cv;
+    std::condition_variable flush_cv;
+    std::atomic<bool> is_writer_sleeping{false};
+    /// Position up to which the messages were written, guarded by the mutex
+    u64 written_position = 0;
+    bool is_stopping = false;
+
+    std::atomic<bool> is_console_enabled{true};
+    std::mutex file_sink_mutex;
+    FileUtil::IOFile file_sink;
+
+    std::thread writer;
+};
+
+static Logger& GetLogger() {
+    static Logger logger;
+    return logger;
+}
+
+/// Messages per second each class may log on average before its messages are dropped
+constexpr u64 RATE_LIMIT_MESSAGES_PER_SECOND = 100;
+/// Messages each class may log in a burst above the average rate
+constexpr u64 RATE_LIMIT_BURST = 500;
+
+/**
+ * Token bucket limiting the rate of the warnings and errors of a log class, so that code repeating
+ * the same problem doesn't flood the log. The bucket is kept as the time it will be full again,
+ * each message moving it by the interval of a token, so that it is a single atomic.
+ */
+class RateLimiter {
+public:
+    /// Takes a token, returns false if the message has to be dropped
+    bool TryAcquire(u64 now_us) {
+        u64 full_time = bucket_full_time.load(std::memory_order_relaxed);
+        for (;;) {
+            const u64 new_full_time = std::max(full_time, now_us) + TOKEN_INTERVAL_US;
+            if (new_full_time - now_us > TOKEN_INTERVAL_US * RATE_LIMIT_BURST) {
+                dropped_count.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (bucket_full_time.compare_exchange_weak(full_time, new_full_time,
+                                                       std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+
+    /// Gets the number of messages dropped since the previous call
+    u64 TakeDroppedCount() {
+        return dropped_count.exchange(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr u64 TOKEN_INTERVAL_US = 1000000 / RATE_LIMIT_MESSAGES_PER_SECOND;
+
+    std::atomic<u64> bucket_full_time{0};
+    std::atomic<u64> dropped_count{0};
+};
+
+static std::array<RateLimiter, static_cast<size_t>(Class::Count)> rate_limiters;
+
 static Filter* filter = nullptr;
 
 void SetFilter(Filter* new_filter) {
     filter = new_filter;
 }
 
+bool IsMessageEnabled(Class log_class, Level log_level) {
+    return filter == nullptr || filter->CheckMessage(log_class, log_level);
+}
+
+void SetFileSink(const std::string& path) {
+    GetLogger().SetFileSink(FileUtil::IOFile(path, "w"));
+}
+
+void SetConsoleSink(bool enabled) {
+    GetLogger().SetConsoleSink(enabled);
+}
+
+void Flush() {
+    GetLogger().Flush();
+}
+
+static void PushMessage(Class log_class, Level log_level, const char* filename,
+                        unsigned int line_nr, const char* function, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    GetLogger().Push(log_class, log_level, filename, line_nr, function, format, args);
+    va_end(args);
+}
+
 void LogMessage(Class log_class, Level log_level, const char* filename, unsigned int line_nr,
                 const char* function, const char* format, ...) {
-    if (filter != nullptr && !filter->CheckMessage(log_class, log_level))
+    if (!IsMessageEnabled(log_class, log_level))
         return;
 
+    if (log_level == Level::Warning || log_level == Level::Error) {
+        using std::chrono::steady_clock;
+        static const steady_clock::time_point time_origin = steady_clock::now();
+        const u64 now_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                               steady_clock::now() - time_origin)
+                               .count();
+        RateLimiter& rate_limiter = rate_limiters[static_cast<size_t>(log_class)];
+        if (!rate_limiter.TryAcquire(now_us)) {
+            return;
+        }
+        const u64 dropped_count = rate_limiter.TakeDroppedCount();
+        if (dropped_count != 0) {
+            PushMessage(log_class, log_level, filename, line_nr, function,
+                        "Dropped %llu messages of this class, it was logging too many",
+                        static_cast<unsigned long long>(dropped_count));
+        }
+    }
+
     va_list args;
     va_start(args, format);
-    Entry entry = CreateEntry(log_class, log_level, filename, line_nr, function, format, args);
+    GetLogger().Push(log_class, log_level, filename, line_nr, function, format, args);
     va_end(args);
 
-    PrintColoredMessage(entry);
+    // Critical messages usually precede a crash, they have to be out before it
+    if (log_level == Level::Critical) {
+        Flush();
+    }
 }
 }
@@ -47,4 +47,22 @@ Entry CreateEntry(Class log_class, Level log_level, const char* filename, unsign
                   const char* function, const char* format, va_list args);
 
 void SetFilter(Filter* filter);
+
+/**
+ * Returns whether messages of a class and level pass the filter, so that callers can skip building
+ * costly messages that would be discarded.
+ */
+bool IsMessageEnabled(Class log_class, Level log_level);
+
+/**
+ * Also writes the log messages to the file at the given path, replacing its contents and the
+ * previous file sink.
+ */
+void SetFileSink(const std::string& path);
+
+/// Sets whether the log messages are written to stderr, which they are by default.
+void SetConsoleSink(bool enabled);
+
+/// Waits until the messages logged so far were written, they are written by a background thread.
+void Flush();
 }
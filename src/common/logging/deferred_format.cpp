@@ -0,0 +1,363 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "common/common_funcs.h" // snprintf compatibility define
+#include "common/logging/deferred_format.h"
+
+namespace Log {
+
+namespace {
+
+enum class ArgumentType {
+    None,
+    Signed,
+    Unsigned,
+    Float,
+    String,
+    Pointer,
+    Unsupported,
+};
+
+/// A conversion specification of a format string, without its length modifier
+struct Conversion {
+    const char* flags_begin;
+    const char* flags_end;
+    bool has_width_argument;
+    bool has_precision_argument;
+    /// Precision written in the format string, -1 if there is none
+    int precision;
+    const char* length_begin;
+    /// Length modifier, in the forms of the standard ("hh", "l", "z", ...)
+    std::array<char, 3> length;
+    char specifier;
+    /// Character following the conversion specification
+    const char* end;
+};
+
+/// Parses the conversion specification starting after a '%'
+Conversion ParseConversion(const char* p) {
+    Conversion conversion{};
+    conversion.precision = -1;
+    conversion.flags_begin = p;
+    while (*p != '\0' && std::strchr("-+ #0'", *p) != nullptr) {
+        ++p;
+    }
+    conversion.flags_end = p;
+
+    // Width and precision written in the format string stay in the flags, '*' takes an argument
+    if (*p == '*') {
+        conversion.has_width_argument = true;
+        ++p;
+    }
+    while (*p >= '0' && *p <= '9') {
+        ++p;
+    }
+    if (*p == '.') {
+        ++p;
+        if (*p == '*') {
+            conversion.has_precision_argument = true;
+            ++p;
+        } else {
+            conversion.precision = std::atoi(p);
+        }
+        while (*p >= '0' && *p <= '9') {
+            ++p;
+        }
+    }
+
+    conversion.length_begin = p;
+    size_t length_size = 0;
+    while (*p != '\0' && std::strchr("hljztLq", *p) != nullptr && length_size < 2) {
+        conversion.length[length_size++] = *p++;
+    }
+    conversion.specifier = *p;
+    conversion.end = *p != '\0' ? p + 1 : p;
+    return conversion;
+}
+
+bool IsLength(const Conversion& conversion, const char* length) {
+    return std::strcmp(conversion.length.data(), length) == 0;
+}
+
+ArgumentType GetArgumentType(const Conversion& conversion) {
+    switch (conversion.specifier) {
+    case 'd':
+    case 'i':
+        return ArgumentType::Signed;
+    case 'c':
+        // Wide characters would have to be converted
+        return conversion.length[0] == '\0' ? ArgumentType::Signed : ArgumentType::Unsupported;
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+        return ArgumentType::Unsigned;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        return ArgumentType::Float;
+    case 's':
+        // Wide strings would have to be converted
+        return conversion.length[0] == '\0' ? ArgumentType::String : ArgumentType::Unsupported;
+    case 'p':
+        return ArgumentType::Pointer;
+    case '%':
+        return ArgumentType::None;
+    default:
+        return ArgumentType::Unsupported;
+    }
+}
+
+/// Writes the arguments into a buffer, failing once they don't fit it
+class ArgumentWriter {
+public:
+    ArgumentWriter(u8* buffer, size_t size) : p(buffer), end(buffer + size) {}
+
+    bool Write(const void* data, size_t size) {
+        if (static_cast<size_t>(end - p) < size) {
+            return false;
+        }
+        std::memcpy(p, data, size);
+        p += size;
+        return true;
+    }
+
+    bool WriteU64(u64 value) {
+        return Write(&value, sizeof(value));
+    }
+
+    /// Writes a string, up to the given length as it may not be null-terminated past it
+    bool WriteString(const char* string, int max_length) {
+        if (string == nullptr) {
+            string = "(null)";
+        }
+        const void* terminator =
+            max_length < 0 ? nullptr : std::memchr(string, '\0', static_cast<size_t>(max_length));
+        const size_t length = max_length < 0 ? std::strlen(string)
+                                             : terminator != nullptr
+                                                   ? static_cast<const char*>(terminator) - string
+                                                   : static_cast<size_t>(max_length);
+        const char terminator_char = '\0';
+        return Write(string, length) && Write(&terminator_char, 1);
+    }
+
+private:
+    u8* p;
+    u8* const end;
+};
+
+/// Reads the arguments back in the order they were written
+class ArgumentReader {
+public:
+    explicit ArgumentReader(const u8* buffer) : p(buffer) {}
+
+    u64 ReadU64() {
+        u64 value;
+        std::memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+        return value;
+    }
+
+    const char* ReadString() {
+        const char* string = reinterpret_cast<const char*>(p);
+        p += std::strlen(string) + 1;
+        return string;
+    }
+
+private:
+    const u8* p;
+};
+
+s64 ReadSigned(const Conversion& conversion, va_list& args) {
+    if (conversion.specifier == 'c' || IsLength(conversion, "")) {
+        return va_arg(args, int);
+    } else if (IsLength(conversion, "hh")) {
+        return static_cast<signed char>(va_arg(args, int));
+    } else if (IsLength(conversion, "h")) {
+        return static_cast<short>(va_arg(args, int));
+    } else if (IsLength(conversion, "l")) {
+        return va_arg(args, long);
+    } else if (IsLength(conversion, "j")) {
+        return va_arg(args, intmax_t);
+    } else if (IsLength(conversion, "z") || IsLength(conversion, "t")) {
+        return va_arg(args, ptrdiff_t);
+    }
+    return va_arg(args, long long);
+}
+
+u64 ReadUnsigned(const Conversion& conversion, va_list& args) {
+    if (IsLength(conversion, "")) {
+        return va_arg(args, unsigned int);
+    } else if (IsLength(conversion, "hh")) {
+        return static_cast<unsigned char>(va_arg(args, unsigned int));
+    } else if (IsLength(conversion, "h")) {
+        return static_cast<unsigned short>(va_arg(args, unsigned int));
+    } else if (IsLength(conversion, "l")) {
+        return va_arg(args, unsigned long);
+    } else if (IsLength(conversion, "j")) {
+        return va_arg(args, uintmax_t);
+    } else if (IsLength(conversion, "z") || IsLength(conversion, "t")) {
+        return va_arg(args, size_t);
+    }
+    return va_arg(args, unsigned long long);
+}
+
+/// Appends the result of formatting a single conversion to the message
+template <typename T>
+void AppendFormatted(std::string& message, const std::string& spec, T value) {
+    const int length = snprintf(nullptr, 0, spec.c_str(), value);
+    if (length <= 0) {
+        return;
+    }
+    const size_t offset = message.size();
+    message.resize(offset + length + 1);
+    snprintf(&message[offset], length + 1, spec.c_str(), value);
+    message.resize(offset + length);
+}
+
+/// Encodes the arguments, which are taken by reference as va_list may be an array type
+bool EncodeArguments(const char* format, va_list& args, ArgumentWriter& writer) {
+    const char* p = format;
+    while ((p = std::strchr(p, '%')) != nullptr) {
+        const Conversion conversion = ParseConversion(p + 1);
+        p = conversion.end;
+
+        if (conversion.has_width_argument && !writer.WriteU64(va_arg(args, int))) {
+            return false;
+        }
+        int precision = conversion.precision;
+        if (conversion.has_precision_argument) {
+            precision = va_arg(args, int);
+            if (!writer.WriteU64(static_cast<u64>(precision))) {
+                return false;
+            }
+        }
+
+        bool fits = true;
+        switch (GetArgumentType(conversion)) {
+        case ArgumentType::None:
+            break;
+        case ArgumentType::Signed:
+            fits = writer.WriteU64(static_cast<u64>(ReadSigned(conversion, args)));
+            break;
+        case ArgumentType::Unsigned:
+            fits = writer.WriteU64(ReadUnsigned(conversion, args));
+            break;
+        case ArgumentType::Float: {
+            const double value = conversion.length[0] == 'L'
+                                     ? static_cast<double>(va_arg(args, long double))
+                                     : va_arg(args, double);
+            fits = writer.Write(&value, sizeof(value));
+            break;
+        }
+        case ArgumentType::String:
+            fits = writer.WriteString(va_arg(args, const char*), precision);
+            break;
+        case ArgumentType::Pointer:
+            fits = writer.WriteU64(reinterpret_cast<uintptr_t>(va_arg(args, void*)));
+            break;
+        case ArgumentType::Unsupported:
+            return false;
+        }
+        if (!fits) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // Anonymous namespace
+
+bool EncodeFormatArguments(const char* format, va_list args, u8* buffer, size_t buffer_size) {
+    ArgumentWriter writer(buffer, buffer_size);
+    va_list arguments;
+    va_copy(arguments, args);
+    const bool result = EncodeArguments(format, arguments, writer);
+    va_end(arguments);
+    return result;
+}
+
+void FormatEncodedArguments(const char* format, const u8* buffer, char* out_text,
+                            size_t text_len) {
+    if (text_len == 0) {
+        return;
+    }
+
+    ArgumentReader reader(buffer);
+    std::string message;
+    const char* p = format;
+    for (;;) {
+        const char* percent = std::strchr(p, '%');
+        if (percent == nullptr) {
+            message.append(p);
+            break;
+        }
+        message.append(p, percent);
+        const Conversion conversion = ParseConversion(percent + 1);
+        p = conversion.end;
+
+        // Rebuilds the conversion with the width and precision arguments written out, and the
+        // length modifier of the 64-bit values the arguments were stored as
+        std::string spec = "%";
+        for (const char* flag = conversion.flags_begin; flag != conversion.length_begin; ++flag) {
+            if (*flag == '*') {
+                spec += std::to_string(static_cast<int>(reader.ReadU64()));
+            } else {
+                spec += *flag;
+            }
+        }
+
+        switch (GetArgumentType(conversion)) {
+        case ArgumentType::None:
+            message += '%';
+            break;
+        case ArgumentType::Signed:
+            if (conversion.specifier == 'c') {
+                AppendFormatted(message, spec + 'c', static_cast<int>(reader.ReadU64()));
+            } else {
+                AppendFormatted(message, spec + "lld", static_cast<long long>(reader.ReadU64()));
+            }
+            break;
+        case ArgumentType::Unsigned:
+            AppendFormatted(message, spec + "ll" + conversion.specifier,
+                            static_cast<unsigned long long>(reader.ReadU64()));
+            break;
+        case ArgumentType::Float: {
+            const u64 bits = reader.ReadU64();
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            AppendFormatted(message, spec + conversion.specifier, value);
+            break;
+        }
+        case ArgumentType::String:
+            AppendFormatted(message, spec + 's', reader.ReadString());
+            break;
+        case ArgumentType::Pointer:
+            AppendFormatted(message, spec + 'p',
+                            reinterpret_cast<void*>(static_cast<uintptr_t>(reader.ReadU64())));
+            break;
+        case ArgumentType::Unsupported:
+            // Not reached, these messages are formatted right away
+            break;
+        }
+    }
+
+    const size_t length = std::min(message.size(), text_len - 1);
+    std::memcpy(out_text, message.data(), length);
+    out_text[length] = '\0';
+}
+
+} // namespace Log
@@ -0,0 +1,26 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstdarg>
+#include <cstddef>
+#include "common/common_types.h"
+
+namespace Log {
+
+/**
+ * Copies the arguments of a printf-style format string into a buffer, so that the message can be
+ * formatted later on another thread. Numbers are stored as 64-bit values and strings are copied,
+ * as they may not outlive the call.
+ *
+ * @return false if the arguments don't fit the buffer, or the format string uses a conversion
+ *         that isn't supported, in which case the message has to be formatted right away
+ */
+bool EncodeFormatArguments(const char* format, va_list args, u8* buffer, size_t buffer_size);
+
+/// Formats a message from its format string and the arguments encoded by EncodeFormatArguments.
+void FormatEncodedArguments(const char* format, const u8* buffer, char* out_text, size_t text_len);
+
+} // namespace Log
@@ -55,6 +55,9 @@ enum class Class : ClassType {
     Service_CFG,       ///< The CFG (Configuration) service
     Service_DSP,       ///< The DSP (DSP control) service
     Service_HID,       ///< The HID (Human interface device) service
+    Service_Audio,     ///< The audio services (audout, audren)
+    Service_APM,       ///< The APM (Performance) service
+    Service_BSD,       ///< The BSD sockets service
     HW,                ///< Low-level hardware emulation
     HW_Memory,         ///< Memory-map and address translation
     HW_LCD,            ///< LCD register emulation
@@ -92,20 +95,51 @@ void LogMessage(Class log_class, Level log_level, const char* filename, unsigned
 #define LOG_GENERIC(log_class, log_level, ...)                                                     \
     ::Log::LogMessage(log_class, log_level, __FILE__, __LINE__, __func__, __VA_ARGS__)
 
+// Lowest level of the log calls that are compiled in, as the value of its Level. The calls below it
+// are removed along with the evaluation of their arguments.
+#ifndef LOG_MIN_LEVEL
 #ifdef _DEBUG
+#define LOG_MIN_LEVEL 0
+#else
+#define LOG_MIN_LEVEL 1
+#endif
+#endif
+
+#if LOG_MIN_LEVEL <= 0
 #define LOG_TRACE(log_class, ...)                                                                  \
     LOG_GENERIC(::Log::Class::log_class, ::Log::Level::Trace, __VA_ARGS__)
 #else
 #define LOG_TRACE(log_class, ...) (void(0))
 #endif
 
+#if LOG_MIN_LEVEL <= 1
 #define LOG_DEBUG(log_class, ...)                                                                  \
     LOG_GENERIC(::Log::Class::log_class, ::Log::Level::Debug, __VA_ARGS__)
+#else
+#define LOG_DEBUG(log_class, ...) (void(0))
+#endif
+
+#if LOG_MIN_LEVEL <= 2
 #define LOG_INFO(log_class, ...)                                                                   \
     LOG_GENERIC(::Log::Class::log_class, ::Log::Level::Info, __VA_ARGS__)
+#else
+#define LOG_INFO(log_class, ...) (void(0))
+#endif
+
+#if LOG_MIN_LEVEL <= 3
 #define LOG_WARNING(log_class, ...)                                                                \
     LOG_GENERIC(::Log::Class::log_class, ::Log::Level::Warning, __VA_ARGS__)
+#else
+#define LOG_WARNING(log_class, ...) (void(0))
+#endif
+
+#if LOG_MIN_LEVEL <= 4
 #define LOG_ERROR(log_class, ...)                                                                  \
     LOG_GENERIC(::Log::Class::log_class, ::Log::Level::Error, __VA_ARGS__)
+#else
+#define LOG_ERROR(log_class, ...) (void(0))
+#endif
+
+// Critical messages precede crashes, they are never removed
 #define LOG_CRITICAL(log_class, ...)                                                               \
     LOG_GENERIC(::Log::Class::log_class, ::Log::Level::Critical, __VA_ARGS__)
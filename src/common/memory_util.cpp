@@ -2,6 +2,7 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <cstdint>
 #include "common/logging/log.h"
 #include "common/memory_util.h"
 
@@ -89,6 +90,91 @@ void* AllocateMemoryPages(size_t size) {
     return ptr;
 }
 
+void* ReserveMemoryPages(size_t size) {
+#ifdef _WIN32
+    void* ptr = VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    void* ptr = mmap(nullptr, size, PROT_NONE, MAP_ANON | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+
+    if (ptr == MAP_FAILED)
+        ptr = nullptr;
+#endif
+
+    if (ptr == nullptr)
+        LOG_ERROR(Common_Memory, "Failed to reserve address space");
+
+    return ptr;
+}
+
+bool CommitMemoryPages(void* ptr, size_t size) {
+#ifdef _WIN32
+    if (VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) == nullptr) {
+        LOG_ERROR(Common_Memory, "CommitMemoryPages failed!\n%s", GetLastErrorMsg());
+        return false;
+    }
+#else
+    if (mprotect(ptr, size, PROT_READ | PROT_WRITE) != 0) {
+        LOG_ERROR(Common_Memory, "CommitMemoryPages failed!");
+        return false;
+    }
+#endif
+    return true;
+}
+
+void DecommitMemoryPages(void* ptr, size_t size) {
+#ifdef _WIN32
+    if (!VirtualFree(ptr, size, MEM_DECOMMIT))
+        LOG_ERROR(Common_Memory, "DecommitMemoryPages failed!\n%s", GetLastErrorMsg());
+#else
+    // Mapping over the range discards its contents and returns the pages to the host.
+    if (mmap(ptr, size, PROT_NONE, MAP_ANON | MAP_PRIVATE | MAP_NORESERVE | MAP_FIXED, -1, 0) ==
+        MAP_FAILED)
+        LOG_ERROR(Common_Memory, "DecommitMemoryPages failed!");
+#endif
+}
+
+size_t DiscardMemoryPages(void* ptr, size_t size) {
+    const uintptr_t mask = static_cast<uintptr_t>(GetPageSize()) - 1;
+    const uintptr_t begin = (reinterpret_cast<uintptr_t>(ptr) + mask) & ~mask;
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(ptr) + size) & ~mask;
+    if (begin >= end) {
+        return 0;
+    }
+#ifdef _WIN32
+    if (VirtualAlloc(reinterpret_cast<void*>(begin), end - begin, MEM_RESET, PAGE_READWRITE) ==
+        nullptr) {
+        LOG_ERROR(Common_Memory, "DiscardMemoryPages failed!\n%s", GetLastErrorMsg());
+        return 0;
+    }
+#else
+    if (madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED) != 0) {
+        LOG_ERROR(Common_Memory, "DiscardMemoryPages failed!");
+        return 0;
+    }
+#endif
+    return end - begin;
+}
+
+size_t AdviseHugePages(void* ptr, size_t size) {
+#ifdef MADV_HUGEPAGE
+    const uintptr_t mask = HUGE_PAGE_SIZE - 1;
+    const uintptr_t begin = (reinterpret_cast<uintptr_t>(ptr) + mask) & ~mask;
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(ptr) + size) & ~mask;
+    if (begin >= end) {
+        return 0;
+    }
+    if (madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE) != 0) {
+        LOG_WARNING(Common_Memory, "Transparent huge pages aren't available");
+        return 0;
+    }
+    return end - begin;
+#else
+    // Large pages on Windows can only be requested when allocating, with a privilege that
+    // applications don't get by default, so regular pages are used there.
+    return 0;
+#endif
+}
+
 void* AllocateAlignedMemory(size_t size, size_t alignment) {
 #ifdef _WIN32
     void* ptr = _aligned_malloc(size, alignment);
@@ -10,6 +10,35 @@
 void* AllocateExecutableMemory(size_t size, bool low = true);
 void* AllocateMemoryPages(size_t size);
 void FreeMemoryPages(void* ptr, size_t size);
+
+/**
+ * Reserves a range of host address space without backing it with memory. The range must be
+ * committed with CommitMemoryPages before being accessed, and released with FreeMemoryPages.
+ */
+void* ReserveMemoryPages(size_t size);
+/// Backs part of a reserved range with zero-filled, read-write memory.
+bool CommitMemoryPages(void* ptr, size_t size);
+/// Returns the memory backing part of a reserved range to the host, keeping the reservation.
+void DecommitMemoryPages(void* ptr, size_t size);
+/**
+ * Tells the host that the contents of a range of committed memory are no longer needed, so that it
+ * can take the pages back without writing them out. The range stays accessible, and its contents
+ * are undefined until they are written again. Only the host pages entirely within the range are
+ * discarded.
+ * @returns The number of bytes discarded.
+ */
+size_t DiscardMemoryPages(void* ptr, size_t size);
+
+/// Size of the huge pages used by AdviseHugePages
+constexpr size_t HUGE_PAGE_SIZE = 0x200000;
+/**
+ * Asks the host to back the huge page aligned part of a range of memory with huge pages whenever
+ * it can, which makes TLB misses rarer on large working sets. The memory doesn't have to be
+ * committed yet. The host silently falls back to regular pages when it runs out of huge pages.
+ * @returns The number of bytes of the range that may be backed by huge pages, 0 if unsupported.
+ */
+size_t AdviseHugePages(void* ptr, size_t size);
+
 void* AllocateAlignedMemory(size_t size, size_t alignment);
 void FreeAlignedMemory(void* ptr);
 void WriteProtectMemory(void* ptr, size_t size, bool executable = false);
@@ -5,3 +5,30 @@
 // Includes the MicroProfile implementation in this file for compilation
 #define MICROPROFILE_IMPL 1
 #include "common/microprofile.h"
+
+#if MICROPROFILE_ENABLED
+static std::atomic<const MicroProfileGpuTimers*> gpu_timers{nullptr};
+
+void MicroProfileSetGpuTimers(const MicroProfileGpuTimers* timers) {
+    gpu_timers.store(timers);
+}
+
+uint32_t MicroProfileGpuInsertTimeStamp() {
+    const MicroProfileGpuTimers* timers = gpu_timers.load(std::memory_order_relaxed);
+    return timers != nullptr ? timers->insert_time_stamp() : 0;
+}
+
+uint64_t MicroProfileGpuGetTimeStamp(uint32_t key) {
+    const MicroProfileGpuTimers* timers = gpu_timers.load(std::memory_order_relaxed);
+    return timers != nullptr ? timers->get_time_stamp(key) : 0;
+}
+
+uint64_t MicroProfileTicksPerSecondGpu() {
+    return 1000000000;
+}
+
+// Only used by the HTML dumps, which may run on a thread without the graphics context
+int MicroProfileGetGpuTickReference(int64_t* out_cpu, int64_t* out_gpu) {
+    return 0;
+}
+#endif
@@ -11,7 +11,7 @@
 // Customized Citra settings.
 // This file wraps the MicroProfile header so that these are consistent everywhere.
 #define MICROPROFILE_WEBSERVER 0
-#define MICROPROFILE_GPU_TIMERS 0 // TODO: Implement timer queries when we upgrade to OpenGL 3.3
+#define MICROPROFILE_GPU_TIMERS 1 // Implemented by the renderer, see MicroProfileSetGpuTimers
 #define MICROPROFILE_CONTEXT_SWITCH_TRACE 0
 #define MICROPROFILE_PER_THREAD_BUFFER_SIZE (2048 << 13) // 16 MB
 
@@ -24,6 +24,23 @@ typedef void* HANDLE;
 
 #define MP_RGB(r, g, b) ((r) << 16 | (g) << 8 | (b) << 0)
 
+#if MICROPROFILE_ENABLED
+/**
+ * Timestamp queries of the host GPU backing the GPU scopes. The renderer provides them, as the
+ * profiler doesn't know about the graphics API; until then the GPU scopes record nothing. Only the
+ * thread owning the graphics context may enter GPU scopes and call MicroProfileFlip.
+ */
+struct MicroProfileGpuTimers {
+    /// Queues a timestamp query and returns the key of its result
+    uint32_t (*insert_time_stamp)();
+    /// Gets the result of a query, in nanoseconds, waiting for the GPU if needed
+    uint64_t (*get_time_stamp)(uint32_t key);
+};
+
+/// Sets the timestamp queries of the GPU scopes, nullptr to stop recording them
+void MicroProfileSetGpuTimers(const MicroProfileGpuTimers* timers);
+#endif
+
 // On OS X, some Mach header included by MicroProfile defines these as macros, conflicting with
 // identifiers we use.
 #ifdef PAGE_SIZE
@@ -2,7 +2,8 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
-#include <array>
+#include <algorithm>
+#include <string_view>
 #include <vector>
 #include "common/logging/log.h"
 #include "common/param_package.h"
@@ -13,33 +14,90 @@ namespace Common {
 constexpr char KEY_VALUE_SEPARATOR = ':';
 constexpr char PARAM_SEPARATOR = ',';
 constexpr char ESCAPE_CHARACTER = '$';
-const std::string KEY_VALUE_SEPARATOR_ESCAPE{ESCAPE_CHARACTER, '0'};
-const std::string PARAM_SEPARATOR_ESCAPE{ESCAPE_CHARACTER, '1'};
-const std::string ESCAPE_CHARACTER_ESCAPE{ESCAPE_CHARACTER, '2'};
+constexpr char KEY_VALUE_SEPARATOR_ESCAPE = '0';
+constexpr char PARAM_SEPARATOR_ESCAPE = '1';
+constexpr char ESCAPE_CHARACTER_ESCAPE = '2';
 
-ParamPackage::ParamPackage(const std::string& serialized) {
-    std::vector<std::string> pairs;
-    Common::SplitString(serialized, PARAM_SEPARATOR, pairs);
-
-    for (const std::string& pair : pairs) {
-        std::vector<std::string> key_value;
-        Common::SplitString(pair, KEY_VALUE_SEPARATOR, key_value);
-        if (key_value.size() != 2) {
-            LOG_ERROR(Common, "invalid key pair %s", pair.c_str());
-            continue;
+/// Replaces the escape sequences of a serialized key or value with the characters they stand for
+static std::string Unescape(std::string_view part) {
+    std::string result;
+    result.reserve(part.size());
+    for (size_t i = 0; i < part.size(); ++i) {
+        if (part[i] == ESCAPE_CHARACTER && i + 1 < part.size()) {
+            switch (part[i + 1]) {
+            case KEY_VALUE_SEPARATOR_ESCAPE:
+                result += KEY_VALUE_SEPARATOR;
+                ++i;
+                continue;
+            case PARAM_SEPARATOR_ESCAPE:
+                result += PARAM_SEPARATOR;
+                ++i;
+                continue;
+            case ESCAPE_CHARACTER_ESCAPE:
+                result += ESCAPE_CHARACTER;
+                ++i;
+                continue;
+            }
+        }
+        result += part[i];
+    }
+    return result;
+}
+
+/// Appends a key or value to a serialized package, escaping the characters the format reserves
+static void AppendEscaped(std::string& result, const std::string& part) {
+    for (const char c : part) {
+        switch (c) {
+        case KEY_VALUE_SEPARATOR:
+            result += ESCAPE_CHARACTER;
+            result += KEY_VALUE_SEPARATOR_ESCAPE;
+            break;
+        case PARAM_SEPARATOR:
+            result += ESCAPE_CHARACTER;
+            result += PARAM_SEPARATOR_ESCAPE;
+            break;
+        case ESCAPE_CHARACTER:
+            result += ESCAPE_CHARACTER;
+            result += ESCAPE_CHARACTER_ESCAPE;
+            break;
+        default:
+            result += c;
+            break;
         }
+    }
+}
 
-        for (std::string& part : key_value) {
-            part = Common::ReplaceAll(part, KEY_VALUE_SEPARATOR_ESCAPE, {KEY_VALUE_SEPARATOR});
-            part = Common::ReplaceAll(part, PARAM_SEPARATOR_ESCAPE, {PARAM_SEPARATOR});
-            part = Common::ReplaceAll(part, ESCAPE_CHARACTER_ESCAPE, {ESCAPE_CHARACTER});
+static bool KeyLess(const ParamPackage::DataType::value_type& entry, const std::string& key) {
+    return entry.first < key;
+}
+
+ParamPackage::ParamPackage(const std::string& serialized) {
+    // The pairs are views into the string, only the keys and values themselves are copied
+    std::vector<std::string_view> pairs;
+    Common::SplitString(std::string_view(serialized), PARAM_SEPARATOR, pairs);
+    data.reserve(pairs.size());
+
+    for (const std::string_view pair : pairs) {
+        // The separators inside keys and values are escaped, so a valid pair has exactly one
+        const size_t separator = pair.find(KEY_VALUE_SEPARATOR);
+        if (separator == std::string_view::npos ||
+            pair.find(KEY_VALUE_SEPARATOR, separator + 1) != std::string_view::npos) {
+            LOG_ERROR(Common, "invalid key pair %s", std::string(pair).c_str());
+            continue;
         }
 
-        Set(key_value[0], key_value[1]);
+        Set(Unescape(pair.substr(0, separator)), Unescape(pair.substr(separator + 1)));
     }
 }
 
-ParamPackage::ParamPackage(std::initializer_list<DataType::value_type> list) : data(list) {}
+ParamPackage::ParamPackage(std::initializer_list<DataType::value_type> list) : data(list) {
+    // Like a map built from the list, the first of duplicated keys is kept
+    std::stable_sort(data.begin(), data.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    data.erase(std::unique(data.begin(), data.end(),
+                           [](const auto& a, const auto& b) { return a.first == b.first; }),
+               data.end());
+}
 
 std::string ParamPackage::Serialize() const {
     if (data.empty())
@@ -48,21 +106,26 @@ std::string ParamPackage::Serialize() const {
     std::string result;
 
     for (const auto& pair : data) {
-        std::array<std::string, 2> key_value{{pair.first, pair.second}};
-        for (std::string& part : key_value) {
-            part = Common::ReplaceAll(part, {ESCAPE_CHARACTER}, ESCAPE_CHARACTER_ESCAPE);
-            part = Common::ReplaceAll(part, {PARAM_SEPARATOR}, PARAM_SEPARATOR_ESCAPE);
-            part = Common::ReplaceAll(part, {KEY_VALUE_SEPARATOR}, KEY_VALUE_SEPARATOR_ESCAPE);
-        }
-        result += key_value[0] + KEY_VALUE_SEPARATOR + key_value[1] + PARAM_SEPARATOR;
+        AppendEscaped(result, pair.first);
+        result += KEY_VALUE_SEPARATOR;
+        AppendEscaped(result, pair.second);
+        result += PARAM_SEPARATOR;
     }
 
     result.pop_back(); // discard the trailing PARAM_SEPARATOR
     return result;
 }
 
+ParamPackage::DataType::const_iterator ParamPackage::Find(const std::string& key) const {
+    const auto pair = std::lower_bound(data.begin(), data.end(), key, KeyLess);
+    if (pair == data.end() || pair->first != key) {
+        return data.end();
+    }
+    return pair;
+}
+
 std::string ParamPackage::Get(const std::string& key, const std::string& default_value) const {
-    auto pair = data.find(key);
+    auto pair = Find(key);
     if (pair == data.end()) {
         LOG_DEBUG(Common, "key %s not found", key.c_str());
         return default_value;
@@ -72,7 +135,7 @@ std::string ParamPackage::Get(const std::string& key, const std::string& default
 }
 
 int ParamPackage::Get(const std::string& key, int default_value) const {
-    auto pair = data.find(key);
+    auto pair = Find(key);
     if (pair == data.end()) {
         LOG_DEBUG(Common, "key %s not found", key.c_str());
         return default_value;
@@ -87,7 +150,7 @@ int ParamPackage::Get(const std::string& key, int default_value) const {
 }
 
 float ParamPackage::Get(const std::string& key, float default_value) const {
-    auto pair = data.find(key);
+    auto pair = Find(key);
     if (pair == data.end()) {
         LOG_DEBUG(Common, "key %s not found", key.c_str());
         return default_value;
@@ -102,19 +165,24 @@ float ParamPackage::Get(const std::string& key, float default_value) const {
 }
 
 void ParamPackage::Set(const std::string& key, const std::string& value) {
-    data[key] = value;
+    auto pair = std::lower_bound(data.begin(), data.end(), key, KeyLess);
+    if (pair != data.end() && pair->first == key) {
+        pair->second = value;
+    } else {
+        data.emplace(pair, key, value);
+    }
 }
 
 void ParamPackage::Set(const std::string& key, int value) {
-    data[key] = std::to_string(value);
+    Set(key, std::to_string(value));
 }
 
 void ParamPackage::Set(const std::string& key, float value) {
-    data[key] = std::to_string(value);
+    Set(key, std::to_string(value));
 }
 
 bool ParamPackage::Has(const std::string& key) const {
-    return data.find(key) != data.end();
+    return Find(key) != data.end();
 }
 
 } // namespace Common
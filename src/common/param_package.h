@@ -6,14 +6,19 @@
 
 #include <initializer_list>
 #include <string>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace Common {
 
 /// A string-based key-value container supporting serializing to and deserializing from a string
 class ParamPackage {
 public:
-    using DataType = std::unordered_map<std::string, std::string>;
+    /**
+     * The parameters sorted by key. Packages hold a handful of short parameters, which a sorted
+     * vector stores in a single allocation and searches faster than a hash map.
+     */
+    using DataType = std::vector<std::pair<std::string, std::string>>;
 
     ParamPackage() = default;
     explicit ParamPackage(const std::string& serialized);
@@ -24,6 +29,7 @@ public:
     ParamPackage& operator=(const ParamPackage& other) = default;
     ParamPackage& operator=(ParamPackage&& other) = default;
 
+    /// Serializes the parameters in the order of their keys, so equal packages serialize equally
     std::string Serialize() const;
     std::string Get(const std::string& key, const std::string& default_value) const;
     int Get(const std::string& key, int default_value) const;
@@ -34,6 +40,8 @@ public:
     bool Has(const std::string& key) const;
 
 private:
+    DataType::const_iterator Find(const std::string& key) const;
+
     DataType data;
 };
 
@@ -0,0 +1,54 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+#include "common/common_types.h"
+
+namespace Common {
+
+/**
+ * A value published by a single writer thread and read by any number of threads without locking.
+ * The sequence number is odd while a write is in progress; readers copy the value and retry if
+ * the sequence number was odd or changed meanwhile.
+ */
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+public:
+    SeqLock() = default;
+    explicit SeqLock(const T& value) : value(value) {}
+
+    /// Publishes a new value, only one thread may write at a time
+    void Write(const T& new_value) {
+        const u32 current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&value, &new_value, sizeof(T));
+        sequence.store(current + 2, std::memory_order_release);
+    }
+
+    /// Gets the latest value that was completely written
+    T Read() const {
+        T result;
+        u32 before, after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            std::memcpy(&result, &value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+        return result;
+    }
+
+private:
+    std::atomic<u32> sequence{0};
+    T value{};
+};
+
+} // namespace Common
@@ -0,0 +1,359 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <lz4.h>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "common/state_stream.h"
+
+namespace Common {
+
+using namespace StateFormat;
+
+/// Compresses a block, returns an empty buffer if that doesn't make it any smaller
+static std::vector<u8> CompressLZ4(const u8* data, size_t size) {
+    std::vector<u8> compressed(LZ4_compressBound(static_cast<int>(size)));
+    const int compressed_size = LZ4_compress_default(
+        reinterpret_cast<const char*>(data), reinterpret_cast<char*>(compressed.data()),
+        static_cast<int>(size), static_cast<int>(compressed.size()));
+    if (compressed_size <= 0 || static_cast<size_t>(compressed_size) >= size) {
+        return {};
+    }
+    compressed.resize(compressed_size);
+    return compressed;
+}
+
+StateWriter::StateWriter(ThreadPool& pool) : pool(pool) {}
+
+StateWriter::~StateWriter() {
+    if (file.IsOpen()) {
+        Close();
+    }
+}
+
+bool StateWriter::Open(const std::string& filename) {
+    in_section = false;
+    if (!file.Open(filename, "wb")) {
+        LOG_ERROR(Common, "Failed to create the state file %s", filename.c_str());
+        return false;
+    }
+    file.WriteObject(FileHeader{FILE_MAGIC, FILE_VERSION});
+    return file.IsGood();
+}
+
+void StateWriter::BeginSection(const std::string& name, u32 version,
+                               StateCompression compression) {
+    ASSERT_MSG(!in_section, "Section %s started inside another one", name.c_str());
+    ASSERT_MSG(name.size() <= MAX_NAME_LENGTH, "Section name %s is too long", name.c_str());
+    ASSERT(version != 0);
+
+    section_header = {};
+    std::copy(name.begin(), name.end(), section_header.name.begin());
+    section_header.version = version;
+    section_header.compression = static_cast<u32>(compression);
+
+    // The header is written again once the size of the section is known
+    section_header_offset = file.Tell();
+    file.WriteObject(section_header);
+    buffer.clear();
+    in_section = true;
+}
+
+bool StateWriter::EndSection() {
+    ASSERT(in_section);
+    SubmitBuffer();
+    while (!pending_blocks.empty()) {
+        WriteOldestBlock();
+    }
+
+    file.Seek(section_header_offset, SEEK_SET);
+    file.WriteObject(section_header);
+    file.Seek(0, SEEK_END);
+    in_section = false;
+    return file.IsGood();
+}
+
+void StateWriter::Write(const void* data, size_t size) {
+    ASSERT(in_section);
+    const u8* bytes = static_cast<const u8*>(data);
+    while (size != 0) {
+        if (buffer.empty()) {
+            buffer.reserve(BLOCK_SIZE);
+        }
+        const size_t copy_size = std::min(size, BLOCK_SIZE - buffer.size());
+        buffer.insert(buffer.end(), bytes, bytes + copy_size);
+        bytes += copy_size;
+        size -= copy_size;
+        if (buffer.size() == BLOCK_SIZE) {
+            SubmitBuffer();
+        }
+    }
+}
+
+bool StateWriter::WriteSection(const std::string& name, u32 version, const void* data, size_t size,
+                               StateCompression compression) {
+    BeginSection(name, version, compression);
+    // The blocks are compressed straight from the buffer, which outlives them
+    const u8* bytes = static_cast<const u8*>(data);
+    for (size_t offset = 0; offset < size; offset += BLOCK_SIZE) {
+        PendingBlock block;
+        block.data = bytes + offset;
+        block.size = std::min(BLOCK_SIZE, size - offset);
+        SubmitBlock(std::move(block));
+    }
+    return EndSection();
+}
+
+bool StateWriter::Close() {
+    if (in_section) {
+        EndSection();
+    }
+    const bool good = file.IsGood();
+    return file.Close() && good;
+}
+
+void StateWriter::SubmitBuffer() {
+    if (buffer.empty()) {
+        return;
+    }
+
+    PendingBlock block;
+    block.buffer = std::move(buffer);
+    block.data = block.buffer.data();
+    block.size = block.buffer.size();
+    buffer = {};
+    SubmitBlock(std::move(block));
+}
+
+void StateWriter::SubmitBlock(PendingBlock block) {
+    section_header.size += block.size;
+    if (static_cast<StateCompression>(static_cast<u32>(section_header.compression)) ==
+        StateCompression::LZ4) {
+        // Moving the block keeps its buffer where it is
+        block.compressed = pool.Submit(
+            [data = block.data, size = block.size] { return CompressLZ4(data, size); },
+            TaskPriority::Low);
+    }
+    pending_blocks.push_back(std::move(block));
+
+    // Bounds the memory taken by the buffered blocks, while keeping every worker busy
+    while (pending_blocks.size() > 2 * pool.GetNumWorkers()) {
+        WriteOldestBlock();
+    }
+}
+
+void StateWriter::WriteOldestBlock() {
+    PendingBlock& block = pending_blocks.front();
+    std::vector<u8> compressed;
+    if (block.compressed.valid()) {
+        compressed = block.compressed.get();
+    }
+
+    const u8* stored = compressed.empty() ? block.data : compressed.data();
+    const size_t stored_size = compressed.empty() ? block.size : compressed.size();
+    file.WriteObject(
+        BlockHeader{static_cast<u32>(stored_size), static_cast<u32>(block.size)});
+    file.WriteBytes(stored, stored_size);
+    section_header.stored_size += sizeof(BlockHeader) + stored_size;
+    pending_blocks.pop_front();
+}
+
+StateReader::StateReader(ThreadPool& pool) : pool(pool) {}
+
+bool StateReader::Open(const std::string& filename) {
+    sections.clear();
+    remaining_size = 0;
+    if (!file.Open(filename)) {
+        LOG_ERROR(Common, "Failed to map the state file %s", filename.c_str());
+        return false;
+    }
+
+    FileHeader file_header{};
+    if (file.Size() < sizeof(file_header)) {
+        LOG_ERROR(Common, "%s is not a state file", filename.c_str());
+        return false;
+    }
+    std::memcpy(&file_header, file.Data(), sizeof(file_header));
+    if (file_header.magic != FILE_MAGIC || file_header.version != FILE_VERSION) {
+        LOG_ERROR(Common, "%s is not a state file of a supported version", filename.c_str());
+        return false;
+    }
+
+    // Only the section headers are read, the blocks are paged in when a section is read
+    u64 offset = sizeof(file_header);
+    while (offset != file.Size()) {
+        Section section;
+        if (file.Size() - offset < sizeof(section.header)) {
+            LOG_ERROR(Common, "State file %s is truncated", filename.c_str());
+            return false;
+        }
+        std::memcpy(&section.header, file.Data() + offset, sizeof(section.header));
+        section.offset = offset + sizeof(section.header);
+        if (section.header.stored_size > file.Size() - section.offset) {
+            LOG_ERROR(Common, "State file %s is truncated", filename.c_str());
+            return false;
+        }
+
+        const char* name = section.header.name.data();
+        sections[std::string(name, strnlen(name, MAX_NAME_LENGTH))] = section;
+        offset = section.offset + section.header.stored_size;
+    }
+    return true;
+}
+
+const StateReader::Section* StateReader::FindSection(const std::string& name, u32 min_version,
+                                                     u32 max_version) const {
+    auto itr = sections.find(name);
+    if (itr == sections.end()) {
+        return nullptr;
+    }
+
+    const u32 version = itr->second.header.version;
+    if (version < min_version || version > max_version) {
+        LOG_ERROR(Common, "Unsupported version %u of state section %s", version, name.c_str());
+        return nullptr;
+    }
+    return &itr->second;
+}
+
+u32 StateReader::BeginSection(const std::string& name, u32 min_version, u32 max_version) {
+    block = nullptr;
+    block_size = 0;
+    block_offset = 0;
+    remaining_size = 0;
+
+    const Section* section = FindSection(name, min_version, max_version);
+    if (section == nullptr) {
+        return 0;
+    }
+
+    compression = static_cast<StateCompression>(static_cast<u32>(section->header.compression));
+    next_block_offset = section->offset;
+    blocks_end = section->offset + section->header.stored_size;
+    remaining_size = section->header.size;
+    return section->header.version;
+}
+
+bool StateReader::Read(void* data, size_t size) {
+    if (size > remaining_size) {
+        return false;
+    }
+
+    u8* bytes = static_cast<u8*>(data);
+    while (size != 0) {
+        if (block_offset == block_size && !LoadNextBlock()) {
+            remaining_size = 0;
+            return false;
+        }
+        const size_t copy_size = std::min(size, block_size - block_offset);
+        std::memcpy(bytes, block + block_offset, copy_size);
+        block_offset += copy_size;
+        remaining_size -= copy_size;
+        bytes += copy_size;
+        size -= copy_size;
+    }
+    return true;
+}
+
+u64 StateReader::GetSectionSize(const std::string& name) const {
+    auto itr = sections.find(name);
+    return itr != sections.end() ? static_cast<u64>(itr->second.header.size) : 0;
+}
+
+u32 StateReader::ReadSection(const std::string& name, u32 min_version, u32 max_version,
+                             void* data, size_t size) {
+    const Section* section = FindSection(name, min_version, max_version);
+    if (section == nullptr || section->header.size != size) {
+        return 0;
+    }
+
+    const auto section_compression =
+        static_cast<StateCompression>(static_cast<u32>(section->header.compression));
+    u8* bytes = static_cast<u8*>(data);
+    std::vector<std::future<bool>> results;
+    u64 offset = section->offset;
+    const u64 end = section->offset + section->header.stored_size;
+    size_t data_offset = 0;
+    while (offset != end) {
+        BlockHeader header{};
+        if (end - offset < sizeof(header)) {
+            break;
+        }
+        std::memcpy(&header, file.Data() + offset, sizeof(header));
+        offset += sizeof(header);
+        if (header.stored_size > end - offset || header.size > size - data_offset) {
+            break;
+        }
+
+        results.push_back(pool.Submit(
+            [section_compression, header, stored = file.Data() + offset,
+             dest = bytes + data_offset] {
+                return DecodeBlock(section_compression, header, stored, dest);
+            },
+            TaskPriority::High));
+        offset += header.stored_size;
+        data_offset += header.size;
+    }
+
+    // Every task is waited for, as they write to the buffer
+    bool good = offset == end && data_offset == size;
+    for (auto& result : results) {
+        good &= result.get();
+    }
+    if (!good) {
+        LOG_ERROR(Common, "State section %s is corrupted", name.c_str());
+        return 0;
+    }
+    return section->header.version;
+}
+
+bool StateReader::DecodeBlock(StateCompression compression, const BlockHeader& header,
+                              const u8* stored, u8* data) {
+    if (header.stored_size == header.size) {
+        std::memcpy(data, stored, header.size);
+        return true;
+    }
+    if (compression != StateCompression::LZ4) {
+        return false;
+    }
+    const int size = LZ4_decompress_safe(reinterpret_cast<const char*>(stored),
+                                         reinterpret_cast<char*>(data),
+                                         static_cast<int>(header.stored_size),
+                                         static_cast<int>(header.size));
+    return size >= 0 && static_cast<u32>(size) == header.size;
+}
+
+bool StateReader::LoadNextBlock() {
+    BlockHeader header{};
+    if (blocks_end - next_block_offset < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, file.Data() + next_block_offset, sizeof(header));
+    const u64 stored_offset = next_block_offset + sizeof(header);
+    if (header.stored_size > blocks_end - stored_offset || header.size > BLOCK_SIZE ||
+        header.size == 0) {
+        return false;
+    }
+
+    const u8* stored = file.Data() + stored_offset;
+    if (header.stored_size == header.size) {
+        // Uncompressed blocks are read straight from the mapping
+        block = stored;
+    } else {
+        decompressed_block.resize(header.size);
+        if (!DecodeBlock(compression, header, stored, decompressed_block.data())) {
+            return false;
+        }
+        block = decompressed_block.data();
+    }
+    block_size = header.size;
+    block_offset = 0;
+    next_block_offset = stored_offset + header.stored_size;
+    return true;
+}
+
+} // namespace Common
@@ -0,0 +1,244 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "common/common_types.h"
+#include "common/file_util.h"
+#include "common/swap.h"
+#include "common/thread_pool.h"
+
+/**
+ * Streaming serialization of emulator state into files of versioned sections, for save states and
+ * boot snapshots. Unlike PointerWrap (see chunk_file.h), which serializes into a single buffer,
+ * the writer streams each section to the file as it is written, a block at a time, and the
+ * reader maps the file instead of reading it whole.
+ *
+ * The file is a FileHeader followed by the sections, each a SectionHeader followed by its blocks.
+ * A block is a BlockHeader followed by up to BLOCK_SIZE bytes of the section, compressed on their
+ * own so that the blocks of a large section, such as the guest RAM, are compressed and
+ * decompressed in parallel on the thread pool. Blocks compression doesn't shrink are stored as is.
+ */
+namespace Common {
+
+enum class StateCompression : u32 {
+    None = 0,
+    LZ4 = 1,
+};
+
+namespace StateFormat {
+
+constexpr u32 FILE_MAGIC = 0x41545359; // "YSTA"
+constexpr u32 FILE_VERSION = 1;
+/// Size of the blocks the sections are split in, before compression
+constexpr size_t BLOCK_SIZE = 0x400000;
+constexpr size_t MAX_NAME_LENGTH = 32;
+
+struct FileHeader {
+    u32_le magic;
+    u32_le version;
+};
+static_assert(sizeof(FileHeader) == 8, "FileHeader has incorrect size");
+
+struct SectionHeader {
+    std::array<char, MAX_NAME_LENGTH> name;
+    u32_le version;
+    u32_le compression;
+    /// Size of the section before compression
+    u64_le size;
+    /// Size of the blocks following the header, along with their headers
+    u64_le stored_size;
+};
+static_assert(sizeof(SectionHeader) == 56, "SectionHeader has incorrect size");
+
+struct BlockHeader {
+    /// Size of the block in the file, equal to size if it is stored uncompressed
+    u32_le stored_size;
+    u32_le size;
+};
+static_assert(sizeof(BlockHeader) == 8, "BlockHeader has incorrect size");
+
+} // namespace StateFormat
+
+/**
+ * Writes a state file, one section at a time. It waits for the tasks it submits to the pool, so it
+ * must not be used from a task of the same pool.
+ */
+class StateWriter {
+public:
+    explicit StateWriter(ThreadPool& pool = ThreadPool::GetInstance());
+    /// Closes the file if it is still open
+    ~StateWriter();
+
+    StateWriter(const StateWriter&) = delete;
+    StateWriter& operator=(const StateWriter&) = delete;
+
+    /// Creates a state file, replacing its contents
+    bool Open(const std::string& filename);
+
+    /**
+     * Starts a section, which the following writes go to until EndSection.
+     * @param name Name of the section, at most MAX_NAME_LENGTH characters, unique in the file.
+     * @param version Version of the contents of the section, at least 1.
+     */
+    void BeginSection(const std::string& name, u32 version,
+                      StateCompression compression = StateCompression::LZ4);
+
+    /// Writes the data buffered so far and the header of the current section
+    bool EndSection();
+
+    void Write(const void* data, size_t size);
+
+    template <typename T>
+    void Write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivial types can be written");
+        Write(&value, sizeof(T));
+    }
+
+    template <typename T>
+    void Write(const std::vector<T>& values) {
+        Write(static_cast<u64>(values.size()));
+        Write(values.data(), values.size() * sizeof(T));
+    }
+
+    void Write(const std::string& value) {
+        Write(static_cast<u64>(value.size()));
+        Write(value.data(), value.size());
+    }
+
+    /// Writes a whole section from a single buffer, such as the guest RAM
+    bool WriteSection(const std::string& name, u32 version, const void* data, size_t size,
+                      StateCompression compression = StateCompression::LZ4);
+
+    /// Finishes the current section and closes the file
+    bool Close();
+
+private:
+    struct PendingBlock {
+        /// Buffered data the block owns, empty if it points into the caller's buffer
+        std::vector<u8> buffer;
+        const u8* data;
+        size_t size;
+        /// Compressed contents, empty if compression didn't shrink the block
+        std::future<std::vector<u8>> compressed;
+    };
+
+    /// Sends the buffered data of the current section off to be compressed
+    void SubmitBuffer();
+    /// Sends a block off to be compressed, keeping at most a few blocks per worker in flight
+    void SubmitBlock(PendingBlock block);
+    /// Writes the oldest block submitted, waiting for its compression to finish
+    void WriteOldestBlock();
+
+    ThreadPool& pool;
+    FileUtil::IOFile file;
+
+    bool in_section = false;
+    StateFormat::SectionHeader section_header{};
+    u64 section_header_offset = 0;
+    std::vector<u8> buffer;
+    /// Blocks submitted to the pool, oldest first, written to the file in order
+    std::deque<PendingBlock> pending_blocks;
+};
+
+/**
+ * Reads the sections of a state file, which is mapped rather than read whole. Like the writer, it
+ * must not be used from a task of the pool it decompresses on.
+ */
+class StateReader {
+public:
+    explicit StateReader(ThreadPool& pool = ThreadPool::GetInstance());
+
+    StateReader(const StateReader&) = delete;
+    StateReader& operator=(const StateReader&) = delete;
+
+    /// Maps a state file and finds its sections
+    bool Open(const std::string& filename);
+
+    /**
+     * Starts reading a section. Reads that run past its end fail.
+     * @param min_version Oldest version of the section that can still be read.
+     * @param max_version Newest version of the section that can be read.
+     * @returns The version of the section, 0 if it is missing or has an unsupported version.
+     */
+    u32 BeginSection(const std::string& name, u32 min_version, u32 max_version);
+
+    bool Read(void* data, size_t size);
+
+    template <typename T>
+    bool Read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivial types can be read");
+        return Read(&value, sizeof(T));
+    }
+
+    template <typename T>
+    bool Read(std::vector<T>& values) {
+        u64 count = 0;
+        if (!Read(count) || count > remaining_size / sizeof(T)) {
+            return false;
+        }
+        values.resize(static_cast<size_t>(count));
+        return Read(values.data(), values.size() * sizeof(T));
+    }
+
+    bool Read(std::string& value) {
+        u64 size = 0;
+        if (!Read(size) || size > remaining_size) {
+            return false;
+        }
+        value.resize(static_cast<size_t>(size));
+        return Read(&value[0], value.size());
+    }
+
+    /// Returns the size of a section before compression, 0 if it is missing
+    u64 GetSectionSize(const std::string& name) const;
+
+    /**
+     * Reads a whole section into a single buffer, decompressing its blocks in parallel.
+     * @param size Size of the buffer, which must be the size of the section.
+     * @returns The version of the section, 0 if it is missing, has an unsupported version or
+     *          is corrupted.
+     */
+    u32 ReadSection(const std::string& name, u32 min_version, u32 max_version, void* data,
+                    size_t size);
+
+private:
+    struct Section {
+        StateFormat::SectionHeader header;
+        /// Offset of the first block in the file
+        u64 offset;
+    };
+
+    const Section* FindSection(const std::string& name, u32 min_version, u32 max_version) const;
+    /// Decompresses a block to a buffer of its size, returns false if it is corrupted
+    static bool DecodeBlock(StateCompression compression, const StateFormat::BlockHeader& header,
+                            const u8* stored, u8* data);
+    /// Moves on to the next block of the current section
+    bool LoadNextBlock();
+
+    ThreadPool& pool;
+    FileUtil::MappedFile file;
+    std::unordered_map<std::string, Section> sections;
+
+    // Section being read with Read
+    StateCompression compression = StateCompression::None;
+    u64 next_block_offset = 0;
+    u64 blocks_end = 0;
+    u64 remaining_size = 0;
+    /// Current block, pointing into the mapping if it is stored uncompressed
+    const u8* block = nullptr;
+    size_t block_size = 0;
+    size_t block_offset = 0;
+    std::vector<u8> decompressed_block;
+};
+
+} // namespace Common
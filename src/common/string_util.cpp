@@ -2,6 +2,7 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <cctype>
 #include <cerrno>
 #include <cstdio>
@@ -20,6 +21,10 @@
 #include <iconv.h>
 #endif
 
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+
 namespace Common {
 
 /// Make a string lowercase
@@ -135,13 +140,17 @@ std::string ArrayToString(const u8* data, size_t size, int line_len, bool spaces
 }
 
 // Turns "  hej " into "hej". Also handles tabs.
-std::string StripSpaces(const std::string& str) {
+std::string_view TrimSpaces(std::string_view str) {
     const size_t s = str.find_first_not_of(" \t\r\n");
 
     if (str.npos != s)
         return str.substr(s, str.find_last_not_of(" \t\r\n") - s + 1);
     else
-        return "";
+        return {};
+}
+
+std::string StripSpaces(const std::string& str) {
+    return std::string(TrimSpaces(str));
 }
 
 // "\"hello\"" is turned to "hello"
@@ -236,14 +245,25 @@ void BuildCompleteFilename(std::string& _CompleteFilename, const std::string& _P
     _CompleteFilename += _Filename;
 }
 
-void SplitString(const std::string& str, const char delim, std::vector<std::string>& output) {
-    std::istringstream iss(str);
-    output.resize(1);
+template <typename T>
+static void SplitStringInto(std::string_view str, const char delim, std::vector<T>& output) {
+    output.clear();
+
+    // A delimiter at the end doesn't start another field
+    size_t start = 0;
+    while (start < str.size()) {
+        const size_t end = std::min(str.find(delim, start), str.size());
+        output.emplace_back(str.substr(start, end - start));
+        start = end + 1;
+    }
+}
 
-    while (std::getline(iss, *output.rbegin(), delim))
-        output.push_back("");
+void SplitString(const std::string& str, const char delim, std::vector<std::string>& output) {
+    SplitStringInto(str, delim, output);
+}
 
-    output.pop_back();
+void SplitString(std::string_view str, const char delim, std::vector<std::string_view>& output) {
+    SplitStringInto(str, delim, output);
 }
 
 std::string TabsToSpaces(int tab_size, const std::string& in) {
@@ -271,32 +291,180 @@ std::string ReplaceAll(std::string result, const std::string& src, const std::st
     return result;
 }
 
-#ifdef _WIN32
+constexpr char16_t REPLACEMENT_CHARACTER = 0xFFFD;
 
-std::string UTF16ToUTF8(const std::u16string& input) {
-#if _MSC_VER >= 1900
-    // Workaround for missing char16_t/char32_t instantiations in MSVC2015
-    std::wstring_convert<std::codecvt_utf8_utf16<__int16>, __int16> convert;
-    std::basic_string<__int16> tmp_buffer(input.cbegin(), input.cend());
-    return convert.to_bytes(tmp_buffer);
-#else
-    std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> convert;
-    return convert.to_bytes(input);
+/// Widens the leading ASCII characters of a UTF-8 string, returns how many there were
+static size_t WidenAscii(const char* input, size_t size, char16_t* output) {
+    size_t i = 0;
+#ifdef ARCHITECTURE_x86_64
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= size; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        if (_mm_movemask_epi8(bytes) != 0) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_unpacklo_epi8(bytes, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i + 8),
+                         _mm_unpackhi_epi8(bytes, zero));
+    }
 #endif
+    for (; i < size && static_cast<u8>(input[i]) < 0x80; ++i) {
+        output[i] = input[i];
+    }
+    return i;
 }
 
-std::u16string UTF8ToUTF16(const std::string& input) {
-#if _MSC_VER >= 1900
-    // Workaround for missing char16_t/char32_t instantiations in MSVC2015
-    std::wstring_convert<std::codecvt_utf8_utf16<__int16>, __int16> convert;
-    auto tmp_buffer = convert.from_bytes(input);
-    return std::u16string(tmp_buffer.cbegin(), tmp_buffer.cend());
-#else
-    std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> convert;
-    return convert.from_bytes(input);
+/// Narrows the leading ASCII characters of a UTF-16 string, returns how many there were
+static size_t NarrowAscii(const char16_t* input, size_t size, char* output) {
+    size_t i = 0;
+#ifdef ARCHITECTURE_x86_64
+    const __m128i non_ascii_mask = _mm_set1_epi16(static_cast<short>(0xFF80));
+    for (; i + 16 <= size; i += 16) {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 8));
+        const __m128i non_ascii = _mm_and_si128(_mm_or_si128(low, high), non_ascii_mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(non_ascii, _mm_setzero_si128())) != 0xFFFF) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(low, high));
+    }
 #endif
+    for (; i < size && input[i] < 0x80; ++i) {
+        output[i] = static_cast<char>(input[i]);
+    }
+    return i;
+}
+
+/**
+ * Decodes the UTF-8 sequence at the start of the input.
+ * @param length Set to the number of bytes used, one for an invalid sequence.
+ * @returns The code point, or REPLACEMENT_CHARACTER for an invalid sequence.
+ */
+static char32_t DecodeUTF8(const u8* input, size_t size, size_t& length) {
+    length = 1;
+    const u8 lead = input[0];
+    size_t count;
+    char32_t code_point;
+    char32_t min_code_point;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        count = 2;
+        code_point = lead & 0x1F;
+        min_code_point = 0x80;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        count = 3;
+        code_point = lead & 0x0F;
+        min_code_point = 0x800;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        count = 4;
+        code_point = lead & 0x07;
+        min_code_point = 0x10000;
+    } else {
+        return REPLACEMENT_CHARACTER;
+    }
+    if (count > size) {
+        return REPLACEMENT_CHARACTER;
+    }
+    for (size_t i = 1; i < count; ++i) {
+        if ((input[i] & 0xC0) != 0x80) {
+            return REPLACEMENT_CHARACTER;
+        }
+        code_point = (code_point << 6) | (input[i] & 0x3F);
+    }
+    // Overlong encodings, surrogates and code points past the last plane are invalid
+    if (code_point < min_code_point || (code_point >= 0xD800 && code_point <= 0xDFFF) ||
+        code_point > 0x10FFFF) {
+        return REPLACEMENT_CHARACTER;
+    }
+    length = count;
+    return code_point;
+}
+
+void UTF8ToUTF16(std::string_view input, std::u16string& output) {
+    // A UTF-8 string never has fewer code units than its UTF-16 form
+    output.resize(input.size());
+    char16_t* const out = &output[0];
+    const u8* const in = reinterpret_cast<const u8*>(input.data());
+
+    size_t in_pos = 0;
+    size_t out_pos = 0;
+    while (in_pos < input.size()) {
+        const size_t ascii_length =
+            WidenAscii(input.data() + in_pos, input.size() - in_pos, out + out_pos);
+        in_pos += ascii_length;
+        out_pos += ascii_length;
+        if (in_pos == input.size()) {
+            break;
+        }
+
+        size_t length;
+        const char32_t code_point = DecodeUTF8(in + in_pos, input.size() - in_pos, length);
+        in_pos += length;
+        if (code_point >= 0x10000) {
+            out[out_pos++] = static_cast<char16_t>(0xD800 + ((code_point - 0x10000) >> 10));
+            out[out_pos++] = static_cast<char16_t>(0xDC00 + ((code_point - 0x10000) & 0x3FF));
+        } else {
+            out[out_pos++] = static_cast<char16_t>(code_point);
+        }
+    }
+    output.resize(out_pos);
+}
+
+std::u16string UTF8ToUTF16(std::string_view input) {
+    std::u16string output;
+    UTF8ToUTF16(input, output);
+    return output;
+}
+
+void UTF16ToUTF8(std::u16string_view input, std::string& output) {
+    // A UTF-16 code unit never takes more than three bytes, surrogate pairs take four
+    output.resize(input.size() * 3);
+    u8* const out = reinterpret_cast<u8*>(&output[0]);
+
+    size_t in_pos = 0;
+    size_t out_pos = 0;
+    while (in_pos < input.size()) {
+        const size_t ascii_length = NarrowAscii(input.data() + in_pos, input.size() - in_pos,
+                                                reinterpret_cast<char*>(out + out_pos));
+        in_pos += ascii_length;
+        out_pos += ascii_length;
+        if (in_pos == input.size()) {
+            break;
+        }
+
+        char32_t code_point = input[in_pos++];
+        if (code_point >= 0xD800 && code_point <= 0xDFFF) {
+            // Unpaired surrogates are invalid
+            if (code_point <= 0xDBFF && in_pos < input.size() && input[in_pos] >= 0xDC00 &&
+                input[in_pos] <= 0xDFFF) {
+                code_point = 0x10000 + ((code_point - 0xD800) << 10) + (input[in_pos++] - 0xDC00);
+            } else {
+                code_point = REPLACEMENT_CHARACTER;
+            }
+        }
+
+        if (code_point < 0x800) {
+            out[out_pos++] = static_cast<u8>(0xC0 | (code_point >> 6));
+        } else if (code_point < 0x10000) {
+            out[out_pos++] = static_cast<u8>(0xE0 | (code_point >> 12));
+            out[out_pos++] = static_cast<u8>(0x80 | ((code_point >> 6) & 0x3F));
+        } else {
+            out[out_pos++] = static_cast<u8>(0xF0 | (code_point >> 18));
+            out[out_pos++] = static_cast<u8>(0x80 | ((code_point >> 12) & 0x3F));
+            out[out_pos++] = static_cast<u8>(0x80 | ((code_point >> 6) & 0x3F));
+        }
+        out[out_pos++] = static_cast<u8>(0x80 | (code_point & 0x3F));
+    }
+    output.resize(out_pos);
+}
+
+std::string UTF16ToUTF8(std::u16string_view input) {
+    std::string output;
+    UTF16ToUTF8(input, output);
+    return output;
 }
 
+#ifdef _WIN32
+
 static std::wstring CPToUTF16(u32 code_page, const std::string& input) {
     auto const size =
         MultiByteToWideChar(code_page, 0, input.data(), static_cast<int>(input.size()), nullptr, 0);
@@ -390,58 +558,6 @@ static std::string CodeToUTF8(const char* fromcode, const std::basic_string<T>&
     return result;
 }
 
-std::u16string UTF8ToUTF16(const std::string& input) {
-    std::u16string result;
-
-    iconv_t const conv_desc = iconv_open("UTF-16LE", "UTF-8");
-    if ((iconv_t)(-1) == conv_desc) {
-        LOG_ERROR(Common, "Iconv initialization failure [UTF-8]: %s", strerror(errno));
-        iconv_close(conv_desc);
-        return {};
-    }
-
-    const size_t in_bytes = sizeof(char) * input.size();
-    // Multiply by 4, which is the max number of bytes to encode a codepoint
-    const size_t out_buffer_size = 4 * sizeof(char16_t) * in_bytes;
-
-    std::u16string out_buffer;
-    out_buffer.resize(out_buffer_size);
-
-    char* src_buffer = const_cast<char*>(&input[0]);
-    size_t src_bytes = in_bytes;
-    char* dst_buffer = (char*)(&out_buffer[0]);
-    size_t dst_bytes = out_buffer.size();
-
-    while (0 != src_bytes) {
-        size_t const iconv_result =
-            iconv(conv_desc, &src_buffer, &src_bytes, &dst_buffer, &dst_bytes);
-
-        if (static_cast<size_t>(-1) == iconv_result) {
-            if (EILSEQ == errno || EINVAL == errno) {
-                // Try to skip the bad character
-                if (0 != src_bytes) {
-                    --src_bytes;
-                    ++src_buffer;
-                }
-            } else {
-                LOG_ERROR(Common, "iconv failure [UTF-8]: %s", strerror(errno));
-                break;
-            }
-        }
-    }
-
-    out_buffer.resize(out_buffer_size - dst_bytes);
-    out_buffer.swap(result);
-
-    iconv_close(conv_desc);
-
-    return result;
-}
-
-std::string UTF16ToUTF8(const std::u16string& input) {
-    return CodeToUTF8("UTF-16LE", input);
-}
-
 std::string CP1252ToUTF8(const std::string& input) {
     // return CodeToUTF8("CP1252//TRANSLIT", input);
     // return CodeToUTF8("CP1252//IGNORE", input);
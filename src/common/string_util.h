@@ -9,6 +9,7 @@
 #include <iomanip>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "common/common_types.h"
 
@@ -35,6 +36,8 @@ inline void CharArrayFromFormat(char (&out)[Count], const char* format, ...) {
 // Good
 std::string ArrayToString(const u8* data, size_t size, int line_len = 20, bool spaces = true);
 
+/// Removes the leading and trailing whitespace, the result refers to the input
+std::string_view TrimSpaces(std::string_view str);
 std::string StripSpaces(const std::string& s);
 std::string StripQuotes(const std::string& s);
 
@@ -75,6 +78,8 @@ bool AsciiToHex(const char* _szValue, u32& result);
 std::string TabsToSpaces(int tab_size, const std::string& in);
 
 void SplitString(const std::string& str, char delim, std::vector<std::string>& output);
+/// Splits a string without copying it, the fields refer to the input
+void SplitString(std::string_view str, char delim, std::vector<std::string_view>& output);
 
 // "C:/Windows/winhelp.exe" to "C:/Windows/", "winhelp", ".exe"
 bool SplitPath(const std::string& full_path, std::string* _pPath, std::string* _pFilename,
@@ -84,8 +89,16 @@ void BuildCompleteFilename(std::string& _CompleteFilename, const std::string& _P
                            const std::string& _Filename);
 std::string ReplaceAll(std::string result, const std::string& src, const std::string& dest);
 
-std::string UTF16ToUTF8(const std::u16string& input);
-std::u16string UTF8ToUTF16(const std::string& input);
+/**
+ * Conversions between UTF-8 and UTF-16. ASCII runs are converted 16 characters at a time, and
+ * invalid sequences become U+FFFD.
+ */
+std::string UTF16ToUTF8(std::u16string_view input);
+std::u16string UTF8ToUTF16(std::string_view input);
+
+/// Conversions writing into an existing string, reusing its memory
+void UTF16ToUTF8(std::u16string_view input, std::string& output);
+void UTF8ToUTF16(std::string_view input, std::u16string& output);
 
 std::string CP1252ToUTF8(const std::string& str);
 std::string SHIFTJISToUTF8(const std::string& str);
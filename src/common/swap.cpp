@@ -0,0 +1,171 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include "common/assert.h"
+#include "common/kernel_dispatch.h"
+#include "common/swap.h"
+
+#ifdef ARCHITECTURE_x86_64
+#include <immintrin.h>
+#include "common/x64/cpu_detect.h"
+#endif
+
+namespace Common {
+
+/**
+ * A kernel swaps as many values as its vectors fit, and returns how many it swapped. The rest is
+ * swapped by the scalar code.
+ */
+using SwapKernel = size_t (*)(const u8* src, u8* dst, size_t count);
+
+struct Kernels {
+    SwapKernel swap16;
+    SwapKernel swap32;
+    SwapKernel swap64;
+};
+
+static size_t SwapNone(const u8*, u8*, size_t) {
+    return 0;
+}
+
+#ifdef ARCHITECTURE_x86_64
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#endif
+
+/// Byte shuffles reversing each value of a 16-byte lane, for values of 2, 4 and 8 bytes
+alignas(16) constexpr u8 SHUFFLE_16[16] = {1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14};
+alignas(16) constexpr u8 SHUFFLE_32[16] = {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12};
+alignas(16) constexpr u8 SHUFFLE_64[16] = {7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8};
+
+template <size_t ValueSize>
+static const u8* GetShuffle() {
+    return ValueSize == 2 ? SHUFFLE_16 : ValueSize == 4 ? SHUFFLE_32 : SHUFFLE_64;
+}
+
+template <size_t ValueSize>
+TARGET_SSSE3 static size_t SwapSSSE3(const u8* src, u8* dst, size_t count) {
+    const __m128i shuffle =
+        _mm_load_si128(reinterpret_cast<const __m128i*>(GetShuffle<ValueSize>()));
+    const size_t num_vectors = count * ValueSize / sizeof(__m128i);
+    for (size_t i = 0; i < num_vectors; ++i) {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src) + i);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst) + i, _mm_shuffle_epi8(value, shuffle));
+    }
+    return num_vectors * sizeof(__m128i) / ValueSize;
+}
+
+template <size_t ValueSize>
+TARGET_AVX2 static size_t SwapAVX2(const u8* src, u8* dst, size_t count) {
+    // vpshufb shuffles each 16-byte lane on its own, so the lane shuffle is used in both
+    const __m256i shuffle = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(GetShuffle<ValueSize>())));
+    const size_t num_vectors = count * ValueSize / sizeof(__m256i);
+    for (size_t i = 0; i < num_vectors; ++i) {
+        const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src) + i);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst) + i,
+                            _mm256_shuffle_epi8(value, shuffle));
+    }
+    return num_vectors * sizeof(__m256i) / ValueSize;
+}
+
+static constexpr Kernels SSSE3_KERNELS{SwapSSSE3<2>, SwapSSSE3<4>, SwapSSSE3<8>};
+static constexpr Kernels AVX2_KERNELS{SwapAVX2<2>, SwapAVX2<4>, SwapAVX2<8>};
+
+#undef TARGET_SSSE3
+#undef TARGET_AVX2
+
+#endif // ARCHITECTURE_x86_64
+
+static constexpr Kernels SCALAR_KERNELS{SwapNone, SwapNone, SwapNone};
+
+static const Kernels* SelectKernels(SwapIsa isa) {
+    switch (isa) {
+#ifdef ARCHITECTURE_x86_64
+    case SwapIsa::AVX2:
+        RecordKernelSelection("ByteSwap", "AVX2");
+        return &AVX2_KERNELS;
+    case SwapIsa::SSSE3:
+        RecordKernelSelection("ByteSwap", "SSSE3");
+        return &SSSE3_KERNELS;
+#endif
+    default:
+        RecordKernelSelection("ByteSwap", "Scalar");
+        return &SCALAR_KERNELS;
+    }
+}
+
+static SwapIsa GetBestSwapIsa() {
+#ifdef ARCHITECTURE_x86_64
+    if (Common::GetCPUCaps().avx2) {
+        return SwapIsa::AVX2;
+    }
+    if (Common::GetCPUCaps().ssse3) {
+        return SwapIsa::SSSE3;
+    }
+#endif
+    return SwapIsa::Scalar;
+}
+
+static const Kernels*& GetKernels() {
+    static const Kernels* kernels = SelectKernels(GetBestSwapIsa());
+    return kernels;
+}
+
+bool IsSwapIsaSupported(SwapIsa isa) {
+    switch (isa) {
+    case SwapIsa::Scalar:
+        return true;
+    case SwapIsa::SSSE3:
+        return GetBestSwapIsa() != SwapIsa::Scalar;
+    case SwapIsa::AVX2:
+        return GetBestSwapIsa() == SwapIsa::AVX2;
+    }
+    return false;
+}
+
+void SetSwapIsa(SwapIsa isa) {
+    ASSERT(IsSwapIsaSupported(isa));
+    GetKernels() = SelectKernels(isa);
+}
+
+/// Swaps the values the kernel left, copying each through a local so that nothing is aliased
+template <typename T, T (*Swap)(T)>
+static void SwapRemaining(const u8* src, u8* dst, size_t done, size_t count) {
+    for (size_t i = done; i < count; ++i) {
+        T value;
+        std::memcpy(&value, src + i * sizeof(T), sizeof(T));
+        value = Swap(value);
+        std::memcpy(dst + i * sizeof(T), &value, sizeof(T));
+    }
+}
+
+void SwapBytes16(const void* src, void* dst, size_t count) {
+    const u8* src_bytes = static_cast<const u8*>(src);
+    u8* dst_bytes = static_cast<u8*>(dst);
+    const size_t done = GetKernels()->swap16(src_bytes, dst_bytes, count);
+    SwapRemaining<u16, swap16>(src_bytes, dst_bytes, done, count);
+}
+
+void SwapBytes32(const void* src, void* dst, size_t count) {
+    const u8* src_bytes = static_cast<const u8*>(src);
+    u8* dst_bytes = static_cast<u8*>(dst);
+    const size_t done = GetKernels()->swap32(src_bytes, dst_bytes, count);
+    SwapRemaining<u32, swap32>(src_bytes, dst_bytes, done, count);
+}
+
+void SwapBytes64(const void* src, void* dst, size_t count) {
+    const u8* src_bytes = static_cast<const u8*>(src);
+    u8* dst_bytes = static_cast<u8*>(dst);
+    const size_t done = GetKernels()->swap64(src_bytes, dst_bytes, count);
+    SwapRemaining<u64, swap64>(src_bytes, dst_bytes, done, count);
+}
+
+} // namespace Common
@@ -25,7 +25,9 @@
     defined(__NetBSD__) || defined(__OpenBSD__)
 #include <sys/endian.h>
 #endif
+#include <cstddef>
 #include <cstring>
+#include <type_traits>
 #include "common/common_types.h"
 
 // GCC 4.6+
@@ -151,6 +153,47 @@ inline double swapd(double f) {
     return f;
 }
 
+/**
+ * Byte swaps arrays of 16, 32 or 64-bit values, for guest data stored in the other byte order.
+ * The source and the destination may be the same array, but must not overlap otherwise. Neither
+ * has to be aligned.
+ * @param count Number of values in the arrays
+ */
+void SwapBytes16(const void* src, void* dst, size_t count);
+void SwapBytes32(const void* src, void* dst, size_t count);
+void SwapBytes64(const void* src, void* dst, size_t count);
+
+/// Byte swaps an array of integers or floats in place
+template <typename T>
+void SwapSpan(T* data, size_t count) {
+    static_assert(std::is_arithmetic<T>::value, "Only arithmetic values can be swapped");
+    if constexpr (sizeof(T) == 2) {
+        SwapBytes16(data, data, count);
+    } else if constexpr (sizeof(T) == 4) {
+        SwapBytes32(data, data, count);
+    } else if constexpr (sizeof(T) == 8) {
+        SwapBytes64(data, data, count);
+    } else {
+        static_assert(sizeof(T) == 1, "Unsupported size");
+    }
+}
+
+/// Instruction sets the arrays can be byte swapped with
+enum class SwapIsa {
+    Scalar,
+    SSSE3,
+    AVX2,
+};
+
+/// Returns whether the host CPU supports byte swapping arrays with an instruction set
+bool IsSwapIsaSupported(SwapIsa isa);
+
+/**
+ * Selects the instruction set arrays are byte swapped with, which must be supported. The best one
+ * is selected by default, the others exist to compare them.
+ */
+void SetSwapIsa(SwapIsa isa);
+
 } // Namespace Common
 
 template <typename T, typename F>
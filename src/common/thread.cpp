@@ -2,6 +2,11 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <vector>
 #include "common/thread.h"
 #ifdef __APPLE__
 #include <mach/mach.h>
@@ -133,4 +138,50 @@ void SetCurrentThreadName(const char* szThreadName) {
 
 #endif
 
+static std::atomic<bool> is_host_thread_pinning_enabled{false};
+
+/**
+ * Gets the host processors the emulator threads are pinned to, those of the first NUMA node.
+ * Processors above 31 are left out, as affinity masks only have 32 bits.
+ */
+static std::vector<u32> GetPinningProcessors() {
+    std::vector<u32> processors;
+#ifdef __linux__
+    // A list of ranges, like "0-15,32-47". The first processors listed are usually distinct
+    // physical cores, their hyperthreads come after them.
+    std::ifstream cpu_list("/sys/devices/system/node/node0/cpulist");
+    std::string range;
+    while (std::getline(cpu_list, range, ',')) {
+        const size_t dash = range.find('-');
+        const unsigned long first = std::stoul(range.substr(0, dash));
+        const unsigned long last =
+            dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+        for (unsigned long processor = first; processor <= last && processor < 32; ++processor) {
+            processors.push_back(static_cast<u32>(processor));
+        }
+    }
+#endif
+    if (processors.empty()) {
+        const u32 num_processors = std::min(std::max(std::thread::hardware_concurrency(), 1u), 32u);
+        for (u32 processor = 0; processor < num_processors; ++processor) {
+            processors.push_back(processor);
+        }
+    }
+    return processors;
+}
+
+void SetHostThreadPinning(bool enabled) {
+    is_host_thread_pinning_enabled = enabled;
+}
+
+void PinCurrentHostThread(HostThread thread) {
+    if (!is_host_thread_pinning_enabled) {
+        return;
+    }
+    static const std::vector<u32> processors = GetPinningProcessors();
+    // Hosts with fewer processors than roles have some of the threads share a processor
+    const u32 processor = processors[static_cast<size_t>(thread) % processors.size()];
+    SetCurrentThreadAffinity(1u << processor);
+}
+
 } // namespace Common
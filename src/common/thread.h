@@ -37,6 +37,28 @@ int CurrentThreadId();
 void SetThreadAffinity(std::thread::native_handle_type thread, u32 mask);
 void SetCurrentThreadAffinity(u32 mask);
 
+/// Emulator threads that get a host processor of their own when host thread pinning is enabled
+enum class HostThread {
+    /// Threads running the emulated CPU cores, the first one is the emulation thread
+    CpuCore0,
+    CpuCore1,
+    CpuCore2,
+    CpuCore3,
+    Render,
+    Audio,
+    Input,
+};
+
+/**
+ * Sets whether the emulator threads pin themselves to a host processor each as they start. The
+ * processors are those of the first NUMA node of the host, so that the threads never migrate
+ * across sockets, and the guest memory they touch first is allocated on that node as well.
+ */
+void SetHostThreadPinning(bool enabled);
+
+/// Pins the calling thread to the host processor of its role, if host thread pinning is enabled
+void PinCurrentHostThread(HostThread thread);
+
 class Event {
 public:
     Event() : is_set(false) {}
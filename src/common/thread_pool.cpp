@@ -0,0 +1,121 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <string>
+#include "common/assert.h"
+#include "common/thread.h"
+#include "common/thread_pool.h"
+
+namespace Common {
+
+namespace {
+/// Pool and index of the worker the current thread is, if any
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+} // Anonymous namespace
+
+ThreadPool::ThreadPool(size_t num_workers, bool pin_workers) {
+    ASSERT(num_workers > 0);
+    workers.reserve(num_workers);
+    for (size_t i = 0; i < num_workers; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    // The workers may steal from each other as soon as they run, so they all exist by then
+    for (size_t i = 0; i < num_workers; ++i) {
+        workers[i]->thread = std::thread(&ThreadPool::WorkerLoop, this, i, pin_workers);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    sleep_condition.notify_all();
+
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+ThreadPool& ThreadPool::GetInstance() {
+    static ThreadPool instance(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+    return instance;
+}
+
+void ThreadPool::Enqueue(Task task, TaskPriority priority, size_t preferred_worker) {
+    size_t index;
+    if (preferred_worker != ANY_WORKER) {
+        index = preferred_worker % workers.size();
+    } else if (current_pool == this) {
+        index = current_worker;
+    } else {
+        index = next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    }
+
+    // Counted before it's queued, so that the count never drops below the number of queued tasks
+    num_queued.fetch_add(1);
+    {
+        Worker& worker = *workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.queues[static_cast<size_t>(priority)].push_back(std::move(task));
+    }
+
+    // Taking the lock orders this with a worker checking the count before it goes to sleep
+    { std::lock_guard<std::mutex> lock(sleep_mutex); }
+    sleep_condition.notify_one();
+}
+
+bool ThreadPool::TakeTask(size_t index, Task& task) {
+    for (size_t priority = 0; priority < NUM_PRIORITIES; ++priority) {
+        for (size_t offset = 0; offset < workers.size(); ++offset) {
+            const bool is_own = offset == 0;
+            Worker& worker = *workers[(index + offset) % workers.size()];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            auto& queue = worker.queues[priority];
+            if (queue.empty()) {
+                continue;
+            }
+            // Own tasks are taken from the back, as the newest ones are the most likely to have
+            // their data in cache, while thieves take the oldest ones
+            if (is_own) {
+                task = std::move(queue.back());
+                queue.pop_back();
+            } else {
+                task = std::move(queue.front());
+                queue.pop_front();
+            }
+            num_queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::WorkerLoop(size_t index, bool pin) {
+    current_pool = this;
+    current_worker = index;
+    SetCurrentThreadName(("ThreadPoolWorker" + std::to_string(index)).c_str());
+    if (pin && index < 32) {
+        SetCurrentThreadAffinity(1u << index);
+    }
+
+    Task task;
+    while (true) {
+        if (TakeTask(index, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleep_condition.wait(lock, [this] { return stopping || num_queued.load() != 0; });
+        if (stopping && num_queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+} // namespace Common
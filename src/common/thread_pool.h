@@ -0,0 +1,114 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "common/common_types.h"
+
+namespace Common {
+
+enum class TaskPriority : u32 {
+    High,
+    Normal,
+    Low,
+};
+
+/**
+ * Pool of host threads running tasks of all subsystems, so that they share the host cores instead
+ * of each starting threads of their own. Every worker has its own queues; tasks submitted by a
+ * worker go to its queues, and workers running out of tasks steal from the others. A worker takes
+ * the tasks of a higher priority first, stealing them before it runs its own of a lower priority.
+ *
+ * A task must not wait for the future of another task of the same pool: when all the workers do
+ * so, nobody is left to run the tasks they wait for.
+ */
+class ThreadPool {
+public:
+    /// Passed as the preferred worker of a task that can run anywhere
+    static constexpr size_t ANY_WORKER = ~size_t(0);
+
+    /**
+     * Starts the workers.
+     * @param num_workers Number of worker threads, at least one.
+     * @param pin_workers Whether worker N only runs on host core N, for pools whose tasks benefit
+     *                    from staying on a core.
+     */
+    explicit ThreadPool(size_t num_workers, bool pin_workers = false);
+
+    /// Runs the tasks that are still queued and stops the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// Pool shared by the whole emulator, with a worker per host core but one
+    static ThreadPool& GetInstance();
+
+    size_t GetNumWorkers() const {
+        return workers.size();
+    }
+
+    /**
+     * Queues a task.
+     * @param function Callable run by a worker, exceptions it throws are stored in the future.
+     * @param priority Priority of the task.
+     * @param preferred_worker Worker whose queue the task goes to, e.g. to keep related tasks on
+     *                         the same core. Other workers may still steal it when idle.
+     * @returns Future of the result of the function.
+     */
+    template <typename Function>
+    auto Submit(Function&& function, TaskPriority priority = TaskPriority::Normal,
+                size_t preferred_worker = ANY_WORKER)
+        -> std::future<std::invoke_result_t<std::decay_t<Function>>> {
+        using Result = std::invoke_result_t<std::decay_t<Function>>;
+        // std::function has to be copyable, unlike the packaged task
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+        std::future<Result> future = task->get_future();
+        Enqueue([task = std::move(task)] { (*task)(); }, priority, preferred_worker);
+        return future;
+    }
+
+private:
+    static constexpr size_t NUM_PRIORITIES = 3;
+
+    using Task = std::function<void()>;
+
+    struct Worker {
+        std::mutex mutex;
+        std::array<std::deque<Task>, NUM_PRIORITIES> queues;
+        std::thread thread;
+    };
+
+    void Enqueue(Task task, TaskPriority priority, size_t preferred_worker);
+
+    /// Takes the task of the highest priority, from the queues of the worker first
+    bool TakeTask(size_t index, Task& task);
+
+    void WorkerLoop(size_t index, bool pin);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    /// Worker of the next task submitted from outside of the pool
+    std::atomic<size_t> next_worker{0};
+
+    /// Number of queued tasks, the workers sleep while there are none
+    std::atomic<size_t> num_queued{0};
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_condition;
+    bool stopping = false;
+};
+
+} // namespace Common
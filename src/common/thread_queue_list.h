@@ -5,157 +5,194 @@
 #pragma once
 
 #include <array>
-#include <deque>
-#include <boost/range/algorithm_ext/erase.hpp>
+#include <climits>
+#include "common/assert.h"
+#include "common/bit_set.h"
+#include "common/common_types.h"
 
 namespace Common {
 
-template <class T, unsigned int N>
-struct ThreadQueueList {
-    // TODO(yuriks): If performance proves to be a problem, the std::deques can be replaced with
-    //               (dynamically resizable) circular buffers to remove their overhead when
-    //               inserting and popping.
+/// Links embedded in the objects queued in a ThreadQueueList
+template <class T>
+struct ThreadQueueNode {
+    T* prev = nullptr;
+    T* next = nullptr;
+    /// Priority level the object is queued at, only valid while linked
+    unsigned int priority = 0;
+    bool linked = false;
+};
 
+/**
+ * Priority queue of threads, with one FIFO per priority level. The FIFOs are intrusive doubly
+ * linked lists threaded through a ThreadQueueNode member of T, and a bitmap of the non-empty
+ * levels finds the best one with a single bit scan. Every operation is O(1) and none of them
+ * allocate. An object can only be in one ThreadQueueList using a given node at a time.
+ */
+template <class T, unsigned int N, ThreadQueueNode<T> T::*Node>
+struct ThreadQueueList {
     typedef unsigned int Priority;
 
     // Number of priority levels. (Valid levels are [0..NUM_QUEUES).)
     static const Priority NUM_QUEUES = N;
 
-    ThreadQueueList() {
-        first = nullptr;
-    }
+    static_assert(NUM_QUEUES <= sizeof(u64) * CHAR_BIT, "Too many priority levels for the bitmap");
 
     // Only for debugging, returns priority level.
-    Priority contains(const T& uid) {
-        for (Priority i = 0; i < NUM_QUEUES; ++i) {
-            Queue& cur = queues[i];
-            if (std::find(cur.data.cbegin(), cur.data.cend(), uid) != cur.data.cend()) {
-                return i;
-            }
-        }
+    Priority contains(const T* thread) const {
+        const ThreadQueueNode<T>& node = thread->*Node;
+        return node.linked ? node.priority : -1;
+    }
 
-        return -1;
+    T* get_first() const {
+        if (used_priorities == 0) {
+            return nullptr;
+        }
+        return queues[LeastSignificantSetBit(used_priorities)].head;
     }
 
-    T get_first() {
-        Queue* cur = first;
-        while (cur != nullptr) {
-            if (!cur->data.empty()) {
-                return cur->data.front();
-            }
-            cur = cur->next_nonempty;
+    /// Returns the thread queued after the given one, in the order get_first returns them
+    T* get_next(const T* thread) const {
+        const ThreadQueueNode<T>& node = thread->*Node;
+        if (node.next != nullptr) {
+            return node.next;
         }
 
-        return T();
+        // Only consider the levels strictly worse than the one of the thread
+        const u64 worse_priorities = used_priorities & ~((u64(2) << node.priority) - 1);
+        if (worse_priorities == 0) {
+            return nullptr;
+        }
+        return queues[LeastSignificantSetBit(worse_priorities)].head;
     }
 
-    T pop_first() {
-        Queue* cur = first;
-        while (cur != nullptr) {
-            if (!cur->data.empty()) {
-                auto tmp = std::move(cur->data.front());
-                cur->data.pop_front();
-                return tmp;
-            }
-            cur = cur->next_nonempty;
+    T* pop_first() {
+        T* thread = get_first();
+        if (thread != nullptr) {
+            unlink(thread);
         }
-
-        return T();
+        return thread;
     }
 
-    T pop_first_better(Priority priority) {
-        Queue* cur = first;
-        Queue* stop = &queues[priority];
-        while (cur < stop) {
-            if (!cur->data.empty()) {
-                auto tmp = std::move(cur->data.front());
-                cur->data.pop_front();
-                return tmp;
-            }
-            cur = cur->next_nonempty;
+    T* pop_first_better(Priority priority) {
+        // Only consider the levels strictly better than the given one
+        const u64 better_priorities = used_priorities & ((u64(1) << priority) - 1);
+        if (better_priorities == 0) {
+            return nullptr;
         }
 
-        return T();
+        T* thread = queues[LeastSignificantSetBit(better_priorities)].head;
+        unlink(thread);
+        return thread;
     }
 
-    void push_front(Priority priority, const T& thread_id) {
-        Queue* cur = &queues[priority];
-        cur->data.push_front(thread_id);
+    void push_front(Priority priority, T* thread) {
+        ThreadQueueNode<T>& node = prepare_node(priority, thread);
+        Queue& cur = queues[priority];
+
+        node.next = cur.head;
+        if (cur.head != nullptr) {
+            (cur.head->*Node).prev = thread;
+        } else {
+            cur.tail = thread;
+        }
+        cur.head = thread;
+        used_priorities |= u64(1) << priority;
     }
 
-    void push_back(Priority priority, const T& thread_id) {
-        Queue* cur = &queues[priority];
-        cur->data.push_back(thread_id);
+    void push_back(Priority priority, T* thread) {
+        ThreadQueueNode<T>& node = prepare_node(priority, thread);
+        Queue& cur = queues[priority];
+
+        node.prev = cur.tail;
+        if (cur.tail != nullptr) {
+            (cur.tail->*Node).next = thread;
+        } else {
+            cur.head = thread;
+        }
+        cur.tail = thread;
+        used_priorities |= u64(1) << priority;
     }
 
-    void move(const T& thread_id, Priority old_priority, Priority new_priority) {
-        remove(old_priority, thread_id);
-        prepare(new_priority);
-        push_back(new_priority, thread_id);
+    void move(T* thread, Priority old_priority, Priority new_priority) {
+        remove(old_priority, thread);
+        push_back(new_priority, thread);
     }
 
-    void remove(Priority priority, const T& thread_id) {
-        Queue* cur = &queues[priority];
-        boost::remove_erase(cur->data, thread_id);
+    void remove(Priority priority, T* thread) {
+        const ThreadQueueNode<T>& node = thread->*Node;
+        if (!node.linked) {
+            return;
+        }
+        DEBUG_ASSERT_MSG(node.priority == priority, "Thread queued at a different priority");
+        unlink(thread);
     }
 
     void rotate(Priority priority) {
-        Queue* cur = &queues[priority];
-
-        if (cur->data.size() > 1) {
-            cur->data.push_back(std::move(cur->data.front()));
-            cur->data.pop_front();
+        Queue& cur = queues[priority];
+        if (cur.head != cur.tail) {
+            T* thread = cur.head;
+            unlink(thread);
+            push_back(priority, thread);
         }
     }
 
     void clear() {
-        queues.fill(Queue());
-        first = nullptr;
+        for (Queue& cur : queues) {
+            while (cur.head != nullptr) {
+                unlink(cur.head);
+            }
+        }
     }
 
     bool empty(Priority priority) const {
-        const Queue* cur = &queues[priority];
-        return cur->data.empty();
-    }
-
-    void prepare(Priority priority) {
-        Queue* cur = &queues[priority];
-        if (cur->next_nonempty == UnlinkedTag())
-            link(priority);
+        return (used_priorities & (u64(1) << priority)) == 0;
     }
 
 private:
     struct Queue {
-        // Points to the next active priority, skipping over ones that have never been used.
-        Queue* next_nonempty = UnlinkedTag();
-        // Double-ended queue of threads in this priority level
-        std::deque<T> data;
+        T* head = nullptr;
+        T* tail = nullptr;
     };
 
-    /// Special tag used to mark priority levels that have never been used.
-    static Queue* UnlinkedTag() {
-        return reinterpret_cast<Queue*>(1);
+    ThreadQueueNode<T>& prepare_node(Priority priority, T* thread) {
+        DEBUG_ASSERT(priority < NUM_QUEUES);
+        ThreadQueueNode<T>& node = thread->*Node;
+        DEBUG_ASSERT_MSG(!node.linked, "Thread is already queued");
+        node.prev = nullptr;
+        node.next = nullptr;
+        node.priority = priority;
+        node.linked = true;
+        return node;
     }
 
-    void link(Priority priority) {
-        Queue* cur = &queues[priority];
+    void unlink(T* thread) {
+        ThreadQueueNode<T>& node = thread->*Node;
+        Queue& cur = queues[node.priority];
 
-        for (int i = priority - 1; i >= 0; --i) {
-            if (queues[i].next_nonempty != UnlinkedTag()) {
-                cur->next_nonempty = queues[i].next_nonempty;
-                queues[i].next_nonempty = cur;
-                return;
-            }
+        if (node.prev != nullptr) {
+            (node.prev->*Node).next = node.next;
+        } else {
+            cur.head = node.next;
+        }
+        if (node.next != nullptr) {
+            (node.next->*Node).prev = node.prev;
+        } else {
+            cur.tail = node.prev;
+        }
+
+        if (cur.head == nullptr) {
+            used_priorities &= ~(u64(1) << node.priority);
         }
 
-        cur->next_nonempty = first;
-        first = cur;
+        node.prev = nullptr;
+        node.next = nullptr;
+        node.linked = false;
     }
 
-    // The first queue that's ever been used.
-    Queue* first;
-    // The priority level queues of thread ids.
+    /// Bitmap of the priority levels that have threads queued, bit N being priority N
+    u64 used_priorities = 0;
+    // The priority level queues of threads.
     std::array<Queue, NUM_QUEUES> queues;
 };
 
-} // namespace
+} // namespace Common
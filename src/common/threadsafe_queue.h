@@ -8,9 +8,13 @@
 // single reader, single writer queue
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <mutex>
+#include <type_traits>
 #include "common/common_types.h"
 
 namespace Common {
@@ -119,4 +123,285 @@ public:
 private:
     std::mutex write_lock;
 };
+
+/// Size of the cache lines, the bounded queues keep what their producers and consumers write apart
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+namespace detail {
+
+/**
+ * Parks the threads waiting for a bounded queue to change. The queue operations only check
+ * whether anyone waits, the mutex and condition variable are only used when someone does.
+ */
+class QueueWaiter {
+public:
+    /// Waits until ready() returns true, it has to check the state of the queue with acquire loads
+    template <typename Predicate>
+    void Wait(Predicate ready) {
+        std::unique_lock<std::mutex> lock(mutex);
+        waiters.fetch_add(1);
+        // Orders the registration before the checks, Notify does the opposite
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        condition.wait(lock, ready);
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /// Waits until ready() returns true or the timeout expired, returns the last result of ready()
+    template <typename Predicate, typename Rep, typename Period>
+    bool WaitFor(Predicate ready, const std::chrono::duration<Rep, Period>& timeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        waiters.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const bool result = condition.wait_for(lock, timeout, ready);
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        return result;
+    }
+
+    /// Wakes the waiting threads up, called after the state of the queue changed
+    void Notify() {
+        NotifyIf([] { return true; });
+    }
+
+    /// Wakes the waiting threads up if there are any and ready() returns true
+    template <typename Predicate>
+    void NotifyIf(Predicate ready) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) != 0 && ready()) {
+            std::lock_guard<std::mutex> lock(mutex);
+            condition.notify_all();
+        }
+    }
+
+private:
+    std::atomic<u32> waiters{0};
+    std::mutex mutex;
+    std::condition_variable condition;
+};
+
+} // namespace detail
+
+/**
+ * Bounded single producer, single consumer queue. The elements live in a ring that is allocated
+ * once, and each side keeps a cached copy of the index of the other, so that it only reads the
+ * cache line of the other side when the ring looks full or empty.
+ *
+ * Push and PopWait block while the queue is full or empty, TryPush and TryPop return instead.
+ */
+template <typename T, size_t Capacity>
+class BoundedSPSCQueue {
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+public:
+    template <typename Arg>
+    bool TryPush(Arg&& t) {
+        const size_t write = write_index.load(std::memory_order_relaxed);
+        if (write - cached_read_index == Capacity) {
+            cached_read_index = read_index.load(std::memory_order_acquire);
+            if (write - cached_read_index == Capacity) {
+                return false;
+            }
+        }
+        slots[write & MASK] = std::forward<Arg>(t);
+        write_index.store(write + 1, std::memory_order_release);
+        not_empty.Notify();
+        return true;
+    }
+
+    template <typename Arg>
+    void Push(Arg&& t) {
+        while (!TryPush(std::forward<Arg>(t))) {
+            not_full.Wait([this] { return HasRoomToResume(); });
+        }
+    }
+
+    bool TryPop(T& t) {
+        const size_t read = read_index.load(std::memory_order_relaxed);
+        if (read == cached_write_index) {
+            cached_write_index = write_index.load(std::memory_order_acquire);
+            if (read == cached_write_index) {
+                return false;
+            }
+        }
+        t = std::move(slots[read & MASK]);
+        read_index.store(read + 1, std::memory_order_release);
+        not_full.NotifyIf([this] { return HasRoomToResume(); });
+        return true;
+    }
+
+    void PopWait(T& t) {
+        while (!TryPop(t)) {
+            not_empty.Wait([this] { return !Empty(); });
+        }
+    }
+
+    /// Waits up to the timeout for an element, returns false if none came
+    template <typename Rep, typename Period>
+    bool PopWaitFor(T& t, const std::chrono::duration<Rep, Period>& timeout) {
+        return TryPop(t) || (not_empty.WaitFor([this] { return !Empty(); }, timeout) && TryPop(t));
+    }
+
+    bool Empty() const {
+        return Size() == 0;
+    }
+
+    size_t Size() const {
+        // The read index is loaded first, it can't pass the write index loaded after it
+        const size_t read = read_index.load(std::memory_order_acquire);
+        return write_index.load(std::memory_order_acquire) - read;
+    }
+
+private:
+    static constexpr size_t MASK = Capacity - 1;
+
+    /**
+     * Whether a producer waiting for room can resume. It waits for half of the ring, so that it
+     * isn't woken up by every element taken.
+     */
+    bool HasRoomToResume() const {
+        return Size() <= Capacity / 2;
+    }
+
+    // Written by the producer
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> write_index{0};
+    size_t cached_read_index = 0;
+
+    // Written by the consumer
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> read_index{0};
+    size_t cached_write_index = 0;
+
+    alignas(CACHE_LINE_SIZE) std::array<T, Capacity> slots;
+
+    detail::QueueWaiter not_empty;
+    detail::QueueWaiter not_full;
+};
+
+/**
+ * Bounded multiple producer, multiple consumer queue. The elements live in a ring that is
+ * allocated once. Each slot has a sequence number telling whose turn it is: it equals the position
+ * a producer can claim it for, becomes position + 1 once the element is written, and position +
+ * Capacity once the element was taken. Producers and consumers claim positions with a CAS on
+ * their own index, and never wait on each other unless the queue is full or empty.
+ *
+ * Push and PopWait block while the queue is full or empty, TryPush and TryPop return instead.
+ */
+template <typename T, size_t Capacity>
+class BoundedMPMCQueue {
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+public:
+    BoundedMPMCQueue() {
+        for (size_t i = 0; i < Capacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    template <typename Arg>
+    bool TryPush(Arg&& t) {
+        size_t position = enqueue_position.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[position & MASK];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const auto difference =
+                static_cast<std::make_signed_t<size_t>>(sequence - position);
+            if (difference == 0) {
+                if (enqueue_position.compare_exchange_weak(position, position + 1,
+                                                           std::memory_order_relaxed)) {
+                    slot.value = std::forward<Arg>(t);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    not_empty.Notify();
+                    return true;
+                }
+            } else if (difference < 0) {
+                // The slot still holds the element of the previous round
+                return false;
+            } else {
+                position = enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    template <typename Arg>
+    void Push(Arg&& t) {
+        while (!TryPush(std::forward<Arg>(t))) {
+            not_full.Wait([this] { return HasRoomToResume(); });
+        }
+    }
+
+    bool TryPop(T& t) {
+        size_t position = dequeue_position.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[position & MASK];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const auto difference =
+                static_cast<std::make_signed_t<size_t>>(sequence - (position + 1));
+            if (difference == 0) {
+                if (dequeue_position.compare_exchange_weak(position, position + 1,
+                                                           std::memory_order_relaxed)) {
+                    t = std::move(slot.value);
+                    slot.sequence.store(position + Capacity, std::memory_order_release);
+                    not_full.NotifyIf([this] { return HasRoomToResume(); });
+                    return true;
+                }
+            } else if (difference < 0) {
+                // The slot wasn't written yet
+                return false;
+            } else {
+                position = dequeue_position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void PopWait(T& t) {
+        while (!TryPop(t)) {
+            not_empty.Wait([this] { return !Empty(); });
+        }
+    }
+
+    /// Waits up to the timeout for an element, returns false if none came
+    template <typename Rep, typename Period>
+    bool PopWaitFor(T& t, const std::chrono::duration<Rep, Period>& timeout) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!TryPop(t)) {
+            if (!not_empty.WaitFor([this] { return !Empty(); },
+                                   deadline - std::chrono::steady_clock::now())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Whether the next element to pop wasn't written yet, only a hint while others use the queue
+    bool Empty() const {
+        const size_t position = dequeue_position.load(std::memory_order_acquire);
+        return slots[position & MASK].sequence.load(std::memory_order_acquire) != position + 1;
+    }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    static constexpr size_t MASK = Capacity - 1;
+
+    /**
+     * Whether the producers waiting for room can resume. They wait for half of the ring, counting
+     * the claimed positions, so that they aren't woken up by every element taken.
+     */
+    bool HasRoomToResume() const {
+        // The dequeue position is loaded first, it can't pass the enqueue position loaded after it
+        const size_t dequeue = dequeue_position.load(std::memory_order_acquire);
+        return enqueue_position.load(std::memory_order_acquire) - dequeue <= Capacity / 2;
+    }
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueue_position{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeue_position{0};
+    std::array<Slot, Capacity> slots;
+
+    detail::QueueWaiter not_empty;
+    detail::QueueWaiter not_full;
+};
+
 } // namespace Common
@@ -31,8 +31,14 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <type_traits>
 
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+
 namespace Math {
 
 template <typename T>
@@ -630,6 +636,84 @@ static inline decltype(T{} * T{} + T{} * T{}) Dot(const Vec4<T>& a, const Vec4<T
     return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
 }
 
+#ifdef ARCHITECTURE_x86_64
+
+// SSE versions of the arithmetic of Vec4<float> and of the conversion of Vec4<u8> to it. The
+// layout of the vectors is left alone, as they are laid over arrays of floats and of pixels, so
+// they are loaded unaligned. Every lane rounds like the scalar code, and the sums of the products
+// are added in the same order, so the results are the same.
+namespace Detail {
+
+inline __m128 Load(const Vec4<float>& vec) {
+    return _mm_loadu_ps(&vec.x);
+}
+
+inline Vec4<float> Store(__m128 value) {
+    Vec4<float> vec;
+    _mm_storeu_ps(&vec.x, value);
+    return vec;
+}
+
+inline __m128 Load(const Vec4<std::uint8_t>& vec) {
+    std::int32_t bytes;
+    std::memcpy(&bytes, &vec.x, sizeof(bytes));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i words = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero);
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+}
+
+/// Adds up the lanes in the order of the scalar code
+inline float SumInOrder(__m128 value) {
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, value);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+} // namespace Detail
+
+template <>
+inline Vec4<float> Vec4<float>::operator+(const Vec4& other) const {
+    return Detail::Store(_mm_add_ps(Detail::Load(*this), Detail::Load(other)));
+}
+
+template <>
+inline void Vec4<float>::operator+=(const Vec4& other) {
+    *this = *this + other;
+}
+
+template <>
+inline Vec4<float> Vec4<float>::operator-(const Vec4& other) const {
+    return Detail::Store(_mm_sub_ps(Detail::Load(*this), Detail::Load(other)));
+}
+
+template <>
+inline void Vec4<float>::operator-=(const Vec4& other) {
+    *this = *this - other;
+}
+
+template <>
+inline Vec4<float> Vec4<float>::operator*(const Vec4& other) const {
+    return Detail::Store(_mm_mul_ps(Detail::Load(*this), Detail::Load(other)));
+}
+
+template <>
+inline float Vec4<float>::Length2() const {
+    const __m128 vec = Detail::Load(*this);
+    return Detail::SumInOrder(_mm_mul_ps(vec, vec));
+}
+
+template <>
+template <>
+inline Vec4<float> Vec4<std::uint8_t>::Cast<float>() const {
+    return Detail::Store(Detail::Load(*this));
+}
+
+static inline float Dot(const Vec4<float>& a, const Vec4<float>& b) {
+    return Detail::SumInOrder(_mm_mul_ps(Detail::Load(a), Detail::Load(b)));
+}
+
+#endif
+
 template <typename T>
 static inline Vec3<decltype(T{} * T{} - T{} * T{})> Cross(const Vec3<T>& a, const Vec3<T>& b) {
     return MakeVec(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
@@ -642,6 +726,21 @@ static inline decltype(X{} * float{} + X{} * float{}) Lerp(const X& begin, const
     return begin * (1.f - t) + end * t;
 }
 
+#ifdef ARCHITECTURE_x86_64
+
+static inline Vec4<float> Lerp(const Vec4<float>& begin, const Vec4<float>& end, const float t) {
+    return Detail::Store(_mm_add_ps(_mm_mul_ps(Detail::Load(begin), _mm_set1_ps(1.f - t)),
+                                    _mm_mul_ps(Detail::Load(end), _mm_set1_ps(t))));
+}
+
+static inline Vec4<float> Lerp(const Vec4<std::uint8_t>& begin, const Vec4<std::uint8_t>& end,
+                               const float t) {
+    return Detail::Store(_mm_add_ps(_mm_mul_ps(Detail::Load(begin), _mm_set1_ps(1.f - t)),
+                                    _mm_mul_ps(Detail::Load(end), _mm_set1_ps(t))));
+}
+
+#endif
+
 // linear interpolation via int: 0=begin, base=end
 template <typename X, int base>
 static inline decltype((X{} * int{} + X{} * int{}) / base) LerpInt(const X& begin, const X& end,
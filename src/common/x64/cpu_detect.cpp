@@ -81,6 +81,7 @@ static CPUCaps Detect() {
     strcpy(caps.cpu_string, caps.brand_string);
 
     // Detect family and other miscellaneous features
+    bool is_avx512_enabled = false;
     if (max_std_fn >= 1) {
         __cpuid(cpu_id, 0x00000001);
 
@@ -110,11 +111,14 @@ static CPUCaps Detect() {
         //  - Is the XSAVE bit set in CPUID?
         //  - XGETBV result has the XCR bit set.
         if (((cpu_id[2] >> 28) & 1) && ((cpu_id[2] >> 27) & 1)) {
-            if ((_xgetbv(_XCR_XFEATURE_ENABLED_MASK) & 0x6) == 0x6) {
+            const u64 xcr0 = _xgetbv(_XCR_XFEATURE_ENABLED_MASK);
+            if ((xcr0 & 0x6) == 0x6) {
                 caps.avx = true;
                 if ((cpu_id[2] >> 12) & 1)
                     caps.fma = true;
             }
+            // AVX-512 also needs the OS to save the opmask and upper ZMM registers
+            is_avx512_enabled = caps.avx && (xcr0 & 0xE0) == 0xE0;
         }
 
         if (max_std_fn >= 7) {
@@ -126,6 +130,10 @@ static CPUCaps Detect() {
                 caps.bmi1 = true;
             if ((cpu_id[1] >> 8) & 1)
                 caps.bmi2 = true;
+            if ((cpu_id[1] >> 16) & 1)
+                caps.avx512f = is_avx512_enabled;
+            if ((cpu_id[1] >> 30) & 1)
+                caps.avx512bw = caps.avx512f;
         }
     }
 
@@ -190,6 +198,10 @@ std::string GetCPUCapsString() {
         sum += ", AVX";
     if (caps.avx2)
         sum += ", AVX2";
+    if (caps.avx512f)
+        sum += ", AVX512F";
+    if (caps.avx512bw)
+        sum += ", AVX512BW";
     if (caps.bmi1)
         sum += ", BMI1";
     if (caps.bmi2)
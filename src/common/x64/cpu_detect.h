@@ -30,6 +30,8 @@ struct CPUCaps {
     bool lzcnt;
     bool avx;
     bool avx2;
+    bool avx512f;
+    bool avx512bw;
     bool bmi1;
     bool bmi2;
     bool fma;
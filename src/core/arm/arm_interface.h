@@ -5,6 +5,8 @@
 #pragma once
 
 #include <array>
+#include <utility>
+#include <vector>
 #include "common/common_types.h"
 #include "core/hle/kernel/vm_manager.h"
 
@@ -28,10 +30,13 @@ public:
     /**
      * Runs the CPU for the given number of instructions
      * @param num_instructions Number of instructions to run
+     * @return Number of cycles actually consumed, which is less than requested if execution was
+     *         halted early (e.g. for a reschedule)
      */
-    void Run(int num_instructions) {
-        ExecuteInstructions(num_instructions);
-        this->num_instructions += num_instructions;
+    u64 Run(int num_instructions) {
+        const u64 cycles = ExecuteInstructions(num_instructions);
+        this->num_instructions += cycles;
+        return cycles;
     }
 
     /// Step CPU by one instruction
@@ -45,6 +50,42 @@ public:
     /// Clear all instruction cache
     virtual void ClearInstructionCache() = 0;
 
+    /**
+     * Invalidates the instructions translated from a range of guest memory, after it has been
+     * written to. It can be called from any thread, and takes effect before the core executes
+     * anything else.
+     */
+    virtual void InvalidateCacheRange(VAddr start, size_t length) {}
+
+    /// Gets the host memory used by translated code, or 0 if the backend can't tell
+    virtual size_t GetCodeCacheMemoryUsage() const {
+        return 0;
+    }
+
+    /// Statistics about the execution of guest code since the CPU was created
+    struct JitStats {
+        /// Number of guest PCs needing the interpreter fallback that are reported
+        static constexpr size_t MAX_REPORTED_FALLBACK_PCS = 10;
+
+        u64 runs = 0;                     ///< Calls to Run
+        u64 run_time_ns = 0;              ///< Host time spent in Run
+        u64 halts = 0;                    ///< Requests to stop running early, e.g. to reschedule
+        u64 cache_clears = 0;             ///< Times all the translated code was thrown away
+        u64 cache_invalidations = 0;      ///< Guest memory ranges whose code was dropped
+        u64 invalidated_bytes = 0;        ///< Total size of those ranges
+        u64 translator_resets = 0;        ///< Times the translator was recreated
+        u64 interpreter_fallbacks = 0;    ///< Times the interpreter ran instructions instead
+        u64 interpreted_instructions = 0; ///< Instructions run by the interpreter fallback
+        u64 svcs = 0;                     ///< Supervisor calls made by the guest
+        /// Guest PCs that needed the interpreter fallback most often, with their number of hits
+        std::vector<std::pair<VAddr, u64>> top_fallback_pcs;
+    };
+
+    /// Gets the statistics of the backend, which can be called from any thread
+    virtual JitStats GetJitStats() const {
+        return {};
+    }
+
     /// Notify CPU emulation that page tables have changed
     virtual void PageTableChanged() = 0;
 
@@ -74,6 +115,30 @@ public:
      */
     virtual void SetReg(int index, u64 value) = 0;
 
+    /// Registers the SVCs take their arguments in and return their results in, X0 to X7
+    using SvcRegisters = std::array<u64, 8>;
+
+    /**
+     * Gets the registers the SVCs take their arguments in, with a single call
+     * @param regs Where to store the values of X0 to X7
+     */
+    virtual void GetSvcRegisters(SvcRegisters& regs) const {
+        for (size_t index = 0; index < regs.size(); ++index) {
+            regs[index] = GetReg(static_cast<int>(index));
+        }
+    }
+
+    /**
+     * Sets the registers the SVCs return their results in, with a single call
+     * @param regs Values to set the registers to
+     * @param count Number of registers to set, starting from X0
+     */
+    virtual void SetSvcRegisters(const SvcRegisters& regs, size_t count) {
+        for (size_t index = 0; index < count; ++index) {
+            SetReg(static_cast<int>(index), regs[index]);
+        }
+    }
+
     virtual u128 GetExtReg(int index) const = 0;
 
     virtual void SetExtReg(int index, u128 value) = 0;
@@ -120,6 +185,14 @@ public:
      */
     virtual void LoadContext(const ThreadContext& ctx) = 0;
 
+    /**
+     * Loads a CPU context except for its vector registers, when the CPU still holds them
+     * @param ctx Thread context to load
+     */
+    virtual void LoadContextExceptVectors(const ThreadContext& ctx) {
+        LoadContext(ctx);
+    }
+
     /// Prepare core for thread reschedule (if needed to correctly handle state)
     virtual void PrepareReschedule() = 0;
 
@@ -132,8 +205,9 @@ protected:
     /**
      * Executes the given number of instructions
      * @param num_instructions Number of instructions to executes
+     * @return Number of cycles consumed by the executed instructions
      */
-    virtual void ExecuteInstructions(int num_instructions) = 0;
+    virtual u64 ExecuteInstructions(int num_instructions) = 0;
 
 private:
     u64 num_instructions = 0; ///< Number of instructions executed
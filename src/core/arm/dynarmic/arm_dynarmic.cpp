@@ -2,12 +2,19 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <chrono>
 #include <cinttypes>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <dynarmic/A64/a64.h>
 #include <dynarmic/A64/config.h>
+#include "common/logging/log.h"
+#include "common/microprofile.h"
 #include "core/arm/dynarmic/arm_dynarmic.h"
-#include "core/core_timing.h"
 #include "core/hle/kernel/svc.h"
 #include "core/memory.h"
 
@@ -43,12 +50,24 @@ public:
     }
 
     void InterpreterFallback(u64 pc, size_t num_instructions) override {
-        ARM_Interface::ThreadContext ctx;
-        parent.SaveContext(ctx);
-        parent.inner_unicorn.LoadContext(ctx);
-        parent.inner_unicorn.ExecuteInstructions(num_instructions);
-        parent.inner_unicorn.SaveContext(ctx);
-        parent.LoadContext(ctx);
+        bool is_first_hit;
+        {
+            std::lock_guard<std::mutex> lock(fallback_mutex);
+            is_first_hit = fallback_hits[pc]++ == 0;
+        }
+        if (is_first_hit) {
+            LOG_DEBUG(Core_ARM, "Interpreter fallback @ 0x%016" PRIx64 " (instr=0x%08X), %zu "
+                                "instructions",
+                      pc, Memory::Read32(pc), num_instructions);
+        }
+        ++parent.counters.interpreter_fallbacks;
+
+        // The fallback context is kept in sync with the inner Unicorn instance, so only the
+        // registers dynarmic touched since the last fallback are transferred to it.
+        parent.SaveContext(fallback_context);
+        fallback_context.pc = pc;
+        parent.inner_unicorn.ExecuteInstructionsOnContext(fallback_context, num_instructions);
+        parent.LoadContext(fallback_context);
         num_interpreted_instructions += num_instructions;
     }
 
@@ -57,16 +76,14 @@ public:
     }
 
     void CallSVC(u32 swi) override {
-        printf("svc %x\n", swi);
+        ++num_svcs;
         Kernel::CallSVC(swi);
     }
 
     void AddTicks(u64 ticks) override {
-        if (ticks > ticks_remaining) {
-            ticks_remaining = 0;
-            return;
-        }
-        ticks -= ticks_remaining;
+        // Blocks are charged as a whole, so the JIT may overshoot its budget slightly
+        ticks_executed += ticks;
+        ticks_remaining = ticks < ticks_remaining ? ticks_remaining - ticks : 0;
     }
     u64 GetTicksRemaining() override {
         return ticks_remaining;
@@ -74,19 +91,85 @@ public:
 
     ARM_Dynarmic& parent;
     size_t ticks_remaining = 0;
-    size_t num_interpreted_instructions = 0;
+    /// Statistics for the current ExecuteInstructions call
+    u64 ticks_executed = 0;
+    u64 num_interpreted_instructions = 0;
+    u64 num_svcs = 0;
+    /// Number of times each guest PC needed the interpreter fallback, read from other threads
+    std::unordered_map<u64, u64> fallback_hits;
+    mutable std::mutex fallback_mutex;
+    ARM_Interface::ThreadContext fallback_context{};
     u64 tpidrr0_el0 = 0;
 };
 
+static std::unique_ptr<Dynarmic::A64::Jit> MakeJit(ARM_Dynarmic_Callbacks* cb,
+                                                   Memory::PageTable* page_table) {
+    Dynarmic::A64::UserConfig config{cb};
+    if (page_table) {
+        // Let the JIT resolve accesses to regular memory inline, only calling back into us for
+        // unmapped, MMIO and rasterizer-cached pages (whose pointers are null).
+        config.page_table = reinterpret_cast<void**>(page_table->pointers.data());
+    }
+    return std::make_unique<Dynarmic::A64::Jit>(config);
+}
+
 ARM_Dynarmic::ARM_Dynarmic()
     : cb(std::make_unique<ARM_Dynarmic_Callbacks>(*this)),
-      jit(Dynarmic::A64::UserConfig{cb.get()}) {
+      jit(MakeJit(cb.get(), Memory::GetCurrentPageTable())),
+      current_page_table(Memory::GetCurrentPageTable()) {
     ARM_Interface::ThreadContext ctx;
     inner_unicorn.SaveContext(ctx);
     LoadContext(ctx);
 }
 
-ARM_Dynarmic::~ARM_Dynarmic() = default;
+ARM_Dynarmic::~ARM_Dynarmic() {
+    LogInterpreterFallbackHits();
+}
+
+/// Returns the guest PCs that needed the interpreter fallback, the most frequent first
+static std::vector<std::pair<u64, u64>> GetSortedFallbackHits(const ARM_Dynarmic_Callbacks& cb) {
+    std::vector<std::pair<u64, u64>> hits;
+    {
+        std::lock_guard<std::mutex> lock(cb.fallback_mutex);
+        hits.assign(cb.fallback_hits.begin(), cb.fallback_hits.end());
+    }
+    std::sort(hits.begin(), hits.end(),
+              [](const auto& a, const auto& b) { return a.second > b.second; });
+    return hits;
+}
+
+void ARM_Dynarmic::LogInterpreterFallbackHits() const {
+    const std::vector<std::pair<u64, u64>> hits = GetSortedFallbackHits(*cb);
+    if (hits.empty()) {
+        return;
+    }
+
+    LOG_INFO(Core_ARM, "Interpreter fallback was needed at %zu guest PCs, most frequent:",
+             hits.size());
+    for (size_t i = 0; i < std::min(hits.size(), JitStats::MAX_REPORTED_FALLBACK_PCS); ++i) {
+        LOG_INFO(Core_ARM, "  0x%016" PRIx64 ": %" PRIu64 " hits", hits[i].first,
+                 hits[i].second);
+    }
+}
+
+ARM_Interface::JitStats ARM_Dynarmic::GetJitStats() const {
+    JitStats stats;
+    stats.runs = counters.runs;
+    stats.run_time_ns = counters.run_time_ns;
+    stats.halts = counters.halts;
+    stats.cache_clears = counters.cache_clears;
+    stats.cache_invalidations = counters.cache_invalidations;
+    stats.invalidated_bytes = counters.invalidated_bytes;
+    stats.translator_resets = counters.translator_resets;
+    stats.interpreter_fallbacks = counters.interpreter_fallbacks;
+    stats.interpreted_instructions = counters.interpreted_instructions;
+    stats.svcs = counters.svcs;
+
+    std::vector<std::pair<u64, u64>> hits = GetSortedFallbackHits(*cb);
+    hits.resize(std::min(hits.size(), JitStats::MAX_REPORTED_FALLBACK_PCS));
+    stats.top_fallback_pcs = std::move(hits);
+    return stats;
+}
 
 void ARM_Dynarmic::MapBackingMemory(u64 address, size_t size, u8* memory,
                                     Kernel::VMAPermission perms) {
@@ -94,27 +177,38 @@ void ARM_Dynarmic::MapBackingMemory(u64 address, size_t size, u8* memory,
 }
 
 void ARM_Dynarmic::SetPC(u64 pc) {
-    jit.SetPC(pc);
+    jit->SetPC(pc);
 }
 
 u64 ARM_Dynarmic::GetPC() const {
-    return jit.GetPC();
+    return jit->GetPC();
 }
 
 u64 ARM_Dynarmic::GetReg(int index) const {
-    return jit.GetRegister(index);
+    return jit->GetRegister(index);
 }
 
 void ARM_Dynarmic::SetReg(int index, u64 value) {
-    jit.SetRegister(index, value);
+    jit->SetRegister(index, value);
+}
+
+void ARM_Dynarmic::GetSvcRegisters(SvcRegisters& regs) const {
+    const auto& registers = jit->GetRegisters();
+    std::copy_n(registers.begin(), regs.size(), regs.begin());
+}
+
+void ARM_Dynarmic::SetSvcRegisters(const SvcRegisters& regs, size_t count) {
+    for (size_t index = 0; index < count; ++index) {
+        jit->SetRegister(index, regs[index]);
+    }
 }
 
 u128 ARM_Dynarmic::GetExtReg(int index) const {
-    return jit.GetVector(index);
+    return jit->GetVector(index);
 }
 
 void ARM_Dynarmic::SetExtReg(int index, u128 value) {
-    jit.SetVector(index, value);
+    jit->SetVector(index, value);
 }
 
 u32 ARM_Dynarmic::GetVFPReg(int /*index*/) const {
@@ -127,11 +221,11 @@ void ARM_Dynarmic::SetVFPReg(int /*index*/, u32 /*value*/) {
 }
 
 u32 ARM_Dynarmic::GetCPSR() const {
-    return jit.GetPstate();
+    return jit->GetPstate();
 }
 
 void ARM_Dynarmic::SetCPSR(u32 cpsr) {
-    jit.SetPstate(cpsr);
+    jit->SetPstate(cpsr);
 }
 
 u64 ARM_Dynarmic::GetTlsAddress() const {
@@ -142,43 +236,106 @@ void ARM_Dynarmic::SetTlsAddress(u64 address) {
     cb->tpidrr0_el0 = address;
 }
 
-void ARM_Dynarmic::ExecuteInstructions(int num_instructions) {
+void ARM_Dynarmic::SetTickWeights(const TickWeights& weights) {
+    tick_weights = weights;
+}
+
+MICROPROFILE_DEFINE(ARM_Jit_Dynarmic, "ARM JIT", "Dynarmic", MP_RGB(255, 64, 64));
+
+u64 ARM_Dynarmic::ExecuteInstructions(int num_instructions) {
+    MICROPROFILE_SCOPE(ARM_Jit_Dynarmic);
     cb->ticks_remaining = num_instructions;
-    jit.Run();
-    CoreTiming::AddTicks(num_instructions - cb->num_interpreted_instructions);
+    cb->ticks_executed = 0;
     cb->num_interpreted_instructions = 0;
+    cb->num_svcs = 0;
+
+    PerformPendingInvalidations();
+    const auto start = std::chrono::steady_clock::now();
+    jit->Run();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    ++counters.runs;
+    counters.run_time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    counters.interpreted_instructions += cb->num_interpreted_instructions;
+    counters.svcs += cb->num_svcs;
+
+    // The JIT's own count includes the instructions it handed to the interpreter fallback
+    const u64 interpreted = std::min(cb->num_interpreted_instructions, cb->ticks_executed);
+    return (cb->ticks_executed - interpreted) * tick_weights.jit_instruction +
+           interpreted * tick_weights.interpreted_instruction + cb->num_svcs * tick_weights.svc;
 }
 
 void ARM_Dynarmic::SaveContext(ARM_Interface::ThreadContext& ctx) {
-    ctx.cpu_registers = jit.GetRegisters();
-    ctx.sp = jit.GetSP();
-    ctx.pc = jit.GetPC();
-    ctx.cpsr = jit.GetPstate();
-    ctx.fpu_registers = jit.GetVectors();
-    ctx.fpscr = jit.GetFpcr();
+    ctx.cpu_registers = jit->GetRegisters();
+    ctx.sp = jit->GetSP();
+    ctx.pc = jit->GetPC();
+    ctx.cpsr = jit->GetPstate();
+    ctx.fpu_registers = jit->GetVectors();
+    ctx.fpscr = jit->GetFpcr();
     ctx.tls_address = cb->tpidrr0_el0;
 }
 
 void ARM_Dynarmic::LoadContext(const ARM_Interface::ThreadContext& ctx) {
-    jit.SetRegisters(ctx.cpu_registers);
-    jit.SetSP(ctx.sp);
-    jit.SetPC(ctx.pc);
-    jit.SetPstate(ctx.cpsr);
-    jit.SetVectors(ctx.fpu_registers);
-    jit.SetFpcr(ctx.fpscr);
+    LoadContextExceptVectors(ctx);
+    jit->SetVectors(ctx.fpu_registers);
+}
+
+void ARM_Dynarmic::LoadContextExceptVectors(const ARM_Interface::ThreadContext& ctx) {
+    jit->SetRegisters(ctx.cpu_registers);
+    jit->SetSP(ctx.sp);
+    jit->SetPC(ctx.pc);
+    jit->SetPstate(ctx.cpsr);
+    jit->SetFpcr(ctx.fpscr);
     cb->tpidrr0_el0 = ctx.tls_address;
 }
 
 void ARM_Dynarmic::PrepareReschedule() {
-    if (jit.IsExecuting()) {
-        jit.HaltExecution();
+    if (jit->IsExecuting()) {
+        jit->HaltExecution();
+        ++counters.halts;
     }
 }
 
 void ARM_Dynarmic::ClearInstructionCache() {
-    jit.ClearCache();
+    jit->ClearCache();
+    ++counters.cache_clears;
+}
+
+void ARM_Dynarmic::InvalidateCacheRange(VAddr start, size_t length) {
+    {
+        std::lock_guard<std::mutex> lock(invalidation_mutex);
+        pending_invalidations.emplace_back(start, length);
+    }
+    ++counters.cache_invalidations;
+    counters.invalidated_bytes += length;
+
+    // The write may come from the JIT itself, or from another core while this one is running
+    if (jit->IsExecuting()) {
+        jit->HaltExecution();
+        ++counters.halts;
+    }
+}
+
+void ARM_Dynarmic::PerformPendingInvalidations() {
+    std::lock_guard<std::mutex> lock(invalidation_mutex);
+    for (const auto& range : pending_invalidations) {
+        jit->InvalidateCacheRange(range.first, range.second);
+    }
+    pending_invalidations.clear();
 }
 
 void ARM_Dynarmic::PageTableChanged() {
-    UNIMPLEMENTED();
+    Memory::PageTable* const new_page_table = Memory::GetCurrentPageTable();
+    if (new_page_table == current_page_table) {
+        return;
+    }
+
+    // The page table is baked into the JIT's configuration, so a new instance is needed to point
+    // it at the new address space. Carry the register state over so callers don't notice.
+    ARM_Interface::ThreadContext ctx;
+    SaveContext(ctx);
+    jit = MakeJit(cb.get(), new_page_table);
+    current_page_table = new_page_table;
+    ++counters.translator_resets;
+    LoadContext(ctx);
 }
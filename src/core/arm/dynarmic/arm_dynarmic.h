@@ -4,7 +4,11 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 #include <dynarmic/A64/a64.h>
 #include "common/common_types.h"
 #include "core/arm/arm_interface.h"
@@ -14,6 +18,13 @@ class ARM_Dynarmic_Callbacks;
 
 class ARM_Dynarmic final : public ARM_Interface {
 public:
+    /// Cycles charged for each class of guest instruction
+    struct TickWeights {
+        u64 jit_instruction = 1;         ///< Instruction executed by the JIT
+        u64 interpreted_instruction = 1; ///< Instruction handed to the interpreter fallback
+        u64 svc = 0;                     ///< Extra cost of a supervisor call, on top of the SVC
+    };
+
     ARM_Dynarmic();
     ~ARM_Dynarmic();
 
@@ -24,6 +35,8 @@ public:
     u64 GetPC() const override;
     u64 GetReg(int index) const override;
     void SetReg(int index, u64 value) override;
+    void GetSvcRegisters(SvcRegisters& regs) const override;
+    void SetSvcRegisters(const SvcRegisters& regs, size_t count) override;
     u128 GetExtReg(int index) const override;
     void SetExtReg(int index, u128 value) override;
     u32 GetVFPReg(int index) const override;
@@ -35,16 +48,52 @@ public:
 
     void SaveContext(ThreadContext& ctx) override;
     void LoadContext(const ThreadContext& ctx) override;
+    void LoadContextExceptVectors(const ThreadContext& ctx) override;
 
     void PrepareReschedule() override;
-    void ExecuteInstructions(int num_instructions) override;
+    u64 ExecuteInstructions(int num_instructions) override;
 
     void ClearInstructionCache() override;
+    void InvalidateCacheRange(VAddr start, size_t length) override;
     void PageTableChanged() override;
 
+    JitStats GetJitStats() const override;
+
+    /// Changes how many cycles each class of guest instruction is charged
+    void SetTickWeights(const TickWeights& weights);
+
+    /// Logs the guest PCs where the interpreter fallback was needed most often
+    void LogInterpreterFallbackHits() const;
+
 private:
     friend class ARM_Dynarmic_Callbacks;
     std::unique_ptr<ARM_Dynarmic_Callbacks> cb;
-    Dynarmic::A64::Jit jit;
+    std::unique_ptr<Dynarmic::A64::Jit> jit;
     ARM_Unicorn inner_unicorn;
+
+    /// Page table the JIT currently performs its inline lookups against
+    Memory::PageTable* current_page_table = nullptr;
+
+    TickWeights tick_weights;
+
+    /// Counters of GetJitStats, updated by the core's thread and read from any other
+    struct Counters {
+        std::atomic<u64> runs{0};
+        std::atomic<u64> run_time_ns{0};
+        std::atomic<u64> halts{0};
+        std::atomic<u64> cache_clears{0};
+        std::atomic<u64> cache_invalidations{0};
+        std::atomic<u64> invalidated_bytes{0};
+        std::atomic<u64> translator_resets{0};
+        std::atomic<u64> interpreter_fallbacks{0};
+        std::atomic<u64> interpreted_instructions{0};
+        std::atomic<u64> svcs{0};
+    };
+    Counters counters;
+
+    /// Ranges to invalidate before running the JIT again, they may be added from any thread
+    std::vector<std::pair<VAddr, size_t>> pending_invalidations;
+    std::mutex invalidation_mutex;
+
+    void PerformPendingInvalidations();
 };
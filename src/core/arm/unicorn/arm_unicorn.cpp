@@ -2,12 +2,14 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <unicorn/arm64.h>
 #include "common/assert.h"
 #include "common/microprofile.h"
 #include "core/arm/unicorn/arm_unicorn.h"
 #include "core/core.h"
-#include "core/core_timing.h"
 #include "core/hle/kernel/svc.h"
 
 // Load Unicorn DLL once on Windows using RAII
@@ -56,6 +58,75 @@ static bool UnmappedMemoryHook(uc_engine* uc, uc_mem_type type, u64 addr, int si
     return {};
 }
 
+/// Converts a general purpose register index (31 being SP) to its Unicorn identifier
+static uc_arm64_reg ToUnicornRegister(int index) {
+    if (index <= 28) {
+        return static_cast<uc_arm64_reg>(UC_ARM64_REG_X0 + index);
+    }
+    if (index < 31) {
+        return static_cast<uc_arm64_reg>(UC_ARM64_REG_X29 + index - 29);
+    }
+    return UC_ARM64_REG_SP;
+}
+
+/// Number of registers in a ThreadContext transferred to and from Unicorn, all but the FPCR
+constexpr size_t NUM_CONTEXT_REGISTERS = 31 + 4 + 32;
+/// Index of the PC in the context registers
+constexpr size_t CONTEXT_PC_INDEX = 32;
+/// Index of the first vector register in the context registers, the others are 64-bit
+constexpr size_t CONTEXT_FIRST_VECTOR_INDEX = 35;
+
+/// Unicorn identifiers of the context registers, in the order of GetContextPointers
+static std::array<int, NUM_CONTEXT_REGISTERS> MakeContextRegisters() {
+    std::array<int, NUM_CONTEXT_REGISTERS> registers{};
+    for (int i = 0; i < 31; ++i) {
+        registers[i] = ToUnicornRegister(i);
+    }
+    registers[31] = UC_ARM64_REG_SP;
+    registers[CONTEXT_PC_INDEX] = UC_ARM64_REG_PC;
+    registers[33] = UC_ARM64_REG_NZCV;
+    registers[34] = UC_ARM64_REG_TPIDRRO_EL0;
+    for (int i = 0; i < 32; ++i) {
+        registers[CONTEXT_FIRST_VECTOR_INDEX + i] = UC_ARM64_REG_Q0 + i;
+    }
+    return registers;
+}
+
+static std::array<int, NUM_CONTEXT_REGISTERS> context_registers = MakeContextRegisters();
+
+/// Returns where the context registers are stored in a context, to transfer them in one batch
+static std::array<void*, NUM_CONTEXT_REGISTERS> GetContextPointers(
+    const ARM_Interface::ThreadContext& ctx) {
+    // Unicorn takes non-const pointers even to write its registers
+    auto& values = const_cast<ARM_Interface::ThreadContext&>(ctx);
+    std::array<void*, NUM_CONTEXT_REGISTERS> pointers{};
+    for (size_t i = 0; i < 31; ++i) {
+        pointers[i] = &values.cpu_registers[i];
+    }
+    pointers[31] = &values.sp;
+    pointers[CONTEXT_PC_INDEX] = &values.pc;
+    pointers[33] = &values.cpsr;
+    pointers[34] = &values.tls_address;
+    for (size_t i = 0; i < 32; ++i) {
+        pointers[CONTEXT_FIRST_VECTOR_INDEX + i] = &values.fpu_registers[i];
+    }
+    return pointers;
+}
+
+void ARM_Unicorn::BlockHook(uc_engine* uc, u64 address, u32 size, void* user_data) {
+    BlockBudget& budget = *static_cast<BlockBudget*>(user_data);
+    if (!budget.enabled) {
+        return;
+    }
+
+    // The block is charged as a whole when entered, so execution stops at the first block
+    // boundary past the budget
+    budget.executed += std::max<u32>(size / 4, 1);
+    if (budget.executed >= budget.limit) {
+        CHECKED(uc_emu_stop(uc));
+    }
+}
+
 ARM_Unicorn::ARM_Unicorn() {
     CHECKED(uc_open(UC_ARCH_ARM64, UC_MODE_ARM, &uc));
 
@@ -65,6 +136,8 @@ ARM_Unicorn::ARM_Unicorn() {
     uc_hook hook{};
     CHECKED(uc_hook_add(uc, &hook, UC_HOOK_INTR, (void*)InterruptHook, this, 0, -1));
     CHECKED(uc_hook_add(uc, &hook, UC_HOOK_MEM_INVALID, (void*)UnmappedMemoryHook, this, 0, -1));
+    // Installed up front, as only the blocks translated while a hook exists call it
+    CHECKED(uc_hook_add(uc, &hook, UC_HOOK_BLOCK, (void*)BlockHook, &block_budget, 0, -1));
 }
 
 ARM_Unicorn::~ARM_Unicorn() {
@@ -77,6 +150,7 @@ void ARM_Unicorn::MapBackingMemory(VAddr address, size_t size, u8* memory,
 }
 
 void ARM_Unicorn::SetPC(u64 pc) {
+    shared_context_valid = false;
     CHECKED(uc_reg_write(uc, UC_ARM64_REG_PC, &pc));
 }
 
@@ -88,24 +162,34 @@ u64 ARM_Unicorn::GetPC() const {
 
 u64 ARM_Unicorn::GetReg(int regn) const {
     u64 val{};
-    auto treg = UC_ARM64_REG_SP;
-    if (regn <= 28) {
-        treg = (uc_arm64_reg)(UC_ARM64_REG_X0 + regn);
-    } else if (regn < 31) {
-        treg = (uc_arm64_reg)(UC_ARM64_REG_X29 + regn - 29);
-    }
-    CHECKED(uc_reg_read(uc, treg, &val));
+    CHECKED(uc_reg_read(uc, ToUnicornRegister(regn), &val));
     return val;
 }
 
 void ARM_Unicorn::SetReg(int regn, u64 val) {
-    auto treg = UC_ARM64_REG_SP;
-    if (regn <= 28) {
-        treg = (uc_arm64_reg)(UC_ARM64_REG_X0 + regn);
-    } else if (regn < 31) {
-        treg = (uc_arm64_reg)(UC_ARM64_REG_X29 + regn - 29);
+    shared_context_valid = false;
+    CHECKED(uc_reg_write(uc, ToUnicornRegister(regn), &val));
+}
+
+void ARM_Unicorn::GetSvcRegisters(SvcRegisters& regs) const {
+    int uregs[std::tuple_size<SvcRegisters>::value];
+    void* tregs[std::tuple_size<SvcRegisters>::value];
+    for (size_t index = 0; index < regs.size(); ++index) {
+        uregs[index] = ToUnicornRegister(static_cast<int>(index));
+        tregs[index] = &regs[index];
     }
-    CHECKED(uc_reg_write(uc, treg, &val));
+    CHECKED(uc_reg_read_batch(uc, uregs, tregs, static_cast<int>(regs.size())));
+}
+
+void ARM_Unicorn::SetSvcRegisters(const SvcRegisters& regs, size_t count) {
+    shared_context_valid = false;
+    int uregs[std::tuple_size<SvcRegisters>::value];
+    void* tregs[std::tuple_size<SvcRegisters>::value];
+    for (size_t index = 0; index < count; ++index) {
+        uregs[index] = ToUnicornRegister(static_cast<int>(index));
+        tregs[index] = const_cast<u64*>(&regs[index]);
+    }
+    CHECKED(uc_reg_write_batch(uc, uregs, tregs, static_cast<int>(count)));
 }
 
 u128 ARM_Unicorn::GetExtReg(int /*index*/) const {
@@ -134,6 +218,7 @@ u32 ARM_Unicorn::GetCPSR() const {
 }
 
 void ARM_Unicorn::SetCPSR(u32 cpsr) {
+    shared_context_valid = false;
     u64 nzcv = cpsr;
     CHECKED(uc_reg_write(uc, UC_ARM64_REG_NZCV, &nzcv));
 }
@@ -145,73 +230,78 @@ VAddr ARM_Unicorn::GetTlsAddress() const {
 }
 
 void ARM_Unicorn::SetTlsAddress(VAddr base) {
+    shared_context_valid = false;
     CHECKED(uc_reg_write(uc, UC_ARM64_REG_TPIDRRO_EL0, &base));
 }
 
 MICROPROFILE_DEFINE(ARM_Jit, "ARM JIT", "ARM JIT", MP_RGB(255, 64, 64));
 
-void ARM_Unicorn::ExecuteInstructions(int num_instructions) {
+u64 ARM_Unicorn::ExecuteInstructions(int num_instructions) {
     MICROPROFILE_SCOPE(ARM_Jit);
-    CHECKED(uc_emu_start(uc, GetPC(), 1ULL << 63, 0, num_instructions));
-    CoreTiming::AddTicks(num_instructions);
-}
-
-void ARM_Unicorn::SaveContext(ARM_Interface::ThreadContext& ctx) {
-    int uregs[32];
-    void* tregs[32];
+    shared_context_valid = false;
 
-    CHECKED(uc_reg_read(uc, UC_ARM64_REG_SP, &ctx.sp));
-    CHECKED(uc_reg_read(uc, UC_ARM64_REG_PC, &ctx.pc));
-    CHECKED(uc_reg_read(uc, UC_ARM64_REG_NZCV, &ctx.cpsr));
-
-    for (auto i = 0; i < 29; ++i) {
-        uregs[i] = UC_ARM64_REG_X0 + i;
-        tregs[i] = &ctx.cpu_registers[i];
+    if (num_instructions <= 1) {
+        // Single steps must stop after exactly one instruction, which takes the count limit.
+        // Unicorn doesn't tell us how many instructions ran when it is stopped early.
+        CHECKED(uc_emu_start(uc, GetPC(), 1ULL << 63, 0, num_instructions));
+        return static_cast<u64>(num_instructions);
     }
-    uregs[29] = UC_ARM64_REG_X29;
-    tregs[29] = (void*)&ctx.cpu_registers[29];
-    uregs[30] = UC_ARM64_REG_X30;
-    tregs[30] = (void*)&ctx.cpu_registers[30];
-
-    CHECKED(uc_reg_read_batch(uc, uregs, tregs, 31));
-
-    ctx.tls_address = GetTlsAddress();
 
-    for (int i = 0; i < 32; ++i) {
-        uregs[i] = UC_ARM64_REG_Q0 + i;
-        tregs[i] = &ctx.fpu_registers[i];
-    }
-
-    CHECKED(uc_reg_read_batch(uc, uregs, tregs, 32));
+    // The count limit calls a hook on every instruction, the block budget only once per block
+    block_budget.enabled = true;
+    block_budget.executed = 0;
+    block_budget.limit = static_cast<u64>(num_instructions);
+    CHECKED(uc_emu_start(uc, GetPC(), 1ULL << 63, 0, 0));
+    block_budget.enabled = false;
+    return block_budget.executed;
 }
 
-void ARM_Unicorn::LoadContext(const ARM_Interface::ThreadContext& ctx) {
-    int uregs[32];
-    void* tregs[32];
-
-    CHECKED(uc_reg_write(uc, UC_ARM64_REG_SP, &ctx.sp));
-    CHECKED(uc_reg_write(uc, UC_ARM64_REG_PC, &ctx.pc));
-    CHECKED(uc_reg_write(uc, UC_ARM64_REG_NZCV, &ctx.cpsr));
-
-    for (int i = 0; i < 29; ++i) {
-        uregs[i] = UC_ARM64_REG_X0 + i;
-        tregs[i] = (void*)&ctx.cpu_registers[i];
+void ARM_Unicorn::ExecuteInstructionsOnContext(ThreadContext& ctx, size_t num_instructions) {
+    if (!shared_context_valid) {
+        LoadContext(ctx);
+    } else {
+        // Only transfer what changed since Unicorn last ran on this context, the PC is passed
+        // to uc_emu_start
+        const std::array<void*, NUM_CONTEXT_REGISTERS> values = GetContextPointers(ctx);
+        const std::array<void*, NUM_CONTEXT_REGISTERS> previous =
+            GetContextPointers(shared_context);
+        std::array<int, NUM_CONTEXT_REGISTERS> uregs;
+        std::array<void*, NUM_CONTEXT_REGISTERS> tregs;
+        int count = 0;
+        for (size_t i = 0; i < NUM_CONTEXT_REGISTERS; ++i) {
+            const size_t size = i < CONTEXT_FIRST_VECTOR_INDEX ? sizeof(u64) : sizeof(u128);
+            if (i == CONTEXT_PC_INDEX || std::memcmp(values[i], previous[i], size) == 0) {
+                continue;
+            }
+            uregs[count] = context_registers[i];
+            tregs[count] = values[i];
+            ++count;
+        }
+        if (count > 0) {
+            CHECKED(uc_reg_write_batch(uc, uregs.data(), tregs.data(), count));
+        }
     }
-    uregs[29] = UC_ARM64_REG_X29;
-    tregs[29] = (void*)&ctx.cpu_registers[29];
-    uregs[30] = UC_ARM64_REG_X30;
-    tregs[30] = (void*)&ctx.cpu_registers[30];
 
-    CHECKED(uc_reg_write_batch(uc, uregs, tregs, 31));
+    MICROPROFILE_SCOPE(ARM_Jit);
+    CHECKED(uc_emu_start(uc, ctx.pc, 1ULL << 63, 0, num_instructions));
 
-    SetTlsAddress(ctx.tls_address);
+    // Everything but the FPCR, which Unicorn doesn't track, comes back from the interpreter
+    SaveContext(ctx);
+    shared_context = ctx;
+    shared_context_valid = true;
+}
 
-    for (auto i = 0; i < 32; ++i) {
-        uregs[i] = UC_ARM64_REG_Q0 + i;
-        tregs[i] = (void*)&ctx.fpu_registers[i];
-    }
+void ARM_Unicorn::SaveContext(ARM_Interface::ThreadContext& ctx) {
+    std::array<void*, NUM_CONTEXT_REGISTERS> values = GetContextPointers(ctx);
+    CHECKED(uc_reg_read_batch(uc, context_registers.data(), values.data(),
+                              static_cast<int>(NUM_CONTEXT_REGISTERS)));
+}
 
-    CHECKED(uc_reg_write_batch(uc, uregs, tregs, 32));
+void ARM_Unicorn::LoadContext(const ARM_Interface::ThreadContext& ctx) {
+    shared_context_valid = false;
+    std::array<void*, NUM_CONTEXT_REGISTERS> values = GetContextPointers(ctx);
+    CHECKED(uc_reg_write_batch(uc, context_registers.data(), values.data(),
+                               static_cast<int>(NUM_CONTEXT_REGISTERS)));
 }
 
 void ARM_Unicorn::PrepareReschedule() {
@@ -18,6 +18,8 @@ public:
     u64 GetPC() const override;
     u64 GetReg(int index) const override;
     void SetReg(int index, u64 value) override;
+    void GetSvcRegisters(SvcRegisters& regs) const override;
+    void SetSvcRegisters(const SvcRegisters& regs, size_t count) override;
     u128 GetExtReg(int index) const override;
     void SetExtReg(int index, u128 value) override;
     u32 GetVFPReg(int index) const override;
@@ -29,10 +31,35 @@ public:
     void SaveContext(ThreadContext& ctx) override;
     void LoadContext(const ThreadContext& ctx) override;
     void PrepareReschedule() override;
-    void ExecuteInstructions(int num_instructions) override;
+    u64 ExecuteInstructions(int num_instructions) override;
     void ClearInstructionCache() override;
     void PageTableChanged() override{};
 
+    /**
+     * Executes instructions on a context owned by another CPU backend, e.g. to interpret the
+     * instructions a JIT can't handle. Registers that still hold the values left behind by the
+     * previous call aren't transferred again, which keeps repeated fallbacks cheap. Unlike
+     * ExecuteInstructions, it stops after exactly the given number of instructions.
+     * @param ctx Context to execute on, updated with the resulting state
+     * @param num_instructions Number of instructions to execute
+     */
+    void ExecuteInstructionsOnContext(ThreadContext& ctx, size_t num_instructions);
+
 private:
+    /// Instruction budget of ExecuteInstructions, charged by BlockHook as blocks are entered
+    struct BlockBudget {
+        bool enabled = false;
+        u64 executed = 0;
+        u64 limit = 0;
+    };
+
+    static void BlockHook(uc_engine* uc, u64 address, u32 size, void* user_data);
+
     uc_engine* uc{};
+    BlockBudget block_budget;
+
+    /// Register state Unicorn was left with by the last ExecuteInstructionsOnContext call
+    ThreadContext shared_context{};
+    /// Whether shared_context still matches the Unicorn register state
+    bool shared_context_valid = false;
 };
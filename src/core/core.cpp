@@ -2,31 +2,55 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
 #include <utility>
+#include "common/assert.h"
+#include "common/kernel_dispatch.h"
 #include "common/logging/log.h"
-#include "core/arm/dynarmic/arm_dynarmic.h"
-#include "core/arm/unicorn/arm_unicorn.h"
+#include "common/microprofile.h"
+#include "common/thread.h"
+#include "core/arm/arm_interface.h"
 #include "core/core.h"
+#include "core/core_cpu.h"
 #include "core/core_timing.h"
+#include "core/file_sys/block_cache.h"
 #include "core/gdbstub/gdbstub.h"
+#include "core/hle/lock.h"
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/kernel/process.h"
+#include "core/hle/kernel/shared_memory.h"
 #include "core/hle/kernel/thread.h"
 #include "core/hle/service/service.h"
 #include "core/hw/hw.h"
 #include "core/loader/loader.h"
+#include "core/loader/symbols.h"
+#include "core/memory_compactor.h"
 #include "core/memory_setup.h"
+#include "core/movie.h"
 #include "core/settings.h"
+#include "core/title_profile.h"
+#include "core/tracer/guest_profiler.h"
+#include "video_core/gpu.h"
+#include "video_core/renderer_base.h"
 #include "video_core/video_core.h"
 
 namespace Core {
 
 /*static*/ System System::s_instance;
 
+/// Index of the emulated CPU core driven by the calling host thread. The emu thread drives core 0.
+static thread_local size_t current_core_index = 0;
+
 System::ResultStatus System::RunLoop(int tight_loop) {
     status = ResultStatus::Success;
-    if (!cpu_core) {
+    if (!cpu_cores[0]) {
         return ResultStatus::ErrorNotInitialized;
     }
 
@@ -45,20 +69,15 @@ System::ResultStatus System::RunLoop(int tight_loop) {
         }
     }
 
-    // If we don't have a currently active thread then don't execute instructions,
-    // instead advance to the next event and try to yield to the next thread
-    if (Kernel::GetCurrentThread() == nullptr) {
-        LOG_TRACE(Core_ARM, "Idling");
-        CoreTiming::Idle();
-        CoreTiming::Advance();
-        PrepareReschedule();
-    } else {
-        CoreTiming::Advance();
-        cpu_core->Run(tight_loop);
-    }
+    // In multi-core mode, this also releases the other cores into the next slice
+    cpu_cores[0]->RunLoop(tight_loop);
 
-    HW::Update();
-    Reschedule();
+    // The memory usage is only sampled now and then for its peak, measuring it locks the kernel
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= next_memory_sample_time) {
+        peak_memory_usage = std::max(peak_memory_usage, GetMemoryFootprint().Total());
+        next_memory_sample_time = now + MEMORY_SAMPLE_INTERVAL;
+    }
 
     return status;
 }
@@ -67,7 +86,10 @@ System::ResultStatus System::SingleStep() {
     return RunLoop(1);
 }
 
+MICROPROFILE_DEFINE(Core_Load, "Core", "Load", MP_RGB(100, 100, 100));
+
 System::ResultStatus System::Load(EmuWindow* emu_window, const std::string& filepath) {
+    MICROPROFILE_SCOPE(Core_Load);
     app_loader = Loader::GetLoader(filepath);
 
     if (!app_loader) {
@@ -92,6 +114,9 @@ System::ResultStatus System::Load(EmuWindow* emu_window, const std::string& file
         }
     }
 
+    // The profile picks the CPU backend and the number of cores, before they are created
+    ApplyTitleProfile();
+
     ResultStatus init_result{Init(emu_window, system_mode.first.get())};
     if (init_result != ResultStatus::Success) {
         LOG_CRITICAL(Core, "Failed to initialize system (Error %i)!", init_result);
@@ -118,39 +143,75 @@ System::ResultStatus System::Load(EmuWindow* emu_window, const std::string& file
 }
 
 void System::PrepareReschedule() {
-    cpu_core->PrepareReschedule();
-    reschedule_pending = true;
+    CpuCore(CurrentCoreIndex()).PrepareReschedule();
 }
 
-PerfStats::Results System::GetAndResetPerfStats() {
-    return perf_stats.GetAndResetStats(CoreTiming::GetGlobalTimeUs());
+Cpu& System::CpuCore(size_t core_index) {
+    ASSERT_MSG(core_index < num_cpu_cores && cpu_cores[core_index], "Invalid CPU core %zu",
+               core_index);
+    return *cpu_cores[core_index];
 }
 
-void System::Reschedule() {
-    if (!reschedule_pending) {
+size_t System::CurrentCoreIndex() const {
+    return current_core_index;
+}
+
+void System::RunCpuCore(Cpu& cpu_state) {
+    current_core_index = cpu_state.CoreIndex();
+    LOG_DEBUG(Core, "Core-%zu host thread started", current_core_index);
+    Common::PinCurrentHostThread(static_cast<Common::HostThread>(
+        static_cast<size_t>(Common::HostThread::CpuCore0) + current_core_index));
+
+    while (cpu_barrier->IsAlive()) {
+        cpu_state.RunLoop(100000);
+    }
+}
+
+void System::ApplyTitleProfile() {
+    u64 program_id;
+    if (!Settings::values.use_title_profiles ||
+        app_loader->ReadProgramId(program_id) != Loader::ResultStatus::Success) {
         return;
     }
 
-    reschedule_pending = false;
-    Kernel::Reschedule();
+    Settings::Values values = Settings::values;
+    if (!TitleProfile::Read(TitleProfile::GetPath(program_id), values)) {
+        return;
+    }
+    settings_before_profile = Settings::values;
+    TitleProfile::CopyValues(values, Settings::values);
+    LOG_INFO(Core, "Applied the profile of title %016llX", program_id);
+}
+
+PerfStats::Results System::GetAndResetPerfStats() {
+    return perf_stats.GetAndResetStats(CoreTiming::GetGlobalTimeUs());
 }
 
 System::ResultStatus System::Init(EmuWindow* emu_window, u32 system_mode) {
     LOG_DEBUG(HW_Memory, "initialized OK");
 
-    switch (Settings::values.cpu_core) {
-    case Settings::CpuCore::Unicorn:
-        cpu_core = std::make_unique<ARM_Unicorn>();
-        break;
-    case Settings::CpuCore::Dynarmic:
-    default:
-        cpu_core = std::make_unique<ARM_Dynarmic>();
-        break;
+    // The cores running on host threads interleave their memory accesses differently every run
+    const bool is_deterministic = Settings::values.use_deterministic_mode;
+    num_cpu_cores = Settings::values.use_multi_core && !is_deterministic ? NUM_CPU_CORES : 1;
+    cpu_barrier = std::make_shared<CpuBarrier>(num_cpu_cores);
+    for (size_t index = 0; index < num_cpu_cores; ++index) {
+        cpu_cores[index] = std::make_unique<Cpu>(cpu_barrier, index);
     }
 
     telemetry_session = std::make_unique<Core::TelemetrySession>();
 
     CoreTiming::Init();
+    // The adaptive slices and the wakeups depend on when the events of host threads come in
+    CoreTiming::SetAdaptiveSliceLength(!is_deterministic);
+
+    // Urgent events from host threads interrupt the main core so that the next Advance picks them
+    // up. Halting the JIT only raises a flag it checks between blocks, so this is safe to do from
+    // another thread.
+    if (!is_deterministic) {
+        CoreTiming::SetHostEventWakeupCallback(
+            [this] { cpu_cores[0]->ArmInterface().PrepareReschedule(); });
+    }
+    GuestProfiler::Init();
     HW::Init();
     Kernel::Init(system_mode);
     Service::Init();
@@ -159,16 +220,120 @@ System::ResultStatus System::Init(EmuWindow* emu_window, u32 system_mode) {
     if (!VideoCore::Init(emu_window)) {
         return ResultStatus::ErrorVideoCore;
     }
+    gpu_core = std::make_unique<Tegra::GPU>();
+
+    // Core 0 is run by the caller of RunLoop, the others get a host thread each. They wait at the
+    // barrier until the first slice is started.
+    for (size_t index = 1; index < num_cpu_cores; ++index) {
+        cpu_core_threads[index - 1] =
+            std::make_unique<std::thread>(&System::RunCpuCore, this, std::ref(*cpu_cores[index]));
+    }
 
     LOG_DEBUG(Core, "Initialized OK");
 
     // Reset counters and set time origin to current frame
     GetAndResetPerfStats();
+    perf_stats.ResetSessionStats();
     perf_stats.BeginSystemFrame();
+    peak_memory_usage = 0;
+    next_memory_sample_time = std::chrono::steady_clock::now();
 
     return ResultStatus::Success;
 }
 
+MemoryFootprint System::GetMemoryFootprint() {
+    MemoryFootprint footprint;
+    std::set<const void*> counted_memory;
+
+    {
+        std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+
+        // The service blocks are counted first, so that they don't count as guest shared memory
+        // where they are mapped
+        footprint.service_buffers = Kernel::AddServiceSharedMemoryUsage(counted_memory);
+
+        Kernel::VMManager::MemoryUsage usage;
+        for (const auto& process : Kernel::GetProcessList()) {
+            process->vm_manager.AddMemoryUsage(usage, counted_memory);
+        }
+        footprint.page_tables = usage.page_tables;
+        footprint.guest_heap = usage.heap;
+        footprint.code_sets = usage.code;
+        footprint.shared_memory = usage.shared_memory;
+        footprint.other_guest_memory = usage.other;
+
+        // Compacted heap chunks only use the memory of their compressed copy
+        for (const auto& process : Kernel::GetProcessList()) {
+            if (process->memory_compactor) {
+                footprint.guest_heap -= process->memory_compactor->GetCompactedSize();
+                footprint.guest_heap += process->memory_compactor->GetCompressedSize();
+            }
+        }
+    }
+
+    for (size_t index = 0; index < num_cpu_cores; ++index) {
+        if (cpu_cores[index]) {
+            footprint.jit_cache += cpu_cores[index]->ArmInterface().GetCodeCacheMemoryUsage();
+        }
+    }
+    if (VideoCore::g_renderer) {
+        footprint.renderer_buffers = VideoCore::g_renderer->GetBufferMemoryUsage();
+    }
+    return footprint;
+}
+
+void System::CompactMemory() {
+    if (!Settings::values.use_memory_compaction || !IsPoweredOn()) {
+        return;
+    }
+
+    // The GPU may still be reading the heap for the command lists submitted before the pause
+    gpu_core->WaitIdle();
+
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    for (const auto& process : Kernel::GetProcessList()) {
+        if (!process->memory_compactor) {
+            process->memory_compactor = std::make_shared<Memory::MemoryCompactor>(*process);
+        }
+        process->memory_compactor->Compact();
+    }
+}
+
+ARM_Interface::JitStats System::GetJitStats() {
+    ARM_Interface::JitStats totals;
+    std::map<VAddr, u64> fallback_hits;
+    for (size_t index = 0; index < num_cpu_cores; ++index) {
+        if (!cpu_cores[index]) {
+            continue;
+        }
+        const ARM_Interface::JitStats stats = cpu_cores[index]->ArmInterface().GetJitStats();
+        totals.runs += stats.runs;
+        totals.run_time_ns += stats.run_time_ns;
+        totals.halts += stats.halts;
+        totals.cache_clears += stats.cache_clears;
+        totals.cache_invalidations += stats.cache_invalidations;
+        totals.invalidated_bytes += stats.invalidated_bytes;
+        totals.translator_resets += stats.translator_resets;
+        totals.interpreter_fallbacks += stats.interpreter_fallbacks;
+        totals.interpreted_instructions += stats.interpreted_instructions;
+        totals.svcs += stats.svcs;
+        for (const auto& hit : stats.top_fallback_pcs) {
+            fallback_hits[hit.first] += hit.second;
+        }
+    }
+
+    // Each core only reports its own most frequent PCs, so the merged counts are lower bounds
+    const size_t num_reported =
+        std::min(fallback_hits.size(), ARM_Interface::JitStats::MAX_REPORTED_FALLBACK_PCS);
+    totals.top_fallback_pcs.assign(fallback_hits.begin(), fallback_hits.end());
+    std::partial_sort(totals.top_fallback_pcs.begin(),
+                      totals.top_fallback_pcs.begin() + num_reported,
+                      totals.top_fallback_pcs.end(),
+                      [](const auto& a, const auto& b) { return a.second > b.second; });
+    totals.top_fallback_pcs.resize(num_reported);
+    return totals;
+}
+
 void System::Shutdown() {
     // Log last frame performance stats
     auto perf_results = GetAndResetPerfStats();
@@ -178,18 +343,92 @@ void System::Shutdown() {
                          perf_results.game_fps);
     Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_Frametime",
                          perf_results.frametime * 1000.0);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_AverageSliceLength",
+                         perf_results.average_slice_length);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_JitExitsPerFrame",
+                         perf_results.jit_exits_per_frame);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_InputLatency",
+                         perf_results.input_latency * 1000.0);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_InputEventLatency",
+                         perf_results.input_event_latency * 1000.0);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_Frametime99thPercentile",
+                         perf_results.frametime_p99 * 1000.0);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_Framerate1PercentLow",
+                         perf_results.low_1_percent_fps);
+    Telemetry().AddServiceStats();
+    const MemoryFootprint footprint = GetMemoryFootprint();
+    peak_memory_usage = std::max(peak_memory_usage, footprint.Total());
+    Telemetry().AddSessionPerfStats(perf_stats.GetSessionStats(), GetJitStats(),
+                                    peak_memory_usage);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_MemoryPageTables",
+                         footprint.page_tables);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_MemoryGuestHeap",
+                         footprint.guest_heap);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_MemoryCodeSets",
+                         footprint.code_sets);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_MemorySharedMemory",
+                         footprint.shared_memory);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_MemoryOtherGuestMemory",
+                         footprint.other_guest_memory);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_MemoryJitCache",
+                         footprint.jit_cache);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_MemoryRendererBuffers",
+                         footprint.renderer_buffers);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_MemoryServiceBuffers",
+                         footprint.service_buffers);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_MemoryTotal",
+                         footprint.Total());
+    const auto file_cache_stats = FileSys::BlockCache::GetInstance().GetStats();
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_FileCacheHits",
+                         file_cache_stats.hits);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_FileCacheMisses",
+                         file_cache_stats.misses);
+    Telemetry().AddField(Telemetry::FieldType::Performance, "Shutdown_FileCacheReadAhead",
+                         file_cache_stats.read_ahead);
+    // Every family of kernels the session used picked its variant by now
+    for (const auto& selection : Common::GetKernelSelections()) {
+        Telemetry().AddField(Telemetry::FieldType::Performance,
+                             ("Shutdown_Kernel_" + selection.first).c_str(), selection.second);
+    }
+
+    // Stop the other cores before tearing down the state they run on
+    if (cpu_barrier) {
+        cpu_barrier->NotifyEnd();
+    }
+    for (auto& thread : cpu_core_threads) {
+        if (thread) {
+            thread->join();
+            thread.reset();
+        }
+    }
+
+    CoreTiming::SetHostEventWakeupCallback(nullptr);
 
     // Shutdown emulation session
+    Movie::GetInstance().Shutdown();
     GDBStub::Shutdown();
+    gpu_core = nullptr;
     VideoCore::Shutdown();
     Service::Shutdown();
     Kernel::Shutdown();
     HW::Shutdown();
+    GuestProfiler::Shutdown();
     CoreTiming::Shutdown();
-    cpu_core = nullptr;
+    Loader::Symbols::Clear();
+    for (auto& cpu_core : cpu_cores) {
+        cpu_core = nullptr;
+    }
+    cpu_barrier = nullptr;
+    num_cpu_cores = 1;
     app_loader = nullptr;
     telemetry_session = nullptr;
 
+    // The next title starts from the global settings
+    if (settings_before_profile) {
+        TitleProfile::CopyValues(*settings_before_profile, Settings::values);
+        settings_before_profile = boost::none;
+    }
+
     LOG_DEBUG(Core, "Shutdown OK");
 }
 
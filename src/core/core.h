@@ -4,19 +4,56 @@
 
 #pragma once
 
+#include <array>
+#include <chrono>
 #include <memory>
 #include <string>
+#include <thread>
+#include <boost/optional.hpp>
 #include "common/common_types.h"
+#include "core/arm/arm_interface.h"
+#include "core/core_cpu.h"
 #include "core/loader/loader.h"
 #include "core/memory.h"
 #include "core/perf_stats.h"
+#include "core/settings.h"
 #include "core/telemetry_session.h"
 
 class EmuWindow;
-class ARM_Interface;
+
+namespace Tegra {
+class GPU;
+}
 
 namespace Core {
 
+/// Number of CPU cores on the emulated system
+constexpr size_t NUM_CPU_CORES = 4;
+
+/// Host memory used by the emulation, in bytes, by what it is used for
+struct MemoryFootprint {
+    /// Page tables of the guest address spaces
+    u64 page_tables = 0;
+    u64 guest_heap = 0;
+    /// Loaded modules, including the read-only images shared with other instances
+    u64 code_sets = 0;
+    /// Shared memory created by guest processes
+    u64 shared_memory = 0;
+    /// Stacks, TLS and the other guest mappings
+    u64 other_guest_memory = 0;
+    /// Translated code, only counted by the CPU backends able to report it
+    u64 jit_cache = 0;
+    /// Buffers allocated by the renderer on the host GPU
+    u64 renderer_buffers = 0;
+    /// Shared memory created by HLE services, such as the HID input buffer
+    u64 service_buffers = 0;
+
+    u64 Total() const {
+        return page_tables + guest_heap + code_sets + shared_memory + other_guest_memory +
+               jit_cache + renderer_buffers + service_buffers;
+    }
+};
+
 class System {
 public:
     /**
@@ -78,7 +115,7 @@ public:
      * @returns True if the emulated system is powered on, otherwise false.
      */
     bool IsPoweredOn() const {
-        return cpu_core != nullptr;
+        return cpu_cores[0] != nullptr;
     }
 
     /**
@@ -89,19 +126,66 @@ public:
         return *telemetry_session;
     }
 
-    /// Prepare the core emulation for a reschedule
+    /// Prepare the core emulation of the calling host thread's core for a reschedule
     void PrepareReschedule();
 
     PerfStats::Results GetAndResetPerfStats();
 
     /**
-     * Gets a reference to the emulated CPU.
+     * Gets a reference to the emulated CPU core driven by the calling host thread.
      * @returns A reference to the emulated CPU.
      */
     ARM_Interface& CPU() {
-        return *cpu_core;
+        return ArmInterface(CurrentCoreIndex());
+    }
+
+    /**
+     * Gets a reference to the ARM interface of the specified emulated CPU core.
+     * @param core_index Index of the core, must be less than NumCpuCores().
+     */
+    ARM_Interface& ArmInterface(size_t core_index) {
+        return CpuCore(core_index).ArmInterface();
+    }
+
+    /**
+     * Gets a reference to the specified emulated CPU core.
+     * @param core_index Index of the core, must be less than NumCpuCores().
+     */
+    Cpu& CpuCore(size_t core_index);
+
+    /// Gets the number of emulated CPU cores being run, one unless multi-core mode is enabled
+    size_t NumCpuCores() const {
+        return num_cpu_cores;
     }
 
+    /// Gets the index of the emulated CPU core driven by the calling host thread
+    size_t CurrentCoreIndex() const;
+
+    /// Gets a reference to the emulated GPU
+    Tegra::GPU& GPU() {
+        return *gpu_core;
+    }
+
+    /**
+     * Measures the host memory used by the emulation. Memory mapped in several places is only
+     * counted once. Can be called from any thread while the system is powered on.
+     */
+    MemoryFootprint GetMemoryFootprint();
+
+    /**
+     * Compresses the resident heap of the guest processes when memory compaction is enabled, for
+     * paused instances to use less host memory. The memory is decompressed as it is accessed once
+     * the emulation resumes. Must be called on the emu thread, while the emulation is paused.
+     */
+    void CompactMemory();
+
+    /**
+     * Gets the JIT statistics of all the CPU cores together, with the guest PCs needing the
+     * interpreter fallback most often across them. Can be called from any thread while the system
+     * is powered on.
+     */
+    ARM_Interface::JitStats GetJitStats();
+
     PerfStats perf_stats;
     FrameLimiter frame_limiter;
 
@@ -129,21 +213,38 @@ private:
      */
     ResultStatus Init(EmuWindow* emu_window, u32 system_mode);
 
-    /// Reschedule the core emulation
-    void Reschedule();
+    /// Host thread entry point for the cores other than the main one in multi-core mode
+    void RunCpuCore(Cpu& cpu_state);
+
+    /// Overrides the settings with the profile of the loaded title, if it has one
+    void ApplyTitleProfile();
 
     /// AppLoader used to load the current executing application
     std::unique_ptr<Loader::AppLoader> app_loader;
 
-    ///< ARM11 CPU core
-    std::unique_ptr<ARM_Interface> cpu_core;
+    /// Emulated CPU cores, only the first num_cpu_cores of them are created
+    std::array<std::unique_ptr<Cpu>, NUM_CPU_CORES> cpu_cores;
+    std::shared_ptr<CpuBarrier> cpu_barrier;
+    size_t num_cpu_cores = 1;
+
+    /// Host threads running cores 1-3 in multi-core mode. Core 0 runs on the caller of RunLoop
+    std::array<std::unique_ptr<std::thread>, NUM_CPU_CORES - 1> cpu_core_threads;
 
-    /// When true, signals that a reschedule should happen
-    bool reschedule_pending{};
+    /// Emulated GPU, processing the submitted command lists on its own host thread
+    std::unique_ptr<Tegra::GPU> gpu_core;
 
     /// Telemetry session for this emulation session
     std::unique_ptr<Core::TelemetrySession> telemetry_session;
 
+    /// Settings overridden by the profile of the title, restored on shutdown
+    boost::optional<Settings::Values> settings_before_profile;
+
+    /// Interval between the samples of the memory usage taken for its peak
+    static constexpr std::chrono::seconds MEMORY_SAMPLE_INTERVAL{5};
+    /// Highest total host memory usage sampled during the session, in bytes
+    u64 peak_memory_usage = 0;
+    std::chrono::steady_clock::time_point next_memory_sample_time;
+
     static System s_instance;
 
     ResultStatus status = ResultStatus::Success;
@@ -0,0 +1,162 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <mutex>
+#include "common/logging/log.h"
+#include "core/arm/arm_interface.h"
+#include "core/arm/dynarmic/arm_dynarmic.h"
+#include "core/arm/unicorn/arm_unicorn.h"
+#include "core/core.h"
+#include "core/core_cpu.h"
+#include "core/core_timing.h"
+#include "core/hle/kernel/scheduler.h"
+#include "core/hle/kernel/thread.h"
+#include "core/hle/lock.h"
+#include "core/hw/hw.h"
+#include "core/settings.h"
+#include "core/tracer/guest_profiler.h"
+
+namespace Core {
+
+void CpuBarrier::NotifyEnd() {
+    std::unique_lock<std::mutex> lock(mutex);
+    end = true;
+    condition.notify_all();
+}
+
+bool CpuBarrier::Rendezvous() {
+    if (num_cores == 1) {
+        // Nothing to synchronize with
+        return !end;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (end) {
+        return false;
+    }
+
+    if (++cores_waiting == num_cores) {
+        // Last core to arrive, release the others into the next slice
+        cores_waiting = 0;
+        ++generation;
+        condition.notify_all();
+        return true;
+    }
+
+    const u64 current_generation = generation;
+    condition.wait(lock, [&] { return generation != current_generation || end; });
+    return !end;
+}
+
+Cpu::Cpu(std::shared_ptr<CpuBarrier> cpu_barrier, size_t core_index)
+    : cpu_barrier{std::move(cpu_barrier)}, core_index{core_index} {
+
+    switch (Settings::values.cpu_core) {
+    case Settings::CpuCore::Unicorn:
+        arm_interface = std::make_unique<ARM_Unicorn>();
+        break;
+    case Settings::CpuCore::Dynarmic:
+    default:
+        arm_interface = std::make_unique<ARM_Dynarmic>();
+        break;
+    }
+
+    scheduler = std::make_unique<Kernel::Scheduler>(*arm_interface, core_index);
+}
+
+Cpu::~Cpu() = default;
+
+void Cpu::RunLoop(int tight_loop) {
+    if (IsMainCore()) {
+        // Other cores may still be inside the kernel, and a timing event can touch any kernel
+        // state, so the main core only touches CoreTiming with the kernel locked.
+        std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+
+        // If we don't have a currently active thread, skip ahead to the next event
+        if (scheduler->GetCurrentThread() == nullptr) {
+            CoreTiming::Idle();
+        }
+        CoreTiming::Advance();
+
+        // Don't run past the next scheduled event
+        const int slice_length = std::min(
+            tight_loop, CoreTiming::TicksToCpuCycles(std::max(CoreTiming::GetDowncount(), 1)));
+        cpu_barrier->SetSliceLength(slice_length);
+        System::GetInstance().perf_stats.AddSlice(slice_length);
+    }
+
+    // Wait for all other CPU cores to complete the previous slice, such that they run in lock-step
+    if (!cpu_barrier->Rendezvous()) {
+        // If rendezvous failed, the session has been ended
+        return;
+    }
+
+    // The main core's previous slice ended at the sampling event, the others ran in lock-step
+    if (GuestProfiler::IsEnabled()) {
+        GuestProfiler::Sample(core_index, *arm_interface, scheduler->GetCurrentThread());
+    }
+
+    // If we don't have a currently active thread then don't execute instructions,
+    // instead try to yield to the next thread
+    if (scheduler->GetCurrentThread() == nullptr) {
+        LOG_TRACE(Core, "Core-%zu idling", core_index);
+        PrepareReschedule();
+    } else {
+        const u64 cycles = arm_interface->Run(cpu_barrier->GetSliceLength());
+        System::GetInstance().perf_stats.AddJitExit();
+
+        // The cores run each slice in parallel, so only the main core's cycles count towards
+        // emulated time.
+        if (IsMainCore()) {
+            std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+            CoreTiming::AddCpuCycles(cycles);
+
+            // The thread is spinning, so jump straight to the end of the slice. Advancing then
+            // runs the next event, which is what the thread is waiting for.
+            if (idle_pending.exchange(false)) {
+                LOG_TRACE(Core, "Core-%zu skipping %d idle cycles", core_index,
+                          CoreTiming::GetDowncount());
+                CoreTiming::Idle();
+            }
+        }
+    }
+
+    if (IsMainCore()) {
+        std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+        HW::Update();
+    }
+
+    Reschedule();
+}
+
+void Cpu::SingleStep() {
+    RunLoop(1);
+}
+
+void Cpu::PrepareReschedule() {
+    arm_interface->PrepareReschedule();
+    reschedule_pending = true;
+}
+
+void Cpu::PrepareIdle() {
+    if (!IsMainCore()) {
+        return;
+    }
+
+    arm_interface->PrepareReschedule();
+    idle_pending = true;
+}
+
+void Cpu::Reschedule() {
+    if (!reschedule_pending.exchange(false)) {
+        return;
+    }
+
+    // Lock the global kernel mutex when we manipulate the HLE state
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    scheduler->Reschedule();
+}
+
+} // namespace Core
@@ -0,0 +1,130 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include "common/common_types.h"
+
+class ARM_Interface;
+
+namespace Kernel {
+class Scheduler;
+}
+
+namespace Core {
+
+/**
+ * Barrier used to run the emulated CPU cores in lock-step. Every core waits here at the start of
+ * each timing slice until all of them have finished the previous one, which keeps CoreTiming (only
+ * advanced by the main core) consistent across cores.
+ */
+class CpuBarrier {
+public:
+    explicit CpuBarrier(size_t num_cores) : num_cores(num_cores) {}
+
+    /// Returns false once the emulation session has been ended
+    bool IsAlive() const {
+        return !end;
+    }
+
+    /// Ends the emulation session, releasing every core waiting at the barrier
+    void NotifyEnd();
+
+    /**
+     * Waits for all cores to arrive at the barrier.
+     * @returns True if the cores should continue running, false if the session has ended.
+     */
+    bool Rendezvous();
+
+    /// Sets the number of cycles the cores run in the slice they are released into next
+    void SetSliceLength(int cycles) {
+        slice_length = cycles;
+    }
+
+    int GetSliceLength() const {
+        return slice_length;
+    }
+
+private:
+    const size_t num_cores;
+    size_t cores_waiting{};
+    u64 generation{};
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::atomic<bool> end{};
+    std::atomic<int> slice_length{};
+};
+
+/// A single emulated CPU core, bundling its ARM_Interface with its run loop
+class Cpu {
+public:
+    Cpu(std::shared_ptr<CpuBarrier> cpu_barrier, size_t core_index);
+    ~Cpu();
+
+    /**
+     * Runs one timing slice on this core.
+     * @param tight_loop Number of instructions to execute.
+     */
+    void RunLoop(int tight_loop);
+
+    /// Step this core one instruction
+    void SingleStep();
+
+    /// Prepare this core for a reschedule, halting its execution at the next opportunity
+    void PrepareReschedule();
+
+    /**
+     * Halts this core and skips the rest of the current timing slice, used when its thread was
+     * found to be spinning without making progress. Only the main core can skip ahead, since it
+     * is the one driving CoreTiming.
+     */
+    void PrepareIdle();
+
+    ARM_Interface& ArmInterface() {
+        return *arm_interface;
+    }
+
+    const ARM_Interface& ArmInterface() const {
+        return *arm_interface;
+    }
+
+    /// The main core drives CoreTiming and HW, the others only execute guest code
+    bool IsMainCore() const {
+        return core_index == 0;
+    }
+
+    size_t CoreIndex() const {
+        return core_index;
+    }
+
+    Kernel::Scheduler& Scheduler() {
+        return *scheduler;
+    }
+
+    const Kernel::Scheduler& Scheduler() const {
+        return *scheduler;
+    }
+
+private:
+    /// Reschedule this core, if a reschedule was requested
+    void Reschedule();
+
+    std::unique_ptr<ARM_Interface> arm_interface;
+    std::shared_ptr<CpuBarrier> cpu_barrier;
+    std::unique_ptr<Kernel::Scheduler> scheduler;
+
+    /// When true, signals that a reschedule should happen. Set from other cores' host threads
+    std::atomic<bool> reschedule_pending{};
+
+    /// When true, the rest of the current slice is skipped once execution halts
+    std::atomic<bool> idle_pending{};
+
+    size_t core_index;
+};
+
+} // namespace Core
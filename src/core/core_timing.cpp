@@ -5,23 +5,24 @@
 #include "core/core_timing.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cinttypes>
+#include <functional>
 #include <mutex>
 #include <string>
 #include <tuple>
 #include <unordered_map>
+#include <utility>
 #include <vector>
+#include <boost/container/small_vector.hpp>
 #include "common/assert.h"
 #include "common/logging/log.h"
+#include "common/microprofile.h"
 #include "common/thread.h"
 #include "common/threadsafe_queue.h"
 
 namespace CoreTiming {
 
-static s64 global_timer;
-static int slice_length;
-static int downcount;
-
 struct EventType {
     TimedCallback callback;
     const std::string* name;
@@ -32,77 +33,246 @@ struct Event {
     u64 fifo_order;
     u64 userdata;
     const EventType* type;
+    size_t slot; ///< Index into event_positions tracking where this event is in the queue
 };
 
 // Sort by time, unless the times are the same, in which case sort by the order added to the queue
-static bool operator>(const Event& left, const Event& right) {
-    return std::tie(left.time, left.fifo_order) > std::tie(right.time, right.fifo_order);
-}
-
 static bool operator<(const Event& left, const Event& right) {
     return std::tie(left.time, left.fifo_order) < std::tie(right.time, right.fifo_order);
 }
 
-// unordered_map stores each element separately as a linked list node so pointers to elements
-// remain stable regardless of rehashes/resizing.
-static std::unordered_map<std::string, EventType> event_types;
+/// Identifies the events cancelled together by UnscheduleEvent
+struct EventKey {
+    const EventType* type;
+    u64 userdata;
 
-// The queue is a min-heap using std::make_heap/push_heap/pop_heap.
-// We don't use std::priority_queue because we need to be able to serialize, unserialize and
-// erase arbitrary events (RemoveEvent()) regardless of the queue order. These aren't accomodated
-// by the standard adaptor class.
-static std::vector<Event> event_queue;
-static u64 event_fifo_id;
-// the queue for storing the events from other threads threadsafe until they will be added
-// to the event_queue by the emu thread
-static Common::MPSCQueue<Event, false> ts_queue;
+    bool operator==(const EventKey& other) const {
+        return type == other.type && userdata == other.userdata;
+    }
+};
+
+struct EventKeyHash {
+    size_t operator()(const EventKey& key) const {
+        const size_t type_hash = std::hash<const EventType*>()(key.type);
+        return type_hash ^ (std::hash<u64>()(key.userdata) + 0x9E3779B9 + (type_hash << 6) +
+                            (type_hash >> 2));
+    }
+};
+
+// Batches submitted by host threads through SubmitHostEvents. Producers push onto a lock-free
+// stack, and the emu thread takes the whole stack at once in MoveEvents().
+struct HostEventNode {
+    HostEventBatch batch;
+    HostEventNode* next;
+};
 
 static constexpr int MAX_SLICE_LENGTH = 20000;
 
-static s64 idled_cycles;
+// Bounds of the slice length cap when adaptive slicing is enabled
+static constexpr int MIN_ADAPTIVE_SLICE_LENGTH = 5000;
+static constexpr int MAX_ADAPTIVE_SLICE_LENGTH = 100000;
+
+struct Context {
+    s64 global_timer = 0;
+    int slice_length = 0;
+    int downcount = 0;
+
+    // unordered_map stores each element separately as a linked list node so pointers to elements
+    // remain stable regardless of rehashes/resizing.
+    std::unordered_map<std::string, EventType> event_types;
+
+    // The queue is a binary min-heap. Each event owns a slot in event_positions which always
+    // holds its current index in the heap, so that arbitrary events can be erased in O(log n)
+    // without searching for them. scheduled_events maps (type, userdata) to the slots of matching
+    // events, which is how UnscheduleEvent finds them in O(1).
+    std::vector<Event> event_queue;
+    std::vector<size_t> event_positions;
+    std::vector<size_t> free_event_slots;
+    std::unordered_map<EventKey, boost::container::small_vector<size_t, 1>, EventKeyHash>
+        scheduled_events;
+    u64 event_fifo_id = 0;
+    // the queue for storing the events from other threads threadsafe until they will be added
+    // to the event_queue by the emu thread
+    Common::MPSCQueue<Event, false> ts_queue;
+
+    std::atomic<HostEventNode*> host_event_stack{nullptr};
+
+    std::mutex host_wakeup_mutex;
+    std::function<void()> host_wakeup_callback;
+
+    bool adaptive_slicing = false;
+    // Current cap on the slice length, always MAX_SLICE_LENGTH unless adaptive slicing is enabled
+    int max_slice_length = MAX_SLICE_LENGTH;
+    // Whether the last MoveEvents() call picked up any events from other threads
+    bool moved_foreign_events = false;
+
+    s64 idled_cycles = 0;
+
+    // Are we in a function that has been called from Advance()
+    // If events are sheduled from a function that gets called from Advance(),
+    // don't change slice_length and downcount.
+    bool is_global_timer_sane = false;
+
+    EventType* ev_lost = nullptr;
+
+    /// Clock rate of the emulated CPU, and the ratios between its cycles and the ticks
+    u64 cpu_clock_rate = 0;
+    FixedPointRatio cpu_cycles_to_ticks{1, 1};
+    FixedPointRatio ticks_to_cpu_cycles{1, 1};
+    /// Fraction of a tick, in 1/2^64ths, the executed cycles are ahead of the ticks added for them
+    u64 cpu_tick_fraction = 0;
+};
+
+/// Context of the threads that didn't bind one, enough when the process runs a single system
+static Context default_context;
+static thread_local Context* bound_context = nullptr;
+
+static Context& GetContext() {
+    return bound_context != nullptr ? *bound_context : default_context;
+}
+
+void ContextDeleter::operator()(Context* context) const {
+    delete context;
+}
 
-// Are we in a function that has been called from Advance()
-// If events are sheduled from a function that gets called from Advance(),
-// don't change slice_length and downcount.
-static bool is_global_timer_sane;
+ContextPtr CreateContext() {
+    return ContextPtr(new Context);
+}
 
-static EventType* ev_lost = nullptr;
+void BindContext(Context* context) {
+    bound_context = context;
+}
 
 static void EmptyTimedCallback(u64 userdata, s64 cyclesLate) {}
 
+/// Stores an event at the given heap index, keeping its position slot up to date
+static void PlaceEvent(Context& ctx, size_t index, Event event) {
+    ctx.event_positions[event.slot] = index;
+    ctx.event_queue[index] = std::move(event);
+}
+
+static void SiftUp(Context& ctx, size_t index) {
+    Event event = std::move(ctx.event_queue[index]);
+    while (index > 0) {
+        const size_t parent = (index - 1) / 2;
+        if (!(event < ctx.event_queue[parent])) {
+            break;
+        }
+        PlaceEvent(ctx, index, std::move(ctx.event_queue[parent]));
+        index = parent;
+    }
+    PlaceEvent(ctx, index, std::move(event));
+}
+
+static void SiftDown(Context& ctx, size_t index) {
+    const size_t size = ctx.event_queue.size();
+    Event event = std::move(ctx.event_queue[index]);
+    while (true) {
+        size_t child = 2 * index + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && ctx.event_queue[child + 1] < ctx.event_queue[child]) {
+            ++child;
+        }
+        if (!(ctx.event_queue[child] < event)) {
+            break;
+        }
+        PlaceEvent(ctx, index, std::move(ctx.event_queue[child]));
+        index = child;
+    }
+    PlaceEvent(ctx, index, std::move(event));
+}
+
+/// Adds an event to the queue, assigning it a position slot
+static void PushEvent(Context& ctx, Event event) {
+    if (ctx.free_event_slots.empty()) {
+        event.slot = ctx.event_positions.size();
+        ctx.event_positions.emplace_back();
+    } else {
+        event.slot = ctx.free_event_slots.back();
+        ctx.free_event_slots.pop_back();
+    }
+
+    ctx.scheduled_events[{event.type, event.userdata}].push_back(event.slot);
+
+    ctx.event_queue.emplace_back();
+    PlaceEvent(ctx, ctx.event_queue.size() - 1, std::move(event));
+    SiftUp(ctx, ctx.event_queue.size() - 1);
+}
+
+/// Removes the event at the given heap index from the queue and returns it
+static Event PopEventAt(Context& ctx, size_t index) {
+    Event event = std::move(ctx.event_queue[index]);
+
+    const size_t last = ctx.event_queue.size() - 1;
+    if (index != last) {
+        PlaceEvent(ctx, index, std::move(ctx.event_queue[last]));
+    }
+    ctx.event_queue.pop_back();
+
+    if (index != last) {
+        // The moved event may belong either above or below its new position
+        if (index > 0 && ctx.event_queue[index] < ctx.event_queue[(index - 1) / 2]) {
+            SiftUp(ctx, index);
+        } else {
+            SiftDown(ctx, index);
+        }
+    }
+
+    auto itr = ctx.scheduled_events.find({event.type, event.userdata});
+    ASSERT(itr != ctx.scheduled_events.end());
+    auto& slots = itr->second;
+    slots.erase(std::find(slots.begin(), slots.end(), event.slot));
+    if (slots.empty()) {
+        ctx.scheduled_events.erase(itr);
+    }
+    ctx.free_event_slots.push_back(event.slot);
+
+    return event;
+}
+
 EventType* RegisterEvent(const std::string& name, TimedCallback callback) {
     // check for existing type with same name.
     // we want event type names to remain unique so that we can use them for serialization.
-    ASSERT_MSG(event_types.find(name) == event_types.end(),
+    Context& ctx = GetContext();
+    ASSERT_MSG(ctx.event_types.find(name) == ctx.event_types.end(),
                "CoreTiming Event \"%s\" is already registered. Events should only be registered "
                "during Init to avoid breaking save states.",
                name.c_str());
 
-    auto info = event_types.emplace(name, EventType{callback, nullptr});
+    auto info = ctx.event_types.emplace(name, EventType{callback, nullptr});
     EventType* event_type = &info.first->second;
     event_type->name = &info.first->first;
     return event_type;
 }
 
 void UnregisterAllEvents() {
-    ASSERT_MSG(event_queue.empty(), "Cannot unregister events with events pending");
-    event_types.clear();
+    Context& ctx = GetContext();
+    ASSERT_MSG(ctx.event_queue.empty(), "Cannot unregister events with events pending");
+    ctx.event_types.clear();
 }
 
 void Init() {
-    downcount = MAX_SLICE_LENGTH;
-    slice_length = MAX_SLICE_LENGTH;
-    global_timer = 0;
-    idled_cycles = 0;
+    Context& ctx = GetContext();
+    ctx.downcount = MAX_SLICE_LENGTH;
+    ctx.slice_length = MAX_SLICE_LENGTH;
+    ctx.max_slice_length = MAX_SLICE_LENGTH;
+    ctx.adaptive_slicing = false;
+    ctx.moved_foreign_events = false;
+    ctx.global_timer = 0;
+    ctx.idled_cycles = 0;
+    SetCpuClockRate(BASE_CLOCK_RATE);
+    ctx.cpu_tick_fraction = 0;
 
     // The time between CoreTiming being intialized and the first call to Advance() is considered
     // the slice boundary between slice -1 and slice 0. Dispatcher loops must call Advance() before
     // executing the first cycle of each slice to prepare the slice length and downcount for
     // that slice.
-    is_global_timer_sane = true;
+    ctx.is_global_timer_sane = true;
 
-    event_fifo_id = 0;
-    ev_lost = RegisterEvent("_lost_event", &EmptyTimedCallback);
+    ctx.event_fifo_id = 0;
+    ctx.ev_lost = RegisterEvent("_lost_event", &EmptyTimedCallback);
 }
 
 void Shutdown() {
@@ -114,61 +284,138 @@ void Shutdown() {
 // This should only be called from the CPU thread. If you are calling
 // it from any other thread, you are doing something evil
 u64 GetTicks() {
-    u64 ticks = static_cast<u64>(global_timer);
-    if (!is_global_timer_sane) {
-        ticks += slice_length - downcount;
+    Context& ctx = GetContext();
+    u64 ticks = static_cast<u64>(ctx.global_timer);
+    if (!ctx.is_global_timer_sane) {
+        ticks += ctx.slice_length - ctx.downcount;
     }
     return ticks;
 }
 
 void AddTicks(u64 ticks) {
-    downcount -= ticks;
+    GetContext().downcount -= ticks;
+}
+
+void SetCpuClockRate(u64 clock_rate) {
+    Context& ctx = GetContext();
+    ctx.cpu_clock_rate = clock_rate;
+    ctx.cpu_cycles_to_ticks = FixedPointRatio{BASE_CLOCK_RATE, clock_rate};
+    ctx.ticks_to_cpu_cycles = FixedPointRatio{clock_rate, BASE_CLOCK_RATE};
+}
+
+u64 GetCpuClockRate() {
+    return GetContext().cpu_clock_rate;
+}
+
+int TicksToCpuCycles(int ticks) {
+    const FixedPointRatio& ratio = GetContext().ticks_to_cpu_cycles;
+    return std::max(static_cast<int>(ratio.Apply(static_cast<u64>(ticks))), 1);
+}
+
+void AddCpuCycles(u64 cycles) {
+    Context& ctx = GetContext();
+    // The fractions of a tick are carried over, so that no time is lost to the rounding
+    u64 ticks = ctx.cpu_cycles_to_ticks.Apply(cycles);
+    const u64 fraction = cycles * ctx.cpu_cycles_to_ticks.fraction;
+    ctx.cpu_tick_fraction += fraction;
+    if (ctx.cpu_tick_fraction < fraction) {
+        ++ticks;
+    }
+    AddTicks(ticks);
 }
 
 u64 GetIdleTicks() {
-    return static_cast<u64>(idled_cycles);
+    return static_cast<u64>(GetContext().idled_cycles);
 }
 
 void ClearPendingEvents() {
-    event_queue.clear();
+    Context& ctx = GetContext();
+    ctx.event_queue.clear();
+    ctx.event_positions.clear();
+    ctx.free_event_slots.clear();
+    ctx.scheduled_events.clear();
 }
 
 void ScheduleEvent(s64 cycles_into_future, const EventType* event_type, u64 userdata) {
+    Context& ctx = GetContext();
     ASSERT(event_type != nullptr);
     s64 timeout = GetTicks() + cycles_into_future;
 
     // If this event needs to be scheduled before the next advance(), force one early
-    if (!is_global_timer_sane)
+    if (!ctx.is_global_timer_sane)
         ForceExceptionCheck(cycles_into_future);
 
-    event_queue.emplace_back(Event{timeout, event_fifo_id++, userdata, event_type});
-    std::push_heap(event_queue.begin(), event_queue.end(), std::greater<Event>());
+    PushEvent(ctx, Event{timeout, ctx.event_fifo_id++, userdata, event_type});
 }
 
 void ScheduleEventThreadsafe(s64 cycles_into_future, const EventType* event_type, u64 userdata) {
-    ts_queue.Push(Event{global_timer + cycles_into_future, 0, userdata, event_type});
+    Context& ctx = GetContext();
+    ctx.ts_queue.Push(Event{ctx.global_timer + cycles_into_future, 0, userdata, event_type, 0});
+}
+
+void HostEventBatch::Add(const EventType* event_type, u64 userdata,
+                         std::chrono::nanoseconds delay) {
+    ASSERT(event_type != nullptr);
+    entries.push_back({event_type, userdata, std::chrono::steady_clock::now() + delay});
+}
+
+void SubmitHostEvents(HostEventBatch batch, bool urgent) {
+    if (batch.Empty()) {
+        return;
+    }
+
+    Context& ctx = GetContext();
+    auto* node = new HostEventNode{std::move(batch), ctx.host_event_stack.load()};
+    while (!ctx.host_event_stack.compare_exchange_weak(node->next, node)) {
+    }
+
+    if (urgent) {
+        std::lock_guard<std::mutex> lock(ctx.host_wakeup_mutex);
+        if (ctx.host_wakeup_callback) {
+            ctx.host_wakeup_callback();
+        }
+    }
+}
+
+void ScheduleEventFromHost(const EventType* event_type, u64 userdata,
+                           std::chrono::nanoseconds delay, bool urgent) {
+    HostEventBatch batch;
+    batch.Add(event_type, userdata, delay);
+    SubmitHostEvents(std::move(batch), urgent);
+}
+
+void SetHostEventWakeupCallback(std::function<void()> callback) {
+    Context& ctx = GetContext();
+    std::lock_guard<std::mutex> lock(ctx.host_wakeup_mutex);
+    ctx.host_wakeup_callback = std::move(callback);
 }
 
 void UnscheduleEvent(const EventType* event_type, u64 userdata) {
-    auto itr = std::remove_if(event_queue.begin(), event_queue.end(), [&](const Event& e) {
-        return e.type == event_type && e.userdata == userdata;
-    });
+    Context& ctx = GetContext();
+    auto itr = ctx.scheduled_events.find({event_type, userdata});
+    if (itr == ctx.scheduled_events.end()) {
+        return;
+    }
 
-    // Removing random items breaks the invariant so we have to re-establish it.
-    if (itr != event_queue.end()) {
-        event_queue.erase(itr, event_queue.end());
-        std::make_heap(event_queue.begin(), event_queue.end(), std::greater<Event>());
+    // Popping the last matching event erases the map entry, so don't hold on to the iterator
+    for (size_t remaining = itr->second.size(); remaining > 0; --remaining) {
+        const size_t slot = ctx.scheduled_events[{event_type, userdata}].back();
+        PopEventAt(ctx, ctx.event_positions[slot]);
     }
 }
 
 void RemoveEvent(const EventType* event_type) {
-    auto itr = std::remove_if(event_queue.begin(), event_queue.end(),
-                              [&](const Event& e) { return e.type == event_type; });
+    Context& ctx = GetContext();
+    // Not indexed by type alone, but this is only used for rare, whole-type removals
+    std::vector<size_t> slots;
+    for (const Event& event : ctx.event_queue) {
+        if (event.type == event_type) {
+            slots.push_back(event.slot);
+        }
+    }
 
-    // Removing random items breaks the invariant so we have to re-establish it.
-    if (itr != event_queue.end()) {
-        event_queue.erase(itr, event_queue.end());
-        std::make_heap(event_queue.begin(), event_queue.end(), std::greater<Event>());
+    for (size_t slot : slots) {
+        PopEventAt(ctx, ctx.event_positions[slot]);
     }
 }
 
@@ -178,61 +425,135 @@ void RemoveNormalAndThreadsafeEvent(const EventType* event_type) {
 }
 
 void ForceExceptionCheck(s64 cycles) {
+    Context& ctx = GetContext();
     cycles = std::max<s64>(0, cycles);
-    if (downcount > cycles) {
+    if (ctx.downcount > cycles) {
         // downcount is always (much) smaller than MAX_INT so we can safely cast cycles to an int
         // here. Account for cycles already executed by adjusting the g.slice_length
-        slice_length -= downcount - static_cast<int>(cycles);
-        downcount = static_cast<int>(cycles);
+        ctx.slice_length -= ctx.downcount - static_cast<int>(cycles);
+        ctx.downcount = static_cast<int>(cycles);
     }
 }
 
 void MoveEvents() {
-    for (Event ev; ts_queue.Pop(ev);) {
-        ev.fifo_order = event_fifo_id++;
-        event_queue.emplace_back(std::move(ev));
-        std::push_heap(event_queue.begin(), event_queue.end(), std::greater<Event>());
+    Context& ctx = GetContext();
+    for (Event ev; ctx.ts_queue.Pop(ev);) {
+        ev.fifo_order = ctx.event_fifo_id++;
+        PushEvent(ctx, std::move(ev));
+        ctx.moved_foreign_events = true;
+    }
+
+    HostEventNode* node = ctx.host_event_stack.exchange(nullptr);
+    if (node == nullptr) {
+        return;
+    }
+    ctx.moved_foreign_events = true;
+
+    // The stack holds the newest batch first, restore submission order to keep FIFO semantics
+    HostEventNode* ordered = nullptr;
+    while (node != nullptr) {
+        HostEventNode* next = node->next;
+        node->next = ordered;
+        ordered = node;
+        node = next;
+    }
+
+    // Convert whatever is left of each host delay into guest cycles from now
+    const auto now = std::chrono::steady_clock::now();
+    const s64 current_ticks = static_cast<s64>(GetTicks());
+    while (ordered != nullptr) {
+        for (const auto& entry : ordered->batch.entries) {
+            const s64 remaining_ns =
+                std::max<s64>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     entry.deadline - now)
+                                     .count());
+            PushEvent(ctx, Event{current_ticks + nsToCycles(remaining_ns), ctx.event_fifo_id++,
+                                 entry.userdata, entry.event_type, 0});
+        }
+
+        HostEventNode* next = ordered->next;
+        delete ordered;
+        ordered = next;
+    }
+}
+
+/**
+ * Adjusts the slice length cap at the end of a slice. Quiet slices that ran to completion double
+ * it, while slices with several events or events from other threads bring it back down, so that
+ * those aren't delayed for long.
+ */
+static void UpdateMaxSliceLength(Context& ctx, bool slice_completed, size_t events_fired) {
+    if (ctx.moved_foreign_events) {
+        ctx.max_slice_length = MAX_SLICE_LENGTH;
+    } else if (events_fired > 1) {
+        ctx.max_slice_length = std::max(ctx.max_slice_length / 2, MIN_ADAPTIVE_SLICE_LENGTH);
+    } else if (slice_completed && events_fired == 0) {
+        ctx.max_slice_length = std::min(ctx.max_slice_length * 2, MAX_ADAPTIVE_SLICE_LENGTH);
     }
 }
 
+MICROPROFILE_DEFINE(CoreTiming_Advance, "CoreTiming", "Advance", MP_RGB(200, 140, 40));
+
 void Advance() {
+    MICROPROFILE_SCOPE(CoreTiming_Advance);
+    Context& ctx = GetContext();
+    ctx.moved_foreign_events = false;
     MoveEvents();
 
-    int cycles_executed = slice_length - downcount;
-    global_timer += cycles_executed;
-    slice_length = MAX_SLICE_LENGTH;
+    int cycles_executed = ctx.slice_length - ctx.downcount;
+    const bool slice_completed = ctx.downcount <= 0;
+    ctx.global_timer += cycles_executed;
+    ctx.slice_length = ctx.max_slice_length;
 
-    is_global_timer_sane = true;
+    ctx.is_global_timer_sane = true;
 
-    while (!event_queue.empty() && event_queue.front().time <= global_timer) {
-        Event evt = std::move(event_queue.front());
-        std::pop_heap(event_queue.begin(), event_queue.end(), std::greater<Event>());
-        event_queue.pop_back();
-        evt.type->callback(evt.userdata, global_timer - evt.time);
+    size_t events_fired = 0;
+    while (!ctx.event_queue.empty() && ctx.event_queue.front().time <= ctx.global_timer) {
+        Event evt = PopEventAt(ctx, 0);
+        evt.type->callback(evt.userdata, ctx.global_timer - evt.time);
+        ++events_fired;
     }
 
-    is_global_timer_sane = false;
+    ctx.is_global_timer_sane = false;
+
+    if (ctx.adaptive_slicing) {
+        UpdateMaxSliceLength(ctx, slice_completed, events_fired);
+        ctx.slice_length = ctx.max_slice_length;
+    }
 
     // Still events left (scheduled in the future)
-    if (!event_queue.empty()) {
-        slice_length = static_cast<int>(
-            std::min<s64>(event_queue.front().time - global_timer, MAX_SLICE_LENGTH));
+    if (!ctx.event_queue.empty()) {
+        ctx.slice_length = static_cast<int>(
+            std::min<s64>(ctx.event_queue.front().time - ctx.global_timer, ctx.max_slice_length));
     }
 
-    downcount = slice_length;
+    ctx.downcount = ctx.slice_length;
 }
 
 void Idle() {
-    idled_cycles += downcount;
-    downcount = 0;
+    Context& ctx = GetContext();
+    ctx.idled_cycles += ctx.downcount;
+    ctx.downcount = 0;
+}
+
+void SetAdaptiveSliceLength(bool enabled) {
+    Context& ctx = GetContext();
+    ctx.adaptive_slicing = enabled;
+    if (!enabled) {
+        ctx.max_slice_length = MAX_SLICE_LENGTH;
+    }
+}
+
+u64 GetGlobalTimeNs() {
+    return CYCLES_TO_NS.Apply(GetTicks());
 }
 
 u64 GetGlobalTimeUs() {
-    return GetTicks() * 1000000 / BASE_CLOCK_RATE;
+    return CYCLES_TO_US.Apply(GetTicks());
 }
 
 int GetDowncount() {
-    return downcount;
+    return GetContext().downcount;
 }
 
 } // namespace CoreTiming
@@ -17,16 +17,62 @@
  *   ScheduleEvent(periodInCycles - cyclesLate, callback, "whatever")
  */
 
+#include <chrono>
 #include <functional>
 #include <limits>
+#include <memory>
 #include <string>
+#include <vector>
 #include "common/common_types.h"
 #include "common/logging/log.h"
+#include "common/math_util.h"
 
 // The below clock rate is based on Switch's clockspeed being widely known as 1.020GHz
 // The exact value used is of course unverified.
 constexpr u64 BASE_CLOCK_RATE = 1019215872; // Switch clock speed is 1020MHz un/docked
-constexpr u64 MAX_VALUE_TO_MULTIPLY = std::numeric_limits<s64>::max() / BASE_CLOCK_RATE;
+
+/**
+ * A ratio between two units in 64.64 fixed-point, precomputed so that conversions take a
+ * multiplication instead of a 64-bit division.
+ */
+struct FixedPointRatio {
+    constexpr FixedPointRatio(u64 numerator, u64 denominator)
+        : integer(numerator / denominator), fraction(0) {
+        // Long division of the remainder, one bit of the fraction at a time
+        u64 remainder = numerator % denominator;
+        for (int bit = 0; bit < 64; ++bit) {
+            const bool carry = remainder >> 63;
+            remainder <<= 1;
+            fraction <<= 1;
+            if (carry || remainder >= denominator) {
+                remainder -= denominator;
+                fraction |= 1;
+            }
+        }
+        // Rounded up, so that exact multiples convert exactly
+        if (remainder != 0) {
+            ++fraction;
+        }
+    }
+
+    /// Converts a value, rounding down. Results past 2^64 / denominator may be one too high.
+    constexpr u64 Apply(u64 value) const {
+        return value * integer + MathUtil::MultiplyHigh(value, fraction);
+    }
+
+    u64 integer;
+    u64 fraction;
+};
+
+constexpr FixedPointRatio CYCLES_TO_NS{1000000000, BASE_CLOCK_RATE};
+constexpr FixedPointRatio CYCLES_TO_US{1000000, BASE_CLOCK_RATE};
+constexpr FixedPointRatio CYCLES_TO_MS{1000, BASE_CLOCK_RATE};
+constexpr FixedPointRatio NS_TO_CYCLES{BASE_CLOCK_RATE, 1000000000};
+constexpr FixedPointRatio US_TO_CYCLES{BASE_CLOCK_RATE, 1000000};
+
+/// Longest durations that can be converted to cycles without overflowing an s64
+constexpr u64 MAX_CONVERTIBLE_NS = CYCLES_TO_NS.Apply(std::numeric_limits<s64>::max());
+constexpr u64 MAX_CONVERTIBLE_US = CYCLES_TO_US.Apply(std::numeric_limits<s64>::max());
 
 inline s64 msToCycles(int ms) {
     // since ms is int there is no way to overflow
@@ -49,28 +95,16 @@ inline s64 usToCycles(int us) {
     return (BASE_CLOCK_RATE * static_cast<s64>(us) / 1000000);
 }
 
-inline s64 usToCycles(s64 us) {
-    if (us / 1000000 > MAX_VALUE_TO_MULTIPLY) {
+inline s64 usToCycles(u64 us) {
+    if (us >= MAX_CONVERTIBLE_US) {
         LOG_ERROR(Core_Timing, "Integer overflow, use max value");
         return std::numeric_limits<s64>::max();
     }
-    if (us > MAX_VALUE_TO_MULTIPLY) {
-        LOG_DEBUG(Core_Timing, "Time very big, do rounding");
-        return BASE_CLOCK_RATE * (us / 1000000);
-    }
-    return (BASE_CLOCK_RATE * us) / 1000000;
+    return static_cast<s64>(US_TO_CYCLES.Apply(us));
 }
 
-inline s64 usToCycles(u64 us) {
-    if (us / 1000000 > MAX_VALUE_TO_MULTIPLY) {
-        LOG_ERROR(Core_Timing, "Integer overflow, use max value");
-        return std::numeric_limits<s64>::max();
-    }
-    if (us > MAX_VALUE_TO_MULTIPLY) {
-        LOG_DEBUG(Core_Timing, "Time very big, do rounding");
-        return BASE_CLOCK_RATE * static_cast<s64>(us / 1000000);
-    }
-    return (BASE_CLOCK_RATE * static_cast<s64>(us)) / 1000000;
+inline s64 usToCycles(s64 us) {
+    return us < 0 ? -usToCycles(static_cast<u64>(-us)) : usToCycles(static_cast<u64>(us));
 }
 
 inline s64 nsToCycles(float ns) {
@@ -81,44 +115,52 @@ inline s64 nsToCycles(int ns) {
     return BASE_CLOCK_RATE * static_cast<s64>(ns) / 1000000000;
 }
 
-inline s64 nsToCycles(s64 ns) {
-    if (ns / 1000000000 > MAX_VALUE_TO_MULTIPLY) {
+inline s64 nsToCycles(u64 ns) {
+    if (ns >= MAX_CONVERTIBLE_NS) {
         LOG_ERROR(Core_Timing, "Integer overflow, use max value");
         return std::numeric_limits<s64>::max();
     }
-    if (ns > MAX_VALUE_TO_MULTIPLY) {
-        LOG_DEBUG(Core_Timing, "Time very big, do rounding");
-        return BASE_CLOCK_RATE * (ns / 1000000000);
-    }
-    return (BASE_CLOCK_RATE * ns) / 1000000000;
+    return static_cast<s64>(NS_TO_CYCLES.Apply(ns));
 }
 
-inline s64 nsToCycles(u64 ns) {
-    if (ns / 1000000000 > MAX_VALUE_TO_MULTIPLY) {
-        LOG_ERROR(Core_Timing, "Integer overflow, use max value");
-        return std::numeric_limits<s64>::max();
-    }
-    if (ns > MAX_VALUE_TO_MULTIPLY) {
-        LOG_DEBUG(Core_Timing, "Time very big, do rounding");
-        return BASE_CLOCK_RATE * (static_cast<s64>(ns) / 1000000000);
-    }
-    return (BASE_CLOCK_RATE * static_cast<s64>(ns)) / 1000000000;
+inline s64 nsToCycles(s64 ns) {
+    return ns < 0 ? -nsToCycles(static_cast<u64>(-ns)) : nsToCycles(static_cast<u64>(ns));
 }
 
 inline u64 cyclesToNs(s64 cycles) {
-    return cycles * 1000000000 / BASE_CLOCK_RATE;
+    return CYCLES_TO_NS.Apply(static_cast<u64>(cycles));
 }
 
 inline s64 cyclesToUs(s64 cycles) {
-    return cycles * 1000000 / BASE_CLOCK_RATE;
+    return static_cast<s64>(CYCLES_TO_US.Apply(static_cast<u64>(cycles)));
 }
 
 inline u64 cyclesToMs(s64 cycles) {
-    return cycles * 1000 / BASE_CLOCK_RATE;
+    return CYCLES_TO_MS.Apply(static_cast<u64>(cycles));
 }
 
 namespace CoreTiming {
 
+/**
+ * Timing state of an emulated system: its clock, its scheduled events and its event types. The
+ * functions of this namespace act on the context bound to the calling thread, or on a default
+ * context shared by the threads that didn't bind one. A host process can then run several
+ * emulated systems, binding the threads of each to its own context, including the host threads
+ * submitting events.
+ */
+struct Context;
+
+struct ContextDeleter {
+    void operator()(Context* context) const;
+};
+using ContextPtr = std::unique_ptr<Context, ContextDeleter>;
+
+/// Creates a timing context for another emulated system, Init prepares it once bound
+ContextPtr CreateContext();
+
+/// Binds a context to the calling thread, nullptr goes back to the default context
+void BindContext(Context* context);
+
 /**
  * CoreTiming begins at the boundary of timing slice -1. An initial call to Advance() is
  * required to end slice -1 and start slice 0 before the first cycle of code is executed.
@@ -136,6 +178,20 @@ u64 GetTicks();
 u64 GetIdleTicks();
 void AddTicks(u64 ticks);
 
+/**
+ * Sets the clock rate of the emulated CPU. The ticks stay at BASE_CLOCK_RATE, the timebase of the
+ * guest time, while the cycles executed by the CPU are converted to ticks at this rate. A lower
+ * clock rate runs fewer guest instructions per emulated second.
+ */
+void SetCpuClockRate(u64 clock_rate);
+u64 GetCpuClockRate();
+
+/// Gets the number of cycles the emulated CPU executes in a number of ticks, at least one
+int TicksToCpuCycles(int ticks);
+
+/// Advances the time by the duration of a number of cycles executed by the emulated CPU
+void AddCpuCycles(u64 cycles);
+
 struct EventType;
 
 /**
@@ -159,6 +215,49 @@ void ScheduleEvent(s64 cycles_into_future, const EventType* event_type, u64 user
  */
 void ScheduleEventThreadsafe(s64 cycles_into_future, const EventType* event_type, u64 userdata);
 
+/**
+ * A batch of events produced on a host thread other than the emu thread, such as the GPU, audio
+ * or input threads. Delays are measured in host time from the moment an event is added, and are
+ * converted to guest cycles when the batch arrives on the emu thread.
+ */
+class HostEventBatch {
+public:
+    void Add(const EventType* event_type, u64 userdata,
+             std::chrono::nanoseconds delay = std::chrono::nanoseconds::zero());
+
+    bool Empty() const {
+        return entries.empty();
+    }
+
+private:
+    friend void MoveEvents();
+
+    struct Entry {
+        const EventType* event_type;
+        u64 userdata;
+        std::chrono::steady_clock::time_point deadline;
+    };
+    std::vector<Entry> entries;
+};
+
+/**
+ * Hands a batch of events over to the emu thread. This is lock-free and may be called from any
+ * thread. Events normally arrive at the next slice boundary; urgent ones also interrupt the
+ * emulated CPU so that they are handled as soon as possible.
+ */
+void SubmitHostEvents(HostEventBatch batch, bool urgent = false);
+
+/// Convenience wrapper submitting a single event from a host thread
+void ScheduleEventFromHost(const EventType* event_type, u64 userdata,
+                           std::chrono::nanoseconds delay = std::chrono::nanoseconds::zero(),
+                           bool urgent = false);
+
+/**
+ * Sets the function used to interrupt the emu thread when urgent host events are submitted. It
+ * is called on the submitting thread. Pass nullptr to remove it.
+ */
+void SetHostEventWakeupCallback(std::function<void()> callback);
+
 void UnscheduleEvent(const EventType* event_type, u64 userdata);
 
 /// We only permit one event of each type in the queue at a time.
@@ -177,11 +276,20 @@ void MoveEvents();
 /// Pretend that the main CPU has executed enough cycles to reach the next event.
 void Idle();
 
+/**
+ * Enables or disables adaptive slice lengths. When enabled, slices grow past the default length
+ * while no events come up and execution isn't interrupted, and shrink again around dense event
+ * activity or when events arrive from other threads. Disabled by default.
+ */
+void SetAdaptiveSliceLength(bool enabled);
+
 /// Clear all pending events. This should ONLY be done on exit.
 void ClearPendingEvents();
 
 void ForceExceptionCheck(s64 cycles);
 
+/// Guest time since the start of the emulation, converted from the ticks without divisions
+u64 GetGlobalTimeNs();
 u64 GetGlobalTimeUs();
 
 int GetDowncount();
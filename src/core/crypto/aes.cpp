@@ -0,0 +1,487 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <vector>
+#include "common/alignment.h"
+#include "common/assert.h"
+#include "common/kernel_dispatch.h"
+#include "common/thread_pool.h"
+#include "core/crypto/aes.h"
+
+#ifdef ARCHITECTURE_x86_64
+#include <immintrin.h>
+#include "common/x64/cpu_detect.h"
+#endif
+
+namespace Crypto {
+
+/// Number of blocks the modes prepare at once before running the block cipher over them
+constexpr size_t BATCH_BLOCKS = 64;
+constexpr size_t BATCH_SIZE = BATCH_BLOCKS * AES_BLOCK_SIZE;
+
+/// Buffers larger than this are split in chunks of this size, transformed in parallel
+constexpr size_t PARALLEL_CHUNK_SIZE = 0x40000;
+
+/// Block cipher kernel, running the rounds with the given round keys over whole blocks
+using BlockFunc = void (*)(const u8* round_keys, const u8* src, u8* dst, size_t num_blocks);
+
+struct Kernels {
+    BlockFunc encrypt;
+    BlockFunc decrypt;
+};
+
+static u8 XTime(u8 value) {
+    return static_cast<u8>((value << 1) ^ ((value & 0x80) != 0 ? 0x1B : 0));
+}
+
+/// Multiplies two elements of the field of AES
+static u8 Multiply(u8 lhs, u8 rhs) {
+    u8 product = 0;
+    for (; rhs != 0; rhs >>= 1) {
+        if ((rhs & 1) != 0) {
+            product ^= lhs;
+        }
+        lhs = XTime(lhs);
+    }
+    return product;
+}
+
+/// Substitution boxes and the multiplications of the inverse MixColumns step
+struct Tables {
+    std::array<u8, 256> sbox;
+    std::array<u8, 256> inverse_sbox;
+    std::array<u8, 256> mul9;
+    std::array<u8, 256> mul11;
+    std::array<u8, 256> mul13;
+    std::array<u8, 256> mul14;
+};
+
+static Tables BuildTables() {
+    Tables tables{};
+    for (unsigned value = 0; value < 256; ++value) {
+        // The multiplicative inverse is value^254, 0 has none and maps to 0
+        u8 inverse = value == 0 ? 0 : 1;
+        for (unsigned power = 0; power < 254 && value != 0; ++power) {
+            inverse = Multiply(inverse, static_cast<u8>(value));
+        }
+        u8 substituted = inverse ^ 0x63;
+        for (unsigned shift = 1; shift <= 4; ++shift) {
+            substituted ^= static_cast<u8>((inverse << shift) | (inverse >> (8 - shift)));
+        }
+        tables.sbox[value] = substituted;
+        tables.inverse_sbox[substituted] = static_cast<u8>(value);
+
+        const u8 byte = static_cast<u8>(value);
+        tables.mul9[value] = Multiply(byte, 9);
+        tables.mul11[value] = Multiply(byte, 11);
+        tables.mul13[value] = Multiply(byte, 13);
+        tables.mul14[value] = Multiply(byte, 14);
+    }
+    return tables;
+}
+
+static const Tables& GetTables() {
+    static const Tables tables = BuildTables();
+    return tables;
+}
+
+/// Applies the inverse MixColumns step to the four columns of a block
+static void InverseMixColumns(const Tables& tables, u8* state) {
+    for (size_t column = 0; column < 4; ++column) {
+        u8* bytes = state + column * 4;
+        const u8 a0 = bytes[0], a1 = bytes[1], a2 = bytes[2], a3 = bytes[3];
+        bytes[0] = tables.mul14[a0] ^ tables.mul11[a1] ^ tables.mul13[a2] ^ tables.mul9[a3];
+        bytes[1] = tables.mul9[a0] ^ tables.mul14[a1] ^ tables.mul11[a2] ^ tables.mul13[a3];
+        bytes[2] = tables.mul13[a0] ^ tables.mul9[a1] ^ tables.mul14[a2] ^ tables.mul11[a3];
+        bytes[3] = tables.mul11[a0] ^ tables.mul13[a1] ^ tables.mul9[a2] ^ tables.mul14[a3];
+    }
+}
+
+static void AddRoundKey(u8* state, const u8* round_key) {
+    for (size_t i = 0; i < AES_BLOCK_SIZE; ++i) {
+        state[i] ^= round_key[i];
+    }
+}
+
+/// The state is stored column by column, row r of column c is at r + 4 * c
+static void EncryptBlockSoftware(const Tables& tables, const u8* round_keys, u8* state) {
+    AddRoundKey(state, round_keys);
+    for (size_t round = 1; round <= 10; ++round) {
+        // SubBytes and ShiftRows, row r is rotated left by r columns
+        u8 shifted[AES_BLOCK_SIZE];
+        for (size_t i = 0; i < AES_BLOCK_SIZE; ++i) {
+            const size_t row = i % 4;
+            const size_t column = i / 4;
+            shifted[i] = tables.sbox[state[row + 4 * ((column + row) % 4)]];
+        }
+        if (round == 10) {
+            std::memcpy(state, shifted, AES_BLOCK_SIZE);
+        } else {
+            for (size_t column = 0; column < 4; ++column) {
+                const u8* a = shifted + column * 4;
+                const u8 all = a[0] ^ a[1] ^ a[2] ^ a[3];
+                for (size_t row = 0; row < 4; ++row) {
+                    state[column * 4 + row] = a[row] ^ all ^ XTime(a[row] ^ a[(row + 1) % 4]);
+                }
+            }
+        }
+        AddRoundKey(state, round_keys + round * AES_BLOCK_SIZE);
+    }
+}
+
+/// Equivalent inverse cipher, with round keys the inverse MixColumns was applied to
+static void DecryptBlockSoftware(const Tables& tables, const u8* round_keys, u8* state) {
+    AddRoundKey(state, round_keys);
+    for (size_t round = 1; round <= 10; ++round) {
+        // InvSubBytes and InvShiftRows, row r is rotated right by r columns
+        u8 shifted[AES_BLOCK_SIZE];
+        for (size_t i = 0; i < AES_BLOCK_SIZE; ++i) {
+            const size_t row = i % 4;
+            const size_t column = i / 4;
+            shifted[i] = tables.inverse_sbox[state[row + 4 * ((column + 4 - row) % 4)]];
+        }
+        std::memcpy(state, shifted, AES_BLOCK_SIZE);
+        if (round != 10) {
+            InverseMixColumns(tables, state);
+        }
+        AddRoundKey(state, round_keys + round * AES_BLOCK_SIZE);
+    }
+}
+
+static void EncryptBlocksSoftware(const u8* round_keys, const u8* src, u8* dst,
+                                  size_t num_blocks) {
+    const Tables& tables = GetTables();
+    for (size_t block = 0; block < num_blocks; ++block) {
+        std::memmove(dst + block * AES_BLOCK_SIZE, src + block * AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+        EncryptBlockSoftware(tables, round_keys, dst + block * AES_BLOCK_SIZE);
+    }
+}
+
+static void DecryptBlocksSoftware(const u8* round_keys, const u8* src, u8* dst,
+                                  size_t num_blocks) {
+    const Tables& tables = GetTables();
+    for (size_t block = 0; block < num_blocks; ++block) {
+        std::memmove(dst + block * AES_BLOCK_SIZE, src + block * AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+        DecryptBlockSoftware(tables, round_keys, dst + block * AES_BLOCK_SIZE);
+    }
+}
+
+#ifdef ARCHITECTURE_x86_64
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AESNI __attribute__((target("aes,sse2")))
+#else
+#define TARGET_AESNI
+#endif
+
+/// Blocks are independent, so several of them are in flight to hide the latency of the rounds
+constexpr size_t AESNI_INTERLEAVE = 4;
+
+TARGET_AESNI static void EncryptBlocksAESNI(const u8* round_keys, const u8* src, u8* dst,
+                                            size_t num_blocks) {
+    __m128i keys[11];
+    for (size_t round = 0; round <= 10; ++round) {
+        keys[round] = _mm_load_si128(reinterpret_cast<const __m128i*>(round_keys) + round);
+    }
+    const auto* in = reinterpret_cast<const __m128i*>(src);
+    auto* out = reinterpret_cast<__m128i*>(dst);
+
+    size_t block = 0;
+    for (; block + AESNI_INTERLEAVE <= num_blocks; block += AESNI_INTERLEAVE) {
+        __m128i state[AESNI_INTERLEAVE];
+        for (size_t i = 0; i < AESNI_INTERLEAVE; ++i) {
+            state[i] = _mm_xor_si128(_mm_loadu_si128(in + block + i), keys[0]);
+        }
+        for (size_t round = 1; round < 10; ++round) {
+            for (size_t i = 0; i < AESNI_INTERLEAVE; ++i) {
+                state[i] = _mm_aesenc_si128(state[i], keys[round]);
+            }
+        }
+        for (size_t i = 0; i < AESNI_INTERLEAVE; ++i) {
+            _mm_storeu_si128(out + block + i, _mm_aesenclast_si128(state[i], keys[10]));
+        }
+    }
+    for (; block < num_blocks; ++block) {
+        __m128i state = _mm_xor_si128(_mm_loadu_si128(in + block), keys[0]);
+        for (size_t round = 1; round < 10; ++round) {
+            state = _mm_aesenc_si128(state, keys[round]);
+        }
+        _mm_storeu_si128(out + block, _mm_aesenclast_si128(state, keys[10]));
+    }
+}
+
+TARGET_AESNI static void DecryptBlocksAESNI(const u8* round_keys, const u8* src, u8* dst,
+                                            size_t num_blocks) {
+    __m128i keys[11];
+    for (size_t round = 0; round <= 10; ++round) {
+        keys[round] = _mm_load_si128(reinterpret_cast<const __m128i*>(round_keys) + round);
+    }
+    const auto* in = reinterpret_cast<const __m128i*>(src);
+    auto* out = reinterpret_cast<__m128i*>(dst);
+
+    size_t block = 0;
+    for (; block + AESNI_INTERLEAVE <= num_blocks; block += AESNI_INTERLEAVE) {
+        __m128i state[AESNI_INTERLEAVE];
+        for (size_t i = 0; i < AESNI_INTERLEAVE; ++i) {
+            state[i] = _mm_xor_si128(_mm_loadu_si128(in + block + i), keys[0]);
+        }
+        for (size_t round = 1; round < 10; ++round) {
+            for (size_t i = 0; i < AESNI_INTERLEAVE; ++i) {
+                state[i] = _mm_aesdec_si128(state[i], keys[round]);
+            }
+        }
+        for (size_t i = 0; i < AESNI_INTERLEAVE; ++i) {
+            _mm_storeu_si128(out + block + i, _mm_aesdeclast_si128(state[i], keys[10]));
+        }
+    }
+    for (; block < num_blocks; ++block) {
+        __m128i state = _mm_xor_si128(_mm_loadu_si128(in + block), keys[0]);
+        for (size_t round = 1; round < 10; ++round) {
+            state = _mm_aesdec_si128(state, keys[round]);
+        }
+        _mm_storeu_si128(out + block, _mm_aesdeclast_si128(state, keys[10]));
+    }
+}
+
+static constexpr Kernels AESNI_KERNELS{EncryptBlocksAESNI, DecryptBlocksAESNI};
+
+#undef TARGET_AESNI
+
+#endif // ARCHITECTURE_x86_64
+
+static constexpr Kernels SOFTWARE_KERNELS{EncryptBlocksSoftware, DecryptBlocksSoftware};
+
+static const Kernels* SelectKernels(AESIsa isa) {
+    switch (isa) {
+#ifdef ARCHITECTURE_x86_64
+    case AESIsa::AESNI:
+        Common::RecordKernelSelection("AES", "AESNI");
+        return &AESNI_KERNELS;
+#endif
+    default:
+        Common::RecordKernelSelection("AES", "Software");
+        return &SOFTWARE_KERNELS;
+    }
+}
+
+static AESIsa GetBestAESIsa() {
+#ifdef ARCHITECTURE_x86_64
+    if (Common::GetCPUCaps().aes) {
+        return AESIsa::AESNI;
+    }
+#endif
+    return AESIsa::Software;
+}
+
+static const Kernels*& GetKernels() {
+    static const Kernels* kernels = SelectKernels(GetBestAESIsa());
+    return kernels;
+}
+
+bool IsAESIsaSupported(AESIsa isa) {
+    switch (isa) {
+    case AESIsa::Software:
+        return true;
+    case AESIsa::AESNI:
+        return GetBestAESIsa() == AESIsa::AESNI;
+    }
+    return false;
+}
+
+void SetAESIsa(AESIsa isa) {
+    ASSERT(IsAESIsaSupported(isa));
+    GetKernels() = SelectKernels(isa);
+}
+
+AESCipher::AESCipher(const AESKey& key) {
+    const Tables& tables = GetTables();
+
+    // Each word of the expanded key is the word before it, transformed at the start of each
+    // round key, XORed with the word of the previous round key
+    std::memcpy(encryption_keys.data(), key.data(), key.size());
+    u8 round_constant = 1;
+    for (size_t offset = key.size(); offset < encryption_keys.size(); offset += 4) {
+        u8 word[4];
+        std::memcpy(word, &encryption_keys[offset - 4], 4);
+        if (offset % AES_BLOCK_SIZE == 0) {
+            const u8 first = word[0];
+            word[0] = tables.sbox[word[1]] ^ round_constant;
+            word[1] = tables.sbox[word[2]];
+            word[2] = tables.sbox[word[3]];
+            word[3] = tables.sbox[first];
+            round_constant = XTime(round_constant);
+        }
+        for (size_t i = 0; i < 4; ++i) {
+            encryption_keys[offset + i] = encryption_keys[offset - AES_BLOCK_SIZE + i] ^ word[i];
+        }
+    }
+
+    // The decryption runs the rounds backwards, the inner keys go through the inverse MixColumns
+    for (size_t round = 0; round <= NUM_ROUNDS; ++round) {
+        u8* round_key = &decryption_keys[round * AES_BLOCK_SIZE];
+        std::memcpy(round_key, &encryption_keys[(NUM_ROUNDS - round) * AES_BLOCK_SIZE],
+                    AES_BLOCK_SIZE);
+        if (round != 0 && round != NUM_ROUNDS) {
+            InverseMixColumns(tables, round_key);
+        }
+    }
+}
+
+void AESCipher::EncryptBlocks(const u8* src, u8* dst, size_t num_blocks) const {
+    GetKernels()->encrypt(encryption_keys.data(), src, dst, num_blocks);
+}
+
+void AESCipher::DecryptBlocks(const u8* src, u8* dst, size_t num_blocks) const {
+    GetKernels()->decrypt(decryption_keys.data(), src, dst, num_blocks);
+}
+
+/**
+ * Runs a transform over a buffer, split in chunks transformed in parallel on the thread pool if
+ * it is large. The chunks start at multiples of the alignment.
+ * @param transform Callable taking the offset and size of a chunk.
+ */
+template <typename Transform>
+static void TransformChunks(size_t size, size_t alignment, const Transform& transform) {
+    const size_t chunk_size = Common::AlignUp(PARALLEL_CHUNK_SIZE, alignment);
+    if (size <= chunk_size) {
+        transform(0, size);
+        return;
+    }
+
+    std::vector<std::future<void>> tasks;
+    for (size_t offset = chunk_size; offset < size; offset += chunk_size) {
+        const size_t this_chunk_size = std::min(chunk_size, size - offset);
+        tasks.push_back(Common::ThreadPool::GetInstance().Submit(
+            [&transform, offset, this_chunk_size] { transform(offset, this_chunk_size); },
+            Common::TaskPriority::High));
+    }
+    // The caller transforms the first chunk rather than waiting idle
+    transform(0, chunk_size);
+    for (auto& task : tasks) {
+        task.get();
+    }
+}
+
+/// Writes the big-endian sum of a counter and a block index
+static void AddToCounter(const AESBlock& counter, u64 value, u8* out) {
+    unsigned carry = 0;
+    for (size_t i = AES_BLOCK_SIZE; i-- > 0;) {
+        const unsigned sum = counter[i] + static_cast<unsigned>(value & 0xFF) + carry;
+        out[i] = static_cast<u8>(sum);
+        carry = sum >> 8;
+        value >>= 8;
+    }
+}
+
+/// XORs a part of the storage starting at any offset with the key stream
+static void TransformCTR(const AESCipher& cipher, const AESBlock& counter, u64 offset,
+                         const u8* src, u8* dst, size_t size) {
+    alignas(16) std::array<u8, BATCH_SIZE> key_stream;
+    u64 block = offset / AES_BLOCK_SIZE;
+    size_t skip = static_cast<size_t>(offset % AES_BLOCK_SIZE);
+    while (size != 0) {
+        const size_t num_blocks =
+            std::min(BATCH_BLOCKS, (skip + size + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE);
+        for (size_t i = 0; i < num_blocks; ++i) {
+            AddToCounter(counter, block + i, &key_stream[i * AES_BLOCK_SIZE]);
+        }
+        cipher.EncryptBlocks(key_stream.data(), key_stream.data(), num_blocks);
+
+        const size_t count = std::min(size, num_blocks * AES_BLOCK_SIZE - skip);
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = src[i] ^ key_stream[skip + i];
+        }
+        src += count;
+        dst += count;
+        size -= count;
+        block += num_blocks;
+        skip = 0;
+    }
+}
+
+AESCTRCipher::AESCTRCipher(const AESKey& key, const AESBlock& counter)
+    : cipher(key), counter(counter) {}
+
+void AESCTRCipher::Decrypt(u64 offset, const u8* src, u8* dst, size_t size) const {
+    Encrypt(offset, src, dst, size);
+}
+
+void AESCTRCipher::Encrypt(u64 offset, const u8* src, u8* dst, size_t size) const {
+    TransformChunks(size, AES_BLOCK_SIZE, [&](size_t chunk_offset, size_t chunk_size) {
+        TransformCTR(cipher, counter, offset + chunk_offset, src + chunk_offset,
+                     dst + chunk_offset, chunk_size);
+    });
+}
+
+/// Multiplies a tweak by the primitive element of GF(2^128), in little-endian order
+static void MultiplyByAlpha(u8* tweak) {
+    const bool carry = (tweak[AES_BLOCK_SIZE - 1] & 0x80) != 0;
+    for (size_t i = AES_BLOCK_SIZE - 1; i > 0; --i) {
+        tweak[i] = static_cast<u8>((tweak[i] << 1) | (tweak[i - 1] >> 7));
+    }
+    tweak[0] = static_cast<u8>((tweak[0] << 1) ^ (carry ? 0x87 : 0));
+}
+
+AESXTSCipher::AESXTSCipher(const AESKey& data_key, const AESKey& tweak_key, size_t sector_size,
+                           u64 first_sector)
+    : data_cipher(data_key), tweak_cipher(tweak_key), sector_size(sector_size),
+      first_sector(first_sector) {
+    ASSERT_MSG(sector_size != 0 && sector_size % AES_BLOCK_SIZE == 0,
+               "Unsupported XTS sector size %zu", sector_size);
+}
+
+void AESXTSCipher::Decrypt(u64 offset, const u8* src, u8* dst, size_t size) const {
+    Transform<false>(offset, src, dst, size);
+}
+
+void AESXTSCipher::Encrypt(u64 offset, const u8* src, u8* dst, size_t size) const {
+    Transform<true>(offset, src, dst, size);
+}
+
+template <bool IsEncryption>
+void AESXTSCipher::Transform(u64 offset, const u8* src, u8* dst, size_t size) const {
+    ASSERT(offset % sector_size == 0 && size % sector_size == 0);
+
+    TransformChunks(size, sector_size, [&](size_t chunk_offset, size_t chunk_size) {
+        alignas(16) std::array<u8, BATCH_SIZE> tweaks;
+        alignas(16) std::array<u8, BATCH_SIZE> buffer;
+        for (size_t sector_offset = chunk_offset; sector_offset < chunk_offset + chunk_size;
+             sector_offset += sector_size) {
+            const u64 sector = first_sector + (offset + sector_offset) / sector_size;
+            AESBlock tweak{};
+            for (size_t i = 0; i < sizeof(sector); ++i) {
+                tweak[i] = static_cast<u8>(sector >> (i * 8));
+            }
+            tweak_cipher.EncryptBlocks(tweak.data(), tweak.data(), 1);
+
+            for (size_t batch = 0; batch < sector_size; batch += BATCH_SIZE) {
+                const size_t batch_size = std::min(BATCH_SIZE, sector_size - batch);
+                const u8* in = src + sector_offset + batch;
+                u8* out = dst + sector_offset + batch;
+                for (size_t block = 0; block < batch_size; block += AES_BLOCK_SIZE) {
+                    std::memcpy(&tweaks[block], tweak.data(), AES_BLOCK_SIZE);
+                    MultiplyByAlpha(tweak.data());
+                }
+                for (size_t i = 0; i < batch_size; ++i) {
+                    buffer[i] = in[i] ^ tweaks[i];
+                }
+                if (IsEncryption) {
+                    data_cipher.EncryptBlocks(buffer.data(), buffer.data(),
+                                              batch_size / AES_BLOCK_SIZE);
+                } else {
+                    data_cipher.DecryptBlocks(buffer.data(), buffer.data(),
+                                              batch_size / AES_BLOCK_SIZE);
+                }
+                for (size_t i = 0; i < batch_size; ++i) {
+                    out[i] = buffer[i] ^ tweaks[i];
+                }
+            }
+        }
+    });
+}
+
+} // namespace Crypto
@@ -0,0 +1,126 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include "common/common_types.h"
+
+/**
+ * AES-128 in the modes the encrypted storage of content archives uses, counter (CTR) and XTS. Both
+ * decrypt any part of the storage on its own, so that reads decrypt just what they read. The block
+ * cipher runs on AES-NI when the host supports it. Large buffers are decrypted in parallel on the
+ * shared thread pool, so the ciphers must not be used from tasks of that pool.
+ */
+namespace Crypto {
+
+constexpr size_t AES_BLOCK_SIZE = 16;
+
+using AESKey = std::array<u8, 16>;
+using AESBlock = std::array<u8, AES_BLOCK_SIZE>;
+
+/// Instruction sets the block cipher can run on
+enum class AESIsa {
+    Software,
+    AESNI,
+};
+
+/// Returns whether the host supports an instruction set, the software one always is
+bool IsAESIsaSupported(AESIsa isa);
+
+/// Overrides the instruction set picked for the host, for tests and benchmarks
+void SetAESIsa(AESIsa isa);
+
+/// AES-128 block cipher with its expanded keys
+class AESCipher {
+public:
+    explicit AESCipher(const AESKey& key);
+
+    /// Encrypts whole blocks, the buffers may be the same
+    void EncryptBlocks(const u8* src, u8* dst, size_t num_blocks) const;
+    /// Decrypts whole blocks, the buffers may be the same
+    void DecryptBlocks(const u8* src, u8* dst, size_t num_blocks) const;
+
+private:
+    static constexpr size_t NUM_ROUNDS = 10;
+
+    alignas(16) std::array<u8, (NUM_ROUNDS + 1) * AES_BLOCK_SIZE> encryption_keys;
+    /// Round keys in the order and form the equivalent inverse cipher uses them, like AES-NI does
+    alignas(16) std::array<u8, (NUM_ROUNDS + 1) * AES_BLOCK_SIZE> decryption_keys;
+};
+
+/// Cipher of a mode that transforms any aligned part of a storage on its own
+class StorageCipher {
+public:
+    virtual ~StorageCipher() = default;
+
+    /// Alignment of the offsets and sizes the cipher transforms, in bytes
+    virtual size_t GetAlignment() const = 0;
+
+    /**
+     * Decrypts a part of the storage.
+     * @param offset Offset of the part in the storage, a multiple of the alignment.
+     * @param size Size of the part, a multiple of the alignment unless it ends the storage.
+     */
+    virtual void Decrypt(u64 offset, const u8* src, u8* dst, size_t size) const = 0;
+
+    /// Encrypts a part of the storage, with the same constraints as Decrypt
+    virtual void Encrypt(u64 offset, const u8* src, u8* dst, size_t size) const = 0;
+};
+
+/**
+ * AES-CTR, which XORs the storage with the encrypted counters. The counter is a big-endian 128-bit
+ * number incremented for each block, which any offset can be decrypted from.
+ */
+class AESCTRCipher final : public StorageCipher {
+public:
+    /// @param counter Counter of the first block of the storage
+    AESCTRCipher(const AESKey& key, const AESBlock& counter);
+
+    size_t GetAlignment() const override {
+        return 1;
+    }
+
+    void Decrypt(u64 offset, const u8* src, u8* dst, size_t size) const override;
+    void Encrypt(u64 offset, const u8* src, u8* dst, size_t size) const override;
+
+private:
+    AESCipher cipher;
+    AESBlock counter;
+};
+
+/**
+ * XTS-AES-128 as specified by IEEE 1619, over sectors of a fixed size. The tweak of a sector is its
+ * index in little-endian order, encrypted with the tweak key. Sectors whose size isn't a multiple
+ * of the block size, which would need ciphertext stealing, are not supported.
+ */
+class AESXTSCipher final : public StorageCipher {
+public:
+    /**
+     * @param sector_size Size of the sectors, a multiple of the block size.
+     * @param first_sector Index of the sector at the start of the storage.
+     */
+    AESXTSCipher(const AESKey& data_key, const AESKey& tweak_key, size_t sector_size,
+                 u64 first_sector = 0);
+
+    size_t GetAlignment() const override {
+        return sector_size;
+    }
+
+    void Decrypt(u64 offset, const u8* src, u8* dst, size_t size) const override;
+    void Encrypt(u64 offset, const u8* src, u8* dst, size_t size) const override;
+
+private:
+    /// Transforms whole sectors, which are transformed in parallel
+    template <bool IsEncryption>
+    void Transform(u64 offset, const u8* src, u8* dst, size_t size) const;
+
+    AESCipher data_cipher;
+    AESCipher tweak_cipher;
+    size_t sector_size;
+    u64 first_sector;
+};
+
+} // namespace Crypto
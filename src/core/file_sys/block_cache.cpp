@@ -0,0 +1,201 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include "common/thread.h"
+#include "core/file_sys/block_cache.h"
+
+namespace FileSys {
+
+bool BlockCache::Key::operator<(const Key& other) const {
+    // Ordered by the ownership of the files, which stays valid after they are destroyed
+    if (file.owner_before(other.file)) {
+        return true;
+    }
+    if (other.file.owner_before(file)) {
+        return false;
+    }
+    return block < other.block;
+}
+
+BlockCache& BlockCache::GetInstance() {
+    static BlockCache instance;
+    return instance;
+}
+
+BlockCache::~BlockCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_shutting_down = true;
+    }
+    read_ahead_cv.notify_one();
+    if (io_thread.joinable()) {
+        io_thread.join();
+    }
+}
+
+BlockCache::Data BlockCache::FindBlock(const Key& key) {
+    const auto iter = index.find(key);
+    if (iter == index.end()) {
+        return nullptr;
+    }
+    entries.splice(entries.begin(), entries, iter->second);
+    return iter->second->data;
+}
+
+void BlockCache::InsertBlock(const Key& key, Data data) {
+    const auto iter = index.find(key);
+    if (iter != index.end()) {
+        // Read by the I/O thread and the emulation at the same time
+        return;
+    }
+    if (entries.size() == CAPACITY) {
+        index.erase(entries.back().key);
+        entries.pop_back();
+    }
+    entries.push_front({key, std::move(data)});
+    index.emplace(key, entries.begin());
+}
+
+BlockCache::Data BlockCache::ReadBlock(FileUtil::IOFile& file, u64 block) {
+    auto data = std::make_shared<std::vector<u8>>(BLOCK_SIZE);
+    file.Seek(static_cast<s64>(block * BLOCK_SIZE), SEEK_SET);
+    data->resize(file.ReadBytes(data->data(), data->size()));
+    return data;
+}
+
+BlockCache::Data BlockCache::GetBlock(const std::shared_ptr<FileUtil::IOFile>& file, u64 block) {
+    const Key key{file, block};
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (Data data = FindBlock(key)) {
+            ++hits;
+            return data;
+        }
+    }
+
+    ++misses;
+    std::lock_guard<std::mutex> file_lock(file_mutex);
+    Data data = ReadBlock(*file, block);
+    std::lock_guard<std::mutex> lock(mutex);
+    InsertBlock(key, data);
+    return data;
+}
+
+size_t BlockCache::Read(const std::shared_ptr<FileUtil::IOFile>& file, u64 offset, size_t length,
+                        u8* buffer) {
+    if (length >= BYPASS_SIZE) {
+        std::lock_guard<std::mutex> lock(file_mutex);
+        file->Seek(static_cast<s64>(offset), SEEK_SET);
+        return file->ReadBytes(buffer, length);
+    }
+
+    size_t read_length = 0;
+    while (read_length < length) {
+        const u64 position = offset + read_length;
+        const Data data = GetBlock(file, position / BLOCK_SIZE);
+        const size_t block_offset = static_cast<size_t>(position % BLOCK_SIZE);
+        if (block_offset >= data->size()) {
+            break;
+        }
+
+        const size_t copy_length = std::min(length - read_length, data->size() - block_offset);
+        std::memcpy(buffer + read_length, data->data() + block_offset, copy_length);
+        read_length += copy_length;
+    }
+
+    ScheduleReadAhead(file, offset, read_length);
+    return read_length;
+}
+
+void BlockCache::Invalidate(const std::shared_ptr<FileUtil::IOFile>& file) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const FileRef ref = file;
+    for (auto iter = index.lower_bound({ref, 0});
+         iter != index.end() && !ref.owner_before(iter->first.file) &&
+         !iter->first.file.owner_before(ref);) {
+        entries.erase(iter->second);
+        iter = index.erase(iter);
+    }
+}
+
+void BlockCache::ScheduleReadAhead(const std::shared_ptr<FileUtil::IOFile>& file, u64 offset,
+                                   size_t length) {
+    const FileRef ref = file;
+    const auto is_same_file = [&ref](const Stream& stream) {
+        return !stream.file.owner_before(ref) && !ref.owner_before(stream.file);
+    };
+
+    std::unique_lock<std::mutex> lock(mutex);
+    auto stream = std::find_if(streams.begin(), streams.end(), is_same_file);
+    if (stream == streams.end()) {
+        // Not read recently, replace the oldest stream
+        streams[next_stream] = {ref, offset + length};
+        next_stream = (next_stream + 1) % streams.size();
+        return;
+    }
+
+    const bool is_sequential = stream->next_offset == offset;
+    stream->next_offset = offset + length;
+    if (!is_sequential || length == 0) {
+        return;
+    }
+
+    const u64 next_block = (offset + length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    bool is_queued = false;
+    for (u64 block = next_block; block < next_block + READ_AHEAD_BLOCKS; ++block) {
+        const Key key{ref, block};
+        if (index.find(key) == index.end()) {
+            read_ahead_queue.push_back(key);
+            is_queued = true;
+        }
+    }
+    if (!is_queued) {
+        return;
+    }
+
+    if (!io_thread.joinable()) {
+        io_thread = std::thread(&BlockCache::IoThreadMain, this);
+    }
+    lock.unlock();
+    read_ahead_cv.notify_one();
+}
+
+void BlockCache::IoThreadMain() {
+    Common::SetCurrentThreadName("FileSys IO");
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        read_ahead_cv.wait(lock, [this] { return is_shutting_down || !read_ahead_queue.empty(); });
+        if (is_shutting_down) {
+            return;
+        }
+
+        const Key key = read_ahead_queue.front();
+        read_ahead_queue.pop_front();
+        const std::shared_ptr<FileUtil::IOFile> file = key.file.lock();
+        if (!file || index.find(key) != index.end()) {
+            continue;
+        }
+
+        // The file lock is always taken before the cache lock
+        lock.unlock();
+        std::lock_guard<std::mutex> file_lock(file_mutex);
+        Data data = ReadBlock(*file, key.block);
+        lock.lock();
+
+        // Nothing is inserted past the end of the file
+        if (!data->empty()) {
+            InsertBlock(key, std::move(data));
+            ++read_ahead;
+        }
+    }
+}
+
+BlockCache::Stats BlockCache::GetStats() const {
+    return {hits, misses, read_ahead};
+}
+
+} // namespace FileSys
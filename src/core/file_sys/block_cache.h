@@ -0,0 +1,135 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "common/common_types.h"
+#include "common/file_util.h"
+
+namespace FileSys {
+
+/**
+ * Size-bounded cache of the blocks read from host files, shared by the file backends. When reads
+ * of a file follow on from each other, the following blocks are read ahead on a background I/O
+ * thread, so that streams of small guest reads are served from memory.
+ *
+ * Files are identified by their shared_ptr, so blocks of a destroyed file can never be returned
+ * for another one. Files read through the cache must not be written, and every other host access
+ * to them has to hold the file lock, as the I/O thread may be reading the same file.
+ */
+class BlockCache {
+public:
+    static constexpr u64 BLOCK_SIZE = 0x10000;
+    /// Maximum number of cached blocks
+    static constexpr size_t CAPACITY = 512;
+    /// Number of blocks read ahead of a sequential read
+    static constexpr size_t READ_AHEAD_BLOCKS = 4;
+    /// Reads of at least this size bypass the cache, they would only evict the other blocks
+    static constexpr size_t BYPASS_SIZE = 0x100000;
+
+    struct Stats {
+        /// Blocks found in the cache
+        u64 hits;
+        /// Blocks that had to be read from the host file
+        u64 misses;
+        /// Blocks read ahead by the I/O thread
+        u64 read_ahead;
+    };
+
+    static BlockCache& GetInstance();
+
+    ~BlockCache();
+
+    /**
+     * Reads from a file through the cache.
+     * @returns The number of bytes read, which is less than length at the end of the file.
+     */
+    size_t Read(const std::shared_ptr<FileUtil::IOFile>& file, u64 offset, size_t length,
+                u8* buffer);
+
+    /// Drops the cached blocks of a file, for example after it was resized
+    void Invalidate(const std::shared_ptr<FileUtil::IOFile>& file);
+
+    /// Lock to hold while accessing a file read through the cache outside of it
+    std::unique_lock<std::mutex> LockFile() {
+        return std::unique_lock<std::mutex>(file_mutex);
+    }
+
+    Stats GetStats() const;
+
+private:
+    BlockCache() = default;
+
+    using FileRef = std::weak_ptr<FileUtil::IOFile>;
+    using Data = std::shared_ptr<const std::vector<u8>>;
+
+    struct Key {
+        FileRef file;
+        u64 block;
+
+        bool operator<(const Key& other) const;
+    };
+
+    struct Entry {
+        Key key;
+        Data data;
+    };
+
+    /// A file that is being read sequentially
+    struct Stream {
+        FileRef file;
+        u64 next_offset;
+    };
+
+    /// Returns a block, reading it from the file on a miss
+    Data GetBlock(const std::shared_ptr<FileUtil::IOFile>& file, u64 block);
+
+    /// Returns a cached block, or nullptr. Must be called with the cache lock held.
+    Data FindBlock(const Key& key);
+
+    /// Adds a block, evicting the least recently used one if the cache is full
+    void InsertBlock(const Key& key, Data data);
+
+    /// Reads a block from the host file, with the file lock held
+    static Data ReadBlock(FileUtil::IOFile& file, u64 block);
+
+    /// Queues the blocks following a read to be read ahead, if it continues the previous one
+    void ScheduleReadAhead(const std::shared_ptr<FileUtil::IOFile>& file, u64 offset,
+                           size_t length);
+
+    void IoThreadMain();
+
+    /// Protects the cached blocks, the streams and the read ahead queue
+    std::mutex mutex;
+    /// Protects the host files, held while they are accessed
+    std::mutex file_mutex;
+
+    /// Cached blocks, the most recently used first
+    std::list<Entry> entries;
+    std::map<Key, std::list<Entry>::iterator> index;
+
+    std::array<Stream, 8> streams;
+    size_t next_stream = 0;
+
+    std::deque<Key> read_ahead_queue;
+    std::condition_variable read_ahead_cv;
+    std::thread io_thread;
+    bool is_shutting_down = false;
+
+    std::atomic<u64> hits{0};
+    std::atomic<u64> misses{0};
+    std::atomic<u64> read_ahead{0};
+};
+
+} // namespace FileSys
@@ -8,6 +8,7 @@
 #include "common/common_types.h"
 #include "common/file_util.h"
 #include "common/logging/log.h"
+#include "core/file_sys/block_cache.h"
 #include "core/file_sys/disk_archive.h"
 #include "core/file_sys/errors.h"
 
@@ -20,6 +21,9 @@ ResultVal<size_t> DiskFile::Read(const u64 offset, const size_t length, u8* buff
     if (!mode.read_flag)
         return ERROR_INVALID_OPEN_FLAGS;
 
+    if (IsCached()) {
+        return MakeResult<size_t>(BlockCache::GetInstance().Read(file, offset, length, buffer));
+    }
     file->Seek(offset, SEEK_SET);
     return MakeResult<size_t>(file->ReadBytes(buffer, length));
 }
@@ -37,6 +41,11 @@ ResultVal<size_t> DiskFile::Write(const u64 offset, const size_t length, const b
 }
 
 u64 DiskFile::GetSize() const {
+    // Getting the size seeks the file, which the I/O thread of the cache may be reading
+    if (IsCached()) {
+        const auto lock = BlockCache::GetInstance().LockFile();
+        return file->GetSize();
+    }
     return file->GetSize();
 }
 
@@ -47,9 +56,18 @@ bool DiskFile::SetSize(const u64 size) const {
 }
 
 bool DiskFile::Close() const {
+    if (IsCached()) {
+        BlockCache::GetInstance().Invalidate(file);
+        const auto lock = BlockCache::GetInstance().LockFile();
+        return file->Close();
+    }
     return file->Close();
 }
 
+void DiskFile::Flush() const {
+    file->Flush();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 DiskDirectory::DiskDirectory(const std::string& path) : directory() {
@@ -20,10 +20,14 @@
 
 namespace FileSys {
 
+/**
+ * File on the host file system. Files opened for reading only are read through the BlockCache,
+ * files that can be written aren't, so that they never see their own stale blocks.
+ */
 class DiskFile : public FileBackend {
 public:
     DiskFile(FileUtil::IOFile&& file_, const Mode& mode_)
-        : file(new FileUtil::IOFile(std::move(file_))) {
+        : file(std::make_shared<FileUtil::IOFile>(std::move(file_))) {
         mode.hex = mode_.hex;
     }
 
@@ -33,13 +37,15 @@ public:
     bool SetSize(u64 size) const override;
     bool Close() const override;
 
-    void Flush() const override {
-        file->Flush();
-    }
+    void Flush() const override;
 
 protected:
+    bool IsCached() const {
+        return !mode.write_flag;
+    }
+
     Mode mode;
-    std::unique_ptr<FileUtil::IOFile> file;
+    std::shared_ptr<FileUtil::IOFile> file;
 };
 
 class DiskDirectory : public DirectoryBackend {
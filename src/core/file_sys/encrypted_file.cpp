@@ -0,0 +1,65 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "common/alignment.h"
+#include "common/logging/log.h"
+#include "core/file_sys/encrypted_file.h"
+
+namespace FileSys {
+
+ResultVal<size_t> EncryptedFile::Read(const u64 offset, const size_t length, u8* buffer) const {
+    LOG_TRACE(Service_FS, "called offset=%llu, length=%zu", offset, length);
+    const u64 size = GetSize();
+    if (offset >= size) {
+        return MakeResult<size_t>(0);
+    }
+    const size_t read_length = static_cast<size_t>(std::min<u64>(length, size - offset));
+
+    const size_t alignment = cipher->GetAlignment();
+    const u64 aligned_offset = Common::AlignDown(offset, alignment);
+    const u64 aligned_end = Common::AlignUp(offset + read_length, alignment);
+    if (aligned_offset == offset && aligned_end == offset + read_length) {
+        // Decrypted in place, which is the common case of sector-sized reads
+        CASCADE_RESULT(size_t read, storage->Read(offset, read_length, buffer));
+        cipher->Decrypt(offset, buffer, buffer, read);
+        return MakeResult<size_t>(read);
+    }
+
+    std::vector<u8> units(static_cast<size_t>(aligned_end - aligned_offset));
+    CASCADE_RESULT(size_t read, storage->Read(aligned_offset, units.size(), units.data()));
+    if (read != units.size()) {
+        LOG_ERROR(Service_FS, "Storage ended early at 0x%llx", aligned_offset + read);
+        units.resize(Common::AlignDown(read, alignment));
+    }
+    cipher->Decrypt(aligned_offset, units.data(), units.data(), units.size());
+
+    const size_t skip = static_cast<size_t>(offset - aligned_offset);
+    const size_t copied = std::min(read_length, units.size() > skip ? units.size() - skip : 0);
+    std::memcpy(buffer, units.data() + skip, copied);
+    return MakeResult<size_t>(copied);
+}
+
+ResultVal<size_t> EncryptedFile::Write(const u64 offset, const size_t length, const bool flush,
+                                       const u8* buffer) const {
+    LOG_ERROR(Service_FS, "Attempted to write to an encrypted file");
+    return MakeResult<size_t>(0);
+}
+
+u64 EncryptedFile::GetSize() const {
+    return Common::AlignDown(storage->GetSize(), cipher->GetAlignment());
+}
+
+bool EncryptedFile::SetSize(const u64 size) const {
+    LOG_ERROR(Service_FS, "Attempted to set the size of an encrypted file");
+    return false;
+}
+
+bool EncryptedFile::Close() const {
+    return storage->Close();
+}
+
+} // namespace FileSys
@@ -0,0 +1,40 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include "common/common_types.h"
+#include "core/crypto/aes.h"
+#include "core/file_sys/file_backend.h"
+#include "core/hle/result.h"
+
+namespace FileSys {
+
+/**
+ * Read-only file whose contents are stored encrypted in another file, such as a section of an
+ * encrypted content archive. Reads only decrypt the parts of the storage they read, so that
+ * archives are used as they are shipped, without decrypting them to disk first.
+ */
+class EncryptedFile : public FileBackend {
+public:
+    EncryptedFile(std::shared_ptr<FileBackend> storage,
+                  std::unique_ptr<Crypto::StorageCipher> cipher)
+        : storage(std::move(storage)), cipher(std::move(cipher)) {}
+
+    /// Decrypts the whole units of the cipher the range spans, and copies out the part read
+    ResultVal<size_t> Read(u64 offset, size_t length, u8* buffer) const override;
+    ResultVal<size_t> Write(u64 offset, size_t length, bool flush, const u8* buffer) const override;
+    /// Size of the storage, without the trailing partial unit of the cipher that can't be read
+    u64 GetSize() const override;
+    bool SetSize(u64 size) const override;
+    bool Close() const override;
+    void Flush() const override {}
+
+private:
+    std::shared_ptr<FileBackend> storage;
+    std::unique_ptr<Crypto::StorageCipher> cipher;
+};
+
+} // namespace FileSys
@@ -4,6 +4,7 @@
 
 #include <algorithm>
 #include <set>
+#include <string_view>
 #include "common/file_util.h"
 #include "common/string_util.h"
 #include "core/file_sys/path_parser.h"
@@ -32,12 +33,14 @@ PathParser::PathParser(const Path& path) {
         return;
     }
 
-    Common::SplitString(path_string, '/', path_sequence);
-
-    auto begin = path_sequence.begin();
-    auto end = path_sequence.end();
-    end = std::remove_if(begin, end, [](std::string& str) { return str == "" || str == "."; });
-    path_sequence = std::vector<std::string>(begin, end);
+    // Only the nodes that are kept are copied
+    std::vector<std::string_view> nodes;
+    Common::SplitString(std::string_view(path_string), '/', nodes);
+    for (const std::string_view node : nodes) {
+        if (!node.empty() && node != ".") {
+            path_sequence.emplace_back(node);
+        }
+    }
 
     // checks if the path is out of bounds.
     int level = 0;
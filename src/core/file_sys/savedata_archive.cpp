@@ -2,7 +2,13 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include "common/common_funcs.h"
 #include "common/file_util.h"
+#include "common/logging/log.h"
+#include "common/swap.h"
 #include "core/file_sys/disk_archive.h"
 #include "core/file_sys/errors.h"
 #include "core/file_sys/path_parser.h"
@@ -61,12 +67,21 @@ ResultVal<std::unique_ptr<FileBackend>> SaveDataArchive::OpenFile(const Path& pa
         break; // Expected 'success' case
     }
 
+    // Finish a commit that was interrupted the last time the file was written
+    if (!SaveDataFile::RecoverJournal(full_path)) {
+        LOG_ERROR(Service_FS, "Couldn't recover the journal of %s", full_path.c_str());
+    }
+
     FileUtil::IOFile file(full_path, mode.write_flag ? "r+b" : "rb");
     if (!file.IsOpen()) {
         LOG_CRITICAL(Service_FS, "(unreachable) Unknown error opening %s", full_path.c_str());
         return ERROR_FILE_NOT_FOUND;
     }
 
+    if (mode.write_flag) {
+        auto save_file = std::make_unique<SaveDataFile>(std::move(file), mode, full_path);
+        return MakeResult<std::unique_ptr<FileBackend>>(std::move(save_file));
+    }
     auto disk_file = std::make_unique<DiskFile>(std::move(file), mode);
     return MakeResult<std::unique_ptr<FileBackend>>(std::move(disk_file));
 }
@@ -327,4 +342,218 @@ u64 SaveDataArchive::GetFreeBytes() const {
     return 1024 * 1024 * 1024;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr u32 JOURNAL_MAGIC = Common::MakeMagic('Y', 'S', 'V', 'J');
+
+/// The header is followed by each extent and its data, and then by JOURNAL_MAGIC again
+struct JournalHeader {
+    u32_le magic;
+    u32_le num_extents;
+    u64_le data_size;
+};
+static_assert(sizeof(JournalHeader) == 0x10, "JournalHeader has incorrect size");
+
+struct JournalExtent {
+    u64_le offset;
+    u64_le size;
+};
+static_assert(sizeof(JournalExtent) == 0x10, "JournalExtent has incorrect size");
+
+SaveDataFile::SaveDataFile(FileUtil::IOFile&& file, const Mode& mode, std::string path)
+    : DiskFile(std::move(file), mode), path(std::move(path)) {}
+
+SaveDataFile::~SaveDataFile() {
+    if (file->IsOpen()) {
+        Commit();
+    }
+}
+
+std::string SaveDataFile::GetJournalPath(const std::string& path) {
+    return path + ".journal";
+}
+
+ResultVal<size_t> SaveDataFile::Read(u64 offset, size_t length, u8* buffer) const {
+    if (!mode.read_flag)
+        return ERROR_INVALID_OPEN_FLAGS;
+
+    // Pending writes may extend the file past its size on the host
+    const u64 size = GetSize();
+    if (offset >= size) {
+        return MakeResult<size_t>(0);
+    }
+    const size_t read_length = static_cast<size_t>(std::min<u64>(length, size - offset));
+    file->Seek(offset, SEEK_SET);
+    const size_t file_length = file->ReadBytes(buffer, read_length);
+    std::fill(buffer + std::min(file_length, read_length), buffer + read_length, 0);
+
+    // Overlay the pending writes
+    const u64 end = offset + read_length;
+    auto iter = pending.upper_bound(offset);
+    if (iter != pending.begin()) {
+        --iter;
+    }
+    for (; iter != pending.end() && iter->first < end; ++iter) {
+        const u64 extent_end = iter->first + iter->second.size();
+        if (extent_end <= offset) {
+            continue;
+        }
+        const u64 copy_begin = std::max(offset, iter->first);
+        const u64 copy_end = std::min(end, extent_end);
+        std::memcpy(buffer + (copy_begin - offset),
+                    iter->second.data() + (copy_begin - iter->first),
+                    static_cast<size_t>(copy_end - copy_begin));
+    }
+    return MakeResult<size_t>(read_length);
+}
+
+ResultVal<size_t> SaveDataFile::Write(u64 offset, size_t length, bool flush,
+                                      const u8* buffer) const {
+    if (!mode.write_flag)
+        return ERROR_INVALID_OPEN_FLAGS;
+    if (length == 0) {
+        return MakeResult<size_t>(0);
+    }
+
+    // Merge the write with the extents it overlaps or touches, their union is contiguous. The
+    // flush flag is ignored, titles set it on every small write.
+    u64 begin = offset;
+    u64 end = offset + length;
+    auto first = pending.upper_bound(begin);
+    if (first != pending.begin()) {
+        const auto previous = std::prev(first);
+        if (previous->first + previous->second.size() >= begin) {
+            first = previous;
+        }
+    }
+    auto last = first;
+    for (; last != pending.end() && last->first <= end; ++last) {
+        begin = std::min(begin, last->first);
+        end = std::max(end, last->first + last->second.size());
+    }
+
+    std::vector<u8> merged(static_cast<size_t>(end - begin));
+    for (auto iter = first; iter != last; ++iter) {
+        std::memcpy(merged.data() + (iter->first - begin), iter->second.data(),
+                    iter->second.size());
+        pending_size -= iter->second.size();
+    }
+    std::memcpy(merged.data() + (offset - begin), buffer, length);
+    pending.erase(first, last);
+    pending_size += merged.size();
+    pending.emplace(begin, std::move(merged));
+
+    if (pending_size >= MAX_PENDING_SIZE) {
+        Commit();
+    }
+    return MakeResult<size_t>(length);
+}
+
+u64 SaveDataFile::GetSize() const {
+    const u64 file_size = file->GetSize();
+    if (pending.empty()) {
+        return file_size;
+    }
+    const auto& last = *pending.rbegin();
+    return std::max<u64>(file_size, last.first + last.second.size());
+}
+
+bool SaveDataFile::SetSize(u64 size) const {
+    Commit();
+    return DiskFile::SetSize(size);
+}
+
+bool SaveDataFile::Close() const {
+    Commit();
+    return DiskFile::Close();
+}
+
+void SaveDataFile::Flush() const {
+    Commit();
+}
+
+bool SaveDataFile::Commit() const {
+    if (pending.empty()) {
+        return true;
+    }
+
+    const std::string journal_path = GetJournalPath(path);
+    {
+        FileUtil::IOFile journal(journal_path, "wb");
+        const JournalHeader header{JOURNAL_MAGIC, static_cast<u32>(pending.size()), pending_size};
+        journal.WriteObject(header);
+        for (const auto& extent : pending) {
+            const JournalExtent journal_extent{extent.first, extent.second.size()};
+            journal.WriteObject(journal_extent);
+            journal.WriteBytes(extent.second.data(), extent.second.size());
+        }
+        journal.WriteObject(JOURNAL_MAGIC);
+        if (!journal.Sync()) {
+            LOG_ERROR(Service_FS, "Couldn't write the journal %s", journal_path.c_str());
+            journal.Close();
+            FileUtil::Delete(journal_path);
+            return false;
+        }
+    }
+
+    // The journal is complete, the file can be written. A failure leaves the journal in place for
+    // the next open to replay.
+    file->Clear();
+    for (const auto& extent : pending) {
+        file->Seek(extent.first, SEEK_SET);
+        file->WriteBytes(extent.second.data(), extent.second.size());
+    }
+    if (!file->Sync()) {
+        LOG_ERROR(Service_FS, "Couldn't commit the writes to %s", path.c_str());
+        return false;
+    }
+
+    FileUtil::Delete(journal_path);
+    pending.clear();
+    pending_size = 0;
+    return true;
+}
+
+bool SaveDataFile::RecoverJournal(const std::string& path) {
+    const std::string journal_path = GetJournalPath(path);
+    if (!FileUtil::Exists(journal_path)) {
+        return true;
+    }
+
+    FileUtil::IOFile journal(journal_path, "rb");
+    JournalHeader header{};
+    if (journal.ReadBytes(&header, sizeof(header)) != sizeof(header) ||
+        header.magic != JOURNAL_MAGIC ||
+        journal.GetSize() != sizeof(header) + header.num_extents * sizeof(JournalExtent) +
+                                 header.data_size + sizeof(JOURNAL_MAGIC)) {
+        // The commit was interrupted before the file was touched
+        LOG_WARNING(Service_FS, "Discarding the incomplete journal of %s", path.c_str());
+        journal.Close();
+        return FileUtil::Delete(journal_path);
+    }
+
+    FileUtil::IOFile file(path, "r+b");
+    std::vector<u8> data;
+    for (u32 i = 0; i < header.num_extents; ++i) {
+        JournalExtent extent{};
+        if (journal.ReadBytes(&extent, sizeof(extent)) != sizeof(extent) ||
+            extent.size > header.data_size) {
+            return false;
+        }
+        data.resize(static_cast<size_t>(extent.size));
+        if (journal.ReadBytes(data.data(), data.size()) != data.size()) {
+            return false;
+        }
+        file.Seek(extent.offset, SEEK_SET);
+        file.WriteBytes(data.data(), data.size());
+    }
+    if (!file.Sync()) {
+        return false;
+    }
+
+    LOG_INFO(Service_FS, "Recovered an interrupted commit to %s", path.c_str());
+    journal.Close();
+    return FileUtil::Delete(journal_path);
+}
+
 } // namespace FileSys
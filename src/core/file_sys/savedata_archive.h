@@ -4,9 +4,12 @@
 
 #pragma once
 
+#include <map>
 #include <string>
+#include <vector>
 #include "core/file_sys/archive_backend.h"
 #include "core/file_sys/directory_backend.h"
+#include "core/file_sys/disk_archive.h"
 #include "core/file_sys/file_backend.h"
 #include "core/hle/result.h"
 
@@ -40,4 +43,46 @@ protected:
     std::string mount_point;
 };
 
+/**
+ * Writable save data file that buffers the writes in memory, merging the overlapping and adjacent
+ * ones, and writes them back to the host file in a single commit. Writes are committed on Flush,
+ * SetSize and Close, when too much data is pending, and when the file is destroyed.
+ *
+ * A commit first writes the pending data to a journal next to the file and syncs it, then applies
+ * it to the file. A journal that is left over by a crash during a commit is replayed by
+ * RecoverJournal before the file is opened again, so that the file never keeps a partial commit.
+ */
+class SaveDataFile final : public DiskFile {
+public:
+    /// Amount of pending data at which the writes are committed without waiting for a flush
+    static constexpr size_t MAX_PENDING_SIZE = 0x400000;
+
+    SaveDataFile(FileUtil::IOFile&& file, const Mode& mode, std::string path);
+    ~SaveDataFile() override;
+
+    ResultVal<size_t> Read(u64 offset, size_t length, u8* buffer) const override;
+    ResultVal<size_t> Write(u64 offset, size_t length, bool flush, const u8* buffer) const override;
+    u64 GetSize() const override;
+    bool SetSize(u64 size) const override;
+    bool Close() const override;
+    void Flush() const override;
+
+    /**
+     * Replays the journal of an interrupted commit to a file, if there is one.
+     * @returns False if the journal exists but couldn't be applied.
+     */
+    static bool RecoverJournal(const std::string& path);
+
+    static std::string GetJournalPath(const std::string& path);
+
+private:
+    /// Writes the pending data back to the file
+    bool Commit() const;
+
+    std::string path;
+    /// Data written since the last commit, as non-overlapping extents keyed by their offset
+    mutable std::map<u64, std::vector<u8>> pending;
+    mutable size_t pending_size = 0;
+};
+
 } // namespace FileSys
@@ -66,26 +66,29 @@ static bool IsWithinTouchscreen(const Layout::FramebufferLayout& layout, unsigne
 }
 
 std::tuple<unsigned, unsigned> EmuWindow::ClipToTouchScreen(unsigned new_x, unsigned new_y) {
-    new_x = std::max(new_x, framebuffer_layout.screen.left);
-    new_x = std::min(new_x, framebuffer_layout.screen.right - 1);
+    const Layout::FramebufferLayout layout = GetFramebufferLayout();
+    new_x = std::max(new_x, layout.screen.left);
+    new_x = std::min(new_x, layout.screen.right - 1);
 
-    new_y = std::max(new_y, framebuffer_layout.screen.top);
-    new_y = std::min(new_y, framebuffer_layout.screen.bottom - 1);
+    new_y = std::max(new_y, layout.screen.top);
+    new_y = std::min(new_y, layout.screen.bottom - 1);
 
     return std::make_tuple(new_x, new_y);
 }
 
 void EmuWindow::TouchPressed(unsigned framebuffer_x, unsigned framebuffer_y) {
-    if (!IsWithinTouchscreen(framebuffer_layout, framebuffer_x, framebuffer_y))
+    const Layout::FramebufferLayout layout = GetFramebufferLayout();
+    if (!IsWithinTouchscreen(layout, framebuffer_x, framebuffer_y))
         return;
 
     std::lock_guard<std::mutex> guard(touch_state->mutex);
-    touch_state->touch_x = static_cast<float>(framebuffer_x - framebuffer_layout.screen.left) /
-                           (framebuffer_layout.screen.right - framebuffer_layout.screen.left);
-    touch_state->touch_y = static_cast<float>(framebuffer_y - framebuffer_layout.screen.top) /
-                           (framebuffer_layout.screen.bottom - framebuffer_layout.screen.top);
+    touch_state->touch_x = static_cast<float>(framebuffer_x - layout.screen.left) /
+                           (layout.screen.right - layout.screen.left);
+    touch_state->touch_y = static_cast<float>(framebuffer_y - layout.screen.top) /
+                           (layout.screen.bottom - layout.screen.top);
 
     touch_state->touch_pressed = true;
+    Input::RecordStateChange();
 }
 
 void EmuWindow::TouchReleased() {
@@ -93,13 +96,14 @@ void EmuWindow::TouchReleased() {
     touch_state->touch_pressed = false;
     touch_state->touch_x = 0;
     touch_state->touch_y = 0;
+    Input::RecordStateChange();
 }
 
 void EmuWindow::TouchMoved(unsigned framebuffer_x, unsigned framebuffer_y) {
     if (!touch_state->touch_pressed)
         return;
 
-    if (!IsWithinTouchscreen(framebuffer_layout, framebuffer_x, framebuffer_y))
+    if (!IsWithinTouchscreen(GetFramebufferLayout(), framebuffer_x, framebuffer_y))
         std::tie(framebuffer_x, framebuffer_y) = ClipToTouchScreen(framebuffer_x, framebuffer_y);
 
     TouchPressed(framebuffer_x, framebuffer_y);
@@ -8,6 +8,7 @@
 #include <tuple>
 #include <utility>
 #include "common/common_types.h"
+#include "common/seqlock.h"
 #include "core/frontend/framebuffer_layout.h"
 
 /**
@@ -44,12 +45,37 @@ public:
     /// Polls window events
     virtual void PollEvents() = 0;
 
-    /// Makes the graphics context current for the caller thread
+    /**
+     * Makes the graphics context current for the caller thread. The context may have been current
+     * on another thread before, in which case that thread released it with DoneCurrent.
+     */
     virtual void MakeCurrent() = 0;
 
-    /// Releases (dunno if this is the "right" word) the GLFW context from the caller thread
+    /// Releases the graphics context from the caller thread, so that any thread can make it current
     virtual void DoneCurrent() = 0;
 
+    /// Additional graphics context sharing its objects with the context of the window
+    class GraphicsContext {
+    public:
+        virtual ~GraphicsContext() = default;
+
+        /// Makes the context current for the caller thread
+        virtual void MakeCurrent() = 0;
+
+        /// Releases the context from the caller thread
+        virtual void DoneCurrent() = 0;
+    };
+
+    /**
+     * Creates a graphics context sharing its objects with the context of the window, for worker
+     * threads of the renderer. Must be called on the thread the context of the window is current
+     * on, and the new context isn't current on any thread.
+     * @returns The new context, or nullptr if the frontend doesn't support shared contexts.
+     */
+    virtual std::unique_ptr<GraphicsContext> CreateSharedContext() const {
+        return nullptr;
+    }
+
     /**
      * Signal that a touch pressed event has occurred (e.g. mouse click pressed)
      * @param framebuffer_x Framebuffer x-coordinate that was pressed
@@ -90,8 +116,8 @@ public:
      * Gets the framebuffer layout (width, height, and screen regions)
      * @note This method is thread-safe
      */
-    const Layout::FramebufferLayout& GetFramebufferLayout() const {
-        return framebuffer_layout;
+    Layout::FramebufferLayout GetFramebufferLayout() const {
+        return framebuffer_layout.Read();
     }
 
     /**
@@ -123,10 +149,11 @@ protected:
 
     /**
      * Update framebuffer layout with the given parameter.
-     * @note EmuWindow implementations will usually use this in window resize event handlers.
+     * @note EmuWindow implementations will usually use this in window resize event handlers, on
+     * the thread handling the events of the window.
      */
     void NotifyFramebufferLayoutChanged(const Layout::FramebufferLayout& layout) {
-        framebuffer_layout = layout;
+        framebuffer_layout.Write(layout);
     }
 
     /**
@@ -149,7 +176,9 @@ private:
         // By default, ignore this request and do nothing.
     }
 
-    Layout::FramebufferLayout framebuffer_layout; ///< Current framebuffer layout
+    /// Current framebuffer layout, written by the event thread of the frontend and read by the
+    /// renderer
+    Common::SeqLock<Layout::FramebufferLayout> framebuffer_layout;
 
     unsigned client_area_width;  ///< Current client width, should be set by window impl.
     unsigned client_area_height; ///< Current client height, should be set by window impl.
@@ -0,0 +1,37 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <atomic>
+#include "core/frontend/input.h"
+
+namespace Input {
+
+static std::atomic<u64> devices_generation{0};
+
+void NotifyDevicesChanged() {
+    devices_generation.fetch_add(1, std::memory_order_release);
+}
+
+u64 GetDevicesGeneration() {
+    return devices_generation.load(std::memory_order_acquire);
+}
+
+/// Time of the last state change, in EventClock ticks since its epoch
+static std::atomic<EventClock::rep> last_state_change{0};
+
+void RecordStateChange(EventClock::time_point time) {
+    // Backends on different threads may report their changes out of order
+    const EventClock::rep ticks = time.time_since_epoch().count();
+    EventClock::rep previous = last_state_change.load(std::memory_order_relaxed);
+    while (previous < ticks &&
+           !last_state_change.compare_exchange_weak(previous, ticks, std::memory_order_relaxed)) {
+    }
+}
+
+EventClock::time_point GetLastStateChange() {
+    return EventClock::time_point(
+        EventClock::duration(last_state_change.load(std::memory_order_relaxed)));
+}
+
+} // namespace Input
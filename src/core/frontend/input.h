@@ -4,11 +4,13 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <tuple>
 #include <unordered_map>
 #include <utility>
+#include "common/common_types.h"
 #include "common/logging/log.h"
 #include "common/param_package.h"
 #include "common/vector_math.h"
@@ -48,6 +50,15 @@ FactoryListType<InputDeviceType> FactoryList<InputDeviceType>::list;
 
 } // namespace Impl
 
+/**
+ * Records that the devices the factories create changed, such as a controller being plugged in or
+ * unplugged, so that the cached devices are created again. Can be called from any thread.
+ */
+void NotifyDevicesChanged();
+
+/// Gets a counter that NotifyDevicesChanged and the (un)registration of factories increment
+u64 GetDevicesGeneration();
+
 /**
  * Registers an input device factory.
  * @tparam InputDeviceType the type of input devices the factory can create
@@ -61,6 +72,7 @@ void RegisterFactory(const std::string& name, std::shared_ptr<Factory<InputDevic
     if (!Impl::FactoryList<InputDeviceType>::list.insert(std::move(pair)).second) {
         LOG_ERROR(Input, "Factory %s already registered", name.c_str());
     }
+    NotifyDevicesChanged();
 }
 
 /**
@@ -73,6 +85,7 @@ void UnregisterFactory(const std::string& name) {
     if (Impl::FactoryList<InputDeviceType>::list.erase(name) == 0) {
         LOG_ERROR(Input, "Factory %s not registered", name.c_str());
     }
+    NotifyDevicesChanged();
 }
 
 /**
@@ -95,6 +108,58 @@ std::unique_ptr<InputDeviceType> CreateDevice(const std::string& params) {
     return pair->second->Create(package);
 }
 
+/**
+ * An input device created from a serialized ParamPackage, which is only created again when the
+ * parameters or the devices available change. Reconfiguring the input then leaves the devices
+ * whose bindings stayed the same alone, instead of parsing and opening all of them again.
+ */
+template <typename InputDeviceType>
+class CachedDevice {
+public:
+    /**
+     * Creates the device if it is missing, its parameters differ from the ones it was created with,
+     * or the devices changed since.
+     * @returns Whether the device was created
+     */
+    bool Update(const std::string& new_params) {
+        // Read first, so that a change while the device is created triggers another update
+        const u64 new_generation = GetDevicesGeneration();
+        if (device && new_params == params && new_generation == generation) {
+            return false;
+        }
+        device = CreateDevice<InputDeviceType>(new_params);
+        params = new_params;
+        generation = new_generation;
+        return true;
+    }
+
+    InputDeviceType* operator->() const {
+        return device.get();
+    }
+
+    InputDeviceType& operator*() const {
+        return *device;
+    }
+
+private:
+    std::unique_ptr<InputDeviceType> device;
+    std::string params;
+    u64 generation = 0;
+};
+
+/// Monotonic host clock the changes of the input state are timestamped with
+using EventClock = std::chrono::steady_clock;
+
+/**
+ * Records the state of an input device changing, called by the input backends when they notice
+ * it. Can be called from any thread.
+ * @param time When the change happened, as close to the host event as the backend can tell
+ */
+void RecordStateChange(EventClock::time_point time = EventClock::now());
+
+/// Gets the time of the latest change of the input state, or the clock's epoch if none happened
+EventClock::time_point GetLastStateChange();
+
 /**
  * A button device is an input device that returns bool as status.
  * true for pressed; false for released.
@@ -5,14 +5,20 @@
 // Originally written by Sven Peter <sven@fail0verflow.com> for anergistic.
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <cinttypes>
 #include <climits>
 #include <csignal>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
+#include <deque>
 #include <map>
+#include <mutex>
 #include <numeric>
+#include <string>
+#include <vector>
 #include <fcntl.h>
 
 #ifdef _WIN32
@@ -35,15 +41,22 @@
 #include "core/arm/arm_interface.h"
 #include "core/core.h"
 #include "core/gdbstub/gdbstub.h"
+#include "core/hle/kernel/thread.h"
+#include "core/hle/lock.h"
 #include "core/loader/loader.h"
 #include "core/memory.h"
 
-const int GDB_BUFFER_SIZE = 10000;
+// Large enough for the client to read or write 32KiB of memory per packet
+const int GDB_BUFFER_SIZE = 0x10004;
 
 const char GDB_STUB_START = '$';
 const char GDB_STUB_END = '#';
 const char GDB_STUB_ACK = '+';
 const char GDB_STUB_NACK = '-';
+const char GDB_STUB_NOTIFY = '%';
+// Binary data escapes the bytes with a special meaning as this byte followed by them XOR 0x20
+const u8 GDB_STUB_ESCAPE = '}';
+const u8 GDB_STUB_ESCAPE_XOR = 0x20;
 
 #ifndef SIGTRAP
 const u32 SIGTRAP = 5;
@@ -53,19 +66,14 @@ const u32 SIGTRAP = 5;
 const u32 SIGTERM = 15;
 #endif
 
-#ifndef MSG_WAITALL
-const u32 MSG_WAITALL = 8;
-#endif
-
 const u32 R15_REGISTER = 15;
 const u32 CPSR_REGISTER = 25;
 const u32 FPSCR_REGISTER = 58;
 
 // For sample XML files see the GDB source /gdb/features
-// GDB also wants the l character at the start
 // This XML defines what the registers are for this specific ARM device
 static const char* target_xml =
-    R"(l<?xml version="1.0"?>
+    R"(<?xml version="1.0"?>
 <!DOCTYPE target SYSTEM "gdb-target.dtd">
 <target version="1.0">
   <feature name="org.gnu.gdb.arm.core">
@@ -121,6 +129,11 @@ static int gdbserver_socket = -1;
 static u8 command_buffer[GDB_BUFFER_SIZE];
 static u32 command_length;
 
+// Data received from the client is read by the largest available chunk, not a byte per recv
+static std::array<u8, GDB_BUFFER_SIZE> receive_buffer;
+static size_t receive_offset = 0;
+static size_t receive_length = 0;
+
 static u32 latest_signal = 0;
 static bool step_break = false;
 static bool memory_break = false;
@@ -132,6 +145,18 @@ static u16 gdbstub_port = 24689;
 static bool halt_loop = true;
 static bool step_loop = false;
 
+// In non-stop mode, the client stops and resumes the guest threads one by one while the others
+// keep running, and the stops are reported to it asynchronously
+static bool non_stop = false;
+/// Thread whose registers the client accesses, as selected with Hg, 0 for the running thread
+static u32 selected_thread_id = 0;
+/// Threads the client asked to stop, waiting for their cores to switch them out
+static std::vector<u32> stopping_threads;
+/// Stop replies left to send, the client fetches them one by one with vStopped
+static std::deque<std::string> pending_stop_replies;
+/// Whether a stop notification was sent and the client hasn't fetched all the stop replies yet
+static bool is_stop_notification_sent = false;
+
 // If set to false, the server will never be started and no
 // gdbstub-related functions will be executed.
 static std::atomic<bool> server_enabled(false);
@@ -188,8 +213,8 @@ static u8 NibbleToHex(u8 n) {
 * @param src Pointer to array of output hex string characters.
 * @param len Length of src array.
 */
-static u32 HexToInt(const u8* src, size_t len) {
-    u32 output = 0;
+static u64 HexToInt(const u8* src, size_t len) {
+    u64 output = 0;
     while (len-- > 0) {
         output = (output << 4) | HexCharToValue(src[0]);
         src++;
@@ -255,16 +280,25 @@ static u32 GdbHexToInt(const u8* src) {
     return output;
 }
 
-/// Read a byte from the gdb client.
+/**
+ * Read a byte from the gdb client. Everything the client has sent so far is received at once and
+ * the following calls are served from it. Returns 0 once the connection has failed.
+ */
 static u8 ReadByte() {
-    u8 c;
-    size_t received_size = recv(gdbserver_socket, reinterpret_cast<char*>(&c), 1, MSG_WAITALL);
-    if (received_size != 1) {
-        LOG_ERROR(Debug_GDBStub, "recv failed : %ld", received_size);
-        Shutdown();
+    if (receive_offset == receive_length) {
+        const auto received_size =
+            recv(gdbserver_socket, reinterpret_cast<char*>(receive_buffer.data()),
+                 static_cast<int>(receive_buffer.size()), 0);
+        if (received_size <= 0) {
+            LOG_ERROR(Debug_GDBStub, "recv failed : %ld", static_cast<long>(received_size));
+            Shutdown();
+            return 0;
+        }
+        receive_offset = 0;
+        receive_length = static_cast<size_t>(received_size);
     }
 
-    return c;
+    return receive_buffer[receive_offset++];
 }
 
 /// Calculate the checksum of the current command buffer.
@@ -372,25 +406,25 @@ static void SendPacket(const char packet) {
 /**
  * Send reply to gdb client.
  *
- * @param reply Reply to be sent to client.
+ * @param reply Reply to be sent to client, which may hold binary data.
+ * @param length Length of the reply.
+ * @param start Character starting the packet, GDB_STUB_NOTIFY for a notification.
  */
-static void SendReply(const char* reply) {
+static void SendReply(const u8* reply, size_t length, char start = GDB_STUB_START) {
     if (!IsConnected()) {
         return;
     }
 
-    memset(command_buffer, 0, sizeof(command_buffer));
-
-    command_length = static_cast<u32>(strlen(reply));
-    if (command_length + 4 > sizeof(command_buffer)) {
+    if (length + 4 > sizeof(command_buffer)) {
         LOG_ERROR(Debug_GDBStub, "command_buffer overflow in SendReply");
         return;
     }
+    command_length = static_cast<u32>(length);
 
     memcpy(command_buffer + 1, reply, command_length);
 
-    u8 checksum = CalculateChecksum(command_buffer, command_length + 1);
-    command_buffer[0] = GDB_STUB_START;
+    u8 checksum = CalculateChecksum(command_buffer + 1, command_length);
+    command_buffer[0] = start;
     command_buffer[command_length + 1] = GDB_STUB_END;
     command_buffer[command_length + 2] = NibbleToHex(checksum >> 4);
     command_buffer[command_length + 3] = NibbleToHex(checksum);
@@ -409,6 +443,209 @@ static void SendReply(const char* reply) {
     }
 }
 
+/**
+ * Send reply to gdb client.
+ *
+ * @param reply Reply to be sent to client.
+ */
+static void SendReply(const char* reply) {
+    SendReply(reinterpret_cast<const u8*>(reply), strlen(reply));
+}
+
+/**
+ * Reports a guest thread having stopped in non-stop mode. The first stop is notified to the
+ * client right away, the ones following it are queued until the client fetches them.
+ *
+ * @param thread_id Id of the thread that stopped.
+ */
+static void QueueStopReply(u32 thread_id) {
+    const std::string reply = Common::StringFromFormat("T%02xthread:%x;", 0, thread_id);
+    if (is_stop_notification_sent) {
+        pending_stop_replies.push_back(reply);
+        return;
+    }
+
+    const std::string notification = "Stop:" + reply;
+    SendReply(reinterpret_cast<const u8*>(notification.data()), notification.size(),
+              GDB_STUB_NOTIFY);
+    is_stop_notification_sent = true;
+}
+
+/**
+ * Parses the id of a thread sent by the client.
+ *
+ * @param src Pointer to the id, in hex or -1 for all the threads.
+ * @param len Length of the id.
+ * @returns The id, 0 for any or all threads.
+ */
+static u32 ParseThreadId(const u8* src, size_t len) {
+    if (len == 0 || src[0] == '-') {
+        return 0;
+    }
+    return static_cast<u32>(HexToInt(src, len));
+}
+
+/**
+ * Finds a living guest thread by its id. Must be called with the HLE lock held.
+ *
+ * @param thread_id Id of the thread.
+ * @returns The thread, nullptr if there is none with this id.
+ */
+static Kernel::Thread* FindThread(u32 thread_id) {
+    for (const auto& thread : Kernel::GetThreadList()) {
+        if (thread->GetThreadId() == thread_id && thread->status != THREADSTATUS_DEAD) {
+            return thread.get();
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Gets the thread whose registers the client accesses when it is stopped in non-stop mode. Must
+ * be called with the HLE lock held.
+ *
+ * @returns The thread, nullptr if the registers of the running thread are accessed instead.
+ */
+static Kernel::Thread* GetSelectedStoppedThread() {
+    if (!non_stop || selected_thread_id == 0) {
+        return nullptr;
+    }
+    Kernel::Thread* thread = FindThread(selected_thread_id);
+    if (thread == nullptr || !thread->debug_suspended ||
+        thread->status == THREADSTATUS_RUNNING) {
+        return nullptr;
+    }
+    return thread;
+}
+
+// The registers of a thread stopped in non-stop mode are in its saved context, the others are
+// those of the CPU. The kernel is locked for each access, as replying may shut the stub down.
+static u64 GetGuestReg(int index) {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    Kernel::Thread* thread = GetSelectedStoppedThread();
+    return thread ? thread->context.cpu_registers[index] : Core::CPU().GetReg(index);
+}
+
+static void SetGuestReg(int index, u64 value) {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    if (Kernel::Thread* thread = GetSelectedStoppedThread()) {
+        thread->context.cpu_registers[index] = value;
+    } else {
+        Core::CPU().SetReg(index, value);
+    }
+}
+
+static u32 GetGuestCPSR() {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    Kernel::Thread* thread = GetSelectedStoppedThread();
+    return thread ? static_cast<u32>(thread->context.cpsr) : Core::CPU().GetCPSR();
+}
+
+static void SetGuestCPSR(u32 value) {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    if (Kernel::Thread* thread = GetSelectedStoppedThread()) {
+        thread->context.cpsr = value;
+    } else {
+        Core::CPU().SetCPSR(value);
+    }
+}
+
+static u32 GetGuestVFPReg(int index) {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    Kernel::Thread* thread = GetSelectedStoppedThread();
+    return thread ? static_cast<u32>(thread->context.fpu_registers[index][0])
+                  : Core::CPU().GetVFPReg(index);
+}
+
+static void SetGuestVFPReg(int index, u32 value) {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    if (Kernel::Thread* thread = GetSelectedStoppedThread()) {
+        thread->context.fpu_registers[index][0] = value;
+        ++thread->context_version;
+    } else {
+        Core::CPU().SetVFPReg(index, value);
+    }
+}
+
+/**
+ * Appends data to a reply in the binary format, escaping the bytes that delimit packets.
+ *
+ * @param reply Reply to append to.
+ * @param src Data to append.
+ * @param len Length of the data.
+ * @param max_reply_size Size the reply must not grow beyond.
+ * @returns Number of bytes of data that fit in the reply.
+ */
+static size_t AppendBinary(std::vector<u8>& reply, const u8* src, size_t len,
+                           size_t max_reply_size) {
+    size_t appended = 0;
+    for (; appended < len; ++appended) {
+        const u8 byte = src[appended];
+        const bool needs_escape = byte == GDB_STUB_START || byte == GDB_STUB_END ||
+                                  byte == GDB_STUB_ESCAPE || byte == '*';
+        if (reply.size() + (needs_escape ? 2 : 1) > max_reply_size) {
+            break;
+        }
+        if (needs_escape) {
+            reply.push_back(GDB_STUB_ESCAPE);
+            reply.push_back(byte ^ GDB_STUB_ESCAPE_XOR);
+        } else {
+            reply.push_back(byte);
+        }
+    }
+    return appended;
+}
+
+/**
+ * Decodes data in the binary format, undoing the escapes.
+ *
+ * @param src Pointer to the encoded data.
+ * @param len Length of the encoded data.
+ */
+static std::vector<u8> GdbBinaryToMem(const u8* src, size_t len) {
+    std::vector<u8> data;
+    data.reserve(len);
+    for (size_t i = 0; i < len; ++i) {
+        if (src[i] == GDB_STUB_ESCAPE && i + 1 < len) {
+            data.push_back(src[++i] ^ GDB_STUB_ESCAPE_XOR);
+        } else {
+            data.push_back(src[i]);
+        }
+    }
+    return data;
+}
+
+/**
+ * Replies to a qXfer read of an object with the part of it the client asked for, the rest of it
+ * being read by the following requests.
+ *
+ * @param object Object being read.
+ * @param args Pointer to the "offset,length" arguments of the request.
+ * @param args_length Length of the arguments.
+ */
+static void SendXferReply(const std::string& object, const u8* args, size_t args_length) {
+    const u8* args_end = args + args_length;
+    const u8* length_pos = std::find(args, args_end, ',');
+    if (length_pos == args_end) {
+        return SendReply("E01");
+    }
+    const u64 offset = HexToInt(args, length_pos - args);
+    const u64 length = HexToInt(length_pos + 1, args_end - length_pos - 1);
+    if (offset >= object.size()) {
+        return SendReply("l");
+    }
+
+    // 'm' tells that more data follows, 'l' that this is the last part
+    const size_t available = std::min<u64>(object.size() - offset, length);
+    std::vector<u8> reply{'m'};
+    const size_t sent = AppendBinary(reply, reinterpret_cast<const u8*>(object.data()) + offset,
+                                     available, sizeof(command_buffer) - 4);
+    if (offset + sent == object.size()) {
+        reply[0] = 'l';
+    }
+    SendReply(reply.data(), reply.size());
+}
+
 /// Handle query command from gdb client.
 static void HandleQuery() {
     LOG_DEBUG(Debug_GDBStub, "gdb: query '%s'\n", command_buffer + 1);
@@ -418,11 +655,58 @@ static void HandleQuery() {
     if (strcmp(query, "TStatus") == 0) {
         SendReply("T0");
     } else if (strncmp(query, "Supported", strlen("Supported")) == 0) {
-        // PacketSize needs to be large enough for target xml
-        SendReply("PacketSize=800;qXfer:features:read+");
+        const std::string reply =
+            Common::StringFromFormat("PacketSize=%x;qXfer:features:read+;QNonStop+",
+                                     static_cast<int>(sizeof(command_buffer) - 4));
+        SendReply(reply.c_str());
+    } else if (strcmp(query, "fThreadInfo") == 0) {
+        std::string reply = "m";
+        {
+            std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+            for (const auto& thread : Kernel::GetThreadList()) {
+                if (thread->status == THREADSTATUS_DEAD) {
+                    continue;
+                }
+                if (reply.size() > 1) {
+                    reply += ',';
+                }
+                reply += Common::StringFromFormat("%x", thread->GetThreadId());
+            }
+        }
+        // The whole list fits in the first reply
+        SendReply(reply.size() > 1 ? reply.c_str() : "l");
+    } else if (strcmp(query, "sThreadInfo") == 0) {
+        SendReply("l");
+    } else if (strcmp(query, "C") == 0) {
+        u32 thread_id;
+        {
+            std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+            const Kernel::Thread* thread = Kernel::GetCurrentThread();
+            thread_id = thread ? thread->GetThreadId() : 0;
+        }
+        SendReply(Common::StringFromFormat("QC%x", thread_id).c_str());
+    } else if (strncmp(query, "ThreadExtraInfo,", strlen("ThreadExtraInfo,")) == 0) {
+        const size_t id_offset = 1 + strlen("ThreadExtraInfo,");
+        std::string info;
+        {
+            std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+            const u32 thread_id =
+                ParseThreadId(command_buffer + id_offset, command_length - id_offset);
+            if (const Kernel::Thread* thread = FindThread(thread_id)) {
+                info = thread->name;
+                if (thread->debug_suspended) {
+                    info += " (stopped)";
+                }
+            }
+        }
+        std::string reply(info.size() * 2, '\0');
+        MemToGdbHex(reinterpret_cast<u8*>(&reply[0]), reinterpret_cast<const u8*>(info.data()),
+                    info.size());
+        SendReply(reply.c_str());
     } else if (strncmp(query, "Xfer:features:read:target.xml:",
                        strlen("Xfer:features:read:target.xml:")) == 0) {
-        SendReply(target_xml);
+        const size_t args_offset = 1 + strlen("Xfer:features:read:target.xml:");
+        SendXferReply(target_xml, command_buffer + args_offset, command_length - args_offset);
     } else {
         SendReply("");
     }
@@ -430,14 +714,99 @@ static void HandleQuery() {
 
 /// Handle set thread command from gdb client.
 static void HandleSetThread() {
-    if (memcmp(command_buffer, "Hg0", 3) == 0 || memcmp(command_buffer, "Hc-1", 4) == 0 ||
-        memcmp(command_buffer, "Hc0", 4) == 0 || memcmp(command_buffer, "Hc1", 4) == 0) {
+    if (command_buffer[1] == 'g') {
+        selected_thread_id = ParseThreadId(command_buffer + 2, command_length - 2);
+        return SendReply("OK");
+    }
+    if (command_buffer[1] == 'c') {
         return SendReply("OK");
     }
 
     SendReply("E01");
 }
 
+/// Handle thread alive command from gdb client.
+static void HandleThreadAlive() {
+    const u32 thread_id = ParseThreadId(command_buffer + 1, command_length - 1);
+    bool is_alive;
+    {
+        std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+        is_alive = FindThread(thread_id) != nullptr;
+    }
+    SendReply(is_alive ? "OK" : "E01");
+}
+
+/// Handle general set command from gdb client.
+static void HandleGeneralSet() {
+    const char* command = reinterpret_cast<const char*>(command_buffer + 1);
+
+    if (strncmp(command, "NonStop:", strlen("NonStop:")) == 0) {
+        non_stop = command[strlen("NonStop:")] == '1';
+        LOG_INFO(Debug_GDBStub, "gdb: %s mode", non_stop ? "non-stop" : "all-stop");
+        if (non_stop) {
+            // The threads are stopped one by one from now on, the system runs meanwhile
+            halt_loop = false;
+            step_loop = false;
+        } else {
+            halt_loop = true;
+        }
+        stopping_threads.clear();
+        pending_stop_replies.clear();
+        is_stop_notification_sent = false;
+        SendReply("OK");
+    } else {
+        SendReply("");
+    }
+}
+
+/**
+ * Reports the threads stopped in non-stop mode to the client. In reply to '?', the first stopped
+ * thread is reported and the others are fetched with vStopped.
+ */
+static void SendStoppedThreads() {
+    pending_stop_replies.clear();
+    {
+        std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+        for (const auto& thread : Kernel::GetThreadList()) {
+            if (thread->debug_suspended && thread->status != THREADSTATUS_DEAD &&
+                thread->status != THREADSTATUS_RUNNING) {
+                pending_stop_replies.push_back(
+                    Common::StringFromFormat("T%02xthread:%x;", 0, thread->GetThreadId()));
+            }
+        }
+    }
+
+    if (pending_stop_replies.empty()) {
+        return SendReply("OK");
+    }
+    const std::string reply = std::move(pending_stop_replies.front());
+    pending_stop_replies.pop_front();
+    SendReply(reply.c_str());
+}
+
+/// Notifies the client of the threads it stopped that have now left their cores.
+static void ReportStoppedThreads() {
+    if (stopping_threads.empty()) {
+        return;
+    }
+
+    std::vector<u32> stopped_threads;
+    {
+        std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+        auto stopped_end = std::stable_partition(
+            stopping_threads.begin(), stopping_threads.end(), [](u32 thread_id) {
+                const Kernel::Thread* thread = FindThread(thread_id);
+                return thread != nullptr && thread->status == THREADSTATUS_RUNNING;
+            });
+        stopped_threads.assign(stopped_end, stopping_threads.end());
+        stopping_threads.erase(stopped_end, stopping_threads.end());
+    }
+
+    for (const u32 thread_id : stopped_threads) {
+        QueueStopReply(thread_id);
+    }
+}
+
 /**
  * Send signal packet to client.
  *
@@ -460,7 +829,7 @@ static void SendSignal(u32 signal) {
 /// Read command from gdb client.
 static void ReadCommand() {
     command_length = 0;
-    memset(command_buffer, 0, sizeof(command_buffer));
+    command_buffer[0] = '\0';
 
     u8 c = ReadByte();
     if (c == '+') {
@@ -477,13 +846,20 @@ static void ReadCommand() {
     }
 
     while ((c = ReadByte()) != GDB_STUB_END) {
-        if (command_length >= sizeof(command_buffer)) {
+        if (!IsConnected()) {
+            command_length = 0;
+            return;
+        }
+        // One byte is kept for the terminator, the handlers parse the commands as strings
+        if (command_length + 1 >= sizeof(command_buffer)) {
             LOG_ERROR(Debug_GDBStub, "gdb: command_buffer overflow\n");
+            command_length = 0;
             SendPacket(GDB_STUB_NACK);
             return;
         }
         command_buffer[command_length++] = c;
     }
+    command_buffer[command_length] = '\0';
 
     u8 checksum_received = HexCharToValue(ReadByte()) << 4;
     checksum_received |= HexCharToValue(ReadByte());
@@ -510,6 +886,10 @@ static bool IsDataAvailable() {
         return false;
     }
 
+    if (receive_offset != receive_length) {
+        return true;
+    }
+
     fd_set fd_socket;
 
     FD_ZERO(&fd_socket);
@@ -539,11 +919,11 @@ static void ReadRegister() {
     }
 
     if (id <= R15_REGISTER) {
-        IntToGdbHex(reply, Core::CPU().GetReg(id));
+        IntToGdbHex(reply, GetGuestReg(id));
     } else if (id == CPSR_REGISTER) {
-        IntToGdbHex(reply, Core::CPU().GetCPSR());
+        IntToGdbHex(reply, GetGuestCPSR());
     } else if (id > CPSR_REGISTER && id < FPSCR_REGISTER) {
-        IntToGdbHex(reply, Core::CPU().GetVFPReg(
+        IntToGdbHex(reply, GetGuestVFPReg(
                                id - CPSR_REGISTER -
                                1)); // VFP registers should start at 26, so one after CSPR_REGISTER
     } else if (id == FPSCR_REGISTER) {
@@ -563,17 +943,17 @@ static void ReadRegisters() {
     u8* bufptr = buffer;
 
     for (int reg = 0; reg <= R15_REGISTER; reg++) {
-        IntToGdbHex(bufptr + reg * CHAR_BIT, Core::CPU().GetReg(reg));
+        IntToGdbHex(bufptr + reg * CHAR_BIT, GetGuestReg(reg));
     }
 
     bufptr += (16 * CHAR_BIT);
 
-    IntToGdbHex(bufptr, Core::CPU().GetCPSR());
+    IntToGdbHex(bufptr, GetGuestCPSR());
 
     bufptr += CHAR_BIT;
 
     for (int reg = 0; reg <= 31; reg++) {
-        IntToGdbHex(bufptr + reg * CHAR_BIT, Core::CPU().GetVFPReg(reg));
+        IntToGdbHex(bufptr + reg * CHAR_BIT, GetGuestVFPReg(reg));
     }
 
     bufptr += (32 * CHAR_BIT);
@@ -593,11 +973,11 @@ static void WriteRegister() {
     }
 
     if (id <= R15_REGISTER) {
-        Core::CPU().SetReg(id, GdbHexToInt(buffer_ptr));
+        SetGuestReg(id, GdbHexToInt(buffer_ptr));
     } else if (id == CPSR_REGISTER) {
-        Core::CPU().SetCPSR(GdbHexToInt(buffer_ptr));
+        SetGuestCPSR(GdbHexToInt(buffer_ptr));
     } else if (id > CPSR_REGISTER && id < FPSCR_REGISTER) {
-        Core::CPU().SetVFPReg(id - CPSR_REGISTER - 1, GdbHexToInt(buffer_ptr));
+        SetGuestVFPReg(id - CPSR_REGISTER - 1, GdbHexToInt(buffer_ptr));
     } else if (id == FPSCR_REGISTER) {
         UNIMPLEMENTED();
     } else {
@@ -616,16 +996,16 @@ static void WriteRegisters() {
 
     for (int i = 0, reg = 0; reg <= FPSCR_REGISTER; i++, reg++) {
         if (reg <= R15_REGISTER) {
-            Core::CPU().SetReg(reg, GdbHexToInt(buffer_ptr + i * CHAR_BIT));
+            SetGuestReg(reg, GdbHexToInt(buffer_ptr + i * CHAR_BIT));
         } else if (reg == CPSR_REGISTER) {
-            Core::CPU().SetCPSR(GdbHexToInt(buffer_ptr + i * CHAR_BIT));
+            SetGuestCPSR(GdbHexToInt(buffer_ptr + i * CHAR_BIT));
         } else if (reg == CPSR_REGISTER - 1) {
             // Dummy FPA register, ignore
         } else if (reg < CPSR_REGISTER) {
             // Dummy FPA registers, ignore
             i += 2;
         } else if (reg > CPSR_REGISTER && reg < FPSCR_REGISTER) {
-            Core::CPU().SetVFPReg(reg - CPSR_REGISTER - 1, GdbHexToInt(buffer_ptr + i * CHAR_BIT));
+            SetGuestVFPReg(reg - CPSR_REGISTER - 1, GdbHexToInt(buffer_ptr + i * CHAR_BIT));
             i++; // Skip padding
         } else if (reg == FPSCR_REGISTER) {
             UNIMPLEMENTED();
@@ -647,10 +1027,10 @@ static void ReadMemory() {
     u32 len =
         HexToInt(start_offset, static_cast<u32>((command_buffer + command_length) - start_offset));
 
-    LOG_DEBUG(Debug_GDBStub, "gdb: addr: %08x len: %08x\n", addr, len);
+    LOG_DEBUG(Debug_GDBStub, "gdb: addr: %016" PRIx64 " len: %08x\n", addr, len);
 
-    if (len * 2 > sizeof(reply)) {
-        SendReply("E01");
+    if (size_t{len} * 2 >= sizeof(reply)) {
+        return SendReply("E01");
     }
 
     if (!Memory::IsValidVirtualAddress(addr)) {
@@ -679,6 +1059,10 @@ static void WriteMemory() {
         return SendReply("E00");
     }
 
+    if (size_t{len} * 2 > static_cast<size_t>(command_buffer + command_length - (len_pos + 1))) {
+        return SendReply("E01");
+    }
+
     std::vector<u8> data(len);
 
     GdbHexToMem(data.data(), len_pos + 1, len);
@@ -686,6 +1070,37 @@ static void WriteMemory() {
     SendReply("OK");
 }
 
+/// Modify location in memory with binary data received from the gdb client.
+static void WriteMemoryBinary() {
+    const u8* command_end = command_buffer + command_length;
+    const u8* start_offset = command_buffer + 1;
+    auto addr_pos = std::find(start_offset, command_end, ',');
+    VAddr addr = HexToInt(start_offset, static_cast<u32>(addr_pos - start_offset));
+
+    start_offset = addr_pos + 1;
+    auto len_pos = std::find(start_offset, command_end, ':');
+    if (len_pos == command_end) {
+        return SendReply("E01");
+    }
+    u32 len = HexToInt(start_offset, static_cast<u32>(len_pos - start_offset));
+
+    // The client probes for the support of this packet with an empty write
+    if (len == 0) {
+        return SendReply("OK");
+    }
+
+    if (!Memory::IsValidVirtualAddress(addr)) {
+        return SendReply("E00");
+    }
+
+    const std::vector<u8> data = GdbBinaryToMem(len_pos + 1, command_end - (len_pos + 1));
+    if (data.size() != len) {
+        return SendReply("E01");
+    }
+    Memory::WriteBlock(addr, data.data(), len);
+    SendReply("OK");
+}
+
 void Break(bool is_memory_break) {
     if (!halt_loop) {
         halt_loop = true;
@@ -719,6 +1134,107 @@ static void Continue() {
     halt_loop = false;
 }
 
+/**
+ * Stops or resumes the guest threads for a vCont action in non-stop mode.
+ *
+ * @param action Action, 't' to stop and 'c' or 'C' to resume.
+ * @param thread_id Thread the action applies to, 0 for all of them.
+ */
+static void ApplyNonStopAction(u8 action, u32 thread_id) {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    for (const auto& thread : Kernel::GetThreadList()) {
+        if (thread->status == THREADSTATUS_DEAD ||
+            (thread_id != 0 && thread->GetThreadId() != thread_id)) {
+            continue;
+        }
+        if (action == 't') {
+            if (!thread->debug_suspended) {
+                thread->DebugSuspend();
+                stopping_threads.push_back(thread->GetThreadId());
+            }
+        } else {
+            thread->DebugResume();
+            stopping_threads.erase(
+                std::remove(stopping_threads.begin(), stopping_threads.end(),
+                            thread->GetThreadId()),
+                stopping_threads.end());
+        }
+    }
+}
+
+/// Lets all the threads stopped in non-stop mode run again.
+static void ResumeStoppedThreads() {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    for (const auto& thread : Kernel::GetThreadList()) {
+        thread->DebugResume();
+    }
+    stopping_threads.clear();
+    pending_stop_replies.clear();
+    is_stop_notification_sent = false;
+}
+
+/// Handle resume command (vCont) from gdb client.
+static void HandleContinueActions() {
+    const u8* command_end = command_buffer + command_length;
+    const u8* action_pos = command_buffer + strlen("vCont");
+    bool step = false;
+    bool resume = false;
+
+    while (action_pos < command_end && *action_pos == ';') {
+        const u8* action_end = std::find(action_pos + 1, command_end, ';');
+        const u8* thread_pos = std::find(action_pos + 1, action_end, ':');
+        const u8 action = action_pos + 1 < action_end ? action_pos[1] : 0;
+        const u32 thread_id =
+            thread_pos != action_end ? ParseThreadId(thread_pos + 1, action_end - thread_pos - 1)
+                                     : 0;
+
+        if (action == 's' || action == 'S') {
+            step = true;
+        } else if (action == 'c' || action == 'C') {
+            resume = true;
+            if (non_stop) {
+                ApplyNonStopAction('c', thread_id);
+            }
+        } else if (action == 't' && non_stop) {
+            ApplyNonStopAction('t', thread_id);
+        }
+        action_pos = action_end;
+    }
+
+    if (non_stop) {
+        // The CPU cores only step all together, a single thread can't while the others run
+        return SendReply(step ? "E01" : "OK");
+    }
+    if (step) {
+        Step();
+    } else if (resume) {
+        Continue();
+    } else {
+        SendReply("E01");
+    }
+}
+
+/// Handle multi-letter command from gdb client.
+static void HandleVCommand() {
+    const char* command = reinterpret_cast<const char*>(command_buffer);
+
+    if (strcmp(command, "vCont?") == 0) {
+        SendReply("vCont;c;C;s;S;t");
+    } else if (strncmp(command, "vCont;", strlen("vCont;")) == 0) {
+        HandleContinueActions();
+    } else if (strcmp(command, "vStopped") == 0) {
+        if (pending_stop_replies.empty()) {
+            is_stop_notification_sent = false;
+            return SendReply("OK");
+        }
+        const std::string reply = std::move(pending_stop_replies.front());
+        pending_stop_replies.pop_front();
+        SendReply(reply.c_str());
+    } else {
+        SendReply("");
+    }
+}
+
 /**
  * Commit breakpoint to list of breakpoints.
  *
@@ -834,6 +1350,10 @@ void HandlePacket() {
         return;
     }
 
+    if (non_stop) {
+        ReportStoppedThreads();
+    }
+
     if (!IsDataAvailable()) {
         return;
     }
@@ -849,11 +1369,24 @@ void HandlePacket() {
     case 'q':
         HandleQuery();
         break;
+    case 'Q':
+        HandleGeneralSet();
+        break;
     case 'H':
         HandleSetThread();
         break;
+    case 'T':
+        HandleThreadAlive();
+        break;
+    case 'v':
+        HandleVCommand();
+        break;
     case '?':
-        SendSignal(latest_signal);
+        if (non_stop) {
+            SendStoppedThreads();
+        } else {
+            SendSignal(latest_signal);
+        }
         break;
     case 'k':
         Shutdown();
@@ -877,6 +1410,9 @@ void HandlePacket() {
     case 'M':
         WriteMemory();
         break;
+    case 'X':
+        WriteMemoryBinary();
+        break;
     case 's':
         Step();
         return;
@@ -1003,10 +1539,18 @@ void Shutdown() {
     }
 
     LOG_INFO(Debug_GDBStub, "Stopping GDB ...");
+    if (non_stop) {
+        // The threads the client stopped would never run again otherwise
+        ResumeStoppedThreads();
+        non_stop = false;
+    }
+    selected_thread_id = 0;
     if (gdbserver_socket != -1) {
         shutdown(gdbserver_socket, SHUT_RDWR);
         gdbserver_socket = -1;
     }
+    receive_offset = 0;
+    receive_length = 0;
 
 #ifdef _WIN32
     WSACleanup();
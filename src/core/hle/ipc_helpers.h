@@ -61,8 +61,6 @@ public:
                    u32 num_handles_to_copy = 0, u32 num_handles_to_move = 0,
                    u32 num_domain_objects = 0)
         : RequestHelperBase(context) {
-        memset(cmdbuf, 0, sizeof(u32) * IPC::COMMAND_BUFFER_LENGTH);
-
         IPC::CommandHeader header{};
 
         // The entire size of the raw data section in u32 units, including the 16 bytes of mandatory
@@ -96,6 +94,10 @@ public:
         IPC::DataPayloadHeader data_payload_header{};
         data_payload_header.magic = Common::MakeMagic('S', 'F', 'C', 'O');
         PushRaw(data_payload_header);
+
+        // Only the parameters that are going to be pushed need clearing, the headers above were
+        // written in full and the rest of the command buffer isn't sent back.
+        memset(cmdbuf + index, 0, sizeof(u32) * normal_params_size);
     }
 
     template <class T, class... Args>
@@ -103,6 +105,12 @@ public:
         context->AddDomainObject(std::make_shared<T>(std::forward<Args>(args)...));
     }
 
+    /// Pushes an interface the service keeps a reference to
+    template <class T>
+    void PushIpcInterface(std::shared_ptr<T> iface) {
+        context->AddDomainObject(std::move(iface));
+    }
+
     // Validate on destruction, as there shouldn't be any case where we don't want it
     ~RequestBuilder() {
         ValidateHeader();
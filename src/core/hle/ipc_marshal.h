@@ -0,0 +1,174 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "common/common_types.h"
+#include "core/hle/ipc_helpers.h"
+#include "core/hle/kernel/hle_ipc.h"
+#include "core/hle/result.h"
+
+/**
+ * Typed IPC marshalling for service handlers. Instead of parsing the request and building the
+ * response by hand, a handler is written as a regular member function:
+ *
+ *     std::tuple<ResultCode, u32> Open(IPC::BufferA path);
+ *
+ * Its parameters are popped from the request in order, and its return value is pushed as the
+ * response. The layout, including the size of the response, is derived from the signature at
+ * compile time.
+ *
+ * Supported parameter types are trivially copyable values (read from the raw data section like
+ * PopRaw does), the buffer views BufferA, BufferB and BufferX (taken from the descriptors of that
+ * type, in order) and Kernel::HLERequestContext&. The return type is either ResultCode or a tuple
+ * of a ResultCode followed by trivially copyable values. Handlers returning handles or interfaces
+ * still use RequestBuilder directly.
+ */
+namespace IPC {
+
+/// View of the guest buffer of the request's next A buffer descriptor
+struct BufferA : Kernel::GuestView {
+    explicit BufferA(Kernel::GuestView view) : GuestView(view) {}
+};
+
+/// View of the guest buffer of the request's next B buffer descriptor
+struct BufferB : Kernel::GuestView {
+    explicit BufferB(Kernel::GuestView view) : GuestView(view) {}
+};
+
+/// View of the guest buffer of the request's next X buffer descriptor
+struct BufferX : Kernel::GuestView {
+    explicit BufferX(Kernel::GuestView view) : GuestView(view) {}
+};
+
+namespace detail {
+
+/// Size of a value in the raw data section, in words
+template <typename T>
+constexpr u32 WordsOf() {
+    return (sizeof(T) + 3) / 4;
+}
+
+/// Position in the request while popping the parameters of a handler
+struct ParseState {
+    Kernel::HLERequestContext& context;
+    RequestParser parser;
+    size_t next_buffer_a = 0;
+    size_t next_buffer_b = 0;
+    size_t next_buffer_x = 0;
+};
+
+template <typename T>
+struct Param {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "IPC parameters must be trivially copyable, buffers or the request context");
+    using Stored = T;
+
+    static T Pop(ParseState& state) {
+        return state.parser.PopRaw<T>();
+    }
+};
+
+template <>
+struct Param<BufferA> {
+    using Stored = BufferA;
+
+    static BufferA Pop(ParseState& state) {
+        return BufferA{state.context.BufferViewA(state.next_buffer_a++)};
+    }
+};
+
+template <>
+struct Param<BufferB> {
+    using Stored = BufferB;
+
+    static BufferB Pop(ParseState& state) {
+        return BufferB{state.context.BufferViewB(state.next_buffer_b++)};
+    }
+};
+
+template <>
+struct Param<BufferX> {
+    using Stored = BufferX;
+
+    static BufferX Pop(ParseState& state) {
+        return BufferX{state.context.BufferViewX(state.next_buffer_x++)};
+    }
+};
+
+template <>
+struct Param<Kernel::HLERequestContext> {
+    using Stored = Kernel::HLERequestContext&;
+
+    static Kernel::HLERequestContext& Pop(ParseState& state) {
+        return state.context;
+    }
+};
+
+template <typename T>
+using StoredParam = typename Param<std::decay_t<T>>::Stored;
+
+/// Result code, which is 64-bit in the IPC buffer
+constexpr u32 RESULT_CODE_WORDS = 2;
+
+template <typename R>
+struct Response;
+
+template <>
+struct Response<ResultCode> {
+    static constexpr u32 NUM_WORDS = RESULT_CODE_WORDS;
+
+    static void Push(Kernel::HLERequestContext& context, const ResultCode& result) {
+        RequestBuilder rb{context, NUM_WORDS};
+        rb.Push(result);
+    }
+};
+
+template <typename... Outs>
+struct Response<std::tuple<ResultCode, Outs...>> {
+    static_assert(std::conjunction<std::is_trivially_copyable<Outs>...>::value,
+                  "IPC return values must be trivially copyable");
+
+    static constexpr u32 NUM_WORDS = RESULT_CODE_WORDS + (0 + ... + WordsOf<Outs>());
+
+    template <size_t... I>
+    static void PushValues(RequestBuilder& rb, const std::tuple<ResultCode, Outs...>& values,
+                           std::index_sequence<I...>) {
+        (rb.PushRaw(std::get<I + 1>(values)), ...);
+    }
+
+    static void Push(Kernel::HLERequestContext& context,
+                     const std::tuple<ResultCode, Outs...>& values) {
+        RequestBuilder rb{context, NUM_WORDS};
+        rb.Push(std::get<0>(values));
+        PushValues(rb, values, std::index_sequence_for<Outs...>{});
+    }
+};
+
+} // namespace detail
+
+/**
+ * Pops the parameters of a typed handler from the request, calls it and pushes its return value
+ * as the response.
+ */
+template <typename Self, typename R, typename... Args>
+void InvokeMarshalled(Self* self, R (Self::*handler)(Args...), Kernel::HLERequestContext& ctx) {
+    detail::ParseState state{ctx, RequestParser{ctx}};
+
+    // Braced initialization guarantees the parameters are popped from left to right
+    std::tuple<detail::StoredParam<Args>...> args{
+        detail::Param<std::decay_t<Args>>::Pop(state)...};
+
+    const R result = std::apply(
+        [self, handler](auto&&... params) {
+            return (self->*handler)(std::forward<decltype(params)>(params)...);
+        },
+        std::move(args));
+    detail::Response<R>::Push(ctx, result);
+}
+
+} // namespace IPC
@@ -0,0 +1,147 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <unordered_map>
+#include <vector>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "common/thread_pool.h"
+#include "core/core_timing.h"
+#include "core/hle/kernel/async_request.h"
+#include "core/hle/kernel/domain.h"
+#include "core/hle/kernel/handle_table.h"
+#include "core/hle/kernel/hle_ipc.h"
+#include "core/hle/kernel/process.h"
+#include "core/hle/kernel/thread.h"
+#include "core/memory.h"
+#include "core/settings.h"
+
+namespace Kernel {
+
+namespace {
+
+struct PendingRequest {
+    SharedPtr<Thread> thread;
+    /// The session or domain of the request, which the context only borrows
+    SharedPtr<Object> owner;
+    std::unique_ptr<HLERequestContext> context;
+};
+
+/// Requests waiting for their work to finish, only accessed on the emu thread
+std::unordered_map<u64, PendingRequest> pending_requests;
+u64 next_request_id = 0;
+
+CoreTiming::EventType* completion_event_type = nullptr;
+
+/// Work queued on the thread pool, only accessed on the emu thread
+std::vector<std::future<void>> running_work;
+/// Set on shutdown, work that didn't start by then is dropped
+std::atomic<bool> drop_work{false};
+std::atomic<size_t> num_dropped{0};
+
+void RunWork(u64 request_id, const HLERequestContext::AsyncWork& work) {
+    if (drop_work) {
+        ++num_dropped;
+        return;
+    }
+    work();
+    CoreTiming::ScheduleEventThreadsafe(0, completion_event_type, request_id);
+}
+
+/// Runs on the emu thread once the work of a request is done
+void CompleteRequest(u64 request_id, int cycles_late) {
+    auto itr = pending_requests.find(request_id);
+    if (itr == pending_requests.end()) {
+        return;
+    }
+
+    PendingRequest request = std::move(itr->second);
+    pending_requests.erase(itr);
+
+    // The thread may have been stopped in the meantime, then nobody is waiting for the response
+    if (request.thread->status != THREADSTATUS_WAIT_IPC) {
+        return;
+    }
+
+    HLERequestContext& context = *request.context;
+    context.CompleteAsync();
+
+    u32* cmd_buf = (u32*)Memory::GetPointer(request.thread->GetTLSAddress());
+    const SharedPtr<Process>& process = request.thread->owner_process;
+    context.WriteToOutgoingCommandBuffer(cmd_buf, *process, process->handle_table);
+    context.Clear();
+
+    request.thread->ResumeFromWait();
+}
+
+} // Anonymous namespace
+
+void SubmitAsyncRequest(SharedPtr<Thread> thread, std::unique_ptr<HLERequestContext> context) {
+    ASSERT(thread == GetCurrentThread());
+    ASSERT(context->IsAsync());
+
+    const u64 request_id = next_request_id++;
+    HLERequestContext::AsyncWork work = context->TakeAsyncWork();
+    HLERequestContext::AsyncWait wait = context->TakeAsyncWait();
+
+    SharedPtr<Object> owner = context->IsDomain() ? SharedPtr<Object>(context->Domain())
+                                                  : SharedPtr<Object>(context->ServerSession());
+
+    thread->status = THREADSTATUS_WAIT_IPC;
+    pending_requests.emplace(request_id, PendingRequest{std::move(thread), std::move(owner),
+                                                        std::move(context)});
+
+    if (wait != nullptr) {
+        // Nothing runs on the pool, the source of the event completes the request. The client
+        // thread is waiting on I/O, so the emulated CPU is interrupted to resume it right away.
+        wait([request_id] {
+            CoreTiming::ScheduleEventFromHost(completion_event_type, request_id,
+                                              std::chrono::nanoseconds::zero(), true);
+        });
+        return;
+    }
+
+    // The completion would otherwise come in whenever the pool gets to the work
+    if (Settings::values.use_deterministic_mode) {
+        work();
+        CoreTiming::ScheduleEvent(0, completion_event_type, request_id);
+        return;
+    }
+
+    running_work.erase(std::remove_if(running_work.begin(), running_work.end(),
+                                      [](const std::future<void>& future) {
+                                          return future.wait_for(std::chrono::seconds(0)) ==
+                                                 std::future_status::ready;
+                                      }),
+                       running_work.end());
+    // The client thread is stalled until the work is done
+    running_work.push_back(Common::ThreadPool::GetInstance().Submit(
+        [request_id, work = std::move(work)] { RunWork(request_id, work); },
+        Common::TaskPriority::High));
+}
+
+void AsyncRequestsInit() {
+    completion_event_type = CoreTiming::RegisterEvent("AsyncRequestCompletion", CompleteRequest);
+    drop_work = false;
+    num_dropped = 0;
+}
+
+void AsyncRequestsShutdown() {
+    drop_work = true;
+    for (auto& future : running_work) {
+        future.wait();
+    }
+    running_work.clear();
+    if (num_dropped != 0) {
+        LOG_WARNING(Kernel, "Dropped %zu asynchronous requests that didn't start",
+                    num_dropped.load());
+    }
+    pending_requests.clear();
+}
+
+} // namespace Kernel
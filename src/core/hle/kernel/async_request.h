@@ -0,0 +1,31 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include "core/hle/kernel/kernel.h"
+
+namespace Kernel {
+
+class HLERequestContext;
+class Thread;
+
+/**
+ * Hands a request whose handler called HLERequestContext::RunAsync over to the host thread pool,
+ * or starts the wait of one that called WaitAsync. The client thread waits until the work is done
+ * or the wait is signalled; the completion then builds the response, which is written to the
+ * client's command buffer before the thread is resumed.
+ * @param thread Thread that made the request, it must be the current thread.
+ * @param context Context of the request, owned by the pending request until it completes.
+ */
+void SubmitAsyncRequest(SharedPtr<Thread> thread, std::unique_ptr<HLERequestContext> context);
+
+/// Prepares the completion of asynchronous HLE requests
+void AsyncRequestsInit();
+
+/// Waits for the running asynchronous requests and drops the ones that didn't complete
+void AsyncRequestsShutdown();
+
+} // namespace Kernel
@@ -7,6 +7,7 @@
 #include <memory>
 #include <string>
 #include "common/common_types.h"
+#include "core/hle/kernel/slab_heap.h"
 #include "core/hle/kernel/sync_object.h"
 #include "core/hle/result.h"
 
@@ -16,7 +17,7 @@ class ServerSession;
 class Session;
 class Thread;
 
-class ClientSession final : public SyncObject {
+class ClientSession final : public SyncObject, public SlabAllocated<ClientSession> {
 public:
     friend class ServerSession;
 
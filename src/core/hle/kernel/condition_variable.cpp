@@ -43,7 +43,7 @@ void ConditionVariable::Acquire(Thread* thread) {
 ResultCode ConditionVariable::Release(s32 target) {
     if (target == -1) {
         // When -1, wake up all waiting threads
-        SetAvailableCount(GetWaitingThreads().size());
+        SetAvailableCount(GetNumWaitingThreads());
         WakeupAllWaitingThreads();
     } else {
         // Otherwise, wake up just a single thread
@@ -51,6 +51,12 @@ ResultCode ConditionVariable::Release(s32 target) {
         WakeupWaitingThread(GetHighestPriorityReadyThread());
     }
 
+    // Without waiters the condition variable only exists in guest memory, so stop tracking it
+    // until a thread waits on it again. The caller still holds a reference to it.
+    if (!HasWaitingThreads()) {
+        g_object_address_table.Close(guest_addr);
+    }
+
     return RESULT_SUCCESS;
 }
 
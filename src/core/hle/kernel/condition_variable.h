@@ -8,12 +8,13 @@
 #include <string>
 #include "common/common_types.h"
 #include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/slab_heap.h"
 #include "core/hle/kernel/wait_object.h"
 #include "core/hle/result.h"
 
 namespace Kernel {
 
-class ConditionVariable final : public WaitObject {
+class ConditionVariable final : public WaitObject, public SlabAllocated<ConditionVariable> {
 public:
     /**
      * Creates a condition variable.
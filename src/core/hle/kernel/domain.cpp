@@ -2,8 +2,12 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include "common/logging/log.h"
+#include "core/hle/ipc_helpers.h"
+#include "core/hle/kernel/async_request.h"
 #include "core/hle/kernel/client_port.h"
 #include "core/hle/kernel/domain.h"
+#include "core/hle/kernel/errors.h"
 #include "core/hle/kernel/handle_table.h"
 #include "core/hle/kernel/hle_ipc.h"
 #include "core/hle/kernel/process.h"
@@ -21,24 +25,82 @@ ResultVal<SharedPtr<Domain>> Domain::Create(std::string name) {
 ResultVal<SharedPtr<Domain>> Domain::CreateFromSession(const Session& session) {
     auto res = Create(session.port->GetName() + "_Domain");
     auto& domain = res.Unwrap();
-    domain->request_handlers.push_back(std::move(session.server->hle_handler));
-    Kernel::g_handle_table.ConvertSessionToDomain(session, domain);
+    domain->AddObject(std::move(session.server->hle_handler));
+    Kernel::g_current_process->handle_table.ConvertSessionToDomain(session, domain);
     return res;
 }
 
+Domain::~Domain() = default;
+
+u32 Domain::AddObject(std::shared_ptr<SessionRequestHandler> object) {
+    if (!free_object_ids.empty()) {
+        const u32 object_id = free_object_ids.back();
+        free_object_ids.pop_back();
+        objects[object_id - 1] = std::move(object);
+        return object_id;
+    }
+
+    objects.push_back(std::move(object));
+    return static_cast<u32>(objects.size());
+}
+
+SessionRequestHandler* Domain::GetObject(u32 object_id) const {
+    if (object_id == 0 || object_id > objects.size()) {
+        return nullptr;
+    }
+    return objects[object_id - 1].get();
+}
+
+void Domain::CloseObject(u32 object_id) {
+    ASSERT(GetObject(object_id) != nullptr);
+    objects[object_id - 1] = nullptr;
+    free_object_ids.push_back(object_id);
+}
+
 ResultCode Domain::SendSyncRequest(SharedPtr<Thread> thread) {
-    Kernel::HLERequestContext context(this);
+    if (request_context == nullptr) {
+        request_context = std::make_unique<HLERequestContext>(this);
+    } else {
+        request_context->Reset(this);
+    }
+
+    HLERequestContext& context = *request_context;
     u32* cmd_buf = (u32*)Memory::GetPointer(Kernel::GetCurrentThread()->GetTLSAddress());
     context.PopulateFromIncomingCommandBuffer(cmd_buf, *Kernel::g_current_process,
-                                              Kernel::g_handle_table);
+                                              Kernel::g_current_process->handle_table);
+
+    // If there is a DomainMessageHeader, then this is CommandType "Request"
+    const auto& domain_message_header = context.GetDomainMessageHeader();
+    const u32 object_id = domain_message_header ? domain_message_header->object_id : 1;
+    SessionRequestHandler* object = GetObject(object_id);
+    if (object == nullptr) {
+        LOG_ERROR(Kernel, "Request to invalid domain object %u", object_id);
+        context.Clear();
+        return ERR_INVALID_HANDLE;
+    }
+
+    ResultCode result = RESULT_SUCCESS;
+    if (domain_message_header && domain_message_header->command ==
+                                     IPC::DomainMessageHeader::CommandType::CloseVirtualHandle) {
+        LOG_DEBUG(Kernel, "Closing domain object %u", object_id);
+        CloseObject(object_id);
+
+        IPC::RequestBuilder rb{context, 2};
+        rb.Push(RESULT_SUCCESS);
+        context.WriteToOutgoingCommandBuffer(cmd_buf, *Kernel::g_current_process,
+                                             Kernel::g_current_process->handle_table);
+    } else {
+        result = object->HandleSyncRequest(context);
+    }
 
-    auto& domain_message_header = context.GetDomainMessageHeader();
-    if (domain_message_header) {
-        // If there is a DomainMessageHeader, then this is CommandType "Request"
-        const u32 object_id{context.GetDomainMessageHeader()->object_id};
-        return request_handlers[object_id - 1]->HandleSyncRequest(context);
+    if (context.IsAsync()) {
+        // The pending request owns the context until it completes
+        SubmitAsyncRequest(std::move(thread), std::move(request_context));
+    } else {
+        // Release the objects the request referenced
+        context.Clear();
     }
-    return request_handlers.front()->HandleSyncRequest(context);
+    return result;
 }
 
 } // namespace Kernel
@@ -12,6 +12,7 @@
 
 namespace Kernel {
 
+class HLERequestContext;
 class Session;
 class SessionRequestHandler;
 
@@ -26,6 +27,9 @@ public:
         return HANDLE_TYPE;
     }
 
+    /// Creates an empty domain, not associated with any session
+    static ResultVal<SharedPtr<Domain>> Create(std::string name = "Unknown");
+
     static ResultVal<SharedPtr<Domain>> CreateFromSession(const Session& server);
 
     ResultCode SendSyncRequest(SharedPtr<Thread> thread) override;
@@ -33,13 +37,32 @@ public:
     /// The name of this domain (optional)
     std::string name;
 
-    std::vector<std::shared_ptr<SessionRequestHandler>> request_handlers;
+    /**
+     * Adds an object to the domain.
+     * @returns The id of the object, which stays valid until the object is closed.
+     */
+    u32 AddObject(std::shared_ptr<SessionRequestHandler> object);
+
+    /**
+     * Returns a borrowed reference to an object of the domain, which is only valid until the
+     * object is closed, or nullptr if there is no object with the given id.
+     */
+    SessionRequestHandler* GetObject(u32 object_id) const;
+
+    /// Closes an object of the domain, its id may be reused for a new object afterwards
+    void CloseObject(u32 object_id);
 
 private:
     Domain() = default;
-    ~Domain() override = default;
+    ~Domain() override;
 
-    static ResultVal<SharedPtr<Domain>> Create(std::string name = "Unknown");
+    /// Objects of the domain, indexed by their id minus one. Closed objects leave a nullptr.
+    std::vector<std::shared_ptr<SessionRequestHandler>> objects;
+    /// Ids of the closed objects, reused before the table grows
+    std::vector<u32> free_object_ids;
+
+    /// Context of the requests to this domain, reused to avoid rebuilding it for every request
+    std::unique_ptr<HLERequestContext> request_context;
 };
 
 } // namespace Kernel
@@ -12,7 +12,6 @@ namespace ErrCodes {
 enum {
     // TODO(Subv): Remove these 3DS OS error codes.
     OutOfHandles = 19,
-    SessionClosedByRemote = 26,
     PortNameTooLong = 30,
     NoPendingSessions = 35,
     WrongPermission = 46,
@@ -24,6 +23,8 @@ enum {
     Timeout = 117,
     SynchronizationCanceled = 118,
     TooLarge = 119,
+    SessionClosed = 123,
+    ResourceLimitExceeded = 132,
 };
 }
 
@@ -32,7 +33,7 @@ enum {
 
 // TODO(bunnei): Replace these with correct errors for Switch OS
 constexpr ResultCode ERR_OUT_OF_HANDLES(-1);
-constexpr ResultCode ERR_SESSION_CLOSED_BY_REMOTE(-1);
+constexpr ResultCode ERR_SESSION_CLOSED_BY_REMOTE(ErrorModule::Kernel, ErrCodes::SessionClosed);
 constexpr ResultCode ERR_PORT_NAME_TOO_LONG(-1);
 constexpr ResultCode ERR_WRONG_PERMISSION(-1);
 constexpr ResultCode ERR_MAX_CONNECTIONS_REACHED(-1);
@@ -53,6 +54,8 @@ constexpr ResultCode ERR_NOT_FOUND(-1);
 constexpr ResultCode ERR_OUT_OF_RANGE(-1);
 constexpr ResultCode ERR_OUT_OF_RANGE_KERNEL(-1);
 constexpr ResultCode RESULT_TIMEOUT(ErrorModule::Kernel, ErrCodes::Timeout);
+constexpr ResultCode ERR_RESOURCE_LIMIT_EXCEEDED(ErrorModule::Kernel,
+                                                 ErrCodes::ResourceLimitExceeded);
 /// Returned when Accept() is called on a port with no sessions to be accepted.
 constexpr ResultCode ERR_NO_PENDING_SESSIONS(-1);
 
@@ -15,8 +15,6 @@
 
 namespace Kernel {
 
-HandleTable g_handle_table;
-
 HandleTable::HandleTable() {
     next_generation = 1;
     Clear();
@@ -25,12 +23,13 @@ HandleTable::HandleTable() {
 ResultVal<Handle> HandleTable::Create(SharedPtr<Object> obj) {
     DEBUG_ASSERT(obj != nullptr);
 
+    std::lock_guard<std::mutex> lock(mutex);
     u16 slot = next_free_slot;
     if (slot >= generations.size()) {
         LOG_ERROR(Kernel, "Unable to allocate Handle, too many slots in use.");
         return ERR_OUT_OF_HANDLES;
     }
-    next_free_slot = generations[slot];
+    next_free_slot = next_free_slots[slot];
 
     u16 generation = next_generation++;
 
@@ -39,8 +38,10 @@ ResultVal<Handle> HandleTable::Create(SharedPtr<Object> obj) {
     if (next_generation >= (1 << 15))
         next_generation = 1;
 
-    generations[slot] = generation;
+    // Publish the object before the generation that makes it visible to the lookups
+    unowned_objects[slot].store(obj.get(), std::memory_order_relaxed);
     objects[slot] = std::move(obj);
+    generations[slot].store(generation, std::memory_order_release);
 
     Handle handle = generation | (slot << 15);
     return MakeResult<Handle>(handle);
@@ -56,23 +57,33 @@ ResultVal<Handle> HandleTable::Duplicate(Handle handle) {
 }
 
 void HandleTable::ConvertSessionToDomain(const Session& session, SharedPtr<Object> domain) {
-    for (auto& object : objects) {
-        if (DynamicObjectCast<ClientSession>(object) == session.client) {
-            object = domain;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t slot = 0; slot < MAX_COUNT; ++slot) {
+        // Compare the raw pointers, there is no need to add references to every object
+        if (objects[slot].get() == session.client) {
+            unowned_objects[slot].store(domain.get(), std::memory_order_release);
+            objects[slot] = domain;
         }
     }
 }
 
 ResultCode HandleTable::Close(Handle handle) {
-    if (!IsValid(handle))
-        return ERR_INVALID_HANDLE;
+    // The object is released once the table is unlocked, its destruction may close handles
+    SharedPtr<Object> object;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!IsValid(handle))
+            return ERR_INVALID_HANDLE;
 
-    u16 slot = GetSlot(handle);
+        u16 slot = GetSlot(handle);
 
-    objects[slot] = nullptr;
+        generations[slot].store(0, std::memory_order_release);
+        unowned_objects[slot].store(nullptr, std::memory_order_relaxed);
+        object = std::move(objects[slot]);
 
-    generations[slot] = next_free_slot;
-    next_free_slot = slot;
+        next_free_slots[slot] = next_free_slot;
+        next_free_slot = slot;
+    }
     return RESULT_SUCCESS;
 }
 
@@ -80,28 +91,45 @@ bool HandleTable::IsValid(Handle handle) const {
     size_t slot = GetSlot(handle);
     u16 generation = GetGeneration(handle);
 
-    return slot < MAX_COUNT && objects[slot] != nullptr && generations[slot] == generation;
+    return slot < MAX_COUNT && generation != 0 &&
+           generations[slot].load(std::memory_order_acquire) == generation;
 }
 
 SharedPtr<Object> HandleTable::GetGeneric(Handle handle) const {
+    return GetGenericUnowned(handle);
+}
+
+Object* HandleTable::GetGenericUnowned(Handle handle) const {
     if (handle == CurrentThread) {
         return GetCurrentThread();
     } else if (handle == CurrentProcess) {
-        return g_current_process;
+        return g_current_process.get();
     }
 
+    // The slot may be closed and reused while it is read, in which case its generation changes
     if (!IsValid(handle)) {
         return nullptr;
     }
-    return objects[GetSlot(handle)];
+    Object* object = unowned_objects[GetSlot(handle)].load(std::memory_order_acquire);
+    if (!IsValid(handle)) {
+        return nullptr;
+    }
+    return object;
 }
 
 void HandleTable::Clear() {
-    for (u16 i = 0; i < MAX_COUNT; ++i) {
-        generations[i] = i + 1;
-        objects[i] = nullptr;
+    // The objects are released once the table is unlocked, their destruction may close handles
+    std::array<SharedPtr<Object>, MAX_COUNT> released_objects;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (u16 i = 0; i < MAX_COUNT; ++i) {
+            generations[i].store(0, std::memory_order_release);
+            unowned_objects[i].store(nullptr, std::memory_order_relaxed);
+            released_objects[i] = std::move(objects[i]);
+            next_free_slots[i] = i + 1;
+        }
+        next_free_slot = 0;
     }
-    next_free_slot = 0;
 }
 
 } // namespace
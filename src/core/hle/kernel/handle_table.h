@@ -5,7 +5,9 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <cstddef>
+#include <mutex>
 #include "common/common_types.h"
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/result.h"
@@ -41,6 +43,10 @@ class Session;
  * is destroyed, it is again pushed onto the list to be re-used by the next allocation. It is
  * likely that this allocation strategy differs from the one used in CTR-OS, but this hasn't been
  * verified and isn't likely to cause any problems.
+ *
+ * Each process has its own table. The modifications of a table are serialized by a mutex, while
+ * the lookups don't lock: the unowned lookups can run concurrently with them, and validate the
+ * generation of the slot before and after reading its object.
  */
 class HandleTable final : NonCopyable {
 public:
@@ -92,6 +98,23 @@ public:
         return DynamicObjectCast<T>(GetGeneric(handle));
     }
 
+    /**
+     * Looks up a handle without adding a reference to the object, for callers that are done with
+     * the object before the guest gets a chance to close the handle.
+     * @return Pointer to the looked-up object, or `nullptr` if the handle is not valid.
+     */
+    Object* GetGenericUnowned(Handle handle) const;
+
+    /**
+     * Looks up a handle while verifying its type, without adding a reference to the object.
+     * @return Pointer to the looked-up object, or `nullptr` if the handle is not valid or its
+     *         type differs from the requested one.
+     */
+    template <class T>
+    T* GetUnowned(Handle handle) const {
+        return DynamicObjectCast<T>(GetGenericUnowned(handle));
+    }
+
     /// Closes all handles held in this table.
     void Clear();
 
@@ -112,22 +135,29 @@ private:
     /// Stores the Object referenced by the handle or null if the slot is empty.
     std::array<SharedPtr<Object>, MAX_COUNT> objects;
 
+    /// Copies of the pointers in `objects`, read by the lookups while the table is modified.
+    std::array<std::atomic<Object*>, MAX_COUNT> unowned_objects;
+
     /**
-     * The value of `next_generation` when the handle was created, used to check for validity. For
-     * empty slots, contains the index of the next free slot in the list.
+     * The value of `next_generation` when the handle was created, used to check for validity. It
+     * is 0 for empty slots, a generation no handle has.
      */
-    std::array<u16, MAX_COUNT> generations;
+    std::array<std::atomic<u16>, MAX_COUNT> generations;
+
+    /// For empty slots, contains the index of the next free slot in the list.
+    std::array<u16, MAX_COUNT> next_free_slots;
 
     /**
-     * Global counter of the number of created handles. Stored in `generations` when a handle is
+     * Counter of the number of created handles. Stored in `generations` when a handle is
      * created, and wraps around to 1 when it hits 0x8000.
      */
     u16 next_generation;
 
     /// Head of the free slots linked list.
     u16 next_free_slot;
-};
 
-extern HandleTable g_handle_table;
+    /// Serializes the modifications of the table.
+    std::mutex mutex;
+};
 
 } // namespace
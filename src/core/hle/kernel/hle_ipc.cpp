@@ -2,6 +2,8 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <cstring>
 #include <boost/range/algorithm_ext/erase.hpp>
 #include "common/assert.h"
 #include "common/common_funcs.h"
@@ -13,6 +15,7 @@
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/kernel/process.h"
 #include "core/hle/kernel/server_session.h"
+#include "core/memory.h"
 
 namespace Kernel {
 
@@ -26,20 +29,167 @@ void SessionRequestHandler::ClientDisconnected(SharedPtr<ServerSession> server_s
     boost::range::remove_erase(connected_sessions, server_session);
 }
 
-HLERequestContext::HLERequestContext(SharedPtr<Kernel::Domain> domain) : domain(std::move(domain)) {
+GuestView::GuestView(VAddr address, size_t size) : address(address), size(size) {
+    Memory::HostSpanList spans;
+    if (size != 0 && Memory::GetHostSpans(address, size, spans) && spans.size() == 1) {
+        data = spans[0].pointer;
+    }
+}
+
+void GuestView::Read(size_t offset, void* dest, size_t length) const {
+    ASSERT_MSG(offset <= size && length <= size - offset, "Out of bounds read from guest buffer");
+    if (data) {
+        std::memcpy(dest, data + offset, length);
+    } else {
+        Memory::ReadBlock(address + offset, dest, length);
+    }
+}
+
+void GuestView::Write(size_t offset, const void* src, size_t length) const {
+    ASSERT_MSG(offset <= size && length <= size - offset, "Out of bounds write to guest buffer");
+    if (data) {
+        std::memcpy(data + offset, src, length);
+    } else {
+        Memory::WriteBlock(address + offset, src, length);
+    }
+}
+
+std::vector<u8> GuestView::ReadAll() const {
+    std::vector<u8> buffer(size);
+    Read(0, buffer.data(), size);
+    return buffer;
+}
+
+size_t GuestView::WriteAll(const std::vector<u8>& src) const {
+    const size_t length = std::min(src.size(), size);
+    Write(0, src.data(), length);
+    return length;
+}
+
+HLERequestContext::HLERequestContext(Kernel::Domain* domain) : domain(domain) {
     cmd_buf[0] = 0;
 }
 
-HLERequestContext::HLERequestContext(SharedPtr<Kernel::ServerSession> server_session)
-    : server_session(std::move(server_session)) {
+HLERequestContext::HLERequestContext(Kernel::ServerSession* server_session)
+    : server_session(server_session) {
     cmd_buf[0] = 0;
 }
 
 HLERequestContext::~HLERequestContext() = default;
 
-void HLERequestContext::ParseCommandBuffer(u32_le* src_cmdbuf, bool incoming) {
+void HLERequestContext::Reset(Kernel::ServerSession* session) {
+    Clear();
+    server_session = session;
+}
+
+void HLERequestContext::Reset(Kernel::Domain* domain) {
+    Clear();
+    this->domain = domain;
+}
+
+SharedPtr<Kernel::Domain> HLERequestContext::Domain() const {
+    return domain;
+}
+
+void HLERequestContext::Clear() {
+    cmd_buf[0] = 0;
+    domain = nullptr;
+    server_session = nullptr;
+    move_objects.clear();
+    copy_objects.clear();
+    domain_objects.clear();
+
+    command_header = boost::none;
+    handle_descriptor_header = boost::none;
+    data_payload_header = boost::none;
+    domain_message_header = boost::none;
+    buffer_x_desciptors.clear();
+    buffer_a_desciptors.clear();
+    buffer_b_desciptors.clear();
+    buffer_w_desciptors.clear();
+
+    for (auto& buffer : scratch_buffers) {
+        buffer.clear();
+    }
+    async_work = nullptr;
+    async_wait = nullptr;
+    async_completion = nullptr;
+    data_payload_offset = 0;
+    command = 0;
+}
+
+void HLERequestContext::RunAsync(AsyncWork work, AsyncCompletion completion) {
+    ASSERT_MSG(!IsAsync(), "Request is already asynchronous");
+    ASSERT(work != nullptr && completion != nullptr);
+    async_work = std::move(work);
+    async_completion = std::move(completion);
+}
+
+void HLERequestContext::WaitAsync(AsyncWait wait, AsyncCompletion completion) {
+    ASSERT_MSG(!IsAsync(), "Request is already asynchronous");
+    ASSERT(wait != nullptr && completion != nullptr);
+    async_wait = std::move(wait);
+    async_completion = std::move(completion);
+}
+
+void HLERequestContext::CompleteAsync() {
+    ASSERT(IsAsync());
+    const AsyncCompletion completion = std::move(async_completion);
+    async_completion = nullptr;
+    completion(*this);
+}
+
+std::vector<u8>& HLERequestContext::ScratchBuffer(size_t index, size_t size) {
+    ASSERT(index < scratch_buffers.size());
+    auto& buffer = scratch_buffers[index];
+    buffer.resize(size);
+    return buffer;
+}
+
+u64 HLERequestContext::GetBufferDescriptorBytes() const {
+    u64 bytes = 0;
+    for (const auto& descriptor : buffer_x_desciptors) {
+        bytes += descriptor.size;
+    }
+    for (const auto* descriptors :
+         {&buffer_a_desciptors, &buffer_b_desciptors, &buffer_w_desciptors}) {
+        for (const auto& descriptor : *descriptors) {
+            bytes += descriptor.Size();
+        }
+    }
+    return bytes;
+}
+
+GuestView HLERequestContext::BufferViewX(size_t index) const {
+    ASSERT(index < buffer_x_desciptors.size());
+    const auto& descriptor = buffer_x_desciptors[index];
+    return {descriptor.Address(), descriptor.size};
+}
+
+GuestView HLERequestContext::BufferViewA(size_t index) const {
+    ASSERT(index < buffer_a_desciptors.size());
+    const auto& descriptor = buffer_a_desciptors[index];
+    return {descriptor.Address(), descriptor.Size()};
+}
+
+GuestView HLERequestContext::BufferViewB(size_t index) const {
+    ASSERT(index < buffer_b_desciptors.size());
+    const auto& descriptor = buffer_b_desciptors[index];
+    return {descriptor.Address(), descriptor.Size()};
+}
+
+void HLERequestContext::ParseCommandBuffer(u32_le* src_cmdbuf, bool incoming,
+                                           HandleTable& handle_table) {
     IPC::RequestParser rp(src_cmdbuf);
-    command_header = std::make_unique<IPC::CommandHeader>(rp.PopRaw<IPC::CommandHeader>());
+    command_header.emplace(rp.PopRaw<IPC::CommandHeader>());
+
+    // The same context parses the request and then the response
+    handle_descriptor_header = boost::none;
+    domain_message_header = boost::none;
+    buffer_x_desciptors.clear();
+    buffer_a_desciptors.clear();
+    buffer_b_desciptors.clear();
+    buffer_w_desciptors.clear();
 
     if (command_header->type == IPC::CommandType::Close) {
         // Close does not populate the rest of the IPC header
@@ -48,18 +198,17 @@ void HLERequestContext::ParseCommandBuffer(u32_le* src_cmdbuf, bool incoming) {
 
     // If handle descriptor is present, add size of it
     if (command_header->enable_handle_descriptor) {
-        handle_descriptor_header =
-            std::make_unique<IPC::HandleDescriptorHeader>(rp.PopRaw<IPC::HandleDescriptorHeader>());
+        handle_descriptor_header.emplace(rp.PopRaw<IPC::HandleDescriptorHeader>());
         if (handle_descriptor_header->send_current_pid) {
             rp.Skip(2, false);
         }
         if (incoming) {
             // Populate the object lists with the data in the IPC request.
             for (u32 handle = 0; handle < handle_descriptor_header->num_handles_to_copy; ++handle) {
-                copy_objects.push_back(Kernel::g_handle_table.GetGeneric(rp.Pop<Handle>()));
+                copy_objects.push_back(handle_table.GetGeneric(rp.Pop<Handle>()));
             }
             for (u32 handle = 0; handle < handle_descriptor_header->num_handles_to_move; ++handle) {
-                move_objects.push_back(Kernel::g_handle_table.GetGeneric(rp.Pop<Handle>()));
+                move_objects.push_back(handle_table.GetGeneric(rp.Pop<Handle>()));
             }
         } else {
             // For responses we just ignore the handles, they're empty and will be populated when
@@ -95,12 +244,17 @@ void HLERequestContext::ParseCommandBuffer(u32_le* src_cmdbuf, bool incoming) {
     if (IsDomain() && (command_header->type == IPC::CommandType::Request || !incoming)) {
         // If this is an incoming message, only CommandType "Request" has a domain header
         // All outgoing domain messages have the domain header
-        domain_message_header =
-            std::make_unique<IPC::DomainMessageHeader>(rp.PopRaw<IPC::DomainMessageHeader>());
+        domain_message_header.emplace(rp.PopRaw<IPC::DomainMessageHeader>());
+
+        if (incoming && domain_message_header->command ==
+                            IPC::DomainMessageHeader::CommandType::CloseVirtualHandle) {
+            // Closing a virtual handle has no data payload, only the object id in the header
+            data_payload_offset = rp.GetCurrentOffset();
+            return;
+        }
     }
 
-    data_payload_header =
-        std::make_unique<IPC::DataPayloadHeader>(rp.PopRaw<IPC::DataPayloadHeader>());
+    data_payload_header.emplace(rp.PopRaw<IPC::DataPayloadHeader>());
 
     if (incoming) {
         ASSERT(data_payload_header->magic == Common::MakeMagic('S', 'F', 'C', 'I'));
@@ -116,12 +270,18 @@ void HLERequestContext::ParseCommandBuffer(u32_le* src_cmdbuf, bool incoming) {
 ResultCode HLERequestContext::PopulateFromIncomingCommandBuffer(u32_le* src_cmdbuf,
                                                                 Process& src_process,
                                                                 HandleTable& src_table) {
-    ParseCommandBuffer(src_cmdbuf, true);
+    ParseCommandBuffer(src_cmdbuf, true, src_table);
     if (command_header->type == IPC::CommandType::Close) {
         // Close does not populate the rest of the IPC header
         return RESULT_SUCCESS;
     }
 
+    if (!data_payload_header) {
+        // Closing a virtual handle only has the headers
+        std::copy_n(src_cmdbuf, data_payload_offset, cmd_buf.begin());
+        return RESULT_SUCCESS;
+    }
+
     // The data_size already includes the payload header, the padding and the domain header.
     size_t size = data_payload_offset + command_header->data_size -
                   sizeof(IPC::DataPayloadHeader) / sizeof(u32) - 4;
@@ -135,7 +295,7 @@ ResultCode HLERequestContext::WriteToOutgoingCommandBuffer(u32_le* dst_cmdbuf, P
                                                            HandleTable& dst_table) {
     // The header was already built in the internal command buffer. Attempt to parse it to verify
     // the integrity and then copy it over to the target command buffer.
-    ParseCommandBuffer(cmd_buf.data(), false);
+    ParseCommandBuffer(cmd_buf.data(), false, dst_table);
 
     // The data_size already includes the payload header, the padding and the domain header.
     size_t size = data_payload_offset + command_header->data_size -
@@ -162,12 +322,12 @@ ResultCode HLERequestContext::WriteToOutgoingCommandBuffer(u32_le* dst_cmdbuf, P
         // for specific values in each of these descriptors.
         for (auto& object : copy_objects) {
             ASSERT(object != nullptr);
-            dst_cmdbuf[current_offset++] = Kernel::g_handle_table.Create(object).Unwrap();
+            dst_cmdbuf[current_offset++] = dst_table.Create(object).Unwrap();
         }
 
         for (auto& object : move_objects) {
             ASSERT(object != nullptr);
-            dst_cmdbuf[current_offset++] = Kernel::g_handle_table.Create(object).Unwrap();
+            dst_cmdbuf[current_offset++] = dst_table.Create(object).Unwrap();
         }
     }
 
@@ -178,11 +338,8 @@ ResultCode HLERequestContext::WriteToOutgoingCommandBuffer(u32_le* dst_cmdbuf, P
         // Write the domain objects to the command buffer, these go after the raw untranslated data.
         // TODO(Subv): This completely ignores C buffers.
         size_t domain_offset = size - domain_message_header->num_objects;
-        auto& request_handlers = domain->request_handlers;
-
         for (auto& object : domain_objects) {
-            request_handlers.emplace_back(object);
-            dst_cmdbuf[domain_offset++] = request_handlers.size();
+            dst_cmdbuf[domain_offset++] = domain->AddObject(std::move(object));
         }
     }
     return RESULT_SUCCESS;
@@ -5,9 +5,12 @@
 #pragma once
 
 #include <array>
+#include <functional>
 #include <memory>
 #include <vector>
 #include <boost/container/small_vector.hpp>
+#include <boost/container/static_vector.hpp>
+#include <boost/optional.hpp>
 #include "common/common_types.h"
 #include "common/swap.h"
 #include "core/hle/ipc.h"
@@ -65,6 +68,55 @@ protected:
     std::vector<SharedPtr<ServerSession>> connected_sessions;
 };
 
+/**
+ * Bounds-checked view of a guest buffer referenced by an IPC buffer descriptor. When the buffer is
+ * backed by a single contiguous run of host memory, services can access it in place through Data();
+ * otherwise Read() and Write() transparently fall back to copying through the Memory block
+ * functions.
+ */
+class GuestView {
+public:
+    GuestView(VAddr address, size_t size);
+
+    VAddr Address() const {
+        return address;
+    }
+
+    size_t Size() const {
+        return size;
+    }
+
+    /// Returns true if the whole buffer can be accessed in place through Data().
+    bool IsContiguous() const {
+        return data != nullptr;
+    }
+
+    /// Returns a host pointer to the start of the buffer, or nullptr if it is not contiguous.
+    u8* Data() const {
+        return data;
+    }
+
+    /// Copies `length` bytes starting at `offset` in the buffer into `dest`.
+    void Read(size_t offset, void* dest, size_t length) const;
+
+    /// Copies `length` bytes from `src` into the buffer, starting at `offset`.
+    void Write(size_t offset, const void* src, size_t length) const;
+
+    /// Returns a copy of the whole buffer.
+    std::vector<u8> ReadAll() const;
+
+    /**
+     * Writes as much of `src` as fits into the buffer, starting at its beginning.
+     * @returns the number of bytes written.
+     */
+    size_t WriteAll(const std::vector<u8>& src) const;
+
+private:
+    VAddr address;
+    size_t size;
+    u8* data = nullptr;
+};
+
 /**
  * Class containing information about an in-flight IPC request being handled by an HLE service
  * implementation. Services should avoid using old global APIs (e.g. Kernel::GetCommandBuffer()) and
@@ -86,10 +138,46 @@ protected:
  */
 class HLERequestContext {
 public:
-    HLERequestContext(SharedPtr<Kernel::Domain> domain);
-    HLERequestContext(SharedPtr<Kernel::ServerSession> session);
+    /// Maximum number of buffer descriptors of each type, limited by the command header bitfields
+    static constexpr size_t MAX_BUFFER_DESCRIPTORS = 15;
+
+    template <typename T>
+    using DescriptorList = boost::container::static_vector<T, MAX_BUFFER_DESCRIPTORS>;
+
+    /// Number of scratch buffers available to services, see ScratchBuffer()
+    static constexpr size_t NUM_SCRATCH_BUFFERS = 2;
+
+    /// Slow part of an asynchronous request, run on a host worker thread without the HLE lock
+    using AsyncWork = std::function<void()>;
+    /// Runs on the emu thread once the work is done, and builds the response to the request
+    using AsyncCompletion = std::function<void(HLERequestContext& ctx)>;
+    /// Called from any host thread once the event an asynchronous request waits for happened
+    using AsyncSignal = std::function<void()>;
+    /// Starts waiting for an event outside of the emulator, and hands the signal to its source
+    using AsyncWait = std::function<void(AsyncSignal signal)>;
+
+    /**
+     * The context only borrows the session or domain the request was made through, which must
+     * outlive the request. This way, a context kept by its session for reuse doesn't keep the
+     * session alive, and requests don't need to add a reference.
+     */
+    HLERequestContext(Kernel::Domain* domain);
+    HLERequestContext(Kernel::ServerSession* session);
     ~HLERequestContext();
 
+    /// Prepares a context kept by a session for a new request made through that session.
+    void Reset(Kernel::ServerSession* session);
+
+    /// Prepares a context kept by a domain for a new request made through that domain.
+    void Reset(Kernel::Domain* domain);
+
+    /**
+     * Releases everything referenced by the finished request, so that the context can be kept
+     * around for the next request. The storage of the scratch buffers is kept as well, so a reused
+     * context doesn't need to allocate again.
+     */
+    void Clear();
+
     /// Returns a pointer to the IPC command buffer for this request.
     u32* CommandBuffer() {
         return cmd_buf.data();
@@ -98,19 +186,18 @@ public:
     /**
      * Returns the domain through which this request was made.
      */
-    const SharedPtr<Kernel::Domain>& Domain() const {
-        return domain;
-    }
+    SharedPtr<Kernel::Domain> Domain() const;
 
     /**
      * Returns the session through which this request was made. This can be used as a map key to
      * access per-client data on services.
      */
-    const SharedPtr<Kernel::ServerSession>& ServerSession() const {
+    SharedPtr<Kernel::ServerSession> ServerSession() const {
         return server_session;
     }
 
-    void ParseCommandBuffer(u32_le* src_cmdbuf, bool incoming);
+    /// Parses a command buffer, looking up the handles of an incoming one in handle_table.
+    void ParseCommandBuffer(u32_le* src_cmdbuf, bool incoming, HandleTable& handle_table);
 
     /// Populates this context with data from the requesting process/thread.
     ResultCode PopulateFromIncomingCommandBuffer(u32_le* src_cmdbuf, Process& src_process,
@@ -131,19 +218,31 @@ public:
         return data_payload_offset;
     }
 
-    const std::vector<IPC::BufferDescriptorX>& BufferDescriptorX() const {
+    const DescriptorList<IPC::BufferDescriptorX>& BufferDescriptorX() const {
         return buffer_x_desciptors;
     }
 
-    const std::vector<IPC::BufferDescriptorABW>& BufferDescriptorA() const {
+    const DescriptorList<IPC::BufferDescriptorABW>& BufferDescriptorA() const {
         return buffer_a_desciptors;
     }
 
-    const std::vector<IPC::BufferDescriptorABW>& BufferDescriptorB() const {
+    const DescriptorList<IPC::BufferDescriptorABW>& BufferDescriptorB() const {
         return buffer_b_desciptors;
     }
 
-    const std::unique_ptr<IPC::DomainMessageHeader>& GetDomainMessageHeader() const {
+    /// Returns the total size of the buffers the request passes through buffer descriptors
+    u64 GetBufferDescriptorBytes() const;
+
+    /// Returns a view of the guest memory referenced by the given X buffer descriptor.
+    GuestView BufferViewX(size_t index = 0) const;
+
+    /// Returns a view of the guest memory referenced by the given A buffer descriptor.
+    GuestView BufferViewA(size_t index = 0) const;
+
+    /// Returns a view of the guest memory referenced by the given B buffer descriptor.
+    GuestView BufferViewB(size_t index = 0) const;
+
+    const boost::optional<IPC::DomainMessageHeader>& GetDomainMessageHeader() const {
         return domain_message_header;
     }
 
@@ -175,23 +274,86 @@ public:
         domain_objects.emplace_back(std::move(object));
     }
 
+    /// Returns the objects moved to the client by the response, before it is written back
+    const boost::container::small_vector<SharedPtr<Object>, 8>& MoveObjects() const {
+        return move_objects;
+    }
+
+    /// Returns the objects added to the client's domain by the response, before it is written back
+    const boost::container::small_vector<std::shared_ptr<SessionRequestHandler>, 8>&
+    DomainObjects() const {
+        return domain_objects;
+    }
+
+    /**
+     * Returns a temporary buffer for the service to use while handling this request, e.g. to hold
+     * the contents of a guest buffer. Its contents are discarded when the request completes.
+     * @param index Index of the buffer, less than NUM_SCRATCH_BUFFERS.
+     * @param size Size the buffer is resized to, new bytes are zero-initialized.
+     */
+    std::vector<u8>& ScratchBuffer(size_t index, size_t size);
+
+    /**
+     * Finishes this request asynchronously instead of building the response right away. The
+     * client thread waits while `work` runs on a host worker thread, so that other guest threads
+     * keep running. The work must not touch kernel objects, guest memory or other state guarded by
+     * the HLE lock; it should operate on data captured by the handler. Once it is done,
+     * `completion` runs on the emu thread with this context to build the response.
+     */
+    void RunAsync(AsyncWork work, AsyncCompletion completion);
+
+    /**
+     * Finishes this request once an event outside of the emulator happened, like a host socket
+     * becoming ready. Unlike RunAsync, no host thread is blocked meanwhile: `wait` runs on the emu
+     * thread once the client thread waits, and hands the signal over to whatever sees the event
+     * happen, which calls it from its own thread. `completion` then runs on the emu thread with
+     * this context to build the response. Anything the signalling thread produces for the
+     * response must be captured by both, the guest memory is only accessed by the completion.
+     */
+    void WaitAsync(AsyncWait wait, AsyncCompletion completion);
+
+    /// Returns whether the handler deferred the response of this request with RunAsync or WaitAsync
+    bool IsAsync() const {
+        return async_completion != nullptr;
+    }
+
+    /// Hands the work of an asynchronous request over to the thread that is going to run it
+    AsyncWork TakeAsyncWork() {
+        return std::move(async_work);
+    }
+
+    /// Hands the wait of an asynchronous request over to the code submitting it
+    AsyncWait TakeAsyncWait() {
+        return std::move(async_wait);
+    }
+
+    /// Builds the response of an asynchronous request whose work is done
+    void CompleteAsync();
+
 private:
     std::array<u32, IPC::COMMAND_BUFFER_LENGTH> cmd_buf;
-    SharedPtr<Kernel::Domain> domain;
-    SharedPtr<Kernel::ServerSession> server_session;
+    Kernel::Domain* domain = nullptr;
+    Kernel::ServerSession* server_session = nullptr;
     // TODO(yuriks): Check common usage of this and optimize size accordingly
     boost::container::small_vector<SharedPtr<Object>, 8> move_objects;
     boost::container::small_vector<SharedPtr<Object>, 8> copy_objects;
     boost::container::small_vector<std::shared_ptr<SessionRequestHandler>, 8> domain_objects;
 
-    std::unique_ptr<IPC::CommandHeader> command_header;
-    std::unique_ptr<IPC::HandleDescriptorHeader> handle_descriptor_header;
-    std::unique_ptr<IPC::DataPayloadHeader> data_payload_header;
-    std::unique_ptr<IPC::DomainMessageHeader> domain_message_header;
-    std::vector<IPC::BufferDescriptorX> buffer_x_desciptors;
-    std::vector<IPC::BufferDescriptorABW> buffer_a_desciptors;
-    std::vector<IPC::BufferDescriptorABW> buffer_b_desciptors;
-    std::vector<IPC::BufferDescriptorABW> buffer_w_desciptors;
+    // Stored inline, so that parsing a request doesn't allocate
+    boost::optional<IPC::CommandHeader> command_header;
+    boost::optional<IPC::HandleDescriptorHeader> handle_descriptor_header;
+    boost::optional<IPC::DataPayloadHeader> data_payload_header;
+    boost::optional<IPC::DomainMessageHeader> domain_message_header;
+    DescriptorList<IPC::BufferDescriptorX> buffer_x_desciptors;
+    DescriptorList<IPC::BufferDescriptorABW> buffer_a_desciptors;
+    DescriptorList<IPC::BufferDescriptorABW> buffer_b_desciptors;
+    DescriptorList<IPC::BufferDescriptorABW> buffer_w_desciptors;
+
+    std::array<std::vector<u8>, NUM_SCRATCH_BUFFERS> scratch_buffers;
+
+    AsyncWork async_work;
+    AsyncWait async_wait;
+    AsyncCompletion async_completion;
 
     unsigned data_payload_offset{};
     u32_le command{};
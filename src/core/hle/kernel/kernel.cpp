@@ -3,13 +3,20 @@
 // Refer to the license.txt file included.
 
 #include "core/hle/config_mem.h"
+#include "core/hle/kernel/async_request.h"
+#include "core/hle/kernel/client_session.h"
+#include "core/hle/kernel/condition_variable.h"
+#include "core/hle/kernel/event.h"
 #include "core/hle/kernel/handle_table.h"
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/kernel/memory.h"
+#include "core/hle/kernel/mutex.h"
 #include "core/hle/kernel/object_address_table.h"
 #include "core/hle/kernel/process.h"
 #include "core/hle/kernel/resource_limit.h"
+#include "core/hle/kernel/server_session.h"
 #include "core/hle/kernel/thread.h"
+#include "core/hle/kernel/timeout_queue.h"
 #include "core/hle/kernel/timer.h"
 #include "core/hle/shared_page.h"
 
@@ -17,6 +24,30 @@ namespace Kernel {
 
 unsigned int Object::next_object_id;
 
+/// Number of slab heap slots for each session type, sessions aren't covered by resource limits
+constexpr size_t NUM_SESSION_SLOTS = 0x200;
+
+/// Returns the sum of the given resource's limit over all resource limit categories
+static size_t GetTotalResourceLimit(u32 resource) {
+    size_t total = 0;
+    for (auto category : {ResourceLimitCategory::APPLICATION, ResourceLimitCategory::SYS_APPLET,
+                          ResourceLimitCategory::LIB_APPLET, ResourceLimitCategory::OTHER}) {
+        total += ResourceLimit::GetForCategory(category)->GetMaxResourceValue(resource);
+    }
+    return total;
+}
+
+/// Sizes the slab heaps of the pooled kernel object types after the resource limits
+static void InitializeSlabHeaps() {
+    Thread::GetSlabHeap().Initialize(GetTotalResourceLimit(THREAD));
+    Event::GetSlabHeap().Initialize(GetTotalResourceLimit(EVENT));
+    Timer::GetSlabHeap().Initialize(GetTotalResourceLimit(TIMER));
+    Mutex::GetSlabHeap().Initialize(GetTotalResourceLimit(MUTEX));
+    ConditionVariable::GetSlabHeap().Initialize(GetTotalResourceLimit(MUTEX));
+    ServerSession::GetSlabHeap().Initialize(NUM_SESSION_SLOTS);
+    ClientSession::GetSlabHeap().Initialize(NUM_SESSION_SLOTS);
+}
+
 /// Initialize the kernel
 void Init(u32 system_mode) {
     ConfigMem::Init();
@@ -25,8 +56,11 @@ void Init(u32 system_mode) {
     Kernel::MemoryInit(system_mode);
 
     Kernel::ResourceLimitsInit();
+    InitializeSlabHeaps();
+    Kernel::TimeoutsInit();
     Kernel::ThreadingInit();
     Kernel::TimersInit();
+    Kernel::AsyncRequestsInit();
 
     Object::next_object_id = 0;
     // TODO(Subv): Start the process ids from 10 for now, as lower PIDs are
@@ -36,14 +70,20 @@ void Init(u32 system_mode) {
 
 /// Shutdown the kernel
 void Shutdown() {
+    // Let the running asynchronous requests finish before freeing what they may refer to
+    Kernel::AsyncRequestsShutdown();
+
     // Free all kernel objects
-    g_handle_table.Clear();
+    for (const SharedPtr<Process>& process : GetProcessList()) {
+        process->handle_table.Clear();
+    }
     g_object_address_table.Clear();
 
     Kernel::ThreadingShutdown();
     g_current_process = nullptr;
 
     Kernel::TimersShutdown();
+    Kernel::TimeoutsShutdown();
     Kernel::ResourceLimitsShutdown();
     Kernel::MemoryShutdown();
 }
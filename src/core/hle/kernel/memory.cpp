@@ -11,6 +11,7 @@
 #include "common/assert.h"
 #include "common/common_types.h"
 #include "common/logging/log.h"
+#include "common/memory_util.h"
 #include "core/hle/config_mem.h"
 #include "core/hle/kernel/memory.h"
 #include "core/hle/kernel/vm_manager.h"
@@ -57,6 +58,10 @@ void MemoryInit(u32 mem_type) {
         // Reserve enough space for this region of FCRAM.
         // We do not want this block of memory to be relocated when allocating from it.
         memory_regions[i].linear_heap_memory->reserve(memory_regions[i].size);
+        const size_t huge_size = AdviseHugePages(memory_regions[i].linear_heap_memory->data(),
+                                                 memory_regions[i].size);
+        LOG_DEBUG(Kernel, "%zu of %zu KiB of memory region %d can use huge pages",
+                  huge_size / 1024, static_cast<size_t>(memory_regions[i].size / 1024), i);
 
         base += memory_regions[i].size;
     }
@@ -11,6 +11,7 @@
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/kernel/mutex.h"
 #include "core/hle/kernel/object_address_table.h"
+#include "core/hle/kernel/process.h"
 #include "core/hle/kernel/thread.h"
 
 namespace Kernel {
@@ -73,6 +74,12 @@ ResultCode Mutex::Release(Thread* thread) {
     WakeupAllWaitingThreads();
     Core::System::GetInstance().PrepareReschedule();
 
+    // All the state of a free mutex without waiters is in guest memory, so stop tracking it until
+    // it is contended again. The caller still holds a reference to it.
+    if (!GetHoldingThread() && !HasWaitingThreads()) {
+        g_object_address_table.Close(guest_addr);
+    }
+
     return RESULT_SUCCESS;
 }
 
@@ -87,7 +94,7 @@ void Mutex::RemoveWaitingThread(Thread* thread) {
     WaitObject::RemoveWaitingThread(thread);
     thread->pending_mutexes.erase(this);
     if (!GetHasWaiters())
-        SetHasWaiters(!GetWaitingThreads().empty());
+        SetHasWaiters(HasWaitingThreads());
     UpdatePriority();
 }
 
@@ -95,11 +102,10 @@ void Mutex::UpdatePriority() {
     if (!GetHoldingThread())
         return;
 
+    // The waiting threads are sorted by priority, the first one has the best.
     u32 best_priority = THREADPRIO_LOWEST;
-    for (auto& waiter : GetWaitingThreads()) {
-        if (waiter->current_priority < best_priority)
-            best_priority = waiter->current_priority;
-    }
+    if (const Thread* waiter = GetHighestPriorityWaitingThread())
+        best_priority = waiter->current_priority;
 
     if (best_priority != priority) {
         priority = best_priority;
@@ -108,13 +114,30 @@ void Mutex::UpdatePriority() {
 }
 
 Handle Mutex::GetOwnerHandle() const {
+    return ReadOwnerHandle(guest_addr);
+}
+
+Handle Mutex::ReadOwnerHandle(VAddr guest_addr) {
     GuestState guest_state{Memory::Read32(guest_addr)};
     return guest_state.holding_thread_handle;
 }
 
+bool Mutex::ReleaseUncontended(VAddr guest_addr, Thread* thread) {
+    if (g_object_address_table.Find(guest_addr) != nullptr) {
+        return false;
+    }
+
+    // We can only release the mutex if it's held by the calling thread.
+    ASSERT(ReadOwnerHandle(guest_addr) == thread->guest_handle);
+
+    // Clears both the holder and the has_waiters bit, there's nobody left to wake up
+    Memory::Write32(guest_addr, 0);
+    return true;
+}
+
 SharedPtr<Thread> Mutex::GetHoldingThread() const {
     GuestState guest_state{Memory::Read32(guest_addr)};
-    return g_handle_table.Get<Thread>(guest_state.holding_thread_handle);
+    return g_current_process->handle_table.Get<Thread>(guest_state.holding_thread_handle);
 }
 
 void Mutex::SetHoldingThread(SharedPtr<Thread> thread) {
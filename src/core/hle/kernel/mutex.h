@@ -8,6 +8,7 @@
 #include "common/common_types.h"
 #include "common/swap.h"
 #include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/slab_heap.h"
 #include "core/hle/kernel/wait_object.h"
 #include "core/hle/result.h"
 
@@ -15,7 +16,7 @@ namespace Kernel {
 
 class Thread;
 
-class Mutex final : public WaitObject {
+class Mutex final : public WaitObject, public SlabAllocated<Mutex> {
 public:
     /**
      * Creates a mutex.
@@ -67,6 +68,18 @@ public:
     /// Gets the handle to the holding process stored in the guest state.
     Handle GetOwnerHandle() const;
 
+    /// Gets the handle of the thread holding the guest mutex at the specified address.
+    static Handle ReadOwnerHandle(VAddr guest_addr);
+
+    /**
+     * Fast path for releasing a guest mutex that no kernel Mutex tracks, which means no thread is
+     * waiting for it in the kernel. Only the guest mutex state is updated.
+     * @param guest_addr Address of the guest mutex.
+     * @param thread Thread holding the mutex.
+     * @returns True if the mutex was released, false if its kernel Mutex has to release it.
+     */
+    static bool ReleaseUncontended(VAddr guest_addr, Thread* thread);
+
     /// Gets the Thread pointed to by the owner handle
     SharedPtr<Thread> GetHoldingThread() const;
     /// Sets the holding process handle in the guest state.
@@ -2,6 +2,7 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <utility>
 #include "common/assert.h"
 #include "core/hle/kernel/object_address_table.h"
 
@@ -9,26 +10,93 @@ namespace Kernel {
 
 ObjectAddressTable g_object_address_table;
 
+/// Hashes a guest address. Synchronization primitives are at least 4-byte aligned, and are often
+/// laid out with a fixed stride, so the higher bits are folded in as well.
+static size_t HashAddress(VAddr addr) {
+    const u64 key = addr >> 2;
+    return static_cast<size_t>(key ^ (key >> 8) ^ (key >> 16));
+}
+
+ObjectAddressTable::ObjectAddressTable() : entries(INITIAL_CAPACITY) {}
+
+const ObjectAddressTable::Entry* ObjectAddressTable::FindEntry(VAddr addr) const {
+    const size_t mask = entries.size() - 1;
+    for (size_t index = HashAddress(addr) & mask;; index = (index + 1) & mask) {
+        const Entry& entry = entries[index];
+        if (entry.object == nullptr) {
+            return nullptr;
+        }
+        if (entry.addr == addr) {
+            return &entry;
+        }
+    }
+}
+
+void ObjectAddressTable::Grow() {
+    std::vector<Entry> old_entries(entries.size() * 2);
+    entries.swap(old_entries);
+
+    const size_t mask = entries.size() - 1;
+    for (Entry& old_entry : old_entries) {
+        if (old_entry.object == nullptr) {
+            continue;
+        }
+        size_t index = HashAddress(old_entry.addr) & mask;
+        while (entries[index].object != nullptr) {
+            index = (index + 1) & mask;
+        }
+        entries[index] = std::move(old_entry);
+    }
+}
+
 void ObjectAddressTable::Insert(VAddr addr, SharedPtr<Object> obj) {
-    ASSERT_MSG(objects.find(addr) == objects.end(), "Object already exists with addr=0x%llx", addr);
-    objects[addr] = obj;
+    ASSERT_MSG(Find(addr) == nullptr, "Object already exists with addr=0x%llx", addr);
+    if ((num_objects + 1) * 2 > entries.size()) {
+        Grow();
+    }
+
+    const size_t mask = entries.size() - 1;
+    size_t index = HashAddress(addr) & mask;
+    while (entries[index].object != nullptr) {
+        index = (index + 1) & mask;
+    }
+    const HandleType type = obj->GetHandleType();
+    entries[index] = {addr, type, std::move(obj)};
+    ++num_objects;
 }
 
 void ObjectAddressTable::Close(VAddr addr) {
-    ASSERT_MSG(objects.find(addr) != objects.end(), "Object does not exist with addr=0x%llx", addr);
-    objects.erase(addr);
+    const Entry* entry = FindEntry(addr);
+    ASSERT_MSG(entry != nullptr, "Object does not exist with addr=0x%llx", addr);
+
+    // Move the following entries of the probe sequence into the hole when it is between their
+    // home slot and them, so that no lookup stops at the hole before reaching them.
+    const size_t mask = entries.size() - 1;
+    size_t hole = static_cast<size_t>(entry - entries.data());
+    for (size_t index = (hole + 1) & mask; entries[index].object != nullptr;
+         index = (index + 1) & mask) {
+        const size_t home = HashAddress(entries[index].addr) & mask;
+        if (((index - home) & mask) >= ((index - hole) & mask)) {
+            entries[hole] = std::move(entries[index]);
+            hole = index;
+        }
+    }
+    entries[hole].object = nullptr;
+    --num_objects;
+}
+
+Object* ObjectAddressTable::Find(VAddr addr) const {
+    const Entry* entry = FindEntry(addr);
+    return entry != nullptr ? entry->object.get() : nullptr;
 }
 
 SharedPtr<Object> ObjectAddressTable::GetGeneric(VAddr addr) const {
-    auto iter = objects.find(addr);
-    if (iter != objects.end()) {
-        return iter->second;
-    }
-    return {};
+    return SharedPtr<Object>(Find(addr));
 }
 
 void ObjectAddressTable::Clear() {
-    objects.clear();
+    entries.assign(INITIAL_CAPACITY, {});
+    num_objects = 0;
 }
 
 } // namespace Kernel
@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <map>
+#include <vector>
 #include "common/common_types.h"
 #include "core/hle/kernel/kernel.h"
 
@@ -15,10 +15,14 @@ namespace Kernel {
  * memory. For certain Switch SVCs, Kernel objects are referenced by an address to an object the
  * guest application manages, so we use this table to look these kernel objects up. This is similiar
  * to the HandleTable class.
+ *
+ * The objects are kept in an open addressing hash table with linear probing, which is kept at most
+ * half full. Removals shift the following entries of the probe sequence back instead of leaving
+ * tombstones, so lookups never scan more than the entries colliding with the address.
  */
 class ObjectAddressTable final : NonCopyable {
 public:
-    ObjectAddressTable() = default;
+    ObjectAddressTable();
 
     /**
      * Inserts an object and address pair into the table.
@@ -40,21 +44,50 @@ public:
     SharedPtr<Object> GetGeneric(VAddr addr) const;
 
     /**
-     * Looks up an object by its address while verifying its type.
+     * Looks up an object by its address while verifying its type, against the type stored along
+     * with the object rather than through a virtual call.
      * @return Pointer to the looked-up object, or `nullptr` if the handle is not valid or its
      *         type differs from the requested one.
      */
     template <class T>
     SharedPtr<T> Get(VAddr addr) const {
-        return DynamicObjectCast<T>(GetGeneric(addr));
+        const Entry* entry = FindEntry(addr);
+        if (entry == nullptr || entry->type != T::HANDLE_TYPE) {
+            return nullptr;
+        }
+        return SharedPtr<T>(static_cast<T*>(entry->object.get()));
     }
 
+    /**
+     * Looks up an object by its address without taking a reference to it.
+     * @return Pointer to the looked-up object, or `nullptr` if there is no object at the address.
+     */
+    Object* Find(VAddr addr) const;
+
     /// Closes all addresses held in this table.
     void Clear();
 
 private:
-    /// Stores the Object referenced by the address
-    std::map<VAddr, SharedPtr<Object>> objects;
+    /// Number of entries the table starts with, always a power of two
+    static constexpr size_t INITIAL_CAPACITY = 64;
+
+    /// An entry is empty if it has no object
+    struct Entry {
+        VAddr addr;
+        HandleType type;
+        SharedPtr<Object> object;
+    };
+
+    /// Returns the entry of the object at the given address, nullptr if there is none
+    const Entry* FindEntry(VAddr addr) const;
+
+    /// Doubles the number of entries, reinserting the objects
+    void Grow();
+
+    /// Stores the Objects referenced by the addresses, hashed by address
+    std::vector<Entry> entries;
+    /// Number of entries holding an object
+    size_t num_objects = 0;
 };
 
 extern ObjectAddressTable g_object_address_table;
@@ -6,7 +6,11 @@
 #include <memory>
 #include "common/assert.h"
 #include "common/common_funcs.h"
+#include "common/file_util.h"
 #include "common/logging/log.h"
+#include "common/memory_util.h"
+#include "core/arm/arm_interface.h"
+#include "core/core.h"
 #include "core/hle/kernel/errors.h"
 #include "core/hle/kernel/memory.h"
 #include "core/hle/kernel/process.h"
@@ -14,6 +18,8 @@
 #include "core/hle/kernel/thread.h"
 #include "core/hle/kernel/vm_manager.h"
 #include "core/memory.h"
+#include "core/memory_compactor.h"
+#include "core/settings.h"
 
 namespace Kernel {
 
@@ -46,6 +52,29 @@ SharedPtr<Process> Process::Create(std::string&& name) {
     return process;
 }
 
+bool Process::ReserveResource(u32 resource, s32 count) {
+    std::atomic<s32>& usage = resource_usage[resource];
+    if (resource_limit == nullptr) {
+        usage.fetch_add(count, std::memory_order_relaxed);
+        return true;
+    }
+
+    const s64 max_value = resource_limit->GetMaxResourceValue(resource);
+    s32 current = usage.load(std::memory_order_relaxed);
+    do {
+        if (current + count > max_value) {
+            return false;
+        }
+    } while (!usage.compare_exchange_weak(current, current + count, std::memory_order_relaxed));
+    return true;
+}
+
+void Process::ReleaseResource(u32 resource, s32 count) {
+    const s32 previous = resource_usage[resource].fetch_sub(count, std::memory_order_relaxed);
+    DEBUG_ASSERT_MSG(previous >= count, "Released more resources of type %u than reserved",
+                     resource);
+}
+
 void Process::ParseKernelCaps(const u32* kernel_caps, size_t len) {
     for (size_t i = 0; i < len; ++i) {
         u32 descriptor = kernel_caps[i];
@@ -140,16 +169,27 @@ void Process::Run(VAddr entry_point, s32 main_thread_priority, u32 stack_size) {
     Kernel::SetupMainThread(entry_point, main_thread_priority, this);
 }
 
+/// Drops the translations of written code from the JIT caches of every emulated CPU core
+static void InvalidateCodeOnCpuCores(VAddr addr, u64 size) {
+    auto& system = Core::System::GetInstance();
+    for (size_t core = 0; core < system.NumCpuCores(); ++core) {
+        system.ArmInterface(core).InvalidateCacheRange(addr, static_cast<size_t>(size));
+    }
+}
+
 void Process::LoadModule(SharedPtr<CodeSet> module_, VAddr base_addr) {
     memory_region = GetMemoryRegion(flags.memory_region);
 
     auto MapSegment = [&](CodeSet::Segment& segment, VMAPermission permissions,
                           MemoryState memory_state) {
-        auto vma = vm_manager
-                       .MapMemoryBlock(segment.addr + base_addr, module_->memory, segment.offset,
-                                       segment.size, memory_state)
-                       .Unwrap();
-        vm_manager.Reprotect(vma, permissions);
+        const VAddr addr = segment.addr + base_addr;
+        const bool is_shared = module_->shared_image && permissions != VMAPermission::ReadWrite;
+        auto vma = is_shared ? vm_manager.MapBackingMemory(
+                                   addr, module_->shared_image->WritableData() + segment.offset,
+                                   segment.size, memory_state)
+                             : vm_manager.MapMemoryBlock(addr, module_->memory, segment.offset,
+                                                         segment.size, memory_state);
+        vm_manager.Reprotect(vma.Unwrap(), permissions);
         misc_memory_used += segment.size;
         memory_region->used += segment.size;
     };
@@ -158,6 +198,15 @@ void Process::LoadModule(SharedPtr<CodeSet> module_, VAddr base_addr) {
     MapSegment(module_->code, VMAPermission::ReadExecute, MemoryState::Code);
     MapSegment(module_->rodata, VMAPermission::Read, MemoryState::Static);
     MapSegment(module_->data, VMAPermission::ReadWrite, MemoryState::Static);
+
+    if (module_->shared_image) {
+        shared_module_images.push_back(module_->shared_image);
+    }
+
+    if (Settings::values.use_code_write_detection) {
+        code_write_trackers.push_back(std::make_unique<Memory::DirtyPageTracker>(
+            *this, module_->code.addr + base_addr, module_->code.size, InvalidateCodeOnCpuCores));
+    }
 }
 
 VAddr Process::GetLinearHeapAreaAddress() const {
@@ -181,21 +230,36 @@ ResultVal<VAddr> Process::HeapAllocate(VAddr target, u64 size, VMAPermission per
     }
 
     if (heap_memory == nullptr) {
-        // Initialize heap
+        // Initialize heap. Reserving space for the whole heap region keeps the block at the same
+        // host address while it grows, so growing it only has to clear the new memory. The host
+        // only backs the reserved pages with memory once they are touched.
         heap_memory = std::make_shared<std::vector<u8>>();
+        heap_memory->reserve(Memory::HEAP_SIZE);
         heap_start = heap_end = target;
+
+        const size_t huge_size = AdviseHugePages(heap_memory->data(), heap_memory->capacity());
+        LOG_INFO(Kernel, "%zu of %zu KiB of heap backing memory can use huge pages",
+                 huge_size / 1024, heap_memory->capacity() / 1024);
     }
 
     // If necessary, expand backing vector to cover new heap extents.
     if (target < heap_start) {
+        // Compacted chunks are decompressed to where they were in the block
+        if (memory_compactor) {
+            memory_compactor->RestoreAll();
+        }
         heap_memory->insert(begin(*heap_memory), heap_start - target, 0);
         heap_start = target;
         vm_manager.RefreshMemoryBlockMappings(heap_memory.get());
     }
     if (target + size > heap_end) {
+        const u8* const old_data = heap_memory->data();
         heap_memory->insert(end(*heap_memory), (target + size) - heap_end, 0);
         heap_end = target + size;
-        vm_manager.RefreshMemoryBlockMappings(heap_memory.get());
+        // The existing mappings stay valid as long as the block wasn't relocated
+        if (heap_memory->data() != old_data) {
+            vm_manager.RefreshMemoryBlockMappings(heap_memory.get());
+        }
     }
     ASSERT(heap_end - heap_start == heap_memory->size());
 
@@ -310,6 +374,10 @@ void ClearProcessList() {
     process_list.clear();
 }
 
+const std::vector<SharedPtr<Process>>& GetProcessList() {
+    return process_list;
+}
+
 SharedPtr<Process> GetProcessById(u32 process_id) {
     auto itr = std::find_if(
         process_list.begin(), process_list.end(),
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <bitset>
 #include <cstddef>
 #include <memory>
@@ -12,10 +14,21 @@
 #include <boost/container/static_vector.hpp>
 #include "common/bit_field.h"
 #include "common/common_types.h"
+#include "core/hle/kernel/handle_table.h"
 #include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/resource_limit.h"
 #include "core/hle/kernel/thread.h"
+#include "core/hle/kernel/tls_slot_allocator.h"
 #include "core/hle/kernel/vm_manager.h"
 
+namespace FileUtil {
+class MappedFile;
+}
+
+namespace Memory {
+class MemoryCompactor;
+}
+
 namespace Kernel {
 
 struct AddressMapping {
@@ -52,7 +65,6 @@ union ProcessFlags {
 
 enum class ProcessStatus { Created, Running, Exited };
 
-class ResourceLimit;
 struct MemoryRegionInfo;
 
 struct CodeSet final : public Object {
@@ -77,6 +89,13 @@ struct CodeSet final : public Object {
 
     std::shared_ptr<std::vector<u8>> memory;
 
+    /**
+     * Read-only image shared by all instances of the module, that backs the code and rodata
+     * segments instead of `memory` when set. Their offsets are then offsets into this image. Its
+     * pages are copied when they are written to, so writes stay private to the process.
+     */
+    std::shared_ptr<FileUtil::MappedFile> shared_image;
+
     struct Segment {
         size_t offset = 0;
         VAddr addr = 0;
@@ -115,11 +134,28 @@ public:
 
     /// Resource limit descriptor for this process
     SharedPtr<ResourceLimit> resource_limit;
+    /// Number of objects of each resource type the process currently holds
+    std::array<std::atomic<s32>, NUM_RESOURCE_TYPES> resource_usage{};
+
+    /**
+     * Accounts for objects of a resource type the process is about to create, unless they would
+     * exceed the limit of its resource limit. The check is lock-free, so it is cheap enough to be
+     * made on every creation.
+     * @param resource Resource type of the objects.
+     * @param count Number of objects.
+     * @return Whether the objects may be created.
+     */
+    bool ReserveResource(u32 resource, s32 count = 1);
+
+    /// Gives back objects of a resource type that were accounted for by ReserveResource
+    void ReleaseResource(u32 resource, s32 count = 1);
 
     /// The process may only call SVCs which have the corresponding bit set.
     std::bitset<0x80> svc_access_mask;
     /// Maximum size of the handle table for the process.
     unsigned int handle_table_size = 0x200;
+    /// Table of the handles the threads of this process refer to kernel objects with.
+    HandleTable handle_table;
     /// Special memory ranges mapped into this processes address space. This is used to give
     /// processes access to specific I/O regions and device memory.
     boost::container::static_vector<AddressMapping, 8> address_mappings;
@@ -165,14 +201,22 @@ public:
 
     u64 heap_used = 0, linear_heap_used = 0, misc_memory_used = 0;
 
+    /// Shared images backing the code of the loaded modules, kept alive while they are mapped
+    std::vector<std::shared_ptr<FileUtil::MappedFile>> shared_module_images;
+
+    /// Watch the code of the loaded modules, to invalidate the JIT translations of written code
+    std::vector<std::unique_ptr<Memory::DirtyPageTracker>> code_write_trackers;
+
+    /// Compressed chunks of the heap, created the first time the paused emulation compacts it
+    std::shared_ptr<Memory::MemoryCompactor> memory_compactor;
+
     MemoryRegionInfo* memory_region = nullptr;
 
     /// The Thread Local Storage area is allocated as processes create threads,
     /// each TLS area is 0x200 bytes, so one page (0x1000) is split up in 8 parts, and each part
-    /// holds the TLS for a specific thread. This vector contains which parts are in use for each
-    /// page as a bitmask.
-    /// This vector will grow as more pages are allocated for new threads.
-    std::vector<std::bitset<8>> tls_slots;
+    /// holds the TLS for a specific thread. This keeps track of which parts are in use.
+    /// Pages are added as more of them are allocated for new threads.
+    TLSSlotAllocator tls_slots;
 
     std::string name;
 
@@ -197,6 +241,9 @@ private:
 
 void ClearProcessList();
 
+/// Retrieves the current list of processes.
+const std::vector<SharedPtr<Process>>& GetProcessList();
+
 /// Retrieves a process from the current list of processes.
 SharedPtr<Process> GetProcessById(u32 process_id);
 
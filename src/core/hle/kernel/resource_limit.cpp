@@ -96,7 +96,8 @@ void ResourceLimitsInit() {
     SharedPtr<ResourceLimit> resource_limit = ResourceLimit::Create("Applications");
     resource_limit->max_priority = 0x18;
     resource_limit->max_commit = 0x4000000;
-    resource_limit->max_threads = 0x20;
+    // Switch titles use many more threads than the 3DS allowed applications to
+    resource_limit->max_threads = 0x100;
     resource_limit->max_events = 0x20;
     resource_limit->max_mutexes = 0x20;
     resource_limit->max_semaphores = 0x8;
@@ -27,6 +27,7 @@ enum ResourceTypes {
     SHARED_MEMORY = 7,
     ADDRESS_ARBITER = 8,
     CPU_TIME = 9,
+    NUM_RESOURCE_TYPES,
 };
 
 class ResourceLimit final : public Object {
@@ -0,0 +1,180 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "core/arm/arm_interface.h"
+#include "core/core_timing.h"
+#include "core/hle/kernel/process.h"
+#include "core/hle/kernel/scheduler.h"
+#include "core/memory.h"
+#include "core/tracer/scheduler_trace.h"
+
+namespace Kernel {
+
+Scheduler::Scheduler(ARM_Interface& cpu_core, size_t core_index)
+    : cpu_core(cpu_core), core_index(core_index) {}
+
+Scheduler::~Scheduler() {
+    Reset();
+}
+
+bool Scheduler::HaveReadyThreads() const {
+    return ready_queue.get_first() != nullptr;
+}
+
+bool Scheduler::HaveReadyThreads(u32 priority) const {
+    const Thread* first = ready_queue.get_first();
+    return first != nullptr && first->current_priority <= priority;
+}
+
+Thread* Scheduler::GetCurrentThread() const {
+    return current_thread.get();
+}
+
+size_t Scheduler::GetLoad() const {
+    const bool running = current_thread && current_thread->status == THREADSTATUS_RUNNING;
+    return num_ready_threads + (running ? 1 : 0);
+}
+
+Thread* Scheduler::PopNextReadyThread() {
+    Thread* next = nullptr;
+    Thread* thread = GetCurrentThread();
+
+    if (thread && thread->status == THREADSTATUS_RUNNING && !thread->debug_suspended &&
+        thread->CanRunOnCore(core_index)) {
+        // We have to do better than the current thread.
+        // This call returns null when that's not possible.
+        next = ready_queue.pop_first_better(thread->current_priority);
+        if (!next) {
+            // Otherwise just keep going with the current thread
+            next = thread;
+        }
+    } else {
+        next = ready_queue.pop_first();
+    }
+
+    if (next != nullptr && next != thread) {
+        --num_ready_threads;
+    }
+    return next;
+}
+
+void Scheduler::SwitchContext(Thread* new_thread) {
+    Thread* previous_thread = GetCurrentThread();
+
+    // Keeping the running thread needs no context switch, its registers are already loaded
+    if (new_thread != nullptr && new_thread == previous_thread &&
+        new_thread->status == THREADSTATUS_RUNNING) {
+        new_thread->last_running_ticks = CoreTiming::GetTicks();
+        return;
+    }
+
+    if (SchedulerTrace::IsEnabled() && new_thread != previous_thread) {
+        SchedulerTrace::Record(SchedulerTrace::EventType::ContextSwitch,
+                               new_thread ? new_thread->GetThreadId() : 0);
+    }
+
+    // Save context for previous thread
+    if (previous_thread) {
+        previous_thread->last_running_ticks = CoreTiming::GetTicks();
+        cpu_core.SaveContext(previous_thread->context);
+        vector_thread = previous_thread;
+        vector_thread_version = ++previous_thread->context_version;
+
+        if (previous_thread->status == THREADSTATUS_RUNNING) {
+            // This is only the case when a reschedule is triggered without the current thread
+            // yielding execution (i.e. an event triggered, system core time-sliced, etc)
+            if (previous_thread->debug_suspended) {
+                // Stopped by the debugger, it is queued again when it is resumed
+                previous_thread->status = THREADSTATUS_READY;
+            } else if (previous_thread->CanRunOnCore(core_index)) {
+                ready_queue.push_front(previous_thread->current_priority, previous_thread);
+                ++num_ready_threads;
+                previous_thread->status = THREADSTATUS_READY;
+            } else {
+                // Its affinity mask changed while it was running, move it to a core it may use
+                previous_thread->ScheduleOnBestCore();
+            }
+        }
+    }
+
+    // Load context of new thread
+    if (new_thread) {
+        ASSERT_MSG(new_thread->status == THREADSTATUS_READY,
+                   "Thread must be ready to become running.");
+
+        // Cancel any outstanding wakeup events for this thread
+        new_thread->CancelWakeupTimer();
+
+        auto previous_process = Kernel::g_current_process;
+
+        current_thread = new_thread;
+
+        UnscheduleThread(new_thread, new_thread->current_priority);
+        new_thread->status = THREADSTATUS_RUNNING;
+
+        if (previous_process != current_thread->owner_process) {
+            Kernel::g_current_process = current_thread->owner_process;
+            SetCurrentPageTable(&Kernel::g_current_process->vm_manager.page_table);
+        }
+
+        // The vector registers are left alone when they still are those of the thread, i.e. when
+        // it is the last one this core switched away from and its context didn't change since
+        if (new_thread == vector_thread && new_thread->context_version == vector_thread_version) {
+            cpu_core.LoadContextExceptVectors(new_thread->context);
+        } else {
+            cpu_core.LoadContext(new_thread->context);
+        }
+        vector_thread = new_thread;
+        vector_thread_version = new_thread->context_version;
+        cpu_core.SetTlsAddress(new_thread->GetTLSAddress());
+    } else {
+        current_thread = nullptr;
+        // Note: We do not reset the current process and current page table when idling because
+        // technically we haven't changed processes, our threads are just paused.
+    }
+}
+
+void Scheduler::Reschedule() {
+    Thread* cur = GetCurrentThread();
+    Thread* next = PopNextReadyThread();
+
+    if (cur && next) {
+        LOG_TRACE(Kernel, "core %zu context switch %u -> %u", core_index, cur->GetObjectId(),
+                  next->GetObjectId());
+    } else if (cur) {
+        LOG_TRACE(Kernel, "core %zu context switch %u -> idle", core_index, cur->GetObjectId());
+    } else if (next) {
+        LOG_TRACE(Kernel, "core %zu context switch idle -> %u", core_index, next->GetObjectId());
+    }
+
+    SwitchContext(next);
+}
+
+void Scheduler::ScheduleThread(Thread* thread, u32 priority) {
+    ready_queue.push_back(priority, thread);
+    ++num_ready_threads;
+}
+
+void Scheduler::UnscheduleThread(Thread* thread, u32 priority) {
+    if (ready_queue.contains(thread) == ThreadQueue::Priority(-1)) {
+        return;
+    }
+    ready_queue.remove(priority, thread);
+    --num_ready_threads;
+}
+
+void Scheduler::SetThreadPriority(Thread* thread, u32 priority) {
+    ready_queue.move(thread, thread->current_priority, priority);
+}
+
+void Scheduler::Reset() {
+    current_thread = nullptr;
+    vector_thread = nullptr;
+    ready_queue.clear();
+    num_ready_threads = 0;
+}
+
+} // namespace Kernel
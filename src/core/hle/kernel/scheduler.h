@@ -0,0 +1,79 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+#include "common/thread_queue_list.h"
+#include "core/hle/kernel/thread.h"
+
+class ARM_Interface;
+
+namespace Kernel {
+
+/**
+ * Scheduling state of a single emulated CPU core: the thread it is running and the threads ready
+ * to run on it. Every function must be called with the HLE lock held.
+ */
+class Scheduler final {
+public:
+    Scheduler(ARM_Interface& cpu_core, size_t core_index);
+    ~Scheduler();
+
+    /// Returns whether there are any threads that are ready to run on this core
+    bool HaveReadyThreads() const;
+
+    /// Returns whether any thread of at least the given priority is ready to run on this core
+    bool HaveReadyThreads(u32 priority) const;
+
+    /// Switches this core to the best ready thread, if it should stop running its current one
+    void Reschedule();
+
+    /// Gets the thread running on this core, nullptr if it is idle
+    Thread* GetCurrentThread() const;
+
+    /// Adds a ready thread to the back of this core's queue at the given priority
+    void ScheduleThread(Thread* thread, u32 priority);
+
+    /// Removes a ready thread from this core's queue
+    void UnscheduleThread(Thread* thread, u32 priority);
+
+    /// Moves a ready thread queued on this core to a different priority
+    void SetThreadPriority(Thread* thread, u32 priority);
+
+    /// Number of threads running or ready to run on this core, used to balance threads over cores
+    size_t GetLoad() const;
+
+    size_t CoreIndex() const {
+        return core_index;
+    }
+
+    /// Drops the running thread and empties the ready queue, used when the kernel shuts down
+    void Reset();
+
+private:
+    using ThreadQueue =
+        Common::ThreadQueueList<Thread, THREADPRIO_LOWEST + 1, &Thread::ready_queue_node>;
+
+    /// Pops the thread that should run next from the ready queue, or keeps the current one
+    Thread* PopNextReadyThread();
+
+    /// Switches the active thread context of this core to that of the specified thread
+    void SwitchContext(Thread* new_thread);
+
+    /// Threads ready to run on this core
+    ThreadQueue ready_queue;
+    /// Number of threads in ready_queue
+    size_t num_ready_threads = 0;
+
+    SharedPtr<Thread> current_thread;
+    /// Thread whose vector registers the CPU holds, with the version of its context they match
+    SharedPtr<Thread> vector_thread;
+    u64 vector_thread_version = 0;
+
+    ARM_Interface& cpu_core;
+    size_t core_index;
+};
+
+} // namespace Kernel
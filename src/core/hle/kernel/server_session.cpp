@@ -4,17 +4,29 @@
 
 #include <tuple>
 
+#include "core/hle/ipc.h"
+#include "core/hle/kernel/async_request.h"
 #include "core/hle/kernel/client_port.h"
 #include "core/hle/kernel/client_session.h"
+#include "core/hle/kernel/errors.h"
 #include "core/hle/kernel/handle_table.h"
 #include "core/hle/kernel/hle_ipc.h"
 #include "core/hle/kernel/process.h"
 #include "core/hle/kernel/server_session.h"
 #include "core/hle/kernel/session.h"
 #include "core/hle/kernel/thread.h"
+#include "core/memory.h"
 
 namespace Kernel {
 
+/// Fails the request of a client thread waiting for a guest server to reply
+static void FailRequest(Thread* thread) {
+    if (thread->status == THREADSTATUS_WAIT_IPC) {
+        thread->SetWaitSynchronizationResult(ERR_SESSION_CLOSED_BY_REMOTE);
+        thread->ResumeFromWait();
+    }
+}
+
 ServerSession::ServerSession() = default;
 ServerSession::~ServerSession() {
     // This destructor will be called automatically when the last ServerSession handle is closed by
@@ -24,8 +36,13 @@ ServerSession::~ServerSession() {
     if (parent->port)
         parent->port->active_sessions--;
 
-    // TODO(Subv): Wake up all the ClientSession's waiting threads and set
-    // the SendSyncRequest result to 0xC920181A.
+    // The requests that were not replied to can't be anymore
+    for (auto& thread : pending_requesting_threads) {
+        FailRequest(thread.get());
+    }
+    if (currently_handling != nullptr) {
+        FailRequest(currently_handling.get());
+    }
 
     parent->server = nullptr;
 }
@@ -49,13 +66,52 @@ bool ServerSession::ShouldWait(Thread* thread) const {
 
 void ServerSession::Acquire(Thread* thread) {
     ASSERT_MSG(!ShouldWait(thread), "object unavailable!");
+    if (parent->client == nullptr) {
+        // The client endpoint was closed, ReceiveRequest reports that to the server
+        return;
+    }
+
     // We are now handling a request, pop it from the stack.
-    // TODO(Subv): What happens if the client endpoint is closed before any requests are made?
     ASSERT(!pending_requesting_threads.empty());
     currently_handling = pending_requesting_threads.back();
     pending_requesting_threads.pop_back();
 }
 
+ResultCode ServerSession::ReceiveRequest(Thread* server_thread) {
+    if (currently_handling == nullptr) {
+        return ERR_SESSION_CLOSED_BY_REMOTE;
+    }
+
+    // TODO(Subv): Translate the handles and buffer descriptors of the request once multiple
+    // processes are supported. For now, both threads share the address space and handle table.
+    std::array<u32, IPC::COMMAND_BUFFER_LENGTH> cmd_buf;
+    Memory::ReadBlock(currently_handling->GetTLSAddress(), cmd_buf.data(), sizeof(cmd_buf));
+    Memory::WriteBlock(server_thread->GetTLSAddress(), cmd_buf.data(), sizeof(cmd_buf));
+    return RESULT_SUCCESS;
+}
+
+ResultCode ServerSession::Reply(Thread* server_thread) {
+    if (currently_handling == nullptr) {
+        // Nothing to reply to, the session was closed or no request was received
+        return ERR_SESSION_CLOSED_BY_REMOTE;
+    }
+
+    SharedPtr<Thread> client_thread = std::move(currently_handling);
+    currently_handling = nullptr;
+
+    std::array<u32, IPC::COMMAND_BUFFER_LENGTH> cmd_buf;
+    Memory::ReadBlock(server_thread->GetTLSAddress(), cmd_buf.data(), sizeof(cmd_buf));
+    Memory::WriteBlock(client_thread->GetTLSAddress(), cmd_buf.data(), sizeof(cmd_buf));
+
+    if (client_thread->status == THREADSTATUS_WAIT_IPC) {
+        client_thread->ResumeFromWait();
+    }
+
+    // The next pending request can be received now
+    WakeupAllWaitingThreads();
+    return RESULT_SUCCESS;
+}
+
 ResultCode ServerSession::HandleSyncRequest(SharedPtr<Thread> thread) {
     // The ServerSession received a sync request, this means that there's new data available
     // from its ClientSession, so wake up any threads that may be waiting on a svcReplyAndReceive or
@@ -69,15 +125,31 @@ ResultCode ServerSession::HandleSyncRequest(SharedPtr<Thread> thread) {
         if (translate_result.IsError())
             return translate_result;
 
-        Kernel::HLERequestContext context(this);
+        if (request_context == nullptr) {
+            request_context = std::make_unique<HLERequestContext>(this);
+        } else {
+            request_context->Reset(this);
+        }
+
+        HLERequestContext& context = *request_context;
         u32* cmd_buf = (u32*)Memory::GetPointer(Kernel::GetCurrentThread()->GetTLSAddress());
         context.PopulateFromIncomingCommandBuffer(cmd_buf, *Kernel::g_current_process,
-                                                  Kernel::g_handle_table);
+                                                  Kernel::g_current_process->handle_table);
 
         result = hle_handler->HandleSyncRequest(context);
+
+        if (context.IsAsync()) {
+            // The pending request owns the context until it completes, the next request gets a
+            // new one
+            SubmitAsyncRequest(std::move(thread), std::move(request_context));
+        } else {
+            // Release the objects the request referenced
+            context.Clear();
+        }
     } else {
         // Add the thread to the list of threads that have issued a sync request with this
-        // server.
+        // server. It waits until the server replies with svcReplyAndReceive.
+        thread->status = THREADSTATUS_WAIT_IPC;
         pending_requesting_threads.push_back(std::move(thread));
     }
 
@@ -9,6 +9,7 @@
 #include "common/assert.h"
 #include "common/common_types.h"
 #include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/slab_heap.h"
 #include "core/hle/kernel/wait_object.h"
 #include "core/hle/result.h"
 #include "core/memory.h"
@@ -17,6 +18,7 @@ namespace Kernel {
 
 class ClientSession;
 class ClientPort;
+class HLERequestContext;
 class ServerSession;
 class Session;
 class SessionRequestHandler;
@@ -34,7 +36,7 @@ class Thread;
  * After the server replies to the request, the response is marshalled back to the caller's
  * TLS buffer and control is transferred back to it.
  */
-class ServerSession final : public WaitObject {
+class ServerSession final : public WaitObject, public SlabAllocated<ServerSession> {
 public:
     std::string GetTypeName() const override {
         return "ServerSession";
@@ -58,8 +60,8 @@ public:
 
     /**
      * Sets the HLE handler for the session. This handler will be called to service IPC requests
-     * instead of the regular IPC machinery. (The regular IPC machinery is currently not
-     * implemented.)
+     * instead of the regular IPC machinery, where a guest server receives and replies to them with
+     * svcReplyAndReceive.
      */
     void SetHleHandler(std::shared_ptr<SessionRequestHandler> hle_handler_) {
         hle_handler = std::move(hle_handler_);
@@ -72,6 +74,19 @@ public:
      */
     ResultCode HandleSyncRequest(SharedPtr<Thread> thread);
 
+    /**
+     * Copies the request of the thread whose request is being handled, which was selected by
+     * acquiring the session, into the command buffer of a guest server thread.
+     * @returns ERR_SESSION_CLOSED_BY_REMOTE if the client endpoint was closed instead.
+     */
+    ResultCode ReceiveRequest(Thread* server_thread);
+
+    /**
+     * Copies the response in the command buffer of a guest server thread to the thread whose
+     * request is being handled, and resumes it.
+     */
+    ResultCode Reply(Thread* server_thread);
+
     bool ShouldWait(Thread* thread) const override;
 
     void Acquire(Thread* thread) override;
@@ -102,6 +117,9 @@ private:
      * @return The created server session
      */
     static ResultVal<SharedPtr<ServerSession>> Create(std::string name = "Unknown");
+
+    /// Context of the requests to the HLE handler, reused to avoid rebuilding it for every request
+    std::unique_ptr<HLERequestContext> request_context;
 };
 
 /**
@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include <cstring>
+#include <set>
 #include "common/logging/log.h"
 #include "core/hle/kernel/errors.h"
 #include "core/hle/kernel/memory.h"
@@ -11,8 +12,20 @@
 
 namespace Kernel {
 
+/// Shared memory blocks with memory of their own that were created by HLE services
+static std::set<const SharedMemory*> service_shared_memory;
+
 SharedMemory::SharedMemory() {}
-SharedMemory::~SharedMemory() {}
+SharedMemory::~SharedMemory() {
+    if (memory_region != nullptr) {
+        memory_region->used -= size;
+        if (owner_process != nullptr) {
+            owner_process->linear_heap_used -= size;
+        } else {
+            service_shared_memory.erase(this);
+        }
+    }
+}
 
 SharedPtr<SharedMemory> SharedMemory::Create(SharedPtr<Process> owner_process, u32 size,
                                              MemoryPermission permissions,
@@ -27,32 +40,22 @@ SharedPtr<SharedMemory> SharedMemory::Create(SharedPtr<Process> owner_process, u
     shared_memory->other_permissions = other_permissions;
 
     if (address == 0) {
-        // We need to allocate a block from the Linear Heap ourselves.
-        // We'll manually allocate some memory from the linear heap in the specified region.
+        // The block gets memory of its own, accounted to the specified region. Every mapping of
+        // it shares that memory, and creating it doesn't move the linear heap of the region.
         MemoryRegionInfo* memory_region = GetMemoryRegion(region);
-        auto& linheap_memory = memory_region->linear_heap_memory;
-
-        ASSERT_MSG(linheap_memory->size() + size <= memory_region->size,
+        ASSERT_MSG(memory_region->used + size <= memory_region->size,
                    "Not enough space in region to allocate shared memory!");
 
-        shared_memory->backing_block = linheap_memory;
-        shared_memory->backing_block_offset = linheap_memory->size();
-        // Allocate some memory from the end of the linear heap for this region.
-        linheap_memory->insert(linheap_memory->end(), size, 0);
+        shared_memory->backing_block = std::make_shared<std::vector<u8>>(size);
+        shared_memory->backing_block_offset = 0;
+        shared_memory->memory_region = memory_region;
         memory_region->used += size;
 
-        shared_memory->linear_heap_phys_address =
-            Memory::FCRAM_PADDR + memory_region->base +
-            static_cast<PAddr>(shared_memory->backing_block_offset);
-
         // Increase the amount of used linear heap memory for the owner process.
         if (shared_memory->owner_process != nullptr) {
             shared_memory->owner_process->linear_heap_used += size;
-        }
-
-        // Refresh the address mappings for the current process.
-        if (Kernel::g_current_process != nullptr) {
-            Kernel::g_current_process->vm_manager.RefreshMemoryBlockMappings(linheap_memory.get());
+        } else {
+            service_shared_memory.insert(shared_memory.get());
         }
     } else {
         auto& vm_manager = shared_memory->owner_process->vm_manager;
@@ -145,9 +148,10 @@ ResultCode SharedMemory::Map(Process* target_process, VAddr address, MemoryPermi
 
     VAddr target_address = address;
 
-    if (base_address == 0 && target_address == 0) {
-        // Calculate the address at which to map the memory block.
-        target_address = Memory::PhysicalToVirtualAddress(linear_heap_phys_address).value();
+    if (target_address == 0) {
+        LOG_ERROR(Kernel, "cannot map id=%u, name=%s, no address was specified", GetObjectId(),
+                  name.c_str());
+        return ERR_INVALID_ADDRESS;
     }
 
     // Map the memory block into the target process
@@ -181,4 +185,14 @@ u8* SharedMemory::GetPointer(u32 offset) {
     return backing_block->data() + backing_block_offset + offset;
 }
 
+u64 AddServiceSharedMemoryUsage(std::set<const void*>& counted_memory) {
+    u64 usage = 0;
+    for (const SharedMemory* shared_memory : service_shared_memory) {
+        if (counted_memory.insert(shared_memory->backing_block.get()).second) {
+            usage += shared_memory->backing_block->size();
+        }
+    }
+    return usage;
+}
+
 } // namespace Kernel
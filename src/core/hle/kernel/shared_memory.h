@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <set>
 #include <string>
 #include "common/common_types.h"
 #include "core/hle/kernel/kernel.h"
@@ -35,8 +36,8 @@ public:
      * @param other_permissions Permission restrictions applied to other processes mapping the
      * block.
      * @param address The address from which to map the Shared Memory.
-     * @param region If the address is 0, the shared memory will be allocated in this region of the
-     * linear heap.
+     * @param region If the address is 0, the memory of the block is allocated and accounted to
+     * this region.
      * @param name Optional object name, used for debugging purposes.
      */
     static SharedPtr<SharedMemory> Create(SharedPtr<Process> owner_process, u32 size,
@@ -108,9 +109,9 @@ public:
     SharedPtr<Process> owner_process;
     /// Address of shared memory block in the owner process if specified.
     VAddr base_address;
-    /// Physical address of the shared memory block in the linear heap if no address was specified
-    /// during creation.
-    PAddr linear_heap_phys_address;
+    /// Region the memory of the block was allocated from, if no address was specified during
+    /// creation.
+    MemoryRegionInfo* memory_region = nullptr;
     /// Backing memory for this shared memory block.
     std::shared_ptr<std::vector<u8>> backing_block;
     /// Offset into the backing block for this shared memory.
@@ -129,4 +130,12 @@ private:
     ~SharedMemory() override;
 };
 
+/**
+ * Counts the host memory of the shared memory blocks created by HLE services, unless it was counted
+ * already.
+ * @param counted_memory Host memory already counted, updated with the blocks counted
+ * @returns The size of the blocks counted
+ */
+u64 AddServiceSharedMemoryUsage(std::set<const void*>& counted_memory);
+
 } // namespace
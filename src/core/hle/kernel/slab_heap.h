@@ -0,0 +1,130 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include "common/assert.h"
+#include "common/common_types.h"
+#include "common/logging/log.h"
+
+namespace Kernel {
+
+/**
+ * Fixed-capacity pool of equally sized slots, mirroring the slab heaps Horizon allocates kernel
+ * objects from. Freed slots are kept in an intrusive free list, so allocating and freeing are
+ * O(1), and objects of the same type end up next to each other in memory. Once the pool is
+ * exhausted, allocations fall back to the global heap.
+ */
+class SlabHeap final : NonCopyable {
+public:
+    SlabHeap(size_t slot_size, size_t slot_alignment)
+        : slot_size(AlignSlotSize(slot_size, slot_alignment)), slot_alignment(slot_alignment) {}
+
+    /**
+     * Reserves the storage for the pool. The storage is kept for the lifetime of the emulator, as
+     * objects from a previous emulation session may still be alive, so only the first call has
+     * any effect.
+     * @param capacity Number of slots to reserve.
+     */
+    void Initialize(size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (num_slots != 0 || capacity == 0) {
+            return;
+        }
+
+        u8* storage = static_cast<u8*>(::operator new(capacity * slot_size + slot_alignment));
+        begin = reinterpret_cast<u8*>(
+            (reinterpret_cast<uintptr_t>(storage) + slot_alignment - 1) & ~(slot_alignment - 1));
+        end = begin + capacity * slot_size;
+        num_slots = capacity;
+
+        for (size_t slot = capacity; slot-- > 0;) {
+            PushFreeSlot(begin + slot * slot_size);
+        }
+    }
+
+    void* Allocate(size_t size) {
+        DEBUG_ASSERT(size <= slot_size);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (free_list != nullptr) {
+                FreeSlot* slot = free_list;
+                free_list = slot->next;
+                return slot;
+            }
+
+            if (!warned_exhausted && num_slots != 0) {
+                LOG_WARNING(Kernel, "Slab heap of %zu slots exhausted, using the global heap",
+                            num_slots);
+                warned_exhausted = true;
+            }
+        }
+        return ::operator new(size);
+    }
+
+    void Free(void* pointer) {
+        u8* bytes = static_cast<u8*>(pointer);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (bytes >= begin && bytes < end) {
+            PushFreeSlot(bytes);
+            return;
+        }
+        ::operator delete(pointer);
+    }
+
+private:
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    static size_t AlignSlotSize(size_t size, size_t alignment) {
+        size = std::max(size, sizeof(FreeSlot));
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    void PushFreeSlot(u8* slot) {
+        FreeSlot* free_slot = reinterpret_cast<FreeSlot*>(slot);
+        free_slot->next = free_list;
+        free_list = free_slot;
+    }
+
+    const size_t slot_size;
+    const size_t slot_alignment;
+
+    std::mutex mutex;
+    u8* begin = nullptr;
+    u8* end = nullptr;
+    size_t num_slots = 0;
+    FreeSlot* free_list = nullptr;
+    bool warned_exhausted = false;
+};
+
+/**
+ * Mixin making a kernel object type allocate its instances from its own SlabHeap. The type must
+ * be final, so that every instance has the same size.
+ */
+template <typename T>
+class SlabAllocated {
+public:
+    static void* operator new(size_t size) {
+        return GetSlabHeap().Allocate(size);
+    }
+
+    static void operator delete(void* pointer) {
+        GetSlabHeap().Free(pointer);
+    }
+
+    static SlabHeap& GetSlabHeap() {
+        // Intentionally leaked, objects may outlive any static destruction order
+        static SlabHeap* slab_heap = new SlabHeap(sizeof(T), alignof(T));
+        return *slab_heap;
+    }
+};
+
+} // namespace Kernel
@@ -3,6 +3,8 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <array>
+#include <chrono>
 
 #include "common/logging/log.h"
 #include "common/microprofile.h"
@@ -17,6 +19,8 @@
 #include "core/hle/kernel/object_address_table.h"
 #include "core/hle/kernel/process.h"
 #include "core/hle/kernel/resource_limit.h"
+#include "core/hle/kernel/server_port.h"
+#include "core/hle/kernel/server_session.h"
 #include "core/hle/kernel/shared_memory.h"
 #include "core/hle/kernel/svc.h"
 #include "core/hle/kernel/svc_wrap.h"
@@ -25,6 +29,8 @@
 #include "core/hle/lock.h"
 #include "core/hle/result.h"
 #include "core/hle/service/service.h"
+#include "core/tracer/scheduler_trace.h"
+#include "core/tracer/svc_trace.h"
 
 namespace Kernel {
 
@@ -81,13 +87,13 @@ static ResultCode ConnectToPort(Handle* out_handle, VAddr port_name_address) {
     CASCADE_RESULT(client_session, client_port->Connect());
 
     // Return the client session
-    CASCADE_RESULT(*out_handle, g_handle_table.Create(client_session));
+    CASCADE_RESULT(*out_handle, g_current_process->handle_table.Create(client_session));
     return RESULT_SUCCESS;
 }
 
 /// Makes a blocking IPC call to an OS service.
 static ResultCode SendSyncRequest(Handle handle) {
-    SharedPtr<SyncObject> session = g_handle_table.Get<SyncObject>(handle);
+    SharedPtr<SyncObject> session = g_current_process->handle_table.Get<SyncObject>(handle);
     if (!session) {
         LOG_ERROR(Kernel_SVC, "called with invalid handle=0x%08X", handle);
         return ERR_INVALID_HANDLE;
@@ -106,7 +112,7 @@ static ResultCode SendSyncRequest(Handle handle) {
 static ResultCode GetThreadId(u32* thread_id, Handle thread_handle) {
     LOG_TRACE(Kernel_SVC, "called thread=0x%08X", thread_handle);
 
-    const SharedPtr<Thread> thread = g_handle_table.Get<Thread>(thread_handle);
+    const Thread* thread = g_current_process->handle_table.GetUnowned<Thread>(thread_handle);
     if (!thread) {
         return ERR_INVALID_HANDLE;
     }
@@ -119,7 +125,7 @@ static ResultCode GetThreadId(u32* thread_id, Handle thread_handle) {
 static ResultCode GetProcessId(u32* process_id, Handle process_handle) {
     LOG_TRACE(Kernel_SVC, "called process=0x%08X", process_handle);
 
-    const SharedPtr<Process> process = g_handle_table.Get<Process>(process_handle);
+    const Process* process = g_current_process->handle_table.GetUnowned<Process>(process_handle);
     if (!process) {
         return ERR_INVALID_HANDLE;
     }
@@ -145,6 +151,25 @@ static bool DefaultThreadWakeupCallback(ThreadWakeupReason reason, SharedPtr<Thr
 };
 
 /// Wait for a kernel object to synchronize, timeout after the specified nanoseconds
+/// Number of consecutive polling SVCs after which a thread is considered to be spinning
+constexpr u32 IDLE_POLL_THRESHOLD = 16;
+
+/**
+ * Records that the current thread made an SVC that only polled for a state change. Threads that
+ * keep polling without doing anything else in between (e.g. spinning on GetSystemTick or on
+ * zero-timeout waits) are waiting for an event, so the core skips ahead to it.
+ */
+static void NoteIdlePoll() {
+    Thread* const thread = GetCurrentThread();
+    if (++thread->idle_poll_count < IDLE_POLL_THRESHOLD) {
+        return;
+    }
+
+    thread->idle_poll_count = 0;
+    auto& system = Core::System::GetInstance();
+    system.CpuCore(system.CurrentCoreIndex()).PrepareIdle();
+}
+
 static ResultCode WaitSynchronization1(
     SharedPtr<WaitObject> object, Thread* thread, s64 nano_seconds = -1,
     std::function<Thread::WakeupCallback> wakeup_callback = DefaultThreadWakeupCallback) {
@@ -155,9 +180,14 @@ static ResultCode WaitSynchronization1(
 
     if (object->ShouldWait(thread)) {
         if (nano_seconds == 0) {
+            NoteIdlePoll();
             return RESULT_TIMEOUT;
         }
 
+        if (SchedulerTrace::IsEnabled()) {
+            SchedulerTrace::Record(SchedulerTrace::EventType::WaitBegin, thread->GetThreadId(), 1);
+        }
+
         thread->wait_objects = {object};
         object->AddWaitingThread(thread);
         thread->status = THREADSTATUS_WAIT_SYNCH_ANY;
@@ -174,8 +204,26 @@ static ResultCode WaitSynchronization1(
     return RESULT_SUCCESS;
 }
 
+/**
+ * Looks up the objects of an array of guest handles to wait on. No references are added to them:
+ * the handles keep them alive until the SVC either acquires one or makes the thread wait on them.
+ */
+static ResultCode GetWaitObjects(std::array<WaitObject*, MAX_WAIT_OBJECTS>& objects,
+                                 VAddr handles_address, u64 handle_count) {
+    std::array<Handle, MAX_WAIT_OBJECTS> handles;
+    Memory::ReadBlock(handles_address, handles.data(), handle_count * sizeof(Handle));
+
+    for (u64 i = 0; i < handle_count; ++i) {
+        Object* object = g_current_process->handle_table.GetGenericUnowned(handles[i]);
+        if (object == nullptr || !object->IsWaitable())
+            return ERR_INVALID_HANDLE;
+        objects[i] = static_cast<WaitObject*>(object);
+    }
+    return RESULT_SUCCESS;
+}
+
 /// Wait for the given handles to synchronize, timeout after the specified nanoseconds
-static ResultCode WaitSynchronization(Handle* index, VAddr handles_address, u64 handle_count,
+static ResultCode WaitSynchronization(Handle* index, VAddr handles_address, u32 handle_count,
                                       s64 nano_seconds) {
     LOG_TRACE(Kernel_SVC, "called handles_address=0x%llx, handle_count=%d, nano_seconds=%d",
               handles_address, handle_count, nano_seconds);
@@ -183,32 +231,23 @@ static ResultCode WaitSynchronization(Handle* index, VAddr handles_address, u64
     if (!Memory::IsValidVirtualAddress(handles_address))
         return ERR_INVALID_POINTER;
 
-    static constexpr u64 MaxHandles = 0x40;
-
-    if (handle_count > MaxHandles)
+    if (handle_count > MAX_WAIT_OBJECTS)
         return ResultCode(ErrorModule::Kernel, ErrCodes::TooLarge);
 
     auto thread = GetCurrentThread();
 
-    using ObjectPtr = SharedPtr<WaitObject>;
-    std::vector<ObjectPtr> objects(handle_count);
-
-    for (int i = 0; i < handle_count; ++i) {
-        Handle handle = Memory::Read32(handles_address + i * sizeof(Handle));
-        auto object = g_handle_table.Get<WaitObject>(handle);
-        if (object == nullptr)
-            return ERR_INVALID_HANDLE;
-        objects[i] = object;
-    }
+    std::array<WaitObject*, MAX_WAIT_OBJECTS> objects;
+    CASCADE_CODE(GetWaitObjects(objects, handles_address, handle_count));
+    const auto objects_end = objects.begin() + handle_count;
 
     // Find the first object that is acquirable in the provided list of objects
-    auto itr = std::find_if(objects.begin(), objects.end(), [thread](const ObjectPtr& object) {
+    auto itr = std::find_if(objects.begin(), objects_end, [thread](const WaitObject* object) {
         return !object->ShouldWait(thread);
     });
 
-    if (itr != objects.end()) {
+    if (itr != objects_end) {
         // We found a ready object, acquire it and set the result value
-        WaitObject* object = itr->get();
+        WaitObject* object = *itr;
         object->Acquire(thread);
         *index = static_cast<s32>(std::distance(objects.begin(), itr));
         return RESULT_SUCCESS;
@@ -218,13 +257,19 @@ static ResultCode WaitSynchronization(Handle* index, VAddr handles_address, u64
 
     // If a timeout value of 0 was provided, just return the Timeout error code instead of
     // suspending the thread.
-    if (nano_seconds == 0)
+    if (nano_seconds == 0) {
+        NoteIdlePoll();
         return RESULT_TIMEOUT;
+    }
 
-    for (auto& object : objects)
-        object->AddWaitingThread(thread);
+    if (SchedulerTrace::IsEnabled()) {
+        SchedulerTrace::Record(SchedulerTrace::EventType::WaitBegin, thread->GetThreadId(),
+                               handle_count);
+    }
 
-    thread->wait_objects = std::move(objects);
+    thread->wait_objects.assign(objects.begin(), objects_end);
+    for (auto& object : thread->wait_objects)
+        object->AddWaitingThread(thread);
     thread->status = THREADSTATUS_WAIT_SYNCH_ANY;
 
     // Create an event to wake the thread up after the specified nanosecond delay has passed
@@ -240,7 +285,7 @@ static ResultCode WaitSynchronization(Handle* index, VAddr handles_address, u64
 static ResultCode CancelSynchronization(Handle thread_handle) {
     LOG_TRACE(Kernel_SVC, "called thread=0x%08X", thread_handle);
 
-    const SharedPtr<Thread> thread = g_handle_table.Get<Thread>(thread_handle);
+    const SharedPtr<Thread> thread = g_current_process->handle_table.Get<Thread>(thread_handle);
     if (!thread) {
         return ERR_INVALID_HANDLE;
     }
@@ -252,6 +297,141 @@ static ResultCode CancelSynchronization(Handle thread_handle) {
     return RESULT_SUCCESS;
 }
 
+/// Accepts a pending connection to a port served by the guest
+static ResultCode AcceptSession(Handle* out_server_session, Handle port_handle) {
+    LOG_TRACE(Kernel_SVC, "called port=0x%08X", port_handle);
+
+    SharedPtr<ServerPort> port = g_current_process->handle_table.Get<ServerPort>(port_handle);
+    if (port == nullptr)
+        return ERR_INVALID_HANDLE;
+
+    SharedPtr<ServerSession> session;
+    CASCADE_RESULT(session, port->Accept());
+    CASCADE_RESULT(*out_server_session, g_current_process->handle_table.Create(std::move(session)));
+    return RESULT_SUCCESS;
+}
+
+/**
+ * Receives the request selected by acquiring an object a guest server waited on, if the object
+ * is a session. Other objects, e.g. ports or events, are just signaled.
+ */
+static ResultCode ReceiveFromWaitObject(WaitObject* object, Thread* thread) {
+    if (object->GetHandleType() != HandleType::ServerSession) {
+        return RESULT_SUCCESS;
+    }
+    return static_cast<ServerSession*>(object)->ReceiveRequest(thread);
+}
+
+/// Wakeup callback for ReplyAndReceive, receives the request of the session that was signaled
+static bool ReplyAndReceiveWakeupCallback(ThreadWakeupReason reason, SharedPtr<Thread> thread,
+                                          SharedPtr<WaitObject> object, size_t index) {
+    ASSERT(thread->status == THREADSTATUS_WAIT_SYNCH_ANY);
+
+    if (reason == ThreadWakeupReason::Timeout) {
+        thread->SetWaitSynchronizationResult(RESULT_TIMEOUT);
+        return true;
+    }
+
+    ASSERT(reason == ThreadWakeupReason::Signal);
+    thread->SetWaitSynchronizationResult(ReceiveFromWaitObject(object.get(), thread.get()));
+    thread->SetWaitSynchronizationOutput(static_cast<u32>(index));
+    return true;
+}
+
+/**
+ * Replies to the request being handled on a session, then waits for a request on any of the given
+ * sessions, or for any of the other given objects to be signaled. This lets a guest server
+ * multiplex its sessions, and send a reply and receive the next request in a single SVC.
+ */
+static ResultCode ReplyAndReceive(u32* index, VAddr handles_address, u32 handle_count,
+                                  Handle reply_target, s64 nano_seconds) {
+    LOG_TRACE(Kernel_SVC,
+              "called handles_address=0x%llx, handle_count=%d, reply_target=0x%08X, "
+              "nano_seconds=%lld",
+              handles_address, handle_count, reply_target, nano_seconds);
+
+    if (handle_count > MAX_WAIT_OBJECTS)
+        return ResultCode(ErrorModule::Kernel, ErrCodes::TooLarge);
+
+    if (handle_count != 0 && !Memory::IsValidVirtualAddress(handles_address))
+        return ERR_INVALID_POINTER;
+
+    auto thread = GetCurrentThread();
+
+    std::array<WaitObject*, MAX_WAIT_OBJECTS> objects;
+    CASCADE_CODE(GetWaitObjects(objects, handles_address, handle_count));
+    const auto objects_end = objects.begin() + handle_count;
+
+    if (reply_target != 0) {
+        SharedPtr<ServerSession> session =
+            g_current_process->handle_table.Get<ServerSession>(reply_target);
+        if (session == nullptr)
+            return ERR_INVALID_HANDLE;
+
+        // A failed reply means the client is gone, which doesn't prevent receiving
+        session->Reply(thread);
+        Core::System::GetInstance().PrepareReschedule();
+    }
+
+    if (handle_count == 0) {
+        // Only replying
+        return RESULT_SUCCESS;
+    }
+
+    // Find the first object that is acquirable in the provided list of objects
+    auto itr = std::find_if(objects.begin(), objects_end, [thread](const WaitObject* object) {
+        return !object->ShouldWait(thread);
+    });
+
+    if (itr != objects_end) {
+        // Receive right away from the first ready object
+        WaitObject* object = *itr;
+        object->Acquire(thread);
+        *index = static_cast<s32>(std::distance(objects.begin(), itr));
+        return ReceiveFromWaitObject(object, thread);
+    }
+
+    if (nano_seconds == 0) {
+        NoteIdlePoll();
+        return RESULT_TIMEOUT;
+    }
+
+    if (SchedulerTrace::IsEnabled()) {
+        SchedulerTrace::Record(SchedulerTrace::EventType::WaitBegin, thread->GetThreadId(),
+                               handle_count);
+    }
+
+    thread->wait_objects.assign(objects.begin(), objects_end);
+    for (auto& object : thread->wait_objects)
+        object->AddWaitingThread(thread);
+    thread->status = THREADSTATUS_WAIT_SYNCH_ANY;
+
+    thread->WakeAfterDelay(nano_seconds);
+    thread->wakeup_callback = ReplyAndReceiveWakeupCallback;
+
+    Core::System::GetInstance().PrepareReschedule();
+
+    return RESULT_TIMEOUT;
+}
+
+/**
+ * Gets the kernel mutex tracking the specified guest mutex, creating it if the mutex wasn't
+ * contended before. The thread owning the guest mutex acquires newly created ones.
+ */
+static SharedPtr<Mutex> GetOrCreateMutex(VAddr mutex_addr) {
+    SharedPtr<Mutex> mutex = g_object_address_table.Get<Mutex>(mutex_addr);
+    if (!mutex) {
+        // Create a new mutex for the specified address if one does not already exist
+        mutex = Mutex::Create(nullptr, mutex_addr);
+        mutex->name = Common::StringFromFormat("mutex-%llx", mutex_addr);
+
+        if (SharedPtr<Thread> holding_thread = mutex->GetHoldingThread()) {
+            mutex->Acquire(holding_thread.get());
+        }
+    }
+    return mutex;
+}
+
 /// Attempts to locks a mutex, creating it if it does not already exist
 static ResultCode LockMutex(Handle holding_thread_handle, VAddr mutex_addr,
                             Handle requesting_thread_handle) {
@@ -259,17 +439,19 @@ static ResultCode LockMutex(Handle holding_thread_handle, VAddr mutex_addr,
                           "requesting_current_thread_handle=0x%08X",
               holding_thread_handle, mutex_addr, requesting_thread_handle);
 
-    SharedPtr<Thread> holding_thread = g_handle_table.Get<Thread>(holding_thread_handle);
-    SharedPtr<Thread> requesting_thread = g_handle_table.Get<Thread>(requesting_thread_handle);
+    // The guest only asks the kernel for the mutex after failing to take it. If the mutex was
+    // released or changed hands since, have the guest retry taking it instead of waiting.
+    if (Mutex::ReadOwnerHandle(mutex_addr) != holding_thread_handle) {
+        return RESULT_SUCCESS;
+    }
+
+    HandleTable& handle_table = g_current_process->handle_table;
+    SharedPtr<Thread> holding_thread = handle_table.Get<Thread>(holding_thread_handle);
+    SharedPtr<Thread> requesting_thread = handle_table.Get<Thread>(requesting_thread_handle);
 
     ASSERT(requesting_thread);
 
-    SharedPtr<Mutex> mutex = g_object_address_table.Get<Mutex>(mutex_addr);
-    if (!mutex) {
-        // Create a new mutex for the specified address if one does not already exist
-        mutex = Mutex::Create(holding_thread, mutex_addr);
-        mutex->name = Common::StringFromFormat("mutex-%llx", mutex_addr);
-    }
+    SharedPtr<Mutex> mutex = GetOrCreateMutex(mutex_addr);
 
     ASSERT(holding_thread == mutex->GetHoldingThread());
 
@@ -280,6 +462,11 @@ static ResultCode LockMutex(Handle holding_thread_handle, VAddr mutex_addr,
 static ResultCode UnlockMutex(VAddr mutex_addr) {
     LOG_TRACE(Kernel_SVC, "called mutex_addr=0x%llx", mutex_addr);
 
+    // Nobody waits for the mutex in the kernel, so releasing it only updates guest memory
+    if (Mutex::ReleaseUncontended(mutex_addr, GetCurrentThread())) {
+        return RESULT_SUCCESS;
+    }
+
     SharedPtr<Mutex> mutex = g_object_address_table.Get<Mutex>(mutex_addr);
     ASSERT(mutex);
 
@@ -342,7 +529,7 @@ static ResultCode GetInfo(u64* result, u64 info_id, u64 handle, u64 info_sub_id)
 
 /// Gets the priority for the specified thread
 static ResultCode GetThreadPriority(u32* priority, Handle handle) {
-    const SharedPtr<Thread> thread = g_handle_table.Get<Thread>(handle);
+    const Thread* thread = g_current_process->handle_table.GetUnowned<Thread>(handle);
     if (!thread)
         return ERR_INVALID_HANDLE;
 
@@ -356,7 +543,7 @@ static ResultCode SetThreadPriority(Handle handle, u32 priority) {
         return ERR_OUT_OF_RANGE;
     }
 
-    SharedPtr<Thread> thread = g_handle_table.Get<Thread>(handle);
+    SharedPtr<Thread> thread = g_current_process->handle_table.Get<Thread>(handle);
     if (!thread)
         return ERR_INVALID_HANDLE;
 
@@ -378,10 +565,55 @@ static ResultCode SetThreadPriority(Handle handle, u32 priority) {
     return RESULT_SUCCESS;
 }
 
+/// Gets the ideal core and the affinity mask of the specified thread
+static ResultCode GetThreadCoreMask(u32* ideal_core, u64* mask, Handle handle) {
+    LOG_TRACE(Kernel_SVC, "called, handle=0x%08X", handle);
+
+    const Thread* thread = g_current_process->handle_table.GetUnowned<Thread>(handle);
+    if (!thread)
+        return ERR_INVALID_HANDLE;
+
+    *ideal_core = static_cast<u32>(thread->processor_id);
+    *mask = thread->affinity_mask;
+    return RESULT_SUCCESS;
+}
+
+/// Sets the ideal core and the affinity mask of the specified thread
+static ResultCode SetThreadCoreMask(Handle handle, u32 core, u64 mask) {
+    LOG_TRACE(Kernel_SVC, "called, handle=0x%08X, core=0x%X, mask=0x%016llX", handle, core,
+              mask);
+
+    const SharedPtr<Thread> thread = g_current_process->handle_table.Get<Thread>(handle);
+    if (!thread)
+        return ERR_INVALID_HANDLE;
+
+    s32 ideal_core = static_cast<s32>(core);
+    if (ideal_core == THREADPROCESSORID_DEFAULT) {
+        ideal_core = g_current_process->ideal_processor;
+        mask = u64(1) << ideal_core;
+    } else if (ideal_core == THREADPROCESSORID_DONT_UPDATE) {
+        ideal_core = thread->processor_id;
+    }
+
+    if (mask == 0 || (mask & ~u64(THREADPROCESSORID_DEFAULT_MASK)) != 0) {
+        return ERR_INVALID_COMBINATION;
+    }
+    if (ideal_core < 0 || ideal_core >= THREADPROCESSORID_MAX) {
+        return ERR_OUT_OF_RANGE;
+    }
+    if (((mask >> ideal_core) & 1) == 0) {
+        return ERR_INVALID_COMBINATION;
+    }
+
+    thread->ChangeCore(ideal_core, mask);
+    Core::System::GetInstance().PrepareReschedule();
+    return RESULT_SUCCESS;
+}
+
 /// Get which CPU core is executing the current thread
 static u32 GetCurrentProcessorNumber() {
-    LOG_WARNING(Kernel_SVC, "(STUBBED) called, defaulting to processor 0");
-    return 0;
+    LOG_TRACE(Kernel_SVC, "called");
+    return static_cast<u32>(Core::System::GetInstance().CurrentCoreIndex());
 }
 
 static ResultCode MapSharedMemory(Handle shared_memory_handle, VAddr addr, u64 size,
@@ -391,7 +623,7 @@ static ResultCode MapSharedMemory(Handle shared_memory_handle, VAddr addr, u64 s
               shared_memory_handle, addr, size, permissions);
 
     SharedPtr<SharedMemory> shared_memory =
-        Kernel::g_handle_table.Get<SharedMemory>(shared_memory_handle);
+        g_current_process->handle_table.Get<SharedMemory>(shared_memory_handle);
     if (!shared_memory) {
         return ERR_INVALID_HANDLE;
     }
@@ -418,13 +650,13 @@ static ResultCode MapSharedMemory(Handle shared_memory_handle, VAddr addr, u64 s
 /// Query process memory
 static ResultCode QueryProcessMemory(MemoryInfo* memory_info, PageInfo* /*page_info*/,
                                      Handle process_handle, u64 addr) {
-    SharedPtr<Process> process = g_handle_table.Get<Process>(process_handle);
+    Process* process = g_current_process->handle_table.GetUnowned<Process>(process_handle);
     if (!process) {
         return ERR_INVALID_HANDLE;
     }
     auto vma = process->vm_manager.FindVMA(addr);
     memory_info->attributes = 0;
-    if (vma == g_current_process->vm_manager.vma_map.end()) {
+    if (vma == process->vm_manager.vma_map.end()) {
         memory_info->base_address = 0;
         memory_info->permission = static_cast<u32>(VMAPermission::None);
         memory_info->size = 0;
@@ -503,10 +735,12 @@ static ResultCode CreateThread(Handle* out_handle, VAddr entry_point, u64 arg, V
     case THREADPROCESSORID_1:
     case THREADPROCESSORID_2:
     case THREADPROCESSORID_3:
-        // TODO(bunnei): Implement support for other processor IDs
-        LOG_ERROR(Kernel_SVC,
-                  "Newly created thread must run in another thread (%u), unimplemented.",
-                  processor_id);
+        if (static_cast<size_t>(processor_id) >= Core::System::GetInstance().NumCpuCores()) {
+            LOG_WARNING(Kernel_SVC,
+                        "Newly created thread must run on core %d, but multi-core emulation is "
+                        "disabled. Running it on core 0.",
+                        processor_id);
+        }
         break;
     default:
         ASSERT_MSG(false, "Unsupported thread processor ID: %d", processor_id);
@@ -516,7 +750,7 @@ static ResultCode CreateThread(Handle* out_handle, VAddr entry_point, u64 arg, V
     CASCADE_RESULT(SharedPtr<Thread> thread,
                    Thread::Create(name, entry_point, priority, arg, processor_id, stack_top,
                                   g_current_process));
-    CASCADE_RESULT(thread->guest_handle, g_handle_table.Create(thread));
+    CASCADE_RESULT(thread->guest_handle, g_current_process->handle_table.Create(thread));
     *out_handle = thread->guest_handle;
 
     Core::System::GetInstance().PrepareReschedule();
@@ -532,7 +766,7 @@ static ResultCode CreateThread(Handle* out_handle, VAddr entry_point, u64 arg, V
 static ResultCode StartThread(Handle thread_handle) {
     LOG_TRACE(Kernel_SVC, "called thread=0x%08X", thread_handle);
 
-    const SharedPtr<Thread> thread = g_handle_table.Get<Thread>(thread_handle);
+    const SharedPtr<Thread> thread = g_current_process->handle_table.Get<Thread>(thread_handle);
     if (!thread) {
         return ERR_INVALID_HANDLE;
     }
@@ -554,10 +788,16 @@ static void ExitThread() {
 static void SleepThread(s64 nanoseconds) {
     LOG_TRACE(Kernel_SVC, "called nanoseconds=%lld", nanoseconds);
 
-    // Don't attempt to yield execution if there are no available threads to run,
-    // this way we avoid a useless reschedule to the idle thread.
-    if (nanoseconds == 0 && !HaveReadyThreads())
+    // Zero and negative timeouts yield to the threads of at least the same priority. When there
+    // are none the thread keeps running, avoiding a useless exit from the JIT.
+    if (nanoseconds <= 0) {
+        if (YieldCurrentThread()) {
+            Core::System::GetInstance().PrepareReschedule();
+        } else {
+            NoteIdlePoll();
+        }
         return;
+    }
 
     // Sleep current thread and check for next thread to schedule
     WaitCurrentThread_Sleep();
@@ -576,17 +816,10 @@ static ResultCode WaitProcessWideKeyAtomic(VAddr mutex_addr, VAddr condition_var
         "called mutex_addr=%llx, condition_variable_addr=%llx, thread_handle=0x%08X, timeout=%d",
         mutex_addr, condition_variable_addr, thread_handle, nano_seconds);
 
-    SharedPtr<Thread> thread = g_handle_table.Get<Thread>(thread_handle);
+    SharedPtr<Thread> thread = g_current_process->handle_table.Get<Thread>(thread_handle);
     ASSERT(thread);
 
-    SharedPtr<Mutex> mutex = g_object_address_table.Get<Mutex>(mutex_addr);
-    if (!mutex) {
-        // Create a new mutex for the specified address if one does not already exist
-        mutex = Mutex::Create(thread, mutex_addr);
-        mutex->name = Common::StringFromFormat("mutex-%llx", mutex_addr);
-    }
-
-    ASSERT(mutex->GetOwnerHandle() == thread_handle);
+    ASSERT(Mutex::ReadOwnerHandle(mutex_addr) == thread_handle);
 
     SharedPtr<ConditionVariable> condition_variable =
         g_object_address_table.Get<ConditionVariable>(condition_variable_addr);
@@ -601,9 +834,9 @@ static ResultCode WaitProcessWideKeyAtomic(VAddr mutex_addr, VAddr condition_var
     ASSERT(condition_variable->GetAvailableCount() == 0);
     ASSERT(condition_variable->mutex_addr == mutex_addr);
 
-    auto wakeup_callback = [mutex, nano_seconds](ThreadWakeupReason reason,
-                                                 SharedPtr<Thread> thread,
-                                                 SharedPtr<WaitObject> object, size_t index) {
+    auto wakeup_callback = [mutex_addr, nano_seconds](ThreadWakeupReason reason,
+                                                      SharedPtr<Thread> thread,
+                                                      SharedPtr<WaitObject> object, size_t index) {
         ASSERT(thread->status == THREADSTATUS_WAIT_SYNCH_ANY);
 
         if (reason == ThreadWakeupReason::Timeout) {
@@ -613,6 +846,9 @@ static ResultCode WaitProcessWideKeyAtomic(VAddr mutex_addr, VAddr condition_var
 
         ASSERT(reason == ThreadWakeupReason::Signal);
 
+        // The mutex is only tracked while it is contended, so look it up again
+        SharedPtr<Mutex> mutex = GetOrCreateMutex(mutex_addr);
+
         // Now try to acquire the mutex and don't resume if it's not available.
         if (!mutex->ShouldWait(thread.get())) {
             mutex->Acquire(thread.get());
@@ -641,7 +877,9 @@ static ResultCode WaitProcessWideKeyAtomic(VAddr mutex_addr, VAddr condition_var
     CASCADE_CODE(
         WaitSynchronization1(condition_variable, thread.get(), nano_seconds, wakeup_callback));
 
-    mutex->Release(thread.get());
+    if (!Mutex::ReleaseUncontended(mutex_addr, thread.get())) {
+        g_object_address_table.Get<Mutex>(mutex_addr)->Release(thread.get());
+    }
 
     return RESULT_SUCCESS;
 }
@@ -657,17 +895,17 @@ static ResultCode SignalProcessWideKey(VAddr condition_variable_addr, s32 target
     SharedPtr<ConditionVariable> condition_variable =
         g_object_address_table.Get<ConditionVariable>(condition_variable_addr);
     if (!condition_variable) {
-        // Create a new condition_variable for the specified address if one does not already exist
-        condition_variable = ConditionVariable::Create(condition_variable_addr).Unwrap();
-        condition_variable->name =
-            Common::StringFromFormat("condition-variable-%llx", condition_variable_addr);
+        // Nobody is waiting on the condition variable, so there is no kernel state to update.
+        // Just store the count a condition variable without waiters would have been left with.
+        Memory::Write32(condition_variable_addr, target == -1 ? 0 : target);
+        return RESULT_SUCCESS;
     }
 
     CASCADE_CODE(condition_variable->Release(target));
 
     if (condition_variable->mutex_addr) {
         // If a mutex was created for this condition_variable, wait the current thread on it
-        SharedPtr<Mutex> mutex = g_object_address_table.Get<Mutex>(condition_variable->mutex_addr);
+        SharedPtr<Mutex> mutex = GetOrCreateMutex(condition_variable->mutex_addr);
         return WaitSynchronization1(mutex, GetCurrentThread());
     }
 
@@ -680,6 +918,7 @@ static u64 GetSystemTick() {
 
     // Advance time to defeat dumb games that busy-wait for the frame to end.
     CoreTiming::AddTicks(400);
+    NoteIdlePoll();
 
     return result;
 }
@@ -687,13 +926,13 @@ static u64 GetSystemTick() {
 /// Close a handle
 static ResultCode CloseHandle(Handle handle) {
     LOG_TRACE(Kernel_SVC, "Closing handle 0x%08X", handle);
-    return g_handle_table.Close(handle);
+    return g_current_process->handle_table.Close(handle);
 }
 
 /// Reset an event
 static ResultCode ResetSignal(Handle handle) {
     LOG_WARNING(Kernel_SVC, "(STUBBED) called handle 0x%08X", handle);
-    auto event = g_handle_table.Get<Event>(handle);
+    Event* event = g_current_process->handle_table.GetUnowned<Event>(handle);
     ASSERT(event != nullptr);
     event->Clear();
     return RESULT_SUCCESS;
@@ -732,8 +971,8 @@ static const FunctionDef SVC_Table[] = {
     {0x0B, SvcWrap<SleepThread>, "SleepThread"},
     {0x0C, SvcWrap<GetThreadPriority>, "GetThreadPriority"},
     {0x0D, SvcWrap<SetThreadPriority>, "SetThreadPriority"},
-    {0x0E, nullptr, "GetThreadCoreMask"},
-    {0x0F, nullptr, "SetThreadCoreMask"},
+    {0x0E, SvcWrap<GetThreadCoreMask>, "GetThreadCoreMask"},
+    {0x0F, SvcWrap<SetThreadCoreMask>, "SetThreadCoreMask"},
     {0x10, SvcWrap<GetCurrentProcessorNumber>, "GetCurrentProcessorNumber"},
     {0x11, nullptr, "SignalEvent"},
     {0x12, nullptr, "ClearEvent"},
@@ -783,9 +1022,9 @@ static const FunctionDef SVC_Table[] = {
     {0x3E, nullptr, "Unknown"},
     {0x3F, nullptr, "Unknown"},
     {0x40, nullptr, "CreateSession"},
-    {0x41, nullptr, "AcceptSession"},
+    {0x41, SvcWrap<AcceptSession>, "AcceptSession"},
     {0x42, nullptr, "ReplyAndReceiveLight"},
-    {0x43, nullptr, "ReplyAndReceive"},
+    {0x43, SvcWrap<ReplyAndReceive>, "ReplyAndReceive"},
     {0x44, nullptr, "ReplyAndReceiveWithUserBuffer"},
     {0x45, nullptr, "CreateEvent"},
     {0x46, nullptr, "Unknown"},
@@ -862,9 +1101,27 @@ void CallSVC(u32 immediate) {
     MICROPROFILE_SCOPE(Kernel_SVC);
 
     // Lock the global kernel mutex when we enter the kernel HLE.
-    std::lock_guard<std::recursive_mutex> lock(HLE::g_hle_lock);
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+
+    Thread* const thread = GetCurrentThread();
+    const u32 idle_poll_count = thread->idle_poll_count;
 
     const FunctionDef* info = GetSVCInfo(immediate);
+    if (SchedulerTrace::IsEnabled()) {
+        SchedulerTrace::Record(SchedulerTrace::EventType::SvcCall, thread->GetThreadId(),
+                               immediate, info ? info->name : nullptr);
+    }
+
+    const bool is_svc_traced = SvcTrace::IsEnabled();
+    SvcTrace::Arguments arguments;
+    std::chrono::steady_clock::time_point start_time;
+    if (is_svc_traced) {
+        static_assert(std::is_same<SvcTrace::Arguments, ARM_Interface::SvcRegisters>::value,
+                      "The traced arguments are the SVC registers");
+        Core::CPU().GetSvcRegisters(arguments);
+        start_time = std::chrono::steady_clock::now();
+    }
+
     if (info) {
         if (info->func) {
             info->func();
@@ -874,6 +1131,16 @@ void CallSVC(u32 immediate) {
     } else {
         LOG_CRITICAL(Kernel_SVC, "unknown SVC function 0x%x", immediate);
     }
+
+    if (is_svc_traced) {
+        SvcTrace::Record(immediate, info ? info->name : nullptr, thread->GetThreadId(), arguments,
+                         Core::CPU().GetReg(0), std::chrono::steady_clock::now() - start_time);
+    }
+
+    // Any SVC that didn't just poll means the thread is doing real work
+    if (thread->idle_poll_count == idle_poll_count) {
+        thread->idle_poll_count = 0;
+    }
 }
 
 } // namespace Kernel
@@ -4,6 +4,10 @@
 
 #pragma once
 
+#include <algorithm>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include "common/common_types.h"
 #include "core/arm/arm_interface.h"
 #include "core/core.h"
@@ -13,178 +17,145 @@
 
 namespace Kernel {
 
-#define PARAM(n) Core::CPU().GetReg(n)
+namespace detail {
+
+using SvcRegisters = ARM_Interface::SvcRegisters;
 
 /**
- * HLE a function return from the current ARM userland process
- * @param res Result to return
+ * Marshals an argument of an SVC. Values are read from the register with the index of the
+ * argument, truncated to the type of the argument like the guest does.
  */
-static inline void FuncReturn(u64 res) {
-    Core::CPU().SetReg(0, res);
-}
+template <typename T>
+struct SvcArgument {
+    static constexpr bool IS_REGISTER_OUTPUT = false;
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
-// Function wrappers that return type ResultCode
+    SvcArgument(const SvcRegisters& regs, size_t index) : value(static_cast<T>(regs[index])) {}
 
-template <ResultCode func(u64)>
-void SvcWrap() {
-    FuncReturn(func(PARAM(0)).raw);
-}
+    T Get() const {
+        return value;
+    }
 
-template <ResultCode func(u32)>
-void SvcWrap() {
-    FuncReturn(func((u32)PARAM(0)).raw);
-}
+    void Store(SvcRegisters& regs, size_t index) const {}
 
-template <ResultCode func(u32, u32)>
-void SvcWrap() {
-    FuncReturn(func((u32)PARAM(0), (u32)PARAM(1)).raw);
-}
+    T value;
+};
 
-template <ResultCode func(u32*, u32)>
-void SvcWrap() {
-    u32 param_1 = 0;
-    u32 retval = func(&param_1, (u32)PARAM(1)).raw;
-    Core::CPU().SetReg(1, param_1);
-    FuncReturn(retval);
-}
+/// Pointers are outputs, returned in the register following the index of the argument.
+template <typename T>
+struct SvcArgument<T*> {
+    static constexpr bool IS_REGISTER_OUTPUT = true;
 
-template <ResultCode func(u32*, u64)>
-void SvcWrap() {
-    u32 param_1 = 0;
-    u32 retval = func(&param_1, PARAM(1)).raw;
-    Core::CPU().SetReg(1, param_1);
-    FuncReturn(retval);
-}
+    SvcArgument(const SvcRegisters& regs, size_t index) {}
 
-template <ResultCode func(u64, s32)>
-void SvcWrap() {
-    FuncReturn(func(PARAM(0), (s32)PARAM(1)).raw);
-}
+    T* Get() {
+        return &value;
+    }
 
-template <ResultCode func(u64*, u64)>
-void SvcWrap() {
-    u64 param_1 = 0;
-    u32 retval = func(&param_1, PARAM(1)).raw;
-    Core::CPU().SetReg(1, param_1);
-    FuncReturn(retval);
-}
+    void Store(SvcRegisters& regs, size_t index) const {
+        regs[index + 1] = static_cast<u64>(value);
+    }
 
-template <ResultCode func(u64, u64, u32, u32)>
-void SvcWrap() {
-    FuncReturn(
-        func(PARAM(0), PARAM(1), (u32)(PARAM(3) & 0xFFFFFFFF), (u32)(PARAM(3) & 0xFFFFFFFF)).raw);
-}
+    T value{};
+};
 
-template <ResultCode func(u32, u64, u32)>
-void SvcWrap() {
-    FuncReturn(func((u32)PARAM(0), PARAM(1), (u32)PARAM(2)).raw);
-}
+/// The memory information is written to the guest memory pointed to by the register.
+template <>
+struct SvcArgument<MemoryInfo*> {
+    static constexpr bool IS_REGISTER_OUTPUT = false;
 
-template <ResultCode func(u64, u64, u64)>
-void SvcWrap() {
-    FuncReturn(func(PARAM(0), PARAM(1), PARAM(2)).raw);
-}
+    SvcArgument(const SvcRegisters& regs, size_t index) : address(regs[index]) {}
 
-template <ResultCode func(u32, u64, u64, u32)>
-void SvcWrap() {
-    FuncReturn(func((u32)PARAM(0), PARAM(1), PARAM(2), (u32)PARAM(3)).raw);
-}
+    MemoryInfo* Get() {
+        return &value;
+    }
 
-template <ResultCode func(u32*, u64, u64, s64)>
-void SvcWrap() {
-    u32 param_1 = 0;
-    ResultCode retval = func(&param_1, PARAM(1), (u32)(PARAM(2) & 0xFFFFFFFF), (s64)PARAM(3));
-    Core::CPU().SetReg(1, param_1);
-    FuncReturn(retval.raw);
-}
+    void Store(SvcRegisters& regs, size_t index) const {
+        Memory::Write64(address, value.base_address);
+        Memory::Write64(address + 8, value.size);
+        Memory::Write32(address + 16, value.type);
+        Memory::Write32(address + 20, value.attributes);
+        Memory::Write32(address + 24, value.permission);
+    }
 
-template <ResultCode func(u64, u64, u32, s64)>
-void SvcWrap() {
-    FuncReturn(func(PARAM(0), PARAM(1), (u32)PARAM(2), (s64)PARAM(3)).raw);
-}
+    VAddr address;
+    MemoryInfo value{};
+};
 
-template <ResultCode func(u64*, u64, u64, u64)>
-void SvcWrap() {
-    u64 param_1 = 0;
-    u32 retval = func(&param_1, PARAM(1), PARAM(2), PARAM(3)).raw;
-    Core::CPU().SetReg(1, param_1);
-    FuncReturn(retval);
-}
+/// The page information isn't returned to the guest yet.
+template <>
+struct SvcArgument<PageInfo*> {
+    static constexpr bool IS_REGISTER_OUTPUT = false;
 
-template <ResultCode func(u32*, u64, u64, u64, u32, s32)>
-void SvcWrap() {
-    u32 param_1 = 0;
-    u32 retval =
-        func(&param_1, PARAM(1), PARAM(2), PARAM(3), (u32)PARAM(4), (s32)(PARAM(5) & 0xFFFFFFFF))
-            .raw;
-    Core::CPU().SetReg(1, param_1);
-    FuncReturn(retval);
-}
+    SvcArgument(const SvcRegisters& regs, size_t index) {}
 
-template <ResultCode func(MemoryInfo*, PageInfo*, u64)>
-void SvcWrap() {
-    MemoryInfo memory_info = {};
-    PageInfo page_info = {};
-    u32 retval = func(&memory_info, &page_info, PARAM(2)).raw;
+    PageInfo* Get() {
+        return &value;
+    }
 
-    Memory::Write64(PARAM(0), memory_info.base_address);
-    Memory::Write64(PARAM(0) + 8, memory_info.size);
-    Memory::Write32(PARAM(0) + 16, memory_info.type);
-    Memory::Write32(PARAM(0) + 20, memory_info.attributes);
-    Memory::Write32(PARAM(0) + 24, memory_info.permission);
+    void Store(SvcRegisters& regs, size_t index) const {}
 
-    FuncReturn(retval);
-}
+    PageInfo value{};
+};
 
-template <ResultCode func(u32*, u64, u64, u32)>
-void SvcWrap() {
-    u32 param_1 = 0;
-    u32 retval = func(&param_1, PARAM(1), PARAM(2), (u32)(PARAM(3) & 0xFFFFFFFF)).raw;
-    Core::CPU().SetReg(1, param_1);
-    FuncReturn(retval);
+/// Converts the value an SVC returns to the value of X0.
+template <typename T>
+u64 ToRegister(T value) {
+    return static_cast<u64>(value);
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
-// Function wrappers that return type u32
+inline u64 ToRegister(ResultCode value) {
+    return value.raw;
+}
 
-template <u32 func()>
-void SvcWrap() {
-    FuncReturn(func());
+/// Number of registers an SVC returns results in, starting from X0.
+template <typename R, typename... Args, size_t... I>
+constexpr size_t NumResultRegisters(std::index_sequence<I...>) {
+    size_t count = std::is_void<R>::value ? 0 : 1;
+    ((count = SvcArgument<Args>::IS_REGISTER_OUTPUT ? std::max(count, I + 2) : count), ...);
+    return count;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
-// Function wrappers that return type u64
+template <auto func, typename R, typename... Args, size_t... I>
+void CallSvcImpl(std::index_sequence<I...>) {
+    static_assert(sizeof...(Args) < std::tuple_size<SvcRegisters>::value,
+                  "Too many arguments for the SVC registers");
+    constexpr size_t num_result_registers =
+        NumResultRegisters<R, Args...>(std::index_sequence<I...>{});
 
-template <u64 func()>
-void SvcWrap() {
-    FuncReturn(func());
-}
+    ARM_Interface& cpu = Core::CPU();
+    SvcRegisters regs{};
+    if constexpr (sizeof...(Args) != 0) {
+        cpu.GetSvcRegisters(regs);
+    }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
-/// Function wrappers that return type void
+    std::tuple<SvcArgument<Args>...> args{SvcArgument<Args>(regs, I)...};
+    if constexpr (std::is_void<R>::value) {
+        func(std::get<I>(args).Get()...);
+    } else {
+        regs[0] = ToRegister(func(std::get<I>(args).Get()...));
+    }
+    (std::get<I>(args).Store(regs, I), ...);
 
-template <void func()>
-void SvcWrap() {
-    func();
+    if constexpr (num_result_registers != 0) {
+        cpu.SetSvcRegisters(regs, num_result_registers);
+    }
 }
 
-template <void func(s64)>
-void SvcWrap() {
-    func((s64)PARAM(0));
+template <auto func, typename R, typename... Args>
+void CallSvc(R (*)(Args...)) {
+    CallSvcImpl<func, R, Args...>(std::index_sequence_for<Args...>{});
 }
 
-template <void func(u64, s32 len)>
-void SvcWrap() {
-    func(PARAM(0), (s32)(PARAM(1) & 0xFFFFFFFF));
-}
+} // namespace detail
 
-template <void func(u64, u64, u64)>
+/**
+ * Calls an SVC with the arguments the guest passed in its registers, then returns its results in
+ * them. The marshalling is generated from the signature of the SVC, and the registers are read
+ * and written with a single call each.
+ */
+template <auto func>
 void SvcWrap() {
-    func(PARAM(0), PARAM(1), PARAM(2));
+    detail::CallSvc<func>(func);
 }
 
-#undef PARAM
-#undef FuncReturn
-
 } // namespace Kernel
@@ -3,15 +3,17 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <limits>
 #include <list>
+#include <unordered_map>
 #include <vector>
 #include "common/assert.h"
 #include "common/common_types.h"
 #include "common/logging/log.h"
 #include "common/math_util.h"
-#include "common/thread_queue_list.h"
 #include "core/arm/arm_interface.h"
 #include "core/core.h"
+#include "core/core_cpu.h"
 #include "core/core_timing.h"
 #include "core/hle/kernel/errors.h"
 #include "core/hle/kernel/handle_table.h"
@@ -19,15 +21,15 @@
 #include "core/hle/kernel/memory.h"
 #include "core/hle/kernel/mutex.h"
 #include "core/hle/kernel/process.h"
+#include "core/hle/kernel/scheduler.h"
 #include "core/hle/kernel/thread.h"
 #include "core/hle/result.h"
 #include "core/memory.h"
+#include "core/tracer/scheduler_trace.h"
 
 namespace Kernel {
 
 /// Event type for the thread wake up event
-static CoreTiming::EventType* ThreadWakeupEventType = nullptr;
-
 bool Thread::ShouldWait(Thread* thread) const {
     return status != THREADSTATUS_DEAD;
 }
@@ -36,21 +38,15 @@ void Thread::Acquire(Thread* thread) {
     ASSERT_MSG(!ShouldWait(thread), "object unavailable!");
 }
 
-// TODO(yuriks): This can be removed if Thread objects are explicitly pooled in the future, allowing
-//               us to simply use a pool index or similar.
-static Kernel::HandleTable wakeup_callback_handle_table;
-
 // Lists all thread ids that aren't deleted/etc.
 static std::vector<SharedPtr<Thread>> thread_list;
 
-// Lists only ready thread ids.
-static Common::ThreadQueueList<Thread*, THREADPRIO_LOWEST + 1> ready_queue;
-
-static SharedPtr<Thread> current_thread;
-
 // The first available thread id at startup
 static u32 next_thread_id;
 
+// Threads waiting to be arbitrated by address, each list in the order the threads started waiting
+static std::unordered_map<VAddr, std::vector<Thread*>> arbitration_waiters;
+
 /**
  * Creates a new thread ID
  * @return The new thread ID
@@ -59,33 +55,53 @@ inline static u32 const NewThreadId() {
     return next_thread_id++;
 }
 
-Thread::Thread() {}
-Thread::~Thread() {}
+/**
+ * Callback that will wake up the thread it was scheduled for
+ * @param thread The thread that's been awoken
+ * @param cycles_late The number of CPU cycles that have passed since the desired wakeup time
+ */
+static void ThreadWakeupCallback(SharedPtr<Thread> thread, int cycles_late);
+
+Thread::Thread()
+    : wakeup_timeout([this](int cycles_late) { ThreadWakeupCallback(this, cycles_late); }) {}
+Thread::~Thread() {
+    if (owner_process != nullptr) {
+        owner_process->ReleaseResource(THREAD);
+    }
+}
+
+/// Returns the scheduler of the emulated CPU core driven by the calling host thread
+static Scheduler& GetCurrentScheduler() {
+    Core::System& system = Core::System::GetInstance();
+    return system.CpuCore(system.CurrentCoreIndex()).Scheduler();
+}
 
 Thread* GetCurrentThread() {
-    return current_thread.get();
+    return GetCurrentScheduler().GetCurrentThread();
 }
 
-/**
- * Check if the specified thread is waiting on the specified address to be arbitrated
- * @param thread The thread to test
- * @param wait_address The address to test against
- * @return True if the thread is waiting, false otherwise
- */
-static bool CheckWait_AddressArbiter(const Thread* thread, VAddr wait_address) {
-    return thread->status == THREADSTATUS_WAIT_ARB && wait_address == thread->wait_address;
+/// Removes a thread that stops waiting on its arbitration address from the waiters of the address
+static void RemoveArbitrationWaiter(Thread* thread) {
+    auto bucket = arbitration_waiters.find(thread->wait_address);
+    if (bucket == arbitration_waiters.end())
+        return;
+
+    std::vector<Thread*>& waiters = bucket->second;
+    waiters.erase(std::remove(waiters.begin(), waiters.end(), thread), waiters.end());
+    if (waiters.empty())
+        arbitration_waiters.erase(bucket);
 }
 
 void Thread::Stop() {
     // Cancel any outstanding wakeup events for this thread
-    CoreTiming::UnscheduleEvent(ThreadWakeupEventType, callback_handle);
-    wakeup_callback_handle_table.Close(callback_handle);
-    callback_handle = 0;
+    wakeup_timeout.Cancel();
 
     // Clean up thread from ready queue
     // This is only needed when the thread is termintated forcefully (SVC TerminateProcess)
     if (status == THREADSTATUS_READY) {
-        ready_queue.remove(current_priority, this);
+        scheduler->UnscheduleThread(this, current_priority);
+    } else if (status == THREADSTATUS_WAIT_ARB) {
+        RemoveArbitrationWaiter(this);
     }
 
     status = THREADSTATUS_DEAD;
@@ -102,116 +118,39 @@ void Thread::Stop() {
     ReleaseThreadMutexes(this);
 
     // Mark the TLS slot in the thread's page as free.
-    u64 tls_page = (tls_address - Memory::TLS_AREA_VADDR) / Memory::PAGE_SIZE;
-    u64 tls_slot =
-        ((tls_address - Memory::TLS_AREA_VADDR) % Memory::PAGE_SIZE) / Memory::TLS_ENTRY_SIZE;
-    Kernel::g_current_process->tls_slots[tls_page].reset(tls_slot);
+    const u32 tls_slot =
+        static_cast<u32>((tls_address - Memory::TLS_AREA_VADDR) / Memory::TLS_ENTRY_SIZE);
+    owner_process->tls_slots.Free(tls_slot);
 }
 
 Thread* ArbitrateHighestPriorityThread(u32 address) {
-    Thread* highest_priority_thread = nullptr;
-    u32 priority = THREADPRIO_LOWEST;
-
-    // Iterate through threads, find highest priority thread that is waiting to be arbitrated...
-    for (auto& thread : thread_list) {
-        if (!CheckWait_AddressArbiter(thread.get(), address))
-            continue;
-
-        if (thread == nullptr)
-            continue;
+    auto bucket = arbitration_waiters.find(address);
+    if (bucket == arbitration_waiters.end())
+        return nullptr;
 
-        if (thread->current_priority <= priority) {
-            highest_priority_thread = thread.get();
-            priority = thread->current_priority;
-        }
-    }
+    // Find the highest priority thread waiting on the address, the first one to wait on ties
+    const std::vector<Thread*>& waiters = bucket->second;
+    Thread* highest_priority_thread = *std::min_element(
+        waiters.begin(), waiters.end(), [](const Thread* lhs, const Thread* rhs) {
+            return lhs->current_priority < rhs->current_priority;
+        });
 
-    // If a thread was arbitrated, resume it
-    if (nullptr != highest_priority_thread) {
-        highest_priority_thread->ResumeFromWait();
-    }
+    // Resuming the thread removes it from the waiters of the address
+    highest_priority_thread->ResumeFromWait();
 
     return highest_priority_thread;
 }
 
 void ArbitrateAllThreads(u32 address) {
-    // Resume all threads found to be waiting on the address
-    for (auto& thread : thread_list) {
-        if (CheckWait_AddressArbiter(thread.get(), address))
-            thread->ResumeFromWait();
-    }
-}
-
-/**
- * Switches the CPU's active thread context to that of the specified thread
- * @param new_thread The thread to switch to
- */
-static void SwitchContext(Thread* new_thread) {
-    Thread* previous_thread = GetCurrentThread();
-
-    // Save context for previous thread
-    if (previous_thread) {
-        previous_thread->last_running_ticks = CoreTiming::GetTicks();
-        Core::CPU().SaveContext(previous_thread->context);
-
-        if (previous_thread->status == THREADSTATUS_RUNNING) {
-            // This is only the case when a reschedule is triggered without the current thread
-            // yielding execution (i.e. an event triggered, system core time-sliced, etc)
-            ready_queue.push_front(previous_thread->current_priority, previous_thread);
-            previous_thread->status = THREADSTATUS_READY;
-        }
-    }
-
-    // Load context of new thread
-    if (new_thread) {
-        ASSERT_MSG(new_thread->status == THREADSTATUS_READY,
-                   "Thread must be ready to become running.");
-
-        // Cancel any outstanding wakeup events for this thread
-        CoreTiming::UnscheduleEvent(ThreadWakeupEventType, new_thread->callback_handle);
-
-        auto previous_process = Kernel::g_current_process;
-
-        current_thread = new_thread;
-
-        ready_queue.remove(new_thread->current_priority, new_thread);
-        new_thread->status = THREADSTATUS_RUNNING;
-
-        if (previous_process != current_thread->owner_process) {
-            Kernel::g_current_process = current_thread->owner_process;
-            SetCurrentPageTable(&Kernel::g_current_process->vm_manager.page_table);
-        }
-
-        Core::CPU().LoadContext(new_thread->context);
-        Core::CPU().SetTlsAddress(new_thread->GetTLSAddress());
-    } else {
-        current_thread = nullptr;
-        // Note: We do not reset the current process and current page table when idling because
-        // technically we haven't changed processes, our threads are just paused.
-    }
-}
-
-/**
- * Pops and returns the next thread from the thread queue
- * @return A pointer to the next ready thread
- */
-static Thread* PopNextReadyThread() {
-    Thread* next;
-    Thread* thread = GetCurrentThread();
-
-    if (thread && thread->status == THREADSTATUS_RUNNING) {
-        // We have to do better than the current thread.
-        // This call returns null when that's not possible.
-        next = ready_queue.pop_first_better(thread->current_priority);
-        if (!next) {
-            // Otherwise just keep going with the current thread
-            next = thread;
-        }
-    } else {
-        next = ready_queue.pop_first();
-    }
+    auto bucket = arbitration_waiters.find(address);
+    if (bucket == arbitration_waiters.end())
+        return;
 
-    return next;
+    // Resume all threads found to be waiting on the address
+    const std::vector<Thread*> waiters = std::move(bucket->second);
+    arbitration_waiters.erase(bucket);
+    for (Thread* thread : waiters)
+        thread->ResumeFromWait();
 }
 
 void WaitCurrentThread_Sleep() {
@@ -223,6 +162,7 @@ void WaitCurrentThread_ArbitrateAddress(VAddr wait_address) {
     Thread* thread = GetCurrentThread();
     thread->wait_address = wait_address;
     thread->status = THREADSTATUS_WAIT_ARB;
+    arbitration_waiters[wait_address].push_back(thread);
 }
 
 void ExitCurrentThread() {
@@ -232,18 +172,7 @@ void ExitCurrentThread() {
                       thread_list.end());
 }
 
-/**
- * Callback that will wake up the thread it was scheduled for
- * @param thread_handle The handle of the thread that's been awoken
- * @param cycles_late The number of CPU cycles that have passed since the desired wakeup time
- */
-static void ThreadWakeupCallback(u64 thread_handle, int cycles_late) {
-    SharedPtr<Thread> thread = wakeup_callback_handle_table.Get<Thread>((Handle)thread_handle);
-    if (thread == nullptr) {
-        LOG_CRITICAL(Kernel, "Callback fired for invalid thread %08X", (Handle)thread_handle);
-        return;
-    }
-
+static void ThreadWakeupCallback(SharedPtr<Thread> thread, int cycles_late) {
     bool resume = true;
 
     if (thread->status == THREADSTATUS_WAIT_SYNCH_ANY ||
@@ -268,21 +197,30 @@ void Thread::WakeAfterDelay(s64 nanoseconds) {
     if (nanoseconds == -1)
         return;
 
-    CoreTiming::ScheduleEvent(nsToCycles(nanoseconds), ThreadWakeupEventType, callback_handle);
+    if (SchedulerTrace::IsEnabled()) {
+        SchedulerTrace::Record(SchedulerTrace::EventType::WakeupScheduled, GetThreadId(),
+                               static_cast<u64>(nanoseconds));
+    }
+
+    wakeup_timeout.Arm(nsToCycles(nanoseconds));
 }
 
 void Thread::CancelWakeupTimer() {
-    CoreTiming::UnscheduleEvent(ThreadWakeupEventType, callback_handle);
+    wakeup_timeout.Cancel();
 }
 
 void Thread::ResumeFromWait() {
     ASSERT_MSG(wait_objects.empty(), "Thread is waking up while waiting for objects");
 
     switch (status) {
+    case THREADSTATUS_WAIT_ARB:
+        RemoveArbitrationWaiter(this);
+        break;
+
     case THREADSTATUS_WAIT_SYNCH_ALL:
     case THREADSTATUS_WAIT_SYNCH_ANY:
-    case THREADSTATUS_WAIT_ARB:
     case THREADSTATUS_WAIT_SLEEP:
+    case THREADSTATUS_WAIT_IPC:
         break;
 
     case THREADSTATUS_READY:
@@ -306,9 +244,110 @@ void Thread::ResumeFromWait() {
 
     wakeup_callback = nullptr;
 
-    ready_queue.push_back(current_priority, this);
+    ScheduleOnBestCore();
+}
+
+bool Thread::CanRunOnCore(size_t core_index) const {
+    const size_t num_cores = Core::System::GetInstance().NumCpuCores();
+    const u64 emulated_cores_mask = (u64(1) << num_cores) - 1;
+    if ((affinity_mask & emulated_cores_mask) == 0) {
+        return core_index == 0;
+    }
+    return ((affinity_mask >> core_index) & 1) != 0;
+}
+
+/**
+ * Picks the core a thread that became ready should run on. Among the cores the thread may run on,
+ * the one with the fewest running and ready threads is chosen, with ties going to the thread's
+ * ideal core and then to the core it last ran on.
+ */
+static size_t SelectThreadCore(const Thread* thread) {
+    Core::System& system = Core::System::GetInstance();
+    const size_t previous_core = thread->scheduler ? thread->scheduler->CoreIndex() : 0;
+
+    size_t best_core = 0;
+    size_t best_load = std::numeric_limits<size_t>::max();
+    for (size_t core = 0; core < system.NumCpuCores(); ++core) {
+        if (!thread->CanRunOnCore(core)) {
+            continue;
+        }
+
+        const size_t load = system.CpuCore(core).Scheduler().GetLoad();
+        const bool is_ideal = static_cast<s32>(core) == thread->processor_id;
+        const bool best_is_ideal = static_cast<s32>(best_core) == thread->processor_id;
+        if (load < best_load ||
+            (load == best_load && !best_is_ideal && (is_ideal || core == previous_core))) {
+            best_core = core;
+            best_load = load;
+        }
+    }
+
+    return best_core;
+}
+
+void Thread::ScheduleOnBestCore() {
+    const size_t core = SelectThreadCore(this);
+    Core::Cpu& cpu_core = Core::System::GetInstance().CpuCore(core);
+
+    if (scheduler != nullptr && scheduler != &cpu_core.Scheduler()) {
+        LOG_TRACE(Kernel, "Migrating thread %u from core %zu to core %zu", GetObjectId(),
+                  scheduler->CoreIndex(), core);
+    }
+
+    scheduler = &cpu_core.Scheduler();
     status = THREADSTATUS_READY;
-    Core::System::GetInstance().PrepareReschedule();
+    if (debug_suspended) {
+        // It is queued once the debugger resumes it
+        return;
+    }
+    scheduler->ScheduleThread(this, current_priority);
+
+    // The thread may belong to a different core than the one that woke it up
+    cpu_core.PrepareReschedule();
+}
+
+void Thread::ChangeCore(s32 ideal_core, u64 mask) {
+    processor_id = ideal_core;
+    affinity_mask = mask;
+
+    if (scheduler == nullptr) {
+        return;
+    }
+
+    if (status == THREADSTATUS_READY && !CanRunOnCore(scheduler->CoreIndex())) {
+        scheduler->UnscheduleThread(this, current_priority);
+        ScheduleOnBestCore();
+    } else if (status == THREADSTATUS_RUNNING && !CanRunOnCore(scheduler->CoreIndex())) {
+        // Have its core move it away on the next reschedule
+        Core::System::GetInstance().CpuCore(scheduler->CoreIndex()).PrepareReschedule();
+    }
+}
+
+void Thread::DebugSuspend() {
+    if (debug_suspended) {
+        return;
+    }
+    debug_suspended = true;
+
+    if (scheduler == nullptr) {
+        return;
+    }
+    if (status == THREADSTATUS_READY) {
+        scheduler->UnscheduleThread(this, current_priority);
+    } else if (status == THREADSTATUS_RUNNING) {
+        Core::System::GetInstance().CpuCore(scheduler->CoreIndex()).PrepareReschedule();
+    }
+}
+
+void Thread::DebugResume() {
+    if (!debug_suspended) {
+        return;
+    }
+    debug_suspended = false;
+
+    if (status == THREADSTATUS_READY) {
+        ScheduleOnBestCore();
+    }
 }
 
 /**
@@ -324,36 +363,11 @@ static void DebugThreadQueue() {
     }
 
     for (auto& t : thread_list) {
-        u32 priority = ready_queue.contains(t.get());
-        if (priority != -1) {
-            LOG_DEBUG(Kernel, "0x%02X %u", priority, t->GetObjectId());
-        }
-    }
-}
-
-/**
- * Finds a free location for the TLS section of a thread.
- * @param tls_slots The TLS page array of the thread's owner process.
- * Returns a tuple of (page, slot, alloc_needed) where:
- * page: The index of the first allocated TLS page that has free slots.
- * slot: The index of the first free slot in the indicated page.
- * alloc_needed: Whether there's a need to allocate a new TLS page (All pages are full).
- */
-std::tuple<u32, u32, bool> GetFreeThreadLocalSlot(std::vector<std::bitset<8>>& tls_slots) {
-    // Iterate over all the allocated pages, and try to find one where not all slots are used.
-    for (unsigned page = 0; page < tls_slots.size(); ++page) {
-        const auto& page_tls_slots = tls_slots[page];
-        if (!page_tls_slots.all()) {
-            // We found a page with at least one free slot, find which slot it is
-            for (unsigned slot = 0; slot < page_tls_slots.size(); ++slot) {
-                if (!page_tls_slots.test(slot)) {
-                    return std::make_tuple(page, slot, false);
-                }
-            }
+        if (t->status == THREADSTATUS_READY) {
+            LOG_DEBUG(Kernel, "0x%02X %u (core %zu)", t->current_priority, t->GetObjectId(),
+                      t->scheduler->CoreIndex());
         }
     }
-
-    return std::make_tuple(0, 0, true);
 }
 
 /**
@@ -396,10 +410,16 @@ ResultVal<SharedPtr<Thread>> Thread::Create(std::string name, VAddr entry_point,
         return ResultCode(-1);
     }
 
+    // Checked before allocating, so that a title creating threads without bound fails here rather
+    // than overflowing the slab heap of the threads into the host heap
+    if (!owner_process->ReserveResource(THREAD)) {
+        LOG_ERROR(Kernel_SVC, "(name=%s): process reached its thread limit", name.c_str());
+        return ERR_RESOURCE_LIMIT_EXCEEDED;
+    }
+
     SharedPtr<Thread> thread(new Thread);
 
     thread_list.push_back(thread);
-    ready_queue.prepare(priority);
 
     thread->thread_id = NewThreadId();
     thread->status = THREADSTATUS_DORMANT;
@@ -407,22 +427,21 @@ ResultVal<SharedPtr<Thread>> Thread::Create(std::string name, VAddr entry_point,
     thread->stack_top = stack_top;
     thread->nominal_priority = thread->current_priority = priority;
     thread->last_running_ticks = CoreTiming::GetTicks();
+    thread->idle_poll_count = 0;
     thread->processor_id = processor_id;
+    thread->affinity_mask = processor_id >= 0 ? u64(1) << processor_id : 0;
+    thread->scheduler = nullptr;
+    thread->debug_suspended = false;
     thread->wait_objects.clear();
     thread->wait_address = 0;
     thread->name = std::move(name);
-    thread->callback_handle = wakeup_callback_handle_table.Create(thread).Unwrap();
     thread->owner_process = owner_process;
 
     // Find the next available TLS index, and mark it as used
     auto& tls_slots = owner_process->tls_slots;
-    bool needs_allocation = true;
-    u32 available_page; // Which allocated page has free space
-    u32 available_slot; // Which slot within the page is free
+    boost::optional<u32> tls_slot = tls_slots.Allocate();
 
-    std::tie(available_page, available_slot, needs_allocation) = GetFreeThreadLocalSlot(tls_slots);
-
-    if (needs_allocation) {
+    if (!tls_slot) {
         // There are no already-allocated pages with free slots, lets allocate a new one.
         // TLS pages are allocated from the BASE region in the linear heap.
         MemoryRegionInfo* memory_region = GetMemoryRegion(MemoryRegion::BASE);
@@ -441,24 +460,21 @@ ResultVal<SharedPtr<Thread>> Thread::Create(std::string name, VAddr entry_point,
         memory_region->used += Memory::PAGE_SIZE;
         owner_process->linear_heap_used += Memory::PAGE_SIZE;
 
-        tls_slots.emplace_back(0); // The page is completely available at the start
-        available_page = static_cast<u32>(tls_slots.size() - 1);
-        available_slot = 0; // Use the first slot in the new page
+        const u32 page = tls_slots.AddPage(); // The page is completely available at the start
+        tls_slot = tls_slots.Allocate();
+        ASSERT(tls_slot);
 
         auto& vm_manager = owner_process->vm_manager;
         vm_manager.RefreshMemoryBlockMappings(linheap_memory.get());
 
         // Map the page to the current process' address space.
         // TODO(Subv): Find the correct MemoryState for this region.
-        vm_manager.MapMemoryBlock(Memory::TLS_AREA_VADDR + available_page * Memory::PAGE_SIZE,
+        vm_manager.MapMemoryBlock(Memory::TLS_AREA_VADDR + page * Memory::PAGE_SIZE,
                                   linheap_memory, offset, Memory::PAGE_SIZE,
                                   MemoryState::ThreadLocalStorage);
     }
 
-    // Mark the slot as used
-    tls_slots[available_page].set(available_slot);
-    thread->tls_address = Memory::TLS_AREA_VADDR + available_page * Memory::PAGE_SIZE +
-                          available_slot * Memory::TLS_ENTRY_SIZE;
+    thread->tls_address = Memory::TLS_AREA_VADDR + *tls_slot * Memory::TLS_ENTRY_SIZE;
 
     // TODO(peachum): move to ScheduleThread() when scheduler is added so selected core is used
     // to initialize the context
@@ -471,12 +487,11 @@ void Thread::SetPriority(u32 priority) {
     ASSERT_MSG(priority <= THREADPRIO_LOWEST && priority >= THREADPRIO_HIGHEST,
                "Invalid priority value.");
     // If thread was ready, adjust queues
-    if (status == THREADSTATUS_READY)
-        ready_queue.move(this, current_priority, priority);
-    else
-        ready_queue.prepare(priority);
+    if (status == THREADSTATUS_READY && !debug_suspended)
+        scheduler->SetThreadPriority(this, priority);
 
     nominal_priority = current_priority = priority;
+    UpdateWaitObjectsPriority();
 }
 
 void Thread::UpdatePriority() {
@@ -490,11 +505,15 @@ void Thread::UpdatePriority() {
 
 void Thread::BoostPriority(u32 priority) {
     // If thread was ready, adjust queues
-    if (status == THREADSTATUS_READY)
-        ready_queue.move(this, current_priority, priority);
-    else
-        ready_queue.prepare(priority);
+    if (status == THREADSTATUS_READY && !debug_suspended)
+        scheduler->SetThreadPriority(this, priority);
     current_priority = priority;
+    UpdateWaitObjectsPriority();
+}
+
+void Thread::UpdateWaitObjectsPriority() {
+    for (auto& object : wait_objects)
+        object->UpdateWaitingThreadPriority(this);
 }
 
 SharedPtr<Thread> SetupMainThread(VAddr entry_point, u32 priority,
@@ -509,7 +528,7 @@ SharedPtr<Thread> SetupMainThread(VAddr entry_point, u32 priority,
     SharedPtr<Thread> thread = std::move(thread_res).Unwrap();
 
     // Register 1 must be a handle to the main thread
-    thread->guest_handle = Kernel::g_handle_table.Create(thread).Unwrap();
+    thread->guest_handle = owner_process->handle_table.Create(thread).Unwrap();
 
     thread->context.cpu_registers[1] = thread->guest_handle;
 
@@ -520,22 +539,22 @@ SharedPtr<Thread> SetupMainThread(VAddr entry_point, u32 priority,
 }
 
 bool HaveReadyThreads() {
-    return ready_queue.get_first() != nullptr;
+    return GetCurrentScheduler().HaveReadyThreads();
 }
 
-void Reschedule() {
-    Thread* cur = GetCurrentThread();
-    Thread* next = PopNextReadyThread();
-
-    if (cur && next) {
-        LOG_TRACE(Kernel, "context switch %u -> %u", cur->GetObjectId(), next->GetObjectId());
-    } else if (cur) {
-        LOG_TRACE(Kernel, "context switch %u -> idle", cur->GetObjectId());
-    } else if (next) {
-        LOG_TRACE(Kernel, "context switch idle -> %u", next->GetObjectId());
-    }
+bool YieldCurrentThread() {
+    Scheduler& scheduler = GetCurrentScheduler();
+    Thread* thread = scheduler.GetCurrentThread();
+    if (!scheduler.HaveReadyThreads(thread->current_priority))
+        return false;
+
+    thread->status = THREADSTATUS_READY;
+    scheduler.ScheduleThread(thread, thread->current_priority);
+    return true;
+}
 
-    SwitchContext(next);
+void Reschedule() {
+    GetCurrentScheduler().Reschedule();
 }
 
 void Thread::SetWaitSynchronizationResult(ResultCode result) {
@@ -561,20 +580,20 @@ VAddr Thread::GetCommandBufferAddress() const {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void ThreadingInit() {
-    ThreadWakeupEventType = CoreTiming::RegisterEvent("ThreadWakeupCallback", ThreadWakeupCallback);
-
-    current_thread = nullptr;
     next_thread_id = 1;
 }
 
 void ThreadingShutdown() {
-    current_thread = nullptr;
+    Core::System& system = Core::System::GetInstance();
+    for (size_t core = 0; core < system.NumCpuCores(); ++core) {
+        system.CpuCore(core).Scheduler().Reset();
+    }
 
     for (auto& t : thread_list) {
         t->Stop();
     }
     thread_list.clear();
-    ready_queue.clear();
+    arbitration_waiters.clear();
 }
 
 const std::vector<SharedPtr<Thread>>& GetThreadList() {
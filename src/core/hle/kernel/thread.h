@@ -9,9 +9,13 @@
 #include <vector>
 #include <boost/container/flat_map.hpp>
 #include <boost/container/flat_set.hpp>
+#include <boost/container/static_vector.hpp>
 #include "common/common_types.h"
+#include "common/thread_queue_list.h"
 #include "core/arm/arm_interface.h"
 #include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/slab_heap.h"
+#include "core/hle/kernel/timeout_queue.h"
 #include "core/hle/kernel/wait_object.h"
 #include "core/hle/result.h"
 
@@ -23,7 +27,8 @@ enum ThreadPriority : u32 {
 };
 
 enum ThreadProcessorId : s32 {
-    THREADPROCESSORID_DEFAULT = -2, ///< Run thread on default core specified by exheader
+    THREADPROCESSORID_DONT_UPDATE = -3, ///< Keep the thread's current ideal core
+    THREADPROCESSORID_DEFAULT = -2,     ///< Run thread on default core specified by exheader
     THREADPROCESSORID_0 = 0,        ///< Run thread on core 0
     THREADPROCESSORID_1 = 1,        ///< Run thread on core 1
     THREADPROCESSORID_2 = 2,        ///< Run thread on core 2
@@ -42,6 +47,7 @@ enum ThreadStatus {
     THREADSTATUS_WAIT_SLEEP,     ///< Waiting due to a SleepThread SVC
     THREADSTATUS_WAIT_SYNCH_ANY, ///< Waiting due to WaitSynch1 or WaitSynchN with wait_all = false
     THREADSTATUS_WAIT_SYNCH_ALL, ///< Waiting due to WaitSynchronizationN with wait_all = true
+    THREADSTATUS_WAIT_IPC,       ///< Waiting for the response to an asynchronous HLE request
     THREADSTATUS_DORMANT,        ///< Created but not yet made ready
     THREADSTATUS_DEAD            ///< Run to completion, or forcefully terminated
 };
@@ -53,10 +59,17 @@ enum class ThreadWakeupReason {
 
 namespace Kernel {
 
+/// Maximum number of objects a thread can wait on at once
+constexpr size_t MAX_WAIT_OBJECTS = 0x40;
+
+/// Objects a thread waits on, stored inline since threads wait again and again
+using WaitObjectList = boost::container::static_vector<SharedPtr<WaitObject>, MAX_WAIT_OBJECTS>;
+
 class Mutex;
 class Process;
+class Scheduler;
 
-class Thread final : public WaitObject {
+class Thread final : public WaitObject, public SlabAllocated<Thread> {
 public:
     /**
      * Creates and returns a new thread. The new thread is immediately scheduled
@@ -127,6 +140,37 @@ public:
      */
     void ResumeFromWait();
 
+    /**
+     * Marks the thread as ready and queues it on the core it should run on next: the least loaded
+     * core allowed by its affinity mask, preferring its ideal core.
+     */
+    void ScheduleOnBestCore();
+
+    /**
+     * Returns whether the thread's affinity mask allows it to run on the given core. Threads that
+     * are only allowed on cores which aren't being emulated run on core 0.
+     */
+    bool CanRunOnCore(size_t core_index) const;
+
+    /**
+     * Changes the cores the thread is allowed to run on, migrating it if it's ready on a core it
+     * may no longer use. A running thread is moved the next time its core reschedules.
+     * @param ideal_core The core the thread prefers to run on
+     * @param mask Bitmask of the cores the thread is allowed to run on
+     */
+    void ChangeCore(s32 ideal_core, u64 mask);
+
+    /**
+     * Keeps the thread from running until DebugResume, for a debugger stopping it while the other
+     * threads keep running. A running thread stops the next time its core reschedules, which is
+     * requested right away. The thread still waits and wakes up as usual meanwhile, but it isn't
+     * queued to run when it becomes ready.
+     */
+    void DebugSuspend();
+
+    /// Lets a thread stopped with DebugSuspend run again
+    void DebugResume();
+
     /**
      * Schedules an event to wake up the specified thread after the specified delay
      * @param nanoseconds The time this thread will be allowed to sleep for
@@ -188,6 +232,9 @@ public:
     }
 
     ARM_Interface::ThreadContext context;
+    /// Incremented whenever context is saved or changed, so that a core still holding the vector
+    /// registers of the thread can tell whether they are current
+    u64 context_version = 0;
 
     u32 thread_id;
 
@@ -200,7 +247,18 @@ public:
 
     u64 last_running_ticks; ///< CPU tick when thread was last running
 
-    s32 processor_id;
+    /// Number of consecutive SVCs this thread made that only polled for a state change
+    u32 idle_poll_count;
+
+    s32 processor_id; ///< Ideal core of the thread
+
+    u64 affinity_mask; ///< Bitmask of the cores the thread is allowed to run on
+
+    /// Scheduler of the core the thread is queued or running on, nullptr if it never was
+    Scheduler* scheduler;
+
+    /// Whether a debugger stopped the thread. It isn't queued while it is ready then.
+    bool debug_suspended;
 
     VAddr tls_address; ///< Virtual address of the Thread Local Storage of the thread
 
@@ -214,17 +272,20 @@ public:
 
     /// Objects that the thread is waiting on, in the same order as they were
     // passed to WaitSynchronization1/N.
-    std::vector<SharedPtr<WaitObject>> wait_objects;
+    WaitObjectList wait_objects;
 
     VAddr wait_address; ///< If waiting on an AddressArbiter, this is the arbitration address
 
+    /// Links of this thread in its core's ready queue, while it is ready to run
+    Common::ThreadQueueNode<Thread> ready_queue_node;
+
     std::string name;
 
     /// Handle used by guest emulated application to access this thread
     Handle guest_handle;
 
-    /// Handle used as userdata to reference this object when inserting into the CoreTiming queue.
-    Handle callback_handle;
+    /// Wakes the thread up when a wait with a timeout times out
+    Timeout wakeup_timeout;
 
     using WakeupCallback = bool(ThreadWakeupReason reason, SharedPtr<Thread> thread,
                                 SharedPtr<WaitObject> object, size_t index);
@@ -236,6 +297,9 @@ public:
 private:
     Thread();
     ~Thread() override;
+
+    /// Requeues the thread in the objects it waits on after its current priority changed
+    void UpdateWaitObjectsPriority();
 };
 
 /**
@@ -253,6 +317,13 @@ SharedPtr<Thread> SetupMainThread(VAddr entry_point, u32 priority,
  */
 bool HaveReadyThreads();
 
+/**
+ * Queues the current thread behind the ready threads of its core that have at least its priority,
+ * when there are any. The caller must reschedule if the thread yielded.
+ * @return Whether the thread yielded, false if there was no thread to yield to
+ */
+bool YieldCurrentThread();
+
 /**
  * Reschedules to the next available thread (call after current thread is suspended)
  */
@@ -0,0 +1,183 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "common/assert.h"
+#include "core/core_timing.h"
+#include "core/hle/kernel/timeout_queue.h"
+
+namespace Kernel {
+
+/**
+ * Binary min-heap of the armed timeouts, ordered by deadline and then by the order they were
+ * armed in. Every timeout stores its index in the heap, so that it is removed without a search.
+ */
+class TimeoutQueue {
+public:
+    static void Push(Timeout* timeout) {
+        timeout->queue_index = heap.size();
+        heap.push_back(timeout);
+        SiftUp(timeout->queue_index);
+    }
+
+    static void Remove(Timeout* timeout) {
+        const size_t index = timeout->queue_index;
+        timeout->queue_index = Timeout::NOT_QUEUED;
+
+        Timeout* const last = heap.back();
+        heap.pop_back();
+        if (last == timeout) {
+            return;
+        }
+
+        Place(last, index);
+        SiftUp(index);
+        SiftDown(last->queue_index);
+    }
+
+    static Timeout* Earliest() {
+        return heap.empty() ? nullptr : heap.front();
+    }
+
+    static void Clear() {
+        for (Timeout* timeout : heap) {
+            timeout->queue_index = Timeout::NOT_QUEUED;
+        }
+        heap.clear();
+    }
+
+    static void Expire(Timeout* timeout, int cycles_late) {
+        timeout->callback(cycles_late);
+    }
+
+private:
+    static bool IsEarlier(const Timeout* a, const Timeout* b) {
+        return a->deadline != b->deadline ? a->deadline < b->deadline : a->sequence < b->sequence;
+    }
+
+    static void Place(Timeout* timeout, size_t index) {
+        heap[index] = timeout;
+        timeout->queue_index = index;
+    }
+
+    static void SiftUp(size_t index) {
+        Timeout* const timeout = heap[index];
+        while (index > 0) {
+            const size_t parent = (index - 1) / 2;
+            if (!IsEarlier(timeout, heap[parent])) {
+                break;
+            }
+            Place(heap[parent], index);
+            index = parent;
+        }
+        Place(timeout, index);
+    }
+
+    static void SiftDown(size_t index) {
+        Timeout* const timeout = heap[index];
+        while (true) {
+            size_t child = index * 2 + 1;
+            if (child >= heap.size()) {
+                break;
+            }
+            if (child + 1 < heap.size() && IsEarlier(heap[child + 1], heap[child])) {
+                ++child;
+            }
+            if (!IsEarlier(heap[child], timeout)) {
+                break;
+            }
+            Place(heap[child], index);
+            index = child;
+        }
+        Place(timeout, index);
+    }
+
+    static std::vector<Timeout*> heap;
+};
+
+std::vector<Timeout*> TimeoutQueue::heap;
+
+/// The CoreTiming event expiring the timeouts, scheduled for the earliest one
+static CoreTiming::EventType* timeout_event_type = nullptr;
+/// Whether the event is scheduled, and the tick it is scheduled for
+static bool is_event_scheduled = false;
+static u64 event_deadline = 0;
+/// Number of timeouts armed so far, orders the timeouts with the same deadline
+static u64 next_sequence = 0;
+
+/// Schedules the CoreTiming event for the earliest timeout, unless it already fires before it
+static void ScheduleEarliestTimeout() {
+    const Timeout* earliest = TimeoutQueue::Earliest();
+    if (earliest == nullptr) {
+        // The event is left scheduled if it is, it just won't find any timeout to expire
+        return;
+    }
+    if (is_event_scheduled) {
+        if (event_deadline <= earliest->GetDeadline()) {
+            return;
+        }
+        CoreTiming::UnscheduleEvent(timeout_event_type, 0);
+    }
+
+    const s64 cycles_into_future =
+        std::max<s64>(static_cast<s64>(earliest->GetDeadline() - CoreTiming::GetTicks()), 0);
+    CoreTiming::ScheduleEvent(cycles_into_future, timeout_event_type, 0);
+    is_event_scheduled = true;
+    event_deadline = earliest->GetDeadline();
+}
+
+/// The timeout event, expires the timeouts whose deadline passed
+static void TimeoutCallback(u64 userdata, int cycles_late) {
+    is_event_scheduled = false;
+    const u64 now = event_deadline + cycles_late;
+
+    while (Timeout* timeout = TimeoutQueue::Earliest()) {
+        if (timeout->GetDeadline() > now) {
+            break;
+        }
+        const int timeout_cycles_late = static_cast<int>(now - timeout->GetDeadline());
+        TimeoutQueue::Remove(timeout);
+        // The callback may arm this timeout again, or destroy it
+        TimeoutQueue::Expire(timeout, timeout_cycles_late);
+    }
+
+    ScheduleEarliestTimeout();
+}
+
+Timeout::Timeout(Callback callback) : callback(std::move(callback)) {}
+
+Timeout::~Timeout() {
+    Cancel();
+}
+
+void Timeout::Arm(s64 cycles_into_future) {
+    Cancel();
+
+    deadline = CoreTiming::GetTicks() + std::max<s64>(cycles_into_future, 0);
+    sequence = next_sequence++;
+    TimeoutQueue::Push(this);
+    ScheduleEarliestTimeout();
+}
+
+void Timeout::Cancel() {
+    if (IsArmed()) {
+        TimeoutQueue::Remove(this);
+    }
+}
+
+void TimeoutsInit() {
+    TimeoutQueue::Clear();
+    is_event_scheduled = false;
+    next_sequence = 0;
+    timeout_event_type = CoreTiming::RegisterEvent("KernelTimeout", TimeoutCallback);
+}
+
+void TimeoutsShutdown() {
+    TimeoutQueue::Clear();
+    is_event_scheduled = false;
+}
+
+} // namespace Kernel
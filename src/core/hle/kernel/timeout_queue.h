@@ -0,0 +1,63 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include "common/common_types.h"
+
+namespace Kernel {
+
+/**
+ * Timeout of a kernel object, such as the wakeup of a waiting thread or the next signal of a
+ * timer. The armed timeouts are kept in a queue sorted by deadline, and a single CoreTiming event
+ * is scheduled for the earliest one. Arming, re-arming and cancelling a timeout are O(log n) and
+ * rarely touch the CoreTiming queue. A timeout is cancelled when it is destroyed.
+ */
+class Timeout final : NonCopyable {
+public:
+    /// Called when the timeout expires, with the number of cycles it expired late
+    using Callback = std::function<void(int cycles_late)>;
+
+    explicit Timeout(Callback callback);
+    ~Timeout();
+
+    /**
+     * Arms the timeout, re-arming it if it was already armed
+     * @param cycles_into_future Number of cycles from now until the timeout expires
+     */
+    void Arm(s64 cycles_into_future);
+
+    /// Disarms the timeout if it is armed
+    void Cancel();
+
+    bool IsArmed() const {
+        return queue_index != NOT_QUEUED;
+    }
+
+    /// Returns the CoreTiming tick at which the timeout expires, while it is armed
+    u64 GetDeadline() const {
+        return deadline;
+    }
+
+private:
+    friend class TimeoutQueue;
+
+    static constexpr size_t NOT_QUEUED = std::numeric_limits<size_t>::max();
+
+    Callback callback;
+    /// CoreTiming tick at which the timeout expires, while armed
+    u64 deadline = 0;
+    /// Order the timeout was armed in, to expire timeouts with the same deadline in that order
+    u64 sequence = 0;
+    /// Index of the timeout in the queue, NOT_QUEUED while disarmed
+    size_t queue_index = NOT_QUEUED;
+};
+
+void TimeoutsInit();
+void TimeoutsShutdown();
+
+} // namespace Kernel
@@ -6,11 +6,13 @@
 
 #include "common/common_types.h"
 #include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/slab_heap.h"
+#include "core/hle/kernel/timeout_queue.h"
 #include "core/hle/kernel/wait_object.h"
 
 namespace Kernel {
 
-class Timer final : public WaitObject {
+class Timer final : public WaitObject, public SlabAllocated<Timer> {
 public:
     /**
      * Creates a timer
@@ -67,8 +69,8 @@ private:
     Timer();
     ~Timer() override;
 
-    /// Handle used as userdata to reference this object when inserting into the CoreTiming queue.
-    Handle callback_handle;
+    /// Signals the timer when its current delay expires
+    Timeout timeout;
 };
 
 /// Initializes the required variables for timers
@@ -0,0 +1,60 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "common/assert.h"
+#include "common/bit_set.h"
+#include "core/hle/kernel/tls_slot_allocator.h"
+#include "core/memory.h"
+
+namespace Kernel {
+
+static_assert(TLSSlotAllocator::SLOTS_PER_PAGE * Memory::TLS_ENTRY_SIZE == Memory::PAGE_SIZE,
+              "TLS slots must fill the page exactly");
+
+boost::optional<u32> TLSSlotAllocator::Allocate() {
+    if (free_words.empty()) {
+        return boost::none;
+    }
+
+    const u32 word_index = free_words.back();
+    u64& word = words[word_index];
+    const u32 bit = static_cast<u32>(Common::LeastSignificantSetBit(~word));
+    word |= u64(1) << bit;
+    if (word == FULL_WORD) {
+        free_words.pop_back();
+    }
+    return word_index * SLOTS_PER_WORD + bit;
+}
+
+void TLSSlotAllocator::Free(u32 slot) {
+    const u32 word_index = slot / SLOTS_PER_WORD;
+    ASSERT(word_index < words.size());
+
+    u64& word = words[word_index];
+    const u64 mask = u64(1) << (slot % SLOTS_PER_WORD);
+    ASSERT_MSG(word & mask, "TLS slot %u is not in use", slot);
+
+    if (word == FULL_WORD) {
+        free_words.push_back(word_index);
+    }
+    word &= ~mask;
+}
+
+u32 TLSSlotAllocator::AddPage() {
+    const u32 page = num_pages++;
+    const u32 first_slot = page * SLOTS_PER_PAGE;
+    const u32 word_index = first_slot / SLOTS_PER_WORD;
+    if (word_index == words.size()) {
+        words.push_back(FULL_WORD);
+    }
+
+    u64& word = words[word_index];
+    if (word == FULL_WORD) {
+        free_words.push_back(word_index);
+    }
+    word &= ~(((u64(1) << SLOTS_PER_PAGE) - 1) << (first_slot % SLOTS_PER_WORD));
+    return page;
+}
+
+} // namespace Kernel
@@ -0,0 +1,57 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <vector>
+#include <boost/optional.hpp>
+#include "common/common_types.h"
+
+namespace Kernel {
+
+/**
+ * Tracks which Thread Local Storage slots of a process are in use. Each TLS page is split into
+ * SLOTS_PER_PAGE slots, which are numbered consecutively over all pages.
+ *
+ * Slots are kept in a bitmap of 64 bit words, together with a free list of the words that have at
+ * least one free slot. Allocating, freeing and adding pages are all O(1), no matter how many
+ * threads the process created and destroyed before.
+ */
+class TLSSlotAllocator final {
+public:
+    static constexpr u32 SLOTS_PER_PAGE = 8;
+
+    /**
+     * Marks a free slot as used.
+     * @returns The index of the slot, or boost::none if all pages are full and AddPage needs to
+     * be called first.
+     */
+    boost::optional<u32> Allocate();
+
+    /// Marks a slot returned by Allocate as free again
+    void Free(u32 slot);
+
+    /**
+     * Adds a page with all its slots free.
+     * @returns The index of the new page.
+     */
+    u32 AddPage();
+
+    /// Returns the number of pages added so far
+    u32 NumPages() const {
+        return num_pages;
+    }
+
+private:
+    static constexpr u32 SLOTS_PER_WORD = 64;
+    static constexpr u64 FULL_WORD = ~u64(0);
+
+    /// One bit per slot, set if the slot is used or its page hasn't been added yet
+    std::vector<u64> words;
+    /// Indices of the words with at least one clear bit, each word is in here at most once
+    std::vector<u32> free_words;
+    u32 num_pages = 0;
+};
+
+} // namespace Kernel
@@ -24,6 +24,19 @@ static const char* GetMemoryStateName(MemoryState state) {
     return names[(int)state];
 }
 
+/// Maps host memory into the address space of every emulated CPU core that keeps its own copy
+static void MapBackingMemoryOnCpuCores(VAddr target, u64 size, u8* memory) {
+    auto& system = Core::System::GetInstance();
+    // Nothing to update before the cores are created, as in the tests
+    if (!system.IsPoweredOn()) {
+        return;
+    }
+    for (size_t core = 0; core < system.NumCpuCores(); ++core) {
+        system.ArmInterface(core).MapBackingMemory(target, size, memory,
+                                                   VMAPermission::ReadWriteExecute);
+    }
+}
+
 bool VirtualMemoryArea::CanBeMergedWith(const VirtualMemoryArea& next) const {
     ASSERT(base + size == next.base);
     if (permissions != next.permissions || meminfo_state != next.meminfo_state ||
@@ -53,15 +66,15 @@ VMManager::~VMManager() {
 
 void VMManager::Reset() {
     vma_map.clear();
+    block_mappings.clear();
+    last_found_vma = vma_map.end();
 
     // Initialize the map with a single free region covering the entire managed space.
     VirtualMemoryArea initial_vma;
     initial_vma.size = MAX_ADDRESS;
     vma_map.emplace(initial_vma.base, initial_vma);
 
-    page_table.pointers.fill(nullptr);
-    page_table.attributes.fill(Memory::PageType::Unmapped);
-    page_table.cached_res_count.fill(0);
+    page_table.Clear();
 
     UpdatePageTableForVMA(initial_vma);
 }
@@ -74,6 +87,30 @@ VMManager::VMAHandle VMManager::FindVMA(VAddr target) const {
     }
 }
 
+VMManager::VMAHandle VMManager::FindVMA(VAddr target) {
+    if (target >= MAX_ADDRESS) {
+        return vma_map.end();
+    }
+
+    const auto contains = [target](VMAHandle vma) {
+        return target >= vma->second.base && target - vma->second.base < vma->second.size;
+    };
+    if (last_found_vma != vma_map.end()) {
+        if (contains(last_found_vma)) {
+            return last_found_vma;
+        }
+        // Walks of the address space query each VMA after the previous one
+        const VMAHandle next = std::next(last_found_vma);
+        if (next != vma_map.end() && contains(next)) {
+            last_found_vma = next;
+            return next;
+        }
+    }
+
+    last_found_vma = static_cast<const VMManager&>(*this).FindVMA(target);
+    return last_found_vma;
+}
+
 ResultVal<VMManager::VMAHandle> VMManager::MapMemoryBlock(VAddr target,
                                                           std::shared_ptr<std::vector<u8>> block,
                                                           size_t offset, u64 size,
@@ -86,14 +123,14 @@ ResultVal<VMManager::VMAHandle> VMManager::MapMemoryBlock(VAddr target,
     VirtualMemoryArea& final_vma = vma_handle->second;
     ASSERT(final_vma.size == size);
 
-    Core::CPU().MapBackingMemory(target, size, block->data() + offset,
-                                 VMAPermission::ReadWriteExecute);
+    MapBackingMemoryOnCpuCores(target, size, block->data() + offset);
 
     final_vma.type = VMAType::AllocatedMemoryBlock;
     final_vma.permissions = VMAPermission::ReadWrite;
     final_vma.meminfo_state = state;
     final_vma.backing_block = block;
     final_vma.offset = offset;
+    IndexMemoryBlockVMA(final_vma);
     UpdatePageTableForVMA(final_vma);
 
     return MakeResult<VMAHandle>(MergeAdjacent(vma_handle));
@@ -108,7 +145,7 @@ ResultVal<VMManager::VMAHandle> VMManager::MapBackingMemory(VAddr target, u8* me
     VirtualMemoryArea& final_vma = vma_handle->second;
     ASSERT(final_vma.size == size);
 
-    Core::CPU().MapBackingMemory(target, size, memory, VMAPermission::ReadWriteExecute);
+    MapBackingMemoryOnCpuCores(target, size, memory);
 
     final_vma.type = VMAType::BackingMemory;
     final_vma.permissions = VMAPermission::ReadWrite;
@@ -139,6 +176,7 @@ ResultVal<VMManager::VMAHandle> VMManager::MapMMIO(VAddr target, PAddr paddr, u6
 
 VMManager::VMAIter VMManager::Unmap(VMAIter vma_handle) {
     VirtualMemoryArea& vma = vma_handle->second;
+    UnindexMemoryBlockVMA(vma);
     vma.type = VMAType::Free;
     vma.permissions = VMAPermission::None;
     vma.meminfo_state = MemoryState::Free;
@@ -193,16 +231,56 @@ ResultCode VMManager::ReprotectRange(VAddr target, u64 size, VMAPermission new_p
 }
 
 void VMManager::RefreshMemoryBlockMappings(const std::vector<u8>* block) {
-    // If this ever proves to have a noticeable performance impact, allow users of the function to
-    // specify a specific range of addresses to limit the scan to.
-    for (const auto& p : vma_map) {
-        const VirtualMemoryArea& vma = p.second;
-        if (block == vma.backing_block.get()) {
+    const auto iter = block_mappings.find(block);
+    if (iter == block_mappings.end()) {
+        return;
+    }
+
+    for (const auto& mapping : iter->second) {
+        UpdatePageTableForVMA(vma_map.at(mapping.second));
+    }
+}
+
+void VMManager::RefreshMemoryBlockMappings(const std::vector<u8>* block, size_t offset,
+                                           size_t size) {
+    const auto iter = block_mappings.find(block);
+    if (iter == block_mappings.end()) {
+        return;
+    }
+
+    // The mappings are ordered by their offset into the block, so none past the end of the range
+    // has to be looked at.
+    const size_t end = offset + size;
+    for (const auto& mapping : iter->second) {
+        if (mapping.first >= end) {
+            break;
+        }
+        const VirtualMemoryArea& vma = vma_map.at(mapping.second);
+        if (vma.offset + vma.size > offset) {
             UpdatePageTableForVMA(vma);
         }
     }
 }
 
+void VMManager::IndexMemoryBlockVMA(const VirtualMemoryArea& vma) {
+    if (vma.type == VMAType::AllocatedMemoryBlock) {
+        block_mappings[vma.backing_block.get()].emplace(vma.offset, vma.base);
+    }
+}
+
+void VMManager::UnindexMemoryBlockVMA(const VirtualMemoryArea& vma) {
+    if (vma.type != VMAType::AllocatedMemoryBlock) {
+        return;
+    }
+
+    const auto iter = block_mappings.find(vma.backing_block.get());
+    ASSERT(iter != block_mappings.end());
+    iter->second.erase({vma.offset, vma.base});
+    if (iter->second.empty()) {
+        block_mappings.erase(iter);
+    }
+}
+
 void VMManager::LogLayout(Log::Level log_level) const {
     for (const auto& p : vma_map) {
         const VirtualMemoryArea& vma = p.second;
@@ -213,6 +291,8 @@ void VMManager::LogLayout(Log::Level log_level) const {
                     (u8)vma.permissions & (u8)VMAPermission::Execute ? 'X' : '-',
                     GetMemoryStateName(vma.meminfo_state));
     }
+    LOG_GENERIC(Log::Class::Kernel, log_level, "Page table host memory usage: %zu KiB",
+                GetPageTableMemoryUsage() / 1024);
 }
 
 VMManager::VMAIter VMManager::StripIterConstness(const VMAHandle& iter) {
@@ -314,6 +394,7 @@ VMManager::VMAIter VMManager::SplitVMA(VMAIter vma_handle, u64 offset_in_vma) {
     }
 
     ASSERT(old_vma.CanBeMergedWith(new_vma));
+    IndexMemoryBlockVMA(new_vma);
 
     return vma_map.emplace_hint(std::next(vma_handle), new_vma.base, new_vma);
 }
@@ -322,6 +403,10 @@ VMManager::VMAIter VMManager::MergeAdjacent(VMAIter iter) {
     VMAIter next_vma = std::next(iter);
     if (next_vma != vma_map.end() && iter->second.CanBeMergedWith(next_vma->second)) {
         iter->second.size += next_vma->second.size;
+        UnindexMemoryBlockVMA(next_vma->second);
+        if (last_found_vma == next_vma) {
+            last_found_vma = iter;
+        }
         vma_map.erase(next_vma);
     }
 
@@ -329,6 +414,10 @@ VMManager::VMAIter VMManager::MergeAdjacent(VMAIter iter) {
         VMAIter prev_vma = std::prev(iter);
         if (prev_vma->second.CanBeMergedWith(iter->second)) {
             prev_vma->second.size += iter->second.size;
+            UnindexMemoryBlockVMA(iter->second);
+            if (last_found_vma == iter) {
+                last_found_vma = prev_vma;
+            }
             vma_map.erase(iter);
             iter = prev_vma;
         }
@@ -356,8 +445,56 @@ void VMManager::UpdatePageTableForVMA(const VirtualMemoryArea& vma) {
 }
 
 u64 VMManager::GetTotalMemoryUsage() {
-    LOG_WARNING(Kernel, "(STUBBED) called");
-    return 0x400000;
+    u64 usage = 0;
+    for (const auto& p : vma_map) {
+        const VirtualMemoryArea& vma = p.second;
+        if (vma.type == VMAType::AllocatedMemoryBlock || vma.type == VMAType::BackingMemory) {
+            usage += vma.size;
+        }
+    }
+    return usage;
+}
+
+size_t VMManager::GetPageTableMemoryUsage() const {
+    return page_table.GetHostMemoryUsage();
+}
+
+void VMManager::AddMemoryUsage(MemoryUsage& usage, std::set<const void*>& counted_memory) const {
+    usage.page_tables += GetPageTableMemoryUsage();
+
+    for (const auto& p : vma_map) {
+        const VirtualMemoryArea& vma = p.second;
+        u64 size;
+        if (vma.type == VMAType::AllocatedMemoryBlock) {
+            if (!counted_memory.insert(vma.backing_block.get()).second) {
+                continue;
+            }
+            size = vma.backing_block->size();
+        } else if (vma.type == VMAType::BackingMemory) {
+            if (!counted_memory.insert(vma.backing_memory).second) {
+                continue;
+            }
+            size = vma.size;
+        } else {
+            continue;
+        }
+
+        switch (vma.meminfo_state) {
+        case MemoryState::Heap:
+            usage.heap += size;
+            break;
+        case MemoryState::Code:
+        case MemoryState::Static:
+            usage.code += size;
+            break;
+        case MemoryState::Shared:
+            usage.shared_memory += size;
+            break;
+        default:
+            usage.other += size;
+            break;
+        }
+    }
 }
 
 u64 VMManager::GetTotalHeapUsage() {
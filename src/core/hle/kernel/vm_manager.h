@@ -6,6 +6,8 @@
 
 #include <map>
 #include <memory>
+#include <set>
+#include <utility>
 #include <vector>
 #include "common/common_types.h"
 #include "core/hle/result.h"
@@ -126,6 +128,14 @@ public:
     /// Finds the VMA in which the given address is included in, or `vma_map.end()`.
     VMAHandle FindVMA(VAddr target) const;
 
+    /**
+     * Finds the VMA in which the given address is included in, or `vma_map.end()`. The VMA found
+     * last is remembered, so that repeated lookups in the same VMA and walks of the address space
+     * from one VMA to the next don't have to search the map. As the cache is modified, this must
+     * only be used by the kernel, which serializes the accesses to the address space.
+     */
+    VMAHandle FindVMA(VAddr target);
+
     // TODO(yuriks): Should these functions actually return the handle?
 
     /**
@@ -172,17 +182,49 @@ public:
     ResultCode ReprotectRange(VAddr target, u64 size, VMAPermission new_perms);
 
     /**
-     * Scans all VMAs and updates the page table range of any that use the given vector as backing
-     * memory. This should be called after any operation that causes reallocation of the vector.
+     * Updates the page table range of all VMAs that use the given vector as backing memory. This
+     * should be called after any operation that causes reallocation of the vector.
      */
     void RefreshMemoryBlockMappings(const std::vector<u8>* block);
 
+    /**
+     * Updates the page table range of the VMAs that map part of the given range of the backing
+     * vector, for operations that only change where that part of the vector lives.
+     *
+     * @param block The backing vector.
+     * @param offset Offset into `block` of the range.
+     * @param size Size of the range.
+     */
+    void RefreshMemoryBlockMappings(const std::vector<u8>* block, size_t offset, size_t size);
+
     /// Dumps the address space layout to the log, for debugging
     void LogLayout(Log::Level log_level) const;
 
     /// Gets the total memory usage, used by svcGetInfo
     u64 GetTotalMemoryUsage();
 
+    /// Gets the amount of host memory used by this address space's page table
+    size_t GetPageTableMemoryUsage() const;
+
+    /// Host memory used by address spaces, by what it is used for
+    struct MemoryUsage {
+        u64 page_tables = 0;
+        u64 heap = 0;
+        /// Modules, including the read-only images shared with other instances
+        u64 code = 0;
+        u64 shared_memory = 0;
+        /// Stacks, TLS and the other mappings
+        u64 other = 0;
+    };
+
+    /**
+     * Adds the host memory used by this address space to a breakdown. Host memory that is mapped
+     * several times is only counted once, in the category of the first mapping found.
+     * @param usage Breakdown to add to
+     * @param counted_memory Host memory already counted, updated with the memory added
+     */
+    void AddMemoryUsage(MemoryUsage& usage, std::set<const void*>& counted_memory) const;
+
     /// Gets the total heap usage, used by svcGetInfo
     u64 GetTotalHeapUsage();
 
@@ -205,6 +247,25 @@ public:
 private:
     using VMAIter = decltype(vma_map)::iterator;
 
+    /// Last VMA found by FindVMA, or `vma_map.end()`
+    VMAHandle last_found_vma;
+
+    /// Offsets into the backing block and base addresses of the VMAs mapping a block
+    using BlockMappings = std::set<std::pair<size_t, VAddr>>;
+
+    /**
+     * Reverse index of the VMAs of type AllocatedMemoryBlock, keyed by their backing block, so that
+     * refreshing the mappings of a block doesn't have to scan the whole address space. It is kept
+     * up to date wherever VMAs are mapped, unmapped, split or merged.
+     */
+    std::map<const std::vector<u8>*, BlockMappings> block_mappings;
+
+    /// Adds a VMA to the reverse index if it is backed by a memory block.
+    void IndexMemoryBlockVMA(const VirtualMemoryArea& vma);
+
+    /// Removes a VMA from the reverse index if it is backed by a memory block.
+    void UnindexMemoryBlockVMA(const VirtualMemoryArea& vma);
+
     /// Converts a VMAHandle to a mutable VMAIter.
     VMAIter StripIterConstness(const VMAHandle& iter);
 
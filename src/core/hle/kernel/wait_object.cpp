@@ -17,35 +17,44 @@
 
 namespace Kernel {
 
+static_assert(THREADPRIO_LOWEST < 64, "The waiting threads list lacks priority levels");
+
 void WaitObject::AddWaitingThread(SharedPtr<Thread> thread) {
-    auto itr = std::find(waiting_threads.begin(), waiting_threads.end(), thread);
-    if (itr == waiting_threads.end())
-        waiting_threads.push_back(std::move(thread));
+    auto [itr, inserted] = waiters.try_emplace(thread.get());
+    if (!inserted)
+        return;
+
+    Waiter& waiter = itr->second;
+    const u32 priority = thread->current_priority;
+    waiter.thread = std::move(thread);
+    waiting_threads.push_back(priority, &waiter);
 }
 
 void WaitObject::RemoveWaitingThread(Thread* thread) {
-    auto itr = std::find(waiting_threads.begin(), waiting_threads.end(), thread);
+    auto itr = waiters.find(thread);
     // If a thread passed multiple handles to the same object,
     // the kernel might attempt to remove the thread from the object's
     // waiting threads list multiple times.
-    if (itr != waiting_threads.end())
-        waiting_threads.erase(itr);
+    if (itr == waiters.end())
+        return;
+
+    Waiter& waiter = itr->second;
+    waiting_threads.remove(waiter.node.priority, &waiter);
+    waiters.erase(itr);
 }
 
 SharedPtr<Thread> WaitObject::GetHighestPriorityReadyThread() {
-    Thread* candidate = nullptr;
-    u32 candidate_priority = THREADPRIO_LOWEST + 1;
+    // The waiters are sorted by priority, so the first ready one is the best candidate.
+    for (Waiter* waiter = waiting_threads.get_first(); waiter != nullptr;
+         waiter = waiting_threads.get_next(waiter)) {
+        Thread* thread = waiter->thread.get();
 
-    for (const auto& thread : waiting_threads) {
         // The list of waiting threads must not contain threads that are not waiting to be awakened.
         ASSERT_MSG(thread->status == THREADSTATUS_WAIT_SYNCH_ANY ||
                        thread->status == THREADSTATUS_WAIT_SYNCH_ALL,
                    "Inconsistent thread statuses in waiting_threads");
 
-        if (thread->current_priority >= candidate_priority)
-            continue;
-
-        if (ShouldWait(thread.get()))
+        if (ShouldWait(thread))
             continue;
 
         // A thread is ready to run if it's either in THREADSTATUS_WAIT_SYNCH_ANY or
@@ -53,18 +62,39 @@ SharedPtr<Thread> WaitObject::GetHighestPriorityReadyThread() {
         bool ready_to_run = true;
         if (thread->status == THREADSTATUS_WAIT_SYNCH_ALL) {
             ready_to_run = std::none_of(thread->wait_objects.begin(), thread->wait_objects.end(),
-                                        [&thread](const SharedPtr<WaitObject>& object) {
-                                            return object->ShouldWait(thread.get());
+                                        [thread](const SharedPtr<WaitObject>& object) {
+                                            return object->ShouldWait(thread);
                                         });
         }
 
-        if (ready_to_run) {
-            candidate = thread.get();
-            candidate_priority = thread->current_priority;
-        }
+        if (ready_to_run)
+            return thread;
     }
 
-    return candidate;
+    return nullptr;
+}
+
+Thread* WaitObject::GetHighestPriorityWaitingThread() const {
+    const Waiter* waiter = waiting_threads.get_first();
+    return waiter != nullptr ? waiter->thread.get() : nullptr;
+}
+
+void WaitObject::UpdateWaitingThreadPriority(Thread* thread) {
+    auto itr = waiters.find(thread);
+    if (itr == waiters.end())
+        return;
+
+    Waiter& waiter = itr->second;
+    if (waiter.node.priority != thread->current_priority)
+        waiting_threads.move(&waiter, waiter.node.priority, thread->current_priority);
+}
+
+bool WaitObject::HasWaitingThreads() const {
+    return !waiters.empty();
+}
+
+size_t WaitObject::GetNumWaitingThreads() const {
+    return waiters.size();
 }
 
 void WaitObject::WakeupWaitingThread(SharedPtr<Thread> thread) {
@@ -105,8 +135,14 @@ void WaitObject::WakeupAllWaitingThreads() {
     }
 }
 
-const std::vector<SharedPtr<Thread>>& WaitObject::GetWaitingThreads() const {
-    return waiting_threads;
+std::vector<SharedPtr<Thread>> WaitObject::GetWaitingThreads() const {
+    std::vector<SharedPtr<Thread>> threads;
+    threads.reserve(waiters.size());
+    for (const Waiter* waiter = waiting_threads.get_first(); waiter != nullptr;
+         waiter = waiting_threads.get_next(waiter)) {
+        threads.push_back(waiter->thread);
+    }
+    return threads;
 }
 
 } // namespace Kernel
@@ -4,9 +4,11 @@
 
 #pragma once
 
+#include <unordered_map>
 #include <vector>
 #include <boost/smart_ptr/intrusive_ptr.hpp>
 #include "common/common_types.h"
+#include "common/thread_queue_list.h"
 #include "core/hle/kernel/kernel.h"
 
 namespace Kernel {
@@ -53,12 +55,40 @@ public:
     /// Obtains the highest priority thread that is ready to run from this object's waiting list.
     SharedPtr<Thread> GetHighestPriorityReadyThread();
 
-    /// Get a const reference to the waiting threads list for debug use
-    const std::vector<SharedPtr<Thread>>& GetWaitingThreads() const;
+    /// Obtains the highest priority thread waiting on this object, ready to run or not.
+    Thread* GetHighestPriorityWaitingThread() const;
+
+    /**
+     * Requeues a thread waiting on this object after its current priority changed, so that the
+     * waiters stay sorted by priority.
+     * @param thread Thread whose priority changed, ignored if it is not waiting on this object
+     */
+    void UpdateWaitingThreadPriority(Thread* thread);
+
+    /// Returns whether any thread is waiting on this object
+    bool HasWaitingThreads() const;
+
+    /// Returns the number of threads waiting on this object
+    size_t GetNumWaitingThreads() const;
+
+    /// Get a copy of the waiting threads list, in the order they would be woken up, for debug use
+    std::vector<SharedPtr<Thread>> GetWaitingThreads() const;
 
 private:
-    /// Threads waiting for this object to become available
-    std::vector<SharedPtr<Thread>> waiting_threads;
+    /// Entry of a thread in the waiting threads list
+    struct Waiter {
+        SharedPtr<Thread> thread;
+        Common::ThreadQueueNode<Waiter> node;
+    };
+
+    /// Number of thread priority levels, THREADPRIO_HIGHEST to THREADPRIO_LOWEST
+    static constexpr unsigned int NUM_PRIORITIES = 64;
+
+    /// Entries of the waiting threads, the map keeps them at the same address while they are queued
+    std::unordered_map<const Thread*, Waiter> waiters;
+    /// Threads waiting for this object to become available, by current priority and then in the
+    /// order they started waiting
+    Common::ThreadQueueList<Waiter, NUM_PRIORITIES, &Waiter::node> waiting_threads;
 };
 
 // Specialization of DynamicObjectCast for WaitObjects
@@ -70,4 +100,12 @@ inline SharedPtr<WaitObject> DynamicObjectCast<WaitObject>(SharedPtr<Object> obj
     return nullptr;
 }
 
+template <>
+inline WaitObject* DynamicObjectCast<WaitObject>(Object* object) {
+    if (object != nullptr && object->IsWaitable()) {
+        return static_cast<WaitObject*>(object);
+    }
+    return nullptr;
+}
+
 } // namespace Kernel
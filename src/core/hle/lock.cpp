@@ -5,5 +5,5 @@
 #include <core/hle/lock.h>
 
 namespace HLE {
-std::recursive_mutex g_hle_lock;
+std::mutex g_hle_lock;
 }
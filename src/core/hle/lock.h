@@ -13,6 +13,10 @@ namespace HLE {
  * modify the HLE kernel state. Note: Any operation that directly or indirectly reads from or writes
  * to the emulated memory is not protected by this mutex, and should be avoided in any threads other
  * than the CPU thread.
+ *
+ * The lock is not recursive, code running with it held (SVCs, services, CoreTiming events) must
+ * not try to acquire it again. Memory accesses don't take it, MMIO accesses are serialized by a
+ * separate lock in the memory subsystem.
  */
-extern std::recursive_mutex g_hle_lock;
+extern std::mutex g_hle_lock;
 } // namespace HLE
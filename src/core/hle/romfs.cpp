@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include <cstring>
+#include <limits>
 #include "common/swap.h"
 #include "core/hle/romfs.h"
 
@@ -28,7 +29,7 @@ struct DirectoryMetadata {
     u32_le next_dir_offset;
     u32_le first_child_dir_offset;
     u32_le first_file_offset;
-    u32_le same_hash_next_dir_offset;
+    u32_le same_hash_next_offset;
     u32_le name_length; // in bytes
     // followed by directory name
 };
@@ -40,63 +41,154 @@ struct FileMetadata {
     u32_le next_file_offset;
     u64_le data_offset;
     u64_le data_length;
-    u32_le same_hash_next_file_offset;
+    u32_le same_hash_next_offset;
     u32_le name_length; // in bytes
     // followed by file name
 };
 
 static_assert(sizeof(FileMetadata) == 0x20, "FileMetadata has incorrect size");
 
-static bool MatchName(const u8* buffer, u32 name_length, const std::u16string& name) {
-    std::vector<char16_t> name_buffer(name_length / sizeof(char16_t));
-    std::memcpy(name_buffer.data(), buffer, name_length);
-    return name == std::u16string(name_buffer.begin(), name_buffer.end());
-}
+constexpr u32 INVALID_FIELD = 0xFFFFFFFF;
 
-const u8* GetFilePointer(const u8* romfs, const std::vector<std::u16string>& path) {
-    constexpr u32 INVALID_FIELD = 0xFFFFFFFF;
-
-    // Split path into directory names and file name
-    std::vector<std::u16string> dir_names = path;
-    dir_names.pop_back();
-    const std::u16string& file_name = path.back();
-
-    Header header;
-    std::memcpy(&header, romfs, sizeof(header));
-
-    // Find directories of each level
-    DirectoryMetadata dir;
-    const u8* current_dir = romfs + header.dir_table_offset;
-    std::memcpy(&dir, current_dir, sizeof(dir));
-    for (const std::u16string& dir_name : dir_names) {
-        u32 child_dir_offset;
-        child_dir_offset = dir.first_child_dir_offset;
-        while (true) {
-            if (child_dir_offset == INVALID_FIELD) {
-                return nullptr;
+/// Offset of the root directory in the directory table
+constexpr u32 ROOT_DIR_OFFSET = 0;
+
+/// Bounds-checked view of a RomFS image
+class Reader {
+public:
+    Reader(const u8* romfs, u64 size) : romfs(romfs), size(size) {}
+
+    bool ReadHeader() {
+        return Read(0, header);
+    }
+
+    template <typename T>
+    bool Read(u64 offset, T& out) const {
+        if (offset > size || size - offset < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&out, romfs + offset, sizeof(T));
+        return true;
+    }
+
+    /// Compares a name stored in the image with another one, without copying either
+    bool MatchName(u64 offset, u32 name_length, const std::u16string& name) const {
+        if (name_length != name.size() * sizeof(char16_t) || offset > size ||
+            size - offset < name_length) {
+            return false;
+        }
+        // Names are stored as UTF-16LE, which is the host byte order
+        return std::memcmp(romfs + offset, name.data(), name_length) == 0;
+    }
+
+    /**
+     * Finds an entry of the directory or file table by its parent directory and name, following
+     * the chain of entries with the same hash.
+     * @returns The offset of the entry in its table, or INVALID_FIELD if there is none.
+     */
+    template <typename Metadata>
+    u32 Find(u32 hash_table_offset, u32 hash_table_length, u32 table_offset, u32 parent_offset,
+             const std::u16string& name, Metadata& entry) const {
+        const u32 num_buckets = hash_table_length / sizeof(u32);
+        if (num_buckets == 0) {
+            return INVALID_FIELD;
+        }
+
+        u32_le entry_offset;
+        const u32 bucket = CalculatePathHash(parent_offset, name) % num_buckets;
+        if (!Read(hash_table_offset + u64{bucket} * sizeof(u32), entry_offset)) {
+            return INVALID_FIELD;
+        }
+        while (entry_offset != INVALID_FIELD) {
+            const u64 entry_address = u64{table_offset} + entry_offset;
+            if (!Read(entry_address, entry)) {
+                return INVALID_FIELD;
             }
-            const u8* current_child_dir = romfs + header.dir_table_offset + child_dir_offset;
-            std::memcpy(&dir, current_child_dir, sizeof(dir));
-            if (MatchName(current_child_dir + sizeof(dir), dir.name_length, dir_name)) {
-                current_dir = current_child_dir;
-                break;
+            if (entry.parent_dir_offset == parent_offset &&
+                MatchName(entry_address + sizeof(entry), entry.name_length, name)) {
+                return entry_offset;
+            }
+            entry_offset = entry.same_hash_next_offset;
+        }
+        return INVALID_FIELD;
+    }
+
+    /// Finds a file, returning the offset of its contents in the image
+    bool FindFile(const std::vector<std::u16string>& path, u64& data_offset,
+                  u64& data_length) const {
+        if (path.empty()) {
+            return false;
+        }
+
+        u32 dir_offset = ROOT_DIR_OFFSET;
+        DirectoryMetadata dir;
+        for (size_t level = 0; level + 1 < path.size(); ++level) {
+            dir_offset = Find(header.dir_hash_table_offset, header.dir_hash_table_length,
+                              header.dir_table_offset, dir_offset, path[level], dir);
+            if (dir_offset == INVALID_FIELD) {
+                return false;
             }
-            child_dir_offset = dir.next_dir_offset;
         }
+
+        FileMetadata file;
+        if (Find(header.file_hash_table_offset, header.file_hash_table_length,
+                 header.file_table_offset, dir_offset, path.back(), file) == INVALID_FIELD) {
+            return false;
+        }
+        data_offset = header.data_offset + file.data_offset;
+        data_length = file.data_length;
+        return true;
     }
 
-    // Find the file
-    FileMetadata file;
-    u32 file_offset = dir.first_file_offset;
-    while (file_offset != INVALID_FIELD) {
-        const u8* current_file = romfs + header.file_table_offset + file_offset;
-        std::memcpy(&file, current_file, sizeof(file));
-        if (MatchName(current_file + sizeof(file), file.name_length, file_name)) {
-            return romfs + header.data_offset + file.data_offset;
+private:
+    static u32 CalculatePathHash(u32 parent_offset, const std::u16string& name) {
+        u32 hash = parent_offset ^ 123456789;
+        for (const char16_t c : name) {
+            hash = ((hash >> 5) | (hash << 27)) ^ c;
         }
-        file_offset = file.next_file_offset;
+        return hash;
+    }
+
+    const u8* romfs;
+    u64 size;
+    Header header{};
+};
+
+const u8* GetFilePointer(const u8* romfs, const std::vector<std::u16string>& path) {
+    // The size of the image isn't known, so the reads are effectively unchecked
+    Reader reader(romfs, std::numeric_limits<u64>::max() / 2);
+    u64 data_offset;
+    u64 data_length;
+    if (!reader.ReadHeader() || !reader.FindFile(path, data_offset, data_length)) {
+        return nullptr;
+    }
+    return romfs + data_offset;
+}
+
+bool Image::Open(const std::string& filename, u64 offset, u64 size_) {
+    data = nullptr;
+    size = 0;
+    if (!file.Open(filename) || offset > file.Size() || file.Size() - offset < size_ ||
+        size_ < sizeof(Header)) {
+        file.Close();
+        return false;
+    }
+    data = file.Data() + offset;
+    size = size_;
+    return true;
+}
+
+const u8* Image::GetFile(const std::vector<std::u16string>& path, u64& file_size) const {
+    Reader reader(data, size);
+    u64 data_offset;
+    u64 data_length;
+    if (data == nullptr || !reader.ReadHeader() ||
+        !reader.FindFile(path, data_offset, data_length) || data_offset > size ||
+        size - data_offset < data_length) {
+        return nullptr;
     }
-    return nullptr;
+    file_size = data_length;
+    return data + data_offset;
 }
 
 } // namespace RomFS
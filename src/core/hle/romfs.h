@@ -7,6 +7,7 @@
 #include <string>
 #include <vector>
 #include "common/common_types.h"
+#include "common/file_util.h"
 
 namespace RomFS {
 
@@ -15,8 +16,35 @@ namespace RomFS {
  * @param romfs The pointer to the RomFS image
  * @param path A vector containing the directory names and file name of the path to the file
  * @return the pointer to the file
- * @todo reimplement this with a full RomFS manager
  */
 const u8* GetFilePointer(const u8* romfs, const std::vector<std::u16string>& path);
 
+/**
+ * RomFS image in a memory mapped file. Files are looked up through the directory and file hash
+ * tables of the image, and the names are compared in place, so a lookup doesn't allocate.
+ */
+class Image {
+public:
+    /**
+     * Maps a RomFS image stored in a file.
+     * @param offset Offset of the image in the file.
+     * @param size Size of the image.
+     * @returns True on success, false if the file couldn't be mapped or isn't large enough.
+     */
+    bool Open(const std::string& filename, u64 offset, u64 size);
+
+    /**
+     * Gets the contents of a file in the image.
+     * @param path Directory names and file name of the path to the file.
+     * @param file_size Set to the size of the file.
+     * @returns A pointer to the contents of the file, or nullptr if it doesn't exist.
+     */
+    const u8* GetFile(const std::vector<std::u16string>& path, u64& file_size) const;
+
+private:
+    FileUtil::MappedFile file;
+    const u8* data = nullptr;
+    u64 size = 0;
+};
+
 } // namespace RomFS
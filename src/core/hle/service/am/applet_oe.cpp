@@ -2,14 +2,154 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <queue>
 #include "common/logging/log.h"
+#include "core/core_timing.h"
 #include "core/hle/ipc_helpers.h"
 #include "core/hle/kernel/event.h"
 #include "core/hle/service/am/applet_oe.h"
+#include "core/settings.h"
 
 namespace Service {
 namespace AM {
 
+/// Returned by ReceiveMessage when no message is pending
+constexpr ResultCode ERR_NO_MESSAGES(ErrorModule::AM, 3);
+
+/// Default resolution of the display the application renders to, in each operation mode
+constexpr u32 HANDHELD_DISPLAY_WIDTH = 1280;
+constexpr u32 HANDHELD_DISPLAY_HEIGHT = 720;
+constexpr u32 DOCKED_DISPLAY_WIDTH = 1920;
+constexpr u32 DOCKED_DISPLAY_HEIGHT = 1080;
+
+/// Messages the applet manager sends to the application, see ICommonStateGetter::ReceiveMessage
+enum class AppletMessage : u32 {
+    FocusStateChanged = 15,
+    OperationModeChanged = 30,
+    PerformanceModeChanged = 31,
+};
+
+enum class FocusState : u8 {
+    InFocus = 1,
+    NotInFocus = 2,
+};
+
+enum class OperationMode : u8 {
+    Handheld = 0,
+    Docked = 1,
+};
+
+/**
+ * Messages of the applet manager to the application, along with the state they notify changes
+ * of. The message event stays signalled while messages are pending, so that the application can
+ * wait on it instead of polling ReceiveMessage and the state getters every frame.
+ *
+ * Only accessed on the emu thread: changes of the settings made on other threads are handed over
+ * as host events.
+ */
+class AppletMessageQueue final {
+public:
+    static std::shared_ptr<AppletMessageQueue> Create() {
+        std::shared_ptr<AppletMessageQueue> queue(new AppletMessageQueue);
+
+        // The event may still be pending once the queue is gone
+        std::weak_ptr<AppletMessageQueue> weak_queue = queue;
+        queue->mode_change_event = CoreTiming::RegisterEvent(
+            "AM::OperationModeChanged", [weak_queue](u64 userdata, int cycles_late) {
+                if (auto queue = weak_queue.lock()) {
+                    queue->ChangeOperationMode(static_cast<OperationMode>(userdata));
+                }
+            });
+        queue->settings_callback =
+            Settings::RegisterApplyCallback([event = queue->mode_change_event] {
+                CoreTiming::ScheduleEventFromHost(event,
+                                                  static_cast<u64>(GetSettingsOperationMode()));
+            });
+        return queue;
+    }
+
+    ~AppletMessageQueue() {
+        Settings::UnregisterApplyCallback(settings_callback);
+    }
+
+    const Kernel::SharedPtr<Kernel::Event>& GetMessageEvent() const {
+        return message_event;
+    }
+
+    const Kernel::SharedPtr<Kernel::Event>& GetDisplayResolutionChangeEvent() const {
+        return display_resolution_change_event;
+    }
+
+    /// Pops the oldest message, returns false if there is none
+    bool PopMessage(AppletMessage& message) {
+        if (messages.empty()) {
+            return false;
+        }
+        message = messages.front();
+        messages.pop();
+        if (messages.empty()) {
+            message_event->Clear();
+        }
+        return true;
+    }
+
+    FocusState GetFocusState() const {
+        return focus_state;
+    }
+
+    OperationMode GetOperationMode() const {
+        return operation_mode;
+    }
+
+    void ChangeFocusState(FocusState state) {
+        if (state == focus_state) {
+            return;
+        }
+        focus_state = state;
+        PushMessage(AppletMessage::FocusStateChanged);
+    }
+
+    void ChangeOperationMode(OperationMode mode) {
+        if (mode == operation_mode) {
+            return;
+        }
+        operation_mode = mode;
+        // The performance mode follows the operation mode, and so does the display resolution
+        PushMessage(AppletMessage::OperationModeChanged);
+        PushMessage(AppletMessage::PerformanceModeChanged);
+        display_resolution_change_event->Signal();
+    }
+
+private:
+    AppletMessageQueue() {
+        message_event = Kernel::Event::Create(Kernel::ResetType::Sticky, "AM:MessageEvent");
+        display_resolution_change_event = Kernel::Event::Create(
+            Kernel::ResetType::OneShot, "AM:DisplayResolutionChangeEvent");
+        operation_mode = GetSettingsOperationMode();
+
+        // The application is told it has the focus once it starts
+        PushMessage(AppletMessage::FocusStateChanged);
+    }
+
+    static OperationMode GetSettingsOperationMode() {
+        return Settings::values.use_docked_mode ? OperationMode::Docked : OperationMode::Handheld;
+    }
+
+    void PushMessage(AppletMessage message) {
+        messages.push(message);
+        message_event->Signal();
+    }
+
+    std::queue<AppletMessage> messages;
+    Kernel::SharedPtr<Kernel::Event> message_event;
+    Kernel::SharedPtr<Kernel::Event> display_resolution_change_event;
+    FocusState focus_state = FocusState::InFocus;
+    OperationMode operation_mode;
+
+    CoreTiming::EventType* mode_change_event = nullptr;
+    size_t settings_callback = 0;
+};
+
 class IWindowController final : public ServiceFramework<IWindowController> {
 public:
     IWindowController() : ServiceFramework("IWindowController") {
@@ -73,45 +213,89 @@ private:
 
 class ICommonStateGetter final : public ServiceFramework<ICommonStateGetter> {
 public:
-    ICommonStateGetter() : ServiceFramework("ICommonStateGetter") {
+    explicit ICommonStateGetter(std::shared_ptr<AppletMessageQueue> msg_queue)
+        : ServiceFramework("ICommonStateGetter"), msg_queue(std::move(msg_queue)) {
         static const FunctionInfo functions[] = {
             {0, &ICommonStateGetter::GetEventHandle, "GetEventHandle"},
             {1, &ICommonStateGetter::ReceiveMessage, "ReceiveMessage"},
+            {5, &ICommonStateGetter::GetOperationMode, "GetOperationMode"},
+            {6, &ICommonStateGetter::GetPerformanceMode, "GetPerformanceMode"},
             {9, &ICommonStateGetter::GetCurrentFocusState, "GetCurrentFocusState"},
+            {60, &ICommonStateGetter::GetDefaultDisplayResolution, "GetDefaultDisplayResolution"},
+            {61, &ICommonStateGetter::GetDefaultDisplayResolutionChangeEvent,
+             "GetDefaultDisplayResolutionChangeEvent"},
         };
         RegisterHandlers(functions);
-
-        event = Kernel::Event::Create(Kernel::ResetType::OneShot, "ICommonStateGetter:Event");
     }
 
 private:
     void GetEventHandle(Kernel::HLERequestContext& ctx) {
-        event->Signal();
-
         IPC::RequestBuilder rb{ctx, 2, 1};
         rb.Push(RESULT_SUCCESS);
-        rb.PushCopyObjects(event);
+        rb.PushCopyObjects(msg_queue->GetMessageEvent());
 
-        LOG_WARNING(Service, "(STUBBED) called");
+        LOG_DEBUG(Service, "called");
     }
 
     void ReceiveMessage(Kernel::HLERequestContext& ctx) {
+        AppletMessage message;
+        if (!msg_queue->PopMessage(message)) {
+            IPC::RequestBuilder rb{ctx, 2};
+            rb.Push(ERR_NO_MESSAGES);
+            return;
+        }
+
         IPC::RequestBuilder rb{ctx, 3};
         rb.Push(RESULT_SUCCESS);
-        rb.Push<u32>(15);
+        rb.Push(static_cast<u32>(message));
 
-        LOG_WARNING(Service, "(STUBBED) called");
+        LOG_DEBUG(Service, "called, message=%u", static_cast<u32>(message));
+    }
+
+    void GetOperationMode(Kernel::HLERequestContext& ctx) {
+        IPC::RequestBuilder rb{ctx, 3};
+        rb.Push(RESULT_SUCCESS);
+        rb.Push(static_cast<u8>(msg_queue->GetOperationMode()));
+
+        LOG_DEBUG(Service, "called");
+    }
+
+    void GetPerformanceMode(Kernel::HLERequestContext& ctx) {
+        // The performance modes are numbered like the operation modes they follow
+        IPC::RequestBuilder rb{ctx, 3};
+        rb.Push(RESULT_SUCCESS);
+        rb.Push(static_cast<u32>(msg_queue->GetOperationMode()));
+
+        LOG_DEBUG(Service, "called");
     }
 
     void GetCurrentFocusState(Kernel::HLERequestContext& ctx) {
         IPC::RequestBuilder rb{ctx, 3};
         rb.Push(RESULT_SUCCESS);
-        rb.Push<u32>(1); // 1: In focus, 2/3: Out of focus(running in "background")
+        rb.Push(static_cast<u8>(msg_queue->GetFocusState()));
 
-        LOG_WARNING(Service, "(STUBBED) called");
+        LOG_DEBUG(Service, "called");
+    }
+
+    void GetDefaultDisplayResolution(Kernel::HLERequestContext& ctx) {
+        const bool is_docked = msg_queue->GetOperationMode() == OperationMode::Docked;
+        IPC::RequestBuilder rb{ctx, 4};
+        rb.Push(RESULT_SUCCESS);
+        rb.Push<u32>(is_docked ? DOCKED_DISPLAY_WIDTH : HANDHELD_DISPLAY_WIDTH);
+        rb.Push<u32>(is_docked ? DOCKED_DISPLAY_HEIGHT : HANDHELD_DISPLAY_HEIGHT);
+
+        LOG_DEBUG(Service, "called");
     }
 
-    Kernel::SharedPtr<Kernel::Event> event;
+    void GetDefaultDisplayResolutionChangeEvent(Kernel::HLERequestContext& ctx) {
+        IPC::RequestBuilder rb{ctx, 2, 1};
+        rb.Push(RESULT_SUCCESS);
+        rb.PushCopyObjects(msg_queue->GetDisplayResolutionChangeEvent());
+
+        LOG_DEBUG(Service, "called");
+    }
+
+    std::shared_ptr<AppletMessageQueue> msg_queue;
 };
 
 class IApplicationFunctions final : public ServiceFramework<IApplicationFunctions> {
@@ -145,7 +329,8 @@ public:
 
 class IApplicationProxy final : public ServiceFramework<IApplicationProxy> {
 public:
-    IApplicationProxy() : ServiceFramework("IApplicationProxy") {
+    explicit IApplicationProxy(std::shared_ptr<AppletMessageQueue> msg_queue)
+        : ServiceFramework("IApplicationProxy"), msg_queue(std::move(msg_queue)) {
         static const FunctionInfo functions[] = {
             {0, &IApplicationProxy::GetCommonStateGetter, "GetCommonStateGetter"},
             {1, &IApplicationProxy::GetSelfController, "GetSelfController"},
@@ -198,7 +383,7 @@ private:
     void GetCommonStateGetter(Kernel::HLERequestContext& ctx) {
         IPC::RequestBuilder rb{ctx, 2, 0, 0, 1};
         rb.Push(RESULT_SUCCESS);
-        rb.PushIpcInterface<ICommonStateGetter>();
+        rb.PushIpcInterface<ICommonStateGetter>(msg_queue);
         LOG_DEBUG(Service, "called");
     }
 
@@ -215,21 +400,25 @@ private:
         rb.PushIpcInterface<IApplicationFunctions>();
         LOG_DEBUG(Service, "called");
     }
+
+    std::shared_ptr<AppletMessageQueue> msg_queue;
 };
 
 void AppletOE::OpenApplicationProxy(Kernel::HLERequestContext& ctx) {
     IPC::RequestBuilder rb{ctx, 2, 0, 0, 1};
     rb.Push(RESULT_SUCCESS);
-    rb.PushIpcInterface<IApplicationProxy>();
+    rb.PushIpcInterface<IApplicationProxy>(msg_queue);
     LOG_DEBUG(Service, "called");
 }
 
-AppletOE::AppletOE() : ServiceFramework("appletOE") {
+AppletOE::AppletOE() : ServiceFramework("appletOE"), msg_queue(AppletMessageQueue::Create()) {
     static const FunctionInfo functions[] = {
         {0x00000000, &AppletOE::OpenApplicationProxy, "OpenApplicationProxy"},
     };
     RegisterHandlers(functions);
 }
 
+AppletOE::~AppletOE() = default;
+
 } // namespace AM
 } // namespace Service
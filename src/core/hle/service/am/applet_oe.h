@@ -4,19 +4,25 @@
 
 #pragma once
 
+#include <memory>
 #include "core/hle/kernel/hle_ipc.h"
 #include "core/hle/service/service.h"
 
 namespace Service {
 namespace AM {
 
+class AppletMessageQueue;
+
 class AppletOE final : public ServiceFramework<AppletOE> {
 public:
     AppletOE();
-    ~AppletOE() = default;
+    ~AppletOE();
 
 private:
     void OpenApplicationProxy(Kernel::HLERequestContext& ctx);
+
+    /// Messages to the application, shared by the interfaces of every proxy it opens
+    std::shared_ptr<AppletMessageQueue> msg_queue;
 };
 
 } // namespace AM
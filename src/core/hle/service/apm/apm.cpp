@@ -2,23 +2,166 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include "common/logging/log.h"
+#include "core/core_timing.h"
 #include "core/hle/ipc_helpers.h"
 #include "core/hle/service/apm/apm.h"
+#include "core/settings.h"
 
 namespace Service {
 namespace APM {
 
+struct PerformanceConfiguration {
+    u32 config;
+    /// Clock rate of the CPU in MHz
+    u32 cpu_clock_mhz;
+};
+
+// See https://switchbrew.org/wiki/PPC_services#PerformanceConfiguration
+constexpr std::array<PerformanceConfiguration, 16> PERFORMANCE_CONFIGURATIONS{{
+    {0x00010000, 1020},
+    {0x00010001, 1020},
+    {0x00010002, 1224},
+    {0x00020000, 1020},
+    {0x00020001, 1020},
+    {0x00020002, 1224},
+    {0x00020003, 1020},
+    {0x00020004, 1020},
+    {0x00020005, 1020},
+    {0x00020006, 1020},
+    {0x92220007, 1020},
+    {0x92220008, 1020},
+    {0x92220009, 1785},
+    {0x9222000A, 1785},
+    {0x9222000B, 1020},
+    {0x9222000C, 1020},
+}};
+
+/// Configurations the modes start with
+constexpr u32 DEFAULT_HANDHELD_CONFIG = 0x00020003;
+constexpr u32 DEFAULT_DOCKED_CONFIG = 0x00010000;
+
+/// The CPU clock of BASE_CLOCK_RATE, the one of most configurations
+constexpr u32 BASE_CPU_CLOCK_MHZ = 1020;
+/// Lowest value of the CPU clock percentage setting
+constexpr u32 MIN_CPU_CLOCK_PERCENTAGE = 10;
+
+static bool IsValidMode(PerformanceMode mode) {
+    return mode == PerformanceMode::Handheld || mode == PerformanceMode::Docked;
+}
+
+Module::Module() : configs{DEFAULT_HANDHELD_CONFIG, DEFAULT_DOCKED_CONFIG} {
+    ApplyCpuClockRate();
+}
+
+void Module::SetPerformanceConfiguration(PerformanceMode mode, u32 config) {
+    configs[static_cast<u32>(mode)] = config;
+    if (mode == GetPerformanceMode()) {
+        ApplyCpuClockRate();
+    }
+}
+
+u32 Module::GetPerformanceConfiguration(PerformanceMode mode) const {
+    return configs[static_cast<u32>(mode)];
+}
+
+PerformanceMode Module::GetPerformanceMode() const {
+    return Settings::values.use_docked_mode ? PerformanceMode::Docked : PerformanceMode::Handheld;
+}
+
+void Module::ApplyCpuClockRate() const {
+    const u32 config = GetPerformanceConfiguration(GetPerformanceMode());
+    const auto it = std::find_if(PERFORMANCE_CONFIGURATIONS.begin(),
+                                 PERFORMANCE_CONFIGURATIONS.end(),
+                                 [config](const auto& entry) { return entry.config == config; });
+    u32 cpu_clock_mhz = BASE_CPU_CLOCK_MHZ;
+    if (it != PERFORMANCE_CONFIGURATIONS.end()) {
+        cpu_clock_mhz = it->cpu_clock_mhz;
+    } else {
+        LOG_WARNING(Service_APM, "Unknown performance configuration 0x%08x", config);
+    }
+
+    const u64 percentage =
+        std::clamp(Settings::values.cpu_clock_percentage, MIN_CPU_CLOCK_PERCENTAGE, 100u);
+    const u64 clock_rate = BASE_CLOCK_RATE * cpu_clock_mhz * percentage / BASE_CPU_CLOCK_MHZ / 100;
+    CoreTiming::SetCpuClockRate(clock_rate);
+    LOG_DEBUG(Service_APM, "CPU clock set to %llu Hz by configuration 0x%08x", clock_rate, config);
+}
+
+class ISession final : public ServiceFramework<ISession> {
+public:
+    explicit ISession(std::shared_ptr<Module> module)
+        : ServiceFramework("ISession"), module(std::move(module)) {
+        static const FunctionInfo functions[] = {
+            {0, &ISession::SetPerformanceConfiguration, "SetPerformanceConfiguration"},
+            {1, &ISession::GetPerformanceConfiguration, "GetPerformanceConfiguration"},
+        };
+        RegisterHandlers(functions);
+    }
+
+private:
+    void SetPerformanceConfiguration(Kernel::HLERequestContext& ctx) {
+        IPC::RequestParser rp{ctx};
+        const auto mode = static_cast<PerformanceMode>(rp.Pop<u32>());
+        const u32 config = rp.Pop<u32>();
+        LOG_DEBUG(Service_APM, "called, mode=%u config=0x%08x", static_cast<u32>(mode), config);
+
+        IPC::RequestBuilder rb{ctx, 2};
+        if (!IsValidMode(mode)) {
+            LOG_ERROR(Service_APM, "Invalid performance mode %u", static_cast<u32>(mode));
+            rb.Push(ResultCode(ErrorModule::APM, 1));
+            return;
+        }
+        module->SetPerformanceConfiguration(mode, config);
+        rb.Push(RESULT_SUCCESS);
+    }
+
+    void GetPerformanceConfiguration(Kernel::HLERequestContext& ctx) {
+        IPC::RequestParser rp{ctx};
+        const auto mode = static_cast<PerformanceMode>(rp.Pop<u32>());
+        LOG_DEBUG(Service_APM, "called, mode=%u", static_cast<u32>(mode));
+
+        if (!IsValidMode(mode)) {
+            LOG_ERROR(Service_APM, "Invalid performance mode %u", static_cast<u32>(mode));
+            IPC::RequestBuilder rb{ctx, 2};
+            rb.Push(ResultCode(ErrorModule::APM, 1));
+            return;
+        }
+        IPC::RequestBuilder rb{ctx, 3};
+        rb.Push(RESULT_SUCCESS);
+        rb.Push(module->GetPerformanceConfiguration(mode));
+    }
+
+    std::shared_ptr<Module> module;
+};
+
 void InstallInterfaces(SM::ServiceManager& service_manager) {
-    std::make_shared<APM>()->InstallAsService(service_manager);
+    auto module = std::make_shared<Module>();
+    std::make_shared<APM>(module)->InstallAsService(service_manager);
 }
 
-APM::APM() : ServiceFramework("apm") {
+APM::APM(std::shared_ptr<Module> module) : ServiceFramework("apm"), module(std::move(module)) {
     static const FunctionInfo functions[] = {
-        {0x00000000, nullptr, "OpenSession"}, {0x00000001, nullptr, "GetPerformanceMode"},
+        {0x00000000, &APM::OpenSession, "OpenSession"},
+        {0x00000001, &APM::GetPerformanceMode, "GetPerformanceMode"},
     };
     RegisterHandlers(functions);
 }
 
+void APM::OpenSession(Kernel::HLERequestContext& ctx) {
+    IPC::RequestBuilder rb{ctx, 2, 0, 0, 1};
+    rb.Push(RESULT_SUCCESS);
+    rb.PushIpcInterface<ISession>(module);
+    LOG_DEBUG(Service_APM, "called");
+}
+
+void APM::GetPerformanceMode(Kernel::HLERequestContext& ctx) {
+    IPC::RequestBuilder rb{ctx, 3};
+    rb.Push(RESULT_SUCCESS);
+    rb.Push(static_cast<u32>(module->GetPerformanceMode()));
+    LOG_DEBUG(Service_APM, "called");
+}
+
 } // namespace APM
 } // namespace Service
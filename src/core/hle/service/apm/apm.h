@@ -4,15 +4,48 @@
 
 #pragma once
 
+#include <array>
+#include <memory>
 #include "core/hle/service/service.h"
 
 namespace Service {
 namespace APM {
 
+enum class PerformanceMode : u32 {
+    Handheld = 0,
+    Docked = 1,
+};
+
+/**
+ * Performance configurations of the modes of the console. The configuration of the current mode
+ * sets the clock rate of the emulated CPU.
+ */
+class Module final {
+public:
+    Module();
+
+    void SetPerformanceConfiguration(PerformanceMode mode, u32 config);
+    u32 GetPerformanceConfiguration(PerformanceMode mode) const;
+
+    PerformanceMode GetPerformanceMode() const;
+
+private:
+    /// Sets the CPU clock rate of the configuration of the current mode
+    void ApplyCpuClockRate() const;
+
+    std::array<u32, 2> configs;
+};
+
 class APM final : public ServiceFramework<APM> {
 public:
-    APM();
+    explicit APM(std::shared_ptr<Module> module);
     ~APM() = default;
+
+private:
+    void OpenSession(Kernel::HLERequestContext& ctx);
+    void GetPerformanceMode(Kernel::HLERequestContext& ctx);
+
+    std::shared_ptr<Module> module;
 };
 
 /// Registers all AM services with the specified service manager.
@@ -4,12 +4,14 @@
 
 #include "core/hle/service/audio/audio.h"
 #include "core/hle/service/audio/audout_u.h"
+#include "core/hle/service/audio/audren_u.h"
 
 namespace Service {
 namespace Audio {
 
 void InstallInterfaces(SM::ServiceManager& service_manager) {
     std::make_shared<AudOutU>()->InstallAsService(service_manager);
+    std::make_shared<AudRenU>()->InstallAsService(service_manager);
 }
 
 } // namespace Audio
@@ -2,24 +2,272 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include "audio_core/stream.h"
 #include "common/logging/log.h"
+#include "common/swap.h"
+#include "core/core.h"
+#include "core/core_timing.h"
 #include "core/hle/ipc_helpers.h"
+#include "core/hle/kernel/event.h"
 #include "core/hle/service/audio/audout_u.h"
+#include "core/memory.h"
+#include "core/settings.h"
 
 namespace Service {
 namespace Audio {
 
+/// Format of the only audio out, the samples are always 16-bit
+constexpr u32 DEFAULT_SAMPLE_RATE = 48000;
+constexpr u32 DEFAULT_NUM_CHANNELS = 2;
+constexpr u32 PCM_FORMAT_INT16 = 2;
+
+constexpr std::array<char, 10> DEFAULT_DEVICE_NAME{"DeviceOut"};
+
+enum class AudioState : u32 {
+    Started,
+    Stopped,
+};
+
+/// Buffer appended by the guest, samples are read from buffer + offset
+struct AudioOutBuffer {
+    u64_le next;
+    u64_le buffer;
+    u64_le capacity;
+    u64_le size;
+    u64_le offset;
+};
+static_assert(sizeof(AudioOutBuffer) == 0x28, "AudioOutBuffer has wrong size");
+
+class IAudioOut final : public ServiceFramework<IAudioOut> {
+public:
+    explicit IAudioOut(CoreTiming::EventType* buffer_release_event)
+        : ServiceFramework("IAudioOut"), buffer_release_event(buffer_release_event),
+          is_guest_timed(Settings::values.use_deterministic_mode),
+          stream(DEFAULT_SAMPLE_RATE, DEFAULT_NUM_CHANNELS,
+                 is_guest_timed ? "null" : Settings::values.sink_id,
+                 Settings::values.enable_audio_stretching, [buffer_release_event] {
+                     // Runs on the audio thread, the event is signalled on the emulation one
+                     CoreTiming::ScheduleEventThreadsafe(0, buffer_release_event, 0);
+                 }) {
+        static const FunctionInfo functions[] = {
+            {0, &IAudioOut::GetAudioOutState, "GetAudioOutState"},
+            {1, &IAudioOut::StartAudioOut, "StartAudioOut"},
+            {2, &IAudioOut::StopAudioOut, "StopAudioOut"},
+            {3, &IAudioOut::AppendAudioOutBuffer, "AppendAudioOutBuffer"},
+            {4, &IAudioOut::RegisterBufferEvent, "RegisterBufferEvent"},
+            {5, &IAudioOut::GetReleasedAudioOutBuffer, "GetReleasedAudioOutBuffer"},
+            {6, &IAudioOut::ContainsAudioOutBuffer, "ContainsAudioOutBuffer"},
+        };
+        RegisterHandlers(functions);
+
+        buffer_event = Kernel::Event::Create(Kernel::ResetType::OneShot, "IAudioOut:BufferEvent");
+    }
+
+    /// Signals the buffer event if buffers were released since it was cleared
+    void SignalReleasedBuffers() {
+        if (is_guest_timed) {
+            ReleaseGuestTimedBuffers();
+        }
+        buffer_event->Signal();
+    }
+
+private:
+    void GetAudioOutState(Kernel::HLERequestContext& ctx) {
+        LOG_DEBUG(Service_Audio, "called");
+        IPC::RequestBuilder rb{ctx, 3};
+        rb.Push(RESULT_SUCCESS);
+        rb.Push(static_cast<u32>(stream.IsPlaying() ? AudioState::Started : AudioState::Stopped));
+    }
+
+    void StartAudioOut(Kernel::HLERequestContext& ctx) {
+        LOG_DEBUG(Service_Audio, "called");
+        const bool was_playing = stream.IsPlaying();
+        stream.Play();
+        if (is_guest_timed && !was_playing) {
+            // The queued buffers start playing now
+            guest_timed_end_ticks = CoreTiming::GetTicks();
+            for (GuestTimedBuffer& buffer : guest_timed_buffers) {
+                ScheduleGuestTimedBuffer(buffer);
+            }
+        }
+        IPC::RequestBuilder rb{ctx, 2};
+        rb.Push(RESULT_SUCCESS);
+    }
+
+    void StopAudioOut(Kernel::HLERequestContext& ctx) {
+        LOG_DEBUG(Service_Audio, "called");
+        stream.Stop();
+        IPC::RequestBuilder rb{ctx, 2};
+        rb.Push(RESULT_SUCCESS);
+    }
+
+    void AppendAudioOutBuffer(Kernel::HLERequestContext& ctx) {
+        IPC::RequestParser rp{ctx};
+        const u64 tag = rp.Pop<u64>();
+
+        AudioOutBuffer out_buffer{};
+        ctx.BufferViewA().Read(0, &out_buffer, sizeof(out_buffer));
+        LOG_TRACE(Service_Audio, "called, tag=0x%llx size=0x%llx", tag, out_buffer.size);
+
+        // Copied right away, the guest may reuse the memory once the buffer is released
+        std::vector<s16> samples(out_buffer.size / sizeof(s16));
+        Memory::ReadBlock(out_buffer.buffer + out_buffer.offset, samples.data(),
+                          samples.size() * sizeof(s16));
+        if (is_guest_timed) {
+            const u64 num_frames = samples.size() / DEFAULT_NUM_CHANNELS;
+            guest_timed_buffers.push_back(
+                {tag, num_frames * BASE_CLOCK_RATE / DEFAULT_SAMPLE_RATE, 0});
+            if (stream.IsPlaying()) {
+                ScheduleGuestTimedBuffer(guest_timed_buffers.back());
+            }
+        } else {
+            stream.SetTimeScale(Core::System::GetInstance().perf_stats.GetLastFrameTimeScale());
+            stream.QueueBuffer({tag, std::move(samples)});
+        }
+
+        IPC::RequestBuilder rb{ctx, 2};
+        rb.Push(RESULT_SUCCESS);
+    }
+
+    void RegisterBufferEvent(Kernel::HLERequestContext& ctx) {
+        LOG_DEBUG(Service_Audio, "called");
+        IPC::RequestBuilder rb{ctx, 2, 1};
+        rb.Push(RESULT_SUCCESS);
+        rb.PushCopyObjects(buffer_event);
+    }
+
+    void GetReleasedAudioOutBuffer(Kernel::HLERequestContext& ctx) {
+        const auto output_buffer = ctx.BufferViewB();
+        const size_t max_count = output_buffer.Size() / sizeof(u64);
+        std::vector<u64> tags;
+        if (is_guest_timed) {
+            const size_t count = std::min(max_count, guest_timed_released_tags.size());
+            tags.assign(guest_timed_released_tags.begin(),
+                        guest_timed_released_tags.begin() + count);
+            guest_timed_released_tags.erase(guest_timed_released_tags.begin(),
+                                            guest_timed_released_tags.begin() + count);
+        } else {
+            tags = stream.PopReleasedBuffers(max_count);
+        }
+        output_buffer.Write(0, tags.data(), tags.size() * sizeof(u64));
+        LOG_TRACE(Service_Audio, "called, count=%zu", tags.size());
+
+        // Signalled again by the next release
+        buffer_event->Clear();
+
+        IPC::RequestBuilder rb{ctx, 3};
+        rb.Push(RESULT_SUCCESS);
+        rb.Push(static_cast<u32>(tags.size()));
+    }
+
+    void ContainsAudioOutBuffer(Kernel::HLERequestContext& ctx) {
+        IPC::RequestParser rp{ctx};
+        const u64 tag = rp.Pop<u64>();
+        LOG_DEBUG(Service_Audio, "called, tag=0x%llx", tag);
+        IPC::RequestBuilder rb{ctx, 3};
+        rb.Push(RESULT_SUCCESS);
+        rb.Push<u32>(is_guest_timed ? ContainsGuestTimedBuffer(tag) : stream.ContainsBuffer(tag));
+    }
+
+    /// Buffer played on the guest clock in deterministic mode, in place of the stream
+    struct GuestTimedBuffer {
+        u64 tag;
+        u64 duration_ticks;
+        /// Guest time the buffer is done playing at, set once the audio out plays it
+        u64 release_ticks;
+    };
+
+    /// Plays a buffer after the ones before it, and schedules its release for when it ends
+    void ScheduleGuestTimedBuffer(GuestTimedBuffer& buffer) {
+        const u64 now = CoreTiming::GetTicks();
+        guest_timed_end_ticks = std::max(guest_timed_end_ticks, now) + buffer.duration_ticks;
+        buffer.release_ticks = guest_timed_end_ticks;
+        CoreTiming::ScheduleEvent(static_cast<s64>(buffer.release_ticks - now),
+                                  buffer_release_event);
+    }
+
+    /// Releases the buffers that are done playing. Releases scheduled before the audio out was
+    /// stopped find nothing to release.
+    void ReleaseGuestTimedBuffers() {
+        if (!stream.IsPlaying()) {
+            return;
+        }
+        const u64 now = CoreTiming::GetTicks();
+        while (!guest_timed_buffers.empty() && guest_timed_buffers.front().release_ticks != 0 &&
+               guest_timed_buffers.front().release_ticks <= now) {
+            guest_timed_released_tags.push_back(guest_timed_buffers.front().tag);
+            guest_timed_buffers.pop_front();
+        }
+    }
+
+    bool ContainsGuestTimedBuffer(u64 tag) const {
+        return std::any_of(guest_timed_buffers.begin(), guest_timed_buffers.end(),
+                           [tag](const GuestTimedBuffer& buffer) { return buffer.tag == tag; }) ||
+               std::find(guest_timed_released_tags.begin(), guest_timed_released_tags.end(),
+                         tag) != guest_timed_released_tags.end();
+    }
+
+    CoreTiming::EventType* buffer_release_event;
+    /// Whether the buffers are released on the guest clock rather than by the audio thread, which
+    /// is the case in deterministic mode. The audio is muted then.
+    const bool is_guest_timed;
+    std::deque<GuestTimedBuffer> guest_timed_buffers;
+    std::vector<u64> guest_timed_released_tags;
+    /// Guest time the last buffer scheduled is done playing at
+    u64 guest_timed_end_ticks = 0;
+
+    AudioCore::Stream stream;
+    Kernel::SharedPtr<Kernel::Event> buffer_event;
+};
+
 void AudOutU::ListAudioOuts(Kernel::HLERequestContext& ctx) {
-    LOG_WARNING(Service, "(STUBBED) called");
-    IPC::RequestBuilder rb{ctx, 2};
+    LOG_DEBUG(Service_Audio, "called");
+    const auto buffer = ctx.BufferViewB();
+    buffer.Write(0, DEFAULT_DEVICE_NAME.data(),
+                 std::min(buffer.Size(), DEFAULT_DEVICE_NAME.size()));
+
+    IPC::RequestBuilder rb{ctx, 3};
     rb.Push(RESULT_SUCCESS);
+    rb.Push<u32>(1);
+}
+
+void AudOutU::OpenAudioOut(Kernel::HLERequestContext& ctx) {
+    LOG_DEBUG(Service_Audio, "called");
+
+    // The device name and the requested format are ignored, the only audio out has a fixed one
+    auto out = std::make_shared<IAudioOut>(buffer_release_event);
+    audio_out = out;
+
+    IPC::RequestBuilder rb{ctx, 6, 0, 0, 1};
+    rb.Push(RESULT_SUCCESS);
+    rb.Push<u32>(DEFAULT_SAMPLE_RATE);
+    rb.Push<u32>(DEFAULT_NUM_CHANNELS);
+    rb.Push<u32>(PCM_FORMAT_INT16);
+    rb.Push(static_cast<u32>(AudioState::Stopped));
+    rb.PushIpcInterface(std::move(out));
+}
+
+void AudOutU::BufferReleaseCallback(u64 userdata, int cycles_late) {
+    if (auto out = audio_out.lock()) {
+        out->SignalReleasedBuffers();
+    }
 }
 
 AudOutU::AudOutU() : ServiceFramework("audout:u") {
     static const FunctionInfo functions[] = {
         {0x00000000, &AudOutU::ListAudioOuts, "ListAudioOuts"},
+        {0x00000001, &AudOutU::OpenAudioOut, "OpenAudioOut"},
     };
     RegisterHandlers(functions);
+
+    buffer_release_event = CoreTiming::RegisterEvent(
+        "AudOutU::BufferRelease",
+        [this](u64 userdata, int cycles_late) { BufferReleaseCallback(userdata, cycles_late); });
 }
 
 } // namespace Audio
@@ -4,12 +4,19 @@
 
 #pragma once
 
+#include <memory>
 #include "core/hle/kernel/hle_ipc.h"
 #include "core/hle/service/service.h"
 
+namespace CoreTiming {
+struct EventType;
+}
+
 namespace Service {
 namespace Audio {
 
+class IAudioOut;
+
 class AudOutU final : public ServiceFramework<AudOutU> {
 public:
     AudOutU();
@@ -17,6 +24,15 @@ public:
 
 private:
     void ListAudioOuts(Kernel::HLERequestContext& ctx);
+    void OpenAudioOut(Kernel::HLERequestContext& ctx);
+
+    /// Signals the buffer events of the audio out, scheduled by its audio thread or, in
+    /// deterministic mode, on the guest clock
+    void BufferReleaseCallback(u64 userdata, int cycles_late);
+
+    /// Last audio out opened, the one its audio thread releases buffers of
+    std::weak_ptr<IAudioOut> audio_out;
+    CoreTiming::EventType* buffer_release_event;
 };
 
 } // namespace Audio
@@ -0,0 +1,549 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+#include "audio_core/mixer.h"
+#include "audio_core/stream.h"
+#include "common/alignment.h"
+#include "common/assert.h"
+#include "common/common_funcs.h"
+#include "common/logging/log.h"
+#include "common/swap.h"
+#include "core/core.h"
+#include "core/core_timing.h"
+#include "core/hle/ipc_helpers.h"
+#include "core/hle/kernel/event.h"
+#include "core/hle/service/audio/audren_u.h"
+#include "core/memory.h"
+#include "core/settings.h"
+
+namespace Service {
+namespace Audio {
+
+/// Channels of the mixed output, the voices are mixed down to stereo
+constexpr u32 OUTPUT_NUM_CHANNELS = 2;
+/// Frames that may be queued to the audio thread, the following ones are dropped
+constexpr size_t MAX_QUEUED_FRAMES = 10;
+/// Wave buffers of each voice, used as a ring
+constexpr size_t NUM_WAVE_BUFFERS = 4;
+
+struct AudioRendererParameter {
+    u32_le sample_rate;
+    u32_le sample_count;
+    u32_le mix_buffer_count;
+    u32_le submix_count;
+    u32_le voice_count;
+    u32_le sink_count;
+    u32_le effect_count;
+    u32_le performance_frame_count;
+    u8 is_voice_drop_enabled;
+    INSERT_PADDING_BYTES(3);
+    u32_le splitter_count;
+    u32_le splitter_send_channel_count;
+    INSERT_PADDING_WORDS(1);
+    u32_le revision;
+};
+static_assert(sizeof(AudioRendererParameter) == 52, "AudioRendererParameter has wrong size");
+
+/// Header of the requests and responses of RequestUpdateAudioRenderer, sizes are in bytes
+struct UpdateDataHeader {
+    u32_le revision;
+    u32_le behavior_size;
+    u32_le memory_pools_size;
+    u32_le voices_size;
+    u32_le voice_resource_size;
+    u32_le effects_size;
+    u32_le mixes_size;
+    u32_le sinks_size;
+    u32_le performance_manager_size;
+    INSERT_PADDING_WORDS(6);
+    u32_le total_size;
+};
+static_assert(sizeof(UpdateDataHeader) == 0x40, "UpdateDataHeader has wrong size");
+
+enum class MemoryPoolState : u32 {
+    Invalid,
+    Unknown,
+    RequestDetach,
+    Detached,
+    RequestAttach,
+    Attached,
+    Released,
+};
+
+struct MemoryPoolInfo {
+    u64_le pool_address;
+    u64_le pool_size;
+    MemoryPoolState pool_state;
+    INSERT_PADDING_WORDS(3);
+};
+static_assert(sizeof(MemoryPoolInfo) == 0x20, "MemoryPoolInfo has wrong size");
+
+struct MemoryPoolEntry {
+    MemoryPoolState state;
+    INSERT_PADDING_WORDS(3);
+};
+static_assert(sizeof(MemoryPoolEntry) == 0x10, "MemoryPoolEntry has wrong size");
+
+enum class PlayState : u8 {
+    Started,
+    Stopped,
+    Paused,
+};
+
+enum class SampleFormat : u8 {
+    Invalid,
+    Pcm8,
+    Pcm16,
+    Pcm24,
+    Pcm32,
+    PcmFloat,
+    Adpcm,
+};
+
+struct BiquadFilter {
+    u8 enable;
+    INSERT_PADDING_BYTES(1);
+    std::array<s16_le, 3> numerator;
+    std::array<s16_le, 2> denominator;
+};
+static_assert(sizeof(BiquadFilter) == 0xc, "BiquadFilter has wrong size");
+
+struct WaveBuffer {
+    u64_le buffer_address;
+    u64_le buffer_size;
+    s32_le start_sample_offset;
+    s32_le end_sample_offset;
+    u8 is_looping;
+    u8 end_of_stream;
+    u8 sent_to_server;
+    INSERT_PADDING_BYTES(5);
+    u64_le context_address;
+    u64_le context_size;
+    INSERT_PADDING_BYTES(8);
+};
+static_assert(sizeof(WaveBuffer) == 0x38, "WaveBuffer has wrong size");
+
+struct VoiceInfo {
+    u32_le id;
+    u32_le node_id;
+    u8 is_new;
+    u8 is_in_use;
+    PlayState play_state;
+    SampleFormat sample_format;
+    u32_le sample_rate;
+    u32_le priority;
+    u32_le sorting_order;
+    u32_le channel_count;
+    float_le pitch;
+    float_le volume;
+    std::array<BiquadFilter, 2> biquad_filter;
+    /// Number of the wave buffers queued, starting at wave_buffer_head
+    u32_le wave_buffer_count;
+    u16_le wave_buffer_head;
+    INSERT_PADDING_BYTES(6);
+    u64_le additional_params_address;
+    u64_le additional_params_size;
+    u32_le mix_id;
+    u32_le splitter_info_id;
+    std::array<WaveBuffer, NUM_WAVE_BUFFERS> wave_buffer;
+    std::array<u32_le, 6> voice_channel_resource_ids;
+    INSERT_PADDING_BYTES(24);
+};
+static_assert(sizeof(VoiceInfo) == 0x170, "VoiceInfo has wrong size");
+
+struct VoiceOutStatus {
+    u64_le played_sample_count;
+    u32_le wave_buffer_consumed;
+    u32_le voice_drops_count;
+};
+static_assert(sizeof(VoiceOutStatus) == 0x10, "VoiceOutStatus has wrong size");
+
+/// Sizes of the sections of the responses
+constexpr u32 BEHAVIOR_OUT_SIZE = 0xb0;
+constexpr u32 EFFECT_OUT_SIZE = 0x10;
+constexpr u32 SINK_OUT_SIZE = 0x20;
+constexpr u32 PERFORMANCE_OUT_SIZE = 0x10;
+
+/// Playback state of a voice, kept across the updates of the guest
+struct VoiceState {
+    VoiceInfo info{};
+    VoiceOutStatus out_status{};
+
+    /// Wave buffer being played, and the number of frames played from it
+    u32 wave_index = 0;
+    size_t frame_offset = 0;
+    /// Samples of the wave buffer being played, read from guest memory when it starts
+    std::vector<s16> samples;
+    bool is_buffer_loaded = false;
+
+    /// Wave buffers left to play
+    u32 num_queued = 0;
+    /// Wave buffers played since the guest was last told about the consumed ones
+    u32 num_unreported = 0;
+
+    AudioCore::ResamplerState resampler;
+    /// Volume the previous frame ended with, the next one ramps from it to the new volume
+    float previous_volume = 0.0f;
+};
+
+class IAudioRenderer final : public ServiceFramework<IAudioRenderer> {
+public:
+    explicit IAudioRenderer(const AudioRendererParameter& params)
+        : ServiceFramework("IAudioRenderer"), params(params), voices(params.voice_count),
+          stream(params.sample_rate, OUTPUT_NUM_CHANNELS, Settings::values.sink_id,
+                 Settings::values.enable_audio_stretching, [] {}) {
+        static const FunctionInfo functions[] = {
+            {0, &IAudioRenderer::GetAudioRendererSampleRate, "GetAudioRendererSampleRate"},
+            {1, &IAudioRenderer::GetAudioRendererSampleCount, "GetAudioRendererSampleCount"},
+            {2, &IAudioRenderer::GetAudioRendererMixBufferCount,
+             "GetAudioRendererMixBufferCount"},
+            {3, &IAudioRenderer::GetAudioRendererState, "GetAudioRendererState"},
+            {4, &IAudioRenderer::RequestUpdateAudioRenderer, "RequestUpdateAudioRenderer"},
+            {5, &IAudioRenderer::StartAudioRenderer, "StartAudioRenderer"},
+            {6, &IAudioRenderer::StopAudioRenderer, "StopAudioRenderer"},
+            {7, &IAudioRenderer::QuerySystemEvent, "QuerySystemEvent"},
+            {8, nullptr, "SetAudioRendererRenderingTimeLimit"},
+            {9, nullptr, "GetAudioRendererRenderingTimeLimit"},
+        };
+        RegisterHandlers(functions);
+
+        system_event =
+            Kernel::Event::Create(Kernel::ResetType::OneShot, "IAudioRenderer:SystemEvent");
+        mix_buffer.resize(params.sample_count * OUTPUT_NUM_CHANNELS);
+        voice_buffer.resize(params.sample_count * OUTPUT_NUM_CHANNELS);
+        stream.Play();
+    }
+
+    /// Guest ticks between two frames of the renderer
+    s64 GetFramePeriod() const {
+        return static_cast<s64>(BASE_CLOCK_RATE * params.sample_count / params.sample_rate);
+    }
+
+    /// Mixes a frame of the voices, queues it to the stream and signals the guest
+    void Render() {
+        if (!is_started) {
+            return;
+        }
+
+        std::fill(mix_buffer.begin(), mix_buffer.end(), 0);
+        for (VoiceState& voice : voices) {
+            MixVoice(voice);
+        }
+
+        // The emulation never waits for the audio thread, frames it can't keep up with are lost
+        if (stream.GetQueuedBufferCount() < MAX_QUEUED_FRAMES) {
+            std::vector<s16> samples(mix_buffer.size());
+            AudioCore::ClampSamples(samples.data(), mix_buffer.data(), mix_buffer.size());
+            stream.SetTimeScale(Core::System::GetInstance().perf_stats.GetLastFrameTimeScale());
+            stream.QueueBuffer({next_tag++, std::move(samples)});
+        }
+
+        system_event->Signal();
+    }
+
+private:
+    void GetAudioRendererSampleRate(Kernel::HLERequestContext& ctx) {
+        IPC::RequestBuilder rb{ctx, 3};
+        rb.Push(RESULT_SUCCESS);
+        rb.Push<u32>(params.sample_rate);
+        LOG_DEBUG(Service_Audio, "called");
+    }
+
+    void GetAudioRendererSampleCount(Kernel::HLERequestContext& ctx) {
+        IPC::RequestBuilder rb{ctx, 3};
+        rb.Push(RESULT_SUCCESS);
+        rb.Push<u32>(params.sample_count);
+        LOG_DEBUG(Service_Audio, "called");
+    }
+
+    void GetAudioRendererMixBufferCount(Kernel::HLERequestContext& ctx) {
+        IPC::RequestBuilder rb{ctx, 3};
+        rb.Push(RESULT_SUCCESS);
+        rb.Push<u32>(params.mix_buffer_count);
+        LOG_DEBUG(Service_Audio, "called");
+    }
+
+    void GetAudioRendererState(Kernel::HLERequestContext& ctx) {
+        IPC::RequestBuilder rb{ctx, 3};
+        rb.Push(RESULT_SUCCESS);
+        rb.Push<u32>(is_started ? 0 : 1);
+        LOG_DEBUG(Service_Audio, "called");
+    }
+
+    void RequestUpdateAudioRenderer(Kernel::HLERequestContext& ctx) {
+        const std::vector<u8> input = ctx.BufferViewA().ReadAll();
+        UpdateDataHeader input_header{};
+        if (input.size() < sizeof(input_header)) {
+            LOG_ERROR(Service_Audio, "update of 0x%zx bytes is too small", input.size());
+            IPC::RequestBuilder rb{ctx, 2};
+            rb.Push(RESULT_SUCCESS);
+            return;
+        }
+        std::memcpy(&input_header, input.data(), sizeof(input_header));
+
+        // Requests start with the behavior, then the memory pools, the voice resources and the
+        // voices. The effects, mixes and sinks that follow aren't emulated.
+        size_t offset = sizeof(UpdateDataHeader) + input_header.behavior_size;
+        const size_t num_memory_pools = input_header.memory_pools_size / sizeof(MemoryPoolInfo);
+        const size_t memory_pools_offset = offset;
+        offset += input_header.memory_pools_size + input_header.voice_resource_size;
+        const size_t num_voices =
+            std::min<size_t>(input_header.voices_size / sizeof(VoiceInfo), voices.size());
+        if (offset + num_voices * sizeof(VoiceInfo) > input.size() ||
+            memory_pools_offset + num_memory_pools * sizeof(MemoryPoolInfo) > input.size()) {
+            LOG_ERROR(Service_Audio, "update of 0x%zx bytes is truncated", input.size());
+            IPC::RequestBuilder rb{ctx, 2};
+            rb.Push(RESULT_SUCCESS);
+            return;
+        }
+
+        for (size_t i = 0; i < num_voices; ++i) {
+            VoiceInfo info;
+            std::memcpy(&info, &input[offset + i * sizeof(VoiceInfo)], sizeof(info));
+            UpdateVoice(voices[i], info);
+        }
+
+        const u32 num_pool_entries = (params.effect_count + params.voice_count * 4);
+        UpdateDataHeader output_header{};
+        output_header.revision = params.revision;
+        output_header.behavior_size = BEHAVIOR_OUT_SIZE;
+        output_header.memory_pools_size = num_pool_entries * sizeof(MemoryPoolEntry);
+        output_header.voices_size = params.voice_count * sizeof(VoiceOutStatus);
+        output_header.effects_size = params.effect_count * EFFECT_OUT_SIZE;
+        output_header.sinks_size = params.sink_count * SINK_OUT_SIZE;
+        output_header.performance_manager_size = PERFORMANCE_OUT_SIZE;
+        output_header.total_size = sizeof(UpdateDataHeader) + output_header.behavior_size +
+                                   output_header.memory_pools_size + output_header.voices_size +
+                                   output_header.effects_size + output_header.sinks_size +
+                                   output_header.performance_manager_size;
+
+        std::vector<u8>& output = ctx.ScratchBuffer(0, output_header.total_size);
+        std::memcpy(output.data(), &output_header, sizeof(output_header));
+        offset = sizeof(UpdateDataHeader);
+
+        // Memory pools are attached and detached as soon as the guest asks
+        for (size_t i = 0; i < std::min<size_t>(num_memory_pools, num_pool_entries); ++i) {
+            MemoryPoolInfo pool;
+            std::memcpy(&pool, &input[memory_pools_offset + i * sizeof(pool)], sizeof(pool));
+            MemoryPoolEntry entry{};
+            if (pool.pool_state == MemoryPoolState::RequestAttach) {
+                entry.state = MemoryPoolState::Attached;
+            } else if (pool.pool_state == MemoryPoolState::RequestDetach) {
+                entry.state = MemoryPoolState::Detached;
+            } else {
+                entry.state = pool.pool_state;
+            }
+            std::memcpy(&output[offset + i * sizeof(entry)], &entry, sizeof(entry));
+        }
+        offset += output_header.memory_pools_size;
+
+        for (size_t i = 0; i < voices.size(); ++i) {
+            std::memcpy(&output[offset + i * sizeof(VoiceOutStatus)], &voices[i].out_status,
+                        sizeof(VoiceOutStatus));
+            voices[i].num_unreported = 0;
+        }
+
+        ctx.BufferViewB().WriteAll(output);
+        LOG_TRACE(Service_Audio, "called, voices=%zu", num_voices);
+
+        IPC::RequestBuilder rb{ctx, 2};
+        rb.Push(RESULT_SUCCESS);
+    }
+
+    void StartAudioRenderer(Kernel::HLERequestContext& ctx) {
+        is_started = true;
+        IPC::RequestBuilder rb{ctx, 2};
+        rb.Push(RESULT_SUCCESS);
+        LOG_DEBUG(Service_Audio, "called");
+    }
+
+    void StopAudioRenderer(Kernel::HLERequestContext& ctx) {
+        is_started = false;
+        IPC::RequestBuilder rb{ctx, 2};
+        rb.Push(RESULT_SUCCESS);
+        LOG_DEBUG(Service_Audio, "called");
+    }
+
+    void QuerySystemEvent(Kernel::HLERequestContext& ctx) {
+        IPC::RequestBuilder rb{ctx, 2, 1};
+        rb.Push(RESULT_SUCCESS);
+        rb.PushCopyObjects(system_event);
+        LOG_DEBUG(Service_Audio, "called");
+    }
+
+    static void UpdateVoice(VoiceState& voice, const VoiceInfo& info) {
+        if (info.is_new) {
+            voice = {};
+            voice.wave_index = info.wave_buffer_head % NUM_WAVE_BUFFERS;
+            voice.previous_volume = info.volume;
+        }
+        voice.info = info;
+
+        // The guest doesn't know about the buffers played since the previous update yet
+        voice.num_queued = info.wave_buffer_count > voice.num_unreported
+                               ? info.wave_buffer_count - voice.num_unreported
+                               : 0;
+    }
+
+    /// Reads the samples of the wave buffer a voice is at, between its start and end offsets
+    static void LoadWaveBuffer(VoiceState& voice) {
+        const WaveBuffer& wave_buffer = voice.info.wave_buffer[voice.wave_index];
+        const size_t num_channels = voice.info.channel_count;
+        const size_t num_frames = wave_buffer.buffer_size / (sizeof(s16) * num_channels);
+        const size_t start =
+            std::min<size_t>(std::max<s32>(wave_buffer.start_sample_offset, 0), num_frames);
+        const size_t end = wave_buffer.end_sample_offset > 0
+                               ? std::min<size_t>(wave_buffer.end_sample_offset, num_frames)
+                               : num_frames;
+
+        voice.samples.resize(end > start ? (end - start) * num_channels : 0);
+        Memory::ReadBlock(wave_buffer.buffer_address + start * num_channels * sizeof(s16),
+                          voice.samples.data(), voice.samples.size() * sizeof(s16));
+        voice.frame_offset = 0;
+        voice.is_buffer_loaded = true;
+    }
+
+    /// Resamples the next frame of a voice to the output rate and adds it to the mix buffer
+    void MixVoice(VoiceState& voice) {
+        const VoiceInfo& info = voice.info;
+        if (!info.is_in_use || info.play_state != PlayState::Started) {
+            return;
+        }
+
+        const u32 num_channels = info.channel_count;
+        if (info.sample_format != SampleFormat::Pcm16 || num_channels == 0 ||
+            num_channels > AudioCore::MAX_CHANNELS) {
+            LOG_TRACE(Service_Audio, "unimplemented voice format %u with %u channels",
+                      static_cast<u32>(info.sample_format), num_channels);
+            return;
+        }
+
+        const u32 step = static_cast<u32>(info.sample_rate * info.pitch * 0x10000 /
+                                          params.sample_rate);
+        size_t num_frames = 0;
+        while (num_frames < params.sample_count && voice.num_queued > 0) {
+            if (!voice.is_buffer_loaded) {
+                LoadWaveBuffer(voice);
+            }
+
+            size_t num_consumed;
+            const size_t num_input_frames = voice.samples.size() / num_channels;
+            num_frames += AudioCore::Resample(
+                &voice_buffer[num_frames * num_channels], params.sample_count - num_frames,
+                voice.samples.data() + voice.frame_offset * num_channels,
+                num_input_frames - voice.frame_offset, num_channels, step, voice.resampler,
+                num_consumed);
+            voice.frame_offset += num_consumed;
+            voice.out_status.played_sample_count += num_consumed;
+
+            if (voice.frame_offset < num_input_frames) {
+                continue;
+            }
+            if (info.wave_buffer[voice.wave_index].is_looping && num_input_frames > 0) {
+                voice.frame_offset = 0;
+                continue;
+            }
+
+            voice.is_buffer_loaded = false;
+            voice.wave_index = (voice.wave_index + 1) % NUM_WAVE_BUFFERS;
+            --voice.num_queued;
+            ++voice.num_unreported;
+            ++voice.out_status.wave_buffer_consumed;
+        }
+
+        if (num_channels == 1) {
+            // Mono voices play on both channels, expanded in place from the end
+            for (size_t i = num_frames; i-- > 0;) {
+                voice_buffer[i * 2] = voice_buffer[i * 2 + 1] = voice_buffer[i];
+            }
+        }
+        AudioCore::MixSamples(mix_buffer.data(), voice_buffer.data(), num_frames,
+                              voice.previous_volume, info.volume);
+        voice.previous_volume = info.volume;
+    }
+
+    AudioRendererParameter params;
+    std::vector<VoiceState> voices;
+    AudioCore::Stream stream;
+    Kernel::SharedPtr<Kernel::Event> system_event;
+    bool is_started = false;
+
+    /// Mix of the voices and the samples of the voice being mixed, interleaved stereo frames
+    std::vector<s32> mix_buffer;
+    std::vector<s16> voice_buffer;
+
+    /// Tag of the next frame queued to the stream
+    u64 next_tag = 0;
+};
+
+void AudRenU::OpenAudioRenderer(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const auto params = rp.PopRaw<AudioRendererParameter>();
+    LOG_DEBUG(Service_Audio, "called, sample_rate=%u sample_count=%u voice_count=%u",
+              params.sample_rate, params.sample_count, params.voice_count);
+
+    auto renderer = std::make_shared<IAudioRenderer>(params);
+    audio_renderer = renderer;
+
+    // Rendering restarts with the new renderer
+    CoreTiming::UnscheduleEvent(render_event, 0);
+    CoreTiming::ScheduleEvent(renderer->GetFramePeriod(), render_event);
+
+    IPC::RequestBuilder rb{ctx, 2, 0, 0, 1};
+    rb.Push(RESULT_SUCCESS);
+    rb.PushIpcInterface(std::move(renderer));
+}
+
+void AudRenU::GetAudioRendererWorkBufferSize(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const auto params = rp.PopRaw<AudioRendererParameter>();
+
+    // Estimate of the memory the system renderer works in. The guest allocates it for the
+    // renderer, which doesn't use it.
+    u64 size = Common::AlignUp(4 * params.mix_buffer_count, 0x40);
+    size += params.submix_count * 0x400;
+    size += (params.submix_count + 1) * 0x940;
+    size += params.voice_count * 0x3F0;
+    size += Common::AlignUp(8 * (params.submix_count + 1), 0x10);
+    size += Common::AlignUp(8 * params.voice_count, 0x10);
+    size += Common::AlignUp((0x3C0 * (params.sink_count + params.submix_count) +
+                             4 * params.sample_count) *
+                                (params.mix_buffer_count + 6),
+                            0x40);
+    size += (params.effect_count + params.voice_count * 4) * sizeof(MemoryPoolInfo) + 0x50;
+    size += params.sink_count * 0x170;
+    size = Common::AlignUp(size, 0x1000);
+
+    IPC::RequestBuilder rb{ctx, 4};
+    rb.Push(RESULT_SUCCESS);
+    rb.Push<u64>(size);
+    LOG_DEBUG(Service_Audio, "called, size=0x%llx", size);
+}
+
+void AudRenU::RenderCallback(u64 userdata, int cycles_late) {
+    if (auto renderer = audio_renderer.lock()) {
+        renderer->Render();
+        CoreTiming::ScheduleEvent(renderer->GetFramePeriod() - cycles_late, render_event);
+    }
+}
+
+AudRenU::AudRenU() : ServiceFramework("audren:u") {
+    static const FunctionInfo functions[] = {
+        {0, &AudRenU::OpenAudioRenderer, "OpenAudioRenderer"},
+        {1, &AudRenU::GetAudioRendererWorkBufferSize, "GetAudioRendererWorkBufferSize"},
+        {2, nullptr, "GetAudioDevice"},
+    };
+    RegisterHandlers(functions);
+
+    render_event = CoreTiming::RegisterEvent(
+        "AudRenU::Render",
+        [this](u64 userdata, int cycles_late) { RenderCallback(userdata, cycles_late); });
+}
+
+} // namespace Audio
+} // namespace Service
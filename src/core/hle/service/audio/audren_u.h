@@ -0,0 +1,38 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include "core/hle/kernel/hle_ipc.h"
+#include "core/hle/service/service.h"
+
+namespace CoreTiming {
+struct EventType;
+}
+
+namespace Service {
+namespace Audio {
+
+class IAudioRenderer;
+
+class AudRenU final : public ServiceFramework<AudRenU> {
+public:
+    AudRenU();
+    ~AudRenU() = default;
+
+private:
+    void OpenAudioRenderer(Kernel::HLERequestContext& ctx);
+    void GetAudioRendererWorkBufferSize(Kernel::HLERequestContext& ctx);
+
+    /// Renders a frame of the audio renderer, every sample_count samples of guest time
+    void RenderCallback(u64 userdata, int cycles_late);
+
+    /// Last audio renderer opened, the one that is rendered
+    std::weak_ptr<IAudioRenderer> audio_renderer;
+    CoreTiming::EventType* render_event;
+};
+
+} // namespace Audio
+} // namespace Service
@@ -0,0 +1,86 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <utility>
+#include "core/hle/lock.h"
+#include "core/hle/service/command_stats.h"
+
+namespace Service {
+
+namespace {
+
+struct Entry {
+    std::string command_name;
+    bool is_implemented = false;
+    CommandStats stats;
+};
+
+/**
+ * Statistics of every command that was registered or called. The mutex only guards the map itself:
+ * services are created both with and without the HLE lock held, while the statistics are updated
+ * and read with the HLE lock held.
+ */
+std::mutex table_mutex;
+std::map<std::pair<std::string, u32>, Entry> table;
+
+} // Anonymous namespace
+
+void CommandStats::Record(u64 elapsed_ns, u64 bytes) {
+    ++calls;
+    total_ns += elapsed_ns;
+    max_ns = std::max(max_ns, elapsed_ns);
+    buffer_bytes += bytes;
+
+    size_t bucket = 0;
+    while (bucket + 1 < NUM_LATENCY_BUCKETS && (elapsed_ns >> bucket) != 0) {
+        ++bucket;
+    }
+    ++latency_histogram[bucket];
+}
+
+u64 CommandStats::GetMedianBoundNs() const {
+    u64 seen_calls = 0;
+    for (size_t bucket = 0; bucket < latency_histogram.size(); ++bucket) {
+        seen_calls += latency_histogram[bucket];
+        if (seen_calls * 2 >= calls) {
+            return u64(1) << bucket;
+        }
+    }
+    return 0;
+}
+
+CommandStats& GetCommandStats(const std::string& service_name, u32 command_id,
+                              const char* command_name, bool is_implemented) {
+    std::lock_guard<std::mutex> lock(table_mutex);
+    Entry& entry = table[{service_name, command_id}];
+    if (command_name != nullptr) {
+        entry.command_name = command_name;
+    }
+    entry.is_implemented = entry.is_implemented || is_implemented;
+    return entry.stats;
+}
+
+std::vector<CommandStatsEntry> GetCommandStatsSnapshot() {
+    std::lock_guard<std::mutex> hle_lock(HLE::g_hle_lock);
+    std::lock_guard<std::mutex> lock(table_mutex);
+
+    std::vector<CommandStatsEntry> entries;
+    for (const auto& [key, entry] : table) {
+        if (entry.stats.calls != 0) {
+            entries.push_back(
+                {key.first, key.second, entry.command_name, entry.is_implemented, entry.stats});
+        }
+    }
+    return entries;
+}
+
+void ClearCommandStats() {
+    std::lock_guard<std::mutex> lock(table_mutex);
+    table.clear();
+}
+
+} // namespace Service
@@ -0,0 +1,64 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "common/common_types.h"
+
+namespace Service {
+
+/// Number of buckets of the latency histograms, bucket i counts calls taking < 2^i ns
+constexpr size_t NUM_LATENCY_BUCKETS = 32;
+
+/**
+ * Statistics about the calls to a single command of a service. All the instances of a service
+ * share them, and they are updated with the HLE lock held.
+ */
+struct CommandStats {
+    u64 calls = 0;
+    u64 total_ns = 0;
+    u64 max_ns = 0;
+    /// Sum of the sizes of the buffers the requests passed through buffer descriptors
+    u64 buffer_bytes = 0;
+    std::array<u64, NUM_LATENCY_BUCKETS> latency_histogram{};
+
+    void Record(u64 elapsed_ns, u64 bytes);
+
+    /// Returns the upper bound of the histogram bucket holding the median call
+    u64 GetMedianBoundNs() const;
+};
+
+/// Statistics of a command along with what they are about
+struct CommandStatsEntry {
+    std::string service_name;
+    u32 command_id;
+    /// Name of the command, empty if the service doesn't know it
+    std::string command_name;
+    /// Whether the service has a handler for the command, the calls to others only fail
+    bool is_implemented;
+    CommandStats stats;
+};
+
+/**
+ * Returns the statistics of a command, creating them on first use. They stay at the same address
+ * until ClearCommandStats, so that services keep a pointer to them.
+ * @param service_name Name of the service.
+ * @param command_id Id of the command.
+ * @param command_name Name of the command, nullptr if the service doesn't know it.
+ * @param is_implemented Whether the service has a handler for the command.
+ */
+CommandStats& GetCommandStats(const std::string& service_name, u32 command_id,
+                              const char* command_name, bool is_implemented);
+
+/// Copies the statistics of the commands called at least once, with the HLE lock held
+std::vector<CommandStatsEntry> GetCommandStatsSnapshot();
+
+/// Forgets the statistics of all commands, when the services are created anew
+void ClearCommandStats();
+
+} // namespace Service
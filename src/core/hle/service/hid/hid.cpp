@@ -2,38 +2,53 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstring>
+#include <tuple>
 #include "common/logging/log.h"
+#include "core/core.h"
 #include "core/core_timing.h"
+#include "core/frontend/framebuffer_layout.h"
 #include "core/frontend/input.h"
 #include "core/hle/ipc_helpers.h"
 #include "core/hle/kernel/client_port.h"
 #include "core/hle/kernel/client_session.h"
-#include "core/hle/kernel/shared_memory.h"
 #include "core/hle/service/hid/hid.h"
 #include "core/hle/service/service.h"
+#include "core/hle/service/shared_state.h"
+#include "core/movie.h"
 
 namespace Service {
 namespace HID {
 
+// The native HID buttons are in the order of the bits of ControllerPadState
+static_assert(Settings::NativeButton::BUTTON_HID_BEGIN == Settings::NativeButton::A &&
+                  Settings::NativeButton::SR - Settings::NativeButton::BUTTON_HID_BEGIN == 25,
+              "Native buttons don't match the controller pad state");
+
 // Updating period for each HID device.
 // TODO(shinyquagsire23): These need better values.
 constexpr u64 pad_update_ticks = BASE_CLOCK_RATE / 234;
 constexpr u64 accelerometer_update_ticks = BASE_CLOCK_RATE / 104;
 constexpr u64 gyroscope_update_ticks = BASE_CLOCK_RATE / 101;
 
+/// Number of entries of each ring buffer of the shared memory
+constexpr u64 RING_SIZE = 17;
+/// Value of a stick pushed all the way in a direction
+constexpr float STICK_MAX = 0x7FFF;
+/// Diameter reported for the touches, they have no size on the emulated touch screen
+constexpr u32 TOUCH_DIAMETER = 15;
+
 class IAppletResource final : public ServiceFramework<IAppletResource> {
 public:
-    IAppletResource() : ServiceFramework("IAppletResource") {
+    IAppletResource() : ServiceFramework("IAppletResource"), shared_mem("HID:SharedMemory") {
         static const FunctionInfo functions[] = {
             {0, &IAppletResource::GetSharedMemoryHandle, "GetSharedMemoryHandle"},
         };
         RegisterHandlers(functions);
 
-        shared_mem = Kernel::SharedMemory::Create(
-            nullptr, 0x40000, Kernel::MemoryPermission::ReadWrite, Kernel::MemoryPermission::Read,
-            0, Kernel::MemoryRegion::BASE, "HID:SharedMemory");
-
         // Register update callbacks
         pad_update_event = CoreTiming::RegisterEvent(
             "HID::UpdatePadCallback",
@@ -42,88 +57,248 @@ public:
         // TODO(shinyquagsire23): Other update callbacks? (accel, gyro?)
 
         CoreTiming::ScheduleEvent(pad_update_ticks, pad_update_event);
+
+        // The devices are created anew at the next sample when the input configuration changes
+        settings_callback =
+            Settings::RegisterApplyCallback([this] { is_device_reload_pending = true; });
+    }
+
+    ~IAppletResource() {
+        Settings::UnregisterApplyCallback(settings_callback);
+    }
+
+    /// Samples the input devices into the shared memory
+    void UpdatePad() {
+        auto& perf_stats = Core::System::GetInstance().perf_stats;
+        const Input::EventClock::time_point state_change = Input::GetLastStateChange();
+        const bool is_state_changed = state_change != last_state_change;
+        last_state_change = state_change;
+        if (is_state_changed) {
+            perf_stats.RecordInputStateChange(state_change);
+        }
+        perf_stats.RecordInputSample();
+
+        SharedMemory* mem = &shared_mem.Get();
+
+        // Only the devices whose bindings changed, or all of them after a controller was plugged
+        // in or unplugged, are created again
+        if (is_device_reload_pending.exchange(false) ||
+            devices_generation != Input::GetDevicesGeneration())
+            LoadInputDevices();
+
+        // The devices are sampled once, then every ring buffer gets a new entry in a single pass
+        // over the shared memory. The entries are numbered by the sample they were written in, so
+        // that the application can tell which ones are new.
+        ++sample_number;
+        const u64 now_ticks = CoreTiming::GetTicks();
+        Core::Movie::InputState state = SampleInputDevices();
+        auto& movie = Core::Movie::GetInstance();
+        // The host time of the changes is not reproducible, movies and the deterministic mode
+        // timestamp them at the sample
+        const bool is_reproducible = movie.IsActive() || Settings::values.use_deterministic_mode;
+        movie.HandleInputState(now_ticks, state);
+        const u64 ticks = is_state_changed && !is_reproducible
+                              ? GetChangeTicks(state_change, now_ticks)
+                              : now_ticks;
+        previous_sample_ticks = now_ticks;
+
+        ControllerInputEntry input{};
+        input.timestamp = sample_number;
+        input.timestamp_2 = sample_number;
+        input.buttons.hex = state.buttons;
+        input.joystickLeftX = state.sticks[0];
+        input.joystickLeftY = state.sticks[1];
+        input.joystickRightX = state.sticks[2];
+        input.joystickRightY = state.sticks[3];
+
+        for (size_t index = 0; index < mem->controllers.size(); ++index) {
+            Controller& controller = mem->controllers[index];
+            const bool is_connected = index == Controller_Handheld || index == Controller_Player1;
+            UpdateControllerHeader(controller.header, index, is_connected);
+
+            input.connectionState =
+                is_connected ? ConnectionState_Connected | ConnectionState_Wired : 0;
+            for (ControllerLayout& layout : controller.layouts) {
+                // The bit fields of the entries can't be assigned as a whole
+                const u64 entry = NextEntry(layout.header);
+                std::memcpy(&layout.entries[entry], &input, sizeof(input));
+                PublishEntry(layout.header, entry, ticks);
+            }
+        }
+
+        UpdateTouchScreen(mem->touchscreen, state, ticks);
+
+        // Nothing is emulated behind the mouse and keyboard, but their samples still advance
+        const u64 mouse_entry = NextEntry(mem->mouse.header);
+        std::memset(&mem->mouse.entries[mouse_entry], 0, sizeof(MouseEntry));
+        mem->mouse.entries[mouse_entry].timestamp = sample_number;
+        mem->mouse.entries[mouse_entry].timestamp_2 = sample_number;
+        PublishEntry(mem->mouse.header, mouse_entry, ticks);
+
+        const u64 keyboard_entry = NextEntry(mem->keyboard.header);
+        std::memset(&mem->keyboard.entries[keyboard_entry], 0, sizeof(KeyboardEntry));
+        mem->keyboard.entries[keyboard_entry].timestamp = sample_number;
+        mem->keyboard.entries[keyboard_entry].timestamp_2 = sample_number;
+        PublishEntry(mem->keyboard.header, keyboard_entry, ticks);
+
+        // TODO(shinyquagsire23): Signal events
     }
 
 private:
     void GetSharedMemoryHandle(Kernel::HLERequestContext& ctx) {
         IPC::RequestBuilder rb{ctx, 2, 1};
         rb.Push(RESULT_SUCCESS);
-        rb.PushCopyObjects(shared_mem);
+        rb.PushCopyObjects(shared_mem.GetSharedMemory());
         LOG_DEBUG(Service, "called");
     }
 
     void LoadInputDevices() {
-        std::transform(Settings::values.buttons.begin() + Settings::NativeButton::BUTTON_HID_BEGIN,
-                       Settings::values.buttons.begin() + Settings::NativeButton::BUTTON_HID_END,
-                       buttons.begin(), Input::CreateDevice<Input::ButtonDevice>);
-        // TODO(shinyquagsire23): sticks, gyro, touch, mouse, keyboard
+        devices_generation = Input::GetDevicesGeneration();
+        for (size_t index = 0; index < buttons.size(); ++index) {
+            buttons[index].Update(
+                Settings::values.buttons[Settings::NativeButton::BUTTON_HID_BEGIN + index]);
+        }
+        for (size_t index = 0; index < sticks.size(); ++index) {
+            sticks[index].Update(Settings::values.analogs[index]);
+        }
+        touch_device.Update(Settings::values.touch_device);
+        // TODO(shinyquagsire23): gyro, mouse, keyboard
     }
 
-    void UpdatePadCallback(u64 userdata, int cycles_late) {
-        SharedMemory* mem = reinterpret_cast<SharedMemory*>(shared_mem->GetPointer());
+    /**
+     * Maps the host time of an input state change to the guest time, assuming the emulation ran at
+     * the speed of the previous frame since. Changes are never placed before the previous sample,
+     * which didn't have them.
+     */
+    u64 GetChangeTicks(Input::EventClock::time_point change_time, u64 now_ticks) const {
+        const double age = std::chrono::duration<double>(Input::EventClock::now() - change_time)
+                               .count();
+        const double time_scale = Core::System::GetInstance().perf_stats.GetLastFrameTimeScale();
+        const double age_ticks = time_scale > 0.0 ? age / time_scale * BASE_CLOCK_RATE : 0.0;
+        const u64 max_age_ticks = now_ticks - previous_sample_ticks;
+        return now_ticks - std::min(static_cast<u64>(std::max(age_ticks, 0.0)), max_age_ticks);
+    }
 
-        if (is_device_reload_pending.exchange(false))
-            LoadInputDevices();
+    /// Gets the index of the entry of a ring buffer the next sample is written into
+    template <typename Header>
+    static u64 NextEntry(const Header& header) {
+        return (header.latestEntry + 1) % RING_SIZE;
+    }
 
-        // TODO(shinyquagsire23): This is a hack!
-        ControllerPadState& state =
-            mem->controllers[Controller_Handheld].layouts[Layout_Default].entries[0].buttons;
-        using namespace Settings::NativeButton;
-        state.a.Assign(buttons[A - BUTTON_HID_BEGIN]->GetStatus());
-        state.b.Assign(buttons[B - BUTTON_HID_BEGIN]->GetStatus());
-        state.x.Assign(buttons[X - BUTTON_HID_BEGIN]->GetStatus());
-        state.y.Assign(buttons[Y - BUTTON_HID_BEGIN]->GetStatus());
-        state.lstick.Assign(buttons[LStick - BUTTON_HID_BEGIN]->GetStatus());
-        state.rstick.Assign(buttons[RStick - BUTTON_HID_BEGIN]->GetStatus());
-        state.l.Assign(buttons[L - BUTTON_HID_BEGIN]->GetStatus());
-        state.r.Assign(buttons[R - BUTTON_HID_BEGIN]->GetStatus());
-        state.zl.Assign(buttons[ZL - BUTTON_HID_BEGIN]->GetStatus());
-        state.zr.Assign(buttons[ZR - BUTTON_HID_BEGIN]->GetStatus());
-        state.plus.Assign(buttons[Plus - BUTTON_HID_BEGIN]->GetStatus());
-        state.minus.Assign(buttons[Minus - BUTTON_HID_BEGIN]->GetStatus());
-
-        state.dleft.Assign(buttons[DLeft - BUTTON_HID_BEGIN]->GetStatus());
-        state.dup.Assign(buttons[DUp - BUTTON_HID_BEGIN]->GetStatus());
-        state.dright.Assign(buttons[DRight - BUTTON_HID_BEGIN]->GetStatus());
-        state.ddown.Assign(buttons[DDown - BUTTON_HID_BEGIN]->GetStatus());
-
-        state.lstick_left.Assign(buttons[LStick_Left - BUTTON_HID_BEGIN]->GetStatus());
-        state.lstick_up.Assign(buttons[LStick_Up - BUTTON_HID_BEGIN]->GetStatus());
-        state.lstick_right.Assign(buttons[LStick_Right - BUTTON_HID_BEGIN]->GetStatus());
-        state.lstick_down.Assign(buttons[LStick_Down - BUTTON_HID_BEGIN]->GetStatus());
-
-        state.rstick_left.Assign(buttons[RStick_Left - BUTTON_HID_BEGIN]->GetStatus());
-        state.rstick_up.Assign(buttons[RStick_Up - BUTTON_HID_BEGIN]->GetStatus());
-        state.rstick_right.Assign(buttons[RStick_Right - BUTTON_HID_BEGIN]->GetStatus());
-        state.rstick_down.Assign(buttons[RStick_Down - BUTTON_HID_BEGIN]->GetStatus());
-
-        state.sl.Assign(buttons[SL - BUTTON_HID_BEGIN]->GetStatus());
-        state.sr.Assign(buttons[SR - BUTTON_HID_BEGIN]->GetStatus());
-
-        // TODO(shinyquagsire23): Analog stick vals
-
-        // TODO(shinyquagsire23): Update pad info proper, (circular buffers, timestamps, layouts)
-
-        // TODO(shinyquagsire23): Update touch info
+    /**
+     * Makes the entry of a ring buffer the latest one, once the sample was written into it, so
+     * that the application never reads a partially written entry.
+     */
+    template <typename Header>
+    static void PublishEntry(Header& header, u64 entry, u64 ticks) {
+        header.timestampTicks = ticks;
+        header.numEntries = RING_SIZE;
+        header.maxEntryIndex = RING_SIZE - 1;
+        PublishIndex(header.latestEntry, entry);
+    }
 
-        // TODO(shinyquagsire23): Signal events
+    /// Reads the state of the emulated controller and touch screen from the input devices
+    Core::Movie::InputState SampleInputDevices() const {
+        Core::Movie::InputState state{};
+        for (size_t index = 0; index < buttons.size(); ++index) {
+            state.buttons |= static_cast<u64>(buttons[index]->GetStatus()) << index;
+        }
+        std::tie(state.sticks[0], state.sticks[1]) =
+            ToStickValues(sticks[Settings::NativeAnalog::LStick]->GetStatus());
+        std::tie(state.sticks[2], state.sticks[3]) =
+            ToStickValues(sticks[Settings::NativeAnalog::RStick]->GetStatus());
+
+        float x, y;
+        bool pressed;
+        std::tie(x, y, pressed) = touch_device->GetStatus();
+        if (pressed) {
+            state.touch_x = static_cast<u32>(x * Layout::ScreenUndocked::Width);
+            state.touch_y = static_cast<u32>(y * Layout::ScreenUndocked::Height);
+            state.touch_pressed = 1;
+        }
+        return state;
+    }
+
+    /// Converts the position of an analog stick to the range of the HID stick values
+    static std::tuple<u32, u32> ToStickValues(const std::tuple<float, float>& status) {
+        float x, y;
+        std::tie(x, y) = status;
+        return std::make_tuple(static_cast<u32>(static_cast<s32>(x * STICK_MAX)),
+                               static_cast<u32>(static_cast<s32>(y * STICK_MAX)));
+    }
+
+    static void UpdateControllerHeader(ControllerHeader& header, size_t index,
+                                       bool is_connected) {
+        if (!is_connected) {
+            header = {};
+            return;
+        }
+        header.type = index == Controller_Handheld ? ControllerType_Handheld
+                                                   : ControllerType_ProController;
+        header.isHalf = 0;
+        header.singleColorsDescriptor = ColorDesc_ColorsNonexistent;
+        header.splitColorsDescriptor = ColorDesc_ColorsNonexistent;
+    }
+
+    void UpdateTouchScreen(TouchScreen& touchscreen, const Core::Movie::InputState& state,
+                           u64 ticks) {
+        const u64 index = NextEntry(touchscreen.header);
+        TouchScreenEntry& entry = touchscreen.entries[index];
+        entry.header.timestamp = sample_number;
+
+        if (state.touch_pressed) {
+            entry.header.numTouches = 1;
+            TouchScreenEntryTouch& touch = entry.touches[0];
+            touch = {};
+            touch.timestamp = sample_number;
+            touch.touchIndex = 0;
+            touch.x = state.touch_x;
+            touch.y = state.touch_y;
+            touch.diameterX = TOUCH_DIAMETER;
+            touch.diameterY = TOUCH_DIAMETER;
+            touch.angle = 0;
+        } else {
+            entry.header.numTouches = 0;
+        }
+
+        touchscreen.header.timestamp = sample_number;
+        PublishEntry(touchscreen.header, index, ticks);
+    }
+
+    void UpdatePadCallback(u64 userdata, int cycles_late) {
+        UpdatePad();
 
         // Reschedule recurrent event
         CoreTiming::ScheduleEvent(pad_update_ticks - cycles_late, pad_update_event);
     }
 
     // Handle to shared memory region designated to HID service
-    Kernel::SharedPtr<Kernel::SharedMemory> shared_mem;
+    SharedStatePage<SharedMemory> shared_mem;
 
     // CoreTiming update events
     CoreTiming::EventType* pad_update_event;
 
     // Stored input state info
     std::atomic<bool> is_device_reload_pending{true};
-    std::array<std::unique_ptr<Input::ButtonDevice>, Settings::NativeButton::NUM_BUTTONS_HID>
+    size_t settings_callback;
+    /// Devices generation the devices were last updated at
+    u64 devices_generation = 0;
+    std::array<Input::CachedDevice<Input::ButtonDevice>, Settings::NativeButton::NUM_BUTTONS_HID>
         buttons;
+    std::array<Input::CachedDevice<Input::AnalogDevice>, Settings::NativeAnalog::NumAnalogs> sticks;
+    Input::CachedDevice<Input::TouchDevice> touch_device;
+
+    /// Number of the last sample written into the ring buffers
+    u64 sample_number = 0;
+    /// Guest time of the previous sample
+    u64 previous_sample_ticks = 0;
+    /// Time of the input state change the previous sample included
+    Input::EventClock::time_point last_state_change;
 };
 
+/// Last applet resource created, its shared memory is the one the application reads
+static std::weak_ptr<IAppletResource> applet_resource;
+
 class Hid final : public ServiceFramework<Hid> {
 public:
     Hid() : ServiceFramework("hid") {
@@ -136,7 +311,9 @@ public:
 
 private:
     void CreateAppletResource(Kernel::HLERequestContext& ctx) {
-        auto client_port = std::make_shared<IAppletResource>()->CreatePort();
+        auto resource = std::make_shared<IAppletResource>();
+        applet_resource = resource;
+        auto client_port = resource->CreatePort();
         auto session = client_port->Connect();
         if (session.Succeeded()) {
             LOG_DEBUG(Service, "called, initialized IAppletResource -> session=%u",
@@ -150,7 +327,11 @@ private:
     }
 };
 
-void ReloadInputDevices() {}
+void SampleInput() {
+    if (auto resource = applet_resource.lock()) {
+        resource->UpdatePad();
+    }
+}
 
 void InstallInterfaces(SM::ServiceManager& service_manager) {
     std::make_shared<Hid>()->InstallAsService(service_manager);
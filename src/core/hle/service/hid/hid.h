@@ -321,8 +321,11 @@ struct SharedMemory {
 };
 static_assert(sizeof(SharedMemory) == 0x40000, "HID Shared Memory structure has incorrect size");
 
-/// Reload input devices. Used when input configuration changed
-void ReloadInputDevices();
+/**
+ * Samples the input devices right away, in addition to the periodic updates. Used in low latency
+ * mode to sample them just before the emulation of a frame starts.
+ */
+void SampleInput();
 
 /// Registers all HID services with the specified service manager.
 void InstallInterfaces(SM::ServiceManager& service_manager);
@@ -2,7 +2,12 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <string>
+#include <vector>
+#include "common/logging/backend.h"
 #include "common/logging/log.h"
 #include "core/hle/ipc_helpers.h"
 #include "core/hle/kernel/client_session.h"
@@ -55,6 +60,17 @@ private:
         Thread = 7,
     };
 
+    /// A message being reassembled from the packets it was split into
+    struct PendingMessage {
+        u32 line = 0;
+        std::string message;
+        std::string filename;
+        std::string function;
+    };
+
+    /// Messages a logger may log per second before its messages are dropped
+    static constexpr u32 MAX_MESSAGES_PER_SECOND = 200;
+
     /**
      * LM::Initialize service function
      *  Inputs:
@@ -67,64 +83,123 @@ private:
         IPC::RequestBuilder rb{ctx, 1};
         rb.Push(RESULT_SUCCESS);
 
-        // Read MessageHeader, despite not doing anything with it right now
-        MessageHeader header{};
-        VAddr addr{ctx.BufferDescriptorX()[0].Address()};
-        const VAddr end_addr{addr + ctx.BufferDescriptorX()[0].size};
-        Memory::ReadBlock(addr, &header, sizeof(MessageHeader));
-        addr += sizeof(MessageHeader);
+        // Nothing is read when the messages would be filtered out anyway
+        if (!Log::IsMessageEnabled(Log::Class::Debug_Emulated, Log::Level::Debug)) {
+            return;
+        }
 
-        if (!header.IsSingleMessage()) {
-            LOG_WARNING(Service, "Multi message logs are unimplemeneted");
+        // The whole packet is read at once and parsed in place
+        const auto& descriptor = ctx.BufferDescriptorX()[0];
+        if (descriptor.size < sizeof(MessageHeader)) {
             return;
         }
+        packet.resize(descriptor.size);
+        Memory::ReadBlock(descriptor.Address(), packet.data(), packet.size());
 
-        // Parse out log metadata
-        u32 line{};
-        std::string message, filename, function;
-        while (addr < end_addr) {
-            const Field field{static_cast<Field>(Memory::Read8(addr++))};
-            size_t length{Memory::Read8(addr++)};
+        MessageHeader header{};
+        std::memcpy(static_cast<void*>(&header), packet.data(), sizeof(MessageHeader));
+        const size_t payload_end =
+            std::min<size_t>(packet.size(), sizeof(MessageHeader) + header.payload_size);
+
+        // Long messages are split into several packets, the first one flagged as the head and
+        // the last one as the tail. The message is logged once the tail arrives.
+        if (header.flags & MessageHeader::IsHead) {
+            pending = {};
+        }
+        ParseFields(packet.data() + sizeof(MessageHeader), packet.data() + payload_end);
+        if (header.flags & MessageHeader::IsTail) {
+            LogPendingMessage();
+        }
+    }
+
+    /// Adds the fields of a packet to the pending message, the message text is appended
+    void ParseFields(const u8* data, const u8* end) {
+        while (end - data >= 2) {
+            const Field field{static_cast<Field>(data[0])};
+            const size_t length{std::min<size_t>(data[1], end - data - 2)};
+            const char* value{reinterpret_cast<const char*>(data + 2)};
+            const size_t string_length{strnlen(value, length)};
             switch (field) {
             case Field::Message:
-                message = Memory::ReadCString(addr, length);
+                pending.message.append(value, string_length);
                 break;
             case Field::Line:
-                line = Memory::Read32(addr);
+                if (length >= sizeof(u32)) {
+                    std::memcpy(&pending.line, value, sizeof(u32));
+                }
                 break;
             case Field::Filename:
-                filename = Memory::ReadCString(addr, length);
+                pending.filename.assign(value, string_length);
                 break;
             case Field::Function:
-                function = Memory::ReadCString(addr, length);
+                pending.function.assign(value, string_length);
+                break;
+            default:
                 break;
             }
-            addr += length;
+            data += 2 + length;
         }
+    }
 
+    void LogPendingMessage() {
         // Empty log - nothing to do here
-        if (message.empty()) {
+        if (pending.message.empty()) {
+            return;
+        }
+        if (!TryAcquireMessage()) {
             return;
         }
 
         // Format a nicely printable string out of the log metadata
         std::string output;
-        if (filename.size()) {
-            output += filename + ':';
+        if (!pending.filename.empty()) {
+            output += pending.filename + ':';
         }
-        if (function.size()) {
-            output += function + ':';
+        if (!pending.function.empty()) {
+            output += pending.function + ':';
         }
-        if (line) {
-            output += std::to_string(line) + ':';
+        if (pending.line) {
+            output += std::to_string(pending.line) + ':';
         }
-        if (output.back() == ':') {
+        if (!output.empty()) {
             output += ' ';
         }
-        output += message;
+        output += pending.message;
 
         LOG_DEBUG(Debug_Emulated, "%s", output.c_str());
+        pending = {};
+    }
+
+    /**
+     * Limits the messages of the application to MAX_MESSAGES_PER_SECOND, so that a chatty title
+     * can't flood the log. Returns false if the message has to be dropped.
+     */
+    bool TryAcquireMessage() {
+        const auto now = std::chrono::steady_clock::now();
+        if (now - window_start >= std::chrono::seconds(1)) {
+            if (dropped_messages != 0) {
+                LOG_DEBUG(Debug_Emulated, "Dropped %u messages, the application logged too many",
+                          dropped_messages);
+            }
+            window_start = now;
+            window_messages = 0;
+            dropped_messages = 0;
+        }
+        if (window_messages == MAX_MESSAGES_PER_SECOND) {
+            ++dropped_messages;
+            return false;
+        }
+        ++window_messages;
+        return true;
     }
+
+    /// Buffer the packets are read into, kept to reuse its allocation
+    std::vector<u8> packet;
+    PendingMessage pending;
+
+    std::chrono::steady_clock::time_point window_start{};
+    u32 window_messages = 0;
+    u32 dropped_messages = 0;
 };
 
 void InstallInterfaces(SM::ServiceManager& service_manager) {
@@ -4,13 +4,71 @@
 
 #pragma once
 
-#include <vector>
+#include <cstring>
+#include <type_traits>
+#include "common/assert.h"
 #include "common/common_types.h"
+#include "core/hle/kernel/event.h"
 
 namespace Service {
 namespace NVDRV {
 namespace Devices {
 
+/// Error codes returned by the ioctls
+namespace NvErrCodes {
+enum : u32 {
+    Success = 0,
+    NotImplemented = 1,
+    NotSupported = 2,
+    NotInitialized = 3,
+    BadParameter = 4,
+    Timeout = 5,
+    InsufficientMemory = 6,
+    InvalidAddress = 9,
+};
+} // namespace NvErrCodes
+
+/**
+ * Parameter buffer of an ioctl. It normally points straight into the guest memory of the IPC
+ * buffer, so that devices decode and encode their parameter structs in place. The input and the
+ * output buffer of an ioctl may be the same memory, devices have to read all of their input before
+ * they write any output.
+ */
+class IoctlBuffer {
+public:
+    IoctlBuffer(u8* data, size_t size) : data(data), size(size) {}
+
+    u8* Data() const {
+        return data;
+    }
+
+    size_t Size() const {
+        return size;
+    }
+
+    /// Reads a value of type T starting at `offset` in the buffer
+    template <typename T>
+    T Read(size_t offset = 0) const {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        ASSERT_MSG(offset <= size && sizeof(T) <= size - offset, "Out of bounds ioctl read");
+        T value;
+        std::memcpy(&value, data + offset, sizeof(T));
+        return value;
+    }
+
+    /// Writes a value of type T starting at `offset` in the buffer
+    template <typename T>
+    void Write(const T& value, size_t offset = 0) const {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        ASSERT_MSG(offset <= size && sizeof(T) <= size - offset, "Out of bounds ioctl write");
+        std::memcpy(data + offset, &value, sizeof(T));
+    }
+
+private:
+    u8* data;
+    size_t size;
+};
+
 /// Represents an abstract nvidia device node. It is to be subclassed by concrete device nodes to
 /// implement the ioctl interface.
 class nvdevice {
@@ -21,11 +79,20 @@ public:
     /**
      * Handles an ioctl request.
      * @param command The ioctl command id.
-     * @param input A buffer containing the input data for the ioctl.
-     * @param output A buffer where the output data will be written to.
+     * @param input The buffer containing the input parameters of the ioctl.
+     * @param output The buffer the output parameters of the ioctl are written to.
      * @returns The result code of the ioctl.
      */
-    virtual u32 ioctl(u32 command, const std::vector<u8>& input, std::vector<u8>& output) = 0;
+    virtual u32 ioctl(u32 command, const IoctlBuffer& input, const IoctlBuffer& output) = 0;
+
+    /**
+     * Returns an event of the device that applications wait on, such as the ones handed out by
+     * the ioctls that can't complete right away.
+     * @returns nullptr if the device has no such event.
+     */
+    virtual Kernel::SharedPtr<Kernel::Event> QueryEvent(u32 event_id) {
+        return nullptr;
+    }
 };
 
 } // namespace Devices
@@ -13,22 +13,38 @@ namespace Service {
 namespace NVDRV {
 namespace Devices {
 
-u32 nvdisp_disp0::ioctl(u32 command, const std::vector<u8>& input, std::vector<u8>& output) {
+u32 nvdisp_disp0::ioctl(u32 command, const IoctlBuffer& input, const IoctlBuffer& output) {
     UNIMPLEMENTED();
     return 0;
 }
 
-void nvdisp_disp0::flip(u32 buffer_handle, u32 offset, u32 format, u32 width, u32 height,
-                        u32 stride) {
-    VAddr addr = nvmap_dev->GetObjectAddress(buffer_handle);
-    LOG_WARNING(Service,
-                "Drawing from address %llx offset %08X Width %u Height %u Stride %u Format %u",
-                addr, offset, width, height, stride, format);
-
-    using PixelFormat = RendererBase::FramebufferInfo::PixelFormat;
-    const RendererBase::FramebufferInfo framebuffer_info{
-        addr, offset, width, height, stride, static_cast<PixelFormat>(format)};
-    VideoCore::g_renderer->SwapBuffers(framebuffer_info);
+void nvdisp_disp0::flip(const std::vector<Layer>& layers) {
+    std::vector<RendererBase::LayerInfo> layer_infos;
+    layer_infos.reserve(layers.size());
+
+    for (const Layer& layer : layers) {
+        RendererBase::LayerInfo layer_info{
+            layer.id, static_cast<RendererBase::ScalingMode>(layer.scaling_mode), boost::none};
+
+        if (layer.plane) {
+            const Plane& plane = *layer.plane;
+            VAddr addr = nvmap_dev->GetObjectAddress(plane.buffer_handle);
+            LOG_TRACE(Service,
+                      "Drawing layer %llu from address %llx offset %08X Width %u Height %u "
+                      "Stride %u Format %u",
+                      layer.id, addr, plane.offset, plane.width, plane.height, plane.stride,
+                      plane.format);
+
+            using PixelFormat = RendererBase::FramebufferInfo::PixelFormat;
+            layer_info.framebuffer = RendererBase::FramebufferInfo{
+                addr, plane.offset, plane.width, plane.height, plane.stride,
+                static_cast<PixelFormat>(plane.format)};
+        }
+
+        layer_infos.push_back(std::move(layer_info));
+    }
+
+    VideoCore::g_renderer->SwapBuffers(layer_infos);
 }
 
 } // namespace Devices
@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <vector>
+#include <boost/optional.hpp>
 #include "common/common_types.h"
 #include "core/hle/service/nvdrv/devices/nvdevice.h"
 
@@ -20,10 +21,31 @@ public:
     nvdisp_disp0(std::shared_ptr<nvmap> nvmap_dev) : nvdevice(), nvmap_dev(std::move(nvmap_dev)) {}
     ~nvdisp_disp0() = default;
 
-    u32 ioctl(u32 command, const std::vector<u8>& input, std::vector<u8>& output) override;
-
-    /// Performs a screen flip, drawing the buffer pointed to by the handle.
-    void flip(u32 buffer_handle, u32 offset, u32 format, u32 width, u32 height, u32 stride);
+    u32 ioctl(u32 command, const IoctlBuffer& input, const IoctlBuffer& output) override;
+
+    /// Buffer to display on a layer
+    struct Plane {
+        u32 buffer_handle;
+        u32 offset;
+        u32 format;
+        u32 width;
+        u32 height;
+        u32 stride;
+    };
+
+    /// Layer to compose in a screen flip
+    struct Layer {
+        u64 id;
+        u32 scaling_mode;
+        /// Buffer queued on the layer since the last flip, if any
+        boost::optional<Plane> plane;
+    };
+
+    /**
+     * Performs a screen flip, composing the layers into a single frame.
+     * @param layers Layers of the screen, ordered from the bottom-most to the top-most one
+     */
+    void flip(const std::vector<Layer>& layers);
 
 private:
     std::shared_ptr<nvmap> nvmap_dev;
@@ -4,17 +4,125 @@
 
 #include "common/assert.h"
 #include "common/logging/log.h"
+#include "core/core.h"
 #include "core/hle/service/nvdrv/devices/nvhost_as_gpu.h"
+#include "core/hle/service/nvdrv/devices/nvmap.h"
+#include "video_core/gpu.h"
 
 namespace Service {
 namespace NVDRV {
 namespace Devices {
 
-u32 nvhost_as_gpu::ioctl(u32 command, const std::vector<u8>& input, std::vector<u8>& output) {
-    UNIMPLEMENTED();
+u32 nvhost_as_gpu::ioctl(u32 command, const IoctlBuffer& input, const IoctlBuffer& output) {
+    switch (command) {
+    case IocBindChannelCommand:
+        return BindChannel(input, output);
+    case IocAllocSpaceCommand:
+        return AllocateSpace(input, output);
+    case IocMapBufferExCommand:
+        return MapBufferEx(input, output);
+    case IocUnmapBufferCommand:
+        return UnmapBuffer(input, output);
+    }
+
+    UNIMPLEMENTED_MSG("Unimplemented ioctl 0x%08X", command);
+    return 0;
+}
+
+u32 nvhost_as_gpu::BindChannel(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocBindChannelParams>();
+    LOG_DEBUG(Service, "called, fd=%u", params.fd);
+
+    // There is a single GPU channel, which always uses this address space
+    channel_fd = params.fd;
     return 0;
 }
 
+u32 nvhost_as_gpu::AllocateSpace(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocAllocSpaceParams>();
+
+    LOG_DEBUG(Service, "called, pages=0x%x, page_size=0x%x, flags=0x%x, offset=0x%llx",
+              params.pages, params.page_size, params.flags, params.offset);
+
+    auto& memory_manager = Core::System::GetInstance().GPU().GetMemoryManager();
+    const u64 size = static_cast<u64>(params.pages) * params.page_size;
+    boost::optional<Tegra::GPUVAddr> gpu_addr;
+    if (params.flags & FLAGS_FIXED_OFFSET) {
+        gpu_addr = memory_manager.AllocateFixedSpace(params.offset, size);
+    } else {
+        gpu_addr = memory_manager.AllocateSpace(size, params.align);
+    }
+
+    if (!gpu_addr) {
+        LOG_ERROR(Service, "Couldn't allocate 0x%llx bytes of GPU address space", size);
+        return NvErrCodes::InsufficientMemory;
+    }
+
+    params.offset = *gpu_addr;
+    output.Write(params);
+    return NvErrCodes::Success;
+}
+
+u32 nvhost_as_gpu::MapBufferEx(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocMapBufferExParams>();
+
+    LOG_DEBUG(Service,
+              "called, flags=0x%x, nvmap_handle=0x%x, buffer_offset=0x%llx, mapping_size=0x%llx, "
+              "offset=0x%llx",
+              params.flags, params.nvmap_handle, params.buffer_offset, params.mapping_size,
+              params.offset);
+
+    const VAddr cpu_addr = nvmap_dev->GetObjectAddress(params.nvmap_handle) + params.buffer_offset;
+    // A zero size maps the rest of the buffer
+    const u64 size = params.mapping_size != 0
+                         ? static_cast<u64>(params.mapping_size)
+                         : nvmap_dev->GetObjectSize(params.nvmap_handle) - params.buffer_offset;
+
+    auto& memory_manager = Core::System::GetInstance().GPU().GetMemoryManager();
+    if (params.flags & FLAGS_FIXED_OFFSET) {
+        params.offset = memory_manager.MapBufferEx(cpu_addr, params.offset, size);
+    } else {
+        const auto gpu_addr = memory_manager.MapBufferEx(cpu_addr, size);
+        if (!gpu_addr) {
+            LOG_ERROR(Service, "Couldn't map 0x%llx bytes, the GPU address space is full", size);
+            return NvErrCodes::InsufficientMemory;
+        }
+        params.offset = *gpu_addr;
+    }
+
+    // The object has to stay allocated as long as the GPU can access it
+    const u32 object_id = nvmap_dev->PinObject(params.nvmap_handle);
+    auto result = mapped_objects.emplace(params.offset, object_id);
+    if (!result.second) {
+        nvmap_dev->UnpinObject(result.first->second);
+        result.first->second = object_id;
+    }
+
+    output.Write(params);
+    return NvErrCodes::Success;
+}
+
+u32 nvhost_as_gpu::UnmapBuffer(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocUnmapBufferParams>();
+
+    LOG_DEBUG(Service, "called, offset=0x%llx", params.offset);
+
+    auto& memory_manager = Core::System::GetInstance().GPU().GetMemoryManager();
+    if (!memory_manager.UnmapBuffer(params.offset)) {
+        LOG_ERROR(Service, "No buffer is mapped at 0x%llx", params.offset);
+        return NvErrCodes::InvalidAddress;
+    }
+
+    auto itr = mapped_objects.find(params.offset);
+    if (itr != mapped_objects.end()) {
+        nvmap_dev->UnpinObject(itr->second);
+        mapped_objects.erase(itr);
+    }
+
+    output.Write(params);
+    return NvErrCodes::Success;
+}
+
 } // namespace Devices
 } // namespace NVDRV
 } // namespace Service
@@ -4,20 +4,88 @@
 
 #pragma once
 
-#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "common/common_funcs.h"
 #include "common/common_types.h"
+#include "common/swap.h"
 #include "core/hle/service/nvdrv/devices/nvdevice.h"
 
 namespace Service {
 namespace NVDRV {
 namespace Devices {
 
+class nvmap;
+
+/// GPU address space, into which applications map their nvmap buffers
 class nvhost_as_gpu final : public nvdevice {
 public:
-    nvhost_as_gpu() = default;
+    nvhost_as_gpu(std::shared_ptr<nvmap> nvmap_dev) : nvdevice(), nvmap_dev(std::move(nvmap_dev)) {}
     ~nvhost_as_gpu() override = default;
 
-    u32 ioctl(u32 command, const std::vector<u8>& input, std::vector<u8>& output) override;
+    u32 ioctl(u32 command, const IoctlBuffer& input, const IoctlBuffer& output) override;
+
+private:
+    enum IoctlCommands {
+        IocBindChannelCommand = 0x40044101,
+        IocAllocSpaceCommand = 0xC0184102,
+        IocUnmapBufferCommand = 0xC0084105,
+        IocMapBufferExCommand = 0xC0284106,
+    };
+
+    struct IocBindChannelParams {
+        u32_le fd;
+    };
+    static_assert(sizeof(IocBindChannelParams) == 4, "IocBindChannelParams has incorrect size");
+
+    enum AddressSpaceFlags : u32 {
+        /// The space is allocated or the buffer mapped at the given offset, instead of a free
+        /// address
+        FLAGS_FIXED_OFFSET = 1 << 0,
+    };
+
+    struct IocAllocSpaceParams {
+        // Input
+        u32_le pages;
+        u32_le page_size;
+        u32_le flags;
+        INSERT_PADDING_WORDS(1);
+        // Input for fixed allocations, output. Alignment for the other allocations.
+        union {
+            u64_le offset;
+            u64_le align;
+        };
+    };
+    static_assert(sizeof(IocAllocSpaceParams) == 24, "IocAllocSpaceParams has incorrect size");
+
+    struct IocUnmapBufferParams {
+        u64_le offset;
+    };
+    static_assert(sizeof(IocUnmapBufferParams) == 8, "IocUnmapBufferParams has incorrect size");
+
+    struct IocMapBufferExParams {
+        // Input
+        u32_le flags;
+        u32_le kind;
+        u32_le nvmap_handle;
+        u32_le page_size;
+        u64_le buffer_offset;
+        u64_le mapping_size;
+        // Input for fixed mappings, output
+        u64_le offset;
+    };
+    static_assert(sizeof(IocMapBufferExParams) == 40, "IocMapBufferExParams has incorrect size");
+
+    u32 BindChannel(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 AllocateSpace(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 MapBufferEx(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 UnmapBuffer(const IoctlBuffer& input, const IoctlBuffer& output);
+
+    std::shared_ptr<nvmap> nvmap_dev;
+    u32 channel_fd = 0;
+
+    /// Ids of the nvmap objects pinned by the mapped buffers, by GPU address
+    std::unordered_map<u64, u32> mapped_objects;
 };
 
 } // namespace Devices
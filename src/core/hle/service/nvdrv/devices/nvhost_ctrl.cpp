@@ -0,0 +1,237 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <string>
+#include "common/logging/log.h"
+#include "core/core.h"
+#include "core/core_timing.h"
+#include "core/hle/service/nvdrv/devices/nvhost_ctrl.h"
+#include "video_core/gpu.h"
+
+namespace Service {
+namespace NVDRV {
+namespace Devices {
+
+namespace {
+
+/// Set in the event ids handed to applications, which also hold the syncpoint and the slot
+constexpr u32 EVENT_ID_FLAG = 0x10000000;
+
+u32 EncodeEventId(u32 syncpoint_id, u32 slot) {
+    return EVENT_ID_FLAG | ((syncpoint_id & 0xFFF) << 16) | slot;
+}
+
+u32 DecodeEventSlot(u32 event_id) {
+    return event_id & 0xFF;
+}
+
+/// Whether a syncpoint value reached a threshold, the values wrap around
+bool IsThresholdReached(u32 value, u32 threshold) {
+    return static_cast<s32>(value - threshold) >= 0;
+}
+
+} // Anonymous namespace
+
+nvhost_ctrl::nvhost_ctrl() {
+    syncpoint_increment_event = CoreTiming::RegisterEvent(
+        "nvhost_ctrl::SyncpointIncrement",
+        [this](u64 syncpoint_id, int cycles_late) {
+            SignalSyncpointEvents(static_cast<u32>(syncpoint_id));
+        });
+}
+
+nvhost_ctrl::~nvhost_ctrl() = default;
+
+u32 nvhost_ctrl::ioctl(u32 command, const IoctlBuffer& input, const IoctlBuffer& output) {
+    switch (command) {
+    case IocSyncptReadCommand:
+        return SyncptRead(input, output);
+    case IocSyncptIncrCommand:
+        return SyncptIncr(input, output);
+    case IocSyncptWaitCommand:
+        return SyncptWait(input, output);
+    case IocCtrlEventSignalCommand:
+        return EventSignal(input, output);
+    case IocCtrlEventWaitCommand:
+        return EventWait(input, output, false);
+    case IocCtrlEventWaitAsyncCommand:
+        return EventWait(input, output, true);
+    case IocCtrlEventRegisterCommand:
+        return EventRegister(input, output);
+    case IocCtrlEventUnregisterCommand:
+        return EventUnregister(input, output);
+    }
+    UNIMPLEMENTED_MSG("Unimplemented ioctl 0x%08X", command);
+    return NvErrCodes::NotImplemented;
+}
+
+Kernel::SharedPtr<Kernel::Event> nvhost_ctrl::QueryEvent(u32 event_id) {
+    const u32 slot = DecodeEventSlot(event_id);
+    if (slot >= NUM_EVENTS) {
+        LOG_ERROR(Service, "Invalid event 0x%x", event_id);
+        return nullptr;
+    }
+    return GetEvent(slot).event;
+}
+
+u32 nvhost_ctrl::SyncptRead(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocSyncptReadParams>();
+    LOG_TRACE(Service, "called, id=%u", params.id);
+    if (params.id >= Tegra::GPU::NUM_SYNCPOINTS) {
+        return NvErrCodes::BadParameter;
+    }
+    params.value = GetGPU().GetSyncpointValue(params.id);
+    output.Write(params);
+    return NvErrCodes::Success;
+}
+
+u32 nvhost_ctrl::SyncptIncr(const IoctlBuffer& input, const IoctlBuffer& output) {
+    const auto params = input.Read<IocSyncptIncrParams>();
+    LOG_TRACE(Service, "called, id=%u", params.id);
+    if (params.id >= Tegra::GPU::NUM_SYNCPOINTS) {
+        return NvErrCodes::BadParameter;
+    }
+    Tegra::GPU& gpu = GetGPU();
+    gpu.IncreaseSyncpointMax(params.id, 1);
+    gpu.IncrementSyncpoint(params.id);
+    return NvErrCodes::Success;
+}
+
+u32 nvhost_ctrl::SyncptWait(const IoctlBuffer& input, const IoctlBuffer& output) {
+    const auto params = input.Read<IocSyncptWaitParams>();
+    LOG_TRACE(Service, "called, id=%u, threshold=%u, timeout=%d", params.id, params.threshold,
+              params.timeout);
+    if (params.id >= Tegra::GPU::NUM_SYNCPOINTS) {
+        return NvErrCodes::BadParameter;
+    }
+    if (IsThresholdReached(GetGPU().GetSyncpointValue(params.id), params.threshold)) {
+        return NvErrCodes::Success;
+    }
+    // Blocking here would stall every emulated thread, applications retry or wait on an event
+    return NvErrCodes::Timeout;
+}
+
+u32 nvhost_ctrl::EventSignal(const IoctlBuffer& input, const IoctlBuffer& output) {
+    const auto params = input.Read<IocCtrlEventParams>();
+    LOG_DEBUG(Service, "called, event_id=0x%x", params.event_id);
+    const u32 slot = DecodeEventSlot(params.event_id);
+    if (slot >= NUM_EVENTS) {
+        return NvErrCodes::BadParameter;
+    }
+    // Cancels the wait
+    SyncpointEvent& event = GetEvent(slot);
+    event.is_waiting = false;
+    event.event->Signal();
+    return NvErrCodes::Success;
+}
+
+u32 nvhost_ctrl::EventWait(const IoctlBuffer& input, const IoctlBuffer& output, bool is_async) {
+    auto params = input.Read<IocCtrlEventWaitParams>();
+    LOG_TRACE(Service, "called, syncpt_id=%u, threshold=%u, timeout=%d, value=0x%x, async=%d",
+              params.syncpt_id, params.threshold, params.timeout, params.value, is_async);
+    if (params.syncpt_id >= Tegra::GPU::NUM_SYNCPOINTS) {
+        return NvErrCodes::BadParameter;
+    }
+
+    const u32 value = GetGPU().GetSyncpointValue(params.syncpt_id);
+    if (IsThresholdReached(value, params.threshold)) {
+        params.value = value;
+        output.Write(params);
+        return NvErrCodes::Success;
+    }
+    if (params.timeout == 0) {
+        return NvErrCodes::Timeout;
+    }
+
+    // Asynchronous waits use an event the application registered, the others take a free one
+    u32 slot = NUM_EVENTS;
+    if (is_async) {
+        slot = DecodeEventSlot(params.value);
+        if (slot >= NUM_EVENTS || !events[slot].is_registered) {
+            LOG_ERROR(Service, "Wait on the unregistered event 0x%x", params.value);
+            return NvErrCodes::BadParameter;
+        }
+    } else {
+        for (u32 i = 0; i < NUM_EVENTS; ++i) {
+            if (!events[i].is_registered && !events[i].is_waiting) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot == NUM_EVENTS) {
+            LOG_ERROR(Service, "No free event to wait on syncpoint %u", params.syncpt_id);
+            return NvErrCodes::InsufficientMemory;
+        }
+    }
+
+    // The application waits on the event and retries. The GPU thread can't reach the threshold
+    // before the event is set up, its increments are handled on this thread.
+    SyncpointEvent& event = GetEvent(slot);
+    event.event->Clear();
+    event.is_waiting = true;
+    event.syncpoint_id = params.syncpt_id;
+    event.threshold = params.threshold;
+
+    params.value = EncodeEventId(params.syncpt_id, slot);
+    output.Write(params);
+    return NvErrCodes::Timeout;
+}
+
+u32 nvhost_ctrl::EventRegister(const IoctlBuffer& input, const IoctlBuffer& output) {
+    const auto params = input.Read<IocCtrlEventParams>();
+    LOG_DEBUG(Service, "called, event_id=0x%x", params.event_id);
+    if (params.event_id >= NUM_EVENTS) {
+        return NvErrCodes::BadParameter;
+    }
+    GetEvent(params.event_id).is_registered = true;
+    return NvErrCodes::Success;
+}
+
+u32 nvhost_ctrl::EventUnregister(const IoctlBuffer& input, const IoctlBuffer& output) {
+    const auto params = input.Read<IocCtrlEventParams>();
+    LOG_DEBUG(Service, "called, event_id=0x%x", params.event_id);
+    if (params.event_id >= NUM_EVENTS) {
+        return NvErrCodes::BadParameter;
+    }
+    SyncpointEvent& event = events[params.event_id];
+    event.is_registered = false;
+    event.is_waiting = false;
+    return NvErrCodes::Success;
+}
+
+Tegra::GPU& nvhost_ctrl::GetGPU() {
+    Tegra::GPU& gpu = Core::System::GetInstance().GPU();
+    if (!is_gpu_connected) {
+        CoreTiming::EventType* event_type = syncpoint_increment_event;
+        gpu.SetSyncpointCallback([event_type](u32 syncpoint_id, u32 value) {
+            CoreTiming::ScheduleEventThreadsafe(0, event_type, syncpoint_id);
+        });
+        is_gpu_connected = true;
+    }
+    return gpu;
+}
+
+nvhost_ctrl::SyncpointEvent& nvhost_ctrl::GetEvent(u32 slot) {
+    SyncpointEvent& event = events[slot];
+    if (event.event == nullptr) {
+        event.event = Kernel::Event::Create(Kernel::ResetType::OneShot,
+                                            "nvhost_ctrl::SyncpointEvent" + std::to_string(slot));
+    }
+    return event;
+}
+
+void nvhost_ctrl::SignalSyncpointEvents(u32 syncpoint_id) {
+    const u32 value = GetGPU().GetSyncpointValue(syncpoint_id);
+    for (SyncpointEvent& event : events) {
+        if (event.is_waiting && event.syncpoint_id == syncpoint_id &&
+            IsThresholdReached(value, event.threshold)) {
+            event.is_waiting = false;
+            event.event->Signal();
+        }
+    }
+}
+
+} // namespace Devices
+} // namespace NVDRV
+} // namespace Service
@@ -0,0 +1,126 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include "common/common_types.h"
+#include "common/swap.h"
+#include "core/hle/kernel/event.h"
+#include "core/hle/service/nvdrv/devices/nvdevice.h"
+
+namespace CoreTiming {
+struct EventType;
+}
+
+namespace Tegra {
+class GPU;
+}
+
+namespace Service {
+namespace NVDRV {
+namespace Devices {
+
+/**
+ * Control device of the host1x, through which applications read and wait on the syncpoints the
+ * GPU increments as it completes their work. Waits that can't complete right away are handed an
+ * event, signalled once the GPU thread reached the syncpoint threshold.
+ */
+class nvhost_ctrl final : public nvdevice {
+public:
+    nvhost_ctrl();
+    ~nvhost_ctrl() override;
+
+    u32 ioctl(u32 command, const IoctlBuffer& input, const IoctlBuffer& output) override;
+    Kernel::SharedPtr<Kernel::Event> QueryEvent(u32 event_id) override;
+
+private:
+    /// Number of events applications can wait on syncpoints with
+    static constexpr u32 NUM_EVENTS = 64;
+
+    enum IoctlCommands {
+        IocSyncptReadCommand = 0xC0080014,
+        IocSyncptIncrCommand = 0x40040015,
+        IocSyncptWaitCommand = 0xC00C0016,
+        IocCtrlEventSignalCommand = 0xC004001C,
+        IocCtrlEventWaitCommand = 0xC010001D,
+        IocCtrlEventWaitAsyncCommand = 0xC010001E,
+        IocCtrlEventRegisterCommand = 0xC004001F,
+        IocCtrlEventUnregisterCommand = 0xC0040020,
+    };
+
+    struct IocSyncptReadParams {
+        // Input
+        u32_le id;
+        // Output
+        u32_le value;
+    };
+    static_assert(sizeof(IocSyncptReadParams) == 8, "IocSyncptReadParams has incorrect size");
+
+    struct IocSyncptIncrParams {
+        u32_le id;
+    };
+    static_assert(sizeof(IocSyncptIncrParams) == 4, "IocSyncptIncrParams has incorrect size");
+
+    struct IocSyncptWaitParams {
+        u32_le id;
+        u32_le threshold;
+        s32_le timeout;
+    };
+    static_assert(sizeof(IocSyncptWaitParams) == 12, "IocSyncptWaitParams has incorrect size");
+
+    struct IocCtrlEventWaitParams {
+        // Input
+        u32_le syncpt_id;
+        u32_le threshold;
+        s32_le timeout;
+        // Input with EventWaitAsync, the event to signal. Output, the syncpoint value once it
+        // reached the threshold, or the event that will be signalled.
+        u32_le value;
+    };
+    static_assert(sizeof(IocCtrlEventWaitParams) == 16,
+                  "IocCtrlEventWaitParams has incorrect size");
+
+    struct IocCtrlEventParams {
+        u32_le event_id;
+    };
+    static_assert(sizeof(IocCtrlEventParams) == 4, "IocCtrlEventParams has incorrect size");
+
+    /// Event applications wait on until a syncpoint reaches a threshold
+    struct SyncpointEvent {
+        Kernel::SharedPtr<Kernel::Event> event;
+        /// Registered by the application for asynchronous waits
+        bool is_registered = false;
+        bool is_waiting = false;
+        u32 syncpoint_id = 0;
+        u32 threshold = 0;
+    };
+
+    u32 SyncptRead(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 SyncptIncr(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 SyncptWait(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 EventSignal(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 EventWait(const IoctlBuffer& input, const IoctlBuffer& output, bool is_async);
+    u32 EventRegister(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 EventUnregister(const IoctlBuffer& input, const IoctlBuffer& output);
+
+    /**
+     * Returns the emulated GPU. It is created after the services, so it is only told where to
+     * report the syncpoint increments when the device is first used.
+     */
+    Tegra::GPU& GetGPU();
+    /// Returns the event of a slot, creating it on first use
+    SyncpointEvent& GetEvent(u32 slot);
+    /// Signals the events waiting on a syncpoint that reached their threshold
+    void SignalSyncpointEvents(u32 syncpoint_id);
+
+    std::array<SyncpointEvent, NUM_EVENTS> events;
+    /// Moves the syncpoint increments of the GPU thread over to the emu thread
+    CoreTiming::EventType* syncpoint_increment_event;
+    bool is_gpu_connected = false;
+};
+
+} // namespace Devices
+} // namespace NVDRV
+} // namespace Service
@@ -0,0 +1,151 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <vector>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "core/core.h"
+#include "core/hle/service/nvdrv/devices/nvhost_gpu.h"
+#include "core/tracer/workload_trace.h"
+#include "video_core/gpu.h"
+
+namespace Service {
+namespace NVDRV {
+namespace Devices {
+
+u32 nvhost_gpu::ioctl(u32 command, const IoctlBuffer& input, const IoctlBuffer& output) {
+    // The size encoded in the SubmitGPFIFO command doesn't include the GPFIFO entries that follow
+    // the parameters, so only its group and number are compared
+    if ((command & 0xFFFF) == (IocSubmitGPFIFOCommand & 0xFFFF)) {
+        return SubmitGPFIFO(input, output);
+    }
+
+    switch (command) {
+    case IocSetNVMAPfdCommand:
+        return SetNVMAPfd(input, output);
+    case IocSetClientDataCommand:
+        return SetClientData(input, output);
+    case IocGetClientDataCommand:
+        return GetClientData(input, output);
+    case IocZCullBindCommand:
+        return ZCullBind(input, output);
+    case IocSetErrorNotifierCommand:
+        return SetErrorNotifier(input, output);
+    case IocChannelSetPriorityCommand:
+        return SetChannelPriority(input, output);
+    case IocAllocGPFIFOEx2Command:
+        return AllocGPFIFOEx2(input, output);
+    case IocAllocObjCtxCommand:
+        return AllocateObjectContext(input, output);
+    }
+
+    UNIMPLEMENTED_MSG("Unimplemented ioctl 0x%08X", command);
+    return 0;
+}
+
+u32 nvhost_gpu::SetNVMAPfd(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocSetNVMAPfdParams>();
+    LOG_DEBUG(Service, "called, fd=%u", params.nvmap_fd);
+    nvmap_fd = params.nvmap_fd;
+    return 0;
+}
+
+u32 nvhost_gpu::SetClientData(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocClientDataParams>();
+    LOG_DEBUG(Service, "called");
+    user_data = params.data;
+    return 0;
+}
+
+u32 nvhost_gpu::GetClientData(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocClientDataParams>();
+    LOG_DEBUG(Service, "called");
+    params.data = user_data;
+    output.Write(params);
+    return 0;
+}
+
+u32 nvhost_gpu::ZCullBind(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocZCullBindParams>();
+    LOG_WARNING(Service, "(STUBBED) called, gpu_va=0x%llx, mode=%u", params.gpu_va, params.mode);
+    output.Write(params);
+    return 0;
+}
+
+u32 nvhost_gpu::SetErrorNotifier(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocSetErrorNotifierParams>();
+    LOG_WARNING(Service, "(STUBBED) called, offset=0x%llx, size=0x%llx, mem=0x%x",
+                params.offset, params.size, params.mem);
+    output.Write(params);
+    return 0;
+}
+
+u32 nvhost_gpu::SetChannelPriority(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocChannelSetPriorityParams>();
+    LOG_DEBUG(Service, "called, priority=0x%x", params.priority);
+    channel_priority = params.priority;
+    return 0;
+}
+
+u32 nvhost_gpu::AllocGPFIFOEx2(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocAllocGPFIFOEx2Params>();
+    LOG_WARNING(Service, "(STUBBED) called, num_entries=0x%x, flags=0x%x", params.num_entries,
+                params.flags);
+
+    // The GPFIFO entries are passed with each submission, nothing has to be allocated
+    const u32 syncpoint_value =
+        Core::System::GetInstance().GPU().GetSyncpointValue(CHANNEL_SYNCPOINT);
+    params.fence_out = {CHANNEL_SYNCPOINT, syncpoint_value};
+    output.Write(params);
+    return 0;
+}
+
+u32 nvhost_gpu::AllocateObjectContext(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocAllocObjCtxParams>();
+    LOG_WARNING(Service, "(STUBBED) called, class_num=0x%x, flags=0x%x", params.class_num,
+                params.flags);
+    params.obj_id = 0;
+    output.Write(params);
+    return 0;
+}
+
+u32 nvhost_gpu::SubmitGPFIFO(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocSubmitGPFIFOParams>();
+    LOG_TRACE(Service, "called, gpfifo=0x%llx, num_entries=%u, flags=0x%x", params.gpfifo,
+              params.num_entries, params.flags);
+
+    const size_t entries_size = params.num_entries * sizeof(Tegra::CommandListHeader);
+    ASSERT_MSG(input.Size() >= sizeof(params) + entries_size, "GPFIFO entries are truncated");
+
+    std::vector<Tegra::CommandListHeader> entries(params.num_entries);
+    std::memcpy(entries.data(), input.Data() + sizeof(params), entries_size);
+
+    Tegra::GPU& gpu = Core::System::GetInstance().GPU();
+    if (WorkloadTrace::IsEnabled()) {
+        WorkloadTrace::RecordSubmission(gpu.GetMemoryManager(), entries);
+    }
+
+    // The GPU thread processes the submissions in order, the fences the guest waits on before
+    // submitting come from earlier submissions or from the CPU
+    if (params.flags & SubmitFlags::FenceWait) {
+        LOG_TRACE(Service, "Ignored the fence wait, syncpoint=%u, value=%u", params.fence.id,
+                  params.fence.value);
+    }
+
+    // The GPU thread processes the entries asynchronously, and increments the syncpoint of the
+    // channel once it's done
+    const u32 fence_value = gpu.IncreaseSyncpointMax(CHANNEL_SYNCPOINT, 1);
+    gpu.PushCommandLists(std::move(entries), CHANNEL_SYNCPOINT);
+
+    if (params.flags & SubmitFlags::FenceGet) {
+        params.fence = {CHANNEL_SYNCPOINT, fence_value};
+    }
+    output.Write(params);
+    return 0;
+}
+
+} // namespace Devices
+} // namespace NVDRV
+} // namespace Service
@@ -0,0 +1,134 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_funcs.h"
+#include "common/common_types.h"
+#include "common/swap.h"
+#include "core/hle/service/nvdrv/devices/nvdevice.h"
+
+namespace Service {
+namespace NVDRV {
+namespace Devices {
+
+/// GPU channel, through which applications submit command lists to the GPU
+class nvhost_gpu final : public nvdevice {
+public:
+    /// Syncpoint the GPU increments as it processes the submissions of the channel
+    static constexpr u32 CHANNEL_SYNCPOINT = 1;
+
+    nvhost_gpu() = default;
+    ~nvhost_gpu() override = default;
+
+    u32 ioctl(u32 command, const IoctlBuffer& input, const IoctlBuffer& output) override;
+
+private:
+    enum IoctlCommands {
+        IocSetNVMAPfdCommand = 0x40044801,
+        IocSubmitGPFIFOCommand = 0xC0184808,
+        IocAllocObjCtxCommand = 0xC0104809,
+        IocZCullBindCommand = 0xC010480B,
+        IocSetErrorNotifierCommand = 0xC018480C,
+        IocChannelSetPriorityCommand = 0x4004480D,
+        IocAllocGPFIFOEx2Command = 0xC020481A,
+        IocSetClientDataCommand = 0x40084714,
+        IocGetClientDataCommand = 0x80084715,
+    };
+
+    enum SubmitFlags : u32 {
+        /// The GPU waits for the fence passed in before it processes the entries
+        FenceWait = 1 << 0,
+        /// The fence reached once the entries were processed is returned
+        FenceGet = 1 << 1,
+    };
+
+    struct Fence {
+        u32_le id;
+        u32_le value;
+    };
+    static_assert(sizeof(Fence) == 8, "Fence has incorrect size");
+
+    struct IocSetNVMAPfdParams {
+        u32_le nvmap_fd;
+    };
+    static_assert(sizeof(IocSetNVMAPfdParams) == 4, "IocSetNVMAPfdParams has incorrect size");
+
+    struct IocClientDataParams {
+        u64_le data;
+    };
+    static_assert(sizeof(IocClientDataParams) == 8, "IocClientDataParams has incorrect size");
+
+    struct IocZCullBindParams {
+        u64_le gpu_va;
+        u32_le mode;
+        INSERT_PADDING_WORDS(1);
+    };
+    static_assert(sizeof(IocZCullBindParams) == 16, "IocZCullBindParams has incorrect size");
+
+    struct IocSetErrorNotifierParams {
+        u64_le offset;
+        u64_le size;
+        u32_le mem;
+        INSERT_PADDING_WORDS(1);
+    };
+    static_assert(sizeof(IocSetErrorNotifierParams) == 24,
+                  "IocSetErrorNotifierParams has incorrect size");
+
+    struct IocChannelSetPriorityParams {
+        u32_le priority;
+    };
+    static_assert(sizeof(IocChannelSetPriorityParams) == 4,
+                  "IocChannelSetPriorityParams has incorrect size");
+
+    struct IocAllocGPFIFOEx2Params {
+        // Input
+        u32_le num_entries;
+        u32_le flags;
+        INSERT_PADDING_WORDS(4);
+        // Output
+        Fence fence_out;
+    };
+    static_assert(sizeof(IocAllocGPFIFOEx2Params) == 32,
+                  "IocAllocGPFIFOEx2Params has incorrect size");
+
+    struct IocAllocObjCtxParams {
+        // Input
+        u32_le class_num;
+        u32_le flags;
+        // Output
+        u64_le obj_id;
+    };
+    static_assert(sizeof(IocAllocObjCtxParams) == 16, "IocAllocObjCtxParams has incorrect size");
+
+    /// Parameters of SubmitGPFIFO, the input buffer continues with the GPFIFO entries
+    struct IocSubmitGPFIFOParams {
+        // Input
+        u64_le gpfifo;
+        u32_le num_entries;
+        u32_le flags;
+        // Input with FenceWait, output with FenceGet
+        Fence fence;
+    };
+    static_assert(sizeof(IocSubmitGPFIFOParams) == 24,
+                  "IocSubmitGPFIFOParams has incorrect size");
+
+    u32 SetNVMAPfd(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 SetClientData(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 GetClientData(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 ZCullBind(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 SetErrorNotifier(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 SetChannelPriority(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 AllocGPFIFOEx2(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 AllocateObjectContext(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 SubmitGPFIFO(const IoctlBuffer& input, const IoctlBuffer& output);
+
+    u32 nvmap_fd = 0;
+    u64 user_data = 0;
+    u32 channel_priority = 0;
+};
+
+} // namespace Devices
+} // namespace NVDRV
+} // namespace Service
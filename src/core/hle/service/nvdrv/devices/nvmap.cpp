@@ -2,8 +2,6 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
-#include <algorithm>
-
 #include "common/assert.h"
 #include "common/logging/log.h"
 #include "core/hle/service/nvdrv/devices/nvmap.h"
@@ -12,21 +10,84 @@ namespace Service {
 namespace NVDRV {
 namespace Devices {
 
+nvmap::Object& nvmap::GetObject(u32 handle) {
+    return const_cast<Object&>(static_cast<const nvmap*>(this)->GetObject(handle));
+}
+
+const nvmap::Object& nvmap::GetObject(u32 handle) const {
+    ASSERT_MSG(handle != 0 && handle <= handles.size() && handles[handle - 1] != 0,
+               "Invalid nvmap handle %u", handle);
+    return objects[handles[handle - 1] - 1];
+}
+
+u32 nvmap::CreateObject(u32 size) {
+    u32 id;
+    if (free_ids.empty()) {
+        objects.emplace_back();
+        id = static_cast<u32>(objects.size());
+    } else {
+        id = free_ids.back();
+        free_ids.pop_back();
+    }
+
+    objects[id - 1] = {size, 0, 0, 0, 0, Object::Status::Created, 0, 0};
+    return id;
+}
+
+u32 nvmap::CreateHandle(u32 id) {
+    u32 handle;
+    if (free_handles.empty()) {
+        handles.push_back(0);
+        handle = static_cast<u32>(handles.size());
+    } else {
+        handle = free_handles.back();
+        free_handles.pop_back();
+    }
+
+    handles[handle - 1] = id;
+    ++objects[id - 1].num_handles;
+    return handle;
+}
+
+void nvmap::ReleaseObjectIfUnused(u32 id) {
+    Object& object = objects[id - 1];
+    if (object.num_handles == 0 && object.num_pins == 0) {
+        object.status = Object::Status::Free;
+        free_ids.push_back(id);
+    }
+}
+
 VAddr nvmap::GetObjectAddress(u32 handle) const {
-    auto itr = handles.find(handle);
-    ASSERT(itr != handles.end());
+    const Object& object = GetObject(handle);
+    ASSERT(object.status == Object::Status::Allocated);
+    return object.addr;
+}
 
-    auto object = itr->second;
-    ASSERT(object->status == Object::Status::Allocated);
-    return object->addr;
+u32 nvmap::GetObjectSize(u32 handle) const {
+    return GetObject(handle).size;
 }
 
-u32 nvmap::ioctl(u32 command, const std::vector<u8>& input, std::vector<u8>& output) {
+u32 nvmap::PinObject(u32 handle) {
+    ++GetObject(handle).num_pins;
+    return handles[handle - 1];
+}
+
+void nvmap::UnpinObject(u32 id) {
+    ASSERT(id != 0 && id <= objects.size());
+    Object& object = objects[id - 1];
+    ASSERT_MSG(object.num_pins != 0, "nvmap object %u is not pinned", id);
+    --object.num_pins;
+    ReleaseObjectIfUnused(id);
+}
+
+u32 nvmap::ioctl(u32 command, const IoctlBuffer& input, const IoctlBuffer& output) {
     switch (command) {
     case IocCreateCommand:
         return IocCreate(input, output);
     case IocAllocCommand:
         return IocAlloc(input, output);
+    case IocFreeCommand:
+        return IocFree(input, output);
     case IocGetIdCommand:
         return IocGetId(input, output);
     case IocFromIdCommand:
@@ -35,118 +96,116 @@ u32 nvmap::ioctl(u32 command, const std::vector<u8>& input, std::vector<u8>& out
         return IocParam(input, output);
     }
 
-    UNIMPLEMENTED();
+    UNIMPLEMENTED_MSG("Unimplemented ioctl 0x%08X", command);
+    return 0;
 }
 
-u32 nvmap::IocCreate(const std::vector<u8>& input, std::vector<u8>& output) {
-    IocCreateParams params;
-    std::memcpy(&params, input.data(), sizeof(params));
+u32 nvmap::IocCreate(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocCreateParams>();
 
     // Create a new nvmap object and obtain a handle to it.
-    auto object = std::make_shared<Object>();
-    object->id = next_id++;
-    object->size = params.size;
-    object->status = Object::Status::Created;
-
-    u32 handle = next_handle++;
-    handles[handle] = std::move(object);
+    params.handle = CreateHandle(CreateObject(params.size));
 
     LOG_WARNING(Service, "(STUBBED) size 0x%08X", params.size);
 
-    params.handle = handle;
+    output.Write(params);
+    return 0;
+}
+
+u32 nvmap::IocAlloc(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocAllocParams>();
+
+    Object& object = GetObject(params.handle);
+    object.flags = params.flags;
+    object.align = params.align;
+    object.kind = params.kind;
+    object.addr = params.addr;
+    object.status = Object::Status::Allocated;
+
+    LOG_WARNING(Service, "(STUBBED) Allocated address 0x%llx", params.addr);
 
-    std::memcpy(output.data(), &params, sizeof(params));
+    output.Write(params);
     return 0;
 }
 
-u32 nvmap::IocAlloc(const std::vector<u8>& input, std::vector<u8>& output) {
-    IocAllocParams params;
-    std::memcpy(&params, input.data(), sizeof(params));
+u32 nvmap::IocFree(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocFreeParams>();
 
-    auto itr = handles.find(params.handle);
-    ASSERT(itr != handles.end());
+    LOG_DEBUG(Service, "called, handle=%u", params.handle);
 
-    auto object = itr->second;
-    object->flags = params.flags;
-    object->align = params.align;
-    object->kind = params.kind;
-    object->addr = params.addr;
-    object->status = Object::Status::Allocated;
+    const u32 id = handles[params.handle - 1];
+    Object& object = GetObject(params.handle);
+    params.address = object.addr;
+    params.size = object.size;
+    params.flags = 0;
 
-    LOG_WARNING(Service, "(STUBBED) Allocated address 0x%llx", params.addr);
+    handles[params.handle - 1] = 0;
+    free_handles.push_back(params.handle);
+    --object.num_handles;
+    ReleaseObjectIfUnused(id);
 
-    std::memcpy(output.data(), &params, sizeof(params));
+    output.Write(params);
     return 0;
 }
 
-u32 nvmap::IocGetId(const std::vector<u8>& input, std::vector<u8>& output) {
-    IocGetIdParams params;
-    std::memcpy(&params, input.data(), sizeof(params));
+u32 nvmap::IocGetId(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocGetIdParams>();
 
     LOG_WARNING(Service, "called");
 
-    auto itr = handles.find(params.handle);
-    ASSERT(itr != handles.end());
-
-    params.id = itr->second->id;
+    // Validates the handle
+    GetObject(params.handle);
+    params.id = handles[params.handle - 1];
 
-    std::memcpy(output.data(), &params, sizeof(params));
+    output.Write(params);
     return 0;
 }
 
-u32 nvmap::IocFromId(const std::vector<u8>& input, std::vector<u8>& output) {
-    IocFromIdParams params;
-    std::memcpy(&params, input.data(), sizeof(params));
+u32 nvmap::IocFromId(const IoctlBuffer& input, const IoctlBuffer& output) {
+    auto params = input.Read<IocFromIdParams>();
 
     LOG_WARNING(Service, "(STUBBED) called");
 
-    auto itr = std::find_if(handles.begin(), handles.end(),
-                            [&](const auto& entry) { return entry.second->id == params.id; });
-    ASSERT(itr != handles.end());
+    ASSERT_MSG(params.id != 0 && params.id <= objects.size() &&
+                   objects[params.id - 1].status != Object::Status::Free,
+               "Invalid nvmap object id %u", params.id);
 
     // Make a new handle for the object
-    u32 handle = next_handle++;
-    handles[handle] = itr->second;
+    params.handle = CreateHandle(params.id);
 
-    params.handle = handle;
-
-    std::memcpy(output.data(), &params, sizeof(params));
+    output.Write(params);
     return 0;
 }
 
-u32 nvmap::IocParam(const std::vector<u8>& input, std::vector<u8>& output) {
+u32 nvmap::IocParam(const IoctlBuffer& input, const IoctlBuffer& output) {
     enum class ParamTypes { Size = 1, Alignment = 2, Base = 3, Heap = 4, Kind = 5, Compr = 6 };
 
-    IocParamParams params;
-    std::memcpy(&params, input.data(), sizeof(params));
+    auto params = input.Read<IocParamParams>();
 
     LOG_WARNING(Service, "(STUBBED) called type=%u", params.type);
 
-    auto itr = handles.find(params.handle);
-    ASSERT(itr != handles.end());
-
-    auto object = itr->second;
-    ASSERT(object->status == Object::Status::Allocated);
+    const Object& object = GetObject(params.handle);
+    ASSERT(object.status == Object::Status::Allocated);
 
     switch (static_cast<ParamTypes>(params.type)) {
     case ParamTypes::Size:
-        params.value = object->size;
+        params.value = object.size;
         break;
     case ParamTypes::Alignment:
-        params.value = object->align;
+        params.value = object.align;
         break;
     case ParamTypes::Heap:
         // TODO(Subv): Seems to be a hardcoded value?
         params.value = 0x40000000;
         break;
     case ParamTypes::Kind:
-        params.value = object->kind;
+        params.value = object.kind;
         break;
     default:
         UNIMPLEMENTED();
     }
 
-    std::memcpy(output.data(), &params, sizeof(params));
+    output.Write(params);
     return 0;
 }
 
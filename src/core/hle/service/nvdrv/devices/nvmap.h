@@ -4,8 +4,6 @@
 
 #pragma once
 
-#include <memory>
-#include <unordered_map>
 #include <vector>
 #include "common/common_funcs.h"
 #include "common/common_types.h"
@@ -24,34 +22,60 @@ public:
     /// Returns the allocated address of an nvmap object given its handle.
     VAddr GetObjectAddress(u32 handle) const;
 
-    u32 ioctl(u32 command, const std::vector<u8>& input, std::vector<u8>& output) override;
+    /// Returns the size of an nvmap object given its handle.
+    u32 GetObjectSize(u32 handle) const;
+
+    /**
+     * Pins the object of a handle, so that it stays allocated when its handles are freed.
+     * @returns The id of the object, to unpin it with.
+     */
+    u32 PinObject(u32 handle);
+
+    /// Releases a pin taken with PinObject, given the id of the object
+    void UnpinObject(u32 id);
+
+    u32 ioctl(u32 command, const IoctlBuffer& input, const IoctlBuffer& output) override;
 
 private:
     // Represents an nvmap object.
     struct Object {
-        enum class Status { Created, Allocated };
-        u32 id;
+        enum class Status { Free, Created, Allocated };
         u32 size;
         u32 flags;
         u32 align;
         u8 kind;
         VAddr addr;
         Status status;
+        /// Number of handles referring to the object
+        u32 num_handles;
+        /// Number of pins taken on the object
+        u32 num_pins;
     };
 
-    /// Id to use for the next handle that is created.
-    u32 next_handle = 1;
+    /// Objects, indexed by their id minus one. The slots of destroyed objects are reused.
+    std::vector<Object> objects;
+    std::vector<u32> free_ids;
 
-    // Id to use for the next object that is created.
-    u32 next_id = 1;
+    /// Id of the object each handle refers to, indexed by the handle minus one. Free handles
+    /// refer to id zero and are reused.
+    std::vector<u32> handles;
+    std::vector<u32> free_handles;
 
-    /// Mapping of currently allocated handles to the objects they represent.
-    std::unordered_map<u32, std::shared_ptr<Object>> handles;
+    Object& GetObject(u32 handle);
+    const Object& GetObject(u32 handle) const;
+
+    /// Creates a new object and returns its id
+    u32 CreateObject(u32 size);
+    /// Creates a new handle referring to an object
+    u32 CreateHandle(u32 id);
+    /// Destroys an object once nothing refers to it anymore
+    void ReleaseObjectIfUnused(u32 id);
 
     enum IoctlCommands {
         IocCreateCommand = 0xC0080101,
         IocFromIdCommand = 0xC0080103,
         IocAllocCommand = 0xC0200104,
+        IocFreeCommand = 0xC0180105,
         IocParamCommand = 0xC00C0109,
         IocGetIdCommand = 0xC008010E
     };
@@ -74,6 +98,16 @@ private:
         u64_le addr;
     };
 
+    struct IocFreeParams {
+        // Input
+        u32_le handle;
+        INSERT_PADDING_WORDS(1);
+        // Output
+        u64_le address;
+        u32_le size;
+        u32_le flags;
+    };
+
     struct IocGetIdParams {
         // Output
         u32_le id;
@@ -96,11 +130,12 @@ private:
         u32_le value;
     };
 
-    u32 IocCreate(const std::vector<u8>& input, std::vector<u8>& output);
-    u32 IocAlloc(const std::vector<u8>& input, std::vector<u8>& output);
-    u32 IocGetId(const std::vector<u8>& input, std::vector<u8>& output);
-    u32 IocFromId(const std::vector<u8>& input, std::vector<u8>& output);
-    u32 IocParam(const std::vector<u8>& input, std::vector<u8>& output);
+    u32 IocCreate(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 IocAlloc(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 IocFree(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 IocGetId(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 IocFromId(const IoctlBuffer& input, const IoctlBuffer& output);
+    u32 IocParam(const IoctlBuffer& input, const IoctlBuffer& output);
 };
 
 } // namespace Devices
@@ -2,80 +2,122 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <vector>
 #include "common/logging/log.h"
 #include "core/hle/ipc_helpers.h"
 #include "core/hle/service/nvdrv/devices/nvdevice.h"
 #include "core/hle/service/nvdrv/devices/nvdisp_disp0.h"
 #include "core/hle/service/nvdrv/devices/nvhost_as_gpu.h"
+#include "core/hle/service/nvdrv/devices/nvhost_ctrl.h"
+#include "core/hle/service/nvdrv/devices/nvhost_gpu.h"
 #include "core/hle/service/nvdrv/devices/nvmap.h"
 #include "core/hle/service/nvdrv/nvdrv.h"
 #include "core/hle/service/nvdrv/nvdrv_a.h"
+#include "core/tracer/workload_trace.h"
 
 namespace Service {
 namespace NVDRV {
 
-void NVDRV_A::Open(Kernel::HLERequestContext& ctx) {
+std::tuple<ResultCode, u32, u32> NVDRV_A::Open(IPC::BufferA device_path) {
     LOG_WARNING(Service, "(STUBBED) called");
 
-    auto buffer = ctx.BufferDescriptorA()[0];
-
-    std::string device_name = Memory::ReadCString(buffer.Address(), buffer.Size());
+    std::string device_name = Memory::ReadCString(device_path.Address(), device_path.Size());
 
     auto device = devices[device_name];
     u32 fd = next_fd++;
 
     open_files[fd] = device;
 
-    IPC::RequestBuilder rb{ctx, 4};
-    rb.Push(RESULT_SUCCESS);
-    rb.Push<u32>(fd);
-    rb.Push<u32>(0);
+    return {RESULT_SUCCESS, fd, 0};
 }
 
-void NVDRV_A::Ioctl(Kernel::HLERequestContext& ctx) {
+std::tuple<ResultCode, u32> NVDRV_A::Ioctl(Kernel::HLERequestContext& ctx, u32 fd, u32 command,
+                                           IPC::BufferA input_buffer,
+                                           IPC::BufferB output_buffer) {
     LOG_WARNING(Service, "(STUBBED) called");
 
-    IPC::RequestParser rp{ctx};
-    u32 fd = rp.Pop<u32>();
-    u32 command = rp.Pop<u32>();
-
-    auto input_buffer = ctx.BufferDescriptorA()[0];
-    auto output_buffer = ctx.BufferDescriptorB()[0];
-
-    std::vector<u8> input(input_buffer.Size());
-    std::vector<u8> output(output_buffer.Size());
-
-    Memory::ReadBlock(input_buffer.Address(), input.data(), input_buffer.Size());
     auto itr = open_files.find(fd);
     ASSERT_MSG(itr != open_files.end(), "Tried to talk to an invalid device");
 
-    auto device = itr->second;
-    u32 nv_result = device->ioctl(command, input, output);
-
-    Memory::WriteBlock(output_buffer.Address(), output.data(), output_buffer.Size());
-
-    IPC::RequestBuilder rb{ctx, 3};
-    rb.Push(RESULT_SUCCESS);
-    rb.Push(nv_result);
+    // Devices access the parameters in place in guest memory. Buffers that aren't contiguous in
+    // host memory are staged through scratch buffers instead, which keep their storage across
+    // requests so that this doesn't allocate either.
+    u8* input_data = input_buffer.Data();
+    if (!input_buffer.IsContiguous()) {
+        std::vector<u8>& input = ctx.ScratchBuffer(0, input_buffer.Size());
+        input_buffer.Read(0, input.data(), input.size());
+        input_data = input.data();
+    }
+    u8* output_data = output_buffer.Data();
+    if (!output_buffer.IsContiguous()) {
+        output_data = ctx.ScratchBuffer(1, output_buffer.Size()).data();
+    }
+
+    // The ioctl may overwrite its input, which is traced as it was passed
+    std::vector<u8> traced_input;
+    if (WorkloadTrace::IsEnabled()) {
+        traced_input.assign(input_data, input_data + input_buffer.Size());
+    }
+
+    const Devices::IoctlBuffer input{input_data, input_buffer.Size()};
+    const Devices::IoctlBuffer output{output_data, output_buffer.Size()};
+    u32 nv_result = itr->second->ioctl(command, input, output);
+
+    if (WorkloadTrace::IsEnabled()) {
+        WorkloadTrace::RecordIoctl(fd, command, nv_result, traced_input, output_data,
+                                   output_buffer.Size());
+    }
+
+    if (!output_buffer.IsContiguous()) {
+        output_buffer.Write(0, output_data, output_buffer.Size());
+    }
+
+    return {RESULT_SUCCESS, nv_result};
 }
 
-void NVDRV_A::Initialize(Kernel::HLERequestContext& ctx) {
+std::tuple<ResultCode, u32> NVDRV_A::Initialize() {
     LOG_WARNING(Service, "(STUBBED) called");
-    IPC::RequestBuilder rb{ctx, 3};
+    return {RESULT_SUCCESS, 0};
+}
+
+void NVDRV_A::QueryEvent(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const u32 fd = rp.Pop<u32>();
+    const u32 event_id = rp.Pop<u32>();
+    LOG_DEBUG(Service, "called, fd=%u, event_id=0x%x", fd, event_id);
+
+    Kernel::SharedPtr<Kernel::Event> event;
+    auto itr = open_files.find(fd);
+    if (itr != open_files.end()) {
+        event = itr->second->QueryEvent(event_id);
+    }
+    if (event == nullptr) {
+        LOG_ERROR(Service, "No event 0x%x on fd %u", event_id, fd);
+        IPC::RequestBuilder rb{ctx, 3};
+        rb.Push(RESULT_SUCCESS);
+        rb.Push<u32>(Devices::NvErrCodes::BadParameter);
+        return;
+    }
+
+    IPC::RequestBuilder rb{ctx, 3, 1};
     rb.Push(RESULT_SUCCESS);
-    rb.Push<u32>(0);
+    rb.Push<u32>(Devices::NvErrCodes::Success);
+    rb.PushCopyObjects(event);
 }
 
 NVDRV_A::NVDRV_A() : ServiceFramework("nvdrv:a") {
     static const FunctionInfo functions[] = {
-        {0, &NVDRV_A::Open, "Open"},
-        {1, &NVDRV_A::Ioctl, "Ioctl"},
-        {3, &NVDRV_A::Initialize, "Initialize"},
+        {0, &NVDRV_A::Marshal<&NVDRV_A::Open>, "Open"},
+        {1, &NVDRV_A::Marshal<&NVDRV_A::Ioctl>, "Ioctl"},
+        {3, &NVDRV_A::Marshal<&NVDRV_A::Initialize>, "Initialize"},
+        {4, &NVDRV_A::QueryEvent, "QueryEvent"},
     };
     RegisterHandlers(functions);
 
     auto nvmap_dev = std::make_shared<Devices::nvmap>();
-    devices["/dev/nvhost-as-gpu"] = std::make_shared<Devices::nvhost_as_gpu>();
+    devices["/dev/nvhost-as-gpu"] = std::make_shared<Devices::nvhost_as_gpu>(nvmap_dev);
+    devices["/dev/nvhost-ctrl"] = std::make_shared<Devices::nvhost_ctrl>();
+    devices["/dev/nvhost-gpu"] = std::make_shared<Devices::nvhost_gpu>();
     devices["/dev/nvmap"] = nvmap_dev;
     devices["/dev/nvdisp_disp0"] = std::make_shared<Devices::nvdisp_disp0>(nvmap_dev);
 }
@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <string>
+#include <tuple>
 #include "core/hle/service/nvdrv/nvdrv.h"
 #include "core/hle/service/service.h"
 
@@ -31,9 +32,11 @@ public:
     }
 
 private:
-    void Open(Kernel::HLERequestContext& ctx);
-    void Ioctl(Kernel::HLERequestContext& ctx);
-    void Initialize(Kernel::HLERequestContext& ctx);
+    std::tuple<ResultCode, u32, u32> Open(IPC::BufferA device_path);
+    std::tuple<ResultCode, u32> Ioctl(Kernel::HLERequestContext& ctx, u32 fd, u32 command,
+                                      IPC::BufferA input_buffer, IPC::BufferB output_buffer);
+    std::tuple<ResultCode, u32> Initialize();
+    void QueryEvent(Kernel::HLERequestContext& ctx);
 
     /// Id to use for the next open file descriptor.
     u32 next_fd = 1;
@@ -3,10 +3,14 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <fmt/format.h>
 #include "common/assert.h"
 #include "common/logging/log.h"
+#include "common/microprofile.h"
 #include "common/string_util.h"
+#include "core/core.h"
 #include "core/hle/ipc.h"
 #include "core/hle/ipc_helpers.h"
 #include "core/hle/kernel/client_port.h"
@@ -25,8 +29,11 @@
 #include "core/hle/service/service.h"
 #include "core/hle/service/sm/controller.h"
 #include "core/hle/service/sm/sm.h"
+#include "core/hle/service/sockets/sockets.h"
 #include "core/hle/service/time/time.h"
 #include "core/hle/service/vi/vi.h"
+#include "core/tracer/ipc_capture.h"
+#include "core/tracer/workload_trace.h"
 
 using Kernel::ClientPort;
 using Kernel::ServerPort;
@@ -57,7 +64,13 @@ static std::string MakeFunctionString(const char* name, const char* port_name,
 
 ServiceFrameworkBase::ServiceFrameworkBase(const char* service_name, u32 max_sessions,
                                            InvokerFn* handler_invoker)
-    : service_name(service_name), max_sessions(max_sessions), handler_invoker(handler_invoker) {}
+    : service_name(service_name), max_sessions(max_sessions), handler_invoker(handler_invoker) {
+#if MICROPROFILE_ENABLED
+    // Instances of the same interface share the token
+    profile_token = MicroProfileGetToken("Service", service_name, MP_RGB(200, 100, 200),
+                                         MicroProfileTokenTypeCpu);
+#endif
+}
 
 ServiceFrameworkBase::~ServiceFrameworkBase() = default;
 
@@ -91,8 +104,47 @@ void ServiceFrameworkBase::RegisterHandlersBase(const FunctionInfoBase* function
     handlers.reserve(handlers.size() + n);
     for (size_t i = 0; i < n; ++i) {
         // Usually this array is sorted by id already, so hint to insert at the end
-        handlers.emplace_hint(handlers.cend(), functions[i].expected_header, functions[i]);
+        const FunctionInfoBase& info = functions[i];
+        CommandStats& stats = GetCommandStats(service_name, info.expected_header, info.name,
+                                              info.handler_callback != nullptr);
+        handlers.emplace_hint(handlers.cend(), info.expected_header, Handler{info, &stats});
+    }
+    BuildDenseHandlerTable();
+}
+
+/// Largest command id for which a dense handler table is built
+constexpr u32 MAX_DENSE_COMMAND_ID = 0x3FF;
+/// Maximum number of dense table entries per registered handler, i.e. at least 25% occupancy
+constexpr size_t MAX_DENSE_TABLE_ENTRIES_PER_HANDLER = 4;
+
+void ServiceFrameworkBase::BuildDenseHandlerTable() {
+    dense_handlers.clear();
+    if (handlers.empty()) {
+        return;
+    }
+
+    // The map is sorted, so the last entry has the largest id
+    const u32 max_command = handlers.rbegin()->first;
+    const size_t table_size = static_cast<size_t>(max_command) + 1;
+    if (max_command > MAX_DENSE_COMMAND_ID ||
+        table_size > handlers.size() * MAX_DENSE_TABLE_ENTRIES_PER_HANDLER) {
+        return;
     }
+
+    // Pointers into the map stay valid until handlers are registered again, which rebuilds this
+    dense_handlers.assign(table_size, nullptr);
+    for (auto& entry : handlers) {
+        dense_handlers[entry.first] = &entry.second;
+    }
+}
+
+ServiceFrameworkBase::Handler* ServiceFrameworkBase::FindHandler(u32 command) {
+    if (!dense_handlers.empty()) {
+        return command < dense_handlers.size() ? dense_handlers[command] : nullptr;
+    }
+
+    auto itr = handlers.find(command);
+    return itr == handlers.end() ? nullptr : &itr->second;
 }
 
 void ServiceFrameworkBase::ReportUnimplementedFunction(Kernel::HLERequestContext& ctx,
@@ -113,19 +165,35 @@ void ServiceFrameworkBase::ReportUnimplementedFunction(Kernel::HLERequestContext
 }
 
 void ServiceFrameworkBase::InvokeRequest(Kernel::HLERequestContext& ctx) {
-    auto itr = handlers.find(ctx.GetCommand());
-    const FunctionInfoBase* info = itr == handlers.end() ? nullptr : &itr->second;
+    Handler* handler = FindHandler(ctx.GetCommand());
+    const FunctionInfoBase* info = handler == nullptr ? nullptr : &handler->info;
     if (info == nullptr || info->handler_callback == nullptr) {
+        CommandStats& stats = handler != nullptr
+                                  ? *handler->stats
+                                  : GetCommandStats(service_name, ctx.GetCommand(), nullptr, false);
+        stats.Record(0, ctx.GetBufferDescriptorBytes());
         return ReportUnimplementedFunction(ctx, info);
     }
 
     LOG_TRACE(
         Service, "%s",
         MakeFunctionString(info->name, GetServiceName().c_str(), ctx.CommandBuffer()).c_str());
-    handler_invoker(this, info->handler_callback, ctx);
+
+    using std::chrono::steady_clock;
+    const steady_clock::time_point start = steady_clock::now();
+    {
+        MICROPROFILE_SCOPE_TOKEN(profile_token);
+        MICROPROFILE_META_CPU("IPC requests", 1);
+        handler_invoker(this, info->handler_callback, ctx);
+    }
+    const auto elapsed = steady_clock::now() - start;
+    const u64 elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    Core::System::GetInstance().perf_stats.AddFramePhaseTime(
+        Core::PerfStats::FramePhase::HleServices, std::chrono::nanoseconds(elapsed_ns));
+    handler->stats->Record(elapsed_ns, ctx.GetBufferDescriptorBytes());
 }
 
-ResultCode ServiceFrameworkBase::HandleSyncRequest(Kernel::HLERequestContext& context) {
+ResultCode ServiceFrameworkBase::DispatchRequest(Kernel::HLERequestContext& context) {
     switch (context.GetCommandType()) {
     case IPC::CommandType::Close: {
         IPC::RequestBuilder rb{context, 1};
@@ -143,10 +211,36 @@ ResultCode ServiceFrameworkBase::HandleSyncRequest(Kernel::HLERequestContext& co
     default:
         UNIMPLEMENTED_MSG("command_type=%d", context.GetCommandType());
     }
+    return RESULT_SUCCESS;
+}
+
+ResultCode ServiceFrameworkBase::HandleSyncRequest(Kernel::HLERequestContext& context) {
+    ResultCode result = RESULT_SUCCESS;
+    if (IPCCapture::IsEnabled()) {
+        IPCCapture::Record record;
+        IPCCapture::BeginRecord(record, service_name, context);
+        result = DispatchRequest(context);
+        IPCCapture::EndRecord(record, context, result.raw);
+    } else if (WorkloadTrace::IsEnabled()) {
+        // The response replaces the request in the command buffer
+        std::array<u32, IPC::COMMAND_BUFFER_LENGTH> request;
+        std::copy_n(context.CommandBuffer(), request.size(), request.begin());
+        result = DispatchRequest(context);
+        WorkloadTrace::RecordIPC(service_name, result.raw, request.data(),
+                                 context.IsAsync() ? nullptr : context.CommandBuffer());
+    } else {
+        result = DispatchRequest(context);
+    }
+
+    // Asynchronous requests write their response once they complete. Closing the session doesn't
+    // have a response the client reads.
+    if (context.IsAsync() || result.IsError()) {
+        return result;
+    }
 
     u32* cmd_buf = (u32*)Memory::GetPointer(Kernel::GetCurrentThread()->GetTLSAddress());
     context.WriteToOutgoingCommandBuffer(cmd_buf, *Kernel::g_current_process,
-                                         Kernel::g_handle_table);
+                                         Kernel::g_current_process->handle_table);
 
     return RESULT_SUCCESS;
 }
@@ -154,6 +248,22 @@ ResultCode ServiceFrameworkBase::HandleSyncRequest(Kernel::HLERequestContext& co
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Module interface
 
+/// Logs the call counts and latencies of every command that was called
+static void LogCommandStats() {
+    for (const CommandStatsEntry& entry : GetCommandStatsSnapshot()) {
+        const CommandStats& stats = entry.stats;
+        LOG_DEBUG(Service,
+                  "%s: command %u (%s) called %llu times, average %llu ns, median < %llu ns, "
+                  "max %llu ns, %llu buffer bytes",
+                  entry.service_name.c_str(), entry.command_id, entry.command_name.c_str(),
+                  static_cast<unsigned long long>(stats.calls),
+                  static_cast<unsigned long long>(stats.total_ns / stats.calls),
+                  static_cast<unsigned long long>(stats.GetMedianBoundNs()),
+                  static_cast<unsigned long long>(stats.max_ns),
+                  static_cast<unsigned long long>(stats.buffer_bytes));
+    }
+}
+
 // TODO(yuriks): Move to kernel
 void AddNamedPort(std::string name, SharedPtr<ClientPort> port) {
     g_kernel_named_ports.emplace(std::move(name), std::move(port));
@@ -161,6 +271,7 @@ void AddNamedPort(std::string name, SharedPtr<ClientPort> port) {
 
 /// Initialize ServiceManager
 void Init() {
+    ClearCommandStats();
     SM::g_service_manager = std::make_shared<SM::ServiceManager>();
     SM::ServiceManager::InstallInterfaces(SM::g_service_manager);
 
@@ -172,6 +283,7 @@ void Init() {
     LM::InstallInterfaces(*SM::g_service_manager);
     NVDRV::InstallInterfaces(*SM::g_service_manager);
     PCTL::InstallInterfaces(*SM::g_service_manager);
+    Sockets::InstallInterfaces(*SM::g_service_manager);
     Time::InstallInterfaces(*SM::g_service_manager);
     VI::InstallInterfaces(*SM::g_service_manager);
 
@@ -180,6 +292,7 @@ void Init() {
 
 /// Shutdown ServiceManager
 void Shutdown() {
+    LogCommandStats();
     SM::g_service_manager = nullptr;
     g_kernel_named_ports.clear();
     LOG_DEBUG(Service, "shutdown OK");
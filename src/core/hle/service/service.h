@@ -7,11 +7,14 @@
 #include <cstddef>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <boost/container/flat_map.hpp>
 #include "common/bit_field.h"
 #include "common/common_types.h"
+#include "core/hle/ipc_marshal.h"
 #include "core/hle/kernel/hle_ipc.h"
 #include "core/hle/kernel/kernel.h"
+#include "core/hle/service/command_stats.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Namespace Service
@@ -63,6 +66,12 @@ public:
 
     void InvokeRequest(Kernel::HLERequestContext& ctx);
 
+    /**
+     * Handles a request without writing the response back to the requesting thread, which is left
+     * in the context's command buffer. Used by HandleSyncRequest and to replay IPC captures.
+     */
+    ResultCode DispatchRequest(Kernel::HLERequestContext& context);
+
     ResultCode HandleSyncRequest(Kernel::HLERequestContext& context) override;
 
 protected:
@@ -83,12 +92,24 @@ private:
     using InvokerFn = void(ServiceFrameworkBase* object, HandlerFnP<ServiceFrameworkBase> member,
                            Kernel::HLERequestContext& ctx);
 
+    struct Handler {
+        FunctionInfoBase info;
+        /// Statistics of the command, shared with the other instances of the service
+        CommandStats* stats;
+    };
+
     ServiceFrameworkBase(const char* service_name, u32 max_sessions, InvokerFn* handler_invoker);
     ~ServiceFrameworkBase();
 
     void RegisterHandlersBase(const FunctionInfoBase* functions, size_t n);
     void ReportUnimplementedFunction(Kernel::HLERequestContext& ctx, const FunctionInfoBase* info);
 
+    /// Returns the handler of a command, or nullptr if the service doesn't know the command
+    Handler* FindHandler(u32 command);
+
+    /// Rebuilds the dense handler table if the registered command ids allow for it
+    void BuildDenseHandlerTable();
+
     /// Identifier string used to connect to the service.
     std::string service_name;
     /// Maximum number of concurrent sessions that this service can handle.
@@ -102,7 +123,14 @@ private:
 
     /// Function used to safely up-cast pointers to the derived class before invoking a handler.
     InvokerFn* handler_invoker;
-    boost::container::flat_map<u32, FunctionInfoBase> handlers;
+    boost::container::flat_map<u32, Handler> handlers;
+    /**
+     * Handlers indexed directly by command id, used instead of the map when the registered ids are
+     * small and dense enough. Entries for unregistered ids are nullptr.
+     */
+    std::vector<Handler*> dense_handlers;
+    /// MicroProfile timer of the handlers of the service
+    u64 profile_token = 0;
 };
 
 /**
@@ -163,6 +191,16 @@ protected:
         RegisterHandlersBase(functions, n);
     }
 
+    /**
+     * Adapts a typed handler, whose request and response layouts are derived from its signature as
+     * described in ipc_marshal.h, for registration in a FunctionInfo:
+     * `{1, &Foo::Marshal<&Foo::Bar>, "Bar"}`.
+     */
+    template <auto handler>
+    void Marshal(Kernel::HLERequestContext& ctx) {
+        IPC::InvokeMarshalled(static_cast<Self*>(this), handler, ctx);
+    }
+
 private:
     /**
      * This function is used to allow invocation of pointers to handlers stored in the base class
@@ -0,0 +1,83 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <type_traits>
+#include "common/alignment.h"
+#include "common/common_types.h"
+#include "common/swap.h"
+#include "core/hle/kernel/shared_memory.h"
+#include "core/memory.h"
+
+namespace Service {
+
+/**
+ * Pages of shared memory a service publishes its state in. The guest maps them read-only and reads
+ * the state directly, instead of requesting it through IPC every time. The state is only written
+ * on the emu thread, while the guest may read it at any time from any core, so updates that span
+ * more than one store go through the publishing helpers below.
+ * @tparam Layout Structure of the pages as the guest sees them.
+ */
+template <typename Layout>
+class SharedStatePage final {
+public:
+    static_assert(std::is_trivially_copyable<Layout>::value,
+                  "The layout is read by the guest as is");
+
+    /// Creates the pages, zero-filled, at least as large as the layout
+    explicit SharedStatePage(std::string name)
+        : shared_memory(Kernel::SharedMemory::Create(
+              nullptr, static_cast<u32>(Common::AlignUp(sizeof(Layout), Memory::PAGE_SIZE)),
+              Kernel::MemoryPermission::ReadWrite, Kernel::MemoryPermission::Read, 0,
+              Kernel::MemoryRegion::BASE, std::move(name))) {}
+
+    Layout& Get() {
+        return *reinterpret_cast<Layout*>(shared_memory->GetPointer());
+    }
+
+    /// The shared memory object handed to the guest, for it to map the pages
+    const Kernel::SharedPtr<Kernel::SharedMemory>& GetSharedMemory() const {
+        return shared_memory;
+    }
+
+private:
+    Kernel::SharedPtr<Kernel::SharedMemory> shared_memory;
+};
+
+/**
+ * Value published twice in shared state: the counter selects the copy to read, and updates are
+ * written into the other copy before the counter is incremented. Readers retry if the counter
+ * changed while they were copying the value.
+ */
+template <typename T>
+struct DoubleBufferedState {
+    u32_le counter;
+    std::array<T, 2> entries;
+};
+
+/// Publishes a new value, the guest never sees it partially written
+template <typename T>
+void PublishState(DoubleBufferedState<T>& state, const T& value) {
+    const u32 counter = state.counter;
+    state.entries[(counter + 1) % 2] = value;
+    // The entry must be visible before the counter selects it
+    std::atomic_thread_fence(std::memory_order_release);
+    state.counter = counter + 1;
+}
+
+/**
+ * Stores the index that makes newly written entries visible to the guest, such as the latest
+ * entry of a ring buffer, once the entries themselves are visible.
+ */
+template <typename Index, typename Value>
+void PublishIndex(Index& index, Value value) {
+    std::atomic_thread_fence(std::memory_order_release);
+    index = static_cast<Index>(value);
+}
+
+} // namespace Service
@@ -13,9 +13,10 @@ namespace SM {
 void Controller::ConvertSessionToDomain(Kernel::HLERequestContext& ctx) {
     auto domain = Kernel::Domain::CreateFromSession(*ctx.ServerSession()->parent).Unwrap();
 
+    // The session's handler is the domain's first and only object
     IPC::RequestBuilder rb{ctx, 3};
     rb.Push(RESULT_SUCCESS);
-    rb.Push(static_cast<u32>(domain->request_handlers.size()));
+    rb.Push<u32>(1);
 
     LOG_DEBUG(Service, "called, domain=%d", domain->GetObjectId());
 }
@@ -0,0 +1,137 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include "common/assert.h"
+#include "common/common_types.h"
+
+namespace Service {
+namespace SM {
+
+/**
+ * Service name packed into an integer, the way it is passed in IPC requests: the characters are
+ * stored in memory order and the unused ones are zero. Valid names are never zero.
+ */
+using ServiceName = u64;
+
+/// Maximum length of a service name
+constexpr size_t MAX_SERVICE_NAME_SIZE = sizeof(ServiceName);
+
+/// Packs a name of at most MAX_SERVICE_NAME_SIZE characters
+inline ServiceName PackServiceName(const char* name, size_t size) {
+    ASSERT(size <= MAX_SERVICE_NAME_SIZE);
+    ServiceName packed = 0;
+    std::memcpy(&packed, name, size);
+    return packed;
+}
+
+/// Returns the characters of a packed name, up to the first NUL
+inline std::string UnpackServiceName(ServiceName name) {
+    char chars[MAX_SERVICE_NAME_SIZE + 1] = {};
+    std::memcpy(chars, &name, MAX_SERVICE_NAME_SIZE);
+    return chars;
+}
+
+/**
+ * Map with packed service names as keys, using open addressing with linear probing. It only ever
+ * holds a few dozen entries, so looking up a name typically touches a single cache line and never
+ * allocates. Entries can't be removed, matching the lifetime of service registrations.
+ */
+template <typename T>
+class ServiceNameTable {
+public:
+    /// Returns the value registered for a name, or nullptr if there is none
+    T* Find(ServiceName name) {
+        if (num_entries == 0) {
+            return nullptr;
+        }
+
+        for (size_t index = Hash(name);; index = (index + 1) & Mask()) {
+            Entry& entry = entries[index];
+            if (entry.name == name) {
+                return &entry.value;
+            }
+            if (entry.name == 0) {
+                return nullptr;
+            }
+        }
+    }
+
+    /**
+     * Adds a value for a name that isn't in the table yet.
+     * @returns False if the name is already in the table.
+     */
+    bool Insert(ServiceName name, T value) {
+        ASSERT(name != 0);
+        if (Find(name) != nullptr) {
+            return false;
+        }
+
+        // Keep the load factor at or below one half, so that probe sequences stay short
+        if ((num_entries + 1) * 2 > entries.size()) {
+            Grow();
+        }
+        InsertNew(name, std::move(value));
+        return true;
+    }
+
+    void Clear() {
+        entries.clear();
+        num_entries = 0;
+    }
+
+    size_t Size() const {
+        return num_entries;
+    }
+
+private:
+    struct Entry {
+        ServiceName name = 0;
+        T value{};
+    };
+
+    static constexpr size_t INITIAL_CAPACITY = 64;
+
+    size_t Mask() const {
+        return entries.size() - 1;
+    }
+
+    size_t Hash(ServiceName name) const {
+        // Fibonacci hashing, the high bits of the product depend on all the characters
+        return static_cast<size_t>((name * 0x9E3779B97F4A7C15ULL) >> 32) & Mask();
+    }
+
+    void InsertNew(ServiceName name, T value) {
+        size_t index = Hash(name);
+        while (entries[index].name != 0) {
+            index = (index + 1) & Mask();
+        }
+        entries[index].name = name;
+        entries[index].value = std::move(value);
+        ++num_entries;
+    }
+
+    void Grow() {
+        std::vector<Entry> old_entries(entries.empty() ? INITIAL_CAPACITY : entries.size() * 2);
+        std::swap(entries, old_entries);
+        num_entries = 0;
+        for (Entry& entry : old_entries) {
+            if (entry.name != 0) {
+                InsertNew(entry.name, std::move(entry.value));
+            }
+        }
+    }
+
+    /// Capacity is zero or a power of two
+    std::vector<Entry> entries;
+    size_t num_entries = 0;
+};
+
+} // namespace SM
+} // namespace Service
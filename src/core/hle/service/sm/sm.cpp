@@ -20,7 +20,7 @@ void ServiceManager::InvokeControlRequest(Kernel::HLERequestContext& context) {
 }
 
 static ResultCode ValidateServiceName(const std::string& name) {
-    if (name.size() <= 0 || name.size() > 8) {
+    if (name.size() <= 0 || name.size() > MAX_SERVICE_NAME_SIZE) {
         return ERR_INVALID_NAME_SIZE;
     }
     if (name.find('\0') != std::string::npos) {
@@ -29,6 +29,24 @@ static ResultCode ValidateServiceName(const std::string& name) {
     return RESULT_SUCCESS;
 }
 
+static ResultCode ValidateServiceName(ServiceName name) {
+    if (name == 0) {
+        return ERR_INVALID_NAME_SIZE;
+    }
+
+    // The name ends at its first NUL, the characters after it must all be NUL too. Each byte
+    // holds one character, the first one in the lowest byte.
+    bool ended = false;
+    for (size_t index = 0; index < MAX_SERVICE_NAME_SIZE; ++index) {
+        const bool is_nul = ((name >> (index * 8)) & 0xFF) == 0;
+        if (ended && !is_nul) {
+            return ERR_NAME_CONTAINS_NUL;
+        }
+        ended |= is_nul;
+    }
+    return RESULT_SUCCESS;
+}
+
 void ServiceManager::InstallInterfaces(std::shared_ptr<ServiceManager> self) {
     ASSERT(self->sm_interface.expired());
 
@@ -43,14 +61,15 @@ ResultVal<Kernel::SharedPtr<Kernel::ServerPort>> ServiceManager::RegisterService
 
     CASCADE_CODE(ValidateServiceName(name));
 
-    if (registered_services.find(name) != registered_services.end())
+    const ServiceName packed_name = PackServiceName(name.data(), name.size());
+    if (registered_services.Find(packed_name) != nullptr)
         return ERR_ALREADY_REGISTERED;
 
     Kernel::SharedPtr<Kernel::ServerPort> server_port;
     Kernel::SharedPtr<Kernel::ClientPort> client_port;
     std::tie(server_port, client_port) = Kernel::ServerPort::CreatePortPair(max_sessions, name);
 
-    registered_services.emplace(std::move(name), std::move(client_port));
+    registered_services.Insert(packed_name, std::move(client_port));
     return MakeResult<Kernel::SharedPtr<Kernel::ServerPort>>(std::move(server_port));
 }
 
@@ -58,12 +77,17 @@ ResultVal<Kernel::SharedPtr<Kernel::ClientPort>> ServiceManager::GetServicePort(
     const std::string& name) {
 
     CASCADE_CODE(ValidateServiceName(name));
-    auto it = registered_services.find(name);
-    if (it == registered_services.end()) {
+    return GetServicePort(PackServiceName(name.data(), name.size()));
+}
+
+ResultVal<Kernel::SharedPtr<Kernel::ClientPort>> ServiceManager::GetServicePort(ServiceName name) {
+    CASCADE_CODE(ValidateServiceName(name));
+    Kernel::SharedPtr<Kernel::ClientPort>* client_port = registered_services.Find(name);
+    if (client_port == nullptr) {
         return ERR_SERVICE_NOT_REGISTERED;
     }
 
-    return MakeResult<Kernel::SharedPtr<Kernel::ClientPort>>(it->second);
+    return MakeResult<Kernel::SharedPtr<Kernel::ClientPort>>(*client_port);
 }
 
 ResultVal<Kernel::SharedPtr<Kernel::ClientSession>> ServiceManager::ConnectToService(
@@ -90,10 +114,8 @@ void SM::Initialize(Kernel::HLERequestContext& ctx) {
 
 void SM::GetService(Kernel::HLERequestContext& ctx) {
     IPC::RequestParser rp{ctx};
-    auto name_buf = rp.PopRaw<std::array<char, 8>>();
-    auto end = std::find(name_buf.begin(), name_buf.end(), '\0');
-
-    std::string name(name_buf.begin(), end);
+    // The name is looked up in its packed form, it is only unpacked for logging
+    const ServiceName name = rp.PopRaw<ServiceName>();
 
     // TODO(yuriks): Permission checks go here
 
@@ -101,15 +123,15 @@ void SM::GetService(Kernel::HLERequestContext& ctx) {
     if (client_port.Failed()) {
         IPC::RequestBuilder rb = rp.MakeBuilder(2, 0, 0, 0);
         rb.Push(client_port.Code());
-        LOG_ERROR(Service_SM, "called service=%s -> error 0x%08X", name.c_str(),
-                  client_port.Code().raw);
+        LOG_ERROR(Service_SM, "called service=%s -> error 0x%08X",
+                  UnpackServiceName(name).c_str(), client_port.Code().raw);
         return;
     }
 
     auto session = client_port.Unwrap()->Connect();
     ASSERT(session.Succeeded());
     if (session.Succeeded()) {
-        LOG_DEBUG(Service_SM, "called service=%s -> session=%u", name.c_str(),
+        LOG_DEBUG(Service_SM, "called service=%s -> session=%u", UnpackServiceName(name).c_str(),
                   (*session)->GetObjectId());
         IPC::RequestBuilder rb = rp.MakeBuilder(2, 0, 1, 0);
         rb.Push(session.Code());
@@ -5,10 +5,10 @@
 #pragma once
 
 #include <string>
-#include <unordered_map>
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/result.h"
 #include "core/hle/service/service.h"
+#include "core/hle/service/sm/service_name_table.h"
 
 namespace Kernel {
 class ClientPort;
@@ -48,6 +48,8 @@ public:
     ResultVal<Kernel::SharedPtr<Kernel::ServerPort>> RegisterService(std::string name,
                                                                      unsigned int max_sessions);
     ResultVal<Kernel::SharedPtr<Kernel::ClientPort>> GetServicePort(const std::string& name);
+    /// Looks up a service by its packed name, as passed in IPC requests
+    ResultVal<Kernel::SharedPtr<Kernel::ClientPort>> GetServicePort(ServiceName name);
     ResultVal<Kernel::SharedPtr<Kernel::ClientSession>> ConnectToService(const std::string& name);
 
     void InvokeControlRequest(Kernel::HLERequestContext& context);
@@ -57,7 +59,7 @@ private:
     std::unique_ptr<Controller> controller_interface;
 
     /// Map of registered services, retrieved using GetServicePort or ConnectToService.
-    std::unordered_map<std::string, Kernel::SharedPtr<Kernel::ClientPort>> registered_services;
+    ServiceNameTable<Kernel::SharedPtr<Kernel::ClientPort>> registered_services;
 };
 
 extern std::shared_ptr<ServiceManager> g_service_manager;
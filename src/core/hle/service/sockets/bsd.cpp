@@ -0,0 +1,1122 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "common/logging/log.h"
+#include "core/hle/ipc_helpers.h"
+#include "core/hle/kernel/hle_ipc.h"
+#include "core/hle/service/sockets/bsd.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace Service {
+namespace Sockets {
+
+namespace {
+
+// Constants of the guest, which are the ones of FreeBSD
+constexpr u8 GUEST_AF_INET = 2;
+constexpr s32 GUEST_SOCK_STREAM = 1;
+constexpr s32 GUEST_SOCK_DGRAM = 2;
+constexpr s32 GUEST_IPPROTO_TCP = 6;
+constexpr s32 GUEST_IPPROTO_UDP = 17;
+constexpr s32 GUEST_SOL_SOCKET = 0xFFFF;
+constexpr s32 GUEST_SO_REUSEADDR = 0x4;
+constexpr s32 GUEST_SO_KEEPALIVE = 0x8;
+constexpr s32 GUEST_SO_BROADCAST = 0x20;
+constexpr s32 GUEST_SO_LINGER = 0x80;
+constexpr s32 GUEST_SO_SNDBUF = 0x1001;
+constexpr s32 GUEST_SO_RCVBUF = 0x1002;
+constexpr s32 GUEST_SO_SNDTIMEO = 0x1005;
+constexpr s32 GUEST_SO_RCVTIMEO = 0x1006;
+constexpr s32 GUEST_SO_ERROR = 0x1007;
+constexpr s32 GUEST_SO_TYPE = 0x1008;
+constexpr s32 GUEST_TCP_NODELAY = 0x1;
+constexpr s32 GUEST_MSG_OOB = 0x1;
+constexpr s32 GUEST_MSG_PEEK = 0x2;
+constexpr s32 GUEST_MSG_WAITALL = 0x40;
+constexpr s32 GUEST_MSG_DONTWAIT = 0x80;
+constexpr s32 GUEST_F_GETFL = 3;
+constexpr s32 GUEST_F_SETFL = 4;
+constexpr s32 GUEST_O_NONBLOCK = 0x4;
+constexpr u16 GUEST_POLLIN = 0x1;
+constexpr u16 GUEST_POLLPRI = 0x2;
+constexpr u16 GUEST_POLLOUT = 0x4;
+constexpr u16 GUEST_POLLERR = 0x8;
+constexpr u16 GUEST_POLLHUP = 0x10;
+constexpr u16 GUEST_POLLNVAL = 0x20;
+
+struct SockAddrIn {
+    u8 len;
+    u8 family;
+    /// The port and the address are in network byte order, like on the host
+    u16 port;
+    u32 address;
+    std::array<u8, 8> zero;
+};
+static_assert(sizeof(SockAddrIn) == 16, "SockAddrIn has incorrect size");
+
+struct PollFD {
+    s32 fd;
+    u16 events;
+    u16 revents;
+};
+static_assert(sizeof(PollFD) == 8, "PollFD has incorrect size");
+
+struct Linger {
+    s32 onoff;
+    s32 linger;
+};
+static_assert(sizeof(Linger) == 8, "Linger has incorrect size");
+
+#ifdef _WIN32
+using HostPollFD = WSAPOLLFD;
+constexpr SocketHandle INVALID_HANDLE = INVALID_SOCKET;
+#define HOST_ERROR(name) WSAE##name
+#else
+using HostPollFD = pollfd;
+constexpr SocketHandle INVALID_HANDLE = -1;
+#define HOST_ERROR(name) E##name
+#endif
+
+/// Flags passed to every send, so that writing to a closed connection doesn't raise SIGPIPE
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+int LastSocketError() {
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+Errno TranslateError(int error) {
+    switch (error) {
+    case 0:
+        return Errno::SUCCESS;
+    case HOST_ERROR(WOULDBLOCK):
+#if !defined(_WIN32) && EAGAIN != EWOULDBLOCK
+    case EAGAIN:
+#endif
+        return Errno::AGAIN;
+    case HOST_ERROR(INTR):
+        return Errno::INTR;
+    case HOST_ERROR(BADF):
+        return Errno::BADF;
+    case HOST_ERROR(ACCES):
+        return Errno::ACCES;
+    case HOST_ERROR(FAULT):
+        return Errno::FAULT;
+    case HOST_ERROR(INVAL):
+        return Errno::INVAL;
+    case HOST_ERROR(MFILE):
+        return Errno::MFILE;
+    case HOST_ERROR(INPROGRESS):
+        return Errno::INPROGRESS;
+    case HOST_ERROR(ALREADY):
+        return Errno::ALREADY;
+    case HOST_ERROR(NOTSOCK):
+        return Errno::NOTSOCK;
+    case HOST_ERROR(MSGSIZE):
+        return Errno::MSGSIZE;
+    case HOST_ERROR(PROTOTYPE):
+        return Errno::PROTOTYPE;
+    case HOST_ERROR(NOPROTOOPT):
+        return Errno::NOPROTOOPT;
+    case HOST_ERROR(PROTONOSUPPORT):
+        return Errno::PROTONOSUPPORT;
+    case HOST_ERROR(OPNOTSUPP):
+        return Errno::OPNOTSUPP;
+    case HOST_ERROR(AFNOSUPPORT):
+        return Errno::AFNOSUPPORT;
+    case HOST_ERROR(ADDRINUSE):
+        return Errno::ADDRINUSE;
+    case HOST_ERROR(ADDRNOTAVAIL):
+        return Errno::ADDRNOTAVAIL;
+    case HOST_ERROR(NETDOWN):
+        return Errno::NETDOWN;
+    case HOST_ERROR(NETUNREACH):
+        return Errno::NETUNREACH;
+    case HOST_ERROR(CONNABORTED):
+        return Errno::CONNABORTED;
+    case HOST_ERROR(CONNRESET):
+        return Errno::CONNRESET;
+    case HOST_ERROR(NOBUFS):
+        return Errno::NOBUFS;
+    case HOST_ERROR(ISCONN):
+        return Errno::ISCONN;
+    case HOST_ERROR(NOTCONN):
+        return Errno::NOTCONN;
+    case HOST_ERROR(TIMEDOUT):
+        return Errno::TIMEDOUT;
+    case HOST_ERROR(CONNREFUSED):
+        return Errno::CONNREFUSED;
+    case HOST_ERROR(HOSTUNREACH):
+        return Errno::HOSTUNREACH;
+#ifdef _WIN32
+    case WSAESHUTDOWN:
+        return Errno::PIPE;
+#else
+    case EPIPE:
+        return Errno::PIPE;
+    case ENOMEM:
+        return Errno::NOMEM;
+#endif
+    default:
+        LOG_ERROR(Service_BSD, "Unhandled host socket error %d", error);
+        return Errno::INVAL;
+    }
+}
+
+void CloseSocket(SocketHandle handle) {
+#ifdef _WIN32
+    closesocket(handle);
+#else
+    close(handle);
+#endif
+}
+
+void SetNonBlocking(SocketHandle handle) {
+#ifdef _WIN32
+    u_long is_nonblocking = 1;
+    ioctlsocket(handle, FIONBIO, &is_nonblocking);
+#else
+    fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+s64 HostRecvFrom(SocketHandle handle, u8* data, size_t size, int flags, sockaddr_in* address,
+                 socklen_t* address_size) {
+#ifdef _WIN32
+    return recvfrom(handle, reinterpret_cast<char*>(data), static_cast<int>(size), flags,
+                    reinterpret_cast<sockaddr*>(address), address_size);
+#else
+    return recvfrom(handle, data, size, flags, reinterpret_cast<sockaddr*>(address),
+                    address_size);
+#endif
+}
+
+s64 HostSendTo(SocketHandle handle, const u8* data, size_t size, int flags,
+               const sockaddr_in* address) {
+    const auto host_address = reinterpret_cast<const sockaddr*>(address);
+    const socklen_t address_size = address != nullptr ? sizeof(sockaddr_in) : 0;
+#ifdef _WIN32
+    return sendto(handle, reinterpret_cast<const char*>(data), static_cast<int>(size),
+                  flags | SEND_FLAGS, host_address, address_size);
+#else
+    return sendto(handle, data, size, flags | SEND_FLAGS, host_address, address_size);
+#endif
+}
+
+int HostPoll(std::vector<HostPollFD>& fds) {
+#ifdef _WIN32
+    return WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), 0);
+#else
+    return poll(fds.data(), static_cast<nfds_t>(fds.size()), 0);
+#endif
+}
+
+int TranslateMessageFlags(s32 flags) {
+    int host_flags = 0;
+    if (flags & GUEST_MSG_OOB) {
+        host_flags |= MSG_OOB;
+    }
+    if (flags & GUEST_MSG_PEEK) {
+        host_flags |= MSG_PEEK;
+    }
+    if (flags & GUEST_MSG_WAITALL) {
+        host_flags |= MSG_WAITALL;
+    }
+    // Host sockets never block, the flag only changes how the guest thread waits
+    const s32 unhandled_flags =
+        flags & ~(GUEST_MSG_OOB | GUEST_MSG_PEEK | GUEST_MSG_WAITALL | GUEST_MSG_DONTWAIT);
+    if (unhandled_flags != 0) {
+        LOG_WARNING(Service_BSD, "Unhandled message flags 0x%x", unhandled_flags);
+    }
+    return host_flags;
+}
+
+/// Translates a socket option of the guest, returns false if it isn't supported
+bool TranslateOption(s32 level, s32 name, int& host_level, int& host_name) {
+    if (level == GUEST_IPPROTO_TCP && name == GUEST_TCP_NODELAY) {
+        host_level = IPPROTO_TCP;
+        host_name = TCP_NODELAY;
+        return true;
+    }
+    if (level != GUEST_SOL_SOCKET) {
+        return false;
+    }
+    host_level = SOL_SOCKET;
+    switch (name) {
+    case GUEST_SO_REUSEADDR:
+        host_name = SO_REUSEADDR;
+        return true;
+    case GUEST_SO_KEEPALIVE:
+        host_name = SO_KEEPALIVE;
+        return true;
+    case GUEST_SO_BROADCAST:
+        host_name = SO_BROADCAST;
+        return true;
+    case GUEST_SO_LINGER:
+        host_name = SO_LINGER;
+        return true;
+    case GUEST_SO_SNDBUF:
+        host_name = SO_SNDBUF;
+        return true;
+    case GUEST_SO_RCVBUF:
+        host_name = SO_RCVBUF;
+        return true;
+    case GUEST_SO_ERROR:
+        host_name = SO_ERROR;
+        return true;
+    case GUEST_SO_TYPE:
+        host_name = SO_TYPE;
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool ToHostAddress(const std::vector<u8>& guest_address, sockaddr_in& host_address) {
+    SockAddrIn address;
+    if (guest_address.size() < sizeof(address)) {
+        return false;
+    }
+    std::memcpy(&address, guest_address.data(), sizeof(address));
+    if (address.family != GUEST_AF_INET) {
+        return false;
+    }
+    host_address = {};
+    host_address.sin_family = AF_INET;
+    host_address.sin_port = address.port;
+    host_address.sin_addr.s_addr = address.address;
+    return true;
+}
+
+SockAddrIn ToGuestAddress(const sockaddr_in& host_address) {
+    SockAddrIn address{};
+    address.len = sizeof(address);
+    address.family = GUEST_AF_INET;
+    address.port = host_address.sin_port;
+    address.address = host_address.sin_addr.s_addr;
+    return address;
+}
+
+short ToHostPollEvents(u16 events) {
+    short host_events = 0;
+    if (events & GUEST_POLLIN) {
+        host_events |= POLLIN;
+    }
+#ifndef _WIN32
+    // WSAPoll rejects it
+    if (events & GUEST_POLLPRI) {
+        host_events |= POLLPRI;
+    }
+#endif
+    if (events & GUEST_POLLOUT) {
+        host_events |= POLLOUT;
+    }
+    return host_events;
+}
+
+u16 ToGuestPollEvents(short host_events) {
+    u16 events = 0;
+    if (host_events & POLLIN) {
+        events |= GUEST_POLLIN;
+    }
+    if (host_events & POLLPRI) {
+        events |= GUEST_POLLPRI;
+    }
+    if (host_events & POLLOUT) {
+        events |= GUEST_POLLOUT;
+    }
+    if (host_events & POLLERR) {
+        events |= GUEST_POLLERR;
+    }
+    if (host_events & POLLHUP) {
+        events |= GUEST_POLLHUP;
+    }
+    if (host_events & POLLNVAL) {
+        events |= GUEST_POLLNVAL;
+    }
+    return events;
+}
+
+/// Returns the contents of an input buffer, empty if the request didn't pass it
+std::vector<u8> ReadInputBuffer(const Kernel::HLERequestContext& ctx, size_t index) {
+    if (index >= ctx.BufferDescriptorA().size()) {
+        return {};
+    }
+    return ctx.BufferViewA(index).ReadAll();
+}
+
+/// Writes to an output buffer as much of the data as fits, returns the number of bytes written
+size_t WriteOutputBuffer(const Kernel::HLERequestContext& ctx, size_t index, const void* data,
+                         size_t size) {
+    if (index >= ctx.BufferDescriptorB().size()) {
+        return 0;
+    }
+    const Kernel::GuestView buffer = ctx.BufferViewB(index);
+    size = std::min(size, buffer.Size());
+    buffer.Write(0, data, size);
+    return size;
+}
+
+/// Writes an address to an output buffer, returns its size or 0 if it didn't fit
+u32 WriteAddress(const Kernel::HLERequestContext& ctx, size_t index,
+                 const sockaddr_in& host_address, socklen_t host_address_size) {
+    const size_t buffer_size =
+        index < ctx.BufferDescriptorB().size() ? ctx.BufferViewB(index).Size() : 0;
+    if (host_address_size == 0 || buffer_size < sizeof(SockAddrIn)) {
+        return 0;
+    }
+    const SockAddrIn address = ToGuestAddress(host_address);
+    return static_cast<u32>(WriteOutputBuffer(ctx, index, &address, sizeof(address)));
+}
+
+void PushResult(Kernel::HLERequestContext& ctx, s32 value, Errno error) {
+    IPC::RequestBuilder rb{ctx, 4};
+    rb.Push(RESULT_SUCCESS);
+    rb.PushRaw(value);
+    rb.Push(static_cast<u32>(error));
+}
+
+/// Responds to the calls that also return the size of an address or an option
+void PushResultWithSize(Kernel::HLERequestContext& ctx, s32 value, Errno error, u32 size) {
+    IPC::RequestBuilder rb{ctx, 5};
+    rb.Push(RESULT_SUCCESS);
+    rb.PushRaw(value);
+    rb.Push(static_cast<u32>(error));
+    rb.Push(size);
+}
+
+} // Anonymous namespace
+
+BSD::BSD(const char* name)
+    : ServiceFramework(name), event_loop(std::make_shared<SocketEventLoop>()) {
+    static const FunctionInfo functions[] = {
+        {0, &BSD::RegisterClient, "RegisterClient"},
+        {1, &BSD::StartMonitoring, "StartMonitoring"},
+        {2, &BSD::Socket, "Socket"},
+        {3, &BSD::Socket, "SocketExempt"},
+        {4, nullptr, "Open"},
+        {5, nullptr, "Select"},
+        {6, &BSD::Poll, "Poll"},
+        {7, nullptr, "Sysctl"},
+        {8, &BSD::Recv, "Recv"},
+        {9, &BSD::RecvFrom, "RecvFrom"},
+        {10, &BSD::Send, "Send"},
+        {11, &BSD::SendTo, "SendTo"},
+        {12, &BSD::Accept, "Accept"},
+        {13, &BSD::Bind, "Bind"},
+        {14, &BSD::Connect, "Connect"},
+        {15, &BSD::GetPeerName, "GetPeerName"},
+        {16, &BSD::GetSockName, "GetSockName"},
+        {17, &BSD::GetSockOpt, "GetSockOpt"},
+        {18, &BSD::Listen, "Listen"},
+        {19, nullptr, "Ioctl"},
+        {20, &BSD::Fcntl, "Fcntl"},
+        {21, &BSD::SetSockOpt, "SetSockOpt"},
+        {22, &BSD::Shutdown, "Shutdown"},
+        {23, nullptr, "ShutdownAllSockets"},
+        {24, &BSD::Write, "Write"},
+        {25, &BSD::Read, "Read"},
+        {26, &BSD::Close, "Close"},
+        {27, nullptr, "DuplicateSocket"},
+    };
+    RegisterHandlers(functions);
+}
+
+BSD::~BSD() {
+    for (auto& file : file_descriptors) {
+        if (file) {
+            event_loop->CancelWatches(file->handle);
+            CloseSocket(file->handle);
+        }
+    }
+}
+
+void BSD::RegisterClient(Kernel::HLERequestContext& ctx) {
+    LOG_WARNING(Service_BSD, "(STUBBED) called");
+    IPC::RequestBuilder rb{ctx, 3};
+    rb.Push(RESULT_SUCCESS);
+    rb.Push<u32>(0);
+}
+
+void BSD::StartMonitoring(Kernel::HLERequestContext& ctx) {
+    LOG_WARNING(Service_BSD, "(STUBBED) called");
+    IPC::RequestBuilder rb{ctx, 2};
+    rb.Push(RESULT_SUCCESS);
+}
+
+void BSD::Socket(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 domain = rp.PopRaw<s32>();
+    const s32 type = rp.PopRaw<s32>();
+    const s32 protocol = rp.PopRaw<s32>();
+    LOG_DEBUG(Service_BSD, "called, domain=%d, type=%d, protocol=%d", domain, type, protocol);
+
+    if (domain != GUEST_AF_INET) {
+        LOG_ERROR(Service_BSD, "Unsupported domain %d", domain);
+        PushResult(ctx, -1, Errno::AFNOSUPPORT);
+        return;
+    }
+    if ((type != GUEST_SOCK_STREAM && type != GUEST_SOCK_DGRAM) ||
+        (protocol != 0 && protocol != GUEST_IPPROTO_TCP && protocol != GUEST_IPPROTO_UDP)) {
+        LOG_ERROR(Service_BSD, "Unsupported type %d or protocol %d", type, protocol);
+        PushResult(ctx, -1, Errno::PROTONOSUPPORT);
+        return;
+    }
+
+    const SocketHandle handle =
+        socket(AF_INET, type == GUEST_SOCK_STREAM ? SOCK_STREAM : SOCK_DGRAM, protocol);
+    if (handle == INVALID_HANDLE) {
+        PushResult(ctx, -1, TranslateError(LastSocketError()));
+        return;
+    }
+    SetNonBlocking(handle);
+#ifdef SO_NOSIGPIPE
+    const int no_sigpipe = 1;
+    setsockopt(handle, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+
+    const s32 fd = AllocateFileDescriptor(handle);
+    if (fd == -1) {
+        CloseSocket(handle);
+        PushResult(ctx, -1, Errno::MFILE);
+        return;
+    }
+    PushResult(ctx, fd, Errno::SUCCESS);
+}
+
+void BSD::Poll(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 nfds = rp.PopRaw<s32>();
+    const s32 timeout = rp.PopRaw<s32>();
+    LOG_TRACE(Service_BSD, "called, nfds=%d, timeout=%d", nfds, timeout);
+
+    const std::vector<u8> input = ReadInputBuffer(ctx, 0);
+    if (nfds < 0 || input.size() < static_cast<size_t>(nfds) * sizeof(PollFD)) {
+        PushResult(ctx, -1, Errno::INVAL);
+        return;
+    }
+
+    struct PollState {
+        std::vector<PollFD> fds;
+        std::vector<HostPollFD> host_fds;
+        /// Index in `fds` of each entry of `host_fds`
+        std::vector<size_t> fd_indices;
+        std::vector<SocketEventLoop::WatchId> watches;
+        s32 num_ready = 0;
+        bool is_done = false;
+    };
+    auto state = std::make_shared<PollState>();
+    state->fds.resize(nfds);
+    std::memcpy(state->fds.data(), input.data(), nfds * sizeof(PollFD));
+    for (size_t i = 0; i < state->fds.size(); ++i) {
+        PollFD& fd = state->fds[i];
+        fd.revents = 0;
+        // Negative descriptors are ignored
+        if (fd.fd < 0) {
+            continue;
+        }
+        const FileDescriptor* file = GetFileDescriptor(fd.fd);
+        if (file == nullptr) {
+            fd.revents = GUEST_POLLNVAL;
+            continue;
+        }
+        HostPollFD host_fd{};
+        host_fd.fd = file->handle;
+        host_fd.events = ToHostPollEvents(fd.events);
+        state->host_fds.push_back(host_fd);
+        state->fd_indices.push_back(i);
+    }
+
+    // Polls the host sockets without waiting, and returns the number of ready descriptors
+    const auto poll_once = [state]() -> s32 {
+        if (!state->host_fds.empty() && HostPoll(state->host_fds) < 0) {
+            LOG_ERROR(Service_BSD, "Couldn't poll the sockets, error %d", LastSocketError());
+        }
+        for (size_t i = 0; i < state->host_fds.size(); ++i) {
+            state->fds[state->fd_indices[i]].revents =
+                ToGuestPollEvents(state->host_fds[i].revents);
+        }
+        return static_cast<s32>(std::count_if(state->fds.begin(), state->fds.end(),
+                                              [](const PollFD& fd) { return fd.revents != 0; }));
+    };
+    const auto complete = [state](Kernel::HLERequestContext& ctx) {
+        WriteOutputBuffer(ctx, 0, state->fds.data(), state->fds.size() * sizeof(PollFD));
+        PushResult(ctx, state->num_ready, Errno::SUCCESS);
+    };
+
+    state->num_ready = poll_once();
+    if (state->num_ready != 0 || timeout == 0 || state->host_fds.empty()) {
+        complete(ctx);
+        return;
+    }
+
+    // Every socket is watched, the first one that becomes ready completes the request
+    const auto deadline = timeout < 0 ? SocketEventLoop::Clock::time_point::max()
+                                      : SocketEventLoop::Clock::now() +
+                                            std::chrono::milliseconds(timeout);
+    ctx.WaitAsync(
+        [state, poll_once, deadline,
+         event_loop = event_loop](Kernel::HLERequestContext::AsyncSignal signal) {
+            for (const HostPollFD& host_fd : state->host_fds) {
+                u32 events = 0;
+                if (host_fd.events & (POLLIN | POLLPRI)) {
+                    events |= SocketEventLoop::EVENT_READ;
+                }
+                if (host_fd.events & POLLOUT) {
+                    events |= SocketEventLoop::EVENT_WRITE;
+                }
+                const auto callback = [state, poll_once,
+                                       signal](SocketEventLoop::WatchResult result) {
+                    if (state->is_done || result == SocketEventLoop::WatchResult::Cancelled) {
+                        return true;
+                    }
+                    if (result == SocketEventLoop::WatchResult::Ready) {
+                        state->num_ready = poll_once();
+                        if (state->num_ready == 0) {
+                            return false;
+                        }
+                    }
+                    state->is_done = true;
+                    signal();
+                    return true;
+                };
+                state->watches.push_back(
+                    event_loop->Watch(host_fd.fd, events, callback, deadline));
+            }
+        },
+        [state, complete, event_loop = event_loop](Kernel::HLERequestContext& ctx) {
+            for (const SocketEventLoop::WatchId id : state->watches) {
+                event_loop->CancelWatch(id);
+            }
+            complete(ctx);
+        });
+}
+
+void BSD::Recv(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    const s32 flags = rp.PopRaw<s32>();
+    LOG_TRACE(Service_BSD, "called, fd=%d, flags=0x%x", fd, flags);
+    ReceiveMessage(ctx, fd, flags, false);
+}
+
+void BSD::RecvFrom(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    const s32 flags = rp.PopRaw<s32>();
+    LOG_TRACE(Service_BSD, "called, fd=%d, flags=0x%x", fd, flags);
+    ReceiveMessage(ctx, fd, flags, true);
+}
+
+void BSD::Send(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    const s32 flags = rp.PopRaw<s32>();
+    LOG_TRACE(Service_BSD, "called, fd=%d, flags=0x%x", fd, flags);
+    SendMessage(ctx, fd, flags, false);
+}
+
+void BSD::SendTo(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    const s32 flags = rp.PopRaw<s32>();
+    LOG_TRACE(Service_BSD, "called, fd=%d, flags=0x%x", fd, flags);
+    SendMessage(ctx, fd, flags, true);
+}
+
+void BSD::Accept(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    LOG_DEBUG(Service_BSD, "called, fd=%d", fd);
+
+    const FileDescriptor* file = GetFileDescriptor(fd);
+    if (file == nullptr) {
+        PushResultWithSize(ctx, -1, Errno::BADF, 0);
+        return;
+    }
+
+    struct AcceptState {
+        ~AcceptState() {
+            // The request was dropped before the socket was handed to the guest
+            if (handle != INVALID_HANDLE) {
+                CloseSocket(handle);
+            }
+        }
+
+        SocketHandle handle = INVALID_HANDLE;
+        sockaddr_in address{};
+        socklen_t address_size = sizeof(sockaddr_in);
+    };
+    auto state = std::make_shared<AcceptState>();
+
+    const SocketHandle handle = file->handle;
+    const auto call = [handle, state]() -> CallResult {
+        state->address_size = sizeof(state->address);
+        state->handle = accept(handle, reinterpret_cast<sockaddr*>(&state->address),
+                               &state->address_size);
+        return ToCallResult(state->handle == INVALID_HANDLE ? -1 : 0);
+    };
+    const auto completion = [this, state](Kernel::HLERequestContext& ctx, CallResult result) {
+        if (result.error != Errno::SUCCESS) {
+            PushResultWithSize(ctx, -1, result.error, 0);
+            return;
+        }
+        // Accepted sockets don't inherit the non-blocking flag on every host
+        SetNonBlocking(state->handle);
+        const s32 new_fd = AllocateFileDescriptor(state->handle);
+        if (new_fd == -1) {
+            PushResultWithSize(ctx, -1, Errno::MFILE, 0);
+            return;
+        }
+        state->handle = INVALID_HANDLE;
+        const u32 address_size = WriteAddress(ctx, 0, state->address, state->address_size);
+        PushResultWithSize(ctx, new_fd, Errno::SUCCESS, address_size);
+    };
+    ExecuteCall(ctx, handle, !file->is_nonblocking, SocketEventLoop::EVENT_READ, call,
+                completion);
+}
+
+void BSD::Bind(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    LOG_DEBUG(Service_BSD, "called, fd=%d", fd);
+
+    const FileDescriptor* file = GetFileDescriptor(fd);
+    if (file == nullptr) {
+        PushResult(ctx, -1, Errno::BADF);
+        return;
+    }
+    sockaddr_in address;
+    if (!ToHostAddress(ReadInputBuffer(ctx, 0), address)) {
+        PushResult(ctx, -1, Errno::AFNOSUPPORT);
+        return;
+    }
+    const CallResult result = ToCallResult(
+        bind(file->handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)));
+    PushResult(ctx, result.value, result.error);
+}
+
+void BSD::Connect(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    LOG_DEBUG(Service_BSD, "called, fd=%d", fd);
+
+    const FileDescriptor* file = GetFileDescriptor(fd);
+    if (file == nullptr) {
+        PushResult(ctx, -1, Errno::BADF);
+        return;
+    }
+    sockaddr_in address;
+    if (!ToHostAddress(ReadInputBuffer(ctx, 0), address)) {
+        PushResult(ctx, -1, Errno::AFNOSUPPORT);
+        return;
+    }
+
+    const SocketHandle handle = file->handle;
+    CallResult result = ToCallResult(
+        connect(handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)));
+    // Windows reports connections in progress as blocking calls
+    if (result.error == Errno::AGAIN) {
+        result.error = Errno::INPROGRESS;
+    }
+    if (result.error != Errno::INPROGRESS || file->is_nonblocking) {
+        PushResult(ctx, result.value, result.error);
+        return;
+    }
+
+    // The socket becomes writable once connected, or once the connection failed
+    WaitForSocket(ctx, handle, SocketEventLoop::EVENT_WRITE,
+                  [handle]() -> CallResult {
+                      int error = 0;
+                      socklen_t error_size = sizeof(error);
+                      getsockopt(handle, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error),
+                                 &error_size);
+                      return {error == 0 ? 0 : -1, TranslateError(error)};
+                  },
+                  [](Kernel::HLERequestContext& ctx, CallResult result) {
+                      PushResult(ctx, result.value, result.error);
+                  });
+}
+
+void BSD::GetPeerName(Kernel::HLERequestContext& ctx) {
+    GetAddress(ctx, true);
+}
+
+void BSD::GetSockName(Kernel::HLERequestContext& ctx) {
+    GetAddress(ctx, false);
+}
+
+void BSD::GetSockOpt(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    const s32 level = rp.PopRaw<s32>();
+    const s32 name = rp.PopRaw<s32>();
+    LOG_DEBUG(Service_BSD, "called, fd=%d, level=0x%x, name=0x%x", fd, level, name);
+
+    const FileDescriptor* file = GetFileDescriptor(fd);
+    if (file == nullptr) {
+        PushResultWithSize(ctx, -1, Errno::BADF, 0);
+        return;
+    }
+    int host_level;
+    int host_name;
+    if (!TranslateOption(level, name, host_level, host_name)) {
+        LOG_ERROR(Service_BSD, "Unsupported option 0x%x of level 0x%x", name, level);
+        PushResultWithSize(ctx, -1, Errno::NOPROTOOPT, 0);
+        return;
+    }
+
+    if (host_name == SO_LINGER && host_level == SOL_SOCKET) {
+        linger host_linger{};
+        socklen_t size = sizeof(host_linger);
+        const CallResult result = ToCallResult(getsockopt(
+            file->handle, host_level, host_name, reinterpret_cast<char*>(&host_linger), &size));
+        const Linger value{host_linger.l_onoff, host_linger.l_linger};
+        const u32 written = static_cast<u32>(WriteOutputBuffer(ctx, 0, &value, sizeof(value)));
+        PushResultWithSize(ctx, result.value, result.error, written);
+        return;
+    }
+
+    int host_value = 0;
+    socklen_t size = sizeof(host_value);
+    const CallResult result = ToCallResult(getsockopt(
+        file->handle, host_level, host_name, reinterpret_cast<char*>(&host_value), &size));
+    s32 value = host_value;
+    if (host_level == SOL_SOCKET && host_name == SO_ERROR) {
+        value = static_cast<s32>(TranslateError(host_value));
+    }
+    const u32 written = static_cast<u32>(WriteOutputBuffer(ctx, 0, &value, sizeof(value)));
+    PushResultWithSize(ctx, result.value, result.error, written);
+}
+
+void BSD::Listen(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    const s32 backlog = rp.PopRaw<s32>();
+    LOG_DEBUG(Service_BSD, "called, fd=%d, backlog=%d", fd, backlog);
+
+    const FileDescriptor* file = GetFileDescriptor(fd);
+    if (file == nullptr) {
+        PushResult(ctx, -1, Errno::BADF);
+        return;
+    }
+    const CallResult result = ToCallResult(listen(file->handle, backlog));
+    PushResult(ctx, result.value, result.error);
+}
+
+void BSD::Fcntl(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    const s32 command = rp.PopRaw<s32>();
+    const s32 argument = rp.PopRaw<s32>();
+    LOG_DEBUG(Service_BSD, "called, fd=%d, command=%d, argument=0x%x", fd, command, argument);
+
+    FileDescriptor* file = GetFileDescriptor(fd);
+    if (file == nullptr) {
+        PushResult(ctx, -1, Errno::BADF);
+        return;
+    }
+    // The host socket stays non-blocking, only the way the guest waits changes
+    switch (command) {
+    case GUEST_F_GETFL:
+        PushResult(ctx, file->is_nonblocking ? GUEST_O_NONBLOCK : 0, Errno::SUCCESS);
+        return;
+    case GUEST_F_SETFL:
+        file->is_nonblocking = (argument & GUEST_O_NONBLOCK) != 0;
+        PushResult(ctx, 0, Errno::SUCCESS);
+        return;
+    default:
+        LOG_ERROR(Service_BSD, "Unsupported command %d", command);
+        PushResult(ctx, -1, Errno::INVAL);
+        return;
+    }
+}
+
+void BSD::SetSockOpt(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    const s32 level = rp.PopRaw<s32>();
+    const s32 name = rp.PopRaw<s32>();
+    LOG_DEBUG(Service_BSD, "called, fd=%d, level=0x%x, name=0x%x", fd, level, name);
+
+    const FileDescriptor* file = GetFileDescriptor(fd);
+    if (file == nullptr) {
+        PushResult(ctx, -1, Errno::BADF);
+        return;
+    }
+    if (level == GUEST_SOL_SOCKET && (name == GUEST_SO_SNDTIMEO || name == GUEST_SO_RCVTIMEO)) {
+        LOG_WARNING(Service_BSD, "(STUBBED) Ignoring the timeout option 0x%x", name);
+        PushResult(ctx, 0, Errno::SUCCESS);
+        return;
+    }
+    int host_level;
+    int host_name;
+    if (!TranslateOption(level, name, host_level, host_name)) {
+        LOG_ERROR(Service_BSD, "Unsupported option 0x%x of level 0x%x", name, level);
+        PushResult(ctx, -1, Errno::NOPROTOOPT);
+        return;
+    }
+
+    const std::vector<u8> input = ReadInputBuffer(ctx, 0);
+    CallResult result;
+    if (host_level == SOL_SOCKET && host_name == SO_LINGER) {
+        Linger value;
+        if (input.size() < sizeof(value)) {
+            PushResult(ctx, -1, Errno::INVAL);
+            return;
+        }
+        std::memcpy(&value, input.data(), sizeof(value));
+        linger host_linger{};
+        host_linger.l_onoff = static_cast<decltype(host_linger.l_onoff)>(value.onoff);
+        host_linger.l_linger = static_cast<decltype(host_linger.l_linger)>(value.linger);
+        result = ToCallResult(setsockopt(file->handle, host_level, host_name,
+                                         reinterpret_cast<const char*>(&host_linger),
+                                         sizeof(host_linger)));
+    } else {
+        s32 value;
+        if (input.size() < sizeof(value)) {
+            PushResult(ctx, -1, Errno::INVAL);
+            return;
+        }
+        std::memcpy(&value, input.data(), sizeof(value));
+        const int host_value = value;
+        result = ToCallResult(setsockopt(file->handle, host_level, host_name,
+                                         reinterpret_cast<const char*>(&host_value),
+                                         sizeof(host_value)));
+    }
+    PushResult(ctx, result.value, result.error);
+}
+
+void BSD::Shutdown(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    const s32 how = rp.PopRaw<s32>();
+    LOG_DEBUG(Service_BSD, "called, fd=%d, how=%d", fd, how);
+
+    const FileDescriptor* file = GetFileDescriptor(fd);
+    if (file == nullptr) {
+        PushResult(ctx, -1, Errno::BADF);
+        return;
+    }
+    // SHUT_RD, SHUT_WR and SHUT_RDWR have the same values everywhere
+    const CallResult result = ToCallResult(shutdown(file->handle, how));
+    PushResult(ctx, result.value, result.error);
+}
+
+void BSD::Write(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    LOG_TRACE(Service_BSD, "called, fd=%d", fd);
+    SendMessage(ctx, fd, 0, false);
+}
+
+void BSD::Read(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    LOG_TRACE(Service_BSD, "called, fd=%d", fd);
+    ReceiveMessage(ctx, fd, 0, false);
+}
+
+void BSD::Close(Kernel::HLERequestContext& ctx) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    LOG_DEBUG(Service_BSD, "called, fd=%d", fd);
+
+    FileDescriptor* file = GetFileDescriptor(fd);
+    if (file == nullptr) {
+        PushResult(ctx, -1, Errno::BADF);
+        return;
+    }
+    // The threads blocked on the socket fail with EBADF
+    event_loop->CancelWatches(file->handle);
+    CloseSocket(file->handle);
+    file_descriptors[fd] = boost::none;
+    PushResult(ctx, 0, Errno::SUCCESS);
+}
+
+void BSD::ReceiveMessage(Kernel::HLERequestContext& ctx, s32 fd, s32 flags, bool has_address) {
+    const FileDescriptor* file = GetFileDescriptor(fd);
+    if (file == nullptr) {
+        if (has_address) {
+            PushResultWithSize(ctx, -1, Errno::BADF, 0);
+        } else {
+            PushResult(ctx, -1, Errno::BADF);
+        }
+        return;
+    }
+
+    // Received on the event loop thread if the call blocks, so into a buffer of the host
+    struct ReceiveState {
+        std::vector<u8> data;
+        sockaddr_in address{};
+        socklen_t address_size = 0;
+    };
+    auto state = std::make_shared<ReceiveState>();
+    state->data.resize(ctx.BufferDescriptorB().empty() ? 0 : ctx.BufferViewB(0).Size());
+
+    const SocketHandle handle = file->handle;
+    const int host_flags = TranslateMessageFlags(flags);
+    const auto call = [handle, host_flags, has_address, state]() -> CallResult {
+        state->address_size = has_address ? sizeof(state->address) : 0;
+        return ToCallResult(HostRecvFrom(handle, state->data.data(), state->data.size(),
+                                         host_flags, has_address ? &state->address : nullptr,
+                                         has_address ? &state->address_size : nullptr));
+    };
+    const auto completion = [has_address, state](Kernel::HLERequestContext& ctx,
+                                                 CallResult result) {
+        if (result.value > 0) {
+            WriteOutputBuffer(ctx, 0, state->data.data(), result.value);
+        }
+        if (!has_address) {
+            PushResult(ctx, result.value, result.error);
+            return;
+        }
+        const u32 address_size =
+            result.value >= 0 ? WriteAddress(ctx, 1, state->address, state->address_size) : 0;
+        PushResultWithSize(ctx, result.value, result.error, address_size);
+    };
+    const bool is_blocking = !file->is_nonblocking && (flags & GUEST_MSG_DONTWAIT) == 0;
+    ExecuteCall(ctx, handle, is_blocking, SocketEventLoop::EVENT_READ, call, completion);
+}
+
+void BSD::SendMessage(Kernel::HLERequestContext& ctx, s32 fd, s32 flags, bool has_address) {
+    const FileDescriptor* file = GetFileDescriptor(fd);
+    if (file == nullptr) {
+        PushResult(ctx, -1, Errno::BADF);
+        return;
+    }
+
+    struct SendState {
+        std::vector<u8> data;
+        sockaddr_in address{};
+    };
+    auto state = std::make_shared<SendState>();
+    state->data = ReadInputBuffer(ctx, 0);
+    if (has_address && !ToHostAddress(ReadInputBuffer(ctx, 1), state->address)) {
+        PushResult(ctx, -1, Errno::AFNOSUPPORT);
+        return;
+    }
+
+    const SocketHandle handle = file->handle;
+    const int host_flags = TranslateMessageFlags(flags);
+    const auto call = [handle, host_flags, has_address, state]() -> CallResult {
+        return ToCallResult(HostSendTo(handle, state->data.data(), state->data.size(),
+                                       host_flags, has_address ? &state->address : nullptr));
+    };
+    const bool is_blocking = !file->is_nonblocking && (flags & GUEST_MSG_DONTWAIT) == 0;
+    ExecuteCall(ctx, handle, is_blocking, SocketEventLoop::EVENT_WRITE, call,
+                [](Kernel::HLERequestContext& ctx, CallResult result) {
+                    PushResult(ctx, result.value, result.error);
+                });
+}
+
+void BSD::GetAddress(Kernel::HLERequestContext& ctx, bool is_peer) {
+    IPC::RequestParser rp{ctx};
+    const s32 fd = rp.PopRaw<s32>();
+    LOG_DEBUG(Service_BSD, "called, fd=%d", fd);
+
+    const FileDescriptor* file = GetFileDescriptor(fd);
+    if (file == nullptr) {
+        PushResultWithSize(ctx, -1, Errno::BADF, 0);
+        return;
+    }
+    sockaddr_in address{};
+    socklen_t address_size = sizeof(address);
+    const auto host_address = reinterpret_cast<sockaddr*>(&address);
+    const CallResult result =
+        ToCallResult(is_peer ? getpeername(file->handle, host_address, &address_size)
+                             : getsockname(file->handle, host_address, &address_size));
+    const u32 written =
+        result.error == Errno::SUCCESS ? WriteAddress(ctx, 0, address, address_size) : 0;
+    PushResultWithSize(ctx, result.value, result.error, written);
+}
+
+void BSD::ExecuteCall(Kernel::HLERequestContext& ctx, SocketHandle handle, bool is_blocking,
+                      u32 events, HostCall call, CallCompletion completion) {
+    const CallResult result = call();
+    if (result.error != Errno::AGAIN || !is_blocking) {
+        completion(ctx, result);
+        return;
+    }
+    WaitForSocket(ctx, handle, events, std::move(call), std::move(completion));
+}
+
+void BSD::WaitForSocket(Kernel::HLERequestContext& ctx, SocketHandle handle, u32 events,
+                        HostCall call, CallCompletion completion) {
+    // Written on the event loop thread, and read once the request completes
+    auto result = std::make_shared<CallResult>();
+    ctx.WaitAsync(
+        [handle, events, call = std::move(call), result,
+         event_loop = event_loop](Kernel::HLERequestContext::AsyncSignal signal) {
+            event_loop->Watch(handle, events,
+                              [call, result, signal](SocketEventLoop::WatchResult watch_result) {
+                                  if (watch_result == SocketEventLoop::WatchResult::Cancelled) {
+                                      // The socket was closed by another thread
+                                      *result = {-1, Errno::BADF};
+                                  } else {
+                                      *result = call();
+                                      if (result->error == Errno::AGAIN) {
+                                          return false;
+                                      }
+                                  }
+                                  signal();
+                                  return true;
+                              });
+        },
+        [result, completion = std::move(completion)](Kernel::HLERequestContext& ctx) {
+            completion(ctx, *result);
+        });
+}
+
+BSD::CallResult BSD::ToCallResult(s64 host_result) {
+    if (host_result < 0) {
+        return {-1, TranslateError(LastSocketError())};
+    }
+    return {static_cast<s32>(host_result), Errno::SUCCESS};
+}
+
+BSD::FileDescriptor* BSD::GetFileDescriptor(s32 fd) {
+    if (fd < 0 || static_cast<size_t>(fd) >= file_descriptors.size() || !file_descriptors[fd]) {
+        LOG_ERROR(Service_BSD, "Invalid file descriptor %d", fd);
+        return nullptr;
+    }
+    return &*file_descriptors[fd];
+}
+
+s32 BSD::AllocateFileDescriptor(SocketHandle handle) {
+    for (size_t fd = 0; fd < file_descriptors.size(); ++fd) {
+        if (!file_descriptors[fd]) {
+            file_descriptors[fd] = FileDescriptor{handle};
+            return static_cast<s32>(fd);
+        }
+    }
+    LOG_ERROR(Service_BSD, "No free file descriptor");
+    return -1;
+}
+
+} // namespace Sockets
+} // namespace Service
@@ -0,0 +1,136 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <boost/optional.hpp>
+#include "common/common_types.h"
+#include "core/hle/service/service.h"
+#include "core/hle/service/sockets/socket_event_loop.h"
+
+namespace Service {
+namespace Sockets {
+
+/// Error numbers of the guest, which are the ones of FreeBSD
+enum class Errno : u32 {
+    SUCCESS = 0,
+    INTR = 4,
+    BADF = 9,
+    NOMEM = 12,
+    ACCES = 13,
+    FAULT = 14,
+    INVAL = 22,
+    MFILE = 24,
+    PIPE = 32,
+    AGAIN = 35,
+    INPROGRESS = 36,
+    ALREADY = 37,
+    NOTSOCK = 38,
+    MSGSIZE = 40,
+    PROTOTYPE = 41,
+    NOPROTOOPT = 42,
+    PROTONOSUPPORT = 43,
+    OPNOTSUPP = 45,
+    AFNOSUPPORT = 47,
+    ADDRINUSE = 48,
+    ADDRNOTAVAIL = 49,
+    NETDOWN = 50,
+    NETUNREACH = 51,
+    CONNABORTED = 53,
+    CONNRESET = 54,
+    NOBUFS = 55,
+    ISCONN = 56,
+    NOTCONN = 57,
+    TIMEDOUT = 60,
+    CONNREFUSED = 61,
+    HOSTUNREACH = 65,
+};
+
+/**
+ * BSD sockets of the guest, backed by non-blocking host sockets. A call that would block on a
+ * blocking socket parks the guest thread and hands the socket over to the event loop, which
+ * retries the call on its thread once the socket is ready and then completes the request.
+ */
+class BSD final : public ServiceFramework<BSD> {
+public:
+    explicit BSD(const char* name);
+    ~BSD();
+
+private:
+    /// Maximum number of sockets open at once
+    static constexpr size_t MAX_FILE_DESCRIPTORS = 128;
+
+    struct FileDescriptor {
+        SocketHandle handle;
+        /// Set by the guest, the host socket is always non-blocking
+        bool is_nonblocking = false;
+    };
+
+    /// Result of a host socket call, in the terms of the guest
+    struct CallResult {
+        s32 value;
+        Errno error;
+    };
+    /// Host socket call, run on the emu thread and retried on the event loop thread
+    using HostCall = std::function<CallResult()>;
+    /// Builds the response of a request from the result of its call, on the emu thread
+    using CallCompletion = std::function<void(Kernel::HLERequestContext& ctx, CallResult result)>;
+
+    void RegisterClient(Kernel::HLERequestContext& ctx);
+    void StartMonitoring(Kernel::HLERequestContext& ctx);
+    void Socket(Kernel::HLERequestContext& ctx);
+    void Poll(Kernel::HLERequestContext& ctx);
+    void Recv(Kernel::HLERequestContext& ctx);
+    void RecvFrom(Kernel::HLERequestContext& ctx);
+    void Send(Kernel::HLERequestContext& ctx);
+    void SendTo(Kernel::HLERequestContext& ctx);
+    void Accept(Kernel::HLERequestContext& ctx);
+    void Bind(Kernel::HLERequestContext& ctx);
+    void Connect(Kernel::HLERequestContext& ctx);
+    void GetPeerName(Kernel::HLERequestContext& ctx);
+    void GetSockName(Kernel::HLERequestContext& ctx);
+    void GetSockOpt(Kernel::HLERequestContext& ctx);
+    void Listen(Kernel::HLERequestContext& ctx);
+    void Fcntl(Kernel::HLERequestContext& ctx);
+    void SetSockOpt(Kernel::HLERequestContext& ctx);
+    void Shutdown(Kernel::HLERequestContext& ctx);
+    void Write(Kernel::HLERequestContext& ctx);
+    void Read(Kernel::HLERequestContext& ctx);
+    void Close(Kernel::HLERequestContext& ctx);
+
+    /// Implements Recv and RecvFrom, the latter returning the address of the sender
+    void ReceiveMessage(Kernel::HLERequestContext& ctx, s32 fd, s32 flags, bool has_address);
+    /// Implements Send and SendTo, the latter passing the address of the receiver
+    void SendMessage(Kernel::HLERequestContext& ctx, s32 fd, s32 flags, bool has_address);
+    /// Implements GetPeerName and GetSockName
+    void GetAddress(Kernel::HLERequestContext& ctx, bool is_peer);
+
+    /**
+     * Runs a host call on a socket. If the call would block and the guest expects it to, the
+     * request waits for `events` on the socket and the call is retried once they happen.
+     */
+    void ExecuteCall(Kernel::HLERequestContext& ctx, SocketHandle handle, bool is_blocking,
+                     u32 events, HostCall call, CallCompletion completion);
+    /// Waits for `events` on the socket, and then retries the call until it doesn't block
+    void WaitForSocket(Kernel::HLERequestContext& ctx, SocketHandle handle, u32 events,
+                       HostCall call, CallCompletion completion);
+
+    /// Converts the result of a host call, reading the host error if it failed
+    static CallResult ToCallResult(s64 host_result);
+
+    /// Returns the socket of a file descriptor, or nullptr if it isn't open
+    FileDescriptor* GetFileDescriptor(s32 fd);
+    /// Returns a free file descriptor for a host socket, or -1 if none is free
+    s32 AllocateFileDescriptor(SocketHandle handle);
+
+    /// Only accessed on the emu thread
+    std::array<boost::optional<FileDescriptor>, MAX_FILE_DESCRIPTORS> file_descriptors;
+    std::shared_ptr<SocketEventLoop> event_loop;
+};
+
+} // namespace Sockets
+} // namespace Service
@@ -0,0 +1,385 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "core/hle/service/sockets/socket_event_loop.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#elif defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace Service {
+namespace Sockets {
+
+namespace {
+
+/// Returns the time the loop waits for until the first deadline, in milliseconds, or -1
+int GetWaitTimeout(SocketEventLoop::Clock::time_point deadline) {
+    if (deadline == SocketEventLoop::Clock::time_point::max()) {
+        return -1;
+    }
+    const auto now = SocketEventLoop::Clock::now();
+    if (deadline <= now) {
+        return 0;
+    }
+    // Rounded up, so that the loop doesn't wake up right before the deadline to wait again
+    const auto timeout = std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+    return static_cast<int>(std::min<decltype(timeout)>(timeout, INT_MAX));
+}
+
+#ifdef __linux__
+
+u32 EpollToEvents(u32 epoll_events) {
+    u32 events = 0;
+    if (epoll_events & (EPOLLIN | EPOLLRDHUP)) {
+        events |= SocketEventLoop::EVENT_READ;
+    }
+    if (epoll_events & EPOLLOUT) {
+        events |= SocketEventLoop::EVENT_WRITE;
+    }
+    // The call the socket is watched for fails right away
+    if (epoll_events & (EPOLLERR | EPOLLHUP)) {
+        events |= SocketEventLoop::EVENT_READ | SocketEventLoop::EVENT_WRITE;
+    }
+    return events;
+}
+
+u32 EventsToEpoll(u32 events) {
+    u32 epoll_events = 0;
+    if (events & SocketEventLoop::EVENT_READ) {
+        epoll_events |= EPOLLIN | EPOLLRDHUP;
+    }
+    if (events & SocketEventLoop::EVENT_WRITE) {
+        epoll_events |= EPOLLOUT;
+    }
+    return epoll_events;
+}
+
+#else
+
+#ifdef _WIN32
+int PollSockets(WSAPOLLFD* fds, size_t num_fds, int timeout) {
+    return WSAPoll(fds, static_cast<ULONG>(num_fds), timeout);
+}
+
+void CloseSocket(SocketHandle socket) {
+    closesocket(socket);
+}
+
+using PollEntry = WSAPOLLFD;
+#else
+int PollSockets(pollfd* fds, size_t num_fds, int timeout) {
+    return poll(fds, static_cast<nfds_t>(num_fds), timeout);
+}
+
+void CloseSocket(SocketHandle socket) {
+    close(socket);
+}
+
+using PollEntry = pollfd;
+#endif
+
+u32 PollToEvents(short poll_events) {
+    u32 events = 0;
+    if (poll_events & POLLIN) {
+        events |= SocketEventLoop::EVENT_READ;
+    }
+    if (poll_events & POLLOUT) {
+        events |= SocketEventLoop::EVENT_WRITE;
+    }
+    if (poll_events & (POLLERR | POLLHUP | POLLNVAL)) {
+        events |= SocketEventLoop::EVENT_READ | SocketEventLoop::EVENT_WRITE;
+    }
+    return events;
+}
+
+short EventsToPoll(u32 events) {
+    short poll_events = 0;
+    if (events & SocketEventLoop::EVENT_READ) {
+        poll_events |= POLLIN;
+    }
+    if (events & SocketEventLoop::EVENT_WRITE) {
+        poll_events |= POLLOUT;
+    }
+    return poll_events;
+}
+
+/// Creates a non-blocking UDP socket bound and connected to itself on the loopback interface
+SocketHandle CreateWakeupSocket() {
+    const SocketHandle handle = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_size = sizeof(address);
+    const bool is_bound =
+        bind(handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0 &&
+        getsockname(handle, reinterpret_cast<sockaddr*>(&address), &address_size) == 0 &&
+        connect(handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    ASSERT_MSG(is_bound, "Couldn't create the wakeup socket of the socket event loop");
+#ifdef _WIN32
+    u_long is_nonblocking = 1;
+    ioctlsocket(handle, FIONBIO, &is_nonblocking);
+#else
+    fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    return handle;
+}
+
+#endif
+
+} // Anonymous namespace
+
+SocketEventLoop::SocketEventLoop() {
+#ifdef _WIN32
+    WSADATA data;
+    WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+#ifdef __linux__
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ASSERT_MSG(epoll_fd != -1 && wakeup_fd != -1, "Couldn't create the socket event loop");
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wakeup_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &event);
+#else
+    wakeup_socket = CreateWakeupSocket();
+#endif
+    thread = std::thread([this] { Run(); });
+}
+
+SocketEventLoop::~SocketEventLoop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_running = false;
+        WakeUp();
+    }
+    thread.join();
+
+    for (WatchEntry& watch : watches) {
+        watch.callback(WatchResult::Cancelled);
+    }
+    watches.clear();
+
+#ifdef __linux__
+    close(wakeup_fd);
+    close(epoll_fd);
+#else
+    CloseSocket(wakeup_socket);
+#endif
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+SocketEventLoop::WatchId SocketEventLoop::Watch(SocketHandle socket, u32 events,
+                                                Callback callback, Clock::time_point deadline) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const WatchId id = next_watch_id++;
+    watches.push_back({id, socket, events, std::move(callback), deadline});
+    UpdateSocket(socket);
+    if (deadline != Clock::time_point::max()) {
+        // The loop may have to wait for less time now
+        WakeUp();
+    }
+    return id;
+}
+
+void SocketEventLoop::CancelWatch(WatchId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto itr = std::find_if(watches.begin(), watches.end(),
+                                  [id](const WatchEntry& watch) { return watch.id == id; });
+    if (itr == watches.end()) {
+        return;
+    }
+    const SocketHandle socket = itr->socket;
+    itr->callback(WatchResult::Cancelled);
+    watches.erase(itr);
+    UpdateSocket(socket);
+}
+
+void SocketEventLoop::CancelWatches(SocketHandle socket) {
+    std::lock_guard<std::mutex> lock(mutex);
+    CancelSocketWatches(socket);
+}
+
+void SocketEventLoop::CancelSocketWatches(SocketHandle socket) {
+    const auto itr =
+        std::stable_partition(watches.begin(), watches.end(),
+                              [socket](const WatchEntry& watch) { return watch.socket != socket; });
+    for (auto cancelled = itr; cancelled != watches.end(); ++cancelled) {
+        cancelled->callback(WatchResult::Cancelled);
+    }
+    watches.erase(itr, watches.end());
+    UpdateSocket(socket);
+}
+
+void SocketEventLoop::Run() {
+#ifdef __linux__
+    std::array<epoll_event, 64> events;
+#else
+    std::vector<PollEntry> entries;
+#endif
+
+    while (true) {
+        int timeout;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!is_running) {
+                break;
+            }
+            Clock::time_point deadline = Clock::time_point::max();
+            for (const WatchEntry& watch : watches) {
+                deadline = std::min(deadline, watch.deadline);
+            }
+            timeout = GetWaitTimeout(deadline);
+
+#ifndef __linux__
+            // Rebuilt each time, WakeUp is called whenever the registered sockets change
+            entries.clear();
+            entries.push_back({wakeup_socket, POLLIN, 0});
+            for (const auto& registration : registered_events) {
+                entries.push_back({registration.first, EventsToPoll(registration.second), 0});
+            }
+#endif
+        }
+
+#ifdef __linux__
+        const int num_events = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()),
+                                          timeout);
+#else
+        const int num_events = PollSockets(entries.data(), entries.size(), timeout);
+#endif
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!is_running) {
+            break;
+        }
+
+#ifdef __linux__
+        for (int i = 0; i < num_events; ++i) {
+            if (events[i].data.fd == wakeup_fd) {
+                u64 count;
+                read(wakeup_fd, &count, sizeof(count));
+                continue;
+            }
+            DispatchEvents(events[i].data.fd, EpollToEvents(events[i].events));
+        }
+#else
+        if (num_events > 0) {
+            if (entries[0].revents != 0) {
+                char data;
+                while (recv(wakeup_socket, &data, sizeof(data), 0) > 0) {
+                }
+            }
+            for (size_t i = 1; i < entries.size(); ++i) {
+                if (entries[i].revents != 0) {
+                    DispatchEvents(entries[i].fd, PollToEvents(entries[i].revents));
+                }
+            }
+        }
+#endif
+        DispatchTimeouts(Clock::now());
+    }
+}
+
+void SocketEventLoop::WakeUp() {
+#ifdef __linux__
+    const u64 count = 1;
+    write(wakeup_fd, &count, sizeof(count));
+#else
+    const char data = 0;
+    send(wakeup_socket, &data, sizeof(data), 0);
+#endif
+}
+
+void SocketEventLoop::DispatchEvents(SocketHandle socket, u32 events) {
+    for (auto itr = watches.begin(); itr != watches.end();) {
+        if (itr->socket == socket && (itr->events & events) != 0 &&
+            itr->callback(WatchResult::Ready)) {
+            itr = watches.erase(itr);
+        } else {
+            ++itr;
+        }
+    }
+    UpdateSocket(socket);
+}
+
+void SocketEventLoop::DispatchTimeouts(Clock::time_point now) {
+    std::vector<SocketHandle> sockets;
+    for (auto itr = watches.begin(); itr != watches.end();) {
+        if (itr->deadline <= now) {
+            itr->callback(WatchResult::TimedOut);
+            sockets.push_back(itr->socket);
+            itr = watches.erase(itr);
+        } else {
+            ++itr;
+        }
+    }
+    for (const SocketHandle socket : sockets) {
+        UpdateSocket(socket);
+    }
+}
+
+u32 SocketEventLoop::GetWatchedEvents(SocketHandle socket) const {
+    u32 events = 0;
+    for (const WatchEntry& watch : watches) {
+        if (watch.socket == socket) {
+            events |= watch.events;
+        }
+    }
+    return events;
+}
+
+void SocketEventLoop::UpdateSocket(SocketHandle socket) {
+    const u32 events = GetWatchedEvents(socket);
+    const auto itr = registered_events.find(socket);
+    const u32 old_events = itr != registered_events.end() ? itr->second : 0;
+    if (events == old_events) {
+        return;
+    }
+    if (events == 0) {
+        registered_events.erase(itr);
+    } else {
+        registered_events[socket] = events;
+    }
+
+#ifdef __linux__
+    epoll_event event{};
+    event.events = EventsToEpoll(events);
+    event.data.fd = socket;
+    int operation = EPOLL_CTL_MOD;
+    if (events == 0) {
+        operation = EPOLL_CTL_DEL;
+    } else if (old_events == 0) {
+        operation = EPOLL_CTL_ADD;
+    }
+    if (epoll_ctl(epoll_fd, operation, socket, &event) != 0 && events != 0) {
+        // Not a valid socket, nothing would ever complete the watches
+        LOG_ERROR(Service_BSD, "Couldn't watch the socket %d", socket);
+        registered_events.erase(socket);
+        CancelSocketWatches(socket);
+    }
+#else
+    WakeUp();
+#endif
+}
+
+} // namespace Sockets
+} // namespace Service
@@ -0,0 +1,121 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "common/common_types.h"
+
+namespace Service {
+namespace Sockets {
+
+/// Host socket, a SOCKET on Windows and a file descriptor elsewhere
+#ifdef _WIN32
+using SocketHandle = uintptr_t;
+#else
+using SocketHandle = int;
+#endif
+
+/**
+ * Host thread waiting for the sockets of the guest to become ready, so that their blocking calls
+ * never block the emu thread. Sockets are watched with epoll on Linux and with poll (WSAPoll on
+ * Windows) elsewhere, the sockets being non-blocking. Callbacks run on the loop thread.
+ */
+class SocketEventLoop final {
+public:
+    using Clock = std::chrono::steady_clock;
+    using WatchId = u64;
+
+    /// Events a watch waits for
+    static constexpr u32 EVENT_READ = 1;
+    static constexpr u32 EVENT_WRITE = 2;
+
+    enum class WatchResult {
+        /// One of the events happened, or an error is pending on the socket
+        Ready,
+        /// The deadline passed first
+        TimedOut,
+        /// The watch was cancelled, or the loop stopped
+        Cancelled,
+    };
+
+    /**
+     * Called with the mutex of the loop held, so it must not use the loop. Returns whether the
+     * watch is done; otherwise it is kept, which is only meaningful for ready sockets, e.g. when
+     * the call the socket was watched for would still block.
+     */
+    using Callback = std::function<bool(WatchResult result)>;
+
+    SocketEventLoop();
+    /// Stops the loop thread, the pending watches are cancelled
+    ~SocketEventLoop();
+
+    SocketEventLoop(const SocketEventLoop&) = delete;
+    SocketEventLoop& operator=(const SocketEventLoop&) = delete;
+
+    /**
+     * Calls `callback` on the loop thread once any of `events` happens on the socket.
+     * @param deadline Time after which the watch times out, never by default.
+     */
+    WatchId Watch(SocketHandle socket, u32 events, Callback callback,
+                  Clock::time_point deadline = Clock::time_point::max());
+
+    /// Cancels a watch if it didn't finish yet, its callback is called on this thread
+    void CancelWatch(WatchId id);
+
+    /**
+     * Cancels the watches of a socket, their callbacks are called on this thread. Once this
+     * returns, the loop doesn't use the socket anymore and it can be closed.
+     */
+    void CancelWatches(SocketHandle socket);
+
+private:
+    struct WatchEntry {
+        WatchId id;
+        SocketHandle socket;
+        u32 events;
+        Callback callback;
+        Clock::time_point deadline;
+    };
+
+    void Run();
+    /// Interrupts the wait of the loop thread, so that it picks up the changes of the watches
+    void WakeUp();
+    /// Runs the callbacks of the watches of a socket waiting for the events. Needs the mutex.
+    void DispatchEvents(SocketHandle socket, u32 events);
+    /// Runs the callbacks of the watches whose deadline passed. Needs the mutex.
+    void DispatchTimeouts(Clock::time_point now);
+    /// Cancels the watches of a socket. Needs the mutex.
+    void CancelSocketWatches(SocketHandle socket);
+    /// Returns the events the watches of a socket wait for. Needs the mutex.
+    u32 GetWatchedEvents(SocketHandle socket) const;
+    /// Tells the backend about a change of the events watched on a socket. Needs the mutex.
+    void UpdateSocket(SocketHandle socket);
+
+    std::mutex mutex;
+    std::vector<WatchEntry> watches;
+    WatchId next_watch_id = 0;
+    /// Events each socket is registered for with the backend
+    std::unordered_map<SocketHandle, u32> registered_events;
+    bool is_running = true;
+
+#ifdef __linux__
+    int epoll_fd = -1;
+    /// eventfd the loop thread is woken up with
+    int wakeup_fd = -1;
+#else
+    /// Loopback UDP socket the loop thread is woken up with, by sending a datagram to itself
+    SocketHandle wakeup_socket;
+#endif
+
+    std::thread thread;
+};
+
+} // namespace Sockets
+} // namespace Service
@@ -4,12 +4,14 @@
 
 #include "core/hle/service/time/time.h"
 #include "core/hle/service/time/time_s.h"
+#include "core/hle/service/time/time_sharedmemory.h"
 
 namespace Service {
 namespace Time {
 
 void InstallInterfaces(SM::ServiceManager& service_manager) {
-    std::make_shared<TimeS>()->InstallAsService(service_manager);
+    auto shared_memory = std::make_shared<SharedMemory>();
+    std::make_shared<TimeS>(shared_memory)->InstallAsService(service_manager);
 }
 
 } // namespace Time
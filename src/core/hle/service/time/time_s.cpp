@@ -2,12 +2,12 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
-#include <chrono>
 #include "common/logging/log.h"
 #include "core/hle/ipc_helpers.h"
 #include "core/hle/kernel/client_port.h"
 #include "core/hle/kernel/client_session.h"
 #include "core/hle/service/time/time_s.h"
+#include "core/hle/service/time/time_sharedmemory.h"
 
 namespace Service {
 namespace Time {
@@ -23,9 +23,7 @@ public:
 
 private:
     void GetCurrentTime(Kernel::HLERequestContext& ctx) {
-        const s64 time_since_epoch{std::chrono::duration_cast<std::chrono::milliseconds>(
-                                       std::chrono::system_clock::now().time_since_epoch())
-                                       .count()};
+        const s64 time_since_epoch = GetSystemClockTimeMs();
         IPC::RequestBuilder rb{ctx, 4};
         rb.Push(RESULT_SUCCESS);
         rb.Push<u64>(time_since_epoch);
@@ -47,9 +45,18 @@ void TimeS::GetStandardUserSystemClock(Kernel::HLERequestContext& ctx) {
     }
 }
 
-TimeS::TimeS() : ServiceFramework("time:s") {
+void TimeS::GetSharedMemoryNativeHandle(Kernel::HLERequestContext& ctx) {
+    IPC::RequestBuilder rb{ctx, 2, 1};
+    rb.Push(RESULT_SUCCESS);
+    rb.PushCopyObjects(shared_memory->GetSharedMemoryHolder());
+    LOG_DEBUG(Service, "called");
+}
+
+TimeS::TimeS(std::shared_ptr<SharedMemory> shared_memory)
+    : ServiceFramework("time:s"), shared_memory(std::move(shared_memory)) {
     static const FunctionInfo functions[] = {
         {0x00000000, &TimeS::GetStandardUserSystemClock, "GetStandardUserSystemClock"},
+        {0x00000014, &TimeS::GetSharedMemoryNativeHandle, "GetSharedMemoryNativeHandle"},
     };
     RegisterHandlers(functions);
 }
@@ -4,19 +4,25 @@
 
 #pragma once
 
+#include <memory>
 #include "core/hle/kernel/hle_ipc.h"
 #include "core/hle/service/service.h"
 
 namespace Service {
 namespace Time {
 
+class SharedMemory;
+
 class TimeS final : public ServiceFramework<TimeS> {
 public:
-    TimeS();
+    explicit TimeS(std::shared_ptr<SharedMemory> shared_memory);
     ~TimeS() = default;
 
 private:
     void GetStandardUserSystemClock(Kernel::HLERequestContext& ctx);
+    void GetSharedMemoryNativeHandle(Kernel::HLERequestContext& ctx);
+
+    std::shared_ptr<SharedMemory> shared_memory;
 };
 
 } // namespace Time
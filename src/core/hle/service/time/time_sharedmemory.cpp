@@ -0,0 +1,78 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstddef>
+#include <random>
+#include "core/core_timing.h"
+#include "core/hle/service/time/time_sharedmemory.h"
+#include "core/settings.h"
+
+namespace Service {
+namespace Time {
+
+/// Guest ticks between two updates of the system clocks
+constexpr s64 UPDATE_PERIOD_TICKS = static_cast<s64>(BASE_CLOCK_RATE);
+/// POSIX time the system clocks start at in deterministic mode, 2018-01-01 00:00:00 UTC
+constexpr s64 DETERMINISTIC_EPOCH_MS = 1514764800000;
+/// Seed of the clock source id in deterministic mode
+constexpr u64 DETERMINISTIC_CLOCK_SOURCE_SEED = 0x5EED;
+
+s64 GetSystemClockTimeMs() {
+    if (Settings::values.use_deterministic_mode) {
+        return DETERMINISTIC_EPOCH_MS + static_cast<s64>(CoreTiming::GetGlobalTimeUs() / 1000);
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+SharedMemory::SharedMemory() : page("Time:SharedMemory") {
+    static_assert(offsetof(Format, standard_local_system_clock) == 0x38,
+                  "standard_local_system_clock is at the wrong offset");
+    static_assert(offsetof(Format, standard_network_system_clock) == 0x80,
+                  "standard_network_system_clock is at the wrong offset");
+    static_assert(offsetof(Format, standard_user_system_clock_automatic_correction) == 0xC8,
+                  "standard_user_system_clock_automatic_correction is at the wrong offset");
+    static_assert(sizeof(Format) <= Memory::PAGE_SIZE, "Format doesn't fit in a page");
+
+    std::mt19937_64 generator(Settings::values.use_deterministic_mode
+                                  ? DETERMINISTIC_CLOCK_SOURCE_SEED
+                                  : std::random_device{}());
+    clock_source_id = {generator(), generator()};
+
+    // The steady clock counts from the start of the emulation
+    PublishState(page.Get().standard_steady_clock, SteadyClockContext{0, clock_source_id});
+    PublishState(page.Get().standard_user_system_clock_automatic_correction, false);
+    UpdateSystemClocks();
+
+    update_event = CoreTiming::RegisterEvent("Time::UpdateSystemClocks", [this](u64, int late) {
+        UpdateSystemClocks();
+        CoreTiming::ScheduleEvent(UPDATE_PERIOD_TICKS - late, update_event);
+    });
+    CoreTiming::ScheduleEvent(UPDATE_PERIOD_TICKS, update_event);
+}
+
+SharedMemory::~SharedMemory() {
+    CoreTiming::RemoveEvent(update_event);
+}
+
+void SharedMemory::UpdateSystemClocks() {
+    const s64 posix_time = GetSystemClockTimeMs() / 1000;
+    const s64 steady_time = static_cast<s64>(CoreTiming::GetGlobalTimeNs() / 1000000000);
+    const s64 offset = posix_time - steady_time;
+
+    // The contexts only change when the guest time drifted from the host time by a second
+    if (offset == system_clock_offset) {
+        return;
+    }
+    system_clock_offset = offset;
+
+    const SystemClockContext context{offset, {steady_time, clock_source_id}};
+    PublishState(page.Get().standard_local_system_clock, context);
+    PublishState(page.Get().standard_network_system_clock, context);
+}
+
+} // namespace Time
+} // namespace Service
@@ -0,0 +1,84 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include "common/common_funcs.h"
+#include "common/common_types.h"
+#include "common/swap.h"
+#include "core/hle/kernel/shared_memory.h"
+#include "core/hle/service/shared_state.h"
+
+namespace CoreTiming {
+struct EventType;
+}
+
+namespace Service {
+namespace Time {
+
+/// Identifies the source of a steady clock, time points of different sources can't be compared
+using ClockSourceId = u128;
+
+struct SteadyClockContext {
+    /// Nanoseconds added to the guest time to get the time point of the steady clock
+    u64_le internal_offset;
+    ClockSourceId clock_source_id;
+};
+static_assert(sizeof(SteadyClockContext) == 0x18, "SteadyClockContext has wrong size");
+
+struct SteadyClockTimePoint {
+    /// Seconds of the steady clock
+    s64_le time_point;
+    ClockSourceId clock_source_id;
+};
+static_assert(sizeof(SteadyClockTimePoint) == 0x18, "SteadyClockTimePoint has wrong size");
+
+struct SystemClockContext {
+    /// Seconds added to the steady clock to get the POSIX time
+    s64_le offset;
+    SteadyClockTimePoint steady_time_point;
+};
+static_assert(sizeof(SystemClockContext) == 0x20, "SystemClockContext has wrong size");
+
+/**
+ * Gets the POSIX time of the system clocks in milliseconds. It is the host time, or in
+ * deterministic mode a fixed date advanced by the guest time.
+ */
+s64 GetSystemClockTimeMs();
+
+/**
+ * Page of the clock contexts the time services share with the applications, which read the time
+ * from it without calling the services. Each context is double-buffered, see DoubleBufferedState.
+ */
+class SharedMemory final {
+public:
+    SharedMemory();
+    ~SharedMemory();
+
+    Kernel::SharedPtr<Kernel::SharedMemory> GetSharedMemoryHolder() const {
+        return page.GetSharedMemory();
+    }
+
+private:
+    struct Format {
+        DoubleBufferedState<SteadyClockContext> standard_steady_clock;
+        DoubleBufferedState<SystemClockContext> standard_local_system_clock;
+        DoubleBufferedState<SystemClockContext> standard_network_system_clock;
+        DoubleBufferedState<bool> standard_user_system_clock_automatic_correction;
+        u32_le format_version;
+    };
+
+    /// Moves the system clocks along with the host clock, as the guest time may drift from it
+    void UpdateSystemClocks();
+
+    SharedStatePage<Format> page;
+    CoreTiming::EventType* update_event;
+    ClockSourceId clock_source_id;
+    /// Offset of the system clocks that was published last
+    s64 system_clock_offset = 0;
+};
+
+} // namespace Time
+} // namespace Service
@@ -5,35 +5,46 @@
 #include <algorithm>
 
 #include "common/alignment.h"
+#include "common/math_util.h"
+#include "common/microprofile.h"
 #include "common/scope_exit.h"
+#include "core/core.h"
 #include "core/core_timing.h"
 #include "core/hle/ipc_helpers.h"
+#include "core/hle/service/hid/hid.h"
 #include "core/hle/service/nvdrv/devices/nvdisp_disp0.h"
 #include "core/hle/service/nvdrv/nvdrv_a.h"
 #include "core/hle/service/vi/vi.h"
 #include "core/hle/service/vi/vi_m.h"
+#include "core/settings.h"
 #include "video_core/renderer_base.h"
-#include "video_core/video_core.h"
 
 namespace Service {
 namespace VI {
 
-constexpr size_t SCREEN_REFRESH_RATE = 60;
-constexpr u64 frame_ticks = static_cast<u64>(BASE_CLOCK_RATE / SCREEN_REFRESH_RATE);
-
+/// Refresh rate of the displays of the Switch, in Hz
+constexpr u32 SCREEN_REFRESH_RATE = 60;
+/// Range of the refresh rates that can be configured, in Hz
+constexpr u32 MIN_REFRESH_RATE = 1;
+constexpr u32 MAX_REFRESH_RATE = 1000;
+
+/**
+ * Binder parcel. Requests are read in place from the buffer they were received in, and responses
+ * are written to a buffer provided by the caller, so that a service can reuse the same buffers for
+ * every transaction.
+ */
 class Parcel {
 public:
-    // This default size was chosen arbitrarily.
+    // Small parcels are zero-padded to this size when serialized.
     static constexpr size_t DefaultBufferSize = 0x40;
-    Parcel() : buffer(DefaultBufferSize) {}
-    Parcel(std::vector<u8> data) : buffer(std::move(data)) {}
+    Parcel() = default;
+    /// Reads a parcel from `data`, which must outlive it
+    Parcel(const u8* data, size_t size) : read_buffer(data), read_buffer_size(size) {}
     virtual ~Parcel() = default;
 
     template <typename T>
     T Read() {
-        T val;
-        std::memcpy(&val, buffer.data() + read_index, sizeof(T));
-        read_index += sizeof(T);
+        T val = ReadUnaligned<T>();
         read_index = Common::AlignUp(read_index, 4);
         return val;
     }
@@ -41,63 +52,63 @@ public:
     template <typename T>
     T ReadUnaligned() {
         T val;
-        std::memcpy(&val, buffer.data() + read_index, sizeof(T));
-        read_index += sizeof(T);
+        std::memcpy(&val, ReadBlockUnaligned(sizeof(T)), sizeof(T));
         return val;
     }
 
-    std::vector<u8> ReadBlock(size_t length) {
-        std::vector<u8> data(length);
-        std::memcpy(data.data(), buffer.data() + read_index, length);
-        read_index += length;
+    /// Returns a pointer to the next `length` bytes of the parcel, valid as long as its data
+    const u8* ReadBlock(size_t length) {
+        const u8* data = ReadBlockUnaligned(length);
         read_index = Common::AlignUp(read_index, 4);
         return data;
     }
 
-    std::u16string ReadInterfaceToken() {
-        u32 unknown = Read<u32_le>();
-        u32 length = Read<u32_le>();
-
-        std::u16string token{};
-
-        for (u32 ch = 0; ch < length + 1; ++ch) {
-            token.push_back(ReadUnaligned<u16_le>());
-        }
-
-        read_index = Common::AlignUp(read_index, 4);
+    /// Skips the interface token at the start of the data, which isn't checked
+    void SkipInterfaceToken() {
+        Read<u32_le>(); // Unknown
+        const u32 length = Read<u32_le>();
 
-        return token;
+        // The token is NUL terminated
+        ReadBlock((length + 1) * sizeof(u16_le));
     }
 
     template <typename T>
     void Write(const T& val) {
-        if (buffer.size() < write_index + sizeof(T))
-            buffer.resize(buffer.size() + sizeof(T) + DefaultBufferSize);
-        std::memcpy(buffer.data() + write_index, &val, sizeof(T));
-        write_index += sizeof(T);
-        write_index = Common::AlignUp(write_index, 4);
+        ASSERT(write_buffer != nullptr);
+        write_buffer->resize(Common::AlignUp(write_index + sizeof(T), 4));
+        std::memcpy(write_buffer->data() + write_index, &val, sizeof(T));
+        write_index = write_buffer->size();
     }
 
     void Deserialize() {
         Header header{};
-        std::memcpy(&header, buffer.data(), sizeof(Header));
+        std::memcpy(&header, ReadBlockUnaligned(sizeof(Header)), sizeof(Header));
 
         read_index = header.data_offset;
         DeserializeData();
     }
 
-    std::vector<u8> Serialize() {
+    /**
+     * Serializes the parcel into `out`, replacing its contents. Its capacity is kept, so reusing
+     * the same vector for several parcels doesn't allocate.
+     */
+    void Serialize(std::vector<u8>& out) {
         ASSERT(read_index == 0);
+        out.assign(sizeof(Header), 0);
+        write_buffer = &out;
         write_index = sizeof(Header);
 
         SerializeData();
 
         Header header{};
         header.data_offset = sizeof(Header);
-        header.data_size = write_index - sizeof(Header);
-        std::memcpy(buffer.data(), &header, sizeof(Header));
+        header.data_size = static_cast<u32>(write_index - sizeof(Header));
+        std::memcpy(out.data(), &header, sizeof(Header));
 
-        return buffer;
+        if (out.size() < DefaultBufferSize) {
+            out.resize(DefaultBufferSize);
+        }
+        write_buffer = nullptr;
     }
 
 protected:
@@ -114,8 +125,20 @@ private:
     };
     static_assert(sizeof(Header) == 16, "ParcelHeader has wrong size");
 
-    std::vector<u8> buffer;
+    const u8* ReadBlockUnaligned(size_t length) {
+        ASSERT_MSG(read_index + length <= read_buffer_size,
+                   "Reading 0x%zx bytes at 0x%zx past the end of a parcel of 0x%zx bytes", length,
+                   read_index, read_buffer_size);
+        const u8* data = read_buffer + read_index;
+        read_index += length;
+        return data;
+    }
+
+    const u8* read_buffer = nullptr;
+    size_t read_buffer_size = 0;
     size_t read_index = 0;
+
+    std::vector<u8>* write_buffer = nullptr;
     size_t write_index = 0;
 };
 
@@ -147,13 +170,13 @@ private:
 
 class IGBPConnectRequestParcel : public Parcel {
 public:
-    IGBPConnectRequestParcel(const std::vector<u8>& buffer) : Parcel(buffer) {
+    IGBPConnectRequestParcel(const u8* data, size_t size) : Parcel(data, size) {
         Deserialize();
     }
     ~IGBPConnectRequestParcel() override = default;
 
     void DeserializeData() {
-        std::u16string token = ReadInterfaceToken();
+        SkipInterfaceToken();
         data = Read<Data>();
     }
 
@@ -194,13 +217,13 @@ private:
 
 class IGBPSetPreallocatedBufferRequestParcel : public Parcel {
 public:
-    IGBPSetPreallocatedBufferRequestParcel(const std::vector<u8>& buffer) : Parcel(buffer) {
+    IGBPSetPreallocatedBufferRequestParcel(const u8* data, size_t size) : Parcel(data, size) {
         Deserialize();
     }
     ~IGBPSetPreallocatedBufferRequestParcel() override = default;
 
     void DeserializeData() {
-        std::u16string token = ReadInterfaceToken();
+        SkipInterfaceToken();
         data = Read<Data>();
         ASSERT(data.graphic_buffer_length == sizeof(IGBPBuffer));
         buffer = Read<IGBPBuffer>();
@@ -231,13 +254,13 @@ protected:
 
 class IGBPDequeueBufferRequestParcel : public Parcel {
 public:
-    IGBPDequeueBufferRequestParcel(const std::vector<u8>& buffer) : Parcel(buffer) {
+    IGBPDequeueBufferRequestParcel(const u8* data, size_t size) : Parcel(data, size) {
         Deserialize();
     }
     ~IGBPDequeueBufferRequestParcel() override = default;
 
     void DeserializeData() {
-        std::u16string token = ReadInterfaceToken();
+        SkipInterfaceToken();
         data = Read<Data>();
     }
 
@@ -254,30 +277,35 @@ public:
 
 class IGBPDequeueBufferResponseParcel : public Parcel {
 public:
-    IGBPDequeueBufferResponseParcel(u32 slot) : Parcel(), slot(slot) {}
+    IGBPDequeueBufferResponseParcel(u32 slot, s32 status = 0)
+        : Parcel(), slot(slot), status(status) {}
     ~IGBPDequeueBufferResponseParcel() override = default;
 
+    /// Status returned when no buffer became free, Android's WOULD_BLOCK
+    static constexpr s32 STATUS_WOULD_BLOCK = -11;
+
 protected:
     void SerializeData() override {
         Write(slot);
         // TODO(Subv): Find out how this Fence is used.
         std::array<u32_le, 11> fence = {};
         Write(fence);
-        Write<u32_le>(0);
+        Write(status);
     }
 
     u32_le slot;
+    s32_le status;
 };
 
 class IGBPRequestBufferRequestParcel : public Parcel {
 public:
-    IGBPRequestBufferRequestParcel(const std::vector<u8>& buffer) : Parcel(buffer) {
+    IGBPRequestBufferRequestParcel(const u8* data, size_t size) : Parcel(data, size) {
         Deserialize();
     }
     ~IGBPRequestBufferRequestParcel() override = default;
 
     void DeserializeData() {
-        std::u16string token = ReadInterfaceToken();
+        SkipInterfaceToken();
         slot = Read<u32_le>();
     }
 
@@ -307,13 +335,13 @@ protected:
 
 class IGBPQueueBufferRequestParcel : public Parcel {
 public:
-    IGBPQueueBufferRequestParcel(const std::vector<u8>& buffer) : Parcel(buffer) {
+    IGBPQueueBufferRequestParcel(const u8* data, size_t size) : Parcel(data, size) {
         Deserialize();
     }
     ~IGBPQueueBufferRequestParcel() override = default;
 
     void DeserializeData() {
-        std::u16string token = ReadInterfaceToken();
+        SkipInterfaceToken();
         data = Read<Data>();
     }
 
@@ -392,66 +420,101 @@ private:
         auto transaction = static_cast<TransactionId>(rp.Pop<u32>());
         u32 flags = rp.Pop<u32>();
 
-        auto& input_buffer = ctx.BufferDescriptorA()[0];
-        std::vector<u8> input_data(input_buffer.Size());
-        Memory::ReadBlock(input_buffer.Address(), input_data.data(), input_buffer.Size());
+        // The request is parsed in place when possible, and the response is built in a scratch
+        // buffer of the context, which keeps its capacity from one transaction to the next
+        const auto input_buffer = ctx.BufferViewA();
+        const u8* input_data = input_buffer.Data();
+        const size_t input_size = input_buffer.Size();
+        if (!input_buffer.IsContiguous()) {
+            std::vector<u8>& scratch = ctx.ScratchBuffer(0, input_size);
+            input_buffer.Read(0, scratch.data(), input_size);
+            input_data = scratch.data();
+        }
 
-        auto& output_buffer = ctx.BufferDescriptorB()[0];
+        const auto output_buffer = ctx.BufferViewB();
+        std::vector<u8>& output_data = ctx.ScratchBuffer(1, 0);
 
         auto buffer_queue = nv_flinger->GetBufferQueue(id);
 
         if (transaction == TransactionId::Connect) {
-            IGBPConnectRequestParcel request{input_data};
+            IGBPConnectRequestParcel request{input_data, input_size};
             IGBPConnectResponseParcel response{1280, 720};
-            auto response_buffer = response.Serialize();
-            Memory::WriteBlock(output_buffer.Address(), response_buffer.data(),
-                               output_buffer.Size());
+            response.Serialize(output_data);
         } else if (transaction == TransactionId::SetPreallocatedBuffer) {
-            IGBPSetPreallocatedBufferRequestParcel request{input_data};
+            IGBPSetPreallocatedBufferRequestParcel request{input_data, input_size};
 
             buffer_queue->SetPreallocatedBuffer(request.data.slot, request.buffer);
 
             IGBPSetPreallocatedBufferResponseParcel response{};
-            auto response_buffer = response.Serialize();
-            Memory::WriteBlock(output_buffer.Address(), response_buffer.data(),
-                               output_buffer.Size());
+            response.Serialize(output_data);
         } else if (transaction == TransactionId::DequeueBuffer) {
-            IGBPDequeueBufferRequestParcel request{input_data};
-
-            u32 slot = buffer_queue->DequeueBuffer(request.data.pixel_format, request.data.width,
-                                                   request.data.height);
-
-            IGBPDequeueBufferResponseParcel response{slot};
-            auto response_buffer = response.Serialize();
-            Memory::WriteBlock(output_buffer.Address(), response_buffer.data(),
-                               output_buffer.Size());
+            IGBPDequeueBufferRequestParcel request{input_data, input_size};
+            const auto data = request.data;
+
+            auto slot = buffer_queue->DequeueBuffer(data.pixel_format, data.width, data.height);
+            if (slot == boost::none) {
+                // All the buffers are in use, wait for the compositor to release one without
+                // blocking the other guest threads
+                ctx.RunAsync(
+                    [buffer_queue, data] {
+                        buffer_queue->WaitForFreeBuffer(data.pixel_format, data.width,
+                                                        data.height, DEQUEUE_BUFFER_TIMEOUT);
+                    },
+                    [buffer_queue, data](Kernel::HLERequestContext& ctx) {
+                        CompleteDequeueBuffer(ctx, *buffer_queue, data);
+                    });
+                return;
+            }
+
+            IGBPDequeueBufferResponseParcel response{*slot};
+            response.Serialize(output_data);
         } else if (transaction == TransactionId::RequestBuffer) {
-            IGBPRequestBufferRequestParcel request{input_data};
+            IGBPRequestBufferRequestParcel request{input_data, input_size};
 
             auto& buffer = buffer_queue->RequestBuffer(request.slot);
 
             IGBPRequestBufferResponseParcel response{buffer};
-            auto response_buffer = response.Serialize();
-            Memory::WriteBlock(output_buffer.Address(), response_buffer.data(),
-                               output_buffer.Size());
+            response.Serialize(output_data);
         } else if (transaction == TransactionId::QueueBuffer) {
-            IGBPQueueBufferRequestParcel request{input_data};
+            IGBPQueueBufferRequestParcel request{input_data, input_size};
 
             buffer_queue->QueueBuffer(request.data.slot);
+            nv_flinger->OnBufferQueued(*buffer_queue);
 
             IGBPQueueBufferResponseParcel response{1280, 720};
-            auto response_buffer = response.Serialize();
-            Memory::WriteBlock(output_buffer.Address(), response_buffer.data(),
-                               output_buffer.Size());
+            response.Serialize(output_data);
         } else {
             ASSERT_MSG(false, "Unimplemented");
         }
+        output_buffer.WriteAll(output_data);
 
         LOG_WARNING(Service, "(STUBBED) called");
         IPC::RequestBuilder rb{ctx, 2};
         rb.Push(RESULT_SUCCESS);
     }
 
+    /// Maximum time an application waits for a buffer to become free in DequeueBuffer
+    static constexpr std::chrono::milliseconds DEQUEUE_BUFFER_TIMEOUT{1000};
+
+    /// Answers a DequeueBuffer request that had to wait for a free buffer
+    static void CompleteDequeueBuffer(Kernel::HLERequestContext& ctx, BufferQueue& buffer_queue,
+                                      const IGBPDequeueBufferRequestParcel::Data& data) {
+        auto slot = buffer_queue.DequeueBuffer(data.pixel_format, data.width, data.height);
+        s32 status = 0;
+        if (slot == boost::none) {
+            LOG_ERROR(Service, "No buffer of queue %u became free", buffer_queue.GetId());
+            status = IGBPDequeueBufferResponseParcel::STATUS_WOULD_BLOCK;
+        }
+
+        std::vector<u8>& output_data = ctx.ScratchBuffer(1, 0);
+        IGBPDequeueBufferResponseParcel response{slot.value_or(0), status};
+        response.Serialize(output_data);
+        ctx.BufferViewB().WriteAll(output_data);
+
+        IPC::RequestBuilder rb{ctx, 2};
+        rb.Push(RESULT_SUCCESS);
+    }
+
     void AdjustRefcount(Kernel::HLERequestContext& ctx) {
         IPC::RequestParser rp{ctx};
         u32 id = rp.Pop<u32>();
@@ -468,7 +531,8 @@ private:
 
 class ISystemDisplayService final : public ServiceFramework<ISystemDisplayService> {
 public:
-    ISystemDisplayService() : ServiceFramework("ISystemDisplayService") {
+    ISystemDisplayService(std::shared_ptr<NVFlinger> nv_flinger)
+        : ServiceFramework("ISystemDisplayService"), nv_flinger(std::move(nv_flinger)) {
         static const FunctionInfo functions[] = {
             {1200, nullptr, "GetZOrderCountMin"},
             {2205, &ISystemDisplayService::SetLayerZ, "SetLayerZ"},
@@ -479,14 +543,18 @@ public:
 
 private:
     void SetLayerZ(Kernel::HLERequestContext& ctx) {
-        LOG_WARNING(Service, "(STUBBED) called");
         IPC::RequestParser rp{ctx};
         u64 layer_id = rp.Pop<u64>();
-        u64 z_value = rp.Pop<u64>();
+        s64 z_value = rp.Pop<s64>();
+
+        LOG_DEBUG(Service, "called layer_id=%llu, z_value=%lld", layer_id, z_value);
+        nv_flinger->SetLayerZ(layer_id, z_value);
 
         IPC::RequestBuilder rb = rp.MakeBuilder(2, 0, 0, 0);
         rb.Push(RESULT_SUCCESS);
     }
+
+    std::shared_ptr<NVFlinger> nv_flinger;
 };
 
 class IManagerDisplayService final : public ServiceFramework<IManagerDisplayService> {
@@ -554,7 +622,7 @@ void IApplicationDisplayService::GetSystemDisplayService(Kernel::HLERequestConte
 
     IPC::RequestBuilder rb{ctx, 2, 0, 0, 1};
     rb.Push(RESULT_SUCCESS);
-    rb.PushIpcInterface<ISystemDisplayService>();
+    rb.PushIpcInterface<ISystemDisplayService>(nv_flinger);
 }
 
 void IApplicationDisplayService::GetManagerDisplayService(Kernel::HLERequestContext& ctx) {
@@ -591,14 +659,15 @@ void IApplicationDisplayService::OpenLayer(Kernel::HLERequestContext& ctx) {
     u64 layer_id = rp.Pop<u64>();
     u64 aruid = rp.Pop<u64>();
 
-    auto& buffer = ctx.BufferDescriptorB()[0];
+    const auto buffer = ctx.BufferViewB();
 
     u64 display_id = nv_flinger->OpenDisplay(display_name);
     u32 buffer_queue_id = nv_flinger->GetBufferQueueId(display_id, layer_id);
 
+    std::vector<u8>& data = ctx.ScratchBuffer(0, 0);
     NativeWindow native_window{buffer_queue_id};
-    auto data = native_window.Serialize();
-    Memory::WriteBlock(buffer.Address(), data.data(), data.size());
+    native_window.Serialize(data);
+    buffer.WriteAll(data);
 
     IPC::RequestBuilder rb = rp.MakeBuilder(4, 0, 0, 0);
     rb.Push(RESULT_SUCCESS);
@@ -606,10 +675,18 @@ void IApplicationDisplayService::OpenLayer(Kernel::HLERequestContext& ctx) {
 }
 
 void IApplicationDisplayService::SetLayerScalingMode(Kernel::HLERequestContext& ctx) {
-    LOG_WARNING(Service, "(STUBBED) called");
     IPC::RequestParser rp{ctx};
     u32 scaling_mode = rp.Pop<u32>();
-    u64 unknown = rp.Pop<u64>();
+    u64 layer_id = rp.Pop<u64>();
+
+    LOG_DEBUG(Service, "called scaling_mode=%u, layer_id=%llu", scaling_mode, layer_id);
+
+    using ScalingMode = RendererBase::ScalingMode;
+    if (scaling_mode > static_cast<u32>(ScalingMode::PreserveAspectRatio)) {
+        LOG_ERROR(Service, "Invalid scaling mode %u for layer %llu", scaling_mode, layer_id);
+    } else {
+        nv_flinger->SetLayerScalingMode(layer_id, scaling_mode);
+    }
 
     IPC::RequestBuilder rb = rp.MakeBuilder(2, 0, 0, 0);
     rb.Push(RESULT_SUCCESS);
@@ -659,18 +736,73 @@ NVFlinger::NVFlinger() {
     displays.emplace_back(edid);
     displays.emplace_back(internal);
 
-    // Schedule the screen composition events
+    // Schedule the screen composition events, each display refreshes on its own schedule
     composition_event =
-        CoreTiming::RegisterEvent("ScreenCompositioin", [this](u64 userdata, int cycles_late) {
-            Compose();
-            CoreTiming::ScheduleEvent(frame_ticks - cycles_late, composition_event);
+        CoreTiming::RegisterEvent("ScreenComposition", [this](u64 userdata, int cycles_late) {
+            Display& display = GetDisplay(userdata);
+            Compose(display);
+            CoreTiming::ScheduleEvent(GetVsyncPeriod() - cycles_late, composition_event,
+                                      display.id);
         });
 
-    CoreTiming::ScheduleEvent(frame_ticks, composition_event);
+    for (const auto& display : displays) {
+        CoreTiming::ScheduleEvent(GetVsyncPeriod(), composition_event, display.id);
+    }
 }
 
 NVFlinger::~NVFlinger() {
-    CoreTiming::UnscheduleEvent(composition_event, 0);
+    for (const auto& display : displays) {
+        CoreTiming::UnscheduleEvent(composition_event, display.id);
+    }
+}
+
+s64 NVFlinger::GetVsyncPeriod() {
+    u32 refresh_rate = SCREEN_REFRESH_RATE;
+    switch (Settings::values.refresh_mode) {
+    case Settings::RefreshMode::Fixed:
+        refresh_rate =
+            MathUtil::Clamp(Settings::values.refresh_rate, MIN_REFRESH_RATE, MAX_REFRESH_RATE);
+        break;
+    case Settings::RefreshMode::Host: {
+        if (Settings::GetSpeedLimit() != 100 || Settings::values.use_deterministic_mode) {
+            // Emulated time only runs at the pace of walltime at native speed, and never does in
+            // deterministic mode
+            break;
+        }
+        // Follow the refresh period the frame limiter measured for the host display, as emulated
+        // time is paced to walltime
+        using DoubleSecs = std::chrono::duration<double>;
+        const auto host_period = Core::System::GetInstance().frame_limiter.GetVBlankPeriod();
+        const double seconds = std::chrono::duration_cast<DoubleSecs>(host_period).count();
+        if (seconds > 1.0 / MAX_REFRESH_RATE && seconds < 1.0 / MIN_REFRESH_RATE) {
+            return static_cast<s64>(BASE_CLOCK_RATE * seconds);
+        }
+        break;
+    }
+    case Settings::RefreshMode::Unlocked:
+        // Displays still refresh at the regular rate when nothing is queued, see OnBufferQueued
+        break;
+    }
+    return static_cast<s64>(BASE_CLOCK_RATE / refresh_rate);
+}
+
+void NVFlinger::OnBufferQueued(const BufferQueue& buffer_queue) {
+    if (!Settings::IsRefreshUnlocked()) {
+        return;
+    }
+
+    // Compose the display right away instead of waiting for its next refresh. The renderer then
+    // limits the rate of the compositions to how fast the host presents the frames.
+    const auto itr = std::find_if(displays.begin(), displays.end(), [&](const Display& display) {
+        return std::any_of(display.layers.begin(), display.layers.end(), [&](const Layer& layer) {
+            return layer.buffer_queue.get() == &buffer_queue;
+        });
+    });
+    if (itr == displays.end()) {
+        return;
+    }
+    CoreTiming::UnscheduleEvent(composition_event, itr->id);
+    CoreTiming::ScheduleEvent(0, composition_event, itr->id);
 }
 
 u64 NVFlinger::OpenDisplay(const std::string& name) {
@@ -690,8 +822,6 @@ u64 NVFlinger::OpenDisplay(const std::string& name) {
 u64 NVFlinger::CreateLayer(u64 display_id) {
     auto& display = GetDisplay(display_id);
 
-    ASSERT_MSG(display.layers.empty(), "Only one layer is supported per display at the moment");
-
     u64 layer_id = next_layer_id++;
     u32 buffer_queue_id = next_buffer_queue_id++;
     auto buffer_queue = std::make_shared<BufferQueue>(buffer_queue_id, layer_id);
@@ -705,6 +835,14 @@ u32 NVFlinger::GetBufferQueueId(u64 display_id, u64 layer_id) {
     return layer.buffer_queue->GetId();
 }
 
+void NVFlinger::SetLayerZ(u64 layer_id, s64 z) {
+    GetLayer(layer_id).z = z;
+}
+
+void NVFlinger::SetLayerScalingMode(u64 layer_id, u32 scaling_mode) {
+    GetLayer(layer_id).scaling_mode = scaling_mode;
+}
+
 Kernel::SharedPtr<Kernel::Event> NVFlinger::GetVsyncEvent(u64 display_id) {
     const auto& display = GetDisplay(display_id);
     return display.vsync_event;
@@ -736,111 +874,194 @@ Layer& NVFlinger::GetLayer(u64 display_id, u64 layer_id) {
     return *itr;
 }
 
-void NVFlinger::Compose() {
-    for (auto& display : displays) {
-        // Trigger vsync for this display at the end of drawing
-        SCOPE_EXIT({ display.vsync_event->Signal(); });
+Layer& NVFlinger::GetLayer(u64 layer_id) {
+    auto itr = std::find_if(displays.begin(), displays.end(), [&](const Display& display) {
+        return std::any_of(display.layers.begin(), display.layers.end(),
+                           [&](const Layer& layer) { return layer.id == layer_id; });
+    });
+
+    ASSERT_MSG(itr != displays.end(), "Layer %llu doesn't exist", layer_id);
+    return GetLayer(itr->id, layer_id);
+}
 
-        // Don't do anything for displays without layers.
-        if (display.layers.empty())
-            continue;
+MICROPROFILE_DEFINE(NVFlinger_Compose, "NVFlinger", "Compose", MP_RGB(60, 150, 220));
 
-        // TODO(Subv): Support more than 1 layer.
-        ASSERT_MSG(display.layers.size() == 1, "Max 1 layer per display is supported");
+void NVFlinger::Compose(Display& display) {
+    MICROPROFILE_SCOPE(NVFlinger_Compose);
 
-        Layer& layer = display.layers[0];
-        auto& buffer_queue = layer.buffer_queue;
+    // Trigger vsync for this display at the end of drawing
+    SCOPE_EXIT({ display.vsync_event->Signal(); });
 
-        // Search for a queued buffer and acquire it
-        auto buffer = buffer_queue->AcquireBuffer();
+    // Don't do anything for displays without layers.
+    if (display.layers.empty())
+        return;
 
-        if (buffer == boost::none) {
-            // There was no queued buffer to draw, render previous frame
-            VideoCore::g_renderer->SwapBuffers({});
-            continue;
+    // Draw the layers from the bottom-most to the top-most one, layers with the same Z are
+    // drawn in the order they were created.
+    std::vector<Layer*> sorted_layers;
+    sorted_layers.reserve(display.layers.size());
+    for (auto& layer : display.layers) {
+        sorted_layers.push_back(&layer);
+    }
+    std::stable_sort(sorted_layers.begin(), sorted_layers.end(),
+                     [](const Layer* a, const Layer* b) { return a->z < b->z; });
+
+    using FlipLayer = NVDRV::Devices::nvdisp_disp0::Layer;
+    std::vector<FlipLayer> flip_layers;
+    flip_layers.reserve(sorted_layers.size());
+
+    // Buffers acquired for this frame, they are released once the frame has been composed
+    std::vector<std::pair<BufferQueue*, u32>> acquired_buffers;
+
+    for (Layer* layer : sorted_layers) {
+        FlipLayer flip_layer{layer->id, layer->scaling_mode, boost::none};
+
+        // Search for a queued buffer and acquire it. Without one the previous contents of the
+        // layer are drawn again.
+        auto buffer = layer->buffer_queue->AcquireBuffer();
+        if (buffer != boost::none) {
+            const auto& igbp_buffer = buffer->igbp_buffer;
+            flip_layer.plane = NVDRV::Devices::nvdisp_disp0::Plane{
+                igbp_buffer.gpu_buffer_id, igbp_buffer.offset, igbp_buffer.format,
+                igbp_buffer.width,         igbp_buffer.height, igbp_buffer.stride};
+            acquired_buffers.emplace_back(layer->buffer_queue.get(), buffer->slot);
         }
 
-        auto& igbp_buffer = buffer->igbp_buffer;
+        flip_layers.push_back(std::move(flip_layer));
+    }
 
-        // Now send the buffer to the GPU for drawing.
-        auto nvdrv = NVDRV::nvdrv_a.lock();
-        ASSERT(nvdrv);
+    // Now send the layers to the GPU for drawing.
+    auto nvdrv = NVDRV::nvdrv_a.lock();
+    ASSERT(nvdrv);
 
-        // TODO(Subv): Support more than just disp0. The display device selection is probably based
-        // on which display we're drawing (Default, Internal, External, etc)
-        auto nvdisp = nvdrv->GetDevice<NVDRV::Devices::nvdisp_disp0>("/dev/nvdisp_disp0");
-        ASSERT(nvdisp);
+    // TODO(Subv): Support more than just disp0. The display device selection is probably based
+    // on which display we're drawing (Default, Internal, External, etc)
+    auto nvdisp = nvdrv->GetDevice<NVDRV::Devices::nvdisp_disp0>("/dev/nvdisp_disp0");
+    ASSERT(nvdisp);
 
-        nvdisp->flip(igbp_buffer.gpu_buffer_id, igbp_buffer.offset, igbp_buffer.format,
-                     igbp_buffer.width, igbp_buffer.height, igbp_buffer.stride);
+    nvdisp->flip(flip_layers);
 
-        buffer_queue->ReleaseBuffer(buffer->slot);
+    for (const auto& acquired_buffer : acquired_buffers) {
+        acquired_buffer.first->ReleaseBuffer(acquired_buffer.second);
+    }
+
+    // The emulation of the next frame starts now, after the frame limiting of the renderer. In
+    // deterministic mode the input is only sampled on the guest clock.
+    if (Settings::values.use_low_latency_mode && !Settings::values.use_deterministic_mode) {
+        HID::SampleInput();
     }
 }
 
 BufferQueue::BufferQueue(u32 id, u64 layer_id) : id(id), layer_id(layer_id) {}
 
+BufferQueue::Slot& BufferQueue::GetSlot(u32 slot) {
+    ASSERT_MSG(slot < NUM_SLOTS, "Invalid buffer slot %u", slot);
+    return slots[slot];
+}
+
+const BufferQueue::Slot& BufferQueue::GetSlot(u32 slot) const {
+    ASSERT_MSG(slot < NUM_SLOTS, "Invalid buffer slot %u", slot);
+    return slots[slot];
+}
+
 void BufferQueue::SetPreallocatedBuffer(u32 slot, IGBPBuffer& igbp_buffer) {
-    Buffer buffer{};
-    buffer.slot = slot;
-    buffer.igbp_buffer = igbp_buffer;
-    buffer.status = Buffer::Status::Free;
+    Slot& buffer_slot = GetSlot(slot);
+    ASSERT_MSG(!buffer_slot.is_allocated, "Buffer %u is already allocated", slot);
 
-    LOG_WARNING(Service, "Adding graphics buffer %u", slot);
+    buffer_slot.buffer.slot = slot;
+    buffer_slot.buffer.igbp_buffer = igbp_buffer;
+    buffer_slot.status.store(Buffer::Status::Free, std::memory_order_relaxed);
+    // Publishes the buffer to the consumer
+    buffer_slot.is_allocated.store(true, std::memory_order_release);
 
-    queue.emplace_back(buffer);
+    LOG_WARNING(Service, "Adding graphics buffer %u", slot);
 }
 
-u32 BufferQueue::DequeueBuffer(u32 pixel_format, u32 width, u32 height) {
-    auto itr = std::find_if(queue.begin(), queue.end(), [&](const Buffer& buffer) {
+BufferQueue::Slot* BufferQueue::FindFreeSlot(u32 pixel_format, u32 width, u32 height) {
+    for (Slot& slot : slots) {
         // Only consider free buffers. Buffers become free once again after they've been Acquired
         // and Released by the compositor, see the NVFlinger::Compose method.
-        if (buffer.status != Buffer::Status::Free)
-            return false;
+        if (!slot.is_allocated.load(std::memory_order_acquire) ||
+            slot.status.load(std::memory_order_acquire) != Buffer::Status::Free) {
+            continue;
+        }
 
         // Make sure that the parameters match.
-        auto& igbp_buffer = buffer.igbp_buffer;
-        return igbp_buffer.format == pixel_format && igbp_buffer.width == width &&
-               igbp_buffer.height == height;
-    });
-    ASSERT(itr != queue.end());
+        const auto& igbp_buffer = slot.buffer.igbp_buffer;
+        if (igbp_buffer.format == pixel_format && igbp_buffer.width == width &&
+            igbp_buffer.height == height) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+boost::optional<u32> BufferQueue::DequeueBuffer(u32 pixel_format, u32 width, u32 height) {
+    Slot* slot = FindFreeSlot(pixel_format, width, height);
+    if (slot == nullptr) {
+        return boost::none;
+    }
+
+    // Only the producer takes free buffers, so the slot can't have changed in the meantime
+    slot->status.store(Buffer::Status::Dequeued, std::memory_order_relaxed);
+    return slot->buffer.slot;
+}
 
-    itr->status = Buffer::Status::Dequeued;
-    return itr->slot;
+bool BufferQueue::WaitForFreeBuffer(u32 pixel_format, u32 width, u32 height,
+                                    std::chrono::milliseconds timeout) {
+    // Announcing the waiter before checking the slots makes sure that a release either happens
+    // before the check or notifies the waiter, see ReleaseBuffer
+    ++num_waiters;
+    std::unique_lock<std::mutex> lock(fence_mutex);
+    const bool is_free = fence_cv.wait_for(lock, timeout, [&] {
+        return FindFreeSlot(pixel_format, width, height) != nullptr;
+    });
+    --num_waiters;
+    return is_free;
 }
 
 const IGBPBuffer& BufferQueue::RequestBuffer(u32 slot) const {
-    auto itr = std::find_if(queue.begin(), queue.end(),
-                            [&](const Buffer& buffer) { return buffer.slot == slot; });
-    ASSERT(itr != queue.end());
-    ASSERT(itr->status == Buffer::Status::Dequeued);
-    return itr->igbp_buffer;
+    const Slot& buffer_slot = GetSlot(slot);
+    ASSERT(buffer_slot.status.load(std::memory_order_relaxed) == Buffer::Status::Dequeued);
+    return buffer_slot.buffer.igbp_buffer;
 }
 
 void BufferQueue::QueueBuffer(u32 slot) {
-    auto itr = std::find_if(queue.begin(), queue.end(),
-                            [&](const Buffer& buffer) { return buffer.slot == slot; });
-    ASSERT(itr != queue.end());
-    ASSERT(itr->status == Buffer::Status::Dequeued);
-    itr->status = Buffer::Status::Queued;
+    Slot& buffer_slot = GetSlot(slot);
+    ASSERT(buffer_slot.status.load(std::memory_order_relaxed) == Buffer::Status::Dequeued);
+    buffer_slot.frame_number = next_frame_number++;
+    // Publishes the frame number to the consumer
+    buffer_slot.status.store(Buffer::Status::Queued, std::memory_order_release);
 }
 
 boost::optional<const BufferQueue::Buffer&> BufferQueue::AcquireBuffer() {
-    auto itr = std::find_if(queue.begin(), queue.end(), [](const Buffer& buffer) {
-        return buffer.status == Buffer::Status::Queued;
-    });
-    if (itr == queue.end())
+    Slot* oldest = nullptr;
+    for (Slot& slot : slots) {
+        if (slot.status.load(std::memory_order_acquire) == Buffer::Status::Queued &&
+            (oldest == nullptr || slot.frame_number < oldest->frame_number)) {
+            oldest = &slot;
+        }
+    }
+    if (oldest == nullptr)
         return boost::none;
-    itr->status = Buffer::Status::Acquired;
-    return *itr;
+
+    // Only the consumer takes queued buffers, so the slot can't have changed in the meantime
+    oldest->status.store(Buffer::Status::Acquired, std::memory_order_relaxed);
+    return oldest->buffer;
 }
 
 void BufferQueue::ReleaseBuffer(u32 slot) {
-    auto itr = std::find_if(queue.begin(), queue.end(),
-                            [&](const Buffer& buffer) { return buffer.slot == slot; });
-    ASSERT(itr != queue.end());
-    ASSERT(itr->status == Buffer::Status::Acquired);
-    itr->status = Buffer::Status::Free;
+    Slot& buffer_slot = GetSlot(slot);
+    ASSERT(buffer_slot.status.load(std::memory_order_relaxed) == Buffer::Status::Acquired);
+    buffer_slot.status.store(Buffer::Status::Free);
+
+    // Signal the fence. Taking the mutex orders the release with a waiter checking the slots.
+    if (num_waiters.load() != 0) {
+        {
+            std::lock_guard<std::mutex> lock(fence_mutex);
+        }
+        fence_cv.notify_all();
+    }
 }
 
 Layer::Layer(u64 id, std::shared_ptr<BufferQueue> queue) : id(id), buffer_queue(std::move(queue)) {}
@@ -4,7 +4,12 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <boost/optional.hpp>
 #include "core/hle/kernel/event.h"
 #include "core/hle/service/service.h"
@@ -35,23 +40,48 @@ struct IGBPBuffer {
 
 static_assert(sizeof(IGBPBuffer) == 0x16C, "IGBPBuffer has wrong size");
 
+/**
+ * Queue of the buffers of a layer, between the application drawing to them (the producer) and the
+ * compositor (the consumer). The buffers are kept in a fixed array of slots indexed by their slot
+ * number, and the status of each slot is atomic. The producer side (SetPreallocatedBuffer,
+ * DequeueBuffer, RequestBuffer and QueueBuffer) is used by the emu thread, while the consumer side
+ * (AcquireBuffer and ReleaseBuffer) may be used by another thread without taking a lock.
+ */
 class BufferQueue {
 public:
+    /// Maximum number of buffers in a queue, the same as in Android's BufferQueue
+    static constexpr u32 NUM_SLOTS = 64;
+
     BufferQueue(u32 id, u64 layer_id);
     ~BufferQueue() = default;
 
     struct Buffer {
-        enum class Status { Free = 0, Queued = 1, Dequeued = 2, Acquired = 3 };
+        enum class Status : u32 { Free = 0, Queued = 1, Dequeued = 2, Acquired = 3 };
 
         u32 slot;
-        Status status = Status::Free;
         IGBPBuffer igbp_buffer;
     };
 
     void SetPreallocatedBuffer(u32 slot, IGBPBuffer& buffer);
-    u32 DequeueBuffer(u32 pixel_format, u32 width, u32 height);
+
+    /**
+     * Dequeues a free buffer with the given parameters for the producer to draw to.
+     * @returns The slot of the buffer, or none if no such buffer is free.
+     */
+    boost::optional<u32> DequeueBuffer(u32 pixel_format, u32 width, u32 height);
+
+    /**
+     * Waits until a buffer with the given parameters is free, which the consumer signals when it
+     * releases one, or until the timeout expires. Can be called from any thread.
+     * @returns True if a buffer is free.
+     */
+    bool WaitForFreeBuffer(u32 pixel_format, u32 width, u32 height,
+                           std::chrono::milliseconds timeout);
+
     const IGBPBuffer& RequestBuffer(u32 slot) const;
     void QueueBuffer(u32 slot);
+
+    /// Acquires the buffer that was queued first, if any
     boost::optional<const Buffer&> AcquireBuffer();
     void ReleaseBuffer(u32 slot);
 
@@ -60,10 +90,33 @@ public:
     }
 
 private:
+    struct Slot {
+        Buffer buffer{};
+        std::atomic<Buffer::Status> status{Buffer::Status::Free};
+        /// Set once the buffer has been preallocated, before which the slot is unused
+        std::atomic<bool> is_allocated{false};
+        /// Order in which the buffer was queued, written by the producer before queueing it
+        u64 frame_number = 0;
+    };
+
+    /// Returns the free buffer with the given parameters, or nullptr if there is none
+    Slot* FindFreeSlot(u32 pixel_format, u32 width, u32 height);
+
+    Slot& GetSlot(u32 slot);
+    const Slot& GetSlot(u32 slot) const;
+
     u32 id;
     u64 layer_id;
 
-    std::vector<Buffer> queue;
+    std::array<Slot, NUM_SLOTS> slots;
+    /// Frame number of the next queued buffer, only used by the producer
+    u64 next_frame_number = 0;
+
+    // Fence signalled when a buffer is released. The consumer only takes the mutex to wake up
+    // producers waiting in WaitForFreeBuffer.
+    std::atomic<u32> num_waiters{0};
+    std::mutex fence_mutex;
+    std::condition_variable fence_cv;
 };
 
 struct Layer {
@@ -72,6 +125,10 @@ struct Layer {
 
     u64 id;
     std::shared_ptr<BufferQueue> buffer_queue;
+    /// Position in the stack of layers of the display, higher values are drawn on top
+    s64 z = 0;
+    /// How the layer is fitted to the display, one of RendererBase::ScalingMode
+    u32 scaling_mode = 1;
 };
 
 struct Display {
@@ -99,23 +156,38 @@ public:
     /// Gets the buffer queue id of the specified layer in the specified display.
     u32 GetBufferQueueId(u64 display_id, u64 layer_id);
 
+    /// Sets the position of the specified layer in the stack of layers of its display.
+    void SetLayerZ(u64 layer_id, s64 z);
+
+    /// Sets how the contents of the specified layer are fitted to its display.
+    void SetLayerScalingMode(u64 layer_id, u32 scaling_mode);
+
     /// Gets the vsync event for the specified display.
     Kernel::SharedPtr<Kernel::Event> GetVsyncEvent(u64 display_id);
 
     /// Obtains a buffer queue identified by the id.
     std::shared_ptr<BufferQueue> GetBufferQueue(u32 id) const;
 
-    /// Performs a composition request to the emulated nvidia GPU and triggers the vsync events when
-    /// finished.
-    void Compose();
+    /// Called when a buffer was queued, composes its display right away in unlocked mode.
+    void OnBufferQueued(const BufferQueue& buffer_queue);
 
 private:
+    /// Performs a composition request to the emulated nvidia GPU and triggers the vsync event of
+    /// the display when finished.
+    void Compose(Display& display);
+
+    /// Returns the time between two refreshes of a display, in CPU ticks, from the settings.
+    static s64 GetVsyncPeriod();
+
     /// Returns the display identified by the specified id.
     Display& GetDisplay(u64 display_id);
 
     /// Returns the layer identified by the specified id in the desired display.
     Layer& GetLayer(u64 display_id, u64 layer_id);
 
+    /// Returns the layer identified by the specified id, searching all the displays.
+    Layer& GetLayer(u64 layer_id);
+
     std::vector<Display> displays;
     std::vector<std::shared_ptr<BufferQueue>> buffer_queues;
 
@@ -125,7 +197,7 @@ private:
     /// layers.
     u32 next_buffer_queue_id = 1;
 
-    /// CoreTiming event that handles screen composition.
+    /// CoreTiming event that handles screen composition, the userdata is the id of the display.
     CoreTiming::EventType* composition_event;
 };
 
@@ -189,6 +189,9 @@ private:
     bool relocate;
     u32 entryPoint;
 
+    /// Whether every read-only segment is stored page aligned and whole in a file of that size
+    bool CanMapReadOnlySegments(u64 file_size) const;
+
 public:
     ElfReader(void* ptr);
 
@@ -209,7 +212,12 @@ public:
     u32 GetFlags() const {
         return (u32)(header->e_flags);
     }
-    SharedPtr<CodeSet> LoadInto(u32 vaddr);
+    /**
+     * Loads the segments into a new code set.
+     * @param image Mapping of the file the reader reads from. If set, the read-only segments are
+     *              mapped from it instead of being copied when its layout allows that.
+     */
+    SharedPtr<CodeSet> LoadInto(u32 vaddr, std::shared_ptr<FileUtil::MappedFile> image = nullptr);
 
     int GetNumSegments() const {
         return (int)(header->e_phnum);
@@ -272,7 +280,23 @@ const char* ElfReader::GetSectionName(int section) const {
     return nullptr;
 }
 
-SharedPtr<CodeSet> ElfReader::LoadInto(u32 vaddr) {
+bool ElfReader::CanMapReadOnlySegments(u64 file_size) const {
+    for (unsigned int i = 0; i < header->e_phnum; ++i) {
+        const Elf32_Phdr* p = &segments[i];
+        if (p->p_type != PT_LOAD || (p->p_flags & PF_W) != 0) {
+            continue;
+        }
+        // The whole segment comes from the file, including the rest of its last page
+        const u64 aligned_size = (p->p_memsz + 0xFFF) & ~0xFFF;
+        if ((p->p_offset & Memory::PAGE_MASK) != 0 || p->p_filesz != p->p_memsz ||
+            p->p_offset + aligned_size > file_size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SharedPtr<CodeSet> ElfReader::LoadInto(u32 vaddr, std::shared_ptr<FileUtil::MappedFile> image) {
     LOG_DEBUG(Loader, "String section: %i", header->e_shstrndx);
 
     // Should we relocate?
@@ -286,13 +310,17 @@ SharedPtr<CodeSet> ElfReader::LoadInto(u32 vaddr) {
     }
     LOG_DEBUG(Loader, "%i segments:", header->e_phnum);
 
+    // The read-only segments are mapped straight from the file when they are page aligned in it,
+    // only the writable ones are copied. Writes to the mapped pages stay private copies.
+    const bool map_read_only = image && CanMapReadOnlySegments(image->Size());
+
     // First pass : Get the bits into RAM
     u32 base_addr = relocate ? vaddr : 0;
 
     u32 total_image_size = 0;
     for (unsigned int i = 0; i < header->e_phnum; ++i) {
         Elf32_Phdr* p = &segments[i];
-        if (p->p_type == PT_LOAD) {
+        if (p->p_type == PT_LOAD && (!map_read_only || (p->p_flags & PF_W) != 0)) {
             total_image_size += (p->p_memsz + 0xFFF) & ~0xFFF;
         }
     }
@@ -332,10 +360,17 @@ SharedPtr<CodeSet> ElfReader::LoadInto(u32 vaddr) {
             u32 segment_addr = base_addr + p->p_vaddr;
             u32 aligned_size = (p->p_memsz + 0xFFF) & ~0xFFF;
 
-            codeset_segment->offset = current_image_position;
             codeset_segment->addr = segment_addr;
             codeset_segment->size = aligned_size;
 
+            if (map_read_only && (p->p_flags & PF_W) == 0) {
+                codeset_segment->offset = p->p_offset;
+                image->Advise(FileUtil::MappedFile::AccessHint::WillNeed, p->p_offset,
+                              aligned_size);
+                continue;
+            }
+
+            codeset_segment->offset = current_image_position;
             memcpy(&program_image[current_image_position], GetSegmentPtr(i), p->p_filesz);
             current_image_position += aligned_size;
         }
@@ -343,6 +378,9 @@ SharedPtr<CodeSet> ElfReader::LoadInto(u32 vaddr) {
 
     codeset->entrypoint = base_addr + header->e_entry;
     codeset->memory = std::make_shared<std::vector<u8>>(std::move(program_image));
+    if (map_read_only) {
+        codeset->shared_image = std::move(image);
+    }
 
     LOG_DEBUG(Loader, "Done loading.");
 
@@ -390,16 +428,14 @@ ResultStatus AppLoader_ELF::Load(Kernel::SharedPtr<Kernel::Process>& process) {
     if (!file.IsOpen())
         return ResultStatus::Error;
 
-    // Reset read pointer in case this file has been read before.
-    file.Seek(0, SEEK_SET);
-
-    size_t size = file.GetSize();
-    std::unique_ptr<u8[]> buffer(new u8[size]);
-    if (file.ReadBytes(&buffer[0], size) != size)
+    // The read-only segments stay mapped from the file for as long as the process runs, copy on
+    // write so that the guest can't modify the file
+    auto mapping = std::make_shared<FileUtil::MappedFile>();
+    if (!mapping->Open(filepath, FileUtil::MappedFile::Mode::CopyOnWrite))
         return ResultStatus::Error;
 
-    ElfReader elf_reader(&buffer[0]);
-    SharedPtr<CodeSet> codeset = elf_reader.LoadInto(Memory::PROCESS_IMAGE_VADDR);
+    ElfReader elf_reader(mapping->WritableData());
+    SharedPtr<CodeSet> codeset = elf_reader.LoadInto(Memory::PROCESS_IMAGE_VADDR, mapping);
     codeset->name = filename;
 
     process = Kernel::Process::Create("main");
@@ -16,8 +16,9 @@ namespace Loader {
 /// Loads an ELF/AXF file
 class AppLoader_ELF final : public AppLoader {
 public:
-    AppLoader_ELF(FileUtil::IOFile&& file, std::string filename)
-        : AppLoader(std::move(file)), filename(std::move(filename)) {}
+    AppLoader_ELF(FileUtil::IOFile&& file, std::string filename, std::string filepath)
+        : AppLoader(std::move(file)), filename(std::move(filename)),
+          filepath(std::move(filepath)) {}
 
     /**
      * Returns the type of the file
@@ -34,6 +35,7 @@ public:
 
 private:
     std::string filename;
+    std::string filepath;
 };
 
 } // namespace Loader
@@ -0,0 +1,224 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <lz4.h>
+#include "common/assert.h"
+#include "common/common_funcs.h"
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "common/swap.h"
+#include "core/loader/lazy_segment.h"
+#include "core/memory_setup.h"
+
+namespace Loader {
+
+constexpr u32 CACHE_MAGIC = Common::MakeMagic('Y', 'L', 'Z', 'C');
+constexpr u32 CACHE_VERSION = 1;
+
+/// The header is followed by the end offset of each chunk, and then by the compressed chunks
+struct BlockCacheHeader {
+    u32_le magic;
+    u32_le version;
+    u32_le chunk_size;
+    u32_le size;
+    u32_le num_chunks;
+};
+static_assert(sizeof(BlockCacheHeader) == 0x14, "BlockCacheHeader has incorrect size.");
+
+static u32 GetNumChunks(u32 size) {
+    return (size + BlockCache::CHUNK_SIZE - 1) / BlockCache::CHUNK_SIZE;
+}
+
+bool BlockCache::Read(const std::string& path, u32 segment_size) {
+    FileUtil::IOFile file(path, "rb");
+    if (!file.IsOpen()) {
+        return false;
+    }
+
+    BlockCacheHeader header{};
+    if (file.ReadBytes(&header, sizeof(header)) != sizeof(header) ||
+        header.magic != CACHE_MAGIC || header.version != CACHE_VERSION ||
+        header.chunk_size != CHUNK_SIZE || header.size != segment_size ||
+        header.num_chunks != GetNumChunks(segment_size)) {
+        LOG_WARNING(Loader, "Ignoring outdated segment cache %s", path.c_str());
+        return false;
+    }
+
+    std::vector<u32_le> ends(header.num_chunks);
+    if (file.ReadArray(ends.data(), ends.size()) != ends.size()) {
+        return false;
+    }
+    const u64 data_size = file.GetSize() - file.Tell();
+    chunk_ends.assign(ends.begin(), ends.end());
+    if (!std::is_sorted(chunk_ends.begin(), chunk_ends.end()) ||
+        (!chunk_ends.empty() && chunk_ends.back() != data_size)) {
+        LOG_WARNING(Loader, "Ignoring corrupted segment cache %s", path.c_str());
+        return false;
+    }
+
+    size = segment_size;
+    data.resize(data_size);
+    return file.ReadBytes(data.data(), data.size()) == data.size();
+}
+
+bool BlockCache::Write(const std::string& path, const u8* segment, u32 segment_size) {
+    const u32 num_chunks = GetNumChunks(segment_size);
+    std::vector<u32_le> ends;
+    ends.reserve(num_chunks);
+    std::vector<u8> data;
+
+    for (u32 offset = 0; offset < segment_size; offset += CHUNK_SIZE) {
+        const int chunk_size = static_cast<int>(std::min(CHUNK_SIZE, segment_size - offset));
+        const size_t data_offset = data.size();
+        data.resize(data_offset + LZ4_compressBound(chunk_size));
+        const int compressed_size = LZ4_compress_default(
+            reinterpret_cast<const char*>(segment + offset),
+            reinterpret_cast<char*>(data.data() + data_offset), chunk_size,
+            static_cast<int>(data.size() - data_offset));
+        if (compressed_size <= 0) {
+            return false;
+        }
+        data.resize(data_offset + compressed_size);
+        ends.push_back(static_cast<u32>(data.size()));
+    }
+
+    if (!FileUtil::CreateFullPath(path)) {
+        return false;
+    }
+    FileUtil::IOFile file(path, "wb");
+    const BlockCacheHeader header{CACHE_MAGIC, CACHE_VERSION, CHUNK_SIZE, segment_size,
+                                  num_chunks};
+    file.WriteObject(header);
+    file.WriteArray(ends.data(), ends.size());
+    file.WriteBytes(data.data(), data.size());
+    if (!file.IsGood()) {
+        LOG_ERROR(Loader, "Couldn't write the segment cache %s", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+LazySegment::LazySegment(BlockCache cache_, Memory::PageTable& page_table, VAddr base,
+                         std::shared_ptr<std::vector<u8>> memory_, size_t offset)
+    : cache(std::move(cache_)), page_table(page_table), base(base), memory(std::move(memory_)),
+      offset(offset), is_chunk_populated(cache.chunk_ends.size(), false) {
+    ASSERT(offset + GetMappedSize() <= memory->size());
+}
+
+u64 LazySegment::GetMappedSize() const {
+    return (u64{cache.size} + Memory::PAGE_MASK) & ~u64{Memory::PAGE_MASK};
+}
+
+u8* LazySegment::Populate(VAddr addr) {
+    ASSERT_MSG(IsValidAddress(addr), "Access outside of the lazy segment @ 0x%llx", addr);
+    const u64 segment_offset = addr - base;
+    const size_t chunk = static_cast<size_t>(segment_offset / BlockCache::CHUNK_SIZE);
+    const u32 chunk_offset = static_cast<u32>(chunk * BlockCache::CHUNK_SIZE);
+    u8* const segment = memory->data() + offset;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!is_chunk_populated[chunk]) {
+        const u32 compressed_begin = chunk == 0 ? 0 : cache.chunk_ends[chunk - 1];
+        const u32 chunk_size = std::min(BlockCache::CHUNK_SIZE, cache.size - chunk_offset);
+        const int bytes_uncompressed = LZ4_decompress_safe(
+            reinterpret_cast<const char*>(cache.data.data() + compressed_begin),
+            reinterpret_cast<char*>(segment + chunk_offset),
+            static_cast<int>(cache.chunk_ends[chunk] - compressed_begin),
+            static_cast<int>(chunk_size));
+        if (bytes_uncompressed != static_cast<int>(chunk_size)) {
+            LOG_CRITICAL(Loader, "Segment chunk at 0x%llx decompressed to %d bytes instead of %u",
+                         base + chunk_offset, bytes_uncompressed, chunk_size);
+        }
+        is_chunk_populated[chunk] = true;
+
+        // Later accesses to the chunk go through the page table directly
+        const u64 mapped_size =
+            std::min<u64>(BlockCache::CHUNK_SIZE, GetMappedSize() - chunk_offset);
+        Memory::MapMemoryRegion(page_table, base + chunk_offset, mapped_size,
+                                segment + chunk_offset);
+    }
+    return segment + segment_offset;
+}
+
+bool LazySegment::IsValidAddress(VAddr addr) {
+    return addr >= base && addr - base < GetMappedSize();
+}
+
+template <typename T>
+T LazySegment::Read(VAddr addr) {
+    T value;
+    ReadBlock(addr, &value, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void LazySegment::Write(VAddr addr, T data) {
+    WriteBlock(addr, &data, sizeof(T));
+}
+
+u8 LazySegment::Read8(VAddr addr) {
+    return Read<u8>(addr);
+}
+
+u16 LazySegment::Read16(VAddr addr) {
+    return Read<u16>(addr);
+}
+
+u32 LazySegment::Read32(VAddr addr) {
+    return Read<u32>(addr);
+}
+
+u64 LazySegment::Read64(VAddr addr) {
+    return Read<u64>(addr);
+}
+
+/// Returns the number of bytes from an address to the end of its chunk
+static size_t GetChunkRemaining(VAddr base, VAddr addr) {
+    return BlockCache::CHUNK_SIZE - static_cast<size_t>((addr - base) % BlockCache::CHUNK_SIZE);
+}
+
+bool LazySegment::ReadBlock(VAddr src_addr, void* dest_buffer, size_t size) {
+    u8* dest = static_cast<u8*>(dest_buffer);
+    while (size > 0) {
+        // Accesses may straddle two chunks, each of them is populated separately
+        const size_t copy_amount = std::min(size, GetChunkRemaining(base, src_addr));
+        std::memcpy(dest, Populate(src_addr), copy_amount);
+        dest += copy_amount;
+        src_addr += copy_amount;
+        size -= copy_amount;
+    }
+    return true;
+}
+
+void LazySegment::Write8(VAddr addr, u8 data) {
+    Write<u8>(addr, data);
+}
+
+void LazySegment::Write16(VAddr addr, u16 data) {
+    Write<u16>(addr, data);
+}
+
+void LazySegment::Write32(VAddr addr, u32 data) {
+    Write<u32>(addr, data);
+}
+
+void LazySegment::Write64(VAddr addr, u64 data) {
+    Write<u64>(addr, data);
+}
+
+bool LazySegment::WriteBlock(VAddr dest_addr, const void* src_buffer, size_t size) {
+    const u8* src = static_cast<const u8*>(src_buffer);
+    while (size > 0) {
+        const size_t copy_amount = std::min(size, GetChunkRemaining(base, dest_addr));
+        std::memcpy(Populate(dest_addr), src, copy_amount);
+        src += copy_amount;
+        dest_addr += copy_amount;
+        size -= copy_amount;
+    }
+    return true;
+}
+
+} // namespace Loader
@@ -0,0 +1,98 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "common/common_types.h"
+#include "core/memory.h"
+#include "core/mmio.h"
+
+namespace Loader {
+
+/**
+ * Copy of a segment split in chunks that are compressed independently, so that any of them can be
+ * decompressed without the ones before it. NSO segments are a single LZ4 stream, this is written
+ * to the cache directory the first time a module is loaded.
+ */
+struct BlockCache {
+    /// Size of the uncompressed chunks, the last one may be shorter
+    static constexpr u32 CHUNK_SIZE = 0x10000;
+
+    /// Size of the uncompressed segment
+    u32 size = 0;
+    /// Offset of the end of each compressed chunk in data
+    std::vector<u32> chunk_ends;
+    std::vector<u8> data;
+
+    /**
+     * Reads the cache of a segment.
+     * @returns True on success, false if the file doesn't exist or doesn't match the segment.
+     */
+    bool Read(const std::string& path, u32 segment_size);
+
+    /// Compresses a segment and writes it to a cache file
+    static bool Write(const std::string& path, const u8* segment, u32 segment_size);
+};
+
+/**
+ * Segment whose pages are mapped as special pages and populated from a block cache on their first
+ * access. Each access decompresses the chunk it touches into the memory of the module and maps its
+ * pages as regular memory, so that later accesses no longer go through this handler.
+ */
+class LazySegment final : public Memory::MMIORegion {
+public:
+    /**
+     * @param page_table Page table of the process the segment is loaded into.
+     * @param base Address of the segment.
+     * @param memory Memory of the module, that the pages are mapped to once populated.
+     * @param offset Offset of the segment in the memory.
+     */
+    LazySegment(BlockCache cache, Memory::PageTable& page_table, VAddr base,
+                std::shared_ptr<std::vector<u8>> memory, size_t offset);
+
+    /// Size of the mapped region, rounded up to whole pages
+    u64 GetMappedSize() const;
+
+    bool IsValidAddress(VAddr addr) override;
+
+    u8 Read8(VAddr addr) override;
+    u16 Read16(VAddr addr) override;
+    u32 Read32(VAddr addr) override;
+    u64 Read64(VAddr addr) override;
+
+    bool ReadBlock(VAddr src_addr, void* dest_buffer, size_t size) override;
+
+    void Write8(VAddr addr, u8 data) override;
+    void Write16(VAddr addr, u16 data) override;
+    void Write32(VAddr addr, u32 data) override;
+    void Write64(VAddr addr, u64 data) override;
+
+    bool WriteBlock(VAddr dest_addr, const void* src_buffer, size_t size) override;
+
+private:
+    /// Populates the chunk containing an address and returns the memory at that address
+    u8* Populate(VAddr addr);
+
+    template <typename T>
+    T Read(VAddr addr);
+
+    template <typename T>
+    void Write(VAddr addr, T data);
+
+    BlockCache cache;
+    Memory::PageTable& page_table;
+    VAddr base;
+    std::shared_ptr<std::vector<u8>> memory;
+    size_t offset;
+
+    /// Protects the populated chunks, as every emulated core may access the segment
+    std::mutex mutex;
+    std::vector<bool> is_chunk_populated;
+};
+
+} // namespace Loader
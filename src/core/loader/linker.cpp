@@ -2,12 +2,16 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <cstring>
+#include <string>
 #include <vector>
 
 #include "common/common_funcs.h"
 #include "common/logging/log.h"
 #include "common/swap.h"
 #include "core/loader/linker.h"
+#include "core/loader/symbols.h"
 #include "core/memory.h"
 
 namespace Loader {
@@ -17,12 +21,14 @@ enum class RelocationType : u32 { ABS64 = 257, GLOB_DAT = 1025, JUMP_SLOT = 1026
 enum DynamicType : u32 {
     DT_NULL = 0,
     DT_PLTRELSZ = 2,
+    DT_HASH = 4,
     DT_STRTAB = 5,
     DT_SYMTAB = 6,
     DT_RELA = 7,
     DT_RELASZ = 8,
     DT_STRSZ = 10,
     DT_JMPREL = 23,
+    DT_GNU_HASH = 0x6ffffef5,
 };
 
 struct Elf64_Rela {
@@ -39,48 +45,272 @@ struct Elf64_Dyn {
 };
 static_assert(sizeof(Elf64_Dyn) == 0x10, "Elf64_Dyn has incorrect size.");
 
+/// Symbol type of a function, in the low bits of Elf64_Sym::info
+constexpr u8 STT_FUNC = 2;
+
 struct Elf64_Sym {
     u32_le name;
-    INSERT_PADDING_BYTES(0x2);
+    u8 info;
+    u8 other;
     u16_le shndx;
     u64_le value;
     u64_le size;
 };
 static_assert(sizeof(Elf64_Sym) == 0x18, "Elf64_Sym has incorrect size.");
 
-void Linker::WriteRelocations(std::vector<u8>& program_image, const std::vector<Symbol>& symbols,
-                              u64 relocation_offset, u64 size, bool is_jump_relocation,
-                              VAddr load_base) {
-    for (u64 i = 0; i < size; i += sizeof(Elf64_Rela)) {
-        Elf64_Rela rela;
-        std::memcpy(&rela, &program_image[relocation_offset + i], sizeof(Elf64_Rela));
+/// Entries of the dynamic section that the linker uses, zero when absent
+struct DynamicInfo {
+    u64 strtab = 0;
+    u64 strsz = 0;
+    u64 symtab = 0;
+    u64 hash = 0;
+    u64 gnu_hash = 0;
+    u64 rela = 0;
+    u64 relasz = 0;
+    u64 jmprel = 0;
+    u64 pltrelsz = 0;
+};
 
-        const Symbol& symbol = symbols[rela.symbol];
-        switch (rela.type) {
-        case RelocationType::RELATIVE: {
-            const u64 value = load_base + rela.addend;
-            if (!symbol.name.empty()) {
-                exports[symbol.name] = value;
-            }
-            std::memcpy(&program_image[rela.offset], &value, sizeof(u64));
+static DynamicInfo ReadDynamicSection(const std::vector<u8>& program_image, u64 offset) {
+    DynamicInfo info;
+    while (offset + sizeof(Elf64_Dyn) <= program_image.size()) {
+        Elf64_Dyn dyn;
+        std::memcpy(&dyn, &program_image[offset], sizeof(Elf64_Dyn));
+        offset += sizeof(Elf64_Dyn);
+
+        switch (dyn.tag) {
+        case DT_NULL:
+            return info;
+        case DT_STRTAB:
+            info.strtab = dyn.value;
+            break;
+        case DT_STRSZ:
+            info.strsz = dyn.value;
+            break;
+        case DT_SYMTAB:
+            info.symtab = dyn.value;
+            break;
+        case DT_HASH:
+            info.hash = dyn.value;
+            break;
+        case DT_GNU_HASH:
+            info.gnu_hash = dyn.value;
+            break;
+        case DT_RELA:
+            info.rela = dyn.value;
             break;
+        case DT_RELASZ:
+            info.relasz = dyn.value;
+            break;
+        case DT_JMPREL:
+            info.jmprel = dyn.value;
+            break;
+        case DT_PLTRELSZ:
+            info.pltrelsz = dyn.value;
+            break;
+        }
+    }
+    return info;
+}
+
+/**
+ * Copies an array out of the program image.
+ * @returns True on success, false if the array is past the end of the image.
+ */
+template <typename T>
+static bool ReadArray(const std::vector<u8>& program_image, u64 offset, u64 count,
+                      std::vector<T>& out) {
+    if (offset > program_image.size() || count > (program_image.size() - offset) / sizeof(T)) {
+        return false;
+    }
+    out.resize(static_cast<size_t>(count));
+    std::memcpy(out.data(), &program_image[offset], out.size() * sizeof(T));
+    return true;
+}
+
+static u32 GnuHash(std::string_view name) {
+    u32 hash = 5381;
+    for (const char c : name) {
+        hash = hash * 33 + static_cast<u8>(c);
+    }
+    return hash;
+}
+
+static u32 ElfHash(std::string_view name) {
+    u32 hash = 0;
+    for (const char c : name) {
+        hash = (hash << 4) + static_cast<u8>(c);
+        const u32 high = hash & 0xf0000000;
+        hash ^= high >> 24;
+        hash &= ~high;
+    }
+    return hash;
+}
+
+boost::optional<u64> Linker::Module::FindGnuHashExport(std::string_view name) const {
+    // Layout: nbuckets, symoffset, bloom_size, bloom_shift, [bloom], buckets, chains
+    const u32 num_buckets = hash_table[0];
+    const u32 symbol_offset = hash_table[1];
+    const u32 bloom_shift = hash_table[3];
+    const u32* const buckets = &hash_table[4];
+    const u32* const chains = buckets + num_buckets;
+    const size_t num_chains = hash_table.size() - 4 - num_buckets;
+
+    const u32 hash = GnuHash(name);
+    const u64 bloom_word = bloom_filter[(hash / 64) % bloom_filter.size()];
+    const u64 bloom_mask = (u64{1} << (hash % 64)) | (u64{1} << ((hash >> bloom_shift) % 64));
+    if ((bloom_word & bloom_mask) != bloom_mask) {
+        return boost::none;
+    }
+
+    for (size_t index = buckets[hash % num_buckets];
+         index >= symbol_offset && index - symbol_offset < num_chains && index < symbols.size();
+         ++index) {
+        const u32 chain_hash = chains[index - symbol_offset];
+        const Symbol& symbol = symbols[index];
+        if ((chain_hash | 1) == (hash | 1) && symbol.value && symbol.name == name) {
+            return symbol.value;
+        }
+        // The lowest bit marks the end of the chain of a bucket
+        if (chain_hash & 1) {
+            break;
+        }
+    }
+    return boost::none;
+}
+
+boost::optional<u64> Linker::Module::FindElfHashExport(std::string_view name) const {
+    // Layout: nbucket, nchain, buckets, chains
+    const u32 num_buckets = hash_table[0];
+    const u32* const buckets = &hash_table[2];
+    const u32* const chains = buckets + num_buckets;
+    const size_t num_chains = hash_table.size() - 2 - num_buckets;
+
+    // Index zero is the undefined symbol, it terminates the chains. The walk is bounded in case
+    // the chains of a corrupted table form a cycle.
+    size_t steps = 0;
+    for (size_t index = buckets[ElfHash(name) % num_buckets];
+         index != 0 && index < num_chains && index < symbols.size() && steps < num_chains;
+         index = chains[index], ++steps) {
+        const Symbol& symbol = symbols[index];
+        if (symbol.value && symbol.name == name) {
+            return symbol.value;
+        }
+    }
+    return boost::none;
+}
+
+boost::optional<u64> Linker::Module::FindExport(std::string_view name) const {
+    if (hash_table.empty()) {
+        const auto iter = exports.find(name);
+        if (iter == exports.end()) {
+            return boost::none;
+        }
+        return iter->second;
+    }
+    return is_gnu_hash ? FindGnuHashExport(name) : FindElfHashExport(name);
+}
+
+/// Copies the DT_GNU_HASH or DT_HASH section of a module, preferring the former
+static void ReadHashTable(const std::vector<u8>& program_image, const DynamicInfo& dynamic,
+                          std::vector<u32>& hash_table, std::vector<u64>& bloom_filter,
+                          bool& is_gnu_hash) {
+    std::vector<u32> header;
+    if (dynamic.gnu_hash && ReadArray(program_image, dynamic.gnu_hash, 4, header) &&
+        header[0] != 0 && header[2] != 0) {
+        const u32 num_buckets = header[0];
+        const u64 bloom_offset = dynamic.gnu_hash + 4 * sizeof(u32);
+        const u64 buckets_offset = bloom_offset + u64{header[2]} * sizeof(u64);
+        std::vector<u32> buckets;
+        if (ReadArray(program_image, bloom_offset, header[2], bloom_filter) &&
+            ReadArray(program_image, buckets_offset, num_buckets, buckets)) {
+            // The section doesn't store the length of the chains, they run to the last symbol
+            // of the last bucket, which is the one with the highest index
+            const u64 chains_offset = buckets_offset + u64{num_buckets} * sizeof(u32);
+            const u64 max_chains =
+                chains_offset < program_image.size()
+                    ? (program_image.size() - chains_offset) / sizeof(u32)
+                    : 0;
+            const u32 last_bucket = *std::max_element(buckets.begin(), buckets.end());
+            u64 num_chains = 0;
+            if (last_bucket >= header[1]) {
+                for (u64 index = last_bucket - header[1]; index < max_chains; ++index) {
+                    u32 chain_hash;
+                    std::memcpy(&chain_hash, &program_image[chains_offset + index * sizeof(u32)],
+                                sizeof(u32));
+                    if (chain_hash & 1) {
+                        num_chains = index + 1;
+                        break;
+                    }
+                }
+            }
+
+            std::vector<u32> chains;
+            if (ReadArray(program_image, chains_offset, num_chains, chains)) {
+                hash_table = std::move(header);
+                hash_table.insert(hash_table.end(), buckets.begin(), buckets.end());
+                hash_table.insert(hash_table.end(), chains.begin(), chains.end());
+                is_gnu_hash = true;
+                return;
+            }
+        }
+        bloom_filter.clear();
+    }
+
+    if (dynamic.hash && ReadArray(program_image, dynamic.hash, 2, header) && header[0] != 0) {
+        if (ReadArray(program_image, dynamic.hash, 2 + u64{header[0]} + header[1], hash_table)) {
+            is_gnu_hash = false;
+            return;
+        }
+        hash_table.clear();
+    }
+}
+
+void Linker::WriteRelocations(std::vector<u8>& program_image, const Module& module,
+                              u64 relocation_offset, u64 size, VAddr load_base) {
+    // Copy the whole table at once, instead of each entry separately
+    std::vector<Elf64_Rela> relocations;
+    if (!ReadArray(program_image, relocation_offset, size / sizeof(Elf64_Rela), relocations)) {
+        LOG_CRITICAL(Loader, "Relocation table at 0x%llx is past the end of the image",
+                     relocation_offset);
+        return;
+    }
+
+    const auto write = [&program_image](u64 offset, u64 value) {
+        if (offset + sizeof(u64) > program_image.size()) {
+            LOG_ERROR(Loader, "Relocation at 0x%llx is past the end of the image", offset);
+            return;
         }
+        std::memcpy(&program_image[offset], &value, sizeof(u64));
+    };
+
+    for (const Elf64_Rela& rela : relocations) {
+        // Relative relocations are the bulk of them, and don't refer to a symbol
+        if (rela.type == RelocationType::RELATIVE) {
+            write(rela.offset, load_base + rela.addend);
+            continue;
+        }
+
+        if (rela.symbol >= module.symbols.size()) {
+            LOG_ERROR(Loader, "Relocation refers to unknown symbol %u",
+                      static_cast<u32>(rela.symbol));
+            continue;
+        }
+        const Symbol& symbol = module.symbols[rela.symbol];
+        switch (rela.type) {
         case RelocationType::JUMP_SLOT:
         case RelocationType::GLOB_DAT:
             if (!symbol.value) {
-                imports[symbol.name] = {rela.offset + load_base, 0};
+                imports.push_back({symbol.name, rela.offset + load_base, 0});
             } else {
-                exports[symbol.name] = symbol.value;
-                std::memcpy(&program_image[rela.offset], &symbol.value, sizeof(u64));
+                write(rela.offset, symbol.value);
             }
             break;
         case RelocationType::ABS64:
             if (!symbol.value) {
-                imports[symbol.name] = {rela.offset + load_base, rela.addend};
+                imports.push_back({symbol.name, rela.offset + load_base, rela.addend});
             } else {
-                const u64 value = symbol.value + rela.addend;
-                exports[symbol.name] = value;
-                std::memcpy(&program_image[rela.offset], &value, sizeof(u64));
+                write(rela.offset, symbol.value + rela.addend);
             }
             break;
         default:
@@ -91,57 +321,100 @@ void Linker::WriteRelocations(std::vector<u8>& program_image, const std::vector<
 }
 
 void Linker::Relocate(std::vector<u8>& program_image, u32 dynamic_section_offset, VAddr load_base) {
-    std::map<u64, u64> dynamic;
-    while (dynamic_section_offset < program_image.size()) {
-        Elf64_Dyn dyn;
-        std::memcpy(&dyn, &program_image[dynamic_section_offset], sizeof(Elf64_Dyn));
-        dynamic_section_offset += sizeof(Elf64_Dyn);
-
-        if (dyn.tag == DT_NULL) {
-            break;
-        }
-        dynamic[dyn.tag] = dyn.value;
+    const DynamicInfo dynamic = ReadDynamicSection(program_image, dynamic_section_offset);
+    if (dynamic.strtab > program_image.size() ||
+        dynamic.strsz > program_image.size() - dynamic.strtab) {
+        LOG_CRITICAL(Loader, "Dynamic string table is past the end of the image");
+        return;
     }
 
-    u64 offset = dynamic[DT_SYMTAB];
-    std::vector<Symbol> symbols;
-    while (offset < program_image.size()) {
+    // The names point into a copy of the string table, which is terminated in case the last
+    // string isn't.
+    Module module;
+    module.string_table = std::make_unique<char[]>(static_cast<size_t>(dynamic.strsz) + 1);
+    std::memcpy(module.string_table.get(), &program_image[dynamic.strtab],
+                static_cast<size_t>(dynamic.strsz));
+    module.string_table[static_cast<size_t>(dynamic.strsz)] = '\0';
+
+    u64 offset = dynamic.symtab;
+    while (offset + sizeof(Elf64_Sym) <= program_image.size()) {
         Elf64_Sym sym;
         std::memcpy(&sym, &program_image[offset], sizeof(Elf64_Sym));
         offset += sizeof(Elf64_Sym);
 
-        if (sym.name >= dynamic[DT_STRSZ]) {
+        if (sym.name >= dynamic.strsz) {
             break;
         }
 
-        std::string name = reinterpret_cast<char*>(&program_image[dynamic[DT_STRTAB] + sym.name]);
-        if (sym.value) {
-            exports[name] = load_base + sym.value;
-            symbols.emplace_back(std::move(name), load_base + sym.value);
-        } else {
-            symbols.emplace_back(std::move(name), 0);
+        const std::string_view name = module.string_table.get() + sym.name;
+        module.symbols.push_back({name, sym.value ? load_base + sym.value : 0});
+    }
+
+    ReadHashTable(program_image, dynamic, module.hash_table, module.bloom_filter,
+                  module.is_gnu_hash);
+    if (module.hash_table.empty()) {
+        module.exports.reserve(module.symbols.size());
+        for (const Symbol& symbol : module.symbols) {
+            if (symbol.value && !symbol.name.empty()) {
+                module.exports[symbol.name] = symbol.value;
+            }
         }
     }
 
-    if (dynamic.find(DT_RELA) != dynamic.end()) {
-        WriteRelocations(program_image, symbols, dynamic[DT_RELA], dynamic[DT_RELASZ], false,
-                         load_base);
+    if (dynamic.rela) {
+        WriteRelocations(program_image, module, dynamic.rela, dynamic.relasz, load_base);
     }
+    if (dynamic.jmprel) {
+        WriteRelocations(program_image, module, dynamic.jmprel, dynamic.pltrelsz, load_base);
+    }
+
+    modules.push_back(std::move(module));
+}
 
-    if (dynamic.find(DT_JMPREL) != dynamic.end()) {
-        WriteRelocations(program_image, symbols, dynamic[DT_JMPREL], dynamic[DT_PLTRELSZ], true,
-                         load_base);
+void Linker::AddFunctionSymbols(const std::vector<u8>& program_image, u32 dynamic_section_offset,
+                                VAddr load_base) {
+    const DynamicInfo dynamic = ReadDynamicSection(program_image, dynamic_section_offset);
+    if (dynamic.strtab > program_image.size() ||
+        dynamic.strsz > program_image.size() - dynamic.strtab) {
+        return;
+    }
+    const char* const string_table =
+        reinterpret_cast<const char*>(&program_image[static_cast<size_t>(dynamic.strtab)]);
+
+    // Same as when relocating, the symbol table ends where the entries stop making sense
+    u64 offset = dynamic.symtab;
+    while (offset + sizeof(Elf64_Sym) <= program_image.size()) {
+        Elf64_Sym sym;
+        std::memcpy(&sym, &program_image[offset], sizeof(Elf64_Sym));
+        offset += sizeof(Elf64_Sym);
+
+        if (sym.name >= dynamic.strsz) {
+            break;
+        }
+        if ((sym.info & 0xf) != STT_FUNC || sym.value == 0) {
+            continue;
+        }
+
+        std::string_view name(string_table + sym.name, dynamic.strsz - sym.name);
+        name = name.substr(0, name.find('\0'));
+        Symbols::AddFunction(std::string(name), load_base + sym.value, sym.size);
     }
 }
 
 void Linker::ResolveImports() {
-    // Resolve imports
-    for (const auto& import : imports) {
-        const auto& search = exports.find(import.first);
-        if (search != exports.end()) {
-            Memory::Write64(import.second.ea, search->second + import.second.addend);
+    // Later modules take precedence, so they are searched first. The "main" module is the last
+    // one to be loaded.
+    for (const Import& import : imports) {
+        boost::optional<u64> value;
+        for (auto module = modules.rbegin(); module != modules.rend() && !value; ++module) {
+            value = module->FindExport(import.name);
+        }
+
+        if (value) {
+            Memory::Write64(import.ea, *value + import.addend);
         } else {
-            LOG_ERROR(Loader, "Unresolved import: %s", import.first.c_str());
+            LOG_ERROR(Loader, "Unresolved import: %.*s", static_cast<int>(import.name.size()),
+                      import.name.data());
         }
     }
 }
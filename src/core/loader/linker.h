@@ -4,34 +4,70 @@
 
 #pragma once
 
-#include <map>
-#include <string>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <boost/optional.hpp>
 #include "common/common_types.h"
 
 namespace Loader {
 
 class Linker {
 protected:
+    void Relocate(std::vector<u8>& program_image, u32 dynamic_section_offset, VAddr load_base);
+
+    void ResolveImports();
+
+    /**
+     * Adds the functions of a module's dynamic symbol table to the symbols of the loaded code.
+     * Unlike relocating, this doesn't modify the image, so it also works for modules that relocate
+     * themselves.
+     */
+    static void AddFunctionSymbols(const std::vector<u8>& program_image,
+                                   u32 dynamic_section_offset, VAddr load_base);
+
+private:
     struct Symbol {
-        Symbol(std::string&& name, u64 value) : name(std::move(name)), value(value) {}
-        std::string name;
+        std::string_view name;
+        /// Address of the symbol, or zero if it is imported
         u64 value;
     };
 
     struct Import {
+        std::string_view name;
         VAddr ea;
         s64 addend;
     };
 
-    void WriteRelocations(std::vector<u8>& program_image, const std::vector<Symbol>& symbols,
-                          u64 relocation_offset, u64 size, bool is_jump_relocation,
-                          VAddr load_base);
-    void Relocate(std::vector<u8>& program_image, u32 dynamic_section_offset, VAddr load_base);
+    /// Dynamic symbols of a relocated module, looked up by name when resolving imports
+    struct Module {
+        /// Copy of the string table, that the names of the symbols and imports point into
+        std::unique_ptr<char[]> string_table;
+        std::vector<Symbol> symbols;
 
-    void ResolveImports();
+        /// Words of the DT_GNU_HASH or DT_HASH section, if the module has one
+        std::vector<u32> hash_table;
+        /// Bloom filter of the DT_GNU_HASH section
+        std::vector<u64> bloom_filter;
+        bool is_gnu_hash = false;
+        /// Exports of a module without a hash section
+        std::unordered_map<std::string_view, u64> exports;
+
+        boost::optional<u64> FindExport(std::string_view name) const;
+
+    private:
+        boost::optional<u64> FindGnuHashExport(std::string_view name) const;
+        boost::optional<u64> FindElfHashExport(std::string_view name) const;
+    };
+
+    void WriteRelocations(std::vector<u8>& program_image, const Module& module,
+                          u64 relocation_offset, u64 size, VAddr load_base);
 
-    std::map<std::string, Import> imports;
-    std::map<std::string, VAddr> exports;
+    /// Relocated modules, in load order
+    std::vector<Module> modules;
+    /// Addresses to patch with symbols of other modules once all modules are loaded
+    std::vector<Import> imports;
 };
 
 } // namespace Loader
@@ -2,14 +2,18 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <array>
+#include <cstring>
 #include <vector>
 
 #include "common/common_funcs.h"
 #include "common/logging/log.h"
+#include "common/string_util.h"
 #include "common/swap.h"
 #include "core/hle/kernel/process.h"
 #include "core/hle/kernel/resource_limit.h"
 #include "core/loader/nro.h"
+#include "core/loader/symbols.h"
 #include "core/memory.h"
 
 namespace Loader {
@@ -45,6 +49,30 @@ struct ModHeader {
 };
 static_assert(sizeof(ModHeader) == 0x1c, "ModHeader has incorrect size.");
 
+struct AssetSection {
+    u64_le offset;
+    u64_le size;
+};
+static_assert(sizeof(AssetSection) == 0x10, "AssetSection has incorrect size.");
+
+/// Header of the assets following the NRO image, the offsets of its sections are relative to it
+struct AssetHeader {
+    u32_le magic;
+    u32_le format_version;
+    AssetSection icon;
+    AssetSection nacp;
+    AssetSection romfs;
+};
+static_assert(sizeof(AssetHeader) == 0x38, "AssetHeader has incorrect size.");
+
+struct NacpLanguageEntry {
+    std::array<char, 0x200> application_name;
+    std::array<char, 0x100> developer_name;
+};
+static_assert(sizeof(NacpLanguageEntry) == 0x300, "NacpLanguageEntry has incorrect size.");
+
+constexpr size_t NACP_LANGUAGE_COUNT = 16;
+
 FileType AppLoader_NRO::IdentifyType(FileUtil::IOFile& file) {
     // Read NSO header
     NroHeader nro_header{};
@@ -62,42 +90,32 @@ static constexpr u32 PageAlignSize(u32 size) {
     return (size + Memory::PAGE_MASK) & ~Memory::PAGE_MASK;
 }
 
-static std::vector<u8> ReadSegment(FileUtil::IOFile& file, const NroSegmentHeader& header) {
-    std::vector<u8> data;
-    data.resize(header.size);
-
-    file.Seek(header.offset + sizeof(NroHeader), SEEK_SET);
-    size_t bytes_read{file.ReadBytes(data.data(), header.size)};
-    if (header.size != PageAlignSize(static_cast<u32>(bytes_read))) {
-        LOG_CRITICAL(Loader, "Failed to read NRO segment bytes", header.size);
-        return {};
-    }
-
-    return data;
-}
-
 bool AppLoader_NRO::LoadNro(const std::string& path, VAddr load_base) {
-    FileUtil::IOFile file(path, "rb");
-    if (!file.IsOpen()) {
+    FileUtil::MappedFile file;
+    if (!file.Open(path)) {
         return {};
     }
 
     // Read NSO header
     NroHeader nro_header{};
-    file.Seek(0, SEEK_SET);
-    if (sizeof(NroHeader) != file.ReadBytes(&nro_header, sizeof(NroHeader))) {
+    if (file.Size() < sizeof(NroHeader)) {
         return {};
     }
+    std::memcpy(&nro_header, file.Data(), sizeof(NroHeader));
     if (nro_header.magic != Common::MakeMagic('N', 'R', 'O', '0')) {
         return {};
     }
+    if (nro_header.file_size > file.Size()) {
+        LOG_CRITICAL(Loader, "NRO %s is smaller than its header says", path.c_str());
+        return {};
+    }
 
-    // Build program image
+    // Build program image, copied straight from the mapping
     Kernel::SharedPtr<Kernel::CodeSet> codeset = Kernel::CodeSet::Create("", 0);
     std::vector<u8> program_image;
     program_image.resize(PageAlignSize(nro_header.file_size + nro_header.bss_size));
-    file.Seek(0, SEEK_SET);
-    file.ReadBytes(program_image.data(), nro_header.file_size);
+    file.Advise(FileUtil::MappedFile::AccessHint::Sequential, 0, nro_header.file_size);
+    std::memcpy(program_image.data(), file.Data(), nro_header.file_size);
 
     for (int i = 0; i < nro_header.segments.size(); ++i) {
         codeset->segments[i].addr = nro_header.segments[i].offset;
@@ -123,7 +141,11 @@ bool AppLoader_NRO::LoadNro(const std::string& path, VAddr load_base) {
     if (has_mod_header) {
         Relocate(program_image, nro_header.module_header_offset + mod_header.dynamic_offset,
                  load_base);
+        AddFunctionSymbols(program_image,
+                           nro_header.module_header_offset + mod_header.dynamic_offset, load_base);
     }
+    Symbols::AddModule(path.substr(path.find_last_of("/\\") + 1), load_base,
+                       program_image.size());
 
     // Load codeset for current process
     codeset->name = path;
@@ -133,6 +155,113 @@ bool AppLoader_NRO::LoadNro(const std::string& path, VAddr load_base) {
     return true;
 }
 
+ResultStatus AppLoader_NRO::FindAsset(Asset asset, u64& offset, u64& size) {
+    if (!file.IsOpen()) {
+        return ResultStatus::Error;
+    }
+
+    // The assets start where the image ends
+    NroHeader nro_header{};
+    file.Seek(0, SEEK_SET);
+    if (sizeof(NroHeader) != file.ReadBytes(&nro_header, sizeof(NroHeader))) {
+        return ResultStatus::ErrorInvalidFormat;
+    }
+    const u64 asset_base = nro_header.file_size;
+    const u64 file_size = file.GetSize();
+
+    AssetHeader asset_header{};
+    file.Seek(asset_base, SEEK_SET);
+    if (file_size < asset_base + sizeof(AssetHeader) ||
+        sizeof(AssetHeader) != file.ReadBytes(&asset_header, sizeof(AssetHeader)) ||
+        asset_header.magic != Common::MakeMagic('A', 'S', 'E', 'T')) {
+        return ResultStatus::ErrorNotUsed;
+    }
+    if (asset_header.format_version != 0) {
+        LOG_ERROR(Loader, "Unsupported NRO asset format version %u",
+                  static_cast<u32>(asset_header.format_version));
+        return ResultStatus::ErrorInvalidFormat;
+    }
+
+    const std::array<AssetSection, 3> sections{
+        {asset_header.icon, asset_header.nacp, asset_header.romfs}};
+    const AssetSection& section = sections[static_cast<size_t>(asset)];
+    if (section.size == 0) {
+        return ResultStatus::ErrorNotUsed;
+    }
+    if (section.offset > file_size - asset_base ||
+        section.size > file_size - asset_base - section.offset) {
+        LOG_ERROR(Loader, "NRO asset %zu lies outside of the file", static_cast<size_t>(asset));
+        return ResultStatus::ErrorInvalidFormat;
+    }
+
+    offset = asset_base + section.offset;
+    size = section.size;
+    return ResultStatus::Success;
+}
+
+ResultStatus AppLoader_NRO::ReadAsset(Asset asset, std::vector<u8>& buffer) {
+    u64 offset = 0;
+    u64 size = 0;
+    const ResultStatus result = FindAsset(asset, offset, size);
+    if (result != ResultStatus::Success) {
+        return result;
+    }
+
+    buffer.resize(static_cast<size_t>(size));
+    file.Seek(offset, SEEK_SET);
+    if (file.ReadBytes(buffer.data(), buffer.size()) != buffer.size()) {
+        buffer.clear();
+        return ResultStatus::Error;
+    }
+    return ResultStatus::Success;
+}
+
+ResultStatus AppLoader_NRO::ReadIcon(std::vector<u8>& buffer) {
+    return ReadAsset(Asset::Icon, buffer);
+}
+
+ResultStatus AppLoader_NRO::ReadRomFS(std::shared_ptr<FileUtil::IOFile>& romfs_file, u64& offset,
+                                      u64& size) {
+    const ResultStatus result = FindAsset(Asset::RomFS, offset, size);
+    if (result != ResultStatus::Success) {
+        return result;
+    }
+
+    // The RomFS isn't read here. Its own handle of the file is read through the block cache by the
+    // RomFS archive, only the parts the application accesses are ever read.
+    romfs_file = std::make_shared<FileUtil::IOFile>(filepath, "rb");
+    if (!romfs_file->IsOpen()) {
+        romfs_file = nullptr;
+        return ResultStatus::Error;
+    }
+    LOG_DEBUG(Loader, "RomFS offset: 0x%llx, size: 0x%llx", static_cast<unsigned long long>(offset),
+              static_cast<unsigned long long>(size));
+    return ResultStatus::Success;
+}
+
+ResultStatus AppLoader_NRO::ReadTitle(std::string& title) {
+    std::vector<u8> nacp;
+    const ResultStatus result = ReadAsset(Asset::Nacp, nacp);
+    if (result != ResultStatus::Success) {
+        return result;
+    }
+
+    // The first language that has a name, American English comes first
+    for (size_t language = 0; language < NACP_LANGUAGE_COUNT; ++language) {
+        NacpLanguageEntry entry;
+        if (nacp.size() < (language + 1) * sizeof(entry)) {
+            break;
+        }
+        std::memcpy(&entry, nacp.data() + language * sizeof(entry), sizeof(entry));
+        title = Common::StringFromFixedZeroTerminatedBuffer(entry.application_name.data(),
+                                                            entry.application_name.size());
+        if (!title.empty()) {
+            return ResultStatus::Success;
+        }
+    }
+    return ResultStatus::ErrorNotUsed;
+}
+
 ResultStatus AppLoader_NRO::Load(Kernel::SharedPtr<Kernel::Process>& process) {
     if (is_loaded) {
         return ResultStatus::ErrorAlreadyLoaded;
@@ -5,7 +5,9 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 #include "common/common_types.h"
 #include "common/file_util.h"
 #include "core/hle/kernel/kernel.h"
@@ -33,9 +35,29 @@ public:
 
     ResultStatus Load(Kernel::SharedPtr<Kernel::Process>& process) override;
 
+    ResultStatus ReadIcon(std::vector<u8>& buffer) override;
+
+    /// Returns the RomFS appended to the NRO, which is read from the file as it is accessed
+    ResultStatus ReadRomFS(std::shared_ptr<FileUtil::IOFile>& romfs_file, u64& offset,
+                           u64& size) override;
+
+    ResultStatus ReadTitle(std::string& title) override;
+
 private:
+    /// Sections of the assets homebrew tools append to an NRO
+    enum class Asset { Icon, Nacp, RomFS };
+
     bool LoadNro(const std::string& path, VAddr load_base);
 
+    /**
+     * Finds an asset in the file.
+     * @returns ErrorNotUsed if the NRO doesn't have it
+     */
+    ResultStatus FindAsset(Asset asset, u64& offset, u64& size);
+
+    /// Reads a small asset whole, the RomFS is only ever read through ReadRomFS
+    ResultStatus ReadAsset(Asset asset, std::vector<u8>& buffer);
+
     std::string filepath;
 };
 
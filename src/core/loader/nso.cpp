@@ -2,16 +2,29 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <memory>
 #include <vector>
+#include <boost/optional.hpp>
 #include <lz4.h>
 
 #include "common/common_funcs.h"
+#include "common/common_paths.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
+#include "common/string_util.h"
 #include "common/swap.h"
 #include "core/hle/kernel/process.h"
 #include "core/hle/kernel/resource_limit.h"
+#include "core/loader/lazy_segment.h"
 #include "core/loader/nso.h"
+#include "core/loader/symbols.h"
 #include "core/memory.h"
+#include "core/memory_setup.h"
+#include "core/settings.h"
 
 namespace Loader {
 
@@ -30,8 +43,7 @@ struct NsoHeader {
     u32_le magic;
     INSERT_PADDING_BYTES(0xc);
     std::array<NsoSegmentHeader, 3> segments; // Text, RoData, Data (in that order)
-    u32_le bss_size;
-    INSERT_PADDING_BYTES(0x1c);
+    std::array<u8, 0x20> build_id;
     std::array<u32_le, 3> segments_compressed_size;
 };
 static_assert(sizeof(NsoHeader) == 0x6c, "NsoHeader has incorrect size.");
@@ -61,60 +73,193 @@ FileType AppLoader_NSO::IdentifyType(FileUtil::IOFile& file) {
     return FileType::Error;
 }
 
-static std::vector<u8> ReadSegment(FileUtil::IOFile& file, const NsoSegmentHeader& header,
-                                   int compressed_size) {
-    std::vector<u8> compressed_data;
-    compressed_data.resize(compressed_size);
-
-    file.Seek(header.offset, SEEK_SET);
-    if (compressed_size != file.ReadBytes(compressed_data.data(), compressed_size)) {
-        LOG_CRITICAL(Loader, "Failed to read %d NSO LZ4 compressed bytes", compressed_size);
-        return {};
+/**
+ * Decompresses a segment into its place in the program image.
+ * @returns True on success, false if the data is corrupted.
+ */
+static bool DecompressSegment(const u8* compressed_data, u32 compressed_size, u8* dest,
+                              u32 size) {
+    const int bytes_uncompressed = LZ4_decompress_safe(
+        reinterpret_cast<const char*>(compressed_data), reinterpret_cast<char*>(dest),
+        static_cast<int>(compressed_size), static_cast<int>(size));
+    if (bytes_uncompressed != static_cast<int>(size)) {
+        LOG_CRITICAL(Loader, "NSO segment decompressed to %d bytes instead of %u",
+                     bytes_uncompressed, size);
+        return false;
     }
+    return true;
+}
 
-    std::vector<u8> uncompressed_data;
-    uncompressed_data.resize(header.size);
-    const int bytes_uncompressed = LZ4_decompress_safe(
-        reinterpret_cast<const char*>(compressed_data.data()),
-        reinterpret_cast<char*>(uncompressed_data.data()), compressed_size, header.size);
+static constexpr u32 PageAlignSize(u32 size) {
+    return (size + Memory::PAGE_MASK) & ~Memory::PAGE_MASK;
+}
 
-    ASSERT_MSG(bytes_uncompressed == header.size && bytes_uncompressed == uncompressed_data.size(),
-               "%d != %d != %d", bytes_uncompressed, header.size, uncompressed_data.size());
+/// Smallest .rodata segment that is loaded on demand in lazy loading mode
+constexpr u32 LAZY_SEGMENT_MIN_SIZE = 0x100000;
 
-    return uncompressed_data;
+/// Contents of an NSO file, decompressed but not yet loaded at an address
+struct NsoImage {
+    std::string path;
+    NsoHeader header;
+    std::vector<u8> program_image;
+    /// Cache the .rodata segment is decompressed from on demand, it isn't in the image when set
+    std::unique_ptr<BlockCache> rodata_cache;
+};
+
+static std::string GetRodataCachePath(const NsoHeader& header) {
+    return FileUtil::GetUserPath(D_CACHE_IDX) + "segments" DIR_SEP +
+           Common::ArrayToString(header.build_id.data(), header.build_id.size(), 0, false) +
+           ".rodata";
 }
 
-static constexpr u32 PageAlignSize(u32 size) {
-    return (size + Memory::PAGE_MASK) & ~Memory::PAGE_MASK;
+/**
+ * Moves the code and rodata segments at the start of a program image into an image in the cache
+ * directory named after the hash of their contents, and maps it copy-on-write. Every instance of
+ * the module running on the host maps the same file, so they share the pages nobody wrote to.
+ * @returns The mapping of the image, the program image then only holds what follows it. Returns
+ *          nullptr if no image could be used, leaving the program image untouched.
+ */
+static std::shared_ptr<FileUtil::MappedFile> ShareReadOnlySegments(std::vector<u8>& program_image,
+                                                                   u32 shared_size) {
+    const u64 hash = Common::ComputeHash64(program_image.data(), shared_size);
+    const std::string path = FileUtil::GetUserPath(D_CACHE_IDX) + "modules" DIR_SEP +
+                             Common::StringFromFormat("%016llx.image", hash);
+
+    if (!FileUtil::Exists(path) || FileUtil::GetSize(path) != shared_size) {
+        // Written under a unique name first, so that other instances only ever map whole images
+        const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+        const std::string temp_path =
+            path + Common::StringFromFormat(".%llx.tmp", static_cast<u64>(now));
+        if (!FileUtil::CreateFullPath(path)) {
+            return nullptr;
+        }
+        bool is_written;
+        {
+            FileUtil::IOFile file(temp_path, "wb");
+            is_written = file.WriteBytes(program_image.data(), shared_size) == shared_size;
+        }
+        if (!is_written || !FileUtil::Rename(temp_path, path)) {
+            FileUtil::Delete(temp_path);
+            return nullptr;
+        }
+    }
+
+    // The contents are compared in case of a hash collision or a damaged file
+    auto image = std::make_shared<FileUtil::MappedFile>();
+    if (!image->Open(path, FileUtil::MappedFile::Mode::CopyOnWrite) || image->Size() != shared_size ||
+        std::memcmp(image->Data(), program_image.data(), shared_size) != 0) {
+        LOG_ERROR(Loader, "Shared module image %s doesn't match the module", path.c_str());
+        return nullptr;
+    }
+
+    program_image = std::vector<u8>(program_image.begin() + shared_size, program_image.end());
+    return image;
 }
 
-VAddr AppLoader_NSO::LoadNso(const std::string& path, VAddr load_base, bool relocate) {
-    FileUtil::IOFile file(path, "rb");
-    if (!file.IsOpen()) {
-        return {};
+/**
+ * Reads an NSO file and decompresses its segments. The file is mapped, and the segments are
+ * decompressed in parallel from the mapping directly into their place in the program image, which
+ * then becomes the memory of the module. This doesn't touch any kernel state, so that several NSOs
+ * can be read in parallel too.
+ */
+static boost::optional<NsoImage> ReadNso(const std::string& path) {
+    FileUtil::MappedFile file;
+    if (!FileUtil::Exists(path) || !file.Open(path)) {
+        return boost::none;
     }
 
     // Read NSO header
-    NsoHeader nso_header{};
-    file.Seek(0, SEEK_SET);
-    if (sizeof(NsoHeader) != file.ReadBytes(&nso_header, sizeof(NsoHeader))) {
-        return {};
+    NsoImage image{path};
+    NsoHeader& nso_header = image.header;
+    if (file.Size() < sizeof(NsoHeader)) {
+        return boost::none;
     }
+    std::memcpy(&nso_header, file.Data(), sizeof(NsoHeader));
     if (nso_header.magic != Common::MakeMagic('N', 'S', 'O', '0')) {
-        return {};
+        return boost::none;
+    }
+    LOG_DEBUG(Loader, "%s build ID: %s", path.c_str(),
+              Common::ArrayToString(nso_header.build_id.data(), nso_header.build_id.size(), 0,
+                                    false)
+                  .c_str());
+
+    // The segments are stored in order, each one at its location in the image
+    u32 image_end = 0;
+    for (size_t i = 0; i < nso_header.segments.size(); ++i) {
+        const NsoSegmentHeader& segment = nso_header.segments[i];
+        const u64 compressed_end = u64{segment.offset} + nso_header.segments_compressed_size[i];
+        if (compressed_end > file.Size()) {
+            LOG_CRITICAL(Loader, "NSO segment %zu is past the end of %s", i, path.c_str());
+            return boost::none;
+        }
+        ASSERT_MSG(segment.location >= image_end, "NSO segments overlap");
+        image_end = segment.location + segment.size;
     }
 
+    // Reserve room for the .bss section, so that appending it in LoadNso doesn't copy the image.
+    // Its size in the MOD header, which is only known after decompressing, is usually the same.
+    image.program_image.reserve(
+        PageAlignSize(image_end + PageAlignSize(nso_header.segments[2].bss_size)));
+    image.program_image.resize(image_end);
+
+    // In lazy loading mode, a large .rodata is left out of the image when its block cache exists,
+    // its chunks are decompressed from it once accessed. Otherwise the cache is written now.
+    const NsoSegmentHeader& rodata_segment = nso_header.segments[1];
+    const bool is_rodata_lazy = Settings::values.use_lazy_module_loading &&
+                                rodata_segment.size >= LAZY_SEGMENT_MIN_SIZE;
+    const std::string rodata_cache_path = is_rodata_lazy ? GetRodataCachePath(nso_header) : "";
+    if (is_rodata_lazy) {
+        image.rodata_cache = std::make_unique<BlockCache>();
+        if (!image.rodata_cache->Read(rodata_cache_path, rodata_segment.size)) {
+            image.rodata_cache.reset();
+        }
+    }
+
+    // All the segments are read right away, from several threads at once
+    file.Advise(FileUtil::MappedFile::AccessHint::WillNeed);
+
+    // Decompress the data and rodata segments on other threads, and the text one on this one
+    const auto decompress = [&image, &file](size_t i) {
+        const NsoSegmentHeader& segment = image.header.segments[i];
+        return DecompressSegment(file.Data() + segment.offset,
+                                 image.header.segments_compressed_size[i],
+                                 image.program_image.data() + segment.location, segment.size);
+    };
+    auto rodata = std::async(std::launch::async, [&] {
+        if (image.rodata_cache) {
+            return true;
+        }
+        if (!decompress(1)) {
+            return false;
+        }
+        if (is_rodata_lazy) {
+            BlockCache::Write(rodata_cache_path,
+                              image.program_image.data() + rodata_segment.location,
+                              rodata_segment.size);
+        }
+        return true;
+    });
+    auto data = std::async(std::launch::async, decompress, 2);
+    const bool is_text_valid = decompress(0);
+    const bool is_rodata_valid = rodata.get();
+    const bool is_data_valid = data.get();
+    if (!is_text_valid || !is_rodata_valid || !is_data_valid) {
+        return boost::none;
+    }
+
+    return image;
+}
+
+VAddr AppLoader_NSO::LoadNso(NsoImage& image, VAddr load_base, bool relocate) {
+    const NsoHeader& nso_header = image.header;
+    std::vector<u8>& program_image = image.program_image;
+
     // Build program image
     Kernel::SharedPtr<Kernel::CodeSet> codeset = Kernel::CodeSet::Create("", 0);
-    std::vector<u8> program_image;
-    for (int i = 0; i < nso_header.segments.size(); ++i) {
-        std::vector<u8> data =
-            ReadSegment(file, nso_header.segments[i], nso_header.segments_compressed_size[i]);
-        program_image.resize(nso_header.segments[i].location);
-        program_image.insert(program_image.end(), data.begin(), data.end());
+    for (size_t i = 0; i < nso_header.segments.size(); ++i) {
         codeset->segments[i].addr = nso_header.segments[i].location;
         codeset->segments[i].offset = nso_header.segments[i].location;
-        codeset->segments[i].size = PageAlignSize(static_cast<u32>(data.size()));
+        codeset->segments[i].size = PageAlignSize(nso_header.segments[i].size);
     }
 
     // MOD header pointer is at .text offset + 4
@@ -137,15 +282,44 @@ VAddr AppLoader_NSO::LoadNso(const std::string& path, VAddr load_base, bool relo
 
     // Relocate symbols if there was a proper MOD header - This must happen after the image has been
     // loaded into memory
+    ASSERT_MSG(!relocate || !image.rodata_cache, "Lazy segments can't be relocated");
     if (has_mod_header && relocate) {
         Relocate(program_image, module_offset + mod_header.dynamic_offset, load_base);
     }
 
+    Symbols::AddModule(image.path.substr(image.path.find_last_of("/\\") + 1), load_base,
+                       image_size);
+    // The symbol table is in .rodata, which isn't in the image yet when it's loaded lazily
+    if (has_mod_header && !image.rodata_cache) {
+        AddFunctionSymbols(program_image, module_offset + mod_header.dynamic_offset, load_base);
+    }
+
+    // The text and rodata segments come first, they can be shared unless they have been modified
+    const u32 shared_size = nso_header.segments[2].location;
+    if (Settings::values.use_shared_module_images && !relocate && !image.rodata_cache &&
+        (shared_size & Memory::PAGE_MASK) == 0) {
+        codeset->shared_image = ShareReadOnlySegments(program_image, shared_size);
+        if (codeset->shared_image) {
+            codeset->data.offset = 0;
+        }
+    }
+
     // Load codeset for current process
-    codeset->name = path;
+    codeset->name = image.path;
     codeset->memory = std::make_shared<std::vector<u8>>(std::move(program_image));
     Kernel::g_current_process->LoadModule(codeset, load_base);
 
+    // The pages of a lazy .rodata are populated by the first access to each of its chunks
+    if (image.rodata_cache) {
+        const u32 rodata_offset = nso_header.segments[1].location;
+        const VAddr rodata_addr = load_base + rodata_offset;
+        Memory::PageTable& page_table = Kernel::g_current_process->vm_manager.page_table;
+        auto segment = std::make_shared<LazySegment>(std::move(*image.rodata_cache), page_table,
+                                                     rodata_addr, codeset->memory, rodata_offset);
+        Memory::MapIoRegion(page_table, rodata_addr, segment->GetMappedSize(), segment);
+        LOG_INFO(Loader, "Loading .rodata of %s on demand", image.path.c_str());
+    }
+
     return load_base + image_size;
 }
 
@@ -159,21 +333,29 @@ ResultStatus AppLoader_NSO::Load(Kernel::SharedPtr<Kernel::Process>& process) {
 
     process = Kernel::Process::Create("main");
 
+    // Read and decompress all the modules in parallel, the "main" module is the last one. Only
+    // assigning their addresses and loading them into the process has to happen in order.
+    constexpr std::array<const char*, 8> modules{
+        "rtld", "sdk", "subsdk0", "subsdk1", "subsdk2", "subsdk3", "subsdk4", "main"};
+    const std::string directory = filepath.substr(0, filepath.find_last_of("/\\"));
+    std::array<std::future<boost::optional<NsoImage>>, modules.size()> images;
+    for (size_t i = 0; i < modules.size(); ++i) {
+        const bool is_main = i + 1 == modules.size();
+        const std::string path = is_main ? filepath : directory + "/" + modules[i];
+        images[i] = std::async(std::launch::async, ReadNso, path);
+    }
+
     // Load NSO modules
     VAddr next_load_addr{Memory::PROCESS_IMAGE_VADDR};
-    for (const auto& module :
-         {"rtld", "sdk", "subsdk0", "subsdk1", "subsdk2", "subsdk3", "subsdk4"}) {
-        const std::string path = filepath.substr(0, filepath.find_last_of("/\\")) + "/" + module;
-        const VAddr load_addr = next_load_addr;
-        next_load_addr = LoadNso(path, load_addr);
-        if (next_load_addr) {
-            LOG_DEBUG(Loader, "loaded module %s @ 0x%llx", module, load_addr);
-        } else {
-            next_load_addr = load_addr;
+    for (size_t i = 0; i < modules.size(); ++i) {
+        boost::optional<NsoImage> image = images[i].get();
+        if (image == boost::none) {
+            continue;
         }
+        const VAddr load_addr = next_load_addr;
+        next_load_addr = LoadNso(*image, load_addr);
+        LOG_DEBUG(Loader, "loaded module %s @ 0x%llx", modules[i], load_addr);
     }
-    // Load "main" module
-    LoadNso(filepath, next_load_addr);
 
     process->svc_access_mask.set();
     process->address_mappings = default_address_mappings;
@@ -14,6 +14,8 @@
 
 namespace Loader {
 
+struct NsoImage;
+
 /// Loads an NSO file
 class AppLoader_NSO final : public AppLoader, Linker {
 public:
@@ -34,7 +36,11 @@ public:
     ResultStatus Load(Kernel::SharedPtr<Kernel::Process>& process) override;
 
 private:
-    VAddr LoadNso(const std::string& path, VAddr load_base, bool relocate = false);
+    /**
+     * Loads a read NSO into the current process at the given address.
+     * @returns The address following the loaded module.
+     */
+    VAddr LoadNso(NsoImage& image, VAddr load_base, bool relocate = false);
 
     std::string filepath;
 };
@@ -0,0 +1,114 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include "common/string_util.h"
+#include "core/loader/symbols.h"
+
+namespace Loader {
+
+namespace Symbols {
+
+namespace {
+
+struct Range {
+    std::string name;
+    VAddr address;
+    u64 size;
+
+    bool operator<(const Range& other) const {
+        return address < other.address;
+    }
+};
+
+std::mutex mutex;
+std::vector<Range> modules;
+std::vector<Range> functions;
+/// Whether the ranges were added to since they were last sorted
+bool is_sorted = true;
+
+/// Finds the last range starting at or before an address, or nullptr if there is none
+const Range* FindPreceding(const std::vector<Range>& ranges, VAddr address) {
+    auto iter = std::upper_bound(ranges.begin(), ranges.end(), address,
+                                 [](VAddr address, const Range& range) {
+                                     return address < range.address;
+                                 });
+    if (iter == ranges.begin()) {
+        return nullptr;
+    }
+    return &*std::prev(iter);
+}
+
+} // Anonymous namespace
+
+void Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    modules.clear();
+    functions.clear();
+    is_sorted = true;
+}
+
+void AddModule(std::string name, VAddr base, u64 size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    modules.push_back({std::move(name), base, size});
+    is_sorted = false;
+}
+
+void AddFunction(std::string name, VAddr address, u64 size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    functions.push_back({std::move(name), address, size});
+    is_sorted = false;
+}
+
+Location Lookup(VAddr address) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!is_sorted) {
+        std::sort(modules.begin(), modules.end());
+        std::sort(functions.begin(), functions.end());
+        is_sorted = true;
+    }
+
+    Location location;
+    const Range* module = FindPreceding(modules, address);
+    if (module == nullptr || address - module->address >= module->size) {
+        return location;
+    }
+    location.module = module->name;
+    location.base = module->address;
+
+    // A function without a size is only known to end before the next function or the module end
+    const Range* function = FindPreceding(functions, address);
+    if (function == nullptr || function->address < module->address) {
+        return location;
+    }
+    if (function->size != 0 && address - function->address >= function->size) {
+        return location;
+    }
+    location.function = function->name;
+    location.base = function->address;
+    return location;
+}
+
+std::string Describe(VAddr address) {
+    const Location location = Lookup(address);
+    if (location.module.empty()) {
+        return Common::StringFromFormat("0x%016llx", static_cast<unsigned long long>(address));
+    }
+
+    std::string description = location.module;
+    if (!location.function.empty()) {
+        description += '!' + location.function;
+    }
+    if (address != location.base) {
+        description += Common::StringFromFormat(
+            "+0x%llx", static_cast<unsigned long long>(address - location.base));
+    }
+    return description;
+}
+
+} // namespace Symbols
+
+} // namespace Loader
@@ -0,0 +1,46 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+#include "common/common_types.h"
+
+namespace Loader {
+
+/**
+ * Names of the code of the loaded modules, for symbolizing guest addresses in profiles and other
+ * debugging tools. The loaders add each module they load, along with the functions of its dynamic
+ * symbol table. Functions without a size extend to the next function of their module.
+ */
+namespace Symbols {
+
+struct Location {
+    /// Name of the module containing the address, empty if no module does
+    std::string module;
+    /// Name of the function containing the address, empty if it isn't known
+    std::string function;
+    /// Start of the function, or of the module if the function isn't known
+    VAddr base = 0;
+};
+
+/// Forgets all the modules and functions, when the emulated system shuts down
+void Clear();
+
+void AddModule(std::string name, VAddr base, u64 size);
+
+void AddFunction(std::string name, VAddr address, u64 size);
+
+/// Looks up the module and function containing an address
+Location Lookup(VAddr address);
+
+/**
+ * Describes an address, as "module!function+0x10", "module+0x1234" if the function isn't known, or
+ * just the address if it isn't in any module.
+ */
+std::string Describe(VAddr address);
+
+} // namespace Symbols
+
+} // namespace Loader
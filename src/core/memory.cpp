@@ -2,17 +2,21 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstring>
+#include <limits>
+#include <mutex>
 #include "common/assert.h"
 #include "common/common_types.h"
 #include "common/logging/log.h"
+#include "common/memory_util.h"
 #include "common/swap.h"
 #include "core/arm/arm_interface.h"
 #include "core/core.h"
 #include "core/hle/kernel/memory.h"
 #include "core/hle/kernel/process.h"
-#include "core/hle/lock.h"
 #include "core/memory.h"
 #include "core/memory_setup.h"
 #include "video_core/renderer_base.h"
@@ -25,10 +29,134 @@ static std::array<u8, Memory::N3DS_EXTRA_RAM_SIZE> n3ds_extra_ram;
 
 static PageTable* current_page_table = nullptr;
 
+/// Serializes the MMIO handlers and rasterizer cache accesses of the slow memory access paths
+static std::mutex mmio_lock;
+
+/// Protects the list of dirty page trackers and their state, taken after mmio_lock
+static std::mutex dirty_tracker_lock;
+static std::vector<DirtyPageTracker*> dirty_trackers;
+/// Whether dirty_trackers is empty, checked without the lock on every slow path write
+static std::atomic<bool> has_dirty_trackers{false};
+
+/// Region the rasterizer wrote to, written back to guest memory on the first access to it
+struct PendingReadback {
+    Kernel::SharedPtr<Kernel::Process> process;
+    VAddr addr;
+    u64 size;
+    ReadbackCallback readback;
+};
+
+/// Protects the pending readbacks, held while they are written back so that concurrent accesses
+/// wait for them. Taken after mmio_lock and before dirty_tracker_lock.
+static std::mutex readback_lock;
+static std::vector<PendingReadback> pending_readbacks;
+/// Whether pending_readbacks is empty, checked without the lock on every slow path access
+static std::atomic<bool> has_pending_readbacks{false};
+
+/// Marks written or remapped pages dirty in the trackers watching them
+void NotifyDirtyTrackers(const PageTable& page_table, VAddr addr, u64 size,
+                                bool is_remapped) {
+    if (!has_dirty_trackers) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(dirty_tracker_lock);
+    for (DirtyPageTracker* tracker : dirty_trackers) {
+        tracker->MarkDirty(page_table, addr, size, is_remapped);
+    }
+}
+
+/// Watches pages again for the trackers that keep watching them, once they have been remapped
+void RewatchDirtyTrackers(const PageTable& page_table, VAddr addr, u64 size) {
+    if (!has_dirty_trackers) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(dirty_tracker_lock);
+    for (DirtyPageTracker* tracker : dirty_trackers) {
+        tracker->Rewatch(page_table, addr, size);
+    }
+}
+
+PagePointerArray::PagePointerArray() {
+    table = static_cast<u8**>(AllocateMemoryPages(TABLE_SIZE));
+    ASSERT_MSG(table != nullptr, "Failed to reserve page table storage");
+}
+
+PagePointerArray::~PagePointerArray() {
+    FreeMemoryPages(table, TABLE_SIZE);
+}
+
+void PagePointerArray::Set(size_t index, u8* pointer) {
+    const size_t host_page = index / ENTRIES_PER_HOST_PAGE;
+    if (pointer == nullptr && !touched_pages[host_page]) {
+        // Untouched storage already reads back as null, avoid committing it.
+        return;
+    }
+    touched_pages.set(host_page);
+    table[index] = pointer;
+}
+
+void PagePointerArray::SetRange(size_t index, size_t count, u8* pointer) {
+    const size_t end = index + count;
+    while (index != end) {
+        const size_t host_page = index / ENTRIES_PER_HOST_PAGE;
+        const size_t host_page_end = std::min(end, (host_page + 1) * ENTRIES_PER_HOST_PAGE);
+        const size_t host_page_count = host_page_end - index;
+
+        if (pointer == nullptr) {
+            // Untouched storage already reads back as null, avoid committing it.
+            if (touched_pages[host_page]) {
+                std::fill_n(table + index, host_page_count, nullptr);
+            }
+        } else {
+            touched_pages.set(host_page);
+            for (size_t i = 0; i < host_page_count; ++i) {
+                table[index + i] = pointer + i * PAGE_SIZE;
+            }
+            pointer += host_page_count * PAGE_SIZE;
+        }
+        index = host_page_end;
+    }
+}
+
+void PagePointerArray::Clear() {
+    if (touched_pages.none()) {
+        return;
+    }
+
+    // Hand the committed pages back to the host by replacing the reservation with a fresh one,
+    // which is guaranteed to be zero-filled.
+    FreeMemoryPages(table, TABLE_SIZE);
+    table = static_cast<u8**>(AllocateMemoryPages(TABLE_SIZE));
+    ASSERT_MSG(table != nullptr, "Failed to reserve page table storage");
+    touched_pages.reset();
+}
+
+size_t PagePointerArray::GetHostMemoryUsage() const {
+    return touched_pages.count() * HOST_PAGE_SIZE;
+}
+
+void PageTable::Clear() {
+    pointers.Clear();
+    special_regions.clear();
+    special_region_index.Clear();
+    attributes.Clear();
+    cached_res_count.Clear();
+}
+
+size_t PageTable::GetHostMemoryUsage() const {
+    return pointers.GetHostMemoryUsage() + attributes.GetHostMemoryUsage() +
+           cached_res_count.GetHostMemoryUsage() + special_region_index.GetHostMemoryUsage() +
+           special_regions.capacity() * sizeof(SpecialRegion);
+}
+
 void SetCurrentPageTable(PageTable* page_table) {
     current_page_table = page_table;
-    if (Core::System::GetInstance().IsPoweredOn()) {
-        Core::CPU().PageTableChanged();
+    auto& system = Core::System::GetInstance();
+    if (system.IsPoweredOn()) {
+        // All cores share the address space of the current process
+        for (size_t core = 0; core < system.NumCpuCores(); ++core) {
+            system.ArmInterface(core).PageTableChanged();
+        }
     }
 }
 
@@ -36,25 +164,43 @@ PageTable* GetCurrentPageTable() {
     return current_page_table;
 }
 
+/// Lets the handlers of the special pages of a range of pages write back the memory they stand in
+/// for, before the pages are remapped
+static void NotifyRemappedSpecialPages(const PageTable& page_table, size_t base, size_t size) {
+    const size_t end = base + size;
+    size_t page = page_table.special_region_index.FindUsed(base, end);
+    while (page != end) {
+        const u16 index = page_table.special_region_index[page];
+        size_t run_end = page + 1;
+        while (run_end != end && page_table.special_region_index[run_end] == index) {
+            ++run_end;
+        }
+        const MMIORegionPointer handler = page_table.special_regions[index - 1].handler;
+        handler->OnRemap(static_cast<VAddr>(page) << PAGE_BITS,
+                         static_cast<u64>(run_end - page) << PAGE_BITS);
+        page = page_table.special_region_index.FindUsed(run_end, end);
+    }
+}
+
 static void MapPages(PageTable& page_table, VAddr base, u64 size, u8* memory, PageType type) {
     LOG_DEBUG(HW_Memory, "Mapping %p onto %08X-%08X", memory, base * PAGE_SIZE,
               (base + size) * PAGE_SIZE);
+    ASSERT_MSG(base + size <= PAGE_TABLE_NUM_ENTRIES, "out of range mapping at %08X", base);
 
-    RasterizerFlushVirtualRegion(base << PAGE_BITS, size * PAGE_SIZE,
-                                 FlushMode::FlushAndInvalidate);
-
-    VAddr end = base + size;
-    while (base != end) {
-        ASSERT_MSG(base < PAGE_TABLE_NUM_ENTRIES, "out of range mapping at %08X", base);
-
-        page_table.attributes[base] = type;
-        page_table.pointers[base] = memory;
-        page_table.cached_res_count[base] = 0;
+    NotifyRemappedSpecialPages(page_table, static_cast<size_t>(base), static_cast<size_t>(size));
 
-        base += 1;
-        if (memory != nullptr)
-            memory += PAGE_SIZE;
+    // Only pages that are cached by the rasterizer have anything to flush
+    if (page_table.cached_res_count.GetNumUsed() != 0) {
+        RasterizerFlushVirtualRegion(base << PAGE_BITS, size * PAGE_SIZE,
+                                     FlushMode::FlushAndInvalidate);
     }
+    NotifyDirtyTrackers(page_table, base << PAGE_BITS, size * PAGE_SIZE, true);
+
+    page_table.attributes.Fill(base, size, type);
+    page_table.pointers.SetRange(base, size, memory);
+    page_table.cached_res_count.Fill(base, size, 0);
+    page_table.special_region_index.Fill(base, size, 0);
+    RewatchDirtyTrackers(page_table, base << PAGE_BITS, size * PAGE_SIZE);
 }
 
 void MapMemoryRegion(PageTable& page_table, VAddr base, u64 size, u8* target) {
@@ -68,7 +214,18 @@ void MapIoRegion(PageTable& page_table, VAddr base, u64 size, MMIORegionPointer
     ASSERT_MSG((base & PAGE_MASK) == 0, "non-page aligned base: %08X", base);
     MapPages(page_table, base / PAGE_SIZE, size / PAGE_SIZE, nullptr, PageType::Special);
 
-    page_table.special_regions.emplace_back(SpecialRegion{base, size, mmio_handler});
+    // Handlers mapped again share their entry, so that remapping them doesn't use up the indices
+    auto& regions = page_table.special_regions;
+    auto itr = std::find_if(regions.begin(), regions.end(), [&](const SpecialRegion& region) {
+        return region.handler == mmio_handler;
+    });
+    if (itr == regions.end()) {
+        ASSERT_MSG(regions.size() < std::numeric_limits<u16>::max(), "too many IO regions mapped");
+        regions.emplace_back(SpecialRegion{base, size, mmio_handler});
+        itr = regions.end() - 1;
+    }
+    page_table.special_region_index.Fill(base / PAGE_SIZE, size / PAGE_SIZE,
+                                         static_cast<u16>(itr - regions.begin() + 1));
 }
 
 void UnmapRegion(PageTable& page_table, VAddr base, u64 size) {
@@ -118,13 +275,12 @@ static u8* GetPointerFromVMA(VAddr vaddr) {
  * This function should only be called for virtual addreses with attribute `PageType::Special`.
  */
 static MMIORegionPointer GetMMIOHandler(const PageTable& page_table, VAddr vaddr) {
-    for (const auto& region : page_table.special_regions) {
-        if (vaddr >= region.base && vaddr < (region.base + region.size)) {
-            return region.handler;
-        }
+    const u16 index = page_table.special_region_index[vaddr >> PAGE_BITS];
+    if (index == 0) {
+        ASSERT_MSG(false, "Mapped IO page without a handler @ %08X", vaddr);
+        return nullptr; // Should never happen
     }
-    ASSERT_MSG(false, "Mapped IO page without a handler @ %08X", vaddr);
-    return nullptr; // Should never happen
+    return page_table.special_regions[index - 1].handler;
 }
 
 static MMIORegionPointer GetMMIOHandler(VAddr vaddr) {
@@ -132,6 +288,70 @@ static MMIORegionPointer GetMMIOHandler(VAddr vaddr) {
     return GetMMIOHandler(page_table, vaddr);
 }
 
+/**
+ * Returns the number of bytes starting at the given page and offset, up to `max_size`, that are
+ * backed by a single contiguous run of regular host memory. Adjacent pages are merged into the run
+ * as long as their backing pointers follow on from each other.
+ */
+static size_t GetContiguousRunSize(const PageTable& page_table, size_t page_index,
+                                   size_t page_offset, size_t max_size) {
+    const u8* const run_base = page_table.pointers[page_index];
+    size_t run_size = std::min<size_t>(PAGE_SIZE - page_offset, max_size);
+
+    for (size_t page = 1; run_size < max_size; ++page) {
+        const size_t next_index = page_index + page;
+        if (next_index >= PAGE_TABLE_NUM_ENTRIES ||
+            page_table.attributes[next_index] != PageType::Memory ||
+            page_table.pointers[next_index] != run_base + page * PAGE_SIZE) {
+            break;
+        }
+        run_size += std::min<size_t>(PAGE_SIZE, max_size - run_size);
+    }
+
+    return run_size;
+}
+
+/// Returns the amount of bytes the block operations should process at once at the given position.
+static size_t GetBlockChunkSize(const PageTable& page_table, size_t page_index, size_t page_offset,
+                                size_t remaining_size) {
+    if (page_table.attributes[page_index] == PageType::Memory) {
+        return GetContiguousRunSize(page_table, page_index, page_offset, remaining_size);
+    }
+    return std::min<size_t>(PAGE_SIZE - page_offset, remaining_size);
+}
+
+bool GetHostSpans(const Kernel::Process& process, const VAddr vaddr, const size_t size,
+                  HostSpanList& spans) {
+    const auto& page_table = process.vm_manager.page_table;
+
+    size_t remaining_size = size;
+    size_t page_index = vaddr >> PAGE_BITS;
+    size_t page_offset = vaddr & PAGE_MASK;
+
+    while (remaining_size > 0) {
+        if (page_index >= PAGE_TABLE_NUM_ENTRIES ||
+            page_table.attributes[page_index] != PageType::Memory) {
+            return false;
+        }
+
+        const size_t run_size =
+            GetContiguousRunSize(page_table, page_index, page_offset, remaining_size);
+        const VAddr current_vaddr = static_cast<VAddr>((page_index << PAGE_BITS) + page_offset);
+        spans.push_back({current_vaddr, page_table.pointers[page_index] + page_offset, run_size});
+
+        const size_t next = page_offset + run_size;
+        page_index += next >> PAGE_BITS;
+        page_offset = next & PAGE_MASK;
+        remaining_size -= run_size;
+    }
+
+    return true;
+}
+
+bool GetHostSpans(const VAddr vaddr, const size_t size, HostSpanList& spans) {
+    return GetHostSpans(*Kernel::g_current_process, vaddr, size, spans);
+}
+
 template <typename T>
 T ReadMMIO(MMIORegionPointer mmio_handler, VAddr addr);
 
@@ -145,9 +365,6 @@ T Read(const VAddr vaddr) {
         return value;
     }
 
-    // The memory access might do an MMIO or cached access, so we have to lock the HLE kernel state
-    std::lock_guard<std::recursive_mutex> lock(HLE::g_hle_lock);
-
     PageType type = current_page_table->attributes[vaddr >> PAGE_BITS];
     switch (type) {
     case PageType::Unmapped:
@@ -157,15 +374,20 @@ T Read(const VAddr vaddr) {
         ASSERT_MSG(false, "Mapped memory page without a pointer @ %08X", vaddr);
         break;
     case PageType::RasterizerCachedMemory: {
+        // Only pending readbacks have anything to flush, which they lock on their own. Most of
+        // these pages are clean pages watched by dirty page trackers, read with no lock at all.
         RasterizerFlushVirtualRegion(vaddr, sizeof(T), FlushMode::Flush);
 
         T value;
         std::memcpy(&value, GetPointerFromVMA(vaddr), sizeof(T));
         return value;
     }
-    case PageType::Special:
+    case PageType::Special: {
+        std::lock_guard<std::mutex> lock(mmio_lock);
         return ReadMMIO<T>(GetMMIOHandler(vaddr), vaddr);
+    }
     case PageType::RasterizerCachedSpecial: {
+        std::lock_guard<std::mutex> lock(mmio_lock);
         RasterizerFlushVirtualRegion(vaddr, sizeof(T), FlushMode::Flush);
         return ReadMMIO<T>(GetMMIOHandler(vaddr), vaddr);
     }
@@ -186,9 +408,6 @@ void Write(const VAddr vaddr, const T data) {
         return;
     }
 
-    // The memory access might do an MMIO or cached access, so we have to lock the HLE kernel state
-    std::lock_guard<std::recursive_mutex> lock(HLE::g_hle_lock);
-
     PageType type = current_page_table->attributes[vaddr >> PAGE_BITS];
     switch (type) {
     case PageType::Unmapped:
@@ -199,14 +418,19 @@ void Write(const VAddr vaddr, const T data) {
         ASSERT_MSG(false, "Mapped memory page without a pointer @ %08X", vaddr);
         break;
     case PageType::RasterizerCachedMemory: {
+        std::lock_guard<std::mutex> lock(mmio_lock);
         RasterizerFlushVirtualRegion(vaddr, sizeof(T), FlushMode::FlushAndInvalidate);
+        NotifyDirtyTrackers(*current_page_table, vaddr, sizeof(T), false);
         std::memcpy(GetPointerFromVMA(vaddr), &data, sizeof(T));
         break;
     }
-    case PageType::Special:
+    case PageType::Special: {
+        std::lock_guard<std::mutex> lock(mmio_lock);
         WriteMMIO<T>(GetMMIOHandler(vaddr), vaddr, data);
         break;
+    }
     case PageType::RasterizerCachedSpecial: {
+        std::lock_guard<std::mutex> lock(mmio_lock);
         RasterizerFlushVirtualRegion(vaddr, sizeof(T), FlushMode::FlushAndInvalidate);
         WriteMMIO<T>(GetMMIOHandler(vaddr), vaddr, data);
         break;
@@ -251,25 +475,63 @@ u8* GetPointer(const VAddr vaddr) {
         return page_pointer + (vaddr & PAGE_MASK);
     }
 
-    if (current_page_table->attributes[vaddr >> PAGE_BITS] == PageType::RasterizerCachedMemory) {
+    const PageType type = current_page_table->attributes[vaddr >> PAGE_BITS];
+    if (type == PageType::RasterizerCachedMemory) {
         return GetPointerFromVMA(vaddr);
     }
 
+    if (type == PageType::Special) {
+        // Handlers standing in for regular memory hand it out once it is written back
+        std::lock_guard<std::mutex> lock(mmio_lock);
+        if (u8* pointer = GetMMIOHandler(vaddr)->GetPointer(vaddr)) {
+            return pointer;
+        }
+    }
+
     LOG_ERROR(HW_Memory, "unknown GetPointer @ 0x%08x", vaddr);
     return nullptr;
 }
 
 std::string ReadCString(VAddr vaddr, std::size_t max_length) {
+    const PageTable& page_table = *current_page_table;
     std::string string;
-    string.reserve(max_length);
-    for (std::size_t i = 0; i < max_length; ++i) {
-        char c = Read8(vaddr);
-        if (c == '\0')
-            break;
-        string.push_back(c);
-        ++vaddr;
+
+    size_t remaining_size = max_length;
+    size_t page_index = vaddr >> PAGE_BITS;
+    size_t page_offset = vaddr & PAGE_MASK;
+
+    while (remaining_size > 0) {
+        const size_t chunk_size =
+            GetBlockChunkSize(page_table, page_index, page_offset, remaining_size);
+
+        if (page_table.attributes[page_index] == PageType::Memory) {
+            // The terminator is searched for in the whole run at once. Strings are usually within
+            // a single run, so the string is allocated once at its size.
+            const char* chunk =
+                reinterpret_cast<const char*>(page_table.pointers[page_index] + page_offset);
+            const char* terminator = static_cast<const char*>(std::memchr(chunk, '\0', chunk_size));
+            string.append(chunk, terminator ? terminator - chunk : chunk_size);
+            if (terminator) {
+                return string;
+            }
+        } else {
+            // Other pages are read a character at a time, through the usual handling of their type
+            const VAddr chunk_vaddr = static_cast<VAddr>((page_index << PAGE_BITS) + page_offset);
+            for (size_t i = 0; i < chunk_size; ++i) {
+                const char c = static_cast<char>(Read8(static_cast<VAddr>(chunk_vaddr + i)));
+                if (c == '\0') {
+                    return string;
+                }
+                string.push_back(c);
+            }
+        }
+
+        const size_t next = page_offset + chunk_size;
+        page_index += next >> PAGE_BITS;
+        page_offset = next & PAGE_MASK;
+        remaining_size -= chunk_size;
     }
-    string.shrink_to_fit();
+
     return string;
 }
 
@@ -332,6 +594,69 @@ u8* GetPhysicalPointer(PAddr address) {
     return target_pointer;
 }
 
+/**
+ * Adds a value to the rasterizer resource cache counter of a page, switching it to one of the
+ * cached page types while the counter is non-zero.
+ */
+static void AdjustPageCachedCount(PageTable& page_table, const Kernel::Process& process,
+                                  VAddr vaddr, int count_delta) {
+    const size_t page_index = vaddr >> PAGE_BITS;
+    u8 res_count = page_table.cached_res_count[page_index];
+    ASSERT_MSG(count_delta <= UINT8_MAX - res_count,
+               "Rasterizer resource cache counter overflow!");
+    ASSERT_MSG(count_delta >= -res_count, "Rasterizer resource cache counter underflow!");
+
+    // Switch page type to cached if now cached
+    if (res_count == 0) {
+        switch (page_table.attributes[page_index]) {
+        case PageType::Unmapped:
+            // It is not necessary for a process to have this region mapped into its address
+            // space, for example, a system module need not have a VRAM mapping.
+            break;
+        case PageType::Memory:
+            page_table.attributes.Set(page_index, PageType::RasterizerCachedMemory);
+            page_table.pointers.Set(page_index, nullptr);
+            break;
+        case PageType::Special:
+            page_table.attributes.Set(page_index, PageType::RasterizerCachedSpecial);
+            break;
+        default:
+            UNREACHABLE();
+        }
+    }
+
+    res_count += count_delta;
+    page_table.cached_res_count.Set(page_index, res_count);
+
+    // Switch page type to uncached if now uncached
+    if (res_count == 0) {
+        switch (page_table.attributes[page_index]) {
+        case PageType::Unmapped:
+            // It is not necessary for a process to have this region mapped into its address
+            // space, for example, a system module need not have a VRAM mapping.
+            break;
+        case PageType::RasterizerCachedMemory: {
+            u8* pointer = GetPointerFromVMA(process, vaddr & ~PAGE_MASK);
+            if (pointer == nullptr) {
+                // It's possible that this function has called been while updating the pagetable
+                // after unmapping a VMA. In that case the underlying VMA will no longer exist,
+                // and we should just leave the pagetable entry blank.
+                page_table.attributes.Set(page_index, PageType::Unmapped);
+            } else {
+                page_table.attributes.Set(page_index, PageType::Memory);
+                page_table.pointers.Set(page_index, pointer);
+            }
+            break;
+        }
+        case PageType::RasterizerCachedSpecial:
+            page_table.attributes.Set(page_index, PageType::Special);
+            break;
+        default:
+            UNREACHABLE();
+        }
+    }
+}
+
 void RasterizerMarkRegionCached(PAddr start, u64 size, int count_delta) {
     if (start == 0) {
         return;
@@ -351,76 +676,185 @@ void RasterizerMarkRegionCached(PAddr start, u64 size, int count_delta) {
                       "Trying to flush a cached region to an invalid physical address %08X", paddr);
             continue;
         }
-        VAddr vaddr = *maybe_vaddr;
+        AdjustPageCachedCount(*current_page_table, *Kernel::g_current_process, *maybe_vaddr,
+                              count_delta);
+    }
+}
 
-        u8& res_count = current_page_table->cached_res_count[vaddr >> PAGE_BITS];
-        ASSERT_MSG(count_delta <= UINT8_MAX - res_count,
-                   "Rasterizer resource cache counter overflow!");
-        ASSERT_MSG(count_delta >= -res_count, "Rasterizer resource cache counter underflow!");
+void RasterizerFlushRegion(PAddr start, u64 size) {}
 
-        // Switch page type to cached if now cached
-        if (res_count == 0) {
-            PageType& page_type = current_page_table->attributes[vaddr >> PAGE_BITS];
-            switch (page_type) {
-            case PageType::Unmapped:
-                // It is not necessary for a process to have this region mapped into its address
-                // space, for example, a system module need not have a VRAM mapping.
-                break;
-            case PageType::Memory:
-                page_type = PageType::RasterizerCachedMemory;
-                current_page_table->pointers[vaddr >> PAGE_BITS] = nullptr;
-                break;
-            case PageType::Special:
-                page_type = PageType::RasterizerCachedSpecial;
-                break;
-            default:
-                UNREACHABLE();
-            }
+void RasterizerFlushAndInvalidateRegion(PAddr start, u64 size) {
+    // Since pages are unmapped on shutdown after video core is shutdown, the renderer may be
+    // null here
+}
+
+/// Marks the pages of a region as cached, or uncached again, on behalf of a pending readback
+static void AdjustReadbackPages(const PendingReadback& pending, int count_delta) {
+    std::lock_guard<std::mutex> lock(dirty_tracker_lock);
+    for (VAddr page = pending.addr & ~PAGE_MASK; page < pending.addr + pending.size;
+         page += PAGE_SIZE) {
+        AdjustPageCachedCount(pending.process->vm_manager.page_table, *pending.process, page,
+                              count_delta);
+    }
+}
+
+static bool IsOverlapping(const PendingReadback& pending, const PageTable* page_table, VAddr addr,
+                          u64 size) {
+    return &pending.process->vm_manager.page_table == page_table &&
+           pending.addr < addr + size && addr < pending.addr + pending.size;
+}
+
+void RasterizerFlushVirtualRegion(VAddr start, u64 size, FlushMode mode) {
+    if (!has_pending_readbacks) {
+        return;
+    }
+
+    // Written back whole, so that the accesses to the rest of the region don't flush again
+    std::lock_guard<std::mutex> lock(readback_lock);
+    for (auto itr = pending_readbacks.begin(); itr != pending_readbacks.end();) {
+        if (!IsOverlapping(*itr, current_page_table, start, size)) {
+            ++itr;
+            continue;
         }
+        itr->readback(itr->addr, itr->size);
+        AdjustReadbackPages(*itr, -1);
+        itr = pending_readbacks.erase(itr);
+    }
+    has_pending_readbacks = !pending_readbacks.empty();
+}
 
-        res_count += count_delta;
+void RasterizerDeferReadback(VAddr addr, u64 size, ReadbackCallback readback) {
+    ASSERT(size != 0);
+    std::lock_guard<std::mutex> lock(readback_lock);
+    pending_readbacks.push_back({Kernel::g_current_process, addr, size, std::move(readback)});
+    AdjustReadbackPages(pending_readbacks.back(), 1);
+    has_pending_readbacks = true;
+}
 
-        // Switch page type to uncached if now uncached
-        if (res_count == 0) {
-            PageType& page_type = current_page_table->attributes[vaddr >> PAGE_BITS];
-            switch (page_type) {
-            case PageType::Unmapped:
-                // It is not necessary for a process to have this region mapped into its address
-                // space, for example, a system module need not have a VRAM mapping.
-                break;
-            case PageType::RasterizerCachedMemory: {
-                u8* pointer = GetPointerFromVMA(vaddr & ~PAGE_MASK);
-                if (pointer == nullptr) {
-                    // It's possible that this function has called been while updating the pagetable
-                    // after unmapping a VMA. In that case the underlying VMA will no longer exist,
-                    // and we should just leave the pagetable entry blank.
-                    page_type = PageType::Unmapped;
-                } else {
-                    page_type = PageType::Memory;
-                    current_page_table->pointers[vaddr >> PAGE_BITS] = pointer;
-                }
-                break;
-            }
-            case PageType::RasterizerCachedSpecial:
-                page_type = PageType::Special;
-                break;
-            default:
-                UNREACHABLE();
-            }
+bool IsReadbackPending(VAddr addr, u64 size) {
+    std::lock_guard<std::mutex> lock(readback_lock);
+    return std::any_of(pending_readbacks.begin(), pending_readbacks.end(),
+                       [&](const PendingReadback& pending) {
+                           return IsOverlapping(pending, current_page_table, addr, size);
+                       });
+}
+
+DirtyPageTracker::DirtyPageTracker(Kernel::Process& process, VAddr base, u64 size,
+                                   WriteCallback on_write)
+    : process(process), base(base), on_write(std::move(on_write)), dirty(size >> PAGE_BITS),
+      watched(size >> PAGE_BITS) {
+    ASSERT_MSG(((base | size) & PAGE_MASK) == 0, "non-page aligned range: %08X", base);
+
+    std::lock_guard<std::mutex> lock(dirty_tracker_lock);
+    for (size_t page = 0; page < watched.size(); ++page) {
+        SetPageWatched(page, true);
+    }
+    dirty_trackers.push_back(this);
+    has_dirty_trackers = true;
+}
+
+DirtyPageTracker::~DirtyPageTracker() {
+    std::lock_guard<std::mutex> lock(dirty_tracker_lock);
+    for (size_t page = 0; page < watched.size(); ++page) {
+        if (watched[page]) {
+            SetPageWatched(page, false);
         }
     }
+    dirty_trackers.erase(std::find(dirty_trackers.begin(), dirty_trackers.end(), this));
+    has_dirty_trackers = !dirty_trackers.empty();
 }
 
-void RasterizerFlushRegion(PAddr start, u64 size) {}
+bool DirtyPageTracker::IsDirty(VAddr addr) const {
+    std::lock_guard<std::mutex> lock(dirty_tracker_lock);
+    const size_t page = static_cast<size_t>((addr - base) >> PAGE_BITS);
+    return addr >= base && page < dirty.size() && dirty[page];
+}
 
-void RasterizerFlushAndInvalidateRegion(PAddr start, u64 size) {
-    // Since pages are unmapped on shutdown after video core is shutdown, the renderer may be
-    // null here
+std::vector<VAddr> DirtyPageTracker::GetDirtyPages() const {
+    std::lock_guard<std::mutex> lock(dirty_tracker_lock);
+    std::vector<VAddr> pages;
+    for (size_t page = 0; page < dirty.size(); ++page) {
+        if (dirty[page]) {
+            pages.push_back(base + (static_cast<VAddr>(page) << PAGE_BITS));
+        }
+    }
+    return pages;
 }
 
-void RasterizerFlushVirtualRegion(VAddr start, u64 size, FlushMode mode) {
-    // Since pages are unmapped on shutdown after video core is shutdown, the renderer may be
-    // null here
+void DirtyPageTracker::Checkpoint() {
+    std::lock_guard<std::mutex> lock(dirty_tracker_lock);
+    for (size_t page = 0; page < dirty.size(); ++page) {
+        dirty[page] = false;
+        if (!watched[page]) {
+            SetPageWatched(page, true);
+        }
+    }
+}
+
+bool DirtyPageTracker::GetPageRange(const PageTable& page_table, VAddr addr, u64 size,
+                                    size_t& first, size_t& last) const {
+    const VAddr end = base + (static_cast<VAddr>(dirty.size()) << PAGE_BITS);
+    if (&page_table != &process.vm_manager.page_table || addr >= end || addr + size <= base) {
+        return false;
+    }
+
+    first = static_cast<size_t>((std::max(addr, base) - base) >> PAGE_BITS);
+    last = static_cast<size_t>((std::min(addr + size, end) - base - 1) >> PAGE_BITS);
+    return true;
+}
+
+void DirtyPageTracker::MarkDirty(const PageTable& page_table, VAddr addr, u64 size,
+                                 bool is_remapped) {
+    size_t first, last;
+    if (!GetPageRange(page_table, addr, size, first, last)) {
+        return;
+    }
+
+    if (on_write) {
+        const VAddr range_begin = std::max(addr, base);
+        const VAddr range_end = std::min(addr + size, base + (VAddr{last + 1} << PAGE_BITS));
+        on_write(range_begin, range_end - range_begin);
+    }
+
+    for (size_t page = first; page <= last; ++page) {
+        dirty[page] = true;
+        if (!watched[page]) {
+            continue;
+        }
+        if (is_remapped) {
+            // Remapping the page resets its cache counter
+            watched[page] = false;
+        } else if (!on_write) {
+            SetPageWatched(page, false);
+        }
+    }
+}
+
+void DirtyPageTracker::Rewatch(const PageTable& page_table, VAddr addr, u64 size) {
+    size_t first, last;
+    if (!on_write || !GetPageRange(page_table, addr, size, first, last)) {
+        return;
+    }
+
+    for (size_t page = first; page <= last; ++page) {
+        if (!watched[page]) {
+            SetPageWatched(page, true);
+        }
+    }
+}
+
+void DirtyPageTracker::SetPageWatched(size_t page, bool is_watched) {
+    PageTable& page_table = process.vm_manager.page_table;
+    const VAddr vaddr = base + (static_cast<VAddr>(page) << PAGE_BITS);
+    if (is_watched) {
+        // Only regular memory can be written to behind the tracker's back
+        const PageType type = page_table.attributes[vaddr >> PAGE_BITS];
+        if (type != PageType::Memory && type != PageType::RasterizerCachedMemory) {
+            return;
+        }
+    }
+    AdjustPageCachedCount(page_table, process, vaddr, is_watched ? 1 : -1);
+    watched[page] = is_watched;
 }
 
 u8 Read8(const VAddr addr) {
@@ -448,7 +882,8 @@ void ReadBlock(const Kernel::Process& process, const VAddr src_addr, void* dest_
     size_t page_offset = src_addr & PAGE_MASK;
 
     while (remaining_size > 0) {
-        const size_t copy_amount = std::min<size_t>(PAGE_SIZE - page_offset, remaining_size);
+        const size_t copy_amount =
+            GetBlockChunkSize(page_table, page_index, page_offset, remaining_size);
         const VAddr current_vaddr = static_cast<VAddr>((page_index << PAGE_BITS) + page_offset);
 
         switch (page_table.attributes[page_index]) {
@@ -489,8 +924,9 @@ void ReadBlock(const Kernel::Process& process, const VAddr src_addr, void* dest_
             UNREACHABLE();
         }
 
-        page_index++;
-        page_offset = 0;
+        const size_t next = page_offset + copy_amount;
+        page_index += next >> PAGE_BITS;
+        page_offset = next & PAGE_MASK;
         dest_buffer = static_cast<u8*>(dest_buffer) + copy_amount;
         remaining_size -= copy_amount;
     }
@@ -524,7 +960,8 @@ void WriteBlock(const Kernel::Process& process, const VAddr dest_addr, const voi
     size_t page_offset = dest_addr & PAGE_MASK;
 
     while (remaining_size > 0) {
-        const size_t copy_amount = std::min<size_t>(PAGE_SIZE - page_offset, remaining_size);
+        const size_t copy_amount =
+            GetBlockChunkSize(page_table, page_index, page_offset, remaining_size);
         const VAddr current_vaddr = static_cast<VAddr>((page_index << PAGE_BITS) + page_offset);
 
         switch (page_table.attributes[page_index]) {
@@ -550,6 +987,7 @@ void WriteBlock(const Kernel::Process& process, const VAddr dest_addr, const voi
         case PageType::RasterizerCachedMemory: {
             RasterizerFlushVirtualRegion(current_vaddr, static_cast<u32>(copy_amount),
                                          FlushMode::FlushAndInvalidate);
+            NotifyDirtyTrackers(page_table, current_vaddr, copy_amount, false);
             std::memcpy(GetPointerFromVMA(process, current_vaddr), src_buffer, copy_amount);
             break;
         }
@@ -565,8 +1003,9 @@ void WriteBlock(const Kernel::Process& process, const VAddr dest_addr, const voi
             UNREACHABLE();
         }
 
-        page_index++;
-        page_offset = 0;
+        const size_t next = page_offset + copy_amount;
+        page_index += next >> PAGE_BITS;
+        page_offset = next & PAGE_MASK;
         src_buffer = static_cast<const u8*>(src_buffer) + copy_amount;
         remaining_size -= copy_amount;
     }
@@ -584,7 +1023,8 @@ void ZeroBlock(const VAddr dest_addr, const size_t size) {
     static const std::array<u8, PAGE_SIZE> zeros = {};
 
     while (remaining_size > 0) {
-        const size_t copy_amount = std::min<size_t>(PAGE_SIZE - page_offset, remaining_size);
+        const size_t copy_amount =
+            GetBlockChunkSize(*current_page_table, page_index, page_offset, remaining_size);
         const VAddr current_vaddr = static_cast<VAddr>((page_index << PAGE_BITS) + page_offset);
 
         switch (current_page_table->attributes[page_index]) {
@@ -609,6 +1049,7 @@ void ZeroBlock(const VAddr dest_addr, const size_t size) {
         case PageType::RasterizerCachedMemory: {
             RasterizerFlushVirtualRegion(current_vaddr, static_cast<u32>(copy_amount),
                                          FlushMode::FlushAndInvalidate);
+            NotifyDirtyTrackers(*current_page_table, current_vaddr, copy_amount, false);
             std::memset(GetPointerFromVMA(current_vaddr), 0, copy_amount);
             break;
         }
@@ -623,8 +1064,9 @@ void ZeroBlock(const VAddr dest_addr, const size_t size) {
             UNREACHABLE();
         }
 
-        page_index++;
-        page_offset = 0;
+        const size_t next = page_offset + copy_amount;
+        page_index += next >> PAGE_BITS;
+        page_offset = next & PAGE_MASK;
         remaining_size -= copy_amount;
     }
 }
@@ -635,7 +1077,8 @@ void CopyBlock(VAddr dest_addr, VAddr src_addr, const size_t size) {
     size_t page_offset = src_addr & PAGE_MASK;
 
     while (remaining_size > 0) {
-        const size_t copy_amount = std::min<size_t>(PAGE_SIZE - page_offset, remaining_size);
+        const size_t copy_amount =
+            GetBlockChunkSize(*current_page_table, page_index, page_offset, remaining_size);
         const VAddr current_vaddr = static_cast<VAddr>((page_index << PAGE_BITS) + page_offset);
 
         switch (current_page_table->attributes[page_index]) {
@@ -679,8 +1122,9 @@ void CopyBlock(VAddr dest_addr, VAddr src_addr, const size_t size) {
             UNREACHABLE();
         }
 
-        page_index++;
-        page_offset = 0;
+        const size_t next = page_offset + copy_amount;
+        page_index += next >> PAGE_BITS;
+        page_offset = next & PAGE_MASK;
         dest_addr += static_cast<VAddr>(copy_amount);
         src_addr += static_cast<VAddr>(copy_amount);
         remaining_size -= copy_amount;
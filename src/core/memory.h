@@ -4,11 +4,16 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <bitset>
 #include <cstddef>
+#include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
+#include <boost/container/small_vector.hpp>
 #include <boost/optional.hpp>
 #include "common/common_types.h"
 #include "core/mmio.h"
@@ -28,7 +33,7 @@ const u64 PAGE_SIZE = 1 << PAGE_BITS;
 const u64 PAGE_MASK = PAGE_SIZE - 1;
 const size_t PAGE_TABLE_NUM_ENTRIES = 1ULL << (36 - PAGE_BITS);
 
-enum class PageType {
+enum class PageType : u8 {
     /// Page is unmapped and should cause an access error.
     Unmapped,
     /// Page is mapped to regular memory. This is the only type you can get pointers to.
@@ -43,24 +48,200 @@ enum class PageType {
     RasterizerCachedSpecial,
 };
 
+/// Handler of special pages. A handler mapped at several places is only listed once, with the
+/// range of its first mapping.
 struct SpecialRegion {
     VAddr base;
     u64 size;
     MMIORegionPointer handler;
 };
 
+/**
+ * Flat array of host pointers, one per guest page. The storage is reserved directly from the host
+ * so that only the parts of the table that have actually been written to are backed by physical
+ * memory. This keeps lookups a single indexed load while leaving the untouched majority of the
+ * 36-bit address space free.
+ */
+class PagePointerArray final {
+public:
+    PagePointerArray();
+    ~PagePointerArray();
+
+    PagePointerArray(const PagePointerArray&) = delete;
+    PagePointerArray& operator=(const PagePointerArray&) = delete;
+
+    u8* operator[](size_t index) const {
+        return table[index];
+    }
+
+    /// Sets the pointer backing the given page.
+    void Set(size_t index, u8* pointer);
+
+    /**
+     * Sets the pointers backing a range of pages. The pages are backed by consecutive pages of
+     * host memory starting at `pointer`, or all set to null if it is null.
+     */
+    void SetRange(size_t index, size_t count, u8* pointer);
+
+    /// Resets every entry to null, returning the committed storage to the host.
+    void Clear();
+
+    /// Raw access to the underlying table, for consumers that walk it directly (e.g. the JIT).
+    u8** data() const {
+        return table;
+    }
+
+    /// Returns the amount of table storage that has been touched, in bytes.
+    size_t GetHostMemoryUsage() const;
+
+private:
+    static constexpr size_t HOST_PAGE_SIZE = 0x1000;
+    static constexpr size_t ENTRIES_PER_HOST_PAGE = HOST_PAGE_SIZE / sizeof(u8*);
+    static constexpr size_t TABLE_SIZE = PAGE_TABLE_NUM_ENTRIES * sizeof(u8*);
+
+    u8** table = nullptr;
+    /// Host pages of `table` that have been written to, and are thus likely committed.
+    std::bitset<PAGE_TABLE_NUM_ENTRIES / ENTRIES_PER_HOST_PAGE> touched_pages;
+};
+
+/**
+ * Two-level array of per-page values that only allocates storage for the regions of the address
+ * space that hold a non-default value. Reading an unpopulated entry yields a value-initialized T
+ * without allocating, and leaves are released again once all their entries are reset.
+ */
+template <typename T>
+class SparsePageArray final {
+public:
+    static constexpr size_t LEAF_BITS = 12;
+    static constexpr size_t LEAF_SIZE = 1ULL << LEAF_BITS;
+    static constexpr size_t LEAF_MASK = LEAF_SIZE - 1;
+    static constexpr size_t NUM_LEAVES = PAGE_TABLE_NUM_ENTRIES >> LEAF_BITS;
+
+    T operator[](size_t index) const {
+        const auto& leaf = leaves[index >> LEAF_BITS];
+        return leaf ? leaf->entries[index & LEAF_MASK] : T{};
+    }
+
+    void Set(size_t index, T value) {
+        auto& leaf = leaves[index >> LEAF_BITS];
+        if (!leaf) {
+            if (value == T{})
+                return;
+            leaf = std::make_unique<Leaf>();
+            ++num_leaves;
+        }
+
+        T& entry = leaf->entries[index & LEAF_MASK];
+        if (entry == T{} && value != T{}) {
+            ++leaf->num_used;
+            ++num_used;
+        } else if (entry != T{} && value == T{}) {
+            --leaf->num_used;
+            --num_used;
+        }
+        entry = value;
+
+        if (leaf->num_used == 0) {
+            leaf.reset();
+            --num_leaves;
+        }
+    }
+
+    /// Sets a range of entries to the same value, a leaf at a time.
+    void Fill(size_t index, size_t count, T value) {
+        const size_t end = index + count;
+        while (index != end) {
+            const size_t leaf_offset = index & LEAF_MASK;
+            const size_t leaf_count = std::min(end - index, LEAF_SIZE - leaf_offset);
+            auto& leaf = leaves[index >> LEAF_BITS];
+            index += leaf_count;
+
+            if (!leaf) {
+                if (value == T{})
+                    continue;
+                leaf = std::make_unique<Leaf>();
+                ++num_leaves;
+            }
+
+            const auto first = leaf->entries.begin() + leaf_offset;
+            const size_t old_used = leaf->num_used;
+            leaf->num_used -= leaf_count - std::count(first, first + leaf_count, T{});
+            std::fill_n(first, leaf_count, value);
+            if (value != T{}) {
+                leaf->num_used += leaf_count;
+            }
+            num_used += leaf->num_used;
+            num_used -= old_used;
+
+            if (leaf->num_used == 0) {
+                leaf.reset();
+                --num_leaves;
+            }
+        }
+    }
+
+    void Clear() {
+        for (auto& leaf : leaves) {
+            leaf.reset();
+        }
+        num_leaves = 0;
+        num_used = 0;
+    }
+
+    /// Returns the first entry from `index` to `end` holding a non-default value, or `end`.
+    size_t FindUsed(size_t index, size_t end) const {
+        while (index != end) {
+            const auto& leaf = leaves[index >> LEAF_BITS];
+            const size_t leaf_end = std::min(end, (index | LEAF_MASK) + 1);
+            if (!leaf) {
+                index = leaf_end;
+                continue;
+            }
+            for (; index != leaf_end; ++index) {
+                if (leaf->entries[index & LEAF_MASK] != T{})
+                    return index;
+            }
+        }
+        return end;
+    }
+
+    /// Returns the number of entries holding a non-default value.
+    size_t GetNumUsed() const {
+        return num_used;
+    }
+
+    /// Returns the amount of host memory held by this array, in bytes.
+    size_t GetHostMemoryUsage() const {
+        return sizeof(leaves) + num_leaves * sizeof(Leaf);
+    }
+
+private:
+    struct Leaf {
+        std::array<T, LEAF_SIZE> entries{};
+        size_t num_used = 0;
+    };
+
+    std::array<std::unique_ptr<Leaf>, NUM_LEAVES> leaves;
+    size_t num_leaves = 0;
+    /// Non-default entries across all leaves
+    size_t num_used = 0;
+};
+
 /**
  * A (reasonably) fast way of allowing switchable and remappable process address spaces. It loosely
  * mimics the way a real CPU page table works, but instead is optimized for minimal decoding and
  * fetching requirements when accessing. In the usual case of an access to regular memory, it only
  * requires an indexed fetch and a check for NULL.
+ *
+ * Host memory is only committed for the parts of the address space that are actually mapped, so an
+ * empty table costs well under a megabyte.
  */
 struct PageTable {
     /**
      * Array of memory pointers backing each page. An entry can only be non-null if the
      * corresponding entry in the `attributes` array is of type `Memory`.
      */
-    std::array<u8*, PAGE_TABLE_NUM_ENTRIES> pointers;
+    PagePointerArray pointers;
 
     /**
      * Contains MMIO handlers that back memory regions whose entries in the `attribute` array is of
@@ -68,17 +249,30 @@ struct PageTable {
      */
     std::vector<SpecialRegion> special_regions;
 
+    /**
+     * Index into `special_regions`, plus one, of the region backing each page, so that the handler
+     * of a `Special` page is found without searching the regions. Zero for every other page.
+     */
+    SparsePageArray<u16> special_region_index;
+
     /**
      * Array of fine grained page attributes. If it is set to any value other than `Memory`, then
      * the corresponding entry in `pointers` MUST be set to null.
      */
-    std::array<PageType, PAGE_TABLE_NUM_ENTRIES> attributes;
+    SparsePageArray<PageType> attributes;
 
     /**
      * Indicates the number of externally cached resources touching a page that should be
-     * flushed before the memory is accessed
+     * flushed before the memory is accessed. Its number of used entries is the number of cached
+     * pages in the table, so regions only have to be flushed while it is non-zero.
      */
-    std::array<u8, PAGE_TABLE_NUM_ENTRIES> cached_res_count;
+    SparsePageArray<u8> cached_res_count;
+
+    /// Marks every page as unmapped and releases the host memory held by the table.
+    void Clear();
+
+    /// Returns the amount of host memory used by the table itself, in bytes.
+    size_t GetHostMemoryUsage() const;
 };
 
 /// Physical memory regions as seen from the ARM11
@@ -217,6 +411,26 @@ void CopyBlock(VAddr dest_addr, VAddr src_addr, size_t size);
 
 u8* GetPointer(VAddr virtual_address);
 
+/// A contiguous run of host memory backing part of a guest virtual address range.
+struct HostSpan {
+    VAddr vaddr;
+    u8* pointer;
+    size_t size;
+};
+
+using HostSpanList = boost::container::small_vector<HostSpan, 4>;
+
+/**
+ * Resolves a guest virtual address range into the runs of host memory backing it, merging adjacent
+ * pages whose backing memory is contiguous on the host. This lets callers access large ranges with
+ * one memcpy per run, or directly in place.
+ * @param spans List the resolved spans are appended to.
+ * @returns false if any part of the range is not regular memory (unmapped, MMIO or rasterizer
+ *          cached), in which case the callers should fall back to ReadBlock/WriteBlock.
+ */
+bool GetHostSpans(const Kernel::Process& process, VAddr vaddr, size_t size, HostSpanList& spans);
+bool GetHostSpans(VAddr vaddr, size_t size, HostSpanList& spans);
+
 std::string ReadCString(VAddr virtual_address, std::size_t max_length);
 
 /**
@@ -268,8 +482,96 @@ enum class FlushMode {
 
 /**
  * Flushes and invalidates any externally cached rasterizer resources touching the given virtual
- * address region.
+ * address region. Pending readbacks overlapping the region are written back whole.
  */
 void RasterizerFlushVirtualRegion(VAddr start, u64 size, FlushMode mode);
 
+/// Writes the contents of a region the rasterizer deferred the readback of back to guest memory
+using ReadbackCallback = std::function<void(VAddr addr, u64 size)>;
+
+/**
+ * Defers writing back a region of the current process the rasterizer wrote to until the CPU
+ * accesses it. The rasterizer is expected to have started an asynchronous download of the region,
+ * for the callback to wait for and copy to the region's host memory. The pages of the region are
+ * marked as cached until then, and the first access to any of them writes the whole region back,
+ * rather than every access flushing on its own. Regions that are never accessed are never written
+ * back, which also tells the rasterizer which of its surfaces the CPU actually reads.
+ *
+ * The callback runs on the thread accessing the region, and must not access guest memory through
+ * the functions in this file.
+ */
+void RasterizerDeferReadback(VAddr addr, u64 size, ReadbackCallback readback);
+
+/// Returns whether a readback is pending for a region of the current process
+bool IsReadbackPending(VAddr addr, u64 size);
+
+/**
+ * Records which pages of a range of a process' memory were written to since the last checkpoint.
+ * Any number of trackers can watch the same pages independently.
+ *
+ * The clean pages are marked as rasterizer cached, like the pages of cached GPU resources, so that
+ * writes to them leave the fast path of the memory accessors and of the JIT. The first write to a
+ * page marks it dirty and lets later writes to it take the fast path again. Pages whose mapping
+ * changes are considered dirty. Writes through host pointers, such as the ones returned by
+ * GetPointer and GetHostSpans, aren't seen.
+ *
+ * A tracker must be destroyed before the process it watches.
+ */
+class DirtyPageTracker final {
+public:
+    /// Called with a written or remapped range before it changes, under the tracker lock
+    using WriteCallback = std::function<void(VAddr addr, u64 size)>;
+
+    /**
+     * Starts watching a page aligned range, all of its pages are clean at first.
+     * @param on_write Optional callback for consumers that react to every change. The pages then
+     *                 stay watched after their first write, so writes to them always take the slow
+     *                 paths. It must not use any tracker.
+     */
+    DirtyPageTracker(Kernel::Process& process, VAddr base, u64 size,
+                     WriteCallback on_write = nullptr);
+    ~DirtyPageTracker();
+
+    DirtyPageTracker(const DirtyPageTracker&) = delete;
+    DirtyPageTracker& operator=(const DirtyPageTracker&) = delete;
+
+    /// Returns whether the page containing an address was written to since the last checkpoint.
+    bool IsDirty(VAddr addr) const;
+
+    /// Returns the addresses of the pages written to since the last checkpoint, in order.
+    std::vector<VAddr> GetDirtyPages() const;
+
+    /// Marks every page as clean again.
+    void Checkpoint();
+
+private:
+    friend void NotifyDirtyTrackers(const PageTable& page_table, VAddr addr, u64 size,
+                                    bool is_remapped);
+    friend void RewatchDirtyTrackers(const PageTable& page_table, VAddr addr, u64 size);
+
+    /**
+     * Gets the pages of the watched process overlapping a range.
+     * @returns false if there are none.
+     */
+    bool GetPageRange(const PageTable& page_table, VAddr addr, u64 size, size_t& first,
+                      size_t& last) const;
+
+    /// Marks the pages of the watched process overlapping a range as dirty
+    void MarkDirty(const PageTable& page_table, VAddr addr, u64 size, bool is_remapped);
+
+    /// Watches remapped pages again if the tracker keeps its pages watched
+    void Rewatch(const PageTable& page_table, VAddr addr, u64 size);
+
+    /// Watches or stops watching a clean page
+    void SetPageWatched(size_t page, bool is_watched);
+
+    Kernel::Process& process;
+    VAddr base;
+    WriteCallback on_write;
+    /// Whether each page was written to since the last checkpoint
+    std::vector<bool> dirty;
+    /// Whether each page is currently marked as cached on behalf of this tracker
+    std::vector<bool> watched;
+};
+
 } // namespace Memory
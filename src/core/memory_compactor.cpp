@@ -0,0 +1,311 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <lz4.h>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "common/memory_util.h"
+#include "core/hle/kernel/process.h"
+#include "core/memory.h"
+#include "core/memory_compactor.h"
+#include "core/memory_setup.h"
+
+namespace Memory {
+
+/// Chunks that don't compress to less than this fraction of their size, in eighths, stay resident
+constexpr u32 MAX_COMPRESSED_EIGHTHS = 7;
+
+/// Range of guest memory to map as regular memory once the mutex is released
+struct MappedRange {
+    VAddr base;
+    u64 size;
+    u8* memory;
+};
+
+/// Returns whether every page of a range is resident memory that can be remapped safely
+static bool IsResident(const PageTable& page_table, VAddr base, u64 size) {
+    for (VAddr page = base >> PAGE_BITS; page < (base + size) >> PAGE_BITS; ++page) {
+        // Clean pages watched by dirty page trackers are rasterizer cached, the trackers handle
+        // their remapping
+        const PageType type = page_table.attributes[page];
+        if (type != PageType::Memory && type != PageType::RasterizerCachedMemory) {
+            return false;
+        }
+    }
+    return true;
+}
+
+MemoryCompactor::MemoryCompactor(Kernel::Process& process) : process(process) {}
+
+u64 MemoryCompactor::Compact() {
+    const std::shared_ptr<std::vector<u8>>& heap = process.heap_memory;
+    if (!heap) {
+        return 0;
+    }
+    ForgetRestoredChunks();
+
+    // Ranges of the heap block mapped by each VMA, to tell the chunks that are mapped only once
+    std::vector<std::pair<size_t, size_t>> block_ranges;
+    for (const auto& entry : process.vm_manager.vma_map) {
+        const Kernel::VirtualMemoryArea& vma = entry.second;
+        if (vma.type == Kernel::VMAType::AllocatedMemoryBlock && vma.backing_block == heap) {
+            block_ranges.emplace_back(vma.offset, vma.offset + static_cast<size_t>(vma.size));
+        }
+    }
+    const auto is_mapped_once = [&block_ranges](size_t begin, size_t end) {
+        return std::count_if(block_ranges.begin(), block_ranges.end(),
+                             [begin, end](const std::pair<size_t, size_t>& range) {
+                                 return range.first < end && begin < range.second;
+                             }) == 1;
+    };
+
+    std::vector<u8> scratch;
+    u64 size_compacted = 0;
+    for (const auto& entry : process.vm_manager.vma_map) {
+        const Kernel::VirtualMemoryArea& vma = entry.second;
+        if (vma.type != Kernel::VMAType::AllocatedMemoryBlock || vma.backing_block != heap ||
+            vma.meminfo_state != Kernel::MemoryState::Heap) {
+            continue;
+        }
+
+        const VAddr vma_end = vma.base + vma.size;
+        VAddr chunk_end;
+        for (VAddr chunk_base = vma.base; chunk_base < vma_end; chunk_base = chunk_end) {
+            // Chunks are aligned in the address space, so that they line up across compactions
+            const VAddr next_chunk = (chunk_base + CHUNK_SIZE) & ~VAddr{CHUNK_SIZE - 1};
+            chunk_end = std::min(next_chunk, vma_end);
+            const u32 size = static_cast<u32>(chunk_end - chunk_base);
+            const size_t offset = vma.offset + static_cast<size_t>(chunk_base - vma.base);
+            // Readbacks are only deferred for the current process, which is the one paused
+            if (!IsResident(process.vm_manager.page_table, chunk_base, size) ||
+                !is_mapped_once(offset, offset + size) || IsReadbackPending(chunk_base, size)) {
+                continue;
+            }
+            if (CompactChunk(chunk_base, size, heap->data() + offset, scratch)) {
+                size_compacted += size;
+            }
+        }
+    }
+
+    LOG_INFO(HW_Memory, "Compacted %llu KiB of heap, %llu KiB compacted in %llu KiB in total",
+             size_compacted / 1024, GetCompactedSize() / 1024, GetCompressedSize() / 1024);
+    return size_compacted;
+}
+
+void MemoryCompactor::RestoreAll() {
+    std::vector<MappedRange> ranges;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& entry : chunks) {
+            Chunk& chunk = entry.second;
+            if (!chunk.data.empty()) {
+                DecompressChunk(chunk);
+                ranges.push_back({entry.first, chunk.size, chunk.memory});
+            }
+        }
+    }
+    for (const MappedRange& range : ranges) {
+        MapMemoryRegion(process.vm_manager.page_table, range.base, range.size, range.memory);
+    }
+    ForgetRestoredChunks();
+}
+
+u64 MemoryCompactor::GetCompactedSize() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return compacted_size;
+}
+
+u64 MemoryCompactor::GetCompressedSize() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return compressed_size;
+}
+
+bool MemoryCompactor::CompactChunk(VAddr base, u32 size, u8* memory, std::vector<u8>& scratch) {
+    scratch.resize(LZ4_compressBound(static_cast<int>(size)));
+    const int result = LZ4_compress_default(
+        reinterpret_cast<const char*>(memory), reinterpret_cast<char*>(scratch.data()),
+        static_cast<int>(size), static_cast<int>(scratch.size()));
+    if (result <= 0 || static_cast<u32>(result) > size / 8 * MAX_COMPRESSED_EIGHTHS) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        chunks[base] = {size, memory, std::vector<u8>(scratch.begin(), scratch.begin() + result)};
+        compacted_size += size;
+        compressed_size += result;
+    }
+    MapIoRegion(process.vm_manager.page_table, base, size, shared_from_this());
+    DiscardMemoryPages(memory, size);
+    return true;
+}
+
+MemoryCompactor::ChunkMap::iterator MemoryCompactor::FindChunk(VAddr addr) {
+    auto itr = chunks.upper_bound(addr);
+    if (itr == chunks.begin()) {
+        return chunks.end();
+    }
+    --itr;
+    return addr - itr->first < itr->second.size ? itr : chunks.end();
+}
+
+void MemoryCompactor::DecompressChunk(Chunk& chunk) {
+    const int bytes_decompressed = LZ4_decompress_safe(
+        reinterpret_cast<const char*>(chunk.data.data()), reinterpret_cast<char*>(chunk.memory),
+        static_cast<int>(chunk.data.size()), static_cast<int>(chunk.size));
+    if (bytes_decompressed != static_cast<int>(chunk.size)) {
+        LOG_CRITICAL(HW_Memory, "Compacted chunk decompressed to %d bytes instead of %u",
+                     bytes_decompressed, chunk.size);
+    }
+    compacted_size -= chunk.size;
+    compressed_size -= chunk.data.size();
+    std::vector<u8>().swap(chunk.data);
+}
+
+void MemoryCompactor::ForgetRestoredChunks() {
+    const PageTable& page_table = process.vm_manager.page_table;
+    std::vector<MappedRange> pages;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto itr = chunks.begin(); itr != chunks.end();) {
+            const Chunk& chunk = itr->second;
+            if (!chunk.data.empty()) {
+                ++itr;
+                continue;
+            }
+            // Chunks restored because part of them was remapped keep the rest of their pages
+            // mapped to this region until then
+            for (u32 offset = 0; offset < chunk.size; offset += PAGE_SIZE) {
+                const VAddr page = itr->first + offset;
+                const u16 index = page_table.special_region_index[page >> PAGE_BITS];
+                if (index != 0 && page_table.special_regions[index - 1].handler.get() == this) {
+                    pages.push_back({page, PAGE_SIZE, chunk.memory + offset});
+                }
+            }
+            itr = chunks.erase(itr);
+        }
+    }
+    for (const MappedRange& page : pages) {
+        MapMemoryRegion(process.vm_manager.page_table, page.base, page.size, page.memory);
+    }
+}
+
+u8* MemoryCompactor::Restore(VAddr addr, bool restore_following) {
+    std::vector<MappedRange> ranges;
+    u8* pointer;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto itr = FindChunk(addr);
+        ASSERT_MSG(itr != chunks.end(), "Access outside of the compacted memory @ 0x%llx", addr);
+        Chunk& chunk = itr->second;
+        pointer = chunk.memory + (addr - itr->first);
+        if (!chunk.data.empty()) {
+            DecompressChunk(chunk);
+            ranges.push_back({itr->first, chunk.size, chunk.memory});
+        } else {
+            // Restored when part of it was remapped, the rest of it may belong to other mappings
+            const u64 page_offset = (addr - itr->first) & ~u64{PAGE_MASK};
+            ranges.push_back({itr->first + page_offset, PAGE_SIZE, chunk.memory + page_offset});
+        }
+
+        // The following chunks are only restored as long as they are contiguous on the host too
+        for (auto prev = itr++; restore_following && itr != chunks.end(); prev = itr++) {
+            Chunk& next = itr->second;
+            if (next.data.empty() || itr->first != prev->first + prev->second.size ||
+                next.memory != prev->second.memory + prev->second.size) {
+                break;
+            }
+            DecompressChunk(next);
+            ranges.push_back({itr->first, next.size, next.memory});
+        }
+    }
+
+    // Later accesses to the chunks go through the page table directly
+    for (const MappedRange& range : ranges) {
+        MapMemoryRegion(process.vm_manager.page_table, range.base, range.size, range.memory);
+    }
+    return pointer;
+}
+
+bool MemoryCompactor::IsValidAddress(VAddr addr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return FindChunk(addr) != chunks.end();
+}
+
+template <typename T>
+T MemoryCompactor::Read(VAddr addr) {
+    T value;
+    std::memcpy(&value, Restore(addr), sizeof(T));
+    return value;
+}
+
+template <typename T>
+void MemoryCompactor::Write(VAddr addr, T data) {
+    std::memcpy(Restore(addr), &data, sizeof(T));
+}
+
+u8 MemoryCompactor::Read8(VAddr addr) {
+    return Read<u8>(addr);
+}
+
+u16 MemoryCompactor::Read16(VAddr addr) {
+    return Read<u16>(addr);
+}
+
+u32 MemoryCompactor::Read32(VAddr addr) {
+    return Read<u32>(addr);
+}
+
+u64 MemoryCompactor::Read64(VAddr addr) {
+    return Read<u64>(addr);
+}
+
+bool MemoryCompactor::ReadBlock(VAddr src_addr, void* dest_buffer, size_t size) {
+    // The memory accessors split blocks at page boundaries, a block is within a chunk
+    std::memcpy(dest_buffer, Restore(src_addr), size);
+    return true;
+}
+
+void MemoryCompactor::Write8(VAddr addr, u8 data) {
+    Write<u8>(addr, data);
+}
+
+void MemoryCompactor::Write16(VAddr addr, u16 data) {
+    Write<u16>(addr, data);
+}
+
+void MemoryCompactor::Write32(VAddr addr, u32 data) {
+    Write<u32>(addr, data);
+}
+
+void MemoryCompactor::Write64(VAddr addr, u64 data) {
+    Write<u64>(addr, data);
+}
+
+bool MemoryCompactor::WriteBlock(VAddr dest_addr, const void* src_buffer, size_t size) {
+    std::memcpy(Restore(dest_addr), src_buffer, size);
+    return true;
+}
+
+u8* MemoryCompactor::GetPointer(VAddr addr) {
+    // The callers may access memory past the chunk, without telling how far
+    return Restore(addr, true);
+}
+
+void MemoryCompactor::OnRemap(VAddr addr, u64 size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto itr = FindChunk(addr);
+    if (itr == chunks.end()) {
+        itr = chunks.lower_bound(addr);
+    }
+    for (; itr != chunks.end() && itr->first < addr + size; ++itr) {
+        if (!itr->second.data.empty()) {
+            DecompressChunk(itr->second);
+        }
+    }
+}
+
+} // namespace Memory
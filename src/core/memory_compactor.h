@@ -0,0 +1,126 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "common/common_types.h"
+#include "core/mmio.h"
+
+namespace Kernel {
+class Process;
+}
+
+namespace Memory {
+
+/**
+ * Side store of the heap of a paused process. Compacting the heap compresses its chunks into the
+ * store, maps them as special pages and hands their host memory back to the host. Each chunk is
+ * decompressed into the heap on its first access, and mapped as regular memory again, so that a
+ * resumed process only brings back the memory it touches. The chunks it didn't touch are still
+ * compacted at the next compaction, which only compresses the chunks touched in between.
+ *
+ * Chunks mapped more than once, such as the ones mirrored with svcMapMemory, and chunks with a
+ * pending rasterizer readback are left alone.
+ */
+class MemoryCompactor final : public MMIORegion,
+                              public std::enable_shared_from_this<MemoryCompactor> {
+public:
+    /// Size of the chunks the heap is compressed in, the chunks at the ends of a mapping may be
+    /// shorter
+    static constexpr u32 CHUNK_SIZE = 0x10000;
+
+    explicit MemoryCompactor(Kernel::Process& process);
+
+    /**
+     * Compresses the resident chunks of the heap. Must only be called while the process is paused,
+     * and after the GPU went idle, as the host memory of the chunks is handed back to the host.
+     * @returns The number of bytes of the heap compacted by this call.
+     */
+    u64 Compact();
+
+    /// Decompresses every compacted chunk back into the heap
+    void RestoreAll();
+
+    /// Bytes of the heap currently compacted
+    u64 GetCompactedSize() const;
+
+    /// Bytes used by the compressed chunks
+    u64 GetCompressedSize() const;
+
+    bool IsValidAddress(VAddr addr) override;
+
+    u8 Read8(VAddr addr) override;
+    u16 Read16(VAddr addr) override;
+    u32 Read32(VAddr addr) override;
+    u64 Read64(VAddr addr) override;
+
+    bool ReadBlock(VAddr src_addr, void* dest_buffer, size_t size) override;
+
+    void Write8(VAddr addr, u8 data) override;
+    void Write16(VAddr addr, u16 data) override;
+    void Write32(VAddr addr, u32 data) override;
+    void Write64(VAddr addr, u64 data) override;
+
+    bool WriteBlock(VAddr dest_addr, const void* src_buffer, size_t size) override;
+
+    u8* GetPointer(VAddr addr) override;
+    void OnRemap(VAddr addr, u64 size) override;
+
+private:
+    struct Chunk {
+        u32 size;
+        /// Host memory the chunk is decompressed to
+        u8* memory;
+        /// Compressed contents, empty once the chunk has been restored
+        std::vector<u8> data;
+    };
+    using ChunkMap = std::map<VAddr, Chunk>;
+
+    /**
+     * Compresses a resident chunk into the store and maps it to this region, unless it doesn't
+     * compress well enough.
+     * @param scratch Buffer the chunk is compressed into first.
+     * @returns Whether the chunk was compacted.
+     */
+    bool CompactChunk(VAddr base, u32 size, u8* memory, std::vector<u8>& scratch);
+
+    /// Returns the chunk containing an address. Needs the mutex.
+    ChunkMap::iterator FindChunk(VAddr addr);
+
+    /// Decompresses a chunk back into its memory. Needs the mutex.
+    void DecompressChunk(Chunk& chunk);
+
+    /// Maps the pages of the restored chunks that are still mapped to this region as regular
+    /// memory, and drops these chunks
+    void ForgetRestoredChunks();
+
+    /**
+     * Restores the chunk containing an address, and maps the pages it can as regular memory.
+     * @param restore_following Whether the compacted chunks right after it are restored as well,
+     *                          for the callers accessing memory past the chunk.
+     * @returns The host memory at the address.
+     */
+    u8* Restore(VAddr addr, bool restore_following = false);
+
+    template <typename T>
+    T Read(VAddr addr);
+
+    template <typename T>
+    void Write(VAddr addr, T data);
+
+    Kernel::Process& process;
+
+    /// Protects the chunks, as every emulated core may access them
+    mutable std::mutex mutex;
+    /// Compacted chunks, and the chunks restored since the last compaction
+    ChunkMap chunks;
+    u64 compacted_size = 0;
+    u64 compressed_size = 0;
+};
+
+} // namespace Memory
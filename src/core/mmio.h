@@ -32,6 +32,20 @@ public:
     virtual void Write64(VAddr addr, u64 data) = 0;
 
     virtual bool WriteBlock(VAddr dest_addr, const void* src_buffer, size_t size) = 0;
+
+    /**
+     * Returns the host memory backing an address, for regions that stand in for regular memory
+     * until it is first accessed. Devices have no such memory and return nullptr.
+     */
+    virtual u8* GetPointer(VAddr addr) {
+        return nullptr;
+    }
+
+    /**
+     * Called before pages of the region are mapped to something else. Regions that stand in for
+     * regular memory write the contents of these pages back to it, for the new mapping to see.
+     */
+    virtual void OnRemap(VAddr addr, u64 size) {}
 };
 
 using MMIORegionPointer = std::shared_ptr<MMIORegion>;
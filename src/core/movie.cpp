@@ -0,0 +1,117 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <utility>
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "core/movie.h"
+
+namespace Core {
+
+constexpr u32 MOVIE_MAGIC = 0x1A564D59; // "YMV\x1A"
+constexpr u32 MOVIE_VERSION = 1;
+
+struct MovieHeader {
+    u32 magic;
+    u32 version;
+    u64 num_records;
+};
+static_assert(sizeof(MovieHeader) == 0x10, "MovieHeader has wrong size");
+
+Movie& Movie::GetInstance() {
+    static Movie instance;
+    return instance;
+}
+
+void Movie::StartRecording(const std::string& path) {
+    LOG_INFO(Core, "Recording the input to %s", path.c_str());
+    mode = Mode::Recording;
+    record_path = path;
+    records.clear();
+    last_ticks = 0;
+}
+
+bool Movie::StartPlayback(const std::string& path) {
+    FileUtil::IOFile file(path, "rb");
+    MovieHeader header{};
+    if (file.ReadBytes(&header, sizeof(header)) != sizeof(header) ||
+        header.magic != MOVIE_MAGIC) {
+        LOG_ERROR(Core, "%s is not a movie", path.c_str());
+        return false;
+    }
+    if (header.version != MOVIE_VERSION) {
+        LOG_ERROR(Core, "Movie %s has unsupported version %u", path.c_str(), header.version);
+        return false;
+    }
+
+    std::vector<Record> loaded_records(header.num_records);
+    if (file.ReadArray(loaded_records.data(), loaded_records.size()) != loaded_records.size()) {
+        LOG_ERROR(Core, "Movie %s is truncated", path.c_str());
+        return false;
+    }
+
+    LOG_INFO(Core, "Playing back the input of %s", path.c_str());
+    mode = Mode::Playing;
+    records = std::move(loaded_records);
+    next_record = 0;
+    return true;
+}
+
+void Movie::SetPlaybackCompletionCallback(std::function<void()> callback) {
+    playback_completion_callback = std::move(callback);
+}
+
+void Movie::HandleInputState(u64 ticks, InputState& state) {
+    switch (mode) {
+    case Mode::None:
+        return;
+    case Mode::Recording:
+        last_ticks = ticks;
+        if (records.empty() || records.back().state != state) {
+            records.push_back({ticks, state});
+        }
+        return;
+    case Mode::Playing:
+        break;
+    }
+
+    // Samples may be taken at any time, so the state is the one of the last record up to it
+    while (next_record < records.size() && records[next_record].ticks <= ticks) {
+        ++next_record;
+    }
+    state = next_record > 0 ? records[next_record - 1].state : InputState{};
+
+    if (next_record == records.size()) {
+        LOG_INFO(Core, "Movie playback finished");
+        mode = Mode::None;
+        if (playback_completion_callback) {
+            playback_completion_callback();
+        }
+    }
+}
+
+void Movie::Shutdown() {
+    if (mode == Mode::Recording) {
+        // The state at the end of the recording marks its length
+        if (!records.empty() && records.back().ticks != last_ticks) {
+            records.push_back({last_ticks, records.back().state});
+        }
+
+        FileUtil::IOFile file(record_path, "wb");
+        const MovieHeader header{MOVIE_MAGIC, MOVIE_VERSION, records.size()};
+        if (file.WriteBytes(&header, sizeof(header)) != sizeof(header) ||
+            file.WriteArray(records.data(), records.size()) != records.size()) {
+            LOG_ERROR(Core, "Failed to write the movie to %s", record_path.c_str());
+        } else {
+            LOG_INFO(Core, "Recorded %zu input states to %s", records.size(),
+                     record_path.c_str());
+        }
+    }
+
+    mode = Mode::None;
+    records.clear();
+    next_record = 0;
+}
+
+} // namespace Core
@@ -0,0 +1,95 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <string>
+#include <vector>
+#include "common/common_funcs.h"
+#include "common/common_types.h"
+
+namespace Core {
+
+/**
+ * Records the controller states the HID service writes into its shared memory, keyed by the guest
+ * time they were sampled at, and plays them back in place of the input devices. With the guest
+ * time advancing deterministically, a played back movie feeds the application exactly the input
+ * of the recording, so the same gameplay can be run unattended on different builds.
+ */
+class Movie final {
+public:
+    /// State of the emulated controller and touch screen, as written into the shared memory
+    struct InputState {
+        u64 buttons;
+        std::array<u32, 4> sticks;
+        u32 touch_x;
+        u32 touch_y;
+        u32 touch_pressed;
+        INSERT_PADDING_WORDS(1);
+
+        bool operator==(const InputState& other) const {
+            return buttons == other.buttons && sticks == other.sticks &&
+                   touch_x == other.touch_x && touch_y == other.touch_y &&
+                   touch_pressed == other.touch_pressed;
+        }
+        bool operator!=(const InputState& other) const {
+            return !(*this == other);
+        }
+    };
+    static_assert(sizeof(InputState) == 0x28, "InputState has wrong size");
+
+    static Movie& GetInstance();
+
+    /// Starts recording the input states, they are written to the file on shutdown
+    void StartRecording(const std::string& path);
+
+    /// Loads a movie and starts playing it back, returns false if the file is not a valid movie
+    bool StartPlayback(const std::string& path);
+
+    /// Sets the function called once the last input state of the played back movie was reached
+    void SetPlaybackCompletionCallback(std::function<void()> callback);
+
+    /// Whether a movie is being recorded or played back
+    bool IsActive() const {
+        return mode != Mode::None;
+    }
+
+    /**
+     * Handles the input state sampled at the given guest time: records it, or replaces it with
+     * the state of the movie at that time.
+     */
+    void HandleInputState(u64 ticks, InputState& state);
+
+    /// Writes the recorded movie and stops the recording or playback
+    void Shutdown();
+
+private:
+    enum class Mode {
+        None,
+        Recording,
+        Playing,
+    };
+
+    struct Record {
+        u64 ticks;
+        InputState state;
+    };
+    static_assert(sizeof(Record) == 0x30, "Record has wrong size");
+
+    Movie() = default;
+
+    Mode mode = Mode::None;
+    std::string record_path;
+    /// Input states in the order of their guest time, only the changes are kept
+    std::vector<Record> records;
+    /// Guest time of the last recorded sample, the end of the recording
+    u64 last_ticks = 0;
+    /// Index of the next record to play back
+    size_t next_record = 0;
+    std::function<void()> playback_completion_callback;
+};
+
+} // namespace Core
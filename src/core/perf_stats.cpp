@@ -2,10 +2,15 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <mutex>
+#include <numeric>
 #include <thread>
+#include <vector>
 #include "common/math_util.h"
+#include "common/microprofile.h"
 #include "core/perf_stats.h"
 #include "core/settings.h"
 
@@ -20,17 +25,118 @@ void PerfStats::BeginSystemFrame() {
     std::lock_guard<std::mutex> lock(object_mutex);
 
     frame_begin = Clock::now();
+    frame_input_time = frame_begin;
+    frame_input_sampled = false;
 }
 
 void PerfStats::EndSystemFrame() {
     std::lock_guard<std::mutex> lock(object_mutex);
 
     auto frame_end = Clock::now();
-    accumulated_frametime += frame_end - frame_begin;
+    const Clock::duration frame_work = frame_end - frame_begin;
+    accumulated_frametime += frame_work;
     system_frames += 1;
 
     previous_frame_length = frame_end - previous_frame_end;
     previous_frame_end = frame_end;
+
+    // Only this thread writes to the ring, readers pick the frame up once the count is published
+    const u64 index = frames_recorded.load(std::memory_order_relaxed);
+    FrameRecord& record = frame_ring[index % FRAME_RING_SIZE];
+    record.length.store(previous_frame_length.count(), std::memory_order_relaxed);
+
+    // The emulation thread's work not spent in the other phases is attributed to the CPU. The
+    // presentation thread works in parallel, its phases aren't part of the remainder.
+    Clock::rep remainder = frame_work.count();
+    for (size_t phase = 0; phase < NUM_FRAME_PHASES; ++phase) {
+        const auto frame_phase = static_cast<FramePhase>(phase);
+        if (frame_phase == FramePhase::CpuEmulation) {
+            continue;
+        }
+        const Clock::rep ticks = phase_ticks[phase].exchange(0, std::memory_order_relaxed);
+        record.phases[phase].store(ticks, std::memory_order_relaxed);
+        if (frame_phase == FramePhase::HleServices || frame_phase == FramePhase::Composition) {
+            remainder -= ticks;
+        }
+    }
+    record.phases[static_cast<size_t>(FramePhase::CpuEmulation)].store(
+        std::max<Clock::rep>(remainder, 0), std::memory_order_relaxed);
+
+    frames_recorded.store(index + 1, std::memory_order_release);
+
+    RecordSessionFrame(frame_end);
+}
+
+void PerfStats::RecordSessionFrame(Clock::time_point frame_end) {
+    const auto bucket = static_cast<size_t>(previous_frame_length / SESSION_FRAMETIME_RESOLUTION);
+    ++session_frametime_histogram[std::min(bucket, NUM_SESSION_FRAMETIME_BUCKETS - 1)];
+    ++session_frames;
+
+    if (++speed_window_frames < SPEED_WINDOW_FRAMES) {
+        return;
+    }
+    constexpr double FRAME_LENGTH = 1.0 / 60; // GPU::SCREEN_REFRESH_RATE;
+    const Clock::duration window = frame_end - speed_window_begin;
+    const double window_seconds = duration_cast<DoubleSecs>(window).count();
+    if (window_seconds > 0.0) {
+        const double speed = SPEED_WINDOW_FRAMES * FRAME_LENGTH / window_seconds;
+        const auto speed_bucket = static_cast<size_t>(speed * 10.0);
+        session_speed_time[std::min(speed_bucket, NUM_SPEED_BUCKETS - 1)] += window;
+    }
+    speed_window_begin = frame_end;
+    speed_window_frames = 0;
+}
+
+void PerfStats::ResetSessionStats() {
+    std::lock_guard<std::mutex> lock(object_mutex);
+
+    session_frametime_histogram.fill(0);
+    session_frames = 0;
+    session_speed_time.fill(Clock::duration::zero());
+    session_begin = Clock::now();
+    speed_window_begin = session_begin;
+    speed_window_frames = 0;
+    // The end of the last frame of the previous session must not be taken for this one's
+    previous_frame_end = session_begin;
+}
+
+PerfStats::SessionStats PerfStats::GetSessionStats() {
+    std::lock_guard<std::mutex> lock(object_mutex);
+
+    SessionStats stats{};
+    stats.system_frames = session_frames;
+    stats.seconds = duration_cast<DoubleSecs>(previous_frame_end - session_begin).count();
+
+    if (session_frames != 0) {
+        // Nearest-rank percentile, the overflowing bucket counts as its lower bound
+        const auto percentile = [this](double fraction) {
+            const auto rank = static_cast<u64>(std::ceil(fraction * session_frames));
+            u64 seen_frames = 0;
+            size_t bucket = 0;
+            for (; bucket + 1 < NUM_SESSION_FRAMETIME_BUCKETS; ++bucket) {
+                seen_frames += session_frametime_histogram[bucket];
+                if (seen_frames >= rank) {
+                    break;
+                }
+            }
+            const size_t bound = std::min(bucket + 1, NUM_SESSION_FRAMETIME_BUCKETS - 1);
+            return duration_cast<DoubleSecs>(SESSION_FRAMETIME_RESOLUTION * bound).count();
+        };
+        stats.frametime_p50 = percentile(0.50);
+        stats.frametime_p95 = percentile(0.95);
+        stats.frametime_p99 = percentile(0.99);
+    }
+
+    const Clock::duration measured_time = std::accumulate(
+        session_speed_time.begin(), session_speed_time.end(), Clock::duration::zero());
+    if (measured_time != Clock::duration::zero()) {
+        for (size_t bucket = 0; bucket < NUM_SPEED_BUCKETS; ++bucket) {
+            stats.speed_distribution[bucket] =
+                duration_cast<DoubleSecs>(session_speed_time[bucket]).count() /
+                duration_cast<DoubleSecs>(measured_time).count();
+        }
+    }
+    return stats;
 }
 
 void PerfStats::EndGameFrame() {
@@ -39,6 +145,49 @@ void PerfStats::EndGameFrame() {
     game_frames += 1;
 }
 
+void PerfStats::RecordInputSample() {
+    std::lock_guard<std::mutex> lock(object_mutex);
+
+    if (!frame_input_sampled) {
+        frame_input_time = Clock::now();
+        frame_input_sampled = true;
+    }
+}
+
+void PerfStats::RecordInputStateChange(std::chrono::steady_clock::time_point change_time) {
+    // The clocks have different epochs, only the age of the change can be carried over
+    const auto age = std::chrono::steady_clock::now() - change_time;
+    const auto now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(object_mutex);
+    if (!has_pending_input_event) {
+        pending_input_event_time = now - duration_cast<Clock::duration>(age);
+        pending_input_event_sample_time = now;
+        has_pending_input_event = true;
+    }
+}
+
+PerfStats::Clock::time_point PerfStats::GetFrameInputTime() {
+    std::lock_guard<std::mutex> lock(object_mutex);
+
+    return frame_input_time;
+}
+
+void PerfStats::EndPresent(Clock::time_point input_time) {
+    std::lock_guard<std::mutex> lock(object_mutex);
+
+    const auto now = Clock::now();
+    accumulated_input_latency += now - input_time;
+    presented_frames += 1;
+
+    // The first frame whose input was sampled after the change is the one showing it
+    if (has_pending_input_event && input_time >= pending_input_event_sample_time) {
+        accumulated_input_event_latency += now - pending_input_event_time;
+        input_events_presented += 1;
+        has_pending_input_event = false;
+    }
+}
+
 PerfStats::Results PerfStats::GetAndResetStats(u64 current_system_time_us) {
     std::lock_guard<std::mutex> lock(object_mutex);
 
@@ -56,16 +205,89 @@ PerfStats::Results PerfStats::GetAndResetStats(u64 current_system_time_us) {
                         static_cast<double>(system_frames);
     results.emulation_speed = system_us_per_second / 1'000'000.0;
 
+    const u64 slices = slices_started.exchange(0);
+    const s64 slice_cycles = accumulated_slice_cycles.exchange(0);
+    results.average_slice_length =
+        slices == 0 ? 0.0 : static_cast<double>(slice_cycles) / static_cast<double>(slices);
+    results.jit_exits_per_frame =
+        static_cast<double>(jit_exits.exchange(0)) / static_cast<double>(system_frames);
+    results.input_latency =
+        presented_frames == 0 ? 0.0
+                              : duration_cast<DoubleSecs>(accumulated_input_latency).count() /
+                                    static_cast<double>(presented_frames);
+    results.input_event_latency =
+        input_events_presented == 0
+            ? 0.0
+            : duration_cast<DoubleSecs>(accumulated_input_event_latency).count() /
+                  static_cast<double>(input_events_presented);
+
+    ComputeFrameTimeStats(results);
+
     // Reset counters
     reset_point = now;
     reset_point_system_us = current_system_time_us;
     accumulated_frametime = Clock::duration::zero();
     system_frames = 0;
     game_frames = 0;
+    presented_frames = 0;
+    accumulated_input_latency = Clock::duration::zero();
+    accumulated_input_event_latency = Clock::duration::zero();
+    input_events_presented = 0;
 
     return results;
 }
 
+void PerfStats::ComputeFrameTimeStats(Results& results) {
+    // An entry may be overwritten while it is read if the emulation thread gets a whole ring
+    // ahead, which only mixes a newer frame into the statistics
+    const u64 end = frames_recorded.load(std::memory_order_acquire);
+    const u64 begin = std::max(frames_recorded_at_reset,
+                               end > FRAME_RING_SIZE ? end - FRAME_RING_SIZE : u64{0});
+    frames_recorded_at_reset = end;
+    if (begin == end) {
+        return;
+    }
+
+    std::vector<Clock::rep> lengths;
+    lengths.reserve(static_cast<size_t>(end - begin));
+    std::array<Clock::rep, NUM_FRAME_PHASES> phase_sums{};
+    for (u64 index = begin; index < end; ++index) {
+        const FrameRecord& record = frame_ring[index % FRAME_RING_SIZE];
+        lengths.push_back(record.length.load(std::memory_order_relaxed));
+        for (size_t phase = 0; phase < NUM_FRAME_PHASES; ++phase) {
+            phase_sums[phase] += record.phases[phase].load(std::memory_order_relaxed);
+        }
+    }
+    std::sort(lengths.begin(), lengths.end());
+
+    const size_t count = lengths.size();
+    const auto to_seconds = [](double ticks) {
+        return duration_cast<DoubleSecs>(std::chrono::duration<double, Clock::period>(ticks))
+            .count();
+    };
+    // Nearest-rank percentile
+    const auto percentile = [&](double fraction) {
+        const auto rank = static_cast<size_t>(std::ceil(fraction * count));
+        return to_seconds(static_cast<double>(lengths[std::clamp<size_t>(rank, 1, count) - 1]));
+    };
+    // Frame rate over the slowest frames, at least the slowest one
+    const auto low_fps = [&](size_t divisor) {
+        const size_t num_slowest = std::max<size_t>(count / divisor, 1);
+        const double total = std::accumulate(lengths.end() - num_slowest, lengths.end(), 0.0);
+        const double average = to_seconds(total / num_slowest);
+        return average > 0.0 ? 1.0 / average : 0.0;
+    };
+
+    results.frametime_p50 = percentile(0.50);
+    results.frametime_p95 = percentile(0.95);
+    results.frametime_p99 = percentile(0.99);
+    results.low_1_percent_fps = low_fps(100);
+    results.low_0_1_percent_fps = low_fps(1000);
+    for (size_t phase = 0; phase < NUM_FRAME_PHASES; ++phase) {
+        results.phase_times[phase] = to_seconds(static_cast<double>(phase_sums[phase]) / count);
+    }
+}
+
 double PerfStats::GetLastFrameTimeScale() {
     std::lock_guard<std::mutex> lock(object_mutex);
 
@@ -73,18 +295,26 @@ double PerfStats::GetLastFrameTimeScale() {
     return duration_cast<DoubleSecs>(previous_frame_length).count() / FRAME_LENGTH;
 }
 
+MICROPROFILE_DEFINE(FrameLimiter, "Core", "Frame Limiting", MP_RGB(128, 128, 128));
+
 void FrameLimiter::DoFrameLimiting(u64 current_system_time_us) {
+    MICROPROFILE_SCOPE(FrameLimiter);
+
     // Max lag caused by slow frames. Can be adjusted to compensate for too many slow frames. Higher
     // values increase the time needed to recover and limit framerate again after spikes.
     constexpr microseconds MAX_LAG_TIME_US = 25ms;
 
-    if (!Settings::values.toggle_framelimit) {
+    const u32 speed_limit = Settings::GetSpeedLimit();
+    if (speed_limit == 0) {
         return;
     }
 
     auto now = Clock::now();
+    previous_frame_work = now - previous_walltime;
 
-    frame_limiting_delta_err += microseconds(current_system_time_us - previous_system_time_us);
+    // Emulated time is paced to walltime scaled by the speed limit, a percentage of native speed
+    const u64 system_time_elapsed_us = current_system_time_us - previous_system_time_us;
+    frame_limiting_delta_err += microseconds(system_time_elapsed_us * 100 / speed_limit);
     frame_limiting_delta_err -= duration_cast<microseconds>(now - previous_walltime);
     frame_limiting_delta_err =
         MathUtil::Clamp(frame_limiting_delta_err, -MAX_LAG_TIME_US, MAX_LAG_TIME_US);
@@ -97,8 +327,66 @@ void FrameLimiter::DoFrameLimiting(u64 current_system_time_us) {
         now = now_after_sleep;
     }
 
+    if (Settings::values.use_low_latency_mode) {
+        // The delay is taken out of the sleep of the next frame by the accumulated error, which
+        // only shifts the frames in time relative to the refreshes of the display
+        now = DelayFrameStart(now);
+    }
+
     previous_system_time_us = current_system_time_us;
     previous_walltime = now;
 }
 
+FrameLimiter::Clock::time_point FrameLimiter::DelayFrameStart(Clock::time_point now) {
+    // Time needed to present a submitted frame before the refresh it is meant for
+    constexpr Clock::duration PRESENT_MARGIN = 2ms;
+
+    const Clock::rep last_vblank_ticks = last_vblank.load(std::memory_order_relaxed);
+    if (last_vblank_ticks == 0) {
+        return now;
+    }
+    const Clock::time_point vblank{Clock::duration(last_vblank_ticks)};
+    const Clock::duration period{vblank_period.load(std::memory_order_relaxed)};
+
+    // First refresh the frame can make if it started now
+    const Clock::time_point ready = now + previous_frame_work + PRESENT_MARGIN;
+    if (ready <= vblank) {
+        return now;
+    }
+    const auto num_periods = (ready - vblank + period - Clock::duration(1)) / period;
+    const Clock::time_point target_vblank = vblank + num_periods * period;
+
+    // Start as late as possible while still making that refresh, never waiting a whole period
+    const Clock::duration delay = std::min(target_vblank - ready, period);
+    if (delay <= Clock::duration::zero()) {
+        return now;
+    }
+    std::this_thread::sleep_for(delay);
+    return Clock::now();
+}
+
+void FrameLimiter::RecordVBlank() {
+    const Clock::rep now = Clock::now().time_since_epoch().count();
+    const Clock::rep previous = last_vblank.exchange(now, std::memory_order_relaxed);
+    if (previous == 0) {
+        return;
+    }
+
+    // Follow the refresh period slowly, ignoring the intervals where refreshes were skipped or
+    // where the emulation didn't keep up
+    const Clock::rep interval = now - previous;
+    const Clock::rep period = vblank_period.load(std::memory_order_relaxed);
+    if (interval > period / 2 && interval < period * 3 / 2) {
+        vblank_period.store(period + (interval - period) / 8, std::memory_order_relaxed);
+        is_vblank_period_measured.store(true, std::memory_order_relaxed);
+    }
+}
+
+FrameLimiter::Clock::duration FrameLimiter::GetVBlankPeriod() const {
+    if (!is_vblank_period_measured.load(std::memory_order_relaxed)) {
+        return Clock::duration::zero();
+    }
+    return Clock::duration(vblank_period.load(std::memory_order_relaxed));
+}
+
 } // namespace Core
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <mutex>
 #include "common/common_types.h"
@@ -18,6 +20,21 @@ class PerfStats {
 public:
     using Clock = std::chrono::high_resolution_clock;
 
+    /// Parts of the work of a system frame, see AddFramePhaseTime
+    enum class FramePhase : u32 {
+        /// Guest code and the rest of the emulation thread's work not counted by the other phases
+        CpuEmulation,
+        /// Handlers of the requests to the HLE services
+        HleServices,
+        /// Copying the composed layers out of guest memory for the renderer
+        Composition,
+        /// Deswizzling and uploading the layers to the host GPU, on the presentation thread
+        Upload,
+        /// Drawing the layers and swapping the buffers, on the presentation thread
+        Present,
+    };
+    static constexpr size_t NUM_FRAME_PHASES = 5;
+
     struct Results {
         /// System FPS (LCD VBlanks) in Hz
         double system_fps;
@@ -27,12 +44,101 @@ public:
         double frametime;
         /// Ratio of walltime / emulated time elapsed
         double emulation_speed;
+        /// Average length of the CoreTiming slices run by the main core, in cycles
+        double average_slice_length;
+        /// Number of times the CPU cores returned from guest code per system frame
+        double jit_exits_per_frame;
+        /// Estimated time between the input of a frame being sampled and the frame being shown on
+        /// the host display, in seconds
+        double input_latency;
+        /// Estimated time between the input state changing on the host and the first frame that
+        /// sampled it being shown on the host display, in seconds
+        double input_event_latency;
+        /// Percentiles of the visible lengths of the system frames (including waits), in seconds
+        double frametime_p50;
+        double frametime_p95;
+        double frametime_p99;
+        /// Frame rate over the slowest 1% and 0.1% of the system frames, in Hz. These show
+        /// stutter that the averages hide.
+        double low_1_percent_fps;
+        double low_0_1_percent_fps;
+        /// Average walltime per system frame spent in each FramePhase, in seconds
+        std::array<double, NUM_FRAME_PHASES> phase_times;
+    };
+
+    /// Number of buckets of the emulation speed distribution, 10% wide, the last one open-ended
+    static constexpr size_t NUM_SPEED_BUCKETS = 21;
+
+    /**
+     * Statistics of the whole emulation session, unaffected by GetAndResetStats. They are kept in
+     * fixed-size histograms, so that they cost the same however long the session is.
+     */
+    struct SessionStats {
+        /// Number of system frames and the walltime they took, in seconds
+        u64 system_frames;
+        double seconds;
+        /// Percentiles of the visible lengths of the system frames, in seconds, rounded up to
+        /// the resolution of the histogram
+        double frametime_p50;
+        double frametime_p95;
+        double frametime_p99;
+        /// Share of the walltime spent at each emulation speed, measured over windows of a
+        /// second of emulated time. Bucket i covers the speeds from i * 10% to (i + 1) * 10%.
+        std::array<double, NUM_SPEED_BUCKETS> speed_distribution;
     };
 
+    /// Starts a new emulation session, forgetting the statistics of the previous one
+    void ResetSessionStats();
+
+    SessionStats GetSessionStats();
+
     void BeginSystemFrame();
     void EndSystemFrame();
     void EndGameFrame();
 
+    /// Records a CoreTiming slice of the given length being started on the main core
+    void AddSlice(s64 cycles) {
+        slices_started.fetch_add(1, std::memory_order_relaxed);
+        accumulated_slice_cycles.fetch_add(cycles, std::memory_order_relaxed);
+    }
+
+    /// Records a CPU core returning from guest code, can be called from any core's thread
+    void AddJitExit() {
+        jit_exits.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Records time spent in a part of the work of the current system frame, can be called from
+     * any thread. The CpuEmulation phase is not recorded, it is what remains of the frame.
+     */
+    void AddFramePhaseTime(FramePhase phase, std::chrono::nanoseconds time) {
+        phase_ticks[static_cast<size_t>(phase)].fetch_add(
+            std::chrono::duration_cast<Clock::duration>(time).count(), std::memory_order_relaxed);
+    }
+
+    /// Records the input devices being sampled for the current system frame
+    void RecordInputSample();
+
+    /**
+     * Records a change of the input state being sampled for the first time, before the sample is
+     * recorded with RecordInputSample.
+     * @param change_time When the input backend noticed the change, on the monotonic host clock
+     */
+    void RecordInputStateChange(std::chrono::steady_clock::time_point change_time);
+
+    /**
+     * Gets when the input of the current system frame was sampled. This is the first sample taken
+     * since the frame began, or the start of the frame if none has been taken yet.
+     */
+    Clock::time_point GetFrameInputTime();
+
+    /**
+     * Records a frame having been shown on the host display, called by the presentation thread
+     * once the buffers have been swapped.
+     * @param input_time When the input of the frame was sampled, from GetFrameInputTime.
+     */
+    void EndPresent(Clock::time_point input_time);
+
     Results GetAndResetStats(u64 current_system_time_us);
 
     /**
@@ -41,7 +147,36 @@ public:
      */
     double GetLastFrameTimeScale();
 
+    /**
+     * Number of system frames the frame time percentiles and lows cover at most, the latest ones.
+     * It is more than a reset interval of the status bar has.
+     */
+    static constexpr size_t FRAME_RING_SIZE = 2048;
+
 private:
+    /**
+     * Lengths of a system frame, in Clock ticks. The fields are atomic as the ring is read without
+     * a lock while the emulation thread may overwrite the oldest entries.
+     */
+    struct FrameRecord {
+        /// Visible length, including frame-limiting and the other waits
+        std::atomic<Clock::rep> length{0};
+        std::array<std::atomic<Clock::rep>, NUM_FRAME_PHASES> phases{};
+    };
+
+    /// Resolution of the session frame time histogram, and the number of its buckets. The last
+    /// bucket holds all the frames longer than the others cover.
+    static constexpr Clock::duration SESSION_FRAMETIME_RESOLUTION = std::chrono::microseconds(100);
+    static constexpr size_t NUM_SESSION_FRAMETIME_BUCKETS = 1000;
+    /// Number of system frames, a second of emulated time, over which the speed is measured
+    static constexpr u32 SPEED_WINDOW_FRAMES = 60;
+
+    /// Fills the frame time statistics of the results from the frames recorded since last reset
+    void ComputeFrameTimeStats(Results& results);
+
+    /// Adds the system frame that just ended to the session statistics
+    void RecordSessionFrame(Clock::time_point frame_end);
+
     std::mutex object_mutex;
 
     /// Point when the cumulative counters were reset
@@ -55,6 +190,42 @@ private:
     u32 system_frames = 0;
     /// Cumulative number of game frames (GSP frame submissions) since last reset
     u32 game_frames = 0;
+    /// Cumulative number of frames shown on the host display since last reset
+    u32 presented_frames = 0;
+    /// Cumulative input-to-photon latency of the frames shown since last reset
+    Clock::duration accumulated_input_latency = Clock::duration::zero();
+    /// Cumulative latency from the input state changes to their frames being shown since last
+    /// reset, and the number of changes it was measured for
+    Clock::duration accumulated_input_event_latency = Clock::duration::zero();
+    u32 input_events_presented = 0;
+
+    // The slice counters are updated on every slice, so they are kept outside of object_mutex
+    /// Cumulative number of CoreTiming slices started since last reset
+    std::atomic<u64> slices_started{0};
+    /// Cumulative length of the CoreTiming slices started since last reset, in cycles
+    std::atomic<s64> accumulated_slice_cycles{0};
+    /// Cumulative number of returns from guest code, over all CPU cores, since last reset
+    std::atomic<u64> jit_exits{0};
+    /// Time spent in each FramePhase during the current system frame, in Clock ticks
+    std::array<std::atomic<Clock::rep>, NUM_FRAME_PHASES> phase_ticks{};
+
+    /// Ring of the lengths of the latest system frames, written by EndSystemFrame only
+    std::array<FrameRecord, FRAME_RING_SIZE> frame_ring;
+    /// Number of frames written to the ring, the latest one is at (frames_recorded - 1) % size
+    std::atomic<u64> frames_recorded{0};
+    /// Value of frames_recorded at the last reset
+    u64 frames_recorded_at_reset = 0;
+
+    /// Point when the session began
+    Clock::time_point session_begin = reset_point;
+    /// Number of system frames of the session in each bucket of their visible length
+    std::array<u32, NUM_SESSION_FRAMETIME_BUCKETS> session_frametime_histogram{};
+    u64 session_frames = 0;
+    /// Walltime of the session spent in each bucket of the emulation speed
+    std::array<Clock::duration, NUM_SPEED_BUCKETS> session_speed_time{};
+    /// Start and number of system frames of the current speed measurement window
+    Clock::time_point speed_window_begin = reset_point;
+    u32 speed_window_frames = 0;
 
     /// Point when the previous system frame ended
     Clock::time_point previous_frame_end = reset_point;
@@ -62,15 +233,53 @@ private:
     Clock::time_point frame_begin = reset_point;
     /// Total visible duration (including frame-limiting, etc.) of the previous system frame
     Clock::duration previous_frame_length = Clock::duration::zero();
+    /// Point when the input of the current system frame was sampled
+    Clock::time_point frame_input_time = reset_point;
+    /// Whether the input has been sampled since the current system frame began
+    bool frame_input_sampled = false;
+    /// Oldest input state change sampled but not shown yet, and when it was sampled
+    Clock::time_point pending_input_event_time;
+    Clock::time_point pending_input_event_sample_time;
+    bool has_pending_input_event = false;
 };
 
+/**
+ * Paces the emulation to the emulated time, and in low latency mode to the refresh of the host
+ * display. DoFrameLimiting is called by the emulation thread between frames, RecordVBlank by the
+ * presentation thread.
+ */
 class FrameLimiter {
 public:
     using Clock = std::chrono::high_resolution_clock;
 
     void DoFrameLimiting(u64 current_system_time_us);
 
+    /// Records the host display refreshing, called when a swap of the presented buffers returned
+    void RecordVBlank();
+
+    /// Gets the estimated refresh period of the host display, zero until it has refreshed twice
+    Clock::duration GetVBlankPeriod() const;
+
 private:
+    /**
+     * Delays the start of the next frame so that it is submitted just in time for the next
+     * refresh of the host display, predicting its length from the previous frame. The input
+     * sampled when the frame starts is then shown with the lowest possible latency.
+     * @returns The walltime after the delay.
+     */
+    Clock::time_point DelayFrameStart(Clock::time_point now);
+
+    /// Walltime taken to emulate the previous frame, excluding the frame limiting
+    Clock::duration previous_frame_work = Clock::duration::zero();
+
+    /// Last refresh of the host display, in Clock ticks since its epoch, zero if none yet
+    std::atomic<Clock::rep> last_vblank{0};
+    /// Whether vblank_period has been measured
+    std::atomic<bool> is_vblank_period_measured{false};
+    /// Estimated refresh period of the host display, in Clock ticks
+    std::atomic<Clock::rep> vblank_period{
+        std::chrono::duration_cast<Clock::duration>(std::chrono::microseconds(16667)).count()};
+
     /// Emulated system time (in microseconds) at the last limiter invocation
     u64 previous_system_time_us = 0;
     /// Walltime at the last limiter invocation
@@ -2,8 +2,11 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <map>
+#include <mutex>
+#include <utility>
+#include "common/thread.h"
 #include "core/gdbstub/gdbstub.h"
-#include "core/hle/service/hid/hid.h"
 #include "core/settings.h"
 #include "video_core/video_core.h"
 
@@ -13,19 +16,55 @@ namespace Settings {
 
 Values values = {};
 
+namespace {
+
+/// Callbacks are called with the mutex held, so that they can't be unregistered while running
+std::mutex apply_callbacks_mutex;
+std::map<size_t, std::function<void()>> apply_callbacks;
+size_t next_apply_callback_id = 0;
+
+} // Anonymous namespace
+
 void Apply() {
 
     GDBStub::SetServerPort(values.gdbstub_port);
     GDBStub::ToggleServer(values.use_gdbstub);
 
     VideoCore::g_toggle_framelimit_enabled = values.toggle_framelimit;
+    Common::SetHostThreadPinning(values.pin_host_threads);
 
     if (VideoCore::g_emu_window) {
         auto layout = VideoCore::g_emu_window->GetFramebufferLayout();
         VideoCore::g_emu_window->UpdateCurrentFramebufferLayout(layout.width, layout.height);
     }
 
-    Service::HID::ReloadInputDevices();
+    std::lock_guard<std::mutex> lock(apply_callbacks_mutex);
+    for (const auto& entry : apply_callbacks) {
+        entry.second();
+    }
+}
+
+size_t RegisterApplyCallback(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(apply_callbacks_mutex);
+    const size_t id = next_apply_callback_id++;
+    apply_callbacks.emplace(id, std::move(callback));
+    return id;
+}
+
+void UnregisterApplyCallback(size_t id) {
+    std::lock_guard<std::mutex> lock(apply_callbacks_mutex);
+    apply_callbacks.erase(id);
+}
+
+u32 GetSpeedLimit() {
+    if (!values.toggle_framelimit) {
+        return 0;
+    }
+    return values.use_turbo_mode ? values.turbo_speed_limit : values.speed_limit;
+}
+
+bool IsRefreshUnlocked() {
+    return values.refresh_mode == RefreshMode::Unlocked || values.use_turbo_mode;
 }
 
 } // namespace Settings
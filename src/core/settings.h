@@ -5,6 +5,8 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
+#include <functional>
 #include <string>
 #include "common/common_types.h"
 
@@ -109,6 +111,16 @@ enum class CpuCore {
     Dynarmic,
 };
 
+enum class RefreshMode {
+    /// The emulated displays refresh at refresh_rate
+    Fixed = 0,
+    /// The emulated displays refresh at the rate of the host display
+    Host = 1,
+    /// The emulated displays refresh as soon as a frame is queued, for benchmarking. Turbo mode
+    /// implies it.
+    Unlocked = 2,
+};
+
 struct Values {
     // Controls
     std::array<std::string, NativeButton::NumButtons> buttons;
@@ -118,6 +130,33 @@ struct Values {
 
     // Core
     CpuCore cpu_core;
+    bool use_multi_core;
+    /// Decompresses large read-only segments of executables on their first access
+    bool use_lazy_module_loading;
+    /// Backs the code of executables with cached images shared by every running instance
+    bool use_shared_module_images;
+    /// Invalidates the JIT translations of code written to at runtime, at the cost of slower
+    /// data accesses to code pages
+    bool use_code_write_detection;
+    /// Percentage of the clock rate of the performance configuration the emulated CPU runs at,
+    /// lower values run fewer guest instructions per emulated frame
+    u32 cpu_clock_percentage;
+    /// Runs the emulation from the guest clock alone, so that the same inputs give the same run
+    /// every time, for reproducible benchmarks. Multi-core and the host-paced refresh are disabled.
+    bool use_deterministic_mode;
+    /// Pins the CPU core, render, audio and input threads to a host processor each, on the first
+    /// NUMA node of the host. Takes effect the next time the emulation starts.
+    bool pin_host_threads;
+    /// Compresses the guest heap while the emulation is paused, decompressing it as it is accessed
+    /// once resumed. Saves host memory for instances that stay paused.
+    bool use_memory_compaction;
+    /// Overrides the settings with the profile of the running title, if it has one. See
+    /// TitleProfile for the settings profiles override.
+    bool use_title_profiles;
+
+    // System
+    /// Whether the console is emulated as docked rather than handheld
+    bool use_docked_mode;
 
     // Data Storage
     bool use_virtual_sd;
@@ -125,11 +164,37 @@ struct Values {
     // Renderer
     float resolution_factor;
     bool toggle_framelimit;
+    /// Percentage of native speed the frame limiter targets, 0 for unlimited
+    u32 speed_limit;
+    /// Percentage of native speed targeted in turbo mode, 0 for unlimited
+    u32 turbo_speed_limit;
+    /// Runs at turbo_speed_limit with the emulated displays unlocked. Toggled by the frontends
+    /// with a hotkey, it isn't read from the config.
+    bool use_turbo_mode;
+    /// Number of frames the emulation may submit before they are presented, from 1 to 3
+    int present_ahead_depth;
+    /// Paces the frames to the host display and samples the input right before each frame
+    bool use_low_latency_mode;
+    RefreshMode refresh_mode;
+    /// Refresh rate of the emulated displays in RefreshMode::Fixed, in Hz
+    u32 refresh_rate;
+    bool use_gpu_unswizzle;
+    /// Draws nothing, for headless runs. Set by the frontends, it isn't read from the config.
+    bool use_null_renderer;
+    /// Whether the null renderer hashes the contents of the frames, set by the frontends too
+    bool hash_null_renderer_frames;
 
     float bg_red;
     float bg_green;
     float bg_blue;
 
+    /// File the presented frames are dumped to as a YUV4MPEG2 video, disabled if empty
+    std::string frame_dump_file;
+
+    // Audio
+    std::string sink_id;
+    bool enable_audio_stretching;
+
     std::string log_filter;
 
     // Debugging
@@ -137,5 +202,27 @@ struct Values {
     u16 gdbstub_port;
 } extern values;
 
+/**
+ * Applies the current values. The subsystems that registered a callback pick them up while the
+ * emulation runs, the others when the emulation is next started.
+ */
 void Apply();
+
+/**
+ * Registers a function called by Apply, on the thread calling it, so that a subsystem picks up
+ * the new values without restarting the emulation. Subsystems used by the emulation thread should
+ * only record that new values are pending, and pick them up between frames. The callback mustn't
+ * register or unregister callbacks.
+ * @returns Id to unregister the callback with.
+ */
+size_t RegisterApplyCallback(std::function<void()> callback);
+
+/// Unregisters a callback, waiting for it to return if Apply is calling it
+void UnregisterApplyCallback(size_t id);
+
+/// Gets the percentage of native speed the emulation is limited to, 0 if it is unlimited
+u32 GetSpeedLimit();
+
+/// Whether the emulated displays refresh as soon as a frame is queued
+bool IsRefreshUnlocked();
 } // namespace Settings
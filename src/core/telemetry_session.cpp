@@ -2,13 +2,20 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <cstring>
+#include <future>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "common/assert.h"
 #include "common/file_util.h"
 #include "common/scm_rev.h"
 #include "common/x64/cpu_detect.h"
 #include "core/core.h"
+#include "core/hle/service/command_stats.h"
 #include "core/settings.h"
 #include "core/telemetry_session.h"
 
@@ -79,7 +86,14 @@ std::future<bool> VerifyLogin(std::string username, std::string token, std::func
 #endif
 }
 
-TelemetrySession::TelemetrySession() {
+/**
+ * Submission of the previous session, still running if the backend is slow. The sessions are
+ * submitted one at a time, and the last one is waited for when the program exits.
+ */
+static std::future<void> pending_submission;
+
+TelemetrySession::TelemetrySession()
+    : field_collection(std::make_unique<Telemetry::FieldCollection>()) {
 #ifdef ENABLE_WEB_SERVICE
     if (Settings::values.enable_telemetry) {
         backend = std::make_unique<WebService::TelemetryJson>(
@@ -122,6 +136,10 @@ TelemetrySession::TelemetrySession() {
     AddField(Telemetry::FieldType::UserSystem, "CPU_Extension_x64_AES", Common::GetCPUCaps().aes);
     AddField(Telemetry::FieldType::UserSystem, "CPU_Extension_x64_AVX", Common::GetCPUCaps().avx);
     AddField(Telemetry::FieldType::UserSystem, "CPU_Extension_x64_AVX2", Common::GetCPUCaps().avx2);
+    AddField(Telemetry::FieldType::UserSystem, "CPU_Extension_x64_AVX512F",
+             Common::GetCPUCaps().avx512f);
+    AddField(Telemetry::FieldType::UserSystem, "CPU_Extension_x64_AVX512BW",
+             Common::GetCPUCaps().avx512bw);
     AddField(Telemetry::FieldType::UserSystem, "CPU_Extension_x64_BMI1", Common::GetCPUCaps().bmi1);
     AddField(Telemetry::FieldType::UserSystem, "CPU_Extension_x64_BMI2", Common::GetCPUCaps().bmi2);
     AddField(Telemetry::FieldType::UserSystem, "CPU_Extension_x64_FMA", Common::GetCPUCaps().fma);
@@ -148,10 +166,98 @@ TelemetrySession::TelemetrySession() {
     // Log user configuration information
     AddField(Telemetry::FieldType::UserConfig, "Core_CpuCore",
              static_cast<int>(Settings::values.cpu_core));
+    AddField(Telemetry::FieldType::UserConfig, "Core_UseMultiCore",
+             Settings::values.use_multi_core);
     AddField(Telemetry::FieldType::UserConfig, "Renderer_ResolutionFactor",
              Settings::values.resolution_factor);
     AddField(Telemetry::FieldType::UserConfig, "Renderer_ToggleFramelimit",
              Settings::values.toggle_framelimit);
+    AddField(Telemetry::FieldType::UserConfig, "Renderer_SpeedLimit", Settings::values.speed_limit);
+    AddField(Telemetry::FieldType::UserConfig, "Renderer_UseGpuUnswizzle",
+             Settings::values.use_gpu_unswizzle);
+}
+
+void TelemetrySession::AddServiceStats() {
+    // Number of services whose statistics are sent, from the one taking the most time
+    constexpr size_t MAX_SERVICES = 8;
+
+    struct ServiceTotals {
+        u64 calls = 0;
+        u64 total_ns = 0;
+        u64 max_ns = 0;
+        u64 unimplemented_calls = 0;
+    };
+    std::map<std::string, ServiceTotals> services;
+    ServiceTotals totals;
+    for (const Service::CommandStatsEntry& entry : Service::GetCommandStatsSnapshot()) {
+        for (ServiceTotals* service : {&services[entry.service_name], &totals}) {
+            service->calls += entry.stats.calls;
+            service->total_ns += entry.stats.total_ns;
+            service->max_ns = std::max(service->max_ns, entry.stats.max_ns);
+            if (!entry.is_implemented) {
+                service->unimplemented_calls += entry.stats.calls;
+            }
+        }
+    }
+
+    AddField(Telemetry::FieldType::Performance, "Shutdown_IPC_Calls", totals.calls);
+    AddField(Telemetry::FieldType::Performance, "Shutdown_IPC_TotalMs", totals.total_ns / 1000000);
+    AddField(Telemetry::FieldType::Performance, "Shutdown_IPC_UnimplementedCalls",
+             totals.unimplemented_calls);
+
+    std::vector<std::pair<std::string, ServiceTotals>> sorted(services.begin(), services.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        return a.second.total_ns > b.second.total_ns;
+    });
+    sorted.resize(std::min(sorted.size(), MAX_SERVICES));
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const std::string prefix = "Shutdown_IPC_Service" + std::to_string(i) + "_";
+        const ServiceTotals& service = sorted[i].second;
+        AddField(Telemetry::FieldType::Performance, (prefix + "Name").c_str(), sorted[i].first);
+        AddField(Telemetry::FieldType::Performance, (prefix + "Calls").c_str(), service.calls);
+        AddField(Telemetry::FieldType::Performance, (prefix + "TotalMs").c_str(),
+                 service.total_ns / 1000000);
+        AddField(Telemetry::FieldType::Performance, (prefix + "MaxUs").c_str(),
+                 service.max_ns / 1000);
+        AddField(Telemetry::FieldType::Performance, (prefix + "UnimplementedCalls").c_str(),
+                 service.unimplemented_calls);
+    }
+}
+
+void TelemetrySession::AddSessionPerfStats(const PerfStats::SessionStats& perf_stats,
+                                           const ARM_Interface::JitStats& jit_stats,
+                                           u64 peak_memory_usage) {
+    using Telemetry::FieldType;
+
+    AddField(FieldType::Performance, "Session_Frames", perf_stats.system_frames);
+    AddField(FieldType::Performance, "Session_Seconds", perf_stats.seconds);
+    AddField(FieldType::Performance, "Session_FrametimeP50", perf_stats.frametime_p50 * 1000.0);
+    AddField(FieldType::Performance, "Session_FrametimeP95", perf_stats.frametime_p95 * 1000.0);
+    AddField(FieldType::Performance, "Session_FrametimeP99", perf_stats.frametime_p99 * 1000.0);
+
+    // The distribution is sent as a single field, the per-mille of the time spent in each bucket
+    std::string speed_distribution;
+    for (size_t bucket = 0; bucket < perf_stats.speed_distribution.size(); ++bucket) {
+        if (bucket != 0) {
+            speed_distribution += ',';
+        }
+        const double per_mille = perf_stats.speed_distribution[bucket] * 1000.0;
+        speed_distribution += std::to_string(static_cast<int>(per_mille + 0.5));
+    }
+    AddField(FieldType::Performance, "Session_SpeedDistribution", std::move(speed_distribution));
+
+    AddField(FieldType::Performance, "Session_PeakMemory", peak_memory_usage);
+
+    AddField(FieldType::Performance, "Session_JitRuns", jit_stats.runs);
+    AddField(FieldType::Performance, "Session_JitRunTimeMs", jit_stats.run_time_ns / 1000000);
+    AddField(FieldType::Performance, "Session_JitHalts", jit_stats.halts);
+    AddField(FieldType::Performance, "Session_JitCacheClears", jit_stats.cache_clears);
+    AddField(FieldType::Performance, "Session_JitCacheInvalidations",
+             jit_stats.cache_invalidations);
+    AddField(FieldType::Performance, "Session_JitTranslatorResets", jit_stats.translator_resets);
+    AddField(FieldType::Performance, "Session_JitInterpreterFallbacks",
+             jit_stats.interpreter_fallbacks);
+    AddField(FieldType::Performance, "Session_JitSvcs", jit_stats.svcs);
 }
 
 TelemetrySession::~TelemetrySession() {
@@ -161,12 +267,16 @@ TelemetrySession::~TelemetrySession() {
                                 .count()};
     AddField(Telemetry::FieldType::Session, "Shutdown_Time", shutdown_time);
 
-    // Complete the session, submitting to web service if necessary
-    // This is just a placeholder to wrap up the session once the core completes and this is
-    // destroyed. This will be moved elsewhere once we are actually doing real I/O with the service.
-    field_collection.Accept(*backend);
-    backend->Complete();
-    backend = nullptr;
+    // Complete the session, submitting to web service if necessary. The fields are all added by
+    // now, they are visited and sent in a single batch without holding up the shutdown.
+    if (pending_submission.valid()) {
+        pending_submission.wait();
+    }
+    pending_submission = std::async(std::launch::async, [fields = std::move(field_collection),
+                                                         visitor = std::move(backend)] {
+        fields->Accept(*visitor);
+        visitor->Complete();
+    });
 }
 
 } // namespace Core
@@ -7,13 +7,16 @@
 #include <future>
 #include <memory>
 #include "common/telemetry.h"
+#include "core/arm/arm_interface.h"
+#include "core/perf_stats.h"
 
 namespace Core {
 
 /**
  * Instruments telemetry for this emulation session. Creates a new set of telemetry fields on each
  * session, logging any one-time fields. Interfaces with the telemetry backend used for submitting
- * data to the web service. Submits session data on close.
+ * data to the web service. Submits session data on close, on a background thread so that the
+ * shutdown doesn't wait for the backend.
  */
 class TelemetrySession : NonCopyable {
 public:
@@ -28,11 +31,28 @@ public:
      */
     template <typename T>
     void AddField(Telemetry::FieldType type, const char* name, T value) {
-        field_collection.AddField(type, name, std::move(value));
+        field_collection->AddField(type, name, std::move(value));
     }
 
+    /**
+     * Adds a summary of the IPC requests to the HLE services: the totals, and the services that
+     * took the most time to handle them.
+     */
+    void AddServiceStats();
+
+    /**
+     * Adds the performance of the whole session: the distributions of the frame times and of the
+     * emulation speed, the peak memory usage, and the JIT statistics.
+     * @param perf_stats Statistics of the frames of the session.
+     * @param jit_stats Statistics of the JIT of all the CPU cores.
+     * @param peak_memory_usage Highest total host memory used by the emulation, in bytes.
+     */
+    void AddSessionPerfStats(const PerfStats::SessionStats& perf_stats,
+                             const ARM_Interface::JitStats& jit_stats, u64 peak_memory_usage);
+
 private:
-    Telemetry::FieldCollection field_collection; ///< Tracks all added fields for the session
+    /// Tracks all added fields for the session, handed over to the submission on close
+    std::unique_ptr<Telemetry::FieldCollection> field_collection;
     std::unique_ptr<Telemetry::VisitorInterface> backend; ///< Backend interface that logs fields
 };
 
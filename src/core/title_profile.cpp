@@ -0,0 +1,107 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <inih/cpp/INIReader.h>
+#include "common/common_paths.h"
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "common/string_util.h"
+#include "core/settings.h"
+#include "core/title_profile.h"
+
+namespace TitleProfile {
+
+static const char* ToString(bool value) {
+    return value ? "true" : "false";
+}
+
+std::string GetPath(u64 program_id) {
+    return FileUtil::GetUserPath(D_CONFIG_IDX) + "profiles" DIR_SEP +
+           Common::StringFromFormat("%016llX.ini", static_cast<unsigned long long>(program_id));
+}
+
+bool Read(const std::string& path, Settings::Values& values) {
+    INIReader reader(path);
+    if (reader.ParseError() < 0) {
+        return false;
+    }
+    // Half of a profile could be worse than none of it
+    if (reader.ParseError() > 0) {
+        LOG_ERROR(Core, "Error on line %d of the profile %s, ignoring it", reader.ParseError(),
+                  path.c_str());
+        return false;
+    }
+
+    values.cpu_core = static_cast<Settings::CpuCore>(
+        reader.GetInteger("Core", "cpu_core", static_cast<long>(values.cpu_core)));
+    values.use_multi_core = reader.GetBoolean("Core", "use_multi_core", values.use_multi_core);
+    values.use_code_write_detection =
+        reader.GetBoolean("Core", "use_code_write_detection", values.use_code_write_detection);
+    values.cpu_clock_percentage = static_cast<u32>(
+        reader.GetInteger("Core", "cpu_clock_percentage", values.cpu_clock_percentage));
+    values.use_lazy_module_loading =
+        reader.GetBoolean("Core", "use_lazy_module_loading", values.use_lazy_module_loading);
+    values.use_shared_module_images =
+        reader.GetBoolean("Core", "use_shared_module_images", values.use_shared_module_images);
+
+    values.resolution_factor = static_cast<float>(
+        reader.GetReal("Renderer", "resolution_factor", values.resolution_factor));
+    values.present_ahead_depth = static_cast<int>(
+        reader.GetInteger("Renderer", "present_ahead_depth", values.present_ahead_depth));
+    values.use_gpu_unswizzle =
+        reader.GetBoolean("Renderer", "use_gpu_unswizzle", values.use_gpu_unswizzle);
+    return true;
+}
+
+void CopyValues(const Settings::Values& from, Settings::Values& to) {
+    to.cpu_core = from.cpu_core;
+    to.use_multi_core = from.use_multi_core;
+    to.use_code_write_detection = from.use_code_write_detection;
+    to.cpu_clock_percentage = from.cpu_clock_percentage;
+    to.use_lazy_module_loading = from.use_lazy_module_loading;
+    to.use_shared_module_images = from.use_shared_module_images;
+
+    to.resolution_factor = from.resolution_factor;
+    to.present_ahead_depth = from.present_ahead_depth;
+    to.use_gpu_unswizzle = from.use_gpu_unswizzle;
+}
+
+boost::optional<double> ReadScore(const std::string& path) {
+    INIReader reader(path);
+    if (reader.ParseError() != 0 || reader.Get("Benchmark", "score", "").empty()) {
+        return boost::none;
+    }
+    return reader.GetReal("Benchmark", "score", 0.0);
+}
+
+bool Write(const std::string& path, const Settings::Values& values, double score) {
+    std::string profile = "[Benchmark]\n";
+    profile += Common::StringFromFormat("score = %.4f\n", score);
+
+    profile += "\n[Core]\n";
+    profile += Common::StringFromFormat("cpu_core = %d\n", static_cast<int>(values.cpu_core));
+    profile += Common::StringFromFormat("use_multi_core = %s\n", ToString(values.use_multi_core));
+    profile += Common::StringFromFormat("use_code_write_detection = %s\n",
+                                        ToString(values.use_code_write_detection));
+    profile += Common::StringFromFormat("cpu_clock_percentage = %u\n", values.cpu_clock_percentage);
+    profile += Common::StringFromFormat("use_lazy_module_loading = %s\n",
+                                        ToString(values.use_lazy_module_loading));
+    profile += Common::StringFromFormat("use_shared_module_images = %s\n",
+                                        ToString(values.use_shared_module_images));
+
+    profile += "\n[Renderer]\n";
+    profile += Common::StringFromFormat("resolution_factor = %g\n", values.resolution_factor);
+    profile += Common::StringFromFormat("present_ahead_depth = %d\n", values.present_ahead_depth);
+    profile += Common::StringFromFormat("use_gpu_unswizzle = %s\n",
+                                        ToString(values.use_gpu_unswizzle));
+
+    if (!FileUtil::CreateFullPath(path) ||
+        FileUtil::WriteStringToFile(true, profile, path.c_str()) != profile.size()) {
+        LOG_ERROR(Core, "Failed to write the profile %s", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace TitleProfile
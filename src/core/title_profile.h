@@ -0,0 +1,48 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+#include <boost/optional.hpp>
+#include "common/common_types.h"
+
+namespace Settings {
+struct Values;
+}
+
+/**
+ * Profiles hold the settings a title runs best with, such as the CPU backend, the multi-core mode
+ * and the renderer options. They are INI files named after the program id of their title, in the
+ * profiles directory of the config directory, and override the global settings while their title
+ * runs. The benchmark runner exports them, along with the score of the run they come from.
+ */
+namespace TitleProfile {
+
+/// Gets the path of the profile of a title
+std::string GetPath(u64 program_id);
+
+/**
+ * Reads a profile over the settings, the settings the profile doesn't set keep their value.
+ * @returns Whether the profile exists and was read.
+ */
+bool Read(const std::string& path, Settings::Values& values);
+
+/// Copies the settings that profiles can override
+void CopyValues(const Settings::Values& from, Settings::Values& to);
+
+/**
+ * Gets the score of the benchmark run a profile was exported from, the emulation speed it reached.
+ * @returns The score, none if the profile doesn't exist or was written by hand.
+ */
+boost::optional<double> ReadScore(const std::string& path);
+
+/**
+ * Writes the settings that profiles can override to a profile, replacing it.
+ * @param score Score of the benchmark run the settings were measured with.
+ * @returns Whether the profile was written.
+ */
+bool Write(const std::string& path, const Settings::Values& values, double score);
+
+} // namespace TitleProfile
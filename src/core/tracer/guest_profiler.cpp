@@ -0,0 +1,379 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "common/string_util.h"
+#include "core/arm/arm_interface.h"
+#include "core/core.h"
+#include "core/core_timing.h"
+#include "core/hle/kernel/thread.h"
+#include "core/hle/lock.h"
+#include "core/loader/symbols.h"
+#include "core/memory.h"
+#include "core/tracer/guest_profiler.h"
+
+namespace GuestProfiler {
+
+namespace detail {
+std::atomic<bool> enabled{false};
+}
+
+namespace {
+
+/// Largest number of return addresses walked per sample, which bounds the cost of a sample
+constexpr size_t MAX_CALLERS = 64;
+
+struct SampleInfo {
+    u32 thread_id;
+    /// Number of addresses of the sample: the PC, the link register, then the return addresses
+    /// of the callers. Zero if the core was idle.
+    u32 num_addresses;
+    /// Index of the first address in the core's addresses
+    size_t first_address;
+};
+
+/// Samples of one emulated CPU core, written by that core with the HLE lock held
+struct CoreBuffer {
+    std::vector<SampleInfo> samples;
+    std::vector<VAddr> addresses;
+    /// Number of samples that didn't fit
+    u64 dropped = 0;
+};
+
+std::array<CoreBuffer, Core::NUM_CPU_CORES> core_buffers;
+/// Set by the sampling event, and cleared by each core as it takes the sample
+std::array<std::atomic<bool>, Core::NUM_CPU_CORES> sample_pending{};
+
+CoreTiming::EventType* sample_event = nullptr;
+u32 sample_rate = 0;
+s64 sample_period = 0;
+size_t max_samples = 0;
+/// Incremented by each Start, so that the sampling event of a previous recording stops
+u64 recording = 0;
+
+void SampleCallback(u64 userdata, int cycles_late) {
+    if (!IsEnabled() || userdata != recording) {
+        return;
+    }
+    for (auto& pending : sample_pending) {
+        pending = true;
+    }
+    CoreTiming::ScheduleEvent(std::max<s64>(sample_period - cycles_late, 1), sample_event,
+                              userdata);
+}
+
+} // Anonymous namespace
+
+void Init() {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    sample_event = CoreTiming::RegisterEvent("GuestProfiler::Sample", SampleCallback);
+    if (IsEnabled()) {
+        CoreTiming::ScheduleEvent(sample_period, sample_event, recording);
+    }
+}
+
+void Shutdown() {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    sample_event = nullptr;
+    for (auto& pending : sample_pending) {
+        pending = false;
+    }
+}
+
+void Start(u32 samples_per_second, size_t max_samples_per_core) {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+
+    for (CoreBuffer& buffer : core_buffers) {
+        buffer.samples.clear();
+        buffer.addresses.clear();
+        buffer.dropped = 0;
+    }
+    for (auto& pending : sample_pending) {
+        pending = false;
+    }
+    sample_rate = std::max(samples_per_second, 1u);
+    sample_period = std::max<s64>(BASE_CLOCK_RATE / sample_rate, 1);
+    max_samples = max_samples_per_core;
+    ++recording;
+    detail::enabled = max_samples_per_core != 0;
+
+    // Otherwise the event is scheduled once the emulated system starts
+    if (sample_event != nullptr && IsEnabled()) {
+        CoreTiming::ScheduleEventThreadsafe(sample_period, sample_event, recording);
+    }
+}
+
+void Stop() {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    detail::enabled = false;
+}
+
+void Sample(size_t core_index, const ARM_Interface& cpu, const Kernel::Thread* thread) {
+    if (!sample_pending[core_index].exchange(false)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    if (!IsEnabled()) {
+        return;
+    }
+    CoreBuffer& buffer = core_buffers[core_index];
+    if (buffer.samples.size() >= max_samples) {
+        ++buffer.dropped;
+        return;
+    }
+
+    SampleInfo sample{thread != nullptr ? thread->GetThreadId() : 0, 0, buffer.addresses.size()};
+    if (thread != nullptr) {
+        buffer.addresses.push_back(cpu.GetPC());
+        buffer.addresses.push_back(cpu.GetReg(30));
+
+        // Each frame record holds the frame pointer of the caller and the return address into
+        // it. The stack grows down, so the callers' records are at higher addresses.
+        VAddr frame = cpu.GetReg(29);
+        for (size_t depth = 0; depth < MAX_CALLERS; ++depth) {
+            if (frame == 0 || frame % 8 != 0 || !Memory::IsValidVirtualAddress(frame) ||
+                !Memory::IsValidVirtualAddress(frame + 8)) {
+                break;
+            }
+            const VAddr next_frame = Memory::Read64(frame);
+            const VAddr return_address = Memory::Read64(frame + 8);
+            if (return_address == 0) {
+                break;
+            }
+            buffer.addresses.push_back(return_address);
+            if (next_frame <= frame) {
+                break;
+            }
+            frame = next_frame;
+        }
+        sample.num_addresses = static_cast<u32>(buffer.addresses.size() - sample.first_address);
+    }
+    buffer.samples.push_back(sample);
+}
+
+namespace {
+
+/// Names the functions of guest addresses, looking up each address only once
+class Symbolizer {
+public:
+    struct Function {
+        std::string name;
+        /// Start of the function, or the address itself if the function isn't known
+        VAddr address;
+    };
+
+    const Function& Get(VAddr address) {
+        auto iter = cache.find(address);
+        if (iter != cache.end()) {
+            return iter->second;
+        }
+
+        const Loader::Symbols::Location location = Loader::Symbols::Lookup(address);
+        Function function;
+        if (location.function.empty()) {
+            function = {Loader::Symbols::Describe(address), address};
+        } else {
+            function = {location.module + '!' + location.function, location.base};
+        }
+        return cache.emplace(address, std::move(function)).first->second;
+    }
+
+private:
+    std::unordered_map<VAddr, Function> cache;
+};
+
+/**
+ * Turns the addresses of a sample into the names of the functions on its call stack, from the
+ * outermost caller to the running function.
+ */
+std::vector<std::string> GetCallStack(Symbolizer& symbolizer, const VAddr* addresses,
+                                      u32 num_addresses) {
+    // A return address follows the call, which may be the last instruction of the function, so
+    // the instruction before it is looked up instead
+    const auto get_caller = [&symbolizer](VAddr return_address) -> const Symbolizer::Function& {
+        return symbolizer.Get(return_address - 4);
+    };
+
+    std::vector<std::string> stack;
+    for (u32 index = num_addresses - 1; index >= 2; --index) {
+        stack.push_back(get_caller(addresses[index]).name);
+    }
+
+    // The link register only holds the caller of the running function until it makes a call or
+    // saves it in its frame record, in which case the caller is already on the frame chain
+    const VAddr pc = addresses[0];
+    const VAddr lr = addresses[1];
+    const Symbolizer::Function& running = symbolizer.Get(pc);
+    const bool is_lr_on_chain = num_addresses > 2 && addresses[2] == lr;
+    if (lr != 0 && !is_lr_on_chain && get_caller(lr).address != running.address) {
+        stack.push_back(get_caller(lr).name);
+    }
+
+    stack.push_back(running.name);
+    return stack;
+}
+
+struct CallTreeNode {
+    u64 total = 0;
+    u64 self = 0;
+    std::map<std::string, std::unique_ptr<CallTreeNode>> children;
+};
+
+void WriteCallTree(std::string& report, const CallTreeNode& node, size_t depth,
+                   double samples_to_percent) {
+    std::vector<std::pair<const std::string*, const CallTreeNode*>> children;
+    for (const auto& child : node.children) {
+        children.emplace_back(&child.first, child.second.get());
+    }
+    std::stable_sort(children.begin(), children.end(), [](const auto& a, const auto& b) {
+        return a.second->total > b.second->total;
+    });
+
+    for (const auto& child : children) {
+        const std::string indent(depth * 2, ' ');
+        report += Common::StringFromFormat(
+            "%7.2f%% %8llu %8llu  %s%s\n", child.second->total * samples_to_percent,
+            static_cast<unsigned long long>(child.second->total),
+            static_cast<unsigned long long>(child.second->self), indent.c_str(),
+            child.first->c_str());
+        WriteCallTree(report, *child.second, depth + 1, samples_to_percent);
+    }
+}
+
+} // Anonymous namespace
+
+bool Export(const std::string& filename, ReportFormat format) {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+
+    // Threads that exited in the meantime are only known by their id
+    std::unordered_map<u32, std::string> thread_names;
+    for (const auto& thread : Kernel::GetThreadList()) {
+        thread_names[thread->GetThreadId()] =
+            Common::StringFromFormat("%s (%u)", thread->GetName().c_str(), thread->GetThreadId());
+    }
+
+    // Identical call stacks of the same thread are merged first, the reports are built from them
+    Symbolizer symbolizer;
+    std::map<std::pair<u32, std::vector<std::string>>, u64> stacks;
+    u64 num_samples = 0;
+    u64 num_idle = 0;
+    u64 num_dropped = 0;
+    for (const CoreBuffer& buffer : core_buffers) {
+        num_dropped += buffer.dropped;
+        for (const SampleInfo& sample : buffer.samples) {
+            if (sample.num_addresses == 0) {
+                ++num_idle;
+                continue;
+            }
+            ++num_samples;
+            ++stacks[{sample.thread_id,
+                      GetCallStack(symbolizer, &buffer.addresses[sample.first_address],
+                                   sample.num_addresses)}];
+        }
+    }
+    const auto get_thread_name = [&thread_names](u32 thread_id) {
+        auto iter = thread_names.find(thread_id);
+        if (iter != thread_names.end()) {
+            return iter->second;
+        }
+        return Common::StringFromFormat("thread-%u", thread_id);
+    };
+
+    const double samples_to_percent = num_samples != 0 ? 100.0 / num_samples : 0.0;
+    std::string report;
+    if (format != ReportFormat::Folded) {
+        report += Common::StringFromFormat(
+            "# %llu samples at %u Hz per core, %llu more while idle, %llu dropped\n",
+            static_cast<unsigned long long>(num_samples), sample_rate,
+            static_cast<unsigned long long>(num_idle),
+            static_cast<unsigned long long>(num_dropped));
+    }
+
+    switch (format) {
+    case ReportFormat::Flat: {
+        // Recursive functions only count once per sample towards their total
+        std::unordered_map<std::string, std::pair<u64, u64>> functions;
+        for (const auto& [key, count] : stacks) {
+            const std::vector<std::string>& stack = key.second;
+            functions[stack.back()].first += count;
+            for (const std::string& name : std::set<std::string>(stack.begin(), stack.end())) {
+                functions[name].second += count;
+            }
+        }
+
+        std::vector<std::pair<std::string, std::pair<u64, u64>>> sorted(functions.begin(),
+                                                                       functions.end());
+        std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+
+        report += "#  Self%     Self  Total%    Total  Function\n";
+        for (const auto& [name, counts] : sorted) {
+            report += Common::StringFromFormat(
+                "%7.2f%% %8llu %6.2f%% %8llu  %s\n", counts.first * samples_to_percent,
+                static_cast<unsigned long long>(counts.first), counts.second * samples_to_percent,
+                static_cast<unsigned long long>(counts.second), name.c_str());
+        }
+        break;
+    }
+    case ReportFormat::CallTree: {
+        CallTreeNode root;
+        for (const auto& [key, count] : stacks) {
+            CallTreeNode* node = &root;
+            const auto descend = [&node, count = count](const std::string& name) {
+                auto& child = node->children[name];
+                if (!child) {
+                    child = std::make_unique<CallTreeNode>();
+                }
+                node = child.get();
+                node->total += count;
+            };
+
+            descend(get_thread_name(key.first));
+            for (const std::string& name : key.second) {
+                descend(name);
+            }
+            node->self += count;
+        }
+
+        report += "#  Total    Total     Self  Function\n";
+        WriteCallTree(report, root, 0, samples_to_percent);
+        break;
+    }
+    case ReportFormat::Folded:
+        for (const auto& [key, count] : stacks) {
+            report += get_thread_name(key.first);
+            for (const std::string& name : key.second) {
+                report += ';' + name;
+            }
+            report += Common::StringFromFormat(" %llu\n", static_cast<unsigned long long>(count));
+        }
+        break;
+    }
+
+    FileUtil::IOFile file(filename, "w");
+    if (!file.IsOpen()) {
+        LOG_ERROR(Core, "Couldn't open %s for writing the guest profile", filename.c_str());
+        return false;
+    }
+    file.WriteBytes(report.data(), report.size());
+    if (!file.IsGood()) {
+        LOG_ERROR(Core, "Couldn't write the guest profile to %s", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace GuestProfiler
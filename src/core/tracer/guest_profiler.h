@@ -0,0 +1,74 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include "common/common_types.h"
+
+class ARM_Interface;
+
+namespace Kernel {
+class Thread;
+}
+
+/**
+ * Sampling profiler of the guest code. While enabled, a CoreTiming event asks every emulated core
+ * for a sample at a fixed rate of emulated time, which each core takes before running its next
+ * slice: the PC and link register of its thread, and the return addresses along the chain of frame
+ * pointers. The samples are symbolized against the functions of the loaded modules when exported.
+ *
+ * Sampling on the emulated clock, instead of with a host timer signal, catches the guest state
+ * between two slices rather than somewhere in the JIT, and keeps the rate independent of the
+ * emulation speed. As the event ends the main core's slice, its samples are evenly spread.
+ */
+namespace GuestProfiler {
+
+enum class ReportFormat {
+    Flat,     ///< Functions by the samples they were running in, and by those they were on
+    CallTree, ///< Indented tree of the call stacks, from the thread entry points down
+    Folded,   ///< One line per distinct call stack, the input of flamegraph tools
+};
+
+namespace detail {
+extern std::atomic<bool> enabled;
+}
+
+inline bool IsEnabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+/// Registers the sampling event, when the emulated system starts
+void Init();
+
+/// Forgets the sampling event, which goes away along with the emulated system
+void Shutdown();
+
+/**
+ * Starts sampling, discarding any previous samples.
+ * @param samples_per_second Rate of the samples of each core, in emulated time.
+ * @param max_samples_per_core Number of samples of a core after which further ones are dropped.
+ */
+void Start(u32 samples_per_second = 1000, size_t max_samples_per_core = 1 << 18);
+
+/// Stops sampling, keeping the samples around for export
+void Stop();
+
+/**
+ * Takes a sample of a core, if one was asked for since its last sample. Called by each core
+ * between slices.
+ * @param core_index Index of the core.
+ * @param cpu CPU of the core, holding the state of the thread.
+ * @param thread Thread the core runs, nullptr if it's idle.
+ */
+void Sample(size_t core_index, const ARM_Interface& cpu, const Kernel::Thread* thread);
+
+/**
+ * Writes a report of the samples to a file.
+ * @returns True on success, false if the file couldn't be written.
+ */
+bool Export(const std::string& filename, ReportFormat format);
+
+} // namespace GuestProfiler
@@ -0,0 +1,160 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <mutex>
+#include "common/logging/log.h"
+#include "core/hle/kernel/hle_ipc.h"
+#include "core/hle/lock.h"
+#include "core/tracer/ipc_capture.h"
+
+namespace IPCCapture {
+
+namespace detail {
+std::atomic<bool> enabled{false};
+}
+
+/// File the records are written to, only accessed with the HLE lock held
+static FileUtil::IOFile capture_file;
+
+bool Start(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+
+    detail::enabled = false;
+    if (!capture_file.Open(filename, "wb")) {
+        LOG_ERROR(Core, "Couldn't open %s for writing the IPC capture", filename.c_str());
+        return false;
+    }
+
+    const FileHeader header{FILE_MAGIC, FILE_VERSION};
+    capture_file.WriteObject(header);
+    detail::enabled = capture_file.IsGood();
+    return detail::enabled;
+}
+
+void Stop() {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    detail::enabled = false;
+    capture_file.Close();
+}
+
+static void CaptureBuffer(std::vector<Buffer>& buffers, const Kernel::GuestView& view) {
+    buffers.push_back({view.Address(), view.ReadAll()});
+}
+
+void BeginRecord(Record& record, const std::string& service_name,
+                 Kernel::HLERequestContext& context) {
+    record.service_name = service_name;
+    record.flags = context.IsDomain() ? RECORD_DOMAIN : 0;
+    std::copy_n(context.CommandBuffer(), record.request.size(), record.request.begin());
+
+    for (size_t index = 0; index < context.BufferDescriptorA().size(); ++index) {
+        CaptureBuffer(record.input_buffers, context.BufferViewA(index));
+    }
+    for (size_t index = 0; index < context.BufferDescriptorX().size(); ++index) {
+        CaptureBuffer(record.input_buffers, context.BufferViewX(index));
+    }
+}
+
+static void WriteBuffers(const std::vector<Buffer>& buffers) {
+    for (const Buffer& buffer : buffers) {
+        const BufferHeader header{buffer.address, buffer.data.size()};
+        capture_file.WriteObject(header);
+        capture_file.WriteBytes(buffer.data.data(), buffer.data.size());
+    }
+}
+
+void EndRecord(Record& record, Kernel::HLERequestContext& context, u32 result) {
+    // The capture may have been stopped while the request was handled
+    if (!capture_file.IsOpen()) {
+        return;
+    }
+
+    record.result = result;
+    if (context.IsAsync()) {
+        record.flags |= RECORD_ASYNC;
+    } else {
+        std::copy_n(context.CommandBuffer(), record.response.size(), record.response.begin());
+        for (size_t index = 0; index < context.BufferDescriptorB().size(); ++index) {
+            CaptureBuffer(record.output_buffers, context.BufferViewB(index));
+        }
+    }
+
+    const RecordHeader header{static_cast<u32>(record.service_name.size()), record.flags,
+                              record.result, static_cast<u32>(record.input_buffers.size()),
+                              static_cast<u32>(record.output_buffers.size())};
+    capture_file.WriteObject(header);
+    capture_file.WriteBytes(record.service_name.data(), record.service_name.size());
+    capture_file.WriteArray(record.request.data(), record.request.size());
+    capture_file.WriteArray(record.response.data(), record.response.size());
+    WriteBuffers(record.input_buffers);
+    WriteBuffers(record.output_buffers);
+
+    if (!capture_file.IsGood()) {
+        LOG_ERROR(Core, "Couldn't write the IPC capture, stopping it");
+        detail::enabled = false;
+        capture_file.Close();
+    }
+}
+
+bool Reader::Open(const std::string& filename) {
+    if (!file.Open(filename, "rb")) {
+        return false;
+    }
+
+    FileHeader header{};
+    if (file.ReadBytes(&header, sizeof(header)) != sizeof(header) || header.magic != FILE_MAGIC) {
+        LOG_ERROR(Core, "%s is not an IPC capture", filename.c_str());
+        return false;
+    }
+    if (header.version != FILE_VERSION) {
+        LOG_ERROR(Core, "IPC capture %s has unsupported version %u", filename.c_str(),
+                  static_cast<u32>(header.version));
+        return false;
+    }
+    return true;
+}
+
+/// Upper bound of the size of a single buffer, to not trust a corrupted capture blindly
+constexpr u64 MAX_BUFFER_SIZE = 0x10000000;
+
+static bool ReadBuffers(FileUtil::IOFile& file, std::vector<Buffer>& buffers, u32 count) {
+    buffers.resize(count);
+    for (Buffer& buffer : buffers) {
+        BufferHeader header{};
+        if (file.ReadBytes(&header, sizeof(header)) != sizeof(header) ||
+            header.size > MAX_BUFFER_SIZE) {
+            return false;
+        }
+
+        buffer.address = header.address;
+        buffer.data.resize(header.size);
+        if (file.ReadBytes(buffer.data.data(), buffer.data.size()) != buffer.data.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Reader::Next(Record& record) {
+    RecordHeader header{};
+    if (file.ReadBytes(&header, sizeof(header)) != sizeof(header)) {
+        return false;
+    }
+
+    record.flags = header.flags;
+    record.result = header.result;
+    record.service_name.resize(header.name_size);
+    if (file.ReadBytes(&record.service_name[0], record.service_name.size()) !=
+            record.service_name.size() ||
+        file.ReadArray(record.request.data(), record.request.size()) != record.request.size() ||
+        file.ReadArray(record.response.data(), record.response.size()) != record.response.size()) {
+        return false;
+    }
+
+    return ReadBuffers(file, record.input_buffers, header.num_input_buffers) &&
+           ReadBuffers(file, record.output_buffers, header.num_output_buffers);
+}
+
+} // namespace IPCCapture
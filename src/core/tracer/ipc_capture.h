@@ -0,0 +1,127 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "common/common_types.h"
+#include "common/file_util.h"
+#include "core/hle/ipc.h"
+
+namespace Kernel {
+class HLERequestContext;
+}
+
+/**
+ * Capture of the IPC requests handled by HLE services. While enabled, every request is written to
+ * a binary file together with the contents of its input buffers, its response and the contents of
+ * its output buffers. The ipc-replay tool feeds a capture back into the services without emulating
+ * a CPU, so that service handlers can be benchmarked and profiled in isolation.
+ *
+ * The file starts with a FileHeader, followed by one record per request. Each record is its
+ * RecordHeader, the name of the service, the request and response command buffers, and then each
+ * input and output buffer as a BufferHeader followed by its contents.
+ */
+namespace IPCCapture {
+
+constexpr u32 FILE_MAGIC = 0x43504959; // "YIPC"
+constexpr u32 FILE_VERSION = 1;
+
+struct FileHeader {
+    u32_le magic;
+    u32_le version;
+};
+static_assert(sizeof(FileHeader) == 8, "FileHeader has incorrect size");
+
+enum RecordFlags : u32 {
+    /// The request was made through a domain
+    RECORD_DOMAIN = 1 << 0,
+    /// The request completed asynchronously, the response was not captured
+    RECORD_ASYNC = 1 << 1,
+};
+
+struct RecordHeader {
+    u32_le name_size;
+    u32_le flags;
+    u32_le result;
+    u32_le num_input_buffers;
+    u32_le num_output_buffers;
+};
+static_assert(sizeof(RecordHeader) == 20, "RecordHeader has incorrect size");
+
+struct BufferHeader {
+    u64_le address;
+    u64_le size;
+};
+static_assert(sizeof(BufferHeader) == 16, "BufferHeader has incorrect size");
+
+/// Contents of a guest buffer referenced by a request
+struct Buffer {
+    VAddr address;
+    std::vector<u8> data;
+};
+
+/// A captured request
+struct Record {
+    std::string service_name;
+    u32 flags = 0;
+    u32 result = 0;
+    std::array<u32, IPC::COMMAND_BUFFER_LENGTH> request{};
+    std::array<u32, IPC::COMMAND_BUFFER_LENGTH> response{};
+    /// Contents of the A and X buffers, before the request was handled
+    std::vector<Buffer> input_buffers;
+    /// Contents of the B buffers, after the request was handled
+    std::vector<Buffer> output_buffers;
+};
+
+namespace detail {
+extern std::atomic<bool> enabled;
+}
+
+inline bool IsEnabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * Starts capturing to a file, replacing its contents.
+ * @returns True on success, false if the file couldn't be opened.
+ */
+bool Start(const std::string& filename);
+
+/// Stops capturing and closes the file
+void Stop();
+
+/**
+ * Captures the request of a context, along with its input buffers. Called before the request is
+ * handled, as the response replaces the request in the command buffer.
+ */
+void BeginRecord(Record& record, const std::string& service_name,
+                 Kernel::HLERequestContext& context);
+
+/// Captures the response and the output buffers of a handled request and writes the record
+void EndRecord(Record& record, Kernel::HLERequestContext& context, u32 result);
+
+/// Reads the records of a capture file in order
+class Reader {
+public:
+    /**
+     * Opens a capture file and checks its header.
+     * @returns True on success, false if the file couldn't be read or isn't a capture.
+     */
+    bool Open(const std::string& filename);
+
+    /**
+     * Reads the next record.
+     * @returns True on success, false at the end of the file or if it is truncated.
+     */
+    bool Next(Record& record);
+
+private:
+    FileUtil::IOFile file;
+};
+
+} // namespace IPCCapture
@@ -0,0 +1,202 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "common/string_util.h"
+#include "core/core.h"
+#include "core/core_timing.h"
+#include "core/hle/kernel/thread.h"
+#include "core/hle/lock.h"
+#include "core/tracer/scheduler_trace.h"
+
+namespace SchedulerTrace {
+
+namespace detail {
+std::atomic<bool> enabled{false};
+}
+
+namespace {
+
+struct Event {
+    u64 ticks;
+    u64 arg;
+    const char* name;
+    u32 thread_id;
+    EventType type;
+};
+
+/// Ring buffer of the events recorded on one emulated CPU core
+struct CoreBuffer {
+    std::vector<Event> events;
+    /// Total number of events recorded, the next one goes to next_event % events.size()
+    u64 next_event = 0;
+
+    template <typename Func>
+    void ForEach(Func func) const {
+        const u64 capacity = events.size();
+        const u64 first = next_event > capacity ? next_event - capacity : 0;
+        for (u64 index = first; index < next_event; ++index) {
+            func(events[index % capacity]);
+        }
+    }
+};
+
+std::array<CoreBuffer, Core::NUM_CPU_CORES> core_buffers;
+
+} // Anonymous namespace
+
+void Start(size_t events_per_core) {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+
+    for (CoreBuffer& buffer : core_buffers) {
+        buffer.events.assign(events_per_core, {});
+        buffer.next_event = 0;
+    }
+    detail::enabled = events_per_core != 0;
+}
+
+void Stop() {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    detail::enabled = false;
+}
+
+void Record(EventType type, u32 thread_id, u64 arg, const char* name) {
+    CoreBuffer& buffer = core_buffers[Core::System::GetInstance().CurrentCoreIndex()];
+    const u64 index = buffer.next_event++ % buffer.events.size();
+    buffer.events[index] = {CoreTiming::GetTicks(), arg, name, thread_id, type};
+}
+
+/// Converts emulated CPU ticks to the microsecond timestamps used by the trace format
+static double TicksToUs(u64 ticks) {
+    return static_cast<double>(ticks) * 1000000.0 / BASE_CLOCK_RATE;
+}
+
+/// Escapes a string for use in a JSON string literal
+static std::string EscapeJson(const std::string& str) {
+    std::string escaped;
+    escaped.reserve(str.size());
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            escaped += Common::StringFromFormat("\\u%04x", c);
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+bool ExportChromeTrace(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+
+    // Threads that exited in the meantime are only known by their id
+    std::unordered_map<u32, std::string> thread_names;
+    for (const auto& thread : Kernel::GetThreadList()) {
+        thread_names[thread->GetThreadId()] = EscapeJson(thread->GetName());
+    }
+    const auto get_thread_name = [&thread_names](u32 thread_id) {
+        auto iter = thread_names.find(thread_id);
+        if (iter != thread_names.end()) {
+            return iter->second;
+        }
+        return Common::StringFromFormat("thread-%u", thread_id);
+    };
+
+    std::vector<std::string> trace_events;
+    trace_events.emplace_back(
+        R"({"name":"process_name","ph":"M","pid":0,"tid":0,"args":{"name":"Emulated CPU"}})");
+
+    for (size_t core = 0; core < core_buffers.size(); ++core) {
+        const CoreBuffer& buffer = core_buffers[core];
+        if (buffer.next_event == 0) {
+            continue;
+        }
+
+        trace_events.emplace_back(Common::StringFromFormat(
+            R"({"name":"thread_name","ph":"M","pid":0,"tid":%zu,"args":{"name":"Core %zu"}})",
+            core, core));
+
+        // Context switches are turned into spans covering the time each thread ran
+        u32 running_thread_id = 0;
+        u64 running_since = 0;
+        const auto end_span = [&](u64 ticks) {
+            if (running_thread_id == 0) {
+                return;
+            }
+            trace_events.emplace_back(Common::StringFromFormat(
+                R"({"name":"%s","cat":"thread","ph":"X","pid":0,"tid":%zu,"ts":%.3f,"dur":%.3f,)"
+                R"("args":{"thread_id":%u}})",
+                get_thread_name(running_thread_id).c_str(), core, TicksToUs(running_since),
+                TicksToUs(ticks - running_since), running_thread_id));
+        };
+
+        u64 last_ticks = 0;
+        buffer.ForEach([&](const Event& event) {
+            last_ticks = event.ticks;
+
+            const char* name = nullptr;
+            const char* arg_name = nullptr;
+            switch (event.type) {
+            case EventType::ContextSwitch:
+                end_span(event.ticks);
+                running_thread_id = event.thread_id;
+                running_since = event.ticks;
+                return;
+            case EventType::WaitBegin:
+                name = "Wait";
+                arg_name = "num_objects";
+                break;
+            case EventType::WakeupScheduled:
+                name = "WakeAfterDelay";
+                arg_name = "nanoseconds";
+                break;
+            case EventType::SvcCall:
+                name = event.name ? event.name : "SVC";
+                arg_name = "svc";
+                break;
+            }
+
+            trace_events.emplace_back(Common::StringFromFormat(
+                R"({"name":"%s","cat":"kernel","ph":"i","s":"t","pid":0,"tid":%zu,"ts":%.3f,)"
+                R"("args":{"thread":"%s","%s":%llu}})",
+                name, core, TicksToUs(event.ticks), get_thread_name(event.thread_id).c_str(),
+                arg_name, static_cast<unsigned long long>(event.arg)));
+        });
+
+        // Close the span of the thread that was still running when the recording stopped
+        end_span(last_ticks);
+    }
+
+    FileUtil::IOFile file(filename, "w");
+    if (!file.IsOpen()) {
+        LOG_ERROR(Core, "Couldn't open %s for writing the scheduler trace", filename.c_str());
+        return false;
+    }
+
+    const std::string header = "{\"traceEvents\":[\n";
+    file.WriteBytes(header.data(), header.size());
+    for (size_t index = 0; index < trace_events.size(); ++index) {
+        const bool is_last = index + 1 == trace_events.size();
+        const std::string line = trace_events[index] + (is_last ? "\n" : ",\n");
+        file.WriteBytes(line.data(), line.size());
+    }
+    const std::string footer = "]}\n";
+    file.WriteBytes(footer.data(), footer.size());
+
+    if (!file.IsGood()) {
+        LOG_ERROR(Core, "Couldn't write the scheduler trace to %s", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace SchedulerTrace
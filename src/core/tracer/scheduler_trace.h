@@ -0,0 +1,60 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include "common/common_types.h"
+
+/**
+ * Low-overhead tracing of the kernel scheduler. While enabled, context switches, waits, wakeup
+ * timers and SVCs are recorded into a fixed-size ring buffer per emulated CPU core, which can be
+ * exported in the Chrome trace event format (viewable in chrome://tracing or Perfetto).
+ *
+ * Events are recorded with the HLE lock held. Callers should check IsEnabled() first, so that
+ * tracing costs a single relaxed load when disabled.
+ */
+namespace SchedulerTrace {
+
+enum class EventType : u8 {
+    ContextSwitch,   ///< A core switched to a thread, thread id 0 meaning it went idle
+    WaitBegin,       ///< A thread started waiting, arg is the number of objects it waits on
+    WakeupScheduled, ///< A thread scheduled its wakeup timer, arg is the delay in nanoseconds
+    SvcCall,         ///< A thread called an SVC, arg is the SVC number
+};
+
+namespace detail {
+extern std::atomic<bool> enabled;
+}
+
+inline bool IsEnabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * Starts recording, discarding any previous recording.
+ * @param events_per_core Capacity of each core's ring buffer, the oldest events are overwritten.
+ */
+void Start(size_t events_per_core = 1 << 16);
+
+/// Stops recording, keeping the recorded events around for export
+void Stop();
+
+/**
+ * Records an event on the calling host thread's CPU core.
+ * @param type Type of the event.
+ * @param thread_id Id of the thread the event is about.
+ * @param arg Event specific argument, see EventType.
+ * @param name Optional static string naming the event, e.g. the name of an SVC.
+ */
+void Record(EventType type, u32 thread_id, u64 arg = 0, const char* name = nullptr);
+
+/**
+ * Writes the recorded events to a file in the Chrome trace event JSON format.
+ * @returns True on success, false if the file couldn't be written.
+ */
+bool ExportChromeTrace(const std::string& filename);
+
+} // namespace SchedulerTrace
@@ -0,0 +1,150 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "common/string_util.h"
+#include "core/core_timing.h"
+#include "core/hle/lock.h"
+#include "core/tracer/svc_trace.h"
+
+namespace SvcTrace {
+
+namespace detail {
+std::atomic<bool> enabled{false};
+}
+
+namespace {
+
+/// Number of SVC numbers the statistics are kept for, higher ones share the last entry
+constexpr size_t NUM_SVCS = 0x80;
+/// Buckets of the latency histograms, bucket N counts the calls that took [2^N, 2^(N+1)) ns
+constexpr size_t NUM_BUCKETS = 40;
+
+struct SvcStats {
+    const char* name;
+    u64 count;
+    u64 total_ns;
+    u64 max_ns;
+    std::array<u64, NUM_BUCKETS> histogram;
+
+    /// Gets an upper bound of the latency of the given fraction of the calls
+    u64 GetPercentileNs(double fraction) const {
+        const u64 target = static_cast<u64>(static_cast<double>(count) * fraction);
+        u64 counted = 0;
+        for (size_t bucket = 0; bucket < NUM_BUCKETS; ++bucket) {
+            counted += histogram[bucket];
+            if (counted > target) {
+                return std::min(max_ns, (u64{2} << bucket) - 1);
+            }
+        }
+        return max_ns;
+    }
+};
+
+struct Call {
+    u64 ticks;
+    u64 duration_ns;
+    Arguments arguments;
+    u64 result;
+    u32 svc;
+    u32 thread_id;
+};
+
+std::array<SvcStats, NUM_SVCS> svc_stats;
+std::vector<Call> calls;
+/// Total number of calls captured, the next one goes to next_call % calls.size()
+u64 next_call = 0;
+
+size_t GetBucket(u64 ns) {
+    size_t bucket = 0;
+    while (ns > 1 && bucket + 1 < NUM_BUCKETS) {
+        ns >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+} // Anonymous namespace
+
+void Start(size_t captured_calls) {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+
+    svc_stats = {};
+    calls.assign(captured_calls, {});
+    next_call = 0;
+    detail::enabled = true;
+}
+
+void Stop() {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    detail::enabled = false;
+}
+
+void Record(u32 svc, const char* name, u32 thread_id, const Arguments& arguments, u64 result,
+            std::chrono::nanoseconds duration) {
+    const u64 duration_ns = static_cast<u64>(duration.count());
+    SvcStats& stats = svc_stats[std::min<size_t>(svc, NUM_SVCS - 1)];
+    stats.name = name;
+    ++stats.count;
+    stats.total_ns += duration_ns;
+    stats.max_ns = std::max(stats.max_ns, duration_ns);
+    ++stats.histogram[GetBucket(duration_ns)];
+
+    if (!calls.empty()) {
+        calls[next_call++ % calls.size()] = {CoreTiming::GetTicks(), duration_ns, arguments,
+                                             result, svc, thread_id};
+    }
+}
+
+bool Export(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+
+    std::string text = "svc  name                            count     total_us  mean_ns  "
+                       "p50_ns    p99_ns    max_ns\n";
+    for (size_t svc = 0; svc < NUM_SVCS; ++svc) {
+        const SvcStats& stats = svc_stats[svc];
+        if (stats.count == 0) {
+            continue;
+        }
+        text += Common::StringFromFormat(
+            "0x%02zx %-31s %-9llu %-9llu %-8llu %-9llu %-9llu %llu\n", svc,
+            stats.name ? stats.name : "unknown", static_cast<unsigned long long>(stats.count),
+            static_cast<unsigned long long>(stats.total_ns / 1000),
+            static_cast<unsigned long long>(stats.total_ns / stats.count),
+            static_cast<unsigned long long>(stats.GetPercentileNs(0.5)),
+            static_cast<unsigned long long>(stats.GetPercentileNs(0.99)),
+            static_cast<unsigned long long>(stats.max_ns));
+    }
+
+    if (!calls.empty()) {
+        text += "\nticks            thread svc  duration_ns result             arguments\n";
+        const u64 first = next_call > calls.size() ? next_call - calls.size() : 0;
+        for (u64 index = first; index < next_call; ++index) {
+            const Call& call = calls[index % calls.size()];
+            text += Common::StringFromFormat("%-16llu %-6u 0x%02x %-11llu 0x%016llx",
+                                             static_cast<unsigned long long>(call.ticks),
+                                             call.thread_id, call.svc,
+                                             static_cast<unsigned long long>(call.duration_ns),
+                                             static_cast<unsigned long long>(call.result));
+            for (u64 argument : call.arguments) {
+                text += Common::StringFromFormat(" 0x%llx",
+                                                 static_cast<unsigned long long>(argument));
+            }
+            text += '\n';
+        }
+    }
+
+    FileUtil::IOFile file(filename, "w");
+    if (!file.IsOpen() || file.WriteBytes(text.data(), text.size()) != text.size()) {
+        LOG_ERROR(Core, "Couldn't write the SVC trace to %s", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace SvcTrace
@@ -0,0 +1,64 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include "common/common_types.h"
+
+/**
+ * Opt-in tracing of the SVCs. While enabled, the number of calls and a histogram of the host time
+ * spent in each SVC are kept, and the calls can also be captured with their arguments into a
+ * fixed-size ring buffer.
+ *
+ * Calls are recorded with the HLE lock held. Callers should check IsEnabled() first, so that
+ * tracing costs a single relaxed load when disabled.
+ */
+namespace SvcTrace {
+
+/// Number of argument registers captured with each call
+constexpr size_t NUM_ARGUMENTS = 8;
+
+using Arguments = std::array<u64, NUM_ARGUMENTS>;
+
+namespace detail {
+extern std::atomic<bool> enabled;
+}
+
+inline bool IsEnabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * Starts tracing, discarding the previous statistics and captured calls.
+ * @param captured_calls Capacity of the ring buffer of the captured calls, the oldest calls are
+ *                       overwritten. With 0, only the statistics are kept.
+ */
+void Start(size_t captured_calls = 0);
+
+/// Stops tracing, keeping the statistics and captured calls around for export
+void Stop();
+
+/**
+ * Records a completed SVC.
+ * @param svc Number of the SVC.
+ * @param name Static string naming the SVC, or nullptr if it is unknown.
+ * @param thread_id Id of the calling thread.
+ * @param arguments Argument registers at the call.
+ * @param result Value of the first register once the SVC returned.
+ * @param duration Host time spent handling the SVC.
+ */
+void Record(u32 svc, const char* name, u32 thread_id, const Arguments& arguments, u64 result,
+            std::chrono::nanoseconds duration);
+
+/**
+ * Writes the statistics of each SVC called, followed by the captured calls, to a text file.
+ * @returns True on success, false if the file couldn't be written.
+ */
+bool Export(const std::string& filename);
+
+} // namespace SvcTrace
@@ -0,0 +1,387 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <lz4.h>
+#include "common/assert.h"
+#include "common/hash.h"
+#include "common/logging/log.h"
+#include "common/thread.h"
+#include "common/threadsafe_queue.h"
+#include "core/tracer/workload_trace.h"
+
+namespace WorkloadTrace {
+
+namespace detail {
+std::atomic<bool> enabled{false};
+}
+
+namespace {
+
+/// The records are compressed and written in chunks of about this size
+constexpr size_t CHUNK_SIZE = 0x100000;
+/// Upper bound of the size of a chunk or a record, to not trust a corrupted trace blindly
+constexpr size_t MAX_SIZE = 0x10000000;
+
+/// Compresses the chunks of records and writes them to the file on its own thread
+class Writer {
+public:
+    explicit Writer(FileUtil::IOFile file_) : file(std::move(file_)) {
+        thread = std::thread(&Writer::RunLoop, this);
+    }
+
+    /// Writes the chunks pushed so far before returning
+    ~Writer() {
+        running = false;
+        wakeup_event.Set();
+        thread.join();
+    }
+
+    void Push(std::vector<u8> chunk) {
+        pending_chunks.Push(std::move(chunk));
+        wakeup_event.Set();
+    }
+
+private:
+    void RunLoop() {
+        std::vector<u8> chunk;
+        while (true) {
+            if (!pending_chunks.Pop(chunk)) {
+                // The chunks pushed before stopping are still written
+                if (!running) {
+                    break;
+                }
+                wakeup_event.Wait();
+                continue;
+            }
+            WriteChunk(chunk);
+        }
+    }
+
+    void WriteChunk(const std::vector<u8>& chunk) {
+        const int size = static_cast<int>(chunk.size());
+        compressed.resize(LZ4_compressBound(size));
+        const int compressed_size = LZ4_compress_default(
+            reinterpret_cast<const char*>(chunk.data()), reinterpret_cast<char*>(compressed.data()),
+            size, static_cast<int>(compressed.size()));
+        ASSERT_MSG(compressed_size > 0, "Couldn't compress a chunk of the workload trace");
+
+        const ChunkHeader header{static_cast<u32>(compressed_size), static_cast<u32>(size)};
+        file.WriteObject(header);
+        file.WriteBytes(compressed.data(), compressed_size);
+        if (!file.IsGood() && !failed) {
+            LOG_ERROR(Core, "Couldn't write the workload trace, it will be truncated");
+            failed = true;
+        }
+    }
+
+    FileUtil::IOFile file;
+    std::vector<u8> compressed;
+    bool failed = false;
+
+    Common::SPSCQueue<std::vector<u8>, false> pending_chunks;
+    Common::Event wakeup_event;
+    std::atomic<bool> running{true};
+    std::thread thread;
+};
+
+/// Guards the state below, records are made by the services with the HLE lock held but tracing is
+/// started and stopped by the frontend
+std::mutex trace_mutex;
+std::unique_ptr<Writer> writer;
+/// Records not handed to the writer yet
+std::vector<u8> chunk;
+/// Hashes of the contents of the blobs written so far
+std::unordered_set<u64> written_blobs;
+/// Scratch buffer the command lists are read into
+std::vector<u8> command_list;
+
+void Append(const void* data, size_t size) {
+    const u8* const bytes = static_cast<const u8*>(data);
+    chunk.insert(chunk.end(), bytes, bytes + size);
+}
+
+template <typename T>
+void AppendObject(const T& object) {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+    Append(&object, sizeof(T));
+}
+
+void AppendRecordHeader(RecordType type, size_t size) {
+    ASSERT_MSG(size <= MAX_SIZE, "Record of the workload trace is too large");
+    AppendObject(RecordHeader{static_cast<u32>(type), static_cast<u32>(size)});
+}
+
+/// Hands the records to the writer once they fill a chunk
+void FinishRecord() {
+    if (chunk.size() >= CHUNK_SIZE) {
+        writer->Push(std::move(chunk));
+        chunk.clear();
+    }
+}
+
+/// Appends a blob with the given contents unless one was written already, returns its hash
+u64 AppendBlob(const void* data, size_t size) {
+    const u64 hash = Common::ComputeFastHash64(data, size);
+    if (written_blobs.insert(hash).second) {
+        AppendRecordHeader(RecordType::Blob, sizeof(BlobHeader) + size);
+        AppendObject(BlobHeader{hash, size});
+        Append(data, size);
+        FinishRecord();
+    }
+    return hash;
+}
+
+} // Anonymous namespace
+
+bool Start(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+
+    detail::enabled = false;
+    writer.reset();
+
+    FileUtil::IOFile file(filename, "wb");
+    const FileHeader header{FILE_MAGIC, FILE_VERSION};
+    if (!file.IsOpen() || file.WriteObject(header) != 1) {
+        LOG_ERROR(Core, "Couldn't open %s for writing the workload trace", filename.c_str());
+        return false;
+    }
+
+    chunk.clear();
+    chunk.reserve(CHUNK_SIZE);
+    written_blobs.clear();
+    writer = std::make_unique<Writer>(std::move(file));
+    detail::enabled = true;
+    return true;
+}
+
+void Stop() {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+
+    detail::enabled = false;
+    if (writer == nullptr) {
+        return;
+    }
+    if (!chunk.empty()) {
+        writer->Push(std::move(chunk));
+        chunk.clear();
+    }
+    writer.reset();
+    written_blobs.clear();
+}
+
+void RecordIPC(const std::string& service_name, u32 result, const u32* request,
+               const u32* response) {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (writer == nullptr) {
+        return;
+    }
+
+    constexpr size_t command_buffer_size = IPC::COMMAND_BUFFER_LENGTH * sizeof(u32);
+    AppendRecordHeader(RecordType::IPC,
+                       sizeof(IPCHeader) + service_name.size() + 2 * command_buffer_size);
+    AppendObject(IPCHeader{static_cast<u32>(service_name.size()), result, response == nullptr});
+    Append(service_name.data(), service_name.size());
+    Append(request, command_buffer_size);
+    if (response != nullptr) {
+        Append(response, command_buffer_size);
+    } else {
+        chunk.resize(chunk.size() + command_buffer_size, 0);
+    }
+    FinishRecord();
+}
+
+void RecordIoctl(u32 fd, u32 command, u32 result, const std::vector<u8>& input, const u8* output,
+                 size_t output_size) {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (writer == nullptr) {
+        return;
+    }
+
+    IoctlHeader header{};
+    header.fd = fd;
+    header.command = command;
+    header.result = result;
+    header.input_hash = AppendBlob(input.data(), input.size());
+    header.output_hash = AppendBlob(output, output_size);
+
+    AppendRecordHeader(RecordType::Ioctl, sizeof(header));
+    AppendObject(header);
+    FinishRecord();
+}
+
+void RecordSubmission(const Tegra::MemoryManager& memory_manager,
+                      const std::vector<Tegra::CommandListHeader>& entries) {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (writer == nullptr) {
+        return;
+    }
+
+    for (const Tegra::CommandListHeader& entry : entries) {
+        // Command lists at unmapped addresses are skipped, the GPU reports them
+        command_list.resize(entry.size * sizeof(u32));
+        if (!memory_manager.ReadBlock(entry.addr, command_list.data(), command_list.size())) {
+            continue;
+        }
+
+        const u64 hash = AppendBlob(command_list.data(), command_list.size());
+        AppendRecordHeader(RecordType::Memory, sizeof(MemoryHeader));
+        AppendObject(MemoryHeader{entry.addr, hash});
+        FinishRecord();
+    }
+
+    const size_t entries_size = entries.size() * sizeof(Tegra::CommandListHeader);
+    AppendRecordHeader(RecordType::Submission, sizeof(SubmissionHeader) + entries_size);
+    AppendObject(SubmissionHeader{static_cast<u32>(entries.size())});
+    Append(entries.data(), entries_size);
+    FinishRecord();
+}
+
+bool Reader::Open(const std::string& filename) {
+    if (!file.Open(filename, "rb")) {
+        return false;
+    }
+
+    FileHeader header{};
+    if (file.ReadBytes(&header, sizeof(header)) != sizeof(header) || header.magic != FILE_MAGIC) {
+        LOG_ERROR(Core, "%s is not a workload trace", filename.c_str());
+        return false;
+    }
+    if (header.version != FILE_VERSION) {
+        LOG_ERROR(Core, "Workload trace %s has unsupported version %u", filename.c_str(),
+                  static_cast<u32>(header.version));
+        return false;
+    }
+    return true;
+}
+
+bool Reader::ReadChunk() {
+    ChunkHeader header{};
+    if (file.ReadBytes(&header, sizeof(header)) != sizeof(header) || header.size > MAX_SIZE ||
+        header.compressed_size > static_cast<u32>(LZ4_compressBound(header.size))) {
+        return false;
+    }
+
+    std::vector<u8> compressed(header.compressed_size);
+    if (file.ReadBytes(compressed.data(), compressed.size()) != compressed.size()) {
+        return false;
+    }
+
+    chunk.resize(header.size);
+    chunk_offset = 0;
+    const int size = LZ4_decompress_safe(reinterpret_cast<const char*>(compressed.data()),
+                                         reinterpret_cast<char*>(chunk.data()),
+                                         static_cast<int>(compressed.size()),
+                                         static_cast<int>(chunk.size()));
+    if (size != static_cast<int>(header.size)) {
+        LOG_ERROR(Core, "Workload trace has a corrupted chunk");
+        chunk.clear();
+        return false;
+    }
+    return true;
+}
+
+bool Reader::Read(void* data, size_t size) {
+    u8* bytes = static_cast<u8*>(data);
+    while (size > 0) {
+        if (chunk_offset == chunk.size() && !ReadChunk()) {
+            return false;
+        }
+
+        const size_t count = std::min(size, chunk.size() - chunk_offset);
+        std::memcpy(bytes, chunk.data() + chunk_offset, count);
+        chunk_offset += count;
+        bytes += count;
+        size -= count;
+    }
+    return true;
+}
+
+bool Reader::Next(Record& record) {
+    while (true) {
+        RecordHeader header{};
+        if (!Read(&header, sizeof(header)) || header.size > MAX_SIZE) {
+            return false;
+        }
+
+        record.type = static_cast<RecordType>(static_cast<u32>(header.type));
+        switch (record.type) {
+        case RecordType::Blob: {
+            BlobHeader blob_header{};
+            if (!Read(&blob_header, sizeof(blob_header)) || blob_header.size > MAX_SIZE) {
+                return false;
+            }
+            std::vector<u8>& data = blobs[blob_header.hash];
+            data.resize(blob_header.size);
+            if (!Read(data.data(), data.size())) {
+                return false;
+            }
+            continue;
+        }
+        case RecordType::IPC: {
+            IPCHeader ipc_header{};
+            if (!Read(&ipc_header, sizeof(ipc_header)) || ipc_header.name_size > MAX_SIZE) {
+                return false;
+            }
+            record.service_name.resize(ipc_header.name_size);
+            record.result = ipc_header.result;
+            record.is_async = ipc_header.is_async != 0;
+            return Read(&record.service_name[0], record.service_name.size()) &&
+                   Read(record.request.data(), sizeof(record.request)) &&
+                   Read(record.response.data(), sizeof(record.response));
+        }
+        case RecordType::Ioctl: {
+            IoctlHeader ioctl_header{};
+            if (!Read(&ioctl_header, sizeof(ioctl_header))) {
+                return false;
+            }
+            record.fd = ioctl_header.fd;
+            record.command = ioctl_header.command;
+            record.result = ioctl_header.result;
+            record.input_hash = ioctl_header.input_hash;
+            record.output_hash = ioctl_header.output_hash;
+            return true;
+        }
+        case RecordType::Memory: {
+            MemoryHeader memory_header{};
+            if (!Read(&memory_header, sizeof(memory_header))) {
+                return false;
+            }
+            record.gpu_addr = memory_header.gpu_addr;
+            record.hash = memory_header.hash;
+            return true;
+        }
+        case RecordType::Submission: {
+            SubmissionHeader submission_header{};
+            if (!Read(&submission_header, sizeof(submission_header)) ||
+                submission_header.num_entries * sizeof(Tegra::CommandListHeader) > MAX_SIZE) {
+                return false;
+            }
+            record.entries.resize(submission_header.num_entries);
+            return Read(record.entries.data(),
+                        record.entries.size() * sizeof(Tegra::CommandListHeader));
+        }
+        default: {
+            // Records of types added later are skipped
+            std::vector<u8> payload(header.size);
+            if (!Read(payload.data(), payload.size())) {
+                return false;
+            }
+            continue;
+        }
+        }
+    }
+}
+
+const std::vector<u8>* Reader::GetBlob(u64 hash) const {
+    auto itr = blobs.find(hash);
+    return itr != blobs.end() ? &itr->second : nullptr;
+}
+
+} // namespace WorkloadTrace
@@ -0,0 +1,204 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common/common_funcs.h"
+#include "common/common_types.h"
+#include "common/file_util.h"
+#include "common/swap.h"
+#include "core/hle/ipc.h"
+#include "video_core/command_processor.h"
+#include "video_core/memory_manager.h"
+
+/**
+ * Trace of the workload a title gives to the HLE services and the GPU. While enabled, the IPC
+ * requests handled by the services, the ioctls of the nvdrv devices and the GPFIFO submissions are
+ * recorded along with the contents of the GPU memory the submitted command lists occupy. The
+ * gpu-replay tool feeds the submissions back into the emulated GPU without emulating a CPU, to
+ * benchmark the GPU emulation offline.
+ *
+ * The file starts with a FileHeader, followed by chunks of records, each a ChunkHeader and the
+ * LZ4-compressed records. A record is a RecordHeader followed by a payload depending on its type.
+ * Memory contents are stored in Blob records named by the hash of the contents, written the first
+ * time the contents are seen. Other records refer to contents by hash, so that a buffer submitted
+ * over and over is only stored once. The chunks are compressed and written by a background thread.
+ */
+namespace WorkloadTrace {
+
+constexpr u32 FILE_MAGIC = 0x52545759; // "YWTR"
+constexpr u32 FILE_VERSION = 1;
+
+struct FileHeader {
+    u32_le magic;
+    u32_le version;
+};
+static_assert(sizeof(FileHeader) == 8, "FileHeader has incorrect size");
+
+struct ChunkHeader {
+    u32_le compressed_size;
+    u32_le size;
+};
+static_assert(sizeof(ChunkHeader) == 8, "ChunkHeader has incorrect size");
+
+enum class RecordType : u32 {
+    /// BlobHeader, followed by the contents
+    Blob = 0,
+    /// IPCHeader, followed by the name of the service and the request and response command buffers
+    IPC = 1,
+    /// IoctlHeader, the parameter buffers are blobs
+    Ioctl = 2,
+    /// MemoryHeader, the contents of a range of GPU memory when the next submission was made
+    Memory = 3,
+    /// SubmissionHeader, followed by the GPFIFO entries
+    Submission = 4,
+};
+
+struct RecordHeader {
+    u32_le type;
+    /// Size of the payload following the header
+    u32_le size;
+};
+static_assert(sizeof(RecordHeader) == 8, "RecordHeader has incorrect size");
+
+struct BlobHeader {
+    u64_le hash;
+    u64_le size;
+};
+static_assert(sizeof(BlobHeader) == 16, "BlobHeader has incorrect size");
+
+struct IPCHeader {
+    u32_le name_size;
+    u32_le result;
+    /// Whether the request completed asynchronously, the response is zeroed then
+    u32_le is_async;
+};
+static_assert(sizeof(IPCHeader) == 12, "IPCHeader has incorrect size");
+
+struct IoctlHeader {
+    u32_le fd;
+    u32_le command;
+    u32_le result;
+    INSERT_PADDING_WORDS(1);
+    u64_le input_hash;
+    u64_le output_hash;
+};
+static_assert(sizeof(IoctlHeader) == 32, "IoctlHeader has incorrect size");
+
+struct MemoryHeader {
+    u64_le gpu_addr;
+    u64_le hash;
+};
+static_assert(sizeof(MemoryHeader) == 16, "MemoryHeader has incorrect size");
+
+struct SubmissionHeader {
+    u32_le num_entries;
+};
+static_assert(sizeof(SubmissionHeader) == 4, "SubmissionHeader has incorrect size");
+
+/// A record read back from a trace, only the members of its type are filled in
+struct Record {
+    RecordType type = RecordType::Blob;
+
+    // IPC
+    std::string service_name;
+    bool is_async = false;
+    std::array<u32, IPC::COMMAND_BUFFER_LENGTH> request{};
+    std::array<u32, IPC::COMMAND_BUFFER_LENGTH> response{};
+
+    // Ioctl
+    u32 fd = 0;
+    u32 command = 0;
+    u64 input_hash = 0;
+    u64 output_hash = 0;
+
+    // IPC and Ioctl
+    u32 result = 0;
+
+    // Memory
+    Tegra::GPUVAddr gpu_addr = 0;
+    u64 hash = 0;
+
+    // Submission
+    std::vector<Tegra::CommandListHeader> entries;
+};
+
+namespace detail {
+extern std::atomic<bool> enabled;
+}
+
+inline bool IsEnabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * Starts tracing to a file, replacing its contents.
+ * @returns True on success, false if the file couldn't be opened.
+ */
+bool Start(const std::string& filename);
+
+/// Stops tracing, once the records so far are written to the file
+void Stop();
+
+/**
+ * Records a request handled by an HLE service.
+ * @param service_name Name of the service.
+ * @param result Result of the handler.
+ * @param request Command buffer of the request.
+ * @param response Command buffer of the response, nullptr if the request completes asynchronously.
+ */
+void RecordIPC(const std::string& service_name, u32 result, const u32* request,
+               const u32* response);
+
+/**
+ * Records an ioctl of an nvdrv device.
+ * @param input Parameters passed to the ioctl, copied before the ioctl as it may overwrite them.
+ * @param output Parameters returned by the ioctl.
+ */
+void RecordIoctl(u32 fd, u32 command, u32 result, const std::vector<u8>& input, const u8* output,
+                 size_t output_size);
+
+/**
+ * Records a GPFIFO submission, after the contents of the command lists it submits. Called before
+ * the command lists are pushed to the GPU.
+ */
+void RecordSubmission(const Tegra::MemoryManager& memory_manager,
+                      const std::vector<Tegra::CommandListHeader>& entries);
+
+/// Reads the records of a trace in order
+class Reader {
+public:
+    /**
+     * Opens a trace file and checks its header.
+     * @returns True on success, false if the file couldn't be read or isn't a trace.
+     */
+    bool Open(const std::string& filename);
+
+    /**
+     * Reads the next record, other than blobs, which are kept by the reader.
+     * @returns True on success, false at the end of the file or if it is truncated.
+     */
+    bool Next(Record& record);
+
+    /// Returns the contents with the given hash, nullptr if no blob had it so far
+    const std::vector<u8>* GetBlob(u64 hash) const;
+
+private:
+    /// Decompresses the next chunk
+    bool ReadChunk();
+    /// Reads from the decompressed chunks, crossing over to the next one as needed
+    bool Read(void* data, size_t size);
+
+    FileUtil::IOFile file;
+    std::vector<u8> chunk;
+    size_t chunk_offset = 0;
+    std::unordered_map<u64, std::vector<u8>> blobs;
+};
+
+} // namespace WorkloadTrace
@@ -0,0 +1,233 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <getopt.h>
+#include "common/common_types.h"
+#include "common/logging/backend.h"
+#include "common/logging/filter.h"
+#include "common/logging/log.h"
+#include "core/core_timing.h"
+#include "core/hle/kernel/async_request.h"
+#include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/process.h"
+#include "core/memory.h"
+#include "core/tracer/workload_trace.h"
+#include "video_core/gpu.h"
+
+/**
+ * Replays the GPFIFO submissions of a workload trace (see core/tracer/workload_trace.h) into the
+ * emulated GPU without emulating a CPU, and reports how long the GPU took to process them. Each
+ * GPU page a command list was recorded in is backed by a page of a process created for the
+ * replay, and the recorded contents are written there before the submission using them.
+ */
+
+using Kernel::SharedPtr;
+
+static void PrintHelp(const char* argv0) {
+    std::cout << "Usage: " << argv0
+              << " [options] <trace>\n"
+                 "-i, --iterations=NUMBER  Replay the trace NUMBER times (default 1)\n"
+                 "-h, --help               Display this help and exit\n";
+}
+
+namespace {
+
+/// Address the pages backing the GPU memory are allocated from
+constexpr VAddr BACKING_BASE = 0x10000000;
+
+constexpr u64 GPU_PAGE_SIZE = Tegra::MemoryManager::PAGE_SIZE;
+constexpr u64 GPU_PAGE_MASK = Tegra::MemoryManager::PAGE_MASK;
+
+class Replayer {
+public:
+    explicit Replayer(const WorkloadTrace::Reader& reader)
+        : reader(reader), process(Kernel::Process::Create("gpu-replay")) {
+        Kernel::g_current_process = process;
+        Memory::SetCurrentPageTable(&process->vm_manager.page_table);
+    }
+
+    void Replay(const WorkloadTrace::Record& record) {
+        switch (record.type) {
+        case WorkloadTrace::RecordType::Memory:
+            WriteMemory(record.gpu_addr, record.hash);
+            break;
+        case WorkloadTrace::RecordType::Submission:
+            gpu.PushCommandLists(record.entries);
+            ++num_submissions;
+            num_command_lists += record.entries.size();
+            break;
+        default:
+            // The IPC requests and the ioctls are only recorded for reference
+            break;
+        }
+    }
+
+    void WaitIdle() {
+        gpu.WaitIdle();
+    }
+
+    void PrintSummary(double elapsed_ms) const {
+        std::printf("%llu submissions, %llu command lists in %.3f ms, %llu waits for the GPU\n",
+                    static_cast<unsigned long long>(num_submissions),
+                    static_cast<unsigned long long>(num_command_lists), elapsed_ms,
+                    static_cast<unsigned long long>(num_waits));
+    }
+
+private:
+    void WriteMemory(Tegra::GPUVAddr gpu_addr, u64 hash) {
+        const std::vector<u8>* contents = reader.GetBlob(hash);
+        if (contents == nullptr || contents->empty()) {
+            return;
+        }
+
+        auto written = written_hashes.find(gpu_addr);
+        if (written != written_hashes.end() && written->second == hash) {
+            return;
+        }
+        if (written != written_hashes.end()) {
+            // The GPU may still be reading the previous contents
+            gpu.WaitIdle();
+            ++num_waits;
+        }
+        written_hashes[gpu_addr] = hash;
+
+        MapRange(gpu_addr, contents->size());
+
+        Tegra::MemoryManager& memory_manager = gpu.GetMemoryManager();
+        const u8* data = contents->data();
+        size_t size = contents->size();
+        while (size != 0) {
+            // Consecutive GPU pages aren't backed by consecutive CPU pages
+            const size_t page_left = GPU_PAGE_SIZE - (gpu_addr & GPU_PAGE_MASK);
+            const size_t copy_size = std::min(size, page_left);
+            Memory::WriteBlock(*memory_manager.GpuToCpuAddress(gpu_addr), data, copy_size);
+            gpu_addr += copy_size;
+            data += copy_size;
+            size -= copy_size;
+        }
+    }
+
+    void MapRange(Tegra::GPUVAddr gpu_addr, size_t size) {
+        Tegra::MemoryManager& memory_manager = gpu.GetMemoryManager();
+        const Tegra::GPUVAddr end = gpu_addr + size;
+        for (Tegra::GPUVAddr page = gpu_addr & ~GPU_PAGE_MASK; page < end; page += GPU_PAGE_SIZE) {
+            if (memory_manager.GpuToCpuAddress(page)) {
+                continue;
+            }
+            process->vm_manager
+                .MapMemoryBlock(next_backing_page,
+                                std::make_shared<std::vector<u8>>(Memory::PAGE_SIZE), 0,
+                                Memory::PAGE_SIZE, Kernel::MemoryState::Heap)
+                .Unwrap();
+            memory_manager.MapBufferEx(next_backing_page, page, GPU_PAGE_SIZE);
+            next_backing_page += Memory::PAGE_SIZE;
+        }
+    }
+
+    const WorkloadTrace::Reader& reader;
+    SharedPtr<Kernel::Process> process;
+    Tegra::GPU gpu;
+    VAddr next_backing_page = BACKING_BASE;
+    /// Hash of the contents last written at each address
+    std::unordered_map<Tegra::GPUVAddr, u64> written_hashes;
+    u64 num_submissions = 0;
+    u64 num_command_lists = 0;
+    u64 num_waits = 0;
+};
+
+} // Anonymous namespace
+
+/// Application entry point
+int main(int argc, char** argv) {
+    int option_index = 0;
+    unsigned long iterations = 1;
+    char* endarg;
+
+    static struct option long_options[] = {
+        {"iterations", required_argument, 0, 'i'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0},
+    };
+
+    std::string filepath;
+    while (optind < argc) {
+        char arg = getopt_long(argc, argv, "i:h", long_options, &option_index);
+        if (arg != -1) {
+            switch (arg) {
+            case 'i':
+                errno = 0;
+                iterations = strtoul(optarg, &endarg, 0);
+                if (endarg == optarg)
+                    errno = EINVAL;
+                if (errno != 0) {
+                    perror("--iterations");
+                    return 1;
+                }
+                break;
+            case 'h':
+                PrintHelp(argv[0]);
+                return 0;
+            default:
+                PrintHelp(argv[0]);
+                return 1;
+            }
+        } else {
+            filepath = argv[optind];
+            optind++;
+        }
+    }
+
+    Log::Filter log_filter(Log::Level::Info);
+    Log::SetFilter(&log_filter);
+
+    if (filepath.empty()) {
+        PrintHelp(argv[0]);
+        return 1;
+    }
+
+    WorkloadTrace::Reader reader;
+    if (!reader.Open(filepath)) {
+        LOG_CRITICAL(Frontend, "Failed to open the workload trace %s", filepath.c_str());
+        return 1;
+    }
+
+    std::vector<WorkloadTrace::Record> records;
+    WorkloadTrace::Record record;
+    while (reader.Next(record)) {
+        records.push_back(std::move(record));
+    }
+
+    CoreTiming::Init();
+    Kernel::Init(0);
+
+    {
+        Replayer replayer(reader);
+
+        using std::chrono::steady_clock;
+        const steady_clock::time_point start = steady_clock::now();
+        for (unsigned long iteration = 0; iteration < iterations; ++iteration) {
+            for (const auto& recorded : records) {
+                replayer.Replay(recorded);
+            }
+        }
+        replayer.WaitIdle();
+        const std::chrono::duration<double, std::milli> elapsed = steady_clock::now() - start;
+        replayer.PrintSummary(elapsed.count());
+    }
+
+    // The rest of the kernel shutdown expects emulated CPU cores, which the replay has none of
+    Kernel::AsyncRequestsShutdown();
+    CoreTiming::Shutdown();
+    return 0;
+}
@@ -46,18 +46,27 @@ public:
     }
 
     void ChangeKeyStatus(int key_code, bool pressed) {
+        // Timestamped before anything else, the key events are as close to the host as it gets
+        const auto time = Input::EventClock::now();
+        bool changed = false;
         std::lock_guard<std::mutex> guard(mutex);
         for (const KeyButtonPair& pair : list) {
             if (pair.key_code == key_code)
-                pair.key_button->status.store(pressed);
+                changed |= pair.key_button->status.exchange(pressed) != pressed;
         }
+        if (changed)
+            Input::RecordStateChange(time);
     }
 
     void ChangeAllKeyStatus(bool pressed) {
+        const auto time = Input::EventClock::now();
+        bool changed = false;
         std::lock_guard<std::mutex> guard(mutex);
         for (const KeyButtonPair& pair : list) {
-            pair.key_button->status.store(pressed);
+            changed |= pair.key_button->status.exchange(pressed) != pressed;
         }
+        if (changed)
+            Input::RecordStateChange(time);
     }
 
 private:
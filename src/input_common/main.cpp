@@ -2,8 +2,12 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
+#include <thread>
 #include "common/param_package.h"
+#include "common/thread.h"
 #include "input_common/analog_from_button.h"
 #include "input_common/keyboard.h"
 #include "input_common/main.h"
@@ -17,6 +21,32 @@ namespace InputCommon {
 static std::shared_ptr<Keyboard> keyboard;
 static std::shared_ptr<MotionEmu> motion_emu;
 
+/**
+ * Thread updating the backends that have to be polled, so that the emulation only ever reads the
+ * state they publish. The backends driven by host events timestamp their changes as they get them.
+ */
+static std::thread input_thread;
+static Common::Event input_thread_stop;
+
+/// Interval between two updates of the polled backends
+constexpr auto INPUT_UPDATE_INTERVAL = std::chrono::milliseconds(1);
+
+static void InputThreadMain() {
+    Common::SetCurrentThreadName("Input");
+    Common::PinCurrentHostThread(Common::HostThread::Input);
+
+    auto update_time = std::chrono::steady_clock::now();
+    do {
+#ifdef HAVE_SDL2
+        SDL::UpdateJoysticks();
+#endif
+        motion_emu->Update(update_time);
+        // Late updates are not caught up with, there is no point in polling twice in a row
+        update_time = std::max(update_time + INPUT_UPDATE_INTERVAL,
+                               std::chrono::steady_clock::now());
+    } while (!input_thread_stop.WaitUntil(update_time));
+}
+
 void Init() {
     keyboard = std::make_shared<Keyboard>();
     Input::RegisterFactory<Input::ButtonDevice>("keyboard", keyboard);
@@ -28,9 +58,15 @@ void Init() {
 #ifdef HAVE_SDL2
     SDL::Init();
 #endif
+
+    input_thread_stop.Reset();
+    input_thread = std::thread(InputThreadMain);
 }
 
 void Shutdown() {
+    input_thread_stop.Set();
+    input_thread.join();
+
     Input::UnregisterFactory<Input::ButtonDevice>("keyboard");
     keyboard.reset();
     Input::UnregisterFactory<Input::AnalogDevice>("analog_from_button");
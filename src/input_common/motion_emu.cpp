@@ -2,33 +2,29 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <chrono>
 #include <mutex>
-#include <thread>
 #include <tuple>
 #include "common/math_util.h"
 #include "common/quaternion.h"
-#include "common/thread.h"
+#include "common/seqlock.h"
 #include "common/vector_math.h"
 #include "input_common/motion_emu.h"
 
 namespace InputCommon {
 
-// Implementation class of the motion emulation device
+// Implementation class of the motion emulation device. The tilt is set by the frontend, the input
+// thread turns it into sensor states, and the emulation reads them. Each of them only publishes
+// what it writes through a seqlock, so that nobody waits on anyone.
 class MotionEmuDevice {
 public:
     MotionEmuDevice(int update_millisecond, float sensitivity)
         : update_millisecond(update_millisecond),
           update_duration(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
               std::chrono::milliseconds(update_millisecond))),
-          sensitivity(sensitivity), motion_emu_thread(&MotionEmuDevice::MotionEmuThread, this) {}
-
-    ~MotionEmuDevice() {
-        if (motion_emu_thread.joinable()) {
-            shutdown_event.Set();
-            motion_emu_thread.join();
-        }
-    }
+          sensitivity(sensitivity), next_update(std::chrono::steady_clock::now()),
+          q(MakeQuaternion(Math::Vec3<float>(), 0)) {}
 
     void BeginTilt(int x, int y) {
         mouse_origin = Math::MakeVec(x, y);
@@ -38,7 +34,6 @@ public:
     void Tilt(int x, int y) {
         auto mouse_move = Math::MakeVec(x, y) - mouse_origin;
         if (is_tilting) {
-            std::lock_guard<std::mutex> guard(tilt_mutex);
             if (mouse_move.x == 0 && mouse_move.y == 0) {
                 tilt_angle = 0;
             } else {
@@ -46,79 +41,87 @@ public:
                 tilt_angle = MathUtil::Clamp(tilt_direction.Normalize() * sensitivity, 0.0f,
                                              MathUtil::PI * 0.5f);
             }
+            tilt.Write({tilt_direction, tilt_angle});
         }
     }
 
     void EndTilt() {
-        std::lock_guard<std::mutex> guard(tilt_mutex);
         tilt_angle = 0;
         is_tilting = false;
+        tilt.Write({tilt_direction, tilt_angle});
     }
 
-    std::tuple<Math::Vec3<float>, Math::Vec3<float>> GetStatus() {
-        std::lock_guard<std::mutex> guard(status_mutex);
-        return status;
+    std::tuple<Math::Vec3<float>, Math::Vec3<float>> GetStatus() const {
+        const SensorState state = status.Read();
+        return std::make_tuple(state.accelerometer, state.gyroscope);
     }
 
-private:
-    const int update_millisecond;
-    const std::chrono::steady_clock::duration update_duration;
-    const float sensitivity;
-
-    Math::Vec2<int> mouse_origin;
+    /// Updates the sensor states if an update period has passed, called by the input thread
+    void Update(std::chrono::steady_clock::time_point now) {
+        if (now < next_update) {
+            return;
+        }
+        // Late updates are not caught up with, the rate would be measured over a wrong period
+        next_update = std::max(next_update + update_duration, now);
 
-    std::mutex tilt_mutex;
-    Math::Vec2<float> tilt_direction;
-    float tilt_angle = 0;
+        const Math::Quaternion<float> old_q = q;
 
-    bool is_tilting = false;
+        // Find the quaternion describing current 3DS tilting
+        const TiltState current_tilt = tilt.Read();
+        q = MakeQuaternion(
+            Math::MakeVec(-current_tilt.direction.y, 0.0f, current_tilt.direction.x),
+            current_tilt.angle);
 
-    Common::Event shutdown_event;
+        auto inv_q = q.Inverse();
 
-    std::tuple<Math::Vec3<float>, Math::Vec3<float>> status;
-    std::mutex status_mutex;
+        // Set the gravity vector in world space
+        auto gravity = Math::MakeVec(0.0f, -1.0f, 0.0f);
 
-    // Note: always keep the thread declaration at the end so that other objects are initialized
-    // before this!
-    std::thread motion_emu_thread;
+        // Find the angular rate vector in world space
+        auto angular_rate = ((q - old_q) * inv_q).xyz * 2;
+        angular_rate *= 1000 / update_millisecond / MathUtil::PI * 180;
 
-    void MotionEmuThread() {
-        auto update_time = std::chrono::steady_clock::now();
-        Math::Quaternion<float> q = MakeQuaternion(Math::Vec3<float>(), 0);
-        Math::Quaternion<float> old_q;
+        // Transform the two vectors from world space to 3DS space
+        gravity = QuaternionRotate(inv_q, gravity);
+        angular_rate = QuaternionRotate(inv_q, angular_rate);
 
-        while (!shutdown_event.WaitUntil(update_time)) {
-            update_time += update_duration;
-            old_q = q;
+        // Update the sensor state
+        status.Write({gravity, angular_rate});
 
-            {
-                std::lock_guard<std::mutex> guard(tilt_mutex);
+        // The sensors only change while the device is being tilted
+        const auto delta_q = q - old_q;
+        if (delta_q.xyz.Length2() + delta_q.w * delta_q.w != 0.0f) {
+            Input::RecordStateChange();
+        }
+    }
 
-                // Find the quaternion describing current 3DS tilting
-                q = MakeQuaternion(Math::MakeVec(-tilt_direction.y, 0.0f, tilt_direction.x),
-                                   tilt_angle);
-            }
+private:
+    struct TiltState {
+        Math::Vec2<float> direction;
+        float angle;
+    };
 
-            auto inv_q = q.Inverse();
+    struct SensorState {
+        Math::Vec3<float> accelerometer;
+        Math::Vec3<float> gyroscope;
+    };
 
-            // Set the gravity vector in world space
-            auto gravity = Math::MakeVec(0.0f, -1.0f, 0.0f);
+    const int update_millisecond;
+    const std::chrono::steady_clock::duration update_duration;
+    const float sensitivity;
 
-            // Find the angular rate vector in world space
-            auto angular_rate = ((q - old_q) * inv_q).xyz * 2;
-            angular_rate *= 1000 / update_millisecond / MathUtil::PI * 180;
+    // Only used by the frontend
+    Math::Vec2<int> mouse_origin;
+    Math::Vec2<float> tilt_direction;
+    float tilt_angle = 0;
+    bool is_tilting = false;
 
-            // Transform the two vectors from world space to 3DS space
-            gravity = QuaternionRotate(inv_q, gravity);
-            angular_rate = QuaternionRotate(inv_q, angular_rate);
+    // Only used by the input thread
+    std::chrono::steady_clock::time_point next_update;
+    Math::Quaternion<float> q;
 
-            // Update the sensor state
-            {
-                std::lock_guard<std::mutex> guard(status_mutex);
-                status = std::make_tuple(gravity, angular_rate);
-            }
-        }
-    }
+    Common::SeqLock<TiltState> tilt;
+    Common::SeqLock<SensorState> status;
 };
 
 // Interface wrapper held by input receiver as a unique_ptr. It holds the implementation class as
@@ -143,26 +146,38 @@ std::unique_ptr<Input::MotionDevice> MotionEmu::Create(const Common::ParamPackag
     auto device_wrapper = std::make_unique<MotionEmuDeviceWrapper>(update_period, sensitivity);
     // Previously created device is disconnected here. Having two motion devices for 3DS is not
     // expected.
+    std::lock_guard<std::mutex> lock(device_mutex);
     current_device = device_wrapper->device;
     return std::move(device_wrapper);
 }
 
 void MotionEmu::BeginTilt(int x, int y) {
-    if (auto ptr = current_device.lock()) {
+    if (auto ptr = GetCurrentDevice()) {
         ptr->BeginTilt(x, y);
     }
 }
 
 void MotionEmu::Tilt(int x, int y) {
-    if (auto ptr = current_device.lock()) {
+    if (auto ptr = GetCurrentDevice()) {
         ptr->Tilt(x, y);
     }
 }
 
 void MotionEmu::EndTilt() {
-    if (auto ptr = current_device.lock()) {
+    if (auto ptr = GetCurrentDevice()) {
         ptr->EndTilt();
     }
 }
 
+void MotionEmu::Update(std::chrono::steady_clock::time_point now) {
+    if (auto ptr = GetCurrentDevice()) {
+        ptr->Update(now);
+    }
+}
+
+std::shared_ptr<MotionEmuDevice> MotionEmu::GetCurrentDevice() {
+    std::lock_guard<std::mutex> lock(device_mutex);
+    return current_device.lock();
+}
+
 } // namespace InputCommon
@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include "core/frontend/input.h"
 
 namespace InputCommon {
@@ -39,7 +42,15 @@ public:
      */
     void EndTilt();
 
+    /// Updates the sensor states of the device when its update period has passed, called by the
+    /// input thread on every input tick
+    void Update(std::chrono::steady_clock::time_point now);
+
 private:
+    std::shared_ptr<MotionEmuDevice> GetCurrentDevice();
+
+    /// Only guards the pointer, the device states are read without locking
+    std::mutex device_mutex;
     std::weak_ptr<MotionEmuDevice> current_device;
 };
 
@@ -2,12 +2,19 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
+#include <future>
+#include <mutex>
 #include <string>
 #include <tuple>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 #include <SDL.h>
+#include "common/common_types.h"
 #include "common/logging/log.h"
 #include "common/math_util.h"
 #include "common/param_package.h"
@@ -25,29 +32,85 @@ static std::unordered_map<int, std::weak_ptr<SDLJoystick>> joystick_list;
 static std::shared_ptr<SDLButtonFactory> button_factory;
 static std::shared_ptr<SDLAnalogFactory> analog_factory;
 
-static bool initialized = false;
+/// Set once the joystick subsystem is initialized, the input thread skips its updates until then
+static std::atomic<bool> initialized{false};
+
+/// Background initialization of the joystick subsystem, true if it succeeded
+static std::shared_future<bool> initialization;
+
+/**
+ * Protects the SDL joystick API and the joystick list. The joysticks are updated on the input
+ * thread, while the devices are created on the emulation and UI threads.
+ */
+static std::mutex sdl_mutex;
+
+/// Number of joysticks connected at the previous update, -1 before the first one
+static int previous_num_joysticks = -1;
+
+/// Smallest move of an axis reported as a change of the input state, smaller ones are noise
+constexpr int AXIS_CHANGE_THRESHOLD = 0x400;
 
 class SDLJoystick {
 public:
+    /// Opens a joystick, must be called with the SDL lock held
     explicit SDLJoystick(int joystick_index)
         : joystick{SDL_JoystickOpen(joystick_index), SDL_JoystickClose} {
         if (!joystick) {
             LOG_ERROR(Input, "failed to open joystick %d", joystick_index);
+            return;
         }
+        Refresh();
     }
 
-    bool GetButton(int button) const {
+    ~SDLJoystick() {
+        std::lock_guard<std::mutex> lock(sdl_mutex);
+        joystick.reset();
+    }
+
+    /**
+     * Publishes the state of the joystick to the readers of the devices. Must be called with the
+     * SDL lock held, after SDL_JoystickUpdate.
+     * @returns Whether the state changed since the previous refresh
+     */
+    bool Refresh() {
         if (!joystick)
+            return false;
+
+        bool changed = false;
+        u64 button_state = 0;
+        const int num_buttons = std::min(SDL_JoystickNumButtons(joystick.get()), MAX_BUTTONS);
+        for (int button = 0; button < num_buttons; ++button) {
+            if (SDL_JoystickGetButton(joystick.get(), button) == 1) {
+                button_state |= 1ULL << button;
+            }
+        }
+        changed |= buttons.exchange(button_state, std::memory_order_relaxed) != button_state;
+
+        const int num_axes = std::min(SDL_JoystickNumAxes(joystick.get()), MAX_AXES);
+        for (int axis = 0; axis < num_axes; ++axis) {
+            const Sint16 value = SDL_JoystickGetAxis(joystick.get(), axis);
+            const Sint16 previous = axes[axis].exchange(value, std::memory_order_relaxed);
+            changed |= std::abs(value - previous) >= AXIS_CHANGE_THRESHOLD;
+        }
+
+        const int num_hats = std::min(SDL_JoystickNumHats(joystick.get()), MAX_HATS);
+        for (int hat = 0; hat < num_hats; ++hat) {
+            const Uint8 value = SDL_JoystickGetHat(joystick.get(), hat);
+            changed |= hats[hat].exchange(value, std::memory_order_relaxed) != value;
+        }
+        return changed;
+    }
+
+    bool GetButton(int button) const {
+        if (button < 0 || button >= MAX_BUTTONS)
             return {};
-        SDL_JoystickUpdate();
-        return SDL_JoystickGetButton(joystick.get(), button) == 1;
+        return ((buttons.load(std::memory_order_relaxed) >> button) & 1) != 0;
     }
 
     float GetAxis(int axis) const {
-        if (!joystick)
+        if (axis < 0 || axis >= MAX_AXES)
             return {};
-        SDL_JoystickUpdate();
-        return SDL_JoystickGetAxis(joystick.get(), axis) / 32767.0f;
+        return axes[axis].load(std::memory_order_relaxed) / 32767.0f;
     }
 
     std::tuple<float, float> GetAnalog(int axis_x, int axis_y) const {
@@ -68,7 +131,9 @@ public:
     }
 
     bool GetHatDirection(int hat, Uint8 direction) const {
-        return (SDL_JoystickGetHat(joystick.get(), hat) & direction) != 0;
+        if (hat < 0 || hat >= MAX_HATS)
+            return {};
+        return (hats[hat].load(std::memory_order_relaxed) & direction) != 0;
     }
 
     SDL_JoystickID GetJoystickID() const {
@@ -76,7 +141,17 @@ public:
     }
 
 private:
+    /// State beyond these limits isn't published, no controller needs more
+    static constexpr int MAX_BUTTONS = 64;
+    static constexpr int MAX_AXES = 16;
+    static constexpr int MAX_HATS = 4;
+
     std::unique_ptr<SDL_Joystick, decltype(&SDL_JoystickClose)> joystick;
+
+    /// Last state read by the input thread, a bit per button
+    std::atomic<u64> buttons{0};
+    std::array<std::atomic<Sint16>, MAX_AXES> axes{};
+    std::array<std::atomic<Uint8>, MAX_HATS> hats{};
 };
 
 class SDLButton final : public Input::ButtonDevice {
@@ -144,7 +219,17 @@ private:
     int axis_y;
 };
 
+/// Waits for the joystick subsystem to be initialized, returns whether it succeeded
+static bool WaitForInitialization() {
+    // Each thread waits through its own copy of the future
+    const std::shared_future<bool> pending = initialization;
+    return pending.valid() && pending.get();
+}
+
 static std::shared_ptr<SDLJoystick> GetJoystick(int joystick_index) {
+    // Without the joystick subsystem the joystick fails to open and the device stays released
+    WaitForInitialization();
+    std::lock_guard<std::mutex> lock(sdl_mutex);
     std::shared_ptr<SDLJoystick> joystick = joystick_list[joystick_index].lock();
     if (!joystick) {
         joystick = std::make_shared<SDLJoystick>(joystick_index);
@@ -233,24 +318,76 @@ public:
     }
 };
 
+void UpdateJoysticks() {
+    if (!initialized)
+        return;
+
+    std::vector<std::shared_ptr<SDLJoystick>> joysticks;
+    Input::EventClock::time_point update_time;
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(sdl_mutex);
+        SDL_JoystickUpdate();
+        update_time = Input::EventClock::now();
+
+        // After a joystick is plugged in or unplugged the indices may refer to other joysticks.
+        // The list is cleared so that the devices created again open them anew.
+        const int num_joysticks = SDL_NumJoysticks();
+        if (num_joysticks != previous_num_joysticks) {
+            if (previous_num_joysticks >= 0) {
+                LOG_INFO(Input, "Number of joysticks changed to %d", num_joysticks);
+                joystick_list.clear();
+                Input::NotifyDevicesChanged();
+            }
+            previous_num_joysticks = num_joysticks;
+        }
+
+        for (const auto& entry : joystick_list) {
+            if (auto joystick = entry.second.lock()) {
+                changed |= joystick->Refresh();
+                joysticks.push_back(std::move(joystick));
+            }
+        }
+    }
+    // Joysticks closed meanwhile are destroyed here, which takes the SDL lock
+    joysticks.clear();
+
+    if (changed) {
+        Input::RecordStateChange(update_time);
+    }
+}
+
 void Init() {
-    if (SDL_Init(SDL_INIT_JOYSTICK) < 0) {
-        LOG_CRITICAL(Input, "SDL_Init(SDL_INIT_JOYSTICK) failed with: %s", SDL_GetError());
-    } else {
-        using namespace Input;
-        RegisterFactory<ButtonDevice>("sdl", std::make_shared<SDLButtonFactory>());
-        RegisterFactory<AnalogDevice>("sdl", std::make_shared<SDLAnalogFactory>());
+    // Initializing the joystick subsystem enumerates the devices, which takes a noticeable time on
+    // some hosts. It runs in the background while the frontend starts; the factories are there
+    // from the start and only the creation of the devices waits for it.
+    const auto initialize = [] {
+        std::lock_guard<std::mutex> lock(sdl_mutex);
+        if (SDL_Init(SDL_INIT_JOYSTICK) < 0) {
+            LOG_CRITICAL(Input, "SDL_Init(SDL_INIT_JOYSTICK) failed with: %s", SDL_GetError());
+            return false;
+        }
         initialized = true;
-    }
+        return true;
+    };
+    initialization = std::async(std::launch::async, initialize).share();
+
+    using namespace Input;
+    RegisterFactory<ButtonDevice>("sdl", std::make_shared<SDLButtonFactory>());
+    RegisterFactory<AnalogDevice>("sdl", std::make_shared<SDLAnalogFactory>());
 }
 
 void Shutdown() {
-    if (initialized) {
-        using namespace Input;
-        UnregisterFactory<ButtonDevice>("sdl");
-        UnregisterFactory<AnalogDevice>("sdl");
+    using namespace Input;
+    UnregisterFactory<ButtonDevice>("sdl");
+    UnregisterFactory<AnalogDevice>("sdl");
+    if (WaitForInitialization()) {
+        initialized = false;
+        std::lock_guard<std::mutex> lock(sdl_mutex);
         SDL_QuitSubSystem(SDL_INIT_JOYSTICK);
+        previous_num_joysticks = -1;
     }
+    initialization = {};
 }
 
 /**
@@ -258,7 +395,14 @@ void Shutdown() {
  * because Citra opens joysticks using their indices, not their IDs.
  */
 static int JoystickIDToDeviceIndex(SDL_JoystickID id) {
-    int num_joysticks = SDL_NumJoysticks();
+    if (!WaitForInitialization()) {
+        return -1;
+    }
+    int num_joysticks;
+    {
+        std::lock_guard<std::mutex> lock(sdl_mutex);
+        num_joysticks = SDL_NumJoysticks();
+    }
     for (int i = 0; i < num_joysticks; i++) {
         auto joystick = GetJoystick(i);
         if (joystick->GetJoystickID() == id) {
@@ -320,17 +464,31 @@ public:
 
     void Start() override {
         // SDL joysticks must be opened, otherwise they don't generate events
-        SDL_JoystickUpdate();
-        int num_joysticks = SDL_NumJoysticks();
+        if (!WaitForInitialization()) {
+            return;
+        }
+        int num_joysticks;
+        {
+            std::lock_guard<std::mutex> lock(sdl_mutex);
+            SDL_JoystickUpdate();
+            num_joysticks = SDL_NumJoysticks();
+        }
         for (int i = 0; i < num_joysticks; i++) {
             joysticks_opened.emplace_back(GetJoystick(i));
         }
         // Empty event queue to get rid of old events. citra-qt doesn't use the queue
         SDL_Event dummy;
-        while (SDL_PollEvent(&dummy)) {
+        while (PollEvent(dummy)) {
         }
     }
 
+protected:
+    /// Takes the next event from the SDL queue, which the input thread fills meanwhile
+    static bool PollEvent(SDL_Event& event) {
+        std::lock_guard<std::mutex> lock(sdl_mutex);
+        return SDL_PollEvent(&event) != 0;
+    }
+
     void Stop() override {
         joysticks_opened.clear();
     }
@@ -347,7 +505,7 @@ public:
 
     Common::ParamPackage GetNextInput() override {
         SDL_Event event;
-        while (SDL_PollEvent(&event)) {
+        while (PollEvent(event)) {
             switch (event.type) {
             case SDL_JOYAXISMOTION:
                 if (std::abs(event.jaxis.value / 32767.0) < 0.5) {
@@ -379,7 +537,7 @@ public:
 
     Common::ParamPackage GetNextInput() override {
         SDL_Event event;
-        while (SDL_PollEvent(&event)) {
+        while (PollEvent(event)) {
             if (event.type != SDL_JOYAXISMOTION || std::abs(event.jaxis.value / 32767.0) < 0.5) {
                 continue;
             }
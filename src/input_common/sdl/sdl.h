@@ -28,6 +28,12 @@ void Init();
 /// Unresisters SDL device factories and shut them down.
 void Shutdown();
 
+/**
+ * Pumps the state of the opened joysticks, so that their devices read it without calling into SDL.
+ * Called periodically by the input thread.
+ */
+void UpdateJoysticks();
+
 /// Creates a ParamPackage from an SDL_Event that can directly be used to create a ButtonDevice
 Common::ParamPackage SDLEventToButtonParamPackage(const SDL_Event& event);
 
@@ -0,0 +1,365 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <getopt.h>
+#include "common/common_types.h"
+#include "common/logging/backend.h"
+#include "common/logging/filter.h"
+#include "common/logging/log.h"
+#include "core/core_timing.h"
+#include "core/hle/kernel/async_request.h"
+#include "core/hle/kernel/client_port.h"
+#include "core/hle/kernel/client_session.h"
+#include "core/hle/kernel/domain.h"
+#include "core/hle/kernel/handle_table.h"
+#include "core/hle/kernel/hle_ipc.h"
+#include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/process.h"
+#include "core/hle/kernel/server_port.h"
+#include "core/hle/kernel/server_session.h"
+#include "core/hle/kernel/session.h"
+#include "core/hle/lock.h"
+#include "core/hle/service/service.h"
+#include "core/hle/service/sm/sm.h"
+#include "core/memory.h"
+#include "core/tracer/ipc_capture.h"
+
+/**
+ * Replays an IPC capture (see core/tracer/ipc_capture.h) into the HLE services without emulating a
+ * CPU, and reports how long the services took to handle the requests. The guest buffers referenced
+ * by the requests are mapped at their captured addresses in a process created for the replay.
+ *
+ * Requests are sent to the most recently created instance of the interface they were captured
+ * on. Instances are created by replaying the requests that returned them, or taken from the
+ * service manager and the named ports for services that were connected before the capture
+ * started. Control requests, which manage the session itself, are skipped; whether a request is
+ * sent through a domain is taken from the capture instead.
+ */
+
+using Kernel::SharedPtr;
+
+static void PrintHelp(const char* argv0) {
+    std::cout << "Usage: " << argv0
+              << " [options] <capture>\n"
+                 "-i, --iterations=NUMBER  Replay the capture NUMBER times (default 1)\n"
+                 "-h, --help               Display this help and exit\n";
+}
+
+namespace {
+
+/// An instance of a service interface the captured requests can be sent to
+struct Endpoint {
+    std::shared_ptr<Service::ServiceFrameworkBase> service;
+    SharedPtr<Kernel::ServerSession> session;
+    SharedPtr<Kernel::Domain> domain;
+    std::unique_ptr<Kernel::HLERequestContext> session_context;
+    std::unique_ptr<Kernel::HLERequestContext> domain_context;
+};
+
+struct ServiceTimes {
+    u64 requests = 0;
+    u64 total_ns = 0;
+};
+
+class Replayer {
+public:
+    Replayer() : process(Kernel::Process::Create("ipc-replay")) {
+        Kernel::g_current_process = process;
+        Memory::SetCurrentPageTable(&process->vm_manager.page_table);
+    }
+
+    /// Maps the pages of every buffer of a record that aren't mapped yet
+    void MapBuffers(const IPCCapture::Record& record) {
+        for (const auto& buffer : record.input_buffers) {
+            MapRange(buffer.address, buffer.data.size());
+        }
+        for (const auto& buffer : record.output_buffers) {
+            MapRange(buffer.address, buffer.data.size());
+        }
+    }
+
+    void Replay(const IPCCapture::Record& record) {
+        Endpoint* endpoint = FindEndpoint(record.service_name);
+        if (endpoint == nullptr) {
+            ++num_skipped;
+            return;
+        }
+
+        const bool is_domain = (record.flags & IPCCapture::RECORD_DOMAIN) != 0;
+        Kernel::HLERequestContext& context = GetContext(*endpoint, is_domain);
+
+        for (const auto& buffer : record.input_buffers) {
+            Memory::WriteBlock(buffer.address, buffer.data.data(), buffer.data.size());
+        }
+
+        std::array<u32, IPC::COMMAND_BUFFER_LENGTH> request = record.request;
+        context.PopulateFromIncomingCommandBuffer(request.data(), *process, process->handle_table);
+        if (context.GetCommandType() == IPC::CommandType::Control) {
+            context.Clear();
+            ++num_skipped;
+            return;
+        }
+
+        using std::chrono::steady_clock;
+        const steady_clock::time_point start = steady_clock::now();
+        ResultCode result = endpoint->service->DispatchRequest(context);
+        if (context.IsAsync()) {
+            context.TakeAsyncWork()();
+            context.CompleteAsync();
+        }
+        const auto elapsed = steady_clock::now() - start;
+
+        ServiceTimes& times = service_times[record.service_name];
+        ++times.requests;
+        times.total_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+        if (result.raw != record.result || !OutputBuffersMatch(record)) {
+            ++num_mismatches;
+        }
+
+        // The context belongs to the endpoint, which may be replaced by a new instance
+        std::vector<std::shared_ptr<Kernel::SessionRequestHandler>> interfaces =
+            GetReturnedInterfaces(context);
+        context.Clear();
+        for (const auto& handler : interfaces) {
+            AddEndpoint(handler);
+        }
+    }
+
+    void PrintSummary() const {
+        u64 total_requests = 0;
+        u64 total_ns = 0;
+        for (const auto& entry : service_times) {
+            const ServiceTimes& times = entry.second;
+            std::printf("%-32s %10llu requests %12.3f ms %10llu ns/request\n", entry.first.c_str(),
+                        static_cast<unsigned long long>(times.requests), times.total_ns / 1e6,
+                        static_cast<unsigned long long>(times.total_ns / times.requests));
+            total_requests += times.requests;
+            total_ns += times.total_ns;
+        }
+        std::printf("%llu requests in %.3f ms, %llu skipped, %llu differing from the capture\n",
+                    static_cast<unsigned long long>(total_requests), total_ns / 1e6,
+                    static_cast<unsigned long long>(num_skipped),
+                    static_cast<unsigned long long>(num_mismatches));
+    }
+
+private:
+    void MapRange(VAddr address, size_t size) {
+        if (size == 0) {
+            return;
+        }
+
+        const VAddr end = address + size;
+        for (VAddr page = address & ~Memory::PAGE_MASK; page < end; page += Memory::PAGE_SIZE) {
+            if (!mapped_pages.insert(page).second) {
+                continue;
+            }
+            process->vm_manager
+                .MapMemoryBlock(page, std::make_shared<std::vector<u8>>(Memory::PAGE_SIZE), 0,
+                                Memory::PAGE_SIZE, Kernel::MemoryState::Heap)
+                .Unwrap();
+        }
+    }
+
+    Endpoint* FindEndpoint(const std::string& name) {
+        auto itr = endpoints.find(name);
+        if (itr != endpoints.end()) {
+            // Interfaces without an instance are remembered as an empty endpoint
+            return itr->second.service != nullptr ? &itr->second : nullptr;
+        }
+
+        // The client connected to the service before the capture started
+        SharedPtr<Kernel::ClientPort> port;
+        auto named_port = Service::g_kernel_named_ports.find(name);
+        if (named_port != Service::g_kernel_named_ports.end()) {
+            port = named_port->second;
+        } else {
+            auto registered = Service::SM::g_service_manager->GetServicePort(name);
+            if (registered.Succeeded()) {
+                port = *registered;
+            }
+        }
+
+        if (port == nullptr) {
+            LOG_WARNING(Service, "No instance of %s to replay its requests on", name.c_str());
+            endpoints.emplace(name, Endpoint{});
+            return nullptr;
+        }
+        return AddEndpoint(port->server_port->hle_handler);
+    }
+
+    Endpoint* AddEndpoint(const std::shared_ptr<Kernel::SessionRequestHandler>& handler) {
+        auto service = std::dynamic_pointer_cast<Service::ServiceFrameworkBase>(handler);
+        if (service == nullptr) {
+            return nullptr;
+        }
+
+        const std::string name = service->GetServiceName();
+        Endpoint& endpoint = endpoints[name];
+        endpoint = Endpoint{};
+        endpoint.service = std::move(service);
+        endpoint.session = std::get<SharedPtr<Kernel::ServerSession>>(
+            Kernel::ServerSession::CreateSessionPair(name));
+        endpoint.domain = Kernel::Domain::Create(name + "_Domain").Unwrap();
+        return &endpoint;
+    }
+
+    /// Returns the interfaces a request returned, which become the targets of later requests
+    static std::vector<std::shared_ptr<Kernel::SessionRequestHandler>> GetReturnedInterfaces(
+        const Kernel::HLERequestContext& context) {
+        std::vector<std::shared_ptr<Kernel::SessionRequestHandler>> interfaces(
+            context.DomainObjects().begin(), context.DomainObjects().end());
+        for (const auto& object : context.MoveObjects()) {
+            auto client_session = Kernel::DynamicObjectCast<Kernel::ClientSession>(object);
+            if (client_session != nullptr && client_session->parent->server != nullptr) {
+                interfaces.push_back(client_session->parent->server->hle_handler);
+            }
+        }
+        return interfaces;
+    }
+
+    static Kernel::HLERequestContext& GetContext(Endpoint& endpoint, bool is_domain) {
+        if (is_domain) {
+            if (endpoint.domain_context == nullptr) {
+                endpoint.domain_context =
+                    std::make_unique<Kernel::HLERequestContext>(endpoint.domain.get());
+            }
+            endpoint.domain_context->Reset(endpoint.domain.get());
+            return *endpoint.domain_context;
+        }
+
+        if (endpoint.session_context == nullptr) {
+            endpoint.session_context =
+                std::make_unique<Kernel::HLERequestContext>(endpoint.session.get());
+        }
+        endpoint.session_context->Reset(endpoint.session.get());
+        return *endpoint.session_context;
+    }
+
+    static bool OutputBuffersMatch(const IPCCapture::Record& record) {
+        if ((record.flags & IPCCapture::RECORD_ASYNC) != 0) {
+            // The capture doesn't have the response of asynchronous requests
+            return true;
+        }
+
+        std::vector<u8> data;
+        for (const auto& buffer : record.output_buffers) {
+            data.resize(buffer.data.size());
+            Memory::ReadBlock(buffer.address, data.data(), data.size());
+            if (data != buffer.data) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    SharedPtr<Kernel::Process> process;
+    std::set<VAddr> mapped_pages;
+    std::unordered_map<std::string, Endpoint> endpoints;
+    std::map<std::string, ServiceTimes> service_times;
+    u64 num_skipped = 0;
+    u64 num_mismatches = 0;
+};
+
+} // Anonymous namespace
+
+/// Application entry point
+int main(int argc, char** argv) {
+    int option_index = 0;
+    unsigned long iterations = 1;
+    char* endarg;
+
+    static struct option long_options[] = {
+        {"iterations", required_argument, 0, 'i'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0},
+    };
+
+    std::string filepath;
+    while (optind < argc) {
+        char arg = getopt_long(argc, argv, "i:h", long_options, &option_index);
+        if (arg != -1) {
+            switch (arg) {
+            case 'i':
+                errno = 0;
+                iterations = strtoul(optarg, &endarg, 0);
+                if (endarg == optarg)
+                    errno = EINVAL;
+                if (errno != 0) {
+                    perror("--iterations");
+                    return 1;
+                }
+                break;
+            case 'h':
+                PrintHelp(argv[0]);
+                return 0;
+            default:
+                PrintHelp(argv[0]);
+                return 1;
+            }
+        } else {
+            filepath = argv[optind];
+            optind++;
+        }
+    }
+
+    // The services log the latencies of their commands at the debug level when shut down
+    Log::Filter log_filter(Log::Level::Info);
+    log_filter.ParseFilterString("*:Info Service:Debug");
+    Log::SetFilter(&log_filter);
+
+    if (filepath.empty()) {
+        PrintHelp(argv[0]);
+        return 1;
+    }
+
+    IPCCapture::Reader reader;
+    if (!reader.Open(filepath)) {
+        LOG_CRITICAL(Frontend, "Failed to open the IPC capture %s", filepath.c_str());
+        return 1;
+    }
+
+    std::vector<IPCCapture::Record> records;
+    IPCCapture::Record record;
+    while (reader.Next(record)) {
+        records.push_back(std::move(record));
+    }
+
+    CoreTiming::Init();
+    Kernel::Init(0);
+    Service::Init();
+
+    {
+        std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+
+        Replayer replayer;
+        for (const auto& captured : records) {
+            replayer.MapBuffers(captured);
+        }
+        for (unsigned long iteration = 0; iteration < iterations; ++iteration) {
+            for (const auto& captured : records) {
+                replayer.Replay(captured);
+            }
+        }
+        replayer.PrintSummary();
+    }
+
+    // The rest of the kernel shutdown expects emulated CPU cores, which the replay has none of
+    Kernel::AsyncRequestsShutdown();
+    Service::Shutdown();
+    CoreTiming::Shutdown();
+    return 0;
+}
@@ -0,0 +1,148 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "audio_core/mixer.h"
+
+namespace AudioCore {
+
+constexpr MixerIsa ALL_ISAS[] = {MixerIsa::Scalar, MixerIsa::SSE2, MixerIsa::AVX2};
+
+static const char* GetIsaName(MixerIsa isa) {
+    switch (isa) {
+    case MixerIsa::Scalar:
+        return "Scalar";
+    case MixerIsa::SSE2:
+        return "SSE2";
+    case MixerIsa::AVX2:
+        return "AVX2";
+    }
+    return "Unknown";
+}
+
+static std::vector<s16> GenerateSamples(size_t count) {
+    std::vector<s16> samples(count);
+    u32 seed = 0x12345678;
+    for (s16& sample : samples) {
+        seed = seed * 1103515245 + 12345;
+        sample = static_cast<s16>(seed >> 16);
+    }
+    return samples;
+}
+
+/// Resamples 32kHz to 48kHz in several calls, like the voices of a renderer do
+static std::vector<s16> ResampleInChunks(const std::vector<s16>& input, u32 num_channels) {
+    constexpr u32 step = 0x10000 * 32000 / 48000;
+    constexpr size_t chunk_frames = 240;
+
+    ResamplerState state;
+    std::vector<s16> output;
+    size_t input_frame = 0;
+    const size_t num_input_frames = input.size() / num_channels;
+    while (input_frame < num_input_frames) {
+        std::vector<s16> chunk(chunk_frames * num_channels);
+        size_t num_consumed;
+        const size_t num_frames =
+            Resample(chunk.data(), chunk_frames, &input[input_frame * num_channels],
+                     num_input_frames - input_frame, num_channels, step, state, num_consumed);
+        input_frame += num_consumed;
+        output.insert(output.end(), chunk.begin(), chunk.begin() + num_frames * num_channels);
+    }
+    return output;
+}
+
+TEST_CASE("Mixer[Resample]", "[audio_core]") {
+    // A constant signal stays constant once the history is filled, the filter has unity gain
+    for (u32 num_channels = 1; num_channels <= MAX_CHANNELS; ++num_channels) {
+        const std::vector<s16> input(3200 * num_channels, 1000);
+        const std::vector<s16> output = ResampleInChunks(input, num_channels);
+        // The last frames are interpolated towards the end of the input, past the 4800 frames
+        REQUIRE(output.size() >= 4800 * num_channels);
+        for (size_t i = RESAMPLER_TAPS * 2 * num_channels; i < output.size(); ++i) {
+            REQUIRE(output[i] == 1000);
+        }
+    }
+}
+
+TEST_CASE("Mixer[Kernels]", "[audio_core]") {
+    const std::vector<s16> samples = GenerateSamples(4002);
+    std::vector<s32> mix_input(samples.size());
+    for (size_t i = 0; i < mix_input.size(); ++i) {
+        mix_input[i] = samples[i] * 3;
+    }
+
+    SetMixerIsa(MixerIsa::Scalar);
+    std::vector<s32> reference_mix = mix_input;
+    MixSamples(reference_mix.data(), samples.data(), samples.size() / 2, 0.25f, 1.5f);
+    std::vector<s16> reference_clamped(samples.size());
+    ClampSamples(reference_clamped.data(), mix_input.data(), mix_input.size());
+    const std::vector<s16> reference_mono = ResampleInChunks(samples, 1);
+    const std::vector<s16> reference_stereo = ResampleInChunks(samples, 2);
+
+    for (const MixerIsa isa : ALL_ISAS) {
+        if (!IsMixerIsaSupported(isa)) {
+            continue;
+        }
+        INFO(GetIsaName(isa));
+        SetMixerIsa(isa);
+
+        std::vector<s32> mix = mix_input;
+        MixSamples(mix.data(), samples.data(), samples.size() / 2, 0.25f, 1.5f);
+        for (size_t i = 0; i < mix.size(); ++i) {
+            // Allows for the volume of a frame to round differently
+            REQUIRE(std::abs(mix[i] - reference_mix[i]) <= 1);
+        }
+
+        std::vector<s16> clamped(samples.size());
+        ClampSamples(clamped.data(), mix_input.data(), mix_input.size());
+        REQUIRE(clamped == reference_clamped);
+
+        REQUIRE(ResampleInChunks(samples, 1) == reference_mono);
+        REQUIRE(ResampleInChunks(samples, 2) == reference_stereo);
+    }
+}
+
+// Not run by default, select it with the [benchmark] tag
+TEST_CASE("Mixer[Benchmark]", "[.][benchmark]") {
+    // A frame of a renderer with 200 stereo voices at 32kHz, mixed at 48kHz
+    constexpr size_t num_voices = 200;
+    constexpr size_t num_output_frames = 240;
+    constexpr u32 step = 0x10000 * 32000 / 48000;
+    constexpr int iterations = 200;
+
+    const std::vector<s16> input = GenerateSamples(num_output_frames * 2 * 2);
+    std::vector<s16> voice(num_output_frames * 2);
+    std::vector<s32> mix(num_output_frames * 2);
+    std::vector<s16> output(num_output_frames * 2);
+
+    for (const MixerIsa isa : ALL_ISAS) {
+        if (!IsMixerIsaSupported(isa)) {
+            continue;
+        }
+        SetMixerIsa(isa);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            for (size_t v = 0; v < num_voices; ++v) {
+                ResamplerState state;
+                size_t num_consumed;
+                Resample(voice.data(), num_output_frames, input.data(), input.size() / 2, 2, step,
+                         state, num_consumed);
+                MixSamples(mix.data(), voice.data(), num_output_frames, 0.5f, 0.6f);
+            }
+            ClampSamples(output.data(), mix.data(), mix.size());
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        WARN("Mixing a frame of " << num_voices << " voices with the " << GetIsaName(isa)
+                                  << " kernels takes " << us / iterations << " us");
+    }
+}
+
+} // namespace AudioCore
@@ -0,0 +1,63 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <catch.hpp>
+#include "audio_core/time_stretch.h"
+
+namespace AudioCore {
+
+constexpr u32 SAMPLE_RATE = 48000;
+
+/// One second of a stereo 440Hz sine
+static std::vector<s16> GenerateSine() {
+    std::vector<s16> samples(SAMPLE_RATE * 2);
+    for (size_t frame = 0; frame < SAMPLE_RATE; ++frame) {
+        const double phase = 2.0 * 3.14159265358979323846 * 440.0 * frame / SAMPLE_RATE;
+        samples[frame * 2] = samples[frame * 2 + 1] = static_cast<s16>(10000.0 * std::sin(phase));
+    }
+    return samples;
+}
+
+/// Stretches the samples in buffers of 5ms, like the ones of an audio renderer
+static std::vector<s16> Stretch(const std::vector<s16>& input, double tempo) {
+    constexpr size_t buffer_frames = SAMPLE_RATE / 200;
+    TimeStretcher stretcher(SAMPLE_RATE, 2);
+    std::vector<s16> output;
+    for (size_t frame = 0; frame < input.size() / 2; frame += buffer_frames) {
+        stretcher.Process(&input[frame * 2], buffer_frames, tempo, output);
+    }
+    return output;
+}
+
+TEST_CASE("TimeStretcher[Length]", "[audio_core]") {
+    const std::vector<s16> input = GenerateSine();
+    for (const double tempo : {0.5, 0.8, 1.0, 1.5}) {
+        INFO("tempo " << tempo);
+        const std::vector<s16> output = Stretch(input, tempo);
+        // All but the frames kept for the next sequences are stretched
+        const double expected = input.size() / tempo;
+        REQUIRE(std::abs(output.size() - expected) < 0.1 * SAMPLE_RATE * 2 / tempo);
+    }
+}
+
+TEST_CASE("TimeStretcher[Waveform]", "[audio_core]") {
+    // The sequences are joined where they line up, the sine keeps its amplitude and has no clicks
+    const std::vector<s16> output = Stretch(GenerateSine(), 0.5);
+    constexpr size_t fade_in_samples = SAMPLE_RATE / 10;
+    REQUIRE(output.size() > fade_in_samples);
+
+    // A sine of 440Hz moves by at most 10000 * 2pi * 440 / 48000 per frame, about 576
+    s16 peak = 0;
+    for (size_t i = fade_in_samples + 2; i < output.size(); i += 2) {
+        REQUIRE(std::abs(output[i] - output[i - 2]) < 700);
+        peak = std::max(peak, output[i]);
+    }
+    REQUIRE(peak > 9000);
+}
+
+} // namespace AudioCore
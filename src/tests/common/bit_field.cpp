@@ -0,0 +1,64 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <tuple>
+#include <catch.hpp>
+#include "common/bit_field.h"
+#include "common/common_types.h"
+
+namespace Common {
+
+enum class Mode : u32 { A = 1, B = 5 };
+
+union TestRegister {
+    u32 hex;
+    BitField<0, 13, u32> method;
+    BitField<13, 3, u32> subchannel;
+    BitField<16, 13, s32> offset;
+    BitField<29, 3, Mode> mode;
+};
+
+using Method = decltype(TestRegister::method);
+using Subchannel = decltype(TestRegister::subchannel);
+using Offset = decltype(TestRegister::offset);
+using ModeField = decltype(TestRegister::mode);
+
+static_assert(FieldsMask<u32, Method, Subchannel> == 0xFFFF, "Masks are combined");
+static_assert(std::get<1>(ExtractFields<Method, Subchannel>(u32{0x6123})) == 3,
+              "Fields can be extracted in constant expressions");
+
+TEST_CASE("BitField - Bulk extraction matches the fields", "[common]") {
+    TestRegister reg{};
+    reg.method.Assign(0x1234);
+    reg.subchannel.Assign(5);
+    reg.offset.Assign(-42);
+    reg.mode.Assign(Mode::B);
+
+    const auto [method, subchannel, offset, mode] =
+        ExtractFields<Method, Subchannel, Offset, ModeField>(reg.hex);
+    REQUIRE(method == reg.method);
+    REQUIRE(subchannel == reg.subchannel);
+    REQUIRE(offset == -42);
+    REQUIRE(mode == Mode::B);
+}
+
+TEST_CASE("BitField - Bulk assignment leaves the other bits alone", "[common]") {
+    TestRegister reg{};
+    reg.hex = 0xFFFFFFFF;
+    AssignFields<Method, Offset>(reg.hex, 0x42, -1000);
+    REQUIRE(reg.method == 0x42);
+    REQUIRE(reg.offset == -1000);
+    REQUIRE(reg.subchannel == 7);
+    REQUIRE(static_cast<u32>(reg.mode.Value()) == 7);
+
+    TestRegister expected{};
+    expected.hex = 0x12345678;
+    TestRegister batched = expected;
+    expected.subchannel.Assign(2);
+    expected.mode.Assign(Mode::A);
+    AssignFields<Subchannel, ModeField>(batched.hex, 2, Mode::A);
+    REQUIRE(batched.hex == expected.hex);
+}
+
+} // namespace Common
@@ -0,0 +1,154 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <random>
+#include <vector>
+#include <catch.hpp>
+#include "common/color.h"
+
+namespace Color {
+
+constexpr Format ALL_FORMATS[] = {Format::RGBA8,  Format::RGB8,   Format::RG8,
+                                  Format::RGB565, Format::RGB5A1, Format::RGBA4};
+constexpr ConversionIsa ALL_ISAS[] = {ConversionIsa::Scalar, ConversionIsa::SSSE3};
+/// Lengths around the number of pixels the vector kernels process at once
+constexpr size_t SPAN_LENGTHS[] = {0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 257, 1000};
+
+static std::vector<u8> GenerateData(size_t size) {
+    std::mt19937 generator(1234);
+    std::vector<u8> data(size);
+    for (u8& byte : data) {
+        byte = static_cast<u8>(generator());
+    }
+    return data;
+}
+
+/// Decodes a pixel with the scalar function of its format
+static Math::Vec4<u8> DecodePixel(Format format, const u8* bytes) {
+    switch (format) {
+    case Format::RGBA8:
+        return DecodeRGBA8(bytes);
+    case Format::RGB8:
+        return DecodeRGB8(bytes);
+    case Format::RG8:
+        return DecodeRG8(bytes);
+    case Format::RGB565:
+        return DecodeRGB565(bytes);
+    case Format::RGB5A1:
+        return DecodeRGB5A1(bytes);
+    case Format::RGBA4:
+        return DecodeRGBA4(bytes);
+    }
+    return {};
+}
+
+/// Encodes a pixel with the scalar function of its format
+static void EncodePixel(Format format, const Math::Vec4<u8>& color, u8* bytes) {
+    switch (format) {
+    case Format::RGBA8:
+        return EncodeRGBA8(color, bytes);
+    case Format::RGB8:
+        return EncodeRGB8(color, bytes);
+    case Format::RG8:
+        return EncodeRG8(color, bytes);
+    case Format::RGB565:
+        return EncodeRGB565(color, bytes);
+    case Format::RGB5A1:
+        return EncodeRGB5A1(color, bytes);
+    case Format::RGBA4:
+        return EncodeRGBA4(color, bytes);
+    }
+}
+
+static bool ColorsEqual(const std::vector<Math::Vec4<u8>>& a,
+                        const std::vector<Math::Vec4<u8>>& b) {
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].x != b[i].x || a[i].y != b[i].y || a[i].z != b[i].z || a[i].w != b[i].w) {
+            return false;
+        }
+    }
+    return a.size() == b.size();
+}
+
+TEST_CASE("Color - Span decoding matches the scalar functions", "[common]") {
+    const std::vector<u8> data = GenerateData(4 * 1000);
+
+    for (const ConversionIsa isa : ALL_ISAS) {
+        if (!IsConversionIsaSupported(isa)) {
+            continue;
+        }
+        SetConversionIsa(isa);
+        for (const Format format : ALL_FORMATS) {
+            const size_t bpp = GetBytesPerPixel(format);
+            for (const size_t count : SPAN_LENGTHS) {
+                std::vector<Math::Vec4<u8>> expected(count);
+                for (size_t i = 0; i < count; ++i) {
+                    expected[i] = DecodePixel(format, data.data() + i * bpp);
+                }
+                std::vector<Math::Vec4<u8>> colors(count);
+                DecodeSpan(format, data.data(), colors.data(), count);
+                REQUIRE(ColorsEqual(colors, expected));
+            }
+        }
+    }
+}
+
+TEST_CASE("Color - Span encoding matches the scalar functions", "[common]") {
+    const std::vector<u8> data = GenerateData(4 * 1000);
+    const auto* colors = reinterpret_cast<const Math::Vec4<u8>*>(data.data());
+
+    for (const ConversionIsa isa : ALL_ISAS) {
+        if (!IsConversionIsaSupported(isa)) {
+            continue;
+        }
+        SetConversionIsa(isa);
+        for (const Format format : ALL_FORMATS) {
+            const size_t bpp = GetBytesPerPixel(format);
+            for (const size_t count : SPAN_LENGTHS) {
+                std::vector<u8> expected(count * bpp);
+                for (size_t i = 0; i < count; ++i) {
+                    EncodePixel(format, colors[i], expected.data() + i * bpp);
+                }
+                std::vector<u8> pixels(count * bpp);
+                EncodeSpan(format, colors, pixels.data(), count);
+                REQUIRE(pixels == expected);
+            }
+        }
+    }
+}
+
+TEST_CASE("Color - Conversions between every pair of formats", "[common]") {
+    constexpr size_t WIDTH = 37;
+    constexpr size_t HEIGHT = 5;
+    constexpr size_t STRIDE = WIDTH * 4 + 8;
+    const std::vector<u8> data = GenerateData(STRIDE * HEIGHT);
+
+    for (const ConversionIsa isa : ALL_ISAS) {
+        if (!IsConversionIsaSupported(isa)) {
+            continue;
+        }
+        SetConversionIsa(isa);
+        for (const Format src_format : ALL_FORMATS) {
+            const size_t src_bpp = GetBytesPerPixel(src_format);
+            for (const Format dst_format : ALL_FORMATS) {
+                const size_t dst_bpp = GetBytesPerPixel(dst_format);
+                // The padding at the end of the destination rows must be left alone
+                std::vector<u8> expected(STRIDE * HEIGHT, 0xCD);
+                for (size_t y = 0; y < HEIGHT; ++y) {
+                    for (size_t x = 0; x < WIDTH; ++x) {
+                        const Math::Vec4<u8> color =
+                            DecodePixel(src_format, data.data() + y * STRIDE + x * src_bpp);
+                        EncodePixel(dst_format, color, expected.data() + y * STRIDE + x * dst_bpp);
+                    }
+                }
+                std::vector<u8> pixels(STRIDE * HEIGHT, 0xCD);
+                ConvertRows(src_format, data.data(), STRIDE, dst_format, pixels.data(), STRIDE,
+                            WIDTH, HEIGHT);
+                REQUIRE(pixels == expected);
+            }
+        }
+    }
+}
+
+} // namespace Color
@@ -0,0 +1,64 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+#include <catch.hpp>
+#include "common/logging/deferred_format.h"
+
+namespace Log {
+
+/// Formats a message through its encoded arguments, returns "!" if they couldn't be encoded
+static std::string FormatDeferred(const char* format, ...) {
+    std::array<u8, 1024> buffer;
+    va_list args;
+    va_start(args, format);
+    const bool is_encoded = EncodeFormatArguments(format, args, buffer.data(), buffer.size());
+    va_end(args);
+    if (!is_encoded) {
+        return "!";
+    }
+
+    std::array<char, 1024> text;
+    FormatEncodedArguments(format, buffer.data(), text.data(), text.size());
+    return text.data();
+}
+
+static std::string Format(const char* format, ...) {
+    std::array<char, 1024> text;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text.data(), text.size(), format, args);
+    va_end(args);
+    return text.data();
+}
+
+TEST_CASE("DeferredFormat - Matches printf", "[common][logging]") {
+    const std::string name = "yuzu";
+    const char chars[] = {'a', 'b', 'c'};
+
+#define CHECK_FORMAT(...) REQUIRE(FormatDeferred(__VA_ARGS__) == Format(__VA_ARGS__))
+    CHECK_FORMAT("no arguments");
+    CHECK_FORMAT("%d %i %u 100%%", -5, 42, 3000000000u);
+    CHECK_FORMAT("%hhd %hu %ld %lld %zu", -1, 65535, -7L, -0x123456789LL, size_t{12345});
+    CHECK_FORMAT("0x%08X 0x%" PRIx64 " %o %c", 0xBEEFu, u64{0xDEADBEEFCAFE}, 8u, 'y');
+    CHECK_FORMAT("%-8s|%8s|%.2s|%.*s", name.c_str(), "ab", "abcdef", 3, chars);
+    CHECK_FORMAT("%*d|%-*d|", 6, 42, 4, 7);
+    CHECK_FORMAT("%f %.3f %e %g %10.2f", 1.5, 3.14159, 12345.678, 0.0001, -2.5);
+    CHECK_FORMAT("%p", static_cast<const void*>(chars));
+#undef CHECK_FORMAT
+}
+
+TEST_CASE("DeferredFormat - Falls back", "[common][logging]") {
+    // Arguments that don't fit the buffer, or conversions that aren't supported
+    const std::string long_string(2000, 'x');
+    REQUIRE(FormatDeferred("%s", long_string.c_str()) == "!");
+    REQUIRE(FormatDeferred("%ls", L"wide") == "!");
+    REQUIRE(FormatDeferred("trailing %") == "!");
+}
+
+} // namespace Log
@@ -0,0 +1,60 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <string>
+#include <catch.hpp>
+#include "common/file_util.h"
+
+namespace FileUtil {
+
+TEST_CASE("MappedFile - Modes", "[common]") {
+    const std::string path = "./mapped_file_test";
+    FileUtil::WriteStringToFile(true, "0123456789", path.c_str());
+
+    SECTION("read-only") {
+        MappedFile file(path);
+        REQUIRE(file.IsOpen());
+        REQUIRE(file.Size() == 10);
+        REQUIRE(file.Data()[3] == '3');
+        REQUIRE(file.WritableData() == nullptr);
+        file.Advise(MappedFile::AccessHint::Sequential);
+        file.Advise(MappedFile::AccessHint::DontNeed, 5, 100);
+        REQUIRE(file.Data()[9] == '9');
+    }
+
+    SECTION("copy-on-write") {
+        MappedFile file(path, MappedFile::Mode::CopyOnWrite);
+        REQUIRE(file.IsOpen());
+        file.WritableData()[0] = 'x';
+        // Written pages are private, they stay when the mapping is told to drop pages
+        file.Advise(MappedFile::AccessHint::DontNeed);
+        REQUIRE(file.Data()[0] == 'x');
+        REQUIRE(MappedFile(path).Data()[0] == '0');
+    }
+
+    SECTION("read-write") {
+        {
+            MappedFile file(path, MappedFile::Mode::ReadWrite);
+            REQUIRE(file.IsOpen());
+            file.WritableData()[0] = 'x';
+            REQUIRE(file.Flush());
+        }
+        std::string contents;
+        FileUtil::ReadFileToString(true, path.c_str(), contents);
+        REQUIRE(contents == "x123456789");
+    }
+
+    FileUtil::Delete(path);
+}
+
+TEST_CASE("MappedFile - Empty and missing files", "[common]") {
+    const std::string path = "./mapped_file_empty_test";
+    FileUtil::WriteStringToFile(true, "", path.c_str());
+    REQUIRE(!MappedFile(path).IsOpen());
+    FileUtil::Delete(path);
+
+    REQUIRE(!MappedFile("./mapped_file_missing_test").IsOpen());
+}
+
+} // namespace FileUtil
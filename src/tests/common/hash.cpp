@@ -0,0 +1,103 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <vector>
+#include <catch.hpp>
+#include "common/hash.h"
+
+namespace Common {
+
+constexpr HashIsa ALL_ISAS[] = {HashIsa::Scalar, HashIsa::SSE2, HashIsa::AVX2};
+
+static std::vector<u8> GenerateData(size_t size) {
+    std::mt19937 generator(1234);
+    std::vector<u8> data(size);
+    for (u8& byte : data) {
+        byte = static_cast<u8>(generator());
+    }
+    return data;
+}
+
+TEST_CASE("FastHasher - Streaming matches one-shot", "[common]") {
+    const std::vector<u8> data = GenerateData(5000);
+
+    for (const size_t len : {0, 1, 63, 64, 65, 1023, 1024, 1025, 5000}) {
+        const u64 expected = ComputeFastHash64(data.data(), len, 42);
+        for (const size_t chunk : {1, 7, 64, 100, 1024}) {
+            FastHasher hasher(42);
+            for (size_t offset = 0; offset < len; offset += chunk) {
+                hasher.Update(data.data() + offset, std::min(chunk, len - offset));
+            }
+            REQUIRE(hasher.Finalize() == expected);
+        }
+    }
+}
+
+TEST_CASE("FastHasher - Instruction sets agree", "[common]") {
+    const std::vector<u8> data = GenerateData(10000);
+    SetHashIsa(HashIsa::Scalar);
+    const u64 expected = ComputeFastHash64(data.data(), data.size());
+
+    for (const HashIsa isa : ALL_ISAS) {
+        if (!IsHashIsaSupported(isa)) {
+            continue;
+        }
+        SetHashIsa(isa);
+        REQUIRE(ComputeFastHash64(data.data(), data.size()) == expected);
+    }
+}
+
+TEST_CASE("FastHasher - Distinguishes inputs", "[common]") {
+    std::vector<u8> data = GenerateData(2048);
+    std::set<u64> hashes;
+    // Lengths differing only by zero padding, seeds and single bit flips
+    std::vector<u8> zeroes(130);
+    for (size_t len = 0; len <= zeroes.size(); ++len) {
+        REQUIRE(hashes.insert(ComputeFastHash64(zeroes.data(), len)).second);
+    }
+    for (u64 seed = 1; seed < 16; ++seed) {
+        REQUIRE(hashes.insert(ComputeFastHash64(data.data(), data.size(), seed)).second);
+    }
+    for (size_t bit = 0; bit < data.size() * 8; bit += 61) {
+        data[bit / 8] ^= 1 << (bit % 8);
+        REQUIRE(hashes.insert(ComputeFastHash64(data.data(), data.size())).second);
+        data[bit / 8] ^= 1 << (bit % 8);
+    }
+}
+
+// Not run by default, select it with the [benchmark] tag
+TEST_CASE("Hash[Benchmark]", "[.][benchmark]") {
+    // A 1280x720 RGBA8 framebuffer
+    const std::vector<u8> data = GenerateData(1280 * 720 * 4);
+    constexpr int iterations = 50;
+
+    const auto report = [&](const char* name, auto&& hash) {
+        u64 result = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            result += hash();
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const double bytes_per_second = data.size() * iterations / elapsed.count();
+        std::printf("%-24s %8.2f GB/s (%016llx)\n", name, bytes_per_second / 1e9,
+                    static_cast<unsigned long long>(result));
+    };
+
+    report("ComputeHash64", [&] { return ComputeHash64(data.data(), data.size()); });
+    const char* isa_names[] = {"FastHash64 (scalar)", "FastHash64 (SSE2)", "FastHash64 (AVX2)"};
+    for (const HashIsa isa : ALL_ISAS) {
+        if (!IsHashIsaSupported(isa)) {
+            continue;
+        }
+        SetHashIsa(isa);
+        report(isa_names[static_cast<size_t>(isa)],
+               [&] { return ComputeFastHash64(data.data(), data.size()); });
+    }
+}
+
+} // namespace Common
@@ -22,4 +22,20 @@ TEST_CASE("ParamPackage", "[common]") {
     REQUIRE(copy.Get("abc", 42) == 42);
 }
 
+TEST_CASE("ParamPackage - Keys are unique and serialized in order", "[common]") {
+    ParamPackage package{{"port", "26760"}, {"engine", "sdl"}, {"engine", "keyboard"}};
+    REQUIRE(package.Get("engine", "") == "sdl");
+    package.Set("button", 3);
+    package.Set("port", "1234");
+    REQUIRE(package.Serialize() == "button:3,engine:sdl,port:1234");
+    REQUIRE(ParamPackage("port:1234,engine:sdl,button:3").Serialize() == package.Serialize());
+
+    // Invalid pairs are skipped and the last value of a key repeated in a string wins
+    ParamPackage parsed("engine:sdl,broken,a:b:c,,engine:keyboard,code:$0$1$2");
+    REQUIRE(parsed.Serialize() == "code:$0$1$2,engine:keyboard");
+    REQUIRE(parsed.Get("code", "") == ":,$");
+    REQUIRE(!parsed.Has("broken"));
+    REQUIRE(!ParamPackage("").Has("engine"));
+}
+
 } // namespace Common
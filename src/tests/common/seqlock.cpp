@@ -0,0 +1,61 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <catch.hpp>
+#include "common/seqlock.h"
+
+namespace Common {
+
+namespace {
+/// Every word holds the same value, a torn read would mix two of them
+struct TestValue {
+    std::array<u64, 8> words;
+};
+} // Anonymous namespace
+
+TEST_CASE("SeqLock[ReadWrite]", "[common]") {
+    SeqLock<TestValue> lock;
+    REQUIRE(lock.Read().words[0] == 0);
+
+    TestValue value{};
+    value.words.fill(42);
+    lock.Write(value);
+    REQUIRE(lock.Read().words == value.words);
+}
+
+TEST_CASE("SeqLock[Concurrent]", "[common]") {
+    constexpr u64 num_writes = 100000;
+    SeqLock<TestValue> lock;
+    std::atomic<bool> is_done{false};
+
+    std::thread writer([&] {
+        TestValue value{};
+        for (u64 i = 1; i <= num_writes; ++i) {
+            value.words.fill(i);
+            lock.Write(value);
+        }
+        is_done = true;
+    });
+
+    u64 previous = 0;
+    bool is_consistent = true;
+    while (!is_done) {
+        const TestValue value = lock.Read();
+        for (const u64 word : value.words) {
+            is_consistent &= word == value.words[0];
+        }
+        // Values are never seen going back in time
+        is_consistent &= value.words[0] >= previous;
+        previous = value.words[0];
+    }
+    writer.join();
+
+    REQUIRE(is_consistent);
+    REQUIRE(lock.Read().words[0] == num_writes);
+}
+
+} // namespace Common
@@ -0,0 +1,149 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "common/file_util.h"
+#include "common/state_stream.h"
+#include "common/thread_pool.h"
+
+namespace Common {
+
+/// Data that is half random bytes and half runs of a repeated byte, so that blocks compress
+static std::vector<u8> GenerateData(size_t size) {
+    std::mt19937 generator(1234);
+    std::vector<u8> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = (i / 4096) % 2 == 0 ? static_cast<u8>(generator()) : static_cast<u8>(i / 4096);
+    }
+    return data;
+}
+
+TEST_CASE("StateStream - Sections round trip", "[common]") {
+    const std::string path = "./state_stream_test";
+    ThreadPool pool(4);
+    // Spans several blocks, the last of them partial
+    const std::vector<u8> ram = GenerateData(StateFormat::BLOCK_SIZE * 5 + 1234);
+    const std::vector<u8> streamed = GenerateData(StateFormat::BLOCK_SIZE + 77);
+
+    {
+        StateWriter writer(pool);
+        REQUIRE(writer.Open(path));
+
+        writer.BeginSection("cpu", 3);
+        writer.Write(u64{0x123456789ABCDEF0});
+        writer.Write(std::string("registers"));
+        writer.Write(std::vector<u32>{1, 2, 3});
+        REQUIRE(writer.EndSection());
+
+        REQUIRE(writer.WriteSection("ram", 1, ram.data(), ram.size()));
+
+        writer.BeginSection("raw", 2, StateCompression::None);
+        // Written in pieces crossing the block boundaries
+        constexpr size_t PIECE_SIZE = 100000;
+        for (size_t offset = 0; offset < streamed.size(); offset += PIECE_SIZE) {
+            writer.Write(streamed.data() + offset, std::min(PIECE_SIZE, streamed.size() - offset));
+        }
+        REQUIRE(writer.Close());
+    }
+
+    StateReader reader(pool);
+    REQUIRE(reader.Open(path));
+
+    REQUIRE(reader.BeginSection("cpu", 2, 3) == 3);
+    u64 value = 0;
+    std::string name;
+    std::vector<u32> values;
+    REQUIRE(reader.Read(value));
+    REQUIRE(reader.Read(name));
+    REQUIRE(reader.Read(values));
+    REQUIRE(value == 0x123456789ABCDEF0);
+    REQUIRE(name == "registers");
+    REQUIRE(values.size() == 3);
+    REQUIRE(values[0] == 1);
+    REQUIRE(values[2] == 3);
+    // Reading past the end of the section fails
+    REQUIRE(!reader.Read(value));
+
+    REQUIRE(reader.GetSectionSize("ram") == ram.size());
+    std::vector<u8> loaded_ram(ram.size());
+    REQUIRE(reader.ReadSection("ram", 1, 1, loaded_ram.data(), loaded_ram.size()) == 1);
+    REQUIRE(loaded_ram == ram);
+
+    // Sections can be read in any order, and whole sections can be streamed as well
+    REQUIRE(reader.BeginSection("ram", 1, 1) == 1);
+    std::vector<u8> streamed_ram(ram.size());
+    REQUIRE(reader.Read(streamed_ram.data(), streamed_ram.size()));
+    REQUIRE(streamed_ram == ram);
+
+    std::vector<u8> loaded(streamed.size());
+    REQUIRE(reader.ReadSection("raw", 1, 2, loaded.data(), loaded.size()) == 2);
+    REQUIRE(loaded == streamed);
+
+    // The compressed section takes less space than the uncompressed one
+    REQUIRE(FileUtil::GetSize(path) < ram.size() + streamed.size());
+
+    FileUtil::Delete(path);
+}
+
+TEST_CASE("StateStream - Missing sections and unsupported versions", "[common]") {
+    const std::string path = "./state_stream_version_test";
+    ThreadPool pool(2);
+    {
+        StateWriter writer(pool);
+        REQUIRE(writer.Open(path));
+        writer.BeginSection("timing", 4);
+        writer.Write(u32{42});
+        REQUIRE(writer.Close());
+    }
+
+    StateReader reader(pool);
+    REQUIRE(reader.Open(path));
+    REQUIRE(reader.BeginSection("missing", 1, 1) == 0);
+    REQUIRE(reader.GetSectionSize("missing") == 0);
+    REQUIRE(reader.BeginSection("timing", 1, 3) == 0);
+    REQUIRE(reader.BeginSection("timing", 5, 6) == 0);
+
+    u32 value = 0;
+    REQUIRE(!reader.Read(value));
+    REQUIRE(reader.BeginSection("timing", 4, 4) == 4);
+    REQUIRE(reader.Read(value));
+    REQUIRE(value == 42);
+
+    FileUtil::Delete(path);
+}
+
+TEST_CASE("StateStream - Corrupted files are rejected", "[common]") {
+    const std::string path = "./state_stream_corrupt_test";
+    ThreadPool pool(2);
+    const std::vector<u8> data = GenerateData(100000);
+    {
+        StateWriter writer(pool);
+        REQUIRE(writer.Open(path));
+        REQUIRE(writer.WriteSection("data", 1, data.data(), data.size()));
+        REQUIRE(writer.Close());
+    }
+
+    // Truncating the file cuts the section short
+    const u64 size = FileUtil::GetSize(path);
+    {
+        FileUtil::IOFile file(path, "r+b");
+        REQUIRE(file.Resize(size - 10));
+    }
+    StateReader reader(pool);
+    REQUIRE(!reader.Open(path));
+
+    {
+        FileUtil::IOFile file(path, "wb");
+        file.WriteBytes("not a state file", 16);
+    }
+    REQUIRE(!reader.Open(path));
+
+    FileUtil::Delete(path);
+}
+
+} // namespace Common
@@ -0,0 +1,88 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <catch.hpp>
+#include "common/string_util.h"
+
+namespace Common {
+
+TEST_CASE("UTF8ToUTF16 - Valid strings", "[common]") {
+    REQUIRE(UTF8ToUTF16("") == u"");
+    REQUIRE(UTF8ToUTF16("/save/file.bin") == u"/save/file.bin");
+    // Two, three and four byte sequences, inside and after ASCII runs longer than a vector
+    const std::string mixed = "0123456789abcdef\xC3\xA9\xE3\x81\x82\xF0\x9F\x98\x80xyz";
+    REQUIRE(UTF8ToUTF16(mixed) == u"0123456789abcdeféあ\U0001F600xyz");
+    REQUIRE(UTF16ToUTF8(UTF8ToUTF16(mixed)) == mixed);
+}
+
+TEST_CASE("UTF8ToUTF16 - Invalid sequences", "[common]") {
+    // Stray continuation byte, overlong encoding, encoded surrogate and truncated sequence
+    REQUIRE(UTF8ToUTF16("a\x80"
+                        "b") == u"a\uFFFDb");
+    REQUIRE(UTF8ToUTF16("\xC0\xAF") == u"\uFFFD\uFFFD");
+    REQUIRE(UTF8ToUTF16("\xED\xA0\x80") == u"\uFFFD\uFFFD\uFFFD");
+    REQUIRE(UTF8ToUTF16("\xE3\x81") == u"\uFFFD\uFFFD");
+}
+
+TEST_CASE("UTF16ToUTF8 - Surrogates", "[common]") {
+    REQUIRE(UTF16ToUTF8(u"\U0001F600") == "\xF0\x9F\x98\x80");
+    const std::u16string unpaired{u'a', 0xD800, u'b', 0xDC00};
+    REQUIRE(UTF16ToUTF8(unpaired) == "a\xEF\xBF\xBD"
+                                     "b\xEF\xBF\xBD");
+}
+
+TEST_CASE("UTF16ToUTF8 - Reused output", "[common]") {
+    std::string output = "previous contents that are longer";
+    UTF16ToUTF8(u"short", output);
+    REQUIRE(output == "short");
+
+    std::u16string wide_output = u"previous contents that are longer";
+    UTF8ToUTF16("short", wide_output);
+    REQUIRE(wide_output == u"short");
+}
+
+TEST_CASE("SplitString - Views", "[common]") {
+    std::vector<std::string_view> fields;
+    SplitString(std::string_view("/a//b/"), '/', fields);
+    const std::vector<std::string_view> expected{"", "a", "", "b"};
+    REQUIRE(fields == expected);
+
+    SplitString(std::string_view(""), '/', fields);
+    REQUIRE(fields.empty());
+
+    // Same fields as the copying version
+    std::vector<std::string> copies;
+    SplitString(std::string("/a//b/"), '/', copies);
+    REQUIRE(copies == std::vector<std::string>(expected.begin(), expected.end()));
+}
+
+TEST_CASE("TrimSpaces", "[common]") {
+    REQUIRE(TrimSpaces("  \tkey = value\r\n") == "key = value");
+    REQUIRE(TrimSpaces(" \t ").empty());
+    REQUIRE(StripSpaces(" value ") == "value");
+}
+
+TEST_CASE("UTF8ToUTF16 - Benchmark", "[.][benchmark]") {
+    const std::string ascii_path = "/switch/title/romfs/data/archive/stage_01/model.bin";
+    std::u16string output;
+    const auto start = std::chrono::steady_clock::now();
+    size_t total = 0;
+    for (int i = 0; i < 1000000; ++i) {
+        UTF8ToUTF16(ascii_path, output);
+        total += output.size();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    std::printf("UTF8ToUTF16: %lld ns per path (%zu)\n",
+                static_cast<long long>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() /
+                    1000000),
+                total);
+}
+
+} // namespace Common
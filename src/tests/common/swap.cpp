@@ -0,0 +1,83 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <random>
+#include <vector>
+#include <catch.hpp>
+#include "common/kernel_dispatch.h"
+#include "common/swap.h"
+
+namespace Common {
+
+constexpr SwapIsa ALL_ISAS[] = {SwapIsa::Scalar, SwapIsa::SSSE3, SwapIsa::AVX2};
+
+/// Swaps every value of an array with the scalar functions
+template <typename T, T (*Swap)(T)>
+static std::vector<T> SwapEach(std::vector<T> values) {
+    for (T& value : values) {
+        value = Swap(value);
+    }
+    return values;
+}
+
+template <typename T>
+static std::vector<T> GenerateValues(size_t count) {
+    std::mt19937_64 generator(1234);
+    std::vector<T> values(count);
+    for (T& value : values) {
+        value = static_cast<T>(generator());
+    }
+    return values;
+}
+
+TEST_CASE("Swap - Arrays are swapped like single values", "[common]") {
+    for (const SwapIsa isa : ALL_ISAS) {
+        if (!IsSwapIsaSupported(isa)) {
+            continue;
+        }
+        SetSwapIsa(isa);
+        // Counts around the number of values the vector kernels swap at once
+        for (const size_t count : {0, 1, 3, 7, 8, 9, 15, 16, 17, 33, 1000}) {
+            const auto values16 = GenerateValues<u16>(count);
+            std::vector<u16> swapped16(count);
+            SwapBytes16(values16.data(), swapped16.data(), count);
+            REQUIRE((swapped16 == SwapEach<u16, swap16>(values16)));
+
+            const auto values32 = GenerateValues<u32>(count);
+            std::vector<u32> swapped32(count);
+            SwapBytes32(values32.data(), swapped32.data(), count);
+            REQUIRE((swapped32 == SwapEach<u32, swap32>(values32)));
+
+            // In place, starting at an unaligned address
+            std::vector<u8> bytes(count * sizeof(u64) + 1);
+            const auto values64 = GenerateValues<u64>(count);
+            std::memcpy(bytes.data() + 1, values64.data(), count * sizeof(u64));
+            SwapBytes64(bytes.data() + 1, bytes.data() + 1, count);
+            std::vector<u64> swapped64(count);
+            std::memcpy(swapped64.data(), bytes.data() + 1, count * sizeof(u64));
+            REQUIRE((swapped64 == SwapEach<u64, swap64>(values64)));
+        }
+    }
+}
+
+TEST_CASE("Swap - Spans of floats round trip", "[common]") {
+    std::vector<float> values{1.0f, -2.5f, 3.25f, 1e10f, 0.0f};
+    const std::vector<float> original = values;
+    SwapSpan(values.data(), values.size());
+    REQUIRE(values[0] == swapf(1.0f));
+    SwapSpan(values.data(), values.size());
+    REQUIRE(values == original);
+}
+
+TEST_CASE("Swap - The kernels in use are recorded", "[common]") {
+    SetSwapIsa(SwapIsa::Scalar);
+    REQUIRE(GetKernelSelections()["ByteSwap"] == "Scalar");
+    if (IsSwapIsaSupported(SwapIsa::AVX2)) {
+        SetSwapIsa(SwapIsa::AVX2);
+        REQUIRE(GetKernelSelections()["ByteSwap"] == "AVX2");
+    }
+}
+
+} // namespace Common
@@ -0,0 +1,75 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <vector>
+#include <catch.hpp>
+#include "common/thread.h"
+#include "common/thread_pool.h"
+
+namespace Common {
+
+TEST_CASE("ThreadPool - Results and exceptions", "[common]") {
+    ThreadPool pool(4);
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 100; ++i) {
+        futures.push_back(pool.Submit([i] { return i * i; }));
+    }
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(futures[i].get() == i * i);
+    }
+
+    auto failing = pool.Submit([]() -> int { throw std::runtime_error("task failed"); });
+    REQUIRE_THROWS_AS(failing.get(), std::runtime_error);
+}
+
+TEST_CASE("ThreadPool - Priorities", "[common]") {
+    ThreadPool pool(1);
+    std::promise<void> release;
+    auto blocker = pool.Submit([gate = release.get_future()]() mutable { gate.wait(); });
+
+    // Queued while the only worker is busy, so they all wait until it's released
+    std::vector<TaskPriority> order;
+    std::vector<std::future<void>> futures;
+    for (TaskPriority priority : {TaskPriority::Low, TaskPriority::Normal, TaskPriority::High}) {
+        futures.push_back(pool.Submit([&order, priority] { order.push_back(priority); }, priority));
+    }
+    release.set_value();
+    for (auto& future : futures) {
+        future.get();
+    }
+
+    const std::vector<TaskPriority> expected{TaskPriority::High, TaskPriority::Normal,
+                                             TaskPriority::Low};
+    REQUIRE(order == expected);
+}
+
+TEST_CASE("ThreadPool - Stealing", "[common]") {
+    ThreadPool pool(2);
+    // Both tasks go to the first worker, they can only meet when the other worker steals one
+    Barrier barrier(2);
+    auto first = pool.Submit([&barrier] { barrier.Sync(); }, TaskPriority::Normal, 0);
+    auto second = pool.Submit([&barrier] { barrier.Sync(); }, TaskPriority::Normal, 0);
+    first.get();
+    second.get();
+}
+
+TEST_CASE("ThreadPool - Nested tasks run before the pool stops", "[common]") {
+    std::atomic<int> count{0};
+    {
+        ThreadPool pool(3);
+        for (int i = 0; i < 10; ++i) {
+            pool.Submit([&pool, &count] {
+                for (int j = 0; j < 10; ++j) {
+                    pool.Submit([&count] { ++count; });
+                }
+            });
+        }
+    }
+    REQUIRE(count == 100);
+}
+
+} // namespace Common
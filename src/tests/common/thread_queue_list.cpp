@@ -0,0 +1,86 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <catch.hpp>
+#include "common/thread_queue_list.h"
+
+namespace Common {
+
+namespace {
+struct TestThread {
+    ThreadQueueNode<TestThread> node;
+};
+
+using TestQueue = ThreadQueueList<TestThread, 64, &TestThread::node>;
+} // Anonymous namespace
+
+TEST_CASE("ThreadQueueList[Order]", "[common]") {
+    TestQueue queue;
+    TestThread a, b, c, d;
+
+    REQUIRE(queue.get_first() == nullptr);
+
+    queue.push_back(40, &a);
+    queue.push_back(40, &b);
+    queue.push_front(40, &c);
+    queue.push_back(63, &d);
+
+    REQUIRE(queue.contains(&a) == 40);
+    REQUIRE(queue.contains(&d) == 63);
+    REQUIRE(queue.pop_first_better(40) == nullptr);
+    REQUIRE(queue.pop_first_better(41) == &c);
+
+    queue.rotate(40);
+    REQUIRE(queue.pop_first() == &b);
+    REQUIRE(queue.pop_first() == &a);
+    REQUIRE(queue.empty(40));
+    REQUIRE(queue.contains(&a) == TestQueue::Priority(-1));
+    REQUIRE(queue.pop_first() == &d);
+    REQUIRE(queue.pop_first() == nullptr);
+}
+
+TEST_CASE("ThreadQueueList[RemoveAndMove]", "[common]") {
+    TestQueue queue;
+    TestThread a, b, c;
+
+    queue.push_back(10, &a);
+    queue.push_back(10, &b);
+    queue.push_back(10, &c);
+
+    queue.remove(10, &b);
+    REQUIRE(queue.contains(&b) == TestQueue::Priority(-1));
+
+    queue.move(&c, 10, 0);
+    REQUIRE(queue.get_first() == &c);
+    queue.move(&c, 0, 63);
+    REQUIRE(queue.pop_first() == &a);
+    REQUIRE(queue.pop_first() == &c);
+
+    queue.push_back(5, &a);
+    queue.push_back(6, &b);
+    queue.clear();
+    REQUIRE(queue.get_first() == nullptr);
+    REQUIRE(queue.contains(&a) == TestQueue::Priority(-1));
+}
+
+TEST_CASE("ThreadQueueList[GetNext]", "[common]") {
+    TestQueue queue;
+    TestThread a, b, c, d;
+
+    queue.push_back(63, &d);
+    queue.push_back(7, &a);
+    queue.push_back(7, &b);
+    queue.push_back(20, &c);
+
+    REQUIRE(queue.get_first() == &a);
+    REQUIRE(queue.get_next(&a) == &b);
+    REQUIRE(queue.get_next(&b) == &c);
+    REQUIRE(queue.get_next(&c) == &d);
+    REQUIRE(queue.get_next(&d) == nullptr);
+
+    queue.remove(20, &c);
+    REQUIRE(queue.get_next(&b) == &d);
+}
+
+} // namespace Common
@@ -0,0 +1,173 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <catch.hpp>
+#include "common/threadsafe_queue.h"
+
+namespace Common {
+
+TEST_CASE("BoundedSPSCQueue - Order and capacity", "[common]") {
+    BoundedSPSCQueue<int, 4> queue;
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(queue.TryPush(i));
+    }
+    REQUIRE(!queue.TryPush(4));
+    REQUIRE(queue.Size() == 4);
+
+    int value;
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(queue.TryPop(value));
+        REQUIRE(value == i);
+    }
+    REQUIRE(!queue.TryPop(value));
+    REQUIRE(!queue.PopWaitFor(value, std::chrono::milliseconds(1)));
+    REQUIRE(queue.Empty());
+}
+
+TEST_CASE("BoundedSPSCQueue - Blocking transfer", "[common]") {
+    constexpr int count = 100000;
+    auto queue = std::make_unique<BoundedSPSCQueue<int, 16>>();
+    std::thread producer([&] {
+        for (int i = 0; i < count; ++i) {
+            queue->Push(i);
+        }
+    });
+
+    bool in_order = true;
+    for (int i = 0; i < count; ++i) {
+        int value;
+        queue->PopWait(value);
+        in_order = in_order && value == i;
+    }
+    producer.join();
+    REQUIRE(in_order);
+    REQUIRE(queue->Empty());
+}
+
+TEST_CASE("BoundedMPMCQueue - Order and capacity", "[common]") {
+    BoundedMPMCQueue<int, 4> queue;
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(queue.TryPush(i));
+    }
+    REQUIRE(!queue.TryPush(4));
+
+    int value;
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(queue.TryPop(value));
+        REQUIRE(value == i);
+    }
+    REQUIRE(!queue.TryPop(value));
+    REQUIRE(!queue.PopWaitFor(value, std::chrono::milliseconds(1)));
+}
+
+TEST_CASE("BoundedMPMCQueue - Blocking transfer", "[common]") {
+    constexpr int num_producers = 4;
+    constexpr int num_consumers = 3;
+    constexpr int count_per_producer = 30000;
+    auto queue = std::make_unique<BoundedMPMCQueue<u64, 64>>();
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < num_producers; ++p) {
+        threads.emplace_back([&] {
+            for (int i = 1; i <= count_per_producer; ++i) {
+                queue->Push(static_cast<u64>(i));
+            }
+        });
+    }
+    // Every value is popped exactly once, so the sums add up
+    std::vector<u64> sums(num_consumers);
+    constexpr int total = num_producers * count_per_producer;
+    for (int c = 0; c < num_consumers; ++c) {
+        threads.emplace_back([&, c] {
+            const int share = total / num_consumers + (c < total % num_consumers ? 1 : 0);
+            for (int i = 0; i < share; ++i) {
+                u64 value;
+                queue->PopWait(value);
+                sums[c] += value;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    u64 sum = 0;
+    for (u64 consumer_sum : sums) {
+        sum += consumer_sum;
+    }
+    REQUIRE(sum == u64{num_producers} * count_per_producer * (count_per_producer + 1) / 2);
+    REQUIRE(queue->Empty());
+}
+
+/// Runs producers pushing into a queue and a consumer polling it, returns the elements per second
+template <typename PushFunc, typename PopFunc>
+static double MeasureThroughput(int num_producers, int count_per_producer, PushFunc push,
+                                PopFunc try_pop) {
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&] {
+            for (int i = 0; i < count_per_producer; ++i) {
+                push(i);
+            }
+        });
+    }
+    for (int popped = 0; popped < num_producers * count_per_producer;) {
+        if (try_pop()) {
+            ++popped;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return num_producers * count_per_producer / elapsed.count();
+}
+
+// Not run by default, select it with the [benchmark] tag
+TEST_CASE("ThreadsafeQueue[Benchmark]", "[.][benchmark]") {
+    constexpr int count = 2000000;
+    constexpr int num_producers = 4;
+    int value;
+
+    {
+        SPSCQueue<int, false> queue;
+        std::printf("%-24s %6.1f M/s\n", "SPSCQueue",
+                    MeasureThroughput(1, count, [&](int i) { queue.Push(i); },
+                                      [&] { return queue.Pop(value); }) /
+                        1e6);
+    }
+    {
+        auto queue = std::make_unique<BoundedSPSCQueue<int, 1024>>();
+        std::printf("%-24s %6.1f M/s\n", "BoundedSPSCQueue",
+                    MeasureThroughput(1, count, [&](int i) { queue->Push(i); },
+                                      [&] { return queue->TryPop(value); }) /
+                        1e6);
+    }
+    {
+        MPSCQueue<int, false> queue;
+        std::printf("%-24s %6.1f M/s\n", "MPSCQueue (4 p.)",
+                    MeasureThroughput(num_producers, count / num_producers,
+                                      [&](int i) { queue.Push(i); },
+                                      [&] { return queue.Pop(value); }) /
+                        1e6);
+    }
+    {
+        auto queue = std::make_unique<BoundedMPMCQueue<int, 1024>>();
+        std::printf("%-24s %6.1f M/s\n", "BoundedMPMCQueue (4 p.)",
+                    MeasureThroughput(num_producers, count / num_producers,
+                                      [&](int i) { queue->Push(i); },
+                                      [&] { return queue->TryPop(value); }) /
+                        1e6);
+    }
+}
+
+} // namespace Common
@@ -0,0 +1,59 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <random>
+#include <catch.hpp>
+#include "common/common_types.h"
+#include "common/vector_math.h"
+
+namespace Math {
+
+static bool BitwiseEqual(const Vec4<float>& a, const Vec4<float>& b) {
+    return std::memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+TEST_CASE("VectorMath - Vec4 arithmetic matches the scalar code", "[common]") {
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> distribution(-1000.0f, 1000.0f);
+    const auto random_vec = [&] {
+        return MakeVec(distribution(generator), distribution(generator), distribution(generator),
+                       distribution(generator));
+    };
+
+    for (int i = 0; i < 1000; ++i) {
+        const Vec4<float> a = random_vec();
+        const Vec4<float> b = random_vec();
+        const float t = distribution(generator) / 1000.0f;
+
+        REQUIRE(BitwiseEqual(a + b, MakeVec(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w)));
+        REQUIRE(BitwiseEqual(a - b, MakeVec(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w)));
+        REQUIRE(BitwiseEqual(a * b, MakeVec(a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w)));
+
+        Vec4<float> sum = a;
+        sum += b;
+        REQUIRE(BitwiseEqual(sum, a + b));
+
+        const float dot = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+        REQUIRE(Dot(a, b) == dot);
+        REQUIRE(a.Length2() == Dot(a, a));
+
+        const Vec4<float> lerp =
+            MakeVec(a.x * (1.f - t) + b.x * t, a.y * (1.f - t) + b.y * t,
+                    a.z * (1.f - t) + b.z * t, a.w * (1.f - t) + b.w * t);
+        REQUIRE(BitwiseEqual(Lerp(a, b, t), lerp));
+    }
+}
+
+TEST_CASE("VectorMath - Vec4<u8> conversion and interpolation", "[common]") {
+    const Vec4<u8> begin = MakeVec<u8>(0, 17, 128, 255);
+    const Vec4<u8> end = MakeVec<u8>(255, 3, 128, 0);
+
+    REQUIRE(BitwiseEqual(begin.Cast<float>(), MakeVec(0.0f, 17.0f, 128.0f, 255.0f)));
+    REQUIRE(BitwiseEqual(Lerp(begin, end, 0.25f), Lerp(begin.Cast<float>(), end.Cast<float>(),
+                                                       0.25f)));
+    REQUIRE(BitwiseEqual(Lerp(begin, end, 1.0f), end.Cast<float>()));
+}
+
+} // namespace Math
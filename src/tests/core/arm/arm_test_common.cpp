@@ -18,9 +18,7 @@ TestEnvironment::TestEnvironment(bool mutable_memory_)
     Kernel::g_current_process = Kernel::Process::Create("");
     page_table = &Kernel::g_current_process->vm_manager.page_table;
 
-    page_table->pointers.fill(nullptr);
-    page_table->attributes.fill(Memory::PageType::Unmapped);
-    page_table->cached_res_count.fill(0);
+    page_table->Clear();
 
     Memory::MapIoRegion(*page_table, 0x00000000, 0x80000000, test_memory);
     Memory::MapIoRegion(*page_table, 0x80000000, 0x80000000, test_memory);
@@ -6,7 +6,10 @@
 
 #include <array>
 #include <bitset>
+#include <chrono>
 #include <string>
+#include <thread>
+#include <vector>
 #include "common/file_util.h"
 #include "core/core.h"
 #include "core/core_timing.h"
@@ -235,3 +238,141 @@ TEST_CASE("CoreTiming[ChainScheduling]", "[core]") {
     REQUIRE(0 == reschedules);
     REQUIRE(MAX_SLICE_LENGTH == CoreTiming::GetDowncount());
 }
+
+namespace UnscheduleTest {
+static std::vector<u64> fired;
+
+static void RecordCallback(u64 userdata, s64 cycles_late) {
+    fired.push_back(userdata);
+}
+} // namespace UnscheduleTest
+
+TEST_CASE("CoreTiming[Unschedule]", "[core]") {
+    using namespace UnscheduleTest;
+
+    ScopeInit guard;
+
+    CoreTiming::EventType* cb = CoreTiming::RegisterEvent("callbackRecord", RecordCallback);
+
+    // Enter slice 0
+    CoreTiming::Advance();
+
+    // Schedule events in scrambled order, with a duplicate of one of them
+    for (u64 i = 0; i < 64; ++i) {
+        const u64 id = (i * 37) % 64;
+        CoreTiming::ScheduleEvent(100 + id * 10, cb, id);
+    }
+    CoreTiming::ScheduleEvent(50, cb, 21);
+
+    // Cancel every third event, including both copies of the duplicated one
+    for (u64 id = 0; id < 64; id += 3) {
+        CoreTiming::UnscheduleEvent(cb, id);
+    }
+
+    fired.clear();
+    for (int i = 0; i < 64; ++i) {
+        CoreTiming::AddTicks(CoreTiming::GetDowncount());
+        CoreTiming::Advance();
+    }
+
+    std::vector<u64> expected;
+    for (u64 id = 0; id < 64; ++id) {
+        if (id % 3 != 0) {
+            expected.push_back(id);
+        }
+    }
+    REQUIRE(expected == fired);
+}
+
+TEST_CASE("CoreTiming[HostEvents]", "[core]") {
+    using namespace UnscheduleTest;
+
+    ScopeInit guard;
+
+    CoreTiming::EventType* cb = CoreTiming::RegisterEvent("callbackRecord", RecordCallback);
+
+    // Enter slice 0
+    CoreTiming::Advance();
+
+    int wakeups = 0;
+    CoreTiming::SetHostEventWakeupCallback([&wakeups] { ++wakeups; });
+
+    std::thread producer([cb] {
+        CoreTiming::HostEventBatch batch;
+        batch.Add(cb, 1);
+        batch.Add(cb, 2);
+        CoreTiming::SubmitHostEvents(std::move(batch));
+        CoreTiming::ScheduleEventFromHost(cb, 3, std::chrono::nanoseconds::zero(), true);
+        CoreTiming::ScheduleEventFromHost(cb, 4, std::chrono::hours(1));
+    });
+    producer.join();
+    CoreTiming::SetHostEventWakeupCallback(nullptr);
+    REQUIRE(1 == wakeups);
+
+    // Events without a delay arrive in submission order at the next slice boundary, the delayed
+    // one stays scheduled roughly an hour of guest time in the future.
+    fired.clear();
+    CoreTiming::Advance();
+    REQUIRE(std::vector<u64>{1, 2, 3} == fired);
+    REQUIRE(MAX_SLICE_LENGTH == CoreTiming::GetDowncount());
+    CoreTiming::UnscheduleEvent(cb, 4);
+}
+
+TEST_CASE("CoreTiming[AdaptiveSliceLength]", "[core]") {
+    ScopeInit guard;
+
+    CoreTiming::EventType* cb_a = CoreTiming::RegisterEvent("callbackA", CallbackTemplate<0>);
+    CoreTiming::SetAdaptiveSliceLength(true);
+    CoreTiming::Advance();
+
+    // Quiet slices that run to completion grow the slice length
+    CoreTiming::AddTicks(CoreTiming::GetDowncount());
+    CoreTiming::Advance();
+    REQUIRE(MAX_SLICE_LENGTH * 2 == CoreTiming::GetDowncount());
+    CoreTiming::AddTicks(CoreTiming::GetDowncount());
+    CoreTiming::Advance();
+    REQUIRE(MAX_SLICE_LENGTH * 4 == CoreTiming::GetDowncount());
+
+    // Slices are still cut short by the next event
+    CoreTiming::ScheduleEvent(1000, cb_a, CB_IDS[0]);
+    REQUIRE(1000 == CoreTiming::GetDowncount());
+    AdvanceAndCheck(0, MAX_SLICE_LENGTH * 4);
+
+    // Events from other threads bring it back to the default length
+    CoreTiming::ScheduleEventThreadsafe(MAX_SLICE_LENGTH * 8, cb_a, CB_IDS[0]);
+    CoreTiming::Advance();
+    REQUIRE(MAX_SLICE_LENGTH == CoreTiming::GetDowncount());
+}
+
+TEST_CASE("CoreTiming[Contexts]", "[core]") {
+    ScopeInit guard;
+    CoreTiming::Advance();
+    CoreTiming::AddTicks(1000);
+    CoreTiming::Advance();
+    REQUIRE(1000 == CoreTiming::GetTicks());
+
+    // A bound context has its own clock and event types, the default one is left untouched. The
+    // checks are made on this thread, as Catch doesn't support assertions from others.
+    u64 start_ticks = 0;
+    s64 fired_at = -1;
+    std::thread other_system([&] {
+        CoreTiming::ContextPtr context = CoreTiming::CreateContext();
+        CoreTiming::BindContext(context.get());
+        CoreTiming::Init();
+        CoreTiming::EventType* cb_a = CoreTiming::RegisterEvent(
+            "callbackA", [&](u64, int) { fired_at = CoreTiming::GetTicks(); });
+        CoreTiming::Advance();
+        start_ticks = CoreTiming::GetTicks();
+        CoreTiming::ScheduleEvent(500, cb_a);
+        CoreTiming::AddTicks(CoreTiming::GetDowncount());
+        CoreTiming::Advance();
+        CoreTiming::Shutdown();
+        CoreTiming::BindContext(nullptr);
+    });
+    other_system.join();
+
+    REQUIRE(0 == start_ticks);
+    REQUIRE(500 == fired_at);
+    REQUIRE(1000 == CoreTiming::GetTicks());
+    REQUIRE(CoreTiming::RegisterEvent("callbackA", CallbackTemplate<0>) != nullptr);
+}
@@ -0,0 +1,124 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "core/crypto/aes.h"
+
+namespace Crypto {
+
+static std::vector<u8> FromHex(const std::string& hex) {
+    std::vector<u8> bytes;
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        bytes.push_back(static_cast<u8>(std::stoul(hex.substr(i, 2), nullptr, 16)));
+    }
+    return bytes;
+}
+
+template <typename Array>
+static Array ArrayFromHex(const std::string& hex) {
+    const std::vector<u8> bytes = FromHex(hex);
+    Array array{};
+    std::copy(bytes.begin(), bytes.end(), array.begin());
+    return array;
+}
+
+/// Runs the checks on every instruction set the host supports
+template <typename Checks>
+static void ForEachIsa(const Checks& checks) {
+    for (AESIsa isa : {AESIsa::Software, AESIsa::AESNI}) {
+        if (IsAESIsaSupported(isa)) {
+            SetAESIsa(isa);
+            checks();
+        }
+    }
+    SetAESIsa(AESIsa::Software);
+}
+
+TEST_CASE("AES - Block cipher", "[core][crypto]") {
+    ForEachIsa([] {
+        // FIPS-197 appendix C.1
+        const AESCipher cipher(ArrayFromHex<AESKey>("000102030405060708090a0b0c0d0e0f"));
+        const std::vector<u8> plaintext = FromHex("00112233445566778899aabbccddeeff");
+        std::vector<u8> data = plaintext;
+        cipher.EncryptBlocks(data.data(), data.data(), 1);
+        REQUIRE(data == FromHex("69c4e0d86a7b0430d8cdb78070b4c55a"));
+        cipher.DecryptBlocks(data.data(), data.data(), 1);
+        REQUIRE(data == plaintext);
+    });
+}
+
+TEST_CASE("AES - CTR", "[core][crypto]") {
+    ForEachIsa([] {
+        // SP 800-38A F.5.1
+        const AESCTRCipher cipher(ArrayFromHex<AESKey>("2b7e151628aed2a6abf7158809cf4f3c"),
+                                  ArrayFromHex<AESBlock>("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"));
+        const std::vector<u8> plaintext = FromHex("6bc1bee22e409f96e93d7e117393172a"
+                                                  "ae2d8a571e03ac9c9eb76fac45af8e51");
+        const std::vector<u8> ciphertext = FromHex("874d6191b620e3261bef6864990db6ce"
+                                                   "9806f66b7970fdff8617187bb9fffdff");
+        std::vector<u8> data(plaintext.size());
+        cipher.Encrypt(0, plaintext.data(), data.data(), data.size());
+        REQUIRE(data == ciphertext);
+
+        // Any range can be decrypted on its own
+        std::vector<u8> part(21);
+        cipher.Decrypt(5, ciphertext.data() + 5, part.data(), part.size());
+        REQUIRE(std::equal(part.begin(), part.end(), plaintext.begin() + 5));
+    });
+}
+
+TEST_CASE("AES - XTS", "[core][crypto]") {
+    ForEachIsa([] {
+        // IEEE 1619 vector 1
+        const AESXTSCipher cipher(AESKey{}, AESKey{}, 32);
+        std::vector<u8> data(32);
+        cipher.Encrypt(0, data.data(), data.data(), data.size());
+        REQUIRE(data == FromHex("917cf69ebd68b2ec9b9fe9a3eadda692"
+                                "cd43d2f59598ed858c02c2652fbf922e"));
+        cipher.Decrypt(0, data.data(), data.data(), data.size());
+        REQUIRE(data == std::vector<u8>(32));
+    });
+}
+
+TEST_CASE("AES - Large buffers round trip", "[core][crypto]") {
+    // Large enough to be transformed in parallel, in chunks that don't divide it evenly
+    std::vector<u8> plaintext(0x40000 * 5 + 0x200);
+    for (size_t i = 0; i < plaintext.size(); ++i) {
+        plaintext[i] = static_cast<u8>(i * 7);
+    }
+    const AESKey data_key = ArrayFromHex<AESKey>("2b7e151628aed2a6abf7158809cf4f3c");
+    const AESKey tweak_key = ArrayFromHex<AESKey>("000102030405060708090a0b0c0d0e0f");
+
+    std::vector<std::vector<u8>> ciphertexts;
+    ForEachIsa([&] {
+        const AESXTSCipher xts(data_key, tweak_key, 0x200, 3);
+        std::vector<u8> ciphertext(plaintext.size());
+        xts.Encrypt(0, plaintext.data(), ciphertext.data(), ciphertext.size());
+
+        std::vector<u8> data(ciphertext.size());
+        xts.Decrypt(0, ciphertext.data(), data.data(), data.size());
+        REQUIRE(data == plaintext);
+        // Sectors are decrypted on their own too
+        xts.Decrypt(0x400, ciphertext.data() + 0x400, data.data(), 0x400);
+        REQUIRE(std::equal(data.begin(), data.begin() + 0x400, plaintext.begin() + 0x400));
+
+        const AESCTRCipher ctr(data_key, AESBlock{});
+        const size_t size = plaintext.size() - 3;
+        ctr.Encrypt(0, plaintext.data(), data.data(), size);
+        ctr.Decrypt(0, data.data(), data.data(), size);
+        REQUIRE(std::equal(data.begin(), data.begin() + size, plaintext.begin()));
+
+        ciphertexts.push_back(std::move(ciphertext));
+    });
+
+    // Every instruction set gives the same results
+    for (const auto& ciphertext : ciphertexts) {
+        REQUIRE(ciphertext == ciphertexts.front());
+    }
+}
+
+} // namespace Crypto
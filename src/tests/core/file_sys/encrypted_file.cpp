@@ -0,0 +1,82 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <catch.hpp>
+#include "core/file_sys/encrypted_file.h"
+
+namespace FileSys {
+
+/// Read-only file over a buffer
+class MemoryFile final : public FileBackend {
+public:
+    explicit MemoryFile(std::vector<u8> data) : data(std::move(data)) {}
+
+    ResultVal<size_t> Read(u64 offset, size_t length, u8* buffer) const override {
+        if (offset >= data.size()) {
+            return MakeResult<size_t>(0);
+        }
+        length = std::min<size_t>(length, data.size() - offset);
+        std::memcpy(buffer, data.data() + offset, length);
+        return MakeResult<size_t>(length);
+    }
+    ResultVal<size_t> Write(u64, size_t, bool, const u8*) const override {
+        return MakeResult<size_t>(0);
+    }
+    u64 GetSize() const override {
+        return data.size();
+    }
+    bool SetSize(u64) const override {
+        return false;
+    }
+    bool Close() const override {
+        return true;
+    }
+    void Flush() const override {}
+
+private:
+    std::vector<u8> data;
+};
+
+TEST_CASE("EncryptedFile - Unaligned reads", "[core][file_sys]") {
+    constexpr size_t SECTOR_SIZE = 0x200;
+    std::vector<u8> plaintext(SECTOR_SIZE * 8);
+    for (size_t i = 0; i < plaintext.size(); ++i) {
+        plaintext[i] = static_cast<u8>(i * 13);
+    }
+    Crypto::AESKey data_key{};
+    Crypto::AESKey tweak_key{};
+    data_key[0] = 1;
+    tweak_key[0] = 2;
+
+    std::vector<u8> ciphertext(plaintext.size());
+    Crypto::AESXTSCipher(data_key, tweak_key, SECTOR_SIZE)
+        .Encrypt(0, plaintext.data(), ciphertext.data(), ciphertext.size());
+    // A trailing partial sector can't be decrypted, so it isn't part of the file
+    ciphertext.resize(ciphertext.size() + 0x10);
+
+    EncryptedFile file(std::make_shared<MemoryFile>(std::move(ciphertext)),
+                       std::make_unique<Crypto::AESXTSCipher>(data_key, tweak_key, SECTOR_SIZE));
+    REQUIRE(file.GetSize() == plaintext.size());
+
+    // Whole sectors, a range across sectors and a range running past the end
+    const std::vector<std::pair<u64, size_t>> ranges{
+        {SECTOR_SIZE, SECTOR_SIZE * 2}, {0x1F3, 0x321}, {plaintext.size() - 5, 100}};
+    for (const auto& range : ranges) {
+        std::vector<u8> buffer(range.second);
+        const size_t read = file.Read(range.first, buffer.size(), buffer.data()).Unwrap();
+        REQUIRE(read == std::min<size_t>(range.second, plaintext.size() - range.first));
+        REQUIRE(std::equal(buffer.begin(), buffer.begin() + read,
+                           plaintext.begin() + range.first));
+    }
+
+    std::vector<u8> buffer(16);
+    REQUIRE(file.Read(plaintext.size(), buffer.size(), buffer.data()).Unwrap() == 0);
+}
+
+} // namespace FileSys
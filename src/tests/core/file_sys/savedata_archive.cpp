@@ -0,0 +1,90 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "common/file_util.h"
+#include "core/file_sys/savedata_archive.h"
+
+namespace FileSys {
+
+static std::string ReadHostFile(const std::string& path) {
+    std::string contents;
+    FileUtil::ReadFileToString(true, path.c_str(), contents);
+    return contents;
+}
+
+static std::string ReadFile(const FileBackend& file, u64 offset, size_t length) {
+    std::vector<u8> buffer(length);
+    const size_t read_length = file.Read(offset, length, buffer.data()).Unwrap();
+    return std::string(buffer.begin(), buffer.begin() + read_length);
+}
+
+static void WriteFile(const FileBackend& file, u64 offset, const std::string& data) {
+    file.Write(offset, data.size(), true, reinterpret_cast<const u8*>(data.data()));
+}
+
+TEST_CASE("SaveDataFile - Write-back", "[core][file_sys]") {
+    const std::string path = "./savedata_test";
+    FileUtil::WriteStringToFile(true, "0123456789", path.c_str());
+
+    Mode mode{};
+    mode.read_flag.Assign(1);
+    mode.write_flag.Assign(1);
+    {
+        SaveDataFile file(FileUtil::IOFile(path, "r+b"), mode, path);
+        WriteFile(file, 2, "ab");
+        WriteFile(file, 4, "cd");
+        WriteFile(file, 3, "X");
+        WriteFile(file, 9, "efg");
+
+        // The writes are only visible through the file until they are committed
+        REQUIRE(ReadFile(file, 0, 16) == "01aXcd678efg");
+        REQUIRE(ReadFile(file, 5, 2) == "d6");
+        REQUIRE(file.GetSize() == 12);
+        REQUIRE(ReadHostFile(path) == "0123456789");
+
+        file.Flush();
+        REQUIRE(ReadHostFile(path) == "01aXcd678efg");
+        REQUIRE(!FileUtil::Exists(SaveDataFile::GetJournalPath(path)));
+
+        WriteFile(file, 0, "z");
+        REQUIRE(file.Close());
+    }
+    REQUIRE(ReadHostFile(path) == "z1aXcd678efg");
+
+    FileUtil::Delete(path);
+}
+
+TEST_CASE("SaveDataFile - Journal recovery", "[core][file_sys]") {
+    const std::string path = "./savedata_test";
+    const std::string journal_path = SaveDataFile::GetJournalPath(path);
+
+    // A commit that was interrupted after its journal was written is replayed
+    FileUtil::WriteStringToFile(true, "0123456789", path.c_str());
+    {
+        FileUtil::IOFile journal(journal_path, "wb");
+        const u32 header[] = {0x4A565359, 1, 2, 0};
+        const u64 extent[] = {4, 2};
+        const u32 end = 0x4A565359;
+        journal.WriteArray(header, 4);
+        journal.WriteArray(extent, 2);
+        journal.WriteBytes("ab", 2);
+        journal.WriteObject(end);
+    }
+    REQUIRE(SaveDataFile::RecoverJournal(path));
+    REQUIRE(ReadHostFile(path) == "0123ab6789");
+    REQUIRE(!FileUtil::Exists(journal_path));
+
+    // An incomplete journal means the file wasn't touched yet
+    FileUtil::WriteStringToFile(true, "truncated", journal_path.c_str());
+    REQUIRE(SaveDataFile::RecoverJournal(path));
+    REQUIRE(ReadHostFile(path) == "0123ab6789");
+    REQUIRE(!FileUtil::Exists(journal_path));
+
+    FileUtil::Delete(path);
+}
+
+} // namespace FileSys
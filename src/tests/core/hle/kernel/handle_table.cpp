@@ -0,0 +1,46 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <catch.hpp>
+#include "core/hle/kernel/errors.h"
+#include "core/hle/kernel/event.h"
+#include "core/hle/kernel/handle_table.h"
+#include "core/hle/kernel/thread.h"
+
+namespace Kernel {
+
+TEST_CASE("HandleTable[Lookup]", "[kernel]") {
+    HandleTable table;
+    const SharedPtr<Event> event = Event::Create(ResetType::OneShot);
+    const Handle handle = table.Create(event).Unwrap();
+
+    REQUIRE(table.IsValid(handle));
+    REQUIRE(table.GetGeneric(handle) == event);
+    REQUIRE(table.GetUnowned<Event>(handle) == event.get());
+    REQUIRE(table.GetUnowned<WaitObject>(handle) == event.get());
+    REQUIRE(table.GetUnowned<Thread>(handle) == nullptr);
+    REQUIRE(table.GetGenericUnowned(0) == nullptr);
+}
+
+TEST_CASE("HandleTable[Close]", "[kernel]") {
+    HandleTable table;
+    const SharedPtr<Event> event = Event::Create(ResetType::OneShot);
+    const Handle handle = table.Create(event).Unwrap();
+
+    REQUIRE(table.Close(handle) == RESULT_SUCCESS);
+    REQUIRE(!table.IsValid(handle));
+    REQUIRE(table.GetGenericUnowned(handle) == nullptr);
+    REQUIRE(table.Close(handle) == ERR_INVALID_HANDLE);
+
+    // The slot is reused with another generation, the stale handle stays invalid
+    const Handle new_handle = table.Create(event).Unwrap();
+    REQUIRE(new_handle != handle);
+    REQUIRE(table.GetGenericUnowned(handle) == nullptr);
+    REQUIRE(table.GetGenericUnowned(new_handle) == event.get());
+
+    table.Clear();
+    REQUIRE(table.GetGenericUnowned(new_handle) == nullptr);
+}
+
+} // namespace Kernel
@@ -0,0 +1,51 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <vector>
+#include <catch.hpp>
+#include "core/hle/kernel/event.h"
+#include "core/hle/kernel/object_address_table.h"
+#include "core/hle/kernel/thread.h"
+
+namespace Kernel {
+
+TEST_CASE("ObjectAddressTable[Lookup]", "[kernel]") {
+    ObjectAddressTable table;
+    const SharedPtr<Event> event = Event::Create(ResetType::OneShot);
+    table.Insert(0x1000, event);
+
+    REQUIRE(table.Find(0x1000) == event.get());
+    REQUIRE(table.GetGeneric(0x1000) == event);
+    REQUIRE(table.Get<Event>(0x1000) == event);
+    REQUIRE(table.Get<Thread>(0x1000) == nullptr);
+    REQUIRE(table.Find(0x1004) == nullptr);
+
+    table.Close(0x1000);
+    REQUIRE(table.Find(0x1000) == nullptr);
+}
+
+TEST_CASE("ObjectAddressTable[Collisions]", "[kernel]") {
+    ObjectAddressTable table;
+    std::vector<SharedPtr<Event>> events;
+
+    // Enough objects to grow the table, at addresses sharing the low bits of their hashes
+    for (VAddr i = 0; i < 200; ++i) {
+        events.push_back(Event::Create(ResetType::OneShot));
+        table.Insert(0x10000 + (i << 12), events.back());
+    }
+
+    // Removing objects doesn't hide the ones probed after them
+    for (VAddr i = 0; i < 200; i += 3) {
+        table.Close(0x10000 + (i << 12));
+    }
+    for (VAddr i = 0; i < 200; ++i) {
+        Object* const expected = i % 3 == 0 ? nullptr : events[i].get();
+        REQUIRE(table.Find(0x10000 + (i << 12)) == expected);
+    }
+
+    table.Clear();
+    REQUIRE(table.Find(0x10000 + (1 << 12)) == nullptr);
+}
+
+} // namespace Kernel
@@ -0,0 +1,95 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <vector>
+#include <catch.hpp>
+#include "core/core_timing.h"
+#include "core/hle/kernel/timeout_queue.h"
+
+namespace Kernel {
+
+namespace {
+class ScopeInit final {
+public:
+    ScopeInit() {
+        CoreTiming::Init();
+        TimeoutsInit();
+        CoreTiming::Advance();
+    }
+    ~ScopeInit() {
+        TimeoutsShutdown();
+        CoreTiming::Shutdown();
+    }
+};
+
+/// Runs the CPU until the next CoreTiming event, and past it by the given number of cycles
+void RunToNextEvent(int cycles_past = 0) {
+    CoreTiming::AddTicks(CoreTiming::GetDowncount() + cycles_past);
+    CoreTiming::Advance();
+}
+} // Anonymous namespace
+
+TEST_CASE("Timeout[Order]", "[kernel]") {
+    ScopeInit guard;
+
+    std::vector<int> expired;
+    Timeout a([&expired](int) { expired.push_back(0); });
+    Timeout b([&expired](int) { expired.push_back(1); });
+    Timeout c([&expired](int) { expired.push_back(2); });
+
+    a.Arm(1000);
+    b.Arm(500);
+    c.Arm(800);
+    REQUIRE(CoreTiming::GetDowncount() == 500);
+
+    // Cancelling and re-arming don't need the CoreTiming event to be rescheduled
+    c.Cancel();
+    REQUIRE(!c.IsArmed());
+    a.Arm(300);
+    REQUIRE(CoreTiming::GetDowncount() == 300);
+
+    RunToNextEvent();
+    REQUIRE(expired == std::vector<int>{0});
+    REQUIRE(!a.IsArmed());
+
+    RunToNextEvent();
+    REQUIRE(expired.size() == 2);
+    REQUIRE(expired[1] == 1);
+    REQUIRE(!b.IsArmed());
+}
+
+TEST_CASE("Timeout[Lateness]", "[kernel]") {
+    ScopeInit guard;
+
+    std::vector<int> lateness;
+    Timeout a([&lateness](int cycles_late) { lateness.push_back(cycles_late); });
+    Timeout b([&lateness](int cycles_late) { lateness.push_back(cycles_late); });
+
+    a.Arm(100);
+    b.Arm(150);
+    RunToNextEvent(100);
+
+    // Both timeouts expired with the same event
+    REQUIRE(lateness.size() == 2);
+    REQUIRE(lateness[0] == 100);
+    REQUIRE(lateness[1] == 50);
+}
+
+TEST_CASE("Timeout[Destroy]", "[kernel]") {
+    ScopeInit guard;
+
+    bool expired = false;
+    {
+        Timeout a([&expired](int) { expired = true; });
+        a.Arm(100);
+    }
+    Timeout b([](int) {});
+    b.Arm(200);
+
+    RunToNextEvent();
+    REQUIRE(!expired);
+    REQUIRE(b.IsArmed());
+}
+
+} // namespace Kernel
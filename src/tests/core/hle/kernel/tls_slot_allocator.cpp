@@ -0,0 +1,56 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <boost/optional/optional_io.hpp>
+#include <catch.hpp>
+#include "core/hle/kernel/tls_slot_allocator.h"
+
+namespace Kernel {
+
+TEST_CASE("TLSSlotAllocator[Pages]", "[kernel]") {
+    TLSSlotAllocator allocator;
+    REQUIRE(!allocator.Allocate());
+
+    REQUIRE(allocator.AddPage() == 0);
+    for (u32 slot = 0; slot < TLSSlotAllocator::SLOTS_PER_PAGE; ++slot) {
+        REQUIRE(allocator.Allocate() == slot);
+    }
+    REQUIRE(!allocator.Allocate());
+
+    REQUIRE(allocator.AddPage() == 1);
+    REQUIRE(allocator.Allocate() == TLSSlotAllocator::SLOTS_PER_PAGE);
+    REQUIRE(allocator.NumPages() == 2);
+}
+
+TEST_CASE("TLSSlotAllocator[Reuse]", "[kernel]") {
+    TLSSlotAllocator allocator;
+    constexpr u32 num_pages = 20;
+    constexpr u32 num_slots = num_pages * TLSSlotAllocator::SLOTS_PER_PAGE;
+    for (u32 page = 0; page < num_pages; ++page) {
+        allocator.AddPage();
+    }
+    for (u32 slot = 0; slot < num_slots; ++slot) {
+        REQUIRE(allocator.Allocate());
+    }
+    REQUIRE(!allocator.Allocate());
+
+    // Freed slots are handed out again without needing a new page
+    allocator.Free(3);
+    allocator.Free(77);
+    allocator.Free(150);
+    for (int cycle = 0; cycle < 1000; ++cycle) {
+        const boost::optional<u32> slot = allocator.Allocate();
+        REQUIRE(slot);
+        REQUIRE((*slot == 3 || *slot == 77 || *slot == 150));
+        allocator.Free(*slot);
+    }
+
+    REQUIRE(allocator.Allocate());
+    REQUIRE(allocator.Allocate());
+    REQUIRE(allocator.Allocate());
+    REQUIRE(!allocator.Allocate());
+    REQUIRE(allocator.NumPages() == num_pages);
+}
+
+} // namespace Kernel
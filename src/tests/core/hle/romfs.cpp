@@ -0,0 +1,92 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <vector>
+#include <catch.hpp>
+#include "core/hle/romfs.h"
+
+namespace RomFS {
+
+constexpr u32 INVALID = 0xFFFFFFFF;
+
+static void Put32(std::vector<u8>& image, size_t offset, u32 value) {
+    std::memcpy(&image[offset], &value, sizeof(value));
+}
+
+static void Put64(std::vector<u8>& image, size_t offset, u64 value) {
+    std::memcpy(&image[offset], &value, sizeof(value));
+}
+
+static void PutName(std::vector<u8>& image, size_t offset, const std::u16string& name) {
+    std::memcpy(&image[offset], name.data(), name.size() * sizeof(char16_t));
+}
+
+/**
+ * Builds an image containing /a/b and /c. Both hash tables have a single bucket, so that every
+ * lookup has to follow the chain of entries and check their parents and names.
+ */
+static std::vector<u8> BuildImage() {
+    std::vector<u8> image(0x100);
+
+    constexpr u32 dir_hash_table = 0x28;
+    constexpr u32 dir_table = 0x30;
+    constexpr u32 file_hash_table = 0x68;
+    constexpr u32 file_table = 0x70;
+    constexpr u32 data = 0xC0;
+
+    const u32 header[] = {0x28,         dir_hash_table, 4,          dir_table, 0x34,
+                          file_hash_table, 4,           file_table, 0x48,      data};
+    std::memcpy(&image[0], header, sizeof(header));
+
+    // Directories: the root at 0 and /a at 0x18
+    Put32(image, dir_hash_table, 0x18);
+    const u32 root[] = {0, INVALID, 0x18, 0x24, INVALID, 0};
+    std::memcpy(&image[dir_table], root, sizeof(root));
+    const u32 dir_a[] = {0, INVALID, INVALID, 0, INVALID, 2};
+    std::memcpy(&image[dir_table + 0x18], dir_a, sizeof(dir_a));
+    PutName(image, dir_table + 0x18 + 0x18, u"a");
+
+    // Files: /a/b at 0 and /c at 0x24, chained in the same bucket
+    Put32(image, file_hash_table, 0);
+    Put32(image, file_table + 0x00, 0x18);
+    Put32(image, file_table + 0x04, INVALID);
+    Put64(image, file_table + 0x08, 0);
+    Put64(image, file_table + 0x10, 5);
+    Put32(image, file_table + 0x18, 0x24);
+    Put32(image, file_table + 0x1C, 2);
+    PutName(image, file_table + 0x20, u"b");
+
+    Put32(image, file_table + 0x24, 0);
+    Put32(image, file_table + 0x28, INVALID);
+    Put64(image, file_table + 0x2C, 8);
+    Put64(image, file_table + 0x34, 5);
+    Put32(image, file_table + 0x3C, INVALID);
+    Put32(image, file_table + 0x40, 2);
+    PutName(image, file_table + 0x44, u"c");
+
+    std::memcpy(&image[data], "hello", 5);
+    std::memcpy(&image[data + 8], "world", 5);
+    return image;
+}
+
+TEST_CASE("RomFS::GetFilePointer", "[core][hle]") {
+    const std::vector<u8> image = BuildImage();
+
+    const u8* b = GetFilePointer(image.data(), {u"a", u"b"});
+    REQUIRE(b != nullptr);
+    REQUIRE(std::memcmp(b, "hello", 5) == 0);
+
+    const u8* c = GetFilePointer(image.data(), {u"c"});
+    REQUIRE(c != nullptr);
+    REQUIRE(std::memcmp(c, "world", 5) == 0);
+
+    // The names match, but the parent directories don't
+    REQUIRE(GetFilePointer(image.data(), {u"b"}) == nullptr);
+    REQUIRE(GetFilePointer(image.data(), {u"a", u"c"}) == nullptr);
+    REQUIRE(GetFilePointer(image.data(), {u"d"}) == nullptr);
+    REQUIRE(GetFilePointer(image.data(), {u"c", u"b"}) == nullptr);
+}
+
+} // namespace RomFS
@@ -0,0 +1,47 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <catch.hpp>
+#include "core/hle/service/command_stats.h"
+
+namespace Service {
+
+TEST_CASE("CommandStats[Record]", "[service]") {
+    CommandStats stats;
+    stats.Record(100, 64);
+    stats.Record(1500, 0);
+    stats.Record(300000, 16);
+
+    REQUIRE(stats.calls == 3);
+    REQUIRE(stats.total_ns == 301600);
+    REQUIRE(stats.max_ns == 300000);
+    REQUIRE(stats.buffer_bytes == 80);
+    // The median call took 1500 ns, which is in the bucket of the calls taking < 2048 ns
+    REQUIRE(stats.GetMedianBoundNs() == 2048);
+}
+
+TEST_CASE("CommandStats[Table]", "[service]") {
+    ClearCommandStats();
+    CommandStats& stats = GetCommandStats("vi:m", 2, "GetDisplayService", true);
+    // Instances of the same service share the statistics
+    REQUIRE(&GetCommandStats("vi:m", 2, "GetDisplayService", true) == &stats);
+    stats.Record(1000, 0);
+    GetCommandStats("hid", 7, nullptr, false).Record(0, 0);
+    GetCommandStats("am", 1, "NeverCalled", true);
+
+    // Commands that were never called are left out
+    const auto entries = GetCommandStatsSnapshot();
+    REQUIRE(entries.size() == 2);
+    REQUIRE(entries[0].service_name == "hid");
+    REQUIRE(entries[0].command_name.empty());
+    REQUIRE(!entries[0].is_implemented);
+    REQUIRE(entries[1].service_name == "vi:m");
+    REQUIRE(entries[1].command_name == "GetDisplayService");
+    REQUIRE(entries[1].stats.calls == 1);
+
+    ClearCommandStats();
+    REQUIRE(GetCommandStatsSnapshot().empty());
+}
+
+} // namespace Service
@@ -0,0 +1,86 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <vector>
+#include <catch.hpp>
+#include "core/hle/service/nvdrv/devices/nvmap.h"
+
+namespace Service {
+namespace NVDRV {
+namespace Devices {
+
+/// Issues an ioctl whose parameters are the given words, and returns the words written back
+static std::vector<u32> Ioctl(nvmap& dev, u32 command, std::vector<u32> params) {
+    // The parameters are read and written in place, like in guest memory
+    const IoctlBuffer buffer{reinterpret_cast<u8*>(params.data()), params.size() * sizeof(u32)};
+    REQUIRE(dev.ioctl(command, buffer, buffer) == 0);
+    return params;
+}
+
+static u32 Create(nvmap& dev, u32 size) {
+    return Ioctl(dev, 0xC0080101, {size, 0})[1];
+}
+
+static void Alloc(nvmap& dev, u32 handle, VAddr addr) {
+    Ioctl(dev, 0xC0200104,
+          {handle, 0, 0, 0x1000, 0, 0, static_cast<u32>(addr), static_cast<u32>(addr >> 32)});
+}
+
+static u32 GetId(nvmap& dev, u32 handle) {
+    return Ioctl(dev, 0xC008010E, {0, handle})[0];
+}
+
+static u32 FromId(nvmap& dev, u32 id) {
+    return Ioctl(dev, 0xC0080103, {id, 0})[1];
+}
+
+static void Free(nvmap& dev, u32 handle) {
+    Ioctl(dev, 0xC0180105, {handle, 0, 0, 0, 0, 0});
+}
+
+TEST_CASE("nvmap[Handles]", "[service]") {
+    nvmap dev;
+
+    const u32 first = Create(dev, 0x1000);
+    const u32 second = Create(dev, 0x2000);
+    REQUIRE(first != 0);
+    REQUIRE(first != second);
+    Alloc(dev, first, 0x80000000);
+    Alloc(dev, second, 0x90000000);
+    REQUIRE(dev.GetObjectAddress(first) == 0x80000000);
+    REQUIRE(dev.GetObjectSize(second) == 0x2000);
+
+    // Handles made from an id refer to the same object
+    const u32 duplicate = FromId(dev, GetId(dev, second));
+    REQUIRE(duplicate != second);
+    REQUIRE(dev.GetObjectAddress(duplicate) == 0x90000000);
+
+    // The object lives on as long as one of its handles does
+    Free(dev, second);
+    REQUIRE(dev.GetObjectAddress(duplicate) == 0x90000000);
+
+    // Freed handles are reused
+    REQUIRE(Create(dev, 0x3000) == second);
+}
+
+TEST_CASE("nvmap[Pinning]", "[service]") {
+    nvmap dev;
+
+    const u32 handle = Create(dev, 0x1000);
+    Alloc(dev, handle, 0x80000000);
+    const u32 id = dev.PinObject(handle);
+    REQUIRE(id == GetId(dev, handle));
+
+    // A pinned object outlives its handles, and its id stays valid
+    Free(dev, handle);
+    const u32 other = Create(dev, 0x2000);
+    REQUIRE(GetId(dev, other) != id);
+    REQUIRE(dev.GetObjectAddress(FromId(dev, id)) == 0x80000000);
+
+    dev.UnpinObject(id);
+}
+
+} // namespace Devices
+} // namespace NVDRV
+} // namespace Service
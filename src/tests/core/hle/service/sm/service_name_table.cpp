@@ -0,0 +1,49 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <string>
+#include <catch.hpp>
+#include "core/hle/service/sm/service_name_table.h"
+
+namespace Service {
+namespace SM {
+
+static ServiceName Pack(const std::string& name) {
+    return PackServiceName(name.data(), name.size());
+}
+
+TEST_CASE("ServiceNameTable[Packing]", "[service]") {
+    REQUIRE(Pack("sm:") == 0x3A6D73);
+    REQUIRE(UnpackServiceName(Pack("sm:")) == "sm:");
+    REQUIRE(UnpackServiceName(Pack("appletOE")) == "appletOE");
+}
+
+TEST_CASE("ServiceNameTable[Lookup]", "[service]") {
+    ServiceNameTable<int> table;
+    REQUIRE(table.Find(Pack("hid")) == nullptr);
+
+    REQUIRE(table.Insert(Pack("hid"), 1));
+    REQUIRE(table.Insert(Pack("vi:m"), 2));
+    REQUIRE(!table.Insert(Pack("hid"), 3));
+
+    REQUIRE(*table.Find(Pack("hid")) == 1);
+    REQUIRE(*table.Find(Pack("vi:m")) == 2);
+    REQUIRE(table.Find(Pack("vi:u")) == nullptr);
+    REQUIRE(table.Size() == 2);
+}
+
+TEST_CASE("ServiceNameTable[Growth]", "[service]") {
+    ServiceNameTable<int> table;
+    constexpr int num_names = 1000;
+    for (int index = 0; index < num_names; ++index) {
+        REQUIRE(table.Insert(Pack("svc" + std::to_string(index)), index));
+    }
+    for (int index = 0; index < num_names; ++index) {
+        REQUIRE(*table.Find(Pack("svc" + std::to_string(index))) == index);
+    }
+    REQUIRE(table.Find(Pack("svc1000")) == nullptr);
+}
+
+} // namespace SM
+} // namespace Service
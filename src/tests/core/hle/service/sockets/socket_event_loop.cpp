@@ -0,0 +1,145 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <future>
+#include <catch.hpp>
+#include "core/hle/service/sockets/socket_event_loop.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace Service {
+namespace Sockets {
+
+namespace {
+
+using WatchResult = SocketEventLoop::WatchResult;
+
+/// Loopback UDP socket, the event loop must exist for it to be created on Windows
+class TestSocket final {
+public:
+    TestSocket() {
+        handle = socket(AF_INET, SOCK_DGRAM, 0);
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t address_size = sizeof(address);
+        bind(handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+        getsockname(handle, reinterpret_cast<sockaddr*>(&address), &address_size);
+    }
+
+    ~TestSocket() {
+#ifdef _WIN32
+        closesocket(handle);
+#else
+        close(handle);
+#endif
+    }
+
+    void SendTo(const TestSocket& other) const {
+        const char data = 0;
+        sendto(handle, &data, sizeof(data), 0,
+               reinterpret_cast<const sockaddr*>(&other.address), sizeof(other.address));
+    }
+
+    SocketHandle handle;
+    sockaddr_in address{};
+};
+
+/// Returns a callback that reports its first result through the promise
+SocketEventLoop::Callback ReportResult(std::promise<WatchResult>& promise) {
+    return [&promise](WatchResult result) {
+        promise.set_value(result);
+        return true;
+    };
+}
+
+bool IsReady(std::future<WatchResult>& future) {
+    return future.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+}
+
+} // Anonymous namespace
+
+TEST_CASE("SocketEventLoop[Ready]", "[service]") {
+    SocketEventLoop event_loop;
+    TestSocket receiver;
+    TestSocket sender;
+
+    std::promise<WatchResult> promise;
+    auto future = promise.get_future();
+    event_loop.Watch(receiver.handle, SocketEventLoop::EVENT_READ, ReportResult(promise));
+    // Nothing was received yet
+    REQUIRE(future.wait_for(std::chrono::milliseconds(20)) == std::future_status::timeout);
+
+    sender.SendTo(receiver);
+    REQUIRE(IsReady(future));
+    REQUIRE(future.get() == WatchResult::Ready);
+}
+
+TEST_CASE("SocketEventLoop[Timeout]", "[service]") {
+    SocketEventLoop event_loop;
+    TestSocket receiver;
+
+    std::promise<WatchResult> promise;
+    auto future = promise.get_future();
+    event_loop.Watch(receiver.handle, SocketEventLoop::EVENT_READ, ReportResult(promise),
+                     SocketEventLoop::Clock::now() + std::chrono::milliseconds(10));
+    REQUIRE(IsReady(future));
+    REQUIRE(future.get() == WatchResult::TimedOut);
+}
+
+TEST_CASE("SocketEventLoop[Cancel]", "[service]") {
+    SocketEventLoop event_loop;
+    TestSocket receiver;
+
+    std::promise<WatchResult> first_promise;
+    std::promise<WatchResult> second_promise;
+    auto first_future = first_promise.get_future();
+    auto second_future = second_promise.get_future();
+    const auto id =
+        event_loop.Watch(receiver.handle, SocketEventLoop::EVENT_READ, ReportResult(first_promise));
+    event_loop.Watch(receiver.handle, SocketEventLoop::EVENT_READ, ReportResult(second_promise));
+
+    // Callbacks of cancelled watches run before the cancellation returns
+    event_loop.CancelWatch(id);
+    REQUIRE(first_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    REQUIRE(first_future.get() == WatchResult::Cancelled);
+    REQUIRE(second_future.wait_for(std::chrono::seconds(0)) == std::future_status::timeout);
+
+    event_loop.CancelWatches(receiver.handle);
+    REQUIRE(second_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    REQUIRE(second_future.get() == WatchResult::Cancelled);
+}
+
+TEST_CASE("SocketEventLoop[Retry]", "[service]") {
+    SocketEventLoop event_loop;
+    TestSocket receiver;
+    TestSocket sender;
+
+    // The watch is kept while its callback reports that the call would still block
+    int num_calls = 0;
+    std::promise<WatchResult> promise;
+    auto future = promise.get_future();
+    event_loop.Watch(receiver.handle, SocketEventLoop::EVENT_READ,
+                     [&num_calls, &promise](WatchResult result) {
+                         if (++num_calls < 3) {
+                             return false;
+                         }
+                         promise.set_value(result);
+                         return true;
+                     });
+    sender.SendTo(receiver);
+    REQUIRE(IsReady(future));
+    REQUIRE(future.get() == WatchResult::Ready);
+    REQUIRE(num_calls == 3);
+}
+
+} // namespace Sockets
+} // namespace Service
@@ -0,0 +1,38 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <catch.hpp>
+#include "core/loader/symbols.h"
+
+namespace Loader {
+
+TEST_CASE("Symbols - Lookup", "[core][loader]") {
+    Symbols::Clear();
+    Symbols::AddModule("main", 0x8000000, 0x10000);
+    Symbols::AddModule("sdk", 0x8010000, 0x10000);
+    Symbols::AddFunction("nnMain", 0x8000100, 0x80);
+    Symbols::AddFunction("_start", 0x8000000, 0);
+    Symbols::AddFunction("nn::os::SleepThread", 0x8010400, 0);
+
+    // Sized functions end where they say, unsized ones at the next function
+    REQUIRE(Symbols::Describe(0x8000100) == "main!nnMain");
+    REQUIRE(Symbols::Describe(0x8000140) == "main!nnMain+0x40");
+    REQUIRE(Symbols::Describe(0x8000180) == "main+0x180");
+    REQUIRE(Symbols::Describe(0x80000fc) == "main!_start+0xfc");
+
+    // Functions don't extend into the next module
+    REQUIRE(Symbols::Describe(0x8010004) == "sdk+0x4");
+    REQUIRE(Symbols::Describe(0x8010500) == "sdk!nn::os::SleepThread+0x100");
+    REQUIRE(Symbols::Describe(0x8020000) == "0x0000000008020000");
+
+    const Symbols::Location location = Symbols::Lookup(0x8000104);
+    REQUIRE(location.module == "main");
+    REQUIRE(location.function == "nnMain");
+    REQUIRE(location.base == 0x8000100);
+
+    Symbols::Clear();
+    REQUIRE(Symbols::Lookup(0x8000100).module.empty());
+}
+
+} // namespace Loader
@@ -2,10 +2,16 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
 #include <catch.hpp>
 #include "core/hle/kernel/memory.h"
 #include "core/hle/kernel/process.h"
 #include "core/memory.h"
+#include "core/memory_setup.h"
+#include "core/mmio.h"
 
 TEST_CASE("Memory::IsValidVirtualAddress", "[core][memory][!hide]") {
     SECTION("these regions should not be mapped on an empty process") {
@@ -54,3 +60,208 @@ TEST_CASE("Memory::IsValidVirtualAddress", "[core][memory][!hide]") {
         CHECK(Memory::IsValidVirtualAddress(*process, Memory::CONFIG_MEMORY_VADDR) == false);
     }
 }
+
+TEST_CASE("Memory::PageTable", "[core][memory]") {
+    SECTION("an empty page table should not hold onto any entry storage") {
+        Memory::PageTable page_table;
+        CHECK(page_table.pointers.GetHostMemoryUsage() == 0);
+        CHECK(page_table.attributes[Memory::HEAP_VADDR >> Memory::PAGE_BITS] ==
+              Memory::PageType::Unmapped);
+        CHECK(page_table.pointers[Memory::HEAP_VADDR >> Memory::PAGE_BITS] == nullptr);
+    }
+
+    SECTION("unmapping a region should release the storage used by its attributes") {
+        Memory::PageTable page_table;
+        const size_t empty_usage = page_table.attributes.GetHostMemoryUsage();
+
+        const size_t page_index = Memory::HEAP_VADDR >> Memory::PAGE_BITS;
+        page_table.attributes.Set(page_index, Memory::PageType::Memory);
+        CHECK(page_table.attributes[page_index] == Memory::PageType::Memory);
+        CHECK(page_table.attributes.GetHostMemoryUsage() > empty_usage);
+
+        page_table.attributes.Set(page_index, Memory::PageType::Unmapped);
+        CHECK(page_table.attributes.GetHostMemoryUsage() == empty_usage);
+    }
+
+    SECTION("clearing the page table should reset all pointers") {
+        Memory::PageTable page_table;
+        u8 backing{};
+        const size_t page_index = Memory::HEAP_VADDR >> Memory::PAGE_BITS;
+        page_table.pointers.Set(page_index, &backing);
+        CHECK(page_table.pointers[page_index] == &backing);
+        CHECK(page_table.pointers.GetHostMemoryUsage() != 0);
+
+        page_table.Clear();
+        CHECK(page_table.pointers[page_index] == nullptr);
+        CHECK(page_table.pointers.GetHostMemoryUsage() == 0);
+    }
+
+    SECTION("filling a range of pages should match setting them one at a time") {
+        Memory::PageTable page_table;
+        const size_t empty_usage = page_table.attributes.GetHostMemoryUsage();
+        const size_t page_index = (Memory::HEAP_VADDR >> Memory::PAGE_BITS) + 0xFF0;
+        const size_t count = 0x1020;
+        std::vector<u8> backing(count * Memory::PAGE_SIZE);
+
+        page_table.attributes.Fill(page_index, count, Memory::PageType::Memory);
+        page_table.pointers.SetRange(page_index, count, backing.data());
+        CHECK(page_table.attributes.GetNumUsed() == count);
+        CHECK(page_table.attributes[page_index - 1] == Memory::PageType::Unmapped);
+        CHECK(page_table.attributes[page_index + count - 1] == Memory::PageType::Memory);
+        CHECK(page_table.pointers[page_index] == backing.data());
+        CHECK(page_table.pointers[page_index + count - 1] ==
+              backing.data() + (count - 1) * Memory::PAGE_SIZE);
+        CHECK(page_table.pointers[page_index + count] == nullptr);
+
+        page_table.attributes.Set(page_index + 1, Memory::PageType::Unmapped);
+        CHECK(page_table.attributes.GetNumUsed() == count - 1);
+
+        page_table.attributes.Fill(page_index, count, Memory::PageType::Unmapped);
+        page_table.pointers.SetRange(page_index, count, nullptr);
+        CHECK(page_table.attributes.GetNumUsed() == 0);
+        CHECK(page_table.attributes.GetHostMemoryUsage() == empty_usage);
+        CHECK(page_table.pointers[page_index + 0x10] == nullptr);
+    }
+}
+
+TEST_CASE("Memory::ReadCString", "[core][memory]") {
+    Kernel::g_current_process = Kernel::Process::Create("");
+    Memory::PageTable& page_table = Kernel::g_current_process->vm_manager.page_table;
+    Memory::SetCurrentPageTable(&page_table);
+
+    // Two pages backed by separate host buffers, so that strings can cross from one to the other
+    std::vector<u8> first_page(Memory::PAGE_SIZE, 'a');
+    std::vector<u8> second_page(Memory::PAGE_SIZE, 'b');
+    const VAddr base = Memory::HEAP_VADDR;
+    Memory::MapMemoryRegion(page_table, base, Memory::PAGE_SIZE, first_page.data());
+    Memory::MapMemoryRegion(page_table, base + Memory::PAGE_SIZE, Memory::PAGE_SIZE,
+                            second_page.data());
+
+    SECTION("a string within a page stops at its terminator") {
+        std::memcpy(first_page.data() + 16, "service", 8);
+        CHECK(Memory::ReadCString(base + 16, 32) == "service");
+        CHECK(Memory::ReadCString(base + 16, 3) == "ser");
+    }
+
+    SECTION("a string crossing pages is read from both") {
+        second_page[2] = '\0';
+        const std::string string = Memory::ReadCString(base + Memory::PAGE_SIZE - 4, 64);
+        CHECK(string == "aaaabb");
+    }
+
+    SECTION("an unterminated string is cut at the maximum length") {
+        CHECK(Memory::ReadCString(base, 2 * Memory::PAGE_SIZE).size() == 2 * Memory::PAGE_SIZE);
+    }
+
+    Memory::UnmapRegion(page_table, base, 2 * Memory::PAGE_SIZE);
+}
+
+namespace {
+/// IO region whose reads return a fixed tag, to tell which handler served an access
+struct TaggedRegion final : Memory::MMIORegion {
+    explicit TaggedRegion(u8 tag) : tag(tag) {}
+    u8 tag;
+
+    bool IsValidAddress(VAddr addr) override {
+        return true;
+    }
+    u8 Read8(VAddr addr) override {
+        return tag;
+    }
+    u16 Read16(VAddr addr) override {
+        return tag;
+    }
+    u32 Read32(VAddr addr) override {
+        return tag;
+    }
+    u64 Read64(VAddr addr) override {
+        return tag;
+    }
+    bool ReadBlock(VAddr src_addr, void* dest_buffer, size_t size) override {
+        std::memset(dest_buffer, tag, size);
+        return true;
+    }
+    void Write8(VAddr addr, u8 data) override {}
+    void Write16(VAddr addr, u16 data) override {}
+    void Write32(VAddr addr, u32 data) override {}
+    void Write64(VAddr addr, u64 data) override {}
+    bool WriteBlock(VAddr dest_addr, const void* src_buffer, size_t size) override {
+        return true;
+    }
+};
+} // Anonymous namespace
+
+TEST_CASE("Memory::MapIoRegion", "[core][memory]") {
+    Kernel::g_current_process = Kernel::Process::Create("");
+    Memory::PageTable& page_table = Kernel::g_current_process->vm_manager.page_table;
+    Memory::SetCurrentPageTable(&page_table);
+
+    const VAddr base = Memory::IO_AREA_VADDR;
+    Memory::MapIoRegion(page_table, base, 4 * Memory::PAGE_SIZE, std::make_shared<TaggedRegion>(1));
+    // The later mapping takes over the pages it overlaps
+    Memory::MapIoRegion(page_table, base + Memory::PAGE_SIZE, Memory::PAGE_SIZE,
+                        std::make_shared<TaggedRegion>(2));
+
+    CHECK(Memory::Read8(base) == 1);
+    CHECK(Memory::Read32(base + Memory::PAGE_SIZE + 4) == 2);
+    CHECK(Memory::Read16(base + 3 * Memory::PAGE_SIZE - 2) == 1);
+
+    std::vector<u8> block(Memory::PAGE_SIZE);
+    Memory::ReadBlock(base + Memory::PAGE_SIZE / 2, block.data(), block.size());
+    CHECK(block.front() == 1);
+    CHECK(block.back() == 2);
+
+    Memory::UnmapRegion(page_table, base, 4 * Memory::PAGE_SIZE);
+    CHECK(page_table.special_region_index.GetNumUsed() == 0);
+    CHECK_FALSE(Memory::IsValidVirtualAddress(base));
+}
+
+TEST_CASE("Memory::RasterizerDeferReadback", "[core][memory]") {
+    Kernel::g_current_process = Kernel::Process::Create("");
+    auto& vm_manager = Kernel::g_current_process->vm_manager;
+    Memory::SetCurrentPageTable(&vm_manager.page_table);
+
+    const VAddr base = Memory::HEAP_VADDR;
+    const u64 size = 4 * Memory::PAGE_SIZE;
+    auto block = std::make_shared<std::vector<u8>>(size);
+    REQUIRE(vm_manager.MapMemoryBlock(base, block, 0, size, Kernel::MemoryState::Normal)
+                .Succeeded());
+
+    // Writes the region back as the rasterizer would, through its host memory
+    int num_readbacks = 0;
+    Memory::RasterizerDeferReadback(base + 0x100, 0x1800, [&](VAddr addr, u64 region_size) {
+        CHECK(addr == base + 0x100);
+        CHECK(region_size == 0x1800);
+        std::memset(block->data() + (addr - base), 0xAB, region_size);
+        ++num_readbacks;
+    });
+    CHECK(vm_manager.page_table.attributes[base >> Memory::PAGE_BITS] ==
+          Memory::PageType::RasterizerCachedMemory);
+
+    SECTION("accesses outside the region don't write it back") {
+        CHECK(Memory::Read8(base + 3 * Memory::PAGE_SIZE) == 0);
+        CHECK(Memory::Read8(base) == 0);
+        CHECK(num_readbacks == 0);
+        CHECK(Memory::IsReadbackPending(base + 0x100, 1));
+    }
+
+    SECTION("the first read writes the whole region back") {
+        CHECK(Memory::Read8(base + Memory::PAGE_SIZE) == 0xAB);
+        CHECK(Memory::Read8(base + 0x100) == 0xAB);
+        CHECK(num_readbacks == 1);
+        CHECK(!Memory::IsReadbackPending(base, size));
+        CHECK(vm_manager.page_table.attributes[base >> Memory::PAGE_BITS] ==
+              Memory::PageType::Memory);
+    }
+
+    SECTION("writes land on top of the written back region") {
+        Memory::Write8(base + 0x200, 1);
+        CHECK(num_readbacks == 1);
+        CHECK(Memory::Read8(base + 0x200) == 1);
+        CHECK(Memory::Read8(base + 0x201) == 0xAB);
+    }
+
+    // Remapping the region writes it back as well
+    vm_manager.UnmapRange(base, size);
+    CHECK(!Memory::IsReadbackPending(base, size));
+}
@@ -0,0 +1,103 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <memory>
+#include <random>
+#include <vector>
+#include <catch.hpp>
+#include "core/hle/kernel/process.h"
+#include "core/memory.h"
+#include "core/memory_compactor.h"
+#include "core/memory_setup.h"
+
+namespace Memory {
+
+TEST_CASE("MemoryCompactor", "[core][memory]") {
+    Kernel::g_current_process = Kernel::Process::Create("");
+    Kernel::Process& process = *Kernel::g_current_process;
+    auto& vm_manager = process.vm_manager;
+    SetCurrentPageTable(&vm_manager.page_table);
+
+    // A heap of four chunks, the third one doesn't compress
+    constexpr u32 CHUNK_SIZE = MemoryCompactor::CHUNK_SIZE;
+    const VAddr base = HEAP_VADDR;
+    const u64 size = 4 * CHUNK_SIZE;
+    process.heap_memory = std::make_shared<std::vector<u8>>(size);
+    std::vector<u8>& heap = *process.heap_memory;
+    std::mt19937 random_engine;
+    for (u32 offset = 0; offset < CHUNK_SIZE; ++offset) {
+        heap[CHUNK_SIZE + offset] = static_cast<u8>(offset % 7);
+        heap[2 * CHUNK_SIZE + offset] = static_cast<u8>(random_engine());
+    }
+    const std::vector<u8> original = heap;
+    REQUIRE(vm_manager.MapMemoryBlock(base, process.heap_memory, 0, size, Kernel::MemoryState::Heap)
+                .Succeeded());
+
+    auto compactor = std::make_shared<MemoryCompactor>(process);
+    REQUIRE(compactor->Compact() == 3 * CHUNK_SIZE);
+    REQUIRE(compactor->GetCompactedSize() == 3 * CHUNK_SIZE);
+    REQUIRE(compactor->GetCompressedSize() < CHUNK_SIZE);
+    const auto page_type = [&vm_manager](VAddr addr) {
+        return vm_manager.page_table.attributes[addr >> PAGE_BITS];
+    };
+    REQUIRE(page_type(base) == PageType::Special);
+    REQUIRE(page_type(base + 2 * CHUNK_SIZE) == PageType::Memory);
+
+    SECTION("accesses decompress the chunk they touch") {
+        REQUIRE(Read8(base + CHUNK_SIZE + 5) == 5);
+        REQUIRE(page_type(base + CHUNK_SIZE) == PageType::Memory);
+        REQUIRE(page_type(base + 3 * CHUNK_SIZE) == PageType::Special);
+        REQUIRE(compactor->GetCompactedSize() == 2 * CHUNK_SIZE);
+
+        Write32(base + 3 * CHUNK_SIZE + 8, 0x12345678);
+        REQUIRE(Read32(base + 3 * CHUNK_SIZE + 8) == 0x12345678);
+        REQUIRE(compactor->GetCompactedSize() == CHUNK_SIZE);
+
+        // Only the chunks touched since are compressed again
+        REQUIRE(compactor->Compact() == 2 * CHUNK_SIZE);
+        REQUIRE(Read32(base + 3 * CHUNK_SIZE + 8) == 0x12345678);
+    }
+
+    SECTION("host pointers decompress the chunks that follow too") {
+        const u8* pointer = GetPointer(base + 0x10);
+        REQUIRE(pointer == heap.data() + 0x10);
+        REQUIRE(page_type(base + CHUNK_SIZE) == PageType::Memory);
+        REQUIRE(std::equal(heap.begin(), heap.begin() + 2 * CHUNK_SIZE, original.begin()));
+        // Separated from them by a resident chunk
+        REQUIRE(page_type(base + 3 * CHUNK_SIZE) == PageType::Special);
+    }
+
+    SECTION("remapping part of a chunk decompresses it") {
+        REQUIRE(
+            vm_manager.ReprotectRange(base, PAGE_SIZE, Kernel::VMAPermission::Read).IsSuccess());
+        REQUIRE(page_type(base) == PageType::Memory);
+        REQUIRE(page_type(base + PAGE_SIZE) == PageType::Special);
+        REQUIRE(Read8(base + PAGE_SIZE) == 0);
+
+        // Each side of the split chunk is compacted on its own
+        REQUIRE(compactor->Compact() == CHUNK_SIZE);
+        REQUIRE(page_type(base + 2 * PAGE_SIZE) == PageType::Special);
+    }
+
+    SECTION("chunks mapped twice are left alone") {
+        compactor->RestoreAll();
+        REQUIRE(page_type(base) == PageType::Memory);
+        REQUIRE(heap == original);
+
+        const VAddr mirror = base + size;
+        REQUIRE(vm_manager
+                    .MapMemoryBlock(mirror, process.heap_memory, 0, CHUNK_SIZE,
+                                    Kernel::MemoryState::Mapped)
+                    .Succeeded());
+        REQUIRE(compactor->Compact() == 2 * CHUNK_SIZE);
+        REQUIRE(page_type(base) == PageType::Memory);
+        vm_manager.UnmapRange(mirror, CHUNK_SIZE);
+    }
+
+    // Unmapping the heap writes the compacted chunks back first
+    vm_manager.UnmapRange(base, size);
+    REQUIRE(compactor->GetCompactedSize() == 0);
+}
+
+} // namespace Memory
@@ -0,0 +1,63 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <string>
+#include <catch.hpp>
+#include "common/file_util.h"
+#include "core/movie.h"
+
+namespace Core {
+
+static Movie::InputState MakeState(u64 buttons) {
+    Movie::InputState state{};
+    state.buttons = buttons;
+    return state;
+}
+
+TEST_CASE("Movie - Record and play back", "[core]") {
+    const std::string path = "./movie_test";
+    Movie& movie = Movie::GetInstance();
+
+    movie.StartRecording(path);
+    for (u64 ticks = 100; ticks <= 1000; ticks += 100) {
+        Movie::InputState state = MakeState(ticks >= 500 ? 1 : 0);
+        movie.HandleInputState(ticks, state);
+    }
+    movie.Shutdown();
+
+    bool is_finished = false;
+    REQUIRE(movie.StartPlayback(path));
+    movie.SetPlaybackCompletionCallback([&is_finished] { is_finished = true; });
+
+    // The replayed states don't depend on the devices, nor on when the samples are taken
+    Movie::InputState state = MakeState(0xFF);
+    movie.HandleInputState(50, state);
+    REQUIRE(state == MakeState(0));
+    state = MakeState(0xFF);
+    movie.HandleInputState(499, state);
+    REQUIRE(state == MakeState(0));
+    state = MakeState(0);
+    movie.HandleInputState(750, state);
+    REQUIRE(state == MakeState(1));
+    REQUIRE(!is_finished);
+
+    state = MakeState(0);
+    movie.HandleInputState(1000, state);
+    REQUIRE(state == MakeState(1));
+    REQUIRE(is_finished);
+    REQUIRE(!movie.IsActive());
+
+    movie.SetPlaybackCompletionCallback(nullptr);
+    FileUtil::Delete(path);
+}
+
+TEST_CASE("Movie - Invalid file", "[core]") {
+    const std::string path = "./movie_invalid_test";
+    FileUtil::WriteStringToFile(true, "not a movie", path.c_str());
+    REQUIRE(!Movie::GetInstance().StartPlayback(path));
+    REQUIRE(!Movie::GetInstance().IsActive());
+    FileUtil::Delete(path);
+}
+
+} // namespace Core
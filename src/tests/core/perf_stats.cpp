@@ -0,0 +1,56 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <catch.hpp>
+
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include "core/perf_stats.h"
+
+TEST_CASE("PerfStats::SessionStats", "[core]") {
+    auto perf_stats = std::make_unique<Core::PerfStats>();
+    perf_stats->ResetSessionStats();
+
+    SECTION("empty session") {
+        const Core::PerfStats::SessionStats stats = perf_stats->GetSessionStats();
+        REQUIRE(stats.system_frames == 0);
+        REQUIRE(stats.frametime_p99 == 0.0);
+        REQUIRE(std::accumulate(stats.speed_distribution.begin(), stats.speed_distribution.end(),
+                                0.0) == 0.0);
+    }
+
+    SECTION("frames are counted across resets of the other statistics") {
+        for (int frame = 0; frame < 90; ++frame) {
+            perf_stats->BeginSystemFrame();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            perf_stats->EndSystemFrame();
+            if (frame == 30) {
+                perf_stats->GetAndResetStats(0);
+            }
+        }
+
+        const Core::PerfStats::SessionStats stats = perf_stats->GetSessionStats();
+        REQUIRE(stats.system_frames == 90);
+        REQUIRE(stats.seconds >= 0.09);
+        REQUIRE(stats.frametime_p50 >= 0.001);
+        REQUIRE(stats.frametime_p50 <= stats.frametime_p95);
+        REQUIRE(stats.frametime_p95 <= stats.frametime_p99);
+
+        // A single speed window was completed, a second of emulated time in far less walltime
+        const auto& distribution = stats.speed_distribution;
+        REQUIRE(distribution[Core::PerfStats::NUM_SPEED_BUCKETS - 1] == 1.0);
+        REQUIRE(std::accumulate(distribution.begin(), distribution.end(), 0.0) == 1.0);
+    }
+
+    SECTION("reset forgets the previous session") {
+        for (int frame = 0; frame < 10; ++frame) {
+            perf_stats->BeginSystemFrame();
+            perf_stats->EndSystemFrame();
+        }
+        perf_stats->ResetSessionStats();
+        REQUIRE(perf_stats->GetSessionStats().system_frames == 0);
+    }
+}
@@ -0,0 +1,59 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <string>
+#include <catch.hpp>
+#include "common/file_util.h"
+#include "core/settings.h"
+#include "core/title_profile.h"
+
+namespace TitleProfile {
+
+TEST_CASE("TitleProfile", "[core]") {
+    const std::string path = "./title_profile_test.ini";
+    Settings::Values values{};
+    values.cpu_core = Settings::CpuCore::Dynarmic;
+    values.use_multi_core = true;
+    values.cpu_clock_percentage = 75;
+    values.resolution_factor = 1.5f;
+    values.present_ahead_depth = 3;
+    values.speed_limit = 100;
+
+    SECTION("exported profiles read back as they were written") {
+        REQUIRE(Write(path, values, 1.25));
+        REQUIRE(ReadScore(path) == 1.25);
+
+        Settings::Values read{};
+        read.speed_limit = 50;
+        REQUIRE(Read(path, read));
+        REQUIRE(read.cpu_core == Settings::CpuCore::Dynarmic);
+        REQUIRE(read.use_multi_core);
+        REQUIRE(read.cpu_clock_percentage == 75);
+        REQUIRE(read.resolution_factor == 1.5f);
+        REQUIRE(read.present_ahead_depth == 3);
+        // Settings profiles don't cover are left alone
+        REQUIRE(read.speed_limit == 50);
+    }
+
+    SECTION("profiles written by hand only override what they set") {
+        FileUtil::WriteStringToFile(true, "[Core]\nuse_multi_core = false\n", path.c_str());
+        REQUIRE(!ReadScore(path));
+        REQUIRE(Read(path, values));
+        REQUIRE(!values.use_multi_core);
+        REQUIRE(values.cpu_clock_percentage == 75);
+    }
+
+    SECTION("malformed profiles are ignored") {
+        FileUtil::WriteStringToFile(true, "[Core]\nuse_multi_core = false\nbroken\n",
+                                    path.c_str());
+        REQUIRE(!Read(path, values));
+        REQUIRE(values.use_multi_core);
+    }
+
+    FileUtil::Delete(path);
+    REQUIRE(!Read(path, values));
+    REQUIRE(!ReadScore(path));
+}
+
+} // namespace TitleProfile
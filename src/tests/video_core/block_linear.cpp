@@ -0,0 +1,90 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <vector>
+#include <catch.hpp>
+#include "video_core/block_linear.h"
+
+namespace VideoCore {
+namespace BlockLinear {
+
+/// Offset of a byte of a block-linear surface, computed one byte at a time
+static size_t GetReferenceOffset(u32 x, u32 y, u32 row_size, u32 block_height) {
+    const size_t blocks_per_row = (row_size + GOB_SIZE_X - 1) / GOB_SIZE_X;
+    const size_t block = (y / (GOB_SIZE_Y * block_height)) * blocks_per_row + x / GOB_SIZE_X;
+    const size_t gob = (y / GOB_SIZE_Y) % block_height;
+    return block * block_height * GOB_SIZE + gob * GOB_SIZE + GetGobOffset(x, y);
+}
+
+static void CheckUnswizzle(u32 width, u32 height, u32 bytes_per_pixel, u32 block_height,
+                           bool flip_vertically) {
+    std::vector<u8> tiled(GetSurfaceSize(width, height, bytes_per_pixel, block_height));
+    for (size_t index = 0; index < tiled.size(); ++index) {
+        tiled[index] = static_cast<u8>(index * 7 + index / 251);
+    }
+
+    const u32 row_size = width * bytes_per_pixel;
+    std::vector<u8> linear(row_size * height);
+    Unswizzle(linear.data(), tiled.data(), width, height, bytes_per_pixel, block_height,
+              flip_vertically);
+
+    for (u32 y = 0; y < height; ++y) {
+        const u32 linear_y = flip_vertically ? height - 1 - y : y;
+        for (u32 x = 0; x < row_size; ++x) {
+            const size_t offset = GetReferenceOffset(x, y, row_size, block_height);
+            if (linear[linear_y * row_size + x] != tiled[offset]) {
+                FAIL("Byte " << x << " of row " << y << " differs");
+            }
+        }
+    }
+}
+
+TEST_CASE("BlockLinear[GobOffset]", "[video_core]") {
+    REQUIRE(GetGobOffset(0, 0) == 0);
+    REQUIRE(GetGobOffset(15, 0) == 15);
+    REQUIRE(GetGobOffset(0, 1) == 16);
+    REQUIRE(GetGobOffset(16, 0) == 32);
+    REQUIRE(GetGobOffset(0, 2) == 64);
+    REQUIRE(GetGobOffset(32, 0) == 256);
+    REQUIRE(GetGobOffset(63, 7) == GOB_SIZE - 1);
+}
+
+TEST_CASE("BlockLinear[SurfaceSize]", "[video_core]") {
+    REQUIRE(GetSurfaceSize(1280, 720, 4, 16) == 1280 * 768 * 4);
+    REQUIRE(GetSurfaceSize(1, 1, 4, 1) == GOB_SIZE);
+    REQUIRE(GetSurfaceSize(17, 9, 4, 1) == 4 * GOB_SIZE);
+}
+
+TEST_CASE("BlockLinear[Unswizzle]", "[video_core]") {
+    CheckUnswizzle(1280, 720, 4, FRAMEBUFFER_BLOCK_HEIGHT, true);
+    CheckUnswizzle(1280, 720, 4, FRAMEBUFFER_BLOCK_HEIGHT, false);
+
+    // Partial GOBs at the right and bottom edges
+    CheckUnswizzle(100, 37, 4, 4, false);
+    CheckUnswizzle(33, 130, 2, 16, true);
+    CheckUnswizzle(7, 3, 1, 1, false);
+}
+
+// Not run by default, select it with the [benchmark] tag
+TEST_CASE("BlockLinear[Benchmark]", "[.][benchmark]") {
+    constexpr u32 width = 1280;
+    constexpr u32 height = 720;
+    constexpr int iterations = 200;
+
+    std::vector<u8> tiled(GetSurfaceSize(width, height, 4, FRAMEBUFFER_BLOCK_HEIGHT), 0x55);
+    std::vector<u8> linear(width * height * 4);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        Unswizzle(linear.data(), tiled.data(), width, height, 4, FRAMEBUFFER_BLOCK_HEIGHT, true);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    WARN("Unswizzling a 1280x720 framebuffer takes " << us / iterations << " us");
+}
+
+} // namespace BlockLinear
+} // namespace VideoCore
@@ -0,0 +1,97 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <thread>
+#include <vector>
+#include <catch.hpp>
+#include "video_core/frame_queue.h"
+
+namespace VideoCore {
+
+TEST_CASE("FrameQueue[Order]", "[video_core]") {
+    FrameQueue queue(2);
+
+    Frame* first = queue.AcquireFreeFrame();
+    Frame* second = queue.AcquireFreeFrame();
+    REQUIRE(first != nullptr);
+    REQUIRE(second != nullptr);
+    REQUIRE(first != second);
+
+    queue.SubmitFrame(first);
+    queue.SubmitFrame(second);
+    REQUIRE(queue.AcquirePresentFrame() == first);
+    REQUIRE(queue.AcquirePresentFrame() == second);
+
+    // Presented frames are recycled
+    queue.ReleasePresentFrame(first);
+    REQUIRE(queue.AcquireFreeFrame() == first);
+}
+
+TEST_CASE("FrameQueue[Threads]", "[video_core]") {
+    constexpr u64 num_frames = 1000;
+    FrameQueue queue(2);
+
+    std::vector<u64> presented;
+    std::thread presenter([&] {
+        while (Frame* frame = queue.AcquirePresentFrame()) {
+            presented.push_back(frame->layers.at(0).info.id);
+            queue.ReleasePresentFrame(frame);
+            if (presented.size() == num_frames) {
+                break;
+            }
+        }
+    });
+
+    for (u64 id = 0; id < num_frames; ++id) {
+        Frame* frame = queue.AcquireFreeFrame();
+        REQUIRE(frame != nullptr);
+        frame->layers.resize(1);
+        frame->layers[0].info.id = id;
+        queue.SubmitFrame(frame);
+    }
+    presenter.join();
+
+    REQUIRE(presented.size() == num_frames);
+    for (u64 id = 0; id < num_frames; ++id) {
+        REQUIRE(presented[id] == id);
+    }
+}
+
+TEST_CASE("FrameQueue[SetDepth]", "[video_core]") {
+    FrameQueue queue(1);
+    Frame* first = queue.AcquireFreeFrame();
+    REQUIRE(first != nullptr);
+
+    // A deeper queue lets another frame be acquired before the first one is presented
+    queue.SetDepth(2);
+    Frame* second = queue.AcquireFreeFrame();
+    REQUIRE(second != nullptr);
+    REQUIRE(second != first);
+    queue.SubmitFrame(first);
+    queue.SubmitFrame(second);
+
+    // Back to a single frame, the next one is only acquired once both are presented
+    queue.SetDepth(1);
+    queue.ReleasePresentFrame(queue.AcquirePresentFrame());
+    Frame* third = nullptr;
+    std::thread submitter([&] { third = queue.AcquireFreeFrame(); });
+    queue.ReleasePresentFrame(queue.AcquirePresentFrame());
+    submitter.join();
+    REQUIRE(third != nullptr);
+}
+
+TEST_CASE("FrameQueue[Close]", "[video_core]") {
+    FrameQueue queue(1);
+    REQUIRE(queue.AcquireFreeFrame() != nullptr);
+
+    // Both sides are woken up once the queue is closed
+    Frame* presented = nullptr;
+    std::thread presenter([&] { presented = queue.AcquirePresentFrame(); });
+    queue.Close();
+    presenter.join();
+    REQUIRE(presented == nullptr);
+    REQUIRE(queue.AcquireFreeFrame() == nullptr);
+}
+
+} // namespace VideoCore
@@ -0,0 +1,42 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <catch.hpp>
+#include "video_core/gpu.h"
+
+namespace Tegra {
+
+TEST_CASE("GPU[Syncpoints]", "[video_core]") {
+    GPU gpu;
+    std::mutex increments_mutex;
+    std::vector<std::pair<u32, u32>> increments;
+    gpu.SetSyncpointCallback([&](u32 syncpoint_id, u32 value) {
+        std::lock_guard<std::mutex> lock(increments_mutex);
+        increments.emplace_back(syncpoint_id, value);
+    });
+
+    REQUIRE(gpu.IncreaseSyncpointMax(3, 1) == 1);
+    REQUIRE(gpu.IncreaseSyncpointMax(3, 1) == 2);
+    gpu.PushCommandLists({}, 3);
+    gpu.PushCommandLists({});
+    gpu.PushCommandLists({}, 3);
+    gpu.WaitIdle();
+
+    // The GPU thread increments the syncpoint of each batch once it processed it
+    REQUIRE(gpu.GetSyncpointValue(3) == 2);
+    REQUIRE(gpu.GetSyncpointValue(4) == 0);
+    const std::vector<std::pair<u32, u32>> expected_increments{{3, 1}, {3, 2}};
+    REQUIRE(increments == expected_increments);
+
+    gpu.IncrementSyncpoint(4);
+    REQUIRE(gpu.GetSyncpointValue(4) == 1);
+    REQUIRE(increments.back().first == 4);
+    REQUIRE(increments.back().second == 1);
+    gpu.SetSyncpointCallback(nullptr);
+}
+
+} // namespace Tegra
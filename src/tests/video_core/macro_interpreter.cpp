@@ -0,0 +1,186 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <vector>
+#include <catch.hpp>
+#include "video_core/macro_interpreter.h"
+#include "video_core/maxwell_3d.h"
+#ifdef ARCHITECTURE_x86_64
+#include "video_core/macro_jit_x64.h"
+#endif
+
+namespace Tegra {
+
+using namespace Macro;
+
+/// Register the tests send to, outside of the registers the engine acts on
+constexpr u32 OUTPUT_METHOD = 0x100;
+/// Method address writing from OUTPUT_METHOD on, with an increment of 1
+constexpr u32 OUTPUT_METHOD_ADDRESS = OUTPUT_METHOD | (1 << 12);
+
+static u32 ALU(ALUOperation operation, ResultOperation result, u32 dst, u32 src_a, u32 src_b) {
+    return static_cast<u32>(Operation::ALU) | (static_cast<u32>(result) << 4) | (dst << 8) |
+           (src_a << 11) | (src_b << 14) | (static_cast<u32>(operation) << 17);
+}
+
+static u32 AddImmediate(ResultOperation result, u32 dst, u32 src_a, s32 immediate) {
+    return static_cast<u32>(Operation::AddImmediate) | (static_cast<u32>(result) << 4) |
+           (dst << 8) | (src_a << 11) | (static_cast<u32>(immediate) << 14);
+}
+
+static u32 ExtractInsert(u32 dst, u32 src_a, u32 src_b, u32 src_bit, u32 size, u32 dst_bit) {
+    return static_cast<u32>(Operation::ExtractInsert) |
+           (static_cast<u32>(ResultOperation::Move) << 4) | (dst << 8) | (src_a << 11) |
+           (src_b << 14) | (src_bit << 17) | (size << 22) | (dst_bit << 27);
+}
+
+static u32 Read(ResultOperation result, u32 dst, u32 src_a, s32 immediate) {
+    return static_cast<u32>(Operation::Read) | (static_cast<u32>(result) << 4) | (dst << 8) |
+           (src_a << 11) | (static_cast<u32>(immediate) << 14);
+}
+
+static u32 Branch(BranchCondition condition, bool annul, u32 src_a, s32 offset) {
+    return static_cast<u32>(Operation::Branch) | (static_cast<u32>(condition) << 4) |
+           ((annul ? 1 : 0) << 5) | (src_a << 11) | (static_cast<u32>(offset) << 14);
+}
+
+static u32 Exit(u32 instruction) {
+    return instruction | (1 << 7);
+}
+
+static void UploadMacro(Maxwell3D& maxwell_3d, u32 index, u32 position,
+                        const std::vector<u32>& code) {
+    maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(macros.upload_address), position);
+    for (const u32 word : code) {
+        maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(macros.data), word);
+    }
+    maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(macros.entry), index);
+    maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(macros.bind), position);
+}
+
+static void CallMacro(Maxwell3D& maxwell_3d, u32 index, const std::vector<u32>& parameters) {
+    const u32 method = Maxwell3D::MACRO_REGISTERS_START + index * 2;
+    for (size_t i = 0; i < parameters.size(); ++i) {
+        maxwell_3d.CallMethod(i == 0 ? method : method + 1, parameters[i],
+                              i + 1 == parameters.size());
+    }
+}
+
+static u32 GetOutput(const Maxwell3D& maxwell_3d, u32 index) {
+    return maxwell_3d.GetRegisterValue(OUTPUT_METHOD + index);
+}
+
+/// Sends the parameters after the count given as the second parameter, then 0x1234
+static const std::vector<u32> send_loop_macro{
+    AddImmediate(ResultOperation::MoveAndSetMethod, 0, 1, 0),
+    AddImmediate(ResultOperation::IgnoreAndFetch, 2, 0, 0),
+    AddImmediate(ResultOperation::Move, 2, 2, -1),
+    AddImmediate(ResultOperation::IgnoreAndFetch, 3, 0, 0),
+    AddImmediate(ResultOperation::MoveAndSend, 0, 3, 0),
+    Branch(BranchCondition::NotZero, false, 2, -2),
+    // Delay slot of the branch
+    AddImmediate(ResultOperation::Move, 2, 2, -1),
+    Exit(AddImmediate(ResultOperation::Move, 5, 0, 0x1234)),
+    // Delay slot of the exit
+    AddImmediate(ResultOperation::MoveAndSend, 0, 5, 0),
+    AddImmediate(ResultOperation::MoveAndSend, 0, 0, 0xBAD),
+};
+
+static void TestSendLoop(bool use_macro_jit) {
+    Maxwell3D maxwell_3d(use_macro_jit);
+    UploadMacro(maxwell_3d, 3, 0x20, send_loop_macro);
+    CallMacro(maxwell_3d, 3, {OUTPUT_METHOD_ADDRESS, 3, 10, 20, 30});
+
+    REQUIRE(GetOutput(maxwell_3d, 0) == 10);
+    REQUIRE(GetOutput(maxwell_3d, 1) == 20);
+    REQUIRE(GetOutput(maxwell_3d, 2) == 30);
+    REQUIRE(GetOutput(maxwell_3d, 3) == 0x1234);
+    REQUIRE(GetOutput(maxwell_3d, 4) == 0);
+
+    // Calling it again runs it from the start
+    CallMacro(maxwell_3d, 3, {OUTPUT_METHOD_ADDRESS + 1, 1, 40});
+    REQUIRE(GetOutput(maxwell_3d, 0) == 10);
+    REQUIRE(GetOutput(maxwell_3d, 1) == 40);
+    REQUIRE(GetOutput(maxwell_3d, 2) == 0x1234);
+}
+
+/// Sends the results of the arithmetic operations on the parameter
+static const std::vector<u32> arithmetic_macro{
+    AddImmediate(ResultOperation::Move, 2, 1, 0),
+    AddImmediate(ResultOperation::FetchAndSetMethod, 1, 0, OUTPUT_METHOD_ADDRESS),
+    // 0x80000001 + 0x80000001 carries
+    ALU(ALUOperation::Add, ResultOperation::MoveAndSend, 3, 2, 2),
+    ALU(ALUOperation::AddWithCarry, ResultOperation::MoveAndSend, 4, 0, 0),
+    // 0 - 1 borrows, which clears the carry
+    ALU(ALUOperation::Subtract, ResultOperation::MoveAndSend, 5, 0, 4),
+    ALU(ALUOperation::SubtractWithBorrow, ResultOperation::MoveAndSend, 6, 4, 0),
+    ExtractInsert(7, 5, 2, 1, 3, 4),
+    ALU(ALUOperation::Or, ResultOperation::MoveAndSend, 0, 7, 0),
+    ALU(ALUOperation::AndNot, ResultOperation::MoveAndSend, 0, 5, 2),
+    Read(ResultOperation::MoveAndSend, 0, 0, OUTPUT_METHOD),
+    // Register 0 ignores writes
+    AddImmediate(ResultOperation::Move, 0, 0, 5),
+    Exit(ALU(ALUOperation::Nand, ResultOperation::MoveAndSend, 0, 0, 2)),
+    ALU(ALUOperation::Xor, ResultOperation::MoveAndSend, 0, 2, 1),
+};
+
+static void TestArithmetic(bool use_macro_jit) {
+    Maxwell3D maxwell_3d(use_macro_jit);
+    UploadMacro(maxwell_3d, 0, 0x100, arithmetic_macro);
+    CallMacro(maxwell_3d, 0, {0x80000001, 0x0F0F0F0F});
+
+    REQUIRE(GetOutput(maxwell_3d, 0) == 2);
+    REQUIRE(GetOutput(maxwell_3d, 1) == 1);
+    REQUIRE(GetOutput(maxwell_3d, 2) == 0xFFFFFFFF);
+    REQUIRE(GetOutput(maxwell_3d, 3) == 0);
+    REQUIRE(GetOutput(maxwell_3d, 4) == 0xFFFFFF8F);
+    REQUIRE(GetOutput(maxwell_3d, 5) == 0x7FFFFFFE);
+    REQUIRE(GetOutput(maxwell_3d, 6) == 2);
+    REQUIRE(GetOutput(maxwell_3d, 7) == 0xFFFFFFFF);
+    REQUIRE(GetOutput(maxwell_3d, 8) == 0x8F0F0F0E);
+    REQUIRE(GetOutput(maxwell_3d, 9) == 0);
+}
+
+TEST_CASE("MacroInterpreter[SendLoop]", "[video_core]") {
+    TestSendLoop(false);
+}
+
+TEST_CASE("MacroInterpreter[Arithmetic]", "[video_core]") {
+    TestArithmetic(false);
+}
+
+#ifdef ARCHITECTURE_x86_64
+
+TEST_CASE("MacroJitX64[SendLoop]", "[video_core]") {
+    TestSendLoop(true);
+}
+
+TEST_CASE("MacroJitX64[Arithmetic]", "[video_core]") {
+    TestArithmetic(true);
+}
+
+TEST_CASE("MacroJitX64[CodeCache]", "[video_core]") {
+    Maxwell3D maxwell_3d(false);
+    MacroJitX64 macro_jit(maxwell_3d);
+    UploadMacro(maxwell_3d, 0, 0, send_loop_macro);
+    macro_jit.Execute(0, {OUTPUT_METHOD_ADDRESS, 1, 10});
+    REQUIRE(macro_jit.GetNumCompiledMacros() == 1);
+
+    // Uploading the same code again reuses the compiled macro
+    UploadMacro(maxwell_3d, 0, 0, send_loop_macro);
+    macro_jit.ClearCode();
+    macro_jit.Execute(0, {OUTPUT_METHOD_ADDRESS, 1, 20});
+    REQUIRE(macro_jit.GetNumCompiledMacros() == 1);
+    REQUIRE(GetOutput(maxwell_3d, 0) == 20);
+
+    UploadMacro(maxwell_3d, 0, 0, arithmetic_macro);
+    macro_jit.ClearCode();
+    macro_jit.Execute(0, {0x80000001, 0x0F0F0F0F});
+    REQUIRE(macro_jit.GetNumCompiledMacros() == 2);
+    REQUIRE(GetOutput(maxwell_3d, 0) == 2);
+}
+
+#endif
+
+} // namespace Tegra
@@ -0,0 +1,89 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <catch.hpp>
+#include "video_core/maxwell_3d.h"
+
+namespace Tegra {
+
+using Regs = Maxwell3DRegs;
+
+static void Draw(Maxwell3D& maxwell_3d, Regs::PrimitiveTopology topology, u32 first, u32 count) {
+    maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(draw_begin), static_cast<u32>(topology));
+    maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(vertex_buffer.first), first);
+    maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(vertex_buffer.count), count);
+    maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(draw_end), 0);
+}
+
+static bool IsGroupSet(BitSet32 groups, Maxwell3DStateGroup group) {
+    return groups[static_cast<size_t>(group)];
+}
+
+TEST_CASE("Maxwell3D[DirtyGroups]", "[video_core]") {
+    Maxwell3D maxwell_3d;
+    Draw(maxwell_3d, Regs::PrimitiveTopology::Triangles, 0, 3);
+    REQUIRE(!maxwell_3d.GetDirtyGroups());
+
+    // Writing the value a register already has doesn't flag its group
+    maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(depth_test_enable), 0);
+    REQUIRE(!maxwell_3d.GetDirtyGroups());
+
+    maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(depth_test_enable), 1);
+    maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(cull.cull_face),
+                        static_cast<u32>(Regs::CullFace::Back));
+    REQUIRE(maxwell_3d.GetRegs().depth_test_enable == 1);
+    REQUIRE(maxwell_3d.GetRegs().cull.cull_face == Regs::CullFace::Back);
+    const BitSet32 dirty_groups = maxwell_3d.GetDirtyGroups();
+    REQUIRE(dirty_groups.Count() == 2);
+    REQUIRE(IsGroupSet(dirty_groups, Maxwell3DStateGroup::Depth));
+    REQUIRE(IsGroupSet(dirty_groups, Maxwell3DStateGroup::Cull));
+
+    // Registers outside of the groups don't flag any
+    Draw(maxwell_3d, Regs::PrimitiveTopology::Triangles, 3, 3);
+    maxwell_3d.WriteReg(0x100, 0x1234);
+    REQUIRE(!maxwell_3d.GetDirtyGroups());
+}
+
+TEST_CASE("Maxwell3D[DrawBatch]", "[video_core]") {
+    Maxwell3D maxwell_3d;
+
+    // Consecutive ranges of the same list topology and state are merged
+    Draw(maxwell_3d, Regs::PrimitiveTopology::Triangles, 0, 6);
+    Draw(maxwell_3d, Regs::PrimitiveTopology::Triangles, 6, 3);
+    // Strips can't be merged
+    Draw(maxwell_3d, Regs::PrimitiveTopology::TriangleStrip, 9, 4);
+    Draw(maxwell_3d, Regs::PrimitiveTopology::TriangleStrip, 13, 4);
+    // Neither can draws with different states
+    maxwell_3d.WriteReg(MAXWELL3D_REG_INDEX(blend.enable), 1);
+    Draw(maxwell_3d, Regs::PrimitiveTopology::TriangleStrip, 17, 4);
+    // Empty draws are skipped
+    Draw(maxwell_3d, Regs::PrimitiveTopology::Triangles, 0, 0);
+
+    Maxwell3DDrawBatch batch = maxwell_3d.TakeDrawBatch();
+    REQUIRE(batch.draws.size() == 4);
+    REQUIRE(batch.draws[0].first == 0);
+    REQUIRE(batch.draws[0].count == 9);
+    REQUIRE(batch.draws[1].topology == Regs::PrimitiveTopology::TriangleStrip);
+    REQUIRE(batch.draws[2].first == 13);
+
+    // The first state has every group changed, the next one only the blend group
+    REQUIRE(batch.states.size() == 2);
+    REQUIRE(batch.draws[2].state_index == 0);
+    REQUIRE(batch.draws[3].state_index == 1);
+    REQUIRE(batch.states[0].changed_groups ==
+            BitSet32::AllTrue(static_cast<size_t>(Maxwell3DStateGroup::NumGroups)));
+    REQUIRE(batch.states[1].changed_groups.Count() == 1);
+    REQUIRE(IsGroupSet(batch.states[1].changed_groups, Maxwell3DStateGroup::Blend));
+    REQUIRE(batch.states[1].blend.enable[0] == 1);
+
+    // The next batch starts with the current state, without changes
+    REQUIRE(maxwell_3d.TakeDrawBatch().IsEmpty());
+    Draw(maxwell_3d, Regs::PrimitiveTopology::Triangles, 0, 3);
+    batch = maxwell_3d.TakeDrawBatch();
+    REQUIRE(batch.states.size() == 1);
+    REQUIRE(!batch.states[0].changed_groups);
+    REQUIRE(batch.states[0].blend.enable[0] == 1);
+}
+
+} // namespace Tegra
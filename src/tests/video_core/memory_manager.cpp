@@ -0,0 +1,72 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <boost/optional/optional_io.hpp>
+#include <catch.hpp>
+#include "video_core/memory_manager.h"
+
+namespace Tegra {
+
+TEST_CASE("MemoryManager[Map]", "[video_core]") {
+    MemoryManager memory_manager;
+
+    const boost::optional<GPUVAddr> first = memory_manager.MapBufferEx(0x80000000, 0x1800);
+    const boost::optional<GPUVAddr> second = memory_manager.MapBufferEx(0x90000000, 0x1000);
+    REQUIRE(first);
+    REQUIRE(second);
+    REQUIRE(*first != 0);
+    // Mappings are rounded up to whole pages
+    REQUIRE(*second >= *first + 0x2000);
+
+    REQUIRE(memory_manager.GpuToCpuAddress(*first) == VAddr(0x80000000));
+    REQUIRE(memory_manager.GpuToCpuAddress(*first + 0x1234) == VAddr(0x80001234));
+    REQUIRE(memory_manager.GpuToCpuAddress(*second + 0xFFF) == VAddr(0x90000FFF));
+    REQUIRE(memory_manager.GpuToCpuAddress(*second + 0x1000) == boost::none);
+    REQUIRE(memory_manager.GpuToCpuAddress(0) == boost::none);
+    REQUIRE(memory_manager.GpuToCpuAddress(MemoryManager::ADDRESS_SPACE_SIZE) == boost::none);
+
+    // The range of an unmapped buffer is reused
+    REQUIRE(memory_manager.UnmapBuffer(*first));
+    REQUIRE_FALSE(memory_manager.UnmapBuffer(*first));
+    REQUIRE(memory_manager.GpuToCpuAddress(*first) == boost::none);
+    REQUIRE(memory_manager.MapBufferEx(0xA0000000, 0x1000) == *first);
+}
+
+TEST_CASE("MemoryManager[FixedMap]", "[video_core]") {
+    MemoryManager memory_manager;
+
+    REQUIRE(memory_manager.MapBufferEx(0x80000000, 0x400000, 0x3000) == 0x400000);
+    // Overlapping mappings replace the previous ones entirely
+    REQUIRE(memory_manager.MapBufferEx(0x90000000, 0x401000, 0x1000) == 0x401000);
+    REQUIRE(memory_manager.GpuToCpuAddress(0x401010) == VAddr(0x90000010));
+    REQUIRE(memory_manager.GpuToCpuAddress(0x400000) == boost::none);
+    REQUIRE(memory_manager.GpuToCpuAddress(0x402000) == boost::none);
+    REQUIRE_FALSE(memory_manager.UnmapBuffer(0x400000));
+
+    // Free addresses are allocated past fixed mappings
+    const boost::optional<GPUVAddr> gpu_addr = memory_manager.MapBufferEx(0xA0000000, 0x1000);
+    REQUIRE(gpu_addr);
+    REQUIRE((*gpu_addr < 0x401000 || *gpu_addr >= 0x402000));
+}
+
+TEST_CASE("MemoryManager[AllocateSpace]", "[video_core]") {
+    MemoryManager memory_manager;
+
+    const boost::optional<GPUVAddr> space = memory_manager.AllocateSpace(0x100000, 0x20000);
+    REQUIRE(space);
+    REQUIRE(*space % 0x20000 == 0);
+    REQUIRE(memory_manager.AllocateFixedSpace(*space + 0x1000, 0x1000) == boost::none);
+
+    // Buffers mapped inside a reserved range give it back when they are unmapped
+    REQUIRE(memory_manager.MapBufferEx(0x80000000, *space + 0x10000, 0x2000) == *space + 0x10000);
+    REQUIRE(memory_manager.GpuToCpuAddress(*space + 0x11000) == VAddr(0x80001000));
+    REQUIRE(memory_manager.UnmapBuffer(*space + 0x10000));
+    REQUIRE(memory_manager.GpuToCpuAddress(*space + 0x11000) == boost::none);
+
+    const boost::optional<GPUVAddr> buffer = memory_manager.MapBufferEx(0x90000000, 0x1000);
+    REQUIRE(buffer);
+    REQUIRE((*buffer < *space || *buffer >= *space + 0x100000));
+}
+
+} // namespace Tegra
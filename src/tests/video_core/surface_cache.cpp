@@ -0,0 +1,63 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <memory>
+#include <vector>
+#include <catch.hpp>
+#include "core/hle/kernel/process.h"
+#include "core/memory.h"
+#include "video_core/surface_cache.h"
+
+namespace VideoCore {
+
+TEST_CASE("SurfaceCache", "[video_core]") {
+    Kernel::g_current_process = Kernel::Process::Create("");
+    auto& vm_manager = Kernel::g_current_process->vm_manager;
+    Memory::SetCurrentPageTable(&vm_manager.page_table);
+
+    const VAddr base = Memory::HEAP_VADDR;
+    const u64 size = 4 * Memory::PAGE_SIZE;
+    auto block = std::make_shared<std::vector<u8>>(size);
+    REQUIRE(vm_manager.MapMemoryBlock(base, block, 0, size, Kernel::MemoryState::Normal)
+                .Succeeded());
+
+    // Spans the first two pages, without being page aligned
+    const SurfaceParams params{base + 0x100, 32, 32, 32, 0, 0x1800};
+    SurfaceCache cache;
+    REQUIRE(cache.AcquireSurface(Kernel::g_current_process, params));
+    REQUIRE(!cache.AcquireSurface(Kernel::g_current_process, params));
+
+    SECTION("writes to the surface pages modify it") {
+        Memory::Write32(base + Memory::PAGE_SIZE + 0x10, 0x12345678);
+        REQUIRE(cache.AcquireSurface(Kernel::g_current_process, params));
+        REQUIRE(!cache.AcquireSurface(Kernel::g_current_process, params));
+    }
+
+    SECTION("writes to other pages leave it clean") {
+        Memory::Write32(base + 3 * Memory::PAGE_SIZE, 0x12345678);
+        REQUIRE(!cache.AcquireSurface(Kernel::g_current_process, params));
+    }
+
+    SECTION("a different layout is a different surface") {
+        SurfaceParams other_params = params;
+        other_params.format = 1;
+        REQUIRE(cache.AcquireSurface(Kernel::g_current_process, other_params));
+        REQUIRE(cache.GetNumSurfaces() == 2);
+    }
+
+    SECTION("unused surfaces are evicted") {
+        // The frame it was acquired in, then the frames it is kept for
+        for (u64 frame = 0; frame <= SurfaceCache::MAX_UNUSED_FRAMES; ++frame) {
+            REQUIRE(cache.GetNumSurfaces() == 1);
+            cache.EndFrame();
+        }
+        REQUIRE(cache.GetNumSurfaces() == 0);
+        REQUIRE(cache.AcquireSurface(Kernel::g_current_process, params));
+    }
+
+    cache.Clear();
+    vm_manager.UnmapRange(base, size);
+}
+
+} // namespace VideoCore
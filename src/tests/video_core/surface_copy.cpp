@@ -0,0 +1,189 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <memory>
+#include <vector>
+#include <catch.hpp>
+#include "core/hle/kernel/process.h"
+#include "core/memory.h"
+#include "video_core/block_linear.h"
+#include "video_core/fermi_2d.h"
+#include "video_core/maxwell_dma.h"
+#include "video_core/surface_copy.h"
+
+namespace Tegra {
+
+TEST_CASE("SurfaceCopy", "[video_core]") {
+    Kernel::g_current_process = Kernel::Process::Create("");
+    auto& vm_manager = Kernel::g_current_process->vm_manager;
+    Memory::SetCurrentPageTable(&vm_manager.page_table);
+
+    const VAddr base = Memory::HEAP_VADDR;
+    const u64 size = 4 * Memory::PAGE_SIZE;
+    auto block = std::make_shared<std::vector<u8>>(size);
+    REQUIRE(vm_manager.MapMemoryBlock(base, block, 0, size, Kernel::MemoryState::Normal)
+                .Succeeded());
+
+    // Two pages for each surface, in GPU pages that are in the reverse order in CPU memory
+    MemoryManager memory_manager;
+    const GPUVAddr src_addr = 0x1000000;
+    const GPUVAddr dst_addr = 0x2000000;
+    memory_manager.MapBufferEx(base + Memory::PAGE_SIZE, src_addr, Memory::PAGE_SIZE);
+    memory_manager.MapBufferEx(base, src_addr + Memory::PAGE_SIZE, Memory::PAGE_SIZE);
+    memory_manager.MapBufferEx(base + 2 * Memory::PAGE_SIZE, dst_addr, 2 * Memory::PAGE_SIZE);
+
+    for (u32 offset = 0; offset < 2 * Memory::PAGE_SIZE; ++offset) {
+        Memory::Write8(base + offset, static_cast<u8>(offset * 7 + 1));
+    }
+    const auto read_src = [&](u32 offset) {
+        const u64 page = offset / Memory::PAGE_SIZE;
+        return Memory::Read8(base + (1 - page) * Memory::PAGE_SIZE + offset % Memory::PAGE_SIZE);
+    };
+    const auto read_dst = [&](u32 offset) {
+        return Memory::Read8(base + 2 * Memory::PAGE_SIZE + offset);
+    };
+
+    SECTION("pitch linear copies move the rectangle only, across pages") {
+        // 256 bytes rows, the rectangle spans the page boundary
+        const CopySurface src{src_addr, false, 256, 0, 0};
+        const CopySurface dst{dst_addr, false, 128, 0, 0};
+        CopySurfaceOnCPU(memory_manager, {src, dst, 4, 3, 14, 1, 2, 5, 4});
+
+        for (u32 y = 0; y < 8; ++y) {
+            for (u32 x = 0; x < 128; ++x) {
+                const bool is_inside = y >= 2 && y < 6 && x >= 4 && x < 24;
+                const u8 expected = is_inside ? read_src((y - 2 + 14) * 256 + x - 4 + 12) : 0;
+                REQUIRE(read_dst(y * 128 + x) == expected);
+            }
+        }
+    }
+
+    SECTION("block-linear surfaces follow the GOB layout") {
+        // 128 bytes wide, with blocks of two GOBs, the copy covers some GOBs partly
+        const CopySurface linear{src_addr, false, 128, 0, 0};
+        const CopySurface tiled{dst_addr, true, 0, 32, 2};
+        CopySurfaceOnCPU(memory_manager, {linear, tiled, 4, 0, 0, 2, 3, 28, 20});
+
+        for (u32 y = 0; y < 24; ++y) {
+            for (u32 x = 0; x < 128; ++x) {
+                const u32 block_row = y / 16;
+                const u32 offset = block_row * 2 * 1024 + (x / 64) * 1024 + (y % 16) / 8 * 512 +
+                                   VideoCore::BlockLinear::GetGobOffset(x, y);
+                const bool is_inside = y >= 3 && y < 23 && x >= 8 && x < 120;
+                const u8 expected = is_inside ? read_src((y - 3) * 128 + x - 8) : 0;
+                REQUIRE(read_dst(offset) == expected);
+            }
+        }
+
+        // The surface reads back as it was written
+        const CopySurface copy{src_addr + Memory::PAGE_SIZE, false, 112, 0, 0};
+        CopySurfaceOnCPU(memory_manager, {tiled, copy, 4, 2, 3, 0, 0, 28, 20});
+        for (u32 offset = 0; offset < 112 * 20; ++offset) {
+            REQUIRE(read_src(Memory::PAGE_SIZE + offset) ==
+                    read_src(offset / 112 * 128 + offset % 112));
+        }
+    }
+
+    SECTION("copies touching unmapped memory fail") {
+        const CopySurface src{src_addr, false, 256, 0, 0};
+        const CopySurface unmapped{0x3000000, false, 256, 0, 0};
+        REQUIRE(!CopySurfaceOnCPU(memory_manager, {src, unmapped, 1, 0, 0, 0, 0, 16, 1}));
+        REQUIRE(CopySurfaceOnCPU(memory_manager, {src, unmapped, 1, 0, 0, 0, 0, 0, 0}));
+    }
+
+    vm_manager.UnmapRange(base, size);
+}
+
+TEST_CASE("Fermi2D[Blit]", "[video_core]") {
+    std::vector<SurfaceCopy> copies;
+    Fermi2D fermi_2d([&](const SurfaceCopy& copy) { copies.push_back(copy); });
+
+    const auto set_surface = [&](u32 first_reg, GPUVAddr address, bool is_linear) {
+        fermi_2d.WriteReg(first_reg, static_cast<u32>(Fermi2DRegs::SurfaceFormat::RGBA8_UNORM));
+        fermi_2d.WriteReg(first_reg + 1, is_linear);
+        fermi_2d.WriteReg(first_reg + 2, 4 << 4);
+        fermi_2d.WriteReg(first_reg + 5, 0x400);
+        fermi_2d.WriteReg(first_reg + 6, 256);
+        fermi_2d.WriteReg(first_reg + 8, static_cast<u32>(address >> 32));
+        fermi_2d.WriteReg(first_reg + 9, static_cast<u32>(address));
+    };
+    const auto blit = [&](u32 du_dx) {
+        fermi_2d.WriteReg(FERMI2D_REG_INDEX(blit_dst_x), 8);
+        fermi_2d.WriteReg(FERMI2D_REG_INDEX(blit_dst_y), 9);
+        fermi_2d.WriteReg(FERMI2D_REG_INDEX(blit_dst_width), 64);
+        fermi_2d.WriteReg(FERMI2D_REG_INDEX(blit_dst_height), 32);
+        fermi_2d.WriteReg(FERMI2D_REG_INDEX(blit_du_dx) + 1, du_dx);
+        fermi_2d.WriteReg(FERMI2D_REG_INDEX(blit_dv_dy) + 1, 1);
+        fermi_2d.WriteReg(FERMI2D_REG_INDEX(blit_src_x) + 1, 2);
+        fermi_2d.WriteReg(FERMI2D_REG_INDEX(blit_src_y), 0x80000000);
+        fermi_2d.WriteReg(FERMI2D_REG_INDEX(blit_src_y) + 1, 3);
+    };
+    set_surface(FERMI2D_REG_INDEX(src), 0x101000, true);
+    set_surface(FERMI2D_REG_INDEX(dst), 0x1200000, false);
+
+    blit(1);
+    REQUIRE(copies.size() == 1);
+    const SurfaceCopy& copy = copies[0];
+    REQUIRE(copy.src.address == 0x101000);
+    REQUIRE(!copy.src.is_block_linear);
+    REQUIRE(copy.src.pitch == 0x400);
+    REQUIRE(copy.dst.address == 0x1200000);
+    REQUIRE(copy.dst.is_block_linear);
+    REQUIRE(copy.dst.width == 256);
+    REQUIRE(copy.dst.block_height == 16);
+    REQUIRE(copy.bytes_per_pixel == 4);
+    REQUIRE(copy.src_x == 2);
+    REQUIRE(copy.src_y == 3);
+    REQUIRE(copy.dst_x == 8);
+    REQUIRE(copy.dst_y == 9);
+    REQUIRE(copy.width == 64);
+    REQUIRE(copy.height == 32);
+
+    // Scaled blits aren't copies
+    blit(2);
+    REQUIRE(copies.size() == 1);
+}
+
+TEST_CASE("MaxwellDMA[Launch]", "[video_core]") {
+    std::vector<SurfaceCopy> copies;
+    MaxwellDMA maxwell_dma([&](const SurfaceCopy& copy) { copies.push_back(copy); });
+
+    maxwell_dma.WriteReg(MAXWELLDMA_REG_INDEX(src_address_high), 0x1);
+    maxwell_dma.WriteReg(MAXWELLDMA_REG_INDEX(src_address_low), 0x2000);
+    maxwell_dma.WriteReg(MAXWELLDMA_REG_INDEX(dst_address_low), 0x300000);
+    maxwell_dma.WriteReg(MAXWELLDMA_REG_INDEX(src_pitch), 0x100);
+    maxwell_dma.WriteReg(MAXWELLDMA_REG_INDEX(line_length), 0x40);
+    maxwell_dma.WriteReg(MAXWELLDMA_REG_INDEX(line_count), 0x10);
+    maxwell_dma.WriteReg(MAXWELLDMA_REG_INDEX(dst_params), 3 << 4);
+    maxwell_dma.WriteReg(MAXWELLDMA_REG_INDEX(dst_params.size_x), 0x200);
+    maxwell_dma.WriteReg(MAXWELLDMA_REG_INDEX(dst_params) + 5, (5 << 16) | 0x20);
+
+    // Pitch linear source, block-linear destination, several lines
+    maxwell_dma.WriteReg(MAXWELLDMA_REG_INDEX(launch_dma), 1 | (1 << 7) | (1 << 9));
+    REQUIRE(copies.size() == 1);
+    const SurfaceCopy& copy = copies[0];
+    REQUIRE(copy.src.address == 0x100002000);
+    REQUIRE(!copy.src.is_block_linear);
+    REQUIRE(copy.src.pitch == 0x100);
+    REQUIRE(copy.src_x == 0);
+    REQUIRE(copy.src_y == 0);
+    REQUIRE(copy.dst.address == 0x300000);
+    REQUIRE(copy.dst.is_block_linear);
+    REQUIRE(copy.dst.width == 0x200);
+    REQUIRE(copy.dst.block_height == 8);
+    REQUIRE(copy.dst_x == 0x20);
+    REQUIRE(copy.dst_y == 5);
+    REQUIRE(copy.bytes_per_pixel == 1);
+    REQUIRE(copy.width == 0x40);
+    REQUIRE(copy.height == 0x10);
+
+    // A single line, then a launch without a transfer
+    maxwell_dma.WriteReg(MAXWELLDMA_REG_INDEX(launch_dma), 1 | (1 << 7));
+    REQUIRE(copies.size() == 2);
+    REQUIRE(copies[1].height == 1);
+    maxwell_dma.WriteReg(MAXWELLDMA_REG_INDEX(launch_dma), 0);
+    REQUIRE(copies.size() == 2);
+}
+
+} // namespace Tegra
@@ -0,0 +1,78 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <vector>
+#include <catch.hpp>
+#include "common/file_util.h"
+#include "video_core/texture_disk_cache.h"
+
+namespace VideoCore {
+
+static const std::string CACHE_DIRECTORY = "./texture_disk_cache_test/";
+
+static std::vector<u8> MakeTexture(size_t size, u8 seed) {
+    std::vector<u8> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<u8>(seed + i * 7);
+    }
+    return data;
+}
+
+TEST_CASE("TextureDiskCache[Keys]", "[video_core]") {
+    const std::vector<u8> encoded = MakeTexture(256, 1);
+    const u64 key = TextureDiskCache::ComputeKey(encoded.data(), encoded.size(), 1, 16, 16);
+    REQUIRE(key == TextureDiskCache::ComputeKey(encoded.data(), encoded.size(), 1, 16, 16));
+    REQUIRE(key != TextureDiskCache::ComputeKey(encoded.data(), encoded.size(), 2, 16, 16));
+    REQUIRE(key != TextureDiskCache::ComputeKey(encoded.data(), encoded.size(), 1, 8, 32));
+    REQUIRE(key != TextureDiskCache::ComputeKey(encoded.data(), encoded.size() - 1, 1, 16, 16));
+}
+
+TEST_CASE("TextureDiskCache[Persistence]", "[video_core]") {
+    FileUtil::DeleteDirRecursively(CACHE_DIRECTORY);
+    const std::vector<u8> decoded = MakeTexture(1024, 3);
+    const u64 key = 0x0123456789ABCDEF;
+    {
+        TextureDiskCache cache(CACHE_DIRECTORY, 1 << 20);
+        std::vector<u8> loaded(decoded.size());
+        REQUIRE(!cache.Load(key, loaded.data(), loaded.size()));
+        cache.Store(key, decoded);
+        cache.Flush();
+        REQUIRE(cache.GetNumEntries() == 1);
+        REQUIRE(cache.GetSize() == decoded.size());
+    }
+
+    // Found again by another session
+    TextureDiskCache cache(CACHE_DIRECTORY, 1 << 20);
+    std::vector<u8> loaded(decoded.size());
+    REQUIRE(cache.Load(key, loaded.data(), loaded.size()));
+    REQUIRE(loaded == decoded);
+    // Entries are only read back at the size they were stored with
+    REQUIRE(!cache.Load(key, loaded.data(), loaded.size() - 1));
+    FileUtil::DeleteDirRecursively(CACHE_DIRECTORY);
+}
+
+TEST_CASE("TextureDiskCache[Eviction]", "[video_core]") {
+    FileUtil::DeleteDirRecursively(CACHE_DIRECTORY);
+    const size_t size = 1024;
+    TextureDiskCache cache(CACHE_DIRECTORY, 2 * size);
+    cache.Store(1, MakeTexture(size, 1));
+    cache.Flush();
+    cache.Store(2, MakeTexture(size, 2));
+    cache.Flush();
+
+    // The first entry is used last, so the second one is deleted to make room for the third
+    std::vector<u8> loaded(size);
+    REQUIRE(cache.Load(1, loaded.data(), size));
+    cache.Store(3, MakeTexture(size, 3));
+    cache.Flush();
+    REQUIRE(cache.GetNumEntries() == 2);
+    REQUIRE(cache.GetSize() == 2 * size);
+    REQUIRE(cache.Load(1, loaded.data(), size));
+    REQUIRE(!cache.Load(2, loaded.data(), size));
+    REQUIRE(cache.Load(3, loaded.data(), size));
+    REQUIRE(loaded == MakeTexture(size, 3));
+    FileUtil::DeleteDirRecursively(CACHE_DIRECTORY);
+}
+
+} // namespace VideoCore
@@ -0,0 +1,130 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include "video_core/block_linear.h"
+
+#ifdef ARCHITECTURE_x86_64
+#include <immintrin.h>
+#include "common/x64/cpu_detect.h"
+#endif
+
+namespace VideoCore {
+namespace BlockLinear {
+
+/// Size of the chunks the rows of a GOB are split into
+constexpr u32 CHUNK_SIZE = 16;
+
+/// Copies the 8 rows of a GOB that lies entirely inside the surface
+using CopyGobFunc = void (*)(u8* dest, std::ptrdiff_t dest_pitch, const u8* gob);
+
+#ifdef ARCHITECTURE_x86_64
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+static void CopyGobSSE2(u8* dest, std::ptrdiff_t dest_pitch, const u8* gob) {
+    for (u32 y = 0; y < GOB_SIZE_Y; ++y, dest += dest_pitch) {
+        for (u32 x = 0; x < GOB_SIZE_X; x += CHUNK_SIZE) {
+            const __m128i chunk =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(gob + GetGobOffset(x, y)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x), chunk);
+        }
+    }
+}
+
+TARGET_AVX2 static void CopyGobAVX2(u8* dest, std::ptrdiff_t dest_pitch, const u8* gob) {
+    // A chunk of an even row is directly followed by the same chunk of the next row, so a single
+    // load covers both rows
+    for (u32 y = 0; y < GOB_SIZE_Y; y += 2, dest += 2 * dest_pitch) {
+        for (u32 x = 0; x < GOB_SIZE_X; x += CHUNK_SIZE) {
+            const __m256i rows =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(gob + GetGobOffset(x, y)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x), _mm256_castsi256_si128(rows));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + dest_pitch + x),
+                             _mm256_extracti128_si256(rows, 1));
+        }
+    }
+}
+
+#undef TARGET_AVX2
+
+#else
+
+static void CopyGobGeneric(u8* dest, std::ptrdiff_t dest_pitch, const u8* gob) {
+    for (u32 y = 0; y < GOB_SIZE_Y; ++y, dest += dest_pitch) {
+        for (u32 x = 0; x < GOB_SIZE_X; x += CHUNK_SIZE) {
+            std::memcpy(dest + x, gob + GetGobOffset(x, y), CHUNK_SIZE);
+        }
+    }
+}
+
+#endif // ARCHITECTURE_x86_64
+
+static CopyGobFunc SelectCopyGob() {
+#ifdef ARCHITECTURE_x86_64
+    if (Common::GetCPUCaps().avx2) {
+        return CopyGobAVX2;
+    }
+    // SSE2 is always available on x86_64
+    return CopyGobSSE2;
+#else
+    return CopyGobGeneric;
+#endif
+}
+
+/// Copies the part of a GOB that lies inside the surface, at the right or bottom edge of it
+static void CopyPartialGob(u8* dest, std::ptrdiff_t dest_pitch, const u8* gob, u32 width,
+                           u32 height) {
+    for (u32 y = 0; y < height; ++y, dest += dest_pitch) {
+        for (u32 x = 0; x < width; x += CHUNK_SIZE) {
+            std::memcpy(dest + x, gob + GetGobOffset(x, y), std::min(CHUNK_SIZE, width - x));
+        }
+    }
+}
+
+size_t GetSurfaceSize(u32 width, u32 height, u32 bytes_per_pixel, u32 block_height) {
+    const size_t blocks_per_row = (width * bytes_per_pixel + GOB_SIZE_X - 1) / GOB_SIZE_X;
+    const size_t blocks_per_column =
+        (height + GOB_SIZE_Y * block_height - 1) / (GOB_SIZE_Y * block_height);
+    return blocks_per_row * blocks_per_column * GOB_SIZE * block_height;
+}
+
+void Unswizzle(u8* linear, const u8* tiled, u32 width, u32 height, u32 bytes_per_pixel,
+               u32 block_height, bool flip_vertically) {
+    static const CopyGobFunc copy_gob = SelectCopyGob();
+
+    const u32 row_size = width * bytes_per_pixel;
+    const size_t blocks_per_row = (row_size + GOB_SIZE_X - 1) / GOB_SIZE_X;
+    const size_t block_size = GOB_SIZE * block_height;
+
+    const std::ptrdiff_t pitch =
+        flip_vertically ? -static_cast<std::ptrdiff_t>(row_size) : row_size;
+    u8* const first_row = flip_vertically ? linear + size_t(height - 1) * row_size : linear;
+
+    for (u32 y = 0; y < height; y += GOB_SIZE_Y) {
+        const u32 gob_row = y / GOB_SIZE_Y;
+        const u8* gob = tiled + (gob_row / block_height) * blocks_per_row * block_size +
+                        (gob_row % block_height) * GOB_SIZE;
+        u8* const dest = first_row + y * pitch;
+        const u32 rows = std::min(GOB_SIZE_Y, height - y);
+
+        // Consecutive GOBs of a row are in consecutive blocks
+        for (u32 x = 0; x < row_size; x += GOB_SIZE_X, gob += block_size) {
+            const u32 columns = std::min(GOB_SIZE_X, row_size - x);
+            if (rows == GOB_SIZE_Y && columns == GOB_SIZE_X) {
+                copy_gob(dest + x, pitch, gob);
+            } else {
+                CopyPartialGob(dest + x, pitch, gob, columns, rows);
+            }
+        }
+    }
+}
+
+} // namespace BlockLinear
+} // namespace VideoCore
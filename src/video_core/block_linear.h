@@ -0,0 +1,50 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include "common/common_types.h"
+
+namespace VideoCore {
+
+/**
+ * The Tegra block-linear layout is made of GOBs (groups of bytes) of 64 bytes by 8 rows, which
+ * are stacked vertically into blocks. The blocks are laid out row by row. Inside a GOB the rows
+ * are split into 16 byte chunks, interleaved in a fixed pattern.
+ */
+namespace BlockLinear {
+
+constexpr u32 GOB_SIZE_X = 64;
+constexpr u32 GOB_SIZE_Y = 8;
+constexpr u32 GOB_SIZE = GOB_SIZE_X * GOB_SIZE_Y;
+
+/// Height in GOBs of the blocks of the framebuffers displayed by nvdisp
+constexpr u32 FRAMEBUFFER_BLOCK_HEIGHT = 16;
+
+/// Returns the offset of a byte within a GOB
+constexpr u32 GetGobOffset(u32 x, u32 y) {
+    return ((x % 64) / 32) * 256 + ((y % 8) / 2) * 64 + ((x % 32) / 16) * 32 + (y % 2) * 16 +
+           (x % 16);
+}
+
+/**
+ * Returns the size of a surface in the block-linear layout.
+ * @param block_height Height of the blocks, in GOBs
+ */
+size_t GetSurfaceSize(u32 width, u32 height, u32 bytes_per_pixel, u32 block_height);
+
+/**
+ * Copies a surface in the block-linear layout to a linear one, with rows of width pixels. Whole
+ * GOBs are copied with the widest vector moves supported by the host CPU.
+ * @param linear Destination of the linear surface
+ * @param tiled Surface in the block-linear layout, of GetSurfaceSize bytes
+ * @param block_height Height of the blocks, in GOBs
+ * @param flip_vertically Whether to write the rows bottom-up, as OpenGL expects textures
+ */
+void Unswizzle(u8* linear, const u8* tiled, u32 width, u32 height, u32 bytes_per_pixel,
+               u32 block_height, bool flip_vertically);
+
+} // namespace BlockLinear
+} // namespace VideoCore
@@ -0,0 +1,78 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include "common/logging/log.h"
+#include "common/microprofile.h"
+#include "video_core/command_processor.h"
+#include "video_core/gpu.h"
+
+namespace Tegra {
+
+MICROPROFILE_DEFINE(GPU_CommandList, "GPU", "Process command list", MP_RGB(128, 128, 192));
+
+void GPU::ProcessCommandList(const CommandListHeader& entry) {
+    MICROPROFILE_SCOPE(GPU_CommandList);
+
+    const GPUVAddr gpu_addr = entry.addr;
+    command_list.resize(entry.size);
+    if (!memory_manager.ReadBlock(gpu_addr, command_list.data(),
+                                  command_list.size() * sizeof(u32))) {
+        LOG_ERROR(HW_GPU, "Command list at unmapped address 0x%llx", gpu_addr);
+        return;
+    }
+
+    size_t index = 0;
+    while (index < command_list.size()) {
+        // Every field of the header is decoded from a single load of the word
+        const auto [method, subchannel, arg_count, mode] =
+            ExtractFields<decltype(CommandHeader::method), decltype(CommandHeader::subchannel),
+                          decltype(CommandHeader::arg_count), decltype(CommandHeader::mode)>(
+                command_list[index++]);
+
+        if (mode == SubmissionMode::Inline) {
+            // The inline data takes the place of the argument count
+            CallMethod(subchannel, method, arg_count, true);
+            continue;
+        }
+
+        // A header can't have more arguments than there are words left in the command list
+        const size_t num_args = std::min<size_t>(arg_count, command_list.size() - index);
+        const u32* const args = command_list.data() + index;
+        index += num_args;
+
+        // Methods are 13 bits wide, increasing ones wrap around like on hardware
+        const auto method_at = [method = method](size_t arg) {
+            return static_cast<u32>((method + arg) % GPU::NUM_METHODS);
+        };
+        const auto is_last = [num_args](size_t arg) { return arg + 1 == num_args; };
+
+        switch (mode) {
+        case SubmissionMode::IncreasingOld:
+        case SubmissionMode::Increasing:
+            for (size_t arg = 0; arg < num_args; ++arg) {
+                CallMethod(subchannel, method_at(arg), args[arg], is_last(arg));
+            }
+            break;
+        case SubmissionMode::NonIncreasingOld:
+        case SubmissionMode::NonIncreasing:
+            for (size_t arg = 0; arg < num_args; ++arg) {
+                CallMethod(subchannel, method, args[arg], is_last(arg));
+            }
+            break;
+        case SubmissionMode::IncreaseOnce:
+            for (size_t arg = 0; arg < num_args; ++arg) {
+                CallMethod(subchannel, method_at(std::min<size_t>(arg, 1)), args[arg],
+                           is_last(arg));
+            }
+            break;
+        default:
+            LOG_ERROR(HW_GPU, "Unknown submission mode %u in command list at 0x%llx",
+                      static_cast<u32>(mode), gpu_addr);
+            return;
+        }
+    }
+}
+
+} // namespace Tegra
@@ -0,0 +1,51 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <type_traits>
+#include "common/bit_field.h"
+#include "common/common_types.h"
+#include "video_core/memory_manager.h"
+
+namespace Tegra {
+
+/// Entry of a GPFIFO, pointing to a command list in GPU memory
+union CommandListHeader {
+    u64 raw;
+    BitField<0, 40, GPUVAddr> addr;
+    BitField<41, 1, u64> is_non_main;
+    /// Size of the command list, in words
+    BitField<42, 21, u64> size;
+};
+static_assert(sizeof(CommandListHeader) == 8, "CommandListHeader has incorrect size");
+static_assert(std::is_trivially_copyable<CommandListHeader>::value,
+              "CommandListHeader is not trivially copyable");
+
+/// How the arguments following a command header are written to the methods
+enum class SubmissionMode : u32 {
+    IncreasingOld = 0,
+    /// Each argument is written to the next method
+    Increasing = 1,
+    NonIncreasingOld = 2,
+    /// All the arguments are written to the same method
+    NonIncreasing = 3,
+    /// The argument is stored in the header itself
+    Inline = 4,
+    /// The first argument is written to the method, the others to the next one
+    IncreaseOnce = 5,
+};
+
+/// Header of a method call in a command list
+union CommandHeader {
+    u32 hex;
+    BitField<0, 13, u32> method;
+    BitField<13, 3, u32> subchannel;
+    BitField<16, 13, u32> arg_count;
+    BitField<16, 13, u32> inline_data;
+    BitField<29, 3, SubmissionMode> mode;
+};
+static_assert(sizeof(CommandHeader) == 4, "CommandHeader has incorrect size");
+
+} // namespace Tegra
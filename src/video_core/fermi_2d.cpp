@@ -0,0 +1,95 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <utility>
+#include "common/logging/log.h"
+#include "video_core/fermi_2d.h"
+
+namespace Tegra {
+
+using Regs = Fermi2DRegs;
+
+/// Returns the size of a pixel of a surface format, zero for the unknown formats
+static u32 BytesPerPixel(Regs::SurfaceFormat format) {
+    switch (format) {
+    case Regs::SurfaceFormat::RGBA32_FLOAT:
+    case Regs::SurfaceFormat::RGBA32_UINT:
+        return 16;
+    case Regs::SurfaceFormat::RGBA16_UNORM:
+    case Regs::SurfaceFormat::RGBA16_FLOAT:
+    case Regs::SurfaceFormat::RG32_FLOAT:
+        return 8;
+    case Regs::SurfaceFormat::BGRA8_UNORM:
+    case Regs::SurfaceFormat::BGRA8_SRGB:
+    case Regs::SurfaceFormat::RGB10_A2_UNORM:
+    case Regs::SurfaceFormat::RGBA8_UNORM:
+    case Regs::SurfaceFormat::RGBA8_SRGB:
+    case Regs::SurfaceFormat::RG16_FLOAT:
+    case Regs::SurfaceFormat::R11G11B10_FLOAT:
+    case Regs::SurfaceFormat::R32_FLOAT:
+        return 4;
+    case Regs::SurfaceFormat::B5G6R5_UNORM:
+    case Regs::SurfaceFormat::RG8_UNORM:
+    case Regs::SurfaceFormat::R16_FLOAT:
+        return 2;
+    case Regs::SurfaceFormat::R8_UNORM:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static CopySurface GetCopySurface(const Regs::Surface& surface) {
+    return {surface.Address(), surface.linear == 0, surface.pitch, surface.width,
+            1U << surface.block_height};
+}
+
+Fermi2D::Fermi2D(SurfaceCopyCallback copy_callback) : copy_callback(std::move(copy_callback)) {}
+
+Fermi2D::~Fermi2D() = default;
+
+void Fermi2D::WriteReg(u32 method, u32 value) {
+    if (method >= Regs::NUM_REGS) {
+        LOG_ERROR(HW_GPU, "Fermi 2D method 0x%X is out of the register file", method);
+        return;
+    }
+    regs.reg_array[method] = value;
+
+    if (method == FERMI2D_REG_INDEX(blit_src_y) + 1) {
+        Blit();
+    }
+}
+
+void Fermi2D::Blit() {
+    constexpr u64 ONE = 1ULL << 32;
+    if (regs.blit_du_dx != ONE || regs.blit_dv_dy != ONE) {
+        LOG_ERROR(HW_GPU, "Scaled blits are not implemented");
+        return;
+    }
+    if (regs.src.format != regs.dst.format) {
+        LOG_ERROR(HW_GPU, "Blits from format 0x%X to format 0x%X are not implemented",
+                  static_cast<u32>(regs.src.format), static_cast<u32>(regs.dst.format));
+        return;
+    }
+    const u32 bytes_per_pixel = BytesPerPixel(regs.dst.format);
+    if (bytes_per_pixel == 0) {
+        LOG_ERROR(HW_GPU, "Unknown surface format 0x%X", static_cast<u32>(regs.dst.format));
+        return;
+    }
+
+    // Without scaling, the source starts at a whole pixel
+    copy_callback({
+        GetCopySurface(regs.src),
+        GetCopySurface(regs.dst),
+        bytes_per_pixel,
+        static_cast<u32>(regs.blit_src_x >> 32),
+        static_cast<u32>(regs.blit_src_y >> 32),
+        regs.blit_dst_x,
+        regs.blit_dst_y,
+        regs.blit_dst_width,
+        regs.blit_dst_height,
+    });
+}
+
+} // namespace Tegra
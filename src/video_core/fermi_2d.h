@@ -0,0 +1,147 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include "common/bit_field.h"
+#include "common/common_funcs.h"
+#include "common/common_types.h"
+#include "video_core/memory_manager.h"
+#include "video_core/surface_copy.h"
+
+namespace Tegra {
+
+/// Register file of the Fermi 2D engine, as written by the methods called on it
+struct Fermi2DRegs {
+    static constexpr size_t NUM_REGS = 0x258;
+
+    /// Formats of the surfaces, the same as the ones of the render targets of the 3D engine
+    enum class SurfaceFormat : u32 {
+        RGBA32_FLOAT = 0xC0,
+        RGBA32_UINT = 0xC2,
+        RGBA16_UNORM = 0xC6,
+        RGBA16_FLOAT = 0xCA,
+        RG32_FLOAT = 0xCB,
+        BGRA8_UNORM = 0xCF,
+        BGRA8_SRGB = 0xD0,
+        RGB10_A2_UNORM = 0xD1,
+        RGBA8_UNORM = 0xD5,
+        RGBA8_SRGB = 0xD6,
+        RG16_FLOAT = 0xDE,
+        R11G11B10_FLOAT = 0xE0,
+        R32_FLOAT = 0xE5,
+        B5G6R5_UNORM = 0xE8,
+        RG8_UNORM = 0xEA,
+        R16_FLOAT = 0xF2,
+        R8_UNORM = 0xF3,
+    };
+
+    struct Surface {
+        SurfaceFormat format;
+        /// Whether the surface is pitch linear, rather than block-linear
+        u32 linear;
+        union {
+            u32 raw_block_config;
+            /// Dimensions of the blocks of a block-linear surface, as log2 of their GOB counts
+            BitField<0, 4, u32> block_width;
+            BitField<4, 4, u32> block_height;
+            BitField<8, 4, u32> block_depth;
+        };
+        u32 depth;
+        u32 layer;
+        u32 pitch;
+        u32 width;
+        u32 height;
+        u32 address_high;
+        u32 address_low;
+
+        GPUVAddr Address() const {
+            return (static_cast<GPUVAddr>(address_high) << 32) | address_low;
+        }
+    };
+
+    union {
+        struct {
+            INSERT_PADDING_WORDS(0x80);
+            Surface dst;
+            INSERT_PADDING_WORDS(0x2);
+            Surface src;
+            INSERT_PADDING_WORDS(0x18D);
+            union {
+                u32 raw;
+                BitField<0, 1, u32> origin;
+                BitField<4, 1, u32> filter;
+            } blit_control;
+            INSERT_PADDING_WORDS(0x8);
+            /// Rectangle of the destination the blit writes to, in pixels
+            u32 blit_dst_x;
+            u32 blit_dst_y;
+            u32 blit_dst_width;
+            u32 blit_dst_height;
+            /// Steps in the source for each pixel of the destination, in 32.32 fixed point
+            u64 blit_du_dx;
+            u64 blit_dv_dy;
+            /// Position in the source the blit starts at, in 32.32 fixed point. Writing the high
+            /// word of blit_src_y starts the blit.
+            u64 blit_src_x;
+            u64 blit_src_y;
+            INSERT_PADDING_WORDS(NUM_REGS - 0x238);
+        };
+        std::array<u32, NUM_REGS> reg_array;
+    };
+};
+static_assert(sizeof(Fermi2DRegs) == Fermi2DRegs::NUM_REGS * sizeof(u32),
+              "Fermi2DRegs has incorrect size");
+static_assert(std::is_trivially_copyable<Fermi2DRegs>::value,
+              "Fermi2DRegs is not trivially copyable");
+
+/// Index of a register in the register file, which is the method writing to it
+#define FERMI2D_REG_INDEX(field_name) (offsetof(Tegra::Fermi2DRegs, field_name) / sizeof(u32))
+
+#define ASSERT_REG_POSITION(field_name, position)                                                  \
+    static_assert(offsetof(Fermi2DRegs, field_name) == position * sizeof(u32),                     \
+                  "Field " #field_name " has invalid position")
+
+ASSERT_REG_POSITION(dst, 0x80);
+ASSERT_REG_POSITION(src, 0x8C);
+ASSERT_REG_POSITION(blit_control, 0x223);
+ASSERT_REG_POSITION(blit_dst_x, 0x22C);
+ASSERT_REG_POSITION(blit_du_dx, 0x230);
+ASSERT_REG_POSITION(blit_src_x, 0x234);
+ASSERT_REG_POSITION(blit_src_y, 0x236);
+
+#undef ASSERT_REG_POSITION
+
+/**
+ * The Fermi 2D engine, which blits rectangles between surfaces. Blits are handed to the copy
+ * callback as surface copies, only the ones that neither scale nor convert are supported.
+ */
+class Fermi2D final {
+public:
+    using Regs = Fermi2DRegs;
+
+    /// Engine class bound to a subchannel to call the methods of this engine
+    static constexpr u32 ENGINE_CLASS = 0x902D;
+
+    explicit Fermi2D(SurfaceCopyCallback copy_callback);
+    ~Fermi2D();
+
+    /// Writes a register, and starts a blit if it is the method starting one
+    void WriteReg(u32 method, u32 value);
+
+    const Regs& GetRegs() const {
+        return regs;
+    }
+
+private:
+    void Blit();
+
+    Regs regs{};
+    SurfaceCopyCallback copy_callback;
+};
+
+} // namespace Tegra
@@ -0,0 +1,154 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "common/math_util.h"
+#include "common/string_util.h"
+#include "video_core/frame_dumper.h"
+
+namespace VideoCore {
+
+FrameDumper::FrameDumper(const std::string& filename, u32 width, u32 height, u32 fps)
+    : width(width), height(height), file(filename, "wb") {
+    // Chroma subsampling needs even dimensions
+    ASSERT(width % 2 == 0 && height % 2 == 0);
+
+    if (!file.IsOpen()) {
+        LOG_ERROR(Render, "Couldn't open %s for dumping frames", filename.c_str());
+        return;
+    }
+
+    const std::string header =
+        Common::StringFromFormat("YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", width, height, fps);
+    file.WriteBytes(header.data(), header.size());
+
+    for (auto& buffer : buffers) {
+        buffer.resize(width * height * 4);
+        free_buffers.push_back(&buffer);
+    }
+    yuv.resize(width * height * 3 / 2);
+
+    thread = std::thread(&FrameDumper::EncodeLoop, this);
+    LOG_INFO(Render, "Dumping %ux%u frames to %s", width, height, filename.c_str());
+}
+
+FrameDumper::~FrameDumper() {
+    if (!thread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    submitted_cv.notify_one();
+    thread.join();
+
+    LOG_INFO(Render, "Dumped %llu frames, %llu were dropped",
+             static_cast<unsigned long long>(num_frames),
+             static_cast<unsigned long long>(num_dropped_frames));
+}
+
+std::vector<u8>* FrameDumper::AcquireBuffer() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free_buffers.empty()) {
+        ++num_dropped_frames;
+        return nullptr;
+    }
+
+    std::vector<u8>* buffer = free_buffers.front();
+    free_buffers.pop_front();
+    return buffer;
+}
+
+void FrameDumper::SubmitBuffer(std::vector<u8>* buffer) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        submitted_buffers.push_back(buffer);
+    }
+    submitted_cv.notify_one();
+}
+
+void FrameDumper::DropFrame() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++num_dropped_frames;
+}
+
+void FrameDumper::EncodeLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        // The queued frames are still written when stopping
+        submitted_cv.wait(lock, [this] { return stop || !submitted_buffers.empty(); });
+        if (submitted_buffers.empty()) {
+            return;
+        }
+
+        std::vector<u8>* buffer = submitted_buffers.front();
+        submitted_buffers.pop_front();
+
+        lock.unlock();
+        WriteFrame(*buffer);
+        lock.lock();
+
+        free_buffers.push_back(buffer);
+        ++num_frames;
+    }
+}
+
+/// Converts a full range RGB color to BT.601 luma and chroma
+static u8 ToY(int r, int g, int b) {
+    return static_cast<u8>((77 * r + 150 * g + 29 * b + 128) >> 8);
+}
+
+static u8 ToU(int r, int g, int b) {
+    const int u = ((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128;
+    return static_cast<u8>(MathUtil::Clamp(u, 0, 255));
+}
+
+static u8 ToV(int r, int g, int b) {
+    const int v = ((128 * r - 107 * g - 21 * b + 128) >> 8) + 128;
+    return static_cast<u8>(MathUtil::Clamp(v, 0, 255));
+}
+
+void FrameDumper::WriteFrame(const std::vector<u8>& rgba) {
+    u8* y_plane = yuv.data();
+    u8* u_plane = y_plane + width * height;
+    u8* v_plane = u_plane + width * height / 4;
+
+    // The rows are read back bottom-up, the video is stored top-down. Each chroma sample is the
+    // average of a 2x2 block of pixels.
+    for (u32 y = 0; y < height; y += 2) {
+        const u8* row0 = &rgba[(height - 1 - y) * width * 4];
+        const u8* row1 = row0 - width * 4;
+        u8* y_row0 = y_plane + y * width;
+        u8* y_row1 = y_row0 + width;
+        u8* u_row = u_plane + (y / 2) * (width / 2);
+        u8* v_row = v_plane + (y / 2) * (width / 2);
+
+        for (u32 x = 0; x < width; x += 2) {
+            const u8* p00 = row0 + x * 4;
+            const u8* p01 = p00 + 4;
+            const u8* p10 = row1 + x * 4;
+            const u8* p11 = p10 + 4;
+
+            y_row0[x] = ToY(p00[0], p00[1], p00[2]);
+            y_row0[x + 1] = ToY(p01[0], p01[1], p01[2]);
+            y_row1[x] = ToY(p10[0], p10[1], p10[2]);
+            y_row1[x + 1] = ToY(p11[0], p11[1], p11[2]);
+
+            const int r = (p00[0] + p01[0] + p10[0] + p11[0] + 2) / 4;
+            const int g = (p00[1] + p01[1] + p10[1] + p11[1] + 2) / 4;
+            const int b = (p00[2] + p01[2] + p10[2] + p11[2] + 2) / 4;
+            u_row[x / 2] = ToU(r, g, b);
+            v_row[x / 2] = ToV(r, g, b);
+        }
+    }
+
+    static const char frame_header[] = "FRAME\n";
+    file.WriteBytes(frame_header, sizeof(frame_header) - 1);
+    file.WriteBytes(yuv.data(), yuv.size());
+}
+
+} // namespace VideoCore
@@ -0,0 +1,81 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/common_types.h"
+#include "common/file_util.h"
+
+namespace VideoCore {
+
+/**
+ * Writes the presented frames to a YUV4MPEG2 video file, which most encoders and players read
+ * directly. The frames are converted and written on a thread of its own. The renderer never waits
+ * for it: when all the buffers are queued, frames are dropped and counted instead.
+ */
+class FrameDumper {
+public:
+    /// Number of frames that can be queued for the encoding thread
+    static constexpr size_t NUM_BUFFERS = 4;
+
+    FrameDumper(const std::string& filename, u32 width, u32 height, u32 fps);
+    /// Writes the queued frames and closes the file
+    ~FrameDumper();
+
+    bool IsOpen() const {
+        return file.IsOpen();
+    }
+
+    u32 GetWidth() const {
+        return width;
+    }
+
+    u32 GetHeight() const {
+        return height;
+    }
+
+    /**
+     * Returns a buffer to fill with the next frame, as width * height RGBA8 pixels with the bottom
+     * row first, the way OpenGL reads them back.
+     * @returns The buffer, or nullptr if the encoding thread is behind and the frame is dropped.
+     */
+    std::vector<u8>* AcquireBuffer();
+
+    /// Queues a buffer obtained from AcquireBuffer for encoding
+    void SubmitBuffer(std::vector<u8>* buffer);
+
+    /// Counts a frame the renderer dropped before reading it back
+    void DropFrame();
+
+private:
+    void EncodeLoop();
+    void WriteFrame(const std::vector<u8>& rgba);
+
+    u32 width;
+    u32 height;
+    FileUtil::IOFile file;
+
+    std::array<std::vector<u8>, NUM_BUFFERS> buffers;
+    /// Y, U and V planes of the frame being written, only used by the encoding thread
+    std::vector<u8> yuv;
+
+    std::mutex mutex;
+    std::condition_variable submitted_cv;
+    std::deque<std::vector<u8>*> free_buffers;
+    std::deque<std::vector<u8>*> submitted_buffers;
+    bool stop = false;
+    u64 num_frames = 0;
+    u64 num_dropped_frames = 0;
+
+    std::thread thread;
+};
+
+} // namespace VideoCore
@@ -0,0 +1,84 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "common/assert.h"
+#include "video_core/frame_queue.h"
+
+namespace VideoCore {
+
+FrameQueue::FrameQueue(size_t num_frames) : depth(num_frames) {
+    ASSERT(num_frames != 0);
+    for (size_t index = 0; index < num_frames; ++index) {
+        frames.push_back(std::make_unique<Frame>());
+        free_frames.push_back(frames.back().get());
+    }
+}
+
+Frame* FrameQueue::AcquireFreeFrame() {
+    std::unique_lock<std::mutex> lock(mutex);
+    free_cv.wait(lock, [this] {
+        return is_closed || (!free_frames.empty() && num_acquired_frames < depth);
+    });
+    if (is_closed) {
+        return nullptr;
+    }
+
+    Frame* frame = free_frames.front();
+    free_frames.pop_front();
+    ++num_acquired_frames;
+    return frame;
+}
+
+void FrameQueue::SubmitFrame(Frame* frame) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        submitted_frames.push_back(frame);
+    }
+    submitted_cv.notify_one();
+}
+
+Frame* FrameQueue::AcquirePresentFrame() {
+    std::unique_lock<std::mutex> lock(mutex);
+    submitted_cv.wait(lock, [this] { return is_closed || !submitted_frames.empty(); });
+    if (is_closed) {
+        return nullptr;
+    }
+
+    Frame* frame = submitted_frames.front();
+    submitted_frames.pop_front();
+    return frame;
+}
+
+void FrameQueue::ReleasePresentFrame(Frame* frame) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        free_frames.push_back(frame);
+        --num_acquired_frames;
+    }
+    free_cv.notify_one();
+}
+
+void FrameQueue::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_closed = true;
+    }
+    free_cv.notify_all();
+    submitted_cv.notify_all();
+}
+
+void FrameQueue::SetDepth(size_t num_frames) {
+    ASSERT(num_frames != 0);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (frames.size() < num_frames) {
+            frames.push_back(std::make_unique<Frame>());
+            free_frames.push_back(frames.back().get());
+        }
+        depth = num_frames;
+    }
+    free_cv.notify_all();
+}
+
+} // namespace VideoCore
@@ -0,0 +1,85 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "common/common_types.h"
+#include "video_core/renderer_base.h"
+
+namespace VideoCore {
+
+/**
+ * Contents of the layers of a frame, copied out of guest memory when the frame is submitted so
+ * that it can be presented while the emulation carries on with the next one.
+ */
+struct Frame {
+    struct Layer {
+        RendererBase::LayerInfo info;
+        /// Copy of the guest framebuffer if info.framebuffer is set, still in the guest layout
+        std::vector<u8> data;
+    };
+
+    std::vector<Layer> layers;
+    /// When the input the frame reacted to was sampled
+    std::chrono::high_resolution_clock::time_point input_time;
+};
+
+/**
+ * Bounded queue of frames between the thread submitting them and the thread presenting them.
+ * The frames are recycled, so that their buffers are only allocated once. When all the frames are
+ * queued, the submitting thread waits for one to be presented, which keeps the presentation at
+ * most num_frames frames behind the emulation.
+ */
+class FrameQueue {
+public:
+    explicit FrameQueue(size_t num_frames);
+
+    /**
+     * Returns a frame to fill for submission, waiting until one is available.
+     * @returns The frame, or nullptr if the queue has been closed.
+     */
+    Frame* AcquireFreeFrame();
+
+    /// Queues a frame obtained from AcquireFreeFrame for presentation
+    void SubmitFrame(Frame* frame);
+
+    /**
+     * Returns the oldest submitted frame, waiting until there is one.
+     * @returns The frame, or nullptr if the queue has been closed.
+     */
+    Frame* AcquirePresentFrame();
+
+    /// Returns a frame obtained from AcquirePresentFrame once it has been presented
+    void ReleasePresentFrame(Frame* frame);
+
+    /// Wakes up both threads and makes all further waits fail, dropping the queued frames
+    void Close();
+
+    /**
+     * Changes the number of frames the presentation may be behind. When it shrinks, the frames
+     * already acquired are kept, and the submitting thread waits until they are presented.
+     */
+    void SetDepth(size_t num_frames);
+
+private:
+    std::vector<std::unique_ptr<Frame>> frames;
+    /// Maximum number of frames acquired for submission and not presented yet
+    size_t depth;
+    size_t num_acquired_frames = 0;
+
+    std::mutex mutex;
+    std::condition_variable free_cv;
+    std::condition_variable submitted_cv;
+    std::deque<Frame*> free_frames;
+    std::deque<Frame*> submitted_frames;
+    bool is_closed = false;
+};
+
+} // namespace VideoCore
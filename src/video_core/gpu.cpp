@@ -0,0 +1,166 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "common/logging/log.h"
+#include "common/microprofile.h"
+#include "video_core/gpu.h"
+#include "video_core/renderer_base.h"
+#include "video_core/video_core.h"
+
+namespace Tegra {
+
+MICROPROFILE_DEFINE(GPU_SurfaceCopy, "GPU", "Surface copy", MP_RGB(192, 128, 160));
+
+GPU::GPU()
+    : fermi_2d([this](const SurfaceCopy& copy) { CopySurface(copy); }),
+      maxwell_dma([this](const SurfaceCopy& copy) { CopySurface(copy); }) {
+    gpu_thread = std::thread(&GPU::RunLoop, this);
+}
+
+GPU::~GPU() {
+    running = false;
+    wakeup_event.Set();
+    gpu_thread.join();
+}
+
+void GPU::PushCommandLists(std::vector<CommandListHeader> entries, u32 syncpoint_id) {
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        ++pushed_batches;
+    }
+    pending_batches.Push(CommandListBatch{std::move(entries), syncpoint_id});
+    wakeup_event.Set();
+}
+
+void GPU::WaitIdle() {
+    std::unique_lock<std::mutex> lock(idle_mutex);
+    idle_condition.wait(lock, [this] { return processed_batches == pushed_batches; });
+}
+
+u32 GPU::GetBoundEngine(u32 subchannel) const {
+    return bound_engines[subchannel].load(std::memory_order_relaxed);
+}
+
+u32 GPU::IncreaseSyncpointMax(u32 syncpoint_id, u32 amount) {
+    if (syncpoint_id >= NUM_SYNCPOINTS) {
+        LOG_ERROR(HW_GPU, "Invalid syncpoint %u", syncpoint_id);
+        return 0;
+    }
+    return syncpoint_max_values[syncpoint_id] += amount;
+}
+
+u32 GPU::GetSyncpointValue(u32 syncpoint_id) const {
+    if (syncpoint_id >= NUM_SYNCPOINTS) {
+        LOG_ERROR(HW_GPU, "Invalid syncpoint %u", syncpoint_id);
+        return 0;
+    }
+    return syncpoint_values[syncpoint_id].load(std::memory_order_acquire);
+}
+
+void GPU::IncrementSyncpoint(u32 syncpoint_id) {
+    if (syncpoint_id >= NUM_SYNCPOINTS) {
+        LOG_ERROR(HW_GPU, "Invalid syncpoint %u", syncpoint_id);
+        return;
+    }
+    const u32 value = syncpoint_values[syncpoint_id].fetch_add(1, std::memory_order_acq_rel) + 1;
+
+    std::lock_guard<std::mutex> lock(syncpoint_callback_mutex);
+    if (syncpoint_callback) {
+        syncpoint_callback(syncpoint_id, value);
+    }
+}
+
+void GPU::SetSyncpointCallback(SyncpointCallback callback) {
+    std::lock_guard<std::mutex> lock(syncpoint_callback_mutex);
+    syncpoint_callback = std::move(callback);
+}
+
+void GPU::RunLoop() {
+    MicroProfileOnThreadCreate("GpuThread");
+
+    CommandListBatch batch;
+    while (true) {
+        if (!pending_batches.Pop(batch)) {
+            // The batches pushed before stopping are still processed
+            if (!running) {
+                break;
+            }
+            wakeup_event.Wait();
+            continue;
+        }
+
+        for (const CommandListHeader& entry : batch.entries) {
+            ProcessCommandList(entry);
+        }
+        // The draws of a whole GPFIFO batch go to the renderer at once
+        SubmitDraws();
+        // The renderer executes the draws in order, waiting on the syncpoint orders the CPU
+        // after them as well
+        if (batch.syncpoint_id != NO_SYNCPOINT) {
+            IncrementSyncpoint(batch.syncpoint_id);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex);
+            ++processed_batches;
+        }
+        idle_condition.notify_all();
+    }
+
+#if MICROPROFILE_ENABLED
+    MicroProfileOnThreadExit();
+#endif
+}
+
+void GPU::CallMethod(u32 subchannel, u32 method, u32 argument, bool is_last_call) {
+    LOG_TRACE(HW_GPU, "Method 0x%X on subchannel %u, argument 0x%08X", method, subchannel,
+              argument);
+
+    if (method == BIND_OBJECT_METHOD) {
+        LOG_DEBUG(HW_GPU, "Binding engine class 0x%04X to subchannel %u", argument, subchannel);
+        bound_engines[subchannel].store(argument, std::memory_order_relaxed);
+    }
+    method_arguments[subchannel][method] = argument;
+    if (method == BIND_OBJECT_METHOD) {
+        return;
+    }
+
+    switch (bound_engines[subchannel].load(std::memory_order_relaxed)) {
+    case Maxwell3D::ENGINE_CLASS:
+        maxwell_3d.CallMethod(method, argument, is_last_call);
+        break;
+    case Fermi2D::ENGINE_CLASS:
+        fermi_2d.WriteReg(method, argument);
+        break;
+    case MaxwellDMA::ENGINE_CLASS:
+        maxwell_dma.WriteReg(method, argument);
+        break;
+    }
+}
+
+void GPU::SubmitDraws() {
+    Maxwell3DDrawBatch batch = maxwell_3d.TakeDrawBatch();
+    // Without a renderer, as when replaying a trace, the draws are only recorded
+    if (!batch.IsEmpty() && VideoCore::g_renderer != nullptr) {
+        VideoCore::g_renderer->SubmitDraws(std::move(batch));
+    }
+}
+
+void GPU::CopySurface(const SurfaceCopy& copy) {
+    MICROPROFILE_SCOPE(GPU_SurfaceCopy);
+
+    // The draws recorded before the copy are submitted first, so that the renderer executes them
+    // in order with it
+    SubmitDraws();
+    if (VideoCore::g_renderer != nullptr && VideoCore::g_renderer->AccelerateSurfaceCopy(copy)) {
+        return;
+    }
+    if (!CopySurfaceOnCPU(memory_manager, copy)) {
+        LOG_ERROR(HW_GPU, "Surface copy from 0x%llx to 0x%llx touches unmapped memory",
+                  static_cast<unsigned long long>(copy.src.address),
+                  static_cast<unsigned long long>(copy.dst.address));
+    }
+}
+
+} // namespace Tegra
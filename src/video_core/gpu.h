@@ -0,0 +1,145 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "common/common_types.h"
+#include "common/thread.h"
+#include "common/threadsafe_queue.h"
+#include "video_core/command_processor.h"
+#include "video_core/fermi_2d.h"
+#include "video_core/maxwell_3d.h"
+#include "video_core/maxwell_dma.h"
+#include "video_core/memory_manager.h"
+#include "video_core/surface_copy.h"
+
+namespace Tegra {
+
+/**
+ * Emulated GPU. The command lists submitted through GPFIFOs are processed in order on a dedicated
+ * host thread, so the emulation threads never wait for them.
+ */
+class GPU final {
+public:
+    /// Number of subchannels engines can be bound to
+    static constexpr size_t NUM_SUBCHANNELS = 8;
+    /// Number of methods addressable by a command header
+    static constexpr size_t NUM_METHODS = 0x2000;
+    /// Number of syncpoints, counters incremented as work completes that the CPU waits on
+    static constexpr u32 NUM_SYNCPOINTS = 192;
+    /// Passed instead of a syncpoint for the command lists whose completion isn't tracked
+    static constexpr u32 NO_SYNCPOINT = 0xFFFFFFFF;
+
+    /// Called with a syncpoint and its new value every time it is incremented
+    using SyncpointCallback = std::function<void(u32 syncpoint_id, u32 value)>;
+
+    GPU();
+    ~GPU();
+
+    /**
+     * Queues the entries of a GPFIFO for the GPU thread. Only one host thread may submit at a
+     * time, which the HLE lock ensures for the service handlers.
+     * @param syncpoint_id Syncpoint the GPU thread increments once it processed the entries.
+     */
+    void PushCommandLists(std::vector<CommandListHeader> entries,
+                          u32 syncpoint_id = NO_SYNCPOINT);
+
+    /// Blocks until the GPU thread processed all the command lists pushed so far
+    void WaitIdle();
+
+    /// Returns the engine class bound to a subchannel, zero if there is none
+    u32 GetBoundEngine(u32 subchannel) const;
+
+    MemoryManager& GetMemoryManager() {
+        return memory_manager;
+    }
+
+    /**
+     * Reserves increments of a syncpoint for work that is being submitted.
+     * @returns The value the syncpoint reaches once the work completed.
+     */
+    u32 IncreaseSyncpointMax(u32 syncpoint_id, u32 amount);
+
+    /// Returns the number of increments of a syncpoint that completed
+    u32 GetSyncpointValue(u32 syncpoint_id) const;
+
+    /// Increments a syncpoint and runs the syncpoint callback, may be called from any thread
+    void IncrementSyncpoint(u32 syncpoint_id);
+
+    /**
+     * Sets the function called when syncpoints are incremented. It mostly runs on the GPU thread,
+     * so it shouldn't do more than hand the syncpoint over to the thread waiting for it.
+     */
+    void SetSyncpointCallback(SyncpointCallback callback);
+
+private:
+    /// Body of the GPU thread
+    void RunLoop();
+    void ProcessCommandList(const CommandListHeader& entry);
+    /**
+     * Calls a method of the engine bound to a subchannel.
+     * @param is_last_call Whether it is the last argument the command header has for the method.
+     */
+    void CallMethod(u32 subchannel, u32 method, u32 argument, bool is_last_call);
+    /// Hands the draws recorded by the engines to the renderer
+    void SubmitDraws();
+    /**
+     * Executes a copy launched by the copy engines. The renderer does it on the host GPU if it has
+     * both surfaces there, otherwise they are copied in guest memory.
+     */
+    void CopySurface(const SurfaceCopy& copy);
+
+    MemoryManager memory_manager;
+    /// Engines, only accessed by the GPU thread
+    Maxwell3D maxwell_3d;
+    Fermi2D fermi_2d;
+    MaxwellDMA maxwell_dma;
+
+    /// Method binding an engine class to the subchannel it is called on
+    static constexpr u32 BIND_OBJECT_METHOD = 0;
+
+    /// Engine class bound to each subchannel
+    std::array<std::atomic<u32>, NUM_SUBCHANNELS> bound_engines{};
+    /// Last argument written to each method of each subchannel, only accessed by the GPU thread
+    std::vector<std::array<u32, NUM_METHODS>> method_arguments{NUM_SUBCHANNELS};
+    /// Words of the command list being processed, reused across command lists
+    std::vector<u32> command_list;
+
+    /// GPFIFO entries submitted together, and the syncpoint incremented once they are processed
+    struct CommandListBatch {
+        std::vector<CommandListHeader> entries;
+        u32 syncpoint_id = NO_SYNCPOINT;
+    };
+
+    /// Batches of GPFIFO entries waiting for the GPU thread
+    Common::SPSCQueue<CommandListBatch, false> pending_batches;
+    /// Set when batches are pushed or the thread has to stop
+    Common::Event wakeup_event;
+    std::atomic<bool> running{true};
+
+    /// Number of batches pushed and processed, used to wait for the GPU thread to be idle
+    u64 pushed_batches = 0;
+    u64 processed_batches = 0;
+    std::mutex idle_mutex;
+    std::condition_variable idle_condition;
+
+    /// Completed increments of each syncpoint
+    std::array<std::atomic<u32>, NUM_SYNCPOINTS> syncpoint_values{};
+    /// Reserved increments of each syncpoint, only accessed by the submitting thread
+    std::array<u32, NUM_SYNCPOINTS> syncpoint_max_values{};
+    SyncpointCallback syncpoint_callback;
+    std::mutex syncpoint_callback_mutex;
+
+    std::thread gpu_thread;
+};
+
+} // namespace Tegra
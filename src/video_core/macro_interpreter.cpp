@@ -0,0 +1,233 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "common/logging/log.h"
+#include "common/microprofile.h"
+#include "video_core/macro_interpreter.h"
+#include "video_core/maxwell_3d.h"
+
+namespace Tegra {
+
+using namespace Macro;
+
+u32 Macro::ComputeALU(ALUOperation operation, u32 src_a, u32 src_b, bool& carry_flag) {
+    switch (operation) {
+    case ALUOperation::Add: {
+        const u64 result = static_cast<u64>(src_a) + src_b;
+        carry_flag = result > 0xFFFFFFFF;
+        return static_cast<u32>(result);
+    }
+    case ALUOperation::AddWithCarry: {
+        const u64 result = static_cast<u64>(src_a) + src_b + (carry_flag ? 1 : 0);
+        carry_flag = result > 0xFFFFFFFF;
+        return static_cast<u32>(result);
+    }
+    case ALUOperation::Subtract: {
+        // The carry is set when the subtraction doesn't borrow
+        const u64 result = static_cast<u64>(src_a) - src_b;
+        carry_flag = result < 0x100000000;
+        return static_cast<u32>(result);
+    }
+    case ALUOperation::SubtractWithBorrow: {
+        const u64 result = static_cast<u64>(src_a) - src_b - (carry_flag ? 0 : 1);
+        carry_flag = result < 0x100000000;
+        return static_cast<u32>(result);
+    }
+    case ALUOperation::Xor:
+        return src_a ^ src_b;
+    case ALUOperation::Or:
+        return src_a | src_b;
+    case ALUOperation::And:
+        return src_a & src_b;
+    case ALUOperation::AndNot:
+        return src_a & ~src_b;
+    case ALUOperation::Nand:
+        return ~(src_a & src_b);
+    }
+    LOG_ERROR(HW_GPU, "Unknown macro ALU operation %u", static_cast<u32>(operation));
+    return 0;
+}
+
+MacroEngine::MacroEngine(Maxwell3D& maxwell_3d)
+    : maxwell_3d(maxwell_3d), macro_memory(maxwell_3d.GetMacroMemory()) {}
+
+MacroEngine::~MacroEngine() = default;
+
+u32 MacroEngine::FetchParameter() {
+    if (next_parameter >= parameters->size()) {
+        LOG_ERROR(HW_GPU, "Macro fetched more than the %zu parameters of its call",
+                  parameters->size());
+        return 0;
+    }
+    return (*parameters)[next_parameter++];
+}
+
+void MacroEngine::Send(u32 value) {
+    MethodAddress method_address{state.method_address};
+    maxwell_3d.WriteReg(method_address.address, value);
+    method_address.address.Assign(method_address.address + method_address.increment);
+    state.method_address = method_address.raw;
+}
+
+u32 MacroEngine::Read(u32 method) const {
+    return maxwell_3d.GetRegisterValue(method);
+}
+
+void MacroEngine::BeginCall(const std::vector<u32>& call_parameters) {
+    state = {};
+    state.registers[1] = call_parameters[0];
+    parameters = &call_parameters;
+    next_parameter = 1;
+}
+
+void MacroEngine::EndCall(u32 position) const {
+    if (next_parameter != parameters->size()) {
+        LOG_WARNING(HW_GPU, "Macro at 0x%X used %zu of the %zu parameters of its call", position,
+                    next_parameter, parameters->size());
+    }
+}
+
+MICROPROFILE_DEFINE(GPU_MacroInterpreter, "GPU", "Interpret macro", MP_RGB(128, 96, 192));
+
+MacroInterpreter::MacroInterpreter(Maxwell3D& maxwell_3d) : MacroEngine(maxwell_3d) {}
+
+void MacroInterpreter::Execute(u32 position, const std::vector<u32>& parameters) {
+    MICROPROFILE_SCOPE(GPU_MacroInterpreter);
+
+    BeginCall(parameters);
+    pc = position;
+    while (Step(false)) {
+    }
+    EndCall(position);
+}
+
+bool MacroInterpreter::Step(bool is_delay_slot) {
+    if (pc >= MACRO_MEMORY_SIZE) {
+        LOG_ERROR(HW_GPU, "Macro ran past the end of the macro memory");
+        return false;
+    }
+
+    const u32 base_pc = pc;
+    const Opcode opcode{macro_memory[pc++]};
+    if (is_delay_slot) {
+        pc = delayed_pc;
+    }
+
+    switch (opcode.operation) {
+    case Operation::ALU:
+        ProcessResult(opcode.result_operation, opcode.dst,
+                      ComputeALU(opcode.alu_operation, GetRegister(opcode.src_a),
+                                 GetRegister(opcode.src_b), state.carry_flag));
+        break;
+    case Operation::AddImmediate:
+        ProcessResult(opcode.result_operation, opcode.dst,
+                      GetRegister(opcode.src_a) + opcode.Immediate());
+        break;
+    case Operation::ExtractInsert: {
+        const u32 mask = opcode.BitfieldMask();
+        const u32 src = (GetRegister(opcode.src_b) >> opcode.bf_src_bit) & mask;
+        const u32 dst = GetRegister(opcode.src_a) & ~(mask << opcode.bf_dst_bit);
+        ProcessResult(opcode.result_operation, opcode.dst, dst | (src << opcode.bf_dst_bit));
+        break;
+    }
+    case Operation::ExtractShiftLeftImmediate: {
+        // Shift amounts taken from registers only use their low 5 bits, like on x86
+        const u32 shift = GetRegister(opcode.src_a) & 31;
+        const u32 src = (GetRegister(opcode.src_b) >> shift) & opcode.BitfieldMask();
+        ProcessResult(opcode.result_operation, opcode.dst, src << opcode.bf_dst_bit);
+        break;
+    }
+    case Operation::ExtractShiftLeftRegister: {
+        const u32 shift = GetRegister(opcode.src_a) & 31;
+        const u32 src = (GetRegister(opcode.src_b) >> opcode.bf_src_bit) & opcode.BitfieldMask();
+        ProcessResult(opcode.result_operation, opcode.dst, src << shift);
+        break;
+    }
+    case Operation::Read:
+        ProcessResult(opcode.result_operation, opcode.dst,
+                      Read(GetRegister(opcode.src_a) + opcode.Immediate()));
+        break;
+    case Operation::Branch: {
+        if (is_delay_slot) {
+            LOG_ERROR(HW_GPU, "Ignored macro branch in a delay slot at 0x%X", base_pc);
+            break;
+        }
+        const bool is_zero = GetRegister(opcode.src_a) == 0;
+        const bool is_taken = is_zero == (opcode.branch_condition == BranchCondition::Zero);
+        if (is_taken) {
+            const u32 target = base_pc + opcode.Immediate();
+            if (opcode.branch_annul) {
+                pc = target;
+                return true;
+            }
+            // The instruction after the branch is executed before it is taken
+            delayed_pc = target;
+            return Step(true);
+        }
+        break;
+    }
+    default:
+        LOG_ERROR(HW_GPU, "Unknown macro operation %u at 0x%X",
+                  static_cast<u32>(opcode.operation.Value()), base_pc);
+        break;
+    }
+
+    // Exits have a delay slot too, an exit in a delay slot is ignored
+    if (opcode.is_exit && !is_delay_slot) {
+        delayed_pc = pc;
+        Step(true);
+        return false;
+    }
+    return true;
+}
+
+u32 MacroInterpreter::GetRegister(u32 index) const {
+    return state.registers[index];
+}
+
+void MacroInterpreter::SetRegister(u32 index, u32 value) {
+    // Register 0 is hardwired to zero
+    if (index != 0) {
+        state.registers[index] = value;
+    }
+}
+
+void MacroInterpreter::ProcessResult(ResultOperation operation, u32 dst, u32 result) {
+    switch (operation) {
+    case ResultOperation::IgnoreAndFetch:
+        SetRegister(dst, FetchParameter());
+        break;
+    case ResultOperation::Move:
+        SetRegister(dst, result);
+        break;
+    case ResultOperation::MoveAndSetMethod:
+        SetRegister(dst, result);
+        state.method_address = result;
+        break;
+    case ResultOperation::FetchAndSend:
+        SetRegister(dst, FetchParameter());
+        Send(result);
+        break;
+    case ResultOperation::MoveAndSend:
+        SetRegister(dst, result);
+        Send(result);
+        break;
+    case ResultOperation::FetchAndSetMethod:
+        SetRegister(dst, FetchParameter());
+        state.method_address = result;
+        break;
+    case ResultOperation::MoveAndSetMethodFetchAndSend:
+        SetRegister(dst, result);
+        state.method_address = result;
+        Send(FetchParameter());
+        break;
+    case ResultOperation::MoveAndSetMethodSend:
+        SetRegister(dst, result);
+        state.method_address = result >> 12;
+        Send((result >> 12) & 0x3F);
+        break;
+    }
+}
+
+} // namespace Tegra
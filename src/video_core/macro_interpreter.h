@@ -0,0 +1,176 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include "common/bit_field.h"
+#include "common/common_types.h"
+
+namespace Tegra {
+
+class Maxwell3D;
+
+/**
+ * Macros are programs the guest uploads to the macro memory of the Maxwell 3D engine, and calls
+ * through the methods past its register file. They read their parameters from the call, and
+ * write to the registers of the engine, so that a single call sets up the state of a draw.
+ */
+namespace Macro {
+
+/// Size of the macro memory, in words
+constexpr size_t MACRO_MEMORY_SIZE = 0x800;
+constexpr size_t NUM_REGISTERS = 8;
+
+enum class Operation : u32 {
+    ALU = 0,
+    AddImmediate = 1,
+    ExtractInsert = 2,
+    ExtractShiftLeftImmediate = 3,
+    ExtractShiftLeftRegister = 4,
+    Read = 5,
+    Unused = 6,
+    Branch = 7,
+};
+
+enum class ALUOperation : u32 {
+    Add = 0,
+    AddWithCarry = 1,
+    Subtract = 2,
+    SubtractWithBorrow = 3,
+    Xor = 8,
+    Or = 9,
+    And = 10,
+    AndNot = 11,
+    Nand = 12,
+};
+
+/// What is done with the result of an operation, and with the next parameter
+enum class ResultOperation : u32 {
+    IgnoreAndFetch = 0,
+    Move = 1,
+    MoveAndSetMethod = 2,
+    FetchAndSend = 3,
+    MoveAndSend = 4,
+    FetchAndSetMethod = 5,
+    MoveAndSetMethodFetchAndSend = 6,
+    MoveAndSetMethodSend = 7,
+};
+
+enum class BranchCondition : u32 {
+    Zero = 0,
+    NotZero = 1,
+};
+
+union Opcode {
+    u32 raw;
+    BitField<0, 3, Operation> operation;
+    BitField<4, 3, ResultOperation> result_operation;
+    BitField<4, 1, BranchCondition> branch_condition;
+    /// Whether a taken branch skips its delay slot
+    BitField<5, 1, u32> branch_annul;
+    /// Ends the macro once the instruction in the delay slot is executed
+    BitField<7, 1, u32> is_exit;
+    BitField<8, 3, u32> dst;
+    BitField<11, 3, u32> src_a;
+    BitField<14, 3, u32> src_b;
+    BitField<17, 5, ALUOperation> alu_operation;
+    BitField<17, 5, u32> bf_src_bit;
+    BitField<22, 5, u32> bf_size;
+    BitField<27, 5, u32> bf_dst_bit;
+
+    /// Signed immediate, in the bits following src_a
+    s32 Immediate() const {
+        return static_cast<s32>(raw) >> 14;
+    }
+
+    u32 BitfieldMask() const {
+        return (1U << bf_size) - 1;
+    }
+};
+static_assert(sizeof(Opcode) == 4, "Opcode has incorrect size");
+
+/// Method the macro writes to, moved on by the increment after every write
+union MethodAddress {
+    u32 raw;
+    BitField<0, 12, u32> address;
+    BitField<12, 6, u32> increment;
+};
+
+/// Registers of a macro being executed. Register 0 always reads as zero.
+struct State {
+    std::array<u32, NUM_REGISTERS> registers;
+    u32 method_address;
+    bool carry_flag;
+};
+
+/// Result of an ALU operation, which updates the carry flag for the additions and subtractions
+u32 ComputeALU(ALUOperation operation, u32 src_a, u32 src_b, bool& carry_flag);
+
+} // namespace Macro
+
+/// Executes the macros uploaded to the Maxwell 3D engine
+class MacroEngine {
+public:
+    explicit MacroEngine(Maxwell3D& maxwell_3d);
+    virtual ~MacroEngine();
+
+    /**
+     * Runs the macro starting at a position of the macro memory.
+     * @param parameters Parameters of the call, there is at least one.
+     */
+    virtual void Execute(u32 position, const std::vector<u32>& parameters) = 0;
+
+    /// Called when the macro memory is written to
+    virtual void ClearCode() {}
+
+    // Operations of the macros on the engine, shared by the implementations
+
+    /// Returns the next parameter of the call, zero once they were all fetched
+    u32 FetchParameter();
+    /// Writes to the method selected by the method address, and moves the address on
+    void Send(u32 value);
+    /// Reads a register of the engine
+    u32 Read(u32 method) const;
+
+protected:
+    /// Sets up the state for a call, with the first parameter in register 1
+    void BeginCall(const std::vector<u32>& parameters);
+    /// Checks that the macro consumed the parameters of the call
+    void EndCall(u32 position) const;
+
+    Maxwell3D& maxwell_3d;
+    const std::array<u32, Macro::MACRO_MEMORY_SIZE>& macro_memory;
+    Macro::State state{};
+
+private:
+    const std::vector<u32>* parameters = nullptr;
+    size_t next_parameter = 0;
+};
+
+/// Interprets the macros an instruction at a time
+class MacroInterpreter final : public MacroEngine {
+public:
+    explicit MacroInterpreter(Maxwell3D& maxwell_3d);
+
+    void Execute(u32 position, const std::vector<u32>& parameters) override;
+
+private:
+    /**
+     * Executes the instruction at the program counter.
+     * @returns False if the macro ended.
+     */
+    bool Step(bool is_delay_slot);
+    u32 GetRegister(u32 index) const;
+    void SetRegister(u32 index, u32 value);
+    void ProcessResult(Macro::ResultOperation operation, u32 dst, u32 result);
+
+    /// Index in the macro memory of the next instruction
+    u32 pc = 0;
+    /// Target of the branch whose delay slot is being executed
+    u32 delayed_pc = 0;
+};
+
+} // namespace Tegra
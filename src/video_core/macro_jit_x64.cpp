@@ -0,0 +1,414 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstddef>
+#include <xbyak.h>
+#include "common/hash.h"
+#include "common/logging/log.h"
+#include "common/microprofile.h"
+#include "common/x64/xbyak_abi.h"
+#include "common/x64/xbyak_util.h"
+#include "video_core/macro_jit_x64.h"
+
+namespace Tegra {
+
+using namespace Macro;
+using namespace Common::X64;
+using namespace Xbyak::util;
+
+namespace {
+
+/// Register holding the MacroEngine the macro runs on
+const Xbyak::Reg64 ENGINE = rbp;
+/// Register holding the Macro::State of the call
+const Xbyak::Reg64 STATE = rbx;
+/// Register keeping the result of an instruction across the calls to the engine
+const Xbyak::Reg32 RESULT = r12d;
+const BitSet32 SAVED_REGISTERS = BuildRegSet({ENGINE, STATE, RESULT.cvt64()});
+
+u32 FetchParameterThunk(MacroEngine* engine) {
+    return engine->FetchParameter();
+}
+
+void SendThunk(MacroEngine* engine, u32 value) {
+    engine->Send(value);
+}
+
+u32 ReadThunk(MacroEngine* engine, u32 method) {
+    return engine->Read(method);
+}
+
+/**
+ * Finds the instructions a macro can run, by following its branches from its entry.
+ * @returns Indices of the instructions in the macro memory, in increasing order.
+ */
+std::vector<u32> FindInstructions(const std::array<u32, MACRO_MEMORY_SIZE>& memory, u32 entry) {
+    std::vector<bool> is_reached(MACRO_MEMORY_SIZE);
+    std::vector<u32> instructions;
+    std::vector<u32> pending{entry};
+    const auto reach = [&](s64 index) {
+        if (index >= 0 && index < static_cast<s64>(MACRO_MEMORY_SIZE)) {
+            pending.push_back(static_cast<u32>(index));
+        }
+    };
+
+    while (!pending.empty()) {
+        const u32 index = pending.back();
+        pending.pop_back();
+        if (index >= MACRO_MEMORY_SIZE || is_reached[index]) {
+            continue;
+        }
+        is_reached[index] = true;
+        instructions.push_back(index);
+
+        const Opcode opcode{memory[index]};
+        if (opcode.operation == Operation::Branch) {
+            reach(static_cast<s64>(index) + opcode.Immediate());
+        }
+        // Exits end the macro once their delay slot, compiled along with them, is executed
+        if (!opcode.is_exit) {
+            reach(static_cast<s64>(index) + 1);
+        }
+    }
+
+    std::sort(instructions.begin(), instructions.end());
+    return instructions;
+}
+
+} // Anonymous namespace
+
+/// x64 code of a macro, called with the engine and the state of the call
+class MacroJitX64::CompiledMacro : public Xbyak::CodeGenerator {
+public:
+    using Program = void (*)(MacroEngine* engine, State* state);
+
+    CompiledMacro(const std::array<u32, MACRO_MEMORY_SIZE>& memory, u32 entry,
+                  const std::vector<u32>& instructions);
+
+    void Run(MacroEngine* engine, State* state) const {
+        program(engine, state);
+    }
+
+private:
+    void CompileInstruction(u32 index);
+    void CompileBranch(u32 index, Opcode opcode);
+    /// Compiles the instruction after a branch or an exit, in which branches and exits are ignored
+    void CompileDelaySlot(u32 index);
+    void CompileALU(Opcode opcode);
+    void CompileResult(ResultOperation operation, u32 dst);
+    void JumpTo(s64 index);
+
+    void LoadRegister(const Xbyak::Reg32& dst, u32 index);
+    void StoreRegister(u32 index, const Xbyak::Reg32& src);
+    /// Leaves the parameter in eax
+    void CallFetchParameter();
+    void CallSend(const Xbyak::Reg32& value);
+
+    const std::array<u32, MACRO_MEMORY_SIZE>& memory;
+    std::vector<Xbyak::Label> labels;
+    Xbyak::Label end_label;
+    Program program;
+};
+
+MacroJitX64::CompiledMacro::CompiledMacro(const std::array<u32, MACRO_MEMORY_SIZE>& memory,
+                                          u32 entry, const std::vector<u32>& instructions)
+    : Xbyak::CodeGenerator(0x1000 + instructions.size() * 0x200), memory(memory),
+      labels(MACRO_MEMORY_SIZE) {
+    ABI_PushRegistersAndAdjustStack(*this, SAVED_REGISTERS, 8);
+    mov(ENGINE, ABI_PARAM1);
+    mov(STATE, ABI_PARAM2);
+    if (instructions.empty() || instructions.front() != entry) {
+        JumpTo(entry);
+    }
+
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        const u32 index = instructions[i];
+        const Opcode opcode{memory[index]};
+        L(labels[index]);
+
+        if (opcode.operation == Operation::Branch) {
+            CompileBranch(index, opcode);
+        } else {
+            CompileInstruction(index);
+        }
+
+        if (opcode.is_exit) {
+            CompileDelaySlot(index + 1);
+            jmp(end_label, T_NEAR);
+        } else if (i + 1 == instructions.size() || instructions[i + 1] != index + 1) {
+            JumpTo(static_cast<s64>(index) + 1);
+        }
+    }
+
+    L(end_label);
+    ABI_PopRegistersAndAdjustStack(*this, SAVED_REGISTERS, 8);
+    ret();
+
+    program = getCode<Program>();
+}
+
+void MacroJitX64::CompiledMacro::CompileInstruction(u32 index) {
+    const Opcode opcode{memory[index]};
+    switch (opcode.operation) {
+    case Operation::ALU:
+        CompileALU(opcode);
+        break;
+    case Operation::AddImmediate:
+        LoadRegister(eax, opcode.src_a);
+        add(eax, opcode.Immediate());
+        break;
+    case Operation::ExtractInsert: {
+        const u32 mask = opcode.BitfieldMask();
+        LoadRegister(eax, opcode.src_b);
+        shr(eax, static_cast<int>(opcode.bf_src_bit));
+        and_(eax, mask);
+        shl(eax, static_cast<int>(opcode.bf_dst_bit));
+        LoadRegister(ecx, opcode.src_a);
+        and_(ecx, ~(mask << opcode.bf_dst_bit));
+        or_(eax, ecx);
+        break;
+    }
+    case Operation::ExtractShiftLeftImmediate:
+        // Shifts by cl use the low 5 bits of the register, like the interpreter
+        LoadRegister(ecx, opcode.src_a);
+        LoadRegister(eax, opcode.src_b);
+        shr(eax, cl);
+        and_(eax, opcode.BitfieldMask());
+        shl(eax, static_cast<int>(opcode.bf_dst_bit));
+        break;
+    case Operation::ExtractShiftLeftRegister:
+        LoadRegister(eax, opcode.src_b);
+        shr(eax, static_cast<int>(opcode.bf_src_bit));
+        and_(eax, opcode.BitfieldMask());
+        LoadRegister(ecx, opcode.src_a);
+        shl(eax, cl);
+        break;
+    case Operation::Read:
+        LoadRegister(ABI_PARAM2.cvt32(), opcode.src_a);
+        add(ABI_PARAM2.cvt32(), opcode.Immediate());
+        mov(ABI_PARAM1, ENGINE);
+        CallFarFunction(*this, &ReadThunk);
+        break;
+    case Operation::Branch:
+        LOG_ERROR(HW_GPU, "Ignored macro branch in a delay slot at 0x%X", index);
+        return;
+    default:
+        LOG_ERROR(HW_GPU, "Unknown macro operation %u at 0x%X",
+                  static_cast<u32>(opcode.operation.Value()), index);
+        return;
+    }
+    CompileResult(opcode.result_operation, opcode.dst);
+}
+
+void MacroJitX64::CompiledMacro::CompileBranch(u32 index, Opcode opcode) {
+    Xbyak::Label not_taken;
+    LoadRegister(eax, opcode.src_a);
+    test(eax, eax);
+    if (opcode.branch_condition == BranchCondition::Zero) {
+        jnz(not_taken, T_NEAR);
+    } else {
+        jz(not_taken, T_NEAR);
+    }
+    if (!opcode.branch_annul) {
+        CompileDelaySlot(index + 1);
+    }
+    JumpTo(static_cast<s64>(index) + opcode.Immediate());
+    L(not_taken);
+}
+
+void MacroJitX64::CompiledMacro::CompileDelaySlot(u32 index) {
+    if (index >= MACRO_MEMORY_SIZE) {
+        jmp(end_label, T_NEAR);
+        return;
+    }
+    CompileInstruction(index);
+}
+
+void MacroJitX64::CompiledMacro::CompileALU(Opcode opcode) {
+    const ALUOperation operation = opcode.alu_operation;
+    // Both operands are loaded before the flags are set
+    LoadRegister(eax, opcode.src_a);
+    LoadRegister(edx, opcode.src_b);
+    const auto carry_flag = byte[STATE + offsetof(State, carry_flag)];
+    switch (operation) {
+    case ALUOperation::Add:
+        add(eax, edx);
+        setc(carry_flag);
+        break;
+    case ALUOperation::AddWithCarry:
+        movzx(ecx, carry_flag);
+        bt(ecx, 0);
+        adc(eax, edx);
+        setc(carry_flag);
+        break;
+    case ALUOperation::Subtract:
+        // The carry is set when the subtraction doesn't borrow, the opposite of x86
+        sub(eax, edx);
+        setnc(carry_flag);
+        break;
+    case ALUOperation::SubtractWithBorrow:
+        // Sets the x86 carry to the borrow, the inverse of the macro carry
+        cmp(carry_flag, 1);
+        sbb(eax, edx);
+        setnc(carry_flag);
+        break;
+    case ALUOperation::Xor:
+        xor_(eax, edx);
+        break;
+    case ALUOperation::Or:
+        or_(eax, edx);
+        break;
+    case ALUOperation::And:
+        and_(eax, edx);
+        break;
+    case ALUOperation::AndNot:
+        not_(edx);
+        and_(eax, edx);
+        break;
+    case ALUOperation::Nand:
+        and_(eax, edx);
+        not_(eax);
+        break;
+    default:
+        LOG_ERROR(HW_GPU, "Unknown macro ALU operation %u", static_cast<u32>(operation));
+        xor_(eax, eax);
+        break;
+    }
+}
+
+void MacroJitX64::CompiledMacro::CompileResult(ResultOperation operation, u32 dst) {
+    const auto method_address = dword[STATE + offsetof(State, method_address)];
+    mov(RESULT, eax);
+    switch (operation) {
+    case ResultOperation::IgnoreAndFetch:
+        CallFetchParameter();
+        StoreRegister(dst, eax);
+        break;
+    case ResultOperation::Move:
+        StoreRegister(dst, RESULT);
+        break;
+    case ResultOperation::MoveAndSetMethod:
+        StoreRegister(dst, RESULT);
+        mov(method_address, RESULT);
+        break;
+    case ResultOperation::FetchAndSend:
+        CallFetchParameter();
+        StoreRegister(dst, eax);
+        CallSend(RESULT);
+        break;
+    case ResultOperation::MoveAndSend:
+        StoreRegister(dst, RESULT);
+        CallSend(RESULT);
+        break;
+    case ResultOperation::FetchAndSetMethod:
+        CallFetchParameter();
+        StoreRegister(dst, eax);
+        mov(method_address, RESULT);
+        break;
+    case ResultOperation::MoveAndSetMethodFetchAndSend:
+        StoreRegister(dst, RESULT);
+        mov(method_address, RESULT);
+        CallFetchParameter();
+        CallSend(eax);
+        break;
+    case ResultOperation::MoveAndSetMethodSend:
+        StoreRegister(dst, RESULT);
+        mov(eax, RESULT);
+        shr(eax, 12);
+        mov(method_address, eax);
+        and_(eax, 0x3F);
+        CallSend(eax);
+        break;
+    }
+}
+
+void MacroJitX64::CompiledMacro::JumpTo(s64 index) {
+    if (index < 0 || index >= static_cast<s64>(MACRO_MEMORY_SIZE)) {
+        LOG_WARNING(HW_GPU, "Macro can run past the end of the macro memory");
+        jmp(end_label, T_NEAR);
+        return;
+    }
+    jmp(labels[static_cast<size_t>(index)], T_NEAR);
+}
+
+void MacroJitX64::CompiledMacro::LoadRegister(const Xbyak::Reg32& dst, u32 index) {
+    // Register 0 is hardwired to zero
+    if (index == 0) {
+        xor_(dst, dst);
+        return;
+    }
+    mov(dst, dword[STATE + offsetof(State, registers) + index * sizeof(u32)]);
+}
+
+void MacroJitX64::CompiledMacro::StoreRegister(u32 index, const Xbyak::Reg32& src) {
+    if (index != 0) {
+        mov(dword[STATE + offsetof(State, registers) + index * sizeof(u32)], src);
+    }
+}
+
+void MacroJitX64::CompiledMacro::CallFetchParameter() {
+    mov(ABI_PARAM1, ENGINE);
+    CallFarFunction(*this, &FetchParameterThunk);
+}
+
+void MacroJitX64::CompiledMacro::CallSend(const Xbyak::Reg32& value) {
+    mov(ABI_PARAM2.cvt32(), value);
+    mov(ABI_PARAM1, ENGINE);
+    CallFarFunction(*this, &SendThunk);
+}
+
+MICROPROFILE_DEFINE(GPU_MacroJit, "GPU", "Execute compiled macro", MP_RGB(160, 96, 192));
+MICROPROFILE_DEFINE(GPU_MacroJitCompile, "GPU", "Compile macro", MP_RGB(192, 96, 160));
+
+MacroJitX64::MacroJitX64(Maxwell3D& maxwell_3d) : MacroEngine(maxwell_3d) {}
+
+MacroJitX64::~MacroJitX64() = default;
+
+void MacroJitX64::Execute(u32 position, const std::vector<u32>& parameters) {
+    MICROPROFILE_SCOPE(GPU_MacroJit);
+
+    if (is_code_modified) {
+        position_cache.clear();
+        is_code_modified = false;
+    }
+    const CompiledMacro*& compiled = position_cache[position];
+    if (compiled == nullptr) {
+        compiled = Compile(position);
+    }
+
+    BeginCall(parameters);
+    compiled->Run(this, &state);
+    EndCall(position);
+}
+
+void MacroJitX64::ClearCode() {
+    // Macros are uploaded a word at a time, the positions are only looked up again on the next
+    // call
+    is_code_modified = true;
+}
+
+const MacroJitX64::CompiledMacro* MacroJitX64::Compile(u32 position) {
+    const std::vector<u32> instructions = FindInstructions(macro_memory, position);
+
+    // The code only depends on the words from the first instruction to the delay slot of the last
+    // one, and on the entry of the macro
+    std::vector<u32> key{position};
+    if (!instructions.empty()) {
+        const u32 first = instructions.front();
+        const u32 last = std::min<u32>(instructions.back() + 1, MACRO_MEMORY_SIZE - 1);
+        key.push_back(first);
+        key.insert(key.end(), macro_memory.begin() + first, macro_memory.begin() + last + 1);
+    }
+    const u64 hash = Common::ComputeHash64(key.data(), key.size() * sizeof(u32));
+
+    std::unique_ptr<CompiledMacro>& compiled = macro_cache[hash];
+    if (compiled == nullptr) {
+        MICROPROFILE_SCOPE(GPU_MacroJitCompile);
+        compiled = std::make_unique<CompiledMacro>(macro_memory, position, instructions);
+    }
+    return compiled.get();
+}
+
+} // namespace Tegra
@@ -0,0 +1,46 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "common/common_types.h"
+#include "video_core/macro_interpreter.h"
+
+namespace Tegra {
+
+/**
+ * Compiles the macros to x64 code the first time they are called. Games call the same few
+ * macros for every draw, so the compiled code is looked up by the position of the macro, and
+ * by a hash of its code once the macro memory is written to.
+ */
+class MacroJitX64 final : public MacroEngine {
+public:
+    explicit MacroJitX64(Maxwell3D& maxwell_3d);
+    ~MacroJitX64() override;
+
+    void Execute(u32 position, const std::vector<u32>& parameters) override;
+    void ClearCode() override;
+
+    /// Number of different macros compiled so far
+    size_t GetNumCompiledMacros() const {
+        return macro_cache.size();
+    }
+
+private:
+    class CompiledMacro;
+
+    const CompiledMacro* Compile(u32 position);
+
+    /// Compiled macros by the hash of their code, kept when the macro memory is written to so
+    /// that macros uploaded again aren't compiled again
+    std::unordered_map<u64, std::unique_ptr<CompiledMacro>> macro_cache;
+    /// Compiled macro starting at each position, cleared when the macro memory is written to
+    std::unordered_map<u32, const CompiledMacro*> position_cache;
+    bool is_code_modified = false;
+};
+
+} // namespace Tegra
@@ -0,0 +1,215 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include "common/logging/log.h"
+#include "common/microprofile.h"
+#include "video_core/maxwell_3d.h"
+#ifdef ARCHITECTURE_x86_64
+#include "video_core/macro_jit_x64.h"
+#endif
+
+namespace Tegra {
+
+using Regs = Maxwell3DRegs;
+using StateGroup = Maxwell3DStateGroup;
+
+namespace {
+
+/// Group of the registers the draw state doesn't depend on
+constexpr u8 NO_GROUP = 0xFF;
+
+/// First register and number of registers of a field of the register file
+#define REG_RANGE(field_name)                                                                      \
+    MAXWELL3D_REG_INDEX(field_name), sizeof(Regs::field_name) / sizeof(u32)
+
+std::array<u8, Regs::NUM_REGS> BuildRegisterGroups() {
+    std::array<u8, Regs::NUM_REGS> groups;
+    groups.fill(NO_GROUP);
+    const auto set_group = [&groups](size_t first, size_t count, StateGroup group) {
+        std::fill_n(groups.begin() + first, count, static_cast<u8>(group));
+    };
+
+    set_group(REG_RANGE(rt), StateGroup::RenderTargets);
+    set_group(REG_RANGE(viewport_transform), StateGroup::Viewports);
+    set_group(REG_RANGE(viewport), StateGroup::Viewports);
+    set_group(REG_RANGE(vertex_array), StateGroup::VertexArrays);
+    set_group(REG_RANGE(depth_test_enable), StateGroup::Depth);
+    set_group(REG_RANGE(depth_write_enabled), StateGroup::Depth);
+    set_group(REG_RANGE(depth_test_func), StateGroup::Depth);
+    set_group(REG_RANGE(stencil_enable), StateGroup::Stencil);
+    set_group(REG_RANGE(blend_color), StateGroup::Blend);
+    set_group(REG_RANGE(blend), StateGroup::Blend);
+    set_group(REG_RANGE(cull), StateGroup::Cull);
+    return groups;
+}
+
+#undef REG_RANGE
+
+/// Group of each register, looked up on every register write
+const std::array<u8, Regs::NUM_REGS> register_groups = BuildRegisterGroups();
+
+/// Whether consecutive draws of the topology can be merged into a single one
+bool IsListTopology(Regs::PrimitiveTopology topology) {
+    switch (topology) {
+    case Regs::PrimitiveTopology::Points:
+    case Regs::PrimitiveTopology::Lines:
+    case Regs::PrimitiveTopology::Triangles:
+    case Regs::PrimitiveTopology::Quads:
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // Anonymous namespace
+
+MICROPROFILE_DEFINE(GPU_Maxwell3DDraw, "GPU", "Record Maxwell 3D draw", MP_RGB(128, 160, 192));
+
+Maxwell3D::Maxwell3D(bool use_macro_jit)
+    : dirty_groups(BitSet32::AllTrue(static_cast<size_t>(StateGroup::NumGroups))) {
+#ifdef ARCHITECTURE_x86_64
+    if (use_macro_jit) {
+        macro_engine = std::make_unique<MacroJitX64>(*this);
+        return;
+    }
+#endif
+    macro_engine = std::make_unique<MacroInterpreter>(*this);
+}
+
+Maxwell3D::~Maxwell3D() = default;
+
+void Maxwell3D::CallMethod(u32 method, u32 value, bool is_last_call) {
+    if (method < MACRO_REGISTERS_START) {
+        WriteReg(method, value);
+        return;
+    }
+
+    // A macro is called with its first parameter written to its even method, the others are
+    // written to the odd one
+    if (executing_macro == 0) {
+        if ((method - MACRO_REGISTERS_START) % 2 != 0) {
+            LOG_ERROR(HW_GPU, "Macro parameter written to 0x%X outside of a call", method);
+            return;
+        }
+        executing_macro = method;
+    }
+    macro_parameters.push_back(value);
+    if (is_last_call) {
+        CallMacro();
+    }
+}
+
+void Maxwell3D::WriteReg(u32 method, u32 value) {
+    if (method >= Regs::NUM_REGS) {
+        LOG_ERROR(HW_GPU, "Maxwell 3D method 0x%X is out of the register file", method);
+        return;
+    }
+
+    // Drivers set the whole state for every draw, most writes leave the registers as they were
+    if (regs.reg_array[method] != value) {
+        regs.reg_array[method] = value;
+        const u8 group = register_groups[method];
+        if (group != NO_GROUP) {
+            dirty_groups[group] = true;
+        }
+    }
+
+    switch (method) {
+    case MAXWELL3D_REG_INDEX(draw_end):
+        RecordDraw();
+        break;
+    case MAXWELL3D_REG_INDEX(macros.data):
+        UploadMacroWord(value);
+        break;
+    case MAXWELL3D_REG_INDEX(macros.bind):
+        BindMacro(value);
+        break;
+    }
+}
+
+Maxwell3DDrawBatch Maxwell3D::TakeDrawBatch() {
+    Maxwell3DDrawBatch taken = std::move(batch);
+    batch = {};
+    return taken;
+}
+
+void Maxwell3D::RecordDraw() {
+    MICROPROFILE_SCOPE(GPU_Maxwell3DDraw);
+
+    const u32 first = regs.vertex_buffer.first;
+    const u32 count = regs.vertex_buffer.count;
+    if (count == 0) {
+        return;
+    }
+
+    // The renderer keeps the state it translated across batches, so a batch starting without
+    // changes still gets a state, with no changed groups
+    if (dirty_groups || batch.states.empty()) {
+        CaptureState();
+    }
+
+    const auto topology = regs.draw_begin.topology.Value();
+    const u32 state_index = static_cast<u32>(batch.states.size() - 1);
+    if (!batch.draws.empty()) {
+        Maxwell3DDrawCall& last = batch.draws.back();
+        if (last.state_index == state_index && last.topology == topology &&
+            IsListTopology(topology) && last.first + last.count == first) {
+            last.count += count;
+            return;
+        }
+    }
+    batch.draws.push_back({state_index, topology, first, count});
+}
+
+void Maxwell3D::CaptureState() {
+    // Registers made of bit fields can be copied but not assigned, so the state is built whole
+    batch.states.push_back({
+        regs.rt,
+        regs.viewport_transform,
+        regs.viewport,
+        regs.vertex_array,
+        regs.depth_test_enable != 0,
+        regs.depth_write_enabled != 0,
+        regs.depth_test_func,
+        regs.stencil_enable != 0,
+        regs.blend,
+        {regs.blend_color.r, regs.blend_color.g, regs.blend_color.b, regs.blend_color.a},
+        regs.cull,
+        dirty_groups,
+    });
+    dirty_groups = BitSet32();
+}
+
+void Maxwell3D::UploadMacroWord(u32 word) {
+    const u32 address = regs.macros.upload_address++;
+    if (address >= macro_memory.size()) {
+        LOG_ERROR(HW_GPU, "Macro uploaded past the end of the macro memory");
+        return;
+    }
+    macro_memory[address] = word;
+    macro_engine->ClearCode();
+}
+
+void Maxwell3D::BindMacro(u32 position) {
+    const u32 entry = regs.macros.entry++;
+    if (entry >= NUM_MACROS) {
+        LOG_ERROR(HW_GPU, "Bound macro %u, there are only %zu", entry, NUM_MACROS);
+        return;
+    }
+    macro_positions[entry] = position;
+}
+
+void Maxwell3D::CallMacro() {
+    const u32 macro = (executing_macro - MACRO_REGISTERS_START) / 2;
+    executing_macro = 0;
+    if (macro >= NUM_MACROS) {
+        LOG_ERROR(HW_GPU, "Called macro %u, there are only %zu", macro, NUM_MACROS);
+    } else {
+        macro_engine->Execute(macro_positions[macro], macro_parameters);
+    }
+    macro_parameters.clear();
+}
+
+} // namespace Tegra
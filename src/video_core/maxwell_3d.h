@@ -0,0 +1,405 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "common/bit_field.h"
+#include "common/bit_set.h"
+#include "common/common_funcs.h"
+#include "common/common_types.h"
+#include "video_core/macro_interpreter.h"
+#include "video_core/memory_manager.h"
+
+namespace Tegra {
+
+/// Register file of the Maxwell 3D engine, as written by the methods called on it
+struct Maxwell3DRegs {
+    static constexpr size_t NUM_REGS = 0xE00;
+    static constexpr size_t NUM_RENDER_TARGETS = 8;
+    static constexpr size_t NUM_VIEWPORTS = 16;
+    static constexpr size_t NUM_VERTEX_ARRAYS = 32;
+
+    enum class PrimitiveTopology : u32 {
+        Points = 0x0,
+        Lines = 0x1,
+        LineLoop = 0x2,
+        LineStrip = 0x3,
+        Triangles = 0x4,
+        TriangleStrip = 0x5,
+        TriangleFan = 0x6,
+        Quads = 0x7,
+        QuadStrip = 0x8,
+        Polygon = 0x9,
+    };
+
+    /// Comparison functions, which the guest may write in either their D3D or GL encoding
+    enum class ComparisonOp : u32 {
+        NeverOld = 1,
+        LessOld = 2,
+        EqualOld = 3,
+        LessEqualOld = 4,
+        GreaterOld = 5,
+        NotEqualOld = 6,
+        GreaterEqualOld = 7,
+        AlwaysOld = 8,
+
+        Never = 0x200,
+        Less = 0x201,
+        Equal = 0x202,
+        LessEqual = 0x203,
+        Greater = 0x204,
+        NotEqual = 0x205,
+        GreaterEqual = 0x206,
+        Always = 0x207,
+    };
+
+    enum class CullFace : u32 {
+        Front = 0x404,
+        Back = 0x405,
+        FrontAndBack = 0x408,
+    };
+
+    enum class FrontFace : u32 {
+        ClockWise = 0x900,
+        CounterClockWise = 0x901,
+    };
+
+    struct Blend {
+        /// Blend equations, in their D3D or GL encoding
+        enum class Equation : u32 {
+            Add = 1,
+            Subtract = 2,
+            ReverseSubtract = 3,
+            Min = 4,
+            Max = 5,
+
+            AddGL = 0x8006,
+            MinGL = 0x8007,
+            MaxGL = 0x8008,
+            SubtractGL = 0x800A,
+            ReverseSubtractGL = 0x800B,
+        };
+
+        /// Blend factors, in their D3D or GL encoding
+        enum class Factor : u32 {
+            Zero = 0x1,
+            One = 0x2,
+            SourceColor = 0x3,
+            OneMinusSourceColor = 0x4,
+            SourceAlpha = 0x5,
+            OneMinusSourceAlpha = 0x6,
+            DestAlpha = 0x7,
+            OneMinusDestAlpha = 0x8,
+            DestColor = 0x9,
+            OneMinusDestColor = 0xA,
+            SourceAlphaSaturate = 0xB,
+            ConstantColor = 0x61,
+            OneMinusConstantColor = 0x62,
+            ConstantAlpha = 0x63,
+            OneMinusConstantAlpha = 0x64,
+
+            ZeroGL = 0x4000,
+            OneGL = 0x4001,
+            SourceColorGL = 0x4300,
+            OneMinusSourceColorGL = 0x4301,
+            SourceAlphaGL = 0x4302,
+            OneMinusSourceAlphaGL = 0x4303,
+            DestAlphaGL = 0x4304,
+            OneMinusDestAlphaGL = 0x4305,
+            DestColorGL = 0x4306,
+            OneMinusDestColorGL = 0x4307,
+            SourceAlphaSaturateGL = 0x4308,
+            ConstantColorGL = 0xC001,
+            OneMinusConstantColorGL = 0xC002,
+            ConstantAlphaGL = 0xC003,
+            OneMinusConstantAlphaGL = 0xC004,
+        };
+
+        u32 separate_alpha;
+        Equation equation_rgb;
+        Factor factor_source_rgb;
+        Factor factor_dest_rgb;
+        Equation equation_a;
+        Factor factor_source_a;
+        INSERT_PADDING_WORDS(1);
+        Factor factor_dest_a;
+        u32 enable_common;
+        std::array<u32, NUM_RENDER_TARGETS> enable;
+    };
+
+    struct RenderTarget {
+        u32 address_high;
+        u32 address_low;
+        u32 width;
+        u32 height;
+        u32 format;
+        INSERT_PADDING_WORDS(0xB);
+
+        GPUVAddr Address() const {
+            return (static_cast<GPUVAddr>(address_high) << 32) | address_low;
+        }
+    };
+
+    struct ViewportTransform {
+        f32 scale_x;
+        f32 scale_y;
+        f32 scale_z;
+        f32 translate_x;
+        f32 translate_y;
+        f32 translate_z;
+        INSERT_PADDING_WORDS(2);
+    };
+
+    struct Viewport {
+        union {
+            u32 raw_x;
+            BitField<0, 16, u32> x;
+            BitField<16, 16, u32> width;
+        };
+        union {
+            u32 raw_y;
+            BitField<0, 16, u32> y;
+            BitField<16, 16, u32> height;
+        };
+        f32 depth_range_near;
+        f32 depth_range_far;
+    };
+
+    struct VertexArray {
+        union {
+            u32 raw_config;
+            BitField<0, 12, u32> stride;
+            BitField<12, 1, u32> enable;
+        };
+        u32 start_high;
+        u32 start_low;
+        u32 divisor;
+
+        GPUVAddr StartAddress() const {
+            return (static_cast<GPUVAddr>(start_high) << 32) | start_low;
+        }
+    };
+
+    union {
+        struct {
+            INSERT_PADDING_WORDS(0x45);
+            struct {
+                /// Position in the macro memory the next uploaded word is written to
+                u32 upload_address;
+                /// Writing to it uploads a word of the macros
+                u32 data;
+                /// Macro the next position is bound to
+                u32 entry;
+                /// Writing to it binds a position of the macro memory to a macro
+                u32 bind;
+            } macros;
+            INSERT_PADDING_WORDS(0x1B7);
+            std::array<RenderTarget, NUM_RENDER_TARGETS> rt;
+            std::array<ViewportTransform, NUM_VIEWPORTS> viewport_transform;
+            std::array<Viewport, NUM_VIEWPORTS> viewport;
+            INSERT_PADDING_WORDS(0x1D);
+            /// Range of vertices drawn by the non-indexed draws
+            struct {
+                u32 first;
+                u32 count;
+            } vertex_buffer;
+            INSERT_PADDING_WORDS(0x154);
+            u32 depth_test_enable;
+            INSERT_PADDING_WORDS(0x6);
+            u32 depth_write_enabled;
+            INSERT_PADDING_WORDS(0x8);
+            ComparisonOp depth_test_func;
+            INSERT_PADDING_WORDS(0x3);
+            struct {
+                f32 r;
+                f32 g;
+                f32 b;
+                f32 a;
+            } blend_color;
+            INSERT_PADDING_WORDS(0x4);
+            Blend blend;
+            u32 stencil_enable;
+            INSERT_PADDING_WORDS(0xA4);
+            /// Writing to it draws the vertex range with the topology set by the begin method
+            u32 draw_end;
+            union {
+                u32 raw;
+                BitField<0, 16, PrimitiveTopology> topology;
+            } draw_begin;
+            INSERT_PADDING_WORDS(0xBF);
+            struct {
+                u32 enabled;
+                FrontFace front_face;
+                CullFace cull_face;
+            } cull;
+            INSERT_PADDING_WORDS(0xB7);
+            std::array<VertexArray, NUM_VERTEX_ARRAYS> vertex_array;
+            INSERT_PADDING_WORDS(NUM_REGS - 0x780);
+        };
+        std::array<u32, NUM_REGS> reg_array;
+    };
+};
+static_assert(sizeof(Maxwell3DRegs) == Maxwell3DRegs::NUM_REGS * sizeof(u32),
+              "Maxwell3DRegs has incorrect size");
+static_assert(std::is_trivially_copyable<Maxwell3DRegs>::value,
+              "Maxwell3DRegs is not trivially copyable");
+
+/// Index of a register in the register file, which is the method writing to it
+#define MAXWELL3D_REG_INDEX(field_name) (offsetof(Tegra::Maxwell3DRegs, field_name) / sizeof(u32))
+
+#define ASSERT_REG_POSITION(field_name, position)                                                  \
+    static_assert(offsetof(Maxwell3DRegs, field_name) == position * sizeof(u32),                   \
+                  "Field " #field_name " has invalid position")
+
+ASSERT_REG_POSITION(macros, 0x45);
+ASSERT_REG_POSITION(rt, 0x200);
+ASSERT_REG_POSITION(viewport_transform, 0x280);
+ASSERT_REG_POSITION(viewport, 0x300);
+ASSERT_REG_POSITION(vertex_buffer, 0x35D);
+ASSERT_REG_POSITION(depth_test_enable, 0x4B3);
+ASSERT_REG_POSITION(depth_write_enabled, 0x4BA);
+ASSERT_REG_POSITION(depth_test_func, 0x4C3);
+ASSERT_REG_POSITION(blend_color, 0x4C7);
+ASSERT_REG_POSITION(blend, 0x4CF);
+ASSERT_REG_POSITION(stencil_enable, 0x4E0);
+ASSERT_REG_POSITION(draw_end, 0x585);
+ASSERT_REG_POSITION(draw_begin, 0x586);
+ASSERT_REG_POSITION(cull, 0x646);
+ASSERT_REG_POSITION(vertex_array, 0x700);
+
+#undef ASSERT_REG_POSITION
+
+/**
+ * Groups of registers the draws depend on. Each group is only translated again by the renderer
+ * when one of its registers changed between two draws.
+ */
+enum class Maxwell3DStateGroup : u32 {
+    RenderTargets,
+    Viewports,
+    VertexArrays,
+    Depth,
+    Stencil,
+    Blend,
+    Cull,
+    NumGroups,
+};
+
+/// Registers of the draw state groups, captured when the state of a draw differs from the last one
+struct Maxwell3DDrawState {
+    std::array<Maxwell3DRegs::RenderTarget, Maxwell3DRegs::NUM_RENDER_TARGETS> rt;
+    std::array<Maxwell3DRegs::ViewportTransform, Maxwell3DRegs::NUM_VIEWPORTS> viewport_transform;
+    std::array<Maxwell3DRegs::Viewport, Maxwell3DRegs::NUM_VIEWPORTS> viewport;
+    std::array<Maxwell3DRegs::VertexArray, Maxwell3DRegs::NUM_VERTEX_ARRAYS> vertex_array;
+    bool depth_test_enable;
+    bool depth_write_enabled;
+    Maxwell3DRegs::ComparisonOp depth_test_func;
+    bool stencil_enable;
+    Maxwell3DRegs::Blend blend;
+    std::array<f32, 4> blend_color;
+    decltype(Maxwell3DRegs::cull) cull;
+
+    /// Groups that differ from the previous state, the others don't have to be translated again
+    BitSet32 changed_groups;
+};
+
+/// Draw of a range of vertices, with the state it was recorded with
+struct Maxwell3DDrawCall {
+    /// Index of the state of the draw in the batch
+    u32 state_index;
+    Maxwell3DRegs::PrimitiveTopology topology;
+    u32 first;
+    u32 count;
+};
+
+/// Draws recorded since the last submission to the renderer, in order
+struct Maxwell3DDrawBatch {
+    std::vector<Maxwell3DDrawState> states;
+    std::vector<Maxwell3DDrawCall> draws;
+
+    bool IsEmpty() const {
+        return draws.empty();
+    }
+};
+
+/**
+ * The Maxwell 3D engine. Its methods write to the register file one at a time, so the writes only
+ * store the register and flag the group it belongs to. The state is captured when a draw is
+ * recorded after a change, and the draws are handed to the renderer in batches.
+ */
+class Maxwell3D final {
+public:
+    using Regs = Maxwell3DRegs;
+    using StateGroup = Maxwell3DStateGroup;
+
+    /// Engine class bound to a subchannel to call the methods of this engine
+    static constexpr u32 ENGINE_CLASS = 0xB197;
+    static constexpr size_t NUM_MACROS = 0x80;
+    /// Methods past the register file call the macros, two methods per macro
+    static constexpr u32 MACRO_REGISTERS_START = static_cast<u32>(Regs::NUM_REGS);
+
+    /// Macros run on the JIT where there is one, unless use_macro_jit is false
+    explicit Maxwell3D(bool use_macro_jit = true);
+    ~Maxwell3D();
+
+    /**
+     * Calls a method of the engine.
+     * @param is_last_call Whether the command header has no arguments left for the method, which
+     *                     ends the call of a macro.
+     */
+    void CallMethod(u32 method, u32 value, bool is_last_call);
+
+    /// Writes a register, and records a draw if it is the method ending one
+    void WriteReg(u32 method, u32 value);
+
+    /// Returns the value of a register, zero past the register file
+    u32 GetRegisterValue(u32 method) const {
+        return method < Regs::NUM_REGS ? regs.reg_array[method] : 0;
+    }
+
+    const Regs& GetRegs() const {
+        return regs;
+    }
+
+    const std::array<u32, Macro::MACRO_MEMORY_SIZE>& GetMacroMemory() const {
+        return macro_memory;
+    }
+
+    /// Groups written to since the state was last captured for a draw
+    BitSet32 GetDirtyGroups() const {
+        return dirty_groups;
+    }
+
+    /// Returns the draws recorded since the last call, leaving the batch empty
+    Maxwell3DDrawBatch TakeDrawBatch();
+
+private:
+    /// Records a draw of the vertex range, merging it with the previous one if it continues it
+    void RecordDraw();
+    /// Captures the registers of the draw state groups
+    void CaptureState();
+    void UploadMacroWord(u32 word);
+    void BindMacro(u32 position);
+    /// Runs the macro being called, with the parameters collected for it
+    void CallMacro();
+
+    Regs regs{};
+    /// Groups whose registers changed since the state was last captured, all of them at first
+    BitSet32 dirty_groups;
+    Maxwell3DDrawBatch batch;
+
+    std::array<u32, Macro::MACRO_MEMORY_SIZE> macro_memory{};
+    /// Position in the macro memory each macro starts at
+    std::array<u32, NUM_MACROS> macro_positions{};
+    std::unique_ptr<MacroEngine> macro_engine;
+    /// Method of the macro being called, zero if there is none
+    u32 executing_macro = 0;
+    std::vector<u32> macro_parameters;
+};
+
+} // namespace Tegra
@@ -0,0 +1,64 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <utility>
+#include "common/logging/log.h"
+#include "video_core/maxwell_dma.h"
+
+namespace Tegra {
+
+using Regs = MaxwellDMARegs;
+
+MaxwellDMA::MaxwellDMA(SurfaceCopyCallback copy_callback)
+    : copy_callback(std::move(copy_callback)) {}
+
+MaxwellDMA::~MaxwellDMA() = default;
+
+void MaxwellDMA::WriteReg(u32 method, u32 value) {
+    if (method >= Regs::NUM_REGS) {
+        LOG_ERROR(HW_GPU, "Maxwell DMA method 0x%X is out of the register file", method);
+        return;
+    }
+    regs.reg_array[method] = value;
+
+    if (method == MAXWELLDMA_REG_INDEX(launch_dma)) {
+        Launch();
+    }
+}
+
+void MaxwellDMA::Launch() {
+    if (regs.launch_dma.data_transfer_type == 0) {
+        return;
+    }
+    if (regs.launch_dma.remap_enable) {
+        LOG_ERROR(HW_GPU, "Copies with remapped components are not implemented");
+        return;
+    }
+
+    SurfaceCopy copy{};
+    copy.bytes_per_pixel = 1;
+    copy.width = regs.line_length;
+    copy.height = regs.launch_dma.multi_line_enable ? regs.line_count : 1;
+
+    // Pitch linear ends of the copy start at their address, block-linear ones at a position
+    const auto set_end = [](CopySurface& surface, u32& x, u32& y, GPUVAddr address,
+                            Regs::MemoryLayout layout, u32 pitch, const Regs::Parameters& params) {
+        surface.address = address;
+        surface.is_block_linear = layout == Regs::MemoryLayout::BlockLinear;
+        surface.pitch = pitch;
+        if (surface.is_block_linear) {
+            surface.width = params.size_x;
+            surface.block_height = 1U << params.block_height;
+            x = params.pos_x;
+            y = params.pos_y;
+        }
+    };
+    set_end(copy.src, copy.src_x, copy.src_y, regs.SrcAddress(),
+            regs.launch_dma.src_memory_layout, regs.src_pitch, regs.src_params);
+    set_end(copy.dst, copy.dst_x, copy.dst_y, regs.DstAddress(),
+            regs.launch_dma.dst_memory_layout, regs.dst_pitch, regs.dst_params);
+    copy_callback(copy);
+}
+
+} // namespace Tegra
@@ -0,0 +1,144 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include "common/bit_field.h"
+#include "common/common_funcs.h"
+#include "common/common_types.h"
+#include "video_core/memory_manager.h"
+#include "video_core/surface_copy.h"
+
+namespace Tegra {
+
+/// Register file of the Maxwell DMA engine, as written by the methods called on it
+struct MaxwellDMARegs {
+    static constexpr size_t NUM_REGS = 0x1D6;
+
+    enum class MemoryLayout : u32 {
+        BlockLinear = 0,
+        Pitch = 1,
+    };
+
+    /// Layout of a block-linear end of a copy, and the position of the copy in it
+    struct Parameters {
+        union {
+            u32 raw_block_config;
+            /// Dimensions of the blocks, as log2 of their GOB counts
+            BitField<0, 4, u32> block_width;
+            BitField<4, 4, u32> block_height;
+            BitField<8, 4, u32> block_depth;
+        };
+        /// Width of the surface, in bytes
+        u32 size_x;
+        u32 size_y;
+        u32 size_z;
+        u32 pos_z;
+        union {
+            u32 raw_pos;
+            /// Position of the copy in the surface, in bytes horizontally
+            BitField<0, 16, u32> pos_x;
+            BitField<16, 16, u32> pos_y;
+        };
+    };
+
+    union {
+        struct {
+            INSERT_PADDING_WORDS(0xC0);
+            /// Writing to it launches the copy
+            union {
+                u32 raw;
+                /// Zero for no copy
+                BitField<0, 2, u32> data_transfer_type;
+                BitField<7, 1, MemoryLayout> src_memory_layout;
+                BitField<8, 1, MemoryLayout> dst_memory_layout;
+                /// Whether line_count lines are copied, rather than a single one
+                BitField<9, 1, u32> multi_line_enable;
+                /// Whether the components are remapped, which copies components instead of bytes
+                BitField<10, 1, u32> remap_enable;
+            } launch_dma;
+            INSERT_PADDING_WORDS(0x3F);
+            u32 src_address_high;
+            u32 src_address_low;
+            u32 dst_address_high;
+            u32 dst_address_low;
+            /// Bytes between the lines of the pitch linear ends of the copy
+            u32 src_pitch;
+            u32 dst_pitch;
+            /// Size of the copied lines, in bytes
+            u32 line_length;
+            u32 line_count;
+            INSERT_PADDING_WORDS(0xBB);
+            Parameters dst_params;
+            INSERT_PADDING_WORDS(0x1);
+            Parameters src_params;
+            INSERT_PADDING_WORDS(NUM_REGS - 0x1D0);
+        };
+        std::array<u32, NUM_REGS> reg_array;
+    };
+
+    GPUVAddr SrcAddress() const {
+        return (static_cast<GPUVAddr>(src_address_high) << 32) | src_address_low;
+    }
+
+    GPUVAddr DstAddress() const {
+        return (static_cast<GPUVAddr>(dst_address_high) << 32) | dst_address_low;
+    }
+};
+static_assert(sizeof(MaxwellDMARegs) == MaxwellDMARegs::NUM_REGS * sizeof(u32),
+              "MaxwellDMARegs has incorrect size");
+static_assert(std::is_trivially_copyable<MaxwellDMARegs>::value,
+              "MaxwellDMARegs is not trivially copyable");
+
+/// Index of a register in the register file, which is the method writing to it
+#define MAXWELLDMA_REG_INDEX(field_name)                                                           \
+    (offsetof(Tegra::MaxwellDMARegs, field_name) / sizeof(u32))
+
+#define ASSERT_REG_POSITION(field_name, position)                                                  \
+    static_assert(offsetof(MaxwellDMARegs, field_name) == position * sizeof(u32),                  \
+                  "Field " #field_name " has invalid position")
+
+ASSERT_REG_POSITION(launch_dma, 0xC0);
+ASSERT_REG_POSITION(src_address_high, 0x100);
+ASSERT_REG_POSITION(dst_address_high, 0x102);
+ASSERT_REG_POSITION(src_pitch, 0x104);
+ASSERT_REG_POSITION(line_length, 0x106);
+ASSERT_REG_POSITION(dst_params, 0x1C3);
+ASSERT_REG_POSITION(src_params, 0x1CA);
+
+#undef ASSERT_REG_POSITION
+
+/**
+ * The Maxwell DMA engine, which copies lines of bytes between buffers, either of which may be a
+ * block-linear surface. The copies are handed to the copy callback as surface copies of one byte
+ * pixels.
+ */
+class MaxwellDMA final {
+public:
+    using Regs = MaxwellDMARegs;
+
+    /// Engine class bound to a subchannel to call the methods of this engine
+    static constexpr u32 ENGINE_CLASS = 0xB0B5;
+
+    explicit MaxwellDMA(SurfaceCopyCallback copy_callback);
+    ~MaxwellDMA();
+
+    /// Writes a register, and launches a copy if it is the method launching one
+    void WriteReg(u32 method, u32 value);
+
+    const Regs& GetRegs() const {
+        return regs;
+    }
+
+private:
+    void Launch();
+
+    Regs regs{};
+    SurfaceCopyCallback copy_callback;
+};
+
+} // namespace Tegra
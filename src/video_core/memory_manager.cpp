@@ -0,0 +1,188 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include "common/alignment.h"
+#include "common/assert.h"
+#include "core/memory.h"
+#include "video_core/memory_manager.h"
+
+namespace Tegra {
+
+MemoryManager::MemoryManager() : leaves(new std::atomic<Leaf*>[NUM_LEAVES]()) {}
+
+MemoryManager::~MemoryManager() {
+    for (u64 index = 0; index < NUM_LEAVES; ++index) {
+        delete leaves[index].load(std::memory_order_relaxed);
+    }
+}
+
+boost::optional<GPUVAddr> MemoryManager::AllocateSpace(u64 size, u64 align) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size = Common::AlignUp(size, PAGE_SIZE);
+    const boost::optional<GPUVAddr> gpu_addr = FindFreeRange(size, std::max(align, PAGE_SIZE));
+    if (gpu_addr) {
+        used_ranges[*gpu_addr] = size;
+        SetEntries(*gpu_addr, size, 0, ENTRY_RESERVED);
+    }
+    return gpu_addr;
+}
+
+boost::optional<GPUVAddr> MemoryManager::AllocateFixedSpace(GPUVAddr gpu_addr, u64 size) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    ASSERT_MSG((gpu_addr & PAGE_MASK) == 0, "Unaligned GPU address 0x%llx", gpu_addr);
+    size = Common::AlignUp(size, PAGE_SIZE);
+    if (!IsRangeFree(gpu_addr, size)) {
+        return boost::none;
+    }
+    used_ranges[gpu_addr] = size;
+    SetEntries(gpu_addr, size, 0, ENTRY_RESERVED);
+    return gpu_addr;
+}
+
+boost::optional<GPUVAddr> MemoryManager::MapBufferEx(VAddr cpu_addr, u64 size) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    ASSERT_MSG((cpu_addr & PAGE_MASK) == 0, "Unaligned CPU address 0x%llx", cpu_addr);
+    size = Common::AlignUp(size, PAGE_SIZE);
+    const boost::optional<GPUVAddr> gpu_addr = FindFreeRange(size, PAGE_SIZE);
+    if (gpu_addr) {
+        used_ranges[*gpu_addr] = size;
+        buffers[*gpu_addr] = {size, true};
+        SetEntries(*gpu_addr, size, cpu_addr, ENTRY_MAPPED);
+    }
+    return gpu_addr;
+}
+
+GPUVAddr MemoryManager::MapBufferEx(VAddr cpu_addr, GPUVAddr gpu_addr, u64 size) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    ASSERT_MSG((cpu_addr & PAGE_MASK) == 0, "Unaligned CPU address 0x%llx", cpu_addr);
+    ASSERT_MSG((gpu_addr & PAGE_MASK) == 0, "Unaligned GPU address 0x%llx", gpu_addr);
+    ASSERT_MSG(gpu_addr + size <= ADDRESS_SPACE_SIZE, "Mapping outside of the address space");
+    size = Common::AlignUp(size, PAGE_SIZE);
+
+    // The buffers overlapping the new one are unmapped entirely
+    auto itr = buffers.lower_bound(gpu_addr);
+    if (itr != buffers.begin() && std::prev(itr)->first + std::prev(itr)->second.size > gpu_addr) {
+        --itr;
+    }
+    while (itr != buffers.end() && itr->first < gpu_addr + size) {
+        const Buffer& buffer = itr->second;
+        if (buffer.owns_range) {
+            used_ranges.erase(itr->first);
+        }
+        SetEntries(itr->first, buffer.size, 0, buffer.owns_range ? ENTRY_UNMAPPED : ENTRY_RESERVED);
+        itr = buffers.erase(itr);
+    }
+
+    // Mappings outside of reserved ranges get a range of their own
+    const bool owns_range = IsRangeFree(gpu_addr, size);
+    if (owns_range) {
+        used_ranges[gpu_addr] = size;
+    }
+    buffers[gpu_addr] = {size, owns_range};
+    SetEntries(gpu_addr, size, cpu_addr, ENTRY_MAPPED);
+    return gpu_addr;
+}
+
+bool MemoryManager::UnmapBuffer(GPUVAddr gpu_addr) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto itr = buffers.find(gpu_addr);
+    if (itr == buffers.end()) {
+        return false;
+    }
+
+    const Buffer& buffer = itr->second;
+    if (buffer.owns_range) {
+        used_ranges.erase(gpu_addr);
+        SetEntries(gpu_addr, buffer.size, 0, ENTRY_UNMAPPED);
+    } else {
+        SetEntries(gpu_addr, buffer.size, 0, ENTRY_RESERVED);
+    }
+    buffers.erase(itr);
+    return true;
+}
+
+u8* MemoryManager::GetPointer(GPUVAddr gpu_addr) const {
+    const boost::optional<VAddr> cpu_addr = GpuToCpuAddress(gpu_addr);
+    if (!cpu_addr) {
+        return nullptr;
+    }
+    return Memory::GetPointer(*cpu_addr);
+}
+
+bool MemoryManager::ReadBlock(GPUVAddr gpu_addr, void* dest_buffer, size_t size) const {
+    // Check the whole block first, so that nothing is read if part of it isn't mapped
+    for (GPUVAddr page = gpu_addr & ~PAGE_MASK; page < gpu_addr + size; page += PAGE_SIZE) {
+        if (!GpuToCpuAddress(page)) {
+            return false;
+        }
+    }
+
+    u8* dest = static_cast<u8*>(dest_buffer);
+    while (size != 0) {
+        // Each GPU page may be backed by a different CPU address
+        const size_t copy_size = std::min<size_t>(size, PAGE_SIZE - (gpu_addr & PAGE_MASK));
+        Memory::ReadBlock(*GpuToCpuAddress(gpu_addr), dest, copy_size);
+        gpu_addr += copy_size;
+        dest += copy_size;
+        size -= copy_size;
+    }
+    return true;
+}
+
+void MemoryManager::SetEntries(GPUVAddr gpu_addr, u64 size, VAddr cpu_addr, u64 state) {
+    for (u64 offset = 0; offset < size; offset += PAGE_SIZE) {
+        const u64 page = (gpu_addr + offset) >> PAGE_BITS;
+        std::atomic<Leaf*>& leaf_slot = leaves[page >> LEAF_BITS];
+
+        Leaf* leaf = leaf_slot.load(std::memory_order_relaxed);
+        if (leaf == nullptr) {
+            if (state == ENTRY_UNMAPPED) {
+                continue;
+            }
+            leaf = new Leaf();
+            leaf_slot.store(leaf, std::memory_order_release);
+        }
+
+        const u64 entry = state == ENTRY_MAPPED ? (cpu_addr + offset) | ENTRY_MAPPED : state;
+        leaf->entries[page & LEAF_MASK].store(entry, std::memory_order_relaxed);
+    }
+}
+
+boost::optional<GPUVAddr> MemoryManager::FindFreeRange(u64 size, u64 align) const {
+    GPUVAddr candidate = Common::AlignUp(FIRST_FREE_ADDRESS, align);
+    for (const auto& range : used_ranges) {
+        if (candidate + size <= range.first) {
+            break;
+        }
+        candidate = std::max(candidate, Common::AlignUp(range.first + range.second, align));
+    }
+
+    if (candidate + size > ADDRESS_SPACE_SIZE) {
+        return boost::none;
+    }
+    return candidate;
+}
+
+bool MemoryManager::IsRangeFree(GPUVAddr gpu_addr, u64 size) const {
+    auto itr = used_ranges.lower_bound(gpu_addr);
+    if (itr != used_ranges.end() && itr->first < gpu_addr + size) {
+        return false;
+    }
+    if (itr != used_ranges.begin()) {
+        const auto prev = std::prev(itr);
+        if (prev->first + prev->second > gpu_addr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace Tegra
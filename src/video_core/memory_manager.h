@@ -0,0 +1,152 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <boost/optional.hpp>
+#include "common/common_types.h"
+
+namespace Tegra {
+
+/// Address in the virtual address space of the GPU
+using GPUVAddr = u64;
+
+/**
+ * Virtual address space of the GPU. Buffers are mapped into it by nvhost-as-gpu on the emulation
+ * threads, and the GPU thread translates the addresses used by command lists, textures and copies
+ * through it.
+ *
+ * Translations go through a two-level page table like Memory::PageTable, but with the leaves only
+ * allocated for the parts of the 40-bit address space that are used. Looking up an address is two
+ * dependent loads and takes no lock, so the GPU thread never waits for mappings being changed.
+ */
+class MemoryManager final {
+public:
+    static constexpr u64 PAGE_BITS = 12;
+    static constexpr u64 PAGE_SIZE = 1ULL << PAGE_BITS;
+    static constexpr u64 PAGE_MASK = PAGE_SIZE - 1;
+    static constexpr u64 ADDRESS_SPACE_BITS = 40;
+    static constexpr u64 ADDRESS_SPACE_SIZE = 1ULL << ADDRESS_SPACE_BITS;
+
+    MemoryManager();
+    ~MemoryManager();
+
+    MemoryManager(const MemoryManager&) = delete;
+    MemoryManager& operator=(const MemoryManager&) = delete;
+
+    /**
+     * Reserves a free range of the address space, for buffers mapped at fixed addresses later.
+     * @returns The GPU address of the range, or none if there isn't a large enough free range.
+     */
+    boost::optional<GPUVAddr> AllocateSpace(u64 size, u64 align);
+
+    /**
+     * Reserves a range of the address space at a fixed address.
+     * @returns The GPU address of the range, or none if it overlaps a range in use.
+     */
+    boost::optional<GPUVAddr> AllocateFixedSpace(GPUVAddr gpu_addr, u64 size);
+
+    /**
+     * Maps a buffer at a free address.
+     * @returns The GPU address the buffer was mapped at, or none if the address space is full.
+     */
+    boost::optional<GPUVAddr> MapBufferEx(VAddr cpu_addr, u64 size);
+
+    /**
+     * Maps a buffer at a fixed address, usually inside a range reserved with AllocateSpace. It
+     * replaces the mappings it overlaps.
+     * @returns The GPU address the buffer was mapped at.
+     */
+    GPUVAddr MapBufferEx(VAddr cpu_addr, GPUVAddr gpu_addr, u64 size);
+
+    /**
+     * Unmaps the buffer mapped at an address. Reserved ranges stay reserved.
+     * @returns False if no buffer was mapped at the address.
+     */
+    bool UnmapBuffer(GPUVAddr gpu_addr);
+
+    /// Translates a GPU address to the emulated CPU address it is mapped to, if any
+    boost::optional<VAddr> GpuToCpuAddress(GPUVAddr gpu_addr) const {
+        const u64 entry = GetEntry(gpu_addr);
+        if ((entry & ENTRY_STATE_MASK) != ENTRY_MAPPED) {
+            return boost::none;
+        }
+        return (entry & ~PAGE_MASK) | (gpu_addr & PAGE_MASK);
+    }
+
+    /// Returns the host pointer backing a GPU address, or nullptr if it isn't mapped
+    u8* GetPointer(GPUVAddr gpu_addr) const;
+
+    /**
+     * Reads a block of GPU memory, which doesn't have to be contiguous in CPU memory.
+     * @returns False if part of the block isn't mapped, which is then left untouched.
+     */
+    bool ReadBlock(GPUVAddr gpu_addr, void* dest_buffer, size_t size) const;
+
+private:
+    /// Entries hold the CPU address of the page, with the state of the page in the low bits
+    static constexpr u64 ENTRY_UNMAPPED = 0;
+    static constexpr u64 ENTRY_RESERVED = 1;
+    static constexpr u64 ENTRY_MAPPED = 2;
+    static constexpr u64 ENTRY_STATE_MASK = PAGE_MASK;
+
+    static constexpr u64 LEAF_BITS = 12;
+    static constexpr u64 LEAF_SIZE = 1ULL << LEAF_BITS;
+    static constexpr u64 LEAF_MASK = LEAF_SIZE - 1;
+    static constexpr u64 NUM_LEAVES = 1ULL << (ADDRESS_SPACE_BITS - PAGE_BITS - LEAF_BITS);
+
+    struct Leaf {
+        std::array<std::atomic<u64>, LEAF_SIZE> entries;
+    };
+
+    /// Buffer mapped with MapBufferEx
+    struct Buffer {
+        u64 size;
+        /// Whether the buffer was mapped outside of a reserved range, which is then released
+        /// along with it
+        bool owns_range;
+    };
+
+    /// Addresses below this one are never handed out, so that null GPU pointers stay invalid
+    static constexpr GPUVAddr FIRST_FREE_ADDRESS = 0x100000;
+
+    u64 GetEntry(GPUVAddr gpu_addr) const {
+        if (gpu_addr >= ADDRESS_SPACE_SIZE) {
+            return ENTRY_UNMAPPED;
+        }
+        const u64 page = gpu_addr >> PAGE_BITS;
+        const Leaf* leaf = leaves[page >> LEAF_BITS].load(std::memory_order_acquire);
+        if (leaf == nullptr) {
+            return ENTRY_UNMAPPED;
+        }
+        return leaf->entries[page & LEAF_MASK].load(std::memory_order_relaxed);
+    }
+
+    /// Sets the entries of a range of pages. Must be called with the mutex held.
+    void SetEntries(GPUVAddr gpu_addr, u64 size, VAddr cpu_addr, u64 state);
+
+    /// Finds a free range of the address space. Must be called with the mutex held.
+    boost::optional<GPUVAddr> FindFreeRange(u64 size, u64 align) const;
+    /// Whether a range doesn't overlap any range in use. Must be called with the mutex held.
+    bool IsRangeFree(GPUVAddr gpu_addr, u64 size) const;
+
+    /// Leaves of the page table, they are only freed along with the whole table so that the
+    /// lookups don't have to synchronize with mapping changes
+    std::unique_ptr<std::atomic<Leaf*>[]> leaves;
+
+    /// Serializes the changes to the mappings
+    std::mutex mutex;
+    /// Ranges of the address space in use, by their GPU address. Both the ranges reserved with
+    /// AllocateSpace and the buffers mapped at free addresses are tracked here.
+    std::map<GPUVAddr, u64> used_ranges;
+    /// Buffers mapped with MapBufferEx, by their GPU address
+    std::map<GPUVAddr, Buffer> buffers;
+};
+
+} // namespace Tegra
@@ -4,10 +4,14 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <vector>
 #include <boost/optional.hpp>
 #include "common/assert.h"
 #include "common/common_types.h"
+#include "video_core/maxwell_3d.h"
+#include "video_core/surface_copy.h"
 
 class EmuWindow;
 
@@ -45,10 +49,52 @@ public:
         PixelFormat pixel_format;
     };
 
+    /// How the contents of a layer are fitted to the screen, as set with vi SetLayerScalingMode
+    enum class ScalingMode : u32 {
+        /// Not scaled, drawn the same way as None
+        Freeze = 0,
+        /// Stretched to the screen
+        ScaleToWindow = 1,
+        /// Scaled to cover the screen while keeping the aspect ratio, the excess is cropped
+        ScaleAndCrop = 2,
+        /// Not scaled, drawn at its native size from the top-left corner of the screen
+        None = 3,
+        /// Scaled to fit the screen while keeping the aspect ratio
+        PreserveAspectRatio = 4,
+    };
+
+    /// Describes a layer that is composed into a frame
+    struct LayerInfo {
+        u64 id;
+        ScalingMode scaling_mode;
+        /// New contents of the layer, or none to keep showing the previous ones
+        boost::optional<FramebufferInfo> framebuffer;
+    };
+
     virtual ~RendererBase() {}
 
-    /// Swap buffers (render frame)
-    virtual void SwapBuffers(boost::optional<const FramebufferInfo&> framebuffer_info) = 0;
+    /**
+     * Swap buffers (render frame), composing the given layers into the frame. Layers that were
+     * drawn in the previous frame but aren't in the list are removed.
+     * @param layers Layers of the screen, ordered from the bottom-most to the top-most one
+     */
+    virtual void SwapBuffers(const std::vector<LayerInfo>& layers) = 0;
+
+    /**
+     * Queues draws recorded by the GPU, to be executed in order. Called on the GPU thread.
+     * @param batch Draws of a GPFIFO batch, along with the states they were recorded with
+     */
+    virtual void SubmitDraws(Tegra::Maxwell3DDrawBatch batch) {}
+
+    /**
+     * Copies a surface on the host GPU, for renderers that keep both ends of the copy there.
+     * Called on the GPU thread, once the draws recorded before the copy were submitted.
+     * @returns Whether the renderer did the copy, the GPU copies the surface in guest memory
+     *          otherwise
+     */
+    virtual bool AccelerateSurfaceCopy(const Tegra::SurfaceCopy& copy) {
+        return false;
+    }
 
     /**
      * Set the emulator window to use for renderer
@@ -73,11 +119,18 @@ public:
         return m_current_frame;
     }
 
+    /// Gets the memory of the buffers allocated on the host GPU. Can be called from any thread.
+    size_t GetBufferMemoryUsage() const {
+        return buffer_memory_usage;
+    }
+
     void RefreshRasterizerSetting();
 
 protected:
     f32 m_current_fps = 0.0f; ///< Current framerate, should be set by the renderer
     int m_current_frame = 0;  ///< Current frame, should be set by the renderer
+    /// Memory of the buffers allocated on the host GPU, should be kept up to date by the renderer
+    std::atomic<size_t> buffer_memory_usage{0};
 
 private:
     bool opengl_rasterizer_active = false;
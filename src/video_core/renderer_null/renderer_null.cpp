@@ -0,0 +1,60 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "common/hash.h"
+#include "core/core.h"
+#include "core/core_timing.h"
+#include "core/frontend/emu_window.h"
+#include "core/memory.h"
+#include "video_core/block_linear.h"
+#include "video_core/renderer_null/renderer_null.h"
+
+RendererNull::RendererNull(bool hash_frames) : hash_frames(hash_frames) {}
+
+void RendererNull::SwapBuffers(const std::vector<LayerInfo>& layers) {
+    if (hash_frames) {
+        HashLayers(layers);
+    }
+
+    m_current_frame++;
+
+    auto& system = Core::System::GetInstance();
+    system.perf_stats.EndSystemFrame();
+
+    render_window->PollEvents();
+
+    system.frame_limiter.DoFrameLimiting(CoreTiming::GetGlobalTimeUs());
+    system.perf_stats.BeginSystemFrame();
+}
+
+void RendererNull::HashLayers(const std::vector<LayerInfo>& layers) {
+    for (const LayerInfo& layer : layers) {
+        // Layers without new contents show the same ones as in the previous frame
+        if (layer.framebuffer == boost::none) {
+            continue;
+        }
+        const FramebufferInfo& info = *layer.framebuffer;
+        const size_t size{VideoCore::BlockLinear::GetSurfaceSize(
+            info.width, info.height, FramebufferInfo::BytesPerPixel(info.pixel_format),
+            VideoCore::BlockLinear::FRAMEBUFFER_BLOCK_HEIGHT)};
+        framebuffer_data.resize(size);
+
+        Memory::RasterizerFlushRegion(info.address, size);
+        Memory::ReadBlock(info.address, framebuffer_data.data(), size);
+
+        // Chained, so that the hash depends on the order of the frames too
+        frames_hash = Common::ComputeFastHash64(&layer.id, sizeof(layer.id), frames_hash);
+        frames_hash = Common::ComputeFastHash64(framebuffer_data.data(), size, frames_hash);
+    }
+}
+
+void RendererNull::SetWindow(EmuWindow* window) {
+    render_window = window;
+}
+
+bool RendererNull::Init() {
+    return true;
+}
+
+void RendererNull::ShutDown() {}
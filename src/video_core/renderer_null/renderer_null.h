@@ -0,0 +1,47 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <vector>
+#include "common/common_types.h"
+#include "video_core/renderer_base.h"
+
+class EmuWindow;
+
+/**
+ * Renderer drawing nothing, for headless runs such as benchmarks. It still ends the system frames
+ * and runs the frame limiter, so that the emulation is paced and measured the same way.
+ */
+class RendererNull : public RendererBase {
+public:
+    /**
+     * @param hash_frames Whether the contents of the frames are read from guest memory and hashed,
+     *                    to check that runs of the same input render the same frames.
+     */
+    explicit RendererNull(bool hash_frames = false);
+
+    /// Ends the system frame, hashing the new contents of the layers if enabled
+    void SwapBuffers(const std::vector<LayerInfo>& layers) override;
+
+    void SetWindow(EmuWindow* window) override;
+
+    bool Init() override;
+
+    void ShutDown() override;
+
+    /// Gets the hash of the contents of all the frames so far, zero if they aren't hashed
+    u64 GetFramesHash() const {
+        return frames_hash;
+    }
+
+private:
+    void HashLayers(const std::vector<LayerInfo>& layers);
+
+    EmuWindow* render_window = nullptr;
+    bool hash_frames;
+    u64 frames_hash = 0;
+    /// Copy of the framebuffer being hashed, kept to reuse its allocation
+    std::vector<u8> framebuffer_data;
+};
@@ -207,3 +207,35 @@ public:
 
     GLuint handle = 0;
 };
+
+class OGLSync : private NonCopyable {
+public:
+    OGLSync() = default;
+    OGLSync(OGLSync&& o) {
+        std::swap(handle, o.handle);
+    }
+    ~OGLSync() {
+        Release();
+    }
+    OGLSync& operator=(OGLSync&& o) {
+        std::swap(handle, o.handle);
+        return *this;
+    }
+
+    /// Inserts a fence that is signaled once the commands issued so far are done
+    void Create() {
+        if (handle != 0)
+            return;
+        handle = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    /// Deletes the internal OpenGL resource
+    void Release() {
+        if (handle == 0)
+            return;
+        glDeleteSync(handle);
+        handle = 0;
+    }
+
+    GLsync handle = 0;
+};
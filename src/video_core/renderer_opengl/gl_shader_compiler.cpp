@@ -0,0 +1,95 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <functional>
+#include "common/logging/log.h"
+#include "common/microprofile.h"
+#include "video_core/renderer_opengl/gl_shader_compiler.h"
+#include "video_core/renderer_opengl/gl_shader_util.h"
+
+MICROPROFILE_DEFINE(OpenGL_CompileProgram, "OpenGL", "Compile Program", MP_RGB(100, 100, 255));
+
+namespace GLShader {
+
+ShaderCompiler::ShaderCompiler(const EmuWindow& window, size_t num_workers) {
+    for (size_t i = 0; i < num_workers; ++i) {
+        auto context = window.CreateSharedContext();
+        if (!context) {
+            break;
+        }
+        contexts.push_back(std::move(context));
+    }
+
+    if (contexts.empty()) {
+        LOG_WARNING(Render_OpenGL, "No shared contexts, programs are compiled on the renderer");
+        return;
+    }
+
+    for (auto& context : contexts) {
+        workers.emplace_back(&ShaderCompiler::WorkerLoop, this, std::ref(*context));
+    }
+}
+
+ShaderCompiler::~ShaderCompiler() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_condition.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+std::shared_ptr<AsyncProgram> ShaderCompiler::Compile(std::string vertex_shader,
+                                                      std::string fragment_shader) {
+    auto program =
+        std::make_shared<AsyncProgram>(std::move(vertex_shader), std::move(fragment_shader));
+
+    if (workers.empty()) {
+        program->program.Create(program->vertex_shader.c_str(), program->fragment_shader.c_str());
+        program->ready = true;
+        return program;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        queue.push_back(program);
+    }
+    queue_condition.notify_one();
+    return program;
+}
+
+void ShaderCompiler::WorkerLoop(EmuWindow::GraphicsContext& context) {
+    context.MakeCurrent();
+
+    while (true) {
+        std::shared_ptr<AsyncProgram> program;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_condition.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) {
+                break;
+            }
+            program = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        MICROPROFILE_SCOPE(OpenGL_CompileProgram);
+        program->program.handle = GLShader::LoadProgram(program->vertex_shader.c_str(),
+                                                        program->fragment_shader.c_str());
+        // Makes sure the program is linked before the renderer's context uses it
+        glFinish();
+        program->ready.store(true, std::memory_order_release);
+    }
+
+    context.DoneCurrent();
+
+#if MICROPROFILE_ENABLED
+    MicroProfileOnThreadExit();
+#endif
+}
+
+} // namespace GLShader
@@ -0,0 +1,78 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+#include "common/common_types.h"
+#include "core/frontend/emu_window.h"
+#include "video_core/renderer_opengl/gl_resource_manager.h"
+
+namespace GLShader {
+
+/// Program compiled by a ShaderCompiler, its handle can only be used once it is ready
+class AsyncProgram {
+public:
+    AsyncProgram(std::string vertex_shader, std::string fragment_shader)
+        : vertex_shader(std::move(vertex_shader)), fragment_shader(std::move(fragment_shader)) {}
+
+    bool IsReady() const {
+        return ready.load(std::memory_order_acquire);
+    }
+
+    GLuint GetHandle() const {
+        return program.handle;
+    }
+
+private:
+    friend class ShaderCompiler;
+
+    std::string vertex_shader;
+    std::string fragment_shader;
+    /// Created by a worker, and released by the owner of the program with the renderer's context
+    OGLShader program;
+    std::atomic<bool> ready{false};
+};
+
+/**
+ * Compiles and links programs on worker threads, each with a graphics context sharing its objects
+ * with the renderer's, so that compiling shaders doesn't stall drawing. The renderer uses a cheaper
+ * fallback until a program is ready. When the frontend can't create shared contexts, programs are
+ * compiled right away on the caller thread instead.
+ */
+class ShaderCompiler {
+public:
+    /**
+     * Creates the contexts of the workers and starts them. Must be called on the thread the
+     * context of the window is current on.
+     */
+    ShaderCompiler(const EmuWindow& window, size_t num_workers);
+
+    /// Stops the workers, programs that weren't compiled yet never become ready
+    ~ShaderCompiler();
+
+    /// Queues a program to be compiled. The caller needs the renderer's context current.
+    std::shared_ptr<AsyncProgram> Compile(std::string vertex_shader, std::string fragment_shader);
+
+private:
+    void WorkerLoop(EmuWindow::GraphicsContext& context);
+
+    std::vector<std::unique_ptr<EmuWindow::GraphicsContext>> contexts;
+    std::vector<std::thread> workers;
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_condition;
+    std::deque<std::shared_ptr<AsyncProgram>> queue;
+    bool stopping = false;
+};
+
+} // namespace GLShader
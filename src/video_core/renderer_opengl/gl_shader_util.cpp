@@ -2,15 +2,147 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include <glad/glad.h>
 #include "common/assert.h"
+#include "common/hash.h"
+#include "common/linear_disk_cache.h"
 #include "common/logging/log.h"
 #include "video_core/renderer_opengl/gl_shader_util.h"
 
 namespace GLShader {
 
-GLuint LoadProgram(const char* vertex_shader, const char* fragment_shader) {
+namespace {
+
+/**
+ * Program binaries cached on disk. The key of an entry is the hash of the shader sources and of the
+ * driver identity, its value is the binary format followed by the program binary. Programs can be
+ * loaded by several threads at once, the mutex guards everything but the worker reading the file.
+ */
+struct ProgramCache : LinearDiskCacheReader<u64, u8> {
+    void Read(const u64& key, const u8* value, u32 value_size) override {
+        if (value_size > sizeof(GLenum)) {
+            entries[key].assign(value, value + value_size);
+        }
+    }
+
+    LinearDiskCache<u64, u8> file;
+    std::unordered_map<u64, std::vector<u8>> entries;
+    /// Ready once the worker thread read the file
+    std::future<void> loaded;
+    /// Identifies the driver, computed by the first LoadProgram
+    std::string driver_id;
+    std::mutex mutex;
+};
+
+std::unique_ptr<ProgramCache> program_cache;
+
+/// Returns the program cache if it is open and the driver supports program binaries
+ProgramCache* GetProgramCache() {
+    if (!program_cache || !GLAD_GL_ARB_get_program_binary) {
+        return nullptr;
+    }
+
+    GLint num_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+    if (num_formats == 0) {
+        return nullptr;
+    }
+    return program_cache.get();
+}
+
+/// Waits for the cache file to be read, the first time the cache is used. Needs the mutex.
+void PrepareProgramCache(ProgramCache& cache) {
+    if (!cache.driver_id.empty()) {
+        return;
+    }
+
+    cache.loaded.wait();
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        cache.driver_id += reinterpret_cast<const char*>(glGetString(name));
+        cache.driver_id += '\n';
+    }
+}
+
+u64 GetProgramKey(const ProgramCache& cache, const char* vertex_shader,
+                  const char* fragment_shader) {
+    std::string id = cache.driver_id;
+    id.append(vertex_shader).append(1, '\0').append(fragment_shader);
+    return Common::ComputeHash64(id.data(), id.size());
+}
+
+/// Creates a program from its cached binary, returns 0 if there is none or the driver rejected it
+GLuint LoadCachedProgram(ProgramCache& cache, u64 key) {
+    auto itr = cache.entries.find(key);
+    if (itr == cache.entries.end()) {
+        return 0;
+    }
+
+    const std::vector<u8>& value = itr->second;
+    GLenum format;
+    std::memcpy(&format, value.data(), sizeof(format));
+
+    GLuint program_id = glCreateProgram();
+    glProgramBinary(program_id, format, value.data() + sizeof(format),
+                    static_cast<GLsizei>(value.size() - sizeof(format)));
+
+    GLint result = GL_FALSE;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &result);
+    if (result != GL_TRUE) {
+        // The driver changed in a way its identity doesn't tell, the program is compiled again
+        LOG_DEBUG(Render_OpenGL, "Cached program binary %016llx was rejected", key);
+        glDeleteProgram(program_id);
+        cache.entries.erase(itr);
+        return 0;
+    }
+    return program_id;
+}
+
+void StoreProgram(ProgramCache& cache, u64 key, GLuint program_id) {
+    GLint length = 0;
+    glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<u8> value(sizeof(GLenum) + length);
+    GLenum format;
+    glGetProgramBinary(program_id, length, nullptr, &format, value.data() + sizeof(format));
+    std::memcpy(value.data(), &format, sizeof(format));
+
+    cache.file.Append(key, value.data(), static_cast<u32>(value.size()));
+    cache.file.Sync();
+    cache.entries[key] = std::move(value);
+}
+
+} // Anonymous namespace
+
+void OpenProgramCache(const std::string& filename) {
+    CloseProgramCache();
+
+    program_cache = std::make_unique<ProgramCache>();
+    ProgramCache* cache = program_cache.get();
+    cache->loaded = std::async(std::launch::async, [cache, filename] {
+        const u32 num_entries = cache->file.OpenAndRead(filename.c_str(), *cache);
+        LOG_INFO(Render_OpenGL, "Loaded %u cached program binaries", num_entries);
+    });
+}
+
+void CloseProgramCache() {
+    if (program_cache) {
+        program_cache->loaded.wait();
+        program_cache->file.Close();
+        program_cache.reset();
+    }
+}
+
+static GLuint CompileProgram(const char* vertex_shader, const char* fragment_shader,
+                             bool retrievable) {
 
     // Create the shaders
     GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
@@ -66,6 +198,9 @@ GLuint LoadProgram(const char* vertex_shader, const char* fragment_shader) {
     GLuint program_id = glCreateProgram();
     glAttachShader(program_id, vertex_shader_id);
     glAttachShader(program_id, fragment_shader_id);
+    if (retrievable) {
+        glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
 
     glLinkProgram(program_id);
 
@@ -96,4 +231,28 @@ GLuint LoadProgram(const char* vertex_shader, const char* fragment_shader) {
     return program_id;
 }
 
+GLuint LoadProgram(const char* vertex_shader, const char* fragment_shader) {
+    ProgramCache* cache = GetProgramCache();
+    if (!cache) {
+        return CompileProgram(vertex_shader, fragment_shader, false);
+    }
+
+    u64 key;
+    GLuint program_id;
+    {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        PrepareProgramCache(*cache);
+        key = GetProgramKey(*cache, vertex_shader, fragment_shader);
+        program_id = LoadCachedProgram(*cache, key);
+    }
+
+    if (program_id == 0) {
+        // Other programs can be loaded while this one compiles
+        program_id = CompileProgram(vertex_shader, fragment_shader, true);
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        StoreProgram(*cache, key, program_id);
+    }
+    return program_id;
+}
+
 } // namespace GLShader
@@ -4,12 +4,26 @@
 
 #pragma once
 
+#include <string>
 #include <glad/glad.h>
 
 namespace GLShader {
 
 /**
- * Utility function to create and compile an OpenGL GLSL shader program (vertex + fragment shader)
+ * Starts reading the program binaries cached in a file on a worker thread, so that the reads don't
+ * block the renderer. From then on, LoadProgram creates programs from their cached binaries when
+ * possible, and adds the programs it compiles to the file. The binaries are tied to the driver
+ * they were created with, and the file to the build of yuzu that wrote it.
+ */
+void OpenProgramCache(const std::string& filename);
+
+/// Closes the program cache file, LoadProgram always compiles programs after this
+void CloseProgramCache();
+
+/**
+ * Utility function to create and compile an OpenGL GLSL shader program (vertex + fragment shader),
+ * or to create it from its cached binary if a program cache is open. Threads with contexts sharing
+ * their objects can load programs concurrently.
  * @param vertex_shader String of the GLSL vertex shader program
  * @param fragment_shader String of the GLSL fragment shader program
  * @returns Handle of the newly created OpenGL shader object
@@ -2,7 +2,9 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <array>
 #include <glad/glad.h>
+#include "common/assert.h"
 #include "common/common_funcs.h"
 #include "common/logging/log.h"
 #include "video_core/renderer_opengl/gl_state.h"
@@ -67,214 +69,333 @@ OpenGLState::OpenGLState() {
     draw.vertex_array = 0;
     draw.vertex_buffer = 0;
     draw.uniform_buffer = 0;
+    draw.pixel_unpack_buffer = 0;
     draw.shader_program = 0;
 
     clip_distance = {};
 }
 
-void OpenGLState::Apply() const {
-    // Culling
-    if (cull.enabled != cur_state.cull.enabled) {
-        if (cull.enabled) {
-            glEnable(GL_CULL_FACE);
-        } else {
-            glDisable(GL_CULL_FACE);
-        }
-    }
-
-    if (cull.mode != cur_state.cull.mode) {
-        glCullFace(cull.mode);
+namespace {
+
+OpenGLState::Stats stats;
+
+/// Number of GL calls it takes to apply each group of state, the calls avoided for clean groups
+constexpr std::array<u32, OpenGLState::NumGroups> GROUP_GL_CALLS{{
+    3,     // Cull
+    3,     // Depth
+    1,     // ColorMask
+    4,     // Stencil
+    5,     // Blend
+    3 * 3, // Textures
+    7 * 2, // Luts
+    7,     // Draw
+    2,     // ClipDistance
+}};
+
+/// Makes the GL calls setting some state if it changed, and counts them as issued or avoided
+template <typename Func>
+void UpdateState(bool changed, Func&& call, u32 num_calls = 1) {
+    if (changed) {
+        call();
+        stats.gl_calls += num_calls;
+    } else {
+        stats.skipped_gl_calls += num_calls;
     }
+}
 
-    if (cull.front_face != cur_state.cull.front_face) {
-        glFrontFace(cull.front_face);
+void SetCapability(GLenum capability, bool enabled) {
+    if (enabled) {
+        glEnable(capability);
+    } else {
+        glDisable(capability);
     }
+}
 
-    // Depth test
-    if (depth.test_enabled != cur_state.depth.test_enabled) {
-        if (depth.test_enabled) {
-            glEnable(GL_DEPTH_TEST);
-        } else {
-            glDisable(GL_DEPTH_TEST);
+} // Anonymous namespace
+
+BitSet32 OpenGLState::GetDirtyGroups() const {
+    BitSet32 dirty_groups;
+
+    dirty_groups[Cull] = cull.enabled != cur_state.cull.enabled ||
+                         cull.mode != cur_state.cull.mode ||
+                         cull.front_face != cur_state.cull.front_face;
+
+    dirty_groups[Depth] = depth.test_enabled != cur_state.depth.test_enabled ||
+                          depth.test_func != cur_state.depth.test_func ||
+                          depth.write_mask != cur_state.depth.write_mask;
+
+    dirty_groups[ColorMask] = color_mask.red_enabled != cur_state.color_mask.red_enabled ||
+                              color_mask.green_enabled != cur_state.color_mask.green_enabled ||
+                              color_mask.blue_enabled != cur_state.color_mask.blue_enabled ||
+                              color_mask.alpha_enabled != cur_state.color_mask.alpha_enabled;
+
+    dirty_groups[Stencil] = stencil.test_enabled != cur_state.stencil.test_enabled ||
+                            stencil.test_func != cur_state.stencil.test_func ||
+                            stencil.test_ref != cur_state.stencil.test_ref ||
+                            stencil.test_mask != cur_state.stencil.test_mask ||
+                            stencil.write_mask != cur_state.stencil.write_mask ||
+                            stencil.action_stencil_fail != cur_state.stencil.action_stencil_fail ||
+                            stencil.action_depth_fail != cur_state.stencil.action_depth_fail ||
+                            stencil.action_depth_pass != cur_state.stencil.action_depth_pass;
+
+    dirty_groups[Blend] = blend.enabled != cur_state.blend.enabled ||
+                          blend.rgb_equation != cur_state.blend.rgb_equation ||
+                          blend.a_equation != cur_state.blend.a_equation ||
+                          blend.src_rgb_func != cur_state.blend.src_rgb_func ||
+                          blend.dst_rgb_func != cur_state.blend.dst_rgb_func ||
+                          blend.src_a_func != cur_state.blend.src_a_func ||
+                          blend.dst_a_func != cur_state.blend.dst_a_func ||
+                          blend.color.red != cur_state.blend.color.red ||
+                          blend.color.green != cur_state.blend.color.green ||
+                          blend.color.blue != cur_state.blend.color.blue ||
+                          blend.color.alpha != cur_state.blend.color.alpha ||
+                          logic_op != cur_state.logic_op;
+
+    for (size_t i = 0; i < ARRAY_SIZE(texture_units); ++i) {
+        if (texture_units[i].texture_2d != cur_state.texture_units[i].texture_2d ||
+            texture_units[i].sampler != cur_state.texture_units[i].sampler) {
+            dirty_groups[Textures] = true;
+            break;
         }
     }
 
-    if (depth.test_func != cur_state.depth.test_func) {
-        glDepthFunc(depth.test_func);
-    }
-
-    // Depth mask
-    if (depth.write_mask != cur_state.depth.write_mask) {
-        glDepthMask(depth.write_mask);
-    }
+    dirty_groups[Luts] =
+        lighting_lut.texture_buffer != cur_state.lighting_lut.texture_buffer ||
+        fog_lut.texture_buffer != cur_state.fog_lut.texture_buffer ||
+        proctex_noise_lut.texture_buffer != cur_state.proctex_noise_lut.texture_buffer ||
+        proctex_color_map.texture_buffer != cur_state.proctex_color_map.texture_buffer ||
+        proctex_alpha_map.texture_buffer != cur_state.proctex_alpha_map.texture_buffer ||
+        proctex_lut.texture_buffer != cur_state.proctex_lut.texture_buffer ||
+        proctex_diff_lut.texture_buffer != cur_state.proctex_diff_lut.texture_buffer;
 
-    // Color mask
-    if (color_mask.red_enabled != cur_state.color_mask.red_enabled ||
-        color_mask.green_enabled != cur_state.color_mask.green_enabled ||
-        color_mask.blue_enabled != cur_state.color_mask.blue_enabled ||
-        color_mask.alpha_enabled != cur_state.color_mask.alpha_enabled) {
-        glColorMask(color_mask.red_enabled, color_mask.green_enabled, color_mask.blue_enabled,
-                    color_mask.alpha_enabled);
-    }
+    dirty_groups[Draw] = draw.read_framebuffer != cur_state.draw.read_framebuffer ||
+                         draw.draw_framebuffer != cur_state.draw.draw_framebuffer ||
+                         draw.vertex_array != cur_state.draw.vertex_array ||
+                         draw.vertex_buffer != cur_state.draw.vertex_buffer ||
+                         draw.uniform_buffer != cur_state.draw.uniform_buffer ||
+                         draw.pixel_unpack_buffer != cur_state.draw.pixel_unpack_buffer ||
+                         draw.shader_program != cur_state.draw.shader_program;
 
-    // Stencil test
-    if (stencil.test_enabled != cur_state.stencil.test_enabled) {
-        if (stencil.test_enabled) {
-            glEnable(GL_STENCIL_TEST);
-        } else {
-            glDisable(GL_STENCIL_TEST);
-        }
-    }
-
-    if (stencil.test_func != cur_state.stencil.test_func ||
-        stencil.test_ref != cur_state.stencil.test_ref ||
-        stencil.test_mask != cur_state.stencil.test_mask) {
-        glStencilFunc(stencil.test_func, stencil.test_ref, stencil.test_mask);
-    }
+    dirty_groups[ClipDistance] = clip_distance != cur_state.clip_distance;
 
-    if (stencil.action_depth_fail != cur_state.stencil.action_depth_fail ||
-        stencil.action_depth_pass != cur_state.stencil.action_depth_pass ||
-        stencil.action_stencil_fail != cur_state.stencil.action_stencil_fail) {
-        glStencilOp(stencil.action_stencil_fail, stencil.action_depth_fail,
-                    stencil.action_depth_pass);
-    }
-
-    // Stencil mask
-    if (stencil.write_mask != cur_state.stencil.write_mask) {
-        glStencilMask(stencil.write_mask);
-    }
+    return dirty_groups;
+}
 
-    // Blending
-    if (blend.enabled != cur_state.blend.enabled) {
-        if (blend.enabled) {
-            glEnable(GL_BLEND);
-
-            cur_state.logic_op = GL_COPY;
-            glLogicOp(cur_state.logic_op);
-            glDisable(GL_COLOR_LOGIC_OP);
-        } else {
-            glDisable(GL_BLEND);
-            glEnable(GL_COLOR_LOGIC_OP);
+void OpenGLState::Apply() const {
+    const BitSet32 dirty_groups = GetDirtyGroups();
+    for (int group = 0; group < NumGroups; ++group) {
+        if (!dirty_groups[group]) {
+            stats.skipped_gl_calls += GROUP_GL_CALLS[group];
         }
     }
 
-    if (blend.color.red != cur_state.blend.color.red ||
-        blend.color.green != cur_state.blend.color.green ||
-        blend.color.blue != cur_state.blend.color.blue ||
-        blend.color.alpha != cur_state.blend.color.alpha) {
-        glBlendColor(blend.color.red, blend.color.green, blend.color.blue, blend.color.alpha);
-    }
-
-    if (blend.src_rgb_func != cur_state.blend.src_rgb_func ||
-        blend.dst_rgb_func != cur_state.blend.dst_rgb_func ||
-        blend.src_a_func != cur_state.blend.src_a_func ||
-        blend.dst_a_func != cur_state.blend.dst_a_func) {
-        glBlendFuncSeparate(blend.src_rgb_func, blend.dst_rgb_func, blend.src_a_func,
-                            blend.dst_a_func);
+    for (const int group : dirty_groups) {
+        switch (static_cast<Group>(group)) {
+        case Cull:
+            ApplyCull();
+            break;
+        case Depth:
+            ApplyDepth();
+            break;
+        case ColorMask:
+            ApplyColorMask();
+            break;
+        case Stencil:
+            ApplyStencil();
+            break;
+        case Blend:
+            ApplyBlend();
+            break;
+        case Textures:
+            ApplyTextures();
+            break;
+        case Luts:
+            ApplyLuts();
+            break;
+        case Draw:
+            ApplyDraw();
+            break;
+        case ClipDistance:
+            ApplyClipDistance();
+            break;
+        default:
+            UNREACHABLE();
+        }
     }
+}
 
-    if (blend.rgb_equation != cur_state.blend.rgb_equation ||
-        blend.a_equation != cur_state.blend.a_equation) {
-        glBlendEquationSeparate(blend.rgb_equation, blend.a_equation);
-    }
+void OpenGLState::ApplyCull() const {
+    UpdateState(cull.enabled != cur_state.cull.enabled,
+                [&] { SetCapability(GL_CULL_FACE, cull.enabled); });
+    UpdateState(cull.mode != cur_state.cull.mode, [&] { glCullFace(cull.mode); });
+    UpdateState(cull.front_face != cur_state.cull.front_face,
+                [&] { glFrontFace(cull.front_face); });
+    cur_state.cull = cull;
+}
 
-    if (logic_op != cur_state.logic_op) {
-        glLogicOp(logic_op);
-    }
+void OpenGLState::ApplyDepth() const {
+    UpdateState(depth.test_enabled != cur_state.depth.test_enabled,
+                [&] { SetCapability(GL_DEPTH_TEST, depth.test_enabled); });
+    UpdateState(depth.test_func != cur_state.depth.test_func,
+                [&] { glDepthFunc(depth.test_func); });
+    UpdateState(depth.write_mask != cur_state.depth.write_mask,
+                [&] { glDepthMask(depth.write_mask); });
+    cur_state.depth = depth;
+}
 
-    // Textures
-    for (unsigned i = 0; i < ARRAY_SIZE(texture_units); ++i) {
-        if (texture_units[i].texture_2d != cur_state.texture_units[i].texture_2d) {
-            glActiveTexture(TextureUnits::PicaTexture(i).Enum());
-            glBindTexture(GL_TEXTURE_2D, texture_units[i].texture_2d);
-        }
-        if (texture_units[i].sampler != cur_state.texture_units[i].sampler) {
-            glBindSampler(i, texture_units[i].sampler);
-        }
-    }
+void OpenGLState::ApplyColorMask() const {
+    // The group is only dirty if one of the components changed
+    glColorMask(color_mask.red_enabled, color_mask.green_enabled, color_mask.blue_enabled,
+                color_mask.alpha_enabled);
+    ++stats.gl_calls;
+    cur_state.color_mask = color_mask;
+}
 
-    // Lighting LUTs
-    if (lighting_lut.texture_buffer != cur_state.lighting_lut.texture_buffer) {
-        glActiveTexture(TextureUnits::LightingLUT.Enum());
-        glBindTexture(GL_TEXTURE_BUFFER, cur_state.lighting_lut.texture_buffer);
-    }
+void OpenGLState::ApplyStencil() const {
+    UpdateState(stencil.test_enabled != cur_state.stencil.test_enabled,
+                [&] { SetCapability(GL_STENCIL_TEST, stencil.test_enabled); });
 
-    // Fog LUT
-    if (fog_lut.texture_buffer != cur_state.fog_lut.texture_buffer) {
-        glActiveTexture(TextureUnits::FogLUT.Enum());
-        glBindTexture(GL_TEXTURE_BUFFER, fog_lut.texture_buffer);
-    }
+    UpdateState(stencil.test_func != cur_state.stencil.test_func ||
+                    stencil.test_ref != cur_state.stencil.test_ref ||
+                    stencil.test_mask != cur_state.stencil.test_mask,
+                [&] { glStencilFunc(stencil.test_func, stencil.test_ref, stencil.test_mask); });
 
-    // ProcTex Noise LUT
-    if (proctex_noise_lut.texture_buffer != cur_state.proctex_noise_lut.texture_buffer) {
-        glActiveTexture(TextureUnits::ProcTexNoiseLUT.Enum());
-        glBindTexture(GL_TEXTURE_BUFFER, proctex_noise_lut.texture_buffer);
-    }
+    UpdateState(stencil.action_depth_fail != cur_state.stencil.action_depth_fail ||
+                    stencil.action_depth_pass != cur_state.stencil.action_depth_pass ||
+                    stencil.action_stencil_fail != cur_state.stencil.action_stencil_fail,
+                [&] {
+                    glStencilOp(stencil.action_stencil_fail, stencil.action_depth_fail,
+                                stencil.action_depth_pass);
+                });
 
-    // ProcTex Color Map
-    if (proctex_color_map.texture_buffer != cur_state.proctex_color_map.texture_buffer) {
-        glActiveTexture(TextureUnits::ProcTexColorMap.Enum());
-        glBindTexture(GL_TEXTURE_BUFFER, proctex_color_map.texture_buffer);
-    }
+    UpdateState(stencil.write_mask != cur_state.stencil.write_mask,
+                [&] { glStencilMask(stencil.write_mask); });
 
-    // ProcTex Alpha Map
-    if (proctex_alpha_map.texture_buffer != cur_state.proctex_alpha_map.texture_buffer) {
-        glActiveTexture(TextureUnits::ProcTexAlphaMap.Enum());
-        glBindTexture(GL_TEXTURE_BUFFER, proctex_alpha_map.texture_buffer);
-    }
+    cur_state.stencil = stencil;
+}
 
-    // ProcTex LUT
-    if (proctex_lut.texture_buffer != cur_state.proctex_lut.texture_buffer) {
-        glActiveTexture(TextureUnits::ProcTexLUT.Enum());
-        glBindTexture(GL_TEXTURE_BUFFER, proctex_lut.texture_buffer);
-    }
+void OpenGLState::ApplyBlend() const {
+    // Blending and logic ops are exclusive, toggling one takes two calls
+    UpdateState(blend.enabled != cur_state.blend.enabled,
+                [&] {
+                    if (blend.enabled) {
+                        glEnable(GL_BLEND);
+
+                        cur_state.logic_op = GL_COPY;
+                        glLogicOp(cur_state.logic_op);
+                        glDisable(GL_COLOR_LOGIC_OP);
+                        ++stats.gl_calls;
+                    } else {
+                        glDisable(GL_BLEND);
+                        glEnable(GL_COLOR_LOGIC_OP);
+                    }
+                },
+                2);
+
+    UpdateState(blend.color.red != cur_state.blend.color.red ||
+                    blend.color.green != cur_state.blend.color.green ||
+                    blend.color.blue != cur_state.blend.color.blue ||
+                    blend.color.alpha != cur_state.blend.color.alpha,
+                [&] {
+                    glBlendColor(blend.color.red, blend.color.green, blend.color.blue,
+                                 blend.color.alpha);
+                });
+
+    UpdateState(blend.src_rgb_func != cur_state.blend.src_rgb_func ||
+                    blend.dst_rgb_func != cur_state.blend.dst_rgb_func ||
+                    blend.src_a_func != cur_state.blend.src_a_func ||
+                    blend.dst_a_func != cur_state.blend.dst_a_func,
+                [&] {
+                    glBlendFuncSeparate(blend.src_rgb_func, blend.dst_rgb_func, blend.src_a_func,
+                                        blend.dst_a_func);
+                });
+
+    UpdateState(blend.rgb_equation != cur_state.blend.rgb_equation ||
+                    blend.a_equation != cur_state.blend.a_equation,
+                [&] { glBlendEquationSeparate(blend.rgb_equation, blend.a_equation); });
+
+    // Enabling blending resets the logic op, so this is compared after it
+    UpdateState(logic_op != cur_state.logic_op, [&] { glLogicOp(logic_op); });
+
+    cur_state.blend = blend;
+    cur_state.logic_op = logic_op;
+}
 
-    // ProcTex Diff LUT
-    if (proctex_diff_lut.texture_buffer != cur_state.proctex_diff_lut.texture_buffer) {
-        glActiveTexture(TextureUnits::ProcTexDiffLUT.Enum());
-        glBindTexture(GL_TEXTURE_BUFFER, proctex_diff_lut.texture_buffer);
-    }
+void OpenGLState::ApplyTextures() const {
+    for (unsigned i = 0; i < ARRAY_SIZE(texture_units); ++i) {
+        UpdateState(texture_units[i].texture_2d != cur_state.texture_units[i].texture_2d,
+                    [&] {
+                        glActiveTexture(TextureUnits::PicaTexture(i).Enum());
+                        glBindTexture(GL_TEXTURE_2D, texture_units[i].texture_2d);
+                    },
+                    2);
 
-    // Framebuffer
-    if (draw.read_framebuffer != cur_state.draw.read_framebuffer) {
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, draw.read_framebuffer);
-    }
-    if (draw.draw_framebuffer != cur_state.draw.draw_framebuffer) {
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw.draw_framebuffer);
-    }
+        UpdateState(texture_units[i].sampler != cur_state.texture_units[i].sampler,
+                    [&] { glBindSampler(i, texture_units[i].sampler); });
 
-    // Vertex array
-    if (draw.vertex_array != cur_state.draw.vertex_array) {
-        glBindVertexArray(draw.vertex_array);
+        cur_state.texture_units[i] = texture_units[i];
     }
+}
 
-    // Vertex buffer
-    if (draw.vertex_buffer != cur_state.draw.vertex_buffer) {
-        glBindBuffer(GL_ARRAY_BUFFER, draw.vertex_buffer);
-    }
+/// Binds a LUT texture buffer to its texture unit if it changed
+static void ApplyLut(TextureUnits::TextureUnit unit, GLuint texture_buffer,
+                     GLuint& cur_texture_buffer) {
+    UpdateState(texture_buffer != cur_texture_buffer,
+                [&] {
+                    glActiveTexture(unit.Enum());
+                    glBindTexture(GL_TEXTURE_BUFFER, texture_buffer);
+                },
+                2);
+    cur_texture_buffer = texture_buffer;
+}
 
-    // Uniform buffer
-    if (draw.uniform_buffer != cur_state.draw.uniform_buffer) {
-        glBindBuffer(GL_UNIFORM_BUFFER, draw.uniform_buffer);
-    }
+void OpenGLState::ApplyLuts() const {
+    ApplyLut(TextureUnits::LightingLUT, lighting_lut.texture_buffer,
+             cur_state.lighting_lut.texture_buffer);
+    ApplyLut(TextureUnits::FogLUT, fog_lut.texture_buffer, cur_state.fog_lut.texture_buffer);
+    ApplyLut(TextureUnits::ProcTexNoiseLUT, proctex_noise_lut.texture_buffer,
+             cur_state.proctex_noise_lut.texture_buffer);
+    ApplyLut(TextureUnits::ProcTexColorMap, proctex_color_map.texture_buffer,
+             cur_state.proctex_color_map.texture_buffer);
+    ApplyLut(TextureUnits::ProcTexAlphaMap, proctex_alpha_map.texture_buffer,
+             cur_state.proctex_alpha_map.texture_buffer);
+    ApplyLut(TextureUnits::ProcTexLUT, proctex_lut.texture_buffer,
+             cur_state.proctex_lut.texture_buffer);
+    ApplyLut(TextureUnits::ProcTexDiffLUT, proctex_diff_lut.texture_buffer,
+             cur_state.proctex_diff_lut.texture_buffer);
+}
 
-    // Shader program
-    if (draw.shader_program != cur_state.draw.shader_program) {
-        glUseProgram(draw.shader_program);
-    }
+void OpenGLState::ApplyDraw() const {
+    UpdateState(draw.read_framebuffer != cur_state.draw.read_framebuffer,
+                [&] { glBindFramebuffer(GL_READ_FRAMEBUFFER, draw.read_framebuffer); });
+    UpdateState(draw.draw_framebuffer != cur_state.draw.draw_framebuffer,
+                [&] { glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw.draw_framebuffer); });
+    UpdateState(draw.vertex_array != cur_state.draw.vertex_array,
+                [&] { glBindVertexArray(draw.vertex_array); });
+    UpdateState(draw.vertex_buffer != cur_state.draw.vertex_buffer,
+                [&] { glBindBuffer(GL_ARRAY_BUFFER, draw.vertex_buffer); });
+    UpdateState(draw.uniform_buffer != cur_state.draw.uniform_buffer,
+                [&] { glBindBuffer(GL_UNIFORM_BUFFER, draw.uniform_buffer); });
+    UpdateState(draw.pixel_unpack_buffer != cur_state.draw.pixel_unpack_buffer,
+                [&] { glBindBuffer(GL_PIXEL_UNPACK_BUFFER, draw.pixel_unpack_buffer); });
+    UpdateState(draw.shader_program != cur_state.draw.shader_program,
+                [&] { glUseProgram(draw.shader_program); });
+    cur_state.draw = draw;
+}
 
-    // Clip distance
+void OpenGLState::ApplyClipDistance() const {
     for (size_t i = 0; i < clip_distance.size(); ++i) {
-        if (clip_distance[i] != cur_state.clip_distance[i]) {
-            if (clip_distance[i]) {
-                glEnable(GL_CLIP_DISTANCE0 + static_cast<GLenum>(i));
-            } else {
-                glDisable(GL_CLIP_DISTANCE0 + static_cast<GLenum>(i));
-            }
-        }
+        UpdateState(clip_distance[i] != cur_state.clip_distance[i], [&] {
+            SetCapability(GL_CLIP_DISTANCE0 + static_cast<GLenum>(i), clip_distance[i]);
+        });
     }
+    cur_state.clip_distance = clip_distance;
+}
 
-    cur_state = *this;
+OpenGLState::Stats OpenGLState::ResetStats() {
+    const Stats result = stats;
+    stats = {};
+    return result;
 }
 
 void OpenGLState::ResetTexture(GLuint handle) {
@@ -320,6 +441,9 @@ void OpenGLState::ResetBuffer(GLuint handle) {
     if (cur_state.draw.uniform_buffer == handle) {
         cur_state.draw.uniform_buffer = 0;
     }
+    if (cur_state.draw.pixel_unpack_buffer == handle) {
+        cur_state.draw.pixel_unpack_buffer = 0;
+    }
 }
 
 void OpenGLState::ResetVertexArray(GLuint handle) {
@@ -6,6 +6,8 @@
 
 #include <array>
 #include <glad/glad.h>
+#include "common/bit_set.h"
+#include "common/common_types.h"
 
 namespace TextureUnits {
 
@@ -32,6 +34,26 @@ constexpr TextureUnit ProcTexDiffLUT{9};
 
 class OpenGLState {
 public:
+    /// Groups of related state. Apply() finds the groups that changed, and only visits those.
+    enum Group : u32 {
+        Cull,
+        Depth,
+        ColorMask,
+        Stencil,
+        Blend, ///< Includes the logic op, which is reset when blending is enabled
+        Textures,
+        Luts,
+        Draw,
+        ClipDistance,
+        NumGroups,
+    };
+
+    /// Number of GL calls made by Apply(), and of calls it avoided because the state was the same
+    struct Stats {
+        u32 gl_calls = 0;
+        u32 skipped_gl_calls = 0;
+    };
+
     struct {
         bool enabled;      // GL_CULL_FACE
         GLenum mode;       // GL_CULL_FACE_MODE
@@ -116,12 +138,13 @@ public:
     } proctex_diff_lut;
 
     struct {
-        GLuint read_framebuffer; // GL_READ_FRAMEBUFFER_BINDING
-        GLuint draw_framebuffer; // GL_DRAW_FRAMEBUFFER_BINDING
-        GLuint vertex_array;     // GL_VERTEX_ARRAY_BINDING
-        GLuint vertex_buffer;    // GL_ARRAY_BUFFER_BINDING
-        GLuint uniform_buffer;   // GL_UNIFORM_BUFFER_BINDING
-        GLuint shader_program;   // GL_CURRENT_PROGRAM
+        GLuint read_framebuffer;    // GL_READ_FRAMEBUFFER_BINDING
+        GLuint draw_framebuffer;    // GL_DRAW_FRAMEBUFFER_BINDING
+        GLuint vertex_array;        // GL_VERTEX_ARRAY_BINDING
+        GLuint vertex_buffer;       // GL_ARRAY_BUFFER_BINDING
+        GLuint uniform_buffer;      // GL_UNIFORM_BUFFER_BINDING
+        GLuint pixel_unpack_buffer; // GL_PIXEL_UNPACK_BUFFER_BINDING
+        GLuint shader_program;      // GL_CURRENT_PROGRAM
     } draw;
 
     std::array<bool, 2> clip_distance; // GL_CLIP_DISTANCE
@@ -144,6 +167,22 @@ public:
     static void ResetVertexArray(GLuint handle);
     static void ResetFramebuffer(GLuint handle);
 
+    /// Returns the statistics of all the Apply() calls since the last reset, and resets them
+    static Stats ResetStats();
+
 private:
+    /// Returns the groups in which this state differs from the current one
+    BitSet32 GetDirtyGroups() const;
+
+    void ApplyCull() const;
+    void ApplyDepth() const;
+    void ApplyColorMask() const;
+    void ApplyStencil() const;
+    void ApplyBlend() const;
+    void ApplyTextures() const;
+    void ApplyLuts() const;
+    void ApplyDraw() const;
+    void ApplyClipDistance() const;
+
     static OpenGLState cur_state;
 };
@@ -0,0 +1,145 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <glad/glad.h>
+#include "common/common_types.h"
+#include "common/logging/log.h"
+#include "video_core/maxwell_3d.h"
+
+namespace MaxwellToGL {
+
+using Regs = Tegra::Maxwell3DRegs;
+
+inline GLenum ComparisonOp(Regs::ComparisonOp comparison) {
+    switch (comparison) {
+    case Regs::ComparisonOp::Never:
+    case Regs::ComparisonOp::NeverOld:
+        return GL_NEVER;
+    case Regs::ComparisonOp::Less:
+    case Regs::ComparisonOp::LessOld:
+        return GL_LESS;
+    case Regs::ComparisonOp::Equal:
+    case Regs::ComparisonOp::EqualOld:
+        return GL_EQUAL;
+    case Regs::ComparisonOp::LessEqual:
+    case Regs::ComparisonOp::LessEqualOld:
+        return GL_LEQUAL;
+    case Regs::ComparisonOp::Greater:
+    case Regs::ComparisonOp::GreaterOld:
+        return GL_GREATER;
+    case Regs::ComparisonOp::NotEqual:
+    case Regs::ComparisonOp::NotEqualOld:
+        return GL_NOTEQUAL;
+    case Regs::ComparisonOp::GreaterEqual:
+    case Regs::ComparisonOp::GreaterEqualOld:
+        return GL_GEQUAL;
+    case Regs::ComparisonOp::Always:
+    case Regs::ComparisonOp::AlwaysOld:
+        return GL_ALWAYS;
+    }
+    LOG_ERROR(Render_OpenGL, "Unknown comparison op %u", static_cast<u32>(comparison));
+    return GL_ALWAYS;
+}
+
+inline GLenum BlendEquation(Regs::Blend::Equation equation) {
+    switch (equation) {
+    case Regs::Blend::Equation::Add:
+    case Regs::Blend::Equation::AddGL:
+        return GL_FUNC_ADD;
+    case Regs::Blend::Equation::Subtract:
+    case Regs::Blend::Equation::SubtractGL:
+        return GL_FUNC_SUBTRACT;
+    case Regs::Blend::Equation::ReverseSubtract:
+    case Regs::Blend::Equation::ReverseSubtractGL:
+        return GL_FUNC_REVERSE_SUBTRACT;
+    case Regs::Blend::Equation::Min:
+    case Regs::Blend::Equation::MinGL:
+        return GL_MIN;
+    case Regs::Blend::Equation::Max:
+    case Regs::Blend::Equation::MaxGL:
+        return GL_MAX;
+    }
+    LOG_ERROR(Render_OpenGL, "Unknown blend equation %u", static_cast<u32>(equation));
+    return GL_FUNC_ADD;
+}
+
+inline GLenum BlendFactor(Regs::Blend::Factor factor) {
+    switch (factor) {
+    case Regs::Blend::Factor::Zero:
+    case Regs::Blend::Factor::ZeroGL:
+        return GL_ZERO;
+    case Regs::Blend::Factor::One:
+    case Regs::Blend::Factor::OneGL:
+        return GL_ONE;
+    case Regs::Blend::Factor::SourceColor:
+    case Regs::Blend::Factor::SourceColorGL:
+        return GL_SRC_COLOR;
+    case Regs::Blend::Factor::OneMinusSourceColor:
+    case Regs::Blend::Factor::OneMinusSourceColorGL:
+        return GL_ONE_MINUS_SRC_COLOR;
+    case Regs::Blend::Factor::SourceAlpha:
+    case Regs::Blend::Factor::SourceAlphaGL:
+        return GL_SRC_ALPHA;
+    case Regs::Blend::Factor::OneMinusSourceAlpha:
+    case Regs::Blend::Factor::OneMinusSourceAlphaGL:
+        return GL_ONE_MINUS_SRC_ALPHA;
+    case Regs::Blend::Factor::DestAlpha:
+    case Regs::Blend::Factor::DestAlphaGL:
+        return GL_DST_ALPHA;
+    case Regs::Blend::Factor::OneMinusDestAlpha:
+    case Regs::Blend::Factor::OneMinusDestAlphaGL:
+        return GL_ONE_MINUS_DST_ALPHA;
+    case Regs::Blend::Factor::DestColor:
+    case Regs::Blend::Factor::DestColorGL:
+        return GL_DST_COLOR;
+    case Regs::Blend::Factor::OneMinusDestColor:
+    case Regs::Blend::Factor::OneMinusDestColorGL:
+        return GL_ONE_MINUS_DST_COLOR;
+    case Regs::Blend::Factor::SourceAlphaSaturate:
+    case Regs::Blend::Factor::SourceAlphaSaturateGL:
+        return GL_SRC_ALPHA_SATURATE;
+    case Regs::Blend::Factor::ConstantColor:
+    case Regs::Blend::Factor::ConstantColorGL:
+        return GL_CONSTANT_COLOR;
+    case Regs::Blend::Factor::OneMinusConstantColor:
+    case Regs::Blend::Factor::OneMinusConstantColorGL:
+        return GL_ONE_MINUS_CONSTANT_COLOR;
+    case Regs::Blend::Factor::ConstantAlpha:
+    case Regs::Blend::Factor::ConstantAlphaGL:
+        return GL_CONSTANT_ALPHA;
+    case Regs::Blend::Factor::OneMinusConstantAlpha:
+    case Regs::Blend::Factor::OneMinusConstantAlphaGL:
+        return GL_ONE_MINUS_CONSTANT_ALPHA;
+    }
+    LOG_ERROR(Render_OpenGL, "Unknown blend factor %u", static_cast<u32>(factor));
+    return GL_ONE;
+}
+
+inline GLenum CullFace(Regs::CullFace cull_face) {
+    switch (cull_face) {
+    case Regs::CullFace::Front:
+        return GL_FRONT;
+    case Regs::CullFace::Back:
+        return GL_BACK;
+    case Regs::CullFace::FrontAndBack:
+        return GL_FRONT_AND_BACK;
+    }
+    LOG_ERROR(Render_OpenGL, "Unknown cull face %u", static_cast<u32>(cull_face));
+    return GL_BACK;
+}
+
+inline GLenum FrontFace(Regs::FrontFace front_face) {
+    switch (front_face) {
+    case Regs::FrontFace::ClockWise:
+        return GL_CW;
+    case Regs::FrontFace::CounterClockWise:
+        return GL_CCW;
+    }
+    LOG_ERROR(Render_OpenGL, "Unknown front face %u", static_cast<u32>(front_face));
+    return GL_CCW;
+}
+
+} // namespace MaxwellToGL
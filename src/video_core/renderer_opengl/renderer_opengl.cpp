@@ -3,14 +3,21 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
+#include <iterator>
 #include <memory>
+#include <string>
 #include <glad/glad.h>
 #include "common/assert.h"
 #include "common/bit_field.h"
+#include "common/file_util.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
+#include "common/microprofile.h"
+#include "common/thread.h"
 #include "core/core.h"
 #include "core/core_timing.h"
 #include "core/frontend/emu_window.h"
@@ -18,7 +25,9 @@
 #include "core/hw/lcd.h"
 #include "core/memory.h"
 #include "core/settings.h"
-#include "core/tracer/recorder.h"
+#include "video_core/block_linear.h"
+#include "video_core/renderer_opengl/gl_shader_util.h"
+#include "video_core/renderer_opengl/maxwell_to_gl.h"
 #include "video_core/renderer_opengl/renderer_opengl.h"
 #include "video_core/video_core.h"
 
@@ -60,6 +69,52 @@ void main() {
 }
 )";
 
+static const char unswizzle_vertex_shader[] = R"(
+#version 150 core
+
+void main() {
+    // Single triangle covering the whole viewport
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+// Writes each texel of a layer texture from the block-linear framebuffer, see block_linear.h for
+// the layout. Only 32-bit pixel formats are supported.
+static const char unswizzle_fragment_shader[] = R"(
+#version 150 core
+
+out vec4 color;
+
+uniform usamplerBuffer tiled_data;
+// Offset of the framebuffer in tiled_data, in words
+uniform int tiled_offset;
+uniform int height;
+uniform int blocks_per_row;
+uniform int block_height;
+
+void main() {
+    // Textures are stored bottom-up
+    int x = int(gl_FragCoord.x) * 4;
+    int y = height - 1 - int(gl_FragCoord.y);
+
+    int gob_row = y / 8;
+    int block = (gob_row / block_height) * blocks_per_row + x / 64;
+    int offset = (block * block_height + gob_row % block_height) * 512 + ((x % 64) / 32) * 256 +
+                 ((y % 8) / 2) * 64 + ((x % 32) / 16) * 32 + (y % 2) * 16 + x % 16;
+
+    // Same channel order as the textures uploaded from the CPU
+    uint word = texelFetch(tiled_data, tiled_offset + offset / 4).r;
+    color = (vec4(uvec4(word, word >> 8, word >> 16, word >> 24) & 0xFFu) / 255.0).abgr;
+}
+)";
+
+/// Texture unit the buffer texture of the GPU deswizzling is bound to
+constexpr GLint UNSWIZZLE_TEXTURE_UNIT = 1;
+
+/// Number of threads compiling programs in the background, each has its own GL context
+constexpr size_t NUM_SHADER_COMPILE_WORKERS = 2;
+
 /**
  * Vertex structure that the drawn screen rectangles are composed of.
  */
@@ -94,165 +149,386 @@ static std::array<GLfloat, 3 * 2> MakeOrthographicMatrix(const float width, cons
     return matrix;
 }
 
-RendererOpenGL::RendererOpenGL() = default;
-RendererOpenGL::~RendererOpenGL() = default;
+/// Number of frames the emulation may submit ahead of the presentation, read when the renderer
+/// is created and when the settings are applied
+static size_t GetPresentAheadDepth() {
+    // Waiting for the previous frame to be presented ties the emulation to the refreshes
+    if (Settings::values.use_low_latency_mode) {
+        return 1;
+    }
+    return static_cast<size_t>(MathUtil::Clamp(Settings::values.present_ahead_depth, 1, 3));
+}
+
+#if MICROPROFILE_ENABLED
+/// Timestamp queries of the profiler's GPU scopes, only used on the presentation thread
+static constexpr u32 NUM_PROFILER_QUERIES = 8192;
+static std::array<GLuint, NUM_PROFILER_QUERIES> profiler_queries;
+static u32 next_profiler_query = 0;
+
+static const MicroProfileGpuTimers profiler_gpu_timers{
+    [] {
+        const u32 key = next_profiler_query;
+        next_profiler_query = (next_profiler_query + 1) % NUM_PROFILER_QUERIES;
+        glQueryCounter(profiler_queries[key], GL_TIMESTAMP);
+        return key;
+    },
+    [](u32 key) {
+        GLuint64 result = 0;
+        glGetQueryObjectui64v(profiler_queries[key], GL_QUERY_RESULT, &result);
+        return static_cast<u64>(result);
+    },
+};
+#endif
+
+MICROPROFILE_DEFINE(OpenGL_SwapBuffers, "OpenGL", "Swap Buffers", MP_RGB(100, 100, 255));
+MICROPROFILE_DEFINE(OpenGL_PresentFrame, "OpenGL", "Present Frame", MP_RGB(70, 70, 200));
+MICROPROFILE_DEFINE(OpenGL_Draws, "OpenGL", "Execute Draws", MP_RGB(100, 140, 255));
+MICROPROFILE_DEFINE(OpenGL_LoadFB, "OpenGL", "Load Framebuffer", MP_RGB(140, 140, 255));
+MICROPROFILE_DEFINE_GPU(GPU_PresentFrame, "Present Frame", MP_RGB(70, 70, 200));
+MICROPROFILE_DEFINE_GPU(GPU_LoadFB, "Load Framebuffer", MP_RGB(140, 140, 255));
+MICROPROFILE_DEFINE_GPU(GPU_UnswizzleFB, "Unswizzle Framebuffer", MP_RGB(180, 120, 255));
+MICROPROFILE_DEFINE_GPU(GPU_DrawScreens, "Draw Screens", MP_RGB(100, 180, 255));
+
+RendererOpenGL::RendererOpenGL() : frame_queue(GetPresentAheadDepth()) {}
+
+RendererOpenGL::~RendererOpenGL() {
+    ShutDown();
+}
 
 /// Swap buffers (render frame)
-void RendererOpenGL::SwapBuffers(boost::optional<const FramebufferInfo&> framebuffer_info) {
-    // Maintain the rasterizer's state as a priority
-    OpenGLState prev_state = OpenGLState::GetCurState();
+void RendererOpenGL::SwapBuffers(const std::vector<LayerInfo>& layers) {
+    MICROPROFILE_SCOPE(OpenGL_SwapBuffers);
+
+    // Waits for the presentation thread if it is present_ahead_depth frames behind
+    VideoCore::Frame* frame = frame_queue.AcquireFreeFrame();
+    if (frame != nullptr) {
+        const auto copy_start = std::chrono::steady_clock::now();
+        CopyFrame(layers, *frame);
+        const auto copy_time = std::chrono::steady_clock::now() - copy_start;
+        Core::System::GetInstance().perf_stats.AddFramePhaseTime(
+            Core::PerfStats::FramePhase::Composition, copy_time);
+        frame->input_time = Core::System::GetInstance().perf_stats.GetFrameInputTime();
+        frame_queue.SubmitFrame(frame);
+    }
+
+    m_current_frame++;
+
+    Core::System::GetInstance().perf_stats.EndSystemFrame();
+
+    render_window->PollEvents();
+
+    Core::System::GetInstance().frame_limiter.DoFrameLimiting(CoreTiming::GetGlobalTimeUs());
+    Core::System::GetInstance().perf_stats.BeginSystemFrame();
+
+    RefreshRasterizerSetting();
+}
+
+void RendererOpenGL::SubmitDraws(Tegra::Maxwell3DDrawBatch batch) {
+    std::lock_guard<std::mutex> lock(draw_batch_mutex);
+    pending_draw_batches.push_back(std::move(batch));
+}
+
+static bool IsSameFramebuffer(const RendererBase::FramebufferInfo& lhs,
+                              const RendererBase::FramebufferInfo& rhs) {
+    return lhs.address == rhs.address && lhs.offset == rhs.offset && lhs.width == rhs.width &&
+           lhs.height == rhs.height && lhs.stride == rhs.stride &&
+           lhs.pixel_format == rhs.pixel_format;
+}
+
+void RendererOpenGL::CopyFrame(const std::vector<LayerInfo>& layers, VideoCore::Frame& frame) {
+    frame.layers.resize(layers.size());
+
+    // Forget the layers that aren't shown anymore, the presentation thread frees their textures
+    for (auto itr = submitted_framebuffers.begin(); itr != submitted_framebuffers.end();) {
+        const bool is_shown =
+            std::any_of(layers.begin(), layers.end(),
+                        [&](const LayerInfo& layer) { return layer.id == itr->first; });
+        itr = is_shown ? std::next(itr) : submitted_framebuffers.erase(itr);
+    }
+
+    for (size_t index = 0; index < layers.size(); ++index) {
+        VideoCore::Frame::Layer& frame_layer = frame.layers[index];
+        frame_layer.info = layers[index];
+        if (frame_layer.info.framebuffer == boost::none) {
+            continue;
+        }
+
+        // The guest may reuse the buffer as soon as the composition is done, so its contents have
+        // to be copied now. They are deswizzled later, on the presentation thread.
+        const FramebufferInfo& framebuffer_info = *frame_layer.info.framebuffer;
+        const size_t size{VideoCore::BlockLinear::GetSurfaceSize(
+            framebuffer_info.width, framebuffer_info.height,
+            FramebufferInfo::BytesPerPixel(framebuffer_info.pixel_format),
+            VideoCore::BlockLinear::FRAMEBUFFER_BLOCK_HEIGHT)};
+        auto itr = submitted_framebuffers.find(frame_layer.info.id);
+
+        // Static content, like menus or a paused game, is presented again and again without
+        // changes. Framebuffers the guest didn't write to aren't even copied.
+        const VideoCore::SurfaceParams surface_params{
+            framebuffer_info.address, framebuffer_info.width,
+            framebuffer_info.height,  framebuffer_info.stride,
+            static_cast<u32>(framebuffer_info.pixel_format), size};
+        const bool is_modified =
+            surface_cache.AcquireSurface(Kernel::g_current_process, surface_params);
+        if (!is_modified && itr != submitted_framebuffers.end() &&
+            IsSameFramebuffer(itr->second.info, framebuffer_info)) {
+            frame_layer.info.framebuffer = boost::none;
+            continue;
+        }
+
+        frame_layer.data.resize(size);
+        Memory::RasterizerFlushRegion(framebuffer_info.address, size);
+        Memory::ReadBlock(framebuffer_info.address, frame_layer.data.data(), size);
+
+        // Writes that left the contents as they were are caught by the hash, which is a lot
+        // cheaper than deswizzling and uploading the copy
+        const u64 hash{Common::ComputeFastHash64(frame_layer.data.data(), size)};
+        if (itr != submitted_framebuffers.end() && itr->second.hash == hash &&
+            IsSameFramebuffer(itr->second.info, framebuffer_info)) {
+            frame_layer.info.framebuffer = boost::none;
+            continue;
+        }
+        submitted_framebuffers[frame_layer.info.id] = {framebuffer_info, hash};
+    }
+    surface_cache.EndFrame();
+}
+
+void RendererOpenGL::PresentLoop() {
+    MicroProfileOnThreadCreate("PresentThread");
+    Common::PinCurrentHostThread(Common::HostThread::Render);
+
+    render_window->MakeCurrent();
+
+#if MICROPROFILE_ENABLED
+    // This thread owns the context, so it is the one entering the GPU scopes
+    glGenQueries(NUM_PROFILER_QUERIES, profiler_queries.data());
+    MicroProfileSetGpuTimers(&profiler_gpu_timers);
+#endif
+
+    while (VideoCore::Frame* frame = frame_queue.AcquirePresentFrame()) {
+        // The draws submitted before the frame are executed before it is presented
+        ExecuteDraws();
+        PresentFrame(*frame);
+        frame_queue.ReleasePresentFrame(frame);
+
+        // A profiler frame is a frame shown on the host display
+        MicroProfileFlip();
+    }
+
+#if MICROPROFILE_ENABLED
+    MicroProfileSetGpuTimers(nullptr);
+    glDeleteQueries(NUM_PROFILER_QUERIES, profiler_queries.data());
+#endif
+
+    render_window->DoneCurrent();
+
+#if MICROPROFILE_ENABLED
+    MicroProfileOnThreadExit();
+#endif
+}
+
+void RendererOpenGL::PresentFrame(const VideoCore::Frame& frame) {
+    MICROPROFILE_SCOPE(OpenGL_PresentFrame);
+    MICROPROFILE_SCOPEGPU(GPU_PresentFrame);
+
+    using std::chrono::steady_clock;
+    auto& perf_stats = Core::System::GetInstance().perf_stats;
+    const steady_clock::time_point upload_start = steady_clock::now();
+
     state.Apply();
+    if (is_clear_color_changed.exchange(false)) {
+        glClearColor(Settings::values.bg_red, Settings::values.bg_green, Settings::values.bg_blue,
+                     0.0f);
+    }
+
+    // Free the textures of the layers that aren't shown anymore
+    for (auto itr = layer_screens.begin(); itr != layer_screens.end();) {
+        const bool is_shown = std::any_of(
+            frame.layers.begin(), frame.layers.end(),
+            [&](const VideoCore::Frame::Layer& layer) { return layer.info.id == itr->first; });
+        itr = is_shown ? std::next(itr) : layer_screens.erase(itr);
+    }
+
+    for (const VideoCore::Frame::Layer& layer : frame.layers) {
+        auto result = layer_screens.try_emplace(layer.info.id);
+        ScreenInfo& screen_info = result.first->second;
+        if (result.second) {
+            InitScreenInfo(screen_info);
+        }
+
+        if (layer.info.framebuffer == boost::none) {
+            // Keep showing the previous contents of the layer
+            continue;
+        }
 
-    if (framebuffer_info != boost::none) {
         // If framebuffer_info is provided, reload it from memory to a texture
-        if (screen_info.texture.width != (GLsizei)framebuffer_info->width ||
-            screen_info.texture.height != (GLsizei)framebuffer_info->height ||
-            screen_info.texture.pixel_format != framebuffer_info->pixel_format) {
+        const FramebufferInfo& framebuffer_info = *layer.info.framebuffer;
+        if (screen_info.texture.width != (GLsizei)framebuffer_info.width ||
+            screen_info.texture.height != (GLsizei)framebuffer_info.height ||
+            screen_info.texture.pixel_format != framebuffer_info.pixel_format) {
             // Reallocate texture if the framebuffer size has changed.
             // This is expected to not happen very often and hence should not be a
             // performance problem.
-            ConfigureFramebufferTexture(screen_info.texture, *framebuffer_info);
+            ConfigureFramebufferTexture(screen_info.texture, framebuffer_info);
+        }
+        const bool use_gpu = Settings::values.use_gpu_unswizzle && gpu_unswizzle_supported;
+        if (!use_gpu || !UnswizzleFBOnGPU(framebuffer_info, layer.data, screen_info)) {
+            LoadFBToScreenInfo(framebuffer_info, layer.data.data(), screen_info);
         }
-        LoadFBToScreenInfo(*framebuffer_info, screen_info);
     }
 
-    DrawScreens();
+    const steady_clock::time_point present_start = steady_clock::now();
+    perf_stats.AddFramePhaseTime(Core::PerfStats::FramePhase::Upload,
+                                 present_start - upload_start);
 
-    Core::System::GetInstance().perf_stats.EndSystemFrame();
+    DrawScreens(frame.layers);
 
-    // Swap buffers
-    render_window->PollEvents();
+    if (frame_dumper) {
+        DumpFrame(render_window->GetFramebufferLayout());
+    }
+
+    const OpenGLState::Stats state_stats = OpenGLState::ResetStats();
+    LOG_TRACE(Render_OpenGL, "State changes took %u GL calls, %u redundant calls were skipped",
+              state_stats.gl_calls, state_stats.skipped_gl_calls);
+
+    // Swap buffers, this blocks on vsync instead of the emulation
     render_window->SwapBuffers();
 
-    Core::System::GetInstance().frame_limiter.DoFrameLimiting(CoreTiming::GetGlobalTimeUs());
-    Core::System::GetInstance().perf_stats.BeginSystemFrame();
+    perf_stats.AddFramePhaseTime(Core::PerfStats::FramePhase::Present,
+                                 steady_clock::now() - present_start);
 
-    prev_state.Apply();
-    RefreshRasterizerSetting();
+    Core::System::GetInstance().frame_limiter.RecordVBlank();
+    perf_stats.EndPresent(frame.input_time);
+}
+
+void RendererOpenGL::ExecuteDraws() {
+    std::vector<Tegra::Maxwell3DDrawBatch> batches;
+    {
+        std::lock_guard<std::mutex> lock(draw_batch_mutex);
+        batches.swap(pending_draw_batches);
+    }
+    if (batches.empty()) {
+        return;
+    }
+    MICROPROFILE_SCOPE(OpenGL_Draws);
+
+    size_t num_draws = 0;
+    for (const Tegra::Maxwell3DDrawBatch& batch : batches) {
+        // Draws sharing a state follow each other, it is only synced when moving to the next one
+        size_t state_index = batch.states.size();
+        for (const Tegra::Maxwell3DDrawCall& draw : batch.draws) {
+            if (draw.state_index != state_index) {
+                state_index = draw.state_index;
+                SyncDrawState(batch.states[state_index]);
+                // The state the guest set back to what it was doesn't take any GL call
+                draw_state.Apply();
+            }
+            // TODO: The draws are not rasterized until the guest shaders are translated and the
+            // vertex arrays are fetched, only their state is applied for now
+        }
+        num_draws += batch.draws.size();
+    }
+    LOG_TRACE(Render_OpenGL, "Executed %zu draws from %zu batches", num_draws, batches.size());
 }
 
-static inline u32 MortonInterleave128(u32 x, u32 y) {
-    // 128x128 Z-Order coordinate from 2D coordinates
-    static constexpr u32 xlut[] = {
-        0x0000, 0x0001, 0x0002, 0x0003, 0x0008, 0x0009, 0x000a, 0x000b, 0x0040, 0x0041, 0x0042,
-        0x0043, 0x0048, 0x0049, 0x004a, 0x004b, 0x0800, 0x0801, 0x0802, 0x0803, 0x0808, 0x0809,
-        0x080a, 0x080b, 0x0840, 0x0841, 0x0842, 0x0843, 0x0848, 0x0849, 0x084a, 0x084b, 0x1000,
-        0x1001, 0x1002, 0x1003, 0x1008, 0x1009, 0x100a, 0x100b, 0x1040, 0x1041, 0x1042, 0x1043,
-        0x1048, 0x1049, 0x104a, 0x104b, 0x1800, 0x1801, 0x1802, 0x1803, 0x1808, 0x1809, 0x180a,
-        0x180b, 0x1840, 0x1841, 0x1842, 0x1843, 0x1848, 0x1849, 0x184a, 0x184b, 0x2000, 0x2001,
-        0x2002, 0x2003, 0x2008, 0x2009, 0x200a, 0x200b, 0x2040, 0x2041, 0x2042, 0x2043, 0x2048,
-        0x2049, 0x204a, 0x204b, 0x2800, 0x2801, 0x2802, 0x2803, 0x2808, 0x2809, 0x280a, 0x280b,
-        0x2840, 0x2841, 0x2842, 0x2843, 0x2848, 0x2849, 0x284a, 0x284b, 0x3000, 0x3001, 0x3002,
-        0x3003, 0x3008, 0x3009, 0x300a, 0x300b, 0x3040, 0x3041, 0x3042, 0x3043, 0x3048, 0x3049,
-        0x304a, 0x304b, 0x3800, 0x3801, 0x3802, 0x3803, 0x3808, 0x3809, 0x380a, 0x380b, 0x3840,
-        0x3841, 0x3842, 0x3843, 0x3848, 0x3849, 0x384a, 0x384b, 0x0000, 0x0001, 0x0002, 0x0003,
-        0x0008, 0x0009, 0x000a, 0x000b, 0x0040, 0x0041, 0x0042, 0x0043, 0x0048, 0x0049, 0x004a,
-        0x004b, 0x0800, 0x0801, 0x0802, 0x0803, 0x0808, 0x0809, 0x080a, 0x080b, 0x0840, 0x0841,
-        0x0842, 0x0843, 0x0848, 0x0849, 0x084a, 0x084b, 0x1000, 0x1001, 0x1002, 0x1003, 0x1008,
-        0x1009, 0x100a, 0x100b, 0x1040, 0x1041, 0x1042, 0x1043, 0x1048, 0x1049, 0x104a, 0x104b,
-        0x1800, 0x1801, 0x1802, 0x1803, 0x1808, 0x1809, 0x180a, 0x180b, 0x1840, 0x1841, 0x1842,
-        0x1843, 0x1848, 0x1849, 0x184a, 0x184b, 0x2000, 0x2001, 0x2002, 0x2003, 0x2008, 0x2009,
-        0x200a, 0x200b, 0x2040, 0x2041, 0x2042, 0x2043, 0x2048, 0x2049, 0x204a, 0x204b, 0x2800,
-        0x2801, 0x2802, 0x2803, 0x2808, 0x2809, 0x280a, 0x280b, 0x2840, 0x2841, 0x2842, 0x2843,
-        0x2848, 0x2849, 0x284a, 0x284b, 0x3000, 0x3001, 0x3002, 0x3003, 0x3008, 0x3009, 0x300a,
-        0x300b, 0x3040, 0x3041, 0x3042, 0x3043, 0x3048, 0x3049, 0x304a, 0x304b, 0x3800, 0x3801,
-        0x3802, 0x3803, 0x3808, 0x3809, 0x380a, 0x380b, 0x3840, 0x3841, 0x3842, 0x3843, 0x3848,
-        0x3849, 0x384a, 0x384b, 0x0000, 0x0001, 0x0002, 0x0003, 0x0008, 0x0009, 0x000a, 0x000b,
-        0x0040, 0x0041, 0x0042, 0x0043, 0x0048, 0x0049, 0x004a, 0x004b, 0x0800, 0x0801, 0x0802,
-        0x0803, 0x0808, 0x0809, 0x080a, 0x080b, 0x0840, 0x0841, 0x0842, 0x0843, 0x0848, 0x0849,
-        0x084a, 0x084b, 0x1000, 0x1001, 0x1002, 0x1003, 0x1008, 0x1009, 0x100a, 0x100b, 0x1040,
-        0x1041, 0x1042, 0x1043, 0x1048, 0x1049, 0x104a, 0x104b, 0x1800, 0x1801, 0x1802, 0x1803,
-        0x1808, 0x1809, 0x180a, 0x180b, 0x1840, 0x1841, 0x1842, 0x1843, 0x1848, 0x1849, 0x184a,
-        0x184b, 0x2000, 0x2001, 0x2002, 0x2003, 0x2008, 0x2009, 0x200a, 0x200b, 0x2040, 0x2041,
-        0x2042, 0x2043, 0x2048, 0x2049, 0x204a, 0x204b, 0x2800, 0x2801, 0x2802, 0x2803, 0x2808,
-        0x2809, 0x280a, 0x280b, 0x2840, 0x2841, 0x2842, 0x2843, 0x2848, 0x2849, 0x284a, 0x284b,
-        0x3000, 0x3001, 0x3002, 0x3003, 0x3008, 0x3009, 0x300a, 0x300b, 0x3040, 0x3041, 0x3042,
-        0x3043, 0x3048, 0x3049, 0x304a, 0x304b, 0x3800, 0x3801, 0x3802, 0x3803, 0x3808, 0x3809,
-        0x380a, 0x380b, 0x3840, 0x3841, 0x3842, 0x3843, 0x3848, 0x3849, 0x384a, 0x384b,
-    };
-    static constexpr u32 ylut[] = {
-        0x0000, 0x0004, 0x0010, 0x0014, 0x0020, 0x0024, 0x0030, 0x0034, 0x0080, 0x0084, 0x0090,
-        0x0094, 0x00a0, 0x00a4, 0x00b0, 0x00b4, 0x0100, 0x0104, 0x0110, 0x0114, 0x0120, 0x0124,
-        0x0130, 0x0134, 0x0180, 0x0184, 0x0190, 0x0194, 0x01a0, 0x01a4, 0x01b0, 0x01b4, 0x0200,
-        0x0204, 0x0210, 0x0214, 0x0220, 0x0224, 0x0230, 0x0234, 0x0280, 0x0284, 0x0290, 0x0294,
-        0x02a0, 0x02a4, 0x02b0, 0x02b4, 0x0300, 0x0304, 0x0310, 0x0314, 0x0320, 0x0324, 0x0330,
-        0x0334, 0x0380, 0x0384, 0x0390, 0x0394, 0x03a0, 0x03a4, 0x03b0, 0x03b4, 0x0400, 0x0404,
-        0x0410, 0x0414, 0x0420, 0x0424, 0x0430, 0x0434, 0x0480, 0x0484, 0x0490, 0x0494, 0x04a0,
-        0x04a4, 0x04b0, 0x04b4, 0x0500, 0x0504, 0x0510, 0x0514, 0x0520, 0x0524, 0x0530, 0x0534,
-        0x0580, 0x0584, 0x0590, 0x0594, 0x05a0, 0x05a4, 0x05b0, 0x05b4, 0x0600, 0x0604, 0x0610,
-        0x0614, 0x0620, 0x0624, 0x0630, 0x0634, 0x0680, 0x0684, 0x0690, 0x0694, 0x06a0, 0x06a4,
-        0x06b0, 0x06b4, 0x0700, 0x0704, 0x0710, 0x0714, 0x0720, 0x0724, 0x0730, 0x0734, 0x0780,
-        0x0784, 0x0790, 0x0794, 0x07a0, 0x07a4, 0x07b0, 0x07b4, 0x0000, 0x0004, 0x0010, 0x0014,
-        0x0020, 0x0024, 0x0030, 0x0034, 0x0080, 0x0084, 0x0090, 0x0094, 0x00a0, 0x00a4, 0x00b0,
-        0x00b4, 0x0100, 0x0104, 0x0110, 0x0114, 0x0120, 0x0124, 0x0130, 0x0134, 0x0180, 0x0184,
-        0x0190, 0x0194, 0x01a0, 0x01a4, 0x01b0, 0x01b4, 0x0200, 0x0204, 0x0210, 0x0214, 0x0220,
-        0x0224, 0x0230, 0x0234, 0x0280, 0x0284, 0x0290, 0x0294, 0x02a0, 0x02a4, 0x02b0, 0x02b4,
-        0x0300, 0x0304, 0x0310, 0x0314, 0x0320, 0x0324, 0x0330, 0x0334, 0x0380, 0x0384, 0x0390,
-        0x0394, 0x03a0, 0x03a4, 0x03b0, 0x03b4, 0x0400, 0x0404, 0x0410, 0x0414, 0x0420, 0x0424,
-        0x0430, 0x0434, 0x0480, 0x0484, 0x0490, 0x0494, 0x04a0, 0x04a4, 0x04b0, 0x04b4, 0x0500,
-        0x0504, 0x0510, 0x0514, 0x0520, 0x0524, 0x0530, 0x0534, 0x0580, 0x0584, 0x0590, 0x0594,
-        0x05a0, 0x05a4, 0x05b0, 0x05b4, 0x0600, 0x0604, 0x0610, 0x0614, 0x0620, 0x0624, 0x0630,
-        0x0634, 0x0680, 0x0684, 0x0690, 0x0694, 0x06a0, 0x06a4, 0x06b0, 0x06b4, 0x0700, 0x0704,
-        0x0710, 0x0714, 0x0720, 0x0724, 0x0730, 0x0734, 0x0780, 0x0784, 0x0790, 0x0794, 0x07a0,
-        0x07a4, 0x07b0, 0x07b4, 0x0000, 0x0004, 0x0010, 0x0014, 0x0020, 0x0024, 0x0030, 0x0034,
-        0x0080, 0x0084, 0x0090, 0x0094, 0x00a0, 0x00a4, 0x00b0, 0x00b4, 0x0100, 0x0104, 0x0110,
-        0x0114, 0x0120, 0x0124, 0x0130, 0x0134, 0x0180, 0x0184, 0x0190, 0x0194, 0x01a0, 0x01a4,
-        0x01b0, 0x01b4, 0x0200, 0x0204, 0x0210, 0x0214, 0x0220, 0x0224, 0x0230, 0x0234, 0x0280,
-        0x0284, 0x0290, 0x0294, 0x02a0, 0x02a4, 0x02b0, 0x02b4, 0x0300, 0x0304, 0x0310, 0x0314,
-        0x0320, 0x0324, 0x0330, 0x0334, 0x0380, 0x0384, 0x0390, 0x0394, 0x03a0, 0x03a4, 0x03b0,
-        0x03b4, 0x0400, 0x0404, 0x0410, 0x0414, 0x0420, 0x0424, 0x0430, 0x0434, 0x0480, 0x0484,
-        0x0490, 0x0494, 0x04a0, 0x04a4, 0x04b0, 0x04b4, 0x0500, 0x0504, 0x0510, 0x0514, 0x0520,
-        0x0524, 0x0530, 0x0534, 0x0580, 0x0584, 0x0590, 0x0594, 0x05a0, 0x05a4, 0x05b0, 0x05b4,
-        0x0600, 0x0604, 0x0610, 0x0614, 0x0620, 0x0624, 0x0630, 0x0634, 0x0680, 0x0684, 0x0690,
-        0x0694, 0x06a0, 0x06a4, 0x06b0, 0x06b4, 0x0700, 0x0704, 0x0710, 0x0714, 0x0720, 0x0724,
-        0x0730, 0x0734, 0x0780, 0x0784, 0x0790, 0x0794, 0x07a0, 0x07a4, 0x07b0, 0x07b4,
-    };
-    return xlut[x % 128] + ylut[y % 128];
-}
-
-static inline u32 GetMortonOffset128(u32 x, u32 y, u32 bytes_per_pixel) {
-    // Calculates the offset of the position of the pixel in Morton order
-    // Framebuffer images are split into 128x128 tiles.
-
-    const unsigned int block_height = 128;
-    const unsigned int coarse_x = x & ~127;
-
-    u32 i = MortonInterleave128(x, y);
-
-    const unsigned int offset = coarse_x * block_height;
-
-    return (i + offset) * bytes_per_pixel;
-}
-
-static void MortonCopyPixels128(u32 width, u32 height, u32 bytes_per_pixel, u32 gl_bytes_per_pixel,
-                                u8* morton_data, u8* gl_data, bool morton_to_gl) {
-    u8* data_ptrs[2];
-    for (unsigned y = 0; y < height; ++y) {
-        for (unsigned x = 0; x < width; ++x) {
-            const u32 coarse_y = y & ~127;
-            u32 morton_offset =
-                GetMortonOffset128(x, y, bytes_per_pixel) + coarse_y * width * bytes_per_pixel;
-            u32 gl_pixel_index = (x + (height - 1 - y) * width) * gl_bytes_per_pixel;
-
-            data_ptrs[morton_to_gl] = morton_data + morton_offset;
-            data_ptrs[!morton_to_gl] = &gl_data[gl_pixel_index];
-
-            memcpy(data_ptrs[0], data_ptrs[1], bytes_per_pixel);
+void RendererOpenGL::SyncDrawState(const Tegra::Maxwell3DDrawState& maxwell_state) {
+    using Group = Tegra::Maxwell3DStateGroup;
+    const BitSet32 changed_groups = maxwell_state.changed_groups;
+
+    // The registers of disabled tests are left unset by the guest, they aren't translated
+    if (changed_groups[static_cast<size_t>(Group::Depth)]) {
+        draw_state.depth.test_enabled = maxwell_state.depth_test_enable;
+        draw_state.depth.write_mask = maxwell_state.depth_write_enabled ? GL_TRUE : GL_FALSE;
+        if (maxwell_state.depth_test_enable) {
+            draw_state.depth.test_func = MaxwellToGL::ComparisonOp(maxwell_state.depth_test_func);
         }
     }
+
+    if (changed_groups[static_cast<size_t>(Group::Stencil)]) {
+        draw_state.stencil.test_enabled = maxwell_state.stencil_enable;
+    }
+
+    if (changed_groups[static_cast<size_t>(Group::Blend)]) {
+        // Only the first render target is drawn to for now
+        const auto& blend = maxwell_state.blend;
+        draw_state.blend.enabled = blend.enable[0] != 0;
+        if (draw_state.blend.enabled) {
+            draw_state.blend.rgb_equation = MaxwellToGL::BlendEquation(blend.equation_rgb);
+            draw_state.blend.src_rgb_func = MaxwellToGL::BlendFactor(blend.factor_source_rgb);
+            draw_state.blend.dst_rgb_func = MaxwellToGL::BlendFactor(blend.factor_dest_rgb);
+            const bool separate_alpha = blend.separate_alpha != 0;
+            draw_state.blend.a_equation = separate_alpha
+                                              ? MaxwellToGL::BlendEquation(blend.equation_a)
+                                              : draw_state.blend.rgb_equation;
+            draw_state.blend.src_a_func = separate_alpha
+                                              ? MaxwellToGL::BlendFactor(blend.factor_source_a)
+                                              : draw_state.blend.src_rgb_func;
+            draw_state.blend.dst_a_func = separate_alpha
+                                              ? MaxwellToGL::BlendFactor(blend.factor_dest_a)
+                                              : draw_state.blend.dst_rgb_func;
+            draw_state.blend.color.red = maxwell_state.blend_color[0];
+            draw_state.blend.color.green = maxwell_state.blend_color[1];
+            draw_state.blend.color.blue = maxwell_state.blend_color[2];
+            draw_state.blend.color.alpha = maxwell_state.blend_color[3];
+        }
+    }
+
+    if (changed_groups[static_cast<size_t>(Group::Cull)]) {
+        draw_state.cull.enabled = maxwell_state.cull.enabled != 0;
+        if (draw_state.cull.enabled) {
+            draw_state.cull.mode = MaxwellToGL::CullFace(maxwell_state.cull.cull_face);
+            draw_state.cull.front_face = MaxwellToGL::FrontFace(maxwell_state.cull.front_face);
+        }
+    }
+
+    // The render targets, viewports and vertex arrays have no host objects to bind yet
 }
 
 /**
  * Loads framebuffer from emulated memory into the active OpenGL texture.
  */
 void RendererOpenGL::LoadFBToScreenInfo(const FramebufferInfo& framebuffer_info,
-                                        ScreenInfo& screen_info) {
+                                        const u8* framebuffer_data, ScreenInfo& screen_info) {
+    MICROPROFILE_SCOPE(OpenGL_LoadFB);
+    MICROPROFILE_SCOPEGPU(GPU_LoadFB);
+
     const u32 bpp{FramebufferInfo::BytesPerPixel(framebuffer_info.pixel_format)};
     const u32 size_in_bytes{framebuffer_info.stride * framebuffer_info.height * bpp};
+    const size_t gl_size_in_bytes{framebuffer_info.width * framebuffer_info.height * bpp};
+    MICROPROFILE_META_CPU("Uploaded bytes", static_cast<int>(gl_size_in_bytes));
+
+    // The buffer was last used UPLOAD_BUFFER_COUNT uploads ago, so its fence is normally
+    // signaled already
+    UploadBuffer& upload = upload_buffers[next_upload_buffer];
+    next_upload_buffer = (next_upload_buffer + 1) % UPLOAD_BUFFER_COUNT;
+    if (upload.fence.handle != 0) {
+        glClientWaitSync(upload.fence.handle, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        upload.fence.Release();
+    }
 
-    MortonCopyPixels128(framebuffer_info.width, framebuffer_info.height, bpp, 4,
-                        Memory::GetPointer(framebuffer_info.address), gl_framebuffer_data.data(),
-                        true);
+    state.draw.pixel_unpack_buffer = upload.buffer.handle;
+    state.Apply();
+
+    // Upload buffers only ever grow
+    if (upload.size < gl_size_in_bytes) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, gl_size_in_bytes, nullptr, GL_STREAM_DRAW);
+        buffer_memory_usage += gl_size_in_bytes - upload.size;
+        upload.size = gl_size_in_bytes;
+    }
+
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, gl_size_in_bytes,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT |
+                                        GL_MAP_UNSYNCHRONIZED_BIT);
+    if (mapped == nullptr) {
+        LOG_ERROR(Render_OpenGL, "Couldn't map the upload buffer");
+        state.draw.pixel_unpack_buffer = 0;
+        state.Apply();
+        return;
+    }
+    VideoCore::BlockLinear::Unswizzle(static_cast<u8*>(mapped), framebuffer_data,
+                                      framebuffer_info.width, framebuffer_info.height, bpp,
+                                      VideoCore::BlockLinear::FRAMEBUFFER_BLOCK_HEIGHT, true);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
 
     LOG_TRACE(Render_OpenGL, "0x%08x bytes from 0x%llx(%dx%d), fmt %x", size_in_bytes,
               framebuffer_info.address, framebuffer_info.width, framebuffer_info.height,
@@ -266,29 +542,131 @@ void RendererOpenGL::LoadFBToScreenInfo(const FramebufferInfo& framebuffer_info,
     screen_info.display_texture = screen_info.texture.resource.handle;
     screen_info.display_texcoords = MathUtil::Rectangle<float>(0.f, 0.f, 1.f, 1.f);
 
-    Memory::RasterizerFlushRegion(framebuffer_info.address, size_in_bytes);
-
     state.texture_units[0].texture_2d = screen_info.texture.resource.handle;
     state.Apply();
 
     glActiveTexture(GL_TEXTURE0);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)framebuffer_info.stride);
+    // The unswizzled rows are tightly packed
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)framebuffer_info.width);
 
     // Update existing texture
     // TODO: Test what happens on hardware when you change the framebuffer dimensions so that
     //       they differ from the LCD resolution.
     // TODO: Applications could theoretically crash Citra here by specifying too large
     //       framebuffer sizes. We should make sure that this cannot happen.
+    // The data is read from the bound upload buffer, without waiting for the transfer
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, framebuffer_info.width, framebuffer_info.height,
-                    screen_info.texture.gl_format, screen_info.texture.gl_type,
-                    gl_framebuffer_data.data());
+                    screen_info.texture.gl_format, screen_info.texture.gl_type, nullptr);
+    upload.fence.Create();
 
     glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 
     state.texture_units[0].texture_2d = 0;
+    state.draw.pixel_unpack_buffer = 0;
     state.Apply();
 }
 
+/**
+ * Gets the uniform locations of the unswizzle program and sets its constant uniforms, once the
+ * program is compiled. Returns false while it isn't.
+ */
+bool RendererOpenGL::PrepareUnswizzleProgram() {
+    if (unswizzle_program_initialized) {
+        return true;
+    }
+    if (!unswizzle_program || !unswizzle_program->IsReady()) {
+        return false;
+    }
+
+    const GLuint handle = unswizzle_program->GetHandle();
+    uniform_tiled_offset = glGetUniformLocation(handle, "tiled_offset");
+    uniform_height = glGetUniformLocation(handle, "height");
+    uniform_blocks_per_row = glGetUniformLocation(handle, "blocks_per_row");
+
+    const GLuint previous_program = state.draw.shader_program;
+    state.draw.shader_program = handle;
+    state.Apply();
+    glUniform1i(glGetUniformLocation(handle, "tiled_data"), UNSWIZZLE_TEXTURE_UNIT);
+    glUniform1i(glGetUniformLocation(handle, "block_height"),
+                VideoCore::BlockLinear::FRAMEBUFFER_BLOCK_HEIGHT);
+    state.draw.shader_program = previous_program;
+    state.Apply();
+
+    unswizzle_program_initialized = true;
+    return true;
+}
+
+/**
+ * Deswizzles a framebuffer into the texture of a layer by drawing to it. The framebuffer contents
+ * are streamed into a buffer that is only orphaned when it is full, so uploads don't wait for the
+ * draws still reading the previous frames.
+ */
+bool RendererOpenGL::UnswizzleFBOnGPU(const FramebufferInfo& framebuffer_info,
+                                      const std::vector<u8>& framebuffer_data,
+                                      ScreenInfo& screen_info) {
+    MICROPROFILE_SCOPEGPU(GPU_UnswizzleFB);
+
+    const u32 bpp{FramebufferInfo::BytesPerPixel(framebuffer_info.pixel_format)};
+    const size_t size{framebuffer_data.size()};
+    if (bpp != 4 || size > UNSWIZZLE_BUFFER_SIZE || !PrepareUnswizzleProgram()) {
+        return false;
+    }
+
+    // Keep the framebuffers aligned to the texels of the buffer texture
+    size_t offset{(unswizzle_buffer_offset + 3) & ~size_t(3)};
+
+    glBindBuffer(GL_TEXTURE_BUFFER, unswizzle_buffer.handle);
+    if (offset + size > UNSWIZZLE_BUFFER_SIZE) {
+        // Draws still reading the old storage keep it alive until they are done
+        glBufferData(GL_TEXTURE_BUFFER, UNSWIZZLE_BUFFER_SIZE, nullptr, GL_STREAM_DRAW);
+        offset = 0;
+    }
+
+    void* mapped = glMapBufferRange(GL_TEXTURE_BUFFER, offset, size,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                        GL_MAP_UNSYNCHRONIZED_BIT);
+    if (mapped == nullptr) {
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        LOG_ERROR(Render_OpenGL, "Couldn't map the unswizzle buffer");
+        return false;
+    }
+    std::memcpy(mapped, framebuffer_data.data(), size);
+    glUnmapBuffer(GL_TEXTURE_BUFFER);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    unswizzle_buffer_offset = offset + size;
+
+    const auto draw_state = state.draw;
+    state.draw.draw_framebuffer = unswizzle_framebuffer.handle;
+    state.draw.vertex_array = unswizzle_vertex_array.handle;
+    state.draw.shader_program = unswizzle_program->GetHandle();
+    state.Apply();
+
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           screen_info.texture.resource.handle, 0);
+    glViewport(0, 0, framebuffer_info.width, framebuffer_info.height);
+
+    const GLint blocks_per_row{static_cast<GLint>(
+        (framebuffer_info.width * bpp + VideoCore::BlockLinear::GOB_SIZE_X - 1) /
+        VideoCore::BlockLinear::GOB_SIZE_X)};
+    glUniform1i(uniform_tiled_offset, static_cast<GLint>(offset / 4));
+    glUniform1i(uniform_height, static_cast<GLint>(framebuffer_info.height));
+    glUniform1i(uniform_blocks_per_row, blocks_per_row);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+
+    state.draw = draw_state;
+    state.Apply();
+
+    LOG_TRACE(Render_OpenGL, "0x%08zx bytes from 0x%llx(%dx%d) deswizzled on the GPU", size,
+              framebuffer_info.address, framebuffer_info.width, framebuffer_info.height);
+
+    // Reset the screen info's display texture to its own permanent texture
+    screen_info.display_texture = screen_info.texture.resource.handle;
+    screen_info.display_texcoords = MathUtil::Rectangle<float>(0.f, 0.f, 1.f, 1.f);
+    return true;
+}
+
 /**
  * Fills active OpenGL texture with the given RGB color. Since the color is solid, the texture can
  * be 1x1 but will stretch across whatever it's rendered on.
@@ -330,6 +708,10 @@ void RendererOpenGL::InitOpenGLObjects() {
     // Generate VAO
     vertex_array.Create();
 
+    for (UploadBuffer& upload : upload_buffers) {
+        upload.buffer.Create();
+    }
+
     state.draw.vertex_array = vertex_array.handle;
     state.draw.vertex_buffer = vertex_buffer.handle;
     state.draw.uniform_buffer = 0;
@@ -344,11 +726,54 @@ void RendererOpenGL::InitOpenGLObjects() {
     glEnableVertexAttribArray(attrib_position);
     glEnableVertexAttribArray(attrib_tex_coord);
 
-    // Allocate textures for the screen
-    screen_info.texture.resource.Create();
+    // Layers above the bottom-most one are blended over it using their alpha
+    state.blend.rgb_equation = GL_FUNC_ADD;
+    state.blend.a_equation = GL_FUNC_ADD;
+    state.blend.src_rgb_func = GL_SRC_ALPHA;
+    state.blend.dst_rgb_func = GL_ONE_MINUS_SRC_ALPHA;
+    state.blend.src_a_func = GL_ONE;
+    state.blend.dst_a_func = GL_ONE_MINUS_SRC_ALPHA;
+
+    // The buffer has to hold the largest framebuffers, otherwise they are deswizzled on the CPU
+    GLint max_texture_buffer_size;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texture_buffer_size);
+    gpu_unswizzle_supported =
+        static_cast<size_t>(max_texture_buffer_size) >= UNSWIZZLE_BUFFER_SIZE / 4;
+    if (!gpu_unswizzle_supported) {
+        LOG_WARNING(Render_OpenGL, "Texture buffers are too small to unswizzle on the GPU");
+        return;
+    }
+
+    unswizzle_program =
+        shader_compiler->Compile(unswizzle_vertex_shader, unswizzle_fragment_shader);
+
+    unswizzle_buffer.Create();
+    glBindBuffer(GL_TEXTURE_BUFFER, unswizzle_buffer.handle);
+    glBufferData(GL_TEXTURE_BUFFER, UNSWIZZLE_BUFFER_SIZE, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    buffer_memory_usage += UNSWIZZLE_BUFFER_SIZE;
 
+    // The buffer texture stays bound, nothing else uses this texture unit's buffer target
+    unswizzle_buffer_texture.Create();
+    glActiveTexture(GL_TEXTURE0 + UNSWIZZLE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, unswizzle_buffer_texture.handle);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, unswizzle_buffer.handle);
+    glActiveTexture(GL_TEXTURE0);
+
+    unswizzle_framebuffer.Create();
+    // Core profiles need a vertex array bound to draw, even without attributes
+    unswizzle_vertex_array.Create();
+}
+
+/**
+ * Creates the texture of a layer. It is transparent until the layer's framebuffer is loaded.
+ */
+void RendererOpenGL::InitScreenInfo(ScreenInfo& screen_info) {
     // Allocation of storage is deferred until the first frame, when we
     // know the framebuffer size.
+    screen_info.texture.width = 0;
+    screen_info.texture.height = 0;
+    screen_info.texture.resource.Create();
 
     state.texture_units[0].texture_2d = screen_info.texture.resource.handle;
     state.Apply();
@@ -361,11 +786,11 @@ void RendererOpenGL::InitOpenGLObjects() {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
     screen_info.display_texture = screen_info.texture.resource.handle;
+    screen_info.display_texcoords = MathUtil::Rectangle<float>(0.f, 0.f, 1.f, 1.f);
 
     state.texture_units[0].texture_2d = 0;
     state.Apply();
 
-    // Clear screen to black
     LoadColorToActiveGLTexture(0, 0, 0, 0, screen_info.texture);
 }
 
@@ -374,15 +799,16 @@ void RendererOpenGL::ConfigureFramebufferTexture(TextureInfo& texture,
 
     texture.width = framebuffer_info.width;
     texture.height = framebuffer_info.height;
+    texture.pixel_format = framebuffer_info.pixel_format;
 
     GLint internal_format;
     switch (framebuffer_info.pixel_format) {
     case FramebufferInfo::PixelFormat::ABGR8:
-        // Use RGBA8 and swap in the fragment shader
-        internal_format = GL_RGBA;
+        // Use RGBA8 and swap in the fragment shader. The sized format keeps the texture
+        // renderable, for deswizzling on the GPU.
+        internal_format = GL_RGBA8;
         texture.gl_format = GL_RGBA;
         texture.gl_type = GL_UNSIGNED_INT_8_8_8_8;
-        gl_framebuffer_data.resize(texture.width * texture.height * 4);
         break;
     default:
         UNIMPLEMENTED();
@@ -420,16 +846,272 @@ void RendererOpenGL::DrawSingleScreen(const ScreenInfo& screen_info, float x, fl
     state.Apply();
 }
 
+/// Area of the window a layer is drawn to, and the part of its texture that is shown there
+struct LayerPlacement {
+    float x;
+    float y;
+    float width;
+    float height;
+    /// Texture coordinates as used by DrawSingleScreen, with the horizontal range between top and
+    /// bottom and the vertical one between right (top of the screen) and left (bottom)
+    MathUtil::Rectangle<float> texcoords;
+};
+
+static LayerPlacement GetLayerPlacement(RendererBase::ScalingMode scaling_mode,
+                                        const TextureInfo& texture,
+                                        const Layout::FramebufferLayout& layout) {
+    const auto& screen = layout.screen;
+    const float screen_width = static_cast<float>(screen.GetWidth());
+    const float screen_height = static_cast<float>(screen.GetHeight());
+    LayerPlacement placement{static_cast<float>(screen.left), static_cast<float>(screen.top),
+                             screen_width, screen_height,
+                             MathUtil::Rectangle<float>(0.f, 0.f, 1.f, 1.f)};
+
+    // Layers without contents yet are a single transparent texel
+    if (texture.width == 0 || texture.height == 0) {
+        return placement;
+    }
+
+    const float width = static_cast<float>(texture.width);
+    const float height = static_cast<float>(texture.height);
+
+    using ScalingMode = RendererBase::ScalingMode;
+    switch (scaling_mode) {
+    case ScalingMode::ScaleToWindow:
+        break;
+    case ScalingMode::PreserveAspectRatio: {
+        const float scale = std::min(screen_width / width, screen_height / height);
+        placement.width = width * scale;
+        placement.height = height * scale;
+        placement.x += (screen_width - placement.width) / 2.f;
+        placement.y += (screen_height - placement.height) / 2.f;
+        break;
+    }
+    case ScalingMode::ScaleAndCrop: {
+        const float scale = std::max(screen_width / width, screen_height / height);
+        const float crop_x = (1.f - screen_width / (width * scale)) / 2.f;
+        const float crop_y = (1.f - screen_height / (height * scale)) / 2.f;
+        placement.texcoords =
+            MathUtil::Rectangle<float>(crop_y, crop_x, 1.f - crop_y, 1.f - crop_x);
+        break;
+    }
+    case ScalingMode::Freeze:
+    case ScalingMode::None: {
+        // Native size, with the parts that don't fit on the screen cut off
+        const float scaled_width = width * layout.GetScalingRatio();
+        const float scaled_height = height * layout.GetScalingRatio();
+        const float shown_x = std::min(1.f, screen_width / scaled_width);
+        const float shown_y = std::min(1.f, screen_height / scaled_height);
+        placement.width = scaled_width * shown_x;
+        placement.height = scaled_height * shown_y;
+        placement.texcoords = MathUtil::Rectangle<float>(1.f - shown_y, 0.f, 1.f, shown_x);
+        break;
+    }
+    default:
+        LOG_ERROR(Render_OpenGL, "Unknown scaling mode %u", static_cast<u32>(scaling_mode));
+        break;
+    }
+
+    return placement;
+}
+
 /**
- * Draws the emulated screens to the emulator window.
+ * Draws the emulated screens to the emulator window. With a resolution factor, the layers are
+ * composed in a render target at that multiple of the native resolution, which is then scaled to
+ * the window with a blit. All of it stays on the GPU.
  */
-void RendererOpenGL::DrawScreens() {
+void RendererOpenGL::DrawScreens(const std::vector<VideoCore::Frame::Layer>& layers) {
+    MICROPROFILE_SCOPEGPU(GPU_DrawScreens);
+
     const auto& layout = render_window->GetFramebufferLayout();
-    const auto& screen = layout.screen;
 
+    const float resolution_factor = Settings::values.resolution_factor;
+    if (resolution_factor <= 0.f) {
+        // Auto, the layers are composed at the size of the window
+        glViewport(0, 0, layout.width, layout.height);
+        glClear(GL_COLOR_BUFFER_BIT);
+        ComposeLayers(layers, layout);
+        return;
+    }
+
+    const Layout::FramebufferLayout scaled_layout = Layout::DefaultFrameLayout(
+        static_cast<unsigned>(Layout::ScreenUndocked::Width * resolution_factor),
+        static_cast<unsigned>(Layout::ScreenUndocked::Height * resolution_factor));
+    ResizeScaledTarget(scaled_layout.width, scaled_layout.height);
+
+    state.draw.draw_framebuffer = scaled_framebuffer.handle;
+    state.Apply();
+    glViewport(0, 0, scaled_layout.width, scaled_layout.height);
+    glClear(GL_COLOR_BUFFER_BIT);
+    ComposeLayers(layers, scaled_layout);
+
+    // Filter the composed screen bilinearly up or down to the size it has in the window
+    state.draw.draw_framebuffer = 0;
+    state.draw.read_framebuffer = scaled_framebuffer.handle;
+    state.Apply();
     glViewport(0, 0, layout.width, layout.height);
     glClear(GL_COLOR_BUFFER_BIT);
+    const auto& screen = layout.screen;
+    glBlitFramebuffer(0, 0, scaled_layout.width, scaled_layout.height, screen.left,
+                      layout.height - screen.bottom, screen.right, layout.height - screen.top,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    state.draw.read_framebuffer = 0;
+    state.Apply();
+}
+
+/**
+ * (Re)allocates the render target used for scaled rendering if its size changed.
+ */
+void RendererOpenGL::ResizeScaledTarget(unsigned width, unsigned height) {
+    if (scaled_texture.handle != 0 && width == scaled_width && height == scaled_height) {
+        return;
+    }
+
+    if (scaled_texture.handle == 0) {
+        scaled_texture.Create();
+        scaled_framebuffer.Create();
+    }
+    scaled_width = width;
+    scaled_height = height;
+
+    state.texture_units[0].texture_2d = scaled_texture.handle;
+    state.Apply();
+
+    glActiveTexture(GL_TEXTURE0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    state.texture_units[0].texture_2d = 0;
+    state.draw.draw_framebuffer = scaled_framebuffer.handle;
+    state.Apply();
+
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           scaled_texture.handle, 0);
+
+    state.draw.draw_framebuffer = 0;
+    state.Apply();
+
+    LOG_DEBUG(Render_OpenGL, "Rendering the screen at %ux%u", width, height);
+}
+
+/**
+ * Creates the frame dumper and the objects used to read the frames back, if frames are dumped.
+ */
+void RendererOpenGL::InitFrameDump() {
+    if (Settings::values.frame_dump_file.empty()) {
+        return;
+    }
+
+    // The video has the size of the internal resolution, the window can be resized meanwhile
+    const float resolution_factor = std::max(Settings::values.resolution_factor, 1.f);
+    const u32 width = static_cast<u32>(Layout::ScreenUndocked::Width * resolution_factor) & ~1U;
+    const u32 height = static_cast<u32>(Layout::ScreenUndocked::Height * resolution_factor) & ~1U;
+    frame_dumper = std::make_unique<VideoCore::FrameDumper>(Settings::values.frame_dump_file,
+                                                            width, height, 60);
+    if (!frame_dumper->IsOpen()) {
+        frame_dumper.reset();
+        return;
+    }
+
+    dump_texture.Create();
+    dump_framebuffer.Create();
 
+    state.texture_units[0].texture_2d = dump_texture.handle;
+    state.Apply();
+    glActiveTexture(GL_TEXTURE0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+    state.texture_units[0].texture_2d = 0;
+    state.draw.draw_framebuffer = dump_framebuffer.handle;
+    state.Apply();
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           dump_texture.handle, 0);
+    state.draw.draw_framebuffer = 0;
+    state.Apply();
+
+    const GLsizeiptr size = width * height * 4;
+    for (ReadbackBuffer& readback : readback_buffers) {
+        readback.buffer.Create();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.handle);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        buffer_memory_usage += size;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+/**
+ * Hands the frames whose readbacks are done to the frame dumper, and reads the screen that was
+ * just drawn back asynchronously. Never waits for the GPU: if the oldest readback isn't done when
+ * its buffer is needed again, the new frame is dropped.
+ */
+void RendererOpenGL::DumpFrame(const Layout::FramebufferLayout& layout) {
+    const u32 width = frame_dumper->GetWidth();
+    const u32 height = frame_dumper->GetHeight();
+    const size_t size = width * height * 4;
+
+    // Collect the finished readbacks in the order they were issued
+    for (size_t i = 0; i < READBACK_BUFFER_COUNT; ++i) {
+        ReadbackBuffer& readback =
+            readback_buffers[(next_readback_buffer + i) % READBACK_BUFFER_COUNT];
+        if (readback.fence.handle == 0) {
+            continue;
+        }
+        if (glClientWaitSync(readback.fence.handle, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            break;
+        }
+        readback.fence.Release();
+
+        std::vector<u8>* buffer = frame_dumper->AcquireBuffer();
+        if (buffer == nullptr) {
+            continue;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.handle);
+        const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+        if (mapped != nullptr) {
+            std::memcpy(buffer->data(), mapped, size);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        } else {
+            LOG_ERROR(Render_OpenGL, "Couldn't map the readback buffer");
+        }
+        frame_dumper->SubmitBuffer(buffer);
+    }
+
+    ReadbackBuffer& readback = readback_buffers[next_readback_buffer];
+    if (readback.fence.handle != 0) {
+        frame_dumper->DropFrame();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return;
+    }
+    next_readback_buffer = (next_readback_buffer + 1) % READBACK_BUFFER_COUNT;
+
+    // Scale the screen to the size of the video, then read it into the buffer
+    state.draw.draw_framebuffer = dump_framebuffer.handle;
+    state.Apply();
+    const auto& screen = layout.screen;
+    glBlitFramebuffer(screen.left, layout.height - screen.bottom, screen.right,
+                      layout.height - screen.top, 0, 0, width, height, GL_COLOR_BUFFER_BIT,
+                      GL_LINEAR);
+
+    state.draw.draw_framebuffer = 0;
+    state.draw.read_framebuffer = dump_framebuffer.handle;
+    state.Apply();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.handle);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence.Create();
+
+    state.draw.read_framebuffer = 0;
+    state.Apply();
+}
+
+/**
+ * Composes the layers of the emulated screen in a single pass, into the bound framebuffer.
+ */
+void RendererOpenGL::ComposeLayers(const std::vector<VideoCore::Frame::Layer>& layers,
+                                   const Layout::FramebufferLayout& layout) {
     // Set projection matrix
     std::array<GLfloat, 3 * 2> ortho_matrix =
         MakeOrthographicMatrix((float)layout.width, (float)layout.height);
@@ -439,10 +1121,24 @@ void RendererOpenGL::DrawScreens() {
     glActiveTexture(GL_TEXTURE0);
     glUniform1i(uniform_color_texture, 0);
 
-    DrawSingleScreen(screen_info, (float)screen.left, (float)screen.top, (float)screen.GetWidth(),
-                     (float)screen.GetHeight());
+    for (size_t index = 0; index < layers.size(); ++index) {
+        const LayerInfo& layer = layers[index].info;
+        ScreenInfo& screen_info = layer_screens.at(layer.id);
 
-    m_current_frame++;
+        const LayerPlacement placement =
+            GetLayerPlacement(layer.scaling_mode, screen_info.texture, layout);
+        screen_info.display_texcoords = placement.texcoords;
+
+        // The bottom-most layer replaces the background, as applications don't necessarily clear
+        // the alpha channel of their framebuffer
+        state.blend.enabled = index != 0;
+
+        DrawSingleScreen(screen_info, placement.x, placement.y, placement.width,
+                         placement.height);
+    }
+
+    state.blend.enabled = false;
+    state.Apply();
 }
 
 /// Updates the framerate
@@ -512,6 +1208,12 @@ static void APIENTRY DebugHandler(GLenum source, GLenum type, GLuint id, GLenum
 
 /// Initialize the renderer
 bool RendererOpenGL::Init() {
+    // The cache file is read while the context is set up
+    const std::string cache_dir = FileUtil::GetUserPath(D_CACHE_IDX);
+    if (FileUtil::CreateFullPath(cache_dir)) {
+        GLShader::OpenProgramCache(cache_dir + "opengl_programs.bin");
+    }
+
     render_window->MakeCurrent();
 
     if (GLAD_GL_KHR_debug) {
@@ -532,15 +1234,78 @@ bool RendererOpenGL::Init() {
     Core::Telemetry().AddField(Telemetry::FieldType::UserSystem, "GPU_OpenGL_Version", gl_version);
 
     if (!GLAD_GL_VERSION_3_3) {
+        GLShader::CloseProgramCache();
         return false;
     }
 
+    shader_compiler =
+        std::make_unique<GLShader::ShaderCompiler>(*render_window, NUM_SHADER_COMPILE_WORKERS);
     InitOpenGLObjects();
+    InitFrameDump();
 
     RefreshRasterizerSetting();
 
+    // From now on the context is only used by the presentation thread
+    render_window->DoneCurrent();
+    present_thread = std::thread(&RendererOpenGL::PresentLoop, this);
+
+    // The other settings are read for every frame
+    settings_callback = Settings::RegisterApplyCallback([this] {
+        frame_queue.SetDepth(GetPresentAheadDepth());
+        is_clear_color_changed = true;
+    });
+
     return true;
 }
 
 /// Shutdown the renderer
-void RendererOpenGL::ShutDown() {}
+void RendererOpenGL::ShutDown() {
+    if (!present_thread.joinable()) {
+        return;
+    }
+
+    Settings::UnregisterApplyCallback(settings_callback);
+    frame_queue.Close();
+    present_thread.join();
+    {
+        std::lock_guard<std::mutex> lock(draw_batch_mutex);
+        pending_draw_batches.clear();
+    }
+    // The surfaces are watched in the process memory, which is torn down after the renderer
+    surface_cache.Clear();
+    submitted_framebuffers.clear();
+
+    // Take the context back to free the OpenGL objects, and release it for the frontend
+    render_window->MakeCurrent();
+    shader_compiler.reset();
+    layer_screens.clear();
+    shader.Release();
+    vertex_buffer.Release();
+    vertex_array.Release();
+    for (UploadBuffer& upload : upload_buffers) {
+        upload.fence.Release();
+        upload.buffer.Release();
+        upload.size = 0;
+    }
+    unswizzle_program.reset();
+    unswizzle_program_initialized = false;
+    unswizzle_buffer_texture.Release();
+    unswizzle_buffer.Release();
+    unswizzle_framebuffer.Release();
+    unswizzle_vertex_array.Release();
+    scaled_framebuffer.Release();
+    scaled_texture.Release();
+    scaled_width = scaled_height = 0;
+    for (ReadbackBuffer& readback : readback_buffers) {
+        readback.fence.Release();
+        readback.buffer.Release();
+    }
+    next_readback_buffer = 0;
+    dump_framebuffer.Release();
+    dump_texture.Release();
+    frame_dumper.reset();
+    buffer_memory_usage = 0;
+    render_window->DoneCurrent();
+
+    GLShader::CloseProgramCache();
+}
@@ -4,13 +4,24 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <glad/glad.h>
 #include "common/common_types.h"
 #include "common/math_util.h"
+#include "core/frontend/framebuffer_layout.h"
+#include "video_core/frame_dumper.h"
+#include "video_core/frame_queue.h"
 #include "video_core/renderer_base.h"
 #include "video_core/renderer_opengl/gl_resource_manager.h"
+#include "video_core/renderer_opengl/gl_shader_compiler.h"
 #include "video_core/renderer_opengl/gl_state.h"
+#include "video_core/surface_cache.h"
 
 class EmuWindow;
 
@@ -36,8 +47,14 @@ public:
     RendererOpenGL();
     ~RendererOpenGL() override;
 
-    /// Swap buffers (render frame)
-    void SwapBuffers(boost::optional<const FramebufferInfo&> framebuffer_info) override;
+    /**
+     * Swap buffers (render frame). The layers are copied out of guest memory and queued for the
+     * presentation thread, which does all the OpenGL work.
+     */
+    void SwapBuffers(const std::vector<LayerInfo>& layers) override;
+
+    /// Queues the draws for the presentation thread, which executes them before the next frame
+    void SubmitDraws(Tegra::Maxwell3DDrawBatch batch) override;
 
     /**
      * Set the emulator window to use for renderer
@@ -53,13 +70,38 @@ public:
 
 private:
     void InitOpenGLObjects();
+    void InitScreenInfo(ScreenInfo& screen_info);
     void ConfigureFramebufferTexture(TextureInfo& texture, const FramebufferInfo& framebuffer_info);
-    void DrawScreens();
+    void DrawScreens(const std::vector<VideoCore::Frame::Layer>& layers);
+    void ResizeScaledTarget(unsigned width, unsigned height);
+    void InitFrameDump();
+    void DumpFrame(const Layout::FramebufferLayout& layout);
+    void ComposeLayers(const std::vector<VideoCore::Frame::Layer>& layers,
+                       const Layout::FramebufferLayout& layout);
     void DrawSingleScreen(const ScreenInfo& screen_info, float x, float y, float w, float h);
     void UpdateFramerate();
 
-    // Loads framebuffer from emulated memory into the display information structure
-    void LoadFBToScreenInfo(const FramebufferInfo& framebuffer_info, ScreenInfo& screen_info);
+    // Copies the framebuffers of the layers out of emulated memory into a frame. Framebuffers that
+    // didn't change since the previous frame are left out, which keeps the layer's texture.
+    void CopyFrame(const std::vector<LayerInfo>& layers, VideoCore::Frame& frame);
+    // Body of the presentation thread
+    void PresentLoop();
+    // Draws a frame and swaps the window buffers, on the presentation thread
+    void PresentFrame(const VideoCore::Frame& frame);
+    // Executes the draws submitted by the GPU thread, on the presentation thread
+    void ExecuteDraws();
+    // Translates the groups of a guest draw state that changed into draw_state
+    void SyncDrawState(const Tegra::Maxwell3DDrawState& maxwell_state);
+
+    // Loads framebuffer copied from emulated memory into the display information structure
+    void LoadFBToScreenInfo(const FramebufferInfo& framebuffer_info, const u8* framebuffer_data,
+                            ScreenInfo& screen_info);
+    // Sets up the unswizzle program once it is compiled, returns false while it isn't
+    bool PrepareUnswizzleProgram();
+    // Deswizzles the framebuffer of a layer into its texture with a draw. Returns false if the
+    // framebuffer couldn't be uploaded, in which case LoadFBToScreenInfo has to be used instead.
+    bool UnswizzleFBOnGPU(const FramebufferInfo& framebuffer_info,
+                          const std::vector<u8>& framebuffer_data, ScreenInfo& screen_info);
     // Fills active OpenGL texture with the given RGBA color.
     void LoadColorToActiveGLTexture(u8 color_r, u8 color_g, u8 color_b, u8 color_a,
                                     const TextureInfo& texture);
@@ -67,23 +109,110 @@ private:
     EmuWindow* render_window; ///< Handle to render window
 
     OpenGLState state;
+    /// State of the guest draws. It is kept across draw batches, as only the groups that changed
+    /// are translated again.
+    OpenGLState draw_state;
 
     // OpenGL object IDs
     OGLVertexArray vertex_array;
     OGLBuffer vertex_buffer;
     OGLShader shader;
 
-    /// Display information for Switch screen
-    ScreenInfo screen_info;
-
-    /// OpenGL framebuffer data
-    std::vector<u8> gl_framebuffer_data;
+    /// Compiles the programs that can be replaced by a fallback until they are ready
+    std::unique_ptr<GLShader::ShaderCompiler> shader_compiler;
+
+    /// Objects used to deswizzle the framebuffers on the GPU. The block-linear contents are
+    /// streamed into unswizzle_buffer, which the shader reads through a buffer texture. The
+    /// framebuffers are deswizzled on the CPU until the shader is compiled.
+    static constexpr size_t UNSWIZZLE_BUFFER_SIZE = 16 * 1024 * 1024;
+    std::shared_ptr<GLShader::AsyncProgram> unswizzle_program;
+    bool unswizzle_program_initialized = false;
+    OGLBuffer unswizzle_buffer;
+    OGLTexture unswizzle_buffer_texture;
+    OGLFramebuffer unswizzle_framebuffer;
+    OGLVertexArray unswizzle_vertex_array;
+    size_t unswizzle_buffer_offset = 0;
+    bool gpu_unswizzle_supported = false;
+
+    /// Render target the layers are composed in when rendering at a multiple of the native
+    /// resolution, before it is scaled to the window
+    OGLTexture scaled_texture;
+    OGLFramebuffer scaled_framebuffer;
+    unsigned scaled_width = 0;
+    unsigned scaled_height = 0;
+
+    /// Pixel buffer a presented frame is read back to for dumping, along with a fence signaled
+    /// once the read is done
+    struct ReadbackBuffer {
+        OGLBuffer buffer;
+        OGLSync fence;
+    };
+
+    /// Writes the presented frames to a video file if enabled, see Settings::frame_dump_file
+    std::unique_ptr<VideoCore::FrameDumper> frame_dumper;
+    /// Render target the screen is scaled to the size of the dumped video in
+    OGLTexture dump_texture;
+    OGLFramebuffer dump_framebuffer;
+    /// Ring of readback buffers, the frames are collected a few frames after their reads were
+    /// issued, so that the presentation never waits for them
+    static constexpr size_t READBACK_BUFFER_COUNT = 3;
+    std::array<ReadbackBuffer, READBACK_BUFFER_COUNT> readback_buffers;
+    size_t next_readback_buffer = 0;
+
+    /// Display information for each layer of the Switch screen, indexed by layer id
+    std::unordered_map<u64, ScreenInfo> layer_screens;
+
+    /// Pixel buffer the deswizzled framebuffers are uploaded from, along with a fence signaled
+    /// once the texture upload reading it is done
+    struct UploadBuffer {
+        OGLBuffer buffer;
+        OGLSync fence;
+        size_t size = 0;
+    };
+
+    /// Ring of upload buffers, so that filling one never waits for the previous uploads
+    static constexpr size_t UPLOAD_BUFFER_COUNT = 3;
+    std::array<UploadBuffer, UPLOAD_BUFFER_COUNT> upload_buffers;
+    size_t next_upload_buffer = 0;
 
     // Shader uniform location indices
     GLuint uniform_modelview_matrix;
     GLuint uniform_color_texture;
+    GLuint uniform_tiled_offset;
+    GLuint uniform_height;
+    GLuint uniform_blocks_per_row;
 
     // Shader attribute input indices
     GLuint attrib_position;
     GLuint attrib_tex_coord;
+
+    /// Framebuffer last submitted for a layer, with a hash of its contents
+    struct SubmittedFramebuffer {
+        FramebufferInfo info;
+        u64 hash;
+    };
+
+    /// Framebuffers submitted for each layer, indexed by layer id. Only used by the emulation
+    /// thread, to not upload unchanged framebuffers again.
+    std::unordered_map<u64, SubmittedFramebuffer> submitted_framebuffers;
+
+    /// Framebuffers copied out of guest memory, to not copy them again while the guest doesn't
+    /// write to them. Only used by the emulation thread.
+    VideoCore::SurfaceCache surface_cache;
+
+    /// Frames submitted by the emulation, the presentation is at most present_ahead_depth frames
+    /// behind
+    VideoCore::FrameQueue frame_queue;
+
+    /// Draws submitted by the GPU thread and not executed yet
+    std::vector<Tegra::Maxwell3DDrawBatch> pending_draw_batches;
+    std::mutex draw_batch_mutex;
+
+    /// Thread presenting the submitted frames, the OpenGL context is current on it once started
+    std::thread present_thread;
+
+    /// Picks up the applied settings, see Settings::RegisterApplyCallback
+    size_t settings_callback;
+    /// Set when the settings are applied, the presentation thread then sets the new clear color
+    std::atomic<bool> is_clear_color_changed{false};
 };
@@ -0,0 +1,62 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include "common/alignment.h"
+#include "video_core/surface_cache.h"
+
+namespace VideoCore {
+
+SurfaceCache::SurfaceCache() = default;
+
+SurfaceCache::~SurfaceCache() {
+    Clear();
+}
+
+bool SurfaceCache::AcquireSurface(const Kernel::SharedPtr<Kernel::Process>& new_process,
+                                  const SurfaceParams& params) {
+    if (new_process != process) {
+        Clear();
+        process = new_process;
+    }
+    if (process == nullptr || params.size == 0) {
+        return true;
+    }
+
+    auto itr = std::find_if(surfaces.begin(), surfaces.end(),
+                            [&](const Surface& surface) { return surface.params == params; });
+    if (itr != surfaces.end()) {
+        itr->last_used_frame = current_frame;
+        if (itr->tracker->GetDirtyPages().empty()) {
+            return false;
+        }
+        itr->tracker->Checkpoint();
+        return true;
+    }
+
+    // The pages start out clean, the caller copies the surface right after this
+    const VAddr base = Common::AlignDown(params.address, Memory::PAGE_SIZE);
+    const VAddr end = Common::AlignUp(params.address + params.size, Memory::PAGE_SIZE);
+    surfaces.push_back(
+        {params, std::make_unique<Memory::DirtyPageTracker>(*process, base, end - base),
+         current_frame});
+    return true;
+}
+
+void SurfaceCache::EndFrame() {
+    surfaces.erase(std::remove_if(surfaces.begin(), surfaces.end(),
+                                  [this](const Surface& surface) {
+                                      return current_frame - surface.last_used_frame >=
+                                             MAX_UNUSED_FRAMES;
+                                  }),
+                   surfaces.end());
+    ++current_frame;
+}
+
+void SurfaceCache::Clear() {
+    surfaces.clear();
+    process = nullptr;
+}
+
+} // namespace VideoCore
@@ -0,0 +1,86 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include <tuple>
+#include <vector>
+#include "common/common_types.h"
+#include "core/hle/kernel/process.h"
+#include "core/memory.h"
+
+namespace VideoCore {
+
+/// Guest surface, identified by where it is and how it is laid out
+struct SurfaceParams {
+    VAddr address;
+    u32 width;
+    u32 height;
+    u32 stride;
+    u32 format;
+    /// Size of the surface in guest memory, in bytes
+    u64 size;
+
+    bool operator==(const SurfaceParams& other) const {
+        return std::tie(address, width, height, stride, format, size) ==
+               std::tie(other.address, other.width, other.height, other.stride, other.format,
+                        other.size);
+    }
+};
+
+/**
+ * Keeps track of the guest surfaces the renderer copies out of guest memory, so that surfaces the
+ * guest didn't write to since they were last copied aren't copied again. The pages of each surface
+ * are watched by a DirtyPageTracker, which marks them as rasterizer cached memory: the first guest
+ * write to a clean page takes the slow path and dirties the surface. Writes through host pointers,
+ * such as by HLE services, bypass the tracking.
+ *
+ * Only used by the emulation thread.
+ */
+class SurfaceCache final {
+public:
+    /// Number of frames a surface is kept for after it was last used
+    static constexpr u64 MAX_UNUSED_FRAMES = 4;
+
+    SurfaceCache();
+    ~SurfaceCache();
+
+    SurfaceCache(const SurfaceCache&) = delete;
+    SurfaceCache& operator=(const SurfaceCache&) = delete;
+
+    /**
+     * Starts copying a surface out of guest memory, the surface is clean again afterwards. Writes
+     * racing with the copy dirty the surface for the next one.
+     * @returns Whether the surface was written to since it was last acquired, true for surfaces
+     *          that weren't cached.
+     */
+    bool AcquireSurface(const Kernel::SharedPtr<Kernel::Process>& process,
+                        const SurfaceParams& params);
+
+    /// Evicts the surfaces that weren't acquired in the last few frames
+    void EndFrame();
+
+    /// Evicts every surface, this has to be done before the process they are in goes away
+    void Clear();
+
+    size_t GetNumSurfaces() const {
+        return surfaces.size();
+    }
+
+private:
+    struct Surface {
+        SurfaceParams params;
+        /// Watches the pages the surface spans
+        std::unique_ptr<Memory::DirtyPageTracker> tracker;
+        u64 last_used_frame;
+    };
+
+    /// Process the surfaces are in, held so that it outlives their trackers
+    Kernel::SharedPtr<Kernel::Process> process;
+    std::vector<Surface> surfaces;
+    u64 current_frame = 0;
+};
+
+} // namespace VideoCore
@@ -0,0 +1,209 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+#include "core/memory.h"
+#include "video_core/block_linear.h"
+#include "video_core/surface_copy.h"
+
+namespace Tegra {
+
+using VideoCore::BlockLinear::GOB_SIZE;
+using VideoCore::BlockLinear::GOB_SIZE_X;
+using VideoCore::BlockLinear::GOB_SIZE_Y;
+
+namespace {
+
+/// The rows of a GOB are split into chunks of this size, each of them contiguous in memory
+constexpr u32 GOB_CHUNK_SIZE = 16;
+
+/// Rectangle of a surface, with its horizontal coordinates in bytes
+struct ByteRect {
+    u32 x;
+    u32 y;
+    u32 width;
+    u32 height;
+};
+
+/**
+ * Calls a function with the CPU address of each part of a range of GPU memory that lies in a
+ * single page, along with the offset of the part in the range.
+ * @returns False if it stopped at a page that isn't mapped.
+ */
+template <typename Func>
+bool ForEachCpuRange(const MemoryManager& memory_manager, GPUVAddr gpu_addr, size_t size,
+                     Func&& func) {
+    size_t offset = 0;
+    while (offset < size) {
+        const GPUVAddr part_addr = gpu_addr + offset;
+        const boost::optional<VAddr> cpu_addr = memory_manager.GpuToCpuAddress(part_addr);
+        if (!cpu_addr) {
+            return false;
+        }
+        const size_t part_size = std::min<size_t>(
+            size - offset, MemoryManager::PAGE_SIZE - (part_addr & MemoryManager::PAGE_MASK));
+        func(*cpu_addr, offset, part_size);
+        offset += part_size;
+    }
+    return true;
+}
+
+bool ReadGpuBlock(const MemoryManager& memory_manager, GPUVAddr gpu_addr, u8* dest, size_t size) {
+    return ForEachCpuRange(memory_manager, gpu_addr, size,
+                           [dest](VAddr cpu_addr, size_t offset, size_t part_size) {
+                               Memory::ReadBlock(cpu_addr, dest + offset, part_size);
+                           });
+}
+
+bool WriteGpuBlock(const MemoryManager& memory_manager, GPUVAddr gpu_addr, const u8* src,
+                   size_t size) {
+    return ForEachCpuRange(memory_manager, gpu_addr, size,
+                           [src](VAddr cpu_addr, size_t offset, size_t part_size) {
+                               Memory::WriteBlock(cpu_addr, src + offset, part_size);
+                           });
+}
+
+/**
+ * Calls a function with the GPU address of each GOB of a block-linear surface that overlaps a
+ * rectangle, along with the coordinates of the GOB in the surface.
+ * @returns False if the function returned false for a GOB, which stops at it.
+ */
+template <typename Func>
+bool ForEachGob(const CopySurface& surface, u32 bytes_per_pixel, const ByteRect& rect,
+                Func&& func) {
+    const u64 gobs_per_row = (u64(surface.width) * bytes_per_pixel + GOB_SIZE_X - 1) / GOB_SIZE_X;
+    const u64 block_size = u64(GOB_SIZE) * surface.block_height;
+
+    for (u32 gob_y = rect.y / GOB_SIZE_Y; gob_y <= (rect.y + rect.height - 1) / GOB_SIZE_Y;
+         ++gob_y) {
+        const GPUVAddr row_addr = surface.address +
+                                  (gob_y / surface.block_height) * gobs_per_row * block_size +
+                                  (gob_y % surface.block_height) * GOB_SIZE;
+        // Consecutive GOBs of a row are in consecutive blocks
+        for (u32 gob_x = rect.x / GOB_SIZE_X; gob_x <= (rect.x + rect.width - 1) / GOB_SIZE_X;
+             ++gob_x) {
+            if (!func(row_addr + gob_x * block_size, gob_x * GOB_SIZE_X, gob_y * GOB_SIZE_Y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Calls a function with the offset in the GOB and in the rows of the rectangle of each run of
+ * bytes of the GOB inside the rectangle, along with the size of the run.
+ * @param gob_x, gob_y Coordinates of the GOB in the surface
+ */
+template <typename Func>
+void ForEachGobChunk(u32 gob_x, u32 gob_y, const ByteRect& rect, Func&& func) {
+    const u32 x_begin = std::max(rect.x, gob_x);
+    const u32 x_end = std::min(rect.x + rect.width, gob_x + GOB_SIZE_X);
+    const u32 y_begin = std::max(rect.y, gob_y);
+    const u32 y_end = std::min(rect.y + rect.height, gob_y + GOB_SIZE_Y);
+
+    for (u32 y = y_begin; y < y_end; ++y) {
+        for (u32 x = x_begin; x < x_end;) {
+            const u32 chunk_end = std::min(x_end, (x / GOB_CHUNK_SIZE + 1) * GOB_CHUNK_SIZE);
+            func(VideoCore::BlockLinear::GetGobOffset(x, y),
+                 size_t(y - rect.y) * rect.width + (x - rect.x), chunk_end - x);
+            x = chunk_end;
+        }
+    }
+}
+
+/// Whether a GOB lies entirely inside a rectangle
+bool IsGobCovered(u32 gob_x, u32 gob_y, const ByteRect& rect) {
+    return rect.x <= gob_x && gob_x + GOB_SIZE_X <= rect.x + rect.width && rect.y <= gob_y &&
+           gob_y + GOB_SIZE_Y <= rect.y + rect.height;
+}
+
+/// Reads a rectangle of a surface into rows of rect.width bytes
+bool ReadRect(const MemoryManager& memory_manager, const CopySurface& surface,
+              u32 bytes_per_pixel, const ByteRect& rect, u8* rows) {
+    if (!surface.is_block_linear) {
+        const GPUVAddr first_row = surface.address + u64(rect.y) * surface.pitch + rect.x;
+        // Rows as wide as the pitch follow each other, they are read at once
+        if (surface.pitch == rect.width) {
+            return ReadGpuBlock(memory_manager, first_row, rows, size_t(rect.width) * rect.height);
+        }
+        for (u32 y = 0; y < rect.height; ++y) {
+            if (!ReadGpuBlock(memory_manager, first_row + u64(y) * surface.pitch,
+                              rows + size_t(y) * rect.width, rect.width)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::array<u8, GOB_SIZE> gob;
+    return ForEachGob(surface, bytes_per_pixel, rect,
+                      [&](GPUVAddr gob_addr, u32 gob_x, u32 gob_y) {
+                          if (!ReadGpuBlock(memory_manager, gob_addr, gob.data(), GOB_SIZE)) {
+                              return false;
+                          }
+                          ForEachGobChunk(gob_x, gob_y, rect,
+                                          [&](u32 gob_offset, size_t rows_offset, u32 size) {
+                                              std::memcpy(rows + rows_offset,
+                                                          gob.data() + gob_offset, size);
+                                          });
+                          return true;
+                      });
+}
+
+/// Writes rows of rect.width bytes to a rectangle of a surface
+bool WriteRect(const MemoryManager& memory_manager, const CopySurface& surface,
+               u32 bytes_per_pixel, const ByteRect& rect, const u8* rows) {
+    if (!surface.is_block_linear) {
+        const GPUVAddr first_row = surface.address + u64(rect.y) * surface.pitch + rect.x;
+        if (surface.pitch == rect.width) {
+            return WriteGpuBlock(memory_manager, first_row, rows,
+                                 size_t(rect.width) * rect.height);
+        }
+        for (u32 y = 0; y < rect.height; ++y) {
+            if (!WriteGpuBlock(memory_manager, first_row + u64(y) * surface.pitch,
+                               rows + size_t(y) * rect.width, rect.width)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::array<u8, GOB_SIZE> gob;
+    return ForEachGob(surface, bytes_per_pixel, rect,
+                      [&](GPUVAddr gob_addr, u32 gob_x, u32 gob_y) {
+                          // The parts of the GOBs outside of the rectangle are left as they were
+                          if (!IsGobCovered(gob_x, gob_y, rect) &&
+                              !ReadGpuBlock(memory_manager, gob_addr, gob.data(), GOB_SIZE)) {
+                              return false;
+                          }
+                          ForEachGobChunk(gob_x, gob_y, rect,
+                                          [&](u32 gob_offset, size_t rows_offset, u32 size) {
+                                              std::memcpy(gob.data() + gob_offset,
+                                                          rows + rows_offset, size);
+                                          });
+                          return WriteGpuBlock(memory_manager, gob_addr, gob.data(), GOB_SIZE);
+                      });
+}
+
+} // Anonymous namespace
+
+bool CopySurfaceOnCPU(const MemoryManager& memory_manager, const SurfaceCopy& copy) {
+    if (copy.width == 0 || copy.height == 0) {
+        return true;
+    }
+
+    const u32 row_size = copy.width * copy.bytes_per_pixel;
+    const ByteRect src_rect{copy.src_x * copy.bytes_per_pixel, copy.src_y, row_size, copy.height};
+    const ByteRect dst_rect{copy.dst_x * copy.bytes_per_pixel, copy.dst_y, row_size, copy.height};
+
+    std::vector<u8> rows(size_t(row_size) * copy.height);
+    return ReadRect(memory_manager, copy.src, copy.bytes_per_pixel, src_rect, rows.data()) &&
+           WriteRect(memory_manager, copy.dst, copy.bytes_per_pixel, dst_rect, rows.data());
+}
+
+} // namespace Tegra
@@ -0,0 +1,50 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <functional>
+#include "common/common_types.h"
+#include "video_core/memory_manager.h"
+
+namespace Tegra {
+
+/// Surface in GPU memory that a copy engine reads from or writes to
+struct CopySurface {
+    GPUVAddr address;
+    /// Whether the surface is in the block-linear layout, rather than pitch linear
+    bool is_block_linear;
+    /// Bytes between the rows of a pitch linear surface
+    u32 pitch;
+    /// Width in pixels of a block-linear surface, which sets the number of blocks in a row
+    u32 width;
+    /// Height of the blocks of a block-linear surface, in GOBs
+    u32 block_height;
+};
+
+/// Copy of a rectangle of pixels between two surfaces of the same format
+struct SurfaceCopy {
+    CopySurface src;
+    CopySurface dst;
+    u32 bytes_per_pixel;
+    u32 src_x;
+    u32 src_y;
+    u32 dst_x;
+    u32 dst_y;
+    u32 width;
+    u32 height;
+};
+
+/// Called by the copy engines with the copies they are launched with
+using SurfaceCopyCallback = std::function<void(const SurfaceCopy& copy)>;
+
+/**
+ * Copies a rectangle between surfaces in guest memory, through the memory accessors of the CPU so
+ * that the rasterizer caches and the dirty page trackers see the copy. The source is read whole
+ * before the destination is written, so the surfaces may overlap.
+ * @returns False if part of either surface isn't mapped, the copy may then be partly done.
+ */
+bool CopySurfaceOnCPU(const MemoryManager& memory_manager, const SurfaceCopy& copy);
+
+} // namespace Tegra
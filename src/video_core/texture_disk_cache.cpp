@@ -0,0 +1,215 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "common/file_util.h"
+#include "common/hash.h"
+#include "common/logging/log.h"
+#include "common/microprofile.h"
+#include "common/thread_pool.h"
+#include "video_core/texture_disk_cache.h"
+
+namespace VideoCore {
+
+namespace {
+
+/// Changed whenever a decoder changes its output, so that the old entries are never hit
+constexpr u64 CACHE_VERSION = 1;
+
+constexpr char ENTRY_EXTENSION[] = ".tex";
+constexpr char TEMPORARY_EXTENSION[] = ".tmp";
+
+/// Parses the key out of the name of an entry file, which is the key in hexadecimal
+bool ParseEntryName(const std::string& name, const char* extension, u64& key) {
+    constexpr size_t key_length = 16;
+    if (name.size() != key_length + std::strlen(extension) ||
+        name.compare(key_length, std::string::npos, extension) != 0) {
+        return false;
+    }
+    const std::string key_string = name.substr(0, key_length);
+    char* end = nullptr;
+    key = std::strtoull(key_string.c_str(), &end, 16);
+    return end == key_string.c_str() + key_length;
+}
+
+/// Directories are passed around with a trailing separator, as CreateFullPath expects
+std::string WithTrailingSeparator(std::string directory) {
+    if (!directory.empty() && directory.back() != '/' && directory.back() != '\\') {
+        directory += '/';
+    }
+    return directory;
+}
+
+} // Anonymous namespace
+
+MICROPROFILE_DEFINE(TextureDiskCache_Load, "VideoCore", "Load cached texture",
+                    MP_RGB(96, 160, 128));
+
+TextureDiskCache::TextureDiskCache(std::string directory_, u64 max_size)
+    : directory(WithTrailingSeparator(std::move(directory_))), max_size(max_size) {
+    indexed = Common::ThreadPool::GetInstance()
+                  .Submit([this] { IndexDirectory(); }, Common::TaskPriority::Low)
+                  .share();
+}
+
+TextureDiskCache::~TextureDiskCache() {
+    indexed.wait();
+    Flush();
+}
+
+u64 TextureDiskCache::ComputeKey(const u8* encoded, size_t encoded_size, u32 format, u32 width,
+                                 u32 height) {
+    // The hashes of the disk caches have to stay the same across versions and hosts
+    const std::array<u64, 5> key_data{Common::ComputeHash64(encoded, encoded_size),
+                                      CACHE_VERSION, format, width, height};
+    return Common::ComputeHash64(key_data.data(), sizeof(key_data));
+}
+
+bool TextureDiskCache::Load(u64 key, u8* decoded, size_t size) {
+    MICROPROFILE_SCOPE(TextureDiskCache_Load);
+
+    indexed.wait();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto itr = entries.find(key);
+    if (itr == entries.end() || itr->second.size != size) {
+        return false;
+    }
+
+    FileUtil::IOFile file(GetEntryPath(key), "rb");
+    if (!file.IsOpen() || file.ReadBytes(decoded, size) != size) {
+        LOG_ERROR(HW_GPU, "Couldn't read the cached texture %016" PRIx64, key);
+        total_size -= itr->second.size;
+        entries.erase(itr);
+        return false;
+    }
+    itr->second.last_use = ++use_counter;
+    return true;
+}
+
+void TextureDiskCache::Store(u64 key, std::vector<u8> decoded) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (entries.count(key) != 0 || !pending_keys.insert(key).second) {
+            return;
+        }
+    }
+
+    pending_writes.erase(std::remove_if(pending_writes.begin(), pending_writes.end(),
+                                        [](const std::future<void>& future) {
+                                            return future.wait_for(std::chrono::seconds(0)) ==
+                                                   std::future_status::ready;
+                                        }),
+                         pending_writes.end());
+    pending_writes.push_back(Common::ThreadPool::GetInstance().Submit(
+        [this, key, decoded = std::move(decoded)] { WriteEntry(key, decoded); },
+        Common::TaskPriority::Low));
+}
+
+void TextureDiskCache::Flush() {
+    for (std::future<void>& write : pending_writes) {
+        write.wait();
+    }
+    pending_writes.clear();
+}
+
+u64 TextureDiskCache::GetSize() {
+    indexed.wait();
+    std::lock_guard<std::mutex> lock(mutex);
+    return total_size;
+}
+
+size_t TextureDiskCache::GetNumEntries() {
+    indexed.wait();
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+std::string TextureDiskCache::GetEntryPath(u64 key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016" PRIx64 "%s", key, ENTRY_EXTENSION);
+    return directory + name;
+}
+
+void TextureDiskCache::IndexDirectory() {
+    if (!FileUtil::CreateFullPath(directory)) {
+        LOG_ERROR(HW_GPU, "Couldn't create the texture cache directory %s", directory.c_str());
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    FileUtil::ForeachDirectoryEntry(
+        nullptr, directory,
+        [this](unsigned* num_entries_out, const std::string&, const std::string& name) {
+            u64 key;
+            if (ParseEntryName(name, TEMPORARY_EXTENSION, key)) {
+                // Left by a session that ended while writing the entry
+                if (pending_keys.count(key) == 0) {
+                    FileUtil::Delete(directory + name);
+                }
+            } else if (ParseEntryName(name, ENTRY_EXTENSION, key) && entries.count(key) == 0) {
+                const u64 size = FileUtil::GetSize(directory + name);
+                entries[key] = {size, 0};
+                total_size += size;
+            }
+            return true;
+        });
+    LOG_INFO(HW_GPU, "Found %zu cached textures, %" PRIu64 " MiB", entries.size(),
+             total_size >> 20);
+    Trim();
+}
+
+void TextureDiskCache::WriteEntry(u64 key, const std::vector<u8>& decoded) {
+    // Written under another name first, so that a partial entry is never read
+    const std::string path = GetEntryPath(key);
+    const std::string temporary_path =
+        path.substr(0, path.size() - std::strlen(ENTRY_EXTENSION)) + TEMPORARY_EXTENSION;
+    bool is_written;
+    {
+        FileUtil::IOFile file(temporary_path, "wb");
+        is_written = file.IsOpen() && file.WriteBytes(decoded.data(), decoded.size()) ==
+                                          decoded.size();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    pending_keys.erase(key);
+    if (!is_written || !FileUtil::Rename(temporary_path, path)) {
+        LOG_ERROR(HW_GPU, "Couldn't write the cached texture %016" PRIx64, key);
+        FileUtil::Delete(temporary_path);
+        return;
+    }
+    entries[key] = {decoded.size(), ++use_counter};
+    total_size += decoded.size();
+    Trim();
+}
+
+void TextureDiskCache::Trim() {
+    if (total_size <= max_size) {
+        return;
+    }
+
+    std::vector<std::pair<u64, u64>> uses;
+    uses.reserve(entries.size());
+    for (const auto& entry : entries) {
+        uses.emplace_back(entry.second.last_use, entry.first);
+    }
+    std::sort(uses.begin(), uses.end());
+
+    for (const auto& use : uses) {
+        if (total_size <= max_size) {
+            break;
+        }
+        auto itr = entries.find(use.second);
+        FileUtil::Delete(GetEntryPath(use.second));
+        total_size -= itr->second.size;
+        entries.erase(itr);
+    }
+}
+
+} // namespace VideoCore
@@ -0,0 +1,95 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "common/common_types.h"
+
+namespace VideoCore {
+
+/**
+ * Decoded texture data kept on disk across sessions, keyed by a hash of the encoded data and of
+ * how it is decoded. It is meant for the decoders that cost more than hashing their input and
+ * reading their output back, like the software decoders of compressed formats, which look their
+ * results up here before decoding.
+ *
+ * Each entry is a file of the cache directory. The directory is indexed and the new entries are
+ * written by the thread pool, so that neither stalls the renderer. Once the entries take more
+ * than the maximum size, the least recently used ones are deleted, the ones found on disk first.
+ */
+class TextureDiskCache final {
+public:
+    /**
+     * Opens the cache, the directory is indexed in the background.
+     * @param max_size Size the entries are trimmed down to, in bytes.
+     */
+    TextureDiskCache(std::string directory, u64 max_size);
+    /// Waits for the entries being written
+    ~TextureDiskCache();
+
+    TextureDiskCache(const TextureDiskCache&) = delete;
+    TextureDiskCache& operator=(const TextureDiskCache&) = delete;
+
+    /**
+     * Computes the key of a decoded texture.
+     * @param encoded Data of the texture in guest memory.
+     * @param format Format the texture is decoded from, and any other decoding parameter.
+     */
+    static u64 ComputeKey(const u8* encoded, size_t encoded_size, u32 format, u32 width,
+                          u32 height);
+
+    /**
+     * Reads a decoded texture. Waits for the directory to be indexed the first time.
+     * @returns Whether an entry of exactly `size` bytes was read.
+     */
+    bool Load(u64 key, u8* decoded, size_t size);
+
+    /// Adds a decoded texture, which is written in the background
+    void Store(u64 key, std::vector<u8> decoded);
+
+    /// Waits for the entries stored so far to be written
+    void Flush();
+
+    /// Returns the size of the entries on disk, in bytes
+    u64 GetSize();
+
+    size_t GetNumEntries();
+
+private:
+    struct Entry {
+        u64 size;
+        /// Incremented on every use, the entries with the lowest values are deleted first
+        u64 last_use;
+    };
+
+    std::string GetEntryPath(u64 key) const;
+    void IndexDirectory();
+    void WriteEntry(u64 key, const std::vector<u8>& decoded);
+    /// Deletes the least recently used entries until they fit in the maximum size. Needs the mutex.
+    void Trim();
+
+    const std::string directory;
+    const u64 max_size;
+
+    /// Guards everything below, and the entry files
+    std::mutex mutex;
+    std::unordered_map<u64, Entry> entries;
+    /// Entries being written
+    std::unordered_set<u64> pending_keys;
+    u64 total_size = 0;
+    u64 use_counter = 0;
+
+    /// Ready once the directory is indexed
+    std::shared_future<void> indexed;
+    /// Writes queued on the thread pool, only accessed by the thread storing entries
+    std::vector<std::future<void>> pending_writes;
+};
+
+} // namespace VideoCore
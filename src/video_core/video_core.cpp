@@ -4,7 +4,9 @@
 
 #include <memory>
 #include "common/logging/log.h"
+#include "core/settings.h"
 #include "video_core/renderer_base.h"
+#include "video_core/renderer_null/renderer_null.h"
 #include "video_core/renderer_opengl/renderer_opengl.h"
 #include "video_core/video_core.h"
 
@@ -21,7 +23,11 @@ std::atomic<bool> g_toggle_framelimit_enabled;
 /// Initialize the video core
 bool Init(EmuWindow* emu_window) {
     g_emu_window = emu_window;
-    g_renderer = std::make_unique<RendererOpenGL>();
+    if (Settings::values.use_null_renderer) {
+        g_renderer = std::make_unique<RendererNull>(Settings::values.hash_null_renderer_frames);
+    } else {
+        g_renderer = std::make_unique<RendererOpenGL>();
+    }
     g_renderer->SetWindow(g_emu_window);
     if (g_renderer->Init()) {
         LOG_DEBUG(Render, "initialized OK");
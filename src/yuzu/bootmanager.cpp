@@ -1,16 +1,17 @@
 #include <QApplication>
 #include <QHBoxLayout>
 #include <QKeyEvent>
-
-#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
 // Required for screen DPI information
 #include <QScreen>
 #include <QWindow>
-#endif
 
+#include "common/logging/log.h"
 #include "common/microprofile.h"
 #include "common/scm_rev.h"
 #include "common/string_util.h"
+#include "common/thread.h"
 #include "core/core.h"
 #include "core/frontend/framebuffer_layout.h"
 #include "core/settings.h"
@@ -23,9 +24,8 @@ EmuThread::EmuThread(GRenderWindow* render_window)
     : exec_step(false), running(false), stop_run(false), render_window(render_window) {}
 
 void EmuThread::run() {
-    render_window->MakeCurrent();
-
     MicroProfileOnThreadCreate("EmuThread");
+    Common::PinCurrentHostThread(Common::HostThread::CpuCore0);
 
     stop_run = false;
 
@@ -45,8 +45,11 @@ void EmuThread::run() {
             }
 
             was_active = running || exec_step;
-            if (!was_active && !stop_run)
+            if (!was_active && !stop_run) {
+                // Paused, the guest memory can be compressed until the emulation resumes
+                Core::System::GetInstance().CompactMemory();
                 emit DebugModeEntered();
+            }
         } else if (exec_step) {
             if (!was_active)
                 emit DebugModeLeft();
@@ -69,43 +72,50 @@ void EmuThread::run() {
 #if MICROPROFILE_ENABLED
     MicroProfileOnThreadExit();
 #endif
-
-    render_window->moveContext();
 }
 
-// This class overrides paintEvent and resizeEvent to prevent the GUI thread from stealing GL
-// context.
-// The corresponding functionality is handled in EmuThread instead
-class GGLWidgetInternal : public QGLWidget {
+// Native window the frames are presented to. Its GL context belongs to the presentation thread of
+// the renderer, the GUI thread never paints to it. It gets the input events of the render area,
+// and hands them to the render window.
+class GGLWindowInternal : public QWindow {
 public:
-    GGLWidgetInternal(QGLFormat fmt, GRenderWindow* parent)
-        : QGLWidget(fmt, parent), parent(parent) {}
-
-    void paintEvent(QPaintEvent* ev) override {
-        if (do_painting) {
-            QPainter painter(this);
-        }
+    GGLWindowInternal(const QSurfaceFormat& format, GRenderWindow* parent) : parent(parent) {
+        setSurfaceType(QSurface::OpenGLSurface);
+        setFormat(format);
     }
 
+protected:
     void resizeEvent(QResizeEvent* ev) override {
         parent->OnClientAreaResized(ev->size().width(), ev->size().height());
         parent->OnFramebufferSizeChanged();
     }
 
-    void DisablePainting() {
-        do_painting = false;
+    void keyPressEvent(QKeyEvent* event) override {
+        parent->keyPressEvent(event);
+    }
+    void keyReleaseEvent(QKeyEvent* event) override {
+        parent->keyReleaseEvent(event);
+    }
+    void mousePressEvent(QMouseEvent* event) override {
+        parent->mousePressEvent(event);
     }
-    void EnablePainting() {
-        do_painting = true;
+    void mouseMoveEvent(QMouseEvent* event) override {
+        parent->mouseMoveEvent(event);
+    }
+    void mouseReleaseEvent(QMouseEvent* event) override {
+        parent->mouseReleaseEvent(event);
+    }
+    void focusOutEvent(QFocusEvent* event) override {
+        QWindow::focusOutEvent(event);
+        InputCommon::GetKeyboard()->ReleaseAllKeys();
     }
 
 private:
     GRenderWindow* parent;
-    bool do_painting;
 };
 
 GRenderWindow::GRenderWindow(QWidget* parent, EmuThread* emu_thread)
-    : QWidget(parent), child(nullptr), emu_thread(emu_thread) {
+    : QWidget(parent), emu_thread(emu_thread) {
 
     std::string window_title = Common::StringFromFormat("yuzu %s| %s-%s", Common::g_build_name,
                                                         Common::g_scm_branch, Common::g_scm_desc);
@@ -118,36 +128,67 @@ GRenderWindow::~GRenderWindow() {
     InputCommon::Shutdown();
 }
 
-void GRenderWindow::moveContext() {
-    DoneCurrent();
-// We need to move GL context to the swapping thread in Qt5
-#if QT_VERSION > QT_VERSION_CHECK(5, 0, 0)
-    // If the thread started running, move the GL Context to the new thread. Otherwise, move it
-    // back.
-    auto thread = (QThread::currentThread() == qApp->thread() && emu_thread != nullptr)
-                      ? emu_thread
-                      : qApp->thread();
-    child->context()->moveToThread(thread);
-#endif
-}
-
 void GRenderWindow::SwapBuffers() {
-#if !defined(QT_NO_DEBUG)
-    // Qt debug runtime prints a bogus warning on the console if you haven't called makeCurrent
-    // since the last time you called swapBuffers. This presumably means something if you're using
-    // QGLWidget the "regular" way, but in our multi-threaded use case is harmless since we never
-    // call doneCurrent in this thread.
-    child->makeCurrent();
-#endif
-    child->swapBuffers();
+    context->swapBuffers(child);
 }
 
 void GRenderWindow::MakeCurrent() {
-    child->makeCurrent();
+    // The GL context can only be made current on the thread it belongs to. A context that was
+    // released with DoneCurrent belongs to no thread, and is pulled over to the caller.
+    if (context->thread() == nullptr) {
+        context->moveToThread(QThread::currentThread());
+    }
+    context->makeCurrent(child);
 }
 
 void GRenderWindow::DoneCurrent() {
-    child->doneCurrent();
+    context->doneCurrent();
+    context->moveToThread(nullptr);
+}
+
+/// GL context sharing its objects with the context of the render window, with an offscreen surface
+class GGLContext : public EmuWindow::GraphicsContext {
+public:
+    explicit GGLContext(QOpenGLContext* shared_context) {
+        context.setShareContext(shared_context);
+        context.setFormat(shared_context->format());
+        surface.setFormat(shared_context->format());
+        surface.create();
+    }
+
+    bool Create() {
+        if (!context.create()) {
+            return false;
+        }
+        // Like the context of the window, the context is pulled over by the thread using it
+        context.moveToThread(nullptr);
+        return true;
+    }
+
+    void MakeCurrent() override {
+        if (context.thread() == nullptr) {
+            context.moveToThread(QThread::currentThread());
+        }
+        context.makeCurrent(&surface);
+    }
+
+    void DoneCurrent() override {
+        context.doneCurrent();
+        context.moveToThread(nullptr);
+    }
+
+private:
+    QOpenGLContext context;
+    QOffscreenSurface surface;
+};
+
+std::unique_ptr<EmuWindow::GraphicsContext> GRenderWindow::CreateSharedContext() const {
+    auto shared_context = std::make_unique<GGLContext>(context.get());
+    if (!shared_context->Create()) {
+        LOG_ERROR(Frontend, "Failed to create a shared GL context");
+        return nullptr;
+    }
+    return shared_context;
 }
 
 void GRenderWindow::PollEvents() {}
@@ -161,13 +202,13 @@ void GRenderWindow::OnFramebufferSizeChanged() {
     // Screen changes potentially incur a change in screen DPI, hence we should update the
     // framebuffer size
     qreal pixelRatio = windowPixelRatio();
-    unsigned width = child->QPaintDevice::width() * pixelRatio;
-    unsigned height = child->QPaintDevice::height() * pixelRatio;
+    unsigned width = child->width() * pixelRatio;
+    unsigned height = child->height() * pixelRatio;
     UpdateCurrentFramebufferLayout(width, height);
 }
 
 void GRenderWindow::BackupGeometry() {
-    geometry = ((QGLWidget*)this)->saveGeometry();
+    geometry = QWidget::saveGeometry();
 }
 
 void GRenderWindow::RestoreGeometry() {
@@ -185,7 +226,7 @@ QByteArray GRenderWindow::saveGeometry() {
     // If we are a top-level widget, store the current geometry
     // otherwise, store the last backup
     if (parent() == nullptr)
-        return ((QGLWidget*)this)->saveGeometry();
+        return QWidget::saveGeometry();
     else
         return geometry;
 }
@@ -248,31 +289,47 @@ void GRenderWindow::OnClientAreaResized(unsigned width, unsigned height) {
 }
 
 void GRenderWindow::InitRenderTarget() {
-    if (child) {
-        delete child;
-    }
+    // The container owns the window
+    context.reset();
+    delete container;
+    child = nullptr;
 
     if (layout()) {
         delete layout();
     }
 
-    // TODO: One of these flags might be interesting: WA_OpaquePaintEvent, WA_NoBackground,
-    // WA_DontShowOnScreen, WA_DeleteOnClose
-    QGLFormat fmt;
+    QSurfaceFormat fmt;
     fmt.setVersion(3, 3);
-    fmt.setProfile(QGLFormat::CoreProfile);
+    fmt.setProfile(QSurfaceFormat::CoreProfile);
+    fmt.setRenderableType(QSurfaceFormat::OpenGL);
 
     // Requests a forward-compatible context, which is required to get a 3.2+ context on OS X
-    fmt.setOption(QGL::NoDeprecatedFunctions);
+    fmt.setOption(QSurfaceFormat::DeprecatedFunctions, false);
 
-    child = new GGLWidgetInternal(fmt, this);
+    child = new GGLWindowInternal(fmt, this);
+    container = QWidget::createWindowContainer(child, this);
     QBoxLayout* layout = new QHBoxLayout(this);
 
     resize(Layout::ScreenUndocked::Width, Layout::ScreenUndocked::Height);
-    layout->addWidget(child);
+    layout->addWidget(container);
     layout->setMargin(0);
     setLayout(layout);
 
+    // Showing creates the native window the context renders to, the render window is only meant
+    // to be shown when the emulation starts though
+    const bool was_visible = isVisible();
+    show();
+    if (!was_visible) {
+        hide();
+    }
+
+    // The context is created on the GUI thread, and used by the threads of the renderer
+    context = std::make_unique<QOpenGLContext>();
+    context->setFormat(fmt);
+    if (!context->create()) {
+        LOG_ERROR(Frontend, "Failed to create the GL context");
+    }
+
     OnMinimalClientAreaChangeRequest(GetActiveConfig().min_client_area_size);
 
     OnFramebufferSizeChanged();
@@ -288,12 +345,10 @@ void GRenderWindow::OnMinimalClientAreaChangeRequest(
 
 void GRenderWindow::OnEmulationStarting(EmuThread* emu_thread) {
     this->emu_thread = emu_thread;
-    child->DisablePainting();
 }
 
 void GRenderWindow::OnEmulationStopping() {
     emu_thread = nullptr;
-    child->EnablePainting();
 }
 
 void GRenderWindow::showEvent(QShowEvent* event) {
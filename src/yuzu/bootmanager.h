@@ -6,17 +6,19 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
-#include <QGLWidget>
 #include <QThread>
+#include <QWidget>
 #include "common/thread.h"
 #include "core/core.h"
 #include "core/frontend/emu_window.h"
 
 class QKeyEvent;
+class QOpenGLContext;
 class QScreen;
 
-class GGLWidgetInternal;
+class GGLWindowInternal;
 class GMainWindow;
 class GRenderWindow;
 
@@ -113,6 +115,7 @@ public:
     void MakeCurrent() override;
     void DoneCurrent() override;
     void PollEvents() override;
+    std::unique_ptr<GraphicsContext> CreateSharedContext() const override;
 
     void BackupGeometry();
     void RestoreGeometry();
@@ -137,8 +140,6 @@ public:
     void InitRenderTarget();
 
 public slots:
-    void moveContext(); // overridden
-
     void OnEmulationStarting(EmuThread* emu_thread);
     void OnEmulationStopping();
     void OnFramebufferSizeChanged();
@@ -151,7 +152,11 @@ private:
     void OnMinimalClientAreaChangeRequest(
         const std::pair<unsigned, unsigned>& minimal_size) override;
 
-    GGLWidgetInternal* child;
+    GGLWindowInternal* child = nullptr;
+    /// Widget embedding the native window in the widget tree
+    QWidget* container = nullptr;
+    /// Context of the window, current on one thread of the renderer at a time
+    std::unique_ptr<QOpenGLContext> context;
 
     QByteArray geometry;
 
@@ -71,15 +71,50 @@ void Config::ReadValues() {
     qt_config->beginGroup("Core");
     Settings::values.cpu_core =
         static_cast<Settings::CpuCore>(qt_config->value("cpu_core", 0).toInt());
+    Settings::values.use_multi_core = qt_config->value("use_multi_core", false).toBool();
+    Settings::values.use_lazy_module_loading =
+        qt_config->value("use_lazy_module_loading", false).toBool();
+    Settings::values.use_shared_module_images =
+        qt_config->value("use_shared_module_images", false).toBool();
+    Settings::values.use_code_write_detection =
+        qt_config->value("use_code_write_detection", false).toBool();
+    Settings::values.cpu_clock_percentage = qt_config->value("cpu_clock_percentage", 100).toUInt();
+    Settings::values.use_deterministic_mode =
+        qt_config->value("use_deterministic_mode", false).toBool();
+    Settings::values.pin_host_threads = qt_config->value("pin_host_threads", false).toBool();
+    Settings::values.use_memory_compaction =
+        qt_config->value("use_memory_compaction", false).toBool();
+    Settings::values.use_title_profiles = qt_config->value("use_title_profiles", true).toBool();
+    qt_config->endGroup();
+
+    qt_config->beginGroup("System");
+    Settings::values.use_docked_mode = qt_config->value("use_docked_mode", false).toBool();
     qt_config->endGroup();
 
     qt_config->beginGroup("Renderer");
     Settings::values.resolution_factor = qt_config->value("resolution_factor", 1.0).toFloat();
     Settings::values.toggle_framelimit = qt_config->value("toggle_framelimit", true).toBool();
+    Settings::values.speed_limit = qt_config->value("speed_limit", 100).toUInt();
+    Settings::values.turbo_speed_limit = qt_config->value("turbo_speed_limit", 0).toUInt();
+    Settings::values.present_ahead_depth = qt_config->value("present_ahead_depth", 2).toInt();
+    Settings::values.use_low_latency_mode =
+        qt_config->value("use_low_latency_mode", false).toBool();
+    Settings::values.refresh_mode =
+        static_cast<Settings::RefreshMode>(qt_config->value("refresh_mode", 0).toInt());
+    Settings::values.refresh_rate = qt_config->value("refresh_rate", 60).toUInt();
+    Settings::values.use_gpu_unswizzle = qt_config->value("use_gpu_unswizzle", true).toBool();
 
     Settings::values.bg_red = qt_config->value("bg_red", 0.0).toFloat();
     Settings::values.bg_green = qt_config->value("bg_green", 0.0).toFloat();
     Settings::values.bg_blue = qt_config->value("bg_blue", 0.0).toFloat();
+    Settings::values.frame_dump_file =
+        qt_config->value("frame_dump_file", "").toString().toStdString();
+    qt_config->endGroup();
+
+    qt_config->beginGroup("Audio");
+    Settings::values.sink_id = qt_config->value("output_engine", "auto").toString().toStdString();
+    Settings::values.enable_audio_stretching =
+        qt_config->value("enable_audio_stretching", true).toBool();
     qt_config->endGroup();
 
     qt_config->beginGroup("Data Storage");
@@ -164,16 +199,43 @@ void Config::SaveValues() {
 
     qt_config->beginGroup("Core");
     qt_config->setValue("cpu_core", static_cast<int>(Settings::values.cpu_core));
+    qt_config->setValue("use_multi_core", Settings::values.use_multi_core);
+    qt_config->setValue("use_lazy_module_loading", Settings::values.use_lazy_module_loading);
+    qt_config->setValue("use_shared_module_images", Settings::values.use_shared_module_images);
+    qt_config->setValue("use_code_write_detection", Settings::values.use_code_write_detection);
+    qt_config->setValue("cpu_clock_percentage", Settings::values.cpu_clock_percentage);
+    qt_config->setValue("use_deterministic_mode", Settings::values.use_deterministic_mode);
+    qt_config->setValue("pin_host_threads", Settings::values.pin_host_threads);
+    qt_config->setValue("use_memory_compaction", Settings::values.use_memory_compaction);
+    qt_config->setValue("use_title_profiles", Settings::values.use_title_profiles);
+    qt_config->endGroup();
+
+    qt_config->beginGroup("System");
+    qt_config->setValue("use_docked_mode", Settings::values.use_docked_mode);
     qt_config->endGroup();
 
     qt_config->beginGroup("Renderer");
     qt_config->setValue("resolution_factor", (double)Settings::values.resolution_factor);
     qt_config->setValue("toggle_framelimit", Settings::values.toggle_framelimit);
+    qt_config->setValue("speed_limit", Settings::values.speed_limit);
+    qt_config->setValue("turbo_speed_limit", Settings::values.turbo_speed_limit);
+    qt_config->setValue("present_ahead_depth", Settings::values.present_ahead_depth);
+    qt_config->setValue("use_low_latency_mode", Settings::values.use_low_latency_mode);
+    qt_config->setValue("refresh_mode", static_cast<int>(Settings::values.refresh_mode));
+    qt_config->setValue("refresh_rate", Settings::values.refresh_rate);
+    qt_config->setValue("use_gpu_unswizzle", Settings::values.use_gpu_unswizzle);
 
     // Cast to double because Qt's written float values are not human-readable
     qt_config->setValue("bg_red", (double)Settings::values.bg_red);
     qt_config->setValue("bg_green", (double)Settings::values.bg_green);
     qt_config->setValue("bg_blue", (double)Settings::values.bg_blue);
+    qt_config->setValue("frame_dump_file",
+                        QString::fromStdString(Settings::values.frame_dump_file));
+    qt_config->endGroup();
+
+    qt_config->beginGroup("Audio");
+    qt_config->setValue("output_engine", QString::fromStdString(Settings::values.sink_id));
+    qt_config->setValue("enable_audio_stretching", Settings::values.enable_audio_stretching);
     qt_config->endGroup();
 
     qt_config->beginGroup("Data Storage");
@@ -0,0 +1,105 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <QTimer>
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include "core/core.h"
+#include "yuzu/debugger/jit_stats.h"
+#include "yuzu/util/util.h"
+
+JitStatsWidget::JitStatsWidget(QWidget* parent) : QDockWidget(tr("JIT Statistics"), parent) {
+    setObjectName("JitStatsWidget");
+
+    tree = new QTreeWidget(this);
+    tree->setColumnCount(2);
+    tree->setHeaderLabels({tr("Counter"), tr("Value")});
+
+    const std::array<QString, NUM_COUNTERS> names{{
+        tr("Runs"),
+        tr("Run Time"),
+        tr("Average Run Time"),
+        tr("Halts"),
+        tr("SVCs"),
+        tr("Cache Clears"),
+        tr("Cache Invalidations"),
+        tr("Invalidated Bytes"),
+        tr("Translator Resets"),
+        tr("Interpreter Fallbacks"),
+        tr("Interpreted Instructions"),
+        tr("Code Cache"),
+    }};
+    const QFont font = GetMonospaceFont();
+    for (size_t i = 0; i < items.size(); ++i) {
+        items[i] = new QTreeWidgetItem(QStringList(names[i]));
+        items[i]->setFont(1, font);
+        items[i]->setTextAlignment(1, Qt::AlignRight);
+        tree->addTopLevelItem(items[i]);
+    }
+    fallback_pcs_item = new QTreeWidgetItem(QStringList(tr("Top Interpreter Fallback PCs")));
+    tree->addTopLevelItem(fallback_pcs_item);
+    setWidget(tree);
+
+    refresh_timer = new QTimer(this);
+    refresh_timer->setInterval(1000);
+    connect(refresh_timer, &QTimer::timeout, this, &JitStatsWidget::Refresh);
+    setEnabled(false);
+}
+
+void JitStatsWidget::OnEmulationStarting(EmuThread* emu_thread) {
+    setEnabled(true);
+    Refresh();
+    refresh_timer->start();
+}
+
+void JitStatsWidget::OnEmulationStopping() {
+    // The CPU cores are destroyed right after, they must not be queried anymore
+    refresh_timer->stop();
+    for (QTreeWidgetItem* item : items) {
+        item->setText(1, QString());
+    }
+    qDeleteAll(fallback_pcs_item->takeChildren());
+    setEnabled(false);
+}
+
+void JitStatsWidget::Refresh() {
+    if (!isVisible() || !Core::System::GetInstance().IsPoweredOn()) {
+        return;
+    }
+
+    Core::System& system = Core::System::GetInstance();
+    const ARM_Interface::JitStats stats = system.GetJitStats();
+    const u64 cache_bytes = system.GetMemoryFootprint().jit_cache;
+    const double average_run_us = stats.runs != 0 ? stats.run_time_ns / 1e3 / stats.runs : 0.0;
+
+    const std::array<QString, NUM_COUNTERS> values{{
+        QString::number(stats.runs),
+        tr("%1 ms").arg(stats.run_time_ns / 1e6, 0, 'f', 1),
+        tr("%1 us").arg(average_run_us, 0, 'f', 2),
+        QString::number(stats.halts),
+        QString::number(stats.svcs),
+        QString::number(stats.cache_clears),
+        QString::number(stats.cache_invalidations),
+        ReadableByteSize(stats.invalidated_bytes),
+        QString::number(stats.translator_resets),
+        QString::number(stats.interpreter_fallbacks),
+        QString::number(stats.interpreted_instructions),
+        ReadableByteSize(cache_bytes),
+    }};
+    for (size_t i = 0; i < items.size(); ++i) {
+        items[i]->setText(1, values[i]);
+    }
+
+    qDeleteAll(fallback_pcs_item->takeChildren());
+    const QFont font = GetMonospaceFont();
+    for (const auto& [pc, hits] : stats.top_fallback_pcs) {
+        auto* item = new QTreeWidgetItem(
+            QStringList{QStringLiteral("0x%1").arg(pc, 16, 16, QLatin1Char('0')),
+                        tr("%n hit(s)", "", static_cast<int>(hits))});
+        item->setFont(0, font);
+        item->setFont(1, font);
+        item->setTextAlignment(1, Qt::AlignRight);
+        fallback_pcs_item->addChild(item);
+    }
+}
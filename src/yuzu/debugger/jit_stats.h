@@ -0,0 +1,39 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <QDockWidget>
+
+class QTimer;
+class QTreeWidget;
+class QTreeWidgetItem;
+class EmuThread;
+
+/**
+ * Shows the statistics of the JIT of all the CPU cores, along with the guest PCs needing the
+ * interpreter fallback most often. Refreshed while it is visible.
+ */
+class JitStatsWidget : public QDockWidget {
+    Q_OBJECT
+
+public:
+    explicit JitStatsWidget(QWidget* parent = nullptr);
+
+public slots:
+    void OnEmulationStarting(EmuThread* emu_thread);
+    void OnEmulationStopping();
+
+private slots:
+    void Refresh();
+
+private:
+    static constexpr int NUM_COUNTERS = 12;
+
+    QTreeWidget* tree;
+    std::array<QTreeWidgetItem*, NUM_COUNTERS> items;
+    QTreeWidgetItem* fallback_pcs_item;
+    QTimer* refresh_timer;
+};
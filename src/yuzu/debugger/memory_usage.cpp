@@ -0,0 +1,82 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <QTimer>
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include "core/core.h"
+#include "yuzu/debugger/memory_usage.h"
+#include "yuzu/util/util.h"
+
+MemoryUsageWidget::MemoryUsageWidget(QWidget* parent)
+    : QDockWidget(tr("Memory Usage"), parent) {
+    setObjectName("MemoryUsageWidget");
+
+    tree = new QTreeWidget(this);
+    tree->setColumnCount(2);
+    tree->setHeaderLabels({tr("Category"), tr("Host Memory")});
+    tree->setRootIsDecorated(false);
+
+    const std::array<QString, NUM_CATEGORIES> names{{
+        tr("Page Tables"),
+        tr("Guest Heap"),
+        tr("Code Sets"),
+        tr("Shared Memory"),
+        tr("Other Guest Memory"),
+        tr("JIT Cache"),
+        tr("Renderer Buffers"),
+        tr("Service Buffers"),
+        tr("Total"),
+    }};
+    const QFont font = GetMonospaceFont();
+    for (size_t i = 0; i < items.size(); ++i) {
+        items[i] = new QTreeWidgetItem(QStringList(names[i]));
+        items[i]->setFont(1, font);
+        items[i]->setTextAlignment(1, Qt::AlignRight);
+        tree->addTopLevelItem(items[i]);
+    }
+    setWidget(tree);
+
+    refresh_timer = new QTimer(this);
+    refresh_timer->setInterval(1000);
+    connect(refresh_timer, &QTimer::timeout, this, &MemoryUsageWidget::Refresh);
+    setEnabled(false);
+}
+
+void MemoryUsageWidget::OnEmulationStarting(EmuThread* emu_thread) {
+    setEnabled(true);
+    Refresh();
+    refresh_timer->start();
+}
+
+void MemoryUsageWidget::OnEmulationStopping() {
+    // The system is shut down right after, it must not be measured anymore
+    refresh_timer->stop();
+    for (QTreeWidgetItem* item : items) {
+        item->setText(1, QString());
+    }
+    setEnabled(false);
+}
+
+void MemoryUsageWidget::Refresh() {
+    if (!isVisible() || !Core::System::GetInstance().IsPoweredOn()) {
+        return;
+    }
+
+    const Core::MemoryFootprint footprint = Core::System::GetInstance().GetMemoryFootprint();
+    const std::array<u64, NUM_CATEGORIES> sizes{{
+        footprint.page_tables,
+        footprint.guest_heap,
+        footprint.code_sets,
+        footprint.shared_memory,
+        footprint.other_guest_memory,
+        footprint.jit_cache,
+        footprint.renderer_buffers,
+        footprint.service_buffers,
+        footprint.Total(),
+    }};
+    for (size_t i = 0; i < items.size(); ++i) {
+        items[i]->setText(1, ReadableByteSize(sizes[i]));
+    }
+}
@@ -0,0 +1,35 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <QDockWidget>
+
+class QTimer;
+class QTreeWidget;
+class QTreeWidgetItem;
+class EmuThread;
+
+/// Shows the host memory used by the emulation, by category, refreshed while it is visible
+class MemoryUsageWidget : public QDockWidget {
+    Q_OBJECT
+
+public:
+    explicit MemoryUsageWidget(QWidget* parent = nullptr);
+
+public slots:
+    void OnEmulationStarting(EmuThread* emu_thread);
+    void OnEmulationStopping();
+
+private slots:
+    void Refresh();
+
+private:
+    static constexpr int NUM_CATEGORIES = 9;
+
+    QTreeWidget* tree;
+    std::array<QTreeWidgetItem*, NUM_CATEGORIES> items;
+    QTimer* refresh_timer;
+};
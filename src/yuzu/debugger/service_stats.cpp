@@ -0,0 +1,156 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <map>
+#include <QHeaderView>
+#include <QScrollBar>
+#include <QSet>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include "core/core.h"
+#include "core/hle/service/command_stats.h"
+#include "yuzu/debugger/service_stats.h"
+#include "yuzu/util/util.h"
+
+namespace {
+
+enum Column {
+    Name,
+    Calls,
+    TotalTime,
+    AverageTime,
+    MedianTime,
+    MaxTime,
+    BufferBytes,
+    NumColumns,
+};
+
+/// Item sorted by the numbers of its columns rather than by their text
+class StatsItem : public QTreeWidgetItem {
+public:
+    StatsItem(const QString& name, const Service::CommandStats& stats) {
+        setText(Name, name);
+
+        const QFont font = GetMonospaceFont();
+        const double average_ns = stats.calls != 0 ? double(stats.total_ns) / stats.calls : 0.0;
+        SetNumber(Calls, stats.calls, QString::number(stats.calls), font);
+        SetNumber(TotalTime, stats.total_ns, QString::number(stats.total_ns / 1e6, 'f', 2), font);
+        SetNumber(AverageTime, average_ns, QString::number(average_ns / 1e3, 'f', 1), font);
+        const u64 median_bound_ns = stats.GetMedianBoundNs();
+        if (median_bound_ns != 0) {
+            SetNumber(MedianTime, median_bound_ns,
+                      QStringLiteral("< ") + QString::number(median_bound_ns / 1e3, 'f', 1), font);
+        }
+        SetNumber(MaxTime, stats.max_ns, QString::number(stats.max_ns / 1e3, 'f', 1), font);
+        SetNumber(BufferBytes, stats.buffer_bytes, ReadableByteSize(stats.buffer_bytes), font);
+    }
+
+    bool operator<(const QTreeWidgetItem& other) const override {
+        const int column = treeWidget() != nullptr ? treeWidget()->sortColumn() : Name;
+        if (column == Name) {
+            return QTreeWidgetItem::operator<(other);
+        }
+        return data(column, Qt::UserRole).toDouble() < other.data(column, Qt::UserRole).toDouble();
+    }
+
+private:
+    void SetNumber(int column, double value, const QString& text, const QFont& font) {
+        setText(column, text);
+        setData(column, Qt::UserRole, value);
+        setFont(column, font);
+        setTextAlignment(column, Qt::AlignRight);
+    }
+};
+
+/// Adds the statistics of a command to those of its service
+void Accumulate(Service::CommandStats& totals, const Service::CommandStats& stats) {
+    totals.calls += stats.calls;
+    totals.total_ns += stats.total_ns;
+    totals.max_ns = std::max(totals.max_ns, stats.max_ns);
+    totals.buffer_bytes += stats.buffer_bytes;
+    for (size_t bucket = 0; bucket < stats.latency_histogram.size(); ++bucket) {
+        totals.latency_histogram[bucket] += stats.latency_histogram[bucket];
+    }
+}
+
+} // Anonymous namespace
+
+ServiceStatsWidget::ServiceStatsWidget(QWidget* parent)
+    : QDockWidget(tr("Service Statistics"), parent) {
+    setObjectName("ServiceStatsWidget");
+
+    tree = new QTreeWidget(this);
+    tree->setColumnCount(NumColumns);
+    tree->setHeaderLabels({tr("Service / Command"), tr("Calls"), tr("Total (ms)"),
+                           tr("Average (us)"), tr("Median (us)"), tr("Max (us)"),
+                           tr("Buffers")});
+    tree->setSortingEnabled(true);
+    tree->sortByColumn(TotalTime, Qt::DescendingOrder);
+    tree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    setWidget(tree);
+
+    refresh_timer = new QTimer(this);
+    refresh_timer->setInterval(1000);
+    connect(refresh_timer, &QTimer::timeout, this, &ServiceStatsWidget::Refresh);
+    setEnabled(false);
+}
+
+void ServiceStatsWidget::OnEmulationStarting(EmuThread* emu_thread) {
+    setEnabled(true);
+    Refresh();
+    refresh_timer->start();
+}
+
+void ServiceStatsWidget::OnEmulationStopping() {
+    // The statistics of the session are kept on screen until the next one starts
+    refresh_timer->stop();
+    setEnabled(false);
+}
+
+void ServiceStatsWidget::Refresh() {
+    if (!isVisible() || !Core::System::GetInstance().IsPoweredOn()) {
+        return;
+    }
+
+    QSet<QString> expanded;
+    for (int i = 0; i < tree->topLevelItemCount(); ++i) {
+        if (tree->topLevelItem(i)->isExpanded()) {
+            expanded.insert(tree->topLevelItem(i)->text(Name));
+        }
+    }
+
+    std::map<std::string, std::vector<Service::CommandStatsEntry>> services;
+    for (Service::CommandStatsEntry& entry : Service::GetCommandStatsSnapshot()) {
+        services[entry.service_name].push_back(std::move(entry));
+    }
+
+    const int scroll_position = tree->verticalScrollBar()->value();
+    tree->setUpdatesEnabled(false);
+    tree->clear();
+    for (const auto& [service_name, commands] : services) {
+        Service::CommandStats totals;
+        QList<QTreeWidgetItem*> children;
+        for (const Service::CommandStatsEntry& command : commands) {
+            Accumulate(totals, command.stats);
+            QString name = QString::fromStdString(command.command_name);
+            if (name.isEmpty()) {
+                name = tr("Command %1").arg(command.command_id);
+            }
+            if (!command.is_implemented) {
+                name += tr(" (unimplemented)");
+            }
+            children.append(new StatsItem(name, command.stats));
+        }
+
+        const QString name = QString::fromStdString(service_name);
+        auto* item = new StatsItem(name, totals);
+        item->addChildren(children);
+        tree->addTopLevelItem(item);
+        item->setExpanded(expanded.contains(name));
+    }
+    tree->verticalScrollBar()->setValue(scroll_position);
+    tree->setUpdatesEnabled(true);
+}
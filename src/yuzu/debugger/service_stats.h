@@ -0,0 +1,33 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <QDockWidget>
+
+class QTimer;
+class QTreeWidget;
+class EmuThread;
+
+/**
+ * Shows the calls to the HLE services by service and command: their number, their latencies and
+ * the size of the buffers they passed. Refreshed while it is visible.
+ */
+class ServiceStatsWidget : public QDockWidget {
+    Q_OBJECT
+
+public:
+    explicit ServiceStatsWidget(QWidget* parent = nullptr);
+
+public slots:
+    void OnEmulationStarting(EmuThread* emu_thread);
+    void OnEmulationStopping();
+
+private slots:
+    void Refresh();
+
+private:
+    QTreeWidget* tree;
+    QTimer* refresh_timer;
+};
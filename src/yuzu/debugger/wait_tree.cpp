@@ -2,6 +2,9 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <unordered_set>
+#include <QTimer>
+#include "common/scope_exit.h"
 #include "yuzu/debugger/wait_tree.h"
 #include "yuzu/util/util.h"
 
@@ -11,6 +14,7 @@
 #include "core/hle/kernel/thread.h"
 #include "core/hle/kernel/timer.h"
 #include "core/hle/kernel/wait_object.h"
+#include "core/hle/lock.h"
 
 WaitTreeItem::~WaitTreeItem() {}
 
@@ -22,17 +26,47 @@ std::vector<std::unique_ptr<WaitTreeItem>> WaitTreeItem::GetChildren() const {
     return {};
 }
 
+bool WaitTreeItem::IsSameAs(const WaitTreeItem& other) const {
+    return metaObject() == other.metaObject();
+}
+
 void WaitTreeItem::Expand() {
     if (IsExpandable() && !expanded) {
-        children = GetChildren();
-        for (std::size_t i = 0; i < children.size(); ++i) {
-            children[i]->parent = this;
-            children[i]->row = i;
+        for (auto& child : GetChildren()) {
+            child->SetDisplay(child->GetText(), child->GetColor());
+            AppendChild(std::move(child));
         }
         expanded = true;
     }
 }
 
+bool WaitTreeItem::IsExpanded() const {
+    return expanded;
+}
+
+bool WaitTreeItem::SetDisplay(const QString& text, const QColor& color) {
+    if (text == display_text && color == display_color) {
+        return false;
+    }
+    display_text = text;
+    display_color = color;
+    return true;
+}
+
+const QString& WaitTreeItem::GetDisplayText() const {
+    return display_text;
+}
+
+const QColor& WaitTreeItem::GetDisplayColor() const {
+    return display_color;
+}
+
+void WaitTreeItem::AppendChild(std::unique_ptr<WaitTreeItem> child) {
+    child->parent = this;
+    child->row = children.size();
+    children.push_back(std::move(child));
+}
+
 WaitTreeItem* WaitTreeItem::Parent() const {
     return parent;
 }
@@ -49,24 +83,14 @@ std::size_t WaitTreeItem::Row() const {
     return row;
 }
 
-std::vector<std::unique_ptr<WaitTreeThread>> WaitTreeItem::MakeThreadItemList() {
-    const auto& threads = Kernel::GetThreadList();
-    std::vector<std::unique_ptr<WaitTreeThread>> item_list;
-    item_list.reserve(threads.size());
-    for (std::size_t i = 0; i < threads.size(); ++i) {
-        item_list.push_back(std::make_unique<WaitTreeThread>(*threads[i]));
-        item_list.back()->row = i;
-    }
-    return item_list;
-}
-
 WaitTreeText::WaitTreeText(const QString& t) : text(t) {}
 
 QString WaitTreeText::GetText() const {
     return text;
 }
 
-WaitTreeWaitObject::WaitTreeWaitObject(const Kernel::WaitObject& o) : object(o) {}
+WaitTreeWaitObject::WaitTreeWaitObject(Kernel::SharedPtr<Kernel::WaitObject> o)
+    : object(std::move(o)) {}
 
 bool WaitTreeExpandableItem::IsExpandable() const {
     return true;
@@ -74,41 +98,51 @@ bool WaitTreeExpandableItem::IsExpandable() const {
 
 QString WaitTreeWaitObject::GetText() const {
     return tr("[%1]%2 %3")
-        .arg(object.GetObjectId())
-        .arg(QString::fromStdString(object.GetTypeName()),
-             QString::fromStdString(object.GetName()));
+        .arg(object->GetObjectId())
+        .arg(QString::fromStdString(object->GetTypeName()),
+             QString::fromStdString(object->GetName()));
 }
 
-std::unique_ptr<WaitTreeWaitObject> WaitTreeWaitObject::make(const Kernel::WaitObject& object) {
-    switch (object.GetHandleType()) {
+std::unique_ptr<WaitTreeWaitObject> WaitTreeWaitObject::make(
+    Kernel::SharedPtr<Kernel::WaitObject> object) {
+    switch (object->GetHandleType()) {
     case Kernel::HandleType::Event:
-        return std::make_unique<WaitTreeEvent>(static_cast<const Kernel::Event&>(object));
+        return std::make_unique<WaitTreeEvent>(boost::static_pointer_cast<Kernel::Event>(object));
     case Kernel::HandleType::Mutex:
-        return std::make_unique<WaitTreeMutex>(static_cast<const Kernel::Mutex&>(object));
+        return std::make_unique<WaitTreeMutex>(boost::static_pointer_cast<Kernel::Mutex>(object));
     case Kernel::HandleType::ConditionVariable:
         return std::make_unique<WaitTreeConditionVariable>(
-            static_cast<const Kernel::ConditionVariable&>(object));
+            boost::static_pointer_cast<Kernel::ConditionVariable>(object));
     case Kernel::HandleType::Timer:
-        return std::make_unique<WaitTreeTimer>(static_cast<const Kernel::Timer&>(object));
+        return std::make_unique<WaitTreeTimer>(boost::static_pointer_cast<Kernel::Timer>(object));
     case Kernel::HandleType::Thread:
-        return std::make_unique<WaitTreeThread>(static_cast<const Kernel::Thread&>(object));
+        return std::make_unique<WaitTreeThread>(boost::static_pointer_cast<Kernel::Thread>(object));
     default:
-        return std::make_unique<WaitTreeWaitObject>(object);
+        return std::make_unique<WaitTreeWaitObject>(std::move(object));
     }
 }
 
 std::vector<std::unique_ptr<WaitTreeItem>> WaitTreeWaitObject::GetChildren() const {
     std::vector<std::unique_ptr<WaitTreeItem>> list;
 
-    const auto& threads = object.GetWaitingThreads();
+    auto threads = object->GetWaitingThreads();
     if (threads.empty()) {
         list.push_back(std::make_unique<WaitTreeText>(tr("waited by no thread")));
     } else {
-        list.push_back(std::make_unique<WaitTreeThreadList>(threads));
+        list.push_back(std::make_unique<WaitTreeThreadList>(std::move(threads)));
     }
     return list;
 }
 
+bool WaitTreeWaitObject::IsSameAs(const WaitTreeItem& other) const {
+    return WaitTreeItem::IsSameAs(other) &&
+           object == static_cast<const WaitTreeWaitObject&>(other).object;
+}
+
+const Kernel::WaitObject& WaitTreeWaitObject::GetObject() const {
+    return *object;
+}
+
 QString WaitTreeWaitObject::GetResetTypeQString(Kernel::ResetType reset_type) {
     switch (reset_type) {
     case Kernel::ResetType::OneShot:
@@ -120,8 +154,7 @@ QString WaitTreeWaitObject::GetResetTypeQString(Kernel::ResetType reset_type) {
     }
 }
 
-WaitTreeObjectList::WaitTreeObjectList(
-    const std::vector<Kernel::SharedPtr<Kernel::WaitObject>>& list, bool w_all)
+WaitTreeObjectList::WaitTreeObjectList(const Kernel::WaitObjectList& list, bool w_all)
     : object_list(list), wait_all(w_all) {}
 
 QString WaitTreeObjectList::GetText() const {
@@ -133,14 +166,15 @@ QString WaitTreeObjectList::GetText() const {
 std::vector<std::unique_ptr<WaitTreeItem>> WaitTreeObjectList::GetChildren() const {
     std::vector<std::unique_ptr<WaitTreeItem>> list(object_list.size());
     std::transform(object_list.begin(), object_list.end(), list.begin(),
-                   [](const auto& t) { return WaitTreeWaitObject::make(*t); });
+                   [](const auto& t) { return WaitTreeWaitObject::make(t); });
     return list;
 }
 
-WaitTreeThread::WaitTreeThread(const Kernel::Thread& thread) : WaitTreeWaitObject(thread) {}
+WaitTreeThread::WaitTreeThread(Kernel::SharedPtr<Kernel::Thread> thread)
+    : WaitTreeWaitObject(std::move(thread)) {}
 
 QString WaitTreeThread::GetText() const {
-    const auto& thread = static_cast<const Kernel::Thread&>(object);
+    const auto& thread = static_cast<const Kernel::Thread&>(*object);
     QString status;
     switch (thread.status) {
     case THREADSTATUS_RUNNING:
@@ -155,6 +189,9 @@ QString WaitTreeThread::GetText() const {
     case THREADSTATUS_WAIT_SLEEP:
         status = tr("sleeping");
         break;
+    case THREADSTATUS_WAIT_IPC:
+        status = tr("waiting for IPC response");
+        break;
     case THREADSTATUS_WAIT_SYNCH_ALL:
     case THREADSTATUS_WAIT_SYNCH_ANY:
         status = tr("waiting for objects");
@@ -173,7 +210,7 @@ QString WaitTreeThread::GetText() const {
 }
 
 QColor WaitTreeThread::GetColor() const {
-    const auto& thread = static_cast<const Kernel::Thread&>(object);
+    const auto& thread = static_cast<const Kernel::Thread&>(*object);
     switch (thread.status) {
     case THREADSTATUS_RUNNING:
         return QColor(Qt::GlobalColor::darkGreen);
@@ -183,6 +220,8 @@ QColor WaitTreeThread::GetColor() const {
         return QColor(Qt::GlobalColor::darkRed);
     case THREADSTATUS_WAIT_SLEEP:
         return QColor(Qt::GlobalColor::darkYellow);
+    case THREADSTATUS_WAIT_IPC:
+        return QColor(Qt::GlobalColor::darkMagenta);
     case THREADSTATUS_WAIT_SYNCH_ALL:
     case THREADSTATUS_WAIT_SYNCH_ANY:
         return QColor(Qt::GlobalColor::red);
@@ -198,7 +237,7 @@ QColor WaitTreeThread::GetColor() const {
 std::vector<std::unique_ptr<WaitTreeItem>> WaitTreeThread::GetChildren() const {
     std::vector<std::unique_ptr<WaitTreeItem>> list(WaitTreeWaitObject::GetChildren());
 
-    const auto& thread = static_cast<const Kernel::Thread&>(object);
+    const auto& thread = static_cast<const Kernel::Thread&>(*object);
 
     QString processor;
     switch (thread.processor_id) {
@@ -238,50 +277,54 @@ std::vector<std::unique_ptr<WaitTreeItem>> WaitTreeThread::GetChildren() const {
     return list;
 }
 
-WaitTreeEvent::WaitTreeEvent(const Kernel::Event& object) : WaitTreeWaitObject(object) {}
+WaitTreeEvent::WaitTreeEvent(Kernel::SharedPtr<Kernel::Event> object)
+    : WaitTreeWaitObject(std::move(object)) {}
 
 std::vector<std::unique_ptr<WaitTreeItem>> WaitTreeEvent::GetChildren() const {
     std::vector<std::unique_ptr<WaitTreeItem>> list(WaitTreeWaitObject::GetChildren());
 
     list.push_back(std::make_unique<WaitTreeText>(
         tr("reset type = %1")
-            .arg(GetResetTypeQString(static_cast<const Kernel::Event&>(object).reset_type))));
+            .arg(GetResetTypeQString(static_cast<const Kernel::Event&>(*object).reset_type))));
     return list;
 }
 
-WaitTreeMutex::WaitTreeMutex(const Kernel::Mutex& object) : WaitTreeWaitObject(object) {}
+WaitTreeMutex::WaitTreeMutex(Kernel::SharedPtr<Kernel::Mutex> object)
+    : WaitTreeWaitObject(std::move(object)) {}
 
 std::vector<std::unique_ptr<WaitTreeItem>> WaitTreeMutex::GetChildren() const {
     std::vector<std::unique_ptr<WaitTreeItem>> list(WaitTreeWaitObject::GetChildren());
 
-    const auto& mutex = static_cast<const Kernel::Mutex&>(object);
+    const auto& mutex = static_cast<const Kernel::Mutex&>(*object);
     if (mutex.GetHasWaiters()) {
         list.push_back(std::make_unique<WaitTreeText>(tr("locked by thread:")));
-        list.push_back(std::make_unique<WaitTreeThread>(*mutex.GetHoldingThread()));
+        list.push_back(std::make_unique<WaitTreeThread>(mutex.GetHoldingThread()));
     } else {
         list.push_back(std::make_unique<WaitTreeText>(tr("free")));
     }
     return list;
 }
 
-WaitTreeConditionVariable::WaitTreeConditionVariable(const Kernel::ConditionVariable& object)
-    : WaitTreeWaitObject(object) {}
+WaitTreeConditionVariable::WaitTreeConditionVariable(
+    Kernel::SharedPtr<Kernel::ConditionVariable> object)
+    : WaitTreeWaitObject(std::move(object)) {}
 
 std::vector<std::unique_ptr<WaitTreeItem>> WaitTreeConditionVariable::GetChildren() const {
     std::vector<std::unique_ptr<WaitTreeItem>> list(WaitTreeWaitObject::GetChildren());
 
-    const auto& condition_variable = static_cast<const Kernel::ConditionVariable&>(object);
+    const auto& condition_variable = static_cast<const Kernel::ConditionVariable&>(*object);
     list.push_back(std::make_unique<WaitTreeText>(
         tr("available count = %1").arg(condition_variable.GetAvailableCount())));
     return list;
 }
 
-WaitTreeTimer::WaitTreeTimer(const Kernel::Timer& object) : WaitTreeWaitObject(object) {}
+WaitTreeTimer::WaitTreeTimer(Kernel::SharedPtr<Kernel::Timer> object)
+    : WaitTreeWaitObject(std::move(object)) {}
 
 std::vector<std::unique_ptr<WaitTreeItem>> WaitTreeTimer::GetChildren() const {
     std::vector<std::unique_ptr<WaitTreeItem>> list(WaitTreeWaitObject::GetChildren());
 
-    const auto& timer = static_cast<const Kernel::Timer&>(object);
+    const auto& timer = static_cast<const Kernel::Timer&>(*object);
 
     list.push_back(std::make_unique<WaitTreeText>(
         tr("reset type = %1").arg(GetResetTypeQString(timer.reset_type))));
@@ -303,12 +346,12 @@ QString WaitTreeMutexList::GetText() const {
 std::vector<std::unique_ptr<WaitTreeItem>> WaitTreeMutexList::GetChildren() const {
     std::vector<std::unique_ptr<WaitTreeItem>> list(mutex_list.size());
     std::transform(mutex_list.begin(), mutex_list.end(), list.begin(),
-                   [](const auto& t) { return std::make_unique<WaitTreeMutex>(*t); });
+                   [](const auto& t) { return std::make_unique<WaitTreeMutex>(t); });
     return list;
 }
 
-WaitTreeThreadList::WaitTreeThreadList(const std::vector<Kernel::SharedPtr<Kernel::Thread>>& list)
-    : thread_list(list) {}
+WaitTreeThreadList::WaitTreeThreadList(std::vector<Kernel::SharedPtr<Kernel::Thread>> list)
+    : thread_list(std::move(list)) {}
 
 QString WaitTreeThreadList::GetText() const {
     return tr("waited by thread");
@@ -317,7 +360,7 @@ QString WaitTreeThreadList::GetText() const {
 std::vector<std::unique_ptr<WaitTreeItem>> WaitTreeThreadList::GetChildren() const {
     std::vector<std::unique_ptr<WaitTreeItem>> list(thread_list.size());
     std::transform(thread_list.begin(), thread_list.end(), list.begin(),
-                   [](const auto& t) { return std::make_unique<WaitTreeThread>(*t); });
+                   [](const auto& t) { return std::make_unique<WaitTreeThread>(t); });
     return list;
 }
 
@@ -329,7 +372,7 @@ QModelIndex WaitTreeModel::index(int row, int column, const QModelIndex& parent)
 
     if (parent.isValid()) {
         WaitTreeItem* parent_item = static_cast<WaitTreeItem*>(parent.internalPointer());
-        parent_item->Expand();
+        ExpandItem(*parent_item);
         return createIndex(row, column, parent_item->Children()[row].get());
     }
 
@@ -352,7 +395,7 @@ int WaitTreeModel::rowCount(const QModelIndex& parent) const {
         return static_cast<int>(thread_items.size());
 
     WaitTreeItem* parent_item = static_cast<WaitTreeItem*>(parent.internalPointer());
-    parent_item->Expand();
+    ExpandItem(*parent_item);
     return static_cast<int>(parent_item->Children().size());
 }
 
@@ -366,20 +409,138 @@ QVariant WaitTreeModel::data(const QModelIndex& index, int role) const {
 
     switch (role) {
     case Qt::DisplayRole:
-        return static_cast<WaitTreeItem*>(index.internalPointer())->GetText();
+        return static_cast<WaitTreeItem*>(index.internalPointer())->GetDisplayText();
     case Qt::ForegroundRole:
-        return static_cast<WaitTreeItem*>(index.internalPointer())->GetColor();
+        return static_cast<WaitTreeItem*>(index.internalPointer())->GetDisplayColor();
     default:
         return {};
     }
 }
 
 void WaitTreeModel::ClearItems() {
-    thread_items.clear();
+    beginResetModel();
+    {
+        // The items release the kernel objects they hold
+        const auto lock = LockKernel();
+        thread_items.clear();
+    }
+    endResetModel();
+}
+
+void WaitTreeModel::Refresh() {
+    std::lock_guard<std::mutex> lock(HLE::g_hle_lock);
+    is_kernel_locked = true;
+    SCOPE_EXIT({ is_kernel_locked = false; });
+
+    const auto& threads = Kernel::GetThreadList();
+    std::unordered_set<const Kernel::WaitObject*> remaining_threads;
+    for (const auto& thread : threads) {
+        remaining_threads.insert(thread.get());
+    }
+
+    // Drop the items of the threads that exited, in runs of rows
+    for (std::size_t end = thread_items.size(); end != 0;) {
+        if (remaining_threads.count(&thread_items[end - 1]->GetObject()) != 0) {
+            --end;
+            continue;
+        }
+        std::size_t begin = end - 1;
+        while (begin != 0 && remaining_threads.count(&thread_items[begin - 1]->GetObject()) == 0) {
+            --begin;
+        }
+        beginRemoveRows({}, static_cast<int>(begin), static_cast<int>(end - 1));
+        thread_items.erase(thread_items.begin() + begin, thread_items.begin() + end);
+        for (std::size_t row = begin; row < thread_items.size(); ++row) {
+            thread_items[row]->row = row;
+        }
+        endRemoveRows();
+        end = begin;
+    }
+
+    // Update the items of the other threads
+    std::unordered_set<const Kernel::WaitObject*> shown_threads;
+    for (std::size_t row = 0; row < thread_items.size(); ++row) {
+        WaitTreeItem& item = *thread_items[row];
+        shown_threads.insert(&thread_items[row]->GetObject());
+        const QModelIndex item_index = createIndex(static_cast<int>(row), 0, &item);
+        if (item.SetDisplay(item.GetText(), item.GetColor())) {
+            emit dataChanged(item_index, item_index);
+        }
+        if (item.IsExpanded()) {
+            RefreshChildren(item, item_index);
+        }
+    }
+
+    // Threads are appended to the list as they are created, the new ones go at the end
+    std::vector<std::unique_ptr<WaitTreeThread>> new_items;
+    for (const auto& thread : threads) {
+        if (shown_threads.count(thread.get()) == 0) {
+            new_items.push_back(std::make_unique<WaitTreeThread>(thread));
+        }
+    }
+    if (!new_items.empty()) {
+        const std::size_t begin = thread_items.size();
+        beginInsertRows({}, static_cast<int>(begin),
+                        static_cast<int>(begin + new_items.size() - 1));
+        for (auto& item : new_items) {
+            item->row = thread_items.size();
+            item->SetDisplay(item->GetText(), item->GetColor());
+            thread_items.push_back(std::move(item));
+        }
+        endInsertRows();
+    }
+}
+
+std::unique_lock<std::mutex> WaitTreeModel::LockKernel() const {
+    if (is_kernel_locked) {
+        return {};
+    }
+    return std::unique_lock<std::mutex>(HLE::g_hle_lock);
+}
+
+void WaitTreeModel::ExpandItem(WaitTreeItem& item) const {
+    if (item.IsExpandable() && !item.IsExpanded()) {
+        const auto lock = LockKernel();
+        item.Expand();
+    }
 }
 
-void WaitTreeModel::InitItems() {
-    thread_items = WaitTreeItem::MakeThreadItemList();
+void WaitTreeModel::RefreshChildren(WaitTreeItem& item, const QModelIndex& index) {
+    std::vector<std::unique_ptr<WaitTreeItem>> updated_children = item.GetChildren();
+    std::vector<std::unique_ptr<WaitTreeItem>>& children = item.children;
+
+    // The children showing the same things as before keep their own expanded children, the ones
+    // after the first difference are replaced
+    std::size_t num_same = 0;
+    while (num_same < children.size() && num_same < updated_children.size() &&
+           children[num_same]->IsSameAs(*updated_children[num_same])) {
+        WaitTreeItem& child = *children[num_same];
+        const WaitTreeItem& updated_child = *updated_children[num_same];
+        const QModelIndex child_index = createIndex(static_cast<int>(num_same), 0, &child);
+        if (child.SetDisplay(updated_child.GetText(), updated_child.GetColor())) {
+            emit dataChanged(child_index, child_index);
+        }
+        if (child.IsExpanded()) {
+            RefreshChildren(child, child_index);
+        }
+        ++num_same;
+    }
+
+    if (num_same < children.size()) {
+        beginRemoveRows(index, static_cast<int>(num_same), static_cast<int>(children.size() - 1));
+        children.erase(children.begin() + num_same, children.end());
+        endRemoveRows();
+    }
+    if (num_same < updated_children.size()) {
+        beginInsertRows(index, static_cast<int>(num_same),
+                        static_cast<int>(updated_children.size() - 1));
+        for (std::size_t row = num_same; row < updated_children.size(); ++row) {
+            auto& child = updated_children[row];
+            child->SetDisplay(child->GetText(), child->GetColor());
+            item.AppendChild(std::move(child));
+        }
+        endInsertRows();
+    }
 }
 
 WaitTreeWidget::WaitTreeWidget(QWidget* parent) : QDockWidget(tr("Wait Tree"), parent) {
@@ -388,30 +549,35 @@ WaitTreeWidget::WaitTreeWidget(QWidget* parent) : QDockWidget(tr("Wait Tree"), p
     view->setHeaderHidden(true);
     setWidget(view);
     setEnabled(false);
-}
 
-void WaitTreeWidget::OnDebugModeEntered() {
-    if (!Core::System::GetInstance().IsPoweredOn())
-        return;
-    model->InitItems();
-    view->setModel(model);
-    setEnabled(true);
+    refresh_timer = new QTimer(this);
+    refresh_timer->setInterval(REFRESH_INTERVAL_MS);
+    connect(refresh_timer, &QTimer::timeout, this, &WaitTreeWidget::Refresh);
 }
 
-void WaitTreeWidget::OnDebugModeLeft() {
-    setEnabled(false);
-    view->setModel(nullptr);
-    model->ClearItems();
+void WaitTreeWidget::OnDebugModeEntered() {
+    // Shows the state the emulation stopped in without waiting for the next refresh
+    Refresh();
 }
 
 void WaitTreeWidget::OnEmulationStarting(EmuThread* emu_thread) {
     model = new WaitTreeModel(this);
     view->setModel(model);
-    setEnabled(false);
+    setEnabled(true);
+    refresh_timer->start();
 }
 
 void WaitTreeWidget::OnEmulationStopping() {
+    refresh_timer->stop();
     view->setModel(nullptr);
+    model->ClearItems();
     delete model;
+    model = nullptr;
     setEnabled(false);
 }
+
+void WaitTreeWidget::Refresh() {
+    if (!isVisible() || !Core::System::GetInstance().IsPoweredOn())
+        return;
+    model->Refresh();
+}
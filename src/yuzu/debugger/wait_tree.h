@@ -4,14 +4,19 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
+#include <vector>
 #include <QAbstractItemModel>
 #include <QDockWidget>
 #include <QTreeView>
 #include <boost/container/flat_set.hpp>
 #include "core/core.h"
 #include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/thread.h"
 
 class EmuThread;
+class QTimer;
 
 namespace Kernel {
 class WaitObject;
@@ -24,6 +29,11 @@ class Timer;
 
 class WaitTreeThread;
 
+/**
+ * Item of the wait tree. Items keep the kernel objects they show alive, and are only created,
+ * expanded and destroyed with the kernel locked. Their text and color are read along, so that
+ * drawing them doesn't need the kernel.
+ */
 class WaitTreeItem : public QObject {
     Q_OBJECT
 public:
@@ -31,18 +41,31 @@ public:
     virtual std::vector<std::unique_ptr<WaitTreeItem>> GetChildren() const;
     virtual QString GetText() const = 0;
     virtual QColor GetColor() const;
+    /// Whether the item shows the same thing as another one, possibly in another state
+    virtual bool IsSameAs(const WaitTreeItem& other) const;
     virtual ~WaitTreeItem();
     void Expand();
+    bool IsExpanded() const;
+    /// Sets the text and color shown for the item, returns whether they changed
+    bool SetDisplay(const QString& text, const QColor& color);
+    const QString& GetDisplayText() const;
+    const QColor& GetDisplayColor() const;
     WaitTreeItem* Parent() const;
     const std::vector<std::unique_ptr<WaitTreeItem>>& Children() const;
     std::size_t Row() const;
-    static std::vector<std::unique_ptr<WaitTreeThread>> MakeThreadItemList();
 
 private:
+    friend class WaitTreeModel;
+
+    /// Takes a child at the end of the children
+    void AppendChild(std::unique_ptr<WaitTreeItem> child);
+
     std::size_t row;
     bool expanded = false;
     WaitTreeItem* parent = nullptr;
     std::vector<std::unique_ptr<WaitTreeItem>> children;
+    QString display_text;
+    QColor display_color;
 };
 
 class WaitTreeText : public WaitTreeItem {
@@ -64,13 +87,15 @@ public:
 class WaitTreeWaitObject : public WaitTreeExpandableItem {
     Q_OBJECT
 public:
-    explicit WaitTreeWaitObject(const Kernel::WaitObject& object);
-    static std::unique_ptr<WaitTreeWaitObject> make(const Kernel::WaitObject& object);
+    explicit WaitTreeWaitObject(Kernel::SharedPtr<Kernel::WaitObject> object);
+    static std::unique_ptr<WaitTreeWaitObject> make(Kernel::SharedPtr<Kernel::WaitObject> object);
     QString GetText() const override;
     std::vector<std::unique_ptr<WaitTreeItem>> GetChildren() const override;
+    bool IsSameAs(const WaitTreeItem& other) const override;
+    const Kernel::WaitObject& GetObject() const;
 
 protected:
-    const Kernel::WaitObject& object;
+    Kernel::SharedPtr<Kernel::WaitObject> object;
 
     static QString GetResetTypeQString(Kernel::ResetType reset_type);
 };
@@ -78,20 +103,19 @@ protected:
 class WaitTreeObjectList : public WaitTreeExpandableItem {
     Q_OBJECT
 public:
-    WaitTreeObjectList(const std::vector<Kernel::SharedPtr<Kernel::WaitObject>>& list,
-                       bool wait_all);
+    WaitTreeObjectList(const Kernel::WaitObjectList& list, bool wait_all);
     QString GetText() const override;
     std::vector<std::unique_ptr<WaitTreeItem>> GetChildren() const override;
 
 private:
-    const std::vector<Kernel::SharedPtr<Kernel::WaitObject>>& object_list;
+    const Kernel::WaitObjectList& object_list;
     bool wait_all;
 };
 
 class WaitTreeThread : public WaitTreeWaitObject {
     Q_OBJECT
 public:
-    explicit WaitTreeThread(const Kernel::Thread& thread);
+    explicit WaitTreeThread(Kernel::SharedPtr<Kernel::Thread> thread);
     QString GetText() const override;
     QColor GetColor() const override;
     std::vector<std::unique_ptr<WaitTreeItem>> GetChildren() const override;
@@ -100,28 +124,28 @@ public:
 class WaitTreeEvent : public WaitTreeWaitObject {
     Q_OBJECT
 public:
-    explicit WaitTreeEvent(const Kernel::Event& object);
+    explicit WaitTreeEvent(Kernel::SharedPtr<Kernel::Event> object);
     std::vector<std::unique_ptr<WaitTreeItem>> GetChildren() const override;
 };
 
 class WaitTreeMutex : public WaitTreeWaitObject {
     Q_OBJECT
 public:
-    explicit WaitTreeMutex(const Kernel::Mutex& object);
+    explicit WaitTreeMutex(Kernel::SharedPtr<Kernel::Mutex> object);
     std::vector<std::unique_ptr<WaitTreeItem>> GetChildren() const override;
 };
 
 class WaitTreeConditionVariable : public WaitTreeWaitObject {
     Q_OBJECT
 public:
-    explicit WaitTreeConditionVariable(const Kernel::ConditionVariable& object);
+    explicit WaitTreeConditionVariable(Kernel::SharedPtr<Kernel::ConditionVariable> object);
     std::vector<std::unique_ptr<WaitTreeItem>> GetChildren() const override;
 };
 
 class WaitTreeTimer : public WaitTreeWaitObject {
     Q_OBJECT
 public:
-    explicit WaitTreeTimer(const Kernel::Timer& object);
+    explicit WaitTreeTimer(Kernel::SharedPtr<Kernel::Timer> object);
     std::vector<std::unique_ptr<WaitTreeItem>> GetChildren() const override;
 };
 
@@ -141,12 +165,12 @@ private:
 class WaitTreeThreadList : public WaitTreeExpandableItem {
     Q_OBJECT
 public:
-    explicit WaitTreeThreadList(const std::vector<Kernel::SharedPtr<Kernel::Thread>>& list);
+    explicit WaitTreeThreadList(std::vector<Kernel::SharedPtr<Kernel::Thread>> list);
     QString GetText() const override;
     std::vector<std::unique_ptr<WaitTreeItem>> GetChildren() const override;
 
 private:
-    const std::vector<Kernel::SharedPtr<Kernel::Thread>>& thread_list;
+    std::vector<Kernel::SharedPtr<Kernel::Thread>> thread_list;
 };
 
 class WaitTreeModel : public QAbstractItemModel {
@@ -162,10 +186,26 @@ public:
     int columnCount(const QModelIndex& parent) const override;
 
     void ClearItems();
-    void InitItems();
+
+    /**
+     * Updates the items to the current state of the kernel, telling the view only about the
+     * items that changed. Items of the same objects are kept, along with their expanded children.
+     */
+    void Refresh();
 
 private:
+    /// Locks the kernel, unless the model already holds the lock for a refresh
+    std::unique_lock<std::mutex> LockKernel() const;
+
+    /// Resolves the children of an item the first time they are asked for
+    void ExpandItem(WaitTreeItem& item) const;
+
+    /// Updates the resolved children of an item. Needs the kernel lock.
+    void RefreshChildren(WaitTreeItem& item, const QModelIndex& index);
+
     std::vector<std::unique_ptr<WaitTreeThread>> thread_items;
+    /// Set while a refresh holds the kernel lock, the view may ask for items in the meantime
+    mutable bool is_kernel_locked = false;
 };
 
 class WaitTreeWidget : public QDockWidget {
@@ -176,12 +216,19 @@ public:
 
 public slots:
     void OnDebugModeEntered();
-    void OnDebugModeLeft();
 
     void OnEmulationStarting(EmuThread* emu_thread);
     void OnEmulationStopping();
 
+private slots:
+    /// Updates the tree while it is visible, the emulation may be running
+    void Refresh();
+
 private:
+    /// Interval between the refreshes of the tree, each locks the kernel for a moment
+    static constexpr int REFRESH_INTERVAL_MS = 500;
+
     QTreeView* view;
-    WaitTreeModel* model;
+    WaitTreeModel* model = nullptr;
+    QTimer* refresh_timer;
 };
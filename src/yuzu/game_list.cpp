@@ -2,20 +2,275 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <optional>
 #include <QApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
 #include <QFileInfo>
 #include <QHeaderView>
+#include <QImage>
 #include <QKeyEvent>
 #include <QMenu>
+#include <QSaveFile>
 #include <QThreadPool>
+#include <QTimer>
 #include "common/common_paths.h"
+#include "common/file_util.h"
 #include "common/logging/log.h"
 #include "common/string_util.h"
+#include "common/thread_pool.h"
 #include "core/loader/loader.h"
 #include "game_list.h"
 #include "game_list_p.h"
 #include "ui_settings.h"
 
+// Outside of the anonymous namespace, to be found from the QHash stream operators
+static QDataStream& operator<<(QDataStream& stream, const GameListCacheEntry& entry) {
+    return stream << entry.size << entry.modified_msecs << entry.program_id << entry.file_type
+                  << entry.smdh;
+}
+
+static QDataStream& operator>>(QDataStream& stream, GameListCacheEntry& entry) {
+    return stream >> entry.size >> entry.modified_msecs >> entry.program_id >> entry.file_type >>
+           entry.smdh;
+}
+
+namespace {
+
+constexpr quint32 CACHE_MAGIC = 0x4C47594E; // "NYGL"
+/// Bump whenever the format of the cache or what the loaders report changes
+constexpr quint32 CACHE_VERSION = 1;
+
+/// Artificial cap on the number of directories watched for changes
+constexpr int LIMIT_WATCH_DIRECTORIES = 5000;
+/// Time without any change in the watched directories before the changed ones are rescanned
+constexpr int REFRESH_DELAY_MS = 500;
+
+QString GetCacheFilePath() {
+    return QString::fromStdString(FileUtil::GetUserPath(D_CACHE_IDX)) + "game_list.bin";
+}
+
+/// Reads the cache written by the previous session, empty if it is missing or outdated
+GameListCache LoadCache() {
+    QFile file(GetCacheFilePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION) {
+        return {};
+    }
+
+    GameListCache cache;
+    stream >> cache;
+    if (stream.status() != QDataStream::Ok) {
+        LOG_WARNING(Frontend, "Ignoring the corrupted game list cache");
+        return {};
+    }
+    return cache;
+}
+
+void SaveCache(const GameListCache& cache) {
+    const std::string cache_dir = FileUtil::GetUserPath(D_CACHE_IDX);
+    if (!FileUtil::CreateFullPath(cache_dir)) {
+        return;
+    }
+
+    // Written aside and renamed, so that an interrupted write doesn't lose the previous cache
+    QSaveFile file(GetCacheFilePath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        LOG_WARNING(Frontend, "Could not write the game list cache");
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream << CACHE_MAGIC << CACHE_VERSION << cache;
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        LOG_WARNING(Frontend, "Could not write the game list cache");
+    }
+}
+
+} // Anonymous namespace
+
+GameListModel::GameListModel(QObject* parent) : QAbstractTableModel(parent) {}
+
+int GameListModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(rows.size());
+}
+
+int GameListModel::columnCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : GameList::COLUMN_COUNT;
+}
+
+QVariant GameListModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= rowCount()) {
+        return {};
+    }
+
+    const Row& row = rows[index.row()];
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case GameList::COLUMN_NAME:
+            return row.name;
+        case GameList::COLUMN_FILE_TYPE:
+            return row.entry.file_type;
+        case GameList::COLUMN_SIZE:
+            return ReadableByteSize(row.entry.size);
+        }
+        break;
+    case Qt::DecorationRole:
+        if (index.column() == GameList::COLUMN_NAME && !row.entry.smdh.isEmpty()) {
+            return GetIcon(row);
+        }
+        break;
+    case FullPathRole:
+        return row.path;
+    case ProgramIdRole:
+        return qulonglong(row.entry.program_id);
+    }
+    return {};
+}
+
+QVariant GameListModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return {};
+    }
+
+    switch (section) {
+    case GameList::COLUMN_NAME:
+        return tr("Name");
+    case GameList::COLUMN_FILE_TYPE:
+        return tr("File type");
+    case GameList::COLUMN_SIZE:
+        return tr("Size");
+    }
+    return {};
+}
+
+void GameListModel::sort(int column, Qt::SortOrder order) {
+    const auto less = [column](const Row& a, const Row& b) {
+        switch (column) {
+        case GameList::COLUMN_FILE_TYPE:
+            return a.entry.file_type < b.entry.file_type;
+        case GameList::COLUMN_SIZE:
+            return a.entry.size < b.entry.size;
+        default:
+            return a.name.compare(b.name, Qt::CaseInsensitive) < 0;
+        }
+    };
+
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+    // The selection and the current item of the view follow their game
+    const QModelIndexList old_indices = persistentIndexList();
+    QStringList paths;
+    for (const QModelIndex& index : old_indices) {
+        paths.append(rows[index.row()].path);
+    }
+
+    if (order == Qt::AscendingOrder) {
+        std::stable_sort(rows.begin(), rows.end(), less);
+    } else {
+        std::stable_sort(rows.begin(), rows.end(),
+                         [&less](const Row& a, const Row& b) { return less(b, a); });
+    }
+    UpdateRowIndices();
+
+    QModelIndexList new_indices;
+    for (int i = 0; i < old_indices.size(); ++i) {
+        new_indices.append(index(row_of_path.value(paths[i]), old_indices[i].column()));
+    }
+    changePersistentIndexList(old_indices, new_indices);
+
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+void GameListModel::AddEntries(const GameListCache& entries) {
+    std::vector<Row> new_rows;
+    for (auto entry = entries.cbegin(); entry != entries.cend(); ++entry) {
+        const auto existing = row_of_path.constFind(entry.key());
+        if (existing == row_of_path.cend()) {
+            std::string name;
+            Common::SplitPath(entry.key().toStdString(), nullptr, &name, nullptr);
+            new_rows.push_back({entry.key(), QString::fromStdString(name), entry.value()});
+            continue;
+        }
+
+        const int row = existing.value();
+        rows[row].entry = entry.value();
+        icon_cache.remove(entry.key());
+        emit dataChanged(index(row, 0), index(row, GameList::COLUMN_COUNT - 1));
+    }
+    if (new_rows.empty()) {
+        return;
+    }
+
+    const int first = rowCount();
+    beginInsertRows({}, first, first + static_cast<int>(new_rows.size()) - 1);
+    for (Row& row : new_rows) {
+        row_of_path.insert(row.path, static_cast<int>(rows.size()));
+        rows.push_back(std::move(row));
+    }
+    endInsertRows();
+}
+
+void GameListModel::RemoveMissingEntries(const GameListCache& entries) {
+    bool removed = false;
+    for (int row = rowCount() - 1; row >= 0; --row) {
+        if (entries.contains(rows[row].path)) {
+            continue;
+        }
+        beginRemoveRows({}, row, row);
+        icon_cache.remove(rows[row].path);
+        rows.erase(rows.begin() + row);
+        endRemoveRows();
+        removed = true;
+    }
+    if (removed) {
+        UpdateRowIndices();
+    }
+}
+
+void GameListModel::Clear() {
+    beginResetModel();
+    rows.clear();
+    row_of_path.clear();
+    icon_cache.clear();
+    endResetModel();
+}
+
+QPixmap GameListModel::GetIcon(const Row& row) const {
+    if (const QPixmap* icon = icon_cache.object(row.path)) {
+        return *icon;
+    }
+
+    QImage image;
+    image.loadFromData(reinterpret_cast<const uchar*>(row.entry.smdh.constData()),
+                       row.entry.smdh.size());
+    QPixmap icon = image.isNull() ? GetDefaultIcon(true)
+                                  : QPixmap::fromImage(image.scaled(
+                                        ICON_SIZE, ICON_SIZE, Qt::IgnoreAspectRatio,
+                                        Qt::SmoothTransformation));
+    icon_cache.insert(row.path, new QPixmap(icon));
+    return icon;
+}
+
+void GameListModel::UpdateRowIndices() {
+    row_of_path.clear();
+    for (size_t row = 0; row < rows.size(); ++row) {
+        row_of_path.insert(rows[row].path, static_cast<int>(row));
+    }
+}
+
 GameList::SearchField::KeyReleaseEater::KeyReleaseEater(GameList* gamelist) {
     this->gamelist = gamelist;
     edit_filter_text_old = "";
@@ -50,16 +305,14 @@ bool GameList::SearchField::KeyReleaseEater::eventFilter(QObject* obj, QEvent* e
         // If there is only one result launch this game
         case Qt::Key_Return:
         case Qt::Key_Enter: {
-            QStandardItemModel* item_model = new QStandardItemModel(gamelist->tree_view);
-            QModelIndex root_index = item_model->invisibleRootItem()->index();
-            QStandardItem* child_file;
             QString file_path;
             int resultCount = 0;
             for (int i = 0; i < rowCount; ++i) {
-                if (!gamelist->tree_view->isRowHidden(i, root_index)) {
+                if (!gamelist->tree_view->isRowHidden(i, QModelIndex())) {
                     ++resultCount;
-                    child_file = gamelist->item_model->item(i, 0);
-                    file_path = child_file->data(GameListItemPath::FullPathRole).toString();
+                    file_path = gamelist->item_model->index(i, COLUMN_NAME)
+                                    .data(GameListModel::FullPathRole)
+                                    .toString();
                 }
             }
             if (resultCount == 1) {
@@ -152,7 +405,7 @@ void GameList::onTextChanged(const QString& newText) {
     int rowCount = tree_view->model()->rowCount();
     QString edit_filter_text = newText.toLower();
 
-    QModelIndex root_index = item_model->invisibleRootItem()->index();
+    QModelIndex root_index;
 
     // If the searchfield is empty every item is visible
     // Otherwise the filter gets applied
@@ -162,23 +415,20 @@ void GameList::onTextChanged(const QString& newText) {
         }
         search_field->setFilterResult(rowCount, rowCount);
     } else {
-        QStandardItem* child_file;
-        QString file_path, file_name, file_title, file_programmid;
+        QString file_path, file_name, file_programmid;
         int result_count = 0;
         for (int i = 0; i < rowCount; ++i) {
-            child_file = item_model->item(i, 0);
-            file_path = child_file->data(GameListItemPath::FullPathRole).toString().toLower();
+            const QModelIndex child_file = item_model->index(i, COLUMN_NAME);
+            file_path = child_file.data(GameListModel::FullPathRole).toString().toLower();
             file_name = file_path.mid(file_path.lastIndexOf("/") + 1);
-            file_title = child_file->data(GameListItemPath::TitleRole).toString().toLower();
-            file_programmid =
-                child_file->data(GameListItemPath::ProgramIdRole).toString().toLower();
+            file_programmid = child_file.data(GameListModel::ProgramIdRole).toString().toLower();
 
-            // Only items which filename in combination with its title contains all words
-            // that are in the searchfield will be visible in the gamelist
+            // Only items which filename contains all words that are in the searchfield will be
+            // visible in the gamelist
             // The search is case insensitive because of toLower()
             // I decided not to use Qt::CaseInsensitive in containsAllWords to prevent
             // multiple conversions of edit_filter_text for each game in the gamelist
-            if (containsAllWords(file_name.append(" ").append(file_title), edit_filter_text) ||
+            if (containsAllWords(file_name, edit_filter_text) ||
                 (file_programmid.count() == 16 && edit_filter_text.contains(file_programmid))) {
                 tree_view->setRowHidden(i, root_index, false);
                 ++result_count;
@@ -196,13 +446,19 @@ void GameList::onFilterCloseClicked() {
 
 GameList::GameList(GMainWindow* parent) : QWidget{parent} {
     watcher = new QFileSystemWatcher(this);
-    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &GameList::RefreshGameDirectory);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &GameList::OnDirectoryChanged);
+
+    // Copying a game reports many changes in a row, they are handled together once it settles
+    refresh_timer = new QTimer(this);
+    refresh_timer->setSingleShot(true);
+    refresh_timer->setInterval(REFRESH_DELAY_MS);
+    connect(refresh_timer, &QTimer::timeout, this, &GameList::RefreshGameDirectory);
 
     this->main_window = parent;
     layout = new QVBoxLayout;
     tree_view = new QTreeView;
     search_field = new SearchField(this);
-    item_model = new QStandardItemModel(tree_view);
+    item_model = new GameListModel(tree_view);
     tree_view->setModel(item_model);
 
     tree_view->setAlternatingRowColors(true);
@@ -215,17 +471,14 @@ GameList::GameList(GMainWindow* parent) : QWidget{parent} {
     tree_view->setUniformRowHeights(true);
     tree_view->setContextMenuPolicy(Qt::CustomContextMenu);
 
-    item_model->insertColumns(0, COLUMN_COUNT);
-    item_model->setHeaderData(COLUMN_NAME, Qt::Horizontal, "Name");
-    item_model->setHeaderData(COLUMN_FILE_TYPE, Qt::Horizontal, "File type");
-    item_model->setHeaderData(COLUMN_SIZE, Qt::Horizontal, "Size");
-
     connect(tree_view, &QTreeView::activated, this, &GameList::ValidateEntry);
     connect(tree_view, &QTreeView::customContextMenuRequested, this, &GameList::PopupContextMenu);
 
     // We must register all custom types with the Qt Automoc system so that we are able to use it
-    // with signals/slots. In this case, QList falls under the umbrells of custom types.
-    qRegisterMetaType<QList<QStandardItem*>>("QList<QStandardItem*>");
+    // with signals/slots. In this case, GameListCache falls under the umbrella of custom types.
+    qRegisterMetaType<GameListCache>("GameListCache");
+
+    cache = LoadCache();
 
     layout->setContentsMargins(0, 0, 0, 0);
     layout->setSpacing(0);
@@ -252,15 +505,10 @@ void GameList::clearFilter() {
     search_field->clear();
 }
 
-void GameList::AddEntry(const QList<QStandardItem*>& entry_items) {
-    item_model->invisibleRootItem()->appendRow(entry_items);
-}
-
 void GameList::ValidateEntry(const QModelIndex& item) {
-    // We don't care about the individual QStandardItem that was selected, but its row.
-    int row = item_model->itemFromIndex(item)->row();
-    QStandardItem* child_file = item_model->invisibleRootItem()->child(row, COLUMN_NAME);
-    QString file_path = child_file->data(GameListItemPath::FullPathRole).toString();
+    // We don't care about the individual column that was selected, but its row.
+    const QModelIndex child_file = item_model->index(item.row(), COLUMN_NAME);
+    QString file_path = child_file.data(GameListModel::FullPathRole).toString();
 
     if (file_path.isEmpty())
         return;
@@ -272,7 +520,22 @@ void GameList::ValidateEntry(const QModelIndex& item) {
     emit GameChosen(file_path);
 }
 
-void GameList::DonePopulating(QStringList watch_list) {
+void GameList::DonePopulating(QStringList watch_list, GameListCache scanned_entries) {
+    // Remove the cached games that are gone, and add those the worker found unchanged but that
+    // weren't shown, e.g. because the games directory changed
+    item_model->RemoveMissingEntries(scanned_entries);
+    GameListCache unshown_entries;
+    for (auto entry = scanned_entries.cbegin(); entry != scanned_entries.cend(); ++entry) {
+        if (!item_model->Contains(entry.key())) {
+            unshown_entries.insert(entry.key(), entry.value());
+        }
+    }
+    item_model->AddEntries(unshown_entries);
+    if (scanned_entries != cache) {
+        cache = std::move(scanned_entries);
+        SaveCache(cache);
+    }
+
     // Clear out the old directories to watch for changes and add the new ones
     auto watch_dirs = watcher->directories();
     if (!watch_dirs.isEmpty()) {
@@ -281,7 +544,6 @@ void GameList::DonePopulating(QStringList watch_list) {
     // Workaround: Add the watch paths in chunks to allow the gui to refresh
     // This prevents the UI from stalling when a large number of watch paths are added
     // Also artificially caps the watcher to a certain number of directories
-    constexpr int LIMIT_WATCH_DIRECTORIES = 5000;
     constexpr int SLICE_SIZE = 25;
     int len = std::min(watch_list.length(), LIMIT_WATCH_DIRECTORIES);
     for (int i = 0; i < len; i += SLICE_SIZE) {
@@ -294,6 +556,68 @@ void GameList::DonePopulating(QStringList watch_list) {
     if (rowCount > 0) {
         search_field->setFocus();
     }
+
+    is_scanning = false;
+    if (!changed_directories.isEmpty()) {
+        refresh_timer->start();
+    }
+}
+
+void GameList::DoneRefreshing(QStringList listed_directories, GameListCache scanned_entries) {
+    // The games of the listed directories were all scanned, those of the directories that
+    // couldn't be listed are gone with them
+    const QSet<QString> listed = QSet<QString>::fromList(listed_directories);
+    QStringList removed_directories;
+    for (const QString& directory : refreshed_directories) {
+        if (!listed.contains(directory)) {
+            removed_directories.append(directory + DIR_SEP);
+        }
+    }
+
+    GameListCache new_cache = cache;
+    for (auto entry = cache.cbegin(); entry != cache.cend(); ++entry) {
+        const QString& path = entry.key();
+        const bool scanned =
+            listed.contains(path.left(path.lastIndexOf(DIR_SEP))) ||
+            std::any_of(removed_directories.begin(), removed_directories.end(),
+                        [&path](const QString& directory) { return path.startsWith(directory); });
+        if (scanned && !scanned_entries.contains(path)) {
+            new_cache.remove(path);
+        }
+    }
+    for (auto entry = scanned_entries.cbegin(); entry != scanned_entries.cend(); ++entry) {
+        new_cache.insert(entry.key(), entry.value());
+    }
+
+    // The changed games were already sent by the worker
+    item_model->RemoveMissingEntries(new_cache);
+    if (new_cache != cache) {
+        cache = std::move(new_cache);
+        SaveCache(cache);
+    }
+
+    // Watch the new subdirectories, the watcher forgets the deleted ones by itself
+    const QStringList watch_dirs = watcher->directories();
+    QStringList new_watch_dirs;
+    for (const QString& directory : listed_directories) {
+        if (!watch_dirs.contains(directory)) {
+            new_watch_dirs.append(directory);
+        }
+    }
+    const int free_watches = std::max(LIMIT_WATCH_DIRECTORIES - watch_dirs.size(), 0);
+    new_watch_dirs = new_watch_dirs.mid(0, free_watches);
+    if (!new_watch_dirs.isEmpty()) {
+        watcher->addPaths(new_watch_dirs);
+    }
+
+    int rowCount = tree_view->model()->rowCount();
+    search_field->setFilterResult(rowCount, rowCount);
+
+    refreshed_directories.clear();
+    is_scanning = false;
+    if (!changed_directories.isEmpty()) {
+        refresh_timer->start();
+    }
 }
 
 void GameList::PopupContextMenu(const QPoint& menu_location) {
@@ -301,9 +625,8 @@ void GameList::PopupContextMenu(const QPoint& menu_location) {
     if (!item.isValid())
         return;
 
-    int row = item_model->itemFromIndex(item)->row();
-    QStandardItem* child_file = item_model->invisibleRootItem()->child(row, COLUMN_NAME);
-    u64 program_id = child_file->data(GameListItemPath::ProgramIdRole).toULongLong();
+    const QModelIndex child_file = item_model->index(item.row(), COLUMN_NAME);
+    u64 program_id = child_file.data(GameListModel::ProgramIdRole).toULongLong();
 
     QMenu context_menu;
     QAction* open_save_location = context_menu.addAction(tr("Open Save Data Location"));
@@ -321,17 +644,36 @@ void GameList::PopulateAsync(const QString& dir_path, bool deep_scan) {
         return;
     }
 
-    tree_view->setEnabled(false);
     // Delete any rows that might already exist if we're repopulating
-    item_model->removeRows(0, item_model->rowCount());
+    item_model->Clear();
+
+    // Show the games found by the previous scan right away, the worker only opens the files
+    // that changed since and the list is reconciled when it finishes
+    GameListCache cached_entries;
+    for (auto entry = cache.cbegin(); entry != cache.cend(); ++entry) {
+        if (entry.key().startsWith(dir_path)) {
+            cached_entries.insert(entry.key(), entry.value());
+        }
+    }
+    item_model->AddEntries(cached_entries);
+    tree_view->setEnabled(item_model->rowCount() > 0);
 
-    emit ShouldCancelWorker();
+    // The whole directory is scanned anyway
+    refresh_timer->stop();
+    changed_directories.clear();
+    refreshed_directories.clear();
 
-    GameListWorker* worker = new GameListWorker(dir_path, deep_scan);
+    StartWorker(new GameListWorker({dir_path}, deep_scan, cache), &GameList::DonePopulating);
+}
 
-    connect(worker, &GameListWorker::EntryReady, this, &GameList::AddEntry, Qt::QueuedConnection);
-    connect(worker, &GameListWorker::Finished, this, &GameList::DonePopulating,
+void GameList::StartWorker(GameListWorker* worker,
+                           void (GameList::*on_finished)(QStringList, GameListCache)) {
+    emit ShouldCancelWorker();
+    is_scanning = true;
+
+    connect(worker, &GameListWorker::EntriesReady, item_model, &GameListModel::AddEntries,
             Qt::QueuedConnection);
+    connect(worker, &GameListWorker::Finished, this, on_finished, Qt::QueuedConnection);
     // Use DirectConnection here because worker->Cancel() is thread-safe and we want it to cancel
     // without delay.
     connect(this, &GameList::ShouldCancelWorker, worker, &GameListWorker::Cancel,
@@ -363,56 +705,209 @@ static bool HasSupportedFileExtension(const std::string& file_name) {
     return GameList::supported_file_extensions.contains(file.suffix(), Qt::CaseInsensitive);
 }
 
+void GameList::OnDirectoryChanged(const QString& path) {
+    changed_directories.insert(path);
+    refresh_timer->start();
+}
+
 void GameList::RefreshGameDirectory() {
-    if (!UISettings::values.gamedir.isEmpty() && current_worker != nullptr) {
-        LOG_INFO(Frontend, "Change detected in the games directory. Reloading game list.");
-        search_field->clear();
-        PopulateAsync(UISettings::values.gamedir, UISettings::values.gamedir_deepscan);
+    if (UISettings::values.gamedir.isEmpty() || current_worker == nullptr) {
+        changed_directories.clear();
+        return;
+    }
+    // The changes are kept for when the current scan finishes
+    if (is_scanning) {
+        return;
+    }
+
+    LOG_INFO(Frontend, "Change detected in %d game directories. Refreshing them.",
+             changed_directories.size());
+    search_field->clear();
+
+    // Only the changed directories are listed again, along with the new subdirectories the
+    // watcher doesn't know about
+    refreshed_directories = changed_directories.toList();
+    changed_directories.clear();
+    QSet<QString> known_directories = QSet<QString>::fromList(watcher->directories());
+    for (const QString& directory : refreshed_directories) {
+        known_directories.remove(directory);
     }
+
+    StartWorker(new GameListWorker(refreshed_directories, UISettings::values.gamedir_deepscan,
+                                   cache, known_directories),
+                &GameList::DoneRefreshing);
 }
 
-void GameListWorker::AddFstEntriesToGameList(const std::string& dir_path, unsigned int recursion) {
-    const auto callback = [this, recursion](unsigned* num_entries_out, const std::string& directory,
-                                            const std::string& virtual_name) -> bool {
-        std::string physical_name = directory + DIR_SEP + virtual_name;
+namespace {
+
+/// Maximum number of entries sent to the game list by a single signal
+constexpr int ENTRY_BATCH_SIZE = 64;
 
-        if (stop_processing)
+/// Game file that isn't in the cache or changed since, and has to be opened
+struct PendingFile {
+    std::string path;
+    qint64 size;
+    qint64 modified_msecs;
+};
+
+/// What the scan of a single directory found
+struct DirectoryContents {
+    /// False if the directory couldn't be opened, e.g. because it was deleted
+    bool listed = false;
+    std::vector<std::string> subdirectories;
+    std::vector<PendingFile> pending_files;
+    std::vector<std::pair<QString, GameListCacheEntry>> cached_entries;
+};
+
+/**
+ * Lists the games of a directory, looking them up in the cache. Run on the thread pool, many
+ * directories at once.
+ */
+DirectoryContents ScanDirectory(const std::string& dir_path, bool list_subdirectories,
+                                const GameListCache& cache, const std::atomic_bool& stop) {
+    DirectoryContents contents;
+    const auto callback = [&](unsigned* num_entries_out, const std::string& directory,
+                              const std::string& virtual_name) -> bool {
+        if (stop)
             return false; // Breaks the callback loop.
 
-        bool is_dir = FileUtil::IsDirectory(physical_name);
+        std::string physical_name = directory + DIR_SEP + virtual_name;
+
+        // A single stat for the type, the size and the modification time
+        const QString path = QString::fromStdString(physical_name);
+        const QFileInfo file_info(path);
+        const bool is_dir = file_info.isDir();
         if (!is_dir && HasSupportedFileExtension(physical_name)) {
-            std::unique_ptr<Loader::AppLoader> loader = Loader::GetLoader(physical_name);
-            if (!loader)
-                return true;
-
-            std::vector<u8> smdh;
-            loader->ReadIcon(smdh);
-
-            u64 program_id = 0;
-            loader->ReadProgramId(program_id);
-
-            emit EntryReady({
-                new GameListItemPath(QString::fromStdString(physical_name), smdh, program_id),
-                new GameListItem(
-                    QString::fromStdString(Loader::GetFileTypeString(loader->GetFileType()))),
-                new GameListItemSize(FileUtil::GetSize(physical_name)),
-            });
-        } else if (is_dir && recursion > 0) {
-            watch_list.append(QString::fromStdString(physical_name));
-            AddFstEntriesToGameList(physical_name, recursion - 1);
+            const qint64 size = file_info.size();
+            const qint64 modified_msecs = file_info.lastModified().toMSecsSinceEpoch();
+
+            const auto cached = cache.constFind(path);
+            if (cached != cache.cend() && cached->size == size &&
+                cached->modified_msecs == modified_msecs) {
+                contents.cached_entries.emplace_back(path, cached.value());
+            } else {
+                contents.pending_files.push_back({std::move(physical_name), size, modified_msecs});
+            }
+        } else if (is_dir && list_subdirectories) {
+            contents.subdirectories.push_back(std::move(physical_name));
         }
 
         return true;
     };
 
-    FileUtil::ForeachDirectoryEntry(nullptr, dir_path, callback);
+    contents.listed = FileUtil::ForeachDirectoryEntry(nullptr, dir_path, callback);
+    return contents;
+}
+
+/// Opens a game file to read its metadata, run on the thread pool. Empty if it can't be loaded.
+std::optional<GameListCacheEntry> ProbeFile(const PendingFile& file, const std::atomic_bool& stop) {
+    if (stop)
+        return {};
+
+    std::unique_ptr<Loader::AppLoader> loader = Loader::GetLoader(file.path);
+    if (!loader)
+        return {};
+
+    std::vector<u8> smdh;
+    loader->ReadIcon(smdh);
+
+    u64 program_id = 0;
+    loader->ReadProgramId(program_id);
+
+    GameListCacheEntry entry;
+    entry.size = file.size;
+    entry.modified_msecs = file.modified_msecs;
+    entry.program_id = program_id;
+    entry.file_type = Loader::GetFileTypeString(loader->GetFileType());
+    entry.smdh = QByteArray(reinterpret_cast<const char*>(smdh.data()), int(smdh.size()));
+    return entry;
+}
+
+} // Anonymous namespace
+
+void GameListWorker::ScanDirectories() {
+    Common::ThreadPool& pool = Common::ThreadPool::GetInstance();
+
+    // Breadth first, the directories of a level are listed in parallel and the files that changed
+    // are opened in parallel as soon as their directory was listed
+    std::vector<std::string> directories;
+    for (const QString& dir_path : dir_paths) {
+        directories.push_back(dir_path.toStdString());
+    }
+    for (unsigned int recursion = deep_scan ? 256 : 0; !directories.empty(); --recursion) {
+        std::vector<std::future<DirectoryContents>> listings;
+        std::vector<std::string> next_directories;
+        listings.reserve(directories.size());
+        for (const std::string& directory : directories) {
+            listings.push_back(pool.Submit(
+                [this, directory, recursion] {
+                    return ScanDirectory(directory, recursion > 0, cache, stop_processing);
+                },
+                Common::TaskPriority::Low));
+        }
+
+        for (size_t i = 0; i < listings.size(); ++i) {
+            DirectoryContents contents = listings[i].get();
+            if (contents.listed) {
+                watch_list.append(QString::fromStdString(directories[i]));
+            }
+            for (std::string& subdirectory : contents.subdirectories) {
+                // Already in the list and watched on their own
+                if (!known_directories.contains(QString::fromStdString(subdirectory))) {
+                    next_directories.push_back(std::move(subdirectory));
+                }
+            }
+            for (auto& [path, entry] : contents.cached_entries) {
+                scanned_entries.insert(path, entry);
+            }
+            for (PendingFile& file : contents.pending_files) {
+                QString path = QString::fromStdString(file.path);
+                auto probe = pool.Submit(
+                    [this, file = std::move(file)] { return ProbeFile(file, stop_processing); },
+                    Common::TaskPriority::Low);
+                probes.emplace_back(std::move(path), std::move(probe));
+            }
+        }
+        directories = std::move(next_directories);
+    }
+}
+
+void GameListWorker::CollectProbes() {
+    // The entries are sent in batches rather than one queued signal per game, a batch is also
+    // sent early whenever the next game isn't ready yet so that the list fills up progressively
+    GameListCache batch;
+    for (auto& [path, probe] : probes) {
+        if (!batch.isEmpty() &&
+            probe.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            emit EntriesReady(batch);
+            batch.clear();
+        }
+
+        const std::optional<GameListCacheEntry> entry = probe.get();
+        if (!entry || stop_processing)
+            continue;
+
+        scanned_entries.insert(path, *entry);
+        batch.insert(path, *entry);
+        if (batch.size() == ENTRY_BATCH_SIZE) {
+            emit EntriesReady(batch);
+            batch.clear();
+        }
+    }
+    if (!batch.isEmpty()) {
+        emit EntriesReady(batch);
+    }
+    probes.clear();
 }
 
 void GameListWorker::run() {
     stop_processing = false;
-    watch_list.append(dir_path);
-    AddFstEntriesToGameList(dir_path.toStdString(), deep_scan ? 256 : 0);
-    emit Finished(watch_list);
+    // The tasks refer to the worker, the probes are waited for even if the scan was canceled
+    ScanDirectories();
+    CollectProbes();
+    if (!stop_processing) {
+        emit Finished(watch_list, scanned_entries);
+    }
 }
 
 void GameListWorker::Cancel() {
@@ -4,14 +4,16 @@
 
 #pragma once
 
+#include <QByteArray>
 #include <QFileSystemWatcher>
+#include <QHash>
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QLineEdit>
+#include <QMetaType>
 #include <QModelIndex>
+#include <QSet>
 #include <QSettings>
-#include <QStandardItem>
-#include <QStandardItemModel>
 #include <QString>
 #include <QToolButton>
 #include <QTreeView>
@@ -19,7 +21,32 @@
 #include <QWidget>
 #include "main.h"
 
+class GameListModel;
 class GameListWorker;
+class QTimer;
+
+/**
+ * What the game list knows about a game file without opening it. The entries are kept on disk
+ * between sessions and reused as long as the size and modification time of the file match.
+ */
+struct GameListCacheEntry {
+    qint64 size = 0;
+    qint64 modified_msecs = 0;
+    quint64 program_id = 0;
+    QString file_type;
+    QByteArray smdh;
+
+    bool operator==(const GameListCacheEntry& other) const {
+        return size == other.size && modified_msecs == other.modified_msecs &&
+               program_id == other.program_id && file_type == other.file_type &&
+               smdh == other.smdh;
+    }
+};
+
+/// Game list cache entries, by full path of the game file
+using GameListCache = QHash<QString, GameListCacheEntry>;
+
+Q_DECLARE_METATYPE(GameListCache)
 
 class GameList : public QWidget {
     Q_OBJECT
@@ -83,11 +110,14 @@ private slots:
     void onFilterCloseClicked();
 
 private:
-    void AddEntry(const QList<QStandardItem*>& entry_items);
     void ValidateEntry(const QModelIndex& item);
-    void DonePopulating(QStringList watch_list);
+    void DonePopulating(QStringList watch_list, GameListCache scanned_entries);
+    void DoneRefreshing(QStringList listed_directories, GameListCache scanned_entries);
+    void StartWorker(GameListWorker* worker,
+                     void (GameList::*on_finished)(QStringList, GameListCache));
 
     void PopupContextMenu(const QPoint& menu_location);
+    void OnDirectoryChanged(const QString& path);
     void RefreshGameDirectory();
     bool containsAllWords(QString haystack, QString userinput);
 
@@ -95,7 +125,16 @@ private:
     GMainWindow* main_window = nullptr;
     QVBoxLayout* layout = nullptr;
     QTreeView* tree_view = nullptr;
-    QStandardItemModel* item_model = nullptr;
+    GameListModel* item_model = nullptr;
     GameListWorker* current_worker = nullptr;
     QFileSystemWatcher* watcher = nullptr;
+    /// Entries found by the last complete scan, shown before the next scan completes
+    GameListCache cache;
+    /// Whether a worker is scanning, the changes reported meanwhile are handled once it is done
+    bool is_scanning = false;
+    /// Watched directories that changed since the last refresh, rescanned once they settle
+    QSet<QString> changed_directories;
+    /// Directories the current refresh is scanning
+    QStringList refreshed_directories;
+    QTimer* refresh_timer = nullptr;
 };
@@ -5,11 +5,19 @@
 #pragma once
 
 #include <atomic>
-#include <QImage>
+#include <future>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <QAbstractTableModel>
+#include <QCache>
+#include <QHash>
+#include <QPixmap>
 #include <QRunnable>
-#include <QStandardItem>
+#include <QSet>
 #include <QString>
 #include "common/string_util.h"
+#include "yuzu/game_list.h"
 #include "yuzu/util/util.h"
 
 /**
@@ -24,82 +32,55 @@ static QPixmap GetDefaultIcon(bool large) {
     return icon;
 }
 
-class GameListItem : public QStandardItem {
-
-public:
-    GameListItem() : QStandardItem() {}
-    GameListItem(const QString& string) : QStandardItem(string) {}
-    virtual ~GameListItem() override {}
-};
-
 /**
- * A specialization of GameListItem for path values.
- * This class ensures that for every full path value it holds, a correct string representation
- * of just the filename (with no extension) will be displayed to the user.
- * If this class receives valid SMDH data, it will also display game icons and titles.
+ * Model of the game list, a row per game with its cache entry. The name column displays the file
+ * name without its extension, and the icons are only decoded for the rows the view paints, with
+ * the most recently painted ones kept decoded.
  */
-class GameListItemPath : public GameListItem {
+class GameListModel : public QAbstractTableModel {
+    Q_OBJECT
 
 public:
     static const int FullPathRole = Qt::UserRole + 1;
-    static const int TitleRole = Qt::UserRole + 2;
-    static const int ProgramIdRole = Qt::UserRole + 3;
-
-    GameListItemPath() : GameListItem() {}
-    GameListItemPath(const QString& game_path, const std::vector<u8>& smdh_data, u64 program_id)
-        : GameListItem() {
-        setData(game_path, FullPathRole);
-        setData(qulonglong(program_id), ProgramIdRole);
-    }
+    static const int ProgramIdRole = Qt::UserRole + 2;
 
-    QVariant data(int role) const override {
-        if (role == Qt::DisplayRole) {
-            std::string filename;
-            Common::SplitPath(data(FullPathRole).toString().toStdString(), nullptr, &filename,
-                              nullptr);
-            QString title = data(TitleRole).toString();
-            return QString::fromStdString(filename) + (title.isEmpty() ? "" : "\n    " + title);
-        } else {
-            return GameListItem::data(role);
-        }
-    }
-};
+    explicit GameListModel(QObject* parent = nullptr);
 
-/**
- * A specialization of GameListItem for size values.
- * This class ensures that for every numerical size value it holds (in bytes), a correct
- * human-readable string representation will be displayed to the user.
- */
-class GameListItemSize : public GameListItem {
+    int rowCount(const QModelIndex& parent = {}) const override;
+    int columnCount(const QModelIndex& parent = {}) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
 
-public:
-    static const int SizeRole = Qt::UserRole + 1;
-
-    GameListItemSize() : GameListItem() {}
-    GameListItemSize(const qulonglong size_bytes) : GameListItem() {
-        setData(size_bytes, SizeRole);
-    }
+    /// Adds rows for the entries, replacing those of the games already in the list
+    void AddEntries(const GameListCache& entries);
+    /// Removes the rows of the games that aren't among the entries
+    void RemoveMissingEntries(const GameListCache& entries);
+    void Clear();
 
-    void setData(const QVariant& value, int role) override {
-        // By specializing setData for SizeRole, we can ensure that the numerical and string
-        // representations of the data are always accurate and in the correct format.
-        if (role == SizeRole) {
-            qulonglong size_bytes = value.toULongLong();
-            GameListItem::setData(ReadableByteSize(size_bytes), Qt::DisplayRole);
-            GameListItem::setData(value, SizeRole);
-        } else {
-            GameListItem::setData(value, role);
-        }
+    bool Contains(const QString& path) const {
+        return row_of_path.contains(path);
     }
 
-    /**
-     * This operator is, in practice, only used by the TreeView sorting systems.
-     * Override it so that it will correctly sort by numerical value instead of by string
-     * representation.
-     */
-    bool operator<(const QStandardItem& other) const override {
-        return data(SizeRole).toULongLong() < other.data(SizeRole).toULongLong();
-    }
+private:
+    struct Row {
+        QString path;
+        QString name;
+        GameListCacheEntry entry;
+    };
+
+    /// Number of decoded icons kept around
+    static constexpr int ICON_CACHE_SIZE = 256;
+    static constexpr int ICON_SIZE = 48;
+
+    QPixmap GetIcon(const Row& row) const;
+    void UpdateRowIndices();
+
+    std::vector<Row> rows;
+    QHash<QString, int> row_of_path;
+    /// Decoded icons by full path, least recently used first out
+    mutable QCache<QString, QPixmap> icon_cache{ICON_CACHE_SIZE};
 };
 
 /**
@@ -110,8 +91,17 @@ class GameListWorker : public QObject, public QRunnable {
     Q_OBJECT
 
 public:
-    GameListWorker(QString dir_path, bool deep_scan)
-        : QObject(), QRunnable(), dir_path(dir_path), deep_scan(deep_scan) {}
+    /**
+     * @param dir_paths Directories to scan.
+     * @param cache Entries of the previous scan, the files whose size and modification time
+     *        didn't change since are not opened again.
+     * @param known_directories Subdirectories that are not scanned even with deep scan, when
+     *        only some directories of the list are refreshed.
+     */
+    GameListWorker(QStringList dir_paths, bool deep_scan, GameListCache cache,
+                   QSet<QString> known_directories = {})
+        : QObject(), QRunnable(), dir_paths(dir_paths), deep_scan(deep_scan), cache(cache),
+          known_directories(known_directories) {}
 
 public slots:
     /// Starts the processing of directory tree information.
@@ -121,23 +111,33 @@ public slots:
 
 signals:
     /**
-     * The `EntryReady` signal is emitted once an entry has been prepared and is ready
-     * to be added to the game list.
-     * @param entry_items a list with `QStandardItem`s that make up the columns of the new entry.
+     * The `EntriesReady` signal is emitted once a batch of entries has been prepared and is ready
+     * to be added to the game list. Only the new and changed entries are emitted, those found
+     * unchanged in the cache are reported by `Finished`.
+     * @param entries the new entries, by full path.
      */
-    void EntryReady(QList<QStandardItem*> entry_items);
+    void EntriesReady(GameListCache entries);
 
     /**
      * After the worker has traversed the game directory looking for entries, this signal is emmited
-     * with a list of folders that should be watched for changes as well.
+     * with a list of folders that should be watched for changes as well, i.e. those it could list,
+     * and with every entry it found.
      */
-    void Finished(QStringList watch_list);
+    void Finished(QStringList watch_list, GameListCache scanned_entries);
 
 private:
     QStringList watch_list;
-    QString dir_path;
+    QStringList dir_paths;
     bool deep_scan;
+    GameListCache cache;
+    QSet<QString> known_directories;
+    GameListCache scanned_entries;
+    /// Thread pool tasks opening the game files that aren't in the cache, by full path
+    std::vector<std::pair<QString, std::future<std::optional<GameListCacheEntry>>>> probes;
     std::atomic_bool stop_processing;
 
-    void AddFstEntriesToGameList(const std::string& dir_path, unsigned int recursion = 0);
+    /// Lists the directories on the thread pool and queues the probes of the changed files
+    void ScanDirectories();
+    /// Waits for the probes and sends their entries to the game list in batches
+    void CollectProbes();
 };
@@ -13,6 +13,8 @@
 #include <QMessageBox>
 #include <QtGui>
 #include <QtWidgets>
+#include "common/common_paths.h"
+#include "common/file_util.h"
 #include "common/logging/backend.h"
 #include "common/logging/filter.h"
 #include "common/logging/log.h"
@@ -26,12 +28,20 @@
 #include "core/gdbstub/gdbstub.h"
 #include "core/loader/loader.h"
 #include "core/settings.h"
+#include "core/tracer/ipc_capture.h"
+#include "core/tracer/guest_profiler.h"
+#include "core/tracer/scheduler_trace.h"
+#include "core/tracer/svc_trace.h"
+#include "core/tracer/workload_trace.h"
 #include "yuzu/about_dialog.h"
 #include "yuzu/bootmanager.h"
 #include "yuzu/configuration/config.h"
 #include "yuzu/configuration/configure_dialog.h"
+#include "yuzu/debugger/jit_stats.h"
+#include "yuzu/debugger/memory_usage.h"
 #include "yuzu/debugger/profiler.h"
 #include "yuzu/debugger/registers.h"
+#include "yuzu/debugger/service_stats.h"
 #include "yuzu/debugger/wait_tree.h"
 #include "yuzu/game_list.h"
 #include "yuzu/hotkeys.h"
@@ -42,6 +52,9 @@
 Q_IMPORT_PLUGIN(QWindowsIntegrationPlugin);
 #endif
 
+/// Number of the last SVC calls the SVC trace keeps with their arguments
+constexpr size_t SVC_TRACE_CAPTURED_CALLS = 1 << 16;
+
 /**
  * "Callouts" are one-time instructional messages shown to the user. In the config settings, there
  * is a bitfield "callout_flags" options, used to track if a message has already been shown to the
@@ -132,8 +145,12 @@ void GMainWindow::InitializeWidgets() {
     emu_frametime_label->setToolTip(
         tr("Time taken to emulate a Switch frame, not counting framelimiting or v-sync. For "
            "full-speed emulation this should be at most 16.67 ms."));
+    frame_low_label = new QLabel();
+    frame_low_label->setToolTip(
+        tr("Frame rate over the slowest 1% of the Switch frames, including waits. A value well "
+           "below the average frame rate means that the emulation stutters."));
 
-    for (auto& label : {emu_speed_label, game_fps_label, emu_frametime_label}) {
+    for (auto& label : {emu_speed_label, game_fps_label, emu_frametime_label, frame_low_label}) {
         label->setVisible(false);
         label->setFrameStyle(QFrame::NoFrame);
         label->setContentsMargins(4, 0, 4, 0);
@@ -169,6 +186,60 @@ void GMainWindow::InitializeDebugWidgets() {
             &WaitTreeWidget::OnEmulationStarting);
     connect(this, &GMainWindow::EmulationStopping, waitTreeWidget,
             &WaitTreeWidget::OnEmulationStopping);
+
+    serviceStatsWidget = new ServiceStatsWidget(this);
+    addDockWidget(Qt::LeftDockWidgetArea, serviceStatsWidget);
+    serviceStatsWidget->hide();
+    debug_menu->addAction(serviceStatsWidget->toggleViewAction());
+    connect(this, &GMainWindow::EmulationStarting, serviceStatsWidget,
+            &ServiceStatsWidget::OnEmulationStarting);
+    connect(this, &GMainWindow::EmulationStopping, serviceStatsWidget,
+            &ServiceStatsWidget::OnEmulationStopping);
+
+    memoryUsageWidget = new MemoryUsageWidget(this);
+    addDockWidget(Qt::LeftDockWidgetArea, memoryUsageWidget);
+    memoryUsageWidget->hide();
+    debug_menu->addAction(memoryUsageWidget->toggleViewAction());
+    connect(this, &GMainWindow::EmulationStarting, memoryUsageWidget,
+            &MemoryUsageWidget::OnEmulationStarting);
+    connect(this, &GMainWindow::EmulationStopping, memoryUsageWidget,
+            &MemoryUsageWidget::OnEmulationStopping);
+
+    jitStatsWidget = new JitStatsWidget(this);
+    addDockWidget(Qt::LeftDockWidgetArea, jitStatsWidget);
+    jitStatsWidget->hide();
+    debug_menu->addAction(jitStatsWidget->toggleViewAction());
+    connect(this, &GMainWindow::EmulationStarting, jitStatsWidget,
+            &JitStatsWidget::OnEmulationStarting);
+    connect(this, &GMainWindow::EmulationStopping, jitStatsWidget,
+            &JitStatsWidget::OnEmulationStopping);
+
+    QAction* scheduler_trace_action = new QAction(tr("Record Scheduler Trace"), this);
+    scheduler_trace_action->setCheckable(true);
+    debug_menu->addAction(scheduler_trace_action);
+    connect(scheduler_trace_action, &QAction::toggled, this,
+            &GMainWindow::OnToggleSchedulerTrace);
+
+    QAction* svc_trace_action = new QAction(tr("Record SVC Trace"), this);
+    svc_trace_action->setCheckable(true);
+    debug_menu->addAction(svc_trace_action);
+    connect(svc_trace_action, &QAction::toggled, this, &GMainWindow::OnToggleSvcTrace);
+
+    QAction* guest_profile_action = new QAction(tr("Record Guest Profile"), this);
+    guest_profile_action->setCheckable(true);
+    debug_menu->addAction(guest_profile_action);
+    connect(guest_profile_action, &QAction::toggled, this, &GMainWindow::OnToggleGuestProfile);
+
+    ipc_capture_action = new QAction(tr("Record IPC Capture"), this);
+    ipc_capture_action->setCheckable(true);
+    debug_menu->addAction(ipc_capture_action);
+    connect(ipc_capture_action, &QAction::toggled, this, &GMainWindow::OnToggleIPCCapture);
+
+    workload_trace_action = new QAction(tr("Record Workload Trace"), this);
+    workload_trace_action->setCheckable(true);
+    debug_menu->addAction(workload_trace_action);
+    connect(workload_trace_action, &QAction::toggled, this,
+            &GMainWindow::OnToggleWorkloadTrace);
 }
 
 void GMainWindow::InitializeRecentFileMenuActions() {
@@ -188,6 +259,8 @@ void GMainWindow::InitializeHotkeys() {
     RegisterHotkey("Main Window", "Start Emulation");
     RegisterHotkey("Main Window", "Fullscreen", QKeySequence::FullScreen);
     RegisterHotkey("Main Window", "Exit Fullscreen", QKeySequence::Cancel, Qt::ApplicationShortcut);
+    RegisterHotkey("Main Window", "Toggle Turbo Mode", QKeySequence(Qt::CTRL + Qt::Key_U),
+                   Qt::ApplicationShortcut);
     LoadHotkeys();
 
     connect(GetHotkey("Main Window", "Load File", this), SIGNAL(activated()), this,
@@ -204,6 +277,8 @@ void GMainWindow::InitializeHotkeys() {
             ToggleFullscreen();
         }
     });
+    connect(GetHotkey("Main Window", "Toggle Turbo Mode", this), &QShortcut::activated, this,
+            [] { Settings::values.use_turbo_mode = !Settings::values.use_turbo_mode; });
 }
 
 void GMainWindow::SetDefaultUIGeometry() {
@@ -395,7 +470,6 @@ void GMainWindow::BootGame(const QString& filename) {
     // Create and start the emulation thread
     emu_thread = std::make_unique<EmuThread>(render_window);
     emit EmulationStarting(emu_thread.get());
-    render_window->moveContext();
     emu_thread->start();
 
     connect(render_window, SIGNAL(Closed()), this, SLOT(OnStopGame()));
@@ -407,8 +481,6 @@ void GMainWindow::BootGame(const QString& filename) {
             SLOT(OnDebugModeEntered()), Qt::BlockingQueuedConnection);
     connect(emu_thread.get(), SIGNAL(DebugModeLeft()), registersWidget, SLOT(OnDebugModeLeft()),
             Qt::BlockingQueuedConnection);
-    connect(emu_thread.get(), SIGNAL(DebugModeLeft()), waitTreeWidget, SLOT(OnDebugModeLeft()),
-            Qt::BlockingQueuedConnection);
 
     // Update the GUI
     registersWidget->OnDebugModeEntered();
@@ -454,6 +526,7 @@ void GMainWindow::ShutdownGame() {
     emu_speed_label->setVisible(false);
     game_fps_label->setVisible(false);
     emu_frametime_label->setVisible(false);
+    frame_low_label->setVisible(false);
 
     emulation_running = false;
 }
@@ -653,6 +726,116 @@ void GMainWindow::OnToggleFilterBar() {
     }
 }
 
+void GMainWindow::OnToggleSchedulerTrace(bool record) {
+    if (record) {
+        SchedulerTrace::Start();
+        return;
+    }
+
+    SchedulerTrace::Stop();
+
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save Scheduler Trace"), QString(),
+                                                    tr("Chrome Trace (*.json)"));
+    if (filename.isEmpty())
+        return;
+
+    if (!SchedulerTrace::ExportChromeTrace(filename.toStdString())) {
+        QMessageBox::critical(this, tr("Save Scheduler Trace"),
+                              tr("Could not write the scheduler trace to %1.").arg(filename));
+    }
+}
+
+void GMainWindow::OnToggleSvcTrace(bool record) {
+    if (record) {
+        SvcTrace::Start(SVC_TRACE_CAPTURED_CALLS);
+        return;
+    }
+
+    SvcTrace::Stop();
+
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save SVC Trace"), QString(),
+                                                    tr("Text files (*.txt)"));
+    if (filename.isEmpty())
+        return;
+
+    if (!SvcTrace::Export(filename.toStdString())) {
+        QMessageBox::critical(this, tr("Save SVC Trace"),
+                              tr("Could not write the SVC trace to %1.").arg(filename));
+    }
+}
+
+void GMainWindow::OnToggleGuestProfile(bool record) {
+    if (record) {
+        GuestProfiler::Start();
+        return;
+    }
+
+    GuestProfiler::Stop();
+
+    const QString flat_filter = tr("Flat Profile (*.txt)");
+    const QString call_tree_filter = tr("Call Tree (*.txt)");
+    const QString folded_filter = tr("Folded Stacks for Flame Graphs (*.folded)");
+    QString selected_filter;
+    QString filename = QFileDialog::getSaveFileName(
+        this, tr("Save Guest Profile"), QString(),
+        flat_filter + ";;" + call_tree_filter + ";;" + folded_filter, &selected_filter);
+    if (filename.isEmpty())
+        return;
+
+    GuestProfiler::ReportFormat format = GuestProfiler::ReportFormat::Flat;
+    if (selected_filter == call_tree_filter) {
+        format = GuestProfiler::ReportFormat::CallTree;
+    } else if (selected_filter == folded_filter) {
+        format = GuestProfiler::ReportFormat::Folded;
+    }
+
+    if (!GuestProfiler::Export(filename.toStdString(), format)) {
+        QMessageBox::critical(this, tr("Save Guest Profile"),
+                              tr("Could not write the guest profile to %1.").arg(filename));
+    }
+}
+
+void GMainWindow::OnToggleIPCCapture(bool record) {
+    if (!record) {
+        IPCCapture::Stop();
+        return;
+    }
+
+    QString filename = QFileDialog::getSaveFileName(this, tr("Record IPC Capture"), QString(),
+                                                    tr("IPC Capture (*.ipc)"));
+    if (filename.isEmpty()) {
+        ipc_capture_action->setChecked(false);
+        return;
+    }
+
+    if (!IPCCapture::Start(filename.toStdString())) {
+        QMessageBox::critical(this, tr("Record IPC Capture"),
+                              tr("Could not open %1 for writing the IPC capture.").arg(filename));
+        ipc_capture_action->setChecked(false);
+    }
+}
+
+void GMainWindow::OnToggleWorkloadTrace(bool record) {
+    if (!record) {
+        WorkloadTrace::Stop();
+        return;
+    }
+
+    QString filename = QFileDialog::getSaveFileName(this, tr("Record Workload Trace"), QString(),
+                                                    tr("Workload Trace (*.ywt)"));
+    if (filename.isEmpty()) {
+        workload_trace_action->setChecked(false);
+        return;
+    }
+
+    if (!WorkloadTrace::Start(filename.toStdString())) {
+        QMessageBox::critical(
+            this, tr("Record Workload Trace"),
+            tr("Could not open %1 for writing the workload trace.").arg(filename));
+        workload_trace_action->setChecked(false);
+    }
+}
+
 void GMainWindow::UpdateStatusBar() {
     if (emu_thread == nullptr) {
         status_bar_update_timer.stop();
@@ -661,13 +844,43 @@ void GMainWindow::UpdateStatusBar() {
 
     auto results = Core::System::GetInstance().GetAndResetPerfStats();
 
-    emu_speed_label->setText(tr("Speed: %1%").arg(results.emulation_speed * 100.0, 0, 'f', 0));
+    QString speed_text = tr("Speed: %1%").arg(results.emulation_speed * 100.0, 0, 'f', 0);
+    if (Settings::values.use_turbo_mode) {
+        speed_text += tr(" (Turbo)");
+    }
+    emu_speed_label->setText(speed_text);
     game_fps_label->setText(tr("Game: %1 FPS").arg(results.game_fps, 0, 'f', 0));
     emu_frametime_label->setText(tr("Frame: %1 ms").arg(results.frametime * 1000.0, 0, 'f', 2));
+    frame_low_label->setText(tr("1% Low: %1 FPS").arg(results.low_1_percent_fps, 0, 'f', 0));
+
+    // The details of the frame times go in the tooltips, the status bar has no room for them
+    using Phase = Core::PerfStats::FramePhase;
+    const auto phase_ms = [&results](Phase phase) {
+        return results.phase_times[static_cast<size_t>(phase)] * 1000.0;
+    };
+    emu_frametime_label->setToolTip(
+        tr("Time taken to emulate a Switch frame, not counting framelimiting or v-sync. For "
+           "full-speed emulation this should be at most 16.67 ms.\n\n"
+           "Average time per frame:\nCPU emulation: %1 ms\nHLE services: %2 ms\n"
+           "Composition: %3 ms\nUpload: %4 ms\nPresent: %5 ms")
+            .arg(phase_ms(Phase::CpuEmulation), 0, 'f', 2)
+            .arg(phase_ms(Phase::HleServices), 0, 'f', 2)
+            .arg(phase_ms(Phase::Composition), 0, 'f', 2)
+            .arg(phase_ms(Phase::Upload), 0, 'f', 2)
+            .arg(phase_ms(Phase::Present), 0, 'f', 2));
+    frame_low_label->setToolTip(
+        tr("Frame rate over the slowest 1% of the Switch frames, including waits. A value well "
+           "below the average frame rate means that the emulation stutters.\n\n"
+           "0.1% low: %1 FPS\nFrame time percentiles: p50 %2 ms, p95 %3 ms, p99 %4 ms")
+            .arg(results.low_0_1_percent_fps, 0, 'f', 0)
+            .arg(results.frametime_p50 * 1000.0, 0, 'f', 2)
+            .arg(results.frametime_p95 * 1000.0, 0, 'f', 2)
+            .arg(results.frametime_p99 * 1000.0, 0, 'f', 2));
 
     emu_speed_label->setVisible(true);
     game_fps_label->setVisible(true);
     emu_frametime_label->setVisible(true);
+    frame_low_label->setVisible(true);
 }
 
 void GMainWindow::OnCoreError(Core::System::ResultStatus result, std::string details) {
@@ -823,6 +1036,10 @@ int main(int argc, char* argv[]) {
     Log::Filter log_filter(Log::Level::Info);
     Log::SetFilter(&log_filter);
 
+    const std::string& log_dir = FileUtil::GetUserPath(D_LOGS_IDX);
+    FileUtil::CreateFullPath(log_dir);
+    Log::SetFileSink(log_dir + LOG_FILE);
+
     MicroProfileOnThreadCreate("Frontend");
     SCOPE_EXIT({ MicroProfileShutdown(); });
 
@@ -838,8 +1055,14 @@ int main(int argc, char* argv[]) {
     setlocale(LC_ALL, "C");
 
     GMainWindow main_window;
-    // After settings have been loaded by GMainWindow, apply the filter
+    // After settings have been loaded by GMainWindow, apply the filter, and again whenever the
+    // settings are applied
     log_filter.ParseFilterString(Settings::values.log_filter);
+    const size_t log_filter_callback = Settings::RegisterApplyCallback([&log_filter] {
+        log_filter.ResetAll(Log::Level::Info);
+        log_filter.ParseFilterString(Settings::values.log_filter);
+    });
+    SCOPE_EXIT({ Settings::UnregisterApplyCallback(log_filter_callback); });
 
     main_window.show();
     return app.exec();
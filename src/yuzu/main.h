@@ -21,9 +21,12 @@ class GraphicsBreakPointsWidget;
 class GraphicsTracingWidget;
 class GraphicsVertexShaderWidget;
 class GRenderWindow;
+class JitStatsWidget;
+class MemoryUsageWidget;
 class MicroProfileDialog;
 class ProfilerWidget;
 class RegistersWidget;
+class ServiceStatsWidget;
 class WaitTreeWidget;
 
 class GMainWindow : public QMainWindow {
@@ -126,6 +129,16 @@ private slots:
     void OnConfigure();
     void OnAbout();
     void OnToggleFilterBar();
+    /// Starts recording the scheduler trace, or stops it and saves it to a file
+    void OnToggleSchedulerTrace(bool record);
+    /// Starts tracing the SVCs, or stops it and saves the statistics and calls to a file
+    void OnToggleSvcTrace(bool record);
+    /// Starts sampling the guest code, or stops it and saves a report of the samples to a file
+    void OnToggleGuestProfile(bool record);
+    /// Starts capturing the IPC requests to a file, or stops the capture
+    void OnToggleIPCCapture(bool record);
+    /// Starts tracing the workload given to the services and the GPU to a file, or stops it
+    void OnToggleWorkloadTrace(bool record);
     void OnDisplayTitleBars(bool);
     void ToggleFullscreen();
     void ShowFullscreen();
@@ -146,6 +159,7 @@ private:
     QLabel* emu_speed_label = nullptr;
     QLabel* game_fps_label = nullptr;
     QLabel* emu_frametime_label = nullptr;
+    QLabel* frame_low_label = nullptr;
     QTimer status_bar_update_timer;
 
     std::unique_ptr<Config> config;
@@ -159,6 +173,11 @@ private:
     MicroProfileDialog* microProfileDialog;
     RegistersWidget* registersWidget;
     WaitTreeWidget* waitTreeWidget;
+    ServiceStatsWidget* serviceStatsWidget;
+    MemoryUsageWidget* memoryUsageWidget;
+    JitStatsWidget* jitStatsWidget;
+    QAction* ipc_capture_action = nullptr;
+    QAction* workload_trace_action = nullptr;
 
     QAction* actions_recent_files[max_recent_files_item];
 
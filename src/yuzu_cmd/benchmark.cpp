@@ -0,0 +1,241 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <boost/optional.hpp>
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "common/scm_rev.h"
+#include "common/string_util.h"
+#include "core/core.h"
+#include "core/core_timing.h"
+#include "core/perf_stats.h"
+#include "core/settings.h"
+#include "core/title_profile.h"
+#include "video_core/renderer_base.h"
+#include "video_core/renderer_null/renderer_null.h"
+#include "video_core/video_core.h"
+#include "yuzu_cmd/benchmark.h"
+
+namespace Benchmark {
+
+static std::string EscapeJson(const std::string& str) {
+    std::string escaped;
+    for (const char c : str) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        if (static_cast<unsigned char>(c) >= 0x20) {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+/// Returns the JIT counters accumulated between two snapshots of them
+static ARM_Interface::JitStats SubtractJitStats(const ARM_Interface::JitStats& end,
+                                                const ARM_Interface::JitStats& start) {
+    ARM_Interface::JitStats stats;
+    stats.runs = end.runs - start.runs;
+    stats.run_time_ns = end.run_time_ns - start.run_time_ns;
+    stats.halts = end.halts - start.halts;
+    stats.cache_clears = end.cache_clears - start.cache_clears;
+    stats.cache_invalidations = end.cache_invalidations - start.cache_invalidations;
+    stats.invalidated_bytes = end.invalidated_bytes - start.invalidated_bytes;
+    stats.translator_resets = end.translator_resets - start.translator_resets;
+    stats.interpreter_fallbacks = end.interpreter_fallbacks - start.interpreter_fallbacks;
+    stats.interpreted_instructions = end.interpreted_instructions - start.interpreted_instructions;
+    stats.svcs = end.svcs - start.svcs;
+    return stats;
+}
+
+static std::string MakeReport(const std::string& title_path, u64 frames, double emulated_seconds,
+                              double wall_seconds, const Core::PerfStats::Results& results,
+                              const Core::MemoryFootprint& footprint,
+                              const ARM_Interface::JitStats& jit_stats,
+                              const boost::optional<u64>& frames_hash) {
+    using Phase = Core::PerfStats::FramePhase;
+    const auto phase_ms = [&results](Phase phase) {
+        return results.phase_times[static_cast<size_t>(phase)] * 1000.0;
+    };
+    const u64 percentile_frames = std::min<u64>(frames, Core::PerfStats::FRAME_RING_SIZE);
+
+    std::string report = "{\n";
+    report += Common::StringFromFormat("  \"title\": \"%s\",\n", EscapeJson(title_path).c_str());
+    report += Common::StringFromFormat("  \"revision\": \"%s\",\n",
+                                       EscapeJson(Common::g_scm_rev).c_str());
+    report += Common::StringFromFormat("  \"branch\": \"%s\",\n",
+                                       EscapeJson(Common::g_scm_branch).c_str());
+    report += Common::StringFromFormat("  \"description\": \"%s\",\n",
+                                       EscapeJson(Common::g_scm_desc).c_str());
+    report += Common::StringFromFormat("  \"emulated_frames\": %llu,\n",
+                                       static_cast<unsigned long long>(frames));
+    report += Common::StringFromFormat("  \"emulated_seconds\": %.3f,\n", emulated_seconds);
+    report += Common::StringFromFormat("  \"wall_seconds\": %.3f,\n", wall_seconds);
+    if (frames_hash) {
+        report += Common::StringFromFormat("  \"frames_hash\": \"%016llx\",\n",
+                                           static_cast<unsigned long long>(*frames_hash));
+    }
+
+    report += "  \"perf\": {\n";
+    report += Common::StringFromFormat("    \"system_fps\": %.3f,\n", results.system_fps);
+    report += Common::StringFromFormat("    \"game_fps\": %.3f,\n", results.game_fps);
+    report += Common::StringFromFormat("    \"emulation_speed\": %.4f,\n", results.emulation_speed);
+    report += Common::StringFromFormat("    \"frametime_ms\": %.3f,\n", results.frametime * 1000.0);
+    report += Common::StringFromFormat("    \"percentile_frames\": %llu,\n",
+                                       static_cast<unsigned long long>(percentile_frames));
+    report += Common::StringFromFormat("    \"frametime_p50_ms\": %.3f,\n",
+                                       results.frametime_p50 * 1000.0);
+    report += Common::StringFromFormat("    \"frametime_p95_ms\": %.3f,\n",
+                                       results.frametime_p95 * 1000.0);
+    report += Common::StringFromFormat("    \"frametime_p99_ms\": %.3f,\n",
+                                       results.frametime_p99 * 1000.0);
+    report += Common::StringFromFormat("    \"low_1_percent_fps\": %.3f,\n",
+                                       results.low_1_percent_fps);
+    report += Common::StringFromFormat("    \"low_0_1_percent_fps\": %.3f,\n",
+                                       results.low_0_1_percent_fps);
+    report += "    \"phase_ms\": {\n";
+    report += Common::StringFromFormat("      \"cpu_emulation\": %.3f,\n",
+                                       phase_ms(Phase::CpuEmulation));
+    report += Common::StringFromFormat("      \"hle_services\": %.3f,\n",
+                                       phase_ms(Phase::HleServices));
+    report += Common::StringFromFormat("      \"composition\": %.3f,\n",
+                                       phase_ms(Phase::Composition));
+    report += Common::StringFromFormat("      \"upload\": %.3f,\n", phase_ms(Phase::Upload));
+    report += Common::StringFromFormat("      \"present\": %.3f\n", phase_ms(Phase::Present));
+    report += "    }\n  },\n";
+
+    report += "  \"jit\": {\n";
+    report += Common::StringFromFormat("    \"average_slice_length\": %.1f,\n",
+                                       results.average_slice_length);
+    report += Common::StringFromFormat("    \"exits_per_frame\": %.1f,\n",
+                                       results.jit_exits_per_frame);
+    const auto jit_field = [](const char* name, u64 value) {
+        return Common::StringFromFormat("    \"%s\": %llu,\n", name,
+                                        static_cast<unsigned long long>(value));
+    };
+    report += jit_field("runs", jit_stats.runs);
+    report += Common::StringFromFormat("    \"run_time_ms\": %.3f,\n",
+                                       jit_stats.run_time_ns / 1000000.0);
+    report += jit_field("halts", jit_stats.halts);
+    report += jit_field("cache_clears", jit_stats.cache_clears);
+    report += jit_field("cache_invalidations", jit_stats.cache_invalidations);
+    report += jit_field("invalidated_bytes", jit_stats.invalidated_bytes);
+    report += jit_field("translator_resets", jit_stats.translator_resets);
+    report += jit_field("interpreter_fallbacks", jit_stats.interpreter_fallbacks);
+    report += jit_field("interpreted_instructions", jit_stats.interpreted_instructions);
+    report += jit_field("svcs", jit_stats.svcs);
+    report += Common::StringFromFormat("    \"cache_bytes\": %llu\n",
+                                       static_cast<unsigned long long>(footprint.jit_cache));
+    report += "  },\n";
+
+    const auto memory_field = [](const char* name, u64 bytes, bool is_last) {
+        return Common::StringFromFormat("    \"%s\": %llu%s\n", name,
+                                        static_cast<unsigned long long>(bytes), is_last ? "" : ",");
+    };
+    report += "  \"memory\": {\n";
+    report += memory_field("page_tables", footprint.page_tables, false);
+    report += memory_field("guest_heap", footprint.guest_heap, false);
+    report += memory_field("code_sets", footprint.code_sets, false);
+    report += memory_field("shared_memory", footprint.shared_memory, false);
+    report += memory_field("other_guest_memory", footprint.other_guest_memory, false);
+    report += memory_field("jit_cache", footprint.jit_cache, false);
+    report += memory_field("renderer_buffers", footprint.renderer_buffers, false);
+    report += memory_field("service_buffers", footprint.service_buffers, false);
+    report += memory_field("total", footprint.Total(), true);
+    report += "  }\n}\n";
+    return report;
+}
+
+/// Exports the settings of the run to the profile of the title, unless the profile is better
+static bool ExportProfile(Core::System& system, double score) {
+    u64 program_id;
+    if (system.GetAppLoader().ReadProgramId(program_id) != Loader::ResultStatus::Success) {
+        LOG_CRITICAL(Frontend, "The title has no program id to name its profile after");
+        return false;
+    }
+
+    const std::string path = TitleProfile::GetPath(program_id);
+    if (FileUtil::Exists(path)) {
+        const boost::optional<double> profile_score = TitleProfile::ReadScore(path);
+        if (!profile_score) {
+            LOG_INFO(Frontend, "Kept the profile %s, it was written by hand", path.c_str());
+            return true;
+        }
+        if (*profile_score >= score) {
+            LOG_INFO(Frontend, "Kept the profile %s, it scored %.4f against %.4f", path.c_str(),
+                     *profile_score, score);
+            return true;
+        }
+    }
+    if (!TitleProfile::Write(path, Settings::values, score)) {
+        return false;
+    }
+    LOG_INFO(Frontend, "Exported the settings to the profile %s, scoring %.4f", path.c_str(),
+             score);
+    return true;
+}
+
+bool Run(Core::System& system, const Options& options, const std::string& title_path,
+         const bool& should_stop) {
+    using WallClock = std::chrono::steady_clock;
+
+    // The statistics are reset so that the loading is left out of them
+    system.GetAndResetPerfStats();
+    const ARM_Interface::JitStats start_jit_stats = system.GetJitStats();
+    const int start_frame = VideoCore::g_renderer->GetCurrentFrame();
+    const u64 start_us = CoreTiming::GetGlobalTimeUs();
+    const WallClock::time_point start_time = WallClock::now();
+    const u64 max_us = options.seconds * 1000000;
+
+    u64 frames = 0;
+    u64 emulated_us = 0;
+    while (true) {
+        frames = static_cast<u64>(VideoCore::g_renderer->GetCurrentFrame() - start_frame);
+        emulated_us = CoreTiming::GetGlobalTimeUs() - start_us;
+        if (should_stop || (options.frames != 0 && frames >= options.frames) ||
+            (max_us != 0 && emulated_us >= max_us)) {
+            break;
+        }
+        if (system.RunLoop() != Core::System::ResultStatus::Success) {
+            LOG_CRITICAL(Frontend, "The emulation failed during the benchmark");
+            return false;
+        }
+    }
+
+    const double wall_seconds =
+        std::chrono::duration<double>(WallClock::now() - start_time).count();
+    const Core::PerfStats::Results results = system.GetAndResetPerfStats();
+    const Core::MemoryFootprint footprint = system.GetMemoryFootprint();
+    const ARM_Interface::JitStats jit_stats =
+        SubtractJitStats(system.GetJitStats(), start_jit_stats);
+    boost::optional<u64> frames_hash;
+    if (options.hash_frames) {
+        const auto* renderer = dynamic_cast<const RendererNull*>(VideoCore::g_renderer.get());
+        if (renderer != nullptr) {
+            frames_hash = renderer->GetFramesHash();
+        }
+    }
+    const std::string report = MakeReport(title_path, frames, emulated_us / 1000000.0,
+                                          wall_seconds, results, footprint, jit_stats, frames_hash);
+
+    if (options.report_path.empty()) {
+        std::fputs(report.c_str(), stdout);
+    } else if (FileUtil::WriteStringToFile(true, report, options.report_path.c_str()) !=
+               report.size()) {
+        LOG_CRITICAL(Frontend, "Failed to write the benchmark report to %s",
+                     options.report_path.c_str());
+        return false;
+    }
+
+    // Runs are scored by their emulation speed, which the frame limiter must not cap
+    if (options.export_profile) {
+        return ExportProfile(system, emulated_us / 1000000.0 / wall_seconds);
+    }
+    return true;
+}
+
+} // namespace Benchmark
@@ -0,0 +1,43 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+#include "common/common_types.h"
+
+namespace Core {
+class System;
+}
+
+namespace Benchmark {
+
+struct Options {
+    /// Number of emulated frames to run for, no limit if zero
+    u64 frames = 0;
+    /// Emulated time to run for, in seconds, no limit if zero
+    u64 seconds = 0;
+    /// Percentage of native speed the run is limited to, unlimited if zero
+    u64 speed_limit = 0;
+    /// Whether the frames are rendered in a hidden window instead of not at all
+    bool offscreen = false;
+    /// Whether the contents of the frames are hashed, only without rendering
+    bool hash_frames = false;
+    /// File the JSON report is written to, standard output if empty
+    std::string report_path;
+    /// Whether the settings of the run are exported to the profile of the title, unless the
+    /// profile comes from a faster run or was written by hand
+    bool export_profile = false;
+};
+
+/**
+ * Runs the loaded title until it reaches the limits of the options or should_stop becomes true,
+ * then writes a report of the performance statistics, memory footprint and JIT statistics of the
+ * run. The loading is not part of the measurements.
+ * @returns Whether the report, and the profile if it was asked for, were written.
+ */
+bool Run(Core::System& system, const Options& options, const std::string& title_path,
+         const bool& should_stop);
+
+} // namespace Benchmark
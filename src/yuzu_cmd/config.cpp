@@ -84,16 +84,53 @@ void Config::ReadValues() {
     // Core
     Settings::values.cpu_core =
         static_cast<Settings::CpuCore>(sdl2_config->GetInteger("Core", "cpu_core", 0));
+    Settings::values.use_multi_core = sdl2_config->GetBoolean("Core", "use_multi_core", false);
+    Settings::values.use_lazy_module_loading =
+        sdl2_config->GetBoolean("Core", "use_lazy_module_loading", false);
+    Settings::values.use_shared_module_images =
+        sdl2_config->GetBoolean("Core", "use_shared_module_images", false);
+    Settings::values.use_code_write_detection =
+        sdl2_config->GetBoolean("Core", "use_code_write_detection", false);
+    Settings::values.cpu_clock_percentage =
+        static_cast<u32>(sdl2_config->GetInteger("Core", "cpu_clock_percentage", 100));
+    Settings::values.use_deterministic_mode =
+        sdl2_config->GetBoolean("Core", "use_deterministic_mode", false);
+    Settings::values.pin_host_threads = sdl2_config->GetBoolean("Core", "pin_host_threads", false);
+    Settings::values.use_title_profiles =
+        sdl2_config->GetBoolean("Core", "use_title_profiles", true);
+
+    // System
+    Settings::values.use_docked_mode = sdl2_config->GetBoolean("System", "use_docked_mode", false);
 
     // Renderer
     Settings::values.resolution_factor =
         (float)sdl2_config->GetReal("Renderer", "resolution_factor", 1.0);
     Settings::values.toggle_framelimit =
         sdl2_config->GetBoolean("Renderer", "toggle_framelimit", true);
+    Settings::values.speed_limit =
+        static_cast<u32>(sdl2_config->GetInteger("Renderer", "speed_limit", 100));
+    Settings::values.turbo_speed_limit =
+        static_cast<u32>(sdl2_config->GetInteger("Renderer", "turbo_speed_limit", 0));
+    Settings::values.present_ahead_depth =
+        static_cast<int>(sdl2_config->GetInteger("Renderer", "present_ahead_depth", 2));
+    Settings::values.use_low_latency_mode =
+        sdl2_config->GetBoolean("Renderer", "use_low_latency_mode", false);
+    Settings::values.refresh_mode = static_cast<Settings::RefreshMode>(
+        sdl2_config->GetInteger("Renderer", "refresh_mode", 0));
+    Settings::values.refresh_rate =
+        static_cast<u32>(sdl2_config->GetInteger("Renderer", "refresh_rate", 60));
+    Settings::values.use_gpu_unswizzle =
+        sdl2_config->GetBoolean("Renderer", "use_gpu_unswizzle", true);
 
     Settings::values.bg_red = (float)sdl2_config->GetReal("Renderer", "bg_red", 0.0);
     Settings::values.bg_green = (float)sdl2_config->GetReal("Renderer", "bg_green", 0.0);
     Settings::values.bg_blue = (float)sdl2_config->GetReal("Renderer", "bg_blue", 0.0);
+    Settings::values.frame_dump_file = sdl2_config->Get("Renderer", "frame_dump_file", "");
+
+    // Audio
+    Settings::values.sink_id = sdl2_config->Get("Audio", "output_engine", "auto");
+    Settings::values.enable_audio_stretching =
+        sdl2_config->GetBoolean("Audio", "enable_audio_stretching", true);
 
     // Data Storage
     Settings::values.use_virtual_sd =
@@ -80,6 +80,52 @@ touch_device=
 # 0 (default): Unicorn (slow), 1: Dynarmic (faster)
 cpu_core =
 
+# Whether to emulate each of the 4 CPU cores on its own host thread
+# 0 (default): All guest threads run on a single core, 1: Multi-core
+use_multi_core =
+
+# Whether to decompress the large read-only segments of executables when they are first accessed.
+# The first boot stores them in the cache directory, later boots reach the first frame sooner.
+# 0 (default): Load everything at boot, 1: Load on demand
+use_lazy_module_loading =
+
+# Whether to map the code and read-only data of executables from images in the cache directory.
+# Instances of the same executable running at the same time then share that memory on the host.
+# 0 (default): Each instance keeps its own copy, 1: Share the images
+use_shared_module_images =
+
+# Whether to watch the code of executables for writes, so that code patched at runtime is
+# translated again. Reads of data stored along with the code become slower.
+# 0 (default): Off, 1: On
+use_code_write_detection =
+
+# Percentage of the clock rate requested by the game the emulated CPU runs at. Values below 100
+# underclock it, which takes less host CPU per frame for games that tolerate it.
+# 10 - 100 (default)
+cpu_clock_percentage =
+
+# Whether the emulation only follows the guest clock, so that runs playing back the same movie (see
+# --movie-play) execute identically. The clocks of the guest start at a fixed date, audio is muted
+# and the emulation runs on a single core.
+# 0 (default): Off, 1: On
+use_deterministic_mode =
+
+# Whether the emulator threads are pinned to a host processor each, on the first NUMA node of the
+# host. Avoids migrations between processors and sockets, which helps on multi-socket hosts.
+# 0 (default): Off, 1: On
+pin_host_threads =
+
+# Whether the settings are overridden by the profile of the running game, if it has one. Profiles
+# are named after the program id of their game, in the profiles directory of the config directory,
+# and can be exported from benchmark runs (see --benchmark-profile).
+# 0: Off, 1 (default): On
+use_title_profiles =
+
+[System]
+# Whether the console is emulated as docked, which also selects the default performance mode
+# 0 (default): Handheld, 1: Docked
+use_docked_mode =
+
 [Renderer]
 # Whether to use software or hardware rendering.
 # 0: Software, 1 (default): Hardware
@@ -94,6 +140,10 @@ use_shader_jit =
 # factor for the Switch resolution
 resolution_factor =
 
+# Whether to unswizzle the framebuffers on the GPU instead of the CPU, if the GPU supports it
+# 0: Off, 1 (default): On
+use_gpu_unswizzle =
+
 # Whether to enable V-Sync (caps the framerate at 60FPS) or not.
 # 0 (default): Off, 1: On
 use_vsync =
@@ -104,6 +154,11 @@ bg_red =
 bg_blue =
 bg_green =
 
+# Dumps the presented frames to this file as a YUV4MPEG2 video (.y4m), at the internal resolution.
+# Frames are dropped instead of slowing down the emulation if the file can't be written fast enough.
+# Empty (default): Disabled
+frame_dump_file =
+
 [Layout]
 # Layout for the screen inside the render window.
 # 0 (default): Default Top Bottom Screen, 1: Single Screen Only, 2: Large Screen Small Screen
@@ -128,6 +183,31 @@ custom_bottom_bottom =
 # 0: Off , 1  (default): On
 toggle_framelimit =
 
+# Percentage of native speed the frame limiter targets. 0: Unlimited, 100 (default)
+speed_limit =
+
+# Percentage of native speed targeted in turbo mode, toggled with the Tab key. Turbo mode also
+# refreshes the emulated displays as soon as a frame is ready. 0 (default): Unlimited
+turbo_speed_limit =
+
+# Number of frames the emulation may get ahead of the presentation to the display.
+# Higher values smooth out slow frames, lower values reduce the input latency.
+# 1: Lowest latency, 2 (default), 3: Smoothest
+present_ahead_depth =
+
+# Paces the frames to the refresh of the display and samples the input right before each frame,
+# to reduce the input latency. Implies a present-ahead depth of 1.
+# 0 (default): Off, 1: On
+use_low_latency_mode =
+
+# How often the emulated displays refresh and signal vsync.
+# 0 (default): At refresh_rate, 1: At the rate of the host display,
+# 2: Unlocked, as soon as a frame is ready. Useful to benchmark, combined with toggle_framelimit = 0
+refresh_mode =
+
+# Refresh rate of the emulated displays when refresh_mode is 0, in Hz. 60 (default)
+refresh_rate =
+
 # Swaps the prominent screen with the other screen.
 # For example, if Single Screen is chosen, setting this to 1 will display the bottom screen instead of the top screen.
 # 0 (default): Top Screen is prominent, 1: Bottom Screen is prominent
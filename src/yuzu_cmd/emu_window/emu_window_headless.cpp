@@ -0,0 +1,17 @@
+// Copyright 2018 yuzu emulator team
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "core/frontend/framebuffer_layout.h"
+#include "input_common/main.h"
+#include "yuzu_cmd/emu_window/emu_window_headless.h"
+
+EmuWindow_Headless::EmuWindow_Headless() {
+    // The input devices are still created from the settings, they just never see any events
+    InputCommon::Init();
+    UpdateCurrentFramebufferLayout(Layout::ScreenUndocked::Width, Layout::ScreenUndocked::Height);
+}
+
+EmuWindow_Headless::~EmuWindow_Headless() {
+    InputCommon::Shutdown();
+}
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <cstdlib>
 #include <string>
+#include <thread>
 #define SDL_MAIN_HANDLED
 #include <SDL.h>
 #include <glad/glad.h>
@@ -56,17 +57,30 @@ void EmuWindow_SDL2::OnResize() {
     UpdateCurrentFramebufferLayout(width, height);
 }
 
-EmuWindow_SDL2::EmuWindow_SDL2() {
-    InputCommon::Init();
-
+EmuWindow_SDL2::EmuWindow_SDL2(bool offscreen) : window_thread_id(std::this_thread::get_id()) {
     SDL_SetMainReady();
 
+#ifndef _WIN32
+    // SDL's offscreen driver renders to EGL pbuffers, which works on machines without a display.
+    // The default driver is used when it isn't available, the window is then hidden instead.
+    if (offscreen && std::getenv("SDL_VIDEODRIVER") == nullptr) {
+        setenv("SDL_VIDEODRIVER", "offscreen", 1);
+        if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+            LOG_WARNING(Frontend, "The offscreen video driver is unavailable: %s", SDL_GetError());
+            unsetenv("SDL_VIDEODRIVER");
+        }
+    }
+#endif
+
     // Initialize the window
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+    if (SDL_WasInit(SDL_INIT_VIDEO) == 0 && SDL_Init(SDL_INIT_VIDEO) < 0) {
         LOG_CRITICAL(Frontend, "Failed to initialize SDL2! Exiting...");
         exit(1);
     }
 
+    // The joysticks are initialized in the background, which mustn't overlap SDL_Init above
+    InputCommon::Init();
+
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
@@ -75,6 +89,8 @@ EmuWindow_SDL2::EmuWindow_SDL2() {
     SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
     SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
     SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 0);
+    // Contexts created later for worker threads share their objects with the window's
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
 
     std::string window_title = Common::StringFromFormat("yuzu %s| %s-%s ", Common::g_build_name,
                                                         Common::g_scm_branch, Common::g_scm_desc);
@@ -83,7 +99,8 @@ EmuWindow_SDL2::EmuWindow_SDL2() {
                          SDL_WINDOWPOS_UNDEFINED, // x position
                          SDL_WINDOWPOS_UNDEFINED, // y position
                          Layout::ScreenUndocked::Width, Layout::ScreenUndocked::Height,
-                         SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
+                         SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI |
+                             (offscreen ? SDL_WINDOW_HIDDEN : 0));
 
     if (render_window == nullptr) {
         LOG_CRITICAL(Frontend, "Failed to create SDL2 window! Exiting...");
@@ -102,6 +119,10 @@ EmuWindow_SDL2::EmuWindow_SDL2() {
         exit(1);
     }
 
+    if (offscreen) {
+        SDL_GL_SetSwapInterval(0);
+    }
+
     OnResize();
     OnMinimalClientAreaChangeRequest(GetActiveConfig().min_client_area_size);
     SDL_PumpEvents();
@@ -121,40 +142,72 @@ void EmuWindow_SDL2::SwapBuffers() {
 }
 
 void EmuWindow_SDL2::PollEvents() {
+    // While the event loop runs, the emulation calls this from its own thread, which must not
+    // touch the window
+    if (std::this_thread::get_id() != window_thread_id) {
+        return;
+    }
+
     SDL_Event event;
 
     // SDL_PollEvent returns 0 when there are no more events in the event queue
     while (SDL_PollEvent(&event)) {
-        switch (event.type) {
-        case SDL_WINDOWEVENT:
-            switch (event.window.event) {
-            case SDL_WINDOWEVENT_SIZE_CHANGED:
-            case SDL_WINDOWEVENT_RESIZED:
-            case SDL_WINDOWEVENT_MAXIMIZED:
-            case SDL_WINDOWEVENT_RESTORED:
-            case SDL_WINDOWEVENT_MINIMIZED:
-                OnResize();
-                break;
-            case SDL_WINDOWEVENT_CLOSE:
-                is_open = false;
-                break;
-            }
-            break;
-        case SDL_KEYDOWN:
-        case SDL_KEYUP:
-            OnKeyEvent(static_cast<int>(event.key.keysym.scancode), event.key.state);
-            break;
-        case SDL_MOUSEMOTION:
-            OnMouseMotion(event.motion.x, event.motion.y);
-            break;
-        case SDL_MOUSEBUTTONDOWN:
-        case SDL_MOUSEBUTTONUP:
-            OnMouseButton(event.button.button, event.button.state, event.button.x, event.button.y);
+        HandleEvent(event);
+    }
+}
+
+void EmuWindow_SDL2::RunEventLoop() {
+    SDL_Event event;
+    while (is_open && SDL_WaitEvent(&event)) {
+        HandleEvent(event);
+    }
+}
+
+void EmuWindow_SDL2::Close() {
+    is_open = false;
+
+    // Wakes the event loop up
+    SDL_Event event{};
+    event.type = SDL_QUIT;
+    SDL_PushEvent(&event);
+}
+
+void EmuWindow_SDL2::HandleEvent(const SDL_Event& event) {
+    switch (event.type) {
+    case SDL_WINDOWEVENT:
+        switch (event.window.event) {
+        case SDL_WINDOWEVENT_SIZE_CHANGED:
+        case SDL_WINDOWEVENT_RESIZED:
+        case SDL_WINDOWEVENT_MAXIMIZED:
+        case SDL_WINDOWEVENT_RESTORED:
+        case SDL_WINDOWEVENT_MINIMIZED:
+            OnResize();
             break;
-        case SDL_QUIT:
+        case SDL_WINDOWEVENT_CLOSE:
             is_open = false;
             break;
         }
+        break;
+    case SDL_KEYDOWN:
+        if (event.key.keysym.scancode == SDL_SCANCODE_TAB && event.key.repeat == 0) {
+            Settings::values.use_turbo_mode = !Settings::values.use_turbo_mode;
+            LOG_INFO(Frontend, "Turbo mode %s", Settings::values.use_turbo_mode ? "on" : "off");
+        }
+        OnKeyEvent(static_cast<int>(event.key.keysym.scancode), event.key.state);
+        break;
+    case SDL_KEYUP:
+        OnKeyEvent(static_cast<int>(event.key.keysym.scancode), event.key.state);
+        break;
+    case SDL_MOUSEMOTION:
+        OnMouseMotion(event.motion.x, event.motion.y);
+        break;
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+        OnMouseButton(event.button.button, event.button.state, event.button.x, event.button.y);
+        break;
+    case SDL_QUIT:
+        is_open = false;
+        break;
     }
 }
 
@@ -166,6 +219,39 @@ void EmuWindow_SDL2::DoneCurrent() {
     SDL_GL_MakeCurrent(render_window, nullptr);
 }
 
+/// GL context sharing its objects with the context of the window, used with the window as surface
+class SDLGLContext : public EmuWindow::GraphicsContext {
+public:
+    SDLGLContext(SDL_Window* window, SDL_GLContext context) : window(window), context(context) {}
+
+    ~SDLGLContext() override {
+        SDL_GL_DeleteContext(context);
+    }
+
+    void MakeCurrent() override {
+        SDL_GL_MakeCurrent(window, context);
+    }
+
+    void DoneCurrent() override {
+        SDL_GL_MakeCurrent(window, nullptr);
+    }
+
+private:
+    SDL_Window* window;
+    SDL_GLContext context;
+};
+
+std::unique_ptr<EmuWindow::GraphicsContext> EmuWindow_SDL2::CreateSharedContext() const {
+    // The new context shares with the current one, and creating it makes it current
+    SDL_GLContext context = SDL_GL_CreateContext(render_window);
+    SDL_GL_MakeCurrent(render_window, gl_context);
+    if (context == nullptr) {
+        LOG_ERROR(Frontend, "Failed to create a shared GL context: %s", SDL_GetError());
+        return nullptr;
+    }
+    return std::make_unique<SDLGLContext>(render_window, context);
+}
+
 void EmuWindow_SDL2::OnMinimalClientAreaChangeRequest(
     const std::pair<unsigned, unsigned>& minimal_size) {
 
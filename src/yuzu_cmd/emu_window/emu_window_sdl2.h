@@ -4,43 +4,68 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <thread>
 #include <utility>
 #include "core/frontend/emu_window.h"
 
 struct SDL_Window;
+union SDL_Event;
 
 class EmuWindow_SDL2 : public EmuWindow {
 public:
-    EmuWindow_SDL2();
+    /**
+     * Creates the window and its GL context.
+     * @param offscreen Whether the window is rendered offscreen, or else hidden, and doesn't wait
+     *                  for v-sync, for benchmarks that still render.
+     */
+    explicit EmuWindow_SDL2(bool offscreen = false);
     ~EmuWindow_SDL2();
 
     /// Swap buffers to display the next frame
     void SwapBuffers() override;
 
-    /// Polls window events
+    /// Handles the pending window events, if called from the thread that created the window
     void PollEvents() override;
 
+    /**
+     * Waits for the window events and handles them as they come until the window is closed, on the
+     * thread that created the window while the emulation runs on another one. Input is forwarded
+     * to input_common right away, so that busy frames don't delay it and window moves or resizes
+     * don't stall the emulation.
+     */
+    void RunEventLoop();
+
+    /// Marks the window as closed and wakes the event loop up, from any thread
+    void Close();
+
     /// Makes the graphics context current for the caller thread
     void MakeCurrent() override;
 
     /// Releases the GL context from the caller thread
     void DoneCurrent() override;
 
+    /// Creates a GL context sharing its objects with the context of the window
+    std::unique_ptr<GraphicsContext> CreateSharedContext() const override;
+
     /// Whether the window is still open, and a close request hasn't yet been sent
     bool IsOpen() const;
 
 private:
-    /// Called by PollEvents when a key is pressed or released.
+    /// Dispatches a window event to the handlers below
+    void HandleEvent(const SDL_Event& event);
+
+    /// Called by HandleEvent when a key is pressed or released.
     void OnKeyEvent(int key, u8 state);
 
-    /// Called by PollEvents when the mouse moves.
+    /// Called by HandleEvent when the mouse moves.
     void OnMouseMotion(s32 x, s32 y);
 
-    /// Called by PollEvents when a mouse button is pressed or released
+    /// Called by HandleEvent when a mouse button is pressed or released
     void OnMouseButton(u32 button, u8 state, s32 x, s32 y);
 
-    /// Called by PollEvents when any event that may cause the window to be resized occurs
+    /// Called by HandleEvent when any event that may cause the window to be resized occurs
     void OnResize();
 
     /// Called when a configuration change affects the minimal size of the window
@@ -48,7 +73,10 @@ private:
         const std::pair<unsigned, unsigned>& minimal_size) override;
 
     /// Is the window still open?
-    bool is_open = true;
+    std::atomic<bool> is_open{true};
+
+    /// Thread that created the window, the only one handling its events
+    std::thread::id window_thread_id;
 
     /// Internal SDL2 render window
     SDL_Window* render_window;
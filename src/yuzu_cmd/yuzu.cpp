@@ -24,25 +24,67 @@
 #include <shellapi.h>
 #endif
 
+#include "common/common_paths.h"
+#include "common/file_util.h"
 #include "common/logging/backend.h"
 #include "common/logging/filter.h"
 #include "common/logging/log.h"
 #include "common/scm_rev.h"
 #include "common/scope_exit.h"
 #include "common/string_util.h"
+#include "common/thread.h"
 #include "core/core.h"
 #include "core/gdbstub/gdbstub.h"
 #include "core/loader/loader.h"
+#include "core/movie.h"
 #include "core/settings.h"
+#include "yuzu_cmd/benchmark.h"
 #include "yuzu_cmd/config.h"
+#include "yuzu_cmd/emu_window/emu_window_headless.h"
 #include "yuzu_cmd/emu_window/emu_window_sdl2.h"
 
 static void PrintHelp(const char* argv0) {
     std::cout << "Usage: " << argv0
               << " [options] <filename>\n"
-                 "-g, --gdbport=NUMBER  Enable gdb stub on port NUMBER\n"
-                 "-h, --help            Display this help and exit\n"
-                 "-v, --version         Output version information and exit\n";
+                 "-g, --gdbport=NUMBER     Enable gdb stub on port NUMBER\n"
+                 "-h, --help               Display this help and exit\n"
+                 "-r, --movie-record=FILE  Record the input to FILE\n"
+                 "-p, --movie-play=FILE    Play back the input of FILE and exit once it ends\n"
+                 "-v, --version            Output version information and exit\n"
+                 "\n"
+                 "Benchmark mode, running without a window or frame limiting (see -S) and\n"
+                 "writing a JSON report of the performance statistics. It stops once a limit is\n"
+                 "reached or the played back input ends. The frame time percentiles cover the\n"
+                 "last "
+              << Core::PerfStats::FRAME_RING_SIZE
+              << " frames.\n"
+                 "-f, --benchmark-frames=NUMBER   Run for NUMBER emulated frames\n"
+                 "-s, --benchmark-seconds=NUMBER  Run for NUMBER emulated seconds\n"
+                 "-S, --benchmark-speed=PERCENT   Limit the speed to PERCENT of native speed,\n"
+                 "                                to run at a fixed multiple of real time\n"
+                 "-o, --benchmark-report=FILE     Write the report to FILE instead of the\n"
+                 "                                standard output\n"
+                 "-x, --benchmark-offscreen       Render the frames offscreen instead of not\n"
+                 "                                rendering them, without a display if SDL can\n"
+                 "                                use EGL\n"
+                 "-H, --benchmark-hash-frames     Hash the contents of the frames when not\n"
+                 "                                rendering them, to check that runs match\n"
+                 "-P, --benchmark-profile         Export the settings to the profile of the\n"
+                 "                                game unless it has a faster one, without\n"
+                 "                                applying its profile to the run\n";
+}
+
+static bool ParseBenchmarkLimit(const char* name, u64& value) {
+    char* endarg;
+    errno = 0;
+    value = strtoull(optarg, &endarg, 0);
+    if (endarg == optarg || *endarg != '\0')
+        errno = EINVAL;
+    if (errno != 0) {
+        perror(name);
+        return false;
+    }
+    return true;
 }
 
 static void PrintVersion() {
@@ -66,16 +108,29 @@ int main(int argc, char** argv) {
     }
 #endif
     std::string filepath;
+    std::string movie_record;
+    std::string movie_play;
+    bool is_benchmark = false;
+    Benchmark::Options benchmark_options;
 
     static struct option long_options[] = {
         {"gdbport", required_argument, 0, 'g'},
         {"help", no_argument, 0, 'h'},
+        {"movie-record", required_argument, 0, 'r'},
+        {"movie-play", required_argument, 0, 'p'},
         {"version", no_argument, 0, 'v'},
+        {"benchmark-frames", required_argument, 0, 'f'},
+        {"benchmark-seconds", required_argument, 0, 's'},
+        {"benchmark-speed", required_argument, 0, 'S'},
+        {"benchmark-report", required_argument, 0, 'o'},
+        {"benchmark-offscreen", no_argument, 0, 'x'},
+        {"benchmark-hash-frames", no_argument, 0, 'H'},
+        {"benchmark-profile", no_argument, 0, 'P'},
         {0, 0, 0, 0},
     };
 
     while (optind < argc) {
-        char arg = getopt_long(argc, argv, "g:hv", long_options, &option_index);
+        char arg = getopt_long(argc, argv, "g:hr:p:vf:s:S:o:xHP", long_options, &option_index);
         if (arg != -1) {
             switch (arg) {
             case 'g':
@@ -92,9 +147,46 @@ int main(int argc, char** argv) {
             case 'h':
                 PrintHelp(argv[0]);
                 return 0;
+            case 'r':
+                movie_record = optarg;
+                break;
+            case 'p':
+                movie_play = optarg;
+                break;
             case 'v':
                 PrintVersion();
                 return 0;
+            case 'f':
+                if (!ParseBenchmarkLimit("--benchmark-frames", benchmark_options.frames))
+                    exit(1);
+                is_benchmark = true;
+                break;
+            case 's':
+                if (!ParseBenchmarkLimit("--benchmark-seconds", benchmark_options.seconds))
+                    exit(1);
+                is_benchmark = true;
+                break;
+            case 'S':
+                if (!ParseBenchmarkLimit("--benchmark-speed", benchmark_options.speed_limit))
+                    exit(1);
+                is_benchmark = true;
+                break;
+            case 'o':
+                benchmark_options.report_path = optarg;
+                is_benchmark = true;
+                break;
+            case 'x':
+                benchmark_options.offscreen = true;
+                is_benchmark = true;
+                break;
+            case 'H':
+                benchmark_options.hash_frames = true;
+                is_benchmark = true;
+                break;
+            case 'P':
+                benchmark_options.export_profile = true;
+                is_benchmark = true;
+                break;
             }
         } else {
 #ifdef _WIN32
@@ -113,6 +205,10 @@ int main(int argc, char** argv) {
     Log::Filter log_filter(Log::Level::Debug);
     Log::SetFilter(&log_filter);
 
+    const std::string& log_dir = FileUtil::GetUserPath(D_LOGS_IDX);
+    FileUtil::CreateFullPath(log_dir);
+    Log::SetFileSink(log_dir + LOG_FILE);
+
     MicroProfileOnThreadCreate("EmuThread");
     SCOPE_EXIT({ MicroProfileShutdown(); });
 
@@ -121,20 +217,66 @@ int main(int argc, char** argv) {
         return -1;
     }
 
+    if (is_benchmark && benchmark_options.frames == 0 && benchmark_options.seconds == 0 &&
+        movie_play.empty()) {
+        LOG_CRITICAL(Frontend, "The benchmark needs a number of frames or seconds, or an input "
+                               "recording to play back");
+        return -1;
+    }
+    if (benchmark_options.hash_frames && benchmark_options.offscreen) {
+        LOG_CRITICAL(Frontend, "The frames can only be hashed when they aren't rendered");
+        return -1;
+    }
+    if (benchmark_options.export_profile && benchmark_options.speed_limit != 0) {
+        LOG_CRITICAL(Frontend, "Profiles are only exported from runs without a speed limit");
+        return -1;
+    }
+
     log_filter.ParseFilterString(Settings::values.log_filter);
 
     // Apply the command line arguments
     Settings::values.gdbstub_port = gdb_port;
     Settings::values.use_gdbstub = use_gdbstub;
+    if (is_benchmark) {
+        Settings::values.toggle_framelimit = benchmark_options.speed_limit != 0;
+        Settings::values.speed_limit = static_cast<u32>(benchmark_options.speed_limit);
+        Settings::values.use_turbo_mode = false;
+        Settings::values.use_null_renderer = !benchmark_options.offscreen;
+        Settings::values.hash_null_renderer_frames = benchmark_options.hash_frames;
+        // The run measures the settings it would export, rather than the current profile
+        if (benchmark_options.export_profile) {
+            Settings::values.use_title_profiles = false;
+        }
+    }
     Settings::Apply();
 
-    std::unique_ptr<EmuWindow_SDL2> emu_window{std::make_unique<EmuWindow_SDL2>()};
+    std::unique_ptr<EmuWindow_SDL2> sdl_window;
+    std::unique_ptr<EmuWindow_Headless> headless_window;
+    EmuWindow* emu_window;
+    if (Settings::values.use_null_renderer) {
+        headless_window = std::make_unique<EmuWindow_Headless>();
+        emu_window = headless_window.get();
+    } else {
+        sdl_window = std::make_unique<EmuWindow_SDL2>(is_benchmark);
+        emu_window = sdl_window.get();
+    }
 
     Core::System& system{Core::System::GetInstance()};
 
     SCOPE_EXIT({ system.Shutdown(); });
 
-    const Core::System::ResultStatus load_result{system.Load(emu_window.get(), filepath)};
+    bool is_movie_finished = false;
+    Core::Movie& movie{Core::Movie::GetInstance()};
+    if (!movie_play.empty()) {
+        if (!movie.StartPlayback(movie_play)) {
+            return -1;
+        }
+        movie.SetPlaybackCompletionCallback([&is_movie_finished] { is_movie_finished = true; });
+    } else if (!movie_record.empty()) {
+        movie.StartRecording(movie_record);
+    }
+
+    const Core::System::ResultStatus load_result{system.Load(emu_window, filepath)};
 
     switch (load_result) {
     case Core::System::ResultStatus::ErrorGetLoader:
@@ -167,9 +309,24 @@ int main(int argc, char** argv) {
 
     Core::Telemetry().AddField(Telemetry::FieldType::App, "Frontend", "SDL");
 
-    while (emu_window->IsOpen()) {
-        system.RunLoop();
+    if (is_benchmark) {
+        return Benchmark::Run(system, benchmark_options, filepath, is_movie_finished) ? 0 : -1;
     }
 
+    // The emulation runs on its own thread, while this one handles the events of the window
+    std::thread emu_thread([&] {
+        MicroProfileOnThreadCreate("EmuThread");
+        Common::PinCurrentHostThread(Common::HostThread::CpuCore0);
+        while (sdl_window->IsOpen() && !is_movie_finished) {
+            system.RunLoop();
+        }
+        sdl_window->Close();
+#if MICROPROFILE_ENABLED
+        MicroProfileOnThreadExit();
+#endif
+    });
+    sdl_window->RunEventLoop();
+    emu_thread.join();
+
     return 0;
 }